@@ -436,7 +436,7 @@ bool CActiveMasternode::SendMasternodePing(std::string& errorMessage)
 
         // SetLastPing locks the masternode cs, be careful with the lock order.
         pmn->SetLastPing(mnp);
-        mnodeman.mapSeenMasternodePing.emplace(mnp.GetHash(), mnp);
+        mnodeman.AddSeenMasternodePing(mnp);
 
         //mnodeman.mapSeenMasternodeBroadcast.lastPing is probably outdated, so we'll update it
         CMasternodeBroadcast mnb(*pmn);
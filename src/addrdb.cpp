@@ -24,10 +24,8 @@ bool SerializeDB(Stream& stream, const Data& data)
 {
     // Write and commit header, data
     try {
-        CHashWriter hasher(SER_DISK, CLIENT_VERSION);
         stream << Params().MessageStart() << data;
-        hasher << Params().MessageStart() << data;
-        stream << hasher.GetHash();
+        stream << Hash(stream.begin(), stream.end());
     } catch (const std::exception& e) {
         return error("%s: Serialize or I/O error - %s", __func__, e.what());
     }
@@ -43,6 +41,12 @@ bool SerializeFileDB(const std::string& prefix, const fs::path& path, const Data
     GetRandBytes((unsigned char*)&randv, sizeof(randv));
     std::string tmpfn = strprintf("%s.%04x", prefix, randv);
 
+    // Serialize to memory first: the locks of data are only held for that, not for the disk writes
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    if (!SerializeDB(ss, data)) {
+        return false;
+    }
+
     // open temp output file, and associate with CAutoFile
     fs::path pathTmp = GetDataDir() / tmpfn;
     FILE *file = fsbridge::fopen(pathTmp, "wb");
@@ -53,11 +57,13 @@ bool SerializeFileDB(const std::string& prefix, const fs::path& path, const Data
         return error("%s: Failed to open file %s", __func__, pathTmp.string());
     }
 
-    // Serialize
-    if (!SerializeDB(fileout, data)) {
+    // Write
+    try {
+        fileout.write(ss.data(), ss.size());
+    } catch (const std::exception& e) {
         fileout.fclose();
         remove(pathTmp);
-        return false;
+        return error("%s: I/O error - %s", __func__, e.what());
     }
     if (!FileCommit(fileout.Get())) {
         fileout.fclose();
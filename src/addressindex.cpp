@@ -0,0 +1,90 @@
+// Copyright (c) 2016 BitPay, Inc.
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "addressindex.h"
+
+#include "coins.h"
+#include "primitives/transaction.h"
+#include "pubkey.h"
+#include "undo.h"
+
+std::vector<std::pair<AddressType, uint160>> GetIndexedAddresses(const CScript& script)
+{
+    std::vector<std::pair<AddressType, uint160>> ret;
+    txnouttype type;
+    std::vector<std::vector<unsigned char>> vSolutions;
+    if (!Solver(script, type, vSolutions)) {
+        return ret;
+    }
+    switch (type) {
+    case TX_PUBKEY:
+        ret.emplace_back(AddressType::KEY_HASH, CPubKey(vSolutions[0]).GetID());
+        break;
+    case TX_PUBKEYHASH:
+    case TX_EXCHANGEADDR:
+        ret.emplace_back(AddressType::KEY_HASH, uint160(vSolutions[0]));
+        break;
+    case TX_SCRIPTHASH:
+        ret.emplace_back(AddressType::SCRIPT_HASH, uint160(vSolutions[0]));
+        break;
+    case TX_COLDSTAKE:
+        ret.emplace_back(AddressType::KEY_HASH, uint160(vSolutions[0]));
+        if (vSolutions[1] != vSolutions[0]) {
+            ret.emplace_back(AddressType::KEY_HASH, uint160(vSolutions[1]));
+        }
+        break;
+    default:
+        break;
+    }
+    return ret;
+}
+
+namespace {
+
+class IndexedAddressVisitor : public boost::static_visitor<std::pair<AddressType, uint160>>
+{
+public:
+    std::pair<AddressType, uint160> operator()(const CKeyID& id) const { return {AddressType::KEY_HASH, id}; }
+    std::pair<AddressType, uint160> operator()(const CExchangeKeyID& id) const { return {AddressType::KEY_HASH, id}; }
+    std::pair<AddressType, uint160> operator()(const CScriptID& id) const { return {AddressType::SCRIPT_HASH, id}; }
+    std::pair<AddressType, uint160> operator()(const CNoDestination& no) const { return {AddressType::UNKNOWN, uint160()}; }
+};
+
+} // anon namespace
+
+std::pair<AddressType, uint160> GetIndexedAddress(const CTxDestination& dest)
+{
+    return boost::apply_visitor(IndexedAddressVisitor(), dest);
+}
+
+void CollectAddressIndexEntries(const CTransaction& tx, const CTxUndo* txundo, int nHeight, unsigned int nTxIndex,
+                                bool fUndo, AddressIndexEntries& vIndex, AddressUnspentEntries& vUnspent)
+{
+    const uint256& txid = tx.GetHash();
+    if (txundo && txundo->vprevout.size() == tx.vin.size()) {
+        for (unsigned int j = 0; j < tx.vin.size(); j++) {
+            const Coin& coin = txundo->vprevout[j];
+            const COutPoint& prevout = tx.vin[j].prevout;
+            for (const auto& addr : GetIndexedAddresses(coin.out.scriptPubKey)) {
+                vIndex.emplace_back(CAddressIndexKey(addr.first, addr.second, nHeight, nTxIndex, txid, j, true),
+                                    -coin.out.nValue);
+                vUnspent.emplace_back(CAddressUnspentKey(addr.first, addr.second, prevout.hash, prevout.n),
+                                      fUndo ? CAddressUnspentValue(coin.out.nValue, coin.out.scriptPubKey, coin.nHeight)
+                                            : CAddressUnspentValue());
+            }
+        }
+    }
+    for (unsigned int k = 0; k < tx.vout.size(); k++) {
+        const CTxOut& out = tx.vout[k];
+        if (out.scriptPubKey.IsUnspendable()) continue;
+        for (const auto& addr : GetIndexedAddresses(out.scriptPubKey)) {
+            vIndex.emplace_back(CAddressIndexKey(addr.first, addr.second, nHeight, nTxIndex, txid, k, false),
+                                out.nValue);
+            vUnspent.emplace_back(CAddressUnspentKey(addr.first, addr.second, txid, k),
+                                  fUndo ? CAddressUnspentValue()
+                                        : CAddressUnspentValue(out.nValue, out.scriptPubKey, nHeight));
+        }
+    }
+}
@@ -0,0 +1,199 @@
+// Copyright (c) 2016 BitPay, Inc.
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_ADDRESSINDEX_H
+#define PIVX_ADDRESSINDEX_H
+
+#include "amount.h"
+#include "crypto/common.h"
+#include "script/script.h"
+#include "script/standard.h"
+#include "serialize.h"
+#include "uint256.h"
+
+#include <utility>
+#include <vector>
+
+class CTransaction;
+class CTxUndo;
+
+//! Default for -addressindex
+static const bool DEFAULT_ADDRESSINDEX = false;
+
+/** Type of the hashes indexed by the address index */
+enum class AddressType : uint8_t {
+    UNKNOWN = 0,
+    KEY_HASH = 1,       // P2PK, P2PKH, exchange addresses, and both the keys of P2CS
+    SCRIPT_HASH = 2,    // P2SH
+};
+
+namespace addressindex {
+
+template <typename Stream>
+inline void WriteBE32(Stream& s, uint32_t n)
+{
+    unsigned char buf[4];
+    ::WriteBE32(buf, n);
+    s.write((char*)buf, sizeof(buf));
+}
+
+template <typename Stream>
+inline uint32_t ReadBE32(Stream& s)
+{
+    unsigned char buf[4];
+    s.read((char*)buf, sizeof(buf));
+    return ::ReadBE32(buf);
+}
+
+} // namespace addressindex
+
+/**
+ * Key of the entries of the address index: one for each output paying to an address,
+ * and for each input spending one. They are ordered by address and height.
+ */
+struct CAddressIndexKey
+{
+    AddressType type{AddressType::UNKNOWN};
+    uint160 hashBytes;
+    int blockHeight{0};
+    unsigned int txindex{0};
+    uint256 txhash;
+    unsigned int index{0};
+    bool spending{false};
+
+    CAddressIndexKey() = default;
+    CAddressIndexKey(AddressType _type, const uint160& _hashBytes, int _blockHeight, unsigned int _txindex,
+                     const uint256& _txhash, unsigned int _index, bool _spending) :
+        type(_type), hashBytes(_hashBytes), blockHeight(_blockHeight), txindex(_txindex),
+        txhash(_txhash), index(_index), spending(_spending) {}
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, (uint8_t)type);
+        hashBytes.Serialize(s);
+        // Heights and tx positions are stored big-endian for the ordering of the keys
+        addressindex::WriteBE32(s, blockHeight);
+        addressindex::WriteBE32(s, txindex);
+        txhash.Serialize(s);
+        ser_writedata32(s, index);
+        ser_writedata8(s, spending);
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        type = (AddressType)ser_readdata8(s);
+        hashBytes.Unserialize(s);
+        blockHeight = addressindex::ReadBE32(s);
+        txindex = addressindex::ReadBE32(s);
+        txhash.Unserialize(s);
+        index = ser_readdata32(s);
+        spending = ser_readdata8(s) != 0;
+    }
+};
+
+/** Prefix of the keys of an address (from a height), to iterate over its entries */
+struct CAddressIndexIteratorKey
+{
+    AddressType type;
+    uint160 hashBytes;
+    int blockHeight;
+
+    CAddressIndexIteratorKey(AddressType _type, const uint160& _hashBytes, int _blockHeight = 0) :
+        type(_type), hashBytes(_hashBytes), blockHeight(_blockHeight) {}
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, (uint8_t)type);
+        hashBytes.Serialize(s);
+        addressindex::WriteBE32(s, blockHeight);
+    }
+};
+
+/** Key of the unspent outputs of an address */
+struct CAddressUnspentKey
+{
+    AddressType type{AddressType::UNKNOWN};
+    uint160 hashBytes;
+    uint256 txhash;
+    unsigned int index{0};
+
+    CAddressUnspentKey() = default;
+    CAddressUnspentKey(AddressType _type, const uint160& _hashBytes, const uint256& _txhash, unsigned int _index) :
+        type(_type), hashBytes(_hashBytes), txhash(_txhash), index(_index) {}
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, (uint8_t)type);
+        hashBytes.Serialize(s);
+        txhash.Serialize(s);
+        ser_writedata32(s, index);
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        type = (AddressType)ser_readdata8(s);
+        hashBytes.Unserialize(s);
+        txhash.Unserialize(s);
+        index = ser_readdata32(s);
+    }
+};
+
+/** Prefix of the unspent outputs keys of an address */
+struct CAddressUnspentIteratorKey
+{
+    AddressType type;
+    uint160 hashBytes;
+
+    CAddressUnspentIteratorKey(AddressType _type, const uint160& _hashBytes) : type(_type), hashBytes(_hashBytes) {}
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, (uint8_t)type);
+        hashBytes.Serialize(s);
+    }
+};
+
+/** An unspent output of an address. A null value erases the entry of its key */
+struct CAddressUnspentValue
+{
+    CAmount satoshis{-1};
+    CScript script;
+    int blockHeight{0};
+
+    CAddressUnspentValue() = default;
+    CAddressUnspentValue(CAmount _satoshis, const CScript& _script, int _blockHeight) :
+        satoshis(_satoshis), script(_script), blockHeight(_blockHeight) {}
+
+    SERIALIZE_METHODS(CAddressUnspentValue, obj) { READWRITE(obj.satoshis, obj.script, obj.blockHeight); }
+
+    bool IsNull() const { return satoshis == -1; }
+};
+
+typedef std::vector<std::pair<CAddressIndexKey, CAmount>> AddressIndexEntries;
+typedef std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> AddressUnspentEntries;
+
+/** The (type, hash) of the addresses indexed for script: P2PK outputs are indexed by the hash of their key,
+ * and P2CS outputs by both the staker and the owner keys. Other scripts have no address. */
+std::vector<std::pair<AddressType, uint160>> GetIndexedAddresses(const CScript& script);
+
+/** The (type, hash) of a destination, AddressType::UNKNOWN when it isn't indexed */
+std::pair<AddressType, uint160> GetIndexedAddress(const CTxDestination& dest);
+
+/**
+ * Collect the address index entries of the transaction at position nTxIndex of the block at nHeight.
+ * txundo holds the coins spent by its inputs (null for the coinbase and the zerocoin spends).
+ * When connecting, the unspent entries add the outputs and erase the spent coins; with fUndo they
+ * erase the outputs and restore the spent coins instead.
+ */
+void CollectAddressIndexEntries(const CTransaction& tx, const CTxUndo* txundo, int nHeight, unsigned int nTxIndex,
+                                bool fUndo, AddressIndexEntries& vIndex, AddressUnspentEntries& vUnspent);
+
+#endif // PIVX_ADDRESSINDEX_H
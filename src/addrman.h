@@ -12,6 +12,7 @@
 #endif //HAVE_CONFIG_H
 
 #include "clientversion.h"
+#include "memusage.h"
 #include "netaddress.h"
 #include "optional.h"
 #include "protocol.h"
@@ -21,6 +22,7 @@
 #include "tinyformat.h"
 #include "util/system.h"
 
+#include <atomic>
 #include <fs.h>
 #include <hash.h>
 #include <iostream>
@@ -171,6 +173,55 @@ public:
 //! the maximum time we'll spend trying to resolve a tried table collision, in seconds
 static const int64_t ADDRMAN_TEST_WINDOW = 40*60; // 40 minutes
 
+//! the addresses of a message are added in batches of this size, releasing the lock in between
+static const size_t ADDRMAN_ADD_BATCH_SIZE = 100;
+
+/**
+ * The occupied positions (bucket * ADDRMAN_BUCKET_SIZE + position) of a table,
+ * to pick one of them uniformly in constant time.
+ */
+class CAddrManPositions
+{
+private:
+    //! the occupied positions, in no particular order
+    std::vector<int> vPositions;
+    //! index in vPositions of each position of the table, -1 when free
+    std::vector<int> vIndex;
+
+public:
+    explicit CAddrManPositions(size_t nPositions) : vIndex(nPositions, -1) {}
+
+    void Set(int nPos)
+    {
+        if (vIndex[nPos] != -1) return;
+        vIndex[nPos] = vPositions.size();
+        vPositions.push_back(nPos);
+    }
+
+    void Unset(int nPos)
+    {
+        const int nIndex = vIndex[nPos];
+        if (nIndex == -1) return;
+        // move the last position to the freed index
+        vPositions[nIndex] = vPositions.back();
+        vIndex[vPositions[nIndex]] = nIndex;
+        vPositions.pop_back();
+        vIndex[nPos] = -1;
+    }
+
+    void Clear()
+    {
+        for (int nPos : vPositions) {
+            vIndex[nPos] = -1;
+        }
+        vPositions.clear();
+    }
+
+    size_t size() const { return vPositions.size(); }
+    int operator[](size_t i) const { return vPositions[i]; }
+    size_t DynamicMemoryUsage() const { return memusage::DynamicUsage(vPositions) + memusage::DynamicUsage(vIndex); }
+};
+
 /**
  * Stochastical (IP) address manager
  */
@@ -222,18 +273,27 @@ private:
     //! list of "tried" buckets
     int vvTried[ADDRMAN_TRIED_BUCKET_COUNT][ADDRMAN_BUCKET_SIZE] GUARDED_BY(cs);
 
+    //! occupied positions of vvTried
+    CAddrManPositions triedPositions GUARDED_BY(cs){ADDRMAN_TRIED_BUCKET_COUNT * ADDRMAN_BUCKET_SIZE};
+
     //! number of (unique) "new" entries
     int nNew GUARDED_BY(cs);
 
     //! list of "new" buckets
     int vvNew[ADDRMAN_NEW_BUCKET_COUNT][ADDRMAN_BUCKET_SIZE] GUARDED_BY(cs);
 
+    //! occupied positions of vvNew
+    CAddrManPositions newPositions GUARDED_BY(cs){ADDRMAN_NEW_BUCKET_COUNT * ADDRMAN_BUCKET_SIZE};
+
     //! last time Good was called (memory only)
     int64_t nLastGood GUARDED_BY(cs);
 
     //! Holds addrs inserted into tried table that collide with existing entries. Test-before-evict discipline used to resolve these collisions.
     std::set<int> m_tried_collisions;
 
+    //! number of calls which may have changed the tables (memory only)
+    std::atomic<uint64_t> nChanges{0};
+
 protected:
     //! secret key to randomize bucket select with
     uint256 nKey;
@@ -248,6 +308,28 @@ protected:
     //! nTime and nServices of the found node are updated, if necessary.
     CAddrInfo* Create(const CAddress& addr, const CNetAddr& addrSource, int* pnId = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
+    //! Set a position of the "new" table (-1 to free it). All the changes of vvNew go through here.
+    void SetNew(int nUBucket, int nUBucketPos, int nId) EXCLUSIVE_LOCKS_REQUIRED(cs)
+    {
+        vvNew[nUBucket][nUBucketPos] = nId;
+        if (nId == -1) {
+            newPositions.Unset(nUBucket * ADDRMAN_BUCKET_SIZE + nUBucketPos);
+        } else {
+            newPositions.Set(nUBucket * ADDRMAN_BUCKET_SIZE + nUBucketPos);
+        }
+    }
+
+    //! Set a position of the "tried" table (-1 to free it). All the changes of vvTried go through here.
+    void SetTried(int nKBucket, int nKBucketPos, int nId) EXCLUSIVE_LOCKS_REQUIRED(cs)
+    {
+        vvTried[nKBucket][nKBucketPos] = nId;
+        if (nId == -1) {
+            triedPositions.Unset(nKBucket * ADDRMAN_BUCKET_SIZE + nKBucketPos);
+        } else {
+            triedPositions.Set(nKBucket * ADDRMAN_BUCKET_SIZE + nKBucketPos);
+        }
+    }
+
     //! Swap two elements in vRandom.
     void SwapRandom(unsigned int nRandomPos1, unsigned int nRandomPos2) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
@@ -493,7 +575,7 @@ public:
                 vRandom.push_back(nIdCount);
                 mapInfo[nIdCount] = info;
                 mapAddr[info] = nIdCount;
-                vvTried[nKBucket][nKBucketPos] = nIdCount;
+                SetTried(nKBucket, nKBucketPos, nIdCount);
                 nIdCount++;
             } else {
                 nLost++;
@@ -532,7 +614,7 @@ public:
             if (format >= Format::V2_ASMAP && nUBuckets == ADDRMAN_NEW_BUCKET_COUNT && vvNew[bucket][nUBucketPos] == -1 &&
                 info.nRefCount < ADDRMAN_NEW_BUCKETS_PER_ADDRESS && serialized_asmap_version == supplied_asmap_version) {
                 // Bucketing has not changed, using existing bucket positions for the new table
-                vvNew[bucket][nUBucketPos] = n;
+                SetNew(bucket, nUBucketPos, n);
                 info.nRefCount++;
             } else {
                 // In case the new table data cannot be used (format unknown, bucket count wrong or new asmap),
@@ -541,7 +623,7 @@ public:
                 bucket = info.GetNewBucket(nKey, m_asmap);
                 nUBucketPos = info.GetBucketPosition(nKey, true, bucket);
                 if (vvNew[bucket][nUBucketPos] == -1) {
-                    vvNew[bucket][nUBucketPos] = n;
+                    SetNew(bucket, nUBucketPos, n);
                     info.nRefCount++;
                 }
             }
@@ -568,6 +650,7 @@ public:
     void Clear()
     {
         LOCK(cs);
+        ++nChanges;
         std::vector<int>().swap(vRandom);
         nKey = insecure_rand.rand256();
         for (size_t bucket = 0; bucket < ADDRMAN_NEW_BUCKET_COUNT; bucket++) {
@@ -580,6 +663,8 @@ public:
                 vvTried[bucket][entry] = -1;
             }
         }
+        newPositions.Clear();
+        triedPositions.Clear();
 
         nIdCount = 0;
         nTried = 0;
@@ -599,6 +684,9 @@ public:
         nKey.SetNull();
     }
 
+    //! Counter of the changes, to tell whether the tables changed since it was read
+    uint64_t GetChanges() const { return nChanges.load(); }
+
     //! Return the number of (unique) addresses in all tables.
     size_t size() const
     {
@@ -606,6 +694,14 @@ public:
         return vRandom.size();
     }
 
+    //! Estimated memory usage of the tables
+    size_t DynamicMemoryUsage() const
+    {
+        LOCK(cs);
+        return memusage::DynamicUsage(mapInfo) + memusage::DynamicUsage(mapAddr) + memusage::DynamicUsage(vRandom) +
+               memusage::DynamicUsage(m_tried_collisions) + triedPositions.DynamicMemoryUsage() + newPositions.DynamicMemoryUsage();
+    }
+
     //! Consistency check
     void Check()
     {
@@ -623,6 +719,7 @@ public:
     bool Add(const CAddress& addr, const CNetAddr& source, int64_t nTimePenalty = 0)
     {
         LOCK(cs);
+        ++nChanges;
         bool fRet = false;
         Check();
         fRet |= Add_(addr, source, nTimePenalty);
@@ -633,17 +730,21 @@ public:
         return fRet;
     }
 
-    //! Add multiple addresses.
+    //! Add multiple addresses, by batches of ADDRMAN_ADD_BATCH_SIZE so that Select doesn't wait for all of them.
     bool Add(const std::vector<CAddress>& vAddr, const CNetAddr& source, int64_t nTimePenalty = 0)
     {
-        LOCK(cs);
         int nAdd = 0;
-        Check();
-        for (std::vector<CAddress>::const_iterator it = vAddr.begin(); it != vAddr.end(); it++)
-            nAdd += Add_(*it, source, nTimePenalty) ? 1 : 0;
-        Check();
+        for (size_t nStart = 0; nStart < vAddr.size(); nStart += ADDRMAN_ADD_BATCH_SIZE) {
+            const size_t nEnd = std::min(vAddr.size(), nStart + ADDRMAN_ADD_BATCH_SIZE);
+            LOCK(cs);
+            ++nChanges;
+            Check();
+            for (size_t i = nStart; i < nEnd; i++)
+                nAdd += Add_(vAddr[i], source, nTimePenalty) ? 1 : 0;
+            Check();
+        }
         if (nAdd) {
-            LogPrint(BCLog::ADDRMAN, "Added %i addresses from %s: %i tried, %i new\n", nAdd, source.ToString(), nTried, nNew);
+            LogPrint(BCLog::ADDRMAN, "Added %i addresses from %s: %i tried, %i new\n", nAdd, source.ToString(), WITH_LOCK(cs, return nTried), WITH_LOCK(cs, return nNew));
         }
         return nAdd > 0;
     }
@@ -652,6 +753,7 @@ public:
     void Good(const CService& addr, bool test_before_evict = true, int64_t nTime = GetAdjustedTime())
     {
         LOCK(cs);
+        ++nChanges;
         Check();
         Good_(addr, test_before_evict, nTime);
         Check();
@@ -661,6 +763,7 @@ public:
     void Attempt(const CService& addr, bool fCountFailure, int64_t nTime = GetAdjustedTime())
     {
         LOCK(cs);
+        ++nChanges;
         Check();
         Attempt_(addr, fCountFailure, nTime);
         Check();
@@ -670,6 +773,7 @@ public:
     void ResolveCollisions()
     {
         LOCK(cs);
+        ++nChanges;
         Check();
         ResolveCollisions_();
         Check();
@@ -727,6 +831,7 @@ public:
     void Connected(const CService& addr, int64_t nTime = GetAdjustedTime())
     {
         LOCK(cs);
+        ++nChanges;
         Check();
         Connected_(addr, nTime);
         Check();
@@ -735,6 +840,7 @@ public:
     void SetServices(const CService& addr, ServiceFlags nServices)
     {
         LOCK(cs);
+        ++nChanges;
         Check();
         SetServices_(addr, nServices);
         Check();
@@ -25,6 +25,7 @@ static const int64_t DEFAULT_PLOT_HEIGHT = 768;
 void InitBLSTests();
 void CleanupBLSTests();
 void CleanupBLSDkgTests();
+void CleanupLLMQSigSharesTests();
 
 int main(int argc, char** argv)
 {
@@ -34,17 +35,21 @@ int main(int argc, char** argv)
         std::cout << HelpMessageGroup(_("Options:"))
                   << HelpMessageOpt("-?", _("Print this help message and exit"))
                   << HelpMessageOpt("-list", _("List benchmarks without executing them. Can be combined with -scaling and -filter"))
+                  << HelpMessageOpt("-par=<n>", strprintf(_("Number of script, sapling proofs and special tx signatures verification threads used by the block connection benchmarks (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"), -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS))
                   << HelpMessageOpt("-evals=<n>", strprintf(_("Number of measurement evaluations to perform. (default: %u)"), DEFAULT_BENCH_EVALUATIONS))
                   << HelpMessageOpt("-filter=<regex>", strprintf(_("Regular expression filter to select benchmark by name (default: %s)"), DEFAULT_BENCH_FILTER))
                   << HelpMessageOpt("-scaling=<n>", strprintf(_("Scaling factor for benchmark's runtime (default: %u)"), DEFAULT_BENCH_SCALING))
                   << HelpMessageOpt("-printer=(console|plot)", strprintf(_("Choose printer format. console: print data to console. plot: Print results as HTML graph (default: %s)"), DEFAULT_BENCH_PRINTER))
                   << HelpMessageOpt("-plot-plotlyurl=<uri>", strprintf(_("URL to use for plotly.js (default: %s)"), DEFAULT_PLOT_PLOTLYURL))
                   << HelpMessageOpt("-plot-width=<x>", strprintf(_("Plot width in pixel (default: %u)"), DEFAULT_PLOT_WIDTH))
-                  << HelpMessageOpt("-plot-height=<x>", strprintf(_("Plot height in pixel (default: %u)"), DEFAULT_PLOT_HEIGHT));
+                  << HelpMessageOpt("-plot-height=<x>", strprintf(_("Plot height in pixel (default: %u)"), DEFAULT_PLOT_HEIGHT))
+                  << HelpMessageOpt("-replayfile=<file>", _("Messages capture of -capturemessages replayed by the P2PReplay benchmark (default: a synthetic capture)"))
+                  << HelpMessageOpt("-replayspeed=<n>", _("Replay the messages of the P2PReplay benchmark at <n> times the speed of their capture (default: as fast as possible)"));
 
         return EXIT_SUCCESS;
     }
 
+    SHA256AutoDetect();
     RandomInit();
     ECC_Start();
     ECCVerifyHandle globalVerifyHandle;
@@ -77,6 +82,7 @@ int main(int argc, char** argv)
     benchmark::BenchRunner::RunAll(*printer, evaluations, scaling_factor, regex_filter, is_list_only);
 
     // need to be called before global destructors kick in (PoolAllocator is needed due to many BLSSecretKeys)
+    CleanupLLMQSigSharesTests();
     CleanupBLSDkgTests();
     CleanupBLSTests();
 
@@ -0,0 +1,213 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/chain_setup.h"
+
+#include "blockassembler.h"
+#include "chainparams.h"
+#include "evo/deterministicmns.h"
+#include "evo/evodb.h"
+#include "evo/evonotificationinterface.h"
+#include "evo/specialtx_validation.h"
+#include "llmq/quorums_init.h"
+#include "miner.h"
+#include "random.h"
+#include "sapling/sapling_proofcache.h"
+#include "script/sigcache.h"
+#include "script/sign.h"
+#include "sporkdb.h"
+#include "txdb.h"
+#include "util/system.h"
+#include "util/validation.h"
+#include "validation.h"
+#include "validationinterface.h"
+
+// 0.01 PIV fee paid by the fan-out transactions
+static const CAmount FANOUT_FEE = COIN / 100;
+// Max number of outputs of a single fan-out transaction
+static const size_t FANOUT_MAX_OUTPUTS = 500;
+
+void InitBenchZKSNARKS()
+{
+    static bool fZKSNARKSInit = false;
+    if (!fZKSNARKSInit) {
+        initZKSNARKS();
+        fZKSNARKSInit = true;
+    }
+}
+
+BenchChainSetup::BenchChainSetup(int nBlocks)
+    : pathDataDir{fs::temp_directory_path() / "bench_pivx" / std::to_string(GetRand(1 << 30))}
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    UpdateNetworkUpgradeParameters(Consensus::UPGRADE_POS, Consensus::NetworkUpgrade::NO_ACTIVATION_HEIGHT);
+    UpdateNetworkUpgradeParameters(Consensus::UPGRADE_POS_V2, Consensus::NetworkUpgrade::NO_ACTIVATION_HEIGHT);
+    UpdateNetworkUpgradeParameters(Consensus::UPGRADE_V3_4, Consensus::NetworkUpgrade::NO_ACTIVATION_HEIGHT);
+    UpdateNetworkUpgradeParameters(Consensus::UPGRADE_V5_0, 1);
+    UpdateNetworkUpgradeParameters(Consensus::UPGRADE_V6_0, 1);
+
+    InitBenchZKSNARKS();
+
+    fs::create_directories(pathDataDir);
+    gArgs.ForceSetArg("-datadir", pathDataDir.string());
+    ClearDatadirCache();
+
+    // Minimum size caches: the benchmarks must verify the signatures and proofs every time.
+    gArgs.ForceSetArg("-maxsigcachesize", "0");
+    gArgs.ForceSetArg("-shieldedproofcachesize", "0");
+    InitSignatureCache();
+    InitScriptExecutionCache();
+    SaplingValidation::InitShieldedProofCache();
+
+    CScheduler::Function serviceLoop = std::bind(&CScheduler::serviceQueue, &scheduler);
+    threadGroup.create_thread(std::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
+    GetMainSignals().RegisterBackgroundSignalScheduler(scheduler);
+
+    evoDb.reset(new CEvoDB(1 << 20, true, true));
+    deterministicMNManager.reset(new CDeterministicMNManager(*evoDb));
+    pEvoNotificationInterface = new EvoNotificationInterface();
+    RegisterValidationInterface(pEvoNotificationInterface);
+
+    zerocoinDB.reset(new CZerocoinDB(0, true));
+    pSporkDB.reset(new CSporkDB(0, true));
+    pblocktree.reset(new CBlockTreeDB(1 << 20, true));
+    pcoinsdbview.reset(new CCoinsViewDB(1 << 23, true));
+    pcoinsTip.reset(new CCoinsViewCache(pcoinsdbview.get()));
+    llmq::InitLLMQSystem(*evoDb, &scheduler, true);
+    if (!LoadGenesisBlock()) {
+        throw std::runtime_error("Error initializing block database");
+    }
+    {
+        CValidationState state;
+        if (!ActivateBestChain(state)) {
+            throw std::runtime_error("Error activating the genesis block: " + FormatStateMessage(state));
+        }
+    }
+
+    // Same interpretation of -par as the node (0 = autodetect)
+    nScriptCheckThreads = gArgs.GetArg("-par", DEFAULT_SCRIPTCHECK_THREADS);
+    if (nScriptCheckThreads <= 0)
+        nScriptCheckThreads += GetNumCores();
+    if (nScriptCheckThreads <= 1)
+        nScriptCheckThreads = 0;
+    else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
+        nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
+    for (int i = 0; i < nScriptCheckThreads - 1; i++) {
+        threadGroup.create_thread(&ThreadScriptCheck);
+        threadGroup.create_thread(&ThreadSaplingCheck);
+        threadGroup.create_thread(&ThreadProTxSigCheck);
+        threadGroup.create_thread(&ThreadCoinPrefetch);
+    }
+
+    // Generate the chain
+    coinbaseKey.MakeNewKey(true);
+    keystore.AddKey(coinbaseKey);
+    coinbaseScript = GetScriptForDestination(coinbaseKey.GetPubKey().GetID());
+    for (int i = 0; i < nBlocks; i++) {
+        CreateAndProcessBlock({});
+    }
+}
+
+BenchChainSetup::~BenchChainSetup()
+{
+    scheduler.stop();
+    llmq::InterruptLLMQSystem();
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+    GetMainSignals().FlushBackgroundCallbacks();
+    UnregisterAllValidationInterfaces();
+    GetMainSignals().UnregisterBackgroundSignalScheduler();
+    UnloadBlockIndex();
+    delete pEvoNotificationInterface;
+    pcoinsTip.reset();
+    pcoinsdbview.reset();
+    pblocktree.reset();
+    zerocoinDB.reset();
+    pSporkDB.reset();
+    llmq::DestroyLLMQSystem();
+    deterministicMNManager.reset();
+    evoDb.reset();
+    nScriptCheckThreads = 0;
+    fs::remove_all(pathDataDir);
+}
+
+CBlock BenchChainSetup::CreateBlock(const std::vector<CMutableTransaction>& txns)
+{
+    std::unique_ptr<CBlockTemplate> pblocktemplate = BlockAssembler(
+            Params(), DEFAULT_PRINTPRIORITY).CreateNewBlock(coinbaseScript,
+                                                            nullptr,  // wallet
+                                                            false,    // fProofOfStake
+                                                            nullptr,  // availableCoins
+                                                            true,     // fNoMempoolTx
+                                                            false);   // fTestValidity
+    std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>(pblocktemplate->block);
+    for (const CMutableTransaction& tx : txns) {
+        pblock->vtx.push_back(MakeTransactionRef(tx));
+    }
+
+    const int nHeight = WITH_LOCK(cs_main, return chainActive.Height()) + 1;
+    pblock->hashFinalSaplingRoot = CalculateSaplingTreeRoot(pblock.get(), nHeight, Params());
+    assert(SolveBlock(pblock, nHeight));
+    return *pblock;
+}
+
+void BenchChainSetup::CreateAndProcessBlock(const std::vector<CMutableTransaction>& txns)
+{
+    const CBlock& block = CreateBlock(txns);
+    if (!ProcessNewBlock(std::make_shared<const CBlock>(block), nullptr) ||
+            WITH_LOCK(cs_main, return chainActive.Tip()->GetBlockHash()) != block.GetHash()) {
+        throw std::runtime_error("Error connecting a block of the setup chain");
+    }
+    const CTxOut& out = block.vtx[0]->vout[0];
+    if (out.scriptPubKey == coinbaseScript) {
+        vCoinbaseCoins.emplace_back(COutPoint(block.vtx[0]->GetHash(), 0), out);
+    }
+}
+
+std::vector<BenchCoin> BenchChainSetup::CreateCoins(size_t nCoins, CAmount nValue)
+{
+    const int nMaturity = Params().GetConsensus().nCoinbaseMaturity;
+    const int nSpendHeight = WITH_LOCK(cs_main, return chainActive.Height()) + 1;
+
+    std::vector<BenchCoin> coins;
+    std::vector<CMutableTransaction> txns;
+    while (coins.size() < nCoins) {
+        if (nNextCoinbase >= vCoinbaseCoins.size() || (int)nNextCoinbase + 1 > nSpendHeight - nMaturity) {
+            throw std::runtime_error("Not enough mature coinbase outputs in the setup chain");
+        }
+        const BenchCoin& coinbase = vCoinbaseCoins[nNextCoinbase++];
+
+        CMutableTransaction mtx;
+        mtx.vin.emplace_back(coinbase.outpoint);
+        CAmount nLeft = coinbase.out.nValue - FANOUT_FEE;
+        while (nLeft >= nValue && coins.size() + mtx.vout.size() < nCoins && mtx.vout.size() < FANOUT_MAX_OUTPUTS) {
+            mtx.vout.emplace_back(nValue, coinbaseScript);
+            nLeft -= nValue;
+        }
+        if (mtx.vout.empty()) {
+            throw std::runtime_error("Coinbase output too small for the requested coins");
+        }
+        const size_t nOutputs = mtx.vout.size();
+        if (nLeft > 0) mtx.vout.emplace_back(nLeft, coinbaseScript);
+        SignTx(mtx, {coinbase});
+
+        const uint256& txid = mtx.GetHash();
+        for (size_t i = 0; i < nOutputs; i++) {
+            coins.emplace_back(COutPoint(txid, i), mtx.vout[i]);
+        }
+        txns.emplace_back(mtx);
+    }
+    CreateAndProcessBlock(txns);
+    return coins;
+}
+
+void BenchChainSetup::SignTx(CMutableTransaction& mtx, const std::vector<BenchCoin>& coins, bool fColdStake) const
+{
+    assert(mtx.vin.size() == coins.size());
+    for (size_t i = 0; i < coins.size(); i++) {
+        if (!SignSignature(keystore, coins[i].out.scriptPubKey, mtx, i, coins[i].out.nValue, SIGHASH_ALL, fColdStake)) {
+            throw std::runtime_error("Error signing input of a benchmark transaction");
+        }
+    }
+}
@@ -0,0 +1,66 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_BENCH_CHAIN_SETUP_H
+#define PIVX_BENCH_CHAIN_SETUP_H
+
+#include "fs.h"
+#include "keystore.h"
+#include "primitives/block.h"
+#include "primitives/transaction.h"
+#include "scheduler.h"
+
+#include <boost/thread.hpp>
+
+class EvoNotificationInterface;
+
+/** A spendable output of the setup chain */
+struct BenchCoin
+{
+    COutPoint outpoint;
+    CTxOut out;
+    BenchCoin(const COutPoint& _outpoint, const CTxOut& _out) : outpoint(_outpoint), out(_out) {}
+};
+
+// Load the Sapling parameters (once for all the benchmarks)
+void InitBenchZKSNARKS();
+
+/**
+ * Regtest node, with in-memory databases, and a PoW chain of nBlocks blocks
+ * paying to coinbaseKey. Sapling and special txes are enforced from block 1.
+ * The signature cache is set to its minimum size, so that every benchmark
+ * iteration verifies the scripts again.
+ */
+class BenchChainSetup
+{
+public:
+    explicit BenchChainSetup(int nBlocks);
+    ~BenchChainSetup();
+
+    // Block on top of the current tip with the given txes (not processed)
+    CBlock CreateBlock(const std::vector<CMutableTransaction>& txns);
+    // Create the block and connect it
+    void CreateAndProcessBlock(const std::vector<CMutableTransaction>& txns);
+
+    // Fan-out the mature coinbase outputs into nCoins P2PKH outputs of nValue
+    // (paying to coinbaseKey), and mine them in a new block
+    std::vector<BenchCoin> CreateCoins(size_t nCoins, CAmount nValue);
+    // Sign all the inputs of mtx, spending the given coins (in order)
+    void SignTx(CMutableTransaction& mtx, const std::vector<BenchCoin>& coins, bool fColdStake = false) const;
+
+    CKey coinbaseKey;
+    CScript coinbaseScript;
+    CBasicKeyStore keystore;
+
+private:
+    fs::path pathDataDir;
+    boost::thread_group threadGroup;
+    CScheduler scheduler;
+    EvoNotificationInterface* pEvoNotificationInterface;
+    // Coinbase outputs paying to coinbaseScript (the one at index i was mined at height i + 1)
+    std::vector<BenchCoin> vCoinbaseCoins;
+    size_t nNextCoinbase{0};
+};
+
+#endif // PIVX_BENCH_CHAIN_SETUP_H
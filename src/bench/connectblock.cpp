@@ -0,0 +1,228 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/bench.h"
+#include "bench/chain_setup.h"
+
+#include "bls/bls_wrapper.h"
+#include "chainparams.h"
+#include "evo/providertx.h"
+#include "evo/specialtx_validation.h"
+#include "netbase.h"
+#include "sapling/note.h"
+#include "sapling/transaction_builder.h"
+#include "script/standard.h"
+#include "util/validation.h"
+#include "validation.h"
+
+// Connection of synthetic regtest blocks, one benchmark per kind of block.
+// Each iteration connects the block (through TestBlockValidity, so with
+// ConnectBlock on a fresh view on top of the coins tip, rolled back after)
+// and verifies all its scripts, proofs and payload signatures.
+
+// Length of the setup chain (enough mature coinbase outputs to fund the blocks)
+static const int SETUP_CHAIN_BLOCKS = 200;
+static const CAmount BENCH_FEE = COIN / 100;
+
+static const size_t TRANSPARENT_TXES = 200;
+static const size_t COLDSTAKING_TXES = 100;
+static const size_t SHIELDED_TXES = 10;
+static const size_t PROTX_MASTERNODES = 20;
+
+static void ConnectBlockBench(benchmark::State& state, const CBlock& block)
+{
+    LOCK(cs_main);
+    CBlockIndex* pindexPrev = chainActive.Tip();
+    while (state.KeepRunning()) {
+        block.fChecked = false; // Don't skip CheckBlock
+        CValidationState valState;
+        if (!TestBlockValidity(valState, block, pindexPrev, false, true, false)) {
+            throw std::runtime_error("Benchmark block not valid: " + FormatStateMessage(valState));
+        }
+    }
+}
+
+// P2PKH transactions with two inputs and two outputs
+static void ConnectBlockTransparent(benchmark::State& state)
+{
+    BenchChainSetup setup(SETUP_CHAIN_BLOCKS);
+    const auto& coins = setup.CreateCoins(2 * TRANSPARENT_TXES, 10 * COIN);
+
+    std::vector<CMutableTransaction> txns;
+    for (size_t i = 0; i < TRANSPARENT_TXES; i++) {
+        const std::vector<BenchCoin> vIn = {coins[2 * i], coins[2 * i + 1]};
+        CMutableTransaction mtx;
+        for (const auto& coin : vIn) mtx.vin.emplace_back(coin.outpoint);
+        mtx.vout.emplace_back(10 * COIN, setup.coinbaseScript);
+        mtx.vout.emplace_back(10 * COIN - BENCH_FEE, setup.coinbaseScript);
+        setup.SignTx(mtx, vIn);
+        txns.emplace_back(mtx);
+    }
+
+    ConnectBlockBench(state, setup.CreateBlock(txns));
+}
+
+// Half new P2CS delegations, half owner spends of older delegations
+static void ConnectBlockColdStaking(benchmark::State& state)
+{
+    BenchChainSetup setup(SETUP_CHAIN_BLOCKS);
+    const auto& coins = setup.CreateCoins(2 * COLDSTAKING_TXES, 10 * COIN);
+
+    CKey stakerKey;
+    stakerKey.MakeNewKey(true);
+    const CScript& scriptP2CS = GetScriptForStakeDelegation(stakerKey.GetPubKey().GetID(),
+                                                            setup.coinbaseKey.GetPubKey().GetID());
+    auto delegate = [&](const BenchCoin& coin) {
+        CMutableTransaction mtx;
+        mtx.vin.emplace_back(coin.outpoint);
+        mtx.vout.emplace_back(coin.out.nValue - BENCH_FEE, scriptP2CS);
+        setup.SignTx(mtx, {coin});
+        return mtx;
+    };
+
+    std::vector<CMutableTransaction> delegations;
+    std::vector<BenchCoin> delegatedCoins;
+    for (size_t i = 0; i < COLDSTAKING_TXES; i++) {
+        delegations.emplace_back(delegate(coins[i]));
+        delegatedCoins.emplace_back(COutPoint(delegations.back().GetHash(), 0), delegations.back().vout[0]);
+    }
+    setup.CreateAndProcessBlock(delegations);
+
+    std::vector<CMutableTransaction> txns;
+    for (size_t i = 0; i < COLDSTAKING_TXES; i++) {
+        txns.emplace_back(delegate(coins[COLDSTAKING_TXES + i]));
+        const BenchCoin& p2cs = delegatedCoins[i];
+        CMutableTransaction mtx;
+        mtx.vin.emplace_back(p2cs.outpoint);
+        mtx.vout.emplace_back(p2cs.out.nValue - BENCH_FEE, setup.coinbaseScript);
+        setup.SignTx(mtx, {p2cs}, false);
+        txns.emplace_back(mtx);
+    }
+
+    ConnectBlockBench(state, setup.CreateBlock(txns));
+}
+
+// Half t->z transactions, half z->z transactions (one spend and one output each)
+static void ConnectBlockShielded(benchmark::State& state)
+{
+    BenchChainSetup setup(SETUP_CHAIN_BLOCKS);
+    const Consensus::Params& consensus = Params().GetConsensus();
+    const auto& coins = setup.CreateCoins(2 * SHIELDED_TXES, 10 * COIN);
+
+    auto sk = libzcash::SaplingSpendingKey::random();
+    const auto& expsk = sk.expanded_spending_key();
+    const auto& fvk = sk.full_viewing_key();
+    const auto& ivk = fvk.in_viewing_key();
+    const auto& pa = sk.default_address();
+
+    auto shield = [&](const BenchCoin& coin) {
+        TransactionBuilder builder(consensus, &setup.keystore);
+        builder.AddTransparentInput(coin.outpoint, coin.out.scriptPubKey, coin.out.nValue);
+        builder.AddSaplingOutput(fvk.ovk, pa, coin.out.nValue - BENCH_FEE);
+        builder.SetFee(BENCH_FEE);
+        return CMutableTransaction(builder.Build().GetTxOrThrow());
+    };
+
+    std::vector<CMutableTransaction> shieldTxes;
+    for (size_t i = 0; i < SHIELDED_TXES; i++) {
+        shieldTxes.emplace_back(shield(coins[i]));
+    }
+    setup.CreateAndProcessBlock(shieldTxes);
+
+    // The setup chain had no shielded outputs before: rebuild the commitment
+    // tree, and the witnesses of the new notes, from the last block only.
+    SaplingMerkleTree tree;
+    std::vector<libzcash::SaplingNote> notes;
+    std::vector<SaplingWitness> witnesses;
+    for (const auto& mtx : shieldTxes) {
+        for (const OutputDescription& output : mtx.sapData->vShieldedOutput) {
+            for (auto& witness : witnesses) witness.append(output.cmu);
+            tree.append(output.cmu);
+            auto pt = libzcash::SaplingNotePlaintext::decrypt(output.encCiphertext, ivk, output.ephemeralKey, output.cmu);
+            if (pt) {
+                notes.emplace_back(*pt->note(ivk));
+                witnesses.emplace_back(tree.witness());
+            }
+        }
+    }
+    assert(notes.size() == SHIELDED_TXES);
+    const uint256& anchor = tree.root();
+    assert(anchor == WITH_LOCK(cs_main, return chainActive.Tip()->hashFinalSaplingRoot));
+
+    std::vector<CMutableTransaction> txns;
+    for (size_t i = 0; i < SHIELDED_TXES; i++) {
+        txns.emplace_back(shield(coins[SHIELDED_TXES + i]));
+        TransactionBuilder builder(consensus);
+        builder.AddSaplingSpend(expsk, notes[i], anchor, witnesses[i]);
+        builder.AddSaplingOutput(fvk.ovk, pa, (CAmount)notes[i].value() - BENCH_FEE);
+        builder.SetFee(BENCH_FEE);
+        txns.emplace_back(builder.Build().GetTxOrThrow());
+    }
+
+    ConnectBlockBench(state, setup.CreateBlock(txns));
+}
+
+// ProUpServ transactions (each with a BLS payload signature) for registered masternodes
+static void ConnectBlockSpecialTx(benchmark::State& state)
+{
+    BenchChainSetup setup(SETUP_CHAIN_BLOCKS);
+    const CAmount nCollateral = Params().GetConsensus().nMNCollateralAmt;
+    const auto& collaterals = setup.CreateCoins(PROTX_MASTERNODES, nCollateral + BENCH_FEE);
+    const auto& coins = setup.CreateCoins(PROTX_MASTERNODES, 10 * COIN);
+
+    // Register the masternodes, with internal collateral
+    std::vector<CMutableTransaction> proRegTxes;
+    std::vector<CBLSSecretKey> operatorKeys;
+    for (size_t i = 0; i < PROTX_MASTERNODES; i++) {
+        CKey ownerKey;
+        ownerKey.MakeNewKey(true);
+        operatorKeys.emplace_back();
+        operatorKeys.back().MakeNewKey();
+
+        ProRegPL pl;
+        pl.collateralOutpoint = COutPoint(UINT256_ZERO, 0);
+        pl.addr = LookupNumeric("1.1.1.1", (int)i + 1);
+        pl.keyIDOwner = ownerKey.GetPubKey().GetID();
+        pl.pubKeyOperator = operatorKeys.back().GetPublicKey();
+        pl.keyIDVoting = ownerKey.GetPubKey().GetID();
+        pl.scriptPayout = setup.coinbaseScript;
+        pl.nOperatorReward = 0;
+
+        CMutableTransaction mtx;
+        mtx.nVersion = CTransaction::TxVersion::SAPLING;
+        mtx.nType = CTransaction::TxType::PROREG;
+        mtx.vin.emplace_back(collaterals[i].outpoint);
+        mtx.vout.emplace_back(nCollateral, setup.coinbaseScript);
+        pl.inputsHash = CalcTxInputsHash(mtx);
+        SetTxPayload(mtx, pl);
+        setup.SignTx(mtx, {collaterals[i]});
+        proRegTxes.emplace_back(mtx);
+    }
+    setup.CreateAndProcessBlock(proRegTxes);
+
+    std::vector<CMutableTransaction> txns;
+    for (size_t i = 0; i < PROTX_MASTERNODES; i++) {
+        ProUpServPL pl;
+        pl.proTxHash = proRegTxes[i].GetHash();
+        pl.addr = LookupNumeric("1.1.1.1", (int)(PROTX_MASTERNODES + i + 1));
+
+        CMutableTransaction mtx;
+        mtx.nVersion = CTransaction::TxVersion::SAPLING;
+        mtx.nType = CTransaction::TxType::PROUPSERV;
+        mtx.vin.emplace_back(coins[i].outpoint);
+        mtx.vout.emplace_back(coins[i].out.nValue - BENCH_FEE, setup.coinbaseScript);
+        pl.inputsHash = CalcTxInputsHash(mtx);
+        pl.sig = operatorKeys[i].Sign(::SerializeHash(pl));
+        SetTxPayload(mtx, pl);
+        setup.SignTx(mtx, {coins[i]});
+        txns.emplace_back(mtx);
+    }
+
+    ConnectBlockBench(state, setup.CreateBlock(txns));
+}
+
+BENCHMARK(ConnectBlockTransparent, 10);
+BENCHMARK(ConnectBlockColdStaking, 10);
+BENCHMARK(ConnectBlockShielded, 2);
+BENCHMARK(ConnectBlockSpecialTx, 10);
@@ -10,6 +10,7 @@
 #include "crypto/sha256.h"
 #include "crypto/sha512.h"
 #include "crypto/siphash.h"
+#include "hash.h"
 #include "random.h"
 
 /* Number of bytes to hash per iteration */
@@ -49,6 +50,14 @@ static void SHA256_32b(benchmark::State& state)
     }
 }
 
+static void SHA256D64_1024(benchmark::State& state)
+{
+    std::vector<uint8_t> in(64 * 1024, 0);
+    while (state.KeepRunning()) {
+        SHA256D64(in.data(), in.data(), 1024);
+    }
+}
+
 static void SHA512(benchmark::State& state)
 {
     uint8_t hash[CSHA512::OUTPUT_SIZE];
@@ -57,6 +66,15 @@ static void SHA512(benchmark::State& state)
         CSHA512().Write(in.data(), in.size()).Finalize(hash);
 }
 
+static void QuarkHash_80b(benchmark::State& state)
+{
+    std::vector<uint8_t> in(80, 0);
+    while (state.KeepRunning()) {
+        uint256 hash = HashQuark(in.data(), in.size());
+        in[0] = hash.begin()[0];
+    }
+}
+
 static void FastRandom_32bit(benchmark::State& state)
 {
     FastRandomContext rng(true);
@@ -81,5 +99,7 @@ BENCHMARK(SHA256, 340);
 BENCHMARK(SHA512, 330);
 
 BENCHMARK(SHA256_32b, 4700 * 1000);
+BENCHMARK(SHA256D64_1024, 7400);
+BENCHMARK(QuarkHash_80b, 80 * 1000);
 BENCHMARK(FastRandom_32bit, 110 * 1000 * 1000);
 BENCHMARK(FastRandom_1bit, 440 * 1000 * 1000);
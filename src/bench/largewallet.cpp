@@ -0,0 +1,253 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/bench.h"
+#include "bench/chain_setup.h"
+
+#include "chainparams.h"
+#include "random.h"
+#include "rpc/server.h"
+#include "sapling/transaction_builder.h"
+#include "script/sign.h"
+#include "script/standard.h"
+#include "util/system.h"
+#include "validation.h"
+#include "validationinterface.h"
+#include "wallet/wallet.h"
+
+#include <univalue.h>
+
+extern UniValue listtransactions(const JSONRPCRequest& request);
+
+// Wallet operations on a wallet with a long history: 100k+ transactions to a thousand keys,
+// P2CS delegations (as owner and as staker), spends of its own coins, and Sapling notes.
+// The history is mined in real blocks of the setup chain (so that it can be rescanned), and
+// the wallet is stored in a BDB file (so that it can be loaded).
+
+static const int SETUP_CHAIN_BLOCKS = 210;
+static const size_t LARGE_WALLET_KEYS = 1000;
+static const int LARGE_WALLET_BLOCKS = 100;
+// Each block: transparent receives, P2CS receives (half as owner, half as staker) and
+// spends of the coins received in the previous block
+static const size_t RECEIVES_PER_BLOCK = 900;
+static const size_t P2CS_PER_BLOCK = 50;
+static const size_t SPENDS_PER_BLOCK = 100;
+static const CAmount RECEIVE_VALUE = COIN / 10;
+static const CAmount SPEND_FEE = COIN / 10000;
+// Sapling notes: shielding txes, each with several outputs to the wallet
+static const size_t SHIELDING_TXES = 4;
+static const size_t SHIELDING_OUTPUTS = 5;
+static const CAmount BENCH_SHIELDED_FEE = COIN / 10;
+
+static CKeyID RandomKeyID()
+{
+    CKeyID keyID;
+    GetRandBytes(keyID.begin(), keyID.size());
+    return keyID;
+}
+
+/** The setup chain with the history of the wallet (registered for the validation signals) */
+class LargeWalletSetup
+{
+public:
+    BenchChainSetup chain;
+    fs::path pathWallet;
+    std::unique_ptr<CWallet> pwallet;
+
+    LargeWalletSetup();
+    ~LargeWalletSetup();
+
+private:
+    std::vector<CKeyID> vKeys;
+    // P2PKH outputs of the wallet received in the last block
+    std::vector<BenchCoin> vLastReceived;
+
+    void CreateHistoryBlockTxes(const BenchCoin& funding, std::vector<CMutableTransaction>& txns);
+};
+
+LargeWalletSetup::LargeWalletSetup() : chain(SETUP_CHAIN_BLOCKS), pathWallet(GetDataDir() / "largewallet")
+{
+    fs::create_directories(pathWallet);
+    pwallet = std::make_unique<CWallet>("largewallet", WalletDatabase::Create(pathWallet));
+    bool fFirstRun;
+    if (pwallet->LoadWallet(fFirstRun) != DB_LOAD_OK || !pwallet->SetupSPKM(true)) {
+        throw std::runtime_error("Error creating the large wallet");
+    }
+    for (size_t i = 0; i < LARGE_WALLET_KEYS; i++) {
+        auto res = pwallet->getNewAddress("");
+        if (!res) throw std::runtime_error("Cannot create a large wallet address");
+        vKeys.emplace_back(boost::get<CKeyID>(*res.getObjResult()));
+    }
+    RegisterValidationInterface(pwallet.get());
+
+    // The funding of each block of the history, and of the shielding txes
+    const CAmount nBlockValue = RECEIVES_PER_BLOCK * RECEIVE_VALUE + P2CS_PER_BLOCK * MIN_COLDSTAKING_AMOUNT + COIN;
+    const std::vector<BenchCoin>& vFunding = chain.CreateCoins(LARGE_WALLET_BLOCKS + SHIELDING_TXES, nBlockValue);
+    for (int i = 0; i < LARGE_WALLET_BLOCKS; i++) {
+        std::vector<CMutableTransaction> txns;
+        CreateHistoryBlockTxes(vFunding[i], txns);
+        chain.CreateAndProcessBlock(txns);
+    }
+
+    std::vector<CMutableTransaction> txns;
+    const uint256 ovk = GetRandHash();
+    for (size_t i = 0; i < SHIELDING_TXES; i++) {
+        const BenchCoin& coin = vFunding[LARGE_WALLET_BLOCKS + i];
+        TransactionBuilder builder(Params().GetConsensus(), &chain.keystore);
+        builder.AddTransparentInput(coin.outpoint, coin.out.scriptPubKey, coin.out.nValue);
+        const CAmount nValue = (coin.out.nValue - BENCH_SHIELDED_FEE) / SHIELDING_OUTPUTS;
+        for (size_t j = 0; j < SHIELDING_OUTPUTS; j++) {
+            builder.AddSaplingOutput(ovk, pwallet->GenerateNewSaplingZKey(), nValue);
+        }
+        builder.SetFee(coin.out.nValue - nValue * SHIELDING_OUTPUTS);
+        txns.emplace_back(builder.Build().GetTxOrThrow());
+    }
+    chain.CreateAndProcessBlock(txns);
+    SyncWithValidationInterfaceQueue();
+}
+
+LargeWalletSetup::~LargeWalletSetup()
+{
+    UnregisterValidationInterface(pwallet.get());
+    pwallet->Flush(true);
+    pwallet.reset();
+}
+
+// The txes of a block of the history, funded by the given coin. The outputs of the funding tx
+// (the first one) are anyone-can-spend, so that only the spends of the wallet coins carry a signature.
+void LargeWalletSetup::CreateHistoryBlockTxes(const BenchCoin& funding, std::vector<CMutableTransaction>& txns)
+{
+    CMutableTransaction fanout;
+    fanout.vin.emplace_back(funding.outpoint);
+    for (size_t i = 0; i < RECEIVES_PER_BLOCK; i++) {
+        fanout.vout.emplace_back(RECEIVE_VALUE, CScript() << OP_TRUE);
+    }
+    for (size_t i = 0; i < P2CS_PER_BLOCK; i++) {
+        fanout.vout.emplace_back(MIN_COLDSTAKING_AMOUNT, CScript() << OP_TRUE);
+    }
+    const CAmount nLeft = funding.out.nValue - RECEIVES_PER_BLOCK * RECEIVE_VALUE - P2CS_PER_BLOCK * MIN_COLDSTAKING_AMOUNT - COIN / 100;
+    fanout.vout.emplace_back(nLeft, chain.coinbaseScript);
+    chain.SignTx(fanout, {funding});
+    txns.emplace_back(fanout);
+
+    const uint256& fanoutHash = fanout.GetHash();
+    std::vector<BenchCoin> vReceived;
+    for (uint32_t i = 0; i < RECEIVES_PER_BLOCK + P2CS_PER_BLOCK; i++) {
+        CMutableTransaction mtx;
+        mtx.vin.emplace_back(COutPoint(fanoutHash, i));
+        const CKeyID& keyID = vKeys[GetRand(vKeys.size())];
+        if (i < RECEIVES_PER_BLOCK) {
+            mtx.vout.emplace_back(fanout.vout[i].nValue, GetScriptForDestination(keyID));
+            vReceived.emplace_back(COutPoint(mtx.GetHash(), 0), mtx.vout[0]);
+        } else if (i % 2) {
+            mtx.vout.emplace_back(fanout.vout[i].nValue, GetScriptForStakeDelegation(RandomKeyID(), keyID));
+        } else {
+            mtx.vout.emplace_back(fanout.vout[i].nValue, GetScriptForStakeDelegation(keyID, RandomKeyID()));
+        }
+        txns.emplace_back(mtx);
+    }
+
+    // Payments to external keys, with the change back to the wallet
+    for (size_t i = 0; i < SPENDS_PER_BLOCK && i < vLastReceived.size(); i++) {
+        const BenchCoin& coin = vLastReceived[i];
+        CMutableTransaction mtx;
+        mtx.vin.emplace_back(coin.outpoint);
+        mtx.vout.emplace_back(coin.out.nValue / 2, GetScriptForDestination(RandomKeyID()));
+        mtx.vout.emplace_back(coin.out.nValue / 2 - SPEND_FEE, GetScriptForDestination(vKeys[GetRand(vKeys.size())]));
+        if (!SignSignature(*pwallet, coin.out.scriptPubKey, mtx, 0, coin.out.nValue, SIGHASH_ALL)) {
+            throw std::runtime_error("Error signing a spend of the large wallet");
+        }
+        txns.emplace_back(mtx);
+    }
+    vLastReceived = vReceived;
+}
+
+static void LargeWalletGetBalance(benchmark::State& state)
+{
+    LargeWalletSetup setup;
+    while (state.KeepRunning()) {
+        CAmount nBalance = setup.pwallet->GetAvailableBalance();
+        nBalance += setup.pwallet->GetColdStakingBalance();
+        nBalance += setup.pwallet->GetDelegatedBalance();
+        nBalance += setup.pwallet->GetUnconfirmedBalance();
+        assert(nBalance > 0);
+    }
+}
+
+static void LargeWalletAvailableCoins(benchmark::State& state)
+{
+    LargeWalletSetup setup;
+    while (state.KeepRunning()) {
+        std::vector<COutput> vCoins;
+        setup.pwallet->AvailableCoins(&vCoins);
+        assert(!vCoins.empty());
+    }
+}
+
+static void LargeWalletCreateTransaction(benchmark::State& state)
+{
+    LargeWalletSetup setup;
+    const std::vector<CRecipient> vecSend = {CRecipient(GetScriptForDestination(RandomKeyID()), 10 * COIN, false)};
+    while (state.KeepRunning()) {
+        CTransactionRef tx;
+        CReserveKey reservekey(setup.pwallet.get());
+        CAmount nFeeRequired = 0;
+        int nChangePosInOut = -1;
+        std::string strFailReason;
+        if (!setup.pwallet->CreateTransaction(vecSend, tx, reservekey, nFeeRequired, nChangePosInOut, strFailReason)) {
+            throw std::runtime_error("Error creating a tx of the large wallet: " + strFailReason);
+        }
+    }
+}
+
+// A page of listtransactions, deep in the history
+static void LargeWalletListTransactions(benchmark::State& state)
+{
+    LargeWalletSetup setup;
+    vpwallets.insert(vpwallets.begin(), setup.pwallet.get());
+    JSONRPCRequest request;
+    request.params.setArray();
+    request.params.push_back("*");
+    request.params.push_back(100);
+    request.params.push_back(10000);
+    while (state.KeepRunning()) {
+        const UniValue& result = listtransactions(request);
+        assert(result.size() == 100);
+    }
+    vpwallets.erase(vpwallets.begin());
+}
+
+// Load of the wallet file, into a new wallet
+static void LargeWalletLoadWallet(benchmark::State& state)
+{
+    LargeWalletSetup setup;
+    setup.pwallet->Flush(false);
+    while (state.KeepRunning()) {
+        CWallet wallet("largewallet", WalletDatabase::Create(setup.pathWallet));
+        bool fFirstRun;
+        if (wallet.LoadWallet(fFirstRun) != DB_LOAD_OK) {
+            throw std::runtime_error("Error loading the large wallet");
+        }
+        assert(wallet.mapWallet.size() == setup.pwallet->mapWallet.size());
+    }
+}
+
+// Rescan of the whole chain, updating the txes already in the wallet
+static void LargeWalletRescan(benchmark::State& state)
+{
+    LargeWalletSetup setup;
+    CBlockIndex* pindexGenesis = WITH_LOCK(cs_main, return chainActive.Genesis());
+    while (state.KeepRunning()) {
+        WalletRescanReserver reserver(setup.pwallet.get());
+        assert(reserver.reserve());
+        setup.pwallet->ScanForWalletTransactions(pindexGenesis, nullptr, reserver, true);
+    }
+}
+
+BENCHMARK(LargeWalletGetBalance, 5);
+BENCHMARK(LargeWalletAvailableCoins, 5);
+BENCHMARK(LargeWalletCreateTransaction, 5);
+BENCHMARK(LargeWalletListTransactions, 5);
+BENCHMARK(LargeWalletLoadWallet, 1);
+BENCHMARK(LargeWalletRescan, 1);
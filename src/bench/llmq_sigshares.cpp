@@ -0,0 +1,243 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/bench.h"
+
+#include "bls/bls_batchverifier.h"
+#include "bls/bls_worker.h"
+#include "chainparams.h"
+#include "llmq/quorums_signing_shares.h"
+#include "llmq/quorums_utils.h"
+#include "net.h"
+#include "random.h"
+#include "streams.h"
+
+// Flow of the signature shares of a simulated quorum of N members, for M concurrent signing sessions, through the
+// same steps of the CSigSharesManager (without the network): the QSIGSHARESINV/QGETSIGSHARES/QBSIGSHARES messages,
+// the batched verification of the shares against the members' public key shares, and the recovery of the
+// threshold signatures.
+
+extern CBLSWorker blsWorker;
+
+struct SigSharesSession
+{
+    uint256 id;
+    uint256 msgHash;
+    uint256 signHash;
+    // one share per member, in member order
+    std::vector<CBLSSignature> sigShares;
+    // serialized CBatchedSigShares with all the shares
+    CDataStream batchedSigShares{SER_NETWORK, PROTOCOL_VERSION};
+};
+
+class SigSharesQuorum
+{
+public:
+    const Consensus::LLMQParams& params;
+    uint256 quorumHash;
+    std::vector<CBLSId> ids;
+    std::vector<CBLSPublicKey> pubKeyShares;
+    CBLSPublicKey quorumPublicKey;
+    std::vector<SigSharesSession> sessions;
+
+    SigSharesQuorum(Consensus::LLMQType llmqType, size_t nSessions) :
+            params(Params().GetConsensus().llmqs.at(llmqType)),
+            quorumHash(GetRandHash())
+    {
+        // Shares of a random master key, as at the end of a successful DKG
+        BLSSecretKeyVector msk((size_t)params.threshold);
+        for (auto& sk : msk) {
+            sk.MakeNewKey();
+        }
+        quorumPublicKey = msk[0].GetPublicKey();
+
+        BLSSecretKeyVector skShares((size_t)params.size);
+        for (int i = 0; i < params.size; i++) {
+            ids.emplace_back(GetRandHash());
+            assert(skShares[i].SecretKeyShare(msk, ids[i]));
+            pubKeyShares.emplace_back(skShares[i].GetPublicKey());
+        }
+
+        sessions.resize(nSessions);
+        for (auto& s : sessions) {
+            s.id = GetRandHash();
+            s.msgHash = GetRandHash();
+            s.signHash = llmq::utils::BuildSignHash(llmqType, quorumHash, s.id, s.msgHash);
+
+            llmq::CBatchedSigShares batch;
+            batch.llmqType = (uint8_t)llmqType;
+            batch.quorumHash = quorumHash;
+            batch.id = s.id;
+            batch.msgHash = s.msgHash;
+            for (int i = 0; i < params.size; i++) {
+                s.sigShares.emplace_back(skShares[i].Sign(s.signHash));
+                CBLSLazySignature lazySig;
+                lazySig.Set(s.sigShares.back());
+                batch.sigShares.emplace_back((uint16_t)i, lazySig);
+            }
+            s.batchedSigShares << batch;
+        }
+    }
+
+    template <typename T>
+    static T RoundTrip(const T& msg)
+    {
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << msg;
+        T ret;
+        ss >> ret;
+        return ret;
+    }
+
+    static llmq::CBatchedSigShares ReadBatch(const SigSharesSession& s)
+    {
+        CDataStream ss(s.batchedSigShares);
+        llmq::CBatchedSigShares batch;
+        ss >> batch;
+        return batch;
+    }
+
+    // Every member announces its share, we request all of them and receive them in a single batch
+    void Bench_Messages(benchmark::State& state)
+    {
+        while (state.KeepRunning()) {
+            for (const auto& s : sessions) {
+                llmq::CSigSharesInv announced;
+                announced.Init(params.type, s.signHash);
+                for (int i = 0; i < params.size; i++) {
+                    llmq::CSigSharesInv inv;
+                    inv.Init(params.type, s.signHash);
+                    inv.Set((uint16_t)i, true);
+                    announced.Merge(RoundTrip(inv));
+                }
+                const llmq::CSigSharesInv& requested = RoundTrip(announced);
+
+                const llmq::CBatchedSigShares& batch = ReadBatch(s);
+                for (size_t i = 0; i < batch.sigShares.size(); i++) {
+                    assert(requested.IsSet(batch.sigShares[i].first));
+                    assert(batch.RebuildSigShare(i).GetSignHash() == s.signHash);
+                }
+            }
+        }
+    }
+
+    // Batched verification of all the received shares (each member being a different source), with the sessions
+    // split in nShards separately verified batches, running on the BLS worker pool when nShards > 1
+    void Bench_Verify(benchmark::State& state, size_t nShards)
+    {
+        typedef CBLSBatchVerifier<NodeId, llmq::SigShareKey> BatchVerifier;
+        while (state.KeepRunning()) {
+            auto verifyShard = [this, nShards](size_t shard) {
+                BatchVerifier batchVerifier(false, true);
+                for (size_t j = shard; j < sessions.size(); j += nShards) {
+                    const llmq::CBatchedSigShares& batch = ReadBatch(sessions[j]);
+                    for (size_t i = 0; i < batch.sigShares.size(); i++) {
+                        const llmq::CSigShare& sigShare = batch.RebuildSigShare(i);
+                        batchVerifier.PushMessage((NodeId)sigShare.quorumMember, sigShare.GetKey(), sigShare.GetSignHash(),
+                                                  sigShare.sigShare.Get(), pubKeyShares[sigShare.quorumMember]);
+                    }
+                }
+                batchVerifier.Verify();
+                assert(batchVerifier.badSources.empty());
+            };
+            if (nShards == 1) {
+                verifyShard(0);
+                continue;
+            }
+            std::vector<std::future<void>> futures;
+            for (size_t shard = 0; shard < nShards; shard++) {
+                futures.emplace_back(blsWorker.AsyncRun([&verifyShard, shard]() { verifyShard(shard); }));
+            }
+            for (auto& f : futures) {
+                f.get();
+            }
+        }
+    }
+
+    bool RecoverSig(const SigSharesSession& s) const
+    {
+        // the first threshold shares, as the manager does
+        const std::vector<CBLSSignature> sigShares(s.sigShares.begin(), s.sigShares.begin() + params.threshold);
+        const std::vector<CBLSId> idsForRecovery(ids.begin(), ids.begin() + params.threshold);
+        CBLSSignature recoveredSig;
+        return recoveredSig.Recover(sigShares, idsForRecovery) && recoveredSig.VerifyInsecure(quorumPublicKey, s.signHash);
+    }
+
+    // Recovery (and verification against the quorum public key) of the threshold signature of every session
+    void Bench_Recover(benchmark::State& state, bool parallel)
+    {
+        while (state.KeepRunning()) {
+            if (!parallel) {
+                for (const auto& s : sessions) {
+                    assert(RecoverSig(s));
+                }
+                continue;
+            }
+            std::vector<std::future<void>> futures;
+            for (const auto& s : sessions) {
+                futures.emplace_back(blsWorker.AsyncRun([this, &s]() { assert(RecoverSig(s)); }));
+            }
+            for (auto& f : futures) {
+                f.get();
+            }
+        }
+    }
+};
+
+// 50 members with 32 concurrent sessions, 400 members with 4 concurrent sessions
+std::shared_ptr<SigSharesQuorum> sigShares50;
+std::shared_ptr<SigSharesQuorum> sigShares400;
+
+static void InitSigSharesIfNeeded()
+{
+    if (sigShares50 == nullptr) {
+        // the mainnet LLMQs
+        SelectParams(CBaseChainParams::MAIN);
+        sigShares50 = std::make_shared<SigSharesQuorum>(Consensus::LLMQ_50_60, 32);
+        sigShares400 = std::make_shared<SigSharesQuorum>(Consensus::LLMQ_400_60, 4);
+    }
+}
+
+void CleanupLLMQSigSharesTests()
+{
+    sigShares50.reset();
+    sigShares400.reset();
+}
+
+#define BENCH_SigSharesMessages(quorumSize, num_iters_for_one_second) \
+    static void LLMQSigShares_Messages_##quorumSize(benchmark::State& state) \
+    { \
+        InitSigSharesIfNeeded(); \
+        sigShares##quorumSize->Bench_Messages(state); \
+    } \
+    BENCHMARK(LLMQSigShares_Messages_##quorumSize, num_iters_for_one_second)
+
+BENCH_SigSharesMessages(50, 20)
+BENCH_SigSharesMessages(400, 10)
+
+#define BENCH_SigSharesVerify(name, quorumSize, nShards, num_iters_for_one_second) \
+    static void LLMQSigShares_Verify_##name##_##quorumSize(benchmark::State& state) \
+    { \
+        InitSigSharesIfNeeded(); \
+        sigShares##quorumSize->Bench_Verify(state, nShards); \
+    } \
+    BENCHMARK(LLMQSigShares_Verify_##name##_##quorumSize, num_iters_for_one_second)
+
+BENCH_SigSharesVerify(simple, 50, 1, 1)
+BENCH_SigSharesVerify(simple, 400, 1, 1)
+BENCH_SigSharesVerify(sharded, 50, 4, 2)
+BENCH_SigSharesVerify(sharded, 400, 4, 2)
+
+#define BENCH_SigSharesRecover(name, quorumSize, parallel, num_iters_for_one_second) \
+    static void LLMQSigShares_Recover_##name##_##quorumSize(benchmark::State& state) \
+    { \
+        InitSigSharesIfNeeded(); \
+        sigShares##quorumSize->Bench_Recover(state, parallel); \
+    } \
+    BENCHMARK(LLMQSigShares_Recover_##name##_##quorumSize, num_iters_for_one_second)
+
+BENCH_SigSharesRecover(simple, 50, false, 30)
+BENCH_SigSharesRecover(simple, 400, false, 1)
+BENCH_SigSharesRecover(parallel, 50, true, 100)
+BENCH_SigSharesRecover(parallel, 400, true, 2)
@@ -0,0 +1,163 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/bench.h"
+#include "bench/chain_setup.h"
+
+#include "chainparams.h"
+#include "policy/policy.h"
+#include "random.h"
+#include "sapling/transaction_builder.h"
+#include "script/standard.h"
+#include "txmempool.h"
+#include "util/validation.h"
+#include "validation.h"
+
+// Mempool acceptance of bursts of transactions: each iteration accepts all
+// the transactions of the burst (in order) into an empty mempool.
+
+static const int SETUP_CHAIN_BLOCKS = 200;
+static const CAmount BENCH_FEE = COIN / 100;
+// Shielded txes pay (a lot) more than the minimum shielded fee
+static const CAmount BENCH_SHIELDED_FEE = COIN / 10;
+
+// Chains of dependent transactions, as long as the default ancestor limit allows
+static const size_t CHAINS = 40;
+static const size_t CHAIN_LENGTH = DEFAULT_ANCESTOR_LIMIT;
+static const size_t COLDSTAKING_TXES = 1000;
+static const size_t SHIELDED_TXES = 10;
+
+static void AcceptBurstBench(benchmark::State& state, const std::vector<CTransactionRef>& txns)
+{
+    LOCK(cs_main);
+    while (state.KeepRunning()) {
+        for (const CTransactionRef& tx : txns) {
+            CValidationState valState;
+            if (!AcceptToMemoryPool(mempool, valState, tx, false, nullptr)) {
+                throw std::runtime_error("Benchmark tx rejected: " + FormatStateMessage(valState));
+            }
+        }
+        mempool.clear();
+    }
+}
+
+// One-input one-output transactions, each spending the output of the previous one of its chain
+static std::vector<CTransactionRef> CreateChains(BenchChainSetup& setup, size_t nChains, size_t nLength)
+{
+    std::vector<CTransactionRef> txns;
+    for (BenchCoin coin : setup.CreateCoins(nChains, 10 * COIN)) {
+        for (size_t i = 0; i < nLength; i++) {
+            CMutableTransaction mtx;
+            mtx.vin.emplace_back(coin.outpoint);
+            mtx.vout.emplace_back(coin.out.nValue - BENCH_FEE, setup.coinbaseScript);
+            setup.SignTx(mtx, {coin});
+            txns.emplace_back(MakeTransactionRef(mtx));
+            coin = BenchCoin(COutPoint(txns.back()->GetHash(), 0), txns.back()->vout[0]);
+        }
+    }
+    return txns;
+}
+
+static void MempoolAcceptChains(benchmark::State& state)
+{
+    BenchChainSetup setup(SETUP_CHAIN_BLOCKS);
+    AcceptBurstBench(state, CreateChains(setup, CHAINS, CHAIN_LENGTH));
+}
+
+static void MempoolAcceptColdStaking(benchmark::State& state)
+{
+    BenchChainSetup setup(SETUP_CHAIN_BLOCKS);
+    CKey stakerKey;
+    stakerKey.MakeNewKey(true);
+    const CScript& scriptP2CS = GetScriptForStakeDelegation(stakerKey.GetPubKey().GetID(),
+                                                            setup.coinbaseKey.GetPubKey().GetID());
+    std::vector<CTransactionRef> txns;
+    for (const BenchCoin& coin : setup.CreateCoins(COLDSTAKING_TXES, 10 * COIN)) {
+        CMutableTransaction mtx;
+        mtx.vin.emplace_back(coin.outpoint);
+        mtx.vout.emplace_back(coin.out.nValue - BENCH_FEE, scriptP2CS);
+        setup.SignTx(mtx, {coin});
+        txns.emplace_back(MakeTransactionRef(mtx));
+    }
+    AcceptBurstBench(state, txns);
+}
+
+static void MempoolAcceptShielded(benchmark::State& state)
+{
+    BenchChainSetup setup(SETUP_CHAIN_BLOCKS);
+    auto sk = libzcash::SaplingSpendingKey::random();
+    const auto& fvk = sk.full_viewing_key();
+    std::vector<CTransactionRef> txns;
+    for (const BenchCoin& coin : setup.CreateCoins(SHIELDED_TXES, 10 * COIN)) {
+        TransactionBuilder builder(Params().GetConsensus(), &setup.keystore);
+        builder.AddTransparentInput(coin.outpoint, coin.out.scriptPubKey, coin.out.nValue);
+        builder.AddSaplingOutput(fvk.ovk, sk.default_address(), coin.out.nValue - BENCH_SHIELDED_FEE);
+        builder.SetFee(BENCH_SHIELDED_FEE);
+        txns.emplace_back(MakeTransactionRef(builder.Build().GetTxOrThrow()));
+    }
+    AcceptBurstBench(state, txns);
+}
+
+// Unchecked mempool entries for the chains (no coins needed).
+static std::vector<CTxMemPoolEntry> CreateChainEntries(size_t nChains, size_t nLength)
+{
+    std::vector<CTxMemPoolEntry> entries;
+    const int64_t nTime = GetTime();
+    for (size_t c = 0; c < nChains; c++) {
+        COutPoint prevout(GetRandHash(), 0);
+        for (size_t i = 0; i < nLength; i++) {
+            CMutableTransaction mtx;
+            mtx.vin.emplace_back(prevout);
+            mtx.vin[0].scriptSig = CScript() << OP_1;
+            mtx.vout.emplace_back(10 * COIN - (CAmount)i * BENCH_FEE, CScript() << OP_1);
+            // Different fee rates for each chain, so that the eviction order is not trivial
+            entries.emplace_back(MakeTransactionRef(mtx), BENCH_FEE + (CAmount)c * 1000, nTime, 1, false, 1);
+            prevout = COutPoint(mtx.GetHash(), 0);
+        }
+    }
+    return entries;
+}
+
+// Ancestors/descendants update cost of CTxMemPool::addUnchecked for long (ancestor limit) chains
+static void MempoolAddUncheckedChains(benchmark::State& state)
+{
+    const auto& entries = CreateChainEntries(CHAINS, CHAIN_LENGTH);
+    CTxMemPool pool(CFeeRate(1000));
+    while (state.KeepRunning()) {
+        for (const CTxMemPoolEntry& entry : entries) {
+            pool.addUnchecked(entry.GetTx().GetHash(), entry);
+        }
+        pool.clear();
+    }
+}
+
+// Fill the pool (as MempoolAddUncheckedChains) and evict half of it by fee rate
+static void MempoolLimitSize(benchmark::State& state)
+{
+    // LimitMempoolSize uncaches the coins of the evicted txes from the coins tip
+    BenchChainSetup setup(1);
+    const auto& entries = CreateChainEntries(CHAINS, CHAIN_LENGTH);
+    CTxMemPool pool(CFeeRate(1000));
+    for (const CTxMemPoolEntry& entry : entries) {
+        pool.addUnchecked(entry.GetTx().GetHash(), entry);
+    }
+    const size_t nLimit = pool.DynamicMemoryUsage() / 2;
+    pool.clear();
+
+    LOCK(cs_main);
+    while (state.KeepRunning()) {
+        for (const CTxMemPoolEntry& entry : entries) {
+            pool.addUnchecked(entry.GetTx().GetHash(), entry);
+        }
+        LimitMempoolSize(pool, nLimit, DEFAULT_MEMPOOL_EXPIRY * 60 * 60);
+        assert(pool.DynamicMemoryUsage() <= nLimit);
+        pool.clear();
+    }
+}
+
+BENCHMARK(MempoolAcceptChains, 2);
+BENCHMARK(MempoolAcceptColdStaking, 2);
+BENCHMARK(MempoolAcceptShielded, 10);
+BENCHMARK(MempoolAddUncheckedChains, 20);
+BENCHMARK(MempoolLimitSize, 20);
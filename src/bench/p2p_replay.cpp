@@ -0,0 +1,138 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/bench.h"
+#include "bench/chain_setup.h"
+
+#include "chainparams.h"
+#include "net.h"
+#include "net_processing.h"
+#include "netmessagemaker.h"
+#include "random.h"
+#include "util/system.h"
+#include "utilstrencodings.h"
+#include "utiltime.h"
+#include "validation.h"
+
+// Replay of the messages received from the peers, through the message processing of the node.
+// Each iteration replays the messages of a -capturemessages file (-replayfile), or of a synthetic
+// capture, on new peers of the setup chain. With -replayspeed=<n> the messages are fed at n times
+// the speed of their capture, instead of as fast as the processing allows.
+
+static const int SETUP_CHAIN_BLOCKS = 100;
+// Synthetic capture: peers, and rounds of ping, getheaders and tx inv messages of each peer
+static const int SYNTHETIC_PEERS = 8;
+static const int SYNTHETIC_ROUNDS = 200;
+static const int SYNTHETIC_INV_SIZE = 16;
+
+static CCapturedMessage MakeCapturedMessage(NodeId nPeer, int64_t nTime, CSerializedNetMsg&& msg)
+{
+    CCapturedMessage captured;
+    captured.nTime = nTime;
+    captured.nPeer = nPeer;
+    captured.strCommand = msg.command;
+    captured.vPayload = std::move(msg.data);
+    return captured;
+}
+
+static std::vector<CCapturedMessage> SyntheticCapture()
+{
+    std::vector<CCapturedMessage> vMessages;
+    int64_t nTime = GetTimeMicros();
+    CNetMsgMaker initMsgMaker(INIT_PROTO_VERSION);
+    CNetMsgMaker msgMaker(PROTOCOL_VERSION);
+    for (NodeId nPeer = 0; nPeer < SYNTHETIC_PEERS; nPeer++) {
+        vMessages.emplace_back(MakeCapturedMessage(nPeer, nTime, initMsgMaker.Make(NetMsgType::VERSION, PROTOCOL_VERSION,
+                (uint64_t)NODE_NETWORK, GetTime(), CAddress(CService(), NODE_NONE), CAddress(CService(), NODE_NETWORK),
+                GetRand(std::numeric_limits<uint64_t>::max()), std::string("/bench/"), 0, true)));
+        vMessages.emplace_back(MakeCapturedMessage(nPeer, nTime, initMsgMaker.Make(NetMsgType::VERACK)));
+    }
+    const CBlockLocator locator = WITH_LOCK(cs_main, return chainActive.GetLocator());
+    for (int i = 0; i < SYNTHETIC_ROUNDS; i++) {
+        for (NodeId nPeer = 0; nPeer < SYNTHETIC_PEERS; nPeer++) {
+            nTime += 1000;
+            vMessages.emplace_back(MakeCapturedMessage(nPeer, nTime, msgMaker.Make(NetMsgType::PING, GetRand(std::numeric_limits<uint64_t>::max()))));
+            vMessages.emplace_back(MakeCapturedMessage(nPeer, nTime, msgMaker.Make(NetMsgType::GETHEADERS, locator, uint256())));
+            std::vector<CInv> vInv;
+            for (int j = 0; j < SYNTHETIC_INV_SIZE; j++) {
+                vInv.emplace_back(MSG_TX, GetRandHash());
+            }
+            vMessages.emplace_back(MakeCapturedMessage(nPeer, nTime, msgMaker.Make(NetMsgType::INV, vInv)));
+        }
+    }
+    return vMessages;
+}
+
+// The replayed peers don't have a socket: their sent messages are dropped
+static void DropSentMessages(CNode* pnode)
+{
+    LOCK(pnode->cs_vSend);
+    pnode->vSendMsg.clear();
+    pnode->nSendSize = 0;
+    pnode->nSendOffset = 0;
+    pnode->fPauseSend = false;
+}
+
+static void P2PReplay(benchmark::State& state)
+{
+    BenchChainSetup setup(SETUP_CHAIN_BLOCKS);
+
+    std::vector<CCapturedMessage> vMessages;
+    const std::string strFile = gArgs.GetArg("-replayfile", "");
+    if (strFile.empty()) {
+        vMessages = SyntheticCapture();
+    } else if (!ReadCapturedMessages(fs::absolute(strFile), vMessages)) {
+        throw std::runtime_error("Unable to read the capture " + strFile);
+    }
+    double dSpeed = 0;
+    if (gArgs.IsArgSet("-replayspeed") && !ParseDouble(gArgs.GetArg("-replayspeed", ""), &dSpeed)) {
+        throw std::runtime_error("Invalid -replayspeed");
+    }
+
+    g_connman = std::make_unique<CConnman>(0x1337, 0x1337);
+    CConnman::Options options;
+    options.nSendBufferMaxSize = 1000 * DEFAULT_MAXSENDBUFFER;
+    options.nReceiveFloodSize = 1000 * DEFAULT_MAXRECEIVEBUFFER;
+    g_connman->Init(options);
+    PeerLogicValidation peerLogic(g_connman.get());
+    std::atomic<bool> interrupt{false};
+
+    while (state.KeepRunning()) {
+        std::map<NodeId, std::unique_ptr<CNode>> mapNodes;
+        const int64_t nReplayStart = GetTimeMicros();
+        for (const CCapturedMessage& msg : vMessages) {
+            if (dSpeed > 0) {
+                const int64_t nDue = nReplayStart + (int64_t)((msg.nTime - vMessages.front().nTime) / dSpeed);
+                const int64_t nNow = GetTimeMicros();
+                if (nDue > nNow) MilliSleep((nDue - nNow) / 1000);
+            }
+            std::unique_ptr<CNode>& pnode = mapNodes[msg.nPeer];
+            if (!pnode) {
+                CAddress addr(CService(CNetAddr(), 0), NODE_NONE);
+                pnode.reset(new CNode(msg.nPeer, NODE_NETWORK, 0, INVALID_SOCKET, addr, msg.nPeer, msg.nPeer, "", true));
+                peerLogic.InitializeNode(pnode.get());
+            }
+            if (pnode->fDisconnect) continue;
+            if (!g_connman->ReplayMessage(pnode.get(), msg)) {
+                pnode->fDisconnect = true;
+                continue;
+            }
+            while (peerLogic.ProcessMessages(pnode.get(), interrupt)) {
+                DropSentMessages(pnode.get());
+            }
+            {
+                LOCK(pnode->cs_sendProcessing);
+                peerLogic.SendMessages(pnode.get(), interrupt);
+            }
+            DropSentMessages(pnode.get());
+        }
+        for (const auto& it : mapNodes) {
+            bool fUpdateConnectionTime = false;
+            peerLogic.FinalizeNode(it.first, fUpdateConnectionTime);
+        }
+    }
+    g_connman.reset();
+}
+
+BENCHMARK(P2PReplay, 1);
@@ -0,0 +1,339 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/bench.h"
+#include "bench/chain_setup.h"
+
+#include "chainparams.h"
+#include "random.h"
+#include "sapling/incrementalmerkletree.h"
+#include "sapling/note.h"
+#include "sapling/sapling_validation.h"
+#include "sapling/saplingscriptpubkeyman.h"
+#include "sapling/transaction_builder.h"
+#include "sapling/zip32.h"
+#include "script/interpreter.h"
+#include "wallet/wallet.h"
+
+#include <librustzcash.h>
+
+// Proofs verification, proving (TransactionBuilder::Build), trial decryption of the outputs,
+// note commitment tree and witnesses updates, and witnesses updates of a wallet with many notes.
+
+static const CAmount NOTE_VALUE = 10 * COIN;
+static const CAmount BENCH_SHIELDED_FEE = COIN / 10;
+// Trial decryption: outputs of the tx and viewing keys of the wallet
+static const size_t DECRYPTION_OUTPUTS = 10;
+static const size_t DECRYPTION_IVKS = 100;
+// Commitment tree: leaves of the initial tree, appended commitments and witnesses
+static const size_t TREE_SIZE = 1000;
+static const size_t TREE_APPENDS = 100;
+static const size_t TREE_WITNESSES = 100;
+// Wallet witnesses: notes of the wallet and shielded outputs of each new block
+static const size_t WALLET_NOTES = 1000;
+static const size_t BLOCK_OUTPUTS = 20;
+
+static uint256 RandomCommitment()
+{
+    return *libzcash::SaplingNote(libzcash::SaplingSpendingKey::random().default_address(), COIN).cmu();
+}
+
+/** Notes of sk in a commitment tree, with their witnesses */
+struct SpendableNotes
+{
+    libzcash::SaplingSpendingKey sk;
+    std::vector<libzcash::SaplingNote> notes;
+    std::vector<SaplingWitness> witnesses;
+    SaplingMerkleTree tree;
+
+    SpendableNotes(size_t nNotes) : sk(libzcash::SaplingSpendingKey::random())
+    {
+        for (size_t i = 0; i < nNotes; i++) {
+            notes.emplace_back(sk.default_address(), NOTE_VALUE);
+            const uint256& cmu = *notes.back().cmu();
+            for (SaplingWitness& witness : witnesses) {
+                witness.append(cmu);
+            }
+            tree.append(cmu);
+            witnesses.emplace_back(tree.witness());
+        }
+    }
+};
+
+// A tx spending all the notes, to nOutputs outputs (of the same key)
+static CTransaction BuildShieldedTx(const SpendableNotes& spendable, size_t nOutputs)
+{
+    TransactionBuilder builder(Params().GetConsensus());
+    for (size_t i = 0; i < spendable.notes.size(); i++) {
+        builder.AddSaplingSpend(spendable.sk.expanded_spending_key(), spendable.notes[i], spendable.tree.root(), spendable.witnesses[i]);
+    }
+    const CAmount nTotal = NOTE_VALUE * spendable.notes.size() - BENCH_SHIELDED_FEE;
+    for (size_t i = 0; i < nOutputs; i++) {
+        builder.AddSaplingOutput(spendable.sk.full_viewing_key().ovk, spendable.sk.default_address(), nTotal / nOutputs);
+    }
+    builder.SetFee(nTotal - (nTotal / nOutputs) * nOutputs + BENCH_SHIELDED_FEE);
+    return builder.Build().GetTxOrThrow();
+}
+
+static CTransaction VerificationTx()
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    InitBenchZKSNARKS();
+    return BuildShieldedTx(SpendableNotes(2), 2);
+}
+
+static uint256 SaplingSigHash(const CTransaction& tx)
+{
+    return SignatureHash(CScript(), tx, NOT_AN_INPUT, SIGHASH_ALL, 0, SIGVERSION_SAPLING);
+}
+
+static void SaplingSpendProofVerify(benchmark::State& state)
+{
+    const CTransaction& tx = VerificationTx();
+    const uint256& sighash = SaplingSigHash(tx);
+    while (state.KeepRunning()) {
+        auto ctx = librustzcash_sapling_verification_ctx_init();
+        for (const SpendDescription& spend : tx.sapData->vShieldedSpend) {
+            bool fValid = librustzcash_sapling_check_spend(ctx, spend.cv.begin(), spend.anchor.begin(), spend.nullifier.begin(),
+                                                           spend.rk.begin(), spend.zkproof.begin(), spend.spendAuthSig.begin(), sighash.begin());
+            assert(fValid);
+        }
+        librustzcash_sapling_verification_ctx_free(ctx);
+    }
+}
+
+static void SaplingOutputProofVerify(benchmark::State& state)
+{
+    const CTransaction& tx = VerificationTx();
+    while (state.KeepRunning()) {
+        auto ctx = librustzcash_sapling_verification_ctx_init();
+        for (const OutputDescription& output : tx.sapData->vShieldedOutput) {
+            bool fValid = librustzcash_sapling_check_output(ctx, output.cv.begin(), output.cmu.begin(),
+                                                            output.ephemeralKey.begin(), output.zkproof.begin());
+            assert(fValid);
+        }
+        librustzcash_sapling_verification_ctx_free(ctx);
+    }
+}
+
+// All the proofs and the binding signature of the tx
+static void SaplingCheckProofs(benchmark::State& state)
+{
+    const CTransaction& tx = VerificationTx();
+    const uint256& sighash = SaplingSigHash(tx);
+    while (state.KeepRunning()) {
+        CValidationState valState;
+        bool fValid = SaplingValidation::CheckSaplingProofs(tx, sighash, valState, 100);
+        assert(fValid);
+    }
+}
+
+static void SaplingBuildBench(benchmark::State& state, size_t nSpends, size_t nOutputs)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    InitBenchZKSNARKS();
+    const SpendableNotes spendable(nSpends);
+    while (state.KeepRunning()) {
+        const CTransaction& tx = BuildShieldedTx(spendable, nOutputs);
+        assert(tx.sapData->vShieldedSpend.size() == nSpends);
+    }
+}
+
+static void SaplingBuild1Spend2Outputs(benchmark::State& state) { SaplingBuildBench(state, 1, 2); }
+static void SaplingBuild2Spends2Outputs(benchmark::State& state) { SaplingBuildBench(state, 2, 2); }
+static void SaplingBuild4Spends4Outputs(benchmark::State& state) { SaplingBuildBench(state, 4, 4); }
+
+// An output of NOTE_VALUE paying to addr, encrypted as done by the builder
+static OutputDescription EncryptedOutput(const libzcash::SaplingPaymentAddress& addr)
+{
+    const libzcash::SaplingNote note(addr, NOTE_VALUE);
+    const std::array<unsigned char, ZC_MEMO_SIZE> memo = {{0xF6}};
+    auto res = libzcash::SaplingNotePlaintext(note, memo).encrypt(note.pk_d);
+    assert(res);
+    OutputDescription output;
+    output.cmu = *note.cmu();
+    output.ephemeralKey = res->second.get_epk();
+    output.encCiphertext = res->first;
+    return output;
+}
+
+// A tx with one output paying to addr, the others paying to random addresses
+static CTransaction DecryptionTx(const libzcash::SaplingPaymentAddress& addr)
+{
+    CMutableTransaction mtx;
+    mtx.nVersion = CTransaction::TxVersion::SAPLING;
+    for (size_t i = 0; i < DECRYPTION_OUTPUTS - 1; i++) {
+        mtx.sapData->vShieldedOutput.emplace_back(EncryptedOutput(libzcash::SaplingSpendingKey::random().default_address()));
+    }
+    mtx.sapData->vShieldedOutput.emplace_back(EncryptedOutput(addr));
+    return CTransaction(mtx);
+}
+
+// Trial decryption of all the outputs of the tx with all the ivks, on a single thread
+static void SaplingTrialDecryption(benchmark::State& state)
+{
+    std::vector<libzcash::SaplingIncomingViewingKey> ivks;
+    libzcash::SaplingPaymentAddress addr;
+    for (size_t i = 0; i < DECRYPTION_IVKS; i++) {
+        const auto& sk = libzcash::SaplingSpendingKey::random();
+        ivks.emplace_back(sk.full_viewing_key().in_viewing_key());
+        addr = sk.default_address();
+    }
+    const CTransaction& tx = DecryptionTx(addr);
+    while (state.KeepRunning()) {
+        size_t nFound = 0;
+        for (const OutputDescription& output : tx.sapData->vShieldedOutput) {
+            for (const auto& ivk : ivks) {
+                if (libzcash::SaplingNotePlaintext::decrypt(output.encCiphertext, ivk, output.ephemeralKey, output.cmu)) {
+                    nFound++;
+                    break;
+                }
+            }
+        }
+        assert(nFound == 1);
+    }
+}
+
+static std::unique_ptr<CWallet> CreateBenchWallet()
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    std::unique_ptr<CWallet> pwallet = std::make_unique<CWallet>("default", WalletDatabase::CreateMock());
+    bool isInit;
+    pwallet->LoadWallet(isInit);
+    pwallet->SetupSPKM(false, true);
+    return pwallet;
+}
+
+// Trial decryption of the tx by a wallet with many Sapling keys (spread over the decryption threads)
+static void SaplingFindMyNotes(benchmark::State& state)
+{
+    std::unique_ptr<CWallet> pwallet = CreateBenchWallet();
+    std::vector<unsigned char, secure_allocator<unsigned char>> rawSeed(32);
+    GetStrongRandBytes(rawSeed.data(), rawSeed.size());
+    const auto& master = libzcash::SaplingExtendedSpendingKey::Master(HDSeed(rawSeed));
+    libzcash::SaplingPaymentAddress addr;
+    {
+        LOCK(pwallet->cs_wallet);
+        for (uint32_t i = 0; i < DECRYPTION_IVKS; i++) {
+            const auto& sk = master.Derive(i | ZIP32_HARDENED_KEY_LIMIT);
+            assert(pwallet->AddSaplingZKey(sk));
+            addr = sk.DefaultAddress();
+        }
+    }
+    const CTransaction& tx = DecryptionTx(addr);
+    while (state.KeepRunning()) {
+        const auto& found = pwallet->GetSaplingScriptPubKeyMan()->FindMySaplingNotes(tx);
+        assert(found.first.size() == 1);
+    }
+}
+
+static void SaplingMerkleTreeAppend(benchmark::State& state)
+{
+    SaplingMerkleTree tree;
+    for (size_t i = 0; i < TREE_SIZE; i++) {
+        tree.append(RandomCommitment());
+    }
+    std::vector<uint256> vCommitments;
+    for (size_t i = 0; i < TREE_APPENDS; i++) {
+        vCommitments.emplace_back(RandomCommitment());
+    }
+    while (state.KeepRunning()) {
+        SaplingMerkleTree treeCopy(tree);
+        for (const uint256& cmu : vCommitments) {
+            treeCopy.append(cmu);
+        }
+        assert(treeCopy.size() == TREE_SIZE + TREE_APPENDS);
+    }
+}
+
+// Update of the witnesses of the last leaves of the tree, with the new commitments
+static void SaplingWitnessAppend(benchmark::State& state)
+{
+    SaplingMerkleTree tree;
+    std::vector<SaplingWitness> witnesses;
+    for (size_t i = 0; i < TREE_SIZE; i++) {
+        const uint256& cmu = RandomCommitment();
+        for (SaplingWitness& witness : witnesses) {
+            witness.append(cmu);
+        }
+        tree.append(cmu);
+        if (i >= TREE_SIZE - TREE_WITNESSES) {
+            witnesses.emplace_back(tree.witness());
+        }
+    }
+    std::vector<uint256> vCommitments;
+    for (size_t i = 0; i < TREE_APPENDS; i++) {
+        vCommitments.emplace_back(RandomCommitment());
+    }
+    while (state.KeepRunning()) {
+        std::vector<SaplingWitness> witnessesCopy(witnesses);
+        for (SaplingWitness& witness : witnessesCopy) {
+            for (const uint256& cmu : vCommitments) {
+                witness.append(cmu);
+            }
+        }
+    }
+}
+
+// Shielded tx with the given output commitments (no proofs)
+static CTransactionRef CommitmentsTx(const std::vector<uint256>& vCommitments)
+{
+    CMutableTransaction mtx;
+    mtx.nVersion = CTransaction::TxVersion::SAPLING;
+    for (const uint256& cmu : vCommitments) {
+        OutputDescription output;
+        output.cmu = cmu;
+        mtx.sapData->vShieldedOutput.emplace_back(output);
+    }
+    return MakeTransactionRef(mtx);
+}
+
+// Witnesses update of the notes of the wallet, for blocks with foreign shielded outputs
+static void SaplingIncrementNoteWitnesses(benchmark::State& state)
+{
+    std::unique_ptr<CWallet> pwallet = CreateBenchWallet();
+    const auto& sk = libzcash::SaplingSpendingKey::random();
+    const libzcash::SaplingIncomingViewingKey& ivk = sk.full_viewing_key().in_viewing_key();
+
+    // A first block with the notes of the wallet, each one in its own tx
+    CBlock block;
+    {
+        LOCK(pwallet->cs_wallet);
+        for (size_t i = 0; i < WALLET_NOTES; i++) {
+            CWalletTx wtx(pwallet.get(), CommitmentsTx({*libzcash::SaplingNote(sk.default_address(), NOTE_VALUE).cmu()}));
+            mapSaplingNoteData_t noteData;
+            noteData[SaplingOutPoint(wtx.GetHash(), 0)] = SaplingNoteData(ivk);
+            wtx.SetSaplingNoteData(noteData);
+            pwallet->LoadToWallet(wtx);
+            block.vtx.emplace_back(wtx.tx);
+        }
+    }
+    SaplingMerkleTree tree;
+    CBlockIndex index(block);
+    index.nHeight = 1;
+    pwallet->IncrementNoteWitnesses(&index, &block, tree);
+
+    std::vector<uint256> vCommitments;
+    for (size_t i = 0; i < BLOCK_OUTPUTS; i++) {
+        vCommitments.emplace_back(RandomCommitment());
+    }
+    CBlock blockForeign;
+    blockForeign.vtx.emplace_back(CommitmentsTx(vCommitments));
+    while (state.KeepRunning()) {
+        index.nHeight++;
+        pwallet->IncrementNoteWitnesses(&index, &blockForeign, tree);
+    }
+}
+
+BENCHMARK(SaplingSpendProofVerify, 50);
+BENCHMARK(SaplingOutputProofVerify, 100);
+BENCHMARK(SaplingCheckProofs, 30);
+BENCHMARK(SaplingBuild1Spend2Outputs, 2);
+BENCHMARK(SaplingBuild2Spends2Outputs, 2);
+BENCHMARK(SaplingBuild4Spends4Outputs, 1);
+BENCHMARK(SaplingTrialDecryption, 200);
+BENCHMARK(SaplingFindMyNotes, 500);
+BENCHMARK(SaplingMerkleTreeAppend, 50);
+BENCHMARK(SaplingWitnessAppend, 5);
+BENCHMARK(SaplingIncrementNoteWitnesses, 5);
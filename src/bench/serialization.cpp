@@ -0,0 +1,276 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/bench.h"
+
+#include "bls/bls_wrapper.h"
+#include "evo/deterministicmns.h"
+#include "evo/providertx.h"
+#include "llmq/quorums_commitment.h"
+#include "netbase.h"
+#include "primitives/transaction.h"
+#include "random.h"
+#include "script/standard.h"
+#include "streams.h"
+
+// Serialization, deserialization and GetSerializeSize of the transactions (transparent, P2CS,
+// Sapling and special), of a deterministic masternodes list and of a final commitment,
+// and growth patterns of CDataStream.
+
+static const size_t TX_INPUTS = 2;
+static const size_t TX_OUTPUTS = 2;
+static const size_t TX_SHIELDED_SPENDS = 2;
+static const size_t TX_SHIELDED_OUTPUTS = 2;
+static const size_t DMN_LIST_SIZE = 400;
+static const size_t STREAM_ITEMS = 1000;
+
+// Random inputs, with a scriptSig of the size of a P2PKH signature and a compressed key
+static void AddRandomInputs(CMutableTransaction& mtx, size_t nInputs)
+{
+    for (size_t i = 0; i < nInputs; i++) {
+        mtx.vin.emplace_back(GetRandHash(), (uint32_t)i);
+        std::vector<unsigned char> vchSig(72), vchPubKey(33);
+        GetRandBytes(vchSig.data(), vchSig.size());
+        GetRandBytes(vchPubKey.data(), vchPubKey.size());
+        mtx.vin.back().scriptSig << vchSig << vchPubKey;
+    }
+}
+
+static CKeyID RandomKeyID()
+{
+    CKeyID keyID;
+    GetRandBytes(keyID.begin(), keyID.size());
+    return keyID;
+}
+
+static CTransactionRef TransparentTx()
+{
+    CMutableTransaction mtx;
+    AddRandomInputs(mtx, TX_INPUTS);
+    for (size_t i = 0; i < TX_OUTPUTS; i++) {
+        mtx.vout.emplace_back(COIN, GetScriptForDestination(RandomKeyID()));
+    }
+    return MakeTransactionRef(mtx);
+}
+
+// A delegation, with its change
+static CTransactionRef P2CSTx()
+{
+    CMutableTransaction mtx;
+    AddRandomInputs(mtx, TX_INPUTS);
+    mtx.vout.emplace_back(100 * COIN, GetScriptForStakeDelegation(RandomKeyID(), RandomKeyID()));
+    mtx.vout.emplace_back(COIN, GetScriptForDestination(RandomKeyID()));
+    return MakeTransactionRef(mtx);
+}
+
+static CTransactionRef SaplingTx()
+{
+    CMutableTransaction mtx;
+    mtx.nVersion = CTransaction::TxVersion::SAPLING;
+    for (size_t i = 0; i < TX_SHIELDED_SPENDS; i++) {
+        SpendDescription spend;
+        spend.cv = GetRandHash();
+        spend.anchor = GetRandHash();
+        spend.nullifier = GetRandHash();
+        spend.rk = GetRandHash();
+        GetRandBytes(spend.zkproof.data(), spend.zkproof.size());
+        GetRandBytes(spend.spendAuthSig.data(), spend.spendAuthSig.size());
+        mtx.sapData->vShieldedSpend.emplace_back(spend);
+    }
+    for (size_t i = 0; i < TX_SHIELDED_OUTPUTS; i++) {
+        OutputDescription output;
+        output.cv = GetRandHash();
+        output.cmu = GetRandHash();
+        output.ephemeralKey = GetRandHash();
+        GetRandBytes(output.encCiphertext.data(), output.encCiphertext.size());
+        GetRandBytes(output.outCiphertext.data(), output.outCiphertext.size());
+        GetRandBytes(output.zkproof.data(), output.zkproof.size());
+        mtx.sapData->vShieldedOutput.emplace_back(output);
+    }
+    GetRandBytes(mtx.sapData->bindingSig.data(), mtx.sapData->bindingSig.size());
+    return MakeTransactionRef(mtx);
+}
+
+static ProRegPL RandomProRegPL(uint16_t nPort)
+{
+    ProRegPL pl;
+    pl.collateralOutpoint = COutPoint(GetRandHash(), 0);
+    pl.addr = LookupNumeric("127.0.0.1", nPort);
+    pl.keyIDOwner = RandomKeyID();
+    CBLSSecretKey sk;
+    sk.MakeNewKey();
+    pl.pubKeyOperator = sk.GetPublicKey();
+    pl.keyIDVoting = RandomKeyID();
+    pl.scriptPayout = GetScriptForDestination(RandomKeyID());
+    pl.inputsHash = GetRandHash();
+    pl.vchSig.resize(65);
+    GetRandBytes(pl.vchSig.data(), pl.vchSig.size());
+    return pl;
+}
+
+// A ProRegTx, with its extraPayload
+static CTransactionRef SpecialTx()
+{
+    CMutableTransaction mtx;
+    mtx.nVersion = CTransaction::TxVersion::SAPLING;
+    mtx.nType = CTransaction::TxType::PROREG;
+    AddRandomInputs(mtx, TX_INPUTS);
+    mtx.vout.emplace_back(COIN, GetScriptForDestination(RandomKeyID()));
+    SetTxPayload(mtx, RandomProRegPL(51472));
+    return MakeTransactionRef(mtx);
+}
+
+static CDeterministicMNList DMNList()
+{
+    CDeterministicMNList list(GetRandHash(), 1000, 0);
+    for (size_t i = 0; i < DMN_LIST_SIZE; i++) {
+        const ProRegPL pl = RandomProRegPL(1024 + i);
+        auto dmn = std::make_shared<CDeterministicMN>(i);
+        dmn->proTxHash = GetRandHash();
+        dmn->collateralOutpoint = pl.collateralOutpoint;
+        dmn->nOperatorReward = pl.nOperatorReward;
+        auto state = std::make_shared<CDeterministicMNState>(pl);
+        state->nRegisteredHeight = 100 + i;
+        state->confirmedHash = GetRandHash();
+        state->confirmedHashWithProRegTxHash = GetRandHash();
+        dmn->pdmnState = state;
+        list.AddMN(dmn);
+    }
+    return list;
+}
+
+// A commitment of a 400 members quorum, signed by all of them
+static llmq::CFinalCommitment FinalCommitment()
+{
+    llmq::CFinalCommitment qc;
+    qc.llmqType = Consensus::LLMQ_400_60;
+    qc.quorumHash = GetRandHash();
+    qc.signers.assign(400, true);
+    qc.validMembers.assign(400, true);
+    CBLSSecretKey sk;
+    sk.MakeNewKey();
+    qc.quorumPublicKey = sk.GetPublicKey();
+    qc.quorumVvecHash = GetRandHash();
+    qc.quorumSig = sk.Sign(GetRandHash());
+    qc.membersSig = sk.Sign(GetRandHash());
+    return qc;
+}
+
+template <typename T>
+static void SerializeBench(benchmark::State& state, const T& obj)
+{
+    while (state.KeepRunning()) {
+        CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+        stream << obj;
+        assert(!stream.empty());
+    }
+}
+
+template <typename T>
+static void DeserializeBench(benchmark::State& state, const T& obj)
+{
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << obj;
+    const size_t nSize = stream.size();
+    char a = '\0';
+    stream.write(&a, 1); // Prevent compaction
+
+    while (state.KeepRunning()) {
+        T objRead;
+        stream >> objRead;
+        bool rewound = stream.Rewind(nSize);
+        assert(rewound);
+    }
+}
+
+template <typename T>
+static void GetSerializeSizeBench(benchmark::State& state, const T& obj)
+{
+    size_t nTotal = 0;
+    while (state.KeepRunning()) {
+        nTotal += ::GetSerializeSize(obj, PROTOCOL_VERSION);
+    }
+    assert(nTotal > 0);
+}
+
+static void SerializeTransparentTx(benchmark::State& state) { SerializeBench(state, TransparentTx()); }
+static void DeserializeTransparentTx(benchmark::State& state) { DeserializeBench(state, TransparentTx()); }
+static void GetSerializeSizeTransparentTx(benchmark::State& state) { GetSerializeSizeBench(state, TransparentTx()); }
+static void SerializeP2CSTx(benchmark::State& state) { SerializeBench(state, P2CSTx()); }
+static void DeserializeP2CSTx(benchmark::State& state) { DeserializeBench(state, P2CSTx()); }
+static void SerializeSaplingTx(benchmark::State& state) { SerializeBench(state, SaplingTx()); }
+static void DeserializeSaplingTx(benchmark::State& state) { DeserializeBench(state, SaplingTx()); }
+static void GetSerializeSizeSaplingTx(benchmark::State& state) { GetSerializeSizeBench(state, SaplingTx()); }
+static void SerializeSpecialTx(benchmark::State& state) { SerializeBench(state, SpecialTx()); }
+static void DeserializeSpecialTx(benchmark::State& state) { DeserializeBench(state, SpecialTx()); }
+static void SerializeDMNList(benchmark::State& state) { SerializeBench(state, DMNList()); }
+static void DeserializeDMNList(benchmark::State& state) { DeserializeBench(state, DMNList()); }
+static void GetSerializeSizeDMNList(benchmark::State& state) { GetSerializeSizeBench(state, DMNList()); }
+static void SerializeFinalCommitment(benchmark::State& state) { SerializeBench(state, FinalCommitment()); }
+static void DeserializeFinalCommitment(benchmark::State& state) { DeserializeBench(state, FinalCommitment()); }
+
+// Many small writes to a new stream, growing its buffer as they go
+static void DataStreamGrowth(benchmark::State& state)
+{
+    const uint256 hash = GetRandHash();
+    while (state.KeepRunning()) {
+        CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+        for (size_t i = 0; i < STREAM_ITEMS; i++) {
+            stream << VARINT(i) << hash;
+        }
+        assert(!stream.empty());
+    }
+}
+
+// The same writes, to a stream reserved beforehand
+static void DataStreamReserved(benchmark::State& state)
+{
+    const uint256 hash = GetRandHash();
+    const size_t nReserve = STREAM_ITEMS * (sizeof(uint64_t) + hash.size());
+    while (state.KeepRunning()) {
+        CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+        stream.reserve(nReserve);
+        for (size_t i = 0; i < STREAM_ITEMS; i++) {
+            stream << VARINT(i) << hash;
+        }
+        assert(!stream.empty());
+    }
+}
+
+// Write and read back of the same stream, as done by the message processing
+static void DataStreamReuse(benchmark::State& state)
+{
+    const uint256 hash = GetRandHash();
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < STREAM_ITEMS; i++) {
+            stream << VARINT(i) << hash;
+        }
+        uint64_t n;
+        uint256 hashRead;
+        for (size_t i = 0; i < STREAM_ITEMS; i++) {
+            stream >> VARINT(n) >> hashRead;
+        }
+        assert(stream.empty());
+    }
+}
+
+BENCHMARK(SerializeTransparentTx, 300 * 1000);
+BENCHMARK(DeserializeTransparentTx, 200 * 1000);
+BENCHMARK(GetSerializeSizeTransparentTx, 1000 * 1000);
+BENCHMARK(SerializeP2CSTx, 300 * 1000);
+BENCHMARK(DeserializeP2CSTx, 200 * 1000);
+BENCHMARK(SerializeSaplingTx, 200 * 1000);
+BENCHMARK(DeserializeSaplingTx, 100 * 1000);
+BENCHMARK(GetSerializeSizeSaplingTx, 1000 * 1000);
+BENCHMARK(SerializeSpecialTx, 200 * 1000);
+BENCHMARK(DeserializeSpecialTx, 100 * 1000);
+BENCHMARK(SerializeDMNList, 200);
+BENCHMARK(DeserializeDMNList, 20);
+BENCHMARK(GetSerializeSizeDMNList, 200);
+BENCHMARK(SerializeFinalCommitment, 100 * 1000);
+BENCHMARK(DeserializeFinalCommitment, 1000);
+BENCHMARK(DataStreamGrowth, 5000);
+BENCHMARK(DataStreamReserved, 5000);
+BENCHMARK(DataStreamReuse, 5000);
@@ -148,7 +148,7 @@ static void WalletProcessBlockBench(benchmark::State& state)
         }
 
         std::shared_ptr<CBlock> pblock = createAndProcessBlock(params, coinbaseScript, vtx, chainActive.Tip());
-        pwallet->BlockConnected(pblock, mapBlockIndex[pblock->GetHash()]);
+        pwallet->BlockConnected(pblock, WITH_LOCK(cs_main, return LookupBlockIndex(pblock->GetHash()); ));
     }
     assert(WITH_LOCK(cs_main, return chainActive.Height();) == gen -1);
     int nextBlockHeight = gen + 1;
@@ -186,7 +186,7 @@ static void WalletProcessBlockBench(benchmark::State& state)
     // The wallet receiving the blocks..
     while (state.KeepRunning()) {
         for (const auto& pblock : blocks) {
-            pwallet->BlockConnected(pblock, mapBlockIndex[pblock->GetHash()]);
+            pwallet->BlockConnected(pblock, WITH_LOCK(cs_main, return LookupBlockIndex(pblock->GetHash()); ));
         }
     }
 
@@ -101,8 +101,8 @@ bool SolveProofOfStake(CBlock* pblock, CBlockIndex* pindexPrev, CWallet* pwallet
         return error("Unable to sign coinstake with input %s-%d", stakeIn.hash.ToString(), stakeIn.n);
     }
 
-    pblock->vtx.emplace_back(MakeTransactionRef(txCoinbase));
-    pblock->vtx.emplace_back(MakeTransactionRef(txCoinStake));
+    // The rest of the block may already be assembled
+    pblock->vtx.insert(pblock->vtx.begin(), {MakeTransactionRef(txCoinbase), MakeTransactionRef(txCoinStake)});
     pblock->nTime = nTxNewTime;
     return true;
 }
@@ -133,6 +133,32 @@ bool CreateCoinbaseTx(CBlock* pblock, const CScript& scriptPubKeyIn, CBlockIndex
     return true;
 }
 
+namespace {
+
+/**
+ * The mempool transactions selected by the last addPackageTxs, with the state it depended on.
+ * The stakers assemble a block at every time slot, mostly with the same tip and mempool: the
+ * selection is then reused instead of walking the mempool packages again.
+ */
+struct MempoolSelection
+{
+    bool fValid{false};
+    uint256 hashPrevBlock;
+    //! CTxMemPool::GetTransactionsUpdated(), bumped by every change of the mempool entries
+    unsigned int nTransactionsUpdated{0};
+    //! The space used in the block before the mempool transactions (coinbase, coinstake, commitments)
+    uint64_t nStartBlockSize{0};
+    unsigned int nStartBlockSigOps{0};
+    unsigned int nBlockMaxSize{0};
+    bool fShieldMaintenance{false};
+    //! The mempool entries, valid until the mempool changes
+    std::vector<CTxMemPool::txiter> vEntries;
+};
+
+MempoolSelection lastMempoolSelection GUARDED_BY(mempool.cs);
+
+} // anon namespace
+
 BlockAssembler::BlockAssembler(const CChainParams& _chainparams, const bool _defaultPrintPriority)
         : chainparams(_chainparams), defaultPrintPriority(_defaultPrintPriority)
 {
@@ -186,9 +212,10 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
         pblock->nVersion = gArgs.GetArg("-blockversion", pblock->nVersion);
     }
 
-    // Depending on the tip height, try to find a coinstake who solves the block or create a coinbase tx.
-    if (!(fProofOfStake ? SolveProofOfStake(pblock, pindexPrev, pwallet, availableCoins, stopPoSOnNewBlock)
-                        : CreateCoinbaseTx(pblock, scriptPubKeyIn, pindexPrev))) {
+    // For PoS, the coinstake (and the coinbase with the payments) is added in front of the rest of the
+    // block, which is assembled before the kernel search: once a kernel is found, only the coinstake
+    // and the signatures are left to do before the block is broadcast.
+    if (!fProofOfStake && !CreateCoinbaseTx(pblock, scriptPubKeyIn, pindexPrev)) {
         return nullptr;
     }
 
@@ -211,7 +238,12 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     if (!fNoMempoolTx) {
         // Add transactions from mempool
         LOCK2(cs_main,mempool.cs);
-        addPackageTxs();
+        addMempoolTxs(pindexPrev);
+    }
+
+    // Try to find a coinstake who solves the block
+    if (fProofOfStake && !SolveProofOfStake(pblock, pindexPrev, pwallet, availableCoins, stopPoSOnNewBlock)) {
+        return nullptr;
     }
 
     if (!fProofOfStake) {
@@ -286,8 +318,11 @@ bool BlockAssembler::TestPackage(uint64_t packageSize, unsigned int packageSigOp
 bool BlockAssembler::TestPackageFinality(const CTxMemPool::setEntries& package)
 {
     for (const CTxMemPool::txiter& it : package) {
-        if (!IsFinalTx(it->GetSharedTx(), nHeight))
+        if (!IsFinalTx(it->GetSharedTx(), nHeight)) {
+            // May become final with the time only
+            fSkippedNonFinal = true;
             return false;
+        }
     }
     return true;
 }
@@ -373,6 +408,45 @@ void BlockAssembler::SortForBlock(const CTxMemPool::setEntries& package, CTxMemP
 // Each time through the loop, we compare the best transaction in
 // mapModifiedTxs with the next transaction in the mempool to decide what
 // transaction package to work on next.
+void BlockAssembler::addMempoolTxs(const CBlockIndex* pindexPrev)
+{
+    AssertLockHeld(mempool.cs);
+    MempoolSelection& last = lastMempoolSelection;
+    const bool fShieldMaintenance = sporkManager.IsSporkActive(SPORK_20_SAPLING_MAINTENANCE);
+    if (last.fValid &&
+            last.hashPrevBlock == pindexPrev->GetBlockHash() &&
+            last.nTransactionsUpdated == mempool.GetTransactionsUpdated() &&
+            last.nStartBlockSize == nBlockSize &&
+            last.nStartBlockSigOps == nBlockSigOps &&
+            last.nBlockMaxSize == nBlockMaxSize &&
+            last.fShieldMaintenance == fShieldMaintenance) {
+        for (const CTxMemPool::txiter& it : last.vEntries) {
+            if (it->IsShielded()) nSizeShielded += it->GetTxSize();
+            AddToBlock(it);
+        }
+        return;
+    }
+
+    last.fValid = false;
+    last.hashPrevBlock = pindexPrev->GetBlockHash();
+    last.nTransactionsUpdated = mempool.GetTransactionsUpdated();
+    last.nStartBlockSize = nBlockSize;
+    last.nStartBlockSigOps = nBlockSigOps;
+    last.nBlockMaxSize = nBlockMaxSize;
+    last.fShieldMaintenance = fShieldMaintenance;
+    last.vEntries.clear();
+
+    const size_t nFirstTx = pblock->vtx.size();
+    fSkippedNonFinal = false;
+    addPackageTxs();
+    for (size_t i = nFirstTx; i < pblock->vtx.size(); i++) {
+        CTxMemPool::txiter it = mempool.mapTx.find(pblock->vtx[i]->GetHash());
+        assert(it != mempool.mapTx.end());
+        last.vEntries.emplace_back(it);
+    }
+    last.fValid = !fSkippedNonFinal;
+}
+
 void BlockAssembler::addPackageTxs()
 {
     // mapModifiedTx will store sorted packages after they are modified
@@ -509,13 +583,15 @@ uint256 CalculateSaplingTreeRoot(CBlock* pblock, int nHeight, const CChainParams
         assert(pcoinsTip->GetSaplingAnchorAt(pcoinsTip->GetBestAnchor(), sapling_tree));
 
         // Update the Sapling commitment tree.
+        std::vector<libzcash::PedersenHash> vCommitments;
         for (const auto &tx : pblock->vtx) {
             if (tx->IsShieldedTx()) {
                 for (const OutputDescription &odesc : tx->sapData->vShieldedOutput) {
-                    sapling_tree.append(odesc.cmu);
+                    vCommitments.emplace_back(odesc.cmu);
                 }
             }
         }
+        sapling_tree.append(vCommitments);
         return sapling_tree.root();
     }
     return UINT256_ZERO;
@@ -156,6 +156,9 @@ private:
     // Keep track of block space used for shield txes
     unsigned int nSizeShielded{0};
 
+    // Whether a package was skipped by addPackageTxs as not final
+    bool fSkippedNonFinal{false};
+
     // Whether should print priority by default or not
     const bool defaultPrintPriority{false};
 
@@ -180,6 +183,9 @@ private:
     void AddToBlock(CTxMemPool::txiter iter);
 
     // Methods for how to add transactions to a block.
+    /** Add the mempool transactions with addPackageTxs, or the ones it selected for the previous
+      * block if the tip, the mempool and the block space available are unchanged */
+    void addMempoolTxs(const CBlockIndex* pindexPrev);
     /** Add transactions based on feerate including unconfirmed ancestors */
     void addPackageTxs();
     /** Add the tip updated incremental merkle tree to the header */
@@ -5,6 +5,7 @@
 
 #include "bloom.h"
 
+#include "crypto/siphash.h"
 #include "hash.h"
 #include "primitives/transaction.h"
 #include "script/script.h"
@@ -220,6 +221,77 @@ bool CBloomFilter::IsRelevantAndUpdate(const CTransaction& tx)
     return false;
 }
 
+// The non-empty data pushes of script, up to its first invalid opcode
+static void GetScriptDataElements(const CScript& script, std::vector<std::vector<unsigned char>>& vDataRet)
+{
+    CScript::const_iterator pc = script.begin();
+    std::vector<unsigned char> data;
+    while (pc < script.end()) {
+        opcodetype opcode;
+        if (!script.GetOp(pc, opcode, data))
+            break;
+        if (data.size() != 0)
+            vDataRet.push_back(data);
+    }
+}
+
+CBloomTxElements::CBloomTxElements(const CTransaction& tx) : hash(tx.GetHash())
+{
+    vout.resize(tx.vout.size());
+    for (unsigned int i = 0; i < tx.vout.size(); i++) {
+        const CScript& scriptPubKey = tx.vout[i].scriptPubKey;
+        GetScriptDataElements(scriptPubKey, vout[i].vData);
+        if (!vout[i].vData.empty()) {
+            txnouttype type;
+            std::vector<std::vector<unsigned char> > vSolutions;
+            vout[i].fPubKeyOrMultisig = Solver(scriptPubKey, type, vSolutions) &&
+                                        (type == TX_PUBKEY || type == TX_MULTISIG);
+        }
+    }
+    vin.resize(tx.vin.size());
+    for (unsigned int i = 0; i < tx.vin.size(); i++) {
+        vin[i].prevout = tx.vin[i].prevout;
+        GetScriptDataElements(tx.vin[i].scriptSig, vin[i].vData);
+    }
+}
+
+bool CBloomFilter::IsRelevantAndUpdate(const CBloomTxElements& tx)
+{
+    // Same matches (and updates) as IsRelevantAndUpdate(const CTransaction&), without parsing the scripts
+    if (isFull)
+        return true;
+    if (isEmpty)
+        return false;
+    bool fFound = contains(tx.hash);
+
+    for (unsigned int i = 0; i < tx.vout.size(); i++) {
+        const CBloomTxElements::Output& out = tx.vout[i];
+        for (const std::vector<unsigned char>& data : out.vData) {
+            if (contains(data)) {
+                fFound = true;
+                if ((nFlags & BLOOM_UPDATE_MASK) == BLOOM_UPDATE_ALL ||
+                    ((nFlags & BLOOM_UPDATE_MASK) == BLOOM_UPDATE_P2PUBKEY_ONLY && out.fPubKeyOrMultisig))
+                    insert(COutPoint(tx.hash, i));
+                break;
+            }
+        }
+    }
+
+    if (fFound)
+        return true;
+
+    for (const CBloomTxElements::Input& in : tx.vin) {
+        if (contains(in.prevout))
+            return true;
+        for (const std::vector<unsigned char>& data : in.vData) {
+            if (contains(data))
+                return true;
+        }
+    }
+
+    return false;
+}
+
 void CBloomFilter::UpdateEmptyFull()
 {
     bool full = true;
@@ -259,9 +331,11 @@ CRollingBloomFilter::CRollingBloomFilter(unsigned int nElements, double fpRate)
     reset();
 }
 
-/* Similar to CBloomFilter::Hash */
-static inline uint32_t RollingBloomHash(unsigned int nHashNum, uint32_t nTweak, const std::vector<unsigned char>& vDataToHash) {
-    return MurmurHash3(nHashNum * 0xFBA4C795 + nTweak, vDataToHash);
+/* The nHashNum-th probe of an item, derived from its 64 bit hash with double hashing: the lower
+ * half of the hash plus nHashNum times the upper half (made odd, so that the first 64 probes of an
+ * item hit 64 distinct bits of their integers). */
+static inline uint32_t RollingBloomProbe(unsigned int nHashNum, uint64_t hash) {
+    return (uint32_t)hash + nHashNum * ((uint32_t)(hash >> 32) | 1);
 }
 
 
@@ -273,6 +347,16 @@ static inline uint32_t FastMod(uint32_t x, size_t n) {
 }
 
 void CRollingBloomFilter::insert(const std::vector<unsigned char>& vKey)
+{
+    insertHash(CSipHasher(nKey0, nKey1).Write(vKey.data(), vKey.size()).Finalize());
+}
+
+void CRollingBloomFilter::insert(const uint256& hash)
+{
+    insertHash(SipHashUint256(nKey0, nKey1, hash));
+}
+
+void CRollingBloomFilter::insertHash(uint64_t hash)
 {
     if (nEntriesThisGeneration == nEntriesPerGeneration) {
         nEntriesThisGeneration = 0;
@@ -293,7 +377,7 @@ void CRollingBloomFilter::insert(const std::vector<unsigned char>& vKey)
     nEntriesThisGeneration++;
 
     for (int n = 0; n < nHashFuncs; n++) {
-        uint32_t h = RollingBloomHash(n, nTweak, vKey);
+        uint32_t h = RollingBloomProbe(n, hash);
         int bit = h & 0x3F;
         /* FastMod works with the upper bits of h, so it is safe to ignore that the lower bits of h are already used for bit. */
         uint32_t pos = FastMod(h, data.size());
@@ -303,19 +387,23 @@ void CRollingBloomFilter::insert(const std::vector<unsigned char>& vKey)
     }
 }
 
-void CRollingBloomFilter::insert(const uint256& hash)
+bool CRollingBloomFilter::contains(const std::vector<unsigned char>& vKey) const
 {
-    std::vector<unsigned char> data(hash.begin(), hash.end());
-    insert(data);
+    return containsHash(CSipHasher(nKey0, nKey1).Write(vKey.data(), vKey.size()).Finalize());
 }
 
-bool CRollingBloomFilter::contains(const std::vector<unsigned char>& vKey) const
+bool CRollingBloomFilter::contains(const uint256& hash) const
+{
+    return containsHash(SipHashUint256(nKey0, nKey1, hash));
+}
+
+bool CRollingBloomFilter::containsHash(uint64_t hash) const
 {
     for (int n = 0; n < nHashFuncs; n++) {
-        uint32_t h = RollingBloomHash(n, nTweak, vKey);
+        uint32_t h = RollingBloomProbe(n, hash);
         int bit = h & 0x3F;
         uint32_t pos = FastMod(h, data.size());
-        /* If the relevant bit is not set in either data[pos & ~1] or data[pos | 1], the filter does not contain vKey */
+        /* If the relevant bit is not set in either data[pos & ~1] or data[pos | 1], the filter does not contain the item */
         if (!(((data[pos & ~1] | data[pos | 1]) >> bit) & 1)) {
             return false;
         }
@@ -323,15 +411,10 @@ bool CRollingBloomFilter::contains(const std::vector<unsigned char>& vKey) const
     return true;
 }
 
-bool CRollingBloomFilter::contains(const uint256& hash) const
-{
-    std::vector<unsigned char> data(hash.begin(), hash.end());
-    return contains(data);
-}
-
 void CRollingBloomFilter::reset()
 {
-    nTweak = GetRand(std::numeric_limits<unsigned int>::max());
+    nKey0 = GetRand(std::numeric_limits<uint64_t>::max());
+    nKey1 = GetRand(std::numeric_limits<uint64_t>::max());
     nEntriesThisGeneration = 0;
     nGeneration = 1;
     for (std::vector<uint64_t>::iterator it = data.begin(); it != data.end(); it++) {
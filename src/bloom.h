@@ -6,14 +6,11 @@
 #ifndef BITCOIN_BLOOM_H
 #define BITCOIN_BLOOM_H
 
+#include "primitives/transaction.h"
 #include "serialize.h"
 
 #include <vector>
 
-class COutPoint;
-class CTransaction;
-class uint256;
-
 //! 20,000 items with fp rate < 0.1% or 10,000 items and <0.0001%
 static const unsigned int MAX_BLOOM_FILTER_SIZE = 36000; // bytes
 static const unsigned int MAX_HASH_FUNCS = 50;
@@ -30,6 +27,32 @@ enum bloomflags {
     BLOOM_UPDATE_MASK = 3,
 };
 
+/**
+ * The elements of a transaction tested by CBloomFilter::IsRelevantAndUpdate, extracted once from its scripts
+ * to match the transaction against the filters of several peers.
+ */
+struct CBloomTxElements
+{
+    struct Output {
+        //! The non-empty data pushes of the scriptPubKey, up to its first invalid opcode
+        std::vector<std::vector<unsigned char>> vData;
+        //! Whether the output pays to a pubkey or to a multisig (for BLOOM_UPDATE_P2PUBKEY_ONLY)
+        bool fPubKeyOrMultisig{false};
+    };
+
+    struct Input {
+        COutPoint prevout;
+        //! The non-empty data pushes of the scriptSig, up to its first invalid opcode
+        std::vector<std::vector<unsigned char>> vData;
+    };
+
+    uint256 hash;
+    std::vector<Output> vout;
+    std::vector<Input> vin;
+
+    explicit CBloomTxElements(const CTransaction& tx);
+};
+
 /**
  * BloomFilter is a probabilistic filter which SPV clients provide
  * so that we can filter the transactions we sends them.
@@ -88,6 +111,8 @@ public:
 
     //! Also adds any outputs which match the filter to the filter (to match their spending txes)
     bool IsRelevantAndUpdate(const CTransaction& tx);
+    //! Same as above, with the elements of the transaction already extracted
+    bool IsRelevantAndUpdate(const CBloomTxElements& tx);
 
     //! Checks for empty and full filters to avoid wasting cpu
     void UpdateEmptyFull();
@@ -96,10 +121,11 @@ public:
 /**
  * RollingBloomFilter is a probabilistic "keep track of most recently inserted" set.
  * Construct it with the number of items to keep track of, and a false-positive
- * rate. Unlike CBloomFilter, by default nTweak is set to a cryptographically
- * secure random value for you. Similarly rather than clear() the method
- * reset() is provided, which also changes nTweak to decrease the impact of
- * false-positives.
+ * rate. Unlike CBloomFilter, the items are hashed once with SipHash, keyed with
+ * a cryptographically secure random value, and all the probe positions are
+ * derived from that hash (double hashing). Similarly rather than clear() the
+ * method reset() is provided, which also changes the key to decrease the
+ * impact of false-positives.
  *
  * contains(item) will always return true if item was one of the last N to 1.5*N
  * insert()'ed ... but may also return true for items that were not inserted.
@@ -123,11 +149,15 @@ public:
     void reset();
 
 private:
+    void insertHash(uint64_t hash);
+    bool containsHash(uint64_t hash) const;
+
     int nEntriesPerGeneration;
     int nEntriesThisGeneration;
     int nGeneration;
     std::vector<uint64_t> data;
-    unsigned int nTweak;
+    uint64_t nKey0;
+    uint64_t nKey1;
     int nHashFuncs;
 };
 
@@ -75,6 +75,19 @@ void CBLSWorker::Stop()
     workerPool.stop(true);
 }
 
+std::future<void> CBLSWorker::AsyncRun(std::function<void()> job)
+{
+    if (workerPool.size() == 0) {
+        std::promise<void> p;
+        job();
+        p.set_value();
+        return p.get_future();
+    }
+    return workerPool.push([job](int threadId) {
+        job();
+    });
+}
+
 bool CBLSWorker::GenerateContributions(int quorumThreshold, const BLSIdVector& ids, BLSVerificationVectorPtr& vvecRet, BLSSecretKeyVector& skShares)
 {
     BLSSecretKeyVectorPtr svec = std::make_shared<BLSSecretKeyVector>((size_t)quorumThreshold);
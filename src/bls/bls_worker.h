@@ -137,6 +137,10 @@ public:
     std::future<bool> AsyncVerifySig(const CBLSSignature& sig, const CBLSPublicKey& pubKey, const uint256& msgHash, CancelCond cancelCond = [] { return false; });
     bool IsAsyncVerifyInProgress();
 
+    // Run a generic (compute intensive) job on the worker pool.
+    // If the worker was not started (e.g. unit tests), the job is executed on the calling thread.
+    std::future<void> AsyncRun(std::function<void()> job);
+
 private:
     void PushSigVerifyBatch();
 };
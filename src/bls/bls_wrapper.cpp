@@ -160,24 +160,20 @@ bool CBLSSecretKey::Recover(const std::vector<CBLSSecretKey>& keys, const std::v
 void CBLSPublicKey::AggregateInsecure(const CBLSPublicKey& o)
 {
     assert(IsValid() && o.IsValid());
-    impl = pScheme->Aggregate({impl, o.impl});
+    impl += o.impl;
     cachedHash.SetNull();
 }
 
-CBLSPublicKey CBLSPublicKey::AggregateInsecure(const std::vector<CBLSPublicKey>& pks)
+CBLSPublicKey CBLSPublicKey::AggregateInsecure(Span<const CBLSPublicKey> pks)
 {
-    if (pks.empty()) {
+    if (pks.size() == 0) {
         return CBLSPublicKey();
     }
 
-    std::vector<bls::G1Element> vecPublicKeys;
-    vecPublicKeys.reserve(pks.size());
-    for (auto& pk : pks) {
-        vecPublicKeys.emplace_back(pk.impl);
-    }
-
     CBLSPublicKey ret;
-    ret.impl = pScheme->Aggregate(vecPublicKeys);
+    for (const auto& pk : pks) {
+        ret.impl += pk.impl;
+    }
     ret.fValid = true;
     ret.cachedHash.SetNull();
     return ret;
@@ -229,24 +225,20 @@ bool CBLSPublicKey::DHKeyExchange(const CBLSSecretKey& sk, const CBLSPublicKey&
 void CBLSSignature::AggregateInsecure(const CBLSSignature& o)
 {
     assert(IsValid() && o.IsValid());
-    impl = pScheme->Aggregate({impl, o.impl});
+    impl += o.impl;
     cachedHash.SetNull();
 }
 
-CBLSSignature CBLSSignature::AggregateInsecure(const std::vector<CBLSSignature>& sigs)
+CBLSSignature CBLSSignature::AggregateInsecure(Span<const CBLSSignature> sigs)
 {
-    if (sigs.empty()) {
+    if (sigs.size() == 0) {
         return CBLSSignature();
     }
 
-    std::vector<bls::G2Element> v;
-    v.reserve(sigs.size());
-    for (auto& pk : sigs) {
-        v.emplace_back(pk.impl);
-    }
-
     CBLSSignature ret;
-    ret.impl = pScheme->Aggregate(v);
+    for (const auto& sig : sigs) {
+        ret.impl += sig.impl;
+    }
     ret.fValid = true;
     ret.cachedHash.SetNull();
     return ret;
@@ -8,6 +8,7 @@
 
 #include "hash.h"
 #include "serialize.h"
+#include "span.h"
 #include "uint256.h"
 #include "utilstrencodings.h"
 
@@ -231,8 +232,9 @@ public:
 
     CBLSPublicKey() {}
 
+    // Aggregations are done in place on the native points (no intermediate vectors or copies)
     void AggregateInsecure(const CBLSPublicKey& o);
-    static CBLSPublicKey AggregateInsecure(const std::vector<CBLSPublicKey>& pks);
+    static CBLSPublicKey AggregateInsecure(Span<const CBLSPublicKey> pks);
 
     bool PublicKeyShare(const std::vector<CBLSPublicKey>& mpk, const CBLSId& id);
     bool DHKeyExchange(const CBLSSecretKey& sk, const CBLSPublicKey& pk);
@@ -252,8 +254,9 @@ public:
     CBLSSignature(const CBLSSignature&) = default;
     CBLSSignature& operator=(const CBLSSignature&) = default;
 
+    // Aggregations are done in place on the native points (no intermediate vectors or copies)
     void AggregateInsecure(const CBLSSignature& o);
-    static CBLSSignature AggregateInsecure(const std::vector<CBLSSignature>& sigs);
+    static CBLSSignature AggregateInsecure(Span<const CBLSSignature> sigs);
     static CBLSSignature AggregateSecure(const std::vector<CBLSSignature>& sigs, const std::vector<CBLSPublicKey>& pks, const uint256& hash);
 
     void SubInsecure(const CBLSSignature& o);
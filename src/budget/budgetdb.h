@@ -7,6 +7,7 @@
 #define BUDGET_DB_H
 
 #include "budget/budgetmanager.h"
+#include "flatdb.h"
 #include "fs.h"
 
 void DumpBudgets(CBudgetManager& budgetman);
@@ -14,23 +15,13 @@ void DumpBudgets(CBudgetManager& budgetman);
 
 /** Save Budget Manager (budget.dat)
  */
-class CBudgetDB
+class CBudgetDB : public CFlatDBBase
 {
 private:
     fs::path pathDB;
     std::string strMagicMessage;
 
 public:
-    enum ReadResult {
-        Ok,
-        FileError,
-        HashReadError,
-        IncorrectHash,
-        IncorrectMagicMessage,
-        IncorrectMagicNumber,
-        IncorrectFormat
-    };
-
     CBudgetDB();
     bool Write(const CBudgetManager& objToSave);
     ReadResult Read(CBudgetManager& objToLoad, bool fDryRun = false);
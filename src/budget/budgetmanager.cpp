@@ -5,12 +5,16 @@
 
 #include "budget/budgetmanager.h"
 
+#include "bls/bls_batchverifier.h"
 #include "consensus/validation.h"
+#include "ctpl_stl.h"
 #include "evo/deterministicmns.h"
 #include "masternodeman.h"
+#include "net_processing.h"
 #include "netmessagemaker.h"
 #include "tiertwo/tiertwo_sync_state.h"
 #include "tiertwo/netfulfilledman.h"
+#include "util/threadnames.h"
 #include "util/validation.h"
 #include "validation.h"   // GetTransaction, cs_main
 
@@ -20,8 +24,6 @@
 
 
 #define BUDGET_ORPHAN_VOTES_CLEANUP_SECONDS (60 * 60) // One hour.
-// Request type used in the net requests manager to block peers asking budget sync too often
-static const std::string BUDGET_SYNC_REQUEST_RECV = "budget-sync-recv";
 
 CBudgetManager g_budgetman;
 
@@ -48,55 +50,61 @@ void CBudgetManager::ReloadMapSeen()
     reloadSeenMap(cs_budgets, cs_finalizedvotes, mapFinalizedBudgets, mapSeenFinalizedBudgetVotes, mapOrphanFinalizedBudgetVotes);
 }
 
+// Add the orphan votes of a new proposal/finalized budget (found in mapBudgets), removing them from mapOrphans
+template<typename T, typename B>
+static void AddOrphanVotes(const uint256& nHash, std::map<uint256, std::pair<std::vector<T>, int64_t>>& mapOrphans,
+                           std::map<uint256, B>& mapBudgets, const char* type)
+{
+    auto itOrphanVotes = mapOrphans.find(nHash);
+    if (itOrphanVotes == mapOrphans.end()) return;
+    auto itBudget = mapBudgets.find(nHash);
+    if (itBudget == mapBudgets.end()) return;
+    // Try to add orphan votes
+    for (const T& vote : itOrphanVotes->second.first) {
+        std::string strError;
+        if (!itBudget->second.AddOrUpdateVote(vote, strError)) {
+            LogPrint(BCLog::MNBUDGET, "Unable to add orphan vote for %s: %s\n", type, strError);
+        }
+    }
+    // Remove entry from the map
+    mapOrphans.erase(itOrphanVotes);
+}
+
 void CBudgetManager::CheckOrphanVotes()
 {
     {
         LOCK2(cs_proposals, cs_votes);
         for (auto itOrphanVotes = mapOrphanProposalVotes.begin(); itOrphanVotes != mapOrphanProposalVotes.end();) {
-            auto itProposal = mapProposals.find(itOrphanVotes->first);
-            if (itProposal != mapProposals.end()) {
-                // Proposal found.
-                CBudgetProposal* bp = &(itProposal->second);
-                // Try to add orphan votes
-                for (const CBudgetVote& vote : itOrphanVotes->second.first) {
-                    std::string strError;
-                    if (!bp->AddOrUpdateVote(vote, strError)) {
-                        LogPrint(BCLog::MNBUDGET, "Unable to add orphan vote for proposal: %s\n", strError);
-                    }
-                }
-                // Remove entry from the map
-                itOrphanVotes = mapOrphanProposalVotes.erase(itOrphanVotes);
-            } else {
-                ++itOrphanVotes;
-            }
+            const uint256 nHash = (itOrphanVotes++)->first;
+            AddOrphanVotes(nHash, mapOrphanProposalVotes, mapProposals, "proposal");
         }
+        InvalidateProposalsOrder();
     }
 
     {
         LOCK2(cs_budgets, cs_finalizedvotes);
         for (auto itOrphanVotes = mapOrphanFinalizedBudgetVotes.begin(); itOrphanVotes != mapOrphanFinalizedBudgetVotes.end();) {
-            auto itFinalBudget = mapFinalizedBudgets.find(itOrphanVotes->first);
-            if (itFinalBudget != mapFinalizedBudgets.end()) {
-                // Finalized budget found.
-                CFinalizedBudget* fb = &(itFinalBudget->second);
-                // Try to add orphan votes
-                for (const CFinalizedBudgetVote& vote : itOrphanVotes->second.first) {
-                    std::string strError;
-                    if (!fb->AddOrUpdateVote(vote, strError)) {
-                        LogPrint(BCLog::MNBUDGET, "Unable to add orphan vote for final budget: %s\n", strError);
-                    }
-                }
-                // Remove entry from the map
-                itOrphanVotes = mapOrphanFinalizedBudgetVotes.erase(itOrphanVotes);
-            } else {
-                ++itOrphanVotes;
-            }
+            const uint256 nHash = (itOrphanVotes++)->first;
+            AddOrphanVotes(nHash, mapOrphanFinalizedBudgetVotes, mapFinalizedBudgets, "final budget");
         }
     }
 
     LogPrint(BCLog::MNBUDGET,"%s: Done\n", __func__);
 }
 
+void CBudgetManager::CheckOrphanProposalVotes(const uint256& nProposalHash)
+{
+    LOCK2(cs_proposals, cs_votes);
+    AddOrphanVotes(nProposalHash, mapOrphanProposalVotes, mapProposals, "proposal");
+    InvalidateProposalsOrder();
+}
+
+void CBudgetManager::CheckOrphanFinalizedBudgetVotes(const uint256& nBudgetHash)
+{
+    LOCK2(cs_budgets, cs_finalizedvotes);
+    AddOrphanVotes(nBudgetHash, mapOrphanFinalizedBudgetVotes, mapFinalizedBudgets, "final budget");
+}
+
 uint256 CBudgetManager::SubmitFinalBudget()
 {
     static int nSubmittedHeight = 0; // height at which final budget was submitted last time
@@ -360,6 +368,7 @@ bool CBudgetManager::AddProposal(CBudgetProposal& budgetProposal)
     {
         LOCK(cs_proposals);
         mapProposals.emplace(nHash, budgetProposal);
+        InvalidateProposalsOrder();
         // Add to feeTx index
         mapFeeTxToProposal.emplace(feeTxId, nHash);
     }
@@ -368,6 +377,42 @@ bool CBudgetManager::AddProposal(CBudgetProposal& budgetProposal)
     return true;
 }
 
+size_t CBudgetManager::DynamicMemoryUsage() const
+{
+    size_t nUsage = 0;
+    {
+        LOCK(cs_proposals);
+        nUsage += memusage::DynamicUsage(mapProposals) + memusage::DynamicUsage(mapFeeTxToProposal) +
+                  memusage::DynamicUsage(vProposalsOrdered);
+        for (const auto& it : mapProposals) {
+            nUsage += memusage::DynamicUsage(it.second.mapVotes);
+        }
+    }
+    {
+        LOCK(cs_budgets);
+        nUsage += memusage::DynamicUsage(mapFinalizedBudgets) + memusage::DynamicUsage(mapFeeTxToBudget) +
+                  memusage::DynamicUsage(mapUnconfirmedFeeTx);
+        for (const auto& it : mapFinalizedBudgets) {
+            nUsage += memusage::DynamicUsage(it.second.mapVotes) + memusage::DynamicUsage(it.second.vecBudgetPayments);
+        }
+    }
+    {
+        LOCK(cs_votes);
+        nUsage += memusage::DynamicUsage(mapSeenProposalVotes) + memusage::DynamicUsage(mapOrphanProposalVotes);
+        for (const auto& it : mapOrphanProposalVotes) {
+            nUsage += memusage::DynamicUsage(it.second.first);
+        }
+    }
+    {
+        LOCK(cs_finalizedvotes);
+        nUsage += memusage::DynamicUsage(mapSeenFinalizedBudgetVotes) + memusage::DynamicUsage(mapOrphanFinalizedBudgetVotes);
+        for (const auto& it : mapOrphanFinalizedBudgetVotes) {
+            nUsage += memusage::DynamicUsage(it.second.first);
+        }
+    }
+    return nUsage;
+}
+
 void CBudgetManager::CheckAndRemove()
 {
     int nCurrentHeight = GetBestHeight();
@@ -394,6 +439,7 @@ void CBudgetManager::CheckAndRemove()
         }
         // Remove invalid entries by overwriting complete map
         mapProposals.swap(tmpMapProposals);
+        InvalidateProposalsOrder();
         LogPrint(BCLog::MNBUDGET, "%s: mapProposals cleanup - size after: %d\n", __func__, mapProposals.size());
     }
 
@@ -442,6 +488,7 @@ void CBudgetManager::RemoveByFeeTxId(const uint256& feeTxId)
                 }
                 // Erase proposal object
                 mapProposals.erase(it->second);
+                InvalidateProposalsOrder();
             }
             // Remove from collateral index
             mapFeeTxToProposal.erase(it);
@@ -747,16 +794,31 @@ TrxValidationStatus CBudgetManager::IsTransactionValid(const CTransaction& txNew
     return fThreshold ? TrxValidationStatus::InValid : TrxValidationStatus::VoteThreshold;
 }
 
+void CBudgetManager::InvalidateProposalsOrder()
+{
+    AssertLockHeld(cs_proposals);
+    fProposalsOrderValid = false;
+}
+
 std::vector<CBudgetProposal*> CBudgetManager::GetAllProposalsOrdered()
 {
     LOCK(cs_proposals);
+    // Reordered after a change of the proposals/votes, or a new block (stale votes)
+    const int nHeight = GetBestHeight();
+    if (fProposalsOrderValid && nHeight == nProposalsOrderHeight) {
+        return vProposalsOrdered;
+    }
     std::vector<CBudgetProposal*> vBudgetProposalRet;
+    vBudgetProposalRet.reserve(mapProposals.size());
     for (auto& it: mapProposals) {
         CBudgetProposal* pbudgetProposal = &(it.second);
         RemoveStaleVotesOnProposal(pbudgetProposal);
         vBudgetProposalRet.push_back(pbudgetProposal);
     }
     std::sort(vBudgetProposalRet.begin(), vBudgetProposalRet.end(), CBudgetProposal::PtrHigherYes);
+    vProposalsOrdered = vBudgetProposalRet;
+    nProposalsOrderHeight = nHeight;
+    fProposalsOrderValid = true;
     return vBudgetProposalRet;
 }
 
@@ -887,9 +949,9 @@ void CBudgetManager::RemoveStaleVotesOnProposal(CBudgetProposal* prop)
     LogPrint(BCLog::MNBUDGET, "Cleaning proposal votes for %s. Before: YES=%d, NO=%d\n",
             prop->GetName(), prop->GetYeas(), prop->GetNays());
 
+    auto mnList = deterministicMNManager->GetListAtChainTip();
     auto it = prop->mapVotes.begin();
     while (it != prop->mapVotes.end()) {
-        auto mnList = deterministicMNManager->GetListAtChainTip();
         auto dmn = mnList.GetMNByCollateral(it->first);
         if (dmn) {
             (*it).second.SetValid(!dmn->IsPoSeBanned());
@@ -900,6 +962,8 @@ void CBudgetManager::RemoveStaleVotesOnProposal(CBudgetProposal* prop)
         }
         ++it;
     }
+    prop->RecountVotes();
+    InvalidateProposalsOrder();
 
     LogPrint(BCLog::MNBUDGET, "Cleaned proposal votes for %s. After: YES=%d, NO=%d\n",
             prop->GetName(), prop->GetYeas(), prop->GetNays());
@@ -911,9 +975,9 @@ void CBudgetManager::RemoveStaleVotesOnFinalBudget(CFinalizedBudget* fbud)
     LogPrint(BCLog::MNBUDGET, "Cleaning finalized budget votes for [%s (%s)]. Before: %d\n",
             fbud->GetName(), fbud->GetProposalsStr(), fbud->GetVoteCount());
 
+    auto mnList = deterministicMNManager->GetListAtChainTip();
     auto it = fbud->mapVotes.begin();
     while (it != fbud->mapVotes.end()) {
-        auto mnList = deterministicMNManager->GetListAtChainTip();
         auto dmn = mnList.GetMNByCollateral(it->first);
         if (dmn) {
             (*it).second.SetValid(!dmn->IsPoSeBanned());
@@ -924,6 +988,7 @@ void CBudgetManager::RemoveStaleVotesOnFinalBudget(CFinalizedBudget* fbud)
         }
         ++it;
     }
+    fbud->RecountVotes();
     LogPrint(BCLog::MNBUDGET, "Cleaned finalized budget votes for [%s (%s)]. After: %d\n",
             fbud->GetName(), fbud->GetProposalsStr(), fbud->GetVoteCount());
 }
@@ -1050,7 +1115,7 @@ int CBudgetManager::ProcessBudgetVoteSync(const uint256& nProp, CNode* pfrom)
     if (nProp.IsNull()) {
         LOCK2(cs_budgets, cs_proposals);
         if (!(pfrom->addr.IsRFC1918() || pfrom->addr.IsLocal())) {
-            if (g_netfulfilledman.HasFulfilledRequest(pfrom->addr, BUDGET_SYNC_REQUEST_RECV)) {
+            if (g_netfulfilledman.HasFulfilledRequest(pfrom->addr, NetRequest::BUDGET_SYNC_RECV)) {
                 LogPrint(BCLog::MASTERNODE, "budgetsync - peer %i already asked for budget sync\n", pfrom->GetId());
                 // let's not be so hard with the node for now.
                 return 10;
@@ -1082,11 +1147,27 @@ int CBudgetManager::ProcessProposal(CBudgetProposal& proposal)
 
     LogPrint(BCLog::MNBUDGET, "mprop (new) %s\n", nHash.ToString());
     //We might have active votes for this proposal that are valid now
-    CheckOrphanVotes();
+    CheckOrphanProposalVotes(nHash);
     return 0;
 }
 
 bool CBudgetManager::ProcessProposalVote(CBudgetVote& vote, CNode* pfrom, CValidationState& state)
+{
+    VoteSigner signer;
+    if (!CheckProposalVote(vote, pfrom, state, signer)) {
+        return false;
+    }
+    // Verified later, in a batch with the other votes received
+    if (pfrom && QueueVoteVerification(vote, pfrom, signer)) {
+        return true;
+    }
+    if (!CheckProposalVoteSignature(vote, signer, state)) {
+        return false;
+    }
+    return AcceptProposalVote(vote, pfrom, signer, state);
+}
+
+bool CBudgetManager::CheckProposalVote(CBudgetVote& vote, CNode* pfrom, CValidationState& state, VoteSigner& signerRet)
 {
     const uint256& voteID = vote.GetHash();
 
@@ -1117,21 +1198,9 @@ bool CBudgetManager::ProcessProposalVote(CBudgetVote& vote, CNode* pfrom, CValid
 
         AddSeenProposalVote(vote);
 
-        if (!vote.CheckSignature(dmn->pdmnState->keyIDVoting)) {
-            err = strprintf("invalid mvote sig from dmn: %s", mn_protx_id);
-            return state.DoS(100, false, REJECT_INVALID, "bad-mvote-sig", false, err);
-        }
-
-        if (!UpdateProposal(vote, pfrom, err)) {
-            return state.DoS(0, false, REJECT_INVALID, "bad-mvote", false, strprintf("%s (%s)", err, mn_protx_id));
-        }
-
-        // Relay only if we are synchronized
-        // Makes no sense to relay votes to the peers from where we are syncing them.
-        if (g_tiertwo_sync_state.IsSynced()) vote.Relay();
-        g_tiertwo_sync_state.AddedBudgetItem(voteID);
-        LogPrint(BCLog::MNBUDGET, "mvote - new vote (%s) for proposal %s from dmn %s\n",
-                voteID.ToString(), vote.GetProposalHash().ToString(), mn_protx_id);
+        signerRet.fDeterministic = true;
+        signerRet.keyID = dmn->pdmnState->keyIDVoting;
+        signerRet.strName = mn_protx_id;
         return true;
     }
 
@@ -1151,24 +1220,39 @@ bool CBudgetManager::ProcessProposalVote(CBudgetVote& vote, CNode* pfrom, CValid
 
     AddSeenProposalVote(vote);
 
-    if (!vote.CheckSignature(pmn->pubKeyMasternode.GetID())) {
-        if (g_tiertwo_sync_state.IsSynced()) {
-            err = strprintf("signature from masternode %s invalid", voteVin.prevout.ToString());
-            return state.DoS(20, false, REJECT_INVALID, "bad-mvote-sig", false, err);
-        }
-        return false;
+    signerRet.fDeterministic = false;
+    signerRet.keyID = pmn->pubKeyMasternode.GetID();
+    signerRet.strName = voteVin.prevout.ToString();
+    return true;
+}
+
+bool CBudgetManager::CheckProposalVoteSignature(const CBudgetVote& vote, const VoteSigner& signer, CValidationState& state) const
+{
+    if (vote.CheckSignature(signer.keyID)) {
+        return true;
+    }
+    if (signer.fDeterministic) {
+        return state.DoS(100, false, REJECT_INVALID, "bad-mvote-sig", false, strprintf("invalid mvote sig from dmn: %s", signer.strName));
     }
+    if (g_tiertwo_sync_state.IsSynced()) {
+        return state.DoS(20, false, REJECT_INVALID, "bad-mvote-sig", false, strprintf("signature from masternode %s invalid", signer.strName));
+    }
+    return false;
+}
 
+bool CBudgetManager::AcceptProposalVote(CBudgetVote& vote, CNode* pfrom, const VoteSigner& signer, CValidationState& state)
+{
+    std::string err;
     if (!UpdateProposal(vote, pfrom, err)) {
-        return state.DoS(0, false, REJECT_INVALID, "bad-mvote", false, err);
+        return state.DoS(0, false, REJECT_INVALID, "bad-mvote", false, strprintf("%s (%s)", err, signer.strName));
     }
 
     // Relay only if we are synchronized
     // Makes no sense to relay votes to the peers from where we are syncing them.
     if (g_tiertwo_sync_state.IsSynced()) vote.Relay();
-    g_tiertwo_sync_state.AddedBudgetItem(voteID);
-    LogPrint(BCLog::MNBUDGET, "mvote - new vote (%s) for proposal %s from dmn %s\n",
-            voteID.ToString(), vote.GetProposalHash().ToString(), voteVin.prevout.ToString());
+    g_tiertwo_sync_state.AddedBudgetItem(vote.GetHash());
+    LogPrint(BCLog::MNBUDGET, "mvote - new vote (%s) for proposal %s from %s %s\n",
+            vote.GetHash().ToString(), vote.GetProposalHash().ToString(), (signer.fDeterministic ? "dmn" : "mn"), signer.strName);
     return true;
 }
 
@@ -1191,11 +1275,27 @@ int CBudgetManager::ProcessFinalizedBudget(CFinalizedBudget& finalbudget, CNode*
 
     LogPrint(BCLog::MNBUDGET, "fbs (new) %s\n", nHash.ToString());
     //we might have active votes for this budget that are now valid
-    CheckOrphanVotes();
+    CheckOrphanFinalizedBudgetVotes(nHash);
     return 0;
 }
 
 bool CBudgetManager::ProcessFinalizedBudgetVote(CFinalizedBudgetVote& vote, CNode* pfrom, CValidationState& state)
+{
+    VoteSigner signer;
+    if (!CheckFinalizedBudgetVote(vote, pfrom, state, signer)) {
+        return false;
+    }
+    // Verified later, in a batch with the other votes received
+    if (pfrom && QueueVoteVerification(vote, pfrom, signer)) {
+        return true;
+    }
+    if (!CheckFinalizedBudgetVoteSignature(vote, signer, state)) {
+        return false;
+    }
+    return AcceptFinalizedBudgetVote(vote, pfrom, signer, state);
+}
+
+bool CBudgetManager::CheckFinalizedBudgetVote(CFinalizedBudgetVote& vote, CNode* pfrom, CValidationState& state, VoteSigner& signerRet)
 {
     const uint256& voteID = vote.GetHash();
 
@@ -1226,21 +1326,9 @@ bool CBudgetManager::ProcessFinalizedBudgetVote(CFinalizedBudgetVote& vote, CNod
 
         AddSeenFinalizedBudgetVote(vote);
 
-        if (!vote.CheckSignature(dmn->pdmnState->pubKeyOperator.Get())) {
-            err = strprintf("invalid fbvote sig from dmn: %s", mn_protx_id);
-            return state.DoS(100, false, REJECT_INVALID, "bad-fbvote-sig", false, err);
-        }
-
-        if (!UpdateFinalizedBudget(vote, pfrom, err)) {
-            return state.DoS(0, false, REJECT_INVALID, "bad-fbvote", false, strprintf("%s (%s)", err, mn_protx_id));
-        }
-
-        // Relay only if we are synchronized
-        // Makes no sense to relay votes to the peers from where we are syncing them.
-        if (g_tiertwo_sync_state.IsSynced()) vote.Relay();
-        g_tiertwo_sync_state.AddedBudgetItem(voteID);
-        LogPrint(BCLog::MNBUDGET, "fbvote - new vote (%s) for budget %s from dmn %s\n",
-                voteID.ToString(), vote.GetBudgetHash().ToString(), mn_protx_id);
+        signerRet.fDeterministic = true;
+        signerRet.pubKey = dmn->pdmnState->pubKeyOperator.Get();
+        signerRet.strName = mn_protx_id;
         return true;
     }
 
@@ -1259,27 +1347,271 @@ bool CBudgetManager::ProcessFinalizedBudgetVote(CFinalizedBudgetVote& vote, CNod
 
     AddSeenFinalizedBudgetVote(vote);
 
-    if (!vote.CheckSignature(pmn->pubKeyMasternode.GetID())) {
-        if (g_tiertwo_sync_state.IsSynced()) {
-            err = strprintf("signature from masternode %s invalid", voteVin.prevout.ToString());
-            return state.DoS(20, false, REJECT_INVALID, "bad-fbvote-sig", false, err);
-        }
-        return false;
+    signerRet.fDeterministic = false;
+    signerRet.keyID = pmn->pubKeyMasternode.GetID();
+    signerRet.strName = voteVin.prevout.ToString();
+    return true;
+}
+
+bool CBudgetManager::CheckFinalizedBudgetVoteSignature(const CFinalizedBudgetVote& vote, const VoteSigner& signer, CValidationState& state) const
+{
+    if (signer.fDeterministic ? vote.CheckSignature(signer.pubKey) : vote.CheckSignature(signer.keyID)) {
+        return true;
+    }
+    if (signer.fDeterministic) {
+        return state.DoS(100, false, REJECT_INVALID, "bad-fbvote-sig", false, strprintf("invalid fbvote sig from dmn: %s", signer.strName));
     }
+    if (g_tiertwo_sync_state.IsSynced()) {
+        return state.DoS(20, false, REJECT_INVALID, "bad-fbvote-sig", false, strprintf("signature from masternode %s invalid", signer.strName));
+    }
+    return false;
+}
 
+bool CBudgetManager::AcceptFinalizedBudgetVote(CFinalizedBudgetVote& vote, CNode* pfrom, const VoteSigner& signer, CValidationState& state)
+{
+    std::string err;
     if (!UpdateFinalizedBudget(vote, pfrom, err)) {
-        return state.DoS(0, false, REJECT_INVALID, "bad-fbvote", false, err);
+        return state.DoS(0, false, REJECT_INVALID, "bad-fbvote", false, strprintf("%s (%s)", err, signer.strName));
     }
 
     // Relay only if we are synchronized
     // Makes no sense to relay votes to the peers from where we are syncing them.
     if (g_tiertwo_sync_state.IsSynced()) vote.Relay();
-    g_tiertwo_sync_state.AddedBudgetItem(voteID);
-    LogPrint(BCLog::MNBUDGET, "fbvote - new vote (%s) for budget %s from mn %s\n",
-            voteID.ToString(), vote.GetBudgetHash().ToString(), voteVin.prevout.ToString());
+    g_tiertwo_sync_state.AddedBudgetItem(vote.GetHash());
+    LogPrint(BCLog::MNBUDGET, "fbvote - new vote (%s) for budget %s from %s %s\n",
+            vote.GetHash().ToString(), vote.GetBudgetHash().ToString(), (signer.fDeterministic ? "dmn" : "mn"), signer.strName);
+    return true;
+}
+
+//! Maximum number of budget votes waiting for the verification of their signature
+static const size_t MAX_PENDING_BUDGET_VOTES = 50000;
+//! Maximum number of budget votes verified together
+static const size_t MAX_BUDGET_VOTES_VERIFY_BATCH = 1000;
+
+/**
+ * Verifies the signatures of the budget votes received from the peers, in batches, out of the message
+ * processing threads, so that the vote storms of the superblocks don't hold the other messages.
+ * The ECDSA signatures (proposal votes, and finalized budget votes of the legacy masternodes) are spread
+ * over a pool of threads, while the BLS signatures (finalized budget votes of the deterministic
+ * masternodes) are verified together with a CBLSBatchVerifier. The valid votes are then accepted in the
+ * order they were received.
+ */
+class CBudgetVotesVerifier
+{
+public:
+    struct PendingVote
+    {
+        bool fFinalized;
+        CBudgetVote propVote;
+        CFinalizedBudgetVote budVote;
+        CBudgetManager::VoteSigner signer;
+        // referenced while the vote is pending
+        CNode* pnode;
+    };
+
+private:
+    Mutex cs;
+    std::condition_variable cvPending;
+    std::condition_variable cvIdle;
+    std::deque<PendingVote> pendingVotes GUARDED_BY(cs);
+    // Set while a batch taken from pendingVotes is processed
+    bool fVerifying GUARDED_BY(cs){false};
+    bool fStopped GUARDED_BY(cs){false};
+
+    ctpl::thread_pool workerPool;
+    std::thread verifyThread;
+
+    void ThreadVerifyVotes();
+    void VerifyBatch(const std::vector<PendingVote>& batch, std::vector<char>& vValid);
+    void AcceptVote(PendingVote& vote, bool fValidSig);
+
+public:
+    explicit CBudgetVotesVerifier(int nThreads)
+    {
+        // The verification thread checks the BLS signatures, the pool the ECDSA ones
+        workerPool.resize(std::max(1, nThreads - 1));
+        RenameThreadPool(workerPool, "pivx-bvote-verify");
+        verifyThread = std::thread(&TraceThread<std::function<void()>>, "bvoteverify", std::function<void()>(std::bind(&CBudgetVotesVerifier::ThreadVerifyVotes, this)));
+    }
+    ~CBudgetVotesVerifier() { Stop(); }
+
+    // Take the vote, or return false if it can't be queued (stopped or full)
+    bool Push(PendingVote&& vote);
+    // Wait until the queued votes are processed (or the verification stopped)
+    void WaitForIdle();
+    void Stop();
+};
+
+bool CBudgetVotesVerifier::Push(PendingVote&& vote)
+{
+    {
+        LOCK(cs);
+        if (fStopped) return false;
+        // Full: verified in place, slowing down the peers sending them
+        if (pendingVotes.size() >= MAX_PENDING_BUDGET_VOTES) return false;
+        vote.pnode->AddRef();
+        pendingVotes.emplace_back(std::move(vote));
+    }
+    cvPending.notify_one();
     return true;
 }
 
+void CBudgetVotesVerifier::WaitForIdle()
+{
+    WAIT_LOCK(cs, lock);
+    cvIdle.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(cs) { return fStopped || (pendingVotes.empty() && !fVerifying); });
+}
+
+void CBudgetVotesVerifier::Stop()
+{
+    {
+        LOCK(cs);
+        if (fStopped) return;
+        fStopped = true;
+    }
+    cvPending.notify_all();
+    cvIdle.notify_all();
+    if (verifyThread.joinable()) verifyThread.join();
+    workerPool.stop(true);
+
+    // Release the nodes of the votes not verified
+    LOCK(cs);
+    for (PendingVote& vote : pendingVotes) {
+        vote.pnode->Release();
+    }
+    pendingVotes.clear();
+}
+
+void CBudgetVotesVerifier::VerifyBatch(const std::vector<PendingVote>& batch, std::vector<char>& vValid)
+{
+    // ECDSA, in chunks over the worker pool
+    std::vector<size_t> vECDSA;
+    for (size_t i = 0; i < batch.size(); i++) {
+        if (!batch[i].signer.pubKey.IsValid()) vECDSA.emplace_back(i);
+    }
+    const size_t nChunks = std::min(vECDSA.size(), (size_t)workerPool.size());
+    std::vector<std::future<void>> vFutures;
+    for (size_t c = 0; c < nChunks; c++) {
+        vFutures.emplace_back(workerPool.push([&, c](int threadId) {
+            for (size_t j = c; j < vECDSA.size(); j += nChunks) {
+                const PendingVote& vote = batch[vECDSA[j]];
+                vValid[vECDSA[j]] = vote.fFinalized ? vote.budVote.CheckSignature(vote.signer.keyID)
+                                                    : vote.propVote.CheckSignature(vote.signer.keyID);
+            }
+        }));
+    }
+
+    // BLS, batched on this thread meanwhile. Secure aggregation, as the operator keys are not
+    // proven, with a fallback on each vote of the peers sending invalid signatures.
+    CBLSBatchVerifier<NodeId, size_t> blsVerifier(true, true);
+    for (size_t i = 0; i < batch.size(); i++) {
+        const PendingVote& vote = batch[i];
+        if (!vote.signer.pubKey.IsValid()) continue;
+        CBLSSignature sig(vote.budVote.GetVchSig());
+        if (vote.budVote.nMessVersion != MessageVersion::MESS_VER_HASH || !sig.IsValid()) {
+            vValid[i] = false;
+            continue;
+        }
+        blsVerifier.PushMessage(vote.pnode->GetId(), i, vote.budVote.GetSignatureHash(), sig, vote.signer.pubKey);
+        vValid[i] = true;
+    }
+    blsVerifier.Verify();
+    for (size_t i : blsVerifier.badMessages) {
+        vValid[i] = false;
+    }
+
+    for (auto& f : vFutures) {
+        f.get();
+    }
+}
+
+void CBudgetVotesVerifier::AcceptVote(PendingVote& vote, bool fValidSig)
+{
+    CValidationState state;
+    if (vote.fFinalized) {
+        // Invalid signature: checked again, to get the rejection reason
+        if (fValidSig || g_budgetman.CheckFinalizedBudgetVoteSignature(vote.budVote, vote.signer, state)) {
+            g_budgetman.AcceptFinalizedBudgetVote(vote.budVote, vote.pnode, vote.signer, state);
+        }
+    } else {
+        if (fValidSig || g_budgetman.CheckProposalVoteSignature(vote.propVote, vote.signer, state)) {
+            g_budgetman.AcceptProposalVote(vote.propVote, vote.pnode, vote.signer, state);
+        }
+    }
+    int nDos = 0;
+    if (state.IsInvalid(nDos)) {
+        LogPrint(BCLog::MNBUDGET, "%s: %s\n", __func__, FormatStateMessage(state));
+        if (nDos > 0) {
+            LOCK(cs_main);
+            Misbehaving(vote.pnode->GetId(), nDos);
+        }
+    }
+}
+
+void CBudgetVotesVerifier::ThreadVerifyVotes()
+{
+    while (true) {
+        std::vector<PendingVote> batch;
+        {
+            WAIT_LOCK(cs, lock);
+            cvPending.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(cs) { return fStopped || !pendingVotes.empty(); });
+            if (fStopped) return;
+            const size_t nSize = std::min(pendingVotes.size(), MAX_BUDGET_VOTES_VERIFY_BATCH);
+            batch.reserve(nSize);
+            for (size_t i = 0; i < nSize; i++) {
+                batch.emplace_back(std::move(pendingVotes.front()));
+                pendingVotes.pop_front();
+            }
+            fVerifying = true;
+        }
+
+        std::vector<char> vValid(batch.size(), false);
+        VerifyBatch(batch, vValid);
+
+        for (size_t i = 0; i < batch.size(); i++) {
+            AcceptVote(batch[i], vValid[i]);
+            batch[i].pnode->Release();
+        }
+
+        WITH_LOCK(cs, fVerifying = false);
+        cvIdle.notify_all();
+    }
+}
+
+// Set while the budget votes are verified in batches
+static std::unique_ptr<CBudgetVotesVerifier> budgetVotesVerifier;
+
+void StartBudgetVotesVerification(int nThreads)
+{
+    assert(!budgetVotesVerifier);
+    if (nThreads > 0) {
+        budgetVotesVerifier = std::make_unique<CBudgetVotesVerifier>(nThreads);
+    }
+}
+
+void StopBudgetVotesVerification()
+{
+    // Only stopped: the message threads could still be processing votes. They are verified in place from now on.
+    if (budgetVotesVerifier) budgetVotesVerifier->Stop();
+}
+
+void SyncWithBudgetVotesVerification()
+{
+    if (budgetVotesVerifier) budgetVotesVerifier->WaitForIdle();
+}
+
+bool CBudgetManager::QueueVoteVerification(const CBudgetVote& vote, CNode* pfrom, const VoteSigner& signer)
+{
+    if (!budgetVotesVerifier) return false;
+    return budgetVotesVerifier->Push({false, vote, CFinalizedBudgetVote(), signer, pfrom});
+}
+
+bool CBudgetManager::QueueVoteVerification(const CFinalizedBudgetVote& vote, CNode* pfrom, const VoteSigner& signer)
+{
+    if (!budgetVotesVerifier) return false;
+    return budgetVotesVerifier->Push({true, CBudgetVote(), vote, signer, pfrom});
+}
+
 bool CBudgetManager::ProcessMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv, int& banScore)
 {
     banScore = ProcessMessageInner(pfrom, strCommand, vRecv);
@@ -1457,7 +1789,7 @@ void CBudgetManager::Sync(CNode* pfrom, bool fPartial)
     if (!fPartial) {
         // We are not going to answer full budget sync requests for an hour (chainparams.FulfilledRequestExpireTime()).
         // The remote peer can still do single prop and mnv sync requests if needed.
-        g_netfulfilledman.AddFulfilledRequest(pfrom->addr, BUDGET_SYNC_REQUEST_RECV);
+        g_netfulfilledman.AddFulfilledRequest(pfrom->addr, NetRequest::BUDGET_SYNC_RECV);
     }
 }
 
@@ -1517,7 +1849,11 @@ bool CBudgetManager::UpdateProposal(const CBudgetVote& vote, CNode* pfrom, std::
     }
 
     // Add or update vote
-    return itProposal->second.AddOrUpdateVote(vote, strError);
+    if (!itProposal->second.AddOrUpdateVote(vote, strError)) {
+        return false;
+    }
+    InvalidateProposalsOrder();
+    return true;
 }
 
 bool CBudgetManager::UpdateFinalizedBudget(const CFinalizedBudgetVote& vote, CNode* pfrom, std::string& strError)
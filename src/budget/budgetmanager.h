@@ -6,6 +6,7 @@
 #ifndef BUDGET_MANAGER_H
 #define BUDGET_MANAGER_H
 
+#include "bls/bls_wrapper.h"
 #include "budget/budgetproposal.h"
 #include "budget/finalizedbudget.h"
 #include "validationinterface.h"
@@ -14,6 +15,17 @@ class CValidationState;
 
 #define ORPHAN_VOTES_CACHE_LIMIT 10000
 
+//! Default for -budgetvoteverifythreads
+static const int DEFAULT_BUDGET_VOTE_VERIFY_THREADS = 2;
+//! Maximum number of threads verifying the budget votes signatures
+static const int MAX_BUDGET_VOTE_VERIFY_THREADS = 16;
+
+/** Verify the signatures of the budget votes received from the peers in batches, on nThreads threads */
+void StartBudgetVotesVerification(int nThreads);
+void StopBudgetVotesVerification();
+/** Wait until the budget votes queued for the verification are verified and processed */
+void SyncWithBudgetVotesVerification();
+
 //
 // Budget Manager : Contains all proposals for the budget
 //
@@ -42,6 +54,13 @@ protected:
     // Memory Only. Updated in NewBlock (blocks arrive in order)
     std::atomic<int> nBestHeight;
 
+    // Memory Only. The proposals ordered by net yes votes (GetAllProposalsOrdered), for the height
+    // nProposalsOrderHeight. Invalidated when the proposals or their votes change.
+    std::vector<CBudgetProposal*> vProposalsOrdered;                        // guarded by cs_proposals
+    int nProposalsOrderHeight{0};                                           // guarded by cs_proposals
+    bool fProposalsOrderValid{false};                                       // guarded by cs_proposals
+    void InvalidateProposalsOrder();
+
     struct HighestFinBudget {
         const CFinalizedBudget* m_budget_fin{nullptr};
         int m_vote_count{0};
@@ -56,6 +75,22 @@ protected:
     void SetSynced(bool synced);
 
 public:
+    // The signer of a vote, found when checking it
+    struct VoteSigner {
+        bool fDeterministic{false};
+        // key of the legacy masternodes, or voting key of the deterministic ones (proposal votes)
+        CKeyID keyID;
+        // operator key of the deterministic masternodes (finalized budget votes)
+        CBLSPublicKey pubKey;
+        // proTxHash of the deterministic masternodes, collateral of the legacy ones
+        std::string strName;
+    };
+
+    // Queue the vote, checked except for its signature, for the batched verification of its signature.
+    // Return false if it must be verified in place.
+    bool QueueVoteVerification(const CBudgetVote& vote, CNode* pfrom, const VoteSigner& signer);
+    bool QueueVoteVerification(const CFinalizedBudgetVote& vote, CNode* pfrom, const VoteSigner& signer);
+
     // critical sections to protect the inner data structures (must be locked in this order)
     mutable RecursiveMutex cs_budgets;
     mutable RecursiveMutex cs_proposals;
@@ -118,6 +153,15 @@ public:
     bool ProcessProposalVote(CBudgetVote& proposal, CNode* pfrom, CValidationState& state);
     bool ProcessFinalizedBudgetVote(CFinalizedBudgetVote& vote, CNode* pfrom, CValidationState& state);
 
+    // The steps of the vote processing: checks (except for the signature, returning the signer),
+    // signature verification, and update of the voted proposal / finalized budget.
+    bool CheckProposalVote(CBudgetVote& vote, CNode* pfrom, CValidationState& state, VoteSigner& signerRet);
+    bool CheckProposalVoteSignature(const CBudgetVote& vote, const VoteSigner& signer, CValidationState& state) const;
+    bool AcceptProposalVote(CBudgetVote& vote, CNode* pfrom, const VoteSigner& signer, CValidationState& state);
+    bool CheckFinalizedBudgetVote(CFinalizedBudgetVote& vote, CNode* pfrom, CValidationState& state, VoteSigner& signerRet);
+    bool CheckFinalizedBudgetVoteSignature(const CFinalizedBudgetVote& vote, const VoteSigner& signer, CValidationState& state) const;
+    bool AcceptFinalizedBudgetVote(CFinalizedBudgetVote& vote, CNode* pfrom, const VoteSigner& signer, CValidationState& state);
+
     // functions returning a pointer in the map. Need cs_proposals/cs_budgets locked from the caller
     CBudgetProposal* FindProposal(const uint256& nHash);
     CFinalizedBudget* FindFinalizedBudget(const uint256& nHash);
@@ -155,12 +199,16 @@ public:
     int CountProposals() { LOCK(cs_proposals); return mapProposals.size(); }
 
     void CheckOrphanVotes();
+    // Add the orphan votes of a new proposal / finalized budget (only looking up its own votes)
+    void CheckOrphanProposalVotes(const uint256& nProposalHash);
+    void CheckOrphanFinalizedBudgetVotes(const uint256& nBudgetHash);
     void Clear()
     {
         {
             LOCK(cs_proposals);
             mapProposals.clear();
             mapFeeTxToProposal.clear();
+            InvalidateProposalsOrder();
         }
         {
             LOCK(cs_budgets);
@@ -182,6 +230,8 @@ public:
     }
     void CheckAndRemove();
     std::string ToString() const;
+    // Estimated memory usage of the proposals and budgets (with their votes), and of the seen and orphan votes
+    size_t DynamicMemoryUsage() const;
 
     // Remove proposal/budget by FeeTx (called when a block is disconnected)
     void RemoveByFeeTxId(const uint256& feeTxId);
@@ -191,6 +241,7 @@ public:
         {
             LOCK(obj.cs_proposals);
             READWRITE(obj.mapProposals, obj.mapFeeTxToProposal);
+            SER_READ(obj, obj.InvalidateProposalsOrder());
         }
         {
             LOCK(obj.cs_votes);
@@ -8,6 +8,8 @@
 #include "script/standard.h"
 #include "utilstrencodings.h"
 
+#include <algorithm>
+
 CBudgetProposal::CBudgetProposal():
         nAllotted(0),
         fValid(true),
@@ -244,12 +246,35 @@ bool CBudgetProposal::AddOrUpdateVote(const CBudgetVote& vote, std::string& strE
         strAction = "Existing vote updated:";
     }
 
-    mapVotes[mnId] = vote;
+    auto it = mapVotes.find(mnId);
+    if (it != mapVotes.end()) {
+        CountVote(it->second, -1);
+        it->second = vote;
+    } else {
+        it = mapVotes.emplace(mnId, vote).first;
+    }
+    CountVote(it->second, 1);
     LogPrint(BCLog::MNBUDGET, "%s: %s %s\n", __func__, strAction.c_str(), vote.GetHash().ToString().c_str());
 
     return true;
 }
 
+void CBudgetProposal::CountVote(const CBudgetVote& vote, int nDelta)
+{
+    const uint32_t vd = vote.GetDirection();
+    if (vote.IsValid() && vd <= CBudgetVote::VOTE_NO) {
+        nVoteCounts[vd] += nDelta;
+    }
+}
+
+void CBudgetProposal::RecountVotes()
+{
+    std::fill(std::begin(nVoteCounts), std::end(nVoteCounts), 0);
+    for (const auto& it : mapVotes) {
+        CountVote(it.second, 1);
+    }
+}
+
 UniValue CBudgetProposal::GetVotesArray() const
 {
     UniValue ret(UniValue::VARR);
@@ -283,13 +308,7 @@ double CBudgetProposal::GetRatio() const
 
 int CBudgetProposal::GetVoteCount(CBudgetVote::VoteDirection vd) const
 {
-    int ret = 0;
-    for (const auto& it : mapVotes) {
-        const CBudgetVote& vote = it.second;
-        if (vote.GetDirection() == vd && vote.IsValid())
-            ret++;
-    }
-    return ret;
+    return vd <= CBudgetVote::VOTE_NO ? nVoteCounts[vd] : 0;
 }
 
 int CBudgetProposal::GetBlockStartCycle() const
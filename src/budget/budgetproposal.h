@@ -36,6 +36,12 @@ private:
     bool fValid;
     std::string strInvalid;
 
+    // Memory only. Count of the valid votes for each direction, updated with mapVotes
+    int nVoteCounts[CBudgetVote::VOTE_NO + 1]{0};
+    void CountVote(const CBudgetVote& vote, int nDelta);
+    // Recompute nVoteCounts (after a change of the validity of the votes)
+    void RecountVotes();
+
     // Functions used inside UpdateValid()/IsWellFormed - setting strInvalid
     bool IsHeavilyDownvoted(int mnCount);
     bool updateExpired(int nCurrentHeight);
@@ -127,6 +133,7 @@ public:
         READWRITE(obj.nFeeTXHash);
         READWRITE(obj.nTime);
         READWRITE(obj.mapVotes);
+        SER_READ(obj, obj.RecountVotes());
     }
 
     // Serialization for network messages.
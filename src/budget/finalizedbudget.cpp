@@ -73,11 +73,26 @@ bool CFinalizedBudget::AddOrUpdateVote(const CFinalizedBudgetVote& vote, std::st
         strAction = "Existing vote updated:";
     }
 
-    mapVotes[mnId] = vote;
+    auto it = mapVotes.find(mnId);
+    if (it != mapVotes.end()) {
+        if (it->second.IsValid()) nValidVotes--;
+        it->second = vote;
+    } else {
+        it = mapVotes.emplace(mnId, vote).first;
+    }
+    if (it->second.IsValid()) nValidVotes++;
     LogPrint(BCLog::MNBUDGET, "%s: %s %s\n", __func__, strAction.c_str(), vote.GetHash().ToString().c_str());
     return true;
 }
 
+void CFinalizedBudget::RecountVotes()
+{
+    nValidVotes = 0;
+    for (const auto& it : mapVotes) {
+        if (it.second.IsValid()) nValidVotes++;
+    }
+}
+
 UniValue CFinalizedBudget::GetVotesObject() const
 {
     UniValue ret(UniValue::VOBJ);
@@ -258,13 +273,7 @@ bool CFinalizedBudget::UpdateValid(int nCurrentHeight)
 
 int CFinalizedBudget::GetVoteCount() const
 {
-    int ret = 0;
-    for (const auto& it : mapVotes) {
-        if (it.second.IsValid()) {
-            ret++;
-        }
-    }
-    return ret;
+    return nValidVotes;
 }
 
 std::vector<uint256> CFinalizedBudget::GetVotesHashes() const
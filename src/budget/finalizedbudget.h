@@ -36,6 +36,11 @@ private:
     bool fValid;
     std::string strInvalid;
 
+    // Memory only. Count of the valid votes, updated with mapVotes
+    int nValidVotes{0};
+    // Recompute nValidVotes (after a change of the validity of the votes)
+    void RecountVotes();
+
     // Functions used inside IsWellFormed/UpdateValid - setting strInvalid
     bool updateExpired(int nCurrentHeight);
     bool CheckStartEnd();
@@ -118,6 +123,7 @@ public:
         READWRITE(obj.fAutoChecked);
         READWRITE(obj.mapVotes);
         READWRITE(obj.strProposals);
+        SER_READ(obj, obj.RecountVotes());
     }
 
     // Serialization for network messages.
@@ -6,6 +6,9 @@
 
 #include "chain.h"
 #include "legacy/stakemodifier.h"  // for ComputeNextStakeModifier
+#include "sync.h"
+
+#include <memory>
 
 
 /**
@@ -135,6 +138,73 @@ CBlockIndex::CBlockIndex(const CBlock& block):
         SetProofOfStake();
 }
 
+namespace {
+
+/**
+ * Allocator of the block index entries. There are millions of them: they are allocated in chunks
+ * to save the overhead of a heap allocation each, and mostly live until the shutdown, so the freed
+ * ones are only reused, never given back.
+ */
+class BlockIndexPool
+{
+private:
+    static const size_t ENTRIES_PER_CHUNK = 4096;
+
+    union Slot
+    {
+        Slot* next;
+        alignas(CBlockIndex) unsigned char entry[sizeof(CBlockIndex)];
+    };
+
+    Mutex cs;
+    std::vector<std::unique_ptr<Slot[]>> vChunks GUARDED_BY(cs);
+    size_t nChunkUsed GUARDED_BY(cs){ENTRIES_PER_CHUNK};
+    Slot* freeSlots GUARDED_BY(cs){nullptr};
+
+public:
+    void* Allocate()
+    {
+        LOCK(cs);
+        if (freeSlots) {
+            Slot* slot = freeSlots;
+            freeSlots = slot->next;
+            return slot;
+        }
+        if (nChunkUsed == ENTRIES_PER_CHUNK) {
+            vChunks.emplace_back(new Slot[ENTRIES_PER_CHUNK]);
+            nChunkUsed = 0;
+        }
+        return &vChunks.back()[nChunkUsed++];
+    }
+
+    void Free(void* p)
+    {
+        LOCK(cs);
+        Slot* slot = static_cast<Slot*>(p);
+        slot->next = freeSlots;
+        freeSlots = slot;
+    }
+};
+
+// Never destroyed, as the block index is freed by a static destructor
+BlockIndexPool& blockIndexPool = *new BlockIndexPool();
+
+} // anon namespace
+
+void* CBlockIndex::operator new(size_t size)
+{
+    // The pool only holds CBlockIndex objects, not the ones of the derived classes
+    if (size != sizeof(CBlockIndex)) return ::operator new(size);
+    return blockIndexPool.Allocate();
+}
+
+void CBlockIndex::operator delete(void* p, size_t size)
+{
+    if (!p) return;
+    if (size != sizeof(CBlockIndex)) return ::operator delete(p);
+    blockIndexPool.Free(p);
+}
+
 std::string CBlockIndex::ToString() const
 {
     return strprintf("CBlockIndex(pprev=%p, nHeight=%d, merkle=%s, hashBlock=%s)",
@@ -232,10 +302,7 @@ bool CBlockIndex::SetStakeEntropyBit(unsigned int nEntropyBit)
 // Sets V1 stake modifier (uint64_t)
 void CBlockIndex::SetStakeModifier(const uint64_t nStakeModifier, bool fGeneratedStakeModifier)
 {
-    vStakeModifier.clear();
-    const size_t modSize = sizeof(nStakeModifier);
-    vStakeModifier.resize(modSize);
-    std::memcpy(vStakeModifier.data(), &nStakeModifier, modSize);
+    stakeModifier.assign((const unsigned char*)&nStakeModifier, sizeof(nStakeModifier));
     if (fGeneratedStakeModifier)
         nFlags |= BLOCK_STAKE_MODIFIER;
 
@@ -257,8 +324,7 @@ void CBlockIndex::SetNewStakeModifier()
 // Sets V2 stake modifiers (uint256)
 void CBlockIndex::SetStakeModifier(const uint256& nStakeModifier)
 {
-    vStakeModifier.clear();
-    vStakeModifier.insert(vStakeModifier.begin(), nStakeModifier.begin(), nStakeModifier.end());
+    stakeModifier.assign(nStakeModifier.begin(), nStakeModifier.size());
 }
 
 // Generates and sets new V2 stake modifier
@@ -278,20 +344,20 @@ void CBlockIndex::SetNewStakeModifier(const uint256& prevoutId)
 // Returns V1 stake modifier (uint64_t)
 uint64_t CBlockIndex::GetStakeModifierV1() const
 {
-    if (vStakeModifier.empty() || Params().GetConsensus().NetworkUpgradeActive(nHeight, Consensus::UPGRADE_V3_4))
+    if (stakeModifier.empty() || Params().GetConsensus().NetworkUpgradeActive(nHeight, Consensus::UPGRADE_V3_4))
         return 0;
-    uint64_t nStakeModifier;
-    std::memcpy(&nStakeModifier, vStakeModifier.data(), vStakeModifier.size());
+    uint64_t nStakeModifier = 0;
+    std::memcpy(&nStakeModifier, stakeModifier.begin(), std::min(stakeModifier.size(), sizeof(nStakeModifier)));
     return nStakeModifier;
 }
 
 // Returns V2 stake modifier (uint256)
 uint256 CBlockIndex::GetStakeModifierV2() const
 {
-    if (vStakeModifier.empty() || !Params().GetConsensus().NetworkUpgradeActive(nHeight, Consensus::UPGRADE_V3_4))
+    if (stakeModifier.empty() || !Params().GetConsensus().NetworkUpgradeActive(nHeight, Consensus::UPGRADE_V3_4))
         return UINT256_ZERO;
     uint256 nStakeModifier;
-    std::memcpy(nStakeModifier.begin(), vStakeModifier.data(), vStakeModifier.size());
+    std::memcpy(nStakeModifier.begin(), stakeModifier.begin(), stakeModifier.size());
     return nStakeModifier;
 }
 
@@ -130,6 +130,47 @@ enum {
     BLOCK_STAKE_MODIFIER = (1 << 2), // regenerated stake modifier
 };
 
+/**
+ * The bytes of the stake modifier of a block, stored inline as there's one for each block index
+ * entry. It is empty for PoW blocks. Modifier V1 is 64 bit while modifier V2 is 256 bit.
+ * Serialized as a byte vector.
+ */
+class CStakeModifierBytes
+{
+private:
+    unsigned char data[32]{};
+    uint8_t nSize{0};
+
+public:
+    bool empty() const { return nSize == 0; }
+    size_t size() const { return nSize; }
+    const unsigned char* begin() const { return data; }
+    void clear() { nSize = 0; }
+
+    void assign(const unsigned char* pch, size_t nLen)
+    {
+        assert(nLen <= sizeof(data));
+        memcpy(data, pch, nLen);
+        nSize = nLen;
+    }
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        WriteCompactSize(s, nSize);
+        if (nSize > 0) s.write((const char*)data, nSize);
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        uint64_t nLen = ReadCompactSize(s);
+        if (nLen > sizeof(data)) throw std::ios_base::failure("Stake modifier too large");
+        if (nLen > 0) s.read((char*)data, nLen);
+        nSize = nLen;
+    }
+};
+
 /** The block chain is a tree shaped structure starting with the
  * genesis block at the root, with each block potentially having multiple
  * candidates to be the next block. A blockindex may have multiple pprev pointing
@@ -175,9 +216,7 @@ public:
     uint32_t nStatus{0};
 
     // proof-of-stake specific fields
-    // char vector holding the stake modifier bytes. It is empty for PoW blocks.
-    // Modifier V1 is 64 bit while modifier V2 is 256 bit.
-    std::vector<unsigned char> vStakeModifier{};
+    CStakeModifierBytes stakeModifier{};
     unsigned int nFlags{0};
 
     //! Change in value held by the Sapling circuit over this block.
@@ -207,6 +246,10 @@ public:
     CBlockIndex() {}
     CBlockIndex(const CBlock& block);
 
+    //! The entries are allocated in chunks from a pool instead of one by one from the heap
+    static void* operator new(size_t size);
+    static void operator delete(void* p, size_t size);
+
     std::string ToString() const;
 
     FlatFilePos GetBlockPos() const;
@@ -291,7 +334,7 @@ public:
             // Serialization with CLIENT_VERSION = 4009902+
             READWRITE(obj.nFlags);
             READWRITE(obj.nVersion);
-            READWRITE(obj.vStakeModifier);
+            READWRITE(obj.stakeModifier);
             READWRITE(obj.hashPrev);
             READWRITE(obj.hashMerkleRoot);
             READWRITE(obj.nTime);
@@ -312,7 +355,7 @@ public:
             READWRITE(nMoneySupply);
             READWRITE(obj.nFlags);
             READWRITE(obj.nVersion);
-            READWRITE(obj.vStakeModifier);
+            READWRITE(obj.stakeModifier);
             READWRITE(obj.hashPrev);
             READWRITE(obj.hashMerkleRoot);
             READWRITE(obj.nTime);
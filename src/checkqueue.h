@@ -6,6 +6,7 @@
 #define BITCOIN_CHECKQUEUE_H
 
 #include <algorithm>
+#include <chrono>
 #include <vector>
 
 #include <boost/thread/condition_variable.hpp>
@@ -23,6 +24,11 @@ class CCheckQueueControl;
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * The batches taken by the workers adapt to the measured cost of the
+  * checks: they aim at BATCH_TARGET_NS of work each (up to the maximum
+  * batch size of the queue), so cheap checks take the mutex rarely and
+  * expensive ones are spread over all the workers.
   */
 template <typename T>
 class CCheckQueue
@@ -58,21 +64,40 @@ private:
     unsigned int nTodo;
 
     //! The maximum number of elements to be processed in one batch
+    const unsigned int nMaxBatchSize;
+
+    //! The current batch size, from the average cost of the checks
     unsigned int nBatchSize;
 
+    //! Moving average of the time spent by a check, in nanoseconds (0 until measured)
+    int64_t nCheckCostNs;
+
+    //! The work aimed at for each batch, in nanoseconds
+    static constexpr int64_t BATCH_TARGET_NS = 500 * 1000;
+
+    void UpdateBatchSize(unsigned int nChecks, int64_t nElapsedNs)
+    {
+        const int64_t nCost = std::max((int64_t)1, nElapsedNs / nChecks);
+        nCheckCostNs = nCheckCostNs ? (nCheckCostNs * 7 + nCost) / 8 : nCost;
+        nBatchSize = (unsigned int)std::max((int64_t)1, std::min((int64_t)nMaxBatchSize, BATCH_TARGET_NS / nCheckCostNs));
+    }
+
     /** Internal function that does bulk of the verification work. */
     bool Loop(bool fMaster = false)
     {
         boost::condition_variable& cond = fMaster ? condMaster : condWorker;
         std::vector<T> vChecks;
-        vChecks.reserve(nBatchSize);
+        vChecks.reserve(nMaxBatchSize);
         unsigned int nNow = 0;
         bool fOk = true;
+        int64_t nElapsedNs = 0;
         do {
             {
                 boost::unique_lock<boost::mutex> lock(mutex);
                 // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
                 if (nNow) {
+                    // only the batches that ran all their checks are measured
+                    if (fOk) UpdateBatchSize(nNow, nElapsedNs);
                     fAllOk &= fOk;
                     nTodo -= nNow;
                     if (nTodo == 0 && !fMaster)
@@ -114,16 +139,18 @@ private:
                 fOk = fAllOk;
             }
             // execute work
+            const auto start = std::chrono::steady_clock::now();
             for (T& check : vChecks)
                 if (fOk)
                     fOk = check();
+            nElapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
             vChecks.clear();
         } while (true);
     }
 
 public:
     //! Create a new check queue
-    explicit CCheckQueue(unsigned int nBatchSizeIn) : nIdle(0), nTotal(0), fAllOk(true), nTodo(0), nBatchSize(nBatchSizeIn) {}
+    explicit CCheckQueue(unsigned int nBatchSizeIn) : nIdle(0), nTotal(0), fAllOk(true), nTodo(0), nMaxBatchSize(nBatchSizeIn), nBatchSize(nBatchSizeIn), nCheckCostNs(0) {}
 
     //! Worker thread
     void Thread()
@@ -28,6 +28,13 @@ bool CCoinsView::BatchWrite(CCoinsMap& mapCoins,
 // Sapling
 bool CCoinsView::GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const { return false; }
 bool CCoinsView::GetNullifier(const uint256 &nullifier) const { return false; }
+void CCoinsView::GetNullifiers(const std::vector<uint256>& nullifiers, std::vector<bool>& vSpent) const
+{
+    vSpent.resize(nullifiers.size());
+    for (size_t i = 0; i < nullifiers.size(); i++) {
+        vSpent[i] = GetNullifier(nullifiers[i]);
+    }
+}
 uint256 CCoinsView::GetBestAnchor() const { return uint256(); };
 
 CCoinsViewBacked::CCoinsViewBacked(CCoinsView* viewIn) : base(viewIn) {}
@@ -49,12 +56,17 @@ bool CCoinsViewBacked::BatchWrite(CCoinsMap& mapCoins,
 // Sapling
 bool CCoinsViewBacked::GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const { return base->GetSaplingAnchorAt(rt, tree); }
 bool CCoinsViewBacked::GetNullifier(const uint256 &nullifier) const { return base->GetNullifier(nullifier); }
+void CCoinsViewBacked::GetNullifiers(const std::vector<uint256>& nullifiers, std::vector<bool>& vSpent) const { base->GetNullifiers(nullifiers, vSpent); }
 uint256 CCoinsViewBacked::GetBestAnchor() const { return base->GetBestAnchor(); }
 
 SaltedOutpointHasher::SaltedOutpointHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
 SaltedIdHasher::SaltedIdHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
 
-CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) : CCoinsViewBacked(baseIn), cachedCoinsUsage(0) {}
+CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) :
+    CCoinsViewBacked(baseIn),
+    cacheCoinsMemoryResource(std::make_unique<CCoinsMapMemoryResource>()),
+    cacheCoins(0, SaltedOutpointHasher(), CCoinsMap::key_equal(), cacheCoinsMemoryResource.get()),
+    cachedCoinsUsage(0) {}
 
 size_t CCoinsViewCache::DynamicMemoryUsage() const {
     return memusage::DynamicUsage(cacheCoins) +
@@ -108,9 +120,13 @@ void CCoinsViewCache::AddCoin(const COutPoint& outpoint, Coin&& coin, bool possi
         }
         fresh = !(it->second.flags & CCoinsCacheEntry::DIRTY);
     }
+    if (!it->second.coin.IsSpent()) {
+        nValueDelta -= it->second.coin.out.nValue;
+    }
     it->second.coin = std::move(coin);
     it->second.flags |= CCoinsCacheEntry::DIRTY | (fresh ? CCoinsCacheEntry::FRESH : 0);
     cachedCoinsUsage += it->second.coin.DynamicMemoryUsage();
+    nValueDelta += it->second.coin.out.nValue;
 }
 
 void AddCoins(CCoinsViewCache& cache, const CTransaction& tx, int nHeight, bool check, bool fSkipInvalid)
@@ -135,6 +151,9 @@ void CCoinsViewCache::SpendCoin(const COutPoint& outpoint, Coin* moveout)
     CCoinsMap::iterator it = FetchCoin(outpoint);
     if (it == cacheCoins.end()) return;
     cachedCoinsUsage -= it->second.coin.DynamicMemoryUsage();
+    if (!it->second.coin.IsSpent()) {
+        nValueDelta -= it->second.coin.out.nValue;
+    }
     if (moveout) {
         *moveout = std::move(it->second.coin);
     }
@@ -317,9 +336,113 @@ bool CCoinsViewCache::Flush()
     cacheSaplingAnchors.clear();
     cacheSaplingNullifiers.clear();
     cachedCoinsUsage = 0;
+    ReallocateCache();
     return fOk;
 }
 
+void CCoinsViewCache::ReallocateCache()
+{
+    assert(cacheCoins.empty());
+    cacheCoins.~CCoinsMap();
+    cacheCoinsMemoryResource = std::make_unique<CCoinsMapMemoryResource>();
+    ::new (&cacheCoins) CCoinsMap(0, SaltedOutpointHasher(), CCoinsMap::key_equal(), cacheCoinsMemoryResource.get());
+}
+
+std::unique_ptr<CCoinsViewSnapshot> CCoinsViewCache::TakeSnapshot()
+{
+    const uint256 hashBestBlock = GetBestBlock();
+    const uint256 hashBestAnchor = GetBestAnchor();
+    const size_t nMemoryUsage = DynamicMemoryUsage();
+    // The pool of the coins moves with them
+    auto snapshot = std::make_unique<CCoinsViewSnapshot>(base, hashBestBlock, hashBestAnchor,
+                                                         std::move(cacheCoinsMemoryResource), std::move(cacheCoins),
+                                                         std::move(cacheSaplingAnchors), std::move(cacheSaplingNullifiers),
+                                                         nMemoryUsage);
+    cacheCoins.clear();
+    cacheSaplingAnchors.clear();
+    cacheSaplingNullifiers.clear();
+    cachedCoinsUsage = 0;
+    ReallocateCache();
+    base = snapshot.get();
+    return snapshot;
+}
+
+CCoinsViewSnapshot::CCoinsViewSnapshot(CCoinsView* baseIn, const uint256& hashBlockIn, const uint256& hashSaplingAnchorIn,
+                                       std::unique_ptr<CCoinsMapMemoryResource> coinsMemoryResourceIn, CCoinsMap&& coinsIn,
+                                       CAnchorsSaplingMap&& saplingAnchorsIn, CNullifiersMap&& saplingNullifiersIn, size_t nMemoryUsageIn) :
+    CCoinsViewBacked(baseIn),
+    hashBlock(hashBlockIn),
+    hashSaplingAnchor(hashSaplingAnchorIn),
+    coinsMemoryResource(std::move(coinsMemoryResourceIn)),
+    coins(std::move(coinsIn)),
+    saplingAnchors(std::move(saplingAnchorsIn)),
+    saplingNullifiers(std::move(saplingNullifiersIn)),
+    nMemoryUsage(nMemoryUsageIn) {}
+
+bool CCoinsViewSnapshot::GetCoin(const COutPoint& outpoint, Coin& coin) const
+{
+    CCoinsMap::const_iterator it = coins.find(outpoint);
+    if (it == coins.end()) {
+        return base->GetCoin(outpoint, coin);
+    }
+    // A spent coin of the snapshot hides the one of the database
+    coin = it->second.coin;
+    return !coin.IsSpent();
+}
+
+bool CCoinsViewSnapshot::HaveCoin(const COutPoint& outpoint) const
+{
+    CCoinsMap::const_iterator it = coins.find(outpoint);
+    if (it == coins.end()) {
+        return base->HaveCoin(outpoint);
+    }
+    return !it->second.coin.IsSpent();
+}
+
+bool CCoinsViewSnapshot::GetSaplingAnchorAt(const uint256& rt, SaplingMerkleTree& tree) const
+{
+    CAnchorsSaplingMap::const_iterator it = saplingAnchors.find(rt);
+    if (it == saplingAnchors.end()) {
+        return base->GetSaplingAnchorAt(rt, tree);
+    }
+    if (it->second.entered) {
+        tree = it->second.tree;
+    }
+    return it->second.entered;
+}
+
+bool CCoinsViewSnapshot::GetNullifier(const uint256& nullifier) const
+{
+    CNullifiersMap::const_iterator it = saplingNullifiers.find(nullifier);
+    if (it == saplingNullifiers.end()) {
+        return base->GetNullifier(nullifier);
+    }
+    return it->second.entered;
+}
+
+void CCoinsViewSnapshot::GetNullifiers(const std::vector<uint256>& nullifiers, std::vector<bool>& vSpent) const
+{
+    vSpent.resize(nullifiers.size());
+    // Only the nullifiers not in the snapshot are looked up in the base
+    std::vector<uint256> vMissing;
+    std::vector<size_t> vMissingPos;
+    for (size_t i = 0; i < nullifiers.size(); i++) {
+        CNullifiersMap::const_iterator it = saplingNullifiers.find(nullifiers[i]);
+        if (it == saplingNullifiers.end()) {
+            vMissing.emplace_back(nullifiers[i]);
+            vMissingPos.emplace_back(i);
+        } else {
+            vSpent[i] = it->second.entered;
+        }
+    }
+    if (vMissing.empty()) return;
+    std::vector<bool> vMissingSpent;
+    base->GetNullifiers(vMissing, vMissingSpent);
+    for (size_t i = 0; i < vMissing.size(); i++) {
+        vSpent[vMissingPos[i]] = vMissingSpent[i];
+    }
+}
+
 void CCoinsViewCache::Uncache(const COutPoint& outpoint)
 {
     CCoinsMap::iterator it = cacheCoins.find(outpoint);
@@ -329,6 +452,26 @@ void CCoinsViewCache::Uncache(const COutPoint& outpoint)
     }
 }
 
+void CCoinsViewCache::CacheCoin(const COutPoint& outpoint, Coin&& coin)
+{
+    assert(!coin.IsSpent());
+    auto ret = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::forward_as_tuple(std::move(coin)));
+    if (ret.second) {
+        cachedCoinsUsage += ret.first->second.coin.DynamicMemoryUsage();
+    }
+}
+
+void CCoinsViewCache::GetCachedOutpoints(std::vector<COutPoint>& vOutpoints, size_t nMax) const
+{
+    for (const auto& it : cacheCoins) {
+        if (nMax == 0) return;
+        if (!it.second.coin.IsSpent()) {
+            vOutpoints.emplace_back(it.first);
+            nMax--;
+        }
+    }
+}
+
 unsigned int CCoinsViewCache::GetCacheSize() const
 {
     return cacheCoins.size();
@@ -457,6 +600,32 @@ bool CCoinsViewCache::GetNullifier(const uint256 &nullifier) const {
     return tmp;
 }
 
+void CCoinsViewCache::GetNullifiers(const std::vector<uint256>& nullifiers, std::vector<bool>& vSpent) const
+{
+    vSpent.resize(nullifiers.size());
+    // The cache misses are looked up in the base at once, and cached
+    std::vector<uint256> vMissing;
+    std::vector<size_t> vMissingPos;
+    for (size_t i = 0; i < nullifiers.size(); i++) {
+        CNullifiersMap::const_iterator it = cacheSaplingNullifiers.find(nullifiers[i]);
+        if (it == cacheSaplingNullifiers.end()) {
+            vMissing.emplace_back(nullifiers[i]);
+            vMissingPos.emplace_back(i);
+        } else {
+            vSpent[i] = it->second.entered;
+        }
+    }
+    if (vMissing.empty()) return;
+    std::vector<bool> vMissingSpent;
+    base->GetNullifiers(vMissing, vMissingSpent);
+    for (size_t i = 0; i < vMissing.size(); i++) {
+        CNullifiersCacheEntry entry;
+        entry.entered = vMissingSpent[i];
+        cacheSaplingNullifiers.insert(std::make_pair(vMissing[i], entry));
+        vSpent[vMissingPos[i]] = vMissingSpent[i];
+    }
+}
+
 template<typename Tree, typename Cache, typename CacheIterator, typename CacheEntry>
 void CCoinsViewCache::AbstractPushAnchor(
         const Tree &tree,
@@ -567,10 +736,19 @@ uint256 CCoinsViewCache::GetBestAnchor() const {
 bool CCoinsViewCache::HaveShieldedRequirements(const CTransaction& tx) const
 {
     if (tx.IsShieldedTx()) {
-        for (const SpendDescription &spendDescription : tx.sapData->vShieldedSpend) {
-            if (GetNullifier(spendDescription.nullifier)) // Prevent double spends
+        std::vector<uint256> vNullifiers;
+        vNullifiers.reserve(tx.sapData->vShieldedSpend.size());
+        for (const SpendDescription& spendDescription : tx.sapData->vShieldedSpend) {
+            vNullifiers.emplace_back(spendDescription.nullifier);
+        }
+        std::vector<bool> vSpent;
+        GetNullifiers(vNullifiers, vSpent);
+        for (bool fSpent : vSpent) {
+            if (fSpent) // Prevent double spends
                 return false;
+        }
 
+        for (const SpendDescription &spendDescription : tx.sapData->vShieldedSpend) {
             SaplingMerkleTree tree;
             if (!GetSaplingAnchorAt(spendDescription.anchor, tree)) {
                 return false;
@@ -14,12 +14,14 @@
 #include "sapling/incrementalmerkletree.h"
 #include "script/standard.h"
 #include "serialize.h"
+#include "support/allocators/pool.h"
 #include "uint256.h"
 
 #include <assert.h>
 #include <stdint.h>
 
 #include <unordered_map>
+#include <vector>
 
 /**
  * A UTXO entry.
@@ -174,7 +176,15 @@ struct CNullifiersCacheEntry
 typedef std::unordered_map<uint256, CAnchorsSaplingCacheEntry, SaltedIdHasher> CAnchorsSaplingMap;
 typedef std::unordered_map<uint256, CNullifiersCacheEntry, SaltedIdHasher> CNullifiersMap;
 
-typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
+/**
+ * The coins are pool allocated: one node costs no malloc overhead, so that a same -dbcache holds more of them.
+ * The blocks are big enough for the nodes of the common standard libraries (the pair, the next node pointer, and
+ * possibly a cached hash).
+ */
+typedef PoolAllocator<std::pair<const COutPoint, CCoinsCacheEntry>,
+                      sizeof(std::pair<const COutPoint, CCoinsCacheEntry>) + sizeof(void*) * 4> CCoinsMapAllocator;
+typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher, std::equal_to<COutPoint>, CCoinsMapAllocator> CCoinsMap;
+typedef CCoinsMapAllocator::ResourceType CCoinsMapMemoryResource;
 
 /** Cursor for iterating over CoinsView state */
 class CCoinsViewCursor
@@ -240,6 +250,9 @@ public:
     //! Determine whether a nullifier is spent or not
     virtual bool GetNullifier(const uint256 &nullifier) const;
 
+    //! Determine whether each of the nullifiers is spent, in a single lookup of the backend
+    virtual void GetNullifiers(const std::vector<uint256>& nullifiers, std::vector<bool>& vSpent) const;
+
     //! Get the current "tip" or the latest anchored tree root in the chain
     virtual uint256 GetBestAnchor() const;
 };
@@ -270,6 +283,7 @@ public:
     // Sapling
     bool GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const override;
     bool GetNullifier(const uint256 &nullifier) const override;
+    void GetNullifiers(const std::vector<uint256>& nullifiers, std::vector<bool>& vSpent) const override;
     uint256 GetBestAnchor() const override;
 };
 
@@ -278,6 +292,8 @@ public:
 static const unsigned int STANDARD_LOCKTIME_VERIFY_FLAGS = LOCKTIME_VERIFY_SEQUENCE |
                                                            LOCKTIME_MEDIAN_TIME_PAST;
 
+class CCoinsViewSnapshot;
+
 /** CCoinsView that adds a memory cache for transactions to another CCoinsView */
 class CCoinsViewCache : public CCoinsViewBacked
 {
@@ -287,6 +303,8 @@ protected:
      * declared as "const".
      */
     mutable uint256 hashBlock;
+    //! Must outlive cacheCoins (declared before it)
+    std::unique_ptr<CCoinsMapMemoryResource> cacheCoinsMemoryResource;
     mutable CCoinsMap cacheCoins;
 
     // Sapling
@@ -297,6 +315,9 @@ protected:
     /* Cached dynamic memory usage for the inner Coin objects. */
     mutable size_t cachedCoinsUsage;
 
+    //! Value of the coins added through this cache, minus the value of the coins spent
+    CAmount nValueDelta{0};
+
 public:
     CCoinsViewCache(CCoinsView *baseIn);
 
@@ -308,6 +329,7 @@ public:
     // Sapling methods
     bool GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const override;
     bool GetNullifier(const uint256 &nullifier) const override;
+    void GetNullifiers(const std::vector<uint256>& nullifiers, std::vector<bool>& vSpent) const override;
     uint256 GetBestAnchor() const override;
 
     // Adds the tree to mapSaplingAnchors
@@ -373,17 +395,35 @@ public:
      */
     bool Flush();
 
+    /**
+     * Move the content of this cache to a snapshot, which becomes its backend (on top of the previous one), so that
+     * the snapshot can be written to the database in the background. The cache is left empty.
+     */
+    std::unique_ptr<CCoinsViewSnapshot> TakeSnapshot();
+
     /**
      * Removes the UTXO with the given outpoint from the cache, if it is not modified.
      */
     void Uncache(const COutPoint &outpoint);
 
+    /**
+     * Adds an unspent coin read from the backing view out of this cache (e.g. prefetched on another thread), unless
+     * the outpoint is already cached. The caller must make sure that it's still the coin of the backing view.
+     */
+    void CacheCoin(const COutPoint& outpoint, Coin&& coin);
+
+    //! Append the outpoints of (up to nMax of) the unspent coins of the cache to vOutpoints
+    void GetCachedOutpoints(std::vector<COutPoint>& vOutpoints, size_t nMax) const;
+
     //! Calculate the size of the cache (in number of transaction outputs)
     unsigned int GetCacheSize() const;
 
     //! Calculate the size of the cache (in bytes)
     size_t DynamicMemoryUsage() const;
 
+    //! The change of the value of the unspent coins made through this cache (e.g. by the blocks connected to it)
+    CAmount GetValueDelta() const { return nValueDelta; }
+
     /**
      * Amount of pivx coming in to a transaction
      * Note that lightweight clients may not know anything besides the hash of previous transactions,
@@ -403,7 +443,8 @@ public:
     int GetCoinDepthAtHeight(const COutPoint& output, int nHeight) const;
 
     /*
-     * Return the sum of the value of all transaction outputs
+     * Return the sum of the value of all transaction outputs, scanning the whole backing database.
+     * The money supply is tracked block by block instead: this is only the audit of it.
      */
     CAmount GetTotalAmount() const;
 
@@ -416,6 +457,9 @@ public:
 private:
     CCoinsMap::iterator FetchCoin(const COutPoint& outpoint) const;
 
+    //! Give back the memory of the (empty) coins cache, as its pool only frees it on destruction
+    void ReallocateCache();
+
     //! Generalized interface for popping anchors
     template<typename Tree, typename Cache, typename CacheEntry>
     void AbstractPopAnchor(
@@ -440,6 +484,48 @@ private:
     );
 };
 
+/**
+ * Read-only view of the content taken from a CCoinsViewCache, on top of its previous backend. The caches built on it
+ * keep reading the coins that it has, while they are written to the database on another thread: as its content never
+ * changes, it can be read concurrently.
+ */
+class CCoinsViewSnapshot : public CCoinsViewBacked
+{
+private:
+    const uint256 hashBlock;
+    const uint256 hashSaplingAnchor;
+    const std::unique_ptr<CCoinsMapMemoryResource> coinsMemoryResource;
+    const CCoinsMap coins;
+    const CAnchorsSaplingMap saplingAnchors;
+    const CNullifiersMap saplingNullifiers;
+    const size_t nMemoryUsage;
+
+public:
+    CCoinsViewSnapshot(CCoinsView* baseIn, const uint256& hashBlockIn, const uint256& hashSaplingAnchorIn,
+                       std::unique_ptr<CCoinsMapMemoryResource> coinsMemoryResourceIn, CCoinsMap&& coinsIn,
+                       CAnchorsSaplingMap&& saplingAnchorsIn, CNullifiersMap&& saplingNullifiersIn, size_t nMemoryUsageIn);
+
+    bool GetCoin(const COutPoint& outpoint, Coin& coin) const override;
+    bool HaveCoin(const COutPoint& outpoint) const override;
+    uint256 GetBestBlock() const override { return hashBlock; }
+    bool GetSaplingAnchorAt(const uint256& rt, SaplingMerkleTree& tree) const override;
+    bool GetNullifier(const uint256& nullifier) const override;
+    void GetNullifiers(const std::vector<uint256>& nullifiers, std::vector<bool>& vSpent) const override;
+    uint256 GetBestAnchor() const override { return hashSaplingAnchor; }
+    // The content of a snapshot is never modified
+    bool BatchWrite(CCoinsMap& mapCoins,
+                    const uint256& hashBlock,
+                    const uint256& hashSaplingAnchor,
+                    CAnchorsSaplingMap& mapSaplingAnchors,
+                    CNullifiersMap& mapSaplingNullifiers) override { return false; }
+
+    CCoinsView* GetBackend() const { return base; }
+    const CCoinsMap& GetCoins() const { return coins; }
+    const CAnchorsSaplingMap& GetSaplingAnchors() const { return saplingAnchors; }
+    const CNullifiersMap& GetSaplingNullifiers() const { return saplingNullifiers; }
+    size_t DynamicMemoryUsage() const { return nMemoryUsage; }
+};
+
 //! Utility function to add all of a transaction's outputs to a cache.
 // PIVX: When check is false, this assumes that overwrites are never possible due to BIP34 always in effect
 // When check is true, the underlying view may be queried to determine whether an addition is
@@ -106,8 +106,18 @@ typedef char* sockopt_arg_type;
 #define USE_POLL
 #endif
 
+// Edge-triggered socket events with a persistent interest set, instead of the select()/poll() set rebuilt every time
+#if defined(__linux__)
+#define USE_EPOLL
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__DragonFly__)
+#define USE_KQUEUE
+#endif
+#if defined(USE_EPOLL) || defined(USE_KQUEUE)
+#define USE_EDGE_TRIGGERED_EVENTS
+#endif
+
 bool static inline IsSelectableSocket(const SOCKET& s) {
-#if defined(USE_POLL) || defined(WIN32)
+#if defined(USE_POLL) || defined(USE_KQUEUE) || defined(WIN32)
     return true;
 #else
     return (s < FD_SETSIZE);
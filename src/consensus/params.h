@@ -170,6 +170,8 @@ struct LLMQParams {
  */
 struct Params {
     uint256 hashGenesisBlock;
+    /** By default assume that the signatures and proofs in ancestors of this block are valid */
+    uint256 defaultAssumeValid;
     bool fPowAllowMinDifficultyBlocks;
     bool fPowNoRetargeting;
     uint256 powLimit;
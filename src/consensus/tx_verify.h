@@ -15,13 +15,17 @@ class CBlockIndex;
 class CChainParams;
 class CCoinsViewCache;
 class CValidationState;
+namespace SaplingValidation { class CSaplingProofCheck; }
+class CPublicCoinSpendCheck;
 
 /** Transaction validation functions */
 
 /** Context-independent validity checks */
 bool CheckTransaction(const CTransaction& tx, CValidationState& state, bool fColdStakingActive);
 /** Context-dependent validity checks */
-bool ContextualCheckTransaction(const CTransactionRef& tx, CValidationState& state, const CChainParams& chainparams, int nHeight, bool isMined, bool fIBD);
+bool ContextualCheckTransaction(const CTransactionRef& tx, CValidationState& state, const CChainParams& chainparams, int nHeight, bool isMined, bool fIBD,
+                                std::vector<SaplingValidation::CSaplingProofCheck>* pvSaplingChecks = nullptr,
+                                std::vector<CPublicCoinSpendCheck>* pvZerocoinChecks = nullptr);
 
 /**
  * Count ECDSA signature operations the old-fashioned (pre-0.6) way
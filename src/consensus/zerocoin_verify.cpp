@@ -14,7 +14,12 @@
 #include "zpiv/zpivmodule.h"
 
 
-static bool CheckZerocoinSpend(const CTransactionRef _tx, CValidationState& state)
+bool CPublicCoinSpendCheck::operator()()
+{
+    return spend->Verify();
+}
+
+static bool CheckZerocoinSpend(const CTransactionRef _tx, CValidationState& state, std::vector<CPublicCoinSpendCheck>* pvChecks)
 {
     const CTransaction& tx = *_tx;
     //max needed non-mint outputs should be 2 - one for redemption address and a possible 2nd for change
@@ -77,9 +82,17 @@ static bool CheckZerocoinSpend(const CTransactionRef _tx, CValidationState& stat
 
         if (isPublicSpend) {
             libzerocoin::ZerocoinParams* params = consensus.Zerocoin_Params(false);
-            PublicCoinSpend ret(params);
-            if (!ZPIVModule::validateInput(txin, prevOut, tx, ret)){
-                return state.DoS(100, error("%s: public zerocoin spend did not verify", __func__));
+            if (pvChecks) {
+                auto ret = std::make_shared<PublicCoinSpend>(params);
+                if (!ZPIVModule::validateInputWithoutVerification(txin, prevOut, tx, *ret)) {
+                    return state.DoS(100, error("%s: public zerocoin spend did not verify", __func__));
+                }
+                pvChecks->emplace_back(std::move(ret));
+            } else {
+                PublicCoinSpend ret(params);
+                if (!ZPIVModule::validateInput(txin, prevOut, tx, ret)){
+                    return state.DoS(100, error("%s: public zerocoin spend did not verify", __func__));
+                }
             }
         }
 
@@ -124,7 +137,8 @@ bool CheckPublicCoinSpendEnforced(int blockHeight, bool isPublicSpend)
     return true;
 }
 
-bool ContextualCheckZerocoinTx(const CTransactionRef& tx, CValidationState& state, const Consensus::Params& consensus, int nHeight, bool isMined)
+bool ContextualCheckZerocoinTx(const CTransactionRef& tx, CValidationState& state, const Consensus::Params& consensus, int nHeight, bool isMined,
+                               std::vector<CPublicCoinSpendCheck>* pvChecks)
 {
     // zerocoin enforced via block time. First block with a zc mint is 863735
     const bool fZerocoinEnforced = (nHeight >= consensus.ZC_HeightStart);
@@ -169,7 +183,7 @@ bool ContextualCheckZerocoinTx(const CTransactionRef& tx, CValidationState& stat
     }
 
     if (hasPrivateSpendInputs || hasPublicSpendInputs) {
-        if (!CheckZerocoinSpend(tx, state))
+        if (!CheckZerocoinSpend(tx, state, pvChecks))
             return false;   // failure reason logged in validation state
     }
 
@@ -196,12 +210,12 @@ bool IsSerialInBlockchain(const CBigNum& bnSerial, int& nHeightTx)
     if (!GetTransaction(txHash, tx, hashBlock, true))
         return false;
 
-    if (hashBlock.IsNull() || !mapBlockIndex.count(hashBlock)) {
+    if (hashBlock.IsNull()) {
         return false;
     }
 
-    CBlockIndex* pindex = mapBlockIndex[hashBlock];
-    if (!chainActive.Contains(pindex)) {
+    CBlockIndex* pindex = LookupBlockIndex(hashBlock);
+    if (!pindex || !chainActive.Contains(pindex)) {
         return false;
     }
 
@@ -8,8 +8,11 @@
 #include "consensus/consensus.h"
 #include "script/interpreter.h"
 
+#include <memory>
+
 class CValidationState;
 class CBigNum;
+class PublicCoinSpend;
 
 namespace Consensus {
     struct Params;
@@ -18,11 +21,32 @@ namespace libzerocoin {
     class CoinSpend;
 }
 
+/**
+ * Closure representing the verification of a public zerocoin spend
+ * (commitment or schnorr signature of the coin, and spend signature).
+ */
+class CPublicCoinSpendCheck
+{
+private:
+    std::shared_ptr<const PublicCoinSpend> spend;
+
+public:
+    CPublicCoinSpendCheck() = default;
+    explicit CPublicCoinSpendCheck(std::shared_ptr<const PublicCoinSpend> spendIn) : spend(std::move(spendIn)) {}
+
+    bool operator()();
+
+    void swap(CPublicCoinSpendCheck& check) { spend.swap(check.spend); }
+};
+
 // Fake Serial attack Range
 bool isBlockBetweenFakeSerialAttackRange(int nHeight);
 // Public coin spend
 bool CheckPublicCoinSpendEnforced(int blockHeight, bool isPublicSpend);
-bool ContextualCheckZerocoinTx(const CTransactionRef& tx, CValidationState& state, const Consensus::Params& consensus, int nHeight, bool isMined);
+// Note: if pvChecks is not null, the verification of the public spends is not performed here
+//       but deferred to the CPublicCoinSpendCheck appended to pvChecks.
+bool ContextualCheckZerocoinTx(const CTransactionRef& tx, CValidationState& state, const Consensus::Params& consensus, int nHeight, bool isMined,
+                               std::vector<CPublicCoinSpendCheck>* pvChecks = nullptr);
 bool ContextualCheckZerocoinSpend(const CTransaction& tx, const libzerocoin::CoinSpend* spend, int nHeight);
 bool ContextualCheckZerocoinSpendNoSerialCheck(const CTransaction& tx, const libzerocoin::CoinSpend* spend, int nHeight);
 
@@ -7,9 +7,16 @@
 
 #include "crypto/aes.h"
 #include "crypto/sha512.h"
+#include "ctpl_stl.h"
 #include "script/script.h"
 #include "script/standard.h"
 #include "uint256.h"
+#include "util/system.h"
+
+//! Threads checking the crypted keys at the first unlock, and the keys it needs to use them.
+static const int MAX_UNLOCK_CHECK_THREADS = 8;
+static const size_t MIN_PARALLEL_UNLOCK_CHECK_KEYS = 64;
+static const size_t UNLOCK_CHECK_BATCH_SIZE = 32;
 
 int CCrypter::BytesToKeySHA512AES(const std::vector<unsigned char>& chSalt, const SecureString& strKeyData, int count, unsigned char* key, unsigned char* iv) const
 {
@@ -134,6 +141,38 @@ bool CCryptoKeyStore::DecryptKey(const CKeyingMaterial& vMasterKey, const std::v
     return key.VerifyPubKey(vchPubKey);
 }
 
+bool CCryptoKeyStore::CheckCryptedKeys(size_t nKeys, const std::function<bool(size_t)>& checkKey)
+{
+    const int nThreads = nKeys < MIN_PARALLEL_UNLOCK_CHECK_KEYS ? 1 : std::min(GetNumCores(), MAX_UNLOCK_CHECK_THREADS);
+    if (nThreads <= 1) {
+        for (size_t i = 0; i < nKeys; i++) {
+            if (!checkKey(i)) return false;
+        }
+        return true;
+    }
+
+    std::atomic<size_t> nNextBatch{0};
+    std::atomic<bool> fFailed{false};
+    ctpl::thread_pool pool(nThreads);
+    std::vector<std::future<void>> vChecks;
+    for (int t = 0; t < nThreads; t++) {
+        vChecks.emplace_back(pool.push([&](int) {
+            while (!fFailed) {
+                const size_t nBatchStart = nNextBatch.fetch_add(UNLOCK_CHECK_BATCH_SIZE);
+                if (nBatchStart >= nKeys) return;
+                const size_t nBatchEnd = std::min(nBatchStart + UNLOCK_CHECK_BATCH_SIZE, nKeys);
+                for (size_t i = nBatchStart; i < nBatchEnd && !fFailed; i++) {
+                    if (!checkKey(i)) fFailed = true;
+                }
+            }
+        }));
+    }
+    for (auto& check : vChecks) {
+        check.get();
+    }
+    return !fFailed;
+}
+
 bool CCryptoKeyStore::SetCrypted()
 {
     LOCK(cs_KeyStore);
@@ -193,6 +232,7 @@ bool CCryptoKeyStore::AddCryptedKey(const CPubKey& vchPubKey, const std::vector<
     }
 
     mapCryptedKeys[vchPubKey.GetID()] = make_pair(vchPubKey, vchCryptedSecret);
+    nKeysGeneration++;
     return true;
 }
 
@@ -259,5 +299,6 @@ bool CCryptoKeyStore::EncryptKeys(CKeyingMaterial& vMasterKeyIn)
             return false;
     }
     mapKeys.clear();
+    nKeysGeneration++;
     return true;
 }
@@ -14,6 +14,7 @@
 class uint256;
 
 #include <atomic>
+#include <functional>
 
 const unsigned int WALLET_CRYPTO_KEY_SIZE = 32;
 const unsigned int WALLET_CRYPTO_SALT_SIZE = 8;
@@ -145,6 +146,12 @@ protected:
 
     static bool DecryptKey(const CKeyingMaterial& vMasterKey, const std::vector<unsigned char>& vchCryptedSecret, const CPubKey& vchPubKey, CKey& key);
 
+    /**
+     * Whether checkKey(i) passes for all the nKeys crypted keys, checked on several threads for the large wallets.
+     * Stops at the first failure.
+     */
+    static bool CheckCryptedKeys(size_t nKeys, const std::function<bool(size_t)>& checkKey);
+
     // Unlock Sapling keys
     bool UnlockSaplingKeys(const CKeyingMaterial& vMasterKeyIn, bool fDecryptionThoroughlyChecked);
 
@@ -0,0 +1,291 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// SHA-256 transforms with the Intel SHA extensions. The state is kept in the ABEF/CDGH
+// register layout of the sha256rnds2 instruction, and each QuadRound performs 4 rounds.
+
+#ifdef ENABLE_SHANI
+
+#include "crypto/sha256_constants.h"
+
+#include <stdint.h>
+#include <immintrin.h>
+
+namespace
+{
+
+alignas(__m128i) const uint8_t MASK[16] = {0x03, 0x02, 0x01, 0x00, 0x07, 0x06, 0x05, 0x04, 0x0b, 0x0a, 0x09, 0x08, 0x0f, 0x0e, 0x0d, 0x0c};
+
+/** Four rounds with the words of kw, the sums of the round constants and the message words. */
+void inline __attribute__((always_inline)) QuadRound(__m128i& state0, __m128i& state1, __m128i kw)
+{
+    state1 = _mm_sha256rnds2_epu32(state1, state0, kw);
+    state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(kw, 0x0e));
+}
+
+/** The rounds 4*i to 4*i+3, with the message words m. */
+void inline __attribute__((always_inline)) QuadRound(__m128i& state0, __m128i& state1, __m128i m, int i)
+{
+    QuadRound(state0, state1, _mm_add_epi32(m, _mm_load_si128((const __m128i*)(sha256_constants::K + 4 * i))));
+}
+
+/** The rounds 4*i to 4*i+3 of the padding block of a 64-byte input. */
+void inline __attribute__((always_inline)) QuadRoundPadding(__m128i& state0, __m128i& state1, int i)
+{
+    QuadRound(state0, state1, _mm_load_si128((const __m128i*)(sha256_constants::PADDING_KW + 4 * i)));
+}
+
+/** Start the computation of the next message words m2 from m0 (the words before m1). */
+void inline __attribute__((always_inline)) ShiftMessageA(__m128i& m0, __m128i m1)
+{
+    m0 = _mm_sha256msg1_epu32(m0, m1);
+}
+
+/** Finish the computation of the message words m2, following m1. */
+void inline __attribute__((always_inline)) ShiftMessageC(__m128i& m0, __m128i m1, __m128i& m2)
+{
+    m2 = _mm_sha256msg2_epu32(_mm_add_epi32(m2, _mm_alignr_epi8(m1, m0, 4)), m1);
+}
+
+void inline __attribute__((always_inline)) ShiftMessageB(__m128i& m0, __m128i m1, __m128i& m2)
+{
+    ShiftMessageC(m0, m1, m2);
+    ShiftMessageA(m0, m1);
+}
+
+/** Convert the state from ABCD/EFGH to the ABEF/CDGH layout. */
+void inline __attribute__((always_inline)) Shuffle(__m128i& s0, __m128i& s1)
+{
+    const __m128i t1 = _mm_shuffle_epi32(s0, 0xB1);
+    const __m128i t2 = _mm_shuffle_epi32(s1, 0x1B);
+    s0 = _mm_alignr_epi8(t1, t2, 0x08);
+    s1 = _mm_blend_epi16(t2, t1, 0xF0);
+}
+
+/** Convert the state back from the ABEF/CDGH to the ABCD/EFGH layout. */
+void inline __attribute__((always_inline)) Unshuffle(__m128i& s0, __m128i& s1)
+{
+    const __m128i t1 = _mm_shuffle_epi32(s0, 0x1B);
+    const __m128i t2 = _mm_shuffle_epi32(s1, 0xB1);
+    s0 = _mm_blend_epi16(t1, t2, 0xF0);
+    s1 = _mm_alignr_epi8(t2, t1, 0x08);
+}
+
+/** The initial state, in the ABEF/CDGH layout. */
+void inline __attribute__((always_inline)) Initialize(__m128i& s0, __m128i& s1)
+{
+    s0 = _mm_loadu_si128((const __m128i*)sha256_constants::INIT);
+    s1 = _mm_loadu_si128((const __m128i*)(sha256_constants::INIT + 4));
+    Shuffle(s0, s1);
+}
+
+__m128i inline __attribute__((always_inline)) Load(const unsigned char* in)
+{
+    return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)in), _mm_load_si128((const __m128i*)MASK));
+}
+
+void inline __attribute__((always_inline)) Save(unsigned char* out, __m128i s)
+{
+    _mm_storeu_si128((__m128i*)out, _mm_shuffle_epi8(s, _mm_load_si128((const __m128i*)MASK)));
+}
+
+/** The 64 rounds of a transform of the state s0/s1 with the message words m0..m3. */
+void inline __attribute__((always_inline)) Rounds(__m128i& s0, __m128i& s1, __m128i m0, __m128i m1, __m128i m2, __m128i m3)
+{
+    QuadRound(s0, s1, m0, 0);
+    QuadRound(s0, s1, m1, 1);
+    ShiftMessageA(m0, m1);
+    QuadRound(s0, s1, m2, 2);
+    ShiftMessageA(m1, m2);
+    QuadRound(s0, s1, m3, 3);
+    ShiftMessageB(m2, m3, m0);
+    QuadRound(s0, s1, m0, 4);
+    ShiftMessageB(m3, m0, m1);
+    QuadRound(s0, s1, m1, 5);
+    ShiftMessageB(m0, m1, m2);
+    QuadRound(s0, s1, m2, 6);
+    ShiftMessageB(m1, m2, m3);
+    QuadRound(s0, s1, m3, 7);
+    ShiftMessageB(m2, m3, m0);
+    QuadRound(s0, s1, m0, 8);
+    ShiftMessageB(m3, m0, m1);
+    QuadRound(s0, s1, m1, 9);
+    ShiftMessageB(m0, m1, m2);
+    QuadRound(s0, s1, m2, 10);
+    ShiftMessageB(m1, m2, m3);
+    QuadRound(s0, s1, m3, 11);
+    ShiftMessageB(m2, m3, m0);
+    QuadRound(s0, s1, m0, 12);
+    ShiftMessageB(m3, m0, m1);
+    QuadRound(s0, s1, m1, 13);
+    ShiftMessageC(m0, m1, m2);
+    QuadRound(s0, s1, m2, 14);
+    ShiftMessageC(m1, m2, m3);
+    QuadRound(s0, s1, m3, 15);
+}
+
+/** The 64 rounds of two interleaved transforms, of the states a0/a1 and b0/b1. */
+void inline __attribute__((always_inline)) Rounds2(__m128i& a0, __m128i& a1, __m128i am0, __m128i am1, __m128i am2, __m128i am3,
+                                                   __m128i& b0, __m128i& b1, __m128i bm0, __m128i bm1, __m128i bm2, __m128i bm3)
+{
+    QuadRound(a0, a1, am0, 0);
+    QuadRound(b0, b1, bm0, 0);
+    QuadRound(a0, a1, am1, 1);
+    QuadRound(b0, b1, bm1, 1);
+    ShiftMessageA(am0, am1);
+    ShiftMessageA(bm0, bm1);
+    QuadRound(a0, a1, am2, 2);
+    QuadRound(b0, b1, bm2, 2);
+    ShiftMessageA(am1, am2);
+    ShiftMessageA(bm1, bm2);
+    QuadRound(a0, a1, am3, 3);
+    QuadRound(b0, b1, bm3, 3);
+    ShiftMessageB(am2, am3, am0);
+    ShiftMessageB(bm2, bm3, bm0);
+    QuadRound(a0, a1, am0, 4);
+    QuadRound(b0, b1, bm0, 4);
+    ShiftMessageB(am3, am0, am1);
+    ShiftMessageB(bm3, bm0, bm1);
+    QuadRound(a0, a1, am1, 5);
+    QuadRound(b0, b1, bm1, 5);
+    ShiftMessageB(am0, am1, am2);
+    ShiftMessageB(bm0, bm1, bm2);
+    QuadRound(a0, a1, am2, 6);
+    QuadRound(b0, b1, bm2, 6);
+    ShiftMessageB(am1, am2, am3);
+    ShiftMessageB(bm1, bm2, bm3);
+    QuadRound(a0, a1, am3, 7);
+    QuadRound(b0, b1, bm3, 7);
+    ShiftMessageB(am2, am3, am0);
+    ShiftMessageB(bm2, bm3, bm0);
+    QuadRound(a0, a1, am0, 8);
+    QuadRound(b0, b1, bm0, 8);
+    ShiftMessageB(am3, am0, am1);
+    ShiftMessageB(bm3, bm0, bm1);
+    QuadRound(a0, a1, am1, 9);
+    QuadRound(b0, b1, bm1, 9);
+    ShiftMessageB(am0, am1, am2);
+    ShiftMessageB(bm0, bm1, bm2);
+    QuadRound(a0, a1, am2, 10);
+    QuadRound(b0, b1, bm2, 10);
+    ShiftMessageB(am1, am2, am3);
+    ShiftMessageB(bm1, bm2, bm3);
+    QuadRound(a0, a1, am3, 11);
+    QuadRound(b0, b1, bm3, 11);
+    ShiftMessageB(am2, am3, am0);
+    ShiftMessageB(bm2, bm3, bm0);
+    QuadRound(a0, a1, am0, 12);
+    QuadRound(b0, b1, bm0, 12);
+    ShiftMessageB(am3, am0, am1);
+    ShiftMessageB(bm3, bm0, bm1);
+    QuadRound(a0, a1, am1, 13);
+    QuadRound(b0, b1, bm1, 13);
+    ShiftMessageC(am0, am1, am2);
+    ShiftMessageC(bm0, bm1, bm2);
+    QuadRound(a0, a1, am2, 14);
+    QuadRound(b0, b1, bm2, 14);
+    ShiftMessageC(am1, am2, am3);
+    ShiftMessageC(bm1, bm2, bm3);
+    QuadRound(a0, a1, am3, 15);
+    QuadRound(b0, b1, bm3, 15);
+}
+
+} // namespace
+
+namespace sha256_shani
+{
+void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks)
+{
+    __m128i s0, s1, so0, so1;
+
+    /* Load state */
+    s0 = _mm_loadu_si128((const __m128i*)s);
+    s1 = _mm_loadu_si128((const __m128i*)(s + 4));
+    Shuffle(s0, s1);
+
+    while (blocks--) {
+        /* Remember old state */
+        so0 = s0;
+        so1 = s1;
+
+        /* Load data and transform */
+        Rounds(s0, s1, Load(chunk), Load(chunk + 16), Load(chunk + 32), Load(chunk + 48));
+
+        /* Combine with old state */
+        s0 = _mm_add_epi32(s0, so0);
+        s1 = _mm_add_epi32(s1, so1);
+
+        /* Advance */
+        chunk += 64;
+    }
+
+    Unshuffle(s0, s1);
+    _mm_storeu_si128((__m128i*)s, s0);
+    _mm_storeu_si128((__m128i*)(s + 4), s1);
+}
+} // namespace sha256_shani
+
+namespace sha256d64_shani
+{
+void Transform_2way(unsigned char* out, const unsigned char* in)
+{
+    __m128i am0, am1, am2, am3, as0, as1, aso0, aso1;
+    __m128i bm0, bm1, bm2, bm3, bs0, bs1, bso0, bso1;
+
+    /* Transform 1: the 64 bytes of data */
+    Initialize(as0, as1);
+    bs0 = as0;
+    bs1 = as1;
+    Rounds2(as0, as1, Load(in), Load(in + 16), Load(in + 32), Load(in + 48),
+            bs0, bs1, Load(in + 64), Load(in + 80), Load(in + 96), Load(in + 112));
+    Initialize(aso0, aso1);
+    as0 = _mm_add_epi32(as0, aso0);
+    as1 = _mm_add_epi32(as1, aso1);
+    bs0 = _mm_add_epi32(bs0, aso0);
+    bs1 = _mm_add_epi32(bs1, aso1);
+
+    /* Transform 2: the padding, with a constant message schedule */
+    aso0 = as0;
+    aso1 = as1;
+    bso0 = bs0;
+    bso1 = bs1;
+    for (int i = 0; i < 16; i++) {
+        QuadRoundPadding(as0, as1, i);
+        QuadRoundPadding(bs0, bs1, i);
+    }
+    as0 = _mm_add_epi32(as0, aso0);
+    as1 = _mm_add_epi32(as1, aso1);
+    bs0 = _mm_add_epi32(bs0, bso0);
+    bs1 = _mm_add_epi32(bs1, bso1);
+
+    /* Transform 3: the padded 32-byte hash */
+    Unshuffle(as0, as1);
+    Unshuffle(bs0, bs1);
+    am0 = as0;
+    am1 = as1;
+    bm0 = bs0;
+    bm1 = bs1;
+    am2 = bm2 = _mm_set_epi64x(0x0ull, 0x80000000ull);
+    am3 = bm3 = _mm_set_epi64x(0x10000000000ull, 0x0ull);
+    Initialize(as0, as1);
+    bs0 = as0;
+    bs1 = as1;
+    Rounds2(as0, as1, am0, am1, am2, am3, bs0, bs1, bm0, bm1, bm2, bm3);
+    Initialize(aso0, aso1);
+    as0 = _mm_add_epi32(as0, aso0);
+    as1 = _mm_add_epi32(as1, aso1);
+    bs0 = _mm_add_epi32(bs0, aso0);
+    bs1 = _mm_add_epi32(bs1, aso1);
+
+    /* Extract hash */
+    Unshuffle(as0, as1);
+    Unshuffle(bs0, bs1);
+    Save(out, as0);
+    Save(out + 16, as1);
+    Save(out + 32, bs0);
+    Save(out + 48, bs1);
+}
+} // namespace sha256d64_shani
+
+#endif // ENABLE_SHANI
@@ -4,6 +4,10 @@
 
 #include "dbwrapper.h"
 
+#include "sync.h"
+
+#include <set>
+
 #include <leveldb/cache.h>
 #include <leveldb/env.h>
 #include <leveldb/filter_policy.h>
@@ -36,12 +40,15 @@ static void SetMaxOpenFiles(leveldb::Options *options) {
              options->max_open_files, default_open_files);
 }
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+static leveldb::Options GetOptions(size_t nCacheSize, const DBTuning& tuning)
 {
     leveldb::Options options;
-    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
+    options.block_cache = leveldb::NewLRUCache(nCacheSize / 100 * tuning.nBlockCachePercent);
+    // up to two write buffers may be held in memory simultaneously
+    options.write_buffer_size = nCacheSize / 100 * tuning.nWriteBufferPercent;
+    if (tuning.nBloomBitsPerKey > 0) {
+        options.filter_policy = leveldb::NewBloomFilterPolicy(tuning.nBloomBitsPerKey);
+    }
     options.compression = leveldb::kNoCompression;
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
         // LevelDB versions before 1.16 consider short writes to be corruption. Only trigger error
@@ -52,20 +59,32 @@ static leveldb::Options GetOptions(size_t nCacheSize)
     return options;
 }
 
-CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, int nVersion)
+// The open databases, for their statistics. Never destroyed, as the databases may be closed at exit.
+static Mutex& cs_dbwrappers = *new Mutex();
+static std::set<const CDBWrapper*>& setDBWrappers GUARDED_BY(cs_dbwrappers) = *new std::set<const CDBWrapper*>();
+
+CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, int nVersion, const DBTuning& tuningIn) :
+    tuning(tuningIn)
 {
     penv = nullptr;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize);
+    options = GetOptions(nCacheSize, tuning);
+    nBlockCacheSize = nCacheSize / 100 * tuning.nBlockCachePercent;
     options.create_if_missing = true;
     this->nVersion = nVersion;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
         options.env = penv;
+        strName = "memory";
     } else {
+        strName = path.string();
+        const std::string strDataDir = GetDataDir().string();
+        if (strName.size() > strDataDir.size() && strName.compare(0, strDataDir.size(), strDataDir) == 0) {
+            strName = strName.substr(strDataDir.size() + 1);
+        }
         if (fWipe) {
             LogPrintf("Wiping LevelDB in %s\n", path.string());
             leveldb::Status result = leveldb::DestroyDB(path.string(), options);
@@ -77,10 +96,12 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
     leveldb::Status status = leveldb::DB::Open(options, path.string(), &pdb);
     dbwrapper_private::HandleError(status);
     LogPrintf("Opened LevelDB successfully\n");
+    WITH_LOCK(cs_dbwrappers, setDBWrappers.insert(this); );
 }
 
 CDBWrapper::~CDBWrapper()
 {
+    WITH_LOCK(cs_dbwrappers, setDBWrappers.erase(this); );
     delete pdb;
     pdb = nullptr;
     delete options.filter_policy;
@@ -105,6 +126,40 @@ bool CDBWrapper::IsEmpty()
     return !(it->Valid());
 }
 
+DBWrapperStats CDBWrapper::GetStats() const
+{
+    DBWrapperStats stats;
+    stats.strName = strName;
+    stats.nBlockCacheSize = nBlockCacheSize;
+    stats.nWriteBufferSize = options.write_buffer_size;
+    stats.nBloomBitsPerKey = options.filter_policy ? tuning.nBloomBitsPerKey : 0;
+
+    // All the keys are serialized data, lower than a string of 0xff bytes
+    const std::string strEnd(DBWRAPPER_PREALLOC_KEY_SIZE, '\xff');
+    leveldb::Range range{leveldb::Slice(), leveldb::Slice(strEnd)};
+    pdb->GetApproximateSizes(&range, 1, &stats.nApproximateSize);
+
+    std::string strValue;
+    if (pdb->GetProperty("leveldb.approximate-memory-usage", &strValue)) {
+        stats.nMemoryUsage = std::stoull(strValue);
+    }
+    for (int nLevel = 0; pdb->GetProperty("leveldb.num-files-at-level" + std::to_string(nLevel), &strValue); nLevel++) {
+        stats.vFilesPerLevel.push_back(std::stoi(strValue));
+    }
+    pdb->GetProperty("leveldb.stats", &stats.strStats);
+    return stats;
+}
+
+std::vector<DBWrapperStats> GetDBWrapperStats()
+{
+    std::vector<DBWrapperStats> vStats;
+    LOCK(cs_dbwrappers);
+    for (const CDBWrapper* pdbw : setDBWrappers) {
+        vStats.emplace_back(pdbw->GetStats());
+    }
+    return vStats;
+}
+
 CDBIterator::~CDBIterator() { delete piter; }
 bool CDBIterator::Valid() { return piter->Valid(); }
 void CDBIterator::SeekToFirst() { piter->SeekToFirst(); }
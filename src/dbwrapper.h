@@ -12,7 +12,9 @@
 #include "util/system.h"
 #include "version.h"
 
+#include <memory>
 #include <typeindex>
+#include <vector>
 
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
@@ -30,6 +32,39 @@ public:
 
 class CDBWrapper;
 
+/** LevelDB tuning of a database: how its cache size is split, and its bloom filters */
+struct DBTuning
+{
+    //! Share of the cache size holding the uncompressed table blocks, in percent
+    int nBlockCachePercent{50};
+    //! Share of the cache size used by each of the (up to two) write buffers, in percent
+    int nWriteBufferPercent{25};
+    //! Bits per key of the bloom filters of the tables (0: no filters)
+    int nBloomBitsPerKey{10};
+};
+
+//! Tuning of the databases which are read much more than written (evodb)
+static const DBTuning DB_TUNING_READ_HEAVY{80, 10, 10};
+
+/** Statistics of an open database (getdbstats) */
+struct DBWrapperStats
+{
+    std::string strName;
+    size_t nBlockCacheSize{0};
+    size_t nWriteBufferSize{0};
+    int nBloomBitsPerKey{0};
+    //! Approximate size of the tables on disk
+    uint64_t nApproximateSize{0};
+    //! Approximate memory used by the memtables and the block cache
+    uint64_t nMemoryUsage{0};
+    std::vector<int> vFilesPerLevel;
+    //! The leveldb.stats property: the sizes of the levels, and the time and I/O spent compacting them
+    std::string strStats;
+};
+
+/** The statistics of all the open databases */
+std::vector<DBWrapperStats> GetDBWrapperStats();
+
 /** These should be considered an implementation detail of the specific database.
  */
 namespace dbwrapper_private {
@@ -185,6 +220,12 @@ public:
         return true;
     }
 
+    CDataStream GetValue()
+    {
+        leveldb::Slice slValue = piter->value();
+        return CDataStream(slValue.data(), slValue.data() + slValue.size(), SER_DISK, nVersion);
+    }
+
     unsigned int GetValueSize()
     {
         return piter->value().size();
@@ -219,6 +260,15 @@ private:
     //! the version used to serialize data
     int nVersion;
 
+    //! path of the database, relative to the data directory
+    std::string strName;
+
+    //! tuning of the options
+    DBTuning tuning;
+
+    //! capacity of the block cache
+    size_t nBlockCacheSize;
+
 public:
     /**
      * @param[in] path        Location in the filesystem where leveldb data will be stored.
@@ -226,8 +276,10 @@ public:
      * @param[in] fMemory     If true, use leveldb's memory environment.
      * @param[in] fWipe       If true, remove all existing data.
      * @param[in] nVersion    The version used to serialize data.
+     * @param[in] tuning      How the cache size is split, and the bloom filters.
      */
-    CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, int nVersion = CLIENT_VERSION);
+    CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, int nVersion = CLIENT_VERSION,
+               const DBTuning& tuning = DBTuning());
     ~CDBWrapper();
 
     template <typename K>
@@ -340,6 +392,23 @@ public:
         return new CDBIterator(pdb->NewIterator(iteroptions), nVersion);
     }
 
+    //! Iterator over a snapshot of the database (see GetSnapshot)
+    CDBIterator* NewIterator(const leveldb::Snapshot* snapshot)
+    {
+        leveldb::ReadOptions options = iteroptions;
+        options.snapshot = snapshot;
+        return new CDBIterator(pdb->NewIterator(options), nVersion);
+    }
+
+    //! A consistent view of the database, for the iterators made from it on several threads. Released with its last copy.
+    std::shared_ptr<const leveldb::Snapshot> GetSnapshot()
+    {
+        leveldb::DB* db = pdb;
+        return std::shared_ptr<const leveldb::Snapshot>(pdb->GetSnapshot(), [db](const leveldb::Snapshot* snapshot) {
+            db->ReleaseSnapshot(snapshot);
+        });
+    }
+
    /**
     * Return true if the database managed by this class contains no entries.
     */
@@ -382,6 +451,8 @@ public:
         pdb->CompactRange(nullptr, nullptr);
     }
 
+    DBWrapperStats GetStats() const;
+
 };
 
 template<typename CDBTransaction>
@@ -552,6 +623,7 @@ protected:
         ValueHolder(size_t _memoryUsage) : memoryUsage(_memoryUsage) {}
         virtual ~ValueHolder() = default;
         virtual void Write(const CDataStream& ssKey, CommitTarget &parent) = 0;
+        virtual void Copy(const CDataStream& ssKey, CommitTarget &parent) const = 0;
     };
     typedef std::unique_ptr<ValueHolder> ValueHolderPtr;
 
@@ -565,6 +637,10 @@ protected:
             // ValueHolderImpl instance. Commit() clears the write maps, so this ok.
             commitTarget.Write(ssKey, std::move(value));
         }
+        virtual void Copy(const CDataStream& ssKey, CommitTarget &commitTarget) const
+        {
+            commitTarget.Write(ssKey, value);
+        }
         V value;
     };
 
@@ -690,6 +766,20 @@ public:
         Clear();
     }
 
+    /**
+     * Write the content of the transaction to target, leaving it unchanged: it can be read (but not modified)
+     * meanwhile, while target is written on another thread.
+     */
+    void CopyTo(CommitTarget& target) const
+    {
+        for (const auto &k : deletes) {
+            target.Erase(k);
+        }
+        for (const auto &p : writes) {
+            p.second->Copy(p.first, target);
+        }
+    }
+
     bool IsClean()
     {
         return writes.empty() && deletes.empty();
@@ -113,14 +113,13 @@ CDeterministicMNCPtr CDeterministicMNList::GetValidMN(const uint256& proTxHash)
     return dmn;
 }
 
-CDeterministicMNCPtr CDeterministicMNList::GetMNByOperatorKey(const CBLSPublicKey& pubKey)
+CDeterministicMNCPtr CDeterministicMNList::GetMNByOperatorKey(const CBLSPublicKey& pubKey) const
 {
-    for (const auto& p : mnMap) {
-        if (p.second->pdmnState->pubKeyOperator.Get() == pubKey) {
-            return p.second;
-        }
+    // the operator keys of the revoked masternodes are reset to the null key, which isn't unique
+    if (!pubKey.IsValid()) {
+        return nullptr;
     }
-    return nullptr;
+    return GetUniquePropertyMN(pubKey);
 }
 
 CDeterministicMNCPtr CDeterministicMNList::GetMNByCollateral(const COutPoint& collateralOutpoint) const
@@ -218,18 +217,19 @@ std::vector<CDeterministicMNCPtr> CDeterministicMNList::CalculateQuorum(size_t m
 {
     auto scores = CalculateScores(modifier);
 
-    // sort is descending order
-    std::sort(scores.rbegin(), scores.rend(), [](const std::pair<arith_uint256, CDeterministicMNCPtr>& a, std::pair<arith_uint256, CDeterministicMNCPtr>& b) {
+    // descending order (only the top maxSize entries need to be sorted)
+    const size_t nCount = std::min(maxSize, scores.size());
+    std::partial_sort(scores.begin(), scores.begin() + nCount, scores.end(), [](const std::pair<arith_uint256, CDeterministicMNCPtr>& a, const std::pair<arith_uint256, CDeterministicMNCPtr>& b) {
         if (a.first == b.first) {
             // this should actually never happen, but we should stay compatible with how the non deterministic MNs did the sorting
-            return a.second->collateralOutpoint < b.second->collateralOutpoint;
+            return b.second->collateralOutpoint < a.second->collateralOutpoint;
         }
-        return a.first < b.first;
+        return b.first < a.first;
     });
 
     // take top maxSize entries and return it
     std::vector<CDeterministicMNCPtr> result;
-    result.resize(std::min(maxSize, scores.size()));
+    result.resize(nCount);
     for (size_t i = 0; i < result.size(); i++) {
         result[i] = std::move(scores[i].second);
     }
@@ -399,6 +399,7 @@ void CDeterministicMNList::AddMN(const CDeterministicMNCPtr& dmn, bool fBumpTota
     }
     AddUniqueProperty(dmn, dmn->pdmnState->keyIDOwner);
     AddUniqueProperty(dmn, dmn->pdmnState->pubKeyOperator);
+    UpdateStateSets(dmn->proTxHash, nullptr, dmn->pdmnState.get());
 
     if (fBumpTotalCount) {
         // nTotalRegisteredCount acts more like a checkpoint, not as a limit,
@@ -422,6 +423,7 @@ void CDeterministicMNList::UpdateMN(const CDeterministicMNCPtr& oldDmn, const CD
     UpdateUniqueProperty(dmn, oldState->addr, pdmnState->addr);
     UpdateUniqueProperty(dmn, oldState->keyIDOwner, pdmnState->keyIDOwner);
     UpdateUniqueProperty(dmn, oldState->pubKeyOperator, pdmnState->pubKeyOperator);
+    UpdateStateSets(dmn->proTxHash, oldState.get(), pdmnState.get());
 }
 
 void CDeterministicMNList::UpdateMN(const uint256& proTxHash, const CDeterministicMNStateCPtr& pdmnState)
@@ -454,17 +456,34 @@ void CDeterministicMNList::RemoveMN(const uint256& proTxHash)
     }
     DeleteUniqueProperty(dmn, dmn->pdmnState->keyIDOwner);
     DeleteUniqueProperty(dmn, dmn->pdmnState->pubKeyOperator);
+    UpdateStateSets(proTxHash, dmn->pdmnState.get(), nullptr);
 
     mnMap = mnMap.erase(proTxHash);
     mnInternalIdMap = mnInternalIdMap.erase(dmn->GetInternalId());
 }
 
-CDeterministicMNManager::CDeterministicMNManager(CEvoDB& _evoDb) :
-    evoDb(_evoDb)
+void CDeterministicMNList::UpdateStateSets(const uint256& proTxHash, const CDeterministicMNState* oldState, const CDeterministicMNState* newState)
 {
+    auto isUnconfirmed = [](const CDeterministicMNState* s) { return s && s->confirmedHash.IsNull(); };
+    auto isPenalized = [](const CDeterministicMNState* s) { return s && s->nPoSePenalty > 0 && s->nPoSeBanHeight == -1; };
+    if (isUnconfirmed(oldState) != isUnconfirmed(newState)) {
+        mnUnconfirmedSet = isUnconfirmed(newState) ? mnUnconfirmedSet.insert(proTxHash) : mnUnconfirmedSet.erase(proTxHash);
+    }
+    if (isPenalized(oldState) != isPenalized(newState)) {
+        mnPoSePenalizedSet = isPenalized(newState) ? mnPoSePenalizedSet.insert(proTxHash) : mnPoSePenalizedSet.erase(proTxHash);
+    }
 }
 
-bool CDeterministicMNManager::ProcessBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& _state, bool fJustCheck)
+CDeterministicMNManager::CDeterministicMNManager(CEvoDB& _evoDb, int _nSnapshotInterval, size_t nListsCacheSize) :
+    evoDb(_evoDb),
+    nSnapshotInterval(std::max(1, _nSnapshotInterval)),
+    nListDiffsCacheSize(nSnapshotInterval * DISK_SNAPSHOTS),
+    mnListsLRUCache(std::max((size_t)1, nListsCacheSize))
+{
+}
+
+bool CDeterministicMNManager::ProcessBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& _state, bool fJustCheck,
+                                           const uint256& candidateKey)
 {
     int nHeight = pindex->nHeight;
     if (!IsDIP3Enforced(nHeight)) {
@@ -478,12 +497,20 @@ bool CDeterministicMNManager::ProcessBlock(const CBlock& block, const CBlockInde
     try {
         LOCK(cs);
 
-        if (!BuildNewListFromBlock(block, pindex->pprev, _state, newList, true)) {
+        const bool fCached = !fJustCheck && !candidateKey.IsNull() && candidateKey == lastCandidateList.first;
+        if (fCached) {
+            newList = std::move(lastCandidateList.second);
+        }
+        lastCandidateList = std::make_pair(UINT256_ZERO, CDeterministicMNList());
+        if (!fCached && !BuildNewListFromBlock(block, pindex->pprev, _state, newList, true)) {
             // pass the state returned by the function above
             return false;
         }
 
         if (fJustCheck) {
+            if (!candidateKey.IsNull()) {
+                lastCandidateList = std::make_pair(candidateKey, newList);
+            }
             return true;
         }
 
@@ -497,7 +524,7 @@ bool CDeterministicMNManager::ProcessBlock(const CBlock& block, const CBlockInde
         diff = oldList.BuildDiff(newList);
 
         evoDb.Write(std::make_pair(DB_LIST_DIFF, newList.GetBlockHash()), diff);
-        if ((nHeight % DISK_SNAPSHOT_PERIOD) == 0 || oldList.GetHeight() == -1) {
+        if ((nHeight % nSnapshotInterval) == 0 || oldList.GetHeight() == -1) {
             evoDb.Write(std::make_pair(DB_LIST_SNAPSHOT, newList.GetBlockHash()), newList);
             mnListsCache.emplace(newList.GetBlockHash(), newList);
             LogPrintf("CDeterministicMNManager::%s -- Wrote snapshot. nHeight=%d, mapCurMNs.allMNsCount=%d\n",
@@ -547,6 +574,10 @@ bool CDeterministicMNManager::UndoBlock(const CBlock& block, const CBlockIndex*
 
         mnListsCache.erase(blockHash);
         mnListDiffsCache.erase(blockHash);
+        mnListsLRUCache.erase(blockHash);
+        for (const auto& p : Params().GetConsensus().llmqs) {
+            quorumMembersCache.erase(std::make_pair(p.first, blockHash));
+        }
     }
 
     if (diff.HasChanges()) {
@@ -580,11 +611,7 @@ bool CDeterministicMNManager::BuildNewListFromBlock(const CBlock& block, const C
     // we iterate the oldList here and update the newList
     // this is only valid as long these have not diverged at this point, which is the case as long as we don't add
     // code above this loop that modifies newList
-    oldList.ForEachMN(false, [&](const CDeterministicMNCPtr& dmn) {
-        if (!dmn->pdmnState->confirmedHash.IsNull()) {
-            // already confirmed
-            return;
-        }
+    oldList.ForEachUnconfirmedMN([&](const CDeterministicMNCPtr& dmn) {
         // this works on the previous block, so confirmation will happen one block after nMasternodeMinimumConfirmations
         // has been reached, but the block hash will then point to the block at nMasternodeMinimumConfirmations
         int nConfirmations = pindexPrev->nHeight - dmn->pdmnState->nRegisteredHeight;
@@ -826,13 +853,10 @@ void CDeterministicMNManager::HandleQuorumCommitment(llmq::CFinalCommitment& qc,
 void CDeterministicMNManager::DecreasePoSePenalties(CDeterministicMNList& mnList)
 {
     std::vector<uint256> toDecrease;
-    toDecrease.reserve(mnList.GetValidMNsCount() / 10);
     // only iterate and decrease for valid ones (not PoSe banned yet)
     // if a MN ever reaches the maximum, it stays in PoSe banned state until revived
-    mnList.ForEachMN(true, [&](const CDeterministicMNCPtr& dmn) {
-        if (dmn->pdmnState->nPoSePenalty > 0 && dmn->pdmnState->nPoSeBanHeight == -1) {
-            toDecrease.emplace_back(dmn->proTxHash);
-        }
+    mnList.ForEachPoSePenalizedMN([&](const CDeterministicMNCPtr& dmn) {
+        toDecrease.emplace_back(dmn->proTxHash);
     });
 
     for (const auto& proTxHash : toDecrease) {
@@ -854,6 +878,9 @@ CDeterministicMNList CDeterministicMNManager::GetListForBlock(const CBlockIndex*
 
     while (true) {
         // try using cache before reading from disk
+        if (mnListsLRUCache.get(pindex->GetBlockHash(), snapshot)) {
+            break;
+        }
         auto itLists = mnListsCache.find(pindex->GetBlockHash());
         if (itLists != mnListsCache.end()) {
             snapshot = itLists->second;
@@ -893,6 +920,10 @@ CDeterministicMNList CDeterministicMNManager::GetListForBlock(const CBlockIndex*
         pindex = pindex->pprev;
     }
 
+    // A chain of diffs longer than the snapshot interval means that the periodic
+    // snapshots are missing (e.g. written with a larger interval): compact it,
+    // writing them now, so that the next walks back stop there.
+    const bool fCompact = listDiffIndexes.size() > (size_t)nSnapshotInterval;
     for (const auto& diffIndex : listDiffIndexes) {
         const auto& diff = mnListDiffsCache.at(diffIndex->GetBlockHash());
         if (diff.HasChanges()) {
@@ -901,7 +932,13 @@ CDeterministicMNList CDeterministicMNManager::GetListForBlock(const CBlockIndex*
             snapshot.SetBlockHash(diffIndex->GetBlockHash());
             snapshot.SetHeight(diffIndex->nHeight);
         }
+        if (fCompact && (diffIndex->nHeight % nSnapshotInterval) == 0) {
+            evoDb.Write(std::make_pair(DB_LIST_SNAPSHOT, snapshot.GetBlockHash()), snapshot);
+            LogPrint(BCLog::MASTERNODE, "CDeterministicMNManager::%s -- Wrote compacted snapshot. nHeight=%d\n",
+                     __func__, diffIndex->nHeight);
+        }
     }
+    mnListsLRUCache.insert(snapshot.GetBlockHash(), snapshot);
 
     if (tipIndex) {
         // always keep a snapshot for the tip
@@ -924,6 +961,33 @@ CDeterministicMNList CDeterministicMNManager::GetListAtChainTip()
     return GetListForBlock(tipIndex);
 }
 
+size_t CDeterministicMNManager::DynamicMemoryUsage() const
+{
+    LOCK(cs);
+    size_t nUsage = memusage::DynamicUsage(mnListsCache) + memusage::DynamicUsage(mnListDiffsCache) +
+                    mnListsLRUCache.DynamicMemoryUsage() + quorumMembersCache.DynamicMemoryUsage();
+    // The lists share the masternodes (and the nodes of their maps): each masternode is counted once,
+    // and the entries of each list are an upper bound of the nodes of its maps.
+    std::set<const CDeterministicMN*> setMNs;
+    std::set<const CDeterministicMNState*> setStates;
+    const auto countMN = [&](const CDeterministicMNCPtr& dmn) {
+        if (setMNs.emplace(dmn.get()).second) nUsage += memusage::DynamicUsage(dmn);
+        if (setStates.emplace(dmn->pdmnState.get()).second) nUsage += memusage::DynamicUsage(dmn->pdmnState);
+    };
+    for (const auto& p : mnListsCache) {
+        nUsage += p.second.GetAllMNsCount() * memusage::MallocUsage(sizeof(std::pair<uint256, CDeterministicMNCPtr>));
+        p.second.ForEachMN(false, countMN);
+    }
+    for (const auto& p : mnListDiffsCache) {
+        const CDeterministicMNListDiff& diff = p.second;
+        nUsage += memusage::DynamicUsage(diff.addedMNs) + memusage::DynamicUsage(diff.updatedMNs) + memusage::DynamicUsage(diff.removedMns);
+        for (const auto& dmn : diff.addedMNs) {
+            countMN(dmn);
+        }
+    }
+    return nUsage;
+}
+
 bool CDeterministicMNManager::IsDIP3Enforced(int nHeight) const
 {
     return Params().GetConsensus().NetworkUpgradeActive(nHeight, Consensus::UPGRADE_V6_0);
@@ -953,7 +1017,7 @@ void CDeterministicMNManager::CleanupCache(int nHeight)
     std::vector<uint256> toDeleteLists;
     std::vector<uint256> toDeleteDiffs;
     for (const auto& p : mnListsCache) {
-        if (p.second.GetHeight() + LIST_DIFFS_CACHE_SIZE < nHeight) {
+        if (p.second.GetHeight() + nListDiffsCacheSize < nHeight) {
             toDeleteLists.emplace_back(p.first);
             continue;
         }
@@ -963,7 +1027,7 @@ void CDeterministicMNManager::CleanupCache(int nHeight)
         mnListsCache.erase(h);
     }
     for (const auto& p : mnListDiffsCache) {
-        if (p.second.nHeight + LIST_DIFFS_CACHE_SIZE < nHeight) {
+        if (p.second.nHeight + nListDiffsCacheSize < nHeight) {
             toDeleteDiffs.emplace_back(p.first);
         }
     }
@@ -975,9 +1039,22 @@ void CDeterministicMNManager::CleanupCache(int nHeight)
 std::vector<CDeterministicMNCPtr> CDeterministicMNManager::GetAllQuorumMembers(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum)
 {
     auto& params = Params().GetConsensus().llmqs.at(llmqType);
+    const auto& cacheKey = std::make_pair(llmqType, pindexQuorum->GetBlockHash());
+    std::vector<CDeterministicMNCPtr> members;
+    {
+        LOCK(cs);
+        if (quorumMembersCache.get(cacheKey, members)) {
+            return members;
+        }
+    }
+
     auto allMns = GetListForBlock(pindexQuorum);
     auto modifier = ::SerializeHash(std::make_pair(static_cast<uint8_t>(llmqType), pindexQuorum->GetBlockHash()));
-    return allMns.CalculateQuorum(params.size, modifier);
+    members = allMns.CalculateQuorum(params.size, modifier);
+
+    LOCK(cs);
+    quorumMembersCache.insert(cacheKey, members);
+    return members;
 }
 
 
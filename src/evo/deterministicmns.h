@@ -16,10 +16,12 @@
 #include "saltedhasher.h"
 #include "serialize.h"
 #include "sync.h"
+#include "unordered_lru_cache.h"
 #include "version.h"
 
 #include <immer/map.hpp>
 #include <immer/map_transient.hpp>
+#include <immer/set.hpp>
 
 #include <unordered_map>
 
@@ -268,6 +270,7 @@ public:
     typedef immer::map<uint256, CDeterministicMNCPtr> MnMap;
     typedef immer::map<uint64_t, uint256> MnInternalIdMap;
     typedef immer::map<uint256, std::pair<uint256, uint32_t> > MnUniquePropertyMap;
+    typedef immer::set<uint256> MnSet;
 
 private:
     uint256 blockHash;
@@ -280,6 +283,11 @@ private:
     // we keep track of this as checking for duplicates would otherwise be painfully slow
     MnUniquePropertyMap mnUniquePropertyMap;
 
+    // MNs whose registration isn't confirmed yet, and valid MNs with a PoSe penalty (decreased at every block)
+    // we keep track of these as they are updated by every block, which would otherwise iterate over all the MNs
+    MnSet mnUnconfirmedSet;
+    MnSet mnPoSePenalizedSet;
+
 public:
     CDeterministicMNList() {}
     explicit CDeterministicMNList(const uint256& _blockHash, int _height, uint32_t _totalRegisteredCount) :
@@ -307,6 +315,8 @@ public:
         mnMap = MnMap();
         mnUniquePropertyMap = MnUniquePropertyMap();
         mnInternalIdMap = MnInternalIdMap();
+        mnUnconfirmedSet = MnSet();
+        mnPoSePenalizedSet = MnSet();
 
         s >> blockHash;
         s >> nHeight;
@@ -344,6 +354,24 @@ public:
         }
     }
 
+    //! Calls cb for the MNs without a confirmed hash
+    template <typename Callback>
+    void ForEachUnconfirmedMN(Callback&& cb) const
+    {
+        for (const auto& proTxHash : mnUnconfirmedSet) {
+            cb(GetMN(proTxHash));
+        }
+    }
+
+    //! Calls cb for the MNs with a PoSe penalty, which aren't PoSe banned
+    template <typename Callback>
+    void ForEachPoSePenalizedMN(Callback&& cb) const
+    {
+        for (const auto& proTxHash : mnPoSePenalizedSet) {
+            cb(GetMN(proTxHash));
+        }
+    }
+
 public:
     const uint256& GetBlockHash() const      { return blockHash; }
     int GetHeight() const                    { return nHeight; }
@@ -365,7 +393,7 @@ public:
     }
     CDeterministicMNCPtr GetMN(const uint256& proTxHash) const;
     CDeterministicMNCPtr GetValidMN(const uint256& proTxHash) const;
-    CDeterministicMNCPtr GetMNByOperatorKey(const CBLSPublicKey& pubKey);
+    CDeterministicMNCPtr GetMNByOperatorKey(const CBLSPublicKey& pubKey) const;
     CDeterministicMNCPtr GetMNByCollateral(const COutPoint& collateralOutpoint) const;
     CDeterministicMNCPtr GetValidMNByCollateral(const COutPoint& collateralOutpoint) const;
     CDeterministicMNCPtr GetMNByService(const CService& service) const;
@@ -447,6 +475,9 @@ public:
     }
 
 private:
+    //! Update mnUnconfirmedSet and mnPoSePenalizedSet for the state change of a MN (null for the added and removed ones)
+    void UpdateStateSets(const uint256& proTxHash, const CDeterministicMNState* oldState, const CDeterministicMNState* newState);
+
     template <typename T>
     void AddUniqueProperty(const CDeterministicMNCPtr& dmn, const T& v)
     {
@@ -551,11 +582,13 @@ public:
     }
 };
 
+static const int DEFAULT_DMN_SNAPSHOT_INTERVAL = 1440; // once per day
+static const size_t DEFAULT_DMN_LISTS_CACHE_SIZE = 64;
+
 class CDeterministicMNManager
 {
-    static const int DISK_SNAPSHOT_PERIOD = 1440; // once per day
     static const int DISK_SNAPSHOTS = 3; // keep cache for 3 disk snapshots to have 2 full days covered
-    static const int LIST_DIFFS_CACHE_SIZE = DISK_SNAPSHOT_PERIOD * DISK_SNAPSHOTS;
+    static const size_t QUORUM_MEMBERS_CACHE_SIZE = 64; // members of the most recently requested quorums (of any type)
 
 public:
     mutable RecursiveMutex cs;
@@ -563,14 +596,29 @@ public:
 private:
     CEvoDB& evoDb;
 
+    // blocks between two full lists written to disk (the other blocks only have the diff)
+    const int nSnapshotInterval;
+    const int nListDiffsCacheSize;
+
     std::unordered_map<uint256, CDeterministicMNList, StaticSaltedHasher> mnListsCache;
     std::unordered_map<uint256, CDeterministicMNListDiff, StaticSaltedHasher> mnListDiffsCache;
+    // most recently requested lists (at any height). Copies share the underlying immer maps.
+    unordered_lru_cache<uint256, CDeterministicMNList, StaticSaltedHasher> mnListsLRUCache;
+    // <llmqType, quorumHash> -> members, as calculated by GetAllQuorumMembers
+    unordered_lru_cache<std::pair<Consensus::LLMQType, uint256>, std::vector<CDeterministicMNCPtr>, StaticSaltedHasher, QUORUM_MEMBERS_CACHE_SIZE> quorumMembersCache;
     const CBlockIndex* tipIndex{nullptr};
+    // <candidate key, new list> of the last block processed with fJustCheck
+    std::pair<uint256, CDeterministicMNList> lastCandidateList;
 
 public:
-    explicit CDeterministicMNManager(CEvoDB& _evoDb);
-
-    bool ProcessBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state, bool fJustCheck);
+    explicit CDeterministicMNManager(CEvoDB& _evoDb,
+                                     int _nSnapshotInterval = DEFAULT_DMN_SNAPSHOT_INTERVAL,
+                                     size_t nListsCacheSize = DEFAULT_DMN_LISTS_CACHE_SIZE);
+
+    // candidateKey identifies the parent and transactions of the block: the list built for a check (fJustCheck)
+    // is kept, and reused by the connection of the same candidate
+    bool ProcessBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state, bool fJustCheck,
+                      const uint256& candidateKey = UINT256_ZERO);
     bool UndoBlock(const CBlock& block, const CBlockIndex* pindex);
 
     void SetTipIndex(const CBlockIndex* pindex);
@@ -588,6 +636,9 @@ public:
     bool IsDIP3Enforced(int nHeight) const;
     bool IsDIP3Enforced() const;
 
+    // Estimated memory usage of the cached lists and diffs, and of the quorum members cache
+    size_t DynamicMemoryUsage() const;
+
     // Whether Legacy MNs are disabled at provided height, or at the chain-tip
     bool LegacyMNObsolete(int nHeight) const;
     bool LegacyMNObsolete() const;
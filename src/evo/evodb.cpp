@@ -34,9 +34,10 @@ void CEvoDBScopedCommitter::Rollback()
     evoDB.RollbackCurTransaction();
 }
 
-CEvoDB::CEvoDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(fMemory ? "" : (GetDataDir() / "evodb"), nCacheSize, fMemory, fWipe, CLIENT_VERSION | ADDRV2_FORMAT),
+CEvoDB::CEvoDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(fMemory ? "" : (GetDataDir() / "evodb"), nCacheSize, fMemory, fWipe, CLIENT_VERSION | ADDRV2_FORMAT, DB_TUNING_READ_HEAVY),
                                                               rootBatch(CLIENT_VERSION | ADDRV2_FORMAT),
-                                                              rootDBTransaction(db, rootBatch, CLIENT_VERSION | ADDRV2_FORMAT),
+                                                              flushingDBTransaction(db, rootBatch, CLIENT_VERSION | ADDRV2_FORMAT),
+                                                              rootDBTransaction(flushingDBTransaction, flushingDBTransaction, CLIENT_VERSION | ADDRV2_FORMAT),
                                                               curDBTransaction(rootDBTransaction, rootDBTransaction, CLIENT_VERSION | ADDRV2_FORMAT)
 {
 }
@@ -55,13 +56,42 @@ void CEvoDB::RollbackCurTransaction()
 
 bool CEvoDB::CommitRootTransaction()
 {
+    LOCK(cs);
     assert(curDBTransaction.IsClean());
+    assert(!fBackgroundCommit);
     rootDBTransaction.Commit();
+    flushingDBTransaction.Commit();
     bool ret = db.WriteBatch(rootBatch);
     rootBatch.Clear();
     return ret;
 }
 
+void CEvoDB::BeginBackgroundCommit()
+{
+    LOCK(cs);
+    assert(curDBTransaction.IsClean());
+    assert(!fBackgroundCommit);
+    rootDBTransaction.Commit();
+    fBackgroundCommit = true;
+}
+
+bool CEvoDB::WriteBackgroundCommit()
+{
+    // The flushing transaction is only changed by the Begin and End calls, so it's only read meanwhile
+    CDBBatch batch(CLIENT_VERSION | ADDRV2_FORMAT);
+    flushingDBTransaction.CopyTo(batch);
+    return db.WriteBatch(batch);
+}
+
+void CEvoDB::EndBackgroundCommit()
+{
+    LOCK(cs);
+    if (fBackgroundCommit) {
+        flushingDBTransaction.Clear();
+        fBackgroundCommit = false;
+    }
+}
+
 bool CEvoDB::VerifyBestBlock(const uint256& hash)
 {
     uint256 hashBestBlock;
@@ -28,6 +28,11 @@ public:
     void Rollback();
 };
 
+//! -evodbcache default (MiB)
+static const int64_t DEFAULT_EVODB_CACHE = 64;
+//! min. -evodbcache (MiB)
+static const int64_t MIN_EVODB_CACHE = 4;
+
 class CEvoDB
 {
 public:
@@ -36,12 +41,17 @@ public:
 private:
     CDBWrapper db;
 
-    typedef CDBTransaction<CDBWrapper, CDBBatch> RootTransaction;
+    // The root transaction is committed to the flushing one, which stays readable while it's written (in the
+    // background with the chainstate, see BeginBackgroundCommit)
+    typedef CDBTransaction<CDBWrapper, CDBBatch> FlushingTransaction;
+    typedef CDBTransaction<FlushingTransaction, FlushingTransaction> RootTransaction;
     typedef CDBTransaction<RootTransaction, RootTransaction> CurTransaction;
 
     CDBBatch rootBatch;
+    FlushingTransaction flushingDBTransaction;
     RootTransaction rootDBTransaction;
     CurTransaction curDBTransaction;
+    bool fBackgroundCommit GUARDED_BY(cs){false};
 
 public:
     explicit CEvoDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
@@ -93,11 +103,22 @@ public:
 
     size_t GetMemoryUsage()
     {
-        return rootDBTransaction.GetMemoryUsage();
+        return rootDBTransaction.GetMemoryUsage() + flushingDBTransaction.GetMemoryUsage();
     }
 
+    //! Write the root transaction to the database. There must be no background commit in progress.
     bool CommitRootTransaction();
 
+    /**
+     * Move the root transaction to the flushing one, to be written by WriteBackgroundCommit on another thread.
+     * It's still read until EndBackgroundCommit.
+     */
+    void BeginBackgroundCommit();
+    //! Write the flushing transaction to the database. Called without cs, between the Begin and End calls.
+    bool WriteBackgroundCommit();
+    //! Drop the flushing transaction, once written by WriteBackgroundCommit. No-op without a background commit.
+    void EndBackgroundCommit();
+
     bool VerifyBestBlock(const uint256& hash);
     void WriteBestBlock(const uint256& hash);
 
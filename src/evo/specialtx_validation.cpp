@@ -6,6 +6,7 @@
 #include "evo/specialtx_validation.h"
 
 #include "chain.h"
+#include "checkqueue.h"
 #include "coins.h"
 #include "chainparams.h"
 #include "clientversion.h"
@@ -18,6 +19,28 @@
 #include "primitives/block.h"
 #include "script/standard.h"
 #include "spork.h"
+#include "util/threadnames.h"
+
+static CCheckQueue<CProTxSigCheck> protxsigcheckqueue(32);
+
+void ThreadProTxSigCheck()
+{
+    util::ThreadRename("pivx-protxch");
+    protxsigcheckqueue.Thread();
+}
+
+bool CProTxSigCheck::operator()()
+{
+    switch (type) {
+        case ECDSA_HASH:
+            return CHashSigner::VerifyHash(hash, keyID, vchSig, strError);
+        case ECDSA_MESSAGE:
+            return CMessageSigner::VerifyMessage(keyID, vchSig, strMessage, strError);
+        case BLS_HASH:
+            return blsSig.VerifyInsecure(blsPubKey, hash);
+    }
+    return false;
+}
 
 /* -- Helper static functions -- */
 
@@ -49,8 +72,12 @@ static bool CheckService(const CService& addr, CValidationState& state)
 }
 
 template <typename Payload>
-static bool CheckHashSig(const Payload& pl, const CKeyID& keyID, CValidationState& state)
+static bool CheckHashSig(const Payload& pl, const CKeyID& keyID, CValidationState& state, std::vector<CProTxSigCheck>* pvSigChecks)
 {
+    if (pvSigChecks) {
+        pvSigChecks->emplace_back(::SerializeHash(pl), keyID, pl.vchSig);
+        return true;
+    }
     std::string strError;
     if (!CHashSigner::VerifyHash(::SerializeHash(pl), keyID, pl.vchSig, strError)) {
         return state.DoS(100, false, REJECT_INVALID, "bad-protx-sig", false, strError);
@@ -59,8 +86,12 @@ static bool CheckHashSig(const Payload& pl, const CKeyID& keyID, CValidationStat
 }
 
 template <typename Payload>
-static bool CheckHashSig(const Payload& pl, const CBLSPublicKey& pubKey, CValidationState& state)
+static bool CheckHashSig(const Payload& pl, const CBLSPublicKey& pubKey, CValidationState& state, std::vector<CProTxSigCheck>* pvSigChecks)
 {
+    if (pvSigChecks) {
+        pvSigChecks->emplace_back(::SerializeHash(pl), pubKey, pl.sig);
+        return true;
+    }
     if (!pl.sig.VerifyInsecure(pubKey, ::SerializeHash(pl))) {
         return state.DoS(100, false, REJECT_INVALID, "bad-protx-sig", false);
     }
@@ -68,8 +99,12 @@ static bool CheckHashSig(const Payload& pl, const CBLSPublicKey& pubKey, CValida
 }
 
 template <typename Payload>
-static bool CheckStringSig(const Payload& pl, const CKeyID& keyID, CValidationState& state)
+static bool CheckStringSig(const Payload& pl, const CKeyID& keyID, CValidationState& state, std::vector<CProTxSigCheck>* pvSigChecks)
 {
+    if (pvSigChecks) {
+        pvSigChecks->emplace_back(pl.MakeSignString(), keyID, pl.vchSig);
+        return true;
+    }
     std::string strError;
     if (!CMessageSigner::VerifyMessage(keyID, pl.vchSig, pl.MakeSignString(), strError)) {
         return state.DoS(100, false, REJECT_INVALID, "bad-protx-sig", false, strError);
@@ -106,7 +141,8 @@ static bool CheckCollateralOut(const CTxOut& out, const ProRegPL& pl, CValidatio
 }
 
 // Provider Register Payload
-static bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, const CCoinsViewCache* view, CValidationState& state)
+static bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, const CCoinsViewCache* view, CValidationState& state,
+                          std::vector<CProTxSigCheck>* pvSigChecks)
 {
 
     ProRegPL pl;
@@ -159,7 +195,7 @@ static bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev,
             return state.DoS(10, false, REJECT_INVALID, "bad-protx-collateral-pkh");
         }
         // collateral is not part of this ProRegTx, so we must verify ownership of the collateral
-        if (!CheckStringSig(pl, *keyForPayloadSig, state)) {
+        if (!CheckStringSig(pl, *keyForPayloadSig, state, pvSigChecks)) {
             // pass the state returned by the function above
             return false;
         }
@@ -188,7 +224,8 @@ static bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev,
 }
 
 // Provider Update Service Payload
-static bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state)
+static bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state,
+                             std::vector<CProTxSigCheck>* pvSigChecks)
 {
 
     ProUpServPL pl;
@@ -231,7 +268,7 @@ static bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPr
         }
 
         // we can only check the signature if pindexPrev != nullptr and the MN is known
-        if (!CheckHashSig(pl, mn->pdmnState->pubKeyOperator.Get(), state)) {
+        if (!CheckHashSig(pl, mn->pdmnState->pubKeyOperator.Get(), state, pvSigChecks)) {
             // pass the state returned by the function above
             return false;
         }
@@ -241,7 +278,8 @@ static bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPr
 }
 
 // Provider Update Registrar Payload
-static bool CheckProUpRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, const CCoinsViewCache* view, CValidationState& state)
+static bool CheckProUpRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, const CCoinsViewCache* view, CValidationState& state,
+                            std::vector<CProTxSigCheck>* pvSigChecks)
 {
 
     ProUpRegPL pl;
@@ -308,7 +346,7 @@ static bool CheckProUpRegTx(const CTransaction& tx, const CBlockIndex* pindexPre
             }
         }
 
-        if (!CheckHashSig(pl, dmn->pdmnState->keyIDOwner, state)) {
+        if (!CheckHashSig(pl, dmn->pdmnState->keyIDOwner, state, pvSigChecks)) {
             // pass the state returned by the function above
             return false;
         }
@@ -319,7 +357,8 @@ static bool CheckProUpRegTx(const CTransaction& tx, const CBlockIndex* pindexPre
 }
 
 // Provider Update Revoke Payload
-static bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state)
+static bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state,
+                            std::vector<CProTxSigCheck>* pvSigChecks)
 {
 
     ProUpRevPL pl;
@@ -339,7 +378,7 @@ static bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPre
         if (!dmn)
             return state.DoS(100, false, REJECT_INVALID, "bad-protx-hash");
 
-        if (!CheckHashSig(pl, dmn->pdmnState->pubKeyOperator.Get(), state)) {
+        if (!CheckHashSig(pl, dmn->pdmnState->pubKeyOperator.Get(), state, pvSigChecks)) {
             // pass the state returned by the function above
             return false;
         }
@@ -481,7 +520,8 @@ static bool CheckSpecialTxBasic(const CTransaction& tx, CValidationState& state)
 // - pindexPrev=null: CheckBlock-->CheckSpecialTxNoContext
 // - pindexPrev=chainActive.Tip: AcceptToMemoryPoolWorker-->CheckSpecialTx
 // - pindexPrev=pindex->pprev: ConnectBlock-->ProcessSpecialTxsInBlock-->CheckSpecialTx
-bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, const CCoinsViewCache* view, CValidationState& state)
+bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, const CCoinsViewCache* view, CValidationState& state,
+                    std::vector<CProTxSigCheck>* pvSigChecks)
 {
     AssertLockHeld(cs_main);
 
@@ -504,19 +544,19 @@ bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, const
         }
         case CTransaction::TxType::PROREG: {
             // provider-register
-            return CheckProRegTx(tx, pindexPrev, view, state);
+            return CheckProRegTx(tx, pindexPrev, view, state, pvSigChecks);
         }
         case CTransaction::TxType::PROUPSERV: {
             // provider-update-service
-            return CheckProUpServTx(tx, pindexPrev, state);
+            return CheckProUpServTx(tx, pindexPrev, state, pvSigChecks);
         }
         case CTransaction::TxType::PROUPREG: {
             // provider-update-registrar
-            return CheckProUpRegTx(tx, pindexPrev, view, state);
+            return CheckProUpRegTx(tx, pindexPrev, view, state, pvSigChecks);
         }
         case CTransaction::TxType::PROUPREV: {
             // provider-update-revoke
-            return CheckProUpRevTx(tx, pindexPrev, state);
+            return CheckProUpRevTx(tx, pindexPrev, state, pvSigChecks);
         }
         case CTransaction::TxType::LLMQCOMM: {
             // quorum commitment
@@ -534,28 +574,93 @@ bool CheckSpecialTxNoContext(const CTransaction& tx, CValidationState& state)
 }
 
 
+// Serially verify the payload signatures, in order, and report the first invalid one.
+static bool CheckProTxSigs(std::vector<CProTxSigCheck>& vSigChecks, CValidationState& state)
+{
+    for (CProTxSigCheck& check : vSigChecks) {
+        if (!check()) {
+            return state.DoS(100, false, REJECT_INVALID, "bad-protx-sig", false, check.GetError());
+        }
+    }
+    return true;
+}
+
+// Key of a candidate block: its parent and transactions (the header and signature of a block template change after its check)
+static uint256 CalcCandidateBlockKey(const CBlock& block, const CBlockIndex* pindexPrev)
+{
+    CHashWriter hw(CLIENT_VERSION, SER_GETHASH);
+    hw << (pindexPrev ? pindexPrev->GetBlockHash() : UINT256_ZERO);
+    for (const CTransactionRef& tx : block.vtx) {
+        hw << tx->GetHash();
+    }
+    return hw.GetHash();
+}
+
+// Key of the last block whose special txes passed the checks with fJustCheck
+static uint256 lastCheckedCandidate GUARDED_BY(cs_main);
+
 bool ProcessSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex, const CCoinsViewCache* view, CValidationState& state, bool fJustCheck)
 {
     AssertLockHeld(cs_main);
 
-    // check special txes
-    for (const CTransactionRef& tx: block.vtx) {
-        if (!CheckSpecialTx(*tx, pindex->pprev, view, state)) {
+    // the connection of the block template just checked doesn't need to check its special txes again
+    const uint256 candidateKey = CalcCandidateBlockKey(block, pindex->pprev);
+    const bool fChecked = !fJustCheck && candidateKey == lastCheckedCandidate;
+    lastCheckedCandidate.SetNull();
+
+    // check special txes (deferring the payload signature checks)
+    std::vector<CProTxSigCheck> vSigChecks;
+    for (size_t i = 0; i < block.vtx.size() && !fChecked; i++) {
+        if (!CheckSpecialTx(*block.vtx[i], pindex->pprev, view, state, &vSigChecks)) {
+            // an invalid signature deferred before this failure would have been reported first
+            CValidationState sigState;
+            if (!CheckProTxSigs(vSigChecks, sigState)) {
+                state = sigState;
+            }
             // pass the state returned by the function above
             return false;
         }
     }
 
+    // verify the payload signatures on the worker threads (if any)
+    if (vSigChecks.size() > 1 && nScriptCheckThreads) {
+        std::vector<CProTxSigCheck> vQueued(vSigChecks);
+        CCheckQueueControl<CProTxSigCheck> control(&protxsigcheckqueue);
+        control.Add(vQueued);
+        if (!control.Wait()) {
+            // re-check serially to report the first invalid signature
+            if (!CheckProTxSigs(vSigChecks, state)) {
+                return false;
+            }
+            return state.DoS(100, error("%s: parallel payload signature check failed", __func__),
+                             REJECT_INVALID, "bad-protx-sig");
+        }
+    } else if (!CheckProTxSigs(vSigChecks, state)) {
+        // pass the state returned by the function above
+        return false;
+    }
+
+    int64_t nTimeStart = GetTimeMicros();
     if (!llmq::quorumBlockProcessor->ProcessBlock(block, pindex, state, fJustCheck)) {
         // pass the state returned by the function above
         return false;
     }
+    int64_t nTime1 = GetTimeMicros();
 
-    if (!deterministicMNManager->ProcessBlock(block, pindex, state, fJustCheck)) {
+    if (!deterministicMNManager->ProcessBlock(block, pindex, state, fJustCheck, candidateKey)) {
         // pass the state returned by the function above
         return false;
     }
 
+    if (fJustCheck) {
+        lastCheckedCandidate = candidateKey;
+    }
+
+    if (!fJustCheck) {
+        AddBlockStageTime(BlockStage::LLMQ, nTime1 - nTimeStart);
+        AddBlockStageTime(BlockStage::DETERMINISTIC_MNS, GetTimeMicros() - nTime1);
+    }
+
     return true;
 }
 
@@ -7,6 +7,7 @@
 #define PIVX_SPECIALTX_H
 
 #include "llmq/quorums_commitment.h"
+#include "pubkey.h"
 #include "validation.h" // cs_main needed by CheckLLMQCommitment (!TODO: remove)
 #include "version.h"
 
@@ -20,16 +21,76 @@ class uint256;
 /** The maximum allowed size of the extraPayload (for any TxType) */
 static const unsigned int MAX_SPECIALTX_EXTRAPAYLOAD = 10000;
 
+/**
+ * Closure representing the verification of a ProTx payload signature
+ * (ECDSA over the payload hash or sign-string, or BLS over the payload hash).
+ * Collected by CheckSpecialTx, when connecting a block, to be verified in parallel.
+ */
+class CProTxSigCheck
+{
+public:
+    enum SigType : uint8_t {
+        ECDSA_HASH,
+        ECDSA_MESSAGE,
+        BLS_HASH,
+    };
+
+private:
+    SigType type{ECDSA_HASH};
+    uint256 hash;
+    std::string strMessage;
+    CKeyID keyID;
+    std::vector<unsigned char> vchSig;
+    CBLSPublicKey blsPubKey;
+    CBLSSignature blsSig;
+    std::string strError;
+
+public:
+    CProTxSigCheck() {}
+    // ECDSA signature of a hash
+    CProTxSigCheck(const uint256& _hash, const CKeyID& _keyID, const std::vector<unsigned char>& _vchSig) :
+        type(ECDSA_HASH), hash(_hash), keyID(_keyID), vchSig(_vchSig) {}
+    // ECDSA signature of a message
+    CProTxSigCheck(const std::string& _strMessage, const CKeyID& _keyID, const std::vector<unsigned char>& _vchSig) :
+        type(ECDSA_MESSAGE), strMessage(_strMessage), keyID(_keyID), vchSig(_vchSig) {}
+    // BLS signature of a hash
+    CProTxSigCheck(const uint256& _hash, const CBLSPublicKey& _pubKey, const CBLSSignature& _sig) :
+        type(BLS_HASH), hash(_hash), blsPubKey(_pubKey), blsSig(_sig) {}
+
+    bool operator()();
+
+    void swap(CProTxSigCheck& check)
+    {
+        std::swap(type, check.type);
+        std::swap(hash, check.hash);
+        strMessage.swap(check.strMessage);
+        std::swap(keyID, check.keyID);
+        vchSig.swap(check.vchSig);
+        std::swap(blsPubKey, check.blsPubKey);
+        std::swap(blsSig, check.blsSig);
+        strError.swap(check.strError);
+    }
+
+    const std::string& GetError() const { return strError; }
+};
+
+/** Run an instance of the ProTx payload signature checking thread */
+void ThreadProTxSigCheck();
+
 /** Payload validity checks (including duplicate unique properties against list at pindexPrev)*/
 // Note: for +v2, if the tx is not a special tx, this method returns true.
 // Note2: This function only performs extra payload related checks, it does NOT checks regular inputs and outputs.
-bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, const CCoinsViewCache* view, CValidationState& state) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+// Note3: if pvSigChecks is not null, the payload signature checks are appended to it instead of being performed.
+bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, const CCoinsViewCache* view, CValidationState& state,
+                    std::vector<CProTxSigCheck>* pvSigChecks = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
 // Basic non-contextual checks for special txes
 // Note: for +v2, if the tx is not a special tx, this method returns true.
 bool CheckSpecialTxNoContext(const CTransaction& tx, CValidationState& state) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
-// Update internal tiertwo data when blocks containing special txes get connected/disconnected
+// Update internal tiertwo data when blocks containing special txes get connected/disconnected.
+// The connection of the last block checked with fJustCheck (a block template of ours) skips the special txes checks,
+// and reuses the masternode list built by the check.
 bool ProcessSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex, const CCoinsViewCache* view, CValidationState& state, bool fJustCheck) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 bool UndoSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex);
 
@@ -0,0 +1,88 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+#include "flatdb.h"
+
+#include "sync.h"
+
+// Hash of the data of the cache files, as last written or read
+static Mutex cs_filesHashes;
+static std::map<fs::path, uint256> mapFilesHashes GUARDED_BY(cs_filesHashes);
+
+bool CFlatDBBase::WriteFile(const fs::path& path, CDataStream& ssData, bool& fWrittenRet)
+{
+    fWrittenRet = false;
+    const uint256 hash = Hash(ssData.begin(), ssData.end());
+    {
+        LOCK(cs_filesHashes);
+        auto it = mapFilesHashes.find(path);
+        if (it != mapFilesHashes.end() && it->second == hash && fs::exists(path)) {
+            return true;
+        }
+    }
+    ssData << hash;
+
+    // open output file, and associate with CAutoFile
+    fs::path pathTmp = path;
+    pathTmp += ".new";
+    FILE* file = fsbridge::fopen(pathTmp, "wb");
+    CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
+    if (fileout.IsNull())
+        return error("%s : Failed to open file %s", __func__, pathTmp.string());
+
+    // Write and commit header, data
+    try {
+        fileout << ssData;
+    } catch (const std::exception& e) {
+        return error("%s : Serialize or I/O error - %s", __func__, e.what());
+    }
+    if (!FileCommit(fileout.Get())) {
+        return error("%s : Failed to commit file %s", __func__, pathTmp.string());
+    }
+    fileout.fclose();
+    if (!RenameOver(pathTmp, path)) {
+        return error("%s : Rename-into-place failed for %s", __func__, path.string());
+    }
+
+    WITH_LOCK(cs_filesHashes, mapFilesHashes[path] = hash; );
+    fWrittenRet = true;
+    return true;
+}
+
+CFlatDBBase::ReadResult CFlatDBBase::ReadFile(const fs::path& path, CDataStream& ssData)
+{
+    // open input file, and associate with CAutoFile
+    FILE* file = fsbridge::fopen(path, "rb");
+    CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull()) {
+        error("%s : Failed to open file %s", __func__, path.string());
+        return FileError;
+    }
+
+    // read data and checksum from file
+    uint256 hashIn;
+    try {
+        const uint64_t fileSize = fs::file_size(path);
+        if (fileSize < sizeof(uint256)) {
+            throw std::ios_base::failure("file too small");
+        }
+        ssData.resize(fileSize - sizeof(uint256));
+        filein.read((char*)ssData.data(), ssData.size());
+        filein >> hashIn;
+    } catch (const std::exception& e) {
+        error("%s : Deserialize or I/O error - %s", __func__, e.what());
+        return HashReadError;
+    }
+    filein.fclose();
+
+    // verify stored checksum matches input data
+    uint256 hashTmp = Hash(ssData.begin(), ssData.end());
+    if (hashIn != hashTmp) {
+        error("%s : Checksum mismatch, data corrupted", __func__);
+        return IncorrectHash;
+    }
+
+    WITH_LOCK(cs_filesHashes, mapFilesHashes[path] = hashTmp; );
+    return Ok;
+}
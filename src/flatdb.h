@@ -16,18 +16,11 @@
 #include "util/system.h"
 
 /**
-*   Generic Dumping and Loading
-*   ---------------------------
-*/
-
-template<typename T>
-class CFlatDB
+ * Files of the cache databases: the serialized data followed by its hash.
+ */
+class CFlatDBBase
 {
-private:
-    fs::path pathDB;
-    std::string strFilename;
-    std::string strMagicMessage;
-
+public:
     enum ReadResult {
         Ok,
         FileError,
@@ -38,6 +31,34 @@ private:
         IncorrectFormat
     };
 
+protected:
+    /**
+     * Write ssData, followed by its hash, to a temporary file renamed over path once committed, so that an
+     * interrupted dump keeps the previous file. Nothing is written when the file already has this data
+     * (last written or read by this process), and fWrittenRet is set to false.
+     */
+    static bool WriteFile(const fs::path& path, CDataStream& ssData, bool& fWrittenRet);
+
+    /**
+     * Read the whole file in ssData, checking and dropping its trailing hash. The file is read in one go
+     * in the stream buffer, and its hash computed in place.
+     */
+    static ReadResult ReadFile(const fs::path& path, CDataStream& ssData);
+};
+
+/**
+*   Generic Dumping and Loading
+*   ---------------------------
+*/
+
+template<typename T>
+class CFlatDB : public CFlatDBBase
+{
+private:
+    fs::path pathDB;
+    std::string strFilename;
+    std::string strMagicMessage;
+
     bool Write(T& objToSave)
     {
         int64_t nStart = GetTimeMillis();
@@ -47,23 +68,15 @@ private:
         ssObj << strMagicMessage; // specific magic message for this type of object
         ssObj << Params().MessageStart(); // network specific magic number
         ssObj << objToSave;
-        const uint256& hash = Hash(ssObj.begin(), ssObj.end());
-        ssObj << hash;
-
-        // open output file, and associate with CAutoFile
-        FILE* file = fopen(pathDB.string().c_str(), "wb");
-        CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
-        if (fileout.IsNull())
-            return error("%s: Failed to open file %s", __func__, pathDB.string());
 
-        // Write and commit header, data
-        try {
-            fileout << ssObj;
+        bool fWritten;
+        if (!WriteFile(pathDB, ssObj, fWritten)) {
+            return false;
         }
-        catch (std::exception &e) {
-            return error("%s: Serialize or I/O error - %s", __func__, e.what());
+        if (!fWritten) {
+            LogPrint(BCLog::MASTERNODE, "%s unchanged, not written\n", strFilename);
+            return true;
         }
-        fileout.fclose();
 
         LogPrintf("Written info to %s  %dms\n", strFilename, GetTimeMillis() - nStart);
         LogPrintf("     %s\n", objToSave.ToString());
@@ -73,40 +86,10 @@ private:
     ReadResult Read(T& objToLoad)
     {
         int64_t nStart = GetTimeMillis();
-        // open input file, and associate with CAutoFile
-        FILE* file = fopen(pathDB.string().c_str(), "rb");
-        CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
-        if (filein.IsNull()) {
-            error("%s: Failed to open file %s", __func__, pathDB.string());
-            return FileError;
-        }
-
-        // use file size to size memory buffer
-        int fileSize = fs::file_size(pathDB);
-        int dataSize = fileSize - sizeof(uint256);
-        // Don't try to resize to a negative number if file is small
-        if (dataSize < 0) dataSize = 0;
-        std::vector<unsigned char> vchData;
-        vchData.resize(dataSize);
-        uint256 hashIn;
-
-        // read data and checksum from file
-        try {
-            filein.read((char *)vchData.data(), dataSize);
-            filein >> hashIn;
-        } catch (std::exception &e) {
-            error("%s: Deserialize or I/O error - %s", __func__, e.what());
-            return HashReadError;
-        }
-        filein.fclose();
-
-        CDataStream ssObj(vchData, SER_DISK, CLIENT_VERSION);
-
-        // verify stored checksum matches input data
-        uint256 hashTmp = Hash(ssObj.begin(), ssObj.end());
-        if (hashIn != hashTmp) {
-            error("%s: Checksum mismatch, data corrupted", __func__);
-            return IncorrectHash;
+        CDataStream ssObj(SER_DISK, CLIENT_VERSION);
+        ReadResult readResult = ReadFile(pathDB, ssObj);
+        if (readResult != Ok) {
+            return readResult;
         }
 
         unsigned char pchMsgTmp[4];
@@ -172,9 +155,9 @@ public:
     bool Dump(T& objToSave)
     {
         int64_t nStart = GetTimeMillis();
-        LogPrintf("Writing info to %s...\n", strFilename);
+        LogPrint(BCLog::MASTERNODE, "Writing info to %s...\n", strFilename);
         Write(objToSave);
-        LogPrintf("%s dump finished  %dms\n", strFilename, GetTimeMillis() - nStart);
+        LogPrint(BCLog::MASTERNODE, "%s dump finished  %dms\n", strFilename, GetTimeMillis() - nStart);
         return true;
     }
 };
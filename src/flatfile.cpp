@@ -10,6 +10,13 @@
 #include "tinyformat.h"
 #include "util/system.h"
 
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 FlatFileSeq::FlatFileSeq(fs::path dir, const char* prefix, size_t chunk_size) :
     m_dir(std::move(dir)),
     m_prefix(prefix),
@@ -96,3 +103,83 @@ bool FlatFileSeq::Flush(const FlatFilePos& pos, bool finalize)
     fclose(file);
     return true;
 }
+
+MappedFlatFile::~MappedFlatFile()
+{
+#ifndef WIN32
+    munmap(const_cast<unsigned char*>(m_data), m_size);
+#endif
+}
+
+const unsigned char* MappedFlatFile::Read(size_t pos, size_t len) const
+{
+    if (pos > m_size || len > m_size - pos) {
+        return nullptr;
+    }
+#ifndef WIN32
+    // The reads of a rescan follow each other, within a few blocks. The next bytes are hinted once half of the
+    // previous hint was read, so that most of the reads don't make any syscall.
+    const size_t last_read_end = m_last_read_end.exchange(pos + len);
+    const bool sequential = pos >= last_read_end && pos - last_read_end <= READ_AHEAD_SIZE / 4;
+    if (sequential && pos + len + READ_AHEAD_SIZE / 2 > m_advised_end) {
+        static const size_t page_size = sysconf(_SC_PAGESIZE);
+        const size_t advise_begin = pos - pos % page_size;
+        const size_t advise_end = std::min(m_size, pos + len + READ_AHEAD_SIZE);
+        m_advised_end = advise_end;
+        madvise(const_cast<unsigned char*>(m_data) + advise_begin, advise_end - advise_begin, MADV_WILLNEED);
+    }
+#endif
+    return m_data + pos;
+}
+
+FlatFileMapCache::FlatFileMapCache(FlatFileSeq seq, size_t max_files) :
+    m_seq(std::move(seq)),
+    m_max_files(max_files)
+{
+}
+
+std::shared_ptr<const MappedFlatFile> FlatFileMapCache::Get(int nFile)
+{
+    LOCK(m_mutex);
+    for (auto it = m_files.begin(); it != m_files.end(); ++it) {
+        if (it->first == nFile) {
+            m_files.splice(m_files.begin(), m_files, it);
+            return it->second;
+        }
+    }
+#ifdef WIN32
+    return nullptr;
+#else
+    if (m_max_files == 0) {
+        return nullptr;
+    }
+    const fs::path path = m_seq.FileName(FlatFilePos(nFile, 0));
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd == -1) {
+        return nullptr;
+    }
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    // The mapping doesn't need the file descriptor
+    close(fd);
+    if (data == MAP_FAILED) {
+        LogPrintf("Unable to map file %s\n", path.string());
+        return nullptr;
+    }
+    auto file = std::make_shared<const MappedFlatFile>(static_cast<const unsigned char*>(data), st.st_size);
+    m_files.emplace_front(nFile, file);
+    if (m_files.size() > m_max_files) {
+        m_files.pop_back();
+    }
+    return file;
+#endif
+}
+
+void FlatFileMapCache::Clear()
+{
+    LOCK(m_mutex);
+    m_files.clear();
+}
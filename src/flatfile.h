@@ -6,10 +6,14 @@
 #ifndef BITCOIN_FLATFILE_H
 #define BITCOIN_FLATFILE_H
 
+#include <atomic>
+#include <list>
+#include <memory>
 #include <string>
 
 #include "fs.h"
 #include "serialize.h"
+#include "sync.h"
 
 struct FlatFilePos
 {
@@ -87,4 +91,59 @@ public:
     bool Flush(const FlatFilePos& pos, bool finalize = false);
 };
 
+/** A read-only memory mapping of a whole file of a FlatFileSeq (see FlatFileMapCache). */
+class MappedFlatFile
+{
+private:
+    const unsigned char* const m_data;
+    const size_t m_size;
+    //! End of the last read, to detect the sequential reads, and end of the last read-ahead hint
+    mutable std::atomic<size_t> m_last_read_end{0};
+    mutable std::atomic<size_t> m_advised_end{0};
+
+public:
+    //! Reads following a sequential read are hinted to the kernel up to this size
+    static constexpr size_t READ_AHEAD_SIZE = 4 << 20;
+
+    MappedFlatFile(const unsigned char* data, size_t size) : m_data(data), m_size(size) {}
+    ~MappedFlatFile();
+
+    MappedFlatFile(const MappedFlatFile&) = delete;
+    MappedFlatFile& operator=(const MappedFlatFile&) = delete;
+
+    size_t size() const { return m_size; }
+
+    /**
+     * Points to the bytes [pos, pos + len) of the file (nullptr if they are out of the file), hinting the kernel
+     * (madvise) to read ahead the next ones when the reads are sequential. The pointer is valid as long as this
+     * mapping.
+     */
+    const unsigned char* Read(size_t pos, size_t len) const;
+};
+
+/**
+ * Memory mappings of the files of a FlatFileSeq, so that reading them doesn't need a file opening, seek and
+ * read syscalls each time. The mappings of up to max_files files are kept, the least recently used ones being
+ * unmapped first. Only the files which aren't written anymore may be mapped (a mapping doesn't grow with its
+ * file). Not available on Windows, where Get always returns nullptr.
+ */
+class FlatFileMapCache
+{
+private:
+    const FlatFileSeq m_seq;
+    const size_t m_max_files;
+    Mutex m_mutex;
+    //! The mapped files, most recently used first
+    std::list<std::pair<int, std::shared_ptr<const MappedFlatFile>>> m_files GUARDED_BY(m_mutex);
+
+public:
+    FlatFileMapCache(FlatFileSeq seq, size_t max_files);
+
+    /** Returns the mapping of the file nFile, mapping it if needed (nullptr if it can't be mapped). */
+    std::shared_ptr<const MappedFlatFile> Get(int nFile);
+
+    /** Drops all the mappings (they are unmapped once no longer used). */
+    void Clear();
+};
+
 #endif // BITCOIN_FLATFILE_H
@@ -7,6 +7,12 @@
 #include "crypto/common.h"
 #include "crypto/hmac_sha512.h"
 #include "crypto/scrypt.h"
+#include "crypto/sph_blake.h"
+#include "crypto/sph_bmw.h"
+#include "crypto/sph_groestl.h"
+#include "crypto/sph_jh.h"
+#include "crypto/sph_keccak.h"
+#include "crypto/sph_skein.h"
 
 inline uint32_t ROTL32(uint32_t x, int8_t r)
 {
@@ -79,6 +85,81 @@ void BIP32Hash(const ChainCode chainCode, unsigned int nChild, unsigned char hea
     CHMAC_SHA512(chainCode.begin(), chainCode.size()).Write(&header, 1).Write(data, 32).Write(num, 4).Finalize(output);
 }
 
+namespace {
+
+/** The contexts of the six hashes of Quark right after their init, copied for each hash instead of re-initialized */
+struct QuarkInitContexts
+{
+    sph_blake512_context blake;
+    sph_bmw512_context bmw;
+    sph_groestl512_context groestl;
+    sph_jh512_context jh;
+    sph_keccak512_context keccak;
+    sph_skein512_context skein;
+
+    QuarkInitContexts()
+    {
+        sph_blake512_init(&blake);
+        sph_bmw512_init(&bmw);
+        sph_groestl512_init(&groestl);
+        sph_jh512_init(&jh);
+        sph_keccak512_init(&keccak);
+        sph_skein512_init(&skein);
+    }
+};
+
+const QuarkInitContexts& GetQuarkInitContexts()
+{
+    static const QuarkInitContexts contexts;
+    return contexts;
+}
+
+template <typename Context>
+inline void QuarkStep(const Context& init, void (*update)(void*, const void*, size_t), void (*close)(void*, void*),
+                      const void* data, size_t len, void* out)
+{
+    Context ctx = init;
+    update(&ctx, data, len);
+    close(&ctx, out);
+}
+
+/** The branches of Quark depend on bit 3 of the low word of the previous 512-bit hash */
+inline bool QuarkBranch(const arith_uint512& hash)
+{
+    return (hash.GetLow64() & 8) != 0;
+}
+
+} // namespace
+
+uint256 HashQuark(const unsigned char* data, size_t len)
+{
+    const QuarkInitContexts& init = GetQuarkInitContexts();
+    arith_uint512 hash[9];
+
+    QuarkStep(init.blake, sph_blake512, sph_blake512_close, data, len, &hash[0]);
+    QuarkStep(init.bmw, sph_bmw512, sph_bmw512_close, &hash[0], 64, &hash[1]);
+    if (QuarkBranch(hash[1])) {
+        QuarkStep(init.groestl, sph_groestl512, sph_groestl512_close, &hash[1], 64, &hash[2]);
+    } else {
+        QuarkStep(init.skein, sph_skein512, sph_skein512_close, &hash[1], 64, &hash[2]);
+    }
+    QuarkStep(init.groestl, sph_groestl512, sph_groestl512_close, &hash[2], 64, &hash[3]);
+    QuarkStep(init.jh, sph_jh512, sph_jh512_close, &hash[3], 64, &hash[4]);
+    if (QuarkBranch(hash[4])) {
+        QuarkStep(init.blake, sph_blake512, sph_blake512_close, &hash[4], 64, &hash[5]);
+    } else {
+        QuarkStep(init.bmw, sph_bmw512, sph_bmw512_close, &hash[4], 64, &hash[5]);
+    }
+    QuarkStep(init.keccak, sph_keccak512, sph_keccak512_close, &hash[5], 64, &hash[6]);
+    QuarkStep(init.skein, sph_skein512, sph_skein512_close, &hash[6], 64, &hash[7]);
+    if (QuarkBranch(hash[7])) {
+        QuarkStep(init.keccak, sph_keccak512, sph_keccak512_close, &hash[7], 64, &hash[8]);
+    } else {
+        QuarkStep(init.jh, sph_jh512, sph_jh512_close, &hash[7], 64, &hash[8]);
+    }
+    return hash[8].trim256();
+}
+
 void scrypt_hash(const char* pass, unsigned int pLen, const char* salt, unsigned int sLen, char* output, unsigned int N, unsigned int r, unsigned int p, unsigned int dkLen)
 {
     scrypt(pass, pLen, salt, sLen, output, N, r, p, dkLen);
@@ -10,6 +10,7 @@
 #include "guiinterface.h"
 #include "httpserver.h"
 #include "key_io.h"
+#include "rpc/jsonwriter.h"
 #include "rpc/protocol.h"
 #include "rpc/server.h"
 #include "random.h"
@@ -17,6 +18,8 @@
 #include "util/system.h"
 #include "utilstrencodings.h"
 
+#include <set>
+
 #include <boost/algorithm/string.hpp> // boost::trim
 
 /** Simple one-shot callback timer to be used by the RPC mechanism to e.g.
@@ -78,6 +81,27 @@ static void JSONErrorReply(HTTPRequest* req, const UniValue& objError, const Uni
     req->WriteReply(nStatus, strReply);
 }
 
+/** Sends the JSON written by writeReply as it's produced: the replies larger than
+ * a chunk are sent with chunked transfer encoding instead of being held in memory.
+ */
+static void JSONStreamReply(HTTPRequest* req, const std::function<void(JSONStreamWriter&)>& writeReply)
+{
+    req->WriteHeader("Content-Type", "application/json");
+    bool fChunked = false;
+    JSONStreamWriter writer([req, &fChunked](std::string&& chunk) {
+        fChunked = true;
+        req->WriteReplyChunk(HTTP_OK, std::move(chunk));
+    });
+    writeReply(writer);
+    std::string strRest = writer.Release() + "\n";
+    if (fChunked) {
+        req->WriteReplyChunk(HTTP_OK, std::move(strRest));
+        req->EndChunkedReply();
+    } else {
+        req->WriteReply(HTTP_OK, strRest);
+    }
+}
+
 //This function checks username and password against -rpcauth
 //entries from config file.
 static bool multiUserAuthorized(std::string strUserPass)
@@ -175,7 +199,6 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         // Set the URI
         jreq.URI = req->GetURI();
 
-        std::string strReply;
         // singleton request
         if (valRequest.isObject()) {
             jreq.parse(valRequest);
@@ -183,16 +206,17 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
             UniValue result = tableRPC.execute(jreq);
 
             // Send reply
-            strReply = JSONRPCReply(result, NullUniValue, jreq.id);
+            JSONStreamReply(req, [&](JSONStreamWriter& writer) {
+                JSONRPCReply(writer, result, NullUniValue, jreq.id);
+            });
 
         // array of requests
-        } else if (valRequest.isArray())
-            strReply = JSONRPCExecBatch(valRequest.get_array());
-        else
+        } else if (valRequest.isArray()) {
+            JSONStreamReply(req, [&](JSONStreamWriter& writer) {
+                JSONRPCExecBatch(valRequest.get_array(), writer);
+            });
+        } else
             throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
-
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strReply);
     } catch (const UniValue& objError) {
         JSONErrorReply(req, objError, jreq.id);
         return false;
@@ -221,16 +245,69 @@ static bool InitRPCAuthentication()
     return true;
 }
 
+/** Maximum number of bytes of a request body searched for its method */
+static const size_t MAX_PEEK_METHOD_SIZE = 1024;
+
+/** The slow requests, executed in the heavy work queue */
+static const std::set<std::string> setHeavyRPCMethods = {
+    "rescanblockchain", "importwallet", "importprivkey", "importaddress", "importpubkey", "importmulti",
+    "importsaplingkey", "importsaplingviewingkey", "dumpwallet",
+    "gettxoutsetinfo", "dumptxoutset", "scantxoutset", "verifychain", "invalidateblock", "reconsiderblock",
+};
+
+/** The method of a JSON-RPC request, from the beginning of its body (empty for the batches, or if not found) */
+static std::string PeekJSONRPCMethod(HTTPRequest* req)
+{
+    static const char* WHITESPACE = " \t\r\n";
+    const std::string body = req->PeekBody(MAX_PEEK_METHOD_SIZE);
+    size_t pos = body.find_first_not_of(WHITESPACE);
+    if (pos == std::string::npos || body[pos] != '{')
+        return "";
+    pos = body.find("\"method\"", pos);
+    if (pos == std::string::npos)
+        return "";
+    pos = body.find_first_not_of(WHITESPACE, pos + 8);
+    if (pos == std::string::npos || body[pos] != ':')
+        return "";
+    pos = body.find_first_not_of(WHITESPACE, pos + 1);
+    if (pos == std::string::npos || body[pos] != '"')
+        return "";
+    const size_t end = body.find('"', pos + 1);
+    if (end == std::string::npos)
+        return "";
+    return body.substr(pos + 1, end - pos - 1);
+}
+
+/** The work queue of a JSON-RPC request, from the category of its method. It's only used
+ * to schedule the request: the method is still read from the parsed request. */
+static HTTPWorkQueueId SelectJSONRPCWorkQueue(HTTPRequest* req, const std::string&)
+{
+    const std::string strMethod = PeekJSONRPCMethod(req);
+    if (strMethod.empty())
+        return HTTPWorkQueueId::DEFAULT;
+    if (setHeavyRPCMethods.count(strMethod))
+        return HTTPWorkQueueId::HEAVY;
+    const CRPCCommand* pcmd = tableRPC[strMethod];
+    if (!pcmd)
+        return HTTPWorkQueueId::DEFAULT;
+    if (pcmd->category == "wallet")
+        return HTTPWorkQueueId::WALLET;
+    if (pcmd->okSafeMode && (pcmd->category == "blockchain" || pcmd->category == "rawtransactions" ||
+                             pcmd->category == "addressindex"))
+        return HTTPWorkQueueId::READ;
+    return HTTPWorkQueueId::DEFAULT;
+}
+
 bool StartHTTPRPC()
 {
     LogPrint(BCLog::RPC, "Starting HTTP RPC server\n");
     if (!InitRPCAuthentication())
         return false;
 
-    RegisterHTTPHandler("/", true, HTTPReq_JSONRPC);
+    RegisterHTTPHandler("/", true, HTTPReq_JSONRPC, SelectJSONRPCWorkQueue);
 #ifdef ENABLE_WALLET
     // ifdef can be removed once we switch to better endpoint support and API versioning
-    RegisterHTTPHandler("/wallet/", false, HTTPReq_JSONRPC);
+    RegisterHTTPHandler("/wallet/", false, HTTPReq_JSONRPC, SelectJSONRPCWorkQueue);
 #endif
     assert(EventBase());
     httpRPCTimerInterface = std::make_unique<HTTPRPCTimerInterface>(EventBase());
@@ -22,6 +22,9 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <signal.h>
+#ifndef WIN32
+#include <unistd.h>
+#endif
 
 #include <event2/thread.h>
 #include <event2/buffer.h>
@@ -72,9 +75,10 @@ private:
     std::mutex cs;
     std::condition_variable cond;
     /* XXX in C++11 we can use std::unique_ptr here and avoid manual cleanup */
-    std::deque<WorkItem*> queue;
+    std::deque<std::pair<WorkItem*, int64_t>> queue; // with the time they were queued at
     bool running;
     size_t maxDepth;
+    HTTPWorkQueueStats stats;
 
 public:
     explicit WorkQueue(size_t _maxDepth) : running(true),
@@ -86,7 +90,7 @@ public:
     ~WorkQueue()
     {
         while (!queue.empty()) {
-            delete queue.front();
+            delete queue.front().first;
             queue.pop_front();
         }
     }
@@ -95,9 +99,10 @@ public:
     {
         std::unique_lock<std::mutex> lock(cs);
         if (!running || queue.size() >= maxDepth) {
+            stats.nRejected++;
             return false;
         }
-        queue.push_back(item);
+        queue.emplace_back(item, GetTimeMicros());
         cond.notify_one();
         return true;
     }
@@ -106,17 +111,24 @@ public:
     {
         while (true) {
             WorkItem* i = nullptr;
+            int64_t nTimeStart;
             {
                 std::unique_lock<std::mutex> lock(cs);
                 while (running && queue.empty())
                     cond.wait(lock);
                 if (!running && queue.empty())
                     break;
-                i = queue.front();
+                i = queue.front().first;
+                nTimeStart = GetTimeMicros();
+                stats.AddWait(nTimeStart - queue.front().second);
                 queue.pop_front();
             }
             (*i)();
             delete i;
+            {
+                std::unique_lock<std::mutex> lock(cs);
+                stats.AddRun(GetTimeMicros() - nTimeStart);
+            }
         }
     }
     /** Interrupt and exit loops */
@@ -126,18 +138,28 @@ public:
         running = false;
         cond.notify_all();
     }
+    /** The statistics of the requests executed until now */
+    HTTPWorkQueueStats GetStats()
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        HTTPWorkQueueStats ret = stats;
+        ret.nDepth = queue.size();
+        ret.nMaxDepth = maxDepth;
+        return ret;
+    }
 };
 
 struct HTTPPathHandler
 {
     HTTPPathHandler() {}
-    HTTPPathHandler(std::string prefix, bool exactMatch, HTTPRequestHandler handler):
-        prefix(prefix), exactMatch(exactMatch), handler(handler)
+    HTTPPathHandler(std::string prefix, bool exactMatch, HTTPRequestHandler handler, HTTPWorkQueueSelector selector):
+        prefix(prefix), exactMatch(exactMatch), handler(handler), selector(selector)
     {
     }
     std::string prefix{};
     bool exactMatch{false};
     HTTPRequestHandler handler{};
+    HTTPWorkQueueSelector selector{};
 };
 
 /** HTTP module state */
@@ -148,8 +170,11 @@ static struct event_base* eventBase = 0;
 struct evhttp* eventHTTP = 0;
 //! List of subnets to allow RPC connections from
 static std::vector<CSubNet> rpc_allow_subnets;
-//! Work queue for handling longer requests off the event loop thread
-static WorkQueue<HTTPClosure>* workQueue = 0;
+//! Work queues for handling longer requests off the event loop thread, by HTTPWorkQueueId.
+//! The queues without threads aren't created: their requests go to the default queue.
+static WorkQueue<HTTPClosure>* workQueues[HTTP_WORK_QUEUE_COUNT] = {};
+//! Number of worker threads of each queue
+static int workQueueThreads[HTTP_WORK_QUEUE_COUNT] = {};
 //! Handlers for (sub)paths
 std::vector<HTTPPathHandler> pathHandlers;
 std::vector<evhttp_bound_socket *> boundSockets;
@@ -263,6 +288,9 @@ static void http_request_cb(struct evhttp_request* req, void* arg)
 
     // Dispatch to worker thread
     if (i != iend) {
+        HTTPWorkQueueId queueId = i->selector ? i->selector(hreq.get(), path) : HTTPWorkQueueId::DEFAULT;
+        WorkQueue<HTTPClosure>* workQueue = workQueues[(int)queueId];
+        if (!workQueue) workQueue = workQueues[(int)HTTPWorkQueueId::DEFAULT];
         std::unique_ptr<HTTPWorkItem> item(new HTTPWorkItem(hreq.release(), path, i->handler));
         assert(workQueue);
         if (workQueue->Enqueue(item.get()))
@@ -402,9 +430,15 @@ bool InitHTTPServer()
 
     LogPrint(BCLog::HTTP, "Initialized HTTP server\n");
     int workQueueDepth = std::max((long)gArgs.GetArg("-rpcworkqueue", DEFAULT_HTTP_WORKQUEUE), 1L);
-    LogPrintf("HTTP: creating work queue of depth %d\n", workQueueDepth);
-
-    workQueue = new WorkQueue<HTTPClosure>(workQueueDepth);
+    workQueueThreads[(int)HTTPWorkQueueId::DEFAULT] = std::max((long)gArgs.GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
+    workQueueThreads[(int)HTTPWorkQueueId::WALLET] = std::max((long)gArgs.GetArg("-rpcwalletthreads", DEFAULT_HTTP_QUEUE_THREADS), 0L);
+    workQueueThreads[(int)HTTPWorkQueueId::READ] = std::max((long)gArgs.GetArg("-rpcreadthreads", DEFAULT_HTTP_QUEUE_THREADS), 0L);
+    workQueueThreads[(int)HTTPWorkQueueId::HEAVY] = std::max((long)gArgs.GetArg("-rpcheavythreads", DEFAULT_HTTP_QUEUE_THREADS), 0L);
+    for (int i = 0; i < HTTP_WORK_QUEUE_COUNT; i++) {
+        if (workQueueThreads[i] == 0) continue;
+        LogPrintf("HTTP: creating %s work queue of depth %d\n", GetHTTPWorkQueueName((HTTPWorkQueueId)i), workQueueDepth);
+        workQueues[i] = new WorkQueue<HTTPClosure>(workQueueDepth);
+    }
     // transfer ownership to eventBase/HTTP via .release()
     eventBase = base_ctr.release();
     eventHTTP = http_ctr.release();
@@ -431,12 +465,14 @@ static std::vector<std::thread> g_thread_http_workers;
 bool StartHTTPServer()
 {
     LogPrint(BCLog::HTTP, "Starting HTTP server\n");
-    int rpcThreads = std::max((long)gArgs.GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
-    LogPrintf("HTTP: starting %d worker threads\n", rpcThreads);
     threadHTTP = std::thread(ThreadHTTP, eventBase, eventHTTP);
 
-    for (int i = 0; i < rpcThreads; i++) {
-        g_thread_http_workers.emplace_back(HTTPWorkQueueRun, workQueue);
+    for (int i = 0; i < HTTP_WORK_QUEUE_COUNT; i++) {
+        if (!workQueues[i]) continue;
+        LogPrintf("HTTP: starting %d %s worker threads\n", workQueueThreads[i], GetHTTPWorkQueueName((HTTPWorkQueueId)i));
+        for (int j = 0; j < workQueueThreads[i]; j++) {
+            g_thread_http_workers.emplace_back(HTTPWorkQueueRun, workQueues[i]);
+        }
     }
     return true;
 }
@@ -448,15 +484,17 @@ void InterruptHTTPServer()
         // Reject requests on current connections
         evhttp_set_gencb(eventHTTP, http_reject_request_cb, nullptr);
     }
-    if (workQueue)
-        workQueue->Interrupt();
+    for (WorkQueue<HTTPClosure>* workQueue : workQueues) {
+        if (workQueue)
+            workQueue->Interrupt();
+    }
 }
 
 void StopHTTPServer()
 {
     LogPrint(BCLog::HTTP, "Stopping HTTP server\n");
 
-    if (workQueue) {
+    if (!g_thread_http_workers.empty()) {
         LogPrint(BCLog::HTTP, "Waiting for HTTP worker threads to exit\n");
         for (auto& thread : g_thread_http_workers) {
             // Guard threadHTTP
@@ -491,7 +529,7 @@ void StopHTTPServer()
         event_base_free(eventBase);
         eventBase = nullptr;
     }
-    if (workQueue) {
+    for (WorkQueue<HTTPClosure>*& workQueue : workQueues) {
         delete workQueue;
         workQueue = nullptr;
     }
@@ -535,6 +573,10 @@ HTTPRequest::HTTPRequest(struct evhttp_request* req) : req(req),
 }
 HTTPRequest::~HTTPRequest()
 {
+    if (chunkedReply && !replySent) {
+        // Don't leave the client waiting for the end of an interrupted reply
+        EndChunkedReply();
+    }
     if (!replySent) {
         // Keep track of whether reply was sent to avoid request leaks
         LogPrintf("%s: Unhandled request\n", __func__);
@@ -554,6 +596,17 @@ std::pair<bool, std::string> HTTPRequest::GetHeader(const std::string& hdr)
         return std::make_pair(false, "");
 }
 
+std::string HTTPRequest::PeekBody(size_t nMaxSize)
+{
+    struct evbuffer* buf = evhttp_request_get_input_buffer(req);
+    if (!buf)
+        return "";
+    std::string body(std::min(nMaxSize, evbuffer_get_length(buf)), '\0');
+    if (!body.empty() && evbuffer_copyout(buf, &body[0], body.size()) < 0)
+        return "";
+    return body;
+}
+
 std::string HTTPRequest::ReadBody()
 {
     struct evbuffer* buf = evhttp_request_get_input_buffer(req);
@@ -616,6 +669,228 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     req = 0; // transferred back to main thread
 }
 
+/** Maximum number of file segments (an open file descriptor each) of a reply, queued or being sent */
+static const int MAX_REPLY_FILE_SEGMENTS = 8;
+/** Maximum number of file segments of all the replies */
+static const int MAX_FILE_SEGMENTS = 64;
+/** Seconds a worker waits for a file segment to be available, before giving up on the reply */
+static const int FILE_SEGMENT_TIMEOUT = 30;
+
+/** Count of the file segments of a reply, released by the main http thread once they are sent */
+struct HTTPFileSegments
+{
+    int nOpen{0}; // guarded by fileSegmentsCs
+};
+
+#ifndef WIN32
+static std::mutex fileSegmentsCs;
+static std::condition_variable fileSegmentsCond;
+static int nFileSegments = 0; // guarded by fileSegmentsCs
+
+static bool AcquireFileSegment(HTTPFileSegments& segments)
+{
+    std::unique_lock<std::mutex> lock(fileSegmentsCs);
+    if (!fileSegmentsCond.wait_for(lock, std::chrono::seconds(FILE_SEGMENT_TIMEOUT), [&segments]{
+            return segments.nOpen < MAX_REPLY_FILE_SEGMENTS && nFileSegments < MAX_FILE_SEGMENTS; })) {
+        return false;
+    }
+    segments.nOpen++;
+    nFileSegments++;
+    return true;
+}
+
+static void ReleaseFileSegment(HTTPFileSegments& segments)
+{
+    {
+        std::unique_lock<std::mutex> lock(fileSegmentsCs);
+        segments.nOpen--;
+        nFileSegments--;
+    }
+    fileSegmentsCond.notify_all();
+}
+
+/** Called by libevent once a file segment is sent, or dropped with its connection */
+static void FileSegmentCleanup(struct evbuffer_file_segment const* seg, int flags, void* arg)
+{
+    std::unique_ptr<std::shared_ptr<HTTPFileSegments>> segments(static_cast<std::shared_ptr<HTTPFileSegments>*>(arg));
+    ReleaseFileSegment(**segments);
+}
+#endif
+
+/** A chunk of a reply: data, or (if fd is set) a segment of a file, sent without copying it */
+struct HTTPReplyChunk
+{
+    std::string data;
+    int fd{-1};
+    int64_t nOffset{0};
+    int64_t nLength{0};
+
+    explicit HTTPReplyChunk(std::string&& dataIn) : data(std::move(dataIn)) {}
+    HTTPReplyChunk(int fdIn, int64_t nOffsetIn, int64_t nLengthIn) : fd(fdIn), nOffset(nOffsetIn), nLength(nLengthIn) {}
+};
+
+/** Chunks of a reply, written by a worker thread and sent in the main http thread.
+ * The events triggered by the worker thread send all the chunks written until then,
+ * so that they are sent in order, however the events are processed.
+ */
+struct HTTPChunkedReply
+{
+    Mutex cs;
+    std::deque<HTTPReplyChunk> chunks GUARDED_BY(cs);
+    bool fEnd GUARDED_BY(cs){false};
+    const int nStatus;
+    // Only used in the main http thread
+    bool fStarted{false};
+    bool fSent{false};
+    // The file segments of the reply, may be released after the reply
+    const std::shared_ptr<HTTPFileSegments> fileSegments{std::make_shared<HTTPFileSegments>()};
+
+    explicit HTTPChunkedReply(int nStatusIn) : nStatus(nStatusIn) {}
+    ~HTTPChunkedReply()
+    {
+#ifndef WIN32
+        // Chunks of a request released before they were sent
+        for (const HTTPReplyChunk& chunk : chunks) {
+            if (chunk.fd >= 0) {
+                close(chunk.fd);
+                ReleaseFileSegment(*fileSegments);
+            }
+        }
+#endif
+    }
+};
+
+static void SendReplyChunks(struct evhttp_request* req, HTTPChunkedReply& reply)
+{
+    if (reply.fSent) return; // req was released
+    std::deque<HTTPReplyChunk> chunks;
+    bool fEnd;
+    {
+        LOCK(reply.cs);
+        chunks.swap(reply.chunks);
+        fEnd = reply.fEnd;
+    }
+    if (!reply.fStarted) {
+        evhttp_send_reply_start(req, reply.nStatus, nullptr);
+        reply.fStarted = true;
+    }
+    if (!chunks.empty()) {
+        struct evbuffer* evb = evbuffer_new();
+        assert(evb);
+        for (HTTPReplyChunk& chunk : chunks) {
+#ifndef WIN32
+            if (chunk.fd >= 0) {
+                // The segment closes the file once it's sent
+                struct evbuffer_file_segment* seg = evbuffer_file_segment_new(chunk.fd, chunk.nOffset, chunk.nLength, EVBUF_FS_CLOSE_ON_FREE);
+                if (seg) {
+                    evbuffer_file_segment_add_cleanup_cb(seg, FileSegmentCleanup, new std::shared_ptr<HTTPFileSegments>(reply.fileSegments));
+                    evbuffer_add_file_segment(evb, seg, 0, -1);
+                    evbuffer_file_segment_free(seg);
+                } else {
+                    LogPrintf("%s: unable to send a file segment of %d bytes\n", __func__, chunk.nLength);
+                    close(chunk.fd);
+                    ReleaseFileSegment(*reply.fileSegments);
+                }
+                chunk.fd = -1;
+                continue;
+            }
+#endif
+            evbuffer_add(evb, chunk.data.data(), chunk.data.size());
+        }
+        evhttp_send_reply_chunk(req, evb);
+        evbuffer_free(evb);
+    }
+    if (fEnd) {
+        evhttp_send_reply_end(req);
+        reply.fSent = true;
+        // Re-enable reading from the socket, see WriteReply
+        if (event_get_version_number() >= 0x02010600 && event_get_version_number() < 0x02020001) {
+            evhttp_connection* conn = evhttp_request_get_connection(req);
+            if (conn) {
+                bufferevent* bev = evhttp_connection_get_bufferevent(conn);
+                if (bev) {
+                    bufferevent_enable(bev, EV_READ | EV_WRITE);
+                }
+            }
+        }
+    }
+}
+
+void HTTPRequest::StartChunkedReply(int nStatus)
+{
+    assert(!replySent && req);
+    if (!chunkedReply) {
+        if (ShutdownRequested()) {
+            WriteHeader("Connection", "close");
+        }
+        chunkedReply = std::make_shared<HTTPChunkedReply>(nStatus);
+    }
+}
+
+void HTTPRequest::QueueReplyChunk(int nStatus, HTTPReplyChunk&& chunk)
+{
+    StartChunkedReply(nStatus);
+    {
+        LOCK(chunkedReply->cs);
+        chunkedReply->chunks.emplace_back(std::move(chunk));
+    }
+    auto req_copy = req;
+    auto reply = chunkedReply;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, reply]{
+        SendReplyChunks(req_copy, *reply);
+    });
+    ev->trigger(nullptr);
+}
+
+void HTTPRequest::WriteReplyChunk(int nStatus, std::string&& chunk)
+{
+    QueueReplyChunk(nStatus, HTTPReplyChunk(std::move(chunk)));
+}
+
+bool HTTPRequest::WriteReplyFileChunk(int nStatus, FILE* file, size_t nLength)
+{
+#ifndef WIN32
+    // Wait for the reply (and the others) to send some of its file segments, if it holds too many
+    StartChunkedReply(nStatus);
+    if (!AcquireFileSegment(*chunkedReply->fileSegments)) {
+        fclose(file);
+        return false;
+    }
+    const long nOffset = ftell(file);
+    const int fd = nOffset < 0 ? -1 : dup(fileno(file));
+    fclose(file);
+    if (fd < 0) {
+        ReleaseFileSegment(*chunkedReply->fileSegments);
+        return false;
+    }
+    QueueReplyChunk(nStatus, HTTPReplyChunk(fd, nOffset, nLength));
+#else
+    std::string chunk(nLength, '\0');
+    const bool fRead = fread(&chunk[0], 1, nLength, file) == nLength;
+    fclose(file);
+    if (!fRead) return false;
+    QueueReplyChunk(nStatus, HTTPReplyChunk(std::move(chunk)));
+#endif
+    return true;
+}
+
+void HTTPRequest::EndChunkedReply()
+{
+    assert(!replySent && req && chunkedReply);
+    {
+        LOCK(chunkedReply->cs);
+        chunkedReply->fEnd = true;
+    }
+    auto req_copy = req;
+    auto reply = chunkedReply;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, reply]{
+        SendReplyChunks(req_copy, *reply);
+    });
+    ev->trigger(nullptr);
+    replySent = true;
+    req = 0; // transferred back to main thread
+}
+
 CService HTTPRequest::GetPeer()
 {
     evhttp_connection* con = evhttp_request_get_connection(req);
@@ -656,10 +931,10 @@ HTTPRequest::RequestMethod HTTPRequest::GetRequestMethod()
     }
 }
 
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler)
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler, const HTTPWorkQueueSelector& selector)
 {
     LogPrint(BCLog::HTTP, "Registering HTTP handler for %s (exactmatch %d)\n", prefix, exactMatch);
-    pathHandlers.emplace_back(prefix, exactMatch, handler);
+    pathHandlers.emplace_back(prefix, exactMatch, handler, selector);
 }
 
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch)
@@ -676,6 +951,29 @@ void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch)
     }
 }
 
+std::string GetHTTPWorkQueueName(HTTPWorkQueueId id)
+{
+    switch (id) {
+    case HTTPWorkQueueId::DEFAULT: return "default";
+    case HTTPWorkQueueId::WALLET: return "wallet";
+    case HTTPWorkQueueId::READ: return "read";
+    case HTTPWorkQueueId::HEAVY: return "heavy";
+    }
+    assert(false);
+}
+
+std::vector<HTTPWorkQueueStats> GetHTTPWorkQueueStats()
+{
+    std::vector<HTTPWorkQueueStats> ret;
+    for (int i = 0; i < HTTP_WORK_QUEUE_COUNT; i++) {
+        if (!workQueues[i]) continue;
+        ret.emplace_back(workQueues[i]->GetStats());
+        ret.back().id = (HTTPWorkQueueId)i;
+        ret.back().nThreads = workQueueThreads[i];
+    }
+    return ret;
+}
+
 std::string urlDecode(const std::string &urlEncoded) {
     std::string res;
     if (!urlEncoded.empty()) {
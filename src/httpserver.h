@@ -9,15 +9,22 @@
 #include <string>
 #include <stdint.h>
 #include <functional>
+#include <algorithm>
+#include <memory>
+#include <vector>
 
 static const int DEFAULT_HTTP_THREADS=4;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
 static const int DEFAULT_HTTP_SERVER_TIMEOUT=30;
+//! Default for -rpcwalletthreads, -rpcreadthreads and -rpcheavythreads
+static const int DEFAULT_HTTP_QUEUE_THREADS=0;
 
 struct evhttp_request;
 struct event_base;
 class CService;
 class HTTPRequest;
+struct HTTPChunkedReply;
+struct HTTPReplyChunk;
 
 /** Initialize HTTP server.
  * Call this before RegisterHTTPHandler or EventBase().
@@ -37,13 +44,51 @@ void StopHTTPServer();
  * libevent doesn't support debug logging.*/
 bool UpdateHTTPServerLogging(bool enable);
 
+/** The work queues of the requests, with their own worker threads, so that the slow requests
+ * don't delay the others. A queue without threads uses the default queue instead.
+ */
+enum class HTTPWorkQueueId : uint8_t {
+    DEFAULT = 0,    // -rpcthreads
+    WALLET,         // -rpcwalletthreads: the wallet requests
+    READ,           // -rpcreadthreads: the chain and mempool reads, and the REST requests
+    HEAVY,          // -rpcheavythreads: the rescans, imports and UTXO set scans
+};
+static const int HTTP_WORK_QUEUE_COUNT = 4;
+
+std::string GetHTTPWorkQueueName(HTTPWorkQueueId id);
+
+/** The statistics of a work queue (times in microseconds) */
+struct HTTPWorkQueueStats
+{
+    HTTPWorkQueueId id{HTTPWorkQueueId::DEFAULT};
+    int nThreads{0};
+    size_t nDepth{0};
+    size_t nMaxDepth{0};
+    uint64_t nRequests{0};
+    uint64_t nRejected{0};
+    int64_t nWaitTotal{0};
+    int64_t nWaitMax{0};
+    int64_t nRunTotal{0};
+    int64_t nRunMax{0};
+
+    void AddWait(int64_t nTime) { nRequests++; nWaitTotal += nTime; nWaitMax = std::max(nWaitMax, nTime); }
+    void AddRun(int64_t nTime) { nRunTotal += nTime; nRunMax = std::max(nRunMax, nTime); }
+};
+
+/** The statistics of the work queues */
+std::vector<HTTPWorkQueueStats> GetHTTPWorkQueueStats();
+
 /** Handler for requests to a certain HTTP path */
 typedef std::function<void(HTTPRequest* req, const std::string &)> HTTPRequestHandler;
+/** Selects the work queue of a request, called on the event loop thread (so it must be quick) */
+typedef std::function<HTTPWorkQueueId(HTTPRequest* req, const std::string &)> HTTPWorkQueueSelector;
 /** Register handler for prefix.
  * If multiple handlers match a prefix, the first-registered one will
- * be invoked.
+ * be invoked. Its requests are executed in the work queue chosen by
+ * selector (the default queue if not set).
  */
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler);
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler,
+                         const HTTPWorkQueueSelector& selector = nullptr);
 /** Unregister handler for prefix */
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
 
@@ -60,6 +105,10 @@ class HTTPRequest
 private:
     struct evhttp_request* req;
     bool replySent;
+    //! Chunks of the reply being sent with WriteReplyChunk
+    std::shared_ptr<HTTPChunkedReply> chunkedReply;
+    void StartChunkedReply(int nStatus);
+    void QueueReplyChunk(int nStatus, HTTPReplyChunk&& chunk);
 
 public:
     HTTPRequest(struct evhttp_request* req);
@@ -91,6 +140,11 @@ public:
      */
     std::pair<bool, std::string> GetHeader(const std::string& hdr);
 
+    /**
+     * Copy of the first nMaxSize bytes of the request body, without consuming it.
+     */
+    std::string PeekBody(size_t nMaxSize);
+
     /**
      * Read request body.
      *
@@ -115,6 +169,31 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Write a part of a HTTP reply, which is sent with chunked transfer encoding
+     * (the status and headers are sent with the first chunk).
+     *
+     * @note Finish the reply with EndChunkedReply, instead of WriteReply.
+     */
+    void WriteReplyChunk(int nStatus, std::string&& chunk);
+
+    /**
+     * Write a part of a chunked HTTP reply from the nLength bytes of file at its current position.
+     * The file is sent by the main http thread, without copying it in memory where supported.
+     * Blocks while the reply, or all the replies, hold too many files waiting to be sent,
+     * and fails if none is sent in time.
+     *
+     * @note Takes the ownership of file (also on failure).
+     */
+    bool WriteReplyFileChunk(int nStatus, FILE* file, size_t nLength);
+
+    /**
+     * Finish a reply sent with WriteReplyChunk.
+     *
+     * @note As WriteReply, this gives the request back to the main thread.
+     */
+    void EndChunkedReply();
 };
 
 /** Event handler closure.
@@ -0,0 +1,104 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "index/compactsaplingindex.h"
+
+#include "crypto/common.h"
+#include "util/system.h"
+
+/* The entries of the blocks with Sapling transactions have the key [DB_COMPACT_BLOCK, uint32 (BE)]
+ * with the height (big-endian so that the ranges of heights are sequential reads), and the value
+ * (block hash, compact txs).
+ */
+constexpr char DB_COMPACT_BLOCK = 'c';
+
+std::unique_ptr<CompactSaplingIndex> g_compactsaplingindex;
+
+namespace {
+
+struct DBHeightKey {
+    int height{0};
+
+    DBHeightKey() = default;
+    explicit DBHeightKey(int height_in) : height(height_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_COMPACT_BLOCK);
+        unsigned char buf[4];
+        WriteBE32(buf, height);
+        s.write((char*)buf, sizeof(buf));
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        char prefix = ser_readdata8(s);
+        if (prefix != DB_COMPACT_BLOCK) {
+            throw std::ios_base::failure("Invalid format for compact sapling index DB height key");
+        }
+        unsigned char buf[4];
+        s.read((char*)buf, sizeof(buf));
+        height = ReadBE32(buf);
+    }
+};
+
+} // namespace
+
+CompactSaplingIndex::CompactSaplingIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(std::make_unique<BaseIndex::DB>(GetDataDir() / "indexes" / "compactsapling", n_cache_size, f_memory, f_wipe))
+{}
+
+bool CompactSaplingIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    std::vector<CompactSaplingTx> vtx = GetCompactSaplingTxs(block);
+    if (vtx.empty()) {
+        return true;
+    }
+    return m_db->Write(DBHeightKey(pindex->nHeight), std::make_pair(pindex->GetBlockHash(), vtx));
+}
+
+bool CompactSaplingIndex::LookupBlocks(const std::vector<const CBlockIndex*>& vIndex, std::vector<CompactSaplingBlock>& blocks_out) const
+{
+    blocks_out.clear();
+    if (vIndex.empty()) {
+        return true;
+    }
+
+    // Only the blocks already processed by the index, as an entry may be missing because the
+    // block has no shielded transactions or because it wasn't indexed yet.
+    const CBlockIndex* best_block_index = GetBestBlockIndex();
+    if (!best_block_index || best_block_index->GetAncestor(vIndex.front()->nHeight) != vIndex.front()) {
+        return false;
+    }
+
+    blocks_out.reserve(vIndex.size());
+    std::unique_ptr<CDBIterator> db_it(m_db->NewIterator());
+    db_it->Seek(DBHeightKey(vIndex.front()->nHeight));
+    DBHeightKey key;
+    bool fValidKey = db_it->Valid() && db_it->GetKey(key);
+    for (const CBlockIndex* pindex : vIndex) {
+        if (best_block_index->GetAncestor(pindex->nHeight) != pindex) {
+            break;
+        }
+        CompactSaplingBlock block(pindex);
+        while (fValidKey && key.height < pindex->nHeight) {
+            db_it->Next();
+            fValidKey = db_it->Valid() && db_it->GetKey(key);
+        }
+        if (fValidKey && key.height == pindex->nHeight) {
+            std::pair<uint256, std::vector<CompactSaplingTx>> value;
+            if (!db_it->GetValue(value)) {
+                return error("%s: unable to read the entry at height %d", __func__, pindex->nHeight);
+            }
+            // A different hash is the entry of a block that was reorganized out of the chain
+            if (value.first == block.hash) {
+                block.vtx = std::move(value.second);
+            }
+        }
+        blocks_out.emplace_back(std::move(block));
+    }
+    return true;
+}
@@ -0,0 +1,53 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_INDEX_COMPACTSAPLINGINDEX_H
+#define PIVX_INDEX_COMPACTSAPLINGINDEX_H
+
+#include "chain.h"
+#include "index/base.h"
+#include "sapling/sapling_compactblock.h"
+
+#include <memory>
+
+//! Default for -compactsaplingindex
+static const bool DEFAULT_COMPACTSAPLINGINDEX = false;
+//! Maximum number of compact shielded blocks returned by a single request
+static const int MAX_COMPACT_SAPLING_BLOCKS = 1000;
+
+/**
+ * CompactSaplingIndex stores the compact shielded data (nullifiers, note commitments, ephemeral keys
+ * and the start of the note ciphertexts) of the blocks with Sapling transactions, by height. It's
+ * used to serve light wallets, which trial-decrypt the outputs without downloading the full blocks.
+ *
+ * The blocks without shielded transactions have no entry: their compact blocks are built from the
+ * block index. An entry belonging to a block reorganized out of the active chain is left in place,
+ * and is recognized by its block hash.
+ */
+class CompactSaplingIndex final : public BaseIndex
+{
+private:
+    const std::unique_ptr<BaseIndex::DB> m_db;
+
+protected:
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    BaseIndex::DB& GetDB() const override { return *m_db; }
+
+    const char* GetName() const override { return "compactsaplingindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit CompactSaplingIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    /// Look up the compact blocks of the consecutive blocks of the active chain in vIndex.
+    /// Returns false if the index isn't in sync with the first of them yet, otherwise the compact
+    /// blocks of the prefix of vIndex already indexed (which may be shorter than vIndex).
+    bool LookupBlocks(const std::vector<const CBlockIndex*>& vIndex, std::vector<CompactSaplingBlock>& blocks_out) const;
+};
+
+/// The global compact shielded block index. May be null.
+extern std::unique_ptr<CompactSaplingIndex> g_compactsaplingindex;
+
+#endif // PIVX_INDEX_COMPACTSAPLINGINDEX_H
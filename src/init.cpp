@@ -15,18 +15,25 @@
 #include "init.h"
 
 #include "activemasternode.h"
+#include "addressindex.h"
 #include "addrman.h"
 #include "amount.h"
 #include "bls/bls_wrapper.h"
 #include "checkpoints.h"
 #include "compat/sanity.h"
 #include "consensus/upgrades.h"
+#include "crypto/sha256.h"
+#include "evo/specialtx_validation.h"
 #include "fs.h"
 #include "httpserver.h"
 #include "httprpc.h"
+#include "index/blockfilterindex.h"
+#include "index/compactsaplingindex.h"
+#include "index/txindex.h"
 #include "invalid.h"
 #include "key.h"
 #include "mapport.h"
+#include "metrics.h"
 #include "miner.h"
 #include "netbase.h"
 #include "net_processing.h"
@@ -34,10 +41,12 @@
 #include "policy/policy.h"
 #include "rpc/register.h"
 #include "rpc/server.h"
+#include "sapling/sapling_proofcache.h"
 #include "script/sigcache.h"
 #include "script/standard.h"
 #include "scheduler.h"
 #include "shutdown.h"
+#include "spentindex.h"
 #include "spork.h"
 #include "sporkdb.h"
 #include "tiertwo/init.h"
@@ -53,6 +62,7 @@
 #include "warnings.h"
 
 #ifdef ENABLE_WALLET
+#include "sapling/sapling_operation_queue.h"
 #include "wallet/init.h"
 #include "wallet/wallet.h"
 #include "wallet/rpcwallet.h"
@@ -78,6 +88,8 @@
 
 #if ENABLE_ZMQ
 #include "zmq/zmqnotificationinterface.h"
+#include "zmq/zmqpublishnotifier.h"
+#include "zmq/zmqrpc.h"
 #endif
 
 
@@ -90,9 +102,6 @@ static const bool DEFAULT_STOPAFTERBLOCKIMPORT = false;
 std::unique_ptr<CConnman> g_connman;
 std::unique_ptr<PeerLogicValidation> peerLogic;
 
-#if ENABLE_ZMQ
-static CZMQNotificationInterface* pzmqNotificationInterface = nullptr;
-#endif
 
 #ifdef WIN32
 // Win32 LevelDB doesn't use filedescriptors, and the ones used for
@@ -183,6 +192,14 @@ static std::unique_ptr<ECCVerifyHandle> globalVerifyHandle;
 
 static boost::thread_group threadGroup;
 static CScheduler scheduler;
+
+//! The block filter types indexed, from -blockfilterindex
+static std::vector<BlockFilterType> g_enabled_filter_types;
+
+const CScheduler& GetScheduler()
+{
+    return scheduler;
+}
 void Interrupt()
 {
     InterruptHTTPServer();
@@ -194,6 +211,25 @@ void Interrupt()
     InterruptTierTwo();
     if (g_connman)
         g_connman->Interrupt();
+    if (g_txindex)
+        g_txindex->Interrupt();
+    ForEachBlockFilterIndex([](BlockFilterIndex& index) { index.Interrupt(); });
+    if (g_compactsaplingindex)
+        g_compactsaplingindex->Interrupt();
+}
+
+//! Loads the Sapling parameters while the block index loads, see WaitForSaplingParams
+static std::thread g_sapling_params_thread;
+
+//! Wait for the Sapling parameters, which are needed before any block is connected. Returns the time waited (ms).
+static int64_t WaitForSaplingParams()
+{
+    const int64_t nStart = GetTimeMillis();
+    if (g_sapling_params_thread.joinable()) {
+        uiInterface.InitMessage(_("Loading Sapling parameters..."));
+        g_sapling_params_thread.join();
+    }
+    return GetTimeMillis() - nStart;
 }
 
 void Shutdown()
@@ -213,10 +249,12 @@ void Shutdown()
     mempool.AddTransactionsUpdated(1);
     StopHTTPRPC();
     StopREST();
+    StopHTTPMetrics();
     StopRPC();
     StopHTTPServer();
     StopTierTwoThreads();
 #ifdef ENABLE_WALLET
+    StopSaplingOperationQueue();
     for (CWalletRef pwallet : vpwallets) {
         pwallet->Flush(false);
     }
@@ -226,11 +264,17 @@ void Shutdown()
 
     // Because these depend on each-other, we make sure that neither can be
     // using the other before destroying them.
-    if (peerLogic) UnregisterValidationInterface(peerLogic.get());
+    if (peerLogic) {
+        UnregisterValidationInterface(peerLogic.get());
+        peerLogic->StopTierTwoMessageThreads();
+    }
     if (g_connman) g_connman->Stop();
 
     StopTorControl();
 
+    // Initialization may have failed before the Sapling parameters were loaded
+    WaitForSaplingParams();
+
     // After everything has been shut down, but before things get flushed, stop the
     // CScheduler/checkqueue threadGroup
     scheduler.stop();
@@ -259,6 +303,10 @@ void Shutdown()
 
     // FlushStateToDisk generates a SetBestChain callback, which we should avoid missing
     if (pcoinsTip != nullptr) {
+        // The flush empties the coins cache
+        if (gArgs.GetBoolArg("-persistcoinscache", DEFAULT_PERSIST_COINS_CACHE)) {
+            DumpCoinsCache();
+        }
         FlushStateToDisk();
     }
 
@@ -266,6 +314,18 @@ void Shutdown()
     // CValidationInterface callbacks, flush them...
     GetMainSignals().FlushBackgroundCallbacks();
 
+    // Stop and delete the indexes only after flushing the background callbacks
+    if (g_txindex) {
+        g_txindex->Stop();
+        g_txindex.reset();
+    }
+    ForEachBlockFilterIndex([](BlockFilterIndex& index) { index.Stop(); });
+    DestroyAllBlockFilterIndexes();
+    if (g_compactsaplingindex) {
+        g_compactsaplingindex->Stop();
+        g_compactsaplingindex.reset();
+    }
+
     // Any future callbacks will be dropped. This should absolutely be safe - if
     // missing a callback results in an unrecoverable situation, unclean shutdown
     // would too. The only reason to do the above flushes is to let the wallet catch
@@ -299,10 +359,10 @@ void Shutdown()
     ResetTierTwoInterfaces();
 
 #if ENABLE_ZMQ
-    if (pzmqNotificationInterface) {
-        UnregisterValidationInterface(pzmqNotificationInterface);
-        delete pzmqNotificationInterface;
-        pzmqNotificationInterface = nullptr;
+    if (g_zmq_notification_interface) {
+        UnregisterValidationInterface(g_zmq_notification_interface);
+        delete g_zmq_notification_interface;
+        g_zmq_notification_interface = nullptr;
     }
 #endif
 
@@ -329,6 +389,7 @@ void Shutdown()
     globalVerifyHandle.reset();
     ECC_Stop();
     LogPrintf("%s: done\n", __func__);
+    g_logger->StopAsync();
 }
 
 /**
@@ -391,7 +452,11 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-?", "This help message");
     strUsage += HelpMessageOpt("-version", "Print version and exit");
     strUsage += HelpMessageOpt("-alertnotify=<cmd>", "Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)");
+    strUsage += HelpMessageOpt("-assumevalid=<hex>", strprintf("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script and proof verification (0 to verify all, default: %s, testnet: %s)", defaultChainParams->GetConsensus().defaultAssumeValid.GetHex(), testnetChainParams->GetConsensus().defaultAssumeValid.GetHex()));
     strUsage += HelpMessageOpt("-blocksdir=<dir>", "Specify directory to hold blocks subdirectory for *.dat files (default: <datadir>)");
+#ifndef WIN32
+    strUsage += HelpMessageOpt("-blocksmmap=<n>", strprintf("Read the blocks from memory mappings of up to <n> block files (0 to %d, default: %d)", MAX_BLOCKS_MMAP, DEFAULT_BLOCKS_MMAP));
+#endif
     strUsage += HelpMessageOpt("-blocknotify=<cmd>", "Execute command when the best block changes (%s in cmd is replaced by block hash)");
     strUsage += HelpMessageOpt("-checkblocks=<n>", strprintf("How many blocks to check at startup (default: %u, 0 = all)", DEFAULT_CHECKBLOCKS));
     strUsage += HelpMessageOpt("-checklevel=<n>", strprintf("How thorough the block verification of -checkblocks is (0-4, default: %u)", DEFAULT_CHECKLEVEL));
@@ -410,13 +475,15 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-debuglogfile=<file>", strprintf("Specify location of debug log file: this can be an absolute path or a path relative to the data directory (default: %s)", DEFAULT_DEBUGLOGFILE));
     strUsage += HelpMessageOpt("-disablesystemnotifications", strprintf("Disable OS notifications for incoming transactions (default: %u)", 0));
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf("Set database cache size in megabytes (%d to %d, default: %d)", nMinDbCache, nMaxDbCache, nDefaultDbCache));
+    strUsage += HelpMessageOpt("-backgroundflush", strprintf("Write the periodic flushes of the chainstate cache to disk on a background thread (default: %u)", DEFAULT_BACKGROUND_FLUSH));
     strUsage += HelpMessageOpt("-loadblock=<file>", "Imports blocks from external blk000??.dat file on startup");
     strUsage += HelpMessageOpt("-maxreorg=<n>", strprintf("Set the Maximum reorg depth (default: %u)", DEFAULT_MAX_REORG_DEPTH));
     strUsage += HelpMessageOpt("-maxorphantx=<n>", strprintf("Keep at most <n> unconnectable transactions in memory (default: %u)", DEFAULT_MAX_ORPHAN_TRANSACTIONS));
     strUsage += HelpMessageOpt("-maxmempool=<n>", strprintf("Keep the transaction memory pool below <n> megabytes (default: %u)", DEFAULT_MAX_MEMPOOL_SIZE));
     strUsage += HelpMessageOpt("-mempoolexpiry=<n>", strprintf("Do not keep transactions in the mempool longer than <n> hours (default: %u)", DEFAULT_MEMPOOL_EXPIRY));
     strUsage += HelpMessageOpt("-persistmempool", strprintf("Whether to save the mempool on shutdown and load on restart (default: %u)", DEFAULT_PERSIST_MEMPOOL));
-    strUsage += HelpMessageOpt("-par=<n>", strprintf("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)", -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
+    strUsage += HelpMessageOpt("-persistcoinscache", strprintf("Whether to save the outpoints of the coins cache on shutdown and load their coins in the background on restart (default: %u)", DEFAULT_PERSIST_COINS_CACHE));
+    strUsage += HelpMessageOpt("-par=<n>", strprintf("Set the number of script, sapling proof and special tx signature verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)", -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
 #ifndef WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf("Specify pid file (default: %s)", PIVX_PID_FILENAME));
 #endif
@@ -426,7 +493,16 @@ std::string HelpMessage(HelpMessageMode mode)
 #if !defined(WIN32)
     strUsage += HelpMessageOpt("-sysperms", "Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)");
 #endif
-    strUsage += HelpMessageOpt("-txindex", strprintf("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)", DEFAULT_TXINDEX));
+    strUsage += HelpMessageOpt("-addressindex", strprintf("Maintain an index of the outputs and spends of the addresses, used by the getaddress* rpc calls and the /rest/address endpoints (default: %u)", DEFAULT_ADDRESSINDEX));
+    strUsage += HelpMessageOpt("-blockfilterindex=<type>", strprintf("Maintain an index of compact filters by block (default: %s, values: %s). "
+                                                                    "If <type> is not supplied or if <type> = 1, indexes for all known types are enabled. "
+                                                                    "It is built in the background, and can be enabled without a reindex",
+                                                                    DEFAULT_BLOCKFILTERINDEX, ListBlockFilterTypes()));
+    strUsage += HelpMessageOpt("-compactsaplingindex", strprintf("Maintain an index of the compact shielded blocks (nullifiers, note commitments, ephemeral keys and note ciphertext prefixes), "
+                                                                 "used by the getcompactsaplingblocks rpc call and the /rest/compactsaplingblocks endpoint to serve light wallets. "
+                                                                 "It is built in the background, and can be enabled without a reindex (default: %u)", DEFAULT_COMPACTSAPLINGINDEX));
+    strUsage += HelpMessageOpt("-spentindex", strprintf("Maintain an index of the spent outputs, used to resolve the inputs in the getrawtransaction and getblock rpc calls (default: %u)", DEFAULT_SPENTINDEX));
+    strUsage += HelpMessageOpt("-txindex", strprintf("Maintain a full transaction index, used by the getrawtransaction rpc call. It is built in the background, and can be enabled without a reindex (default: %u)", DEFAULT_TXINDEX));
     strUsage += HelpMessageOpt("-forcestart", "Attempt to force blockchain corruption recovery on startup");
 
     strUsage += HelpMessageGroup("Connection options:");
@@ -449,14 +525,17 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-onion=<ip:port>", strprintf("Use separate SOCKS5 proxy to reach peers via Tor hidden services (default: %s)", "-proxy"));
     strUsage += HelpMessageOpt("-onlynet=<net>", "Only connect to nodes in network <net> (ipv4, ipv6 or onion)");
     strUsage += HelpMessageOpt("-permitbaremultisig", strprintf("Relay non-P2SH multisig (default: %u)", DEFAULT_PERMIT_BAREMULTISIG));
+    strUsage += HelpMessageOpt("-peerblockfilters", strprintf("Serve compact block filters to peers per BIP 157 (default: %u)", DEFAULT_PEERBLOCKFILTERS));
     strUsage += HelpMessageOpt("-peerbloomfilters", strprintf("Support filtering of blocks and transaction with bloom filters (default: %u)", DEFAULT_PEERBLOOMFILTERS));
     strUsage += HelpMessageOpt("-port=<port>", strprintf("Listen for connections on <port> (default: %u or testnet: %u)", defaultChainParams->GetDefaultPort(), testnetChainParams->GetDefaultPort()));
     strUsage += HelpMessageOpt("-proxy=<ip:port>", "Connect through SOCKS5 proxy");
     strUsage += HelpMessageOpt("-proxyrandomize", strprintf("Randomize credentials for every proxy connection. This enables Tor stream isolation (default: %u)", DEFAULT_PROXYRANDOMIZE));
     strUsage += HelpMessageOpt("-seednode=<ip>", "Connect to a node to retrieve peer addresses, and disconnect");
+    strUsage += HelpMessageOpt("-tiertwomsgthreads=<n>", strprintf("Process the tier two (masternodes, budget, sporks, LLMQ) messages on <n> separated threads (0-%d, 0 = in the message handler thread, default: %d)", MAX_TIERTWO_MSG_THREADS, DEFAULT_TIERTWO_MSG_THREADS));
     strUsage += HelpMessageOpt("-timeout=<n>", strprintf("Specify connection timeout in milliseconds (minimum: 1, default: %d)", DEFAULT_CONNECT_TIMEOUT));
     strUsage += HelpMessageOpt("-torcontrol=<ip>:<port>", strprintf("Tor control port to use if onion listening enabled (default: %s)", DEFAULT_TOR_CONTROL));
     strUsage += HelpMessageOpt("-torpassword=<pass>", "Tor control port password (default: empty)");
+    strUsage += HelpMessageOpt("-txreconciliation", strprintf("Announce the transactions to the peers supporting it through the periodic reconciliation of the sets of transactions, instead of flooding them (default: %u)", DEFAULT_TXRECONCILIATION_ENABLE));
     strUsage += HelpMessageOpt("-upnp", strprintf("Use UPnP to map the listening port (default: %u)", DEFAULT_UPNP));
 #ifdef USE_NATPMP
     strUsage += HelpMessageOpt("-natpmp", strprintf("Use NAT-PMP to map the listening port (default: %s)", DEFAULT_NATPMP ? "1 when listening and no -proxy" : "0"));
@@ -479,17 +558,28 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-zmqpubhashtx=<address>", "Enable publish hash transaction in <address>");
     strUsage += HelpMessageOpt("-zmqpubrawblock=<address>", "Enable publish raw block in <address>");
     strUsage += HelpMessageOpt("-zmqpubrawtx=<address>", "Enable publish raw transaction in <address>");
+    strUsage += HelpMessageOpt("-zmqpubhashtxremoved=<address>", "Enable publish hash and removal reason of the transactions removed from the mempool in <address>");
+    strUsage += HelpMessageOpt("-zmqpubhashchainlock=<address>", "Enable publish hash block (locked via ChainLocks) in <address>");
+    strUsage += HelpMessageOpt("-zmqpubrawchainlock=<address>", "Enable publish raw block (locked via ChainLocks) in <address>");
+    strUsage += HelpMessageOpt("-zmqpubrawchainlocksig=<address>", "Enable publish raw block (locked via ChainLocks) and CLSIG message in <address>");
+    strUsage += HelpMessageOpt("-zmqpubmnlistdiff=<address>", "Enable publish deterministic masternode list diff in <address>");
+    strUsage += HelpMessageOpt("-zmqpubhashblockhwm=<n>", strprintf("Set publish hash block outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM));
+    strUsage += HelpMessageOpt("-zmqpubhashtxhwm=<n>", strprintf("Set publish hash transaction outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM));
+    strUsage += HelpMessageOpt("-zmqpubrawblockhwm=<n>", strprintf("Set publish raw block outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM));
+    strUsage += HelpMessageOpt("-zmqpubrawtxhwm=<n>", strprintf("Set publish raw transaction outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM));
+    strUsage += HelpMessageOpt("-zmqqueuesize=<n>", strprintf("Maximum number of notifications waiting to be published; the notifications beyond are dropped (default: %u)", DEFAULT_ZMQ_QUEUE_SIZE));
 #endif
 
     strUsage += HelpMessageGroup("Debugging/Testing options:");
     strUsage += HelpMessageOpt("-uacomment=<cmt>", "Append comment to the user agent string");
     if (showDebug) {
-        strUsage += HelpMessageOpt("-checkblockindex", strprintf("Do a full consistency check for mapBlockIndex, setBlockIndexCandidates, chainActive and mapBlocksUnlinked occasionally. Also sets -checkmempool (default: %u)", defaultChainParams->DefaultConsistencyChecks()));
+        strUsage += HelpMessageOpt("-checkblockindex", strprintf("Do a full consistency check for mapBlockIndex, setBlockIndexCandidates, chainActive and mapBlocksUnlinked occasionally, and re-hash all the block index headers at startup. Also sets -checkmempool (default: %u)", defaultChainParams->DefaultConsistencyChecks()));
         strUsage += HelpMessageOpt("-checkmempool=<n>", strprintf("Run checks every <n> transactions (default: %u)", defaultChainParams->DefaultConsistencyChecks()));
         strUsage += HelpMessageOpt("-checkpoints", strprintf("Only accept block chain matching built-in checkpoints (default: %u)", DEFAULT_CHECKPOINTS_ENABLED));
         strUsage += HelpMessageOpt("-disablesafemode", strprintf("Disable safemode, override a real safe mode event (default: %u)", DEFAULT_DISABLE_SAFEMODE));
         strUsage += HelpMessageOpt("-testsafemode", strprintf("Force safe mode (default: %u)", DEFAULT_TESTSAFEMODE));
         strUsage += HelpMessageOpt("-deprecatedrpc=<method>", "Allows deprecated RPC method(s) to be used");
+        strUsage += HelpMessageOpt("-capturemessages", strprintf("Record the messages received from the peers, with their time, to <datadir>/message_capture (default: %u)", DEFAULT_CAPTURE_MESSAGES));
         strUsage += HelpMessageOpt("-dropmessagestest=<n>", "Randomly drop 1 of every <n> network messages");
         strUsage += HelpMessageOpt("-fuzzmessagestest=<n>", "Randomly fuzz 1 of every <n> network messages");
         strUsage += HelpMessageOpt("-stopafterblockimport", strprintf("Stop running after importing blocks from disk (default: %u)", DEFAULT_STOPAFTERBLOCKIMPORT));
@@ -510,9 +600,14 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-logips", strprintf("Include IP addresses in debug output (default: %u)", DEFAULT_LOGIPS));
     strUsage += HelpMessageOpt("-logtimestamps", strprintf("Prepend debug output with timestamp (default: %u)", DEFAULT_LOGTIMESTAMPS));
     strUsage += HelpMessageOpt("-logtimemicros", strprintf("Add microsecond precision to debug timestamps (default: %u)", DEFAULT_LOGTIMEMICROS));
+    strUsage += HelpMessageOpt("-logasync", strprintf("Write the debug output from a background thread, dropping the messages when it can't keep up (default: %u)", DEFAULT_LOGASYNC));
     if (showDebug) {
         strUsage += HelpMessageOpt("-mocktime=<n>", "Replace actual time with <n> seconds since epoch (default: 0)");
-        strUsage += HelpMessageOpt("-maxsigcachesize=<n>", strprintf("Limit size of signature cache to <n> MiB (default: %u)", DEFAULT_MAX_SIG_CACHE_SIZE));
+        strUsage += HelpMessageOpt("-lockstats", strprintf("Gather the wait and hold times of the locks, returned by getlockstats (default: %u)", DEFAULT_LOCK_STATS));
+        strUsage += HelpMessageOpt("-maxsigcachesize=<n>", strprintf("Limit sum of signature cache and script execution cache sizes to <n> MiB (default: %u)", DEFAULT_MAX_SIG_CACHE_SIZE));
+        strUsage += HelpMessageOpt("-schedulerthreads=<n>", strprintf("Number of threads running the background tasks (1 to %d, default: %d)", MAX_SCHEDULER_THREADS, DEFAULT_SCHEDULER_THREADS));
+        strUsage += HelpMessageOpt("-maxvalidationqueue=<n>", strprintf("Wait for the subscribers when more than <n> validation notifications are pending while connecting blocks (minimum 1, default: %u)", DEFAULT_VALIDATION_QUEUE_DEPTH));
+        strUsage += HelpMessageOpt("-shieldedproofcachesize=<n>", strprintf("Limit size of the cache of verified shielded proofs to <n> MiB (default: %u)", DEFAULT_SHIELDED_PROOF_CACHE_SIZE));
     }
     strUsage += HelpMessageOpt("-maxtipage=<n>", strprintf("Maximum tip age in seconds to consider node in initial block download (default: %u)", DEFAULT_MAX_TIP_AGE));
     strUsage += HelpMessageOpt("-minrelaytxfee=<amt>", strprintf("Fees (in %s/Kb) smaller than this are considered zero fee for relaying, mining and transaction creation (default: %s)", CURRENCY_UNIT, FormatMoney(::minRelayTxFee.GetFeePerK())));
@@ -547,6 +642,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageGroup("RPC server options:");
     strUsage += HelpMessageOpt("-server", "Accept command line and JSON-RPC commands");
     strUsage += HelpMessageOpt("-rest", strprintf("Accept public REST requests (default: %u)", DEFAULT_REST_ENABLE));
+    strUsage += HelpMessageOpt("-metrics", strprintf("Serve the node metrics, in the Prometheus text format, on the public /metrics endpoint of the RPC server (default: %u)", DEFAULT_METRICS_ENABLE));
     strUsage += HelpMessageOpt("-rpcbind=<addr>", "Bind to given address to listen for JSON-RPC connections. Do not expose the RPC server to untrusted networks such as the public internet! This option is ignored unless -rpcallowip is also passed. Port is optional and overrides -rpcport. Use [host]:port notation for IPv6. This option can be specified multiple times (default: 127.0.0.1 and ::1 i.e., localhost)");
     strUsage += HelpMessageOpt("-rpccookiefile=<loc>", "Location of the auth cookie (default: data dir)");
     strUsage += HelpMessageOpt("-rpcuser=<user>", "Username for JSON-RPC connections");
@@ -555,8 +651,12 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-rpcport=<port>", strprintf("Listen for JSON-RPC connections on <port> (default: %u or testnet: %u)", defaultBaseParams->RPCPort(), testnetBaseParams->RPCPort()));
     strUsage += HelpMessageOpt("-rpcallowip=<ip>", "Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times");
     strUsage += HelpMessageOpt("-rpcthreads=<n>", strprintf("Set the number of threads to service RPC calls (default: %d)", DEFAULT_HTTP_THREADS));
+    strUsage += HelpMessageOpt("-rpcwalletthreads=<n>", strprintf("Set the number of threads of a separate work queue servicing the wallet RPC calls (default: %d, served by the -rpcthreads threads)", DEFAULT_HTTP_QUEUE_THREADS));
+    strUsage += HelpMessageOpt("-rpcreadthreads=<n>", strprintf("Set the number of threads of a separate work queue servicing the blockchain and raw transaction read-only RPC calls and the REST requests (default: %d, served by the -rpcthreads threads)", DEFAULT_HTTP_QUEUE_THREADS));
+    strUsage += HelpMessageOpt("-rpcheavythreads=<n>", strprintf("Set the number of threads of a separate work queue servicing the slow RPC calls (rescans, imports, UTXO set scans) (default: %d, served by the -rpcthreads threads)", DEFAULT_HTTP_QUEUE_THREADS));
+    strUsage += HelpMessageOpt("-rpcbatchthreads=<n>", strprintf("Set the number of threads executing the read-only requests of the JSON-RPC batches in parallel, 0 to execute them in sequence (default: %d)", DEFAULT_RPC_BATCH_THREADS));
     if (showDebug) {
-        strUsage += HelpMessageOpt("-rpcworkqueue=<n>", strprintf("Set the depth of the work queue to service RPC calls (default: %d)", DEFAULT_HTTP_WORKQUEUE));
+        strUsage += HelpMessageOpt("-rpcworkqueue=<n>", strprintf("Set the depth of each work queue to service RPC calls (default: %d)", DEFAULT_HTTP_WORKQUEUE));
         strUsage += HelpMessageOpt("-rpcservertimeout=<n>", strprintf("Timeout during HTTP requests (default: %d)", DEFAULT_HTTP_SERVER_TIMEOUT));
     }
 
@@ -640,18 +740,7 @@ void ThreadImport(const std::vector<fs::path>& vImportFiles)
 
     // -reindex
     if (fReindex) {
-        int nFile = 0;
-        while (true) {
-            FlatFilePos pos(nFile, 0);
-            if (!fs::exists(GetBlockPosFilename(pos)))
-                break; // No block files left to reindex
-            FILE* file = OpenBlockFile(pos, true);
-            if (!file)
-                break; // This error is logged in OpenBlockFile
-            LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)nFile);
-            LoadExternalBlockFile(file, &pos);
-            nFile++;
-        }
+        ReindexBlockFiles();
         pblocktree->WriteReindexing(false);
         fReindex = false;
         LogPrintf("Reindexing finished\n");
@@ -707,6 +796,12 @@ void ThreadImport(const std::vector<fs::path>& vImportFiles)
     ::mempool.SetIsLoaded(!ShutdownRequested());
 }
 
+static void ThreadLoadCoinsCache()
+{
+    util::ThreadRename("pivx-loadcoins");
+    LoadCoinsCache();
+}
+
 /** Sanity checks
  *  Ensure that PIVX is running in a usable environment with all
  *  necessary library support.
@@ -741,7 +836,8 @@ static void LoadSaplingParams()
     gettimeofday(&tv_start, nullptr);
 
     try {
-        initZKSNARKS();
+        // The proving parameters are only loaded by the first shielded transaction built
+        initZKSNARKS(false);
     } catch (std::runtime_error &e) {
         std::string strError = strprintf(_("Cannot find the Sapling parameters in the following directory:\n%s"), ZC_GetParamsDir());
         std::string strErrorPosix = strprintf(_("Please run the included %s script and then restart."), "install-params.sh");
@@ -762,6 +858,11 @@ static void LoadSaplingParams()
     LogPrintf("Loaded Sapling parameters in %fs seconds.\n", elapsed);
 }
 
+static void StartLoadSaplingParams()
+{
+    g_sapling_params_thread = std::thread(std::bind(&TraceThread<void (*)()>, "saplingparams", &LoadSaplingParams));
+}
+
 bool AppInitServers()
 {
     RPCServer::OnStarted(&OnRPCStarted);
@@ -775,6 +876,8 @@ bool AppInitServers()
         return false;
     if (gArgs.GetBoolArg("-rest", DEFAULT_REST_ENABLE) && !StartREST())
         return false;
+    if (gArgs.GetBoolArg("-metrics", DEFAULT_METRICS_ENABLE) && !StartHTTPMetrics())
+        return false;
     if (!StartHTTPServer())
         return false;
     return true;
@@ -1053,8 +1156,28 @@ bool AppInitParameterInteraction()
         mempool.setSanityCheck(1.0 / ratio);
     }
     fCheckBlockIndex = gArgs.GetBoolArg("-checkblockindex", Params().DefaultConsistencyChecks());
+    fTxIndex = gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX);
+
+    const std::string blockfilterindex_value = gArgs.GetArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX);
+    if (blockfilterindex_value.empty() || blockfilterindex_value == "1") {
+        g_enabled_filter_types = AllBlockFilterTypes();
+    } else if (blockfilterindex_value != "0") {
+        for (const std::string& name : gArgs.GetArgs("-blockfilterindex")) {
+            BlockFilterType filter_type;
+            if (!BlockFilterTypeByName(name, filter_type)) {
+                return UIError(strprintf(_("Unknown -blockfilterindex value %s."), name));
+            }
+            g_enabled_filter_types.push_back(filter_type);
+        }
+    }
     Checkpoints::fEnabled = gArgs.GetBoolArg("-checkpoints", DEFAULT_CHECKPOINTS_ENABLED);
 
+    hashAssumeValid = uint256S(gArgs.GetArg("-assumevalid", Params().GetConsensus().defaultAssumeValid.GetHex()));
+    if (!hashAssumeValid.IsNull())
+        LogPrintf("Assuming ancestors of block %s have valid signatures and proofs.\n", hashAssumeValid.GetHex());
+    else
+        LogPrintf("Validating signatures and proofs for all blocks.\n");
+
     // -mempoollimit limits
     int64_t nMempoolSizeLimit = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
     int64_t nMempoolDescendantSizeLimit = gArgs.GetArg("-limitdescendantsize", DEFAULT_DESCENDANT_SIZE_LIMIT) * 1000;
@@ -1071,6 +1194,9 @@ bool AppInitParameterInteraction()
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 
+    g_lock_stats = gArgs.GetBoolArg("-lockstats", DEFAULT_LOCK_STATS);
+    GetMainSignals().SetMaxCallbacksPending(std::max<int64_t>(1, gArgs.GetArg("-maxvalidationqueue", DEFAULT_VALIDATION_QUEUE_DEPTH)));
+
     setvbuf(stdout, nullptr, _IOLBF, 0); /// ***TODO*** do we still need this after -printtoconsole is gone?
 
 #ifndef ENABLE_WALLET
@@ -1127,6 +1253,14 @@ bool AppInitParameterInteraction()
     if (gArgs.GetBoolArg("-peerbloomfilters", DEFAULT_PEERBLOOMFILTERS))
         nLocalServices = ServiceFlags(nLocalServices | NODE_BLOOM);
 
+    // Signal NODE_COMPACT_FILTERS if peerblockfilters and basic filters index are both enabled.
+    if (gArgs.GetBoolArg("-peerblockfilters", DEFAULT_PEERBLOCKFILTERS)) {
+        if (std::find(g_enabled_filter_types.begin(), g_enabled_filter_types.end(), BlockFilterType::BASIC_FILTER) == g_enabled_filter_types.end()) {
+            return UIError(_("Cannot set -peerblockfilters without -blockfilterindex."));
+        }
+        nLocalServices = ServiceFlags(nLocalServices | NODE_COMPACT_FILTERS);
+    }
+
     nMaxTipAge = gArgs.GetArg("-maxtipage", DEFAULT_MAX_TIP_AGE);
 
     if (!InitNUParams())
@@ -1153,6 +1287,8 @@ bool AppInitSanityChecks()
     // ********************************************************* Step 4: sanity checks
 
     // Initialize elliptic curve code
+    std::string sha256_algo = SHA256AutoDetect();
+    LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
     RandomInit();
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
@@ -1167,6 +1303,8 @@ bool AppInitSanityChecks()
 
 bool AppInitMain()
 {
+    const int64_t nInitStart = GetTimeMillis();
+
     // ********************************************************* Step 4a: application initialization
     // After daemonization get the data directory lock again and hold on to it until exit
     // This creates a slight window for a race condition to happen, however this condition is harmless: it
@@ -1188,6 +1326,8 @@ bool AppInitMain()
         if (!g_logger->OpenDebugLog())
             return UIError(strprintf(_("Could not open debug log file %s"), g_logger->m_file_path.string()));
     }
+    if (gArgs.GetBoolArg("-logasync", DEFAULT_LOGASYNC))
+        g_logger->StartAsync();
 #ifdef ENABLE_WALLET
     LogPrintf("Using BerkeleyDB version %s\n", DbEnv::version(0, 0, 0));
 #endif
@@ -1209,11 +1349,21 @@ bool AppInitMain()
     }
 
     InitSignatureCache();
+    InitScriptExecutionCache();
+    InitBlockFileMappings(gArgs.GetArg("-blocksmmap", DEFAULT_BLOCKS_MMAP));
+    SaplingValidation::InitShieldedProofCache();
 
-    LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
+    LogPrintf("Using %u threads for script, sapling proofs, zerocoin spends, special tx signatures, headers and transactions verification, and coins prefetching\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
-        for (int i = 0; i < nScriptCheckThreads - 1; i++)
+        for (int i = 0; i < nScriptCheckThreads - 1; i++) {
             threadGroup.create_thread(&ThreadScriptCheck);
+            threadGroup.create_thread(&ThreadSaplingCheck);
+            threadGroup.create_thread(&ThreadZerocoinCheck);
+            threadGroup.create_thread(&ThreadHeaderHashCheck);
+            threadGroup.create_thread(&ThreadTxCheck);
+            threadGroup.create_thread(&ThreadCoinPrefetch);
+            threadGroup.create_thread(&ThreadProTxSigCheck);
+        }
     }
 
     if (gArgs.IsArgSet("-sporkkey")) // spork priv key
@@ -1222,19 +1372,24 @@ bool AppInitMain()
             return UIError(_("Unable to sign spork message, wrong key?"));
     }
 
-    // Start the lightweight task scheduler thread
-    CScheduler::Function serviceLoop = std::bind(&CScheduler::serviceQueue, &scheduler);
-    threadGroup.create_thread(std::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
+    // Start the lightweight task scheduler threads
+    const int nSchedulerThreads = std::max(1, std::min<int>(gArgs.GetArg("-schedulerthreads", DEFAULT_SCHEDULER_THREADS), MAX_SCHEDULER_THREADS));
+    for (int i = 0; i < nSchedulerThreads; i++) {
+        CScheduler::Function serviceLoop = std::bind(&CScheduler::serviceQueue, &scheduler);
+        const std::string strThreadName = i == 0 ? "scheduler" : strprintf("scheduler.%d", i);
+        threadGroup.create_thread(std::bind(&TraceThread<CScheduler::Function>, strThreadName, serviceLoop));
+    }
 
     // Gather some entropy once per minute.
     scheduler.scheduleEvery([]{
         RandAddPeriodic();
-    }, 60000);
+    }, 60000, "randaddperiodic");
 
     GetMainSignals().RegisterBackgroundSignalScheduler(scheduler);
 
-    // Initialize Sapling circuit parameters
-    LoadSaplingParams();
+    // Initialize Sapling circuit parameters, in the background: they are not needed
+    // until the first block is connected, which comes after the block index is loaded
+    StartLoadSaplingParams();
 
     /* Register RPC commands regardless of -server setting so they will be
      * available in the GUI RPC console even if external calls are disabled.
@@ -1243,6 +1398,9 @@ bool AppInitMain()
 #ifdef ENABLE_WALLET
     RegisterWalletRPCCommands(tableRPC);
 #endif
+#if ENABLE_ZMQ
+    RegisterZMQRPCCommands(tableRPC);
+#endif
 
     /* Start the RPC server already.  It will be started in "warmup" mode
      * and not really process calls already (but it will signify connections
@@ -1296,8 +1454,9 @@ bool AppInitMain()
     g_connman = std::make_unique<CConnman>(GetRand(std::numeric_limits<uint64_t>::max()), GetRand(std::numeric_limits<uint64_t>::max()));
     CConnman& connman = *g_connman;
 
-    peerLogic.reset(new PeerLogicValidation(&connman));
-    RegisterValidationInterface(peerLogic.get());
+    const int nTierTwoMsgThreads = std::max(0, std::min((int)gArgs.GetArg("-tiertwomsgthreads", DEFAULT_TIERTWO_MSG_THREADS), MAX_TIERTWO_MSG_THREADS));
+    peerLogic.reset(new PeerLogicValidation(&connman, nTierTwoMsgThreads));
+    RegisterValidationInterface(peerLogic.get(), "peerlogic");
 
     // sanitize comments per BIP-0014, format user agent and check total size
     std::vector<std::string> uacomments;
@@ -1417,10 +1576,10 @@ bool AppInitMain()
     gArgs.WarnForSectionOnlyArgs();
 
 #if ENABLE_ZMQ
-    pzmqNotificationInterface = CZMQNotificationInterface::Create();
+    g_zmq_notification_interface = CZMQNotificationInterface::Create();
 
-    if (pzmqNotificationInterface) {
-        RegisterValidationInterface(pzmqNotificationInterface);
+    if (g_zmq_notification_interface) {
+        RegisterValidationInterface(g_zmq_notification_interface, "zmq");
     }
 #endif
 
@@ -1436,20 +1595,43 @@ bool AppInitMain()
     nTotalCache = std::max(nTotalCache, nMinDbCache << 20); // total cache cannot be less than nMinDbCache
     nTotalCache = std::min(nTotalCache, nMaxDbCache << 20); // total cache cannot be greater than nMaxDbcache
     int64_t nBlockTreeDBCache = nTotalCache / 8;
-    nBlockTreeDBCache = std::min(nBlockTreeDBCache, (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX) ? nMaxBlockDBAndTxIndexCache : nMaxBlockDBCache) << 20);
+    nBlockTreeDBCache = std::min(nBlockTreeDBCache, ((gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX) || gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX)) ? nMaxBlockDBAndTxIndexCache : nMaxBlockDBCache) << 20);
     nTotalCache -= nBlockTreeDBCache;
+    int64_t nTxIndexCache = std::min(nTotalCache / 8, fTxIndex ? nMaxTxIndexCache << 20 : 0);
+    nTotalCache -= nTxIndexCache;
+    const bool fCompactSaplingIndex = gArgs.GetBoolArg("-compactsaplingindex", DEFAULT_COMPACTSAPLINGINDEX);
+    int64_t nCompactSaplingIndexCache = std::min(nTotalCache / 8, fCompactSaplingIndex ? nMaxCompactSaplingIndexCache << 20 : 0);
+    nTotalCache -= nCompactSaplingIndexCache;
+    int64_t nFilterIndexCache = 0;
+    if (!g_enabled_filter_types.empty()) {
+        const size_t n_indexes = g_enabled_filter_types.size();
+        nFilterIndexCache = std::min(nTotalCache / 8, nMaxFilterIndexCache << 20) / n_indexes;
+        nTotalCache -= nFilterIndexCache * n_indexes;
+    }
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nCoinDBCache = std::min(nCoinDBCache, nMaxCoinsDBCache << 20); // cap total coins db cache
     nTotalCache -= nCoinDBCache;
     nCoinCacheUsage = nTotalCache; // the rest goes to in-memory cache
     LogPrintf("Cache configuration:\n");
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
+    if (fTxIndex) {
+        LogPrintf("* Using %.1fMiB for transaction index database\n", nTxIndexCache * (1.0 / 1024 / 1024));
+    }
+    if (fCompactSaplingIndex) {
+        LogPrintf("* Using %.1fMiB for compact sapling index database\n", nCompactSaplingIndexCache * (1.0 / 1024 / 1024));
+    }
+    for (BlockFilterType filter_type : g_enabled_filter_types) {
+        LogPrintf("* Using %.1fMiB for %s block filter index database\n",
+                  nFilterIndexCache * (1.0 / 1024 / 1024), BlockFilterTypeName(filter_type));
+    }
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set\n", nCoinCacheUsage * (1.0 / 1024 / 1024));
 
     const CChainParams& chainparams = Params();
     const Consensus::Params& consensus = chainparams.GetConsensus();
 
+    const int64_t nLoadChainStart = GetTimeMillis();
+    int64_t nSaplingParamsWait = 0;
     bool fLoaded = false;
     while (!fLoaded && !ShutdownRequested()) {
         bool fReset = fReindex;
@@ -1485,7 +1667,7 @@ bool AppInitMain()
                 uiInterface.InitMessage(_("Loading sporks..."));
                 sporkManager.LoadSporksFromDB();
 
-                // LoadBlockIndex will load fTxIndex from the db, or set it if
+                // LoadBlockIndex will load fAddressIndex and fSpentIndex from the db, or set them if
                 // we're reindexing. It will also load fHavePruned if we've
                 // ever removed a block file from disk.
                 // Note that it also sets fReindex based on the disk flag!
@@ -1505,9 +1687,15 @@ bool AppInitMain()
                     return UIError(_("Incorrect or no genesis block found. Wrong datadir for network?"));
                 }
 
-                // Check for changed -txindex state
-                if (fTxIndex != gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
-                    strLoadError = strprintf(_("You need to rebuild the database using %s to change %s"), "-reindex-chainstate", "-txindex");
+                // Check for changed -addressindex state
+                if (fAddressIndex != gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) {
+                    strLoadError = strprintf(_("You need to rebuild the database using %s to change %s"), "-reindex-chainstate", "-addressindex");
+                    break;
+                }
+
+                // Check for changed -spentindex state
+                if (fSpentIndex != gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX)) {
+                    strLoadError = strprintf(_("You need to rebuild the database using %s to change %s"), "-reindex-chainstate", "-spentindex");
                     break;
                 }
 
@@ -1525,6 +1713,10 @@ bool AppInitMain()
                 pcoinsdbview.reset(new CCoinsViewDB(nCoinDBCache, false, fReset || fReindexChainState));
                 pcoinscatcher.reset(new CCoinsViewErrorCatcher(pcoinsdbview.get()));
 
+                // From here on blocks can be connected (replayed, verified), which needs the Sapling parameters
+                nSaplingParamsWait += WaitForSaplingParams();
+                if (ShutdownRequested()) break;
+
                 // If necessary, upgrade from older database format.
                 // This is a no-op if we cleared the coinsviewdb with -reindex or -reindex-chainstate
                 uiInterface.InitMessage(_("Upgrading coins database if needed..."));
@@ -1566,7 +1758,7 @@ bool AppInitMain()
                             strLoadError = _("System error while flushing the chainstate after pruning invalid entries. Possible corrupt database.");
                             break;
                         }
-                        MoneySupply.Update(pcoinsTip->GetTotalAmount(), chainHeight);
+                        LoadMoneySupply(true);
                         // No need to keep the invalid outs in memory. Clear the map 100 blocks after the last invalid UTXO
                         if (chainHeight > consensus.height_last_invalid_UTXO + 100) {
                             invalid_out::setInvalidOutPoints.clear();
@@ -1624,6 +1816,8 @@ bool AppInitMain()
         }
     }
 
+    const int64_t nLoadChainTime = GetTimeMillis() - nLoadChainStart;
+
     // As LoadBlockIndex can take several minutes, it's possible the user
     // requested to kill the GUI during the last operation. If so, exit.
     // As the program has not fully started yet, Shutdown() is possibly overkill.
@@ -1639,13 +1833,32 @@ bool AppInitMain()
         mempool.ReadFeeEstimates(est_filein);
     fFeeEstimatesInitialized = true;
 
+    // The transaction index is built (from scratch, or from where it stopped), and then kept
+    // in sync with the chain, in the background
+    if (fTxIndex) {
+        g_txindex = std::make_unique<TxIndex>(nTxIndexCache, false, fReindex);
+        g_txindex->Start();
+    }
+
+    // The block filter indexes are built and kept in sync in the same way
+    for (const BlockFilterType& filter_type : g_enabled_filter_types) {
+        InitBlockFilterIndex(filter_type, nFilterIndexCache, false, fReindex);
+        GetBlockFilterIndex(filter_type)->Start();
+    }
+    if (fCompactSaplingIndex) {
+        g_compactsaplingindex = std::make_unique<CompactSaplingIndex>(nCompactSaplingIndexCache, false, fReindex);
+        g_compactsaplingindex->Start();
+    }
+
 // ********************************************************* Step 8: Backup and Load wallet
+    const int64_t nLoadWalletStart = GetTimeMillis();
 #ifdef ENABLE_WALLET
     if (!InitLoadWallet())
         return false;
 #else
     LogPrintf("No wallet compiled in!\n");
 #endif
+    const int64_t nLoadWalletTime = GetTimeMillis() - nLoadWalletStart;
     // ********************************************************* Step 9: import blocks
 
     if (!CheckDiskSpace(GetDataDir())) {
@@ -1683,6 +1896,10 @@ bool AppInitMain()
     for (const std::string& strFile : gArgs.GetArgs("-loadblock")) {
         vImportFiles.emplace_back(strFile);
     }
+    // The coins of the last run are read while the blocks are connected
+    if (!fReindex && gArgs.GetBoolArg("-persistcoinscache", DEFAULT_PERSIST_COINS_CACHE)) {
+        threadGroup.create_thread(&ThreadLoadCoinsCache);
+    }
     threadGroup.create_thread(std::bind(&ThreadImport, vImportFiles));
 
     // Wait for genesis block to be processed
@@ -1712,10 +1929,14 @@ bool AppInitMain()
     }
     LogPrintf("chainActive.Height() = %d\n", chain_active_height);
 
-    // Update money supply
-    if (!fReindex && !fReindexChainState) {
-        uiInterface.InitMessage(_("Calculating money supply..."));
-        MoneySupply.Update(pcoinsTip->GetTotalAmount(), chain_active_height);
+    // Load the money supply stored with the chainstate (unless it was just summed, after pruning the invalid outputs).
+    // The supply of an empty chainstate (e.g. with -reindex) is zero, and it's tracked block by block from there.
+    {
+        LOCK(cs_main);
+        if (MoneySupply.GetBlockHash() != pcoinsTip->GetBestBlock()) {
+            uiInterface.InitMessage(_("Calculating money supply..."));
+            LoadMoneySupply(false);
+        }
     }
 
 
@@ -1730,8 +1951,10 @@ bool AppInitMain()
         }
     }
 
+    const int64_t nLoadTierTwoStart = GetTimeMillis();
     LoadTierTwo(chain_active_height, load_cache_files);
     RegisterTierTwoValidationInterface();
+    const int64_t nLoadTierTwoTime = GetTimeMillis() - nLoadTierTwoStart;
 
     // set the mode of budget voting for this node
     SetBudgetFinMode(gArgs.GetArg("-budgetvotemode", "auto"));
@@ -1783,6 +2006,7 @@ bool AppInitMain()
     connOptions.nSendBufferMaxSize = 1000*gArgs.GetArg("-maxsendbuffer", DEFAULT_MAXSENDBUFFER);
     connOptions.nReceiveFloodSize = 1000*gArgs.GetArg("-maxreceivebuffer", DEFAULT_MAXRECEIVEBUFFER);
     connOptions.m_added_nodes = gArgs.GetArgs("-addnode");
+    connOptions.m_capture_messages = gArgs.GetBoolArg("-capturemessages", DEFAULT_CAPTURE_MESSAGES);
 
     if (gArgs.IsArgSet("-bind")) {
         for (const std::string& strBind : gArgs.GetArgs("-bind")) {
@@ -1852,6 +2076,8 @@ bool AppInitMain()
 
     SetRPCWarmupFinished();
     uiInterface.InitMessage(_("Done loading"));
+    LogPrintf("Startup timings: block chain %dms (%dms waiting for the Sapling parameters), wallet %dms, tier two %dms, total %dms\n",
+              nLoadChainTime, nSaplingParamsWait, nLoadWalletTime, nLoadTierTwoTime, GetTimeMillis() - nInitStart);
 
     return true;
 }
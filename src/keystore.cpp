@@ -35,6 +35,7 @@ bool CBasicKeyStore::AddKeyPubKey(const CKey& key, const CPubKey& pubkey)
 {
     LOCK(cs_KeyStore);
     mapKeys[pubkey.GetID()] = key;
+    nKeysGeneration++;
     return true;
 }
 
@@ -45,6 +46,7 @@ bool CBasicKeyStore::AddCScript(const CScript& redeemScript)
 
     LOCK(cs_KeyStore);
     mapScripts[CScriptID(redeemScript)] = redeemScript;
+    nKeysGeneration++;
     return true;
 }
 
@@ -88,6 +90,7 @@ bool CBasicKeyStore::AddWatchOnly(const CScript& dest)
     CPubKey pubKey;
     if (ExtractPubKey(dest, pubKey))
         mapWatchKeys[pubKey.GetID()] = pubKey;
+    nKeysGeneration++;
     return true;
 }
 
@@ -98,6 +101,7 @@ bool CBasicKeyStore::RemoveWatchOnly(const CScript& dest)
     CPubKey pubKey;
     if (ExtractPubKey(dest, pubKey))
         mapWatchKeys.erase(pubKey.GetID());
+    nKeysGeneration++;
     return true;
 }
 
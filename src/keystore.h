@@ -13,6 +13,8 @@
 #include "sapling/zip32.h"
 #include "sync.h"
 
+#include <atomic>
+
 #include <boost/signals2/signal.hpp>
 
 class CScript;
@@ -21,12 +23,19 @@ class CScriptID;
 /** A virtual base class for key stores */
 class CKeyStore
 {
+protected:
+    //! Incremented by every change of the keys, scripts and watch-only scripts of the store
+    std::atomic<uint64_t> nKeysGeneration{0};
+
 public:
     // todo: Make it protected again once we are more advanced in the wallet/spkm decoupling.
     mutable RecursiveMutex cs_KeyStore;
 
     virtual ~CKeyStore() {}
 
+    //! Changes with the transparent keys, scripts and watch-only scripts, on which IsMine depends
+    uint64_t GetKeysGeneration() const { return nKeysGeneration; }
+
     //! Add a key to the store.
     virtual bool AddKeyPubKey(const CKey& key, const CPubKey& pubkey) = 0;
     virtual bool AddKey(const CKey& key);
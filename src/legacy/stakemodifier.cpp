@@ -6,6 +6,10 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "legacy/stakemodifier.h"
+
+#include "saltedhasher.h"
+#include "sync.h"
+#include "unordered_lru_cache.h"
 #include "validation.h"   // mapBlockIndex, chainActive
 
 /*
@@ -15,6 +19,19 @@
 static const unsigned int MODIFIER_INTERVAL = 60;
 static const int MODIFIER_INTERVAL_RATIO = 3;
 static const int64_t OLD_MODIFIER_INTERVAL = 2087;
+static const size_t OLD_MODIFIER_CACHE_SIZE = 100000;
+
+// The kernel modifier of a stake input is read from a block of the active chain above the block of the input.
+// The lookups are cached by (block from, zerocoin), along with the block that provided the modifier: the entry
+// is still valid as long as that block is in the active chain, as all the blocks in between are then the same.
+struct OldModifierLookup
+{
+    const CBlockIndex* pindexModifier{nullptr};
+    uint64_t nStakeModifier{0};
+};
+static RecursiveMutex cs_oldModifierCache;
+static unordered_lru_cache<std::pair<uint256, bool>, OldModifierLookup, StaticSaltedHasher, OLD_MODIFIER_CACHE_SIZE>
+        oldModifierCache GUARDED_BY(cs_oldModifierCache);
 
 // Get selection interval section (in seconds)
 static int64_t GetStakeModifierSelectionIntervalSection(int nSection)
@@ -40,10 +57,10 @@ static bool SelectBlockFromCandidates(
     arith_uint256 hashBest = ARITH_UINT256_ZERO;
     *pindexSelected = (const CBlockIndex*)0;
     for (const auto& item : vSortedByTimestamp) {
-        if (!mapBlockIndex.count(item.second))
+        const CBlockIndex* pindex = LookupBlockIndex(item.second);
+        if (!pindex)
             return error("%s : failed to find block index for candidate block %s", __func__, item.second.ToString().c_str());
 
-        const CBlockIndex* pindex = mapBlockIndex[item.second];
         if (fSelected && pindex->GetBlockTime() > nSelectionIntervalStop)
             break;
 
@@ -87,7 +104,7 @@ static bool SelectBlockFromCandidates(
 
 // The stake modifier used to hash for a stake kernel is chosen as the stake
 // modifier about a selection interval later than the coin generating the kernel
-bool GetOldModifier(const CBlockIndex* pindexFrom, uint64_t& nStakeModifier)
+static bool GetOldModifier(const CBlockIndex* pindexFrom, uint64_t& nStakeModifier, const CBlockIndex*& pindexModifier)
 {
     int64_t nStakeModifierTime = pindexFrom->GetBlockTime();
     const CBlockIndex* pindex = pindexFrom;
@@ -105,6 +122,7 @@ bool GetOldModifier(const CBlockIndex* pindexFrom, uint64_t& nStakeModifier)
     } while (nStakeModifierTime < pindexFrom->GetBlockTime() + OLD_MODIFIER_INTERVAL);
 
     nStakeModifier = pindex->GetStakeModifierV1();
+    pindexModifier = pindex;
     return true;
 }
 
@@ -112,21 +130,37 @@ bool GetOldStakeModifier(CStakeInput* stake, uint64_t& nStakeModifier)
 {
     const CBlockIndex* pindexFrom = stake->GetIndexFrom();
     if (!pindexFrom) return error("%s : failed to get index from", __func__);
+
+    const auto cacheKey = std::make_pair(pindexFrom->GetBlockHash(), stake->IsZPIV());
+    {
+        LOCK(cs_oldModifierCache);
+        OldModifierLookup lookup;
+        if (oldModifierCache.get(cacheKey, lookup) && chainActive.Contains(lookup.pindexModifier)) {
+            nStakeModifier = lookup.nStakeModifier;
+            return true;
+        }
+    }
+
+    OldModifierLookup lookup;
     if (stake->IsZPIV()) {
         int64_t nTimeBlockFrom = pindexFrom->GetBlockTime();
         const int nHeightStop = std::min(chainActive.Height(), Params().GetConsensus().height_last_ZC_AccumCheckpoint-1);
         while (pindexFrom && pindexFrom->nHeight + 1 <= nHeightStop) {
             if (pindexFrom->GetBlockTime() - nTimeBlockFrom > 60 * 60) {
-                nStakeModifier = pindexFrom->nAccumulatorCheckpoint.GetCheapHash();
-                return true;
+                lookup.nStakeModifier = pindexFrom->nAccumulatorCheckpoint.GetCheapHash();
+                lookup.pindexModifier = pindexFrom;
+                break;
             }
             pindexFrom = chainActive.Next(pindexFrom);
         }
-        return false;
+        if (!lookup.pindexModifier) return false;
 
-    } else if (!GetOldModifier(pindexFrom, nStakeModifier))
+    } else if (!GetOldModifier(pindexFrom, lookup.nStakeModifier, lookup.pindexModifier))
         return error("%s : failed to get kernel stake modifier", __func__);
 
+    nStakeModifier = lookup.nStakeModifier;
+    LOCK(cs_oldModifierCache);
+    oldModifierCache.insert(cacheKey, lookup);
     return true;
 }
 
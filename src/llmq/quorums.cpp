@@ -26,6 +26,7 @@ namespace llmq
 
 static const std::string DB_QUORUM_SK_SHARE = "q_Qsk";
 static const std::string DB_QUORUM_QUORUM_VVEC = "q_Qqvvec";
+static const std::string DB_QUORUM_PUBKEY_SHARES = "q_Qpkshares";
 
 std::unique_ptr<CQuorumManager> quorumManager{nullptr};
 
@@ -58,6 +59,8 @@ void CQuorum::Init(const uint256& _minedBlockHash, const CBlockIndex* _pindexQuo
     members = _members;
     validMembers = _validMembers;
     quorumPublicKey = _quorumPublicKey;
+    pubKeyShares.assign(members.size(), CBLSPublicKey());
+    pubKeySharesBuilt.reset(new std::once_flag[members.size()]);
 }
 
 bool CQuorum::IsMember(const uint256& proTxHash) const
@@ -85,8 +88,11 @@ CBLSPublicKey CQuorum::GetPubKeyShare(size_t memberIdx) const
     if (quorumVvec == nullptr || memberIdx >= members.size() || !validMembers[memberIdx]) {
         return CBLSPublicKey();
     }
-    auto& m = members[memberIdx];
-    return blsCache.BuildPubKeyShare(m->proTxHash, quorumVvec, CBLSId(m->proTxHash));
+    // if multiple threads request the same share at the same time, only one builds it and the others wait
+    std::call_once(pubKeySharesBuilt[memberIdx], [&]() {
+        pubKeyShares[memberIdx] = blsWorker.BuildPubKeyShare(quorumVvec, CBLSId(members[memberIdx]->proTxHash));
+    });
+    return pubKeyShares[memberIdx];
 }
 
 CBLSSecretKey CQuorum::GetSkShare() const
@@ -131,12 +137,33 @@ bool CQuorum::ReadContributions(CEvoDB& evoDb)
     // member of the quorum but observed the whole DKG process to have the quorum verification vector.
     evoDb.Read(std::make_pair(DB_QUORUM_SK_SHARE, dbKey), skShare);
 
+    // The public key shares are written by the cache populator, once all of them have been built. If we have them,
+    // there is no need to rebuild them from the verification vector.
+    std::vector<CBLSPublicKey> shares;
+    if (evoDb.Read(std::make_pair(DB_QUORUM_PUBKEY_SHARES, dbKey), shares) && shares.size() == members.size()) {
+        for (size_t i = 0; i < members.size(); i++) {
+            std::call_once(pubKeySharesBuilt[i], [&]() { pubKeyShares[i] = std::move(shares[i]); });
+        }
+        fPubKeySharesLoaded = true;
+    }
+
     return true;
 }
 
-void CQuorum::StartCachePopulatorThread(std::shared_ptr<CQuorum> _this)
+void CQuorum::WritePubKeyShares(CEvoDB& evoDb) const
+{
+    // invalid members are written as null keys
+    std::vector<CBLSPublicKey> shares;
+    shares.reserve(members.size());
+    for (size_t i = 0; i < members.size(); i++) {
+        shares.emplace_back(GetPubKeyShare(i));
+    }
+    evoDb.GetRawDB().Write(std::make_pair(DB_QUORUM_PUBKEY_SHARES, MakeQuorumKey(*this)), shares);
+}
+
+void CQuorum::StartCachePopulatorThread(std::shared_ptr<CQuorum> _this, CEvoDB& evoDb)
 {
-    if (_this->quorumVvec == nullptr) {
+    if (_this->quorumVvec == nullptr || _this->fPubKeySharesLoaded) {
         return;
     }
 
@@ -145,12 +172,17 @@ void CQuorum::StartCachePopulatorThread(std::shared_ptr<CQuorum> _this)
 
     // this thread will exit after some time
     // when then later some other thread tries to get keys, it will be much faster
-    _this->cachePopulatorThread = std::thread(&TraceThread<std::function<void()> >, "quorum-cachepop", [_this, t] {
+    _this->cachePopulatorThread = std::thread(&TraceThread<std::function<void()> >, "quorum-cachepop", [_this, t, &evoDb] {
         for (size_t i = 0; i < _this->members.size() && !_this->stopCachePopulatorThread && !ShutdownRequested(); i++) {
             if (_this->validMembers[i]) {
                 _this->GetPubKeyShare(i);
             }
         }
+        if (_this->stopCachePopulatorThread || ShutdownRequested()) {
+            return;
+        }
+        // all shares are built now, persist them so that we don't need to rebuild them after a restart
+        _this->WritePubKeyShares(evoDb);
         LogPrintf("CQuorum::StartCachePopulatorThread -- done. time=%d\n", t.count());
     });
 }
@@ -178,6 +210,26 @@ void CQuorumManager::UpdatedBlockTip(const CBlockIndex* pindexNew, bool fInitial
     }
 }
 
+std::vector<std::future<void>> CQuorumManager::WarmupQuorums(const CBlockIndex* pindexTip)
+{
+    // Build the active quorums in the background (one job per LLMQ type), loading their verification vectors and
+    // public key shares from evodb, so that they are ready for the first signing sessions after a restart.
+    // The tip is resolved by the caller, so that the jobs never have to take cs_main on the worker threads.
+    std::vector<std::future<void>> futures;
+    if (pindexTip == nullptr) {
+        return futures;
+    }
+    for (const auto& p : Params().GetConsensus().llmqs) {
+        const Consensus::LLMQType llmqType = p.first;
+        const size_t nCount = (size_t)std::max(p.second.signingActiveQuorumCount, p.second.keepOldConnections);
+        futures.emplace_back(blsWorker.AsyncRun([this, llmqType, pindexTip, nCount]() {
+            cxxtimer::Timer t(true);
+            auto quorums = ScanQuorums(llmqType, pindexTip, nCount);
+            LogPrint(BCLog::LLMQ, "CQuorumManager::WarmupQuorums -- loaded %d quorums of type %d. time=%d\n", quorums.size(), llmqType, t.count());
+        }));
+    }
+    return futures;
+}
 
 bool CQuorumManager::BuildQuorumFromCommitment(const CFinalCommitment& qc, const CBlockIndex* pindexQuorum, const uint256& minedBlockHash, std::shared_ptr<CQuorum>& quorum) const
 {
@@ -203,7 +255,7 @@ bool CQuorumManager::BuildQuorumFromCommitment(const CFinalCommitment& qc, const
         // pre-populate caches in the background
         // recovering public key shares is quite expensive and would result in serious lags for the first few signing
         // sessions if the shares would be calculated on-demand
-        CQuorum::StartCachePopulatorThread(quorum);
+        CQuorum::StartCachePopulatorThread(quorum, evoDb);
     }
 
     return true;
@@ -266,6 +318,8 @@ std::vector<CQuorumCPtr> CQuorumManager::ScanQuorums(Consensus::LLMQType llmqTyp
     void* pIndexScanCommitments{(void*)pindexStart};
     size_t nScanCommitments{maxCount};
     std::vector<CQuorumCPtr> vecResultQuorums;
+    std::vector<CQuorumCPtr> vecPrevQuorums;
+    bool fPrevCacheExists{false};
 
     {
         LOCK(quorumsCacheCs);
@@ -289,17 +343,33 @@ std::vector<CQuorumCPtr> CQuorumManager::ScanQuorums(Consensus::LLMQType llmqTyp
         } else {
             // If there is nothing in cache request at least cache.max_size() because this gets cached then later
             nScanCommitments = std::max(maxCount, cache.max_size());
+            // A new tip has the cached quorums of its parent, plus the one it might have mined
+            // (a cached list shorter than cache.max_size() already holds all the mined quorums)
+            fPrevCacheExists = maxCount <= cache.max_size() && pindexStart->pprev != nullptr &&
+                               cache.get(pindexStart->pprev->GetBlockHash(), vecPrevQuorums);
         }
     }
-    // Get the block indexes of the mined commitments to build the required quorums from
-    auto quorumIndexes = quorumBlockProcessor->GetMinedCommitmentsUntilBlock(llmqType, (const CBlockIndex*)pIndexScanCommitments, nScanCommitments);
-    vecResultQuorums.reserve(vecResultQuorums.size() + quorumIndexes.size());
-
-    for (auto& quorumIndex : quorumIndexes) {
-        assert(quorumIndex);
-        auto quorum = GetQuorum(llmqType, quorumIndex);
-        assert(quorum != nullptr);
-        vecResultQuorums.emplace_back(quorum);
+
+    if (fPrevCacheExists) {
+        const CBlockIndex* quorumIndex = quorumBlockProcessor->GetMinedCommitmentQuorum(llmqType, pindexStart);
+        vecResultQuorums.reserve(vecPrevQuorums.size() + 1);
+        if (quorumIndex != nullptr) {
+            auto quorum = GetQuorum(llmqType, quorumIndex);
+            assert(quorum != nullptr);
+            vecResultQuorums.emplace_back(quorum);
+        }
+        vecResultQuorums.insert(vecResultQuorums.end(), vecPrevQuorums.begin(), vecPrevQuorums.end());
+    } else {
+        // Get the block indexes of the mined commitments to build the required quorums from
+        auto quorumIndexes = quorumBlockProcessor->GetMinedCommitmentsUntilBlock(llmqType, (const CBlockIndex*)pIndexScanCommitments, nScanCommitments);
+        vecResultQuorums.reserve(vecResultQuorums.size() + quorumIndexes.size());
+
+        for (auto& quorumIndex : quorumIndexes) {
+            assert(quorumIndex);
+            auto quorum = GetQuorum(llmqType, quorumIndex);
+            assert(quorum != nullptr);
+            vecResultQuorums.emplace_back(quorum);
+        }
     }
 
     size_t nCountResult{vecResultQuorums.size()};
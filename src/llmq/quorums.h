@@ -46,14 +46,20 @@ public:
     CBLSSecretKey skShare;
 
 private:
+    CBLSWorker& blsWorker;
     // Recovery of public key shares is very slow, so we start a background thread that pre-populates a cache so that
-    // the public key shares are ready when needed later
-    mutable CBLSWorkerCache blsCache;
+    // the public key shares are ready when needed later.
+    // Each member's share is built only once (from quorumVvec) and then kept, indexed by member, for the lifetime of
+    // the quorum: after the first build, reading it doesn't need any lock.
+    mutable std::vector<CBLSPublicKey> pubKeyShares;
+    mutable std::unique_ptr<std::once_flag[]> pubKeySharesBuilt;
+    // true when the shares were read from evodb (WritePubKeyShares) and not built from the verification vector
+    bool fPubKeySharesLoaded{false};
     std::atomic<bool> stopCachePopulatorThread;
     std::thread cachePopulatorThread;
 
 public:
-    CQuorum(const Consensus::LLMQParams& _params, CBLSWorker& _blsWorker) : params(_params), blsCache(_blsWorker), stopCachePopulatorThread(false) {}
+    CQuorum(const Consensus::LLMQParams& _params, CBLSWorker& _blsWorker) : params(_params), blsWorker(_blsWorker), stopCachePopulatorThread(false) {}
     ~CQuorum();
     void Init(const uint256& minedBlockHash, const CBlockIndex* pindexQuorum, const std::vector<CDeterministicMNCPtr>& members, const std::vector<bool>& validMembers, const CBLSPublicKey& quorumPublicKey);
 
@@ -67,7 +73,8 @@ public:
 private:
     void WriteContributions(CEvoDB& evoDb);
     bool ReadContributions(CEvoDB& evoDb);
-    static void StartCachePopulatorThread(std::shared_ptr<CQuorum> _this);
+    void WritePubKeyShares(CEvoDB& evoDb) const;
+    static void StartCachePopulatorThread(std::shared_ptr<CQuorum> _this, CEvoDB& evoDb);
 };
 typedef std::shared_ptr<CQuorum> CQuorumPtr;
 typedef std::shared_ptr<const CQuorum> CQuorumCPtr;
@@ -94,6 +101,10 @@ public:
 
     void UpdatedBlockTip(const CBlockIndex* pindexNew, bool fInitialDownload);
 
+    // Load the active quorums of every LLMQ type, up to pindexTip, in the background (through the BLS worker pool).
+    // The jobs don't lock cs_main. Returns one future per LLMQ type.
+    std::vector<std::future<void>> WarmupQuorums(const CBlockIndex* pindexTip);
+
 public:
     bool HasQuorum(Consensus::LLMQType llmqType, const uint256& quorumHash);
 
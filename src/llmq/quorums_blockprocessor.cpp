@@ -29,6 +29,7 @@ CQuorumBlockProcessor::CQuorumBlockProcessor(CEvoDB &_evoDb) :
     evoDb(_evoDb)
 {
     utils::InitQuorumsCache(mapHasMinedCommitmentCache);
+    utils::InitQuorumsCache(mapMinedCommitmentsCache);
 }
 
 template<typename... Args>
@@ -178,6 +179,7 @@ bool CQuorumBlockProcessor::ProcessCommitment(int nHeight, const uint256& blockH
     {
         LOCK(minableCommitmentsCs);
         mapHasMinedCommitmentCache.at((Consensus::LLMQType)qc.llmqType).erase(qc.quorumHash);
+        mapMinedCommitmentsCache.at((Consensus::LLMQType)qc.llmqType).erase(qc.quorumHash);
         minableCommitmentsByQuorum.erase(cacheKey);
         minableCommitments.erase(::SerializeHash(qc));
     }
@@ -207,6 +209,7 @@ bool CQuorumBlockProcessor::UndoBlock(const CBlock& block, const CBlockIndex* pi
         {
             LOCK(minableCommitmentsCs);
             mapHasMinedCommitmentCache.at((Consensus::LLMQType)qc.llmqType).erase(qc.quorumHash);
+            mapMinedCommitmentsCache.at((Consensus::LLMQType)qc.llmqType).erase(qc.quorumHash);
         }
 
         // if a reorg happened, we should allow to mine this commitment later
@@ -297,16 +300,41 @@ bool CQuorumBlockProcessor::HasMinedCommitment(Consensus::LLMQType llmqType, con
 
 bool CQuorumBlockProcessor::GetMinedCommitment(Consensus::LLMQType llmqType, const uint256& quorumHash, CFinalCommitment& retQc, uint256& retMinedBlockHash)
 {
-    auto key = std::make_pair(DB_MINED_COMMITMENT, std::make_pair(static_cast<uint8_t>(llmqType), quorumHash));
     std::pair<CFinalCommitment, uint256> p;
+    {
+        LOCK(minableCommitmentsCs);
+        if (mapMinedCommitmentsCache.at(llmqType).get(quorumHash, p)) {
+            retQc = std::move(p.first);
+            retMinedBlockHash = p.second;
+            return true;
+        }
+    }
+
+    auto key = std::make_pair(DB_MINED_COMMITMENT, std::make_pair(static_cast<uint8_t>(llmqType), quorumHash));
     if (!evoDb.Read(key, p)) {
         return false;
     }
+
+    {
+        LOCK(minableCommitmentsCs);
+        mapMinedCommitmentsCache.at(llmqType).insert(quorumHash, p);
+    }
     retQc = std::move(p.first);
     retMinedBlockHash = p.second;
     return true;
 }
 
+const CBlockIndex* CQuorumBlockProcessor::GetMinedCommitmentQuorum(Consensus::LLMQType llmqType, const CBlockIndex* pindex)
+{
+    int quorumHeight;
+    if (!evoDb.Read(BuildInversedHeightKey(llmqType, pindex->nHeight), quorumHeight)) {
+        return nullptr;
+    }
+    auto quorumIndex = pindex->GetAncestor(quorumHeight);
+    assert(quorumIndex);
+    return quorumIndex;
+}
+
 // The returned quorums are in reversed order, so the most recent one is at index 0
 std::vector<const CBlockIndex*> CQuorumBlockProcessor::GetMinedCommitmentsUntilBlock(Consensus::LLMQType llmqType, const CBlockIndex* pindex, size_t maxCount)
 {
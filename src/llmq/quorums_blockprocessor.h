@@ -40,6 +40,8 @@ private:
     std::map<uint256, CFinalCommitment> minableCommitments;
     // for each llmqtype map quorum_hash --> (bool final_commitment_mined)
     mutable std::map<Consensus::LLMQType, unordered_lru_cache<uint256, bool, StaticSaltedHasher>> mapHasMinedCommitmentCache GUARDED_BY(minableCommitmentsCs);
+    // for each llmqtype map quorum_hash --> (final_commitment, mined_block_hash)
+    mutable std::map<Consensus::LLMQType, unordered_lru_cache<uint256, std::pair<CFinalCommitment, uint256>, StaticSaltedHasher>> mapMinedCommitmentsCache GUARDED_BY(minableCommitmentsCs);
 
 public:
     explicit CQuorumBlockProcessor(CEvoDB& _evoDb);
@@ -58,6 +60,8 @@ public:
 
     bool HasMinedCommitment(Consensus::LLMQType llmqType, const uint256& quorumHash);
     bool GetMinedCommitment(Consensus::LLMQType llmqType, const uint256& quorumHash, CFinalCommitment& ret, uint256& retMinedBlockHash);
+    // Returns the quorum of the llmqType commitment mined in the block pindex, or nullptr if it didn't mine one
+    const CBlockIndex* GetMinedCommitmentQuorum(Consensus::LLMQType llmqType, const CBlockIndex* pindex);
 
     std::vector<const CBlockIndex*> GetMinedCommitmentsUntilBlock(Consensus::LLMQType llmqType, const CBlockIndex* pindex, size_t maxCount);
     std::map<Consensus::LLMQType, std::vector<const CBlockIndex*>> GetMinedAndActiveCommitmentsUntilBlock(const CBlockIndex* pindex);
@@ -14,6 +14,7 @@
 #include "spork.h"
 #include "sporkid.h"
 #include "validation.h"
+#include "validationinterface.h"
 
 namespace llmq
 {
@@ -22,11 +23,68 @@ static const std::string CLSIG_REQUESTID_PREFIX = "clsig";
 
 std::unique_ptr<CChainLocksHandler> chainLocksHandler{nullptr};
 
+// upper bounds (ms) of the buckets of the latency histograms
+static const std::vector<int64_t> LATENCY_BUCKET_BOUNDS = {100, 250, 500, 1000, 2500, 5000, 10000, 30000, 60000};
+
 std::string CChainLockSig::ToString() const
 {
     return strprintf("CChainLockSig(nHeight=%d, blockHash=%s)", nHeight, blockHash.ToString());
 }
 
+CChainLockLatencyHistogram::CChainLockLatencyHistogram() :
+    buckets(LATENCY_BUCKET_BOUNDS.size() + 1, 0)
+{
+}
+
+void CChainLockLatencyHistogram::Add(int64_t nLatency)
+{
+    nLatency = std::max<int64_t>(nLatency, 0);
+    // first bucket with upper bound >= nLatency
+    size_t i = std::lower_bound(LATENCY_BUCKET_BOUNDS.begin(), LATENCY_BUCKET_BOUNDS.end(), nLatency) - LATENCY_BUCKET_BOUNDS.begin();
+    buckets[i]++;
+    nCount++;
+    nTotal += nLatency;
+    nMax = std::max(nMax, nLatency);
+}
+
+UniValue CChainLockLatencyHistogram::ToJson() const
+{
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("count", nCount);
+    ret.pushKV("avg_ms", nCount == 0 ? 0 : nTotal / (int64_t)nCount);
+    ret.pushKV("max_ms", nMax);
+    UniValue arr(UniValue::VARR);
+    for (size_t i = 0; i < buckets.size(); i++) {
+        UniValue bucket(UniValue::VOBJ);
+        if (i < LATENCY_BUCKET_BOUNDS.size()) {
+            bucket.pushKV("le_ms", LATENCY_BUCKET_BOUNDS[i]);
+        } else {
+            bucket.pushKV("gt_ms", LATENCY_BUCKET_BOUNDS.back());
+        }
+        bucket.pushKV("count", buckets[i]);
+        arr.push_back(bucket);
+    }
+    ret.pushKV("buckets", arr);
+    return ret;
+}
+
+UniValue CChainLockStats::ToJson() const
+{
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("signed_sessions", nSignedSessions);
+    ret.pushKV("recovered_sigs", nRecoveredSigs);
+    ret.pushKV("chainlocks", nChainLocks);
+    ret.pushKV("timed_out_sessions", nTimedOutSessions);
+    ret.pushKV("lost_races", nLostRaces);
+    UniValue latency(UniValue::VOBJ);
+    latency.pushKV("tip_to_sign", tipToSign.ToJson());
+    latency.pushKV("sign_to_recovered_sig", signToRecoveredSig.ToJson());
+    latency.pushKV("tip_to_chainlock", tipToChainLock.ToJson());
+    latency.pushKV("tip_to_enforced", tipToEnforced.ToJson());
+    ret.pushKV("latency", latency);
+    return ret;
+}
+
 CChainLocksHandler::CChainLocksHandler(CScheduler* _scheduler) :
     scheduler(_scheduler)
 {
@@ -125,6 +183,18 @@ void CChainLocksHandler::ProcessNewChainLock(NodeId from, const llmq::CChainLock
         bestChainLockHash = hash;
         bestChainLock = clsig;
 
+        stats.nChainLocks++;
+        if (clsig.nHeight == lastSignedHeight && clsig.blockHash != lastSignedMsgHash) {
+            // we signed a competing block
+            stats.nLostRaces++;
+            blockTimings.erase(lastSignedMsgHash);
+        }
+        auto itTimings = blockTimings.find(clsig.blockHash);
+        if (itTimings != blockTimings.end() && itTimings->second.nChainLockTime == 0) {
+            itTimings->second.nChainLockTime = GetTimeMillis();
+            stats.tipToChainLock.Add(itTimings->second.nChainLockTime - itTimings->second.nTipTime);
+        }
+
         CInv inv(MSG_CLSIG, hash);
         g_connman->RelayInv(inv);
 
@@ -180,9 +250,6 @@ void CChainLocksHandler::AcceptedBlockHeader(const CBlockIndex* pindexNew)
 
 void CChainLocksHandler::UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork)
 {
-    if (!fMasterNode) {
-        return;
-    }
     if (!pindexNew->pprev) {
         return;
     }
@@ -190,6 +257,18 @@ void CChainLocksHandler::UpdatedBlockTip(const CBlockIndex* pindexNew, const CBl
         return;
     }
 
+    {
+        LOCK(cs);
+        BlockTimings timings;
+        timings.nTipTime = GetTimeMillis();
+        blockTimings.emplace(pindexNew->GetBlockHash(), timings);
+    }
+
+    if (!fMasterNode) {
+        Cleanup();
+        return;
+    }
+
     // DIP8 defines a process called "Signing attempts" which should run before the CLSIG is finalized
     // To simplify the initial implementation, we skip this process and directly try to create a CLSIG
     // This will fail when multiple blocks compete, but we accept this for the initial implementation.
@@ -225,7 +304,15 @@ void CChainLocksHandler::UpdatedBlockTip(const CBlockIndex* pindexNew, const CBl
         lastSignedMsgHash = msgHash;
     }
 
-    quorumSigningManager->AsyncSignIfMember(Params().GetConsensus().llmqChainLocks, requestId, msgHash);
+    if (quorumSigningManager->AsyncSignIfMember(Params().GetConsensus().llmqChainLocks, requestId, msgHash)) {
+        LOCK(cs);
+        stats.nSignedSessions++;
+        auto it = blockTimings.find(msgHash);
+        if (it != blockTimings.end()) {
+            it->second.nSignTime = GetTimeMillis();
+            stats.tipToSign.Add(it->second.nSignTime - it->second.nTipTime);
+        }
+    }
 
     Cleanup();
 }
@@ -235,10 +322,11 @@ void CChainLocksHandler::EnforceBestChainLock()
 {
     CChainLockSig clsig;
     const CBlockIndex* pindex;
+    const CBlockIndex* currentBestChainLockBlockIndex;
     {
         LOCK(cs);
         clsig = bestChainLockWithKnownBlock;
-        pindex = bestChainLockBlockIndex;
+        pindex = currentBestChainLockBlockIndex = bestChainLockBlockIndex;
     }
 
     {
@@ -271,6 +359,29 @@ void CChainLocksHandler::EnforceBestChainLock()
         // This should not have happened and we are in a state were it's not safe to continue anymore
         assert(false);
     }
+
+    // Notify the chainlock once it's enforced on the active chain
+    const CBlockIndex* pindexNotify = nullptr;
+    {
+        LOCK2(cs_main, cs);
+        if (currentBestChainLockBlockIndex && lastNotifyChainLockBlockIndex != currentBestChainLockBlockIndex &&
+            chainActive.Tip()->GetAncestor(currentBestChainLockBlockIndex->nHeight) == currentBestChainLockBlockIndex) {
+            lastNotifyChainLockBlockIndex = currentBestChainLockBlockIndex;
+            pindexNotify = currentBestChainLockBlockIndex;
+        }
+    }
+    if (pindexNotify) {
+        GetMainSignals().NotifyChainLock(pindexNotify, clsig);
+    }
+
+    {
+        LOCK(cs);
+        auto it = blockTimings.find(clsig.blockHash);
+        if (it != blockTimings.end() && it->second.nChainLockTime != 0) {
+            stats.tipToEnforced.Add(GetTimeMillis() - it->second.nTipTime);
+            blockTimings.erase(it);
+        }
+    }
 }
 
 void CChainLocksHandler::HandleNewRecoveredSig(const llmq::CRecoveredSig& recoveredSig)
@@ -287,6 +398,12 @@ void CChainLocksHandler::HandleNewRecoveredSig(const llmq::CRecoveredSig& recove
             // this is not what we signed, so lets not create a CLSIG for it
             return;
         }
+
+        stats.nRecoveredSigs++;
+        auto it = blockTimings.find(lastSignedMsgHash);
+        if (it != blockTimings.end() && it->second.nSignTime != 0) {
+            stats.signToRecoveredSig.Add(GetTimeMillis() - it->second.nSignTime);
+        }
         if (bestChainLock.nHeight >= lastSignedHeight) {
             // already got the same or a better CLSIG through the CLSIG message
             return;
@@ -306,7 +423,7 @@ void CChainLocksHandler::ScheduleInvalidateBlock(const CBlockIndex* pindex)
 
     scheduler->scheduleFromNow([this, pindex]() {
         DoInvalidateBlock(pindex, true);
-    }, 0);
+    }, 0, "chainlocks-invalidate", CScheduler::Priority::HIGH);
 }
 
 // WARNING, do not hold cs while calling this method as we'll otherwise run into a deadlock
@@ -318,7 +435,11 @@ void CChainLocksHandler::DoInvalidateBlock(const CBlockIndex* pindex, bool activ
         LOCK(cs_main);
 
         // get the non-const pointer
-        CBlockIndex* pindex2 = mapBlockIndex[pindex->GetBlockHash()];
+        CBlockIndex* pindex2 = LookupBlockIndex(pindex->GetBlockHash());
+        if (!pindex2) {
+            LogPrintf("CChainLocksHandler::%s -- block %s not found\n", __func__, pindex->GetBlockHash().ToString());
+            return;
+        }
 
         CValidationState state;
         if (!InvalidateBlock(state, params, pindex2)) {
@@ -397,6 +518,12 @@ bool CChainLocksHandler::InternalHasConflictingChainLock(int nHeight, const uint
     return pAncestor->GetBlockHash() != blockHash;
 }
 
+CChainLockStats CChainLocksHandler::GetStats()
+{
+    LOCK(cs);
+    return stats;
+}
+
 void CChainLocksHandler::Cleanup()
 {
     {
@@ -404,6 +531,12 @@ void CChainLocksHandler::Cleanup()
         if (GetTimeMillis() - lastCleanupTime < CLEANUP_INTERVAL) {
             return;
         }
+        if (!fMasterNode) {
+            // non-masternodes only track the block timings, no need to lock cs_main
+            CleanupBlockTimings();
+            lastCleanupTime = GetTimeMillis();
+            return;
+        }
     }
 
     LOCK2(cs_main, cs);
@@ -416,7 +549,24 @@ void CChainLocksHandler::Cleanup()
         }
     }
 
+    CleanupBlockTimings();
+
     lastCleanupTime = GetTimeMillis();
 }
 
+void CChainLocksHandler::CleanupBlockTimings()
+{
+    AssertLockHeld(cs);
+    for (auto it = blockTimings.begin(); it != blockTimings.end(); ) {
+        if (GetTimeMillis() - it->second.nTipTime >= STATS_SESSION_TIMEOUT) {
+            if (it->second.nSignTime != 0 && it->second.nChainLockTime == 0) {
+                stats.nTimedOutSessions++;
+            }
+            it = blockTimings.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
 }
\ No newline at end of file
@@ -14,6 +14,8 @@
 
 #include <atomic>
 
+#include <univalue.h>
+
 class CBlockIndex;
 class CScheduler;
 
@@ -37,10 +39,54 @@ public:
     std::string ToString() const;
 };
 
+// Histogram of the latencies (in ms) of a chainlock stage
+class CChainLockLatencyHistogram
+{
+public:
+    // one bucket for each upper bound (see the .cpp), plus one for the latencies above the last bound
+    std::vector<uint64_t> buckets;
+    uint64_t nCount{0};
+    int64_t nTotal{0};
+    int64_t nMax{0};
+
+public:
+    CChainLockLatencyHistogram();
+    void Add(int64_t nLatency);
+    UniValue ToJson() const;
+};
+
+// Latencies of the stages new tip -> sign request -> recovered sig -> chainlock (CLSIG accepted) -> chainlock enforced
+struct CChainLockStats
+{
+    CChainLockLatencyHistogram tipToSign;
+    CChainLockLatencyHistogram signToRecoveredSig;
+    CChainLockLatencyHistogram tipToChainLock;
+    CChainLockLatencyHistogram tipToEnforced;
+
+    uint64_t nSignedSessions{0};
+    uint64_t nRecoveredSigs{0};
+    uint64_t nChainLocks{0};
+    // signed sessions that didn't result in a chainlock of the signed block within the timeout
+    uint64_t nTimedOutSessions{0};
+    // signed sessions for which a chainlock of a different block at the same height came in (competing blocks)
+    uint64_t nLostRaces{0};
+
+    UniValue ToJson() const;
+};
+
 class CChainLocksHandler : public CRecoveredSigsListener
 {
     static const int64_t CLEANUP_INTERVAL = 1000 * 30;
     static const int64_t CLEANUP_SEEN_TIMEOUT = 24 * 60 * 60 * 1000;
+    // same as the signing sessions timeout of CSigSharesManager
+    static const int64_t STATS_SESSION_TIMEOUT = 60 * 1000;
+
+    // Timestamps (ms) of the stages of the chainlock of a block, stored until the block gets chainlocked or the timeout
+    struct BlockTimings {
+        int64_t nTipTime{0};
+        int64_t nSignTime{0};
+        int64_t nChainLockTime{0};
+    };
 
 private:
     CScheduler* scheduler;
@@ -52,6 +98,7 @@ private:
 
     CChainLockSig bestChainLockWithKnownBlock;
     const CBlockIndex* bestChainLockBlockIndex{nullptr};
+    const CBlockIndex* lastNotifyChainLockBlockIndex{nullptr};
 
     int32_t lastSignedHeight{-1};
     uint256 lastSignedRequestId;
@@ -59,6 +106,9 @@ private:
 
     std::map<uint256, int64_t> seenChainLocks;
 
+    std::map<uint256, BlockTimings> blockTimings;
+    CChainLockStats stats;
+
     int64_t lastCleanupTime{0};
 
 public:
@@ -81,6 +131,8 @@ public:
     bool HasChainLock(int nHeight, const uint256& blockHash);
     bool HasConflictingChainLock(int nHeight, const uint256& blockHash);
 
+    CChainLockStats GetStats();
+
 private:
     // these require locks to be held already
     bool InternalHasChainLock(int nHeight, const uint256& blockHash);
@@ -90,6 +142,7 @@ private:
     void DoInvalidateBlock(const CBlockIndex* pindex, bool activateBestChain);
 
     void Cleanup();
+    void CleanupBlockTimings() EXCLUSIVE_LOCKS_REQUIRED(cs);
 };
 
 extern std::unique_ptr<CChainLocksHandler> chainLocksHandler;
@@ -28,42 +28,42 @@ void CDKGPendingMessages::PushPendingMessage(NodeId from, CDataStream& vRecv, in
     // this will also consume the data, even if we bail out early
     auto pm = std::make_shared<CDataStream>(std::move(vRecv));
 
-    {
-        LOCK(cs);
-
-        if (messagesPerNode[from] >= maxMessagesPerNode) {
-            // TODO ban?
-            LogPrint(BCLog::NET, "CDKGPendingMessages::%s -- too many messages, peer=%d\n", __func__, from);
-            return;
-        }
-        messagesPerNode[from]++;
-    }
-
     CHashWriter hw(SER_GETHASH, 0);
     hw.write(pm->data(), pm->size());
     uint256 hash = hw.GetHash();
 
-    LOCK2(cs_main, cs);
+    {
+        LOCK(cs_main);
+        g_connman->RemoveAskFor(hash, invType);
+    }
 
-    g_connman->RemoveAskFor(hash, invType);
+    LOCK(cs);
 
-    if (!seenMessages.emplace(hash).second) {
+    if (seenMessages.count(hash)) {
         LogPrint(BCLog::NET, "CDKGPendingMessages::%s -- already seen %s, peer=%d\n", __func__, hash.ToString(), from);
         return;
     }
 
+    size_t& nodeMessages = messagesPerNode[from];
+    if (nodeMessages >= maxMessagesPerNode) {
+        // TODO ban?
+        LogPrint(BCLog::NET, "CDKGPendingMessages::%s -- too many messages, peer=%d\n", __func__, from);
+        return;
+    }
+    nodeMessages++;
+
+    seenMessages.emplace(hash);
     pendingMessages.emplace_back(std::make_pair(from, std::move(pm)));
 }
 
 std::list<CDKGPendingMessages::BinaryMessage> CDKGPendingMessages::PopPendingMessages(size_t maxCount)
 {
-    LOCK(cs);
-
     std::list<BinaryMessage> ret;
-    while (!pendingMessages.empty() && ret.size() < maxCount) {
-        ret.emplace_back(std::move(pendingMessages.front()));
-        pendingMessages.pop_front();
-    }
+
+    LOCK(cs);
+    auto itEnd = pendingMessages.begin();
+    std::advance(itEnd, std::min(maxCount, pendingMessages.size()));
+    ret.splice(ret.end(), pendingMessages, pendingMessages.begin(), itEnd);
 
     return ret;
 }
@@ -76,10 +76,14 @@ bool CDKGPendingMessages::HasSeen(const uint256& hash) const
 
 void CDKGPendingMessages::Clear()
 {
-    LOCK(cs);
-    pendingMessages.clear();
-    messagesPerNode.clear();
-    seenMessages.clear();
+    // free the messages outside of the lock
+    std::list<BinaryMessage> tmp;
+    {
+        LOCK(cs);
+        tmp.swap(pendingMessages);
+        messagesPerNode.clear();
+        seenMessages.clear();
+    }
 }
 
 //////
@@ -126,6 +130,8 @@ void CDKGSessionHandler::UpdatedBlockTip(const CBlockIndex* pindexNew)
 
     LogPrint(BCLog::DKG, "CDKGSessionHandler::%s -- %s - currentHeight=%d, quorumHeight=%d, oldPhase=%d, newPhase=%d\n", __func__,
             params.name, currentHeight, quorumHeight, oldPhase, phase);
+
+    Wakeup();
 }
 
 void CDKGSessionHandler::ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv)
@@ -139,7 +145,10 @@ void CDKGSessionHandler::ProcessMessage(CNode* pfrom, const std::string& strComm
         pendingJustifications.PushPendingMessage(pfrom->GetId(), vRecv, MSG_QUORUM_JUSTIFICATION);
     } else if (strCommand == NetMsgType::QPCOMMITMENT) {
         pendingPrematureCommitments.PushPendingMessage(pfrom->GetId(), vRecv, MSG_QUORUM_PREMATURE_COMMITMENT);
+    } else {
+        return;
     }
+    Wakeup();
 }
 
 void CDKGSessionHandler::StartThread()
@@ -155,6 +164,7 @@ void CDKGSessionHandler::StartThread()
 void CDKGSessionHandler::StopThread()
 {
     stopRequested = true;
+    Wakeup();
     if (phaseHandlerThread.joinable()) {
         phaseHandlerThread.join();
     }
@@ -185,6 +195,42 @@ CDKGSessionHandler::QuorumPhaseAndHash CDKGSessionHandler::GetPhaseAndQuorumHash
     return {phase, quorumHash};
 }
 
+void CDKGSessionHandler::Wakeup()
+{
+    {
+        std::lock_guard<std::mutex> lock(cs_wakeup);
+        fWakeup = true;
+    }
+    cvWakeup.notify_one();
+}
+
+void CDKGSessionHandler::WaitForWakeup(int64_t nMaxMillis)
+{
+    std::unique_lock<std::mutex> lock(cs_wakeup);
+    cvWakeup.wait_for(lock, std::chrono::milliseconds(nMaxMillis), [this] { return fWakeup; });
+    fWakeup = false;
+}
+
+// Contributions and premature commitments are sent by all the (good) members, in order of member index (see
+// SleepBeforePhase). Returns true if all the members before us already sent theirs, i.e. their load is over.
+bool CDKGSessionHandler::HavePreviousMembersSent(QuorumPhase curPhase) const
+{
+    if (curPhase != QuorumPhase_Contribute && curPhase != QuorumPhase_Commit) {
+        return false;
+    }
+    for (size_t i = 0; i < curSession->GetMyMemberIndex(); i++) {
+        const auto& m = curSession->members[i];
+        if (m->bad) {
+            continue;
+        }
+        const auto& received = curPhase == QuorumPhase_Contribute ? m->contributions : m->prematureCommitments;
+        if (received.empty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
 class AbortPhaseException : public std::exception {
 };
 
@@ -211,7 +257,7 @@ void CDKGSessionHandler::WaitForNextPhase(QuorumPhase curPhase,
             throw AbortPhaseException();
         }
         if (!runWhileWaiting()) {
-            MilliSleep(100);
+            WaitForWakeup(100);
         }
     }
 
@@ -241,7 +287,7 @@ void CDKGSessionHandler::WaitForNewQuorum(const uint256& oldQuorumHash)
         if (currState.quorumHash != oldQuorumHash) {
             break;
         }
-        MilliSleep(100);
+        WaitForWakeup(100);
     }
 
     LogPrint(BCLog::DKG, "CDKGSessionHandler::%s -- %s - done\n", __func__, params.name);
@@ -308,8 +354,13 @@ void CDKGSessionHandler::SleepBeforePhase(QuorumPhase curPhase,
                 throw AbortPhaseException();
             }
         }
+        if (HavePreviousMembersSent(curPhase)) {
+            // No more load to wait for
+            LogPrint(BCLog::DKG, "CDKGSessionHandler::%s -- %s - previous members done, stopping sleep early, curPhase=%d\n", __func__, params.name, curPhase);
+            break;
+        }
         if (!runWhileWaiting()) {
-            MilliSleep(100);
+            WaitForWakeup(100);
         }
     }
 
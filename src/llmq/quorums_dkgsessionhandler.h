@@ -8,8 +8,15 @@
 
 #include "ctpl_stl.h"
 #include "llmq/quorums_dkgsession.h"
+#include "saltedhasher.h"
 #include "validation.h"
 
+#include <unordered_map>
+#include <unordered_set>
+
+#include <condition_variable>
+#include <mutex>
+
 namespace llmq
 {
 
@@ -31,6 +38,10 @@ enum QuorumPhase {
  * handler thread.
  *
  * Each message type has it's own instance of this class.
+ *
+ * The queue is bounded by a per-node quota, and duplicates are dropped on insert (by hash of the binary message,
+ * before taking any quota). The producers (message handler thread) and the consumer (phase handler thread) only hold
+ * the (non recursive) lock for the few container operations, never while hashing, deserializing or taking cs_main.
  */
 class CDKGPendingMessages
 {
@@ -38,11 +49,11 @@ public:
     typedef std::pair<NodeId, std::shared_ptr<CDataStream>> BinaryMessage;
 
 private:
-    mutable RecursiveMutex cs;
-    size_t maxMessagesPerNode;
-    std::list<BinaryMessage> pendingMessages;
-    std::map<NodeId, size_t> messagesPerNode;
-    std::set<uint256> seenMessages;
+    mutable Mutex cs;
+    const size_t maxMessagesPerNode;
+    std::list<BinaryMessage> pendingMessages GUARDED_BY(cs);
+    std::unordered_map<NodeId, size_t> messagesPerNode GUARDED_BY(cs);
+    std::unordered_set<uint256, StaticSaltedHasher> seenMessages GUARDED_BY(cs);
 
 public:
     CDKGPendingMessages(size_t _maxMessagesPerNode);
@@ -111,6 +122,11 @@ private:
     std::shared_ptr<CDKGSession> curSession;
     std::thread phaseHandlerThread;
 
+    // Wakes up the phase handler thread, while it's waiting, when new messages or blocks come in
+    std::mutex cs_wakeup;
+    std::condition_variable cvWakeup;
+    bool fWakeup{false};
+
     CDKGPendingMessages pendingContributions;
     CDKGPendingMessages pendingComplaints;
     CDKGPendingMessages pendingJustifications;
@@ -139,6 +155,10 @@ private:
     typedef std::function<bool()> WhileWaitFunc;
     void WaitForNextPhase(QuorumPhase curPhase, QuorumPhase nextPhase, const uint256& expectedQuorumHash, const WhileWaitFunc& runWhileWaiting);
     void WaitForNewQuorum(const uint256& oldQuorumHash);
+    void Wakeup();
+    // Wait for a wake up, at most nMaxMillis ms
+    void WaitForWakeup(int64_t nMaxMillis);
+    bool HavePreviousMembersSent(QuorumPhase curPhase) const;
     void SleepBeforePhase(QuorumPhase curPhase, const uint256& expectedQuorumHash, double randomSleepFactor, const WhileWaitFunc& runWhileWaiting);
     void HandlePhase(QuorumPhase curPhase, QuorumPhase nextPhase, const uint256& expectedQuorumHash, double randomSleepFactor, const StartPhaseFunc& startPhaseFunc, const WhileWaitFunc& runWhileWaiting);
     void HandleDKGRound();
@@ -13,13 +13,14 @@
 #include "quorums_chainlocks.h"
 #include "quorums_signing.h"
 #include "quorums_signing_shares.h"
+#include "validation.h"
 
 namespace llmq
 {
 
 CBLSWorker* blsWorker;
 
-void InitLLMQSystem(CEvoDB& evoDb, CScheduler* scheduler, bool unitTests)
+void InitLLMQSystem(CEvoDB& evoDb, CScheduler* scheduler, bool unitTests, int nSigShareWorkers)
 {
     blsWorker = new CBLSWorker();
 
@@ -27,7 +28,7 @@ void InitLLMQSystem(CEvoDB& evoDb, CScheduler* scheduler, bool unitTests)
     quorumBlockProcessor.reset(new CQuorumBlockProcessor(evoDb));
     quorumDKGSessionManager.reset(new CDKGSessionManager(evoDb, *blsWorker));
     quorumManager.reset(new CQuorumManager(evoDb, *blsWorker, *quorumDKGSessionManager));
-    quorumSigSharesManager.reset(new CSigSharesManager());
+    quorumSigSharesManager.reset(new CSigSharesManager(*blsWorker, nSigShareWorkers));
     quorumSigningManager.reset(new CSigningManager(unitTests));
     chainLocksHandler.reset(new CChainLocksHandler(scheduler));
 }
@@ -50,6 +51,9 @@ void StartLLMQSystem()
     if (blsWorker) {
         blsWorker->Start();
     }
+    if (quorumManager) {
+        quorumManager->WarmupQuorums(WITH_LOCK(cs_main, return chainActive.Tip()));
+    }
     if (quorumDKGSessionManager) {
         quorumDKGSessionManager->StartThreads();
     }
@@ -15,7 +15,8 @@ namespace llmq
 {
 
 // Init/destroy LLMQ globals
-void InitLLMQSystem(CEvoDB& evoDb, CScheduler* scheduler, bool unitTests);
+// nSigShareWorkers: number of shards of the sig shares verified (and recovered) concurrently
+void InitLLMQSystem(CEvoDB& evoDb, CScheduler* scheduler, bool unitTests, int nSigShareWorkers = 1);
 void DestroyLLMQSystem();
 
 // Manage scheduled tasks, threads, listeners etc.
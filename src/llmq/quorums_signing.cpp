@@ -23,8 +23,36 @@ namespace llmq
 
 std::unique_ptr<CSigningManager> quorumSigningManager{nullptr};
 
-CRecoveredSigsDb::CRecoveredSigsDb(bool fMemory) : db(fMemory ? "" : (GetDataDir() / "llmq"), 1 << 20, fMemory, false, CLIENT_VERSION | ADDRV2_FORMAT)
+CRecoveredSigsDb::CRecoveredSigsDb(bool fMemory) : db(fMemory ? "" : (GetDataDir() / "llmq"), 1 << 20, fMemory, false, CLIENT_VERSION | ADDRV2_FORMAT),
+                                                   knownHashesFilter(KNOWN_HASHES_FILTER_SIZE, 0.000001)
 {
+    LoadKnownHashes();
+}
+
+void CRecoveredSigsDb::LoadKnownHashes()
+{
+    cxxtimer::Timer t(true);
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    auto start = std::make_tuple('h', uint256());
+    pcursor->Seek(start);
+
+    LOCK(cs);
+    while (pcursor->Valid()) {
+        decltype(start) k;
+        if (!pcursor->GetKey(k) || std::get<0>(k) != 'h') {
+            break;
+        }
+        AddKnownHash(std::get<1>(k));
+        pcursor->Next();
+    }
+    LogPrint(BCLog::LLMQ, "CRecoveredSigsDb::%s -- loaded %d recovered sig hashes. time=%d\n", __func__, nKnownHashesInserted, t.count());
+}
+
+// cs must be held
+void CRecoveredSigsDb::AddKnownHash(const uint256& hash)
+{
+    knownHashesFilter.insert(hash);
+    nKnownHashesInserted++;
 }
 
 bool CRecoveredSigsDb::HasRecoveredSig(Consensus::LLMQType llmqType, const uint256& id, const uint256& msgHash)
@@ -35,52 +63,62 @@ bool CRecoveredSigsDb::HasRecoveredSig(Consensus::LLMQType llmqType, const uint2
 
 bool CRecoveredSigsDb::HasRecoveredSigForId(Consensus::LLMQType llmqType, const uint256& id)
 {
-    int64_t t = GetTimeMillis();
-
     auto cacheKey = std::make_pair(llmqType, id);
+    bool ret;
     {
         LOCK(cs);
-        auto it = hasSigForIdCache.find(cacheKey);
-        if (it != hasSigForIdCache.end()) {
-            it->second.second = t;
-            return it->second.first;
+        if (hasSigForIdCache.get(cacheKey, ret)) {
+            return ret;
         }
     }
 
 
     auto k = std::make_tuple('r', (uint8_t)llmqType, id);
-    bool ret = db.Exists(k);
+    ret = db.Exists(k);
 
     LOCK(cs);
-    hasSigForIdCache.emplace(cacheKey, std::make_pair(ret, t));
+    hasSigForIdCache.insert(cacheKey, ret);
     return ret;
 }
 
 bool CRecoveredSigsDb::HasRecoveredSigForSession(const uint256& signHash)
 {
-    int64_t t = GetTimeMillis();
-
+    bool ret;
     {
         LOCK(cs);
-        auto it = hasSigForSessionCache.find(signHash);
-        if (it != hasSigForSessionCache.end()) {
-            it->second.second = t;
-            return it->second.first;
+        if (hasSigForSessionCache.get(signHash, ret)) {
+            return ret;
         }
     }
 
     auto k = std::make_tuple('s', signHash);
-    bool ret = db.Exists(k);
+    ret = db.Exists(k);
 
     LOCK(cs);
-    hasSigForSessionCache.emplace(signHash, std::make_pair(ret, t));
+    hasSigForSessionCache.insert(signHash, ret);
     return ret;
 }
 
 bool CRecoveredSigsDb::HasRecoveredSigForHash(const uint256& hash)
 {
+    bool ret;
+    {
+        LOCK(cs);
+        if (hasSigForHashCache.get(hash, ret)) {
+            return ret;
+        }
+        if (nKnownHashesInserted <= KNOWN_HASHES_FILTER_SIZE && !knownHashesFilter.contains(hash)) {
+            // not in the db for sure
+            return false;
+        }
+    }
+
     auto k = std::make_tuple('h', hash);
-    return db.Exists(k);
+    ret = db.Exists(k);
+
+    LOCK(cs);
+    hasSigForHashCache.insert(hash, ret);
+    return ret;
 }
 
 bool CRecoveredSigsDb::ReadRecoveredSig(Consensus::LLMQType llmqType, const uint256& id, CRecoveredSig& ret)
@@ -147,36 +185,11 @@ void CRecoveredSigsDb::WriteRecoveredSig(const llmq::CRecoveredSig& recSig)
     db.WriteBatch(batch);
 
     {
-        int64_t t = GetTimeMillis();
-
         LOCK(cs);
-        hasSigForIdCache[std::make_pair((Consensus::LLMQType)recSig.llmqType, recSig.id)] = std::make_pair(true, t);
-        hasSigForSessionCache[signHash] = std::make_pair(true, t);
-    }
-}
-
-template<typename K>
-static void TruncateCacheMap(std::unordered_map<K, std::pair<bool, int64_t>>& m, size_t maxSize, size_t truncateThreshold)
-{
-    typedef typename std::unordered_map<K, std::pair<bool, int64_t>> Map;
-    typedef typename Map::iterator Iterator;
-
-    if (m.size() <= truncateThreshold) {
-        return;
-    }
-
-    std::vector<Iterator> vec;
-    vec.reserve(m.size());
-    for (auto it = m.begin(); it != m.end(); ++it) {
-        vec.emplace_back(it);
-    }
-    // sort by last access time (descending order)
-    std::sort(vec.begin(), vec.end(), [](const Iterator& it1, const Iterator& it2) {
-        return it1->second.second > it2->second.second;
-    });
-
-    for (size_t i = maxSize; i < vec.size(); i++) {
-        m.erase(vec[i]);
+        hasSigForIdCache.insert(std::make_pair((Consensus::LLMQType)recSig.llmqType, recSig.id), true);
+        hasSigForSessionCache.insert(signHash, true);
+        hasSigForHashCache.insert(recSig.GetHash(), true);
+        AddKnownHash(recSig.GetHash());
     }
 }
 
@@ -237,10 +250,8 @@ void CRecoveredSigsDb::CleanupOldRecoveredSigs(int64_t maxAge)
 
             hasSigForIdCache.erase(std::make_pair((Consensus::LLMQType)recSig.llmqType, recSig.id));
             hasSigForSessionCache.erase(signHash);
+            hasSigForHashCache.erase(recSig.GetHash());
         }
-
-        TruncateCacheMap(hasSigForIdCache, MAX_CACHE_SIZE, MAX_CACHE_TRUNCATE_THRESHOLD);
-        TruncateCacheMap(hasSigForSessionCache, MAX_CACHE_SIZE, MAX_CACHE_TRUNCATE_THRESHOLD);
     }
 
     for (auto& e : toDelete2) {
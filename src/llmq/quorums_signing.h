@@ -8,9 +8,12 @@
 
 #include "llmq/quorums.h"
 
+#include "bloom.h"
 #include "chainparams.h"
 #include "net.h"
+#include "saltedhasher.h"
 #include "sync.h"
+#include "unordered_lru_cache.h"
 
 #include <unordered_map>
 
@@ -77,18 +80,27 @@ public:
     }
 };
 
-// TODO implement caching to speed things up
 class CRecoveredSigsDb
 {
     static const size_t MAX_CACHE_SIZE = 30000;
     static const size_t MAX_CACHE_TRUNCATE_THRESHOLD = 50000;
+    // Hashes of the recovered sigs tracked by the bloom filter (more than a week of sigs in normal conditions)
+    static const unsigned int KNOWN_HASHES_FILTER_SIZE = 100000;
 
 private:
     CDBWrapper db;
 
     RecursiveMutex cs;
-    std::unordered_map<std::pair<Consensus::LLMQType, uint256>, std::pair<bool, int64_t>> hasSigForIdCache;
-    std::unordered_map<uint256, std::pair<bool, int64_t>> hasSigForSessionCache;
+    unordered_lru_cache<std::pair<Consensus::LLMQType, uint256>, bool, StaticSaltedHasher, MAX_CACHE_SIZE, MAX_CACHE_TRUNCATE_THRESHOLD> hasSigForIdCache;
+    unordered_lru_cache<uint256, bool, StaticSaltedHasher, MAX_CACHE_SIZE, MAX_CACHE_TRUNCATE_THRESHOLD> hasSigForSessionCache;
+    unordered_lru_cache<uint256, bool, StaticSaltedHasher, MAX_CACHE_SIZE, MAX_CACHE_TRUNCATE_THRESHOLD> hasSigForHashCache;
+
+    // Hashes of all the recovered sigs in the db (loaded at startup, then updated on write), so that the lookups
+    // of unknown hashes don't need to hit the db. Entries are never removed (a false positive only costs a db read),
+    // but after more than KNOWN_HASHES_FILTER_SIZE insertions the oldest ones may be lost, and from then on a miss
+    // is no longer conclusive.
+    CRollingBloomFilter knownHashesFilter;
+    size_t nKnownHashesInserted{0};
 
 public:
     CRecoveredSigsDb(bool fMemory);
@@ -110,6 +122,8 @@ public:
 
 private:
     bool ReadRecoveredSig(Consensus::LLMQType llmqType, const uint256& id, CRecoveredSig& ret);
+    void LoadKnownHashes();
+    void AddKnownHash(const uint256& hash);
 };
 
 class CRecoveredSigsListener
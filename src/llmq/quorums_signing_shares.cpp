@@ -6,6 +6,7 @@
 #include "quorums_signing_shares.h"
 #include "activemasternode.h"
 #include "bls/bls_batchverifier.h"
+#include "bls/bls_worker.h"
 #include "cxxtimer.h"
 #include "init.h"
 #include "net.h"
@@ -177,7 +178,9 @@ CSigSharesInv CBatchedSigShares::ToInv() const
 
 //////////////////////
 
-CSigSharesManager::CSigSharesManager()
+CSigSharesManager::CSigSharesManager(CBLSWorker& _blsWorker, int _nWorkers) :
+    blsWorker(_blsWorker),
+    nWorkers(std::max(1, std::min(_nWorkers, MAX_SIGSHARES_WORKERS)))
 {
     interruptSigningShare.reset();
 }
@@ -203,6 +206,20 @@ void CSigSharesManager::Interrupt()
     interruptSigningShare();
 }
 
+size_t CSigSharesManager::DynamicMemoryUsage()
+{
+    LOCK(cs);
+    size_t nUsage = memusage::DynamicUsage(sigShares) + memusage::DynamicUsage(firstSeenForSessions) +
+                    memusage::DynamicUsage(nodeStates) + memusage::DynamicUsage(sigSharesRequested) +
+                    memusage::DynamicUsage(sigSharesToAnnounce) + memusage::DynamicUsage(pendingSigns);
+    for (const auto& p : nodeStates) {
+        const CSigSharesNodeState& nodeState = p.second;
+        nUsage += memusage::DynamicUsage(nodeState.sessions) + memusage::DynamicUsage(nodeState.pendingIncomingSigShares) +
+                  memusage::DynamicUsage(nodeState.requestedSigShares) + memusage::DynamicUsage(nodeState.interestedIn);
+    }
+    return nUsage;
+}
+
 void CSigSharesManager::ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman)
 {
     // non-masternodes are not interested in sigshares
@@ -458,14 +475,16 @@ bool CSigSharesManager::ProcessPendingSigShares(CConnman& connman)
     std::map<NodeId, std::vector<CSigShare>> sigSharesByNodes;
     std::map<std::pair<Consensus::LLMQType, uint256>, CQuorumCPtr> quorums;
 
-    CollectPendingSigSharesToVerify(32, sigSharesByNodes, quorums);
+    CollectPendingSigSharesToVerify(32 * (size_t)nWorkers, sigSharesByNodes, quorums);
     if (sigSharesByNodes.empty()) {
         return false;
     }
 
     // It's ok to perform insecure batched verification here as we verify against the quorum public key shares,
-    // which are not craftable by individual entities, making the rogue public key attack impossible
-    CBLSBatchVerifier<NodeId, SigShareKey> batchVerifier(false, true);
+    // which are not craftable by individual entities, making the rogue public key attack impossible.
+    // The sessions are sharded by sign hash, and each shard is verified as a separate batch.
+    typedef CBLSBatchVerifier<NodeId, SigShareKey> BatchVerifier;
+    std::vector<BatchVerifier> batchVerifiers((size_t)nWorkers, BatchVerifier(false, true));
 
     size_t verifyCount = 0;
     for (auto& p : sigSharesByNodes) {
@@ -495,22 +514,30 @@ bool CSigSharesManager::ProcessPendingSigShares(CConnman& connman)
                 assert(false);
             }
 
-            batchVerifier.PushMessage(nodeId, sigShare.GetKey(), sigShare.GetSignHash(), sigShare.sigShare.Get(), pubKeyShare);
+            batchVerifiers[GetShard(sigShare.GetSignHash())].PushMessage(nodeId, sigShare.GetKey(), sigShare.GetSignHash(), sigShare.sigShare.Get(), pubKeyShare);
             verifyCount++;
         }
     }
 
-    cxxtimer::Timer verifyTimer;
-    batchVerifier.Verify();
+    cxxtimer::Timer verifyTimer(true);
+    RunSharded([&](size_t i) {
+        batchVerifiers[i].Verify();
+    });
     verifyTimer.stop();
 
-    LogPrintf("llmq", "CSigSharesManager::%s -- verified sig shares. count=%d, vt=%d, nodes=%d\n", __func__, verifyCount, verifyTimer.count(), sigSharesByNodes.size());
+    std::set<NodeId> badSources;
+    for (const auto& batchVerifier : batchVerifiers) {
+        badSources.insert(batchVerifier.badSources.begin(), batchVerifier.badSources.end());
+    }
+
+    LogPrintf("llmq", "CSigSharesManager::%s -- verified sig shares. count=%d, vt=%d, nodes=%d, shards=%d\n", __func__, verifyCount, verifyTimer.count(), sigSharesByNodes.size(), nWorkers);
 
+    std::map<uint256, const CSigShare*> sessionsToRecover;
     for (auto& p : sigSharesByNodes) {
         auto nodeId = p.first;
         auto& v = p.second;
 
-        if (batchVerifier.badSources.count(nodeId)) {
+        if (badSources.count(nodeId)) {
             LogPrintf("llmq", "CSigSharesManager::%s -- invalid sig shares from other node, banning peer=%d\n",
                 __func__, nodeId);
             // this will also cause re-requesting of the shares that were sent by this node
@@ -518,14 +545,38 @@ bool CSigSharesManager::ProcessPendingSigShares(CConnman& connman)
             continue;
         }
 
-        ProcessPendingSigSharesFromNode(nodeId, v, quorums, connman);
+        ProcessPendingSigSharesFromNode(nodeId, v, quorums, connman, sessionsToRecover);
+    }
+
+    // Recover the signatures of the completed sessions concurrently (one shard per worker),
+    // then process them here, shard by shard (each shard in sign hash order). The order doesn't matter, as
+    // the recovered sigs are of distinct sessions.
+    std::vector<std::vector<std::pair<CRecoveredSig, CQuorumCPtr>>> recoveredSigs((size_t)nWorkers);
+    std::vector<std::vector<const CSigShare*>> sessionsByShard((size_t)nWorkers);
+    for (const auto& p : sessionsToRecover) {
+        sessionsByShard[GetShard(p.first)].emplace_back(p.second);
+    }
+    RunSharded([&](size_t i) {
+        for (const CSigShare* sigShare : sessionsByShard[i]) {
+            const auto& quorum = quorums.at(std::make_pair((Consensus::LLMQType)sigShare->llmqType, sigShare->quorumHash));
+            CRecoveredSig rs;
+            if (RecoverSig(quorum, sigShare->id, sigShare->msgHash, rs)) {
+                recoveredSigs[i].emplace_back(rs, quorum);
+            }
+        }
+    });
+    for (const auto& v : recoveredSigs) {
+        for (const auto& p : v) {
+            quorumSigningManager->ProcessRecoveredSig(-1, p.first, p.second, connman);
+        }
     }
 
     return true;
 }
 
 // It's ensured that no duplicates are passed to this method
-void CSigSharesManager::ProcessPendingSigSharesFromNode(NodeId nodeId, const std::vector<CSigShare>& sigShares, const std::map<std::pair<Consensus::LLMQType, uint256>, CQuorumCPtr>& quorums, CConnman& connman)
+void CSigSharesManager::ProcessPendingSigSharesFromNode(NodeId nodeId, const std::vector<CSigShare>& sigShares, const std::map<std::pair<Consensus::LLMQType, uint256>, CQuorumCPtr>& quorums, CConnman& connman,
+                                                        std::map<uint256, const CSigShare*>& retSessionsToRecover)
 {
     LOCK(cs);
     auto& nodeState = nodeStates[nodeId];
@@ -539,7 +590,9 @@ void CSigSharesManager::ProcessPendingSigSharesFromNode(NodeId nodeId, const std
         auto quorumKey = std::make_pair((Consensus::LLMQType)sigShare.llmqType, sigShare.quorumHash);
         nodeState.interestedIn.emplace(quorumKey);
 
-        ProcessSigShare(nodeId, sigShare, connman, quorums.at(quorumKey));
+        if (ProcessSigShare(nodeId, sigShare, connman, quorums.at(quorumKey))) {
+            retSessionsToRecover.emplace(sigShare.GetSignHash(), &sigShare);
+        }
     }
     t.stop();
 
@@ -548,7 +601,7 @@ void CSigSharesManager::ProcessPendingSigSharesFromNode(NodeId nodeId, const std
 }
 
 // sig shares are already verified when entering this method
-void CSigSharesManager::ProcessSigShare(NodeId nodeId, const CSigShare& sigShare, CConnman& connman, const CQuorumCPtr& quorum)
+bool CSigSharesManager::ProcessSigShare(NodeId nodeId, const CSigShare& sigShare, CConnman& connman, const CQuorumCPtr& quorum)
 {
     auto llmqType = quorum->params.type;
 
@@ -565,14 +618,14 @@ void CSigSharesManager::ProcessSigShare(NodeId nodeId, const CSigShare& sigShare
     }
 
     if (quorumSigningManager->HasRecoveredSigForId(llmqType, sigShare.id)) {
-        return;
+        return false;
     }
 
     {
         LOCK(cs);
 
         if (!sigShares.emplace(sigShare.GetKey(), sigShare).second) {
-            return;
+            return false;
         }
 
         sigSharesToAnnounce.emplace(sigShare.GetKey());
@@ -597,15 +650,21 @@ void CSigSharesManager::ProcessSigShare(NodeId nodeId, const CSigShare& sigShare
         }
     }
 
-    if (canTryRecovery) {
-        TryRecoverSig(quorum, sigShare.id, sigShare.msgHash, connman);
-    }
+    return canTryRecovery;
 }
 
 void CSigSharesManager::TryRecoverSig(const CQuorumCPtr& quorum, const uint256& id, const uint256& msgHash, CConnman& connman)
+{
+    CRecoveredSig rs;
+    if (RecoverSig(quorum, id, msgHash, rs)) {
+        quorumSigningManager->ProcessRecoveredSig(-1, rs, quorum, connman);
+    }
+}
+
+bool CSigSharesManager::RecoverSig(const CQuorumCPtr& quorum, const uint256& id, const uint256& msgHash, CRecoveredSig& rsRet)
 {
     if (quorumSigningManager->HasRecoveredSigForId(quorum->params.type, id)) {
-        return;
+        return false;
     }
 
     std::vector<CBLSSignature> sigSharesForRecovery;
@@ -613,8 +672,6 @@ void CSigSharesManager::TryRecoverSig(const CQuorumCPtr& quorum, const uint256&
     {
         LOCK(cs);
 
-        auto k = std::make_pair(quorum->params.type, id);
-
         auto signHash = llmq::utils::BuildSignHash(quorum->params.type, quorum->pindexQuorum->GetBlockHash(), id, msgHash);
         auto itPair = FindBySignHash(sigShares, signHash);
 
@@ -628,7 +685,7 @@ void CSigSharesManager::TryRecoverSig(const CQuorumCPtr& quorum, const uint256&
 
         // check if we can recover the final signature
         if (sigSharesForRecovery.size() < quorum->params.threshold) {
-            return;
+            return false;
         }
     }
 
@@ -638,30 +695,44 @@ void CSigSharesManager::TryRecoverSig(const CQuorumCPtr& quorum, const uint256&
     if (!recoveredSig.Recover(sigSharesForRecovery, idsForRecovery)) {
         LogPrintf("CSigSharesManager::%s -- failed to recover signature. id=%s, msgHash=%s, time=%d\n", __func__,
             id.ToString(), msgHash.ToString(), t.count());
-        return;
+        return false;
     }
 
     LogPrintf("CSigSharesManager::%s -- recovered signature. id=%s, msgHash=%s, time=%d\n", __func__,
         id.ToString(), msgHash.ToString(), t.count());
 
-    CRecoveredSig rs;
-    rs.llmqType = quorum->params.type;
-    rs.quorumHash = quorum->pindexQuorum->GetBlockHash();
-    rs.id = id;
-    rs.msgHash = msgHash;
-    rs.sig = recoveredSig;
-    rs.UpdateHash();
-
-    auto signHash = llmq::utils::BuildSignHash(rs);
-    bool valid = rs.sig.VerifyInsecure(quorum->quorumPublicKey, signHash);
+    rsRet.llmqType = quorum->params.type;
+    rsRet.quorumHash = quorum->pindexQuorum->GetBlockHash();
+    rsRet.id = id;
+    rsRet.msgHash = msgHash;
+    rsRet.sig = recoveredSig;
+    rsRet.UpdateHash();
+
+    auto signHash = llmq::utils::BuildSignHash(rsRet);
+    bool valid = rsRet.sig.VerifyInsecure(quorum->quorumPublicKey, signHash);
     if (!valid) {
         // this should really not happen as we have verified all signature shares before
         LogPrintf("CSigSharesManager::%s -- own recovered signature is invalid. id=%s, msgHash=%s\n", __func__,
             id.ToString(), msgHash.ToString());
-        return;
+        return false;
     }
 
-    quorumSigningManager->ProcessRecoveredSig(-1, rs, quorum, connman);
+    return true;
+}
+
+void CSigSharesManager::RunSharded(const std::function<void(size_t)>& job)
+{
+    std::vector<std::future<void>> futures;
+    futures.reserve((size_t)nWorkers - 1);
+    for (size_t i = 1; i < (size_t)nWorkers; i++) {
+        futures.emplace_back(blsWorker.AsyncRun([&job, i]() {
+            job(i);
+        }));
+    }
+    job(0);
+    for (auto& f : futures) {
+        f.get();
+    }
 }
 
 // cs must be held
@@ -1195,6 +1266,8 @@ void CSigSharesManager::Sign(const CQuorumCPtr& quorum, const uint256& id, const
 
     LogPrintf("CSigSharesManager::%s -- signed sigShare. id=%s, msgHash=%s, time=%s\n", __func__,
         sigShare.id.ToString(), sigShare.msgHash.ToString(), t.count());
-    ProcessSigShare(-1, sigShare, *g_connman, quorum);
+    if (ProcessSigShare(-1, sigShare, *g_connman, quorum)) {
+        TryRecoverSig(quorum, sigShare.id, sigShare.msgHash, *g_connman);
+    }
 }
 } // namespace llmq
\ No newline at end of file
@@ -20,12 +20,19 @@
 #include <mutex>
 #include <thread>
 
+class CBLSWorker;
 class CEvoDB;
 class CScheduler;
 
 namespace llmq
 {
 
+class CRecoveredSig;
+
+// Number of shards (by sign hash) of the pending sig shares, verified and recovered concurrently
+static const int DEFAULT_SIGSHARES_WORKERS = 4;
+static const int MAX_SIGSHARES_WORKERS = 16;
+
 // <signHash, quorumMember>
 typedef std::pair<uint256, uint16_t> SigShareKey;
 
@@ -165,6 +172,9 @@ class CSigSharesManager
 private:
     RecursiveMutex cs;
 
+    CBLSWorker& blsWorker;
+    const int nWorkers;
+
     std::thread workThread;
     CThreadInterrupt interruptSigningShare;
 
@@ -183,13 +193,16 @@ private:
     int64_t lastCleanupTime{0};
 
 public:
-    CSigSharesManager();
+    CSigSharesManager(CBLSWorker& _blsWorker, int _nWorkers);
     ~CSigSharesManager();
 
     void StartWorkerThread();
     void StopWorkerThread();
     void Interrupt();
 
+    // Estimated memory usage of the sig shares, and of the sessions and requests of the nodes
+    size_t DynamicMemoryUsage();
+
 public:
     void ProcessMessage(CNode* pnode, const std::string& strCommand, CDataStream& vRecv, CConnman& connman);
 
@@ -207,10 +220,19 @@ private:
     void CollectPendingSigSharesToVerify(size_t maxUniqueSessions, std::map<NodeId, std::vector<CSigShare>>& retSigShares, std::map<std::pair<Consensus::LLMQType, uint256>, CQuorumCPtr>& retQuorums);
     bool ProcessPendingSigShares(CConnman& connman);
 
-    void ProcessPendingSigSharesFromNode(NodeId nodeId, const std::vector<CSigShare>& sigShares, const std::map<std::pair<Consensus::LLMQType, uint256>, CQuorumCPtr>& quorums, CConnman& connman);
+    // Adds to retSessionsToRecover (by sign hash) the sessions that have enough sig shares to be recovered
+    void ProcessPendingSigSharesFromNode(NodeId nodeId, const std::vector<CSigShare>& sigShares, const std::map<std::pair<Consensus::LLMQType, uint256>, CQuorumCPtr>& quorums, CConnman& connman,
+                                         std::map<uint256, const CSigShare*>& retSessionsToRecover);
 
-    void ProcessSigShare(NodeId nodeId, const CSigShare& sigShare, CConnman& connman, const CQuorumCPtr& quorum);
+    // Returns true if the session of the sig share has enough shares to try the recovery
+    bool ProcessSigShare(NodeId nodeId, const CSigShare& sigShare, CConnman& connman, const CQuorumCPtr& quorum);
     void TryRecoverSig(const CQuorumCPtr& quorum, const uint256& id, const uint256& msgHash, CConnman& connman);
+    // Recover and verify the signature of a session. Doesn't process it (thread safe)
+    bool RecoverSig(const CQuorumCPtr& quorum, const uint256& id, const uint256& msgHash, CRecoveredSig& rsRet);
+
+    // Run job(i) for each shard i, on the BLS worker pool (shard 0 on the calling thread), and wait for all of them
+    void RunSharded(const std::function<void(size_t)>& job);
+    size_t GetShard(const uint256& signHash) const { return (size_t)(signHash.GetCheapHash() % (uint64_t)nWorkers); }
 
 private:
     void Cleanup();
@@ -5,6 +5,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "logging.h"
+#include "util/threadnames.h"
 #include "utiltime.h"
 
 
@@ -28,6 +29,14 @@ BCLog::Logger* const g_logger = new BCLog::Logger();
 bool fLogIPs = DEFAULT_LOGIPS;
 
 
+BCLog::Logger::~Logger()
+{
+    StopAsync();
+    if (m_fileout) {
+        fclose(m_fileout);
+    }
+}
+
 static int FileWriteStr(const std::string &str, FILE *fp)
 {
     return fwrite(str.data(), 1, str.size(), fp);
@@ -208,6 +217,24 @@ void BCLog::Logger::LogPrintStr(const std::string &str)
 {
     std::string strTimestamped = LogTimestampStr(str);
 
+    if (m_async) {
+        // Registered as a producer before checking m_async again: StopAsync waits for
+        // the message to be pushed before draining the buffer.
+        ++m_async_producers;
+        if (m_async) {
+            if (!PushAsync(std::move(strTimestamped))) {
+                ++m_async_dropped;
+            }
+            --m_async_producers;
+            return;
+        }
+        --m_async_producers;
+    }
+    WriteStr(strTimestamped);
+}
+
+void BCLog::Logger::WriteStr(const std::string& strTimestamped)
+{
     if (m_print_to_console) {
         // print to console
         fwrite(strTimestamped.data(), 1, strTimestamped.size(), stdout);
@@ -237,6 +264,103 @@ void BCLog::Logger::LogPrintStr(const std::string &str)
     }
 }
 
+bool BCLog::Logger::PushAsync(std::string&& str)
+{
+    size_t pos = m_async_enqueue_pos.load(std::memory_order_relaxed);
+    while (true) {
+        AsyncSlot& slot = m_async_slots[pos & (m_async_buffer_size - 1)];
+        const size_t seq = slot.seq.load(std::memory_order_acquire);
+        if (seq == pos) {
+            // Free slot: claim it
+            if (m_async_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                slot.msg = std::move(str);
+                slot.seq.store(pos + 1, std::memory_order_release);
+                break;
+            }
+        } else if (seq < pos) {
+            // Still holding the message of the previous lap: the buffer is full
+            return false;
+        } else {
+            // Claimed by another producer
+            pos = m_async_enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+    if (m_async_writer_waiting.load()) {
+        m_async_cond.notify_one();
+    }
+    return true;
+}
+
+void BCLog::Logger::AsyncWriterThread()
+{
+    util::ThreadRename("pivx-logger");
+    // the drops of a previous run were already reported
+    uint64_t nDroppedReported = m_async_dropped.load();
+    while (true) {
+        // Read before looking at the buffer: once set, all the messages are in it
+        const bool fStop = m_async_stop;
+        AsyncSlot& slot = m_async_slots[m_async_dequeue_pos & (m_async_buffer_size - 1)];
+        if (slot.seq.load(std::memory_order_acquire) == m_async_dequeue_pos + 1) {
+            std::string str = std::move(slot.msg);
+            slot.msg.clear();
+            // Free the slot for the producers of the next lap
+            slot.seq.store(m_async_dequeue_pos + m_async_buffer_size, std::memory_order_release);
+            m_async_dequeue_pos++;
+            WriteStr(str);
+            continue;
+        }
+
+        // Empty buffer
+        const uint64_t nDropped = m_async_dropped.load();
+        if (nDropped != nDroppedReported) {
+            std::string str = strprintf("Logger: %u messages dropped\n", nDropped - nDroppedReported);
+            if (m_log_timestamps) str = FormatISO8601DateTime(GetTime()) + ' ' + str;
+            WriteStr(str);
+            nDroppedReported = nDropped;
+        }
+        if (fStop) break;
+        std::unique_lock<std::mutex> lock(m_async_mutex);
+        m_async_writer_waiting = true;
+        // The producers notify without the mutex: the timeout covers a message pushed
+        // right before the flag was set.
+        m_async_cond.wait_for(lock, std::chrono::milliseconds(100));
+        m_async_writer_waiting = false;
+    }
+}
+
+void BCLog::Logger::StartAsync(size_t nBufferSize)
+{
+    if (m_async) return;
+    assert(nBufferSize > 0 && (nBufferSize & (nBufferSize - 1)) == 0);
+    if (!m_async_slots || m_async_buffer_size != nBufferSize) {
+        m_async_slots.reset(new AsyncSlot[nBufferSize]);
+        m_async_buffer_size = nBufferSize;
+    }
+    for (size_t i = 0; i < m_async_buffer_size; i++) {
+        m_async_slots[i].seq = i;
+    }
+    m_async_enqueue_pos = 0;
+    m_async_dequeue_pos = 0;
+    m_async_stop = false;
+    m_async_writer = std::thread(&BCLog::Logger::AsyncWriterThread, this);
+    m_async = true;
+}
+
+void BCLog::Logger::StopAsync()
+{
+    if (!m_async) return;
+    m_async = false;
+    while (m_async_producers.load() > 0) {
+        std::this_thread::yield();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_async_mutex);
+        m_async_stop = true;
+    }
+    m_async_cond.notify_one();
+    m_async_writer.join();
+}
+
 void BCLog::Logger::ShrinkDebugFile()
 {
     // Amount of debug.log to save at end when shrinking (must fit in memory)
@@ -16,15 +16,21 @@
 #include "tinyformat.h"
 
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
 #include <list>
+#include <memory>
 #include <mutex>
+#include <thread>
 #include <vector>
 
 
 static const bool DEFAULT_LOGTIMEMICROS = false;
 static const bool DEFAULT_LOGIPS        = false;
 static const bool DEFAULT_LOGTIMESTAMPS = true;
+static const bool DEFAULT_LOGASYNC      = false;
+//! Number of messages buffered for the background writer (a power of 2)
+static const size_t LOG_ASYNC_BUFFER_SIZE = 1 << 16;
 extern const char * const DEFAULT_DEBUGLOGFILE;
 
 extern bool fLogIPs;
@@ -88,7 +94,39 @@ namespace BCLog {
 
         std::string LogTimestampStr(const std::string& str);
 
+        /** Write a timestamped message to the enabled outputs */
+        void WriteStr(const std::string& str);
+
+        /**
+         * Asynchronous mode: the messages are pushed to a bounded lock-free ring buffer
+         * (multiple producers, the writer thread as single consumer), and dropped when it's full.
+         * The sequence number of a slot tells whether it's free for the producer at that position
+         * (seq == pos) or holds its message for the consumer (seq == pos + 1).
+         */
+        struct AsyncSlot {
+            std::atomic<size_t> seq{0};
+            std::string msg;
+        };
+        std::unique_ptr<AsyncSlot[]> m_async_slots;
+        size_t m_async_buffer_size{0};
+        std::atomic<size_t> m_async_enqueue_pos{0};
+        size_t m_async_dequeue_pos{0};
+        std::atomic<bool> m_async{false};
+        //! Producers between the check of m_async and the push of their message
+        std::atomic<int> m_async_producers{0};
+        std::atomic<bool> m_async_stop{false};
+        std::atomic<bool> m_async_writer_waiting{false};
+        std::atomic<uint64_t> m_async_dropped{0};
+        std::mutex m_async_mutex;
+        std::condition_variable m_async_cond;
+        std::thread m_async_writer;
+
+        bool PushAsync(std::string&& str);
+        void AsyncWriterThread();
+
     public:
+        ~Logger();
+
         bool m_print_to_console = false;
         bool m_print_to_file = false;
 
@@ -107,6 +145,13 @@ namespace BCLog {
         bool OpenDebugLog();
         void ShrinkDebugFile();
 
+        /** Write the messages from a background thread from now on, buffering up to nBufferSize (a power of 2) of them */
+        void StartAsync(size_t nBufferSize = LOG_ASYNC_BUFFER_SIZE);
+        /** Write the pending messages and get back to writing them from the calling threads */
+        void StopAsync();
+        /** Number of messages dropped because the background writer didn't keep up */
+        uint64_t GetDroppedCount() const { return m_async_dropped.load(); }
+
         uint32_t GetCategoryMask() const { return m_categories.load(); }
 
         void EnableCategory(LogFlags flag);
@@ -5,20 +5,27 @@
 
 #include "masternode-payments.h"
 
+#include "bls/bls_batchverifier.h"
 #include "chainparams.h"
+#include "ctpl_stl.h"
 #include "evo/deterministicmns.h"
 #include "fs.h"
 #include "budget/budgetmanager.h"
 #include "masternodeman.h"
+#include "net_processing.h"
 #include "netmessagemaker.h"
 #include "tiertwo/netfulfilledman.h"
 #include "spork.h"
 #include "sync.h"
 #include "tiertwo/tiertwo_sync_state.h"
 #include "util/system.h"
+#include "util/threadnames.h"
 #include "utilmoneystr.h"
 #include "validation.h"
 
+#include <condition_variable>
+#include <deque>
+#include <thread>
 
 /** Object for who's going to get paid on which blocks */
 CMasternodePayments masternodePayments;
@@ -49,22 +56,14 @@ bool CMasternodePaymentDB::Write(const CMasternodePayments& objToSave)
     ssObj << strMagicMessage;                   // masternode cache file specific magic message
     ssObj << Params().MessageStart(); // network specific magic number
     ssObj << objToSave;
-    uint256 hash = Hash(ssObj.begin(), ssObj.end());
-    ssObj << hash;
-
-    // open output file, and associate with CAutoFile
-    FILE* file = fsbridge::fopen(pathDB, "wb");
-    CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
-    if (fileout.IsNull())
-        return error("%s : Failed to open file %s", __func__, pathDB.string());
-
-    // Write and commit header, data
-    try {
-        fileout << ssObj;
-    } catch (const std::exception& e) {
-        return error("%s : Serialize or I/O error - %s", __func__, e.what());
+    bool fWritten;
+    if (!WriteFile(pathDB, ssObj, fWritten)) {
+        return false;
+    }
+    if (!fWritten) {
+        LogPrint(BCLog::MASTERNODE,"mnpayments.dat unchanged, not written\n");
+        return true;
     }
-    fileout.fclose();
 
     LogPrint(BCLog::MASTERNODE,"Written info to mnpayments.dat  %dms\n", GetTimeMillis() - nStart);
 
@@ -74,41 +73,10 @@ bool CMasternodePaymentDB::Write(const CMasternodePayments& objToSave)
 CMasternodePaymentDB::ReadResult CMasternodePaymentDB::Read(CMasternodePayments& objToLoad)
 {
     int64_t nStart = GetTimeMillis();
-    // open input file, and associate with CAutoFile
-    FILE* file = fsbridge::fopen(pathDB, "rb");
-    CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull()) {
-        error("%s : Failed to open file %s", __func__, pathDB.string());
-        return FileError;
-    }
-
-    // use file size to size memory buffer
-    int fileSize = fs::file_size(pathDB);
-    int dataSize = fileSize - sizeof(uint256);
-    // Don't try to resize to a negative number if file is small
-    if (dataSize < 0)
-        dataSize = 0;
-    std::vector<unsigned char> vchData;
-    vchData.resize(dataSize);
-    uint256 hashIn;
-
-    // read data and checksum from file
-    try {
-        filein.read((char*)vchData.data(), dataSize);
-        filein >> hashIn;
-    } catch (const std::exception& e) {
-        error("%s : Deserialize or I/O error - %s", __func__, e.what());
-        return HashReadError;
-    }
-    filein.fclose();
-
-    CDataStream ssObj(vchData, SER_DISK, CLIENT_VERSION);
-
-    // verify stored checksum matches input data
-    uint256 hashTmp = Hash(ssObj.begin(), ssObj.end());
-    if (hashIn != hashTmp) {
-        error("%s : Checksum mismatch, data corrupted", __func__);
-        return IncorrectHash;
+    CDataStream ssObj(SER_DISK, CLIENT_VERSION);
+    ReadResult readResult = ReadFile(pathDB, ssObj);
+    if (readResult != Ok) {
+        return readResult;
     }
 
     int version;
@@ -396,6 +364,222 @@ void CMasternodePayments::FillBlockPayee(CMutableTransaction& txCoinbase, CMutab
     }
 }
 
+//! Maximum number of winner votes waiting for the verification of their signature
+static const size_t MAX_PENDING_MNW_VOTES = 20000;
+//! Maximum number of winner votes verified together
+static const size_t MAX_MNW_VERIFY_BATCH = 500;
+
+/**
+ * Verifies the signatures of the winner votes received from the peers, in batches, out of the message
+ * processing threads. The ECDSA signatures (legacy masternodes) are spread over a pool of threads, while
+ * the BLS signatures (deterministic masternodes) are verified together with a CBLSBatchVerifier.
+ * The valid votes are then accepted in the order they were received.
+ */
+class CMNWinnerVotesVerifier
+{
+public:
+    struct PendingVote
+    {
+        CMasternodePaymentWinner winner;
+        NodeId nodeId;
+        CKeyID keyID;
+        CBLSPublicKey pubKey;
+    };
+
+private:
+    Mutex cs;
+    std::condition_variable cvPending;
+    std::condition_variable cvIdle;
+    std::deque<PendingVote> pendingVotes GUARDED_BY(cs);
+    // Set while a batch taken from pendingVotes is processed
+    bool fVerifying GUARDED_BY(cs){false};
+    bool fStopped GUARDED_BY(cs){false};
+
+    ctpl::thread_pool workerPool;
+    std::thread verifyThread;
+
+    void ThreadVerifyVotes();
+    void VerifyBatch(std::vector<PendingVote>& batch, std::vector<char>& vValid);
+
+public:
+    explicit CMNWinnerVotesVerifier(int nThreads)
+    {
+        // The verification thread checks the BLS signatures, the pool the ECDSA ones
+        workerPool.resize(std::max(1, nThreads - 1));
+        RenameThreadPool(workerPool, "pivx-mnw-verify");
+        verifyThread = std::thread(&TraceThread<std::function<void()>>, "mnwverify", std::function<void()>(std::bind(&CMNWinnerVotesVerifier::ThreadVerifyVotes, this)));
+    }
+    ~CMNWinnerVotesVerifier() { Stop(); }
+
+    // Take the vote, or return false if it can't be queued (stopped)
+    bool Push(PendingVote& vote);
+    // Wait until the queued votes are processed (or the verification stopped)
+    void WaitForIdle();
+    void Stop();
+};
+
+bool CMNWinnerVotesVerifier::Push(PendingVote& vote)
+{
+    {
+        LOCK(cs);
+        if (fStopped) return false;
+        if (pendingVotes.size() >= MAX_PENDING_MNW_VOTES) {
+            // Dropped without penalty: it can be requested again with the next sync
+            LogPrint(BCLog::MASTERNODE, "mnw - too many votes pending verification, dropping %s\n", vote.winner.GetHash().ToString());
+            return true;
+        }
+        pendingVotes.emplace_back(std::move(vote));
+    }
+    cvPending.notify_one();
+    return true;
+}
+
+void CMNWinnerVotesVerifier::WaitForIdle()
+{
+    WAIT_LOCK(cs, lock);
+    cvIdle.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(cs) { return fStopped || (pendingVotes.empty() && !fVerifying); });
+}
+
+void CMNWinnerVotesVerifier::Stop()
+{
+    {
+        LOCK(cs);
+        if (fStopped) return;
+        fStopped = true;
+    }
+    cvPending.notify_all();
+    cvIdle.notify_all();
+    if (verifyThread.joinable()) verifyThread.join();
+    workerPool.stop(true);
+}
+
+void CMNWinnerVotesVerifier::VerifyBatch(std::vector<PendingVote>& batch, std::vector<char>& vValid)
+{
+    // ECDSA, in chunks over the worker pool
+    std::vector<size_t> vECDSA;
+    for (size_t i = 0; i < batch.size(); i++) {
+        if (!batch[i].pubKey.IsValid()) vECDSA.emplace_back(i);
+    }
+    const size_t nChunks = std::min(vECDSA.size(), (size_t)workerPool.size());
+    std::vector<std::future<void>> vFutures;
+    for (size_t c = 0; c < nChunks; c++) {
+        vFutures.emplace_back(workerPool.push([&, c](int threadId) {
+            for (size_t j = c; j < vECDSA.size(); j += nChunks) {
+                const PendingVote& vote = batch[vECDSA[j]];
+                vValid[vECDSA[j]] = vote.winner.CheckSignature(vote.keyID);
+            }
+        }));
+    }
+
+    // BLS, batched on this thread meanwhile. Secure aggregation, as the operator keys are not
+    // proven, with a fallback on each vote of the peers sending invalid signatures.
+    CBLSBatchVerifier<NodeId, size_t> blsVerifier(true, true);
+    for (size_t i = 0; i < batch.size(); i++) {
+        const PendingVote& vote = batch[i];
+        if (!vote.pubKey.IsValid()) continue;
+        CBLSSignature sig(vote.winner.GetVchSig());
+        if (!sig.IsValid()) {
+            vValid[i] = false;
+            continue;
+        }
+        blsVerifier.PushMessage(vote.nodeId, i, vote.winner.GetSignatureHash(), sig, vote.pubKey);
+        vValid[i] = true;
+    }
+    blsVerifier.Verify();
+    for (size_t i : blsVerifier.badMessages) {
+        vValid[i] = false;
+    }
+
+    for (auto& f : vFutures) {
+        f.get();
+    }
+}
+
+void CMNWinnerVotesVerifier::ThreadVerifyVotes()
+{
+    while (true) {
+        std::vector<PendingVote> batch;
+        {
+            WAIT_LOCK(cs, lock);
+            cvPending.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(cs) { return fStopped || !pendingVotes.empty(); });
+            if (fStopped) return;
+            const size_t nSize = std::min(pendingVotes.size(), MAX_MNW_VERIFY_BATCH);
+            batch.reserve(nSize);
+            for (size_t i = 0; i < nSize; i++) {
+                batch.emplace_back(std::move(pendingVotes.front()));
+                pendingVotes.pop_front();
+            }
+            fVerifying = true;
+        }
+
+        std::vector<char> vValid(batch.size(), false);
+        VerifyBatch(batch, vValid);
+
+        for (size_t i = 0; i < batch.size(); i++) {
+            PendingVote& vote = batch[i];
+            if (!vValid[i]) {
+                LogPrint(BCLog::MASTERNODE, "%s : mnw - invalid signature for %s masternode: %s\n",
+                        __func__, (vote.pubKey.IsValid() ? "deterministic" : "legacy"), vote.winner.vinMasternode.prevout.hash.ToString());
+                LOCK(cs_main);
+                Misbehaving(vote.nodeId, 20);
+                continue;
+            }
+            CValidationState state;
+            masternodePayments.AcceptMNWinner(vote.winner, state);
+        }
+
+        WITH_LOCK(cs, fVerifying = false);
+        cvIdle.notify_all();
+    }
+}
+
+// Set while the winner votes are verified in batches
+static std::unique_ptr<CMNWinnerVotesVerifier> mnwVotesVerifier;
+
+void StartMNWinnerVotesVerification(int nThreads)
+{
+    assert(!mnwVotesVerifier);
+    if (nThreads > 0) {
+        mnwVotesVerifier = std::make_unique<CMNWinnerVotesVerifier>(nThreads);
+    }
+}
+
+void StopMNWinnerVotesVerification()
+{
+    // Only stopped: the message threads could still be queueing. The votes queued from now on are verified in place.
+    if (mnwVotesVerifier) mnwVotesVerifier->Stop();
+}
+
+bool QueueMNWinnerVerification(const CMasternodePaymentWinner& winner, NodeId nodeId, const CKeyID& keyID, const CBLSPublicKey& pubKey)
+{
+    if (!mnwVotesVerifier) return false;
+    CMNWinnerVotesVerifier::PendingVote vote{winner, nodeId, keyID, pubKey};
+    return mnwVotesVerifier->Push(vote);
+}
+
+void SyncWithMNWinnerVotesVerification()
+{
+    if (mnwVotesVerifier) mnwVotesVerifier->WaitForIdle();
+}
+
+bool CMasternodePayments::QueueMNWinner(CMasternodePaymentWinner& winner, CNode* pfrom, CValidationState& state)
+{
+    if (!mnwVotesVerifier || !pfrom) return false;
+    CKeyID keyID;
+    CBLSPublicKey pubKey;
+    if (!CheckMNWinner(winner, pfrom, state, keyID, pubKey)) {
+        // processed (rejected)
+        return true;
+    }
+    if (!QueueMNWinnerVerification(winner, pfrom->GetId(), keyID, pubKey)) {
+        // stopped, verify it here
+        if (CheckMNWinnerSignature(winner, keyID, pubKey, state)) {
+            AcceptMNWinner(winner, state);
+        }
+    }
+    return true;
+}
+
 bool CMasternodePayments::ProcessMessageMasternodePayments(CNode* pfrom, std::string& strCommand, CDataStream& vRecv, CValidationState& state)
 {
     if (!g_tiertwo_sync_state.IsBlockchainSynced()) return true;
@@ -412,13 +596,13 @@ bool CMasternodePayments::ProcessMessageMasternodePayments(CNode* pfrom, std::st
         vRecv >> nCountNeeded;
 
         if (Params().NetworkIDString() == CBaseChainParams::MAIN) {
-            if (g_netfulfilledman.HasFulfilledRequest(pfrom->addr, NetMsgType::GETMNWINNERS)) {
+            if (g_netfulfilledman.HasFulfilledRequest(pfrom->addr, NetRequest::MNW_SYNC_RECV)) {
                 LogPrint(BCLog::MASTERNODE, "%s: mnget - peer already asked me for the list\n", __func__);
                 return state.DoS(20, false, REJECT_INVALID, "getmnwinners-request-already-fulfilled");
             }
         }
 
-        g_netfulfilledman.AddFulfilledRequest(pfrom->addr, NetMsgType::GETMNWINNERS);
+        g_netfulfilledman.AddFulfilledRequest(pfrom->addr, NetRequest::MNW_SYNC_RECV);
         Sync(pfrom, nCountNeeded);
         LogPrint(BCLog::MASTERNODE, "mnget - Sent Masternode winners to peer %i\n", pfrom->GetId());
     } else if (strCommand == NetMsgType::MNWINNER) {
@@ -433,7 +617,9 @@ bool CMasternodePayments::ProcessMessageMasternodePayments(CNode* pfrom, std::st
             g_connman->RemoveAskFor(winner.GetHash(), MSG_MASTERNODE_WINNER);
         }
 
-        ProcessMNWinner(winner, pfrom, state);
+        if (!QueueMNWinner(winner, pfrom, state)) {
+            ProcessMNWinner(winner, pfrom, state);
+        }
         return state.IsValid();
     }
 
@@ -441,6 +627,34 @@ bool CMasternodePayments::ProcessMessageMasternodePayments(CNode* pfrom, std::st
 }
 
 bool CMasternodePayments::ProcessMNWinner(CMasternodePaymentWinner& winner, CNode* pfrom, CValidationState& state)
+{
+    CKeyID keyID;
+    CBLSPublicKey pubKey;
+    if (!CheckMNWinner(winner, pfrom, state, keyID, pubKey)) {
+        return false;
+    }
+
+    if (!CheckMNWinnerSignature(winner, keyID, pubKey, state)) {
+        return false;
+    }
+
+    return AcceptMNWinner(winner, state);
+}
+
+bool CMasternodePayments::CheckMNWinnerSignature(const CMasternodePaymentWinner& winner, const CKeyID& keyID, const CBLSPublicKey& pubKey, CValidationState& state) const
+{
+    const bool fDeterministic = pubKey.IsValid();
+    bool is_valid_sig = fDeterministic ? winner.CheckSignature(pubKey) : winner.CheckSignature(keyID);
+
+    if (!is_valid_sig) {
+        LogPrint(BCLog::MASTERNODE, "%s : mnw - invalid signature for %s masternode: %s\n",
+                __func__, (fDeterministic ? "deterministic" : "legacy"), winner.vinMasternode.prevout.hash.ToString());
+        return state.DoS(20, false, REJECT_INVALID, "invalid voter mnwinner signature");
+    }
+    return true;
+}
+
+bool CMasternodePayments::CheckMNWinner(CMasternodePaymentWinner& winner, CNode* pfrom, CValidationState& state, CKeyID& keyIDRet, CBLSPublicKey& pubKeyRet)
 {
     int nHeight = mnodeman.GetBestHeight();
 
@@ -490,14 +704,23 @@ bool CMasternodePayments::ProcessMNWinner(CMasternodePaymentWinner& winner, CNod
         return state.Error("MN already voted");
     }
 
-    // Check signature
-    bool is_valid_sig = dmn ? winner.CheckSignature(dmn->pdmnState->pubKeyOperator.Get())
-                            : winner.CheckSignature(pmn->pubKeyMasternode.GetID());
+    if (dmn) {
+        pubKeyRet = dmn->pdmnState->pubKeyOperator.Get();
+    } else {
+        keyIDRet = pmn->pubKeyMasternode.GetID();
+    }
+    return true;
+}
 
-    if (!is_valid_sig) {
-        LogPrint(BCLog::MASTERNODE, "%s : mnw - invalid signature for %s masternode: %s\n",
-                __func__, (dmn ? "deterministic" : "legacy"), winner.vinMasternode.prevout.hash.ToString());
-        return state.DoS(20, false, REJECT_INVALID, "invalid voter mnwinner signature");
+bool CMasternodePayments::AcceptMNWinner(CMasternodePaymentWinner& winner, CValidationState& state)
+{
+    // Checked again, the vote (or another one of its signer) could have been accepted while verifying it
+    if (WITH_LOCK(cs_mapMasternodePayeeVotes, return mapMasternodePayeeVotes.count(winner.GetHash()); )) {
+        g_tiertwo_sync_state.AddedMasternodeWinner(winner.GetHash());
+        return false;
+    }
+    if (!CanVote(winner.vinMasternode.prevout, winner.nBlockHeight)) {
+        return state.Error("MN already voted");
     }
 
     // Record vote
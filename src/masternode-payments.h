@@ -6,6 +6,7 @@
 #ifndef MASTERNODE_PAYMENTS_H
 #define MASTERNODE_PAYMENTS_H
 
+#include "flatdb.h"
 #include "key.h"
 #include "masternode.h"
 #include "validationinterface.h"
@@ -25,11 +26,25 @@ extern CMasternodePayments masternodePayments;
 #define MNPAYMENTS_SIGNATURES_REQUIRED 6
 #define MNPAYMENTS_SIGNATURES_TOTAL 10
 
+//! Default for -mnwverifythreads
+static const int DEFAULT_MNW_VERIFY_THREADS = 2;
+//! Maximum number of threads verifying the winner votes signatures
+static const int MAX_MNW_VERIFY_THREADS = 16;
+
 bool IsBlockPayeeValid(const CBlock& block, const CBlockIndex* pindexPrev);
 std::string GetRequiredPaymentsString(int nBlockHeight);
 bool IsBlockValueValid(int nHeight, CAmount& nExpectedValue, CAmount nMinted, CAmount& nBudgetAmt);
 void FillBlockPayee(CMutableTransaction& txCoinbase, CMutableTransaction& txCoinstake, const CBlockIndex* pindexPrev, bool fProofOfStake);
 
+/** Verify the signatures of the winner votes received from the peers in batches, on nThreads threads */
+void StartMNWinnerVotesVerification(int nThreads);
+void StopMNWinnerVotesVerification();
+/** Queue a winner vote received from nodeId, checked except for its signature (signed by keyID, or pubKey if valid).
+ * Return false if the batched verification is not running. */
+bool QueueMNWinnerVerification(const CMasternodePaymentWinner& winner, NodeId nodeId, const CKeyID& keyID, const CBLSPublicKey& pubKey);
+/** Wait until the winner votes queued for the verification are verified and processed */
+void SyncWithMNWinnerVotesVerification();
+
 /**
  * Check coinbase output value for blocks after v6.0 enforcement.
  * It must pay the masternode for regular blocks and a proposal during superblocks.
@@ -40,23 +55,13 @@ void DumpMasternodePayments();
 
 /** Save Masternode Payment Data (mnpayments.dat)
  */
-class CMasternodePaymentDB
+class CMasternodePaymentDB : public CFlatDBBase
 {
 private:
     fs::path pathDB;
     std::string strMagicMessage;
 
 public:
-    enum ReadResult {
-        Ok,
-        FileError,
-        HashReadError,
-        IncorrectHash,
-        IncorrectMagicMessage,
-        IncorrectMagicNumber,
-        IncorrectFormat
-    };
-
     CMasternodePaymentDB();
     bool Write(const CMasternodePayments& objToSave);
     ReadResult Read(CMasternodePayments& objToLoad);
@@ -243,12 +248,22 @@ public:
     bool IsScheduled(const CMasternode& mn, int nNotBlockHeight);
 
     bool ProcessMNWinner(CMasternodePaymentWinner& winner, CNode* pfrom, CValidationState& state);
+    // Check a winner vote, except for its signature, and return the key of its signer
+    // (pubKeyRet is set for the deterministic masternodes, keyIDRet for the legacy ones)
+    bool CheckMNWinner(CMasternodePaymentWinner& winner, CNode* pfrom, CValidationState& state, CKeyID& keyIDRet, CBLSPublicKey& pubKeyRet);
+    // Record a checked winner vote, with a valid signature
+    bool AcceptMNWinner(CMasternodePaymentWinner& winner, CValidationState& state);
     bool ProcessMessageMasternodePayments(CNode* pfrom, std::string& strCommand, CDataStream& vRecv, CValidationState& state);
     std::string GetRequiredPaymentsString(int nBlockHeight);
     void FillBlockPayee(CMutableTransaction& txCoinbase, CMutableTransaction& txCoinstake, const CBlockIndex* pindexPrev, bool fProofOfStake) const;
     std::string ToString() const;
 
-    SERIALIZE_METHODS(CMasternodePayments, obj) { READWRITE(obj.mapMasternodePayeeVotes, obj.mapMasternodeBlocks); }
+    SERIALIZE_METHODS(CMasternodePayments, obj)
+    {
+        // dumped periodically, while the votes are processed
+        LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePayeeVotes);
+        READWRITE(obj.mapMasternodePayeeVotes, obj.mapMasternodeBlocks);
+    }
 
 private:
     // keep track of last voted height for mnw signers
@@ -256,6 +271,11 @@ private:
 
     bool CanVote(const COutPoint& outMasternode, int nBlockHeight) const;
     void RecordWinnerVote(const COutPoint& outMasternode, int nBlockHeight);
+
+    bool CheckMNWinnerSignature(const CMasternodePaymentWinner& winner, const CKeyID& keyID, const CBLSPublicKey& pubKey, CValidationState& state) const;
+    // Check the vote and queue it for the batched verification of its signature.
+    // Return false if it must be processed in place (verification not running).
+    bool QueueMNWinner(CMasternodePaymentWinner& winner, CNode* pfrom, CValidationState& state);
 };
 
 
@@ -68,6 +68,7 @@ void CMasternodeSync::Reset()
     countMasternodeWinner = 0;
     countBudgetItemProp = 0;
     countBudgetItemFin = 0;
+    WITH_LOCK(cs_assets, mapAssets.clear(); );
     g_tiertwo_sync_state.SetCurrentSyncPhase(MASTERNODE_SYNC_INITIAL);
     RequestedMasternodeAttempt = 0;
     nAssetSyncStarted = GetTime();
@@ -147,6 +148,11 @@ void CMasternodeSync::ProcessSyncStatusMsg(int nItemID, int nCount)
     int RequestedMasternodeAssets = g_tiertwo_sync_state.GetSyncPhase();
     if (RequestedMasternodeAssets >= MASTERNODE_SYNC_FINISHED) return;
 
+    LOCK(cs_assets);
+    // The budgets are requested together with the winners
+    const bool fBudgetRequested = RequestedMasternodeAssets == MASTERNODE_SYNC_BUDGET ||
+                                  mapAssets.count(MASTERNODE_SYNC_BUDGET_PROP);
+
     //this means we will receive no further communication
     switch (nItemID) {
         case (MASTERNODE_SYNC_LIST):
@@ -160,19 +166,23 @@ void CMasternodeSync::ProcessSyncStatusMsg(int nItemID, int nCount)
             countMasternodeWinner++;
             break;
         case (MASTERNODE_SYNC_BUDGET_PROP):
-            if (RequestedMasternodeAssets != MASTERNODE_SYNC_BUDGET) return;
+            if (!fBudgetRequested) return;
             sumBudgetItemProp += nCount;
             countBudgetItemProp++;
             break;
         case (MASTERNODE_SYNC_BUDGET_FIN):
-            if (RequestedMasternodeAssets != MASTERNODE_SYNC_BUDGET) return;
+            if (!fBudgetRequested) return;
             sumBudgetItemFin += nCount;
             countBudgetItemFin++;
             break;
         default:
-            break;
+            return;
     }
 
+    TierTwoAssetSync& sync = mapAssets[nItemID];
+    sync.nAnswered++;
+    sync.nExpected = std::max(sync.nExpected, nCount);
+
     LogPrint(BCLog::MASTERNODE, "CMasternodeSync:ProcessMessage - ssc - got inventory count %d %d\n", nItemID, nCount);
 }
 
@@ -186,7 +196,9 @@ void CMasternodeSync::Process()
     static int tick = 0;
     const bool isRegTestNet = Params().IsRegTestNet();
 
-    if (tick++ % MASTERNODE_SYNC_TIMEOUT != 0) return;
+    // Every MASTERNODE_SYNC_TIMEOUT seconds. While syncing (mainnet), the assets
+    // requests and completion are checked every second.
+    if (tick++ % MASTERNODE_SYNC_TIMEOUT != 0 && (isRegTestNet || g_tiertwo_sync_state.IsSynced())) return;
 
     // if the last call to this function was more than 60 minutes ago (client was in sleep mode)
     // reset the sync process
@@ -257,76 +269,140 @@ void CMasternodeSync::syncTimeout(const std::string& reason)
     nCountFailures++;
 }
 
+enum class AssetSyncStatus {
+    PENDING,
+    COMPLETE,
+    TIMEOUT
+};
+
+// Peers asked for an asset in parallel: MASTERNODE_SYNC_THRESHOLD at first, then one more
+// every MASTERNODE_SYNC_TIMEOUT seconds while the asset isn't complete, up to nMaxPeers.
+static bool NeedMorePeers(const TierTwoAssetSync& sync, int nMaxPeers, int64_t now)
+{
+    int nPeers = MASTERNODE_SYNC_THRESHOLD;
+    if (sync.nStarted > 0) nPeers += (int)((now - sync.nStarted) / MASTERNODE_SYNC_TIMEOUT);
+    return sync.nRequested < std::min(nPeers, nMaxPeers);
+}
+
+/*
+ * An asset is complete when enough peers reported their inventory count, and we have all the items
+ * of the largest one, or they stopped arriving (some of them can be invalid or expired).
+ * For the peers that don't report it, the asset is complete nQuietTime seconds after the last item,
+ * or times out when no item arrived at all.
+ */
+static AssetSyncStatus GetAssetSyncStatus(const TierTwoAssetSync& sync, size_t nSeen, int64_t nLastItem, int64_t nQuietTime, int64_t now)
+{
+    if (sync.nStarted == 0) return AssetSyncStatus::PENDING;
+    // items seen before the first request don't count
+    const int64_t nLastActivity = std::max(nLastItem, sync.nStarted);
+
+    if (sync.nAnswered >= MASTERNODE_SYNC_THRESHOLD) {
+        if (nSeen >= (size_t)sync.nExpected || nLastActivity < now - MASTERNODE_SYNC_TIMEOUT * 2) {
+            return AssetSyncStatus::COMPLETE;
+        }
+        return AssetSyncStatus::PENDING;
+    }
+
+    if (nLastItem < sync.nStarted) {
+        return now - sync.nStarted > MASTERNODE_SYNC_TIMEOUT * 5 ? AssetSyncStatus::TIMEOUT : AssetSyncStatus::PENDING;
+    }
+    if (sync.nRequested >= MASTERNODE_SYNC_THRESHOLD && nLastActivity < now - nQuietTime) {
+        return AssetSyncStatus::COMPLETE;
+    }
+    return AssetSyncStatus::PENDING;
+}
+
+TierTwoAssetSync CMasternodeSync::GetAssetSync(int nAsset)
+{
+    LOCK(cs_assets);
+    auto it = mapAssets.find(nAsset);
+    return it != mapAssets.end() ? it->second : TierTwoAssetSync();
+}
+
+template <typename RequestFunc>
+bool CMasternodeSync::RequestAsset(CNode* pnode, int nAsset, NetRequest netRequest, int nMaxPeers, RequestFunc request)
+{
+    const int64_t now = GetTime();
+    if (!NeedMorePeers(GetAssetSync(nAsset), nMaxPeers, now)) return false;
+
+    // Request the asset if we haven't requested it yet.
+    if (g_netfulfilledman.HasFulfilledRequest(pnode->addr, netRequest)) return true;
+    if (!request()) return true; // Failed, try next peer.
+
+    // Mark sync requested.
+    g_netfulfilledman.AddFulfilledRequest(pnode->addr, netRequest);
+    LOCK(cs_assets);
+    TierTwoAssetSync& sync = mapAssets[nAsset];
+    if (sync.nStarted == 0) sync.nStarted = now;
+    sync.nRequested++;
+    return true; // ask the next peer in parallel
+}
+
 bool CMasternodeSync::SyncWithNode(CNode* pnode, bool fLegacyMnObsolete)
 {
     int RequestedMasternodeAssets = g_tiertwo_sync_state.GetSyncPhase();
     CNetMsgMaker msgMaker(pnode->GetSendVersion());
+    const int64_t now = GetTime();
 
     //set to synced
     if (RequestedMasternodeAssets == MASTERNODE_SYNC_SPORKS) {
-
-        // Sync sporks from at least 2 peers
-        if (RequestedMasternodeAttempt >= MASTERNODE_SYNC_THRESHOLD) {
-            SwitchToNextAsset();
+        // Sync sporks from at least 2 peers. The phase moves on as soon as a peer sent all its sporks
+        // (see MessageDispatcher), or MASTERNODE_SYNC_TIMEOUT seconds after the requests.
+        const TierTwoAssetSync sync = GetAssetSync(MASTERNODE_SYNC_SPORKS);
+        RequestedMasternodeAttempt = sync.nRequested;
+        if (sync.nRequested >= MASTERNODE_SYNC_THRESHOLD) {
+            if (now - sync.nStarted >= MASTERNODE_SYNC_TIMEOUT) SwitchToNextAsset();
             return false;
         }
 
-        // Request sporks sync if we haven't requested it yet.
-        if (g_netfulfilledman.HasFulfilledRequest(pnode->addr, "getspork")) return true;
-        g_netfulfilledman.AddFulfilledRequest(pnode->addr, "getspork");
-
-        g_connman->PushMessage(pnode, msgMaker.Make(NetMsgType::GETSPORKS));
-        RequestedMasternodeAttempt++;
-        return false;
+        return RequestAsset(pnode, MASTERNODE_SYNC_SPORKS, NetRequest::SPORKS_SYNC, MASTERNODE_SYNC_THRESHOLD, [&]() {
+            g_connman->PushMessage(pnode, msgMaker.Make(NetMsgType::GETSPORKS));
+            return true;
+        });
     }
 
     if (pnode->nVersion < ActiveProtocol() || !pnode->CanRelay()) {
         return true; // move to next peer
     }
 
+    // Sync proposals, finalizations and votes (requested together with the winners)
+    auto requestBudget = [&]() {
+        return RequestAsset(pnode, MASTERNODE_SYNC_BUDGET_PROP, NetRequest::BUDGET_SYNC, MASTERNODE_SYNC_THRESHOLD * 3, [&]() {
+            g_connman->PushMessage(pnode, msgMaker.Make(NetMsgType::BUDGETVOTESYNC, uint256()));
+            return true;
+        });
+    };
+
     if (RequestedMasternodeAssets == MASTERNODE_SYNC_LIST) {
         if (fLegacyMnObsolete) {
             SwitchToNextAsset();
             return false;
         }
 
-        int lastMasternodeList = g_tiertwo_sync_state.GetlastMasternodeList();
-        LogPrint(BCLog::MASTERNODE, "CMasternodeSync::Process() - lastMasternodeList %lld (GetTime() - MASTERNODE_SYNC_TIMEOUT) %lld\n", lastMasternodeList, GetTime() - MASTERNODE_SYNC_TIMEOUT);
-        if (lastMasternodeList > 0 && lastMasternodeList < GetTime() - MASTERNODE_SYNC_TIMEOUT * 8 && RequestedMasternodeAttempt >= MASTERNODE_SYNC_THRESHOLD) {
-            // hasn't received a new item in the last 40 seconds AND has sent at least a minimum of MASTERNODE_SYNC_THRESHOLD GETMNLIST requests,
-            // so we'll move to the next asset.
+        const TierTwoAssetSync sync = GetAssetSync(MASTERNODE_SYNC_LIST);
+        RequestedMasternodeAttempt = sync.nRequested;
+        int64_t lastMasternodeList = g_tiertwo_sync_state.GetlastMasternodeList();
+        LogPrint(BCLog::MASTERNODE, "CMasternodeSync::Process() - lastMasternodeList %lld, requested %d, answered %d, expected %d, seen %d\n",
+                 lastMasternodeList, sync.nRequested, sync.nAnswered, sync.nExpected, g_tiertwo_sync_state.GetSeenMasternodeListCount());
+        switch (GetAssetSyncStatus(sync, g_tiertwo_sync_state.GetSeenMasternodeListCount(), lastMasternodeList, MASTERNODE_SYNC_TIMEOUT * 8, now)) {
+        case AssetSyncStatus::COMPLETE:
             SwitchToNextAsset();
             return false;
-        }
-
-        // timeout
-        if (lastMasternodeList == 0 &&
-            (RequestedMasternodeAttempt >= MASTERNODE_SYNC_THRESHOLD * 3 || GetTime() - nAssetSyncStarted > MASTERNODE_SYNC_TIMEOUT * 5)) {
+        case AssetSyncStatus::TIMEOUT:
             if (sporkManager.IsSporkActive(SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT)) {
                 syncTimeout("MASTERNODE_SYNC_LIST");
             } else {
                 SwitchToNextAsset();
             }
             return false;
+        case AssetSyncStatus::PENDING:
+            break;
         }
 
-        // Don't request mnlist initial sync to more than 8 randomly ordered peers in this round
-        if (RequestedMasternodeAttempt >= MASTERNODE_SYNC_THRESHOLD * 4) return false;
-
-        // Request mnb sync if we haven't requested it yet.
-        if (g_netfulfilledman.HasFulfilledRequest(pnode->addr, "mnsync")) return true;
-
-        // Try to request MN list sync.
-        if (!mnodeman.RequestMnList(pnode)) {
-            return true; // Failed, try next peer.
-        }
-
-        // Mark sync requested.
-        g_netfulfilledman.AddFulfilledRequest(pnode->addr, "mnsync");
-        // Increase the sync attempt count
-        RequestedMasternodeAttempt++;
-
-        return false; // sleep 1 second before do another request round.
+        // Request mnlist initial sync to up to 8 randomly ordered peers
+        return RequestAsset(pnode, MASTERNODE_SYNC_LIST, NetRequest::MN_LIST_SYNC, MASTERNODE_SYNC_THRESHOLD * 4, [&]() {
+            return mnodeman.RequestMnList(pnode);
+        });
     }
 
     if (RequestedMasternodeAssets == MASTERNODE_SYNC_MNW) {
@@ -335,55 +411,48 @@ bool CMasternodeSync::SyncWithNode(CNode* pnode, bool fLegacyMnObsolete)
             return false;
         }
 
-        int lastMasternodeWinner = g_tiertwo_sync_state.GetlastMasternodeWinner();
-        if (lastMasternodeWinner > 0 && lastMasternodeWinner < GetTime() - MASTERNODE_SYNC_TIMEOUT * 2 && RequestedMasternodeAttempt >= MASTERNODE_SYNC_THRESHOLD) { //hasn't received a new item in the last five seconds, so we'll move to the
+        const TierTwoAssetSync sync = GetAssetSync(MASTERNODE_SYNC_MNW);
+        RequestedMasternodeAttempt = sync.nRequested;
+        int64_t lastMasternodeWinner = g_tiertwo_sync_state.GetlastMasternodeWinner();
+        switch (GetAssetSyncStatus(sync, g_tiertwo_sync_state.GetSeenMasternodeWinnerCount(), lastMasternodeWinner, MASTERNODE_SYNC_TIMEOUT * 2, now)) {
+        case AssetSyncStatus::COMPLETE:
             SwitchToNextAsset();
-            // in case we received a budget item while we were syncing the mnw, let's reset the last budget item received time.
-            // reason: if we received for example a single proposal +50 seconds ago, then once the budget sync starts (right after this call),
-            // it will look like the sync is finished, and will not wait to receive any budget data and declare the sync over.
-            g_tiertwo_sync_state.ResetLastBudgetItem();
             return false;
-        }
-
-        // timeout
-        if (lastMasternodeWinner == 0 &&
-            (RequestedMasternodeAttempt >= MASTERNODE_SYNC_THRESHOLD * 2 || GetTime() - nAssetSyncStarted > MASTERNODE_SYNC_TIMEOUT * 5)) {
+        case AssetSyncStatus::TIMEOUT:
             if (sporkManager.IsSporkActive(SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT)) {
                 syncTimeout("MASTERNODE_SYNC_MNW");
             } else {
                 SwitchToNextAsset();
-                // Same as above (future: remove all of this duplicated code in v6.0.)
-                // in case we received a budget item while we were syncing the mnw, let's reset the last budget item received time.
-                // reason: if we received for example a single proposal +50 seconds ago, then once the budget sync starts (right after this call),
-                // it will look like the sync is finished, and will not wait to receive any budget data and declare the sync over.
-                g_tiertwo_sync_state.ResetLastBudgetItem();
             }
             return false;
+        case AssetSyncStatus::PENDING:
+            break;
         }
 
-        // Don't request mnw initial sync to more than 4 randomly ordered peers in this round.
-        if (RequestedMasternodeAttempt >= MASTERNODE_SYNC_THRESHOLD * 2) return false;
+        // The budgets don't depend on the winners: fetch them in parallel, from the same peers.
+        const bool fMoreBudgetPeers = requestBudget();
 
-        // Request mnw sync if we haven't requested it yet.
-        if (g_netfulfilledman.HasFulfilledRequest(pnode->addr, "mnwsync")) return true;
-
-        // Mark sync requested.
-        g_netfulfilledman.AddFulfilledRequest(pnode->addr, "mnwsync");
-
-        // Sync mn winners
-        int nMnCount = mnodeman.CountEnabled(true /* only_legacy */);
-        g_connman->PushMessage(pnode, msgMaker.Make(NetMsgType::GETMNWINNERS, nMnCount));
-        RequestedMasternodeAttempt++;
-
-        return false; // sleep 1 second before do another request round.
+        // Request mnw initial sync to up to 4 randomly ordered peers
+        const bool fMoreWinnerPeers = RequestAsset(pnode, MASTERNODE_SYNC_MNW, NetRequest::MNW_SYNC, MASTERNODE_SYNC_THRESHOLD * 2, [&]() {
+            int nMnCount = mnodeman.CountEnabled(true /* only_legacy */);
+            g_connman->PushMessage(pnode, msgMaker.Make(NetMsgType::GETMNWINNERS, nMnCount));
+            return true;
+        });
+        return fMoreBudgetPeers || fMoreWinnerPeers;
     }
 
     if (RequestedMasternodeAssets == MASTERNODE_SYNC_BUDGET) {
-        int lastBudgetItem = g_tiertwo_sync_state.GetlastBudgetItem();
+        // The proposals and the finalized budgets are requested with the same message
+        TierTwoAssetSync sync = GetAssetSync(MASTERNODE_SYNC_BUDGET_PROP);
+        const TierTwoAssetSync syncFin = GetAssetSync(MASTERNODE_SYNC_BUDGET_FIN);
+        sync.nAnswered = std::min(sync.nAnswered, syncFin.nAnswered);
+        sync.nExpected += syncFin.nExpected;
+        RequestedMasternodeAttempt = sync.nRequested;
+
+        int64_t lastBudgetItem = g_tiertwo_sync_state.GetlastBudgetItem();
         // We'll start rejecting votes if we accidentally get set as synced too soon
-        if (lastBudgetItem > 0 && lastBudgetItem < GetTime() - MASTERNODE_SYNC_TIMEOUT * 10 && RequestedMasternodeAttempt >= MASTERNODE_SYNC_THRESHOLD) {
-            // Hasn't received a new item in the last fifty seconds and more than MASTERNODE_SYNC_THRESHOLD requests were sent,
-            // so we'll move to the next asset
+        if (GetAssetSyncStatus(sync, g_tiertwo_sync_state.GetSeenBudgetItemCount(), lastBudgetItem, MASTERNODE_SYNC_TIMEOUT * 10, now) != AssetSyncStatus::PENDING) {
+            // Complete, or timed out: maybe there is no budgets at all, so just finish syncing
             SwitchToNextAsset();
 
             // Try to activate our masternode if possible
@@ -391,30 +460,8 @@ bool CMasternodeSync::SyncWithNode(CNode* pnode, bool fLegacyMnObsolete)
             return false;
         }
 
-        // timeout
-        if (lastBudgetItem == 0 &&
-            (RequestedMasternodeAttempt >= MASTERNODE_SYNC_THRESHOLD * 3 || GetTime() - nAssetSyncStarted > MASTERNODE_SYNC_TIMEOUT * 5)) {
-            // maybe there is no budgets at all, so just finish syncing
-            SwitchToNextAsset();
-            activeMasternode.ManageStatus();
-            return false;
-        }
-
-        // Don't request budget initial sync to more than 6 randomly ordered peers in this round.
-        if (RequestedMasternodeAttempt >= MASTERNODE_SYNC_THRESHOLD * 3) return false;
-
-        // Request bud sync if we haven't requested it yet.
-        if (g_netfulfilledman.HasFulfilledRequest(pnode->addr, "busync")) return true;
-
-        // Mark sync requested.
-        g_netfulfilledman.AddFulfilledRequest(pnode->addr, "busync");
-
-        // Sync proposals, finalizations and votes
-        uint256 n;
-        g_connman->PushMessage(pnode, msgMaker.Make(NetMsgType::BUDGETVOTESYNC, n));
-        RequestedMasternodeAttempt++;
-
-        return false; // sleep 1 second before do another request round.
+        // Request budget initial sync to up to 6 randomly ordered peers
+        return requestBudget();
     }
 
     return true;
@@ -16,6 +16,7 @@
 #define MASTERNODE_SYNC_TIMEOUT 5
 
 class CMasternodeSync;
+enum class NetRequest : uint8_t;
 extern CMasternodeSync masternodeSync;
 
 struct TierTwoPeerData {
@@ -23,6 +24,17 @@ struct TierTwoPeerData {
     std::map<const char*, std::pair<int64_t, bool>> mapMsgData;
 };
 
+// Requests of a tier two asset sent to the peers, and their answers
+struct TierTwoAssetSync {
+    // peers asked for the asset
+    int nRequested{0};
+    // time of the first request, 0 if not requested yet
+    int64_t nStarted{0};
+    // peers that reported their inventory count (SYNCSTATUSCOUNT), and the highest count reported
+    int nAnswered{0};
+    int nExpected{0};
+};
+
 //
 // CMasternodeSync : Sync masternode assets in stages
 //
@@ -79,7 +91,24 @@ private:
 
     // Tier two sync node state
     // map of nodeID --> TierTwoPeerData
-    std::map<NodeId, TierTwoPeerData> peersSyncState;
+    // the sync messages are processed by the tier two messages threads, concurrently with Process()
+    Mutex cs_peersSyncState;
+    std::map<NodeId, TierTwoPeerData> peersSyncState GUARDED_BY(cs_peersSyncState);
+
+    // map of asset (MASTERNODE_SYNC_*) --> requests sent to the peers.
+    // The assets are requested to several peers in parallel, the inventory counts are reported
+    // by the tier two messages threads.
+    Mutex cs_assets;
+    std::map<int, TierTwoAssetSync> mapAssets GUARDED_BY(cs_assets);
+    TierTwoAssetSync GetAssetSync(int nAsset);
+
+    /*
+     * Ask the peer for the asset, unless enough peers were asked already.
+     * Returns false when no more peers need to be asked in this round.
+     */
+    template <typename RequestFunc>
+    bool RequestAsset(CNode* pnode, int nAsset, NetRequest netRequest, int nMaxPeers, RequestFunc request);
+
     static int GetNextAsset(int currentAsset);
 
     void SyncRegtest(CNode* pnode);
@@ -133,8 +133,20 @@ std::string CMasternode::GetStrMessage() const
 //
 bool CMasternode::UpdateFromNewBroadcast(CMasternodeBroadcast& mnb)
 {
-    if (mnb.sigTime > sigTime) {
-        // TODO: lock cs. Need to be careful as mnb.lastPing.CheckAndUpdate locks cs_main internally.
+    if (mnb.sigTime <= WITH_LOCK(cs, return sigTime)) {
+        return false;
+    }
+
+    // Check the ping before locking cs, as mnb.lastPing.CheckAndUpdate locks cs_main internally.
+    int nDoS = 0;
+    const bool fPingValid = mnb.lastPing.IsNull() || mnb.lastPing.CheckAndUpdate(nDoS, false);
+
+    {
+        LOCK(cs);
+        // updated by another broadcast in the meantime
+        if (mnb.sigTime <= sigTime) {
+            return false;
+        }
         nMessVersion = mnb.nMessVersion;
         pubKeyMasternode = mnb.pubKeyMasternode;
         pubKeyCollateralAddress = mnb.pubKeyCollateralAddress;
@@ -142,14 +154,14 @@ bool CMasternode::UpdateFromNewBroadcast(CMasternodeBroadcast& mnb)
         vchSig = mnb.vchSig;
         protocolVersion = mnb.protocolVersion;
         addr = mnb.addr;
-        int nDoS = 0;
-        if (mnb.lastPing.IsNull() || (!mnb.lastPing.IsNull() && mnb.lastPing.CheckAndUpdate(nDoS, false))) {
+        if (fPingValid) {
             lastPing = mnb.lastPing;
-            mnodeman.mapSeenMasternodePing.emplace(lastPing.GetHash(), lastPing);
         }
-        return true;
     }
-    return false;
+    if (fPingValid) {
+        mnodeman.AddSeenMasternodePing(mnb.lastPing);
+    }
+    return true;
 }
 
 //
@@ -576,7 +588,7 @@ bool CMasternodePing::CheckAndUpdate(int& nDos, bool fRequireAvailable, bool fCh
             }
 
             // ping have passed the basic checks, can be updated now
-            mnodeman.mapSeenMasternodePing.emplace(GetHash(), *this);
+            mnodeman.AddSeenMasternodePing(*this);
 
             // SetLastPing locks masternode cs. Be careful with the lock ordering.
             pmn->SetLastPing(*this);
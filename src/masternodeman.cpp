@@ -61,23 +61,14 @@ bool CMasternodeDB::Write(const CMasternodeMan& mnodemanToSave)
     ssMasternodes << strMagicMessage;                   // masternode cache file specific magic message
     ssMasternodes << params.MessageStart(); // network specific magic number
     ssMasternodes << mnodemanToSave;
-    uint256 hash = Hash(ssMasternodes.begin(), ssMasternodes.end());
-    ssMasternodes << hash;
-
-    // open output file, and associate with CAutoFile
-    FILE* file = fsbridge::fopen(pathMN, "wb");
-    CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
-    if (fileout.IsNull())
-        return error("%s : Failed to open file %s", __func__, pathMN.string());
-
-    // Write and commit header, data
-    try {
-        fileout << ssMasternodes;
-    } catch (const std::exception& e) {
-        return error("%s : Serialize or I/O error - %s", __func__, e.what());
+    bool fWritten;
+    if (!WriteFile(pathMN, ssMasternodes, fWritten)) {
+        return false;
+    }
+    if (!fWritten) {
+        LogPrint(BCLog::MASTERNODE,"mncache.dat unchanged, not written\n");
+        return true;
     }
-    //    FileCommit(fileout);
-    fileout.fclose();
 
     LogPrint(BCLog::MASTERNODE,"Written info to mncache.dat  %dms\n", GetTimeMillis() - nStart);
     LogPrint(BCLog::MASTERNODE,"  %s\n", mnodemanToSave.ToString());
@@ -88,43 +79,11 @@ bool CMasternodeDB::Write(const CMasternodeMan& mnodemanToSave)
 CMasternodeDB::ReadResult CMasternodeDB::Read(CMasternodeMan& mnodemanToLoad)
 {
     int64_t nStart = GetTimeMillis();
-    // open input file, and associate with CAutoFile
-    FILE* file = fsbridge::fopen(pathMN, "rb");
-    CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull()) {
-        error("%s : Failed to open file %s", __func__, pathMN.string());
-        return FileError;
-    }
-
-    // use file size to size memory buffer
-    int fileSize = fs::file_size(pathMN);
-    int dataSize = fileSize - sizeof(uint256);
-    // Don't try to resize to a negative number if file is small
-    if (dataSize < 0)
-        dataSize = 0;
-    std::vector<unsigned char> vchData;
-    vchData.resize(dataSize);
-    uint256 hashIn;
-
-    // read data and checksum from file
-    try {
-        filein.read((char*)vchData.data(), dataSize);
-        filein >> hashIn;
-    } catch (const std::exception& e) {
-        error("%s : Deserialize or I/O error - %s", __func__, e.what());
-        return HashReadError;
-    }
-    filein.fclose();
-
     const auto& params = Params();
-    // serialize, checksum data up to that point, then append checksum
-    CDataStream ssMasternodes(vchData, SER_DISK,  CLIENT_VERSION);
-
-    // verify stored checksum matches input data
-    uint256 hashTmp = Hash(ssMasternodes.begin(), ssMasternodes.end());
-    if (hashIn != hashTmp) {
-        error("%s : Checksum mismatch, data corrupted", __func__);
-        return IncorrectHash;
+    CDataStream ssMasternodes(SER_DISK, CLIENT_VERSION);
+    ReadResult readResult = ReadFile(pathMN, ssMasternodes);
+    if (readResult != Ok) {
+        return readResult;
     }
 
     int version;
@@ -181,7 +140,9 @@ void DumpMasternodes()
 }
 
 CMasternodeMan::CMasternodeMan():
+        mapMasternodesSnapshot(std::make_shared<const MasternodeMap>()),
         cvLastBlockHashes(CACHED_BLOCK_HASHES, UINT256_ZERO),
+        scoresCache(CACHED_BLOCK_HASHES),
         nDsqCount(0)
 {}
 
@@ -207,6 +168,7 @@ bool CMasternodeMan::Add(CMasternode& mn)
     if (it == mapMasternodes.end()) {
         LogPrint(BCLog::MASTERNODE, "Adding new Masternode %s\n", mn.vin.prevout.ToString());
         mapMasternodes.emplace(mn.vin.prevout, std::make_shared<CMasternode>(mn));
+        PublishMasternodeList();
         LogPrint(BCLog::MASTERNODE, "Masternode added. New total count: %d\n", mapMasternodes.size());
         return true;
     }
@@ -235,6 +197,35 @@ void CMasternodeMan::AskForMN(CNode* pnode, const CTxIn& vin)
     mWeAskedForMasternodeListEntry[vin.prevout] = askAgain;
 }
 
+// Width of the expiry buckets of the seen broadcasts and pings
+static const int64_t SEEN_EXPIRY_BUCKET_SECONDS = 60;
+
+/*
+ * Remove the seen items that expired before nCutoff, popping the buckets that are entirely older.
+ * The items of a popped bucket which expire later now (a seen broadcast got a new ping) are moved to their
+ * new bucket, and the ones already removed from mapSeen are skipped.
+ */
+template <typename T, typename GetSigTime, typename OnErase>
+static void RemoveExpiredSeen(std::map<uint256, T>& mapSeen, std::map<int64_t, std::vector<uint256>>& mapExpiry,
+                              int64_t nCutoff, GetSigTime getSigTime, OnErase onErase)
+{
+    auto it = mapExpiry.begin();
+    while (it != mapExpiry.end() && (it->first + 1) * SEEN_EXPIRY_BUCKET_SECONDS <= nCutoff) {
+        for (const uint256& hash : it->second) {
+            auto itSeen = mapSeen.find(hash);
+            if (itSeen == mapSeen.end()) continue;
+            const int64_t sigTime = getSigTime(itSeen->second);
+            if (sigTime < nCutoff) {
+                onErase(hash);
+                mapSeen.erase(itSeen);
+            } else {
+                mapExpiry[sigTime / SEEN_EXPIRY_BUCKET_SECONDS].emplace_back(hash);
+            }
+        }
+        it = mapExpiry.erase(it);
+    }
+}
+
 int CMasternodeMan::CheckAndRemove(bool forceExpiredRemoval)
 {
     // Skip after legacy obsolete. !TODO: remove when transition to DMN is complete
@@ -247,6 +238,7 @@ int CMasternodeMan::CheckAndRemove(bool forceExpiredRemoval)
     LOCK(cs);
 
     //remove inactive and outdated (or replaced by DMN)
+    std::set<COutPoint> setRemoved;
     auto it = mapMasternodes.begin();
     while (it != mapMasternodes.end()) {
         MasternodeRef& mn = it->second;
@@ -256,45 +248,41 @@ int CMasternodeMan::CheckAndRemove(bool forceExpiredRemoval)
             (forceExpiredRemoval && activeState == CMasternode::MASTERNODE_EXPIRED) ||
             mn->protocolVersion < ActiveProtocol()) {
             LogPrint(BCLog::MASTERNODE, "Removing inactive (legacy) Masternode %s\n", it->first.ToString());
-            //erase all of the broadcasts we've seen from this vin
-            // -- if we missed a few pings and the node was removed, this will allow is to get it back without them
-            //    sending a brand new mnb
-            std::map<uint256, CMasternodeBroadcast>::iterator it3 = mapSeenMasternodeBroadcast.begin();
-            while (it3 != mapSeenMasternodeBroadcast.end()) {
-                if (it3->second.vin.prevout == it->first) {
-                    g_tiertwo_sync_state.EraseSeenMNB((*it3).first);
-                    it3 = mapSeenMasternodeBroadcast.erase(it3);
-                } else {
-                    ++it3;
-                }
-            }
-
             // allow us to ask for this masternode again if we see another ping
-            std::map<COutPoint, int64_t>::iterator it2 = mWeAskedForMasternodeListEntry.begin();
-            while (it2 != mWeAskedForMasternodeListEntry.end()) {
-                if (it2->first == it->first) {
-                    it2 = mWeAskedForMasternodeListEntry.erase(it2);
-                } else {
-                    ++it2;
-                }
-            }
-
-            // clean MN pings right away.
-            auto itPing = mapSeenMasternodePing.begin();
-            while (itPing != mapSeenMasternodePing.end()) {
-                if (itPing->second.GetVin().prevout == it->first) {
-                    itPing = mapSeenMasternodePing.erase(itPing);
-                } else {
-                    ++itPing;
-                }
-            }
+            mWeAskedForMasternodeListEntry.erase(it->first);
 
+            setRemoved.emplace(it->first);
             it = mapMasternodes.erase(it);
             LogPrint(BCLog::MASTERNODE, "Masternode removed.\n");
         } else {
             ++it;
         }
     }
+    if (!setRemoved.empty()) {
+        //erase all of the broadcasts we've seen from the removed vins, in a single pass
+        // -- if we missed a few pings and the node was removed, this will allow is to get it back without them
+        //    sending a brand new mnb
+        auto it3 = mapSeenMasternodeBroadcast.begin();
+        while (it3 != mapSeenMasternodeBroadcast.end()) {
+            if (setRemoved.count(it3->second.vin.prevout)) {
+                g_tiertwo_sync_state.EraseSeenMNB((*it3).first);
+                it3 = mapSeenMasternodeBroadcast.erase(it3);
+            } else {
+                ++it3;
+            }
+        }
+
+        // clean MN pings right away.
+        auto itPing = mapSeenMasternodePing.begin();
+        while (itPing != mapSeenMasternodePing.end()) {
+            if (setRemoved.count(itPing->second.GetVin().prevout)) {
+                itPing = mapSeenMasternodePing.erase(itPing);
+            } else {
+                ++itPing;
+            }
+        }
+        PublishMasternodeList();
+    }
     LogPrint(BCLog::MASTERNODE, "New total masternode count: %d\n", mapMasternodes.size());
 
     // check who's asked for the Masternode list
@@ -327,39 +315,58 @@ int CMasternodeMan::CheckAndRemove(bool forceExpiredRemoval)
         }
     }
 
-    // remove expired mapSeenMasternodeBroadcast
-    std::map<uint256, CMasternodeBroadcast>::iterator it3 = mapSeenMasternodeBroadcast.begin();
-    while (it3 != mapSeenMasternodeBroadcast.end()) {
-        if ((*it3).second.lastPing.sigTime < GetTime() - (MasternodeRemovalSeconds() * 2)) {
-            g_tiertwo_sync_state.EraseSeenMNB((*it3).second.GetHash());
-            it3 = mapSeenMasternodeBroadcast.erase(it3);
-        } else {
-            ++it3;
-        }
+    // remove expired mapSeenMasternodeBroadcast and mapSeenMasternodePing
+    const int64_t nSeenCutoff = GetTime() - (MasternodeRemovalSeconds() * 2);
+    RemoveExpiredSeen(mapSeenMasternodeBroadcast, mapSeenBroadcastExpiry, nSeenCutoff,
+                      [](const CMasternodeBroadcast& mnb) { return mnb.lastPing.sigTime; },
+                      [](const uint256& hash) { g_tiertwo_sync_state.EraseSeenMNB(hash); });
+    RemoveExpiredSeen(mapSeenMasternodePing, mapSeenPingExpiry, nSeenCutoff,
+                      [](const CMasternodePing& mnp) { return mnp.sigTime; },
+                      [](const uint256& hash) {});
+
+    return mapMasternodes.size();
+}
+
+void CMasternodeMan::AddSeenMasternodeBroadcast(const CMasternodeBroadcast& mnb)
+{
+    const uint256& hash = mnb.GetHash();
+    if (mapSeenMasternodeBroadcast.emplace(hash, mnb).second) {
+        mapSeenBroadcastExpiry[mnb.lastPing.sigTime / SEEN_EXPIRY_BUCKET_SECONDS].emplace_back(hash);
     }
+}
 
-    // remove expired mapSeenMasternodePing
-    std::map<uint256, CMasternodePing>::iterator it4 = mapSeenMasternodePing.begin();
-    while (it4 != mapSeenMasternodePing.end()) {
-        if ((*it4).second.sigTime < GetTime() - (MasternodeRemovalSeconds() * 2)) {
-            it4 = mapSeenMasternodePing.erase(it4);
-        } else {
-            ++it4;
-        }
+void CMasternodeMan::AddSeenMasternodePing(const CMasternodePing& mnp)
+{
+    const uint256& hash = mnp.GetHash();
+    if (mapSeenMasternodePing.emplace(hash, mnp).second) {
+        mapSeenPingExpiry[mnp.sigTime / SEEN_EXPIRY_BUCKET_SECONDS].emplace_back(hash);
     }
+}
 
-    return mapMasternodes.size();
+void CMasternodeMan::RebuildSeenExpiry()
+{
+    mapSeenBroadcastExpiry.clear();
+    mapSeenPingExpiry.clear();
+    for (const auto& it : mapSeenMasternodeBroadcast) {
+        mapSeenBroadcastExpiry[it.second.lastPing.sigTime / SEEN_EXPIRY_BUCKET_SECONDS].emplace_back(it.first);
+    }
+    for (const auto& it : mapSeenMasternodePing) {
+        mapSeenPingExpiry[it.second.sigTime / SEEN_EXPIRY_BUCKET_SECONDS].emplace_back(it.first);
+    }
 }
 
 void CMasternodeMan::Clear()
 {
     LOCK(cs);
     mapMasternodes.clear();
+    PublishMasternodeList();
     mAskedUsForMasternodeList.clear();
     mWeAskedForMasternodeList.clear();
     mWeAskedForMasternodeListEntry.clear();
     mapSeenMasternodeBroadcast.clear();
     mapSeenMasternodePing.clear();
+    mapSeenBroadcastExpiry.clear();
+    mapSeenPingExpiry.clear();
     nDsqCount = 0;
 }
 
@@ -393,8 +400,8 @@ CMasternodeMan::MNsInfo CMasternodeMan::getMNsInfo() const
 
     // legacy masternodes
     {
-        LOCK(cs);
-        for (const auto& it : mapMasternodes) {
+        const auto mapSnapshot = GetMasternodeListSnapshot();
+        for (const auto& it : *mapSnapshot) {
             const MasternodeRef& mn = it.second;
             info.total++;
             CountNetwork(mn->addr, info.ipv4, info.ipv6, info.onion);
@@ -426,14 +433,34 @@ CMasternodeMan::MNsInfo CMasternodeMan::getMNsInfo() const
     return info;
 }
 
+size_t CMasternodeMan::DynamicMemoryUsage() const
+{
+    LOCK(cs);
+    size_t nUsage = memusage::DynamicUsage(mapMasternodes) +
+                    memusage::DynamicUsage(mapSeenMasternodeBroadcast) + memusage::DynamicUsage(mapSeenMasternodePing) +
+                    memusage::DynamicUsage(mapSeenBroadcastExpiry) + memusage::DynamicUsage(mapSeenPingExpiry) +
+                    memusage::DynamicUsage(mAskedUsForMasternodeList) + memusage::DynamicUsage(mWeAskedForMasternodeList) +
+                    memusage::DynamicUsage(mWeAskedForMasternodeListEntry);
+    for (const auto& it : mapMasternodes) {
+        nUsage += memusage::DynamicUsage(it.second);
+    }
+    for (const auto& it : mapSeenBroadcastExpiry) {
+        nUsage += memusage::DynamicUsage(it.second);
+    }
+    for (const auto& it : mapSeenPingExpiry) {
+        nUsage += memusage::DynamicUsage(it.second);
+    }
+    return nUsage;
+}
+
 int CMasternodeMan::CountEnabled(bool only_legacy) const
 {
     int count_enabled = 0;
     int protocolVersion = ActiveProtocol();
 
     {
-        LOCK(cs);
-        for (const auto& it : mapMasternodes) {
+        const auto mapSnapshot = GetMasternodeListSnapshot();
+        for (const auto& it : *mapSnapshot) {
             const MasternodeRef& mn = it.second;
             if (mn->protocolVersion < protocolVersion || !mn->IsEnabled()) continue;
             count_enabled++;
@@ -559,8 +586,8 @@ MasternodeRef CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeigh
     int minProtocol = ActiveProtocol();
     int count_enabled = CountEnabled();
     {
-        LOCK(cs);
-        for (const auto& it : mapMasternodes) {
+        const auto mapSnapshot = GetMasternodeListSnapshot();
+        for (const auto& it : *mapSnapshot) {
             if (!it.second->IsEnabled()) continue;
             if (canScheduleMN(fFilterSigTime, it.second, minProtocol, count_enabled, nBlockHeight)) {
                 vecMasternodeLastPaid.emplace_back(SecondsSincePayment(it.second, count_enabled, BlockReading), it.second);
@@ -609,41 +636,91 @@ MasternodeRef CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeigh
     return pBestMasternode;
 }
 
-MasternodeRef CMasternodeMan::GetCurrentMasterNode(const uint256& hash) const
+void CMasternodeMan::PublishMasternodeList()
 {
-    int minProtocol = ActiveProtocol();
-    int64_t score = 0;
-    MasternodeRef winner = nullptr;
+    AssertLockHeld(cs);
+    auto mapSnapshot = std::make_shared<const MasternodeMap>(mapMasternodes);
+    WITH_LOCK(cs_snapshot, mapMasternodesSnapshot = std::move(mapSnapshot); );
+    // after the new snapshot, so that the scores of the old one are not cached
+    InvalidateScoresCache();
+}
 
-    // scan for winner
-    for (const auto& it : mapMasternodes) {
-        const MasternodeRef& mn = it.second;
-        if (mn->protocolVersion < minProtocol || !mn->IsEnabled()) continue;
-        // calculate the score of the masternode
-        const int64_t n = mn->CalculateScore(hash).GetCompact(false);
-        // determine the winner
-        if (n > score) {
-            score = n;
-            winner = mn;
+std::shared_ptr<const CMasternodeMan::MasternodeMap> CMasternodeMan::GetMasternodeListSnapshot() const
+{
+    LOCK(cs_snapshot);
+    return mapMasternodesSnapshot;
+}
+
+void CMasternodeMan::InvalidateScoresCache()
+{
+    LOCK(cs_scores);
+    scoresCache.clear();
+    nScoresGeneration++;
+}
+
+std::shared_ptr<const CMasternodeMan::MasternodeScores> CMasternodeMan::GetScores(const uint256& hash) const
+{
+    const bool fDIP3 = deterministicMNManager->IsDIP3Enforced();
+    const CDeterministicMNList mnList = fDIP3 ? deterministicMNManager->GetListAtChainTip() : CDeterministicMNList();
+    uint64_t nGeneration;
+    {
+        LOCK(cs_scores);
+        if (scoresCacheDMNListHash != mnList.GetBlockHash()) {
+            scoresCache.clear();
+            scoresCacheDMNListHash = mnList.GetBlockHash();
+        }
+        std::shared_ptr<const MasternodeScores> cached;
+        if (scoresCache.get(hash, cached)) {
+            return cached;
         }
+        nGeneration = nScoresGeneration;
     }
 
-    // scan also dmns
-    if (deterministicMNManager->IsDIP3Enforced()) {
-        auto mnList = deterministicMNManager->GetListAtChainTip();
-        mnList.ForEachMN(true, [&](const CDeterministicMNCPtr& dmn) {
+    // Computed without cs_scores, from the list published after nGeneration was read
+    auto scores = std::make_shared<MasternodeScores>();
+    {
+        const auto mapSnapshot = GetMasternodeListSnapshot();
+        scores->reserve(mapSnapshot->size());
+        for (const auto& it : *mapSnapshot) {
+            scores->push_back({it.second->CalculateScore(hash).GetCompact(false), it.second, nullptr});
+        }
+    }
+    if (fDIP3) {
+        mnList.ForEachMN(false, [&](const CDeterministicMNCPtr& dmn) {
             const MasternodeRef mn = MakeMasternodeRefForDMN(dmn);
-            // calculate the score of the masternode
-            const int64_t n = mn->CalculateScore(hash).GetCompact(false);
-            // determine the winner
-            if (n > score) {
-                score = n;
-                winner = mn;
-            }
+            scores->push_back({mn->CalculateScore(hash).GetCompact(false), mn, dmn});
         });
     }
+    // Stable, so that the first masternode (legacy ones first) wins the ties, as when scanning the lists
+    std::stable_sort(scores->begin(), scores->end(), [](const MasternodeScore& a, const MasternodeScore& b) {
+        return a.nScore > b.nScore;
+    });
 
-    return winner;
+    {
+        LOCK(cs_scores);
+        if (nGeneration == nScoresGeneration && scoresCacheDMNListHash == mnList.GetBlockHash()) {
+            scoresCache.insert(hash, scores);
+        }
+    }
+    return scores;
+}
+
+MasternodeRef CMasternodeMan::GetCurrentMasterNode(const uint256& hash) const
+{
+    int minProtocol = ActiveProtocol();
+
+    // the highest score (above zero) of the enabled masternodes
+    for (const MasternodeScore& s : *GetScores(hash)) {
+        if (s.nScore <= 0) break;
+        if (s.dmn) {
+            if (s.dmn->IsPoSeBanned()) continue;
+        } else if (s.mn->protocolVersion < minProtocol || !s.mn->IsEnabled()) {
+            continue;
+        }
+        return s.mn;
+    }
+
+    return nullptr;
 }
 
 std::vector<std::pair<MasternodeRef, int>> CMasternodeMan::GetMnScores(int nLast) const
@@ -668,13 +745,15 @@ int CMasternodeMan::GetMasternodeRank(const CTxIn& vin, int64_t nBlockHeight) co
     // height outside range
     if (hash == UINT256_ZERO) return -1;
 
-    // scan for winner
+    // rank among the eligible masternodes
     int minProtocol = ActiveProtocol();
-    std::vector<std::pair<int64_t, CTxIn> > vecMasternodeScores;
-    {
-        LOCK(cs);
-        for (const auto& it : mapMasternodes) {
-            const MasternodeRef& mn = it.second;
+    const bool fCheckAge = sporkManager.IsSporkActive(SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT);
+    int rank = 0;
+    for (const MasternodeScore& s : *GetScores(hash)) {
+        if (s.dmn) {
+            if (s.dmn->IsPoSeBanned()) continue;
+        } else {
+            const MasternodeRef& mn = s.mn;
             if (!mn->IsEnabled()) {
                 continue; // Skip not enabled
             }
@@ -682,29 +761,12 @@ int CMasternodeMan::GetMasternodeRank(const CTxIn& vin, int64_t nBlockHeight) co
                 LogPrint(BCLog::MASTERNODE,"Skipping Masternode with obsolete version %d\n", mn->protocolVersion);
                 continue; // Skip obsolete versions
             }
-            if (sporkManager.IsSporkActive(SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT) &&
-                    GetAdjustedTime() - mn->sigTime < MN_WINNER_MINIMUM_AGE) {
+            if (fCheckAge && GetAdjustedTime() - mn->sigTime < MN_WINNER_MINIMUM_AGE) {
                 continue; // Skip masternodes younger than (default) 1 hour
             }
-            vecMasternodeScores.emplace_back(mn->CalculateScore(hash).GetCompact(false), mn->vin);
         }
-    }
-
-    // scan also dmns
-    if (deterministicMNManager->IsDIP3Enforced()) {
-        auto mnList = deterministicMNManager->GetListAtChainTip();
-        mnList.ForEachMN(true, [&](const CDeterministicMNCPtr& dmn) {
-            const MasternodeRef mn = MakeMasternodeRefForDMN(dmn);
-            vecMasternodeScores.emplace_back(mn->CalculateScore(hash).GetCompact(false), mn->vin);
-        });
-    }
-
-    sort(vecMasternodeScores.rbegin(), vecMasternodeScores.rend(), CompareScoreMN());
-
-    int rank = 0;
-    for (std::pair<int64_t, CTxIn> & s : vecMasternodeScores) {
         rank++;
-        if (s.second.prevout == vin.prevout) {
+        if (s.mn->vin.prevout == vin.prevout) {
             return rank;
         }
     }
@@ -718,25 +780,11 @@ std::vector<std::pair<int64_t, MasternodeRef>> CMasternodeMan::GetMasternodeRank
     const uint256& hash = GetHashAtHeight(nBlockHeight - 1);
     // height outside range
     if (hash == UINT256_ZERO) return vecMasternodeScores;
-    {
-        LOCK(cs);
-        // scan for winner
-        for (const auto& it : mapMasternodes) {
-            const MasternodeRef mn = it.second;
-            const uint32_t score = mn->IsEnabled() ? mn->CalculateScore(hash).GetCompact(false) : 9999;
-
-            vecMasternodeScores.emplace_back(score, mn);
-        }
-    }
-    // scan also dmns
-    if (deterministicMNManager->IsDIP3Enforced()) {
-        auto mnList = deterministicMNManager->GetListAtChainTip();
-        mnList.ForEachMN(false, [&](const CDeterministicMNCPtr& dmn) {
-            const MasternodeRef mn = MakeMasternodeRefForDMN(dmn);
-            const uint32_t score = dmn->IsPoSeBanned() ? 9999 : mn->CalculateScore(hash).GetCompact(false);
-
-            vecMasternodeScores.emplace_back(score, mn);
-        });
+    const auto scores = GetScores(hash);
+    vecMasternodeScores.reserve(scores->size());
+    for (const MasternodeScore& s : *scores) {
+        const bool fScored = s.dmn ? !s.dmn->IsPoSeBanned() : s.mn->IsEnabled();
+        vecMasternodeScores.emplace_back(fScored ? s.nScore : 9999, s.mn);
     }
     sort(vecMasternodeScores.rbegin(), vecMasternodeScores.rend(), CompareScoreMN());
     return vecMasternodeScores;
@@ -825,7 +873,7 @@ int CMasternodeMan::ProcessMNBroadcast(CNode* pfrom, CMasternodeBroadcast& mnb)
     }
 
     // now that did the mnb checks, can add it.
-    mapSeenMasternodeBroadcast.emplace(mnbHash, mnb);
+    AddSeenMasternodeBroadcast(mnb);
 
     // All checks performed, add it
     LogPrint(BCLog::MASTERNODE,"%s - Got NEW Masternode entry - %s - %lli \n", __func__,
@@ -892,7 +940,7 @@ void CMasternodeMan::BroadcastInvMN(CMasternode* mn, CNode* pfrom)
     pfrom->PushInventory(CInv(MSG_MASTERNODE_ANNOUNCE, hash));
 
     // Add to mapSeenMasternodeBroadcast in case that isn't there for some reason.
-    if (!mapSeenMasternodeBroadcast.count(hash)) mapSeenMasternodeBroadcast.emplace(hash, mnb);
+    AddSeenMasternodeBroadcast(mnb);
 }
 
 int CMasternodeMan::ProcessGetMNList(CNode* pfrom, CTxIn& vin)
@@ -1018,6 +1066,7 @@ void CMasternodeMan::Remove(const COutPoint& collateralOut)
     const auto it = mapMasternodes.find(collateralOut);
     if (it != mapMasternodes.end()) {
         mapMasternodes.erase(it);
+        PublishMasternodeList();
     }
 }
 
@@ -1028,8 +1077,8 @@ void CMasternodeMan::UpdateMasternodeList(CMasternodeBroadcast& mnb)
         return;
     }
 
-    mapSeenMasternodePing.emplace(mnb.lastPing.GetHash(), mnb.lastPing);
-    mapSeenMasternodeBroadcast.emplace(mnb.GetHash(), mnb);
+    AddSeenMasternodePing(mnb.lastPing);
+    AddSeenMasternodeBroadcast(mnb);
     g_tiertwo_sync_state.AddedMasternodeList(mnb.GetHash());
 
     LogPrint(BCLog::MASTERNODE,"%s -- masternode=%s\n", __func__, mnb.vin.prevout.ToString());
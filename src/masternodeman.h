@@ -8,11 +8,14 @@
 
 #include "activemasternode.h"
 #include "cyclingvector.h"
+#include "flatdb.h"
 #include "key.h"
 #include "key_io.h"
 #include "masternode.h"
 #include "net.h"
+#include "saltedhasher.h"
 #include "sync.h"
+#include "unordered_lru_cache.h"
 #include "util/system.h"
 
 #define MASTERNODES_REQUEST_SECONDS (60 * 60) // One hour.
@@ -30,23 +33,13 @@ void DumpMasternodes();
 
 /** Access to the MN database (mncache.dat)
  */
-class CMasternodeDB
+class CMasternodeDB : public CFlatDBBase
 {
 private:
     fs::path pathMN;
     std::string strMagicMessage;
 
 public:
-    enum ReadResult {
-        Ok,
-        FileError,
-        HashReadError,
-        IncorrectHash,
-        IncorrectMagicMessage,
-        IncorrectMagicNumber,
-        IncorrectFormat
-    };
-
     CMasternodeDB();
     bool Write(const CMasternodeMan& mnodemanToSave);
     ReadResult Read(CMasternodeMan& mnodemanToLoad);
@@ -62,8 +55,15 @@ private:
     // critical section to protect the inner data structures specifically on messaging
     mutable RecursiveMutex cs_process_message;
 
+    typedef std::map<COutPoint, MasternodeRef> MasternodeMap;
+
     // map to hold all MNs (indexed by collateral outpoint)
-    std::map<COutPoint, MasternodeRef> mapMasternodes;
+    MasternodeMap mapMasternodes;
+    // Immutable copy of mapMasternodes, published (under cs) after each change of the list.
+    // Readers iterate it without cs, so they don't wait behind the mnb/mnp processing.
+    // The state of the entries is shared with mapMasternodes (guarded by CMasternode::cs).
+    mutable Mutex cs_snapshot;
+    std::shared_ptr<const MasternodeMap> mapMasternodesSnapshot GUARDED_BY(cs_snapshot);
     // who's asked for the Masternode list and the last time
     std::map<CNetAddr, int64_t> mAskedUsForMasternodeList;
     // who we asked for the Masternode list and the last time
@@ -77,6 +77,32 @@ private:
     // Memory Only. Cache last block hashes. Used to verify mn pings and winners.
     CyclingVector<uint256> cvLastBlockHashes;
 
+    // The score of a masternode for a block hash (dmn is set for the deterministic masternodes)
+    struct MasternodeScore {
+        int64_t nScore;
+        MasternodeRef mn;
+        CDeterministicMNCPtr dmn;
+    };
+    typedef std::vector<MasternodeScore> MasternodeScores;
+
+    // Memory Only. The scores of all the masternodes (highest first) for the last block hashes
+    // used, computed once for the ranks and winners. Cleared when the list changes.
+    mutable Mutex cs_scores;
+    mutable unordered_lru_cache<uint256, std::shared_ptr<const MasternodeScores>, StaticSaltedHasher> scoresCache GUARDED_BY(cs_scores);
+    // The block of the deterministic list the cached scores were computed with
+    mutable uint256 scoresCacheDMNListHash GUARDED_BY(cs_scores);
+    // Incremented when the legacy list changes, to discard the scores being computed
+    uint64_t nScoresGeneration GUARDED_BY(cs_scores){0};
+
+    // The scores for the block hash, from the cache if possible
+    std::shared_ptr<const MasternodeScores> GetScores(const uint256& hash) const;
+    void InvalidateScoresCache();
+
+    // Publish a new snapshot of mapMasternodes (and drop the cached scores). Requires cs.
+    void PublishMasternodeList();
+    // The last published list
+    std::shared_ptr<const MasternodeMap> GetMasternodeListSnapshot() const;
+
     // Return the banning score (0 if no ban score increase is needed).
     int ProcessMNBroadcast(CNode* pfrom, CMasternodeBroadcast& mnb);
     int ProcessMNPing(CNode* pfrom, CMasternodePing& mnp);
@@ -88,12 +114,22 @@ private:
     // Validation
     bool CheckInputs(CMasternodeBroadcast& mnb, int nChainHeight, int& nDoS);
 
+    // Expiry buckets of the seen broadcasts and pings: their hashes by sigTime / SEEN_EXPIRY_BUCKET_SECONDS (of the
+    // last ping, for the broadcasts), so that CheckAndRemove drops the expired ones without scanning the seen maps.
+    std::map<int64_t, std::vector<uint256>> mapSeenBroadcastExpiry;
+    std::map<int64_t, std::vector<uint256>> mapSeenPingExpiry;
+    void RebuildSeenExpiry();
+
 public:
     // Keep track of all broadcasts I've seen
     std::map<uint256, CMasternodeBroadcast> mapSeenMasternodeBroadcast;
     // Keep track of all pings I've seen
     std::map<uint256, CMasternodePing> mapSeenMasternodePing;
 
+    // Add to mapSeenMasternodeBroadcast / mapSeenMasternodePing, if not there yet.
+    void AddSeenMasternodeBroadcast(const CMasternodeBroadcast& mnb);
+    void AddSeenMasternodePing(const CMasternodePing& mnp);
+
     // keep track of dsq count to prevent masternodes from gaming obfuscation queue
     // TODO: Remove this from serialization
     int64_t nDsqCount;
@@ -109,6 +145,8 @@ public:
 
         READWRITE(obj.mapSeenMasternodeBroadcast);
         READWRITE(obj.mapSeenMasternodePing);
+        SER_READ(obj, obj.RebuildSeenExpiry());
+        SER_READ(obj, obj.PublishMasternodeList());
     }
 
     CMasternodeMan();
@@ -130,6 +168,9 @@ public:
 
     int CountEnabled(bool only_legacy = false) const;
 
+    /// Estimated memory usage of the list, and of the seen and asked maps
+    size_t DynamicMemoryUsage() const;
+
     bool RequestMnList(CNode* pnode);
 
     /// Find an entry
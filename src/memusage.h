@@ -7,9 +7,11 @@
 
 #include "indirectmap.h"
 #include "prevector.h"
+#include "support/allocators/pool.h"
 
 #include <stdlib.h>
 
+#include <list>
 #include <map>
 #include <memory>
 #include <set>
@@ -48,6 +50,7 @@ template<typename X, typename Y> static inline size_t DynamicUsage(std::pair<X,
  */
 template<typename X> static size_t DynamicUsage(const std::vector<X>& v);
 template<typename X> static size_t DynamicUsage(const std::set<X>& s);
+template<typename X> static size_t DynamicUsage(const std::list<X>& l);
 template<typename X, typename Y> static size_t DynamicUsage(const std::map<X, Y>& m);
 template<typename X> static size_t DynamicUsage(const X& x);
 
@@ -71,6 +74,12 @@ static inline size_t MallocUsage(size_t alloc)
     }
 }
 
+// Usage of a block allocated from a PoolResource (see support/allocators/pool.h), which has no malloc overhead
+static inline size_t PoolUsage(size_t alloc)
+{
+    return ((alloc + sizeof(void*) - 1) / sizeof(void*)) * sizeof(void*);
+}
+
 // STL data structures
 
 template<typename X>
@@ -84,6 +93,15 @@ private:
     X x;
 };
 
+template<typename X>
+struct stl_list_node
+{
+private:
+    void* next;
+    void* prev;
+    X x;
+};
+
 struct stl_shared_counter
 {
     /* Various platforms use different sized counters here.
@@ -137,6 +155,12 @@ static inline size_t IncrementalDynamicUsage(const std::set<X, Y>& s)
     return MallocUsage(sizeof(stl_tree_node<X>));
 }
 
+template<typename X>
+static inline size_t DynamicUsage(const std::list<X>& l)
+{
+    return MallocUsage(sizeof(stl_list_node<X>)) * l.size();
+}
+
 template<typename X, typename Y, typename Z>
 static inline size_t DynamicUsage(const std::map<X, Y, Z>& m)
 {
@@ -221,6 +245,21 @@ static inline size_t DynamicUsage(const std::unordered_map<X, Y, Z>& m)
     return MallocUsage(sizeof(unordered_node<std::pair<const X, Y> >)) * m.size() + MallocUsage(sizeof(void*) * m.bucket_count());
 }
 
+template<typename X, typename Y, typename Z>
+static inline size_t DynamicUsage(const std::unordered_multimap<X, Y, Z>& m)
+{
+    return MallocUsage(sizeof(unordered_node<std::pair<const X, Y> >)) * m.size() + MallocUsage(sizeof(void*) * m.bucket_count());
+}
+
+// The nodes of a pool allocated map are in the chunks of its resource (which may have free blocks)
+template<typename X, typename Y, typename Z, typename E, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+static inline size_t DynamicUsage(const std::unordered_map<X, Y, Z, E, PoolAllocator<std::pair<const X, Y>, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES> >& m)
+{
+    const auto* resource = m.get_allocator().resource();
+    return (MallocUsage(resource->ChunkSizeBytes()) + sizeof(void*)) * resource->NumAllocatedChunks() +
+           MallocUsage(sizeof(void*) * m.bucket_count());
+}
+
 // Dispatch to class method as fallback
 
 template<typename X>
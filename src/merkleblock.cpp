@@ -56,6 +56,31 @@ CMerkleBlock::CMerkleBlock(const CBlock& block, CBloomFilter* filter, const std:
     txn = CPartialMerkleTree(vHashes, vMatch);
 }
 
+CFilterableBlock::CFilterableBlock(std::shared_ptr<const CBlock> blockIn) : block(std::move(blockIn))
+{
+    vHashes.reserve(block->vtx.size());
+    vElements.reserve(block->vtx.size());
+    for (const CTransactionRef& tx : block->vtx) {
+        vHashes.push_back(tx->GetHash());
+        vElements.emplace_back(*tx);
+    }
+}
+
+CMerkleBlock::CMerkleBlock(const CFilterableBlock& block, CBloomFilter& filter)
+{
+    header = block.block->GetBlockHeader();
+
+    std::vector<bool> vMatch(block.vHashes.size(), false);
+    for (unsigned int i = 0; i < block.vHashes.size(); i++) {
+        if (filter.IsRelevantAndUpdate(block.vElements[i])) {
+            vMatch[i] = true;
+            vMatchedTxn.emplace_back(i, block.vHashes[i]);
+        }
+    }
+
+    txn = CPartialMerkleTree(block.vHashes, vMatch);
+}
+
 uint256 CPartialMerkleTree::CalcHash(int height, unsigned int pos, const std::vector<uint256>& vTxid)
 {
     if (height == 0) {
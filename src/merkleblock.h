@@ -12,6 +12,7 @@
 #include "serialize.h"
 #include "uint256.h"
 
+#include <memory>
 #include <vector>
 
 // Helper functions for serialization.
@@ -110,6 +111,21 @@ public:
 };
 
 
+/**
+ * A block with the bloom filter elements of its transactions: the scripts are parsed once for all the
+ * filters the block is matched against. It is only read by the matching, so several filters can be
+ * matched at the same time.
+ */
+class CFilterableBlock
+{
+public:
+    const std::shared_ptr<const CBlock> block;
+    std::vector<uint256> vHashes;
+    std::vector<CBloomTxElements> vElements;
+
+    explicit CFilterableBlock(std::shared_ptr<const CBlock> blockIn);
+};
+
 /**
  * Used to relay blocks as header + vector<merkle branch>
  * to filtered nodes.
@@ -136,6 +152,9 @@ public:
      */
     CMerkleBlock(const CBlock& block, CBloomFilter& filter) : CMerkleBlock(block, &filter, nullptr) { }
 
+    // Create from a CFilterableBlock, filtering transactions according to filter (updated as above)
+    CMerkleBlock(const CFilterableBlock& block, CBloomFilter& filter);
+
     // Create from a CBlock, matching the txids in the set
     CMerkleBlock(const CBlock& block, const std::set<uint256>& txids) : CMerkleBlock(block, nullptr, &txids) { }
 
@@ -0,0 +1,191 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "metrics.h"
+
+#include "chainparams.h"
+#include "httpserver.h"
+#include "llmq/quorums_debug.h"
+#include "net.h"
+#include "rpc/protocol.h"
+#include "tiertwo/tiertwo_sync_state.h"
+#include "tinyformat.h"
+#include "txmempool.h"
+#include "validation.h"
+
+#include <map>
+
+namespace metrics {
+
+Counter mempoolAccepted;
+Counter mempoolRejected;
+Counter sigCacheHits;
+Counter sigCacheMisses;
+Counter scriptCacheHits;
+Counter scriptCacheMisses;
+Counter blockPayloadHits;
+Counter blockPayloadMisses;
+
+// The HELP and TYPE lines of a metric
+static void AddMetric(std::string& out, const std::string& name, const char* type, const char* help)
+{
+    out += strprintf("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static void AddSample(std::string& out, const std::string& name, const std::string& labels, uint64_t value)
+{
+    out += labels.empty() ? strprintf("%s %d\n", name, value) : strprintf("%s{%s} %d\n", name, labels, value);
+}
+
+static void AddSample(std::string& out, const std::string& name, const std::string& labels, double value)
+{
+    out += labels.empty() ? strprintf("%s %.6f\n", name, value) : strprintf("%s{%s} %.6f\n", name, labels, value);
+}
+
+static void AddCounter(std::string& out, const std::string& name, const char* help, uint64_t value)
+{
+    AddMetric(out, name, "counter", help);
+    AddSample(out, name, "", value);
+}
+
+static void AddGauge(std::string& out, const std::string& name, const char* help, uint64_t value)
+{
+    AddMetric(out, name, "gauge", help);
+    AddSample(out, name, "", value);
+}
+
+static void FormatChainMetrics(std::string& out)
+{
+    std::shared_ptr<const ChainTipSnapshot> tip = GetChainTipSnapshot();
+    if (tip) {
+        AddGauge(out, "pivx_chain_height", "Height of the chain tip", tip->nHeight);
+        AddGauge(out, "pivx_chain_tip_time_seconds", "Time of the chain tip block", tip->nTime);
+    }
+    AddGauge(out, "pivx_blockchain_synced", "Whether the blockchain is synced", g_tiertwo_sync_state.IsBlockchainSynced());
+    AddGauge(out, "pivx_tiertwo_sync_phase", "Phase of the tier two sync (999 when finished)", g_tiertwo_sync_state.GetSyncPhase());
+
+    // The durations of the stages of the block connection, with cumulative buckets in seconds
+    const std::string name = "pivx_block_stage_duration_seconds";
+    AddMetric(out, name, "histogram", "Durations of the stages of the connection of the blocks to the tip");
+    for (const auto& it : GetBlockProcessingStats()) {
+        const BlockStageTimes& times = it.second;
+        uint64_t nCumulative = 0;
+        for (size_t i = 0; i < BLOCK_STAGE_BUCKET_BOUNDS.size(); i++) {
+            nCumulative += times.buckets[i];
+            AddSample(out, name + "_bucket", strprintf("stage=\"%s\",le=\"%g\"", it.first, BLOCK_STAGE_BUCKET_BOUNDS[i] * 0.000001), nCumulative);
+        }
+        AddSample(out, name + "_bucket", strprintf("stage=\"%s\",le=\"+Inf\"", it.first), times.nCount);
+        AddSample(out, name + "_sum", strprintf("stage=\"%s\"", it.first), times.nTotal * 0.000001);
+        AddSample(out, name + "_count", strprintf("stage=\"%s\"", it.first), times.nCount);
+    }
+}
+
+static void FormatMempoolMetrics(std::string& out)
+{
+    AddGauge(out, "pivx_mempool_transactions", "Number of transactions in the mempool", mempool.size());
+    AddGauge(out, "pivx_mempool_bytes", "Total size of the transactions in the mempool", mempool.GetTotalTxSize());
+    AddGauge(out, "pivx_mempool_usage_bytes", "Memory usage of the mempool", mempool.DynamicMemoryUsage());
+    AddCounter(out, "pivx_mempool_accepted_total", "Transactions accepted to the mempool", mempoolAccepted.Get());
+    AddCounter(out, "pivx_mempool_rejected_total", "Transactions rejected from the mempool", mempoolRejected.Get());
+}
+
+static void FormatCacheMetrics(std::string& out)
+{
+    const std::string name = "pivx_cache_lookups_total";
+    AddMetric(out, name, "counter", "Lookups of the validation and relay caches");
+    AddSample(out, name, "cache=\"signature\",result=\"hit\"", sigCacheHits.Get());
+    AddSample(out, name, "cache=\"signature\",result=\"miss\"", sigCacheMisses.Get());
+    AddSample(out, name, "cache=\"script_execution\",result=\"hit\"", scriptCacheHits.Get());
+    AddSample(out, name, "cache=\"script_execution\",result=\"miss\"", scriptCacheMisses.Get());
+    AddSample(out, name, "cache=\"block_payload\",result=\"hit\"", blockPayloadHits.Get());
+    AddSample(out, name, "cache=\"block_payload\",result=\"miss\"", blockPayloadMisses.Get());
+}
+
+static void FormatNetMetrics(std::string& out)
+{
+    if (!g_connman) return;
+    const std::string peersName = "pivx_peers";
+    AddMetric(out, peersName, "gauge", "Number of connected peers");
+    AddSample(out, peersName, "direction=\"inbound\"", (uint64_t)g_connman->GetNodeCount(CConnman::CONNECTIONS_IN));
+    AddSample(out, peersName, "direction=\"outbound\"", (uint64_t)g_connman->GetNodeCount(CConnman::CONNECTIONS_OUT));
+
+    AddCounter(out, "pivx_net_sent_bytes_total", "Bytes sent to all the peers", g_connman->GetTotalBytesSent());
+    AddCounter(out, "pivx_net_received_bytes_total", "Bytes received from all the peers", g_connman->GetTotalBytesRecv());
+
+    // The bytes by message type, of the currently connected peers
+    std::vector<CNodeStats> vstats;
+    g_connman->GetNodeStats(vstats);
+    std::map<std::string, uint64_t> mapSent, mapRecv;
+    for (const CNodeStats& stats : vstats) {
+        for (const auto& it : stats.mapSendBytesPerMsgCmd) mapSent[it.first] += it.second;
+        for (const auto& it : stats.mapRecvBytesPerMsgCmd) mapRecv[it.first] += it.second;
+    }
+    const std::string name = "pivx_peer_message_bytes";
+    AddMetric(out, name, "gauge", "Bytes by message type, of the connected peers");
+    for (const auto& it : mapSent) {
+        if (it.second) AddSample(out, name, strprintf("direction=\"sent\",command=\"%s\"", it.first), it.second);
+    }
+    for (const auto& it : mapRecv) {
+        if (it.second) AddSample(out, name, strprintf("direction=\"received\",command=\"%s\"", it.first), it.second);
+    }
+}
+
+static void FormatLLMQMetrics(std::string& out)
+{
+    if (!llmq::quorumDKGDebugManager) return;
+    llmq::CDKGDebugStatus status;
+    llmq::quorumDKGDebugManager->GetLocalDebugStatus(status);
+    const Consensus::Params& consensus = Params().GetConsensus();
+    const std::string phaseName = "pivx_llmq_dkg_phase";
+    const std::string heightName = "pivx_llmq_dkg_quorum_height";
+    AddMetric(out, phaseName, "gauge", "Phase of the local DKG session of each LLMQ type");
+    std::string heights;
+    for (const auto& p : status.sessions) {
+        Optional<Consensus::LLMQParams> opt_params = consensus.GetLLMQParams((Consensus::LLMQType)p.first);
+        if (opt_params == nullopt) {
+            continue;
+        }
+        const std::string labels = strprintf("llmq=\"%s\"", opt_params->name);
+        AddSample(out, phaseName, labels, (uint64_t)p.second.phase);
+        AddSample(heights, heightName, labels, (uint64_t)p.second.quorumHeight);
+    }
+    AddMetric(out, heightName, "gauge", "Height of the quorum of the local DKG session of each LLMQ type");
+    out += heights;
+}
+
+std::string FormatMetrics()
+{
+    std::string out;
+    FormatChainMetrics(out);
+    FormatMempoolMetrics(out);
+    FormatCacheMetrics(out);
+    FormatNetMetrics(out);
+    FormatLLMQMetrics(out);
+    return out;
+}
+
+} // namespace metrics
+
+static bool HTTPReq_Metrics(HTTPRequest* req, const std::string&)
+{
+    if (req->GetRequestMethod() != HTTPRequest::GET) {
+        req->WriteReply(HTTP_BAD_METHOD, "Only GET requests are supported");
+        return false;
+    }
+    req->WriteHeader("Content-Type", "text/plain; version=0.0.4");
+    req->WriteReply(HTTP_OK, metrics::FormatMetrics());
+    return true;
+}
+
+bool StartHTTPMetrics()
+{
+    RegisterHTTPHandler("/metrics", true, HTTPReq_Metrics,
+                        [](HTTPRequest*, const std::string&) { return HTTPWorkQueueId::READ; });
+    return true;
+}
+
+void StopHTTPMetrics()
+{
+    UnregisterHTTPHandler("/metrics", true);
+}
@@ -0,0 +1,54 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_METRICS_H
+#define PIVX_METRICS_H
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+
+//! Default for -metrics
+static const bool DEFAULT_METRICS_ENABLE = false;
+
+namespace metrics {
+
+/** A monotonic counter, updated without locks by the code it measures */
+class Counter
+{
+private:
+    std::atomic<uint64_t> value{0};
+
+public:
+    void Inc(uint64_t n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t Get() const { return value.load(std::memory_order_relaxed); }
+};
+
+//! AcceptToMemoryPool results
+extern Counter mempoolAccepted;
+extern Counter mempoolRejected;
+//! Lookups of the signature cache and of the script execution cache
+extern Counter sigCacheHits;
+extern Counter sigCacheMisses;
+extern Counter scriptCacheHits;
+extern Counter scriptCacheMisses;
+//! Lookups of the serialized blocks shared by the block messages of the peers
+extern Counter blockPayloadHits;
+extern Counter blockPayloadMisses;
+
+/** The metrics, in the Prometheus text exposition format. Doesn't lock cs_main. */
+std::string FormatMetrics();
+
+} // namespace metrics
+
+/** Start the /metrics HTTP endpoint.
+ * Precondition; HTTP has been started.
+ */
+bool StartHTTPMetrics();
+/** Stop the /metrics HTTP endpoint.
+ * Precondition; HTTP has been stopped.
+ */
+void StopHTTPMetrics();
+
+#endif // PIVX_METRICS_H
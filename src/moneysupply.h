@@ -7,29 +7,44 @@
 
 #include "amount.h"
 #include "sync.h"
+#include "uint256.h"
 
 /*
- * Class used to cache the sum of utxo's values
+ * Class used to cache the sum of utxo's values.
+ * It's updated with the change of the value of the UTXO set made by each block connected or disconnected,
+ * and stored in the chainstate with its best block (the sum of the whole set is only the audit of it).
  */
 class CMoneySupply {
 private:
     mutable RecursiveMutex cs;
     CAmount nSupply;
-    // height of the chain when the supply was last updated
+    // height and hash of the chain tip when the supply was last updated
     int64_t nHeight;
+    uint256 hashBlock;
 
 public:
     CMoneySupply(): nSupply(0), nHeight(0) {}
 
-    void Update(const CAmount& _nSupply, int _nHeight)
+    void Update(const CAmount& _nSupply, int _nHeight, const uint256& _hashBlock)
     {
         LOCK(cs);
         nSupply = _nSupply;
         nHeight = _nHeight;
+        hashBlock = _hashBlock;
+    }
+
+    // Add the change of the value of the UTXO set made by the blocks connected (or disconnected) up to the new tip
+    void AddDelta(const CAmount& nDelta, int _nHeight, const uint256& _hashBlock)
+    {
+        LOCK(cs);
+        nSupply += nDelta;
+        nHeight = _nHeight;
+        hashBlock = _hashBlock;
     }
 
     CAmount Get() const { LOCK(cs); return nSupply; }
     int64_t GetCacheHeight() const { LOCK(cs); return nHeight; }
+    uint256 GetBlockHash() const { LOCK(cs); return hashBlock; }
 };
 
 #endif // PIVX_MONEYSUPPLY_H
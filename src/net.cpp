@@ -39,6 +39,18 @@
 #include <poll.h>
 #endif
 
+#ifndef WIN32
+#include <sys/uio.h>
+#endif
+
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
+#ifdef USE_KQUEUE
+#include <sys/event.h>
+#endif
+
 #include <cstdint>
 #include <unordered_map>
 
@@ -722,6 +734,83 @@ void CNode::copyStats(CNodeStats& stats, const std::vector<bool>& m_asmap)
 }
 #undef X
 
+void CConnman::QueueReceivedMessages(CNode* pnode)
+{
+    size_t nSizeAdded = 0;
+    auto it(pnode->vRecvMsg.begin());
+    for (; it != pnode->vRecvMsg.end(); ++it) {
+        if (!it->complete())
+            break;
+        nSizeAdded += it->vRecv.size() + CMessageHeader::HEADER_SIZE;
+        CaptureMessage(*pnode, *it);
+    }
+    {
+        LOCK(pnode->cs_vProcessMsg);
+        pnode->vProcessMsg.splice(pnode->vProcessMsg.end(), pnode->vRecvMsg, pnode->vRecvMsg.begin(), it);
+        pnode->nProcessQueueSize += nSizeAdded;
+        pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
+    }
+}
+
+// Magic and version of the -capturemessages files
+static const char CAPTURE_FILE_MAGIC[] = "pivxcapt";
+static const int CAPTURE_FILE_VERSION = 1;
+
+void CConnman::CaptureMessage(const CNode& node, const CNetMessage& msg)
+{
+    LOCK(cs_capture);
+    if (!fileCapture) return;
+    CCapturedMessage captured;
+    captured.nTime = msg.nTime;
+    captured.nPeer = node.GetId();
+    captured.strCommand = msg.hdr.GetCommand();
+    captured.vPayload.assign(msg.vRecv.begin(), msg.vRecv.end());
+    try {
+        *fileCapture << captured;
+    } catch (const std::exception& e) {
+        LogPrintf("%s: stopping the capture of the messages: %s\n", __func__, e.what());
+        fileCapture.reset();
+    }
+}
+
+bool CConnman::ReplayMessage(CNode* pnode, const CCapturedMessage& msg)
+{
+    // The wire format of the message: header (with checksum) and payload
+    std::vector<unsigned char> vBytes;
+    CMessageHeader hdr(Params().MessageStart(), msg.strCommand.c_str(), msg.vPayload.size());
+    const uint256 hash = Hash(msg.vPayload.begin(), msg.vPayload.end());
+    memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
+    CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, vBytes, 0, hdr};
+    vBytes.insert(vBytes.end(), msg.vPayload.begin(), msg.vPayload.end());
+
+    bool fComplete = false;
+    if (!pnode->ReceiveMsgBytes((const char*)vBytes.data(), vBytes.size(), fComplete)) return false;
+    if (fComplete) QueueReceivedMessages(pnode);
+    return true;
+}
+
+bool ReadCapturedMessages(const fs::path& path, std::vector<CCapturedMessage>& vMessages)
+{
+    CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) return false;
+    vMessages.clear();
+    try {
+        char magic[sizeof(CAPTURE_FILE_MAGIC) - 1];
+        int nVersion;
+        file.read(magic, sizeof(magic));
+        file >> nVersion;
+        if (memcmp(magic, CAPTURE_FILE_MAGIC, sizeof(magic)) != 0 || nVersion != CAPTURE_FILE_VERSION) return false;
+        while (true) {
+            CCapturedMessage msg;
+            file >> msg;
+            vMessages.push_back(std::move(msg));
+        }
+    } catch (const std::ios_base::failure&) {
+        // End of the file (or a record truncated by an unclean shutdown)
+    }
+    return true;
+}
+
 bool CNode::ReceiveMsgBytes(const char* pch, unsigned int nBytes, bool& complete)
 {
     complete = false;
@@ -732,8 +821,12 @@ bool CNode::ReceiveMsgBytes(const char* pch, unsigned int nBytes, bool& complete
     while (nBytes > 0) {
         // get current incomplete message, or create a new one
         if (vRecvMsg.empty() ||
-            vRecvMsg.back().complete())
+            vRecvMsg.back().complete()) {
             vRecvMsg.emplace_back(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION);
+            if (vRecvBuffer.capacity() > 0) {
+                vRecvMsg.back().vRecv.swap_buffer(vRecvBuffer);
+            }
+        }
 
         CNetMessage& msg = vRecvMsg.back();
 
@@ -773,6 +866,19 @@ bool CNode::ReceiveMsgBytes(const char* pch, unsigned int nBytes, bool& complete
     return true;
 }
 
+void CNode::RecycleRecvBuffer(CDataStream& vRecv)
+{
+    CSerializeData buffer;
+    vRecv.swap_buffer(buffer);
+    if (buffer.capacity() > MAX_RECV_BUFFER_REUSE) return;
+    // The contents are overwritten by the next message: no need to zero them
+    buffer.clear();
+    LOCK(cs_vRecv);
+    if (buffer.capacity() > vRecvBuffer.capacity()) {
+        vRecvBuffer.swap(buffer);
+    }
+}
+
 void CNode::SetSendVersion(int nVersionIn)
 {
     // Send version may only be changed in the version message, and
@@ -854,34 +960,77 @@ const uint256& CNetMessage::GetMessageHash() const
     return data_hash;
 }
 
+#ifndef WIN32
+// Maximum number of buffers (headers and payloads) sent by a single sendmsg
+static const int MAX_SEND_IOVECS = 32;
+#endif
+
 // requires LOCK(cs_vSend)
 size_t CConnman::SocketSendData(CNode* pnode)
 {
-    auto it = pnode->vSendMsg.begin();
     size_t nSentSize = 0;
 
-    while (it != pnode->vSendMsg.end()) {
-        const auto& data = *it;
-        assert(data.size() > pnode->nSendOffset);
+    while (!pnode->vSendMsg.empty()) {
+        assert(pnode->vSendMsg.front().size() > pnode->nSendOffset);
+        size_t nToSend = 0;
         int nBytes = 0;
         {
             LOCK(pnode->cs_hSocket);
             if (pnode->hSocket == INVALID_SOCKET)
                 break;
-            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(data.data()) + pnode->nSendOffset, data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+#ifndef WIN32
+            // Scatter-gather the headers and the payloads of the queued messages in a single syscall
+            struct iovec iov[MAX_SEND_IOVECS];
+            int nIov = 0;
+            size_t nOffset = pnode->nSendOffset;
+            for (auto it = pnode->vSendMsg.begin(); it != pnode->vSendMsg.end() && nIov + 2 <= MAX_SEND_IOVECS; ++it) {
+                const std::vector<unsigned char>* bufs[] = {&it->header, &it->Payload()};
+                for (const std::vector<unsigned char>* buf : bufs) {
+                    if (nOffset >= buf->size()) {
+                        nOffset -= buf->size();
+                        continue;
+                    }
+                    iov[nIov].iov_base = const_cast<unsigned char*>(buf->data()) + nOffset;
+                    iov[nIov].iov_len = buf->size() - nOffset;
+                    nToSend += iov[nIov].iov_len;
+                    nOffset = 0;
+                    nIov++;
+                }
+            }
+            struct msghdr msg{};
+            msg.msg_iov = iov;
+            msg.msg_iovlen = nIov;
+            nBytes = sendmsg(pnode->hSocket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+#else
+            // The header, or the payload, of the first message
+            const CQueuedNetMsg& queued = pnode->vSendMsg.front();
+            const bool fHeader = pnode->nSendOffset < queued.header.size();
+            const std::vector<unsigned char>& buf = fHeader ? queued.header : queued.Payload();
+            const size_t nOffset = fHeader ? pnode->nSendOffset : pnode->nSendOffset - queued.header.size();
+            nToSend = buf.size() - nOffset;
+            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(buf.data()) + nOffset, nToSend, MSG_NOSIGNAL | MSG_DONTWAIT);
+#endif
         }
         if (nBytes > 0) {
             pnode->nLastSend = GetSystemTimeInSeconds();
             pnode->nSendBytes += nBytes;
-            pnode->nSendOffset += nBytes;
             nSentSize += nBytes;
-            if (pnode->nSendOffset == data.size()) {
+            // Remove the fully sent messages
+            size_t nLeft = nBytes;
+            while (nLeft > 0) {
+                const size_t nMsgLeft = pnode->vSendMsg.front().size() - pnode->nSendOffset;
+                if (nLeft < nMsgLeft) {
+                    pnode->nSendOffset += nLeft;
+                    break;
+                }
+                nLeft -= nMsgLeft;
                 pnode->nSendOffset = 0;
-                pnode->nSendSize -= data.size();
-                pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
-                it++;
-            } else {
-                // could not send full message; stop sending more
+                pnode->nSendSize -= pnode->vSendMsg.front().size();
+                pnode->vSendMsg.pop_front();
+            }
+            pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+            if ((size_t)nBytes < nToSend) {
+                // could not send everything; stop sending more
                 break;
             }
         } else {
@@ -892,17 +1041,20 @@ size_t CConnman::SocketSendData(CNode* pnode)
                     LogPrintf("socket send error %s\n", NetworkErrorString(nErr));
                     pnode->CloseSocketDisconnect();
                 }
+                if (nErr == WSAEWOULDBLOCK) {
+                    // wait for the socket to become writable again
+                    pnode->fSendReady = false;
+                }
             }
             // couldn't send anything at all
             break;
         }
     }
 
-    if (it == pnode->vSendMsg.end()) {
+    if (pnode->vSendMsg.empty()) {
         assert(pnode->nSendOffset == 0);
         assert(pnode->nSendSize == 0);
     }
-    pnode->vSendMsg.erase(pnode->vSendMsg.begin(), it);
     return nSentSize;
 }
 
@@ -1148,6 +1300,7 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
 
     LogPrint(BCLog::NET, "connection from %s accepted\n", addr.ToString());
 
+    RegisterSocketEvents(pnode);
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
@@ -1183,6 +1336,7 @@ void CConnman::DisconnectNodes()
                 pnode->grantOutbound.Release();
 
                 // close socket and cleanup
+                UnregisterSocketEvents(pnode);
                 pnode->CloseSocketDisconnect();
 
                 // hold in disconnected pool until all refs are released
@@ -1253,6 +1407,149 @@ void CConnman::InactivityCheck(CNode* pnode)
     }
 }
 
+void CConnman::RegisterSocketEvents(CNode* pnode)
+{
+#ifdef USE_EDGE_TRIGGERED_EVENTS
+    if (socketEventsFd == -1) return;
+    LOCK(pnode->cs_hSocket);
+    if (pnode->hSocket == INVALID_SOCKET) return;
+#ifdef USE_EPOLL
+    struct epoll_event ev{};
+    // errors and hangups are always reported
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+    ev.data.ptr = pnode;
+    int r = epoll_ctl(socketEventsFd, EPOLL_CTL_ADD, pnode->hSocket, &ev);
+#else
+    struct kevent ev[2];
+    EV_SET(&ev[0], pnode->hSocket, EVFILT_READ, EV_ADD | EV_CLEAR, 0, 0, pnode);
+    EV_SET(&ev[1], pnode->hSocket, EVFILT_WRITE, EV_ADD | EV_CLEAR, 0, 0, pnode);
+    int r = kevent(socketEventsFd, ev, 2, nullptr, 0, nullptr);
+#endif
+    if (r == -1) {
+        // the node would never be serviced
+        LogPrintf("failed to register the socket of peer=%d: %s\n", pnode->GetId(), NetworkErrorString(WSAGetLastError()));
+        pnode->fDisconnect = true;
+    }
+#endif
+}
+
+void CConnman::UnregisterSocketEvents(CNode* pnode)
+{
+#ifdef USE_EDGE_TRIGGERED_EVENTS
+    if (socketEventsFd == -1) return;
+    LOCK(pnode->cs_hSocket);
+    // a closed socket has already left the interest set
+    if (pnode->hSocket == INVALID_SOCKET) return;
+#ifdef USE_EPOLL
+    epoll_ctl(socketEventsFd, EPOLL_CTL_DEL, pnode->hSocket, nullptr);
+#else
+    struct kevent ev[2];
+    EV_SET(&ev[0], pnode->hSocket, EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+    EV_SET(&ev[1], pnode->hSocket, EVFILT_WRITE, EV_DELETE, 0, 0, nullptr);
+    kevent(socketEventsFd, ev, 2, nullptr, 0, nullptr);
+#endif
+#endif
+}
+
+#ifdef USE_EDGE_TRIGGERED_EVENTS
+// Maximum number of socket events returned by a single wait
+static const int MAX_SOCKET_EVENTS = 1024;
+
+bool CConnman::InitSocketEvents()
+{
+#ifdef USE_EPOLL
+    socketEventsFd = epoll_create1(EPOLL_CLOEXEC);
+#else
+    socketEventsFd = kqueue();
+#endif
+    if (socketEventsFd == -1) {
+        LogPrintf("%s: failed to create the socket events descriptor: %s\n", __func__, NetworkErrorString(WSAGetLastError()));
+        return false;
+    }
+
+    // The listening sockets are level-triggered: AcceptConnection accepts a single connection at a time
+    for (ListenSocket& hListenSocket : vhListenSocket) {
+#ifdef USE_EPOLL
+        struct epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.ptr = &hListenSocket;
+        int r = epoll_ctl(socketEventsFd, EPOLL_CTL_ADD, hListenSocket.socket, &ev);
+#else
+        struct kevent ev;
+        EV_SET(&ev, hListenSocket.socket, EVFILT_READ, EV_ADD, 0, 0, &hListenSocket);
+        int r = kevent(socketEventsFd, &ev, 1, nullptr, 0, nullptr);
+#endif
+        if (r == -1) {
+            LogPrintf("%s: failed to register a listening socket: %s\n", __func__, NetworkErrorString(WSAGetLastError()));
+            return false;
+        }
+    }
+    return true;
+}
+
+void CConnman::SocketEvents(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set)
+{
+    // Only the listening sockets are returned in recv_set: the readiness of the node sockets is kept in
+    // their fRecvReady/fSendReady flags, as the events are only reported on the transitions.
+    const int nTimeout = fSocketEventsPending ? 0 : (int)SELECT_TIMEOUT_MILLISECONDS;
+    fSocketEventsPending = false;
+
+#ifdef USE_EPOLL
+    struct epoll_event events[MAX_SOCKET_EVENTS];
+    int nEvents = epoll_wait(socketEventsFd, events, MAX_SOCKET_EVENTS, nTimeout);
+#else
+    struct kevent events[MAX_SOCKET_EVENTS];
+    struct timespec timeout;
+    timeout.tv_sec = nTimeout / 1000;
+    timeout.tv_nsec = (nTimeout % 1000) * 1000000;
+    int nEvents = kevent(socketEventsFd, nullptr, 0, events, MAX_SOCKET_EVENTS, &timeout);
+#endif
+
+    if (interruptNet) return;
+
+    if (nEvents < 0) {
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEINTR) {
+            LogPrintf("socket events wait error %s\n", NetworkErrorString(nErr));
+            interruptNet.sleep_for(std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS));
+        }
+        return;
+    }
+
+    for (int i = 0; i < nEvents; i++) {
+#ifdef USE_EPOLL
+        void* ptr = events[i].data.ptr;
+        // errors and hangups show up in the recv
+        const bool fRecv = events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP);
+        const bool fSend = events[i].events & EPOLLOUT;
+#else
+        void* ptr = events[i].udata;
+        if (events[i].flags & EV_ERROR) continue;
+        const bool fRecv = events[i].filter == EVFILT_READ || (events[i].flags & EV_EOF);
+        const bool fSend = events[i].filter == EVFILT_WRITE;
+#endif
+        bool fListenSocket = false;
+        for (const ListenSocket& hListenSocket : vhListenSocket) {
+            if (ptr == &hListenSocket) {
+                recv_set.insert(hListenSocket.socket);
+                fListenSocket = true;
+                break;
+            }
+        }
+        if (fListenSocket) continue;
+
+        // Registered nodes are only deleted after being unregistered (DisconnectNodes)
+        CNode* pnode = static_cast<CNode*>(ptr);
+        if (fRecv) {
+            pnode->fRecvReady = true;
+        }
+        if (fSend) {
+            LOCK(pnode->cs_vSend);
+            pnode->fSendReady = true;
+        }
+    }
+}
+#else
 bool CConnman::GenerateSelectSet(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set)
 {
     for (const ListenSocket& hListenSocket : vhListenSocket) {
@@ -1414,6 +1711,7 @@ void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_s
     }
 }
 #endif
+#endif // USE_EDGE_TRIGGERED_EVENTS
 
 void CConnman::SocketHandler()
 {
@@ -1455,10 +1753,21 @@ void CConnman::SocketHandler()
             LOCK(pnode->cs_hSocket);
             if (pnode->hSocket == INVALID_SOCKET)
                 continue;
+#ifndef USE_EDGE_TRIGGERED_EVENTS
             recvSet = recv_set.count(pnode->hSocket) > 0;
             sendSet = send_set.count(pnode->hSocket) > 0;
             errorSet = error_set.count(pnode->hSocket) > 0;
+#endif
+        }
+#ifdef USE_EDGE_TRIGGERED_EVENTS
+        {
+            // Same logic as GenerateSelectSet: first drain the send buffer, then receive more
+            LOCK(pnode->cs_vSend);
+            const bool fPendingSend = !pnode->vSendMsg.empty();
+            sendSet = fPendingSend && pnode->fSendReady;
+            recvSet = !fPendingSend && !pnode->fPauseRecv && pnode->fRecvReady;
         }
+#endif
         if (recvSet || errorSet) {
             // typical socket buffer is 8K-64K
             char pchBuf[0x10000];
@@ -1475,21 +1784,13 @@ void CConnman::SocketHandler()
                     pnode->CloseSocketDisconnect();
                 RecordBytesRecv(nBytes);
                 if (notify) {
-                    size_t nSizeAdded = 0;
-                    auto it(pnode->vRecvMsg.begin());
-                    for (; it != pnode->vRecvMsg.end(); ++it) {
-                        if (!it->complete())
-                            break;
-                        nSizeAdded += it->vRecv.size() + CMessageHeader::HEADER_SIZE;
-                    }
-                    {
-                        LOCK(pnode->cs_vProcessMsg);
-                        pnode->vProcessMsg.splice(pnode->vProcessMsg.end(), pnode->vRecvMsg, pnode->vRecvMsg.begin(), it);
-                        pnode->nProcessQueueSize += nSizeAdded;
-                        pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
-                    }
+                    QueueReceivedMessages(pnode);
                     WakeMessageHandler();
                 }
+#ifdef USE_EDGE_TRIGGERED_EVENTS
+                // there may be more to read: no new event until the socket is drained
+                fSocketEventsPending = true;
+#endif
             } else if (nBytes == 0) {
                 // socket closed gracefully
                 if (!pnode->fDisconnect)
@@ -1503,6 +1804,9 @@ void CConnman::SocketHandler()
                         LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
                     pnode->CloseSocketDisconnect();
                 }
+                if (nErr == WSAEWOULDBLOCK) {
+                    pnode->fRecvReady = false;
+                }
             }
         }
 
@@ -1514,6 +1818,11 @@ void CConnman::SocketHandler()
             size_t nBytes = SocketSendData(pnode);
             if (nBytes)
                 RecordBytesSent(nBytes);
+#ifdef USE_EDGE_TRIGGERED_EVENTS
+            if (pnode->fSendReady && !pnode->vSendMsg.empty()) {
+                fSocketEventsPending = true;
+            }
+#endif
         }
 
         InactivityCheck(pnode);
@@ -1626,8 +1935,17 @@ void CConnman::DumpAddresses()
 {
     int64_t nStart = GetTimeMillis();
 
+    // Nothing to write if the tables didn't change since the last dump
+    const uint64_t nChanges = addrman.GetChanges();
+    if (nChanges == nLastDumpedAddrChanges) {
+        LogPrint(BCLog::NET, "peers.dat unchanged, skipping the flush of %d addresses\n", addrman.size());
+        return;
+    }
+
     CAddrDB adb;
-    adb.Write(addrman);
+    if (adb.Write(addrman)) {
+        nLastDumpedAddrChanges = nChanges;
+    }
 
     LogPrint(BCLog::NET, "Flushed %d addresses to peers.dat  %dms\n",
         addrman.size(), GetTimeMillis() - nStart);
@@ -1936,6 +2254,7 @@ void CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
         pnode->m_masternode_probe_connection = true;
 
     m_msgproc->InitializeNode(pnode);
+    RegisterSocketEvents(pnode);
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
@@ -2178,6 +2497,22 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
 {
     Init(connOptions);
 
+    if (connOptions.m_capture_messages) {
+        const fs::path dir = GetDataDir() / "message_capture";
+        TryCreateDirectories(dir);
+        const fs::path path = dir / strprintf("msgs_%d.dat", GetTime());
+        LOCK(cs_capture);
+        fileCapture.reset(new CAutoFile(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION));
+        if (fileCapture->IsNull()) {
+            LogPrintf("Unable to open %s, the messages aren't captured\n", path.string());
+            fileCapture.reset();
+        } else {
+            fileCapture->write(CAPTURE_FILE_MAGIC, sizeof(CAPTURE_FILE_MAGIC) - 1);
+            *fileCapture << CAPTURE_FILE_VERSION;
+            LogPrintf("Capturing the received messages to %s\n", path.string());
+        }
+    }
+
     {
         LOCK(cs_totalBytesRecv);
         nTotalBytesRecv = 0;
@@ -2207,9 +2542,10 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
     int64_t nStart = GetTimeMillis();
     {
         CAddrDB adb;
-        if (adb.Read(addrman))
+        if (adb.Read(addrman)) {
+            nLastDumpedAddrChanges = addrman.GetChanges();
             LogPrintf("Loaded %i addresses from peers.dat  %dms\n", addrman.size(), GetTimeMillis() - nStart);
-        else {
+        } else {
             addrman.Clear(); // Addrman can be in an inconsistent state after failure, reset it
             LogPrintf("Invalid or missing peers.dat; recreating\n");
             DumpAddresses();
@@ -2262,6 +2598,17 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
         fMsgProcWake = false;
     }
 
+#ifdef USE_EDGE_TRIGGERED_EVENTS
+    if (!InitSocketEvents()) {
+        if (clientInterface) {
+            clientInterface->ThreadSafeMessageBox(
+                    _("Failed to initialize the socket events."),
+                    "", CClientUIInterface::MSG_ERROR);
+        }
+        return false;
+    }
+#endif
+
     // Send and receive from sockets, accept connections
     threadSocketHandler = std::thread(&TraceThread<std::function<void()> >, "net", std::function<void()>(std::bind(&CConnman::ThreadSocketHandler, this)));
 
@@ -2297,7 +2644,7 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
     threadMessageHandler = std::thread(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this)));
 
     // Dump network addresses
-    scheduler.scheduleEvery(std::bind(&CConnman::DumpData, this), DUMP_ADDRESSES_INTERVAL * 1000);
+    scheduler.scheduleEvery(std::bind(&CConnman::DumpData, this), DUMP_ADDRESSES_INTERVAL * 1000, "dump-addresses", CScheduler::Priority::LOW);
 
     return true;
 }
@@ -2378,6 +2725,12 @@ void CConnman::Stop()
         if (hListenSocket.socket != INVALID_SOCKET)
             if (!CloseSocket(hListenSocket.socket))
                 LogPrintf("CloseSocket(hListenSocket) failed with error %s\n", NetworkErrorString(WSAGetLastError()));
+#ifdef USE_EDGE_TRIGGERED_EVENTS
+    if (socketEventsFd != -1) {
+        close(socketEventsFd);
+        socketEventsFd = -1;
+    }
+#endif
 
     // clean up some globals (to help leak detection)
     for(CNode* pnode : vNodes) {
@@ -2391,6 +2744,7 @@ void CConnman::Stop()
     vhListenSocket.clear();
     semOutbound.reset();
     semAddnode.reset();
+    WITH_LOCK(cs_capture, fileCapture.reset());
 }
 
 void CConnman::DeleteNode(CNode* pnode)
@@ -2703,19 +3057,38 @@ bool CConnman::NodeFullyConnected(const CNode* pnode)
     return pnode && pnode->fSuccessfullyConnected && !pnode->fDisconnect;
 }
 
+NetMsgPriority GetNetMsgPriority(const std::string& command)
+{
+    // The messages of a class keep their relative order: a class must contain all the
+    // messages whose ordering matters to each other (e.g. merkleblock and its txs).
+    static const std::set<std::string> highCommands{
+            NetMsgType::BLOCK, NetMsgType::HEADERS, NetMsgType::CMPCTBLOCK, NetMsgType::BLOCKTXN,
+            NetMsgType::CLSIG, NetMsgType::QSIGREC, NetMsgType::QSIGSHARESINV, NetMsgType::QGETSIGSHARES,
+            NetMsgType::QBSIGSHARES};
+    static const std::set<std::string> lowCommands{
+            NetMsgType::MNBROADCAST, NetMsgType::MNPING, NetMsgType::MNWINNER, NetMsgType::BUDGETPROPOSAL,
+            NetMsgType::BUDGETVOTE, NetMsgType::FINALBUDGET, NetMsgType::FINALBUDGETVOTE, NetMsgType::SYNCSTATUSCOUNT};
+    if (highCommands.count(command)) return NetMsgPriority::HIGH;
+    if (lowCommands.count(command)) return NetMsgPriority::LOW;
+    return NetMsgPriority::NORMAL;
+}
+
 void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 {
-    size_t nMessageSize = msg.data.size();
+    size_t nMessageSize = msg.shared_data ? msg.shared_data->data.size() : msg.data.size();
     size_t nTotalSize = nMessageSize + CMessageHeader::HEADER_SIZE;
     LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg.command.c_str()), nMessageSize, pnode->GetId());
 
-    std::vector<unsigned char> serializedHeader;
-    serializedHeader.reserve(CMessageHeader::HEADER_SIZE);
-    uint256 hash = Hash(msg.data.data(), msg.data.data() + nMessageSize);
+    CQueuedNetMsg queued;
+    queued.header.reserve(CMessageHeader::HEADER_SIZE);
+    const uint256& hash = msg.shared_data ? msg.shared_data->hash : Hash(msg.data.data(), msg.data.data() + nMessageSize);
     CMessageHeader hdr(Params().MessageStart(), msg.command.c_str(), nMessageSize);
     memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
 
-    CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, serializedHeader, 0, hdr};
+    CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, queued.header, 0, hdr};
+    queued.data = std::move(msg.data);
+    queued.shared_data = std::move(msg.shared_data);
+    queued.priority = GetNetMsgPriority(msg.command);
 
     size_t nBytesSent = 0;
     {
@@ -2728,9 +3101,13 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 
         if (pnode->nSendSize > nSendBufferMaxSize)
             pnode->fPauseSend = true;
-        pnode->vSendMsg.push_back(std::move(serializedHeader));
-        if (nMessageSize)
-            pnode->vSendMsg.push_back(std::move(msg.data));
+        // Queue the message after the ones of its class (or of a higher one), but not before a partially sent one
+        auto pos = pnode->vSendMsg.end();
+        const auto first = pnode->vSendMsg.begin() + (pnode->nSendOffset > 0 ? 1 : 0);
+        while (pos > first && std::prev(pos)->priority > queued.priority) {
+            --pos;
+        }
+        pnode->vSendMsg.insert(pos, std::move(queued));
 
         // If write queue empty, attempt "optimistic write"
         if (optimisticSend == true)
@@ -27,6 +27,7 @@
 #include <atomic>
 #include <cstdint>
 #include <deque>
+#include <limits>
 #include <thread>
 #include <memory>
 #include <condition_variable>
@@ -38,6 +39,7 @@
 class CAddrMan;
 class CBlockIndex;
 class CScheduler;
+class CNetMessage;
 class CNode;
 class TierTwoConnMan;
 
@@ -61,6 +63,8 @@ static constexpr double MAX_ADDR_RATE_PER_SECOND{0.1};
 static constexpr size_t MAX_ADDR_PROCESSING_TOKEN_BUCKET{MAX_ADDR_TO_SEND};
 /** Maximum length of incoming protocol messages (no message over 2 MiB is currently acceptable). */
 static const unsigned int MAX_PROTOCOL_MESSAGE_LENGTH = 2 * 1024 * 1024;
+/** Maximum capacity of the receive buffer kept by a peer for its next message. */
+static const size_t MAX_RECV_BUFFER_REUSE = 256 * 1024;
 /** Maximum length of strSubVer in `version` message */
 static const unsigned int MAX_SUBVERSION_LENGTH = 256;
 /** Maximum number of automatic outgoing nodes */
@@ -87,12 +91,28 @@ static const ServiceFlags REQUIRED_SERVICES = NODE_NETWORK;
 static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
+//! Default for -capturemessages
+static const bool DEFAULT_CAPTURE_MESSAGES = false;
 
 // NOTE: When adjusting this, update rpcnet:setban's help ("24h")
 static const unsigned int DEFAULT_MISBEHAVING_BANTIME = 60 * 60 * 24;  // Default 24-hour ban
 
 typedef int NodeId;
 
+/** A message received from a peer, as recorded by -capturemessages */
+struct CCapturedMessage
+{
+    int64_t nTime{0}; // time (in microseconds) of message receipt
+    NodeId nPeer{0};
+    std::string strCommand;
+    std::vector<unsigned char> vPayload;
+
+    SERIALIZE_METHODS(CCapturedMessage, obj) { READWRITE(obj.nTime, obj.nPeer, obj.strCommand, obj.vPayload); }
+};
+
+/** Read the messages of a -capturemessages file, in their order of receipt. Returns false if it isn't one. */
+bool ReadCapturedMessages(const fs::path& path, std::vector<CCapturedMessage>& vMessages);
+
 struct AddedNodeInfo
 {
     std::string strAddedNode;
@@ -112,6 +132,17 @@ class CTransaction;
 class CNodeStats;
 class CClientUIInterface;
 
+/** A serialized payload sent to many peers (e.g. a block), with its hash computed once for the message checksums */
+struct CSharedNetPayload
+{
+    const std::vector<unsigned char> data;
+    const uint256 hash;
+
+    explicit CSharedNetPayload(std::vector<unsigned char>&& dataIn) :
+        data(std::move(dataIn)),
+        hash(Hash(data.data(), data.data() + data.size())) {}
+};
+
 struct CSerializedNetMsg
 {
     CSerializedNetMsg() = default;
@@ -123,6 +154,30 @@ struct CSerializedNetMsg
 
     std::vector<unsigned char> data;
     std::string command;
+    // If set, the payload (instead of data), shared with the messages sent to the other peers
+    std::shared_ptr<const CSharedNetPayload> shared_data;
+};
+
+/** The classes of the messages in the send queue of a node, the lower ones being sent first */
+enum class NetMsgPriority : uint8_t {
+    HIGH = 0,   // blocks, headers, chainlocks and LLMQ signatures
+    NORMAL = 1, // transactions and everything else
+    LOW = 2,    // tier two sync data
+};
+
+/** The send queue class of a message command */
+NetMsgPriority GetNetMsgPriority(const std::string& command);
+
+/** A message in the send queue of a node: its serialized header and its (owned or shared) payload */
+struct CQueuedNetMsg
+{
+    std::vector<unsigned char> header;
+    std::vector<unsigned char> data;
+    std::shared_ptr<const CSharedNetPayload> shared_data;
+    NetMsgPriority priority{NetMsgPriority::NORMAL};
+
+    const std::vector<unsigned char>& Payload() const { return shared_data ? shared_data->data : data; }
+    size_t size() const { return header.size() + Payload().size(); }
 };
 
 class NetEventsInterface;
@@ -157,6 +212,7 @@ public:
         bool m_use_addrman_outgoing = true;
         std::vector<std::string> m_specified_outgoing;
         std::vector<std::string> m_added_nodes;
+        bool m_capture_messages = false;
     };
 
     void Init(const Options& connOptions) {
@@ -194,6 +250,9 @@ public:
                                bool masternode_connection = false,
                                bool masternode_probe_connection = false);
     bool CheckIncomingNonce(uint64_t nonce);
+    /** Feed a captured message to pnode as if received from its socket, queueing it for the message handler.
+     * For the replay of the captures, on nodes without socket. */
+    bool ReplayMessage(CNode* pnode, const CCapturedMessage& msg);
 
     struct CFullyConnectedOnly {
         bool operator() (const CNode* pnode) const {
@@ -352,6 +411,7 @@ public:
     unsigned int GetReceiveFloodSize() const;
 
     void SetAsmap(std::vector<bool> asmap) { addrman.m_asmap = std::move(asmap); }
+    size_t GetAddrManMemoryUsage() const { return addrman.DynamicMemoryUsage(); }
     /** Unique tier two connections manager */
     TierTwoConnMan* GetTierTwoConnMan() { return m_tiertwo_conn_man.get(); };
     /** Update the node to be a iqr member if needed */
@@ -376,7 +436,17 @@ private:
     void DisconnectNodes();
     void NotifyNumConnectionsChanged();
     void InactivityCheck(CNode* pnode);
+    /** Move the complete received messages of pnode to its process queue, capturing them with -capturemessages */
+    void QueueReceivedMessages(CNode* pnode);
+    void CaptureMessage(const CNode& node, const CNetMessage& msg);
+#ifdef USE_EDGE_TRIGGERED_EVENTS
+    bool InitSocketEvents();
+#else
     bool GenerateSelectSet(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set);
+#endif
+    // Add/remove the node socket to/from the interest set of the edge-triggered socket events (no-op without them)
+    void RegisterSocketEvents(CNode* pnode);
+    void UnregisterSocketEvents(CNode* pnode);
     void SocketEvents(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set);
     void SocketHandler();
     void ThreadSocketHandler();
@@ -431,12 +501,20 @@ private:
     unsigned int nReceiveFloodSize{0};
 
     std::vector<ListenSocket> vhListenSocket;
+#ifdef USE_EDGE_TRIGGERED_EVENTS
+    //! epoll/kqueue descriptor with the persistent interest set of the listening and node sockets
+    int socketEventsFd{-1};
+    //! Whether a node socket may still be readable/writable, so that the next wait must not block (socket handler thread only)
+    bool fSocketEventsPending{false};
+#endif
     std::atomic<bool> fNetworkActive{true};
     banmap_t setBanned;
     RecursiveMutex cs_setBanned;
     bool setBannedIsDirty{false};
     bool fAddressesInitialized{false};
     CAddrMan addrman;
+    //! addrman change counter when peers.dat was last written or read, to skip the dumps of unchanged tables
+    std::atomic<uint64_t> nLastDumpedAddrChanges{std::numeric_limits<uint64_t>::max()};
     std::deque<std::string> vOneShots;
     RecursiveMutex cs_vOneShots;
     std::vector<std::string> vAddedNodes GUARDED_BY(cs_vAddedNodes);
@@ -482,6 +560,10 @@ private:
     std::thread threadMessageHandler;
 
     std::unique_ptr<TierTwoConnMan> m_tiertwo_conn_man;
+
+    //! -capturemessages file, null when not capturing
+    Mutex cs_capture;
+    std::unique_ptr<CAutoFile> fileCapture GUARDED_BY(cs_capture);
 };
 extern std::unique_ptr<CConnman> g_connman;
 void Discover();
@@ -646,12 +728,15 @@ public:
     ServiceFlags nServicesExpected;
     SOCKET hSocket;
     size_t nSendSize;   // total size of all vSendMsg entries
-    size_t nSendOffset; // offset inside the first vSendMsg already sent
+    size_t nSendOffset; // offset inside the first vSendMsg already sent (header, then payload)
     uint64_t nSendBytes;
-    std::deque<std::vector<unsigned char>> vSendMsg;
+    // Ordered by priority (after the first message, that might be partially sent), FIFO within a class
+    std::deque<CQueuedNetMsg> vSendMsg;
     RecursiveMutex cs_vSend;
     RecursiveMutex cs_hSocket;
     RecursiveMutex cs_vRecv;
+    // Buffer of a processed message, reused for the data of the next message received
+    CSerializeData vRecvBuffer;
 
     RecursiveMutex cs_vProcessMsg;
     std::list<CNetMessage> vProcessMsg;
@@ -705,6 +790,10 @@ public:
     const uint64_t nKeyedNetGroup;
     std::atomic_bool fPauseRecv;
     std::atomic_bool fPauseSend;
+    // Readiness of the socket reported by the edge-triggered socket events (epoll/kqueue), kept until a recv/send
+    // would block. fRecvReady is only accessed by the socket handler thread.
+    bool fRecvReady{false};
+    bool fSendReady GUARDED_BY(cs_vSend){false};
 
     // If true, we will announce/send him plain recovered sigs (usually true for full nodes)
     std::atomic<bool> m_wants_recsigs{false};
@@ -822,6 +911,8 @@ public:
     }
 
     bool ReceiveMsgBytes(const char* pch, unsigned int nBytes, bool& complete);
+    /** Give back the buffer of a processed message, to receive the next one without allocating */
+    void RecycleRecvBuffer(CDataStream& vRecv);
 
     void SetRecvVersion(int nVersionIn)
     {
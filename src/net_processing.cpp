@@ -7,10 +7,14 @@
 
 #include "net_processing.h"
 
+#include "blockencodings.h"
 #include "budget/budgetmanager.h"
 #include "chain.h"
+#include "ctpl_stl.h"
 #include "evo/deterministicmns.h"
 #include "evo/mnauth.h"
+#include "index/blockfilterindex.h"
+#include "kernel.h"
 #include "llmq/quorums_blockprocessor.h"
 #include "llmq/quorums_chainlocks.h"
 #include "llmq/quorums_dkgsessionmgr.h"
@@ -19,14 +23,20 @@
 #include "masternode-sync.h"
 #include "masternodeman.h"
 #include "merkleblock.h"
+#include "metrics.h"
 #include "netbase.h"
 #include "netmessagemaker.h"
+#include "pow.h"
 #include "primitives/block.h"
 #include "primitives/transaction.h"
+#include "saltedhasher.h"
 #include "spork.h"
 #include "sporkdb.h"
 #include "streams.h"
 #include "tiertwo/tiertwo_sync_state.h"
+#include "txreconciliation.h"
+#include "unordered_lru_cache.h"
+#include "util/threadnames.h"
 #include "util/validation.h"
 #include "validation.h"
 
@@ -40,6 +50,18 @@ static const uint64_t RANDOMIZER_ID_ADDRESS_RELAY = 0x3cac0035b5866b90ULL; // SH
 /** the maximum percentage of addresses from our addrman to return in response to a getaddr message. */
 static constexpr size_t MAX_PCT_ADDR_TO_SEND = 23;
 
+/** Maximum depth of the blocks that we send as cmpctblock (deeper ones are sent in full). */
+static const int MAX_CMPCTBLOCK_DEPTH = 5;
+/** Maximum depth of the blocks whose transactions we send in a blocktxn. */
+static const int MAX_BLOCKTXN_DEPTH = 10;
+/** Maximum number of compact filters that may be requested with one getcfilters. See BIP 157. */
+static constexpr uint32_t MAX_GETCFILTERS_SIZE = 1000;
+/** Maximum number of cf hashes that may be requested with one getcfheaders. See BIP 157. */
+static constexpr uint32_t MAX_GETCFHEADERS_SIZE = 2000;
+
+// The reconciliation of the transactions announced to the peers supporting it (null if disabled by -txreconciliation)
+static std::unique_ptr<TxReconciliationTracker> txReconciliation;
+
 struct IteratorComparator
 {
     template<typename I>
@@ -54,12 +76,22 @@ struct COrphanTx {
     CTransactionRef tx;
     NodeId fromPeer;
     int64_t nTimeExpire;
-    size_t list_pos;
+    unsigned int nTxSize;
+};
+typedef std::map<uint256, COrphanTx>::iterator OrphanMapIter;
+struct COrphanPeerState {
+    // The orphans received from the peer, and their size (bounded by MAX_ORPHAN_TX_BYTES_PER_PEER)
+    size_t nBytes{0};
+    std::set<OrphanMapIter, IteratorComparator> setOrphans;
+    // The orphans to reprocess, whose parents were accepted after a tx received from the peer
+    std::set<uint256> workSet;
 };
 RecursiveMutex g_cs_orphans;
 std::map<uint256, COrphanTx> mapOrphanTransactions GUARDED_BY(g_cs_orphans);
-std::map<COutPoint, std::set<std::map<uint256, COrphanTx>::iterator, IteratorComparator>> mapOrphanTransactionsByPrev GUARDED_BY(g_cs_orphans);
-std::vector<std::map<uint256, COrphanTx>::iterator> g_orphan_list GUARDED_BY(g_cs_orphans); //! For random eviction
+std::map<COutPoint, std::set<OrphanMapIter, IteratorComparator>> mapOrphanTransactionsByPrev GUARDED_BY(g_cs_orphans);
+//! Number of orphans spending the outputs of a tx, to quickly skip the txes that no orphan is waiting for
+std::unordered_map<uint256, unsigned int, StaticSaltedHasher> mapOrphanTransactionsByParent GUARDED_BY(g_cs_orphans);
+std::map<NodeId, COrphanPeerState> mapOrphansByPeer GUARDED_BY(g_cs_orphans); //! Until the peer disconnects
 
 void EraseOrphansFor(NodeId peer);
 
@@ -98,6 +130,24 @@ std::map<uint256, NodeId> mapBlockSource;
 std::unique_ptr<CRollingBloomFilter> recentRejects;
 uint256 hashRecentRejectsChainTip;
 
+/**
+ * Filter for the tx and tier two inventory hashes that AlreadyHave recently found,
+ * so that the invs of the same items relayed by the other peers are answered without
+ * querying (and locking) the mempool and the tier two managers again.
+ * Protected by cs_main, reset with recentRejects when the chain tip changes, and at
+ * least every RECENTLY_HAVE_MAX_AGE seconds.
+ *
+ * A hit is not checked against the owner: an item dropped by its owner in the meantime
+ * (e.g. a tx evicted from the mempool, or a seen mnb/mnp cleaned up) is still reported
+ * as had, and not requested again from the peers, until the next reset.
+ *
+ * Memory used: 1.3MB
+ */
+std::unique_ptr<CRollingBloomFilter> recentlyHave;
+int64_t nRecentlyHaveResetTime = 0;
+/** Bound of the staleness window of recentlyHave when the chain tip doesn't change */
+static constexpr int64_t RECENTLY_HAVE_MAX_AGE = 2 * 60;
+
 /** Blocks that are in flight, and that are in the queue to be downloaded. Protected by cs_main. */
 struct QueuedBlock {
     uint256 hash;
@@ -105,6 +155,7 @@ struct QueuedBlock {
     int64_t nTime;              //! Time of "getdata" request in microseconds.
     int nValidatedQueuedBefore; //! Number of blocks queued with validated headers (globally) at the time this one is requested.
     bool fValidatedHeaders;     //! Whether this block has validated headers at the time of request.
+    bool fRerequested;          //! Whether this block was requested again, from a faster peer, as it held back our chain.
 };
 std::map<uint256, std::pair<NodeId, std::list<QueuedBlock>::iterator> > mapBlocksInFlight;
 
@@ -114,6 +165,58 @@ int nQueuedValidatedHeaders = 0;
 /** Number of preferable block download peers. */
 int nPreferredDownload = 0;
 
+/** Maximum number of entries of sharedBlockPayloads */
+static const size_t MAX_SHARED_BLOCK_PAYLOADS = 4;
+
+/**
+ * Serialized payloads of the last connected blocks, and of the last blocks sent from disk, shared by the block
+ * messages of all the peers requesting them: a block is serialized and hashed once, however many peers download
+ * it. Protected by cs_main.
+ */
+unordered_lru_cache<uint256, std::shared_ptr<const CSharedNetPayload>, StaticSaltedHasher, MAX_SHARED_BLOCK_PAYLOADS> sharedBlockPayloads;
+
+/** Maximum number of entries of sharedFilterableBlocks */
+static const size_t MAX_SHARED_FILTERABLE_BLOCKS = 4;
+
+/** Maximum number of threads matching the bloom filters of the peers requesting the same filtered block */
+static const int MAX_FILTERED_BLOCK_THREADS = 4;
+
+/**
+ * The last blocks requested as filtered blocks, read and parsed once for all the bloom filters they are
+ * matched against. Protected by cs_main.
+ */
+unordered_lru_cache<uint256, std::shared_ptr<const CFilterableBlock>, StaticSaltedHasher, MAX_SHARED_FILTERABLE_BLOCKS> sharedFilterableBlocks;
+
+/** The threads matching the filters of the peers requesting the same filtered block, created on first use. Protected by cs_main. */
+std::unique_ptr<ctpl::thread_pool> filteredBlockPool;
+
+/** Maximum number of entries of recentBlocks */
+static const size_t MAX_RECENT_BLOCKS = 16;
+
+enum class RecentBlockStatus {
+    IN_PROGRESS,
+    VALID,
+    INVALID,
+};
+
+/** The outcome of the processing of a block message */
+struct RecentBlock {
+    //! SipHash of the whole message: the outcome is shared only by its identical copies, as the hash
+    //! of a block doesn't commit to its signature
+    uint64_t nPayloadHash{0};
+    RecentBlockStatus status{RecentBlockStatus::IN_PROGRESS};
+    int nDoS{0};
+    std::string strRejectReason;
+};
+
+/**
+ * The last block messages processed, by block hash, so that the copies of the same block relayed by the
+ * other peers are answered without deserializing and checking them again. Only the invalid blocks that
+ * didn't make it to the block index are recorded as such, the others are found in the index.
+ * Protected by cs_main.
+ */
+unordered_lru_cache<uint256, RecentBlock, StaticSaltedHasher, MAX_RECENT_BLOCKS> recentBlocks;
+
 } // anon namespace
 
 namespace
@@ -222,12 +325,24 @@ struct CNodeState {
     int64_t nStallingSince;
     std::list<QueuedBlock> vBlocksInFlight;
     int nBlocksInFlight;
+    //! Moving average of the time between the blocks delivered by this peer (in microseconds), or 0 if none yet.
+    int64_t nBlockDeliveryTimeAvg{0};
+    //! When the last block requested from this peer was delivered (in microseconds).
+    int64_t nLastBlockDelivery{0};
     //! Whether we consider this a preferred download peer.
     bool fPreferredDownload;
     //! Addresses processed
     uint64_t amt_addr_processed = 0;
     //! Addresses rate limited
     uint64_t amt_addr_rate_limited = 0;
+    //! Whether this peer can provide compact blocks (sent a sendcmpct with our version)
+    bool fProvidesHeaderAndIDs{false};
+    //! The compact block received from this peer, waiting for the blocktxn with its missing transactions
+    std::unique_ptr<PartiallyDownloadedBlock> partialBlock;
+    //! The merkle block of the filtered block at the front of this peer's getdata queue, matched along
+    //! with the request of another peer for the same block (with the hash of the block)
+    std::unique_ptr<CMerkleBlock> matchedMerkleBlock;
+    uint256 hashMatchedMerkleBlock;
 
     CNodeBlocks nodeBlocks;
 
@@ -298,13 +413,22 @@ void PushNodeVersion(CNode* pnode, CConnman* connman, int64_t nTime)
         LogPrint(BCLog::NET, "send version message: version %d, blocks=%d, us=%s, peer=%d\n", PROTOCOL_VERSION, nNodeStartingHeight, addrMe.ToString(), nodeid);
 }
 
-// Requires cs_main.
-void MarkBlockAsReceived(const uint256& hash)
+// Requires cs_main. The download speed of the peer is measured when nodeFrom is the one the block was requested from.
+void MarkBlockAsReceived(const uint256& hash, NodeId nodeFrom = -1)
 {
     std::map<uint256, std::pair<NodeId, std::list<QueuedBlock>::iterator> >::iterator itInFlight = mapBlocksInFlight.find(hash);
     if (itInFlight != mapBlocksInFlight.end()) {
         CNodeState* state = State(itInFlight->second.first);
         assert(state != nullptr);
+        if (nodeFrom == itInFlight->second.first) {
+            // Time spent by the peer on this block: since the request, or since the previous delivery if the
+            // peer was busy with the other blocks in flight before.
+            const int64_t nNow = GetTimeMicros();
+            const int64_t nDeliveryTime = std::max<int64_t>(1, nNow - std::max(itInFlight->second.second->nTime, state->nLastBlockDelivery));
+            state->nBlockDeliveryTimeAvg = state->nBlockDeliveryTimeAvg == 0 ? nDeliveryTime :
+                                           (state->nBlockDeliveryTimeAvg * 7 + nDeliveryTime) / 8;
+            state->nLastBlockDelivery = nNow;
+        }
         nQueuedValidatedHeaders -= itInFlight->second.second->fValidatedHeaders;
         state->vBlocksInFlight.erase(itInFlight->second.second);
         state->nBlocksInFlight--;
@@ -314,7 +438,7 @@ void MarkBlockAsReceived(const uint256& hash)
 }
 
 // Requires cs_main.
-void MarkBlockAsInFlight(NodeId nodeid, const uint256& hash, const CBlockIndex* pindex = nullptr)
+void MarkBlockAsInFlight(NodeId nodeid, const uint256& hash, const CBlockIndex* pindex = nullptr, bool fRerequested = false)
 {
     CNodeState* state = State(nodeid);
     assert(state != nullptr);
@@ -322,13 +446,25 @@ void MarkBlockAsInFlight(NodeId nodeid, const uint256& hash, const CBlockIndex*
     // Make sure it's not listed somewhere already.
     MarkBlockAsReceived(hash);
 
-    QueuedBlock newentry = {hash, pindex, GetTimeMicros(), nQueuedValidatedHeaders, pindex != nullptr};
+    QueuedBlock newentry = {hash, pindex, GetTimeMicros(), nQueuedValidatedHeaders, pindex != nullptr, fRerequested};
     nQueuedValidatedHeaders += newentry.fValidatedHeaders;
     std::list<QueuedBlock>::iterator it = state->vBlocksInFlight.insert(state->vBlocksInFlight.end(), newentry);
     state->nBlocksInFlight++;
     mapBlocksInFlight[hash] = std::make_pair(nodeid, it);
 }
 
+/** Number of blocks that can be in flight from a peer: enough to keep it busy for its round trip (the minimum ping
+ *  time) plus BLOCK_DOWNLOAD_BUSY_TIME at its measured speed. Requires cs_main. */
+static int GetBlocksInTransitLimit(const CNodeState* state, int64_t nMinPingUsecTime)
+{
+    if (state->nBlockDeliveryTimeAvg == 0) {
+        return DEFAULT_BLOCKS_IN_TRANSIT_PER_PEER;
+    }
+    const int64_t nRoundTrip = nMinPingUsecTime == std::numeric_limits<int64_t>::max() ? 0 : nMinPingUsecTime;
+    const int64_t nLimit = 1 + (nRoundTrip + BLOCK_DOWNLOAD_BUSY_TIME) / state->nBlockDeliveryTimeAvg;
+    return (int)std::max<int64_t>(MIN_BLOCKS_IN_TRANSIT_PER_PEER, std::min<int64_t>(MAX_BLOCKS_IN_TRANSIT_PER_PEER, nLimit));
+}
+
 /** Check whether the last unknown block a peer advertised is not yet known. */
 static void ProcessBlockAvailability(NodeId nodeid) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
@@ -485,6 +621,7 @@ void PeerLogicValidation::FinalizeNode(NodeId nodeid, bool& fUpdateConnectionTim
         mapBlocksInFlight.erase(entry.hash);
     EraseOrphansFor(nodeid);
     nPreferredDownload -= state->fPreferredDownload;
+    if (txReconciliation) txReconciliation->ForgetPeer(nodeid);
 
     mapNodeState.erase(nodeid);
 }
@@ -513,6 +650,25 @@ bool GetNodeStateStats(NodeId nodeid, CNodeStateStats& stats)
 // mapOrphanTransactions
 //
 
+int static EraseOrphanTx(uint256 hash) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans);
+
+size_t GetOrphanPoolMemoryUsage()
+{
+    LOCK(g_cs_orphans);
+    size_t nUsage = memusage::DynamicUsage(mapOrphanTransactions) + memusage::DynamicUsage(mapOrphanTransactionsByPrev) +
+                    memusage::DynamicUsage(mapOrphanTransactionsByParent) + memusage::DynamicUsage(mapOrphansByPeer);
+    for (const auto& it : mapOrphanTransactions) {
+        nUsage += memusage::RecursiveDynamicUsage(it.second.tx);
+    }
+    for (const auto& it : mapOrphanTransactionsByPrev) {
+        nUsage += memusage::DynamicUsage(it.second);
+    }
+    for (const auto& it : mapOrphansByPeer) {
+        nUsage += memusage::DynamicUsage(it.second.setOrphans) + memusage::DynamicUsage(it.second.workSet);
+    }
+    return nUsage;
+}
+
 bool AddOrphanTx(const CTransactionRef& tx, NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans)
 {
     const uint256& hash = tx->GetHash();
@@ -533,11 +689,23 @@ bool AddOrphanTx(const CTransactionRef& tx, NodeId peer) EXCLUSIVE_LOCKS_REQUIRE
         return false;
     }
 
-    auto ret = mapOrphanTransactions.emplace(hash, COrphanTx{tx, peer, GetTime() + ORPHAN_TX_EXPIRE_TIME, g_orphan_list.size()});
+    // A peer can only evict its own orphans (the ones expiring first) to stay within its quota
+    COrphanPeerState& peerOrphans = mapOrphansByPeer[peer];
+    while (!peerOrphans.setOrphans.empty() && peerOrphans.nBytes + sz > MAX_ORPHAN_TX_BYTES_PER_PEER) {
+        auto itOldest = std::min_element(peerOrphans.setOrphans.begin(), peerOrphans.setOrphans.end(), [](const OrphanMapIter& a, const OrphanMapIter& b) {
+            return a->second.nTimeExpire < b->second.nTimeExpire;
+        });
+        EraseOrphanTx((*itOldest)->first);
+    }
+
+    auto ret = mapOrphanTransactions.emplace(hash, COrphanTx{tx, peer, GetTime() + ORPHAN_TX_EXPIRE_TIME, sz});
     assert(ret.second);
-    g_orphan_list.emplace_back(ret.first);
+    peerOrphans.setOrphans.insert(ret.first);
+    peerOrphans.nBytes += sz;
     for (const CTxIn& txin : tx->vin) {
-        mapOrphanTransactionsByPrev[txin.prevout].insert(ret.first);
+        if (mapOrphanTransactionsByPrev[txin.prevout].insert(ret.first).second) {
+            mapOrphanTransactionsByParent[txin.prevout.hash]++;
+        }
     }
 
     LogPrint(BCLog::MEMPOOL, "stored orphan tx %s (mapsz %u outsz %u)\n", hash.ToString(),
@@ -554,21 +722,19 @@ int static EraseOrphanTx(uint256 hash) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans)
         auto itPrev = mapOrphanTransactionsByPrev.find(txin.prevout);
         if (itPrev == mapOrphanTransactionsByPrev.end())
             continue;
-        itPrev->second.erase(it);
+        if (itPrev->second.erase(it)) {
+            auto itParent = mapOrphanTransactionsByParent.find(txin.prevout.hash);
+            if (itParent != mapOrphanTransactionsByParent.end() && --itParent->second == 0)
+                mapOrphanTransactionsByParent.erase(itParent);
+        }
         if (itPrev->second.empty())
             mapOrphanTransactionsByPrev.erase(itPrev);
     }
 
-    size_t old_pos = it->second.list_pos;
-    assert(g_orphan_list[old_pos] == it);
-    if (old_pos + 1 != g_orphan_list.size()) {
-        // Unless we're deleting the last entry in g_orphan_list, move the last
-        // entry to the position we're deleting.
-        auto it_last = g_orphan_list.back();
-        g_orphan_list[old_pos] = it_last;
-        it_last->second.list_pos = old_pos;
-    }
-    g_orphan_list.pop_back();
+    // The peer's entry is kept until it disconnects (references to it stay valid)
+    COrphanPeerState& peerOrphans = mapOrphansByPeer[it->second.fromPeer];
+    peerOrphans.setOrphans.erase(it);
+    peerOrphans.nBytes -= it->second.nTxSize;
 
     mapOrphanTransactions.erase(it);
     return 1;
@@ -578,13 +744,13 @@ void EraseOrphansFor(NodeId peer)
 {
     LOCK(g_cs_orphans);
     int nErased = 0;
-    std::map<uint256, COrphanTx>::iterator iter = mapOrphanTransactions.begin();
-    while (iter != mapOrphanTransactions.end()) {
-        std::map<uint256, COrphanTx>::iterator maybeErase = iter++; // increment to avoid iterator becoming invalid
-        if (maybeErase->second.fromPeer == peer) {
-            nErased += EraseOrphanTx(maybeErase->second.tx->GetHash());
-        }
+    auto itPeer = mapOrphansByPeer.find(peer);
+    if (itPeer == mapOrphansByPeer.end())
+        return;
+    while (!itPeer->second.setOrphans.empty()) {
+        nErased += EraseOrphanTx((*itPeer->second.setOrphans.begin())->first);
     }
+    mapOrphansByPeer.erase(itPeer);
     if (nErased > 0) LogPrint(BCLog::MEMPOOL, "Erased %d orphan tx from peer %d\n", nErased, peer);
 }
 
@@ -615,14 +781,41 @@ unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans)
     }
     FastRandomContext rng;
     while (mapOrphanTransactions.size() > nMaxOrphans) {
-        // Evict a random orphan:
-        size_t randompos = rng.randrange(g_orphan_list.size());
-        EraseOrphanTx(g_orphan_list[randompos]->first);
+        // Evict a random orphan of the peer using the most orphan space, so that a peer flooding
+        // orphans doesn't evict the ones of the other peers
+        auto itPeer = std::max_element(mapOrphansByPeer.begin(), mapOrphansByPeer.end(), [](const auto& a, const auto& b) {
+            return a.second.nBytes < b.second.nBytes;
+        });
+        assert(itPeer != mapOrphansByPeer.end() && !itPeer->second.setOrphans.empty());
+        const auto& setOrphans = itPeer->second.setOrphans;
+        EraseOrphanTx((*std::next(setOrphans.begin(), rng.randrange(setOrphans.size())))->first);
         ++nEvicted;
     }
     return nEvicted;
 }
 
+// Adds to the work set the orphans spending the outputs of the tx
+void AddChildrenToWorkSet(const CTransaction& tx, std::set<uint256>& orphanWorkSet) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans)
+{
+    const uint256& hash = tx.GetHash();
+    if (!mapOrphanTransactionsByParent.count(hash))
+        return;
+    for (unsigned int i = 0; i < tx.vout.size(); i++) {
+        auto itByPrev = mapOrphanTransactionsByPrev.find(COutPoint(hash, i));
+        if (itByPrev == mapOrphanTransactionsByPrev.end())
+            continue;
+        for (const auto& mi : itByPrev->second) {
+            orphanWorkSet.insert(mi->first);
+        }
+    }
+}
+
+bool HasOrphanWork(NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans)
+{
+    auto it = mapOrphansByPeer.find(peer);
+    return it != mapOrphansByPeer.end() && !it->second.workSet.empty();
+}
+
 // Requires cs_main.
 void Misbehaving(NodeId pnode, int howmuch, const std::string& message) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
@@ -700,15 +893,124 @@ static void CheckBlockSpam(NodeId nodeId, const uint256& hashBlock)
 // blockchain -> download logic notification
 //
 
-PeerLogicValidation::PeerLogicValidation(CConnman* connmanIn) :
-        connman(connmanIn)
+static std::shared_ptr<const CSharedNetPayload> MakeBlockPayload(const CBlock& block)
 {
-    // Initialize global variables that cannot be constructed at startup.
-    recentRejects.reset(new CRollingBloomFilter(120000, 0.000001));
+    // The block serialization doesn't depend on the protocol version
+    std::vector<unsigned char> data;
+    CVectorWriter{SER_NETWORK, PROTOCOL_VERSION, data, 0, block};
+    return std::make_shared<const CSharedNetPayload>(std::move(data));
+}
+
+// The serialized block (the BLOCK message payload), from the shared payloads of the last blocks or as stored on disk
+static std::shared_ptr<const CSharedNetPayload> GetSharedBlockPayload(const CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    std::shared_ptr<const CSharedNetPayload> payload;
+    if (sharedBlockPayloads.get(pindex->GetBlockHash(), payload)) {
+        metrics::blockPayloadHits.Inc();
+        return payload;
+    }
+    metrics::blockPayloadMisses.Inc();
+    // The sent blocks are validated: no need to parse them
+    std::vector<unsigned char> data;
+    if (!ReadRawBlockFromDisk(data, pindex))
+        assert(!"cannot load block from disk");
+    payload = std::make_shared<const CSharedNetPayload>(std::move(data));
+    sharedBlockPayloads.insert(pindex->GetBlockHash(), payload);
+    return payload;
+}
+
+// The block with the parsed elements of its transactions, from the last filtered blocks or as stored on disk
+static std::shared_ptr<const CFilterableBlock> GetSharedFilterableBlock(const CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    std::shared_ptr<const CFilterableBlock> fblock;
+    if (sharedFilterableBlocks.get(pindex->GetBlockHash(), fblock)) {
+        return fblock;
+    }
+    auto pblock = std::make_shared<CBlock>();
+    if (!ReadBlockFromDisk(*pblock, pindex))
+        assert(!"cannot load block from disk");
+    fblock = std::make_shared<const CFilterableBlock>(std::move(pblock));
+    sharedFilterableBlocks.insert(pindex->GetBlockHash(), fblock);
+    return fblock;
+}
+
+/**
+ * The merkle block of pfrom for the filtered block fblock (null if it has no bloom filter). The SPV peers request
+ * each new block at about the same time: the merkle blocks of the other peers whose next request is the same
+ * filtered block are matched in the same pass, in parallel as the filters are independent, and kept in their
+ * state. They don't process any message (that could change their filter) until their request is served.
+ */
+static std::unique_ptr<CMerkleBlock> MatchFilteredBlock(CNode* pfrom, const uint256& hash, const CFilterableBlock& fblock, CConnman* connman) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    CNodeState* state = State(pfrom->GetId());
+    if (state->matchedMerkleBlock) {
+        std::unique_ptr<CMerkleBlock> matched = std::move(state->matchedMerkleBlock);
+        if (state->hashMatchedMerkleBlock == hash) {
+            return matched;
+        }
+    }
+
+    std::vector<CNode*> vPeers{pfrom};
+    connman->ForEachNode([&](CNode* pnode) {
+        // The getdata queues are only accessed by the message handler thread
+        if (pnode == pfrom || pnode->fDisconnect || pnode->vRecvGetData.empty()) return;
+        const CInv& next = pnode->vRecvGetData.front();
+        if (next.type != MSG_FILTERED_BLOCK || next.hash != hash) return;
+        CNodeState* nodestate = State(pnode->GetId());
+        if (!nodestate || nodestate->matchedMerkleBlock) return;
+        pnode->AddRef();
+        vPeers.push_back(pnode);
+    });
+
+    std::vector<std::unique_ptr<CMerkleBlock>> vMerkleBlocks(vPeers.size());
+    auto match = [&vPeers, &vMerkleBlocks, &fblock](size_t i) {
+        LOCK(vPeers[i]->cs_filter);
+        if (vPeers[i]->pfilter) {
+            vMerkleBlocks[i] = std::make_unique<CMerkleBlock>(fblock, *vPeers[i]->pfilter);
+        }
+    };
+    const int nThreads = std::min(GetNumCores(), MAX_FILTERED_BLOCK_THREADS);
+    if (vPeers.size() == 1 || nThreads <= 1) {
+        for (size_t i = 0; i < vPeers.size(); i++) {
+            match(i);
+        }
+    } else {
+        if (!filteredBlockPool) {
+            filteredBlockPool.reset(new ctpl::thread_pool(nThreads - 1));
+            RenameThreadPool(*filteredBlockPool, "pivx-bloom-match");
+        }
+        std::vector<std::future<void>> futures;
+        for (size_t i = 1; i < vPeers.size(); i++) {
+            futures.emplace_back(filteredBlockPool->push([&match, i](int) { match(i); }));
+        }
+        match(0);
+        for (auto& f : futures) {
+            f.get();
+        }
+    }
+
+    for (size_t i = 1; i < vPeers.size(); i++) {
+        if (vMerkleBlocks[i]) {
+            CNodeState* nodestate = State(vPeers[i]->GetId());
+            nodestate->matchedMerkleBlock = std::move(vMerkleBlocks[i]);
+            nodestate->hashMatchedMerkleBlock = hash;
+        }
+        vPeers[i]->Release();
+    }
+    if (vPeers.size() > 1) {
+        LogPrint(BCLog::NET, "%s: matched block %s for %d filtered peers\n", __func__, hash.ToString(), vPeers.size());
+    }
+    return std::move(vMerkleBlocks[0]);
 }
 
 void PeerLogicValidation::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex)
 {
+    // The peers are going to request the new tip: serve it without reading it back from disk
+    if (!IsInitialBlockDownload()) {
+        LOCK(cs_main);
+        sharedBlockPayloads.insert(pindex->GetBlockHash(), MakeBlockPayload(*pblock));
+    }
+
     LOCK(g_cs_orphans);
 
     std::vector<uint256> vOrphanErase;
@@ -766,7 +1068,24 @@ void PeerLogicValidation::BlockChecked(const CBlock& block, const CValidationSta
     std::map<uint256, NodeId>::iterator it = mapBlockSource.find(hash);
 
     int nDoS = 0;
-    if (state.IsInvalid(nDoS)) {
+    const bool fInvalid = state.IsInvalid(nDoS);
+
+    // Record the outcome for the copies of the block message being processed. The blocks which
+    // could have been corrupted (e.g. with mutated txes) are processed again, as an honest copy
+    // has the same hash.
+    RecentBlock recent;
+    if (recentBlocks.get(hash, recent) && recent.status == RecentBlockStatus::IN_PROGRESS && fInvalid) {
+        if (nDoS > 0 && !state.CorruptionPossible() && !LookupBlockIndex(hash)) {
+            recent.status = RecentBlockStatus::INVALID;
+            recent.nDoS = nDoS;
+            recent.strRejectReason = state.GetRejectReason();
+            recentBlocks.insert(hash, recent);
+        } else {
+            recentBlocks.erase(hash);
+        }
+    }
+
+    if (fInvalid) {
         if (it != mapBlockSource.end() && State(it->second)) {
             assert (state.GetRejectCode() < REJECT_INTERNAL); // Blocks are never rejected with internal reject codes
             if (nDoS > 0) {
@@ -787,20 +1106,10 @@ void PeerLogicValidation::BlockChecked(const CBlock& block, const CValidationSta
 // Messages
 //
 
-bool static AlreadyHave(const CInv& inv) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+bool static AlreadyHaveFromOwner(const CInv& inv) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
     switch (inv.type) {
     case MSG_TX: {
-        assert(recentRejects);
-        if (chainActive.Tip()->GetBlockHash() != hashRecentRejectsChainTip) {
-            // If the chain tip has changed previously rejected transactions
-            // might be now valid, e.g. due to a nLockTime'd tx becoming valid,
-            // or a double-spend. Reset the rejects filter and give those
-            // txs a second chance.
-            hashRecentRejectsChainTip = chainActive.Tip()->GetBlockHash();
-            recentRejects->reset();
-        }
-
         {
             LOCK(g_cs_orphans);
             if (mapOrphanTransactions.count(inv.hash)) return true;
@@ -877,6 +1186,53 @@ bool static AlreadyHave(const CInv& inv) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
     return true;
 }
 
+bool static AlreadyHave(const CInv& inv) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    if (inv.type == MSG_BLOCK) {
+        return LookupBlockIndex(inv.hash) != nullptr;
+    }
+
+    assert(recentRejects && recentlyHave);
+    if (chainActive.Tip()->GetBlockHash() != hashRecentRejectsChainTip) {
+        // If the chain tip has changed previously rejected transactions
+        // might be now valid, e.g. due to a nLockTime'd tx becoming valid,
+        // or a double-spend. Reset the rejects filter and give those
+        // txs a second chance. The items seen might have been dropped as well.
+        hashRecentRejectsChainTip = chainActive.Tip()->GetBlockHash();
+        recentRejects->reset();
+        recentlyHave->reset();
+        nRecentlyHaveResetTime = GetTime();
+    } else if (GetTime() - nRecentlyHaveResetTime >= RECENTLY_HAVE_MAX_AGE) {
+        recentlyHave->reset();
+        nRecentlyHaveResetTime = GetTime();
+    }
+
+    if (recentlyHave->contains(inv.hash)) {
+        // Count the items announced during the tier two sync, as the owner lookups do
+        switch (inv.type) {
+        case MSG_MASTERNODE_WINNER:
+            g_tiertwo_sync_state.AddedMasternodeWinner(inv.hash);
+            break;
+        case MSG_BUDGET_VOTE:
+        case MSG_BUDGET_PROPOSAL:
+        case MSG_BUDGET_FINALIZED_VOTE:
+        case MSG_BUDGET_FINALIZED:
+            g_tiertwo_sync_state.AddedBudgetItem(inv.hash);
+            break;
+        case MSG_MASTERNODE_ANNOUNCE:
+            g_tiertwo_sync_state.AddedMasternodeList(inv.hash);
+            break;
+        }
+        return true;
+    }
+
+    if (!AlreadyHaveFromOwner(inv)) {
+        return false;
+    }
+    recentlyHave->insert(inv.hash);
+    return true;
+}
+
 static void RelayTransaction(const CTransaction& tx, CConnman* connman)
 {
     CInv inv(MSG_TX, tx.GetHash());
@@ -1092,32 +1448,34 @@ void static ProcessGetBlockData(CNode* pfrom, const CInv& inv, CConnman* connman
     }
     // Don't send not-validated blocks
     if (send && (pindex->nStatus & BLOCK_HAVE_DATA)) {
-        // Send block from disk
-        CBlock block;
-        if (!ReadBlockFromDisk(block, pindex))
-            assert(!"cannot load block from disk");
-        if (inv.type == MSG_BLOCK)
-            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, block));
-        else // MSG_FILTERED_BLOCK)
+        // The peer is not going to have the transactions of old blocks in its mempool
+        const bool fCmpctBlock = inv.type == MSG_CMPCT_BLOCK && chainActive.Height() - pindex->nHeight <= MAX_CMPCTBLOCK_DEPTH;
+        if (inv.type == MSG_BLOCK || (inv.type == MSG_CMPCT_BLOCK && !fCmpctBlock)) {
+            // Send the shared serialized block
+            CSerializedNetMsg msg;
+            msg.command = NetMsgType::BLOCK;
+            msg.shared_data = GetSharedBlockPayload(pindex);
+            connman->PushMessage(pfrom, std::move(msg));
+        } else if (fCmpctBlock) {
+            // Send block from disk
+            CBlock block;
+            if (!ReadBlockFromDisk(block, pindex))
+                assert(!"cannot load block from disk");
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::CMPCTBLOCK, CBlockHeaderAndShortTxIDs(block)));
+        } else // MSG_FILTERED_BLOCK)
         {
-            bool send_ = false;
-            CMerkleBlock merkleBlock;
-            {
-                LOCK(pfrom->cs_filter);
-                if (pfrom->pfilter) {
-                    send_ = true;
-                    merkleBlock = CMerkleBlock(block, *pfrom->pfilter);
-                }
-            }
-            if (send_) {
-                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::MERKLEBLOCK, merkleBlock));
+            std::shared_ptr<const CFilterableBlock> fblock = GetSharedFilterableBlock(pindex);
+            std::unique_ptr<CMerkleBlock> merkleBlock = MatchFilteredBlock(pfrom, inv.hash, *fblock, connman);
+            if (merkleBlock) {
+                const CBlock& block = *fblock->block;
+                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::MERKLEBLOCK, *merkleBlock));
                 // CMerkleBlock just contains hashes, so also push any transactions in the block the client did not see
                 // This avoids hurting performance by pointlessly requiring a round-trip
                 // Note that there is currently no way for a node to request any single transactions we didn't send here -
                 // they must either disconnect and retry or request the full block.
                 // Thus, the protocol spec specified allows for us to provide duplicate txn here,
                 // however we MUST always provide at least what the remote peer needs
-                for (std::pair<unsigned int, uint256>& pair : merkleBlock.vMatchedTxn)
+                for (const std::pair<unsigned int, uint256>& pair : merkleBlock->vMatchedTxn)
                     connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::TX, *block.vtx[pair.first]));
             }
             // else
@@ -1205,7 +1563,7 @@ void static ProcessGetData(CNode* pfrom, CConnman* connman, const std::atomic<bo
 
     if (it != pfrom->vRecvGetData.end() && !pfrom->fPauseSend) {
         const CInv &inv = *it;
-        if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK) {
+        if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK || inv.type == MSG_CMPCT_BLOCK) {
             it++;
             ProcessGetBlockData(pfrom, inv, connman, interruptMsgProc);
         }
@@ -1225,7 +1583,413 @@ void static ProcessGetData(CNode* pfrom, CConnman* connman, const std::atomic<bo
     }
 }
 
+// Process a block received (in full or as a compact block) from a peer, whose parent we know
+static void ProcessReceivedBlock(CNode* pfrom, const std::shared_ptr<const CBlock>& pblock)
+{
+    const uint256& hashBlock = pblock->GetHash();
+    pfrom->AddInventoryKnown(CInv(MSG_BLOCK, hashBlock));
+    if (!LookupBlockIndexShared(hashBlock)) {
+        {
+            LOCK(cs_main);
+            MarkBlockAsReceived(hashBlock, pfrom->GetId());
+            mapBlockSource.emplace(hashBlock, pfrom->GetId());
+        }
+        ProcessNewBlock(pblock, nullptr);
+
+        // Disconnect node if its running an old protocol version,
+        // used during upgrades, when the node is already connected.
+        pfrom->DisconnectOldProtocol(pfrom->nVersion, ActiveProtocol());
+    } else {
+        LogPrint(BCLog::NET, "%s : Already processed block %s, skipping ProcessNewBlock()\n", __func__, hashBlock.GetHex());
+    }
+}
+
+// Check the header, the work and, for PoS blocks, the stake of a compact block whose parent we know,
+// before spending any time reconstructing it
+static bool CheckCompactBlockHeader(CNode* pfrom, const CBlockHeaderAndShortTxIDs& cmpctblock, CBlockIndex* pindexPrev) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    AssertLockHeld(cs_main);
+    const CBlock block = cmpctblock.GetHeaderBlock();
+    if (!CheckWork(block, pindexPrev)) {
+        Misbehaving(pfrom->GetId(), 100, "compact block with incorrect work");
+        return false;
+    }
+    if (block.IsProofOfWork() && !CheckProofOfWork(block.GetHash(), block.nBits)) {
+        Misbehaving(pfrom->GetId(), 50, "compact block proof of work failed");
+        return false;
+    }
+    if (block.IsProofOfStake()) {
+        std::string strError;
+        if (!CheckProofOfStake(block, strError, pindexPrev)) {
+            Misbehaving(pfrom->GetId(), 100, strprintf("compact block proof of stake check failed (%s)", strError));
+            return false;
+        }
+    }
+    CValidationState state;
+    if (!ContextualCheckBlockHeader(block, state, pindexPrev)) {
+        int nDoS = 0;
+        if (state.IsInvalid(nDoS) && nDoS > 0) {
+            Misbehaving(pfrom->GetId(), nDoS, "invalid compact block header: " + FormatStateMessage(state));
+        }
+        return false;
+    }
+    return true;
+}
+
+// Complete the compact block with the missing txes (from a blocktxn, or none) and process it.
+// If it can't be reconstructed (short ids collision), request the full block.
+static void FillAndProcessCompactBlock(CNode* pfrom, PartiallyDownloadedBlock& partialBlock, const std::vector<CTransactionRef>& vtx_missing, CConnman* connman)
+{
+    const uint256& hashBlock = partialBlock.header.GetHash();
+    std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+    ReadStatus status = partialBlock.FillBlock(*pblock, vtx_missing);
+    if (status == READ_STATUS_INVALID) {
+        LOCK(cs_main);
+        Misbehaving(pfrom->GetId(), 100, "invalid compact block or blocktxn");
+        return;
+    }
+    if (status == READ_STATUS_FAILED) {
+        CNetMsgMaker msgMaker(pfrom->GetSendVersion());
+        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETDATA, std::vector<CInv>{CInv(MSG_BLOCK, hashBlock)}));
+        return;
+    }
+    ProcessReceivedBlock(pfrom, pblock);
+}
+
+// Answer a copy of a recent block message (same block and same payload) with the outcome of the first one.
+// Returns false if the message must be processed.
+static bool ProcessRecentBlockCopy(CNode* pfrom, const uint256& hashBlock, uint64_t nPayloadHash) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    RecentBlock recent;
+    if (!recentBlocks.get(hashBlock, recent) || recent.nPayloadHash != nPayloadHash) {
+        return false;
+    }
+    if (recent.status == RecentBlockStatus::INVALID) {
+        LogPrint(BCLog::NET, "%s : Copy of invalid block %s (%s) from peer=%d\n", __func__, hashBlock.GetHex(), recent.strRejectReason, pfrom->GetId());
+        Misbehaving(pfrom->GetId(), recent.nDoS, recent.strRejectReason);
+    } else {
+        pfrom->AddInventoryKnown(CInv(MSG_BLOCK, hashBlock));
+        LogPrint(BCLog::NET, "%s : Copy of block %s already %s, skipping ProcessNewBlock()\n", __func__, hashBlock.GetHex(),
+                 recent.status == RecentBlockStatus::VALID ? "processed" : "in progress");
+    }
+    return true;
+}
+
+// The outcome of a block message, once processed. The invalid ones are recorded by BlockChecked.
+static void FinishRecentBlock(const uint256& hashBlock) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    RecentBlock recent;
+    if (!recentBlocks.get(hashBlock, recent) || recent.status != RecentBlockStatus::IN_PROGRESS) {
+        return;
+    }
+    if (LookupBlockIndex(hashBlock)) {
+        recent.status = RecentBlockStatus::VALID;
+        recentBlocks.insert(hashBlock, recent);
+    } else {
+        recentBlocks.erase(hashBlock);
+    }
+}
+
 bool fRequestedSporksIDB = false;
+// Process a message of the tier two message types (getTierTwoNetMessageTypes), which only needs the tier two managers
+static bool ProcessTierTwoMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv, CConnman* connman)
+{
+    // Check if the dispatcher can process this message first. If not, try going with the old flow.
+    if (!masternodeSync.MessageDispatcher(pfrom, strCommand, vRecv)) {
+        // Probably one the extensions, future: encapsulate all of this inside tiertwo_networksync.
+        int dosScore{0};
+        if (!mnodeman.ProcessMessage(pfrom, strCommand, vRecv, dosScore)) {
+            WITH_LOCK(cs_main, Misbehaving(pfrom->GetId(), dosScore));
+            return false;
+        }
+        if (!g_budgetman.ProcessMessage(pfrom, strCommand, vRecv, dosScore)) {
+            WITH_LOCK(cs_main, Misbehaving(pfrom->GetId(), dosScore));
+            return false;
+        }
+        CValidationState state_payments;
+        if (!masternodePayments.ProcessMessageMasternodePayments(pfrom, strCommand, vRecv, state_payments)) {
+            if (state_payments.IsInvalid(dosScore)) {
+                WITH_LOCK(cs_main, Misbehaving(pfrom->GetId(), dosScore));
+            }
+            return false;
+        }
+        if (!sporkManager.ProcessSpork(pfrom, strCommand, vRecv, dosScore)) {
+            WITH_LOCK(cs_main, Misbehaving(pfrom->GetId(), dosScore));
+            return false;
+        }
+
+        CValidationState mnauthState;
+        if (!CMNAuth::ProcessMessage(pfrom, strCommand, vRecv, *connman, mnauthState)) {
+            int dosScore{0};
+            if (mnauthState.IsInvalid(dosScore) && dosScore > 0) {
+                LOCK(cs_main);
+                Misbehaving(pfrom->GetId(), dosScore, mnauthState.GetRejectReason());
+            }
+        }
+    }
+    return true;
+}
+
+// Reprocesses up to MAX_ORPHANS_PROCESSED_PER_RUN orphans of the work set, adding their own orphans to it once accepted
+static void ProcessOrphanTx(CConnman* connman, std::set<uint256>& orphanWorkSet) EXCLUSIVE_LOCKS_REQUIRED(cs_main, g_cs_orphans)
+{
+    std::set<NodeId> setMisbehaving;
+    unsigned int nProcessed = 0;
+    while (!orphanWorkSet.empty() && nProcessed < MAX_ORPHANS_PROCESSED_PER_RUN) {
+        const uint256 orphanHash = *orphanWorkSet.begin();
+        orphanWorkSet.erase(orphanWorkSet.begin());
+        auto itOrphan = mapOrphanTransactions.find(orphanHash);
+        if (itOrphan == mapOrphanTransactions.end())
+            continue;
+        nProcessed++;
+
+        const CTransactionRef orphanTx = itOrphan->second.tx;
+        NodeId fromPeer = itOrphan->second.fromPeer;
+        bool fMissingInputs2 = false;
+        // Use a dummy CValidationState so someone can't setup nodes to counter-DoS based on orphan
+        // resolution (that is, feeding people an invalid transaction based on LegitTxX in order to get
+        // anyone relaying LegitTxX banned)
+        CValidationState stateDummy;
+
+        if (setMisbehaving.count(fromPeer))
+            continue;
+        if (AcceptToMemoryPool(mempool, stateDummy, orphanTx, true, &fMissingInputs2)) {
+            LogPrint(BCLog::MEMPOOL, "   accepted orphan tx %s\n", orphanHash.ToString());
+            RelayTransaction(*orphanTx, connman);
+            AddChildrenToWorkSet(*orphanTx, orphanWorkSet);
+            EraseOrphanTx(orphanHash);
+        } else if (!fMissingInputs2) {
+            int nDos = 0;
+            if (stateDummy.IsInvalid(nDos) && nDos > 0) {
+                // Punish peer that gave us an invalid orphan tx
+                Misbehaving(fromPeer, nDos);
+                setMisbehaving.insert(fromPeer);
+                LogPrint(BCLog::MEMPOOL, "   invalid orphan tx %s\n", orphanHash.ToString());
+            }
+            // Has inputs but not accepted to mempool
+            // Probably non-standard or insufficient fee
+            LogPrint(BCLog::MEMPOOL, "   removed orphan tx %s\n", orphanHash.ToString());
+            EraseOrphanTx(orphanHash);
+            assert(recentRejects);
+            recentRejects->insert(orphanHash);
+        }
+        mempool.check(pcoinsTip.get());
+    }
+}
+
+// Announce with invs the txes that the peer is missing after a reconciliation (skipping the ones no longer in the mempool)
+static void AnnounceReconciledTxes(CNode* pto, const std::vector<uint256>& vTxid, CConnman* connman)
+{
+    CNetMsgMaker msgMaker(pto->GetSendVersion());
+    std::vector<CInv> vInv;
+    for (const uint256& txid : vTxid) {
+        if (!mempool.exists(txid)) continue;
+        vInv.emplace_back(MSG_TX, txid);
+        if (vInv.size() == MAX_INV_SZ) {
+            connman->PushMessage(pto, msgMaker.Make(NetMsgType::INV, vInv));
+            vInv.clear();
+        }
+    }
+    if (!vInv.empty())
+        connman->PushMessage(pto, msgMaker.Make(NetMsgType::INV, vInv));
+}
+
+// Queue the message for the tier two messages threads. Returns false if they are not running.
+static bool QueueTierTwoMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv);
+
+/**
+ * Validation logic for compact filters request handling.
+ *
+ * May disconnect from the peer in the case of a bad request.
+ *
+ * @param[in]   pfrom           The peer that we received the request from
+ * @param[in]   filter_type     The filter type the request is for. Must be basic filters.
+ * @param[in]   start_height    The start height for the request
+ * @param[in]   stop_hash       The stop_hash for the request
+ * @param[in]   max_height_diff The maximum number of items permitted to request, as specified in BIP 157
+ * @param[out]  stop_index      The CBlockIndex for the stop_hash block, if the request can be serviced.
+ * @param[out]  filter_index    The filter index, if the request can be serviced.
+ * @return                      True if the request can be serviced.
+ */
+static bool PrepareBlockFilterRequest(CNode* pfrom, BlockFilterType filter_type, uint32_t start_height,
+                                      const uint256& stop_hash, uint32_t max_height_diff,
+                                      const CBlockIndex*& stop_index, BlockFilterIndex*& filter_index)
+{
+    const bool supported_filter_type =
+        (filter_type == BlockFilterType::BASIC_FILTER &&
+         (pfrom->GetLocalServices() & NODE_COMPACT_FILTERS));
+    if (!supported_filter_type) {
+        LogPrint(BCLog::NET, "peer %d requested unsupported block filter type: %d\n",
+                 pfrom->GetId(), static_cast<uint8_t>(filter_type));
+        pfrom->fDisconnect = true;
+        return false;
+    }
+
+    {
+        LOCK(cs_main);
+        stop_index = LookupBlockIndex(stop_hash);
+
+        // Check that the stop block exists and the peer would be allowed to fetch it
+        // (same rules of ProcessGetBlockData for the blocks outside of the active chain).
+        if (!stop_index || !(chainActive.Contains(stop_index) ||
+                (stop_index->IsValid(BLOCK_VALID_SCRIPTS) && pindexBestHeader &&
+                 chainActive.Height() - stop_index->nHeight < gArgs.GetArg("-maxreorg", DEFAULT_MAX_REORG_DEPTH)))) {
+            LogPrint(BCLog::NET, "peer %d requested invalid block hash: %s\n",
+                     pfrom->GetId(), stop_hash.ToString());
+            pfrom->fDisconnect = true;
+            return false;
+        }
+    }
+
+    uint32_t stop_height = stop_index->nHeight;
+    if (start_height > stop_height) {
+        LogPrint(BCLog::NET, "peer %d sent invalid getcfilters/getcfheaders with " /* Continued */
+                 "start height %d and stop height %d\n",
+                 pfrom->GetId(), start_height, stop_height);
+        pfrom->fDisconnect = true;
+        return false;
+    }
+    if (stop_height - start_height >= max_height_diff) {
+        LogPrint(BCLog::NET, "peer %d requested too many cfilters/cfheaders: %d / %d\n",
+                 pfrom->GetId(), stop_height - start_height + 1, max_height_diff);
+        pfrom->fDisconnect = true;
+        return false;
+    }
+
+    filter_index = GetBlockFilterIndex(filter_type);
+    if (!filter_index) {
+        LogPrint(BCLog::NET, "Filter index for supported type %s not found\n", BlockFilterTypeName(filter_type));
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Handle a cfilters request.
+ *
+ * May disconnect from the peer in the case of a bad request.
+ */
+static void ProcessGetCFilters(CNode* pfrom, CDataStream& vRecv, CConnman* connman)
+{
+    uint8_t filter_type_ser;
+    uint32_t start_height;
+    uint256 stop_hash;
+
+    vRecv >> filter_type_ser >> start_height >> stop_hash;
+
+    const BlockFilterType filter_type = static_cast<BlockFilterType>(filter_type_ser);
+
+    const CBlockIndex* stop_index;
+    BlockFilterIndex* filter_index;
+    if (!PrepareBlockFilterRequest(pfrom, filter_type, start_height, stop_hash,
+                                   MAX_GETCFILTERS_SIZE, stop_index, filter_index)) {
+        return;
+    }
+
+    std::vector<BlockFilter> filters;
+    if (!filter_index->LookupFilterRange(start_height, stop_index, filters)) {
+        LogPrint(BCLog::NET, "Failed to find block filter in index: filter_type=%s, start_height=%d, stop_hash=%s\n",
+                 BlockFilterTypeName(filter_type), start_height, stop_hash.ToString());
+        return;
+    }
+
+    CNetMsgMaker msgMaker(pfrom->GetSendVersion());
+    for (const auto& filter : filters) {
+        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::CFILTER, filter));
+    }
+}
+
+/**
+ * Handle a cfheaders request.
+ *
+ * May disconnect from the peer in the case of a bad request.
+ */
+static void ProcessGetCFHeaders(CNode* pfrom, CDataStream& vRecv, CConnman* connman)
+{
+    uint8_t filter_type_ser;
+    uint32_t start_height;
+    uint256 stop_hash;
+
+    vRecv >> filter_type_ser >> start_height >> stop_hash;
+
+    const BlockFilterType filter_type = static_cast<BlockFilterType>(filter_type_ser);
+
+    const CBlockIndex* stop_index;
+    BlockFilterIndex* filter_index;
+    if (!PrepareBlockFilterRequest(pfrom, filter_type, start_height, stop_hash,
+                                   MAX_GETCFHEADERS_SIZE, stop_index, filter_index)) {
+        return;
+    }
+
+    uint256 prev_header;
+    if (start_height > 0) {
+        const CBlockIndex* const prev_block =
+            stop_index->GetAncestor(static_cast<int>(start_height - 1));
+        if (!filter_index->LookupFilterHeader(prev_block, prev_header)) {
+            LogPrint(BCLog::NET, "Failed to find block filter header in index: filter_type=%s, block_hash=%s\n",
+                     BlockFilterTypeName(filter_type), prev_block->GetBlockHash().ToString());
+            return;
+        }
+    }
+
+    std::vector<uint256> filter_hashes;
+    if (!filter_index->LookupFilterHashRange(start_height, stop_index, filter_hashes)) {
+        LogPrint(BCLog::NET, "Failed to find block filter hashes in index: filter_type=%s, start_height=%d, stop_hash=%s\n",
+                 BlockFilterTypeName(filter_type), start_height, stop_hash.ToString());
+        return;
+    }
+
+    connman->PushMessage(pfrom, CNetMsgMaker(pfrom->GetSendVersion()).Make(NetMsgType::CFHEADERS,
+                                                                           filter_type_ser,
+                                                                           stop_index->GetBlockHash(),
+                                                                           prev_header,
+                                                                           filter_hashes));
+}
+
+/**
+ * Handle a getcfcheckpt request.
+ *
+ * May disconnect from the peer in the case of a bad request.
+ */
+static void ProcessGetCFCheckPt(CNode* pfrom, CDataStream& vRecv, CConnman* connman)
+{
+    uint8_t filter_type_ser;
+    uint256 stop_hash;
+
+    vRecv >> filter_type_ser >> stop_hash;
+
+    const BlockFilterType filter_type = static_cast<BlockFilterType>(filter_type_ser);
+
+    const CBlockIndex* stop_index;
+    BlockFilterIndex* filter_index;
+    if (!PrepareBlockFilterRequest(pfrom, filter_type, /*start_height=*/0, stop_hash,
+                                   /*max_height_diff=*/std::numeric_limits<uint32_t>::max(),
+                                   stop_index, filter_index)) {
+        return;
+    }
+
+    std::vector<uint256> headers(stop_index->nHeight / CFCHECKPT_INTERVAL);
+
+    // Populate headers.
+    const CBlockIndex* block_index = stop_index;
+    for (int i = headers.size() - 1; i >= 0; i--) {
+        int height = (i + 1) * CFCHECKPT_INTERVAL;
+        block_index = block_index->GetAncestor(height);
+
+        if (!filter_index->LookupFilterHeader(block_index, headers[i])) {
+            LogPrint(BCLog::NET, "Failed to find block filter header in index: filter_type=%s, block_hash=%s\n",
+                     BlockFilterTypeName(filter_type), block_index->GetBlockHash().ToString());
+            return;
+        }
+    }
+
+    connman->PushMessage(pfrom, CNetMsgMaker(pfrom->GetSendVersion()).Make(NetMsgType::CFCHECKPT,
+                                                                           filter_type_ser,
+                                                                           stop_index->GetBlockHash(),
+                                                                           headers));
+}
+
 bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vRecv, int64_t nTimeReceived, CConnman* connman, std::atomic<bool>& interruptMsgProc)
 {
     LogPrint(BCLog::NET, "received: %s (%u bytes) peer=%d\n", SanitizeString(strCommand), vRecv.size(), pfrom->GetId());
@@ -1447,6 +2211,18 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
             CMNAuth::PushMNAUTH(pfrom, *connman);
         }
 
+        if (pfrom->nVersion >= SHORT_IDS_BLOCKS_VERSION) {
+            // Tell our peer we can provide (and reconstruct) compact blocks, only on request (low-bandwidth mode)
+            connman->PushMessage(pfrom, CNetMsgMaker(pfrom->GetSendVersion()).Make(NetMsgType::SENDCMPCT, false, CMPCTBLOCKS_VERSION));
+        }
+
+        if (txReconciliation && pfrom->nVersion >= TXRECONCILIATION_VERSION && !pfrom->m_masternode_probe_connection &&
+            WITH_LOCK(pfrom->cs_filter, return pfrom->fRelayTxes; )) {
+            // Offer to reconcile the transactions that we announce to each other
+            const uint64_t salt = txReconciliation->PreRegisterPeer(pfrom->GetId());
+            connman->PushMessage(pfrom, CNetMsgMaker(pfrom->GetSendVersion()).Make(NetMsgType::SENDTXRCNCL, TXRECONCILIATION_PROTO_VERSION, salt));
+        }
+
         pfrom->fSuccessfullyConnected = true;
         LogPrintf("New outbound peer connected: version: %d, blocks=%d, peer=%d%s\n",
                   pfrom->nVersion.load(), pfrom->nStartingHeight, pfrom->GetId(),
@@ -1467,6 +2243,73 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
         return false;
     }
 
+    else if (strCommand == NetMsgType::SENDCMPCT) {
+        bool fAnnounceUsingCMPCTBLOCK = false;
+        uint64_t nCMPCTBLOCKVersion = 0;
+        vRecv >> fAnnounceUsingCMPCTBLOCK >> nCMPCTBLOCKVersion;
+        if (nCMPCTBLOCKVersion == CMPCTBLOCKS_VERSION) {
+            LOCK(cs_main);
+            State(pfrom->GetId())->fProvidesHeaderAndIDs = true;
+        }
+        return true;
+    }
+
+    else if (strCommand == NetMsgType::SENDTXRCNCL) {
+        uint32_t nReconVersion = 0;
+        uint64_t remoteSalt = 0;
+        vRecv >> nReconVersion >> remoteSalt;
+        // We didn't offer it, or an unsupported version: keep flooding the transactions to this peer
+        if (txReconciliation && txReconciliation->RegisterPeer(pfrom->GetId(), pfrom->fInbound, nReconVersion, remoteSalt)) {
+            LogPrint(BCLog::NET, "transactions reconciliation with peer=%d (%s)\n", pfrom->GetId(), pfrom->fInbound ? "responder" : "initiator");
+        }
+        return true;
+    }
+
+    else if (strCommand == NetMsgType::REQTXRCNCL) {
+        uint16_t nRemoteSetSize = 0;
+        vRecv >> nRemoteSetSize;
+        std::vector<uint32_t> vSketch;
+        if (!txReconciliation || !txReconciliation->HandleReconciliationRequest(pfrom->GetId(), nRemoteSetSize, vSketch)) {
+            LOCK(cs_main);
+            Misbehaving(pfrom->GetId(), 10, "unexpected reqtxrcncl");
+            return false;
+        }
+        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SKETCH, vSketch));
+        return true;
+    }
+
+    else if (strCommand == NetMsgType::SKETCH) {
+        std::vector<uint32_t> vSketch;
+        vRecv >> vSketch;
+        bool fSuccess = false;
+        std::vector<uint256> vAnnounce;
+        std::vector<uint32_t> vRequested;
+        if (!txReconciliation || !txReconciliation->HandleSketch(pfrom->GetId(), vSketch, fSuccess, vAnnounce, vRequested)) {
+            LOCK(cs_main);
+            Misbehaving(pfrom->GetId(), 10, "unexpected sketch");
+            return false;
+        }
+        LogPrint(BCLog::NET, "reconciliation with peer=%d %s: %d txes to announce, %d requested\n", pfrom->GetId(),
+                 fSuccess ? "succeeded" : "failed", vAnnounce.size(), vRequested.size());
+        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::RECONCILDIFF, fSuccess, vRequested));
+        AnnounceReconciledTxes(pfrom, vAnnounce, connman);
+        return true;
+    }
+
+    else if (strCommand == NetMsgType::RECONCILDIFF) {
+        bool fSuccess = false;
+        std::vector<uint32_t> vRequested;
+        vRecv >> fSuccess >> vRequested;
+        std::vector<uint256> vAnnounce;
+        if (!txReconciliation || !txReconciliation->HandleReconciliationDiff(pfrom->GetId(), fSuccess, vRequested, vAnnounce)) {
+            LOCK(cs_main);
+            Misbehaving(pfrom->GetId(), 10, "unexpected reconcildiff");
+            return false;
+        }
+        AnnounceReconciledTxes(pfrom, vAnnounce, connman);
+        return true;
+    }
+
     else if (strCommand == NetMsgType::QSENDRECSIGS) {
         bool b;
         vRecv >> b;
@@ -1606,6 +2449,9 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
             }
 
             pfrom->AddInventoryKnown(inv);
+            if (inv.type == MSG_TX && txReconciliation) {
+                txReconciliation->TryRemovingFromSet(pfrom->GetId(), inv.hash);
+            }
 
             bool fAlreadyHave = AlreadyHave(inv);
             LogPrint(BCLog::NET, "got inv: %s  %s peer=%d\n", inv.ToString(), fAlreadyHave ? "have" : "new", pfrom->GetId());
@@ -1613,8 +2459,10 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
             if (inv.type == MSG_BLOCK) {
                 UpdateBlockAvailability(pfrom->GetId(), inv.hash);
                 if (!fAlreadyHave && !fImporting && !fReindex && !mapBlocksInFlight.count(inv.hash)) {
-                    // Add this to the list of blocks to request
-                    vToFetch.push_back(inv);
+                    // Add this to the list of blocks to request. New blocks are requested as compact blocks, when the
+                    // peer can provide them, as their txes are most likely already in our mempool.
+                    const bool fCompact = State(pfrom->GetId())->fProvidesHeaderAndIDs && !IsInitialBlockDownload();
+                    vToFetch.emplace_back(fCompact ? MSG_CMPCT_BLOCK : MSG_BLOCK, inv.hash);
                     LogPrint(BCLog::NET, "getblocks (%d) %s to peer=%d\n", pindexBestHeader->nHeight, inv.hash.ToString(), pfrom->GetId());
                 }
             } else {
@@ -1768,13 +2616,14 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
 
 
     else if (strCommand == NetMsgType::TX) {
-        std::deque<COutPoint> vWorkQueue;
-        std::vector<uint256> vEraseQueue;
         CTransaction tx(deserialize, vRecv);
         CTransactionRef ptx = MakeTransactionRef(tx);
 
         CInv inv(MSG_TX, tx.GetHash());
         pfrom->AddInventoryKnown(inv);
+        if (txReconciliation) {
+            txReconciliation->TryRemovingFromSet(pfrom->GetId(), inv.hash);
+        }
 
         LOCK2(cs_main, g_cs_orphans);
 
@@ -1794,63 +2643,16 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
         if (AcceptToMemoryPool(mempool, state, ptx, true, &fMissingInputs, false, ignoreFees)) {
             mempool.check(pcoinsTip.get());
             RelayTransaction(tx, connman);
-            for (unsigned int i = 0; i < tx.vout.size(); i++) {
-                vWorkQueue.emplace_back(inv.hash, i);
-            }
 
             LogPrint(BCLog::MEMPOOL, "%s : peer=%d %s : accepted %s (poolsz %u txn, %u kB)\n",
                     __func__, pfrom->GetId(), pfrom->cleanSubVer, tx.GetHash().ToString(),
                     mempool.size(), mempool.DynamicMemoryUsage() / 1000);
 
-            // Recursively process any orphan transactions that depended on this one
-            std::set<NodeId> setMisbehaving;
-            while (!vWorkQueue.empty()) {
-                auto itByPrev = mapOrphanTransactionsByPrev.find(vWorkQueue.front());
-                vWorkQueue.pop_front();
-                if(itByPrev == mapOrphanTransactionsByPrev.end())
-                    continue;
-                for (auto mi = itByPrev->second.begin();
-                    mi != itByPrev->second.end();
-                    ++mi) {
-                    const CTransactionRef& orphanTx = (*mi)->second.tx;
-                    const uint256& orphanHash = orphanTx->GetHash();
-                    NodeId fromPeer = (*mi)->second.fromPeer;
-                    bool fMissingInputs2 = false;
-                    // Use a dummy CValidationState so someone can't setup nodes to counter-DoS based on orphan
-                    // resolution (that is, feeding people an invalid transaction based on LegitTxX in order to get
-                    // anyone relaying LegitTxX banned)
-                    CValidationState stateDummy;
-
-
-                    if (setMisbehaving.count(fromPeer))
-                        continue;
-                    if (AcceptToMemoryPool(mempool, stateDummy, orphanTx, true, &fMissingInputs2)) {
-                        LogPrint(BCLog::MEMPOOL, "   accepted orphan tx %s\n", orphanHash.ToString());
-                        RelayTransaction(*orphanTx, connman);
-                        for (unsigned int i = 0; i < orphanTx->vout.size(); i++) {
-                            vWorkQueue.emplace_back(orphanHash, i);
-                        }
-                        vEraseQueue.push_back(orphanHash);
-                    } else if (!fMissingInputs2) {
-                        int nDos = 0;
-                        if(stateDummy.IsInvalid(nDos) && nDos > 0) {
-                            // Punish peer that gave us an invalid orphan tx
-                            Misbehaving(fromPeer, nDos);
-                            setMisbehaving.insert(fromPeer);
-                            LogPrint(BCLog::MEMPOOL, "   invalid orphan tx %s\n", orphanHash.ToString());
-                        }
-                        // Has inputs but not accepted to mempool
-                        // Probably non-standard or insufficient fee
-                        LogPrint(BCLog::MEMPOOL, "   removed orphan tx %s\n", orphanHash.ToString());
-                        vEraseQueue.push_back(orphanHash);
-                        assert(recentRejects);
-                        recentRejects->insert(orphanHash);
-                    }
-                    mempool.check(pcoinsTip.get());
-                }
-            }
-
-            for (uint256& hash : vEraseQueue) EraseOrphanTx(hash);
+            // Process the orphan transactions that depended on this one: a first batch now, the next ones
+            // between the next messages of this peer (ProcessMessages)
+            std::set<uint256>& orphanWorkSet = mapOrphansByPeer[pfrom->GetId()].workSet;
+            AddChildrenToWorkSet(tx, orphanWorkSet);
+            ProcessOrphanTx(connman, orphanWorkSet);
 
         } else if (fMissingInputs) {
             bool fRejectedParents = false; // It may be the case that the orphans parents have all been rejected
@@ -1935,36 +2737,28 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
             ReadCompactSize(vRecv); // ignore tx count; assume it is 0.
         }
 
-        LOCK(cs_main);
-
         if (nCount == 0) {
             // Nothing interesting. Stop asking this peers for more headers.
             return true;
         }
-        CBlockIndex* pindexLast = nullptr;
-        for (const CBlockHeader& header : headers) {
-            CValidationState state;
-            if (pindexLast && header.hashPrevBlock != pindexLast->GetBlockHash()) {
-                Misbehaving(pfrom->GetId(), 20, "non-continuous headers sequence");
-                return false;
-            }
 
-            /*TODO: this has a CBlock cast on it so that it will compile. There should be a solution for this
-             * before headers are reimplemented on mainnet
-             */
-            if (!AcceptBlockHeader((CBlock)header, state, &pindexLast)) {
-                int nDoS;
-                if (state.IsInvalid(nDoS)) {
-                    if (nDoS > 0) {
-                        Misbehaving(pfrom->GetId(), nDoS, "invalid header received");
-                    } else {
-                        LogPrint(BCLog::NET, "peer=%d: invalid header received\n", pfrom->GetId());
-                    }
-                    return false;
+        // The headers are hashed in parallel, out of cs_main
+        CBlockIndex* pindexLast = nullptr;
+        CValidationState state;
+        if (!ProcessNewBlockHeaders(headers, state, &pindexLast)) {
+            int nDoS;
+            if (state.IsInvalid(nDoS)) {
+                LOCK(cs_main);
+                if (nDoS > 0) {
+                    Misbehaving(pfrom->GetId(), nDoS, "invalid header received");
+                } else {
+                    LogPrint(BCLog::NET, "peer=%d: invalid header received\n", pfrom->GetId());
                 }
+                return false;
             }
         }
 
+        LOCK(cs_main);
         if (pindexLast)
             UpdateBlockAvailability(pfrom->GetId(), pindexLast->GetBlockHash());
 
@@ -1979,14 +2773,34 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
 
     else if (strCommand == NetMsgType::BLOCK && !fImporting && !fReindex) // Ignore blocks received while importing
     {
-        std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-        vRecv >> *pblock;
-        const uint256& hashBlock = pblock->GetHash();
+        // Read the header ahead, so that the copies of the known and of the recent blocks are answered
+        // without deserializing the whole block
+        const size_t nMessageSize = vRecv.size();
+        CBlockHeader header;
+        vRecv >> header;
+        if (!vRecv.Rewind(nMessageSize - vRecv.size())) {
+            // Header only message
+            throw std::ios_base::failure("block message: end of data");
+        }
+        const uint256 hashBlock = header.GetHash();
         CInv inv(MSG_BLOCK, hashBlock);
         LogPrint(BCLog::NET, "received block %s peer=%d\n", inv.hash.ToString(), pfrom->GetId());
 
+        if (LookupBlockIndexShared(hashBlock)) {
+            pfrom->AddInventoryKnown(inv);
+            LogPrint(BCLog::NET, "%s : Already processed block %s, skipping ProcessNewBlock()\n", __func__, hashBlock.GetHex());
+            return true;
+        }
+        const uint64_t nPayloadHash = CSipHasher(StaticSaltedHasher::s.k0, StaticSaltedHasher::s.k1).Write((const unsigned char*)vRecv.data(), vRecv.size()).Finalize();
+        if (WITH_LOCK(cs_main, return ProcessRecentBlockCopy(pfrom, hashBlock, nPayloadHash))) {
+            return true;
+        }
+
+        std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+        vRecv >> *pblock;
+
         // sometimes we will be sent their most recent block and its not the one we want, in that case tell where we are
-        if (!mapBlockIndex.count(pblock->hashPrevBlock)) {
+        if (!LookupBlockIndexShared(pblock->hashPrevBlock)) {
             CBlockLocator locator = WITH_LOCK(cs_main, return chainActive.GetLocator(););
             if (find(pfrom->vBlockRequested.begin(), pfrom->vBlockRequested.end(), hashBlock) != pfrom->vBlockRequested.end()) {
                 // we already asked for this block, so lets work backwards and ask for the previous block
@@ -1998,22 +2812,128 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
                 pfrom->vBlockRequested.emplace_back(hashBlock);
             }
         } else {
-            pfrom->AddInventoryKnown(inv);
-            if (!mapBlockIndex.count(hashBlock)) {
-                {
-                    LOCK(cs_main);
-                    MarkBlockAsReceived(hashBlock);
-                    mapBlockSource.emplace(hashBlock, pfrom->GetId());
-                }
-                ProcessNewBlock(pblock, nullptr);
+            {
+                LOCK(cs_main);
+                RecentBlock recent;
+                recent.nPayloadHash = nPayloadHash;
+                recentBlocks.insert(hashBlock, recent);
+            }
+            ProcessReceivedBlock(pfrom, pblock);
+            WITH_LOCK(cs_main, FinishRecentBlock(hashBlock));
+        }
+    }
 
-                // Disconnect node if its running an old protocol version,
-                // used during upgrades, when the node is already connected.
-                pfrom->DisconnectOldProtocol(pfrom->nVersion, ActiveProtocol());
-            } else {
-                LogPrint(BCLog::NET, "%s : Already processed block %s, skipping ProcessNewBlock()\n", __func__, pblock->GetHash().GetHex());
+    else if (strCommand == NetMsgType::CMPCTBLOCK && !fImporting && !fReindex) // Ignore blocks received while importing
+    {
+        CBlockHeaderAndShortTxIDs cmpctblock;
+        vRecv >> cmpctblock;
+        const uint256& hashBlock = cmpctblock.header.GetHash();
+        LogPrint(BCLog::NET, "received cmpctblock %s peer=%d\n", hashBlock.ToString(), pfrom->GetId());
+
+        bool fHavePrev;
+        {
+            LOCK(cs_main);
+            CBlockIndex* pindex = LookupBlockIndex(hashBlock);
+            if (pindex && (pindex->nStatus & BLOCK_HAVE_DATA)) {
+                MarkBlockAsReceived(hashBlock);
+                return true;
+            }
+            CBlockIndex* pindexPrev = LookupBlockIndex(cmpctblock.header.hashPrevBlock);
+            fHavePrev = pindexPrev != nullptr;
+            if (fHavePrev && !CheckCompactBlockHeader(pfrom, cmpctblock, pindexPrev)) {
+                return true;
             }
         }
+
+        auto partialBlock = std::make_unique<PartiallyDownloadedBlock>(&mempool);
+        ReadStatus status = fHavePrev ? partialBlock->InitData(cmpctblock) : READ_STATUS_FAILED;
+        if (status == READ_STATUS_INVALID) {
+            LOCK(cs_main);
+            Misbehaving(pfrom->GetId(), 100, "invalid compact block");
+            return false;
+        }
+        if (status == READ_STATUS_FAILED) {
+            // Not connecting to our chain, or short ids collision: the full block goes through the usual path
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETDATA, std::vector<CInv>{CInv(MSG_BLOCK, hashBlock)}));
+            return true;
+        }
+
+        BlockTransactionsRequest req;
+        for (size_t i = 0; i < cmpctblock.BlockTxCount(); i++) {
+            if (!partialBlock->IsTxAvailable(i)) {
+                req.indexes.push_back(i);
+            }
+        }
+        if (req.indexes.empty()) {
+            // All the txes were in our mempool
+            FillAndProcessCompactBlock(pfrom, *partialBlock, {}, connman);
+        } else {
+            req.blockhash = hashBlock;
+            WITH_LOCK(cs_main, State(pfrom->GetId())->partialBlock = std::move(partialBlock));
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETBLOCKTXN, req));
+        }
+    }
+
+    else if (strCommand == NetMsgType::GETCFILTERS) {
+        ProcessGetCFilters(pfrom, vRecv, connman);
+    }
+
+    else if (strCommand == NetMsgType::GETCFHEADERS) {
+        ProcessGetCFHeaders(pfrom, vRecv, connman);
+    }
+
+    else if (strCommand == NetMsgType::GETCFCHECKPT) {
+        ProcessGetCFCheckPt(pfrom, vRecv, connman);
+    }
+
+    else if (strCommand == NetMsgType::GETBLOCKTXN) {
+        BlockTransactionsRequest req;
+        vRecv >> req;
+
+        CBlock block;
+        {
+            LOCK(cs_main);
+            CBlockIndex* pindex = LookupBlockIndex(req.blockhash);
+            if (!pindex || !(pindex->nStatus & BLOCK_HAVE_DATA) || !chainActive.Contains(pindex)) {
+                LogPrint(BCLog::NET, "Peer %d sent us a getblocktxn for a block we don't have\n", pfrom->GetId());
+                return true;
+            }
+            if (chainActive.Height() - pindex->nHeight > MAX_BLOCKTXN_DEPTH) {
+                LogPrint(BCLog::NET, "Peer %d sent us a getblocktxn for a block > %i deep\n", pfrom->GetId(), MAX_BLOCKTXN_DEPTH);
+                return true;
+            }
+            if (!ReadBlockFromDisk(block, pindex))
+                assert(!"cannot load block from disk");
+        }
+
+        BlockTransactions resp(req);
+        for (size_t i = 0; i < req.indexes.size(); i++) {
+            if (req.indexes[i] >= block.vtx.size()) {
+                LOCK(cs_main);
+                Misbehaving(pfrom->GetId(), 100, strprintf("getblocktxn with out-of-bounds tx indices"));
+                return false;
+            }
+            resp.txn[i] = block.vtx[req.indexes[i]];
+        }
+        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCKTXN, resp));
+    }
+
+    else if (strCommand == NetMsgType::BLOCKTXN && !fImporting && !fReindex) // Ignore blocks received while importing
+    {
+        BlockTransactions resp;
+        vRecv >> resp;
+
+        std::unique_ptr<PartiallyDownloadedBlock> partialBlock;
+        {
+            LOCK(cs_main);
+            CNodeState* state = State(pfrom->GetId());
+            if (!state->partialBlock || state->partialBlock->header.GetHash() != resp.blockhash) {
+                LogPrint(BCLog::NET, "Peer %d sent us block transactions for block we weren't expecting\n", pfrom->GetId());
+                return true;
+            }
+            partialBlock = std::move(state->partialBlock);
+        }
+        FillAndProcessCompactBlock(pfrom, *partialBlock, resp.txn, connman);
     }
 
     // This asymmetric behavior for inbound and outbound connections was introduced
@@ -2188,39 +3108,11 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
         // Tier two msg type search
         const std::vector<std::string>& allMessages = getTierTwoNetMessageTypes();
         if (std::find(allMessages.begin(), allMessages.end(), strCommand) != allMessages.end()) {
-            // Check if the dispatcher can process this message first. If not, try going with the old flow.
-            if (!masternodeSync.MessageDispatcher(pfrom, strCommand, vRecv)) {
-                // Probably one the extensions, future: encapsulate all of this inside tiertwo_networksync.
-                int dosScore{0};
-                if (!mnodeman.ProcessMessage(pfrom, strCommand, vRecv, dosScore)) {
-                    WITH_LOCK(cs_main, Misbehaving(pfrom->GetId(), dosScore));
-                    return false;
-                }
-                if (!g_budgetman.ProcessMessage(pfrom, strCommand, vRecv, dosScore)) {
-                    WITH_LOCK(cs_main, Misbehaving(pfrom->GetId(), dosScore));
-                    return false;
-                }
-                CValidationState state_payments;
-                if (!masternodePayments.ProcessMessageMasternodePayments(pfrom, strCommand, vRecv, state_payments)) {
-                    if (state_payments.IsInvalid(dosScore)) {
-                        WITH_LOCK(cs_main, Misbehaving(pfrom->GetId(), dosScore));
-                    }
-                    return false;
-                }
-                if (!sporkManager.ProcessSpork(pfrom, strCommand, vRecv, dosScore)) {
-                    WITH_LOCK(cs_main, Misbehaving(pfrom->GetId(), dosScore));
-                    return false;
-                }
-
-                CValidationState mnauthState;
-                if (!CMNAuth::ProcessMessage(pfrom, strCommand, vRecv, *connman, mnauthState)) {
-                    int dosScore{0};
-                    if (mnauthState.IsInvalid(dosScore) && dosScore > 0) {
-                        LOCK(cs_main);
-                        Misbehaving(pfrom->GetId(), dosScore, mnauthState.GetRejectReason());
-                    }
-                }
+            // Processed by the tier two messages threads, if they are running
+            if (QueueTierTwoMessage(pfrom, strCommand, vRecv)) {
+                return true;
             }
+            return ProcessTierTwoMessage(pfrom, strCommand, vRecv, connman);
         } else {
             // Ignore unknown commands for extensibility
             LogPrint(BCLog::NET, "Unknown command \"%s\" from peer=%d\n", SanitizeString(strCommand), pfrom->GetId());
@@ -2254,6 +3146,190 @@ static bool DisconnectIfBanned(CNode* pnode, CConnman* connman)
     return false;
 }
 
+//! Maximum number of messages of a peer processed by a tier two messages thread before moving to another peer
+static const size_t MAX_TIERTWO_MSGS_PER_RUN = 10;
+
+/**
+ * Processes the tier two messages (masternodes, budget, sporks, LLMQ), which don't need the chainstate, on a pool of
+ * threads separated from the message handler thread, so that their volume doesn't delay the blocks and txes handling.
+ * The messages of each peer are processed in order, by a single thread at a time (their order relative to the
+ * other messages of the peer is not kept).
+ */
+class CTierTwoMessageProcessor
+{
+private:
+    struct QueuedMessage
+    {
+        std::string strCommand;
+        CDataStream vRecv;
+        QueuedMessage(const std::string& _strCommand, CDataStream&& _vRecv) : strCommand(_strCommand), vRecv(std::move(_vRecv)) {}
+    };
+
+    struct PeerQueue
+    {
+        std::deque<QueuedMessage> msgs;
+        size_t nQueuedSize{0};
+    };
+
+    CConnman* connman;
+    ctpl::thread_pool workerPool;
+
+    Mutex cs;
+    // Peers with queued messages, each one scheduled on the pool (and referenced) until its queue is empty
+    std::map<CNode*, PeerQueue> mapPeerQueues GUARDED_BY(cs);
+    bool fStopped GUARDED_BY(cs){false};
+
+    void ProcessPeerMessages(CNode* pnode);
+    void ProcessQueuedMessage(CNode* pnode, QueuedMessage& msg);
+
+public:
+    CTierTwoMessageProcessor(CConnman* connmanIn, int nThreads) : connman(connmanIn)
+    {
+        workerPool.resize(nThreads);
+        RenameThreadPool(workerPool, "pivx-tiertwo-msg");
+    }
+    ~CTierTwoMessageProcessor() { Stop(); }
+
+    void Stop();
+    void QueueMessage(CNode* pnode, const std::string& strCommand, CDataStream& vRecv);
+    // Whether the peer has so many queued messages that no more must be taken from it
+    bool IsFlooded(CNode* pnode);
+};
+
+void CTierTwoMessageProcessor::Stop()
+{
+    {
+        LOCK(cs);
+        if (fStopped) return;
+        fStopped = true;
+    }
+    workerPool.clear_queue();
+    workerPool.stop(true);
+
+    // No more running threads: release the nodes
+    LOCK(cs);
+    for (auto& p : mapPeerQueues) {
+        p.first->Release();
+    }
+    mapPeerQueues.clear();
+}
+
+void CTierTwoMessageProcessor::QueueMessage(CNode* pnode, const std::string& strCommand, CDataStream& vRecv)
+{
+    LOCK(cs);
+    if (fStopped) return;
+    auto it = mapPeerQueues.find(pnode);
+    const bool fSchedule = it == mapPeerQueues.end();
+    if (fSchedule) {
+        pnode->AddRef();
+        it = mapPeerQueues.emplace(pnode, PeerQueue()).first;
+    }
+    it->second.nQueuedSize += vRecv.size();
+    it->second.msgs.emplace_back(strCommand, std::move(vRecv));
+    if (fSchedule) {
+        workerPool.push([this, pnode](int threadId) { ProcessPeerMessages(pnode); });
+    }
+}
+
+bool CTierTwoMessageProcessor::IsFlooded(CNode* pnode)
+{
+    LOCK(cs);
+    auto it = mapPeerQueues.find(pnode);
+    return it != mapPeerQueues.end() && it->second.nQueuedSize > connman->GetReceiveFloodSize();
+}
+
+void CTierTwoMessageProcessor::ProcessPeerMessages(CNode* pnode)
+{
+    std::deque<QueuedMessage> msgs;
+    {
+        LOCK(cs);
+        auto it = mapPeerQueues.find(pnode);
+        if (fStopped || it == mapPeerQueues.end()) return;
+        PeerQueue& queue = it->second;
+        while (!queue.msgs.empty() && msgs.size() < MAX_TIERTWO_MSGS_PER_RUN) {
+            queue.nQueuedSize -= queue.msgs.front().vRecv.size();
+            msgs.emplace_back(std::move(queue.msgs.front()));
+            queue.msgs.pop_front();
+        }
+    }
+
+    for (QueuedMessage& msg : msgs) {
+        if (pnode->fDisconnect) break;
+        ProcessQueuedMessage(pnode, msg);
+    }
+
+    LOCK(cs);
+    if (fStopped) return;
+    auto it = mapPeerQueues.find(pnode);
+    assert(it != mapPeerQueues.end());
+    if (it->second.msgs.empty() || pnode->fDisconnect) {
+        mapPeerQueues.erase(it);
+        pnode->Release();
+        return;
+    }
+    // Let the other peers go first
+    workerPool.push([this, pnode](int threadId) { ProcessPeerMessages(pnode); });
+}
+
+void CTierTwoMessageProcessor::ProcessQueuedMessage(CNode* pnode, QueuedMessage& msg)
+{
+    bool fRet = false;
+    try {
+        fRet = ProcessTierTwoMessage(pnode, msg.strCommand, msg.vRecv, connman);
+    } catch (const std::ios_base::failure& e) {
+        LogPrint(BCLog::NET, "%s(%s, %u bytes): Exception '%s' caught\n", __func__, SanitizeString(msg.strCommand), msg.vRecv.size(), e.what());
+    } catch (const std::exception& e) {
+        PrintExceptionContinue(&e, "ProcessTierTwoMessage()");
+    } catch (...) {
+        PrintExceptionContinue(nullptr, "ProcessTierTwoMessage()");
+    }
+
+    if (!fRet) {
+        LogPrint(BCLog::NET, "ProcessTierTwoMessage(%s) FAILED peer=%d\n", SanitizeString(msg.strCommand), pnode->GetId());
+    }
+
+    LOCK(cs_main);
+    DisconnectIfBanned(pnode, connman);
+}
+
+// Set when the tier two messages have their own threads
+static std::unique_ptr<CTierTwoMessageProcessor> tierTwoMessageProcessor;
+
+static bool QueueTierTwoMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv)
+{
+    if (!tierTwoMessageProcessor) return false;
+    tierTwoMessageProcessor->QueueMessage(pfrom, strCommand, vRecv);
+    return true;
+}
+
+PeerLogicValidation::PeerLogicValidation(CConnman* connmanIn, int nTierTwoMsgThreads) :
+        connman(connmanIn)
+{
+    // Initialize global variables that cannot be constructed at startup.
+    recentRejects.reset(new CRollingBloomFilter(120000, 0.000001));
+    recentlyHave.reset(new CRollingBloomFilter(120000, 0.000001));
+    if (nTierTwoMsgThreads > 0) {
+        tierTwoMessageProcessor = std::make_unique<CTierTwoMessageProcessor>(connman, nTierTwoMsgThreads);
+    }
+    if (gArgs.GetBoolArg("-txreconciliation", DEFAULT_TXRECONCILIATION_ENABLE)) {
+        txReconciliation = std::make_unique<TxReconciliationTracker>();
+    }
+}
+
+PeerLogicValidation::~PeerLogicValidation()
+{
+    tierTwoMessageProcessor.reset();
+    txReconciliation.reset();
+    WITH_LOCK(cs_main, filteredBlockPool.reset(); );
+}
+
+void PeerLogicValidation::StopTierTwoMessageThreads()
+{
+    if (tierTwoMessageProcessor) {
+        tierTwoMessageProcessor->Stop();
+    }
+}
+
 bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& interruptMsgProc)
 {
     // Message format
@@ -2278,6 +3354,18 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
     if (pfrom->fPauseSend)
         return false;
 
+    // Wait for the tier two messages threads to catch up with this peer
+    if (tierTwoMessageProcessor && tierTwoMessageProcessor->IsFlooded(pfrom))
+        return false;
+
+    // Reprocess the next batch of orphans, before the next message of this peer
+    if (WITH_LOCK(g_cs_orphans, return HasOrphanWork(pfrom->GetId()); )) {
+        LOCK2(cs_main, g_cs_orphans);
+        std::set<uint256>& orphanWorkSet = mapOrphansByPeer[pfrom->GetId()].workSet;
+        ProcessOrphanTx(connman, orphanWorkSet);
+        if (!orphanWorkSet.empty()) return true;
+    }
+
     std::list<CNetMessage> msgs;
     {
         LOCK(pfrom->cs_vProcessMsg);
@@ -2350,6 +3438,7 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
         LogPrint(BCLog::NET, "ProcessMessage(%s, %u bytes) FAILED peer=%d\n", SanitizeString(strCommand), nMessageSize,
                  pfrom->GetId());
     }
+    pfrom->RecycleRecvBuffer(vRecv);
 
     LOCK(cs_main);
     DisconnectIfBanned(pfrom, connman);
@@ -2461,8 +3550,10 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
         }
 
         // Start block sync
-        if (!pindexBestHeader)
+        if (!pindexBestHeader) {
             pindexBestHeader = chainActive.Tip();
+            nBestHeaderHeight = pindexBestHeader ? pindexBestHeader->nHeight : -1;
+        }
         bool fFetch = state.fPreferredDownload || (nPreferredDownload == 0 && !pto->fClient && !pto->fOneShot); // Download if this is a nice peer, or we have no nice peers and this one might do.
         if (!state.fSyncStarted && !pto->fClient && !fImporting && !fReindex && pto->CanRelay()) {
             // Only actively request headers from a single peer, unless we're close to end of initial download.
@@ -2566,6 +3657,7 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
                 // No reason to drain out at many times the network's capacity,
                 // especially since we have many peers and some will draw much shorter delays.
                 unsigned int nRelayedTransactions = 0;
+                const bool fReconciling = txReconciliation && txReconciliation->IsPeerRegistered(pto->GetId());
                 LOCK(pto->cs_filter);
                 while (!vInvTx.empty() && nRelayedTransactions < INVENTORY_BROADCAST_MAX) {
                     // Fetch the top element from the heap
@@ -2586,6 +3678,12 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
                     }
                     // todo: back port feerate filter.
                     if (pto->pfilter && !pto->pfilter->IsRelevantAndUpdate(*txinfo.tx)) continue;
+                    // Reconciling peers get most of the txes through the reconciliation of the sets
+                    if (fReconciling && !txReconciliation->ShouldFloodTo(pto->GetId(), hash) &&
+                        txReconciliation->AddToSet(pto->GetId(), hash)) {
+                        pto->filterInventoryKnown.insert(hash);
+                        continue;
+                    }
                     // Send
                     vInv.emplace_back(CInv(MSG_TX, hash));
                     nRelayedTransactions++;
@@ -2600,6 +3698,14 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
         if (!vInv.empty())
             connman->PushMessage(pto, msgMaker.Make(NetMsgType::INV, vInv));
 
+        //
+        // Message: reconciliation request (to our outbound reconciling peers)
+        //
+        uint16_t nReconSetSize = 0;
+        if (txReconciliation && txReconciliation->InitiateReconciliation(pto->GetId(), current_time, nReconSetSize)) {
+            connman->PushMessage(pto, msgMaker.Make(NetMsgType::REQTXRCNCL, nReconSetSize));
+        }
+
         // Detect whether we're stalling
         current_time = GetTime<std::chrono::microseconds>();
         nNow = GetTimeMicros();
@@ -2626,10 +3732,31 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
         // Message: getdata (blocks)
         //
         std::vector<CInv> vGetData;
-        if (!pto->fClient && pto->CanRelay() && fFetch && state.nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
+        const int nBlocksInTransitLimit = GetBlocksInTransitLimit(&state, pto->nMinPingUsecTime);
+        if (!pto->fClient && pto->CanRelay() && fFetch && state.nBlocksInFlight < nBlocksInTransitLimit) {
+            // During IBD, request again the block holding back our chain, when it has been in flight for too long from
+            // a peer much slower than this one (only once, so that it doesn't bounce between the peers).
+            if (IsInitialBlockDownload() && state.nBlockDeliveryTimeAvg > 0 && state.pindexBestKnownBlock &&
+                    state.pindexBestKnownBlock->nHeight > chainActive.Height()) {
+                const CBlockIndex* pindexNext = state.pindexBestKnownBlock->GetAncestor(chainActive.Height() + 1);
+                auto itInFlight = mapBlocksInFlight.find(pindexNext->GetBlockHash());
+                if (pindexNext->pprev == chainActive.Tip() && !(pindexNext->nStatus & BLOCK_HAVE_DATA) &&
+                        itInFlight != mapBlocksInFlight.end() && itInFlight->second.first != pto->GetId()) {
+                    const QueuedBlock& queued = *itInFlight->second.second;
+                    const CNodeState* holder = State(itInFlight->second.first);
+                    if (!queued.fRerequested && queued.nTime < nNow - 1000000 * BLOCK_STALLING_TIMEOUT &&
+                            (holder->nBlockDeliveryTimeAvg == 0 ||
+                             holder->nBlockDeliveryTimeAvg > BLOCK_REREQUEST_SPEED_RATIO * state.nBlockDeliveryTimeAvg)) {
+                        LogPrint(BCLog::NET, "Requesting block %s (%d) held back by peer=%d from peer=%d\n",
+                            pindexNext->GetBlockHash().ToString(), pindexNext->nHeight, itInFlight->second.first, pto->GetId());
+                        vGetData.emplace_back(MSG_BLOCK, pindexNext->GetBlockHash());
+                        MarkBlockAsInFlight(pto->GetId(), pindexNext->GetBlockHash(), pindexNext, true);
+                    }
+                }
+            }
             std::vector<const CBlockIndex*> vToDownload;
             NodeId staller = -1;
-            FindNextBlocksToDownload(pto->GetId(), MAX_BLOCKS_IN_TRANSIT_PER_PEER - state.nBlocksInFlight, vToDownload, staller);
+            FindNextBlocksToDownload(pto->GetId(), std::max(0, nBlocksInTransitLimit - state.nBlocksInFlight), vToDownload, staller);
             for (const CBlockIndex* pindex : vToDownload) {
                 vGetData.emplace_back(MSG_BLOCK, pindex->GetBlockHash());
                 MarkBlockAsInFlight(pto->GetId(), pindex->GetBlockHash(), pindex);
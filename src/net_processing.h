@@ -14,6 +14,10 @@ extern RecursiveMutex cs_main; // !TODO: change mutex to cs_orphans
 
 /** Default for -maxorphantx, maximum number of orphan transactions kept in memory */
 static const unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS = 25;
+/** Maximum size of the orphan transactions kept for a peer (its next orphans evict its oldest ones) */
+static const size_t MAX_ORPHAN_TX_BYTES_PER_PEER = 1000000;
+/** Maximum number of orphan transactions reprocessed at a time, between two messages of the peer */
+static const unsigned int MAX_ORPHANS_PROCESSED_PER_RUN = 10;
 /** Expiration time for orphan transactions in seconds */
 static const int64_t ORPHAN_TX_EXPIRE_TIME = 20 * 60;
 /** Minimum time between orphan transactions expire time checks in seconds */
@@ -25,6 +29,13 @@ static const unsigned int DEFAULT_BLOCK_SPAM_FILTER_MAX_SIZE = 100;
 /** Default for -blockspamfiltermaxavg, maximum average size of an index occurrence in the block spam filter */
 static const unsigned int DEFAULT_BLOCK_SPAM_FILTER_MAX_AVG = 10;
 
+/** Default for -tiertwomsgthreads, number of threads processing the tier two messages */
+static const int DEFAULT_TIERTWO_MSG_THREADS = 2;
+/** Maximum for -tiertwomsgthreads */
+static const int MAX_TIERTWO_MSG_THREADS = 8;
+/** Default for -txreconciliation, reconcile the transactions announced to the peers supporting it */
+static const bool DEFAULT_TXRECONCILIATION_ENABLE = true;
+
 /** Average delay between trickled inventory transmissions in seconds.
  *  Blocks and whitelisted receivers bypass this, outbound peers get half this delay. */
 static const unsigned int INVENTORY_BROADCAST_INTERVAL = 5;
@@ -37,8 +48,12 @@ private:
     CConnman* connman;
 
 public:
-    PeerLogicValidation(CConnman* connman);
-    ~PeerLogicValidation() = default;
+    // nTierTwoMsgThreads: threads processing the tier two messages (0: processed by the message handler thread)
+    PeerLogicValidation(CConnman* connman, int nTierTwoMsgThreads = 0);
+    ~PeerLogicValidation();
+
+    /** Stop the tier two messages threads, before the nodes are deleted (CConnman::Stop) */
+    void StopTierTwoMessageThreads();
 
     void BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex) override;
     void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override;
@@ -73,6 +88,8 @@ bool GetNodeStateStats(NodeId nodeid, CNodeStateStats& stats);
 /** Increase a node's misbehavior score. */
 void Misbehaving(NodeId nodeid, int howmuch, const std::string& message="") EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 bool IsBanned(NodeId nodeid);
+/** Estimated memory usage of the orphan transactions and of their indexes */
+size_t GetOrphanPoolMemoryUsage();
 
 
 using SecondsDouble = std::chrono::duration<double, std::chrono::seconds::period>;
@@ -17,7 +17,9 @@
 #include "util/system.h"
 #include "utilstrencodings.h"
 
+#include <iostream>
 #include <stdio.h>
+#include <sstream>
 #include <tuple>
 
 #include <event2/buffer.h>
@@ -29,6 +31,8 @@
 static const char DEFAULT_RPCCONNECT[] = "127.0.0.1";
 static const bool DEFAULT_NAMED=false;
 static const int DEFAULT_HTTP_CLIENT_TIMEOUT=900;
+static const bool DEFAULT_BATCH=false;
+static const int DEFAULT_BATCH_SIZE=1;
 static const int CONTINUE_EXECUTION=-1;
 
 std::string HelpMessageCli()
@@ -38,6 +42,10 @@ std::string HelpMessageCli()
     std::string strUsage;
     strUsage += HelpMessageGroup("Options:");
     strUsage += HelpMessageOpt("-?", "This help message");
+    strUsage += HelpMessageOpt("-batch", strprintf("Read the commands from standard input, one per line, and send them over a single connection. "
+                                                   "A line is either a JSON-RPC request object or a method followed by its arguments (see -named). "
+                                                   "The replies are written one per line, in the order of the commands (default: %s)", DEFAULT_BATCH));
+    strUsage += HelpMessageOpt("-batchsize=<n>", strprintf("Send up to <n> commands per JSON-RPC batch request in -batch mode (default: %d)", DEFAULT_BATCH_SIZE));
     strUsage += HelpMessageOpt("-conf=<file>", strprintf("Specify configuration file (default: %s)", PIVX_CONF_FILENAME));
     strUsage += HelpMessageOpt("-datadir=<dir>", "Specify data directory");
     AppendParamsHelpMessages(strUsage);
@@ -139,10 +147,11 @@ static int AppInitRPC(int argc, char* argv[])
 /** Reply structure for request_done to fill in */
 struct HTTPReply
 {
-    HTTPReply(): status(0), error(-1) {}
+    HTTPReply(): status(0), error(-1), done(false) {}
 
     int status;
     int error;
+    bool done;
     std::string body;
 };
 
@@ -171,6 +180,7 @@ const char *http_errorstring(int code)
 static void http_request_done(struct evhttp_request *req, void *ctx)
 {
     HTTPReply *reply = static_cast<HTTPReply*>(ctx);
+    reply->done = true;
 
     if (req == nullptr) {
         /* If req is nullptr, it means an error occurred while connecting: the
@@ -201,28 +211,36 @@ static void http_error_cb(enum evhttp_request_error err, void *ctx)
 }
 #endif
 
-UniValue CallRPC(const std::string& strMethod, const UniValue& params)
+/** A connection to the RPC server. A kept alive connection is reused by the requests of -batch mode. */
+class CRPCConnection
+{
+public:
+    explicit CRPCConnection(bool _fKeepAlive);
+    // Sends a JSON-RPC request (or batch of requests) and returns the parsed reply
+    UniValue Post(const std::string& strRequest);
+
+private:
+    const bool fKeepAlive;
+    const std::string host;
+    std::string strRPCUserColonPass;
+    raii_event_base base;
+    raii_evhttp_connection evcon;
+};
+
+CRPCConnection::CRPCConnection(bool _fKeepAlive) :
+    fKeepAlive(_fKeepAlive),
+    host(gArgs.GetArg("-rpcconnect", DEFAULT_RPCCONNECT))
 {
-    std::string host = gArgs.GetArg("-rpcconnect", DEFAULT_RPCCONNECT);
     int port = gArgs.GetArg("-rpcport", BaseParams().RPCPort());
 
     // Obtain event base
-    raii_event_base base = obtain_event_base();
+    base = obtain_event_base();
 
     // Synchronously look up hostname
-    raii_evhttp_connection evcon = obtain_evhttp_connection_base(base.get(), host, port);
+    evcon = obtain_evhttp_connection_base(base.get(), host, port);
     evhttp_connection_set_timeout(evcon.get(), gArgs.GetArg("-rpcclienttimeout", DEFAULT_HTTP_CLIENT_TIMEOUT));
 
-    HTTPReply response;
-    raii_evhttp_request req = obtain_evhttp_request(http_request_done, (void*)&response);
-    if (req == nullptr)
-        throw std::runtime_error("create http request failed");
-#if LIBEVENT_VERSION_NUMBER >= 0x02010300
-    evhttp_request_set_error_cb(req.get(), http_error_cb);
-#endif
-
     // Get credentials
-    std::string strRPCUserColonPass;
     if (gArgs.GetArg("-rpcpassword", "") == "") {
         // Try fall back to cookie-based authentication if no password is provided
         if (!GetAuthCookie(&strRPCUserColonPass)) {
@@ -234,15 +252,25 @@ UniValue CallRPC(const std::string& strMethod, const UniValue& params)
     } else {
         strRPCUserColonPass = gArgs.GetArg("-rpcuser", "") + ":" + gArgs.GetArg("-rpcpassword", "");
     }
+}
+
+UniValue CRPCConnection::Post(const std::string& strRequest)
+{
+    HTTPReply response;
+    raii_evhttp_request req = obtain_evhttp_request(http_request_done, (void*)&response);
+    if (req == nullptr)
+        throw std::runtime_error("create http request failed");
+#if LIBEVENT_VERSION_NUMBER >= 0x02010300
+    evhttp_request_set_error_cb(req.get(), http_error_cb);
+#endif
 
     struct evkeyvalq* output_headers = evhttp_request_get_output_headers(req.get());
     assert(output_headers);
     evhttp_add_header(output_headers, "Host", host.c_str());
-    evhttp_add_header(output_headers, "Connection", "close");
+    evhttp_add_header(output_headers, "Connection", fKeepAlive ? "keep-alive" : "close");
     evhttp_add_header(output_headers, "Authorization", (std::string("Basic ") + EncodeBase64(strRPCUserColonPass)).c_str());
 
     // Attach request data
-    std::string strRequest = JSONRPCRequestObj(strMethod, params, 1).write() + "\n";
     struct evbuffer* output_buffer = evhttp_request_get_output_buffer(req.get());
     assert(output_buffer);
     evbuffer_add(output_buffer, strRequest.data(), strRequest.size());
@@ -265,7 +293,8 @@ UniValue CallRPC(const std::string& strMethod, const UniValue& params)
         throw CConnectionFailed("send http request failed");
     }
 
-    event_base_dispatch(base.get());
+    // A kept alive connection leaves its events pending after the reply: loop until the reply is done
+    while (!response.done && event_base_loop(base.get(), EVLOOP_ONCE) == 0) {}
 
     if (response.status == 0)
         throw CConnectionFailed(strprintf("couldn't connect to server: %s (code %d)\n(make sure server is running and you are connecting to the correct RPC port)", http_errorstring(response.error), response.error));
@@ -280,6 +309,13 @@ UniValue CallRPC(const std::string& strMethod, const UniValue& params)
     UniValue valReply(UniValue::VSTR);
     if (!valReply.read(response.body))
         throw std::runtime_error("couldn't parse reply from server");
+    return valReply;
+}
+
+UniValue CallRPC(const std::string& strMethod, const UniValue& params)
+{
+    CRPCConnection conn(false);
+    const UniValue valReply = conn.Post(JSONRPCRequestObj(strMethod, params, 1).write() + "\n");
     const UniValue& reply = valReply.get_obj();
     if (reply.empty())
         throw std::runtime_error("expected reply to have result, error and id properties");
@@ -375,6 +411,116 @@ int CommandLineRPC(int argc, char* argv[])
     return nRet;
 }
 
+// A command of -batch mode as a JSON-RPC request, with its line number as default id
+static UniValue ParseBatchCommand(const std::string& strLine, int nLine)
+{
+    if (strLine[0] == '{') {
+        UniValue request;
+        if (!request.read(strLine) || !request.isObject())
+            throw std::runtime_error("invalid JSON-RPC request object");
+        if (find_value(request, "id").isNull())
+            request.pushKV("id", nLine);
+        return request;
+    }
+
+    // Method and arguments, separated by whitespace
+    std::istringstream iss(strLine);
+    std::string strMethod;
+    iss >> strMethod;
+    std::vector<std::string> strParams;
+    for (std::string strParam; iss >> strParam;) {
+        strParams.emplace_back(strParam);
+    }
+    const UniValue params = gArgs.GetBoolArg("-named", DEFAULT_NAMED) ? RPCConvertNamedValues(strMethod, strParams) :
+                                                                         RPCConvertValues(strMethod, strParams);
+    return JSONRPCRequestObj(strMethod, params, nLine);
+}
+
+static void PrintBatchReply(const UniValue& reply, bool& fError)
+{
+    if (!find_value(reply, "error").isNull())
+        fError = true;
+    fprintf(stdout, "%s\n", reply.write().c_str());
+}
+
+// Sends the pending requests of -batch mode, and writes their replies
+static void SendBatchRequests(CRPCConnection& conn, UniValue& requests, bool& fError)
+{
+    if (requests.empty())
+        return;
+    // A single request is not wrapped in a batch
+    const UniValue& request = requests.size() == 1 ? requests[0] : requests;
+
+    UniValue reply;
+    const bool fWait = gArgs.GetBoolArg("-rpcwait", false);
+    do {
+        try {
+            reply = conn.Post(request.write() + "\n");
+            break;
+        } catch (const CConnectionFailed& e) {
+            if (fWait)
+                MilliSleep(1000);
+            else
+                throw;
+        }
+    } while (fWait);
+
+    if (reply.isArray()) {
+        for (size_t i = 0; i < reply.size(); i++) {
+            PrintBatchReply(reply[i], fError);
+        }
+    } else if (reply.isObject()) {
+        PrintBatchReply(reply, fError);
+    } else {
+        throw std::runtime_error("expected reply to be a JSON-RPC reply object or array");
+    }
+    fflush(stdout);
+    requests.setArray();
+}
+
+int BatchRPC()
+{
+    bool fError = false;
+    try {
+        CRPCConnection conn(true);
+        const int nBatchSize = std::max(1, (int)gArgs.GetArg("-batchsize", DEFAULT_BATCH_SIZE));
+        UniValue requests(UniValue::VARR);
+        int nLine = 0;
+        for (std::string strLine; std::getline(std::cin, strLine);) {
+            nLine++;
+            if (!strLine.empty() && strLine.back() == '\r')
+                strLine.pop_back();
+            // Skip empty lines and comments
+            if (strLine.find_first_not_of(" \t") == std::string::npos || strLine[0] == '#')
+                continue;
+
+            UniValue request;
+            try {
+                request = ParseBatchCommand(strLine, nLine);
+            } catch (const std::exception& e) {
+                // Reply to the invalid command in its place, after the replies of the preceding ones
+                SendBatchRequests(conn, requests, fError);
+                PrintBatchReply(JSONRPCReplyObj(NullUniValue, JSONRPCError(RPC_PARSE_ERROR, e.what()), nLine), fError);
+                fflush(stdout);
+                continue;
+            }
+            requests.push_back(request);
+            if ((int)requests.size() >= nBatchSize)
+                SendBatchRequests(conn, requests, fError);
+        }
+        SendBatchRequests(conn, requests, fError);
+    } catch (const boost::thread_interrupted&) {
+        throw;
+    } catch (const std::exception& e) {
+        fprintf(stderr, "error: %s\n", e.what());
+        return EXIT_FAILURE;
+    } catch (...) {
+        PrintExceptionContinue(nullptr, "BatchRPC()");
+        throw;
+    }
+    return fError ? EXIT_FAILURE : 0;
+}
+
 #ifdef WIN32
 // Export main() and ensure working ASLR on Windows.
 // Exporting a symbol will prevent the linker from stripping
@@ -410,7 +556,7 @@ int main(int argc, char* argv[])
 
     int ret = EXIT_FAILURE;
     try {
-        ret = CommandLineRPC(argc, argv);
+        ret = gArgs.GetBoolArg("-batch", DEFAULT_BATCH) ? BatchRPC() : CommandLineRPC(argc, argv);
     } catch (const std::exception& e) {
         PrintExceptionContinue(&e, "CommandLineRPC()");
     } catch (...) {
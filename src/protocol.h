@@ -136,6 +136,93 @@ extern const char* TX;
  * @see https://bitcoin.org/en/developer-reference#headers
  */
 extern const char* HEADERS;
+/**
+ * Contains a 1-byte bool and 8-byte LE version number.
+ * Indicates that a node is willing to provide blocks via "cmpctblock" messages.
+ * Only the low-bandwidth mode is used (the first field is always false): blocks are
+ * still announced with invs, and requested with a MSG_CMPCT_BLOCK getdata.
+ * @since protocol version 70928, BIP152 adapted to PIVX blocks.
+ */
+extern const char* SENDCMPCT;
+/**
+ * Contains a CBlockHeaderAndShortTxIDs object - providing a header, the short txids
+ * of the transactions, the prefilled coinbase/coinstake and the block signature.
+ * @since protocol version 70928.
+ */
+extern const char* CMPCTBLOCK;
+/**
+ * Contains a BlockTransactionsRequest
+ * Peer should respond with "blocktxn" message.
+ * @since protocol version 70928.
+ */
+extern const char* GETBLOCKTXN;
+/**
+ * Contains a BlockTransactions.
+ * Sent in response to a "getblocktxn" message.
+ * @since protocol version 70928.
+ */
+extern const char* BLOCKTXN;
+/**
+ * Contains a 4-byte reconciliation protocol version and an 8-byte salt.
+ * Indicates that a node supports the transaction relay reconciliation: the transactions are then mostly
+ * announced after the periodic reconciliation of the sets of the two peers (instead of being flooded with invs).
+ * @since protocol version 70929.
+ */
+extern const char* SENDTXRCNCL;
+/**
+ * Contains the 2-byte size of the initiator's reconciliation set.
+ * Sent by the initiator (the outbound side of the connection), the peer should respond with a "sketch" message.
+ * @since protocol version 70929.
+ */
+extern const char* REQTXRCNCL;
+/**
+ * Contains the sketch (the vector of the 4-byte syndromes) of the responder's reconciliation set.
+ * An empty sketch means that the difference of the sets is too big to be reconciled.
+ * @since protocol version 70929.
+ */
+extern const char* SKETCH;
+/**
+ * Contains a 1-byte bool (whether the difference was decoded) and the short ids of the initiator's missing
+ * transactions, that the responder should announce with an inv (all its set, on failure).
+ * @since protocol version 70929.
+ */
+extern const char* RECONCILDIFF;
+/**
+ * getcfilters requests compact filters for a range of blocks.
+ * Only available with service bit NODE_COMPACT_FILTERS as described by
+ * BIP 157 & 158.
+ */
+extern const char* GETCFILTERS;
+/**
+ * cfilter is a response to a getcfilters request containing a single compact
+ * filter.
+ */
+extern const char* CFILTER;
+/**
+ * getcfheaders requests a compact filter header and the filter hashes for a
+ * range of blocks, which can then be used to reconstruct the filter headers
+ * for those blocks.
+ * Only available with service bit NODE_COMPACT_FILTERS as described by
+ * BIP 157 & 158.
+ */
+extern const char* GETCFHEADERS;
+/**
+ * cfheaders is a response to a getcfheaders request containing a filter header
+ * and a vector of filter hashes for each subsequent block in the requested range.
+ */
+extern const char* CFHEADERS;
+/**
+ * getcfcheckpt requests evenly spaced compact filter headers, enabling
+ * parallelized download and validation of the headers between them.
+ * Only available with service bit NODE_COMPACT_FILTERS as described by
+ * BIP 157 & 158.
+ */
+extern const char* GETCFCHECKPT;
+/**
+ * cfcheckpt is a response to a getcfcheckpt request containing a vector of
+ * evenly spaced filter headers for blocks on the requested chain.
+ */
+extern const char* CFCHECKPT;
 /**
  * The block message transmits a single serialized block.
  * @see https://bitcoin.org/en/developer-reference#block
@@ -322,6 +409,10 @@ enum ServiceFlags : uint64_t {
     // that the node doesn't want to receive master nodes messages. (the 1<<3 was not picked as constant because on bitcoin 0.14 is witness and we want that update here )
     NODE_BLOOM_WITHOUT_MN = (1 << 4),
 
+    // NODE_COMPACT_FILTERS means the node will service basic block filter
+    // requests. See BIP157 and BIP158 for details on how this is implemented.
+    NODE_COMPACT_FILTERS = (1 << 6),
+
     // Bits 24-31 are reserved for temporary experiments. Just pick a bit that
     // isn't getting used, or one not being used much, and notify the
     // bitcoin-development mailing list. Remember that service bits are just
@@ -456,7 +547,9 @@ enum GetDataMsg {
     MSG_QUORUM_PREMATURE_COMMITMENT,
     MSG_QUORUM_RECOVERED_SIG,
     MSG_CLSIG,
-    MSG_TYPE_MAX = MSG_CLSIG,
+    // Only used in getdata: requests a cmpctblock (or the full block, if not recent)
+    MSG_CMPCT_BLOCK,
+    MSG_TYPE_MAX = MSG_CMPCT_BLOCK,
 };
 
 /** inv message data */
@@ -5,6 +5,12 @@
 
 #include "pubkey.h"
 
+#include "crypto/siphash.h"
+#include "unordered_lru_cache.h"
+
+#include <mutex>
+#include <random>
+
 #include <secp256k1.h>
 #include <secp256k1_recovery.h>
 
@@ -12,8 +18,46 @@ namespace
 {
 /* Global secp256k1_context object used for verification. */
 secp256k1_context* secp256k1_context_verify = nullptr;
+
+/* Salt of the parsed keys cache, drawn when the verification context is created. */
+uint64_t pubkey_cache_k0 = 0;
+uint64_t pubkey_cache_k1 = 0;
+
+struct SaltedPubKeyHasher
+{
+    size_t operator()(const CPubKey& key) const
+    {
+        return CSipHasher(pubkey_cache_k0, pubkey_cache_k1).Write(key.begin(), key.size()).Finalize();
+    }
+};
+
+/* Number of parsed keys kept by the cache */
+static const size_t PUBKEY_PARSE_CACHE_SIZE = 4096;
+
+/* The staking and masternode keys sign many blocks and messages: keep them parsed (and
+ * decompressed), as it is a costly part of the verification of a signature. */
+std::mutex cs_pubkey_cache;
+unordered_lru_cache<CPubKey, secp256k1_pubkey, SaltedPubKeyHasher> pubkey_cache(PUBKEY_PARSE_CACHE_SIZE);
 } // namespace
 
+/** Parse the valid key vch into pubkey, through the cache of the parsed keys */
+static bool ParsePubKey(const CPubKey& vch, secp256k1_pubkey& pubkey)
+{
+    {
+        std::lock_guard<std::mutex> lock(cs_pubkey_cache);
+        if (pubkey_cache.get(vch, pubkey)) {
+            return true;
+        }
+    }
+    assert(secp256k1_context_verify && "secp256k1_context_verify must be initialized to use CPubKey.");
+    if (!secp256k1_ec_pubkey_parse(secp256k1_context_verify, &pubkey, vch.begin(), vch.size())) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(cs_pubkey_cache);
+    pubkey_cache.insert(vch, pubkey);
+    return true;
+}
+
 /** This function is taken from the libsecp256k1 distribution and implements
  *  DER parsing for ECDSA signatures, while supporting an arbitrary subset of
  *  format violations.
@@ -166,16 +210,10 @@ static int ecdsa_signature_parse_der_lax(const secp256k1_context* ctx, secp256k1
     return 1;
 }
 
-bool CPubKey::Verify(const uint256& hash, const std::vector<unsigned char>& vchSig) const
+/** Verify a DER signature with an already parsed public key */
+static bool VerifyParsed(const secp256k1_pubkey& pubkey, const uint256& hash, const std::vector<unsigned char>& vchSig)
 {
-    if (!IsValid())
-        return false;
-    secp256k1_pubkey pubkey;
     secp256k1_ecdsa_signature sig;
-    assert(secp256k1_context_verify && "secp256k1_context_verify must be initialized to use CPubKey.");
-    if (!secp256k1_ec_pubkey_parse(secp256k1_context_verify, &pubkey, vch, size())) {
-        return false;
-    }
     if (!ecdsa_signature_parse_der_lax(secp256k1_context_verify, &sig, vchSig.data(), vchSig.size())) {
         return false;
     }
@@ -185,6 +223,34 @@ bool CPubKey::Verify(const uint256& hash, const std::vector<unsigned char>& vchS
     return secp256k1_ecdsa_verify(secp256k1_context_verify, &sig, hash.begin(), &pubkey);
 }
 
+bool CPubKey::Verify(const uint256& hash, const std::vector<unsigned char>& vchSig) const
+{
+    if (!IsValid())
+        return false;
+    secp256k1_pubkey pubkey;
+    if (!ParsePubKey(*this, pubkey)) {
+        return false;
+    }
+    return VerifyParsed(pubkey, hash, vchSig);
+}
+
+size_t CPubKey::VerifyMany(const std::vector<std::pair<uint256, std::vector<unsigned char>>>& vSigs, std::vector<bool>& vResults) const
+{
+    vResults.assign(vSigs.size(), false);
+    if (!IsValid())
+        return 0;
+    secp256k1_pubkey pubkey;
+    if (!ParsePubKey(*this, pubkey)) {
+        return 0;
+    }
+    size_t nValid = 0;
+    for (size_t i = 0; i < vSigs.size(); i++) {
+        vResults[i] = VerifyParsed(pubkey, vSigs[i].first, vSigs[i].second);
+        if (vResults[i]) nValid++;
+    }
+    return nValid;
+}
+
 bool CPubKey::RecoverCompact(const uint256& hash, const std::vector<unsigned char>& vchSig)
 {
     if (vchSig.size() != COMPACT_SIGNATURE_SIZE)
@@ -301,6 +367,11 @@ ECCVerifyHandle::ECCVerifyHandle()
         assert(secp256k1_context_verify == nullptr);
         secp256k1_context_verify = secp256k1_context_create(SECP256K1_CONTEXT_VERIFY);
         assert(secp256k1_context_verify != nullptr);
+        std::random_device rd;
+        std::lock_guard<std::mutex> lock(cs_pubkey_cache);
+        pubkey_cache.clear();
+        pubkey_cache_k0 = ((uint64_t)rd() << 32) | rd();
+        pubkey_cache_k1 = ((uint64_t)rd() << 32) | rd();
     }
     refcount++;
 }
@@ -312,5 +383,7 @@ ECCVerifyHandle::~ECCVerifyHandle()
         assert(secp256k1_context_verify != nullptr);
         secp256k1_context_destroy(secp256k1_context_verify);
         secp256k1_context_verify = nullptr;
+        std::lock_guard<std::mutex> lock(cs_pubkey_cache);
+        pubkey_cache.clear();
     }
 }
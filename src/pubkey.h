@@ -12,6 +12,7 @@
 #include "uint256.h"
 
 #include <stdexcept>
+#include <utility>
 #include <vector>
 
 const unsigned int BIP32_EXTKEY_SIZE = 74;
@@ -200,6 +201,12 @@ public:
      */
     bool Verify(const uint256& hash, const std::vector<unsigned char>& vchSig) const;
 
+    /**
+     * Verify many (hash, DER signature) pairs signed by this key, parsing (and decompressing) it once.
+     * vResults is set to the result of each pair. Returns the number of valid signatures.
+     */
+    size_t VerifyMany(const std::vector<std::pair<uint256, std::vector<unsigned char>>>& vSigs, std::vector<bool>& vResults) const;
+
     /**
      * Check whether a signature is normalized (lower-S).
      */
@@ -206,6 +206,9 @@ void DashboardWidget::loadWalletModel()
         connect(ui->pushImgEmpty, &QPushButton::clicked, [this](){window->openFAQ();});
         connect(ui->btnHowTo, &QPushButton::clicked, [this](){window->openFAQ();});
         connect(txModel, &TransactionTableModel::txArrived, this, &DashboardWidget::onTxArrived);
+        // The records are loaded in the background, show them as they come
+        connect(txModel, &TransactionTableModel::rowsInserted, this, &DashboardWidget::showList);
+        connect(txModel, &TransactionTableModel::txLoadingFinished, this, &DashboardWidget::onTxLoadingFinished);
 
         // Notification pop-up for new transaction
         connect(txModel, &TransactionTableModel::rowsInserted, this, &DashboardWidget::processNewTransaction);
@@ -233,6 +236,20 @@ void DashboardWidget::onTxArrived(const QString& hash, const bool isCoinStake, c
 #endif
 }
 
+void DashboardWidget::onTxLoadingFinished()
+{
+    showList();
+#ifdef USE_QTCHARTS
+    // The chart was built with the records loaded until then
+    if (stakesFilter && fShowCharts) {
+        hasStakes = stakesFilter->rowCount() > 0;
+        filterUpdateNeeded = true;
+        lastRefreshTime = 0;
+        tryChartRefresh();
+    }
+#endif
+}
+
 void DashboardWidget::showList()
 {
     if (txModel->size() == 0) {
@@ -525,14 +542,25 @@ QMap<int, std::pair<qint64, qint64>> DashboardWidget::getAmountBy()
         filterUpdateNeeded = false;
         updateStakeFilter();
     }
-    const int size = stakesFilter->rowCount();
+    // Days of the chart, the same range as the stakes filter (see updateStakeFilter)
+    QDate from, to;
+    if (chartShow != ALL) {
+        bool filterByMonth = monthFilter != 0 && chartShow == MONTH;
+        int year = (yearFilter != 0) ? yearFilter : QDate::currentDate().year();
+        if (filterByMonth) {
+            from = QDate(year, monthFilter, 1);
+            to = QDate(year, monthFilter, from.daysInMonth());
+        } else if (yearFilter != 0) {
+            from = QDate(year, 1, 1);
+            to = QDate(year, 12, 31);
+        }
+    }
+
+    // The model keeps the stake rewards aggregated by day, only the days of the chart are read
+    const QMap<QDate, std::pair<qint64, qint64>> amountsByDay = txModel->getStakeAmountsByDay(from, to);
     QMap<int, std::pair<qint64, qint64>> amountBy;
-    // Get all the stakes
-    for (int i = 0; i < size; ++i) {
-        QModelIndex modelIndex = stakesFilter->index(i, TransactionTableModel::ToAddress);
-        qint64 amount = llabs(modelIndex.data(TransactionTableModel::AmountRole).toLongLong());
-        QDate date = modelIndex.data(TransactionTableModel::DateRole).toDateTime().date();
-        bool isPiv = modelIndex.data(TransactionTableModel::TypeRole).toInt() != TransactionRecord::MNReward;
+    for (auto it = amountsByDay.begin(); it != amountsByDay.end(); ++it) {
+        const QDate& date = it.key();
 
         int time = 0;
         switch (chartShow) {
@@ -552,18 +580,11 @@ QMap<int, std::pair<qint64, qint64>> DashboardWidget::getAmountBy()
                 inform(tr("Error loading chart, invalid show option"));
                 return amountBy;
         }
-        if (amountBy.contains(time)) {
-            if (isPiv) {
-                amountBy[time].first += amount;
-            } else
-                amountBy[time].second += amount;
-        } else {
-            if (isPiv) {
-                amountBy[time] = std::make_pair(amount, 0);
-            } else {
-                amountBy[time] = std::make_pair(0, amount);
-                hasMNRewards = true;
-            }
+        std::pair<qint64, qint64>& amounts = amountBy[time];
+        amounts.first += it.value().first;
+        amounts.second += it.value().second;
+        if (it.value().second != 0) {
+            hasMNRewards = true;
         }
     }
     return amountBy;
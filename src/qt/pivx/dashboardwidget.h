@@ -123,6 +123,7 @@ private Q_SLOTS:
     void updateDisplayUnit();
     void showList();
     void onTxArrived(const QString& hash, const bool isCoinStake, const bool isMNReward, const bool isCSAnyType);
+    void onTxLoadingFinished();
 
 #ifdef USE_QTCHARTS
     void windowResizeEvent(QResizeEvent* event);
@@ -36,16 +36,16 @@ std::string ProposalInfo::statusToStr() const
     return "";
 }
 
-GovernanceModel::GovernanceModel(ClientModel* _clientModel, MNModel* _mnModel) : clientModel(_clientModel), mnModel(_mnModel) {}
-GovernanceModel::~GovernanceModel() {}
-
-void GovernanceModel::setWalletModel(WalletModel* _walletModel)
-{
-    walletModel = _walletModel;
-    connect(walletModel->getTransactionTableModel(), &TransactionTableModel::txLoaded, this, &GovernanceModel::txLoaded);
-}
-
-ProposalInfo GovernanceModel::buildProposalInfo(const CBudgetProposal* prop, bool isPassing, bool isPending)
+// The chain state the proposals are evaluated against, taken on the GUI thread
+struct ProposalsContext {
+    int mnCount{0};
+    int lastBlockHeight{0};
+    CAmount maxBudget{0};
+};
+
+// Util function to create a ProposalInfo object
+static ProposalInfo BuildProposalInfo(const CBudgetProposal* prop, bool isPassing, bool isPending,
+                                      CAmount allocatedAmount, const ProposalsContext& ctx)
 {
     CTxDestination recipient;
     ExtractDestination(prop->GetPayee(), recipient);
@@ -53,8 +53,7 @@ ProposalInfo GovernanceModel::buildProposalInfo(const CBudgetProposal* prop, boo
     // Calculate status
     int votesYes = prop->GetYeas();
     int votesNo = prop->GetNays();
-    int mnCount = clientModel->getMasternodesCount();
-    int remainingPayments = prop->GetRemainingPaymentCount(clientModel->getLastBlockProcessedHeight());
+    int remainingPayments = prop->GetRemainingPaymentCount(ctx.lastBlockHeight);
     ProposalInfo::Status status;
 
     if (isPending) {
@@ -65,7 +64,7 @@ ProposalInfo GovernanceModel::buildProposalInfo(const CBudgetProposal* prop, boo
             status = ProposalInfo::FINISHED;
         } else if (isPassing) {
             status = ProposalInfo::PASSING;
-        } else if (allocatedAmount + prop->GetAmount() > getMaxAvailableBudgetAmount() && votesYes - votesNo > mnCount / 10) {
+        } else if (allocatedAmount + prop->GetAmount() > ctx.maxBudget && votesYes - votesNo > ctx.mnCount / 10) {
             status = ProposalInfo::PASSING_NOT_FUNDED;
         } else {
             status = ProposalInfo::NOT_PASSING;
@@ -86,26 +85,78 @@ ProposalInfo GovernanceModel::buildProposalInfo(const CBudgetProposal* prop, boo
             prop->GetBlockEnd());
 }
 
-std::list<ProposalInfo> GovernanceModel::getProposals(const ProposalInfo::Status* filterByStatus, bool filterFinished)
+// The network proposals ordered by net votes, and the sum of the passing ones
+static std::vector<ProposalInfo> BuildProposals(const ProposalsContext& ctx, CAmount& allocatedAmount)
 {
-    if (!clientModel) return {};
-    std::list<ProposalInfo> ret;
     std::vector<CBudgetProposal> budget = g_budgetman.GetBudget();
+    std::vector<ProposalInfo> ret;
     allocatedAmount = 0;
+    LOCK(g_budgetman.cs_proposals);
     for (const auto& prop : g_budgetman.GetAllProposalsOrdered()) {
         bool isPassing = std::find(budget.begin(), budget.end(), *prop) != budget.end();
-        ProposalInfo propInfo = buildProposalInfo(prop, isPassing, false);
+        ret.emplace_back(BuildProposalInfo(prop, isPassing, false, allocatedAmount, ctx));
+        if (isPassing) allocatedAmount += prop->GetAmount();
+    }
+    return ret;
+}
 
+// ProposalInfo::operator== compares the ids only
+static bool SameProposalInfo(const ProposalInfo& a, const ProposalInfo& b)
+{
+    return a.id == b.id && a.name == b.name && a.url == b.url && a.votesYes == b.votesYes && a.votesNo == b.votesNo &&
+           a.recipientAdd == b.recipientAdd && a.amount == b.amount && a.totalPayments == b.totalPayments &&
+           a.remainingPayments == b.remainingPayments && a.status == b.status && a.startBlock == b.startBlock &&
+           a.endBlock == b.endBlock;
+}
+
+// Builds the proposals, handing them to the model on the GUI thread
+class ProposalsRefreshTask : public QRunnable
+{
+public:
+    ProposalsRefreshTask(GovernanceModel* _model, const ProposalsContext& _ctx) : model(_model), ctx(_ctx) {}
+    void run() override
+    {
+        CAmount allocated;
+        std::vector<ProposalInfo> props = BuildProposals(ctx, allocated);
+        model->postProposals(std::move(props), allocated);
+    }
+
+private:
+    GovernanceModel* model;
+    const ProposalsContext ctx;
+};
+
+GovernanceModel::GovernanceModel(ClientModel* _clientModel, MNModel* _mnModel) : clientModel(_clientModel), mnModel(_mnModel)
+{
+    refreshPool.setMaxThreadCount(1);
+}
+
+GovernanceModel::~GovernanceModel()
+{
+    refreshPool.waitForDone();
+}
+
+void GovernanceModel::setWalletModel(WalletModel* _walletModel)
+{
+    walletModel = _walletModel;
+    connect(walletModel->getTransactionTableModel(), &TransactionTableModel::txLoaded, this, &GovernanceModel::txLoaded);
+}
+
+std::list<ProposalInfo> GovernanceModel::getProposals(const ProposalInfo::Status* filterByStatus, bool filterFinished)
+{
+    if (!clientModel) return {};
+    std::list<ProposalInfo> ret;
+    for (const auto& propInfo : proposals) {
         if (filterFinished && propInfo.isFinished()) continue;
         if (!filterByStatus || propInfo.status == *filterByStatus) {
             ret.emplace_back(propInfo);
         }
-        if (isPassing) allocatedAmount += prop->GetAmount();
     }
 
     // Add pending proposals
+    const ProposalsContext ctx{clientModel->getMasternodesCount(), clientModel->getLastBlockProcessedHeight(), getMaxAvailableBudgetAmount()};
     for (const auto& prop : waitingPropsForConfirmations) {
-        ProposalInfo propInfo = buildProposalInfo(&prop, false, true);
+        ProposalInfo propInfo = BuildProposalInfo(&prop, false, true, allocatedAmount, ctx);
         if (!filterByStatus || propInfo.status == *filterByStatus) {
             ret.emplace_back(propInfo);
         }
@@ -113,9 +164,48 @@ std::list<ProposalInfo> GovernanceModel::getProposals(const ProposalInfo::Status
     return ret;
 }
 
+void GovernanceModel::requestProposalsUpdate()
+{
+    if (!clientModel) return;
+    // A single refresh at a time: the requests made in the meantime are served by the running one
+    if (fRefreshPending.exchange(true)) return;
+    const ProposalsContext ctx{clientModel->getMasternodesCount(), clientModel->getLastBlockProcessedHeight(), getMaxAvailableBudgetAmount()};
+    refreshPool.start(new ProposalsRefreshTask(this, ctx));
+}
+
+void GovernanceModel::postProposals(std::vector<ProposalInfo>&& props, CAmount allocated)
+{
+    {
+        LOCK(cs_pending);
+        pendingProposals = std::move(props);
+        pendingAllocatedAmount = allocated;
+    }
+    QMetaObject::invokeMethod(this, "applyPendingProposals", Qt::QueuedConnection);
+}
+
+void GovernanceModel::applyPendingProposals()
+{
+    std::vector<ProposalInfo> props;
+    CAmount allocated;
+    {
+        LOCK(cs_pending);
+        props = std::move(pendingProposals);
+        pendingProposals.clear();
+        allocated = pendingAllocatedAmount;
+    }
+    fRefreshPending = false;
+    if (allocated == allocatedAmount && props.size() == proposals.size() &&
+        std::equal(props.begin(), props.end(), proposals.begin(), SameProposalInfo)) {
+        return;
+    }
+    proposals = std::move(props);
+    allocatedAmount = allocated;
+    Q_EMIT proposalsChanged();
+}
+
 bool GovernanceModel::hasProposals()
 {
-    return g_budgetman.HasAnyProposal() || !waitingPropsForConfirmations.empty();
+    return !proposals.empty() || !waitingPropsForConfirmations.empty();
 }
 
 CAmount GovernanceModel::getMaxAvailableBudgetAmount() const
@@ -167,6 +257,8 @@ std::vector<VoteInfo> GovernanceModel::getLocalMNsVotesForProposal(const Proposa
         LOCK(g_budgetman.cs_proposals); // future: encapsulate this mutex lock.
         // Get the budget proposal, get the votes, then loop over it and return the ones that correspond to the local masternodes here.
         CBudgetProposal* prop = g_budgetman.FindProposal(propInfo.id);
+        // The cached proposal could have been removed since the last refresh
+        if (!prop) return localVotes;
         const auto& mapVotes = prop->GetVotes();
         for (const auto& it : mapVotes) {
             for (const auto& mn : vecLocalMn) {
@@ -330,6 +422,8 @@ void GovernanceModel::pollGovernanceChanged()
         }
         it->Relay();
         it = waitingPropsForConfirmations.erase(it);
+        // The proposal is now in the network list
+        requestProposalsUpdate();
     }
 
     // If there are no more waiting proposals, turn the timer off.
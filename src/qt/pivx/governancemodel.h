@@ -7,6 +7,7 @@
 
 #include "clientmodel.h"
 #include "operationresult.h"
+#include "sync.h"
 #include "uint256.h"
 
 #include <atomic>
@@ -15,6 +16,7 @@
 #include <utility>
 
 #include <QObject>
+#include <QThreadPool>
 
 struct ProposalInfo {
 public:
@@ -88,15 +90,18 @@ QT_END_NAMESPACE
 
 class GovernanceModel : public QObject
 {
+    Q_OBJECT
 
 public:
     explicit GovernanceModel(ClientModel* _clientModel, MNModel* _mnModel);
     ~GovernanceModel() override;
     void setWalletModel(WalletModel* _walletModel);
 
-    // Return proposals ordered by net votes.
+    // Return proposals ordered by net votes, as of the last refresh.
     // By default, do not return zombie finished proposals that haven't been cleared yet (backend removal sources need a cleanup).
     std::list<ProposalInfo> getProposals(const ProposalInfo::Status* filterByStatus = nullptr, bool filterFinished = true);
+    // Refreshes the proposals on a worker thread, proposalsChanged is emitted on the GUI thread if they changed
+    void requestProposalsUpdate();
     // Returns true if there is at least one proposal cached
     bool hasProposals();
     // Whether a visual refresh is needed
@@ -141,19 +146,34 @@ public:
     // Stop internal timers
     void stop();
 
+Q_SIGNALS:
+    void proposalsChanged();
+
 public Q_SLOTS:
     void pollGovernanceChanged();
     void txLoaded(const QString& hash, const int txType, const int txStatus);
 
+private Q_SLOTS:
+    void applyPendingProposals();
+
 private:
     ClientModel* clientModel{nullptr};
     WalletModel* walletModel{nullptr};
     MNModel* mnModel{nullptr};
     std::atomic<bool> refreshNeeded{false};
 
-    // Cached amount
+    // Cached network proposals, ordered by net votes, and sum of the passing ones.
+    // Replaced on the GUI thread by the lists built by refreshPool.
+    std::vector<ProposalInfo> proposals;
     CAmount allocatedAmount{0};
 
+    // Single thread building the lists of requestProposalsUpdate
+    QThreadPool refreshPool;
+    std::atomic<bool> fRefreshPending{false};
+    Mutex cs_pending;
+    std::vector<ProposalInfo> pendingProposals GUARDED_BY(cs_pending);
+    CAmount pendingAllocatedAmount GUARDED_BY(cs_pending){0};
+
     QTimer* pollTimer{nullptr};
     // Cached proposals waiting for the minimum required confirmations
     // to be broadcasted to the network.
@@ -161,8 +181,10 @@ private:
 
     void scheduleBroadcast(const CBudgetProposal& proposal);
 
-    // Util function to create a ProposalInfo object
-    ProposalInfo buildProposalInfo(const CBudgetProposal* prop, bool isPassing, bool isPending);
+    // Hands the proposals built by a worker thread to the GUI thread
+    void postProposals(std::vector<ProposalInfo>&& props, CAmount allocated);
+
+    friend class ProposalsRefreshTask;
 };
 
 #endif // GOVERNANCEMODEL_H
@@ -126,10 +126,10 @@ MasterNodesWidget::MasterNodesWidget(PIVXGUI *parent) :
 
 void MasterNodesWidget::showEvent(QShowEvent *event)
 {
-    if (mnModel) mnModel->updateMNList();
+    if (mnModel) mnModel->requestMNListUpdate();
     if (!timer) {
         timer = new QTimer(this);
-        connect(timer, &QTimer::timeout, [this]() {mnModel->updateMNList();});
+        connect(timer, &QTimer::timeout, [this]() {mnModel->requestMNListUpdate();});
     }
     timer->start(30000);
 }
@@ -20,43 +20,151 @@
 #include <QFile>
 #include <QHostAddress>
 
-MNModel::MNModel(QObject *parent) : QAbstractTableModel(parent) {}
+#include <algorithm>
+
+// Builds the rows of the model, handing them to the model on the GUI thread
+class MNListRefreshTask : public QRunnable
+{
+public:
+    explicit MNListRefreshTask(MNModel* _model) : model(_model) {}
+    void run() override { model->postMNList(model->getMNList()); }
+
+private:
+    MNModel* model;
+};
+
+MNModel::MNModel(QObject *parent) : QAbstractTableModel(parent)
+{
+    refreshPool.setMaxThreadCount(1);
+}
+
+MNModel::~MNModel()
+{
+    refreshPool.waitForDone();
+}
 
 void MNModel::init()
 {
     updateMNList();
 }
 
-void MNModel::updateMNList()
+// The masternode of a configuration entry, looked up in the published network list (no lock of the manager)
+static bool BuildMNRow(const CMasternodeConfig::CMasternodeEntry& mne, const CMasternodeMan::MasternodeMap* mapMNs,
+                       WalletModel* walletModel, int mnMinConf, MNModelRow& row)
+{
+    int nIndex;
+    if (!mne.castOutputIndex(nIndex))
+        return false;
+    const uint256& txHash = uint256S(mne.getTxHash());
+    row.alias = QString::fromStdString(mne.getAlias());
+    row.ip = QString::fromStdString(mne.getIp());
+    row.collateral = COutPoint(txHash, uint32_t(nIndex));
+    row.privKey = QString::fromStdString(mne.getPrivKey());
+
+    MasternodeRef pmn;
+    if (mapMNs) {
+        auto it = mapMNs->find(row.collateral);
+        if (it != mapMNs->end()) pmn = it->second;
+    }
+    if (!pmn) {
+        pmn = std::make_shared<CMasternode>();
+        pmn->vin = CTxIn(row.collateral);
+    }
+    row.pubKey = QString::fromStdString(pmn->pubKeyMasternode.GetHash().GetHex());
+    row.activeState = pmn->GetActiveState();
+    std::string status = pmn->Status();
+    // Quick workaround to the current Masternode status types.
+    // If the status is REMOVE and there is no pubkey associated to the Masternode
+    // means that the MN is not in the network list. Which.. denotes a not started masternode.
+    // This will change in the future with the MasternodeWrapper introduction.
+    if (status == "REMOVE" && !pmn->pubKeyCollateralAddress.IsValid()) {
+        status = "MISSING";
+    }
+    row.status = QString::fromStdString(status);
+    row.collateralAccepted = walletModel && walletModel->getWalletTxDepth(txHash) >= mnMinConf;
+    return true;
+}
+
+std::vector<MNModelRow> MNModel::getMNList() const
 {
-    int mnMinConf = getMasternodeCollateralMinConf();
-    int end = nodes.size();
-    nodes.clear();
-    collateralTxAccepted.clear();
+    const int mnMinConf = Params().GetConsensus().MasternodeCollateralMinConf();
+    const auto mapMNs = mnodeman.GetMasternodeListSnapshot();
+    std::vector<MNModelRow> rows;
     for (const CMasternodeConfig::CMasternodeEntry& mne : masternodeConfig.getEntries()) {
-        int nIndex;
-        if (!mne.castOutputIndex(nIndex))
-            continue;
-        const uint256& txHash = uint256S(mne.getTxHash());
-        CTxIn txIn(txHash, uint32_t(nIndex));
-        CMasternode* pmn = mnodeman.Find(txIn.prevout);
-        if (!pmn) {
-            pmn = new CMasternode();
-            pmn->vin = txIn;
+        MNModelRow row;
+        if (BuildMNRow(mne, mapMNs.get(), walletModel, mnMinConf, row)) {
+            rows.emplace_back(std::move(row));
         }
-        nodes.insert(QString::fromStdString(mne.getAlias()), std::make_pair(QString::fromStdString(mne.getIp()), pmn));
-        if (walletModel) {
-            collateralTxAccepted.insert(mne.getTxHash(), walletModel->getWalletTxDepth(txHash) >= mnMinConf);
+    }
+    std::stable_sort(rows.begin(), rows.end(), [](const MNModelRow& a, const MNModelRow& b) { return a.alias < b.alias; });
+    // The aliases are unique
+    rows.erase(std::unique(rows.begin(), rows.end(), [](const MNModelRow& a, const MNModelRow& b) { return a.alias == b.alias; }), rows.end());
+    return rows;
+}
+
+void MNModel::updateMNList()
+{
+    applyMNList(getMNList());
+}
+
+void MNModel::requestMNListUpdate()
+{
+    // A single refresh at a time: the requests made in the meantime are served by the running one
+    if (fRefreshPending.exchange(true)) return;
+    refreshPool.start(new MNListRefreshTask(this));
+}
+
+void MNModel::postMNList(std::vector<MNModelRow>&& rows)
+{
+    WITH_LOCK(cs_pending, pendingNodes = std::move(rows));
+    QMetaObject::invokeMethod(this, "applyPendingMNList", Qt::QueuedConnection);
+}
+
+void MNModel::applyPendingMNList()
+{
+    std::vector<MNModelRow> rows;
+    {
+        LOCK(cs_pending);
+        rows = std::move(pendingNodes);
+        pendingNodes.clear();
+    }
+    fRefreshPending = false;
+    applyMNList(std::move(rows));
+}
+
+void MNModel::applyMNList(std::vector<MNModelRow>&& newNodes)
+{
+    // Both lists are sorted by alias: walk them together, removing, inserting and updating the rows in place
+    size_t i = 0;
+    size_t j = 0;
+    while (j < newNodes.size() || i < (size_t)rowCount()) {
+        const MNModelRow* row = WITH_LOCK(cs_nodes, return i < nodes.size() ? &nodes[i] : nullptr);
+        if (j == newNodes.size() || (row && row->alias < newNodes[j].alias)) {
+            beginRemoveRows(QModelIndex(), i, i);
+            WITH_LOCK(cs_nodes, nodes.erase(nodes.begin() + i));
+            endRemoveRows();
+        } else if (!row || newNodes[j].alias < row->alias) {
+            beginInsertRows(QModelIndex(), i, i);
+            WITH_LOCK(cs_nodes, nodes.insert(nodes.begin() + i, std::move(newNodes[j])));
+            endInsertRows();
+            i++;
+            j++;
+        } else {
+            if (*row != newNodes[j]) {
+                WITH_LOCK(cs_nodes, nodes[i] = std::move(newNodes[j]));
+                Q_EMIT dataChanged(index(i, 0, QModelIndex()), index(i, columnCount() - 1, QModelIndex()));
+            }
+            i++;
+            j++;
         }
     }
-    Q_EMIT dataChanged(index(0, 0, QModelIndex()), index(end, 5, QModelIndex()) );
 }
 
 int MNModel::rowCount(const QModelIndex &parent) const
 {
     if (parent.isValid())
         return 0;
-    return nodes.size();
+    return WITH_LOCK(cs_nodes, return nodes.size());
 }
 
 int MNModel::columnCount(const QModelIndex &parent) const
@@ -72,51 +180,28 @@ QVariant MNModel::data(const QModelIndex &index, int role) const
     if (!index.isValid())
             return QVariant();
 
-    // rec could be null, always verify it.
-    CMasternode* rec = static_cast<CMasternode*>(index.internalPointer());
-    bool isAvailable = rec;
-    int row = index.row();
+    LOCK(cs_nodes);
+    if (index.row() >= (int)nodes.size())
+        return QVariant();
+    const MNModelRow& rec = nodes[index.row()];
     if (role == Qt::DisplayRole || role == Qt::EditRole) {
         switch (index.column()) {
             case ALIAS:
-                return nodes.uniqueKeys().value(row);
+                return rec.alias;
             case ADDRESS:
-                return nodes.values().value(row).first;
+                return rec.ip;
             case PUB_KEY:
-                return (isAvailable) ? QString::fromStdString(nodes.values().value(row).second->pubKeyMasternode.GetHash().GetHex()) : "Not available";
+                return rec.pubKey;
             case COLLATERAL_ID:
-                return (isAvailable) ? QString::fromStdString(rec->vin.prevout.hash.GetHex()) : "Not available";
+                return QString::fromStdString(rec.collateral.hash.GetHex());
             case COLLATERAL_OUT_INDEX:
-                return (isAvailable) ? QString::number(rec->vin.prevout.n) : "Not available";
-            case STATUS: {
-                std::pair<QString, CMasternode*> pair = nodes.values().value(row);
-                std::string status = "MISSING";
-                if (pair.second) {
-                    status = pair.second->Status();
-                    // Quick workaround to the current Masternode status types.
-                    // If the status is REMOVE and there is no pubkey associated to the Masternode
-                    // means that the MN is not in the network list and was created in
-                    // updateMNList(). Which.. denotes a not started masternode.
-                    // This will change in the future with the MasternodeWrapper introduction.
-                    if (status == "REMOVE" && !pair.second->pubKeyCollateralAddress.IsValid()) {
-                        return "MISSING";
-                    }
-                }
-                return QString::fromStdString(status);
-            }
-            case PRIV_KEY: {
-                if (isAvailable) {
-                    for (CMasternodeConfig::CMasternodeEntry mne : masternodeConfig.getEntries()) {
-                        if (mne.getTxHash().compare(rec->vin.prevout.hash.GetHex()) == 0) {
-                            return QString::fromStdString(mne.getPrivKey());
-                        }
-                    }
-                }
-                return "Not available";
-            }
-            case WAS_COLLATERAL_ACCEPTED:{
-                return isAvailable && collateralTxAccepted.value(rec->vin.prevout.hash.GetHex());
-            }
+                return QString::number(rec.collateral.n);
+            case STATUS:
+                return rec.status;
+            case PRIV_KEY:
+                return rec.privKey;
+            case WAS_COLLATERAL_ACCEPTED:
+                return rec.collateralAccepted;
         }
     }
     return QVariant();
@@ -125,46 +210,46 @@ QVariant MNModel::data(const QModelIndex &index, int role) const
 QModelIndex MNModel::index(int row, int column, const QModelIndex& parent) const
 {
     Q_UNUSED(parent);
-    std::pair<QString, CMasternode*> pair = nodes.values().value(row);
-    CMasternode* data = pair.second;
-    if (data) {
-        return createIndex(row, column, data);
-    } else if (!pair.first.isEmpty()) {
-        return createIndex(row, column, nullptr);
-    } else {
+    if (row < 0 || row >= rowCount()) {
         return QModelIndex();
     }
+    return createIndex(row, column);
 }
 
 
 bool MNModel::removeMn(const QModelIndex& modelIndex)
 {
-    QString alias = modelIndex.data(Qt::DisplayRole).toString();
     int idx = modelIndex.row();
+    if (idx < 0 || idx >= rowCount()) return false;
     beginRemoveRows(QModelIndex(), idx, idx);
-    nodes.take(alias);
+    WITH_LOCK(cs_nodes, nodes.erase(nodes.begin() + idx));
     endRemoveRows();
-    Q_EMIT dataChanged(index(idx, 0, QModelIndex()), index(idx, 5, QModelIndex()) );
     return true;
 }
 
 bool MNModel::addMn(CMasternodeConfig::CMasternodeEntry* mne)
 {
-    beginInsertRows(QModelIndex(), nodes.size(), nodes.size());
-    int nIndex;
-    if (!mne->castOutputIndex(nIndex))
+    MNModelRow row;
+    if (!BuildMNRow(*mne, mnodeman.GetMasternodeListSnapshot().get(), walletModel, getMasternodeCollateralMinConf(), row))
         return false;
-
-    CMasternode* pmn = mnodeman.Find(COutPoint(uint256S(mne->getTxHash()), uint32_t(nIndex)));
-    nodes.insert(QString::fromStdString(mne->getAlias()), std::make_pair(QString::fromStdString(mne->getIp()), pmn));
+    int idx = 0;
+    {
+        LOCK(cs_nodes);
+        while (idx < (int)nodes.size() && nodes[idx].alias < row.alias) idx++;
+        if (idx < (int)nodes.size() && nodes[idx].alias == row.alias) return false;
+    }
+    beginInsertRows(QModelIndex(), idx, idx);
+    WITH_LOCK(cs_nodes, nodes.insert(nodes.begin() + idx, std::move(row)));
     endInsertRows();
     return true;
 }
 
 int MNModel::getMNState(const QString& mnAlias)
 {
-    QMap<QString, std::pair<QString, CMasternode*>>::const_iterator it = nodes.find(mnAlias);
-    if (it != nodes.end()) return it.value().second->GetActiveState();
+    LOCK(cs_nodes);
+    for (const MNModelRow& row : nodes) {
+        if (row.alias == mnAlias) return row.activeState;
+    }
     throw std::runtime_error(std::string("Masternode alias not found"));
 }
 
@@ -182,8 +267,10 @@ bool MNModel::isMNActive(const QString& mnAlias)
 
 bool MNModel::isMNCollateralMature(const QString& mnAlias)
 {
-    QMap<QString, std::pair<QString, CMasternode*>>::const_iterator it = nodes.find(mnAlias);
-    if (it != nodes.end()) return collateralTxAccepted.value(it.value().second->vin.prevout.hash.GetHex());
+    LOCK(cs_nodes);
+    for (const MNModelRow& row : nodes) {
+        if (row.alias == mnAlias) return row.collateralAccepted;
+    }
     throw std::runtime_error(std::string("Masternode alias not found"));
 }
 
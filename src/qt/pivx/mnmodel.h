@@ -6,21 +6,43 @@
 #define MNMODEL_H
 
 #include <QAbstractTableModel>
+#include <QThreadPool>
 #include "masternodeconfig.h"
 #include "qt/walletmodel.h"
+#include "sync.h"
+
+#include <atomic>
 
 class CMasternode;
 
+// A row of the model: a masternode of the configuration, with its state in the network list
+// when the row was built
+struct MNModelRow {
+    QString alias;
+    QString ip;
+    COutPoint collateral;
+    QString pubKey;
+    QString status;
+    int activeState{0};
+    QString privKey;
+    bool collateralAccepted{false};
+
+    bool operator==(const MNModelRow& other) const
+    {
+        return alias == other.alias && ip == other.ip && collateral == other.collateral &&
+               pubKey == other.pubKey && status == other.status && activeState == other.activeState &&
+               privKey == other.privKey && collateralAccepted == other.collateralAccepted;
+    }
+    bool operator!=(const MNModelRow& other) const { return !(*this == other); }
+};
+
 class MNModel : public QAbstractTableModel
 {
     Q_OBJECT
 
 public:
     explicit MNModel(QObject *parent);
-    ~MNModel() override {
-        nodes.clear();
-        collateralTxAccepted.clear();
-    }
+    ~MNModel() override;
     void init();
     void setWalletModel(WalletModel* _model) { walletModel = _model; };
 
@@ -43,7 +65,12 @@ public:
     QModelIndex index(int row, int column, const QModelIndex& parent) const override;
     bool removeMn(const QModelIndex& index);
     bool addMn(CMasternodeConfig::CMasternodeEntry* entry);
+    // Rebuilds the list on the calling thread
     void updateMNList();
+    // Rebuilds the list on a worker thread, the rows are updated on the GUI thread once it's done
+    void requestMNListUpdate();
+    // The rows of the configured masternodes, sorted by alias (thread safe)
+    std::vector<MNModelRow> getMNList() const;
 
 
     bool isMNsNetworkSynced();
@@ -80,12 +107,29 @@ public:
     void setCoinControl(CCoinControl* coinControl);
     void resetCoinControl();
 
+private Q_SLOTS:
+    void applyPendingMNList();
+
 private:
     WalletModel* walletModel;
     CCoinControl* coinControl;
-    // alias mn node ---> pair <ip, master node>
-    QMap<QString, std::pair<QString, CMasternode*>> nodes;
-    QMap<std::string, bool> collateralTxAccepted;
+    // Rows sorted by alias. Updated on the GUI thread only, locked for the readers of the other threads.
+    mutable Mutex cs_nodes;
+    std::vector<MNModelRow> nodes GUARDED_BY(cs_nodes);
+
+    // Single thread building the lists of requestMNListUpdate
+    QThreadPool refreshPool;
+    std::atomic<bool> fRefreshPending{false};
+    Mutex cs_pending;
+    std::vector<MNModelRow> pendingNodes GUARDED_BY(cs_pending);
+
+    std::vector<MNModelRow> buildMNList() const;
+    // Replaces the rows with the new list, notifying the views of the removed, inserted and changed rows only
+    void applyMNList(std::vector<MNModelRow>&& newNodes);
+    // Hands the list built by a worker thread to the GUI thread
+    void postMNList(std::vector<MNModelRow>&& rows);
+
+    friend class MNListRefreshTask;
 };
 
 #endif // MNMODEL_H
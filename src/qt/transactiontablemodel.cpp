@@ -10,6 +10,7 @@
 #include "guiconstants.h"
 #include "guiutil.h"
 #include "optionsmodel.h"
+#include "transactionfilterproxy.h"
 #include "transactionrecord.h"
 #include "walletmodel.h"
 
@@ -19,6 +20,8 @@
 #include "wallet/wallet.h"
 
 #include <algorithm>
+#include <atomic>
+#include <map>
 
 #include <QColor>
 #include <QDateTime>
@@ -26,7 +29,8 @@
 #include <QtConcurrent/QtConcurrent>
 #include <QFuture>
 
-#define SINGLE_THREAD_MAX_TXES_SIZE 4000
+// Amount of txes decomposed by each task of the first load, the records are added to the model chunk by chunk.
+#define LOAD_CHUNK_TXES_SIZE 1000
 
 // Maximum amount of loaded records in ram in the first load.
 // If the user has more and want to load them:
@@ -43,22 +47,6 @@ static int column_alignments[] = {
     Qt::AlignRight | Qt::AlignVCenter /* amount */
 };
 
-// Comparison operator for sort/binary search of model tx list
-struct TxLessThan {
-    bool operator()(const TransactionRecord& a, const TransactionRecord& b) const
-    {
-        return a.hash < b.hash;
-    }
-    bool operator()(const TransactionRecord& a, const uint256& b) const
-    {
-        return a.hash < b;
-    }
-    bool operator()(const uint256& a, const TransactionRecord& b) const
-    {
-        return a < b.hash;
-    }
-};
-
 struct ConvertTxToVectorResult
 {
     QList<TransactionRecord> records;
@@ -74,14 +62,21 @@ public:
     {
     }
 
+    ~TransactionTablePriv()
+    {
+        // The background load uses this object, stop it before going away
+        fInterruptLoad = true;
+        loadTask.waitForFinished();
+    }
+
     CWallet* wallet{nullptr};
     TransactionTableModel* parent;
 
-    /* Local cache of wallet.
-     * As it is in the same order as the CWallet, by definition
-     * this is sorted by sha256.
+    /* Local cache of wallet, in the order the records were loaded.
+     * The records of a transaction are contiguous, mapRecordRows holds the row of the first one.
      */
     QList<TransactionRecord> cachedWallet;
+    std::map<uint256, int> mapRecordRows;
 
     /**
      * Time of the oldest transaction loaded into the model.
@@ -89,79 +84,142 @@ public:
      */
     qint64 nFirstLoadedTxTime{0};
 
+    /* Background load of the wallet, see refreshWallet */
+    QFuture<void> loadTask;
+    std::atomic<bool> fInterruptLoad{false};
+    Mutex cs_loaded;
+    // Records built by the load tasks, waiting to be inserted by the GUI thread
+    ConvertTxToVectorResult loadedRecords GUARDED_BY(cs_loaded);
+
+    /* Per-day totals of the stake rewards of the records (staked amount, masternode rewards),
+     * maintained as the records are added, removed or change status, for the dashboard chart.
+     */
+    Mutex cs_stakes;
+    QMap<QDate, std::pair<qint64, qint64>> stakeAmountsByDay GUARDED_BY(cs_stakes);
+
+    static bool countsAsStakeReward(const TransactionRecord& rec)
+    {
+        return (rec.type == TransactionRecord::StakeMint || rec.type == TransactionRecord::Generated ||
+                rec.type == TransactionRecord::StakeZPIV || rec.type == TransactionRecord::StakeDelegated ||
+                rec.type == TransactionRecord::MNReward) &&
+               !TransactionFilterProxy::isOrphan(rec.status.status, rec.type);
+    }
+
+    void updateStakeAmounts(const TransactionRecord& rec, bool fAdd)
+    {
+        if (!countsAsStakeReward(rec)) return;
+        const qint64 amount = llabs(rec.credit + rec.debit) * (fAdd ? 1 : -1);
+        const QDate day = QDateTime::fromTime_t(static_cast<uint>(rec.time)).date();
+        LOCK(cs_stakes);
+        std::pair<qint64, qint64>& amounts = stakeAmountsByDay[day];
+        if (rec.type == TransactionRecord::MNReward) {
+            amounts.second += amount;
+        } else {
+            amounts.first += amount;
+        }
+        if (amounts.first == 0 && amounts.second == 0) {
+            stakeAmountsByDay.remove(day);
+        }
+    }
+
     /* Query entire wallet anew from core.
+     * The records are built in chunks by the thread pool, and inserted into the model
+     * by the GUI thread as they are ready (processLoadedRecords), so that it never waits
+     * for the whole wallet. finishLoadingRecords is called once everything is loaded.
      */
     void refreshWallet()
     {
         qDebug() << "TransactionTablePriv::refreshWallet";
         cachedWallet.clear();
+        mapRecordRows.clear();
+        {
+            LOCK(cs_stakes);
+            stakeAmountsByDay.clear();
+        }
+        loadTask = QtConcurrent::run(loadWalletRecords, this);
+    }
 
-        std::vector<CWalletTx> walletTxes = wallet->getWalletTxs();
+    static void loadWalletRecords(TransactionTablePriv* tablePriv)
+    {
+        std::vector<CWalletTx> walletTxes = tablePriv->wallet->getWalletTxs();
+
+        // First check if the amount of txs exceeds the UI limit
+        if (walletTxes.size() > MAX_AMOUNT_LOADED_RECORDS) {
+            // Only latest ones.
+            std::nth_element(walletTxes.begin(), walletTxes.begin() + MAX_AMOUNT_LOADED_RECORDS, walletTxes.end(),
+                    [](const CWalletTx & a, const CWalletTx & b) -> bool {
+                        return a.GetTxTime() > b.GetTxTime();
+                    });
+            walletTxes.erase(walletTxes.begin() + MAX_AMOUNT_LOADED_RECORDS, walletTxes.end());
+        }
 
-        // Divide the work between multiple threads to speedup the process if the vector is larger than 4k txes
-        std::size_t txesSize = walletTxes.size();
-        if (txesSize > SINGLE_THREAD_MAX_TXES_SIZE) {
+        // One task per chunk, run by the thread pool
+        QList<QFuture<void>> tasks;
+        for (std::size_t nStart = 0; nStart < walletTxes.size(); nStart += LOAD_CHUNK_TXES_SIZE) {
+            const std::size_t nEnd = std::min(walletTxes.size(), nStart + LOAD_CHUNK_TXES_SIZE);
+            tasks.append(QtConcurrent::run([tablePriv, &walletTxes, nStart, nEnd]() {
+                tablePriv->pushLoadedRecords(convertTxToRecords(tablePriv, tablePriv->wallet, walletTxes, nStart, nEnd));
+            }));
+        }
+        for (auto& future : tasks) {
+            future.waitForFinished();
+        }
 
-            // First check if the amount of txs exceeds the UI limit
-            if (txesSize > MAX_AMOUNT_LOADED_RECORDS) {
-                // Sort the txs by date
-                sort(walletTxes.begin(), walletTxes.end(),
-                        [](const CWalletTx & a, const CWalletTx & b) -> bool {
-                         return a.GetTxTime() > b.GetTxTime();
-                     });
+        if (!tablePriv->fInterruptLoad) {
+            QMetaObject::invokeMethod(tablePriv->parent, "finishLoadingRecords", Qt::QueuedConnection);
+        }
+    }
 
-                // Only latest ones.
-                walletTxes = std::vector<CWalletTx>(walletTxes.begin(), walletTxes.begin() + MAX_AMOUNT_LOADED_RECORDS);
-                txesSize = walletTxes.size();
+    /* Hand the records of a chunk to the GUI thread (called by the load tasks) */
+    void pushLoadedRecords(const ConvertTxToVectorResult& res)
+    {
+        if (res.records.isEmpty()) return;
+        bool fNotify;
+        {
+            LOCK(cs_loaded);
+            // A single call processes all the chunks queued until then
+            fNotify = loadedRecords.records.isEmpty();
+            loadedRecords.records.append(res.records);
+            if (loadedRecords.nFirstLoadedTxTime == 0 || loadedRecords.nFirstLoadedTxTime > res.nFirstLoadedTxTime) {
+                loadedRecords.nFirstLoadedTxTime = res.nFirstLoadedTxTime;
             }
+        }
+        if (fNotify) {
+            QMetaObject::invokeMethod(parent, "processLoadedRecords", Qt::QueuedConnection);
+        }
+    }
 
-            // Simple way to get the processors count
-            std::size_t threadsCount = (QThreadPool::globalInstance()->maxThreadCount() / 2 ) + 1;
-
-            // Size of the tx subsets
-            std::size_t const subsetSize = txesSize / (threadsCount + 1);
-            std::size_t totalSumSize = 0;
-            QList<QFuture<ConvertTxToVectorResult>> tasks;
-
-            // Subsets + run task
-            for (std::size_t i = 0; i < threadsCount; ++i) {
-                tasks.append(
-                        QtConcurrent::run(
-                                convertTxToRecords,
-                                this,
-                                wallet,
-                                std::vector<CWalletTx>(walletTxes.begin() + totalSumSize, walletTxes.begin() + totalSumSize + subsetSize)
-                        )
-                 );
-                totalSumSize += subsetSize;
-            }
+    /* Append the records loaded so far to the model (GUI thread) */
+    void insertLoadedRecords()
+    {
+        ConvertTxToVectorResult res;
+        {
+            LOCK(cs_loaded);
+            std::swap(res, loadedRecords);
+        }
+        if (res.records.isEmpty()) return;
 
-            // Now take the remaining ones and do the work here
-            std::size_t const remainingSize = txesSize - totalSumSize;
-            auto res = convertTxToRecords(this, wallet,
-                                              std::vector<CWalletTx>(walletTxes.end() - remainingSize, walletTxes.end())
-            );
-            cachedWallet.append(res.records);
+        if (nFirstLoadedTxTime == 0 || nFirstLoadedTxTime > res.nFirstLoadedTxTime) {
             nFirstLoadedTxTime = res.nFirstLoadedTxTime;
+        }
 
-            for (auto &future : tasks) {
-                future.waitForFinished();
-                ConvertTxToVectorResult convertRes = future.result();
-                cachedWallet.append(convertRes.records);
-                if (nFirstLoadedTxTime > convertRes.nFirstLoadedTxTime) {
-                    nFirstLoadedTxTime = convertRes.nFirstLoadedTxTime;
-                }
+        // Skip the transactions that a wallet notification already added during the load
+        QList<TransactionRecord> toInsert;
+        for (const auto& rec : res.records) {
+            if (!mapRecordRows.count(rec.hash)) {
+                toInsert.append(rec);
             }
-
-            // Now that all records have been cached, sort them by tx hash
-            std::sort(cachedWallet.begin(), cachedWallet.end(), TxLessThan());
-
-        } else {
-            // Single thread flow
-            ConvertTxToVectorResult convertRes = convertTxToRecords(this, wallet, walletTxes);
-            cachedWallet.append(convertRes.records);
-            nFirstLoadedTxTime = convertRes.nFirstLoadedTxTime;
         }
+        if (toInsert.isEmpty()) return;
+
+        const int firstRow = cachedWallet.size();
+        parent->beginInsertRows(QModelIndex(), firstRow, firstRow + toInsert.size() - 1);
+        for (const TransactionRecord& rec : toInsert) {
+            mapRecordRows.emplace(rec.hash, cachedWallet.size());
+            cachedWallet.append(rec);
+            updateStakeAmounts(rec, true);
+        }
+        parent->endInsertRows();
     }
 
     void emitTxLoaded(const TransactionRecord& rec)
@@ -172,11 +230,13 @@ public:
 
     static ConvertTxToVectorResult convertTxToRecords(TransactionTablePriv* tablePriv,
                                                       const CWallet* wallet,
-                                                      const std::vector<CWalletTx>& walletTxes)
+                                                      const std::vector<CWalletTx>& walletTxes,
+                                                      std::size_t nStart,
+                                                      std::size_t nEnd)
     {
         ConvertTxToVectorResult res;
-        for (const auto& tx : walletTxes) {
-            QList<TransactionRecord> records = TransactionRecord::decomposeTransaction(wallet, tx);
+        for (std::size_t i = nStart; i < nEnd && !tablePriv->fInterruptLoad; i++) {
+            QList<TransactionRecord> records = TransactionRecord::decomposeTransaction(wallet, walletTxes[i]);
             if (records.isEmpty()) continue;
             qint64 time = records.first().time;
             if (res.nFirstLoadedTxTime == 0 || res.nFirstLoadedTxTime > time) {
@@ -200,13 +260,13 @@ public:
         qDebug() << "TransactionTablePriv::updateWallet : " + QString::fromStdString(hash.ToString()) + " " + QString::number(status);
 
         // Find bounds of this transaction in model
-        QList<TransactionRecord>::iterator lower = std::lower_bound(
-            cachedWallet.begin(), cachedWallet.end(), hash, TxLessThan());
-        QList<TransactionRecord>::iterator upper = std::upper_bound(
-            cachedWallet.begin(), cachedWallet.end(), hash, TxLessThan());
-        int lowerIndex = (lower - cachedWallet.begin());
-        int upperIndex = (upper - cachedWallet.begin());
-        bool inModel = (lower != upper);
+        auto it = mapRecordRows.find(hash);
+        bool inModel = (it != mapRecordRows.end());
+        int lowerIndex = inModel ? it->second : cachedWallet.size();
+        int upperIndex = lowerIndex;
+        while (upperIndex < cachedWallet.size() && cachedWallet[upperIndex].hash == hash) {
+            upperIndex++;
+        }
 
         if (status == CT_UPDATED) {
             if (showTransaction && !inModel)
@@ -239,15 +299,15 @@ public:
                         return;
                     }
 
-                    // Added -- insert at the right position
+                    // Added -- append the records, the views sort them
                     QList<TransactionRecord> toInsert =
                         TransactionRecord::decomposeTransaction(wallet, *wtx);
                     if (!toInsert.isEmpty()) { /* only if something to insert */
                         parent->beginInsertRows(QModelIndex(), lowerIndex, lowerIndex + toInsert.size() - 1);
-                        int insert_idx = lowerIndex;
+                        mapRecordRows.emplace(hash, lowerIndex);
                         for (const TransactionRecord& rec : toInsert) {
-                            cachedWallet.insert(insert_idx, rec);
-                            insert_idx += 1;
+                            cachedWallet.append(rec);
+                            updateStakeAmounts(rec, true);
                             ret = rec; // Return record
                         }
                         parent->endInsertRows();
@@ -261,7 +321,14 @@ public:
                 }
                 // Removed -- remove entire transaction from table
                 parent->beginRemoveRows(QModelIndex(), lowerIndex, upperIndex - 1);
-                cachedWallet.erase(lower, upper);
+                for (int i = lowerIndex; i < upperIndex; i++) {
+                    updateStakeAmounts(cachedWallet[i], false);
+                }
+                cachedWallet.erase(cachedWallet.begin() + lowerIndex, cachedWallet.begin() + upperIndex);
+                mapRecordRows.erase(it);
+                for (auto& entry : mapRecordRows) {
+                    if (entry.second > lowerIndex) entry.second -= (upperIndex - lowerIndex);
+                }
                 parent->endRemoveRows();
                 break;
             case CT_UPDATED:
@@ -280,6 +347,24 @@ public:
         return cachedWallet.size();
     }
 
+    /* Ranges of rows whose status can still change with new blocks: the records that aren't
+     * confirmed yet, and the ones flagged by a wallet update (e.g. disconnected by a reorg).
+     */
+    std::vector<std::pair<int, int>> pendingStatusRanges() const
+    {
+        std::vector<std::pair<int, int>> ranges;
+        for (int i = 0; i < cachedWallet.size(); i++) {
+            const TransactionRecord& rec = cachedWallet[i];
+            if (rec.status.status == TransactionStatus::Confirmed && !rec.status.needsUpdate) continue;
+            if (!ranges.empty() && ranges.back().second == i - 1) {
+                ranges.back().second = i;
+            } else {
+                ranges.emplace_back(i, i);
+            }
+        }
+        return ranges;
+    }
+
     TransactionRecord* index(int cur_block_num, const uint256& cur_block_hash, int idx)
     {
         if (idx >= 0 && idx < cachedWallet.size()) {
@@ -292,7 +377,10 @@ public:
                 if (lockWallet) {
                     auto mi = wallet->mapWallet.find(rec->hash);
                     if (mi != wallet->mapWallet.end()) {
+                        // The status decides whether a stake is counted (orphans aren't)
+                        updateStakeAmounts(*rec, false);
                         rec->updateStatus(mi->second, cur_block_num);
+                        updateStakeAmounts(*rec, true);
                     }
                 }
             }
@@ -348,10 +436,42 @@ void TransactionTableModel::updateConfirmations()
 {
     // Blocks came in since last poll.
     // Invalidate status (number of confirmations) and (possibly) description
-    //  for all rows. Qt is smart enough to only actually request the data for the
-    //  visible rows.
-    Q_EMIT dataChanged(index(0, Status), index(priv->size() - 1, Status));
-    Q_EMIT dataChanged(index(0, ToAddress), index(priv->size() - 1, ToAddress));
+    //  for the rows whose status can change. Qt is smart enough to only actually
+    //  request the data for the visible rows, but the filter proxies re-check every
+    //  changed row, so the confirmed ones are left alone: their number of confirmations
+    //  is refreshed when they are read (see TransactionTablePriv::index).
+    for (const auto& range : priv->pendingStatusRanges()) {
+        Q_EMIT dataChanged(index(range.first, Status), index(range.second, Status));
+        Q_EMIT dataChanged(index(range.first, ToAddress), index(range.second, ToAddress));
+    }
+}
+
+void TransactionTableModel::processLoadedRecords()
+{
+    // The records of the first load aren't incoming transactions, don't notify them
+    bool fWasProcessing = fProcessingQueuedTransactions;
+    fProcessingQueuedTransactions = true;
+    priv->insertLoadedRecords();
+    fProcessingQueuedTransactions = fWasProcessing;
+}
+
+void TransactionTableModel::finishLoadingRecords()
+{
+    processLoadedRecords();
+    Q_EMIT txLoadingFinished();
+}
+
+QMap<QDate, std::pair<qint64, qint64>> TransactionTableModel::getStakeAmountsByDay(const QDate& from, const QDate& to) const
+{
+    QMap<QDate, std::pair<qint64, qint64>> ret;
+    LOCK(priv->cs_stakes);
+    const auto& amounts = priv->stakeAmountsByDay;
+    auto it = from.isNull() ? amounts.begin() : amounts.lowerBound(from);
+    auto end = to.isNull() ? amounts.end() : amounts.upperBound(to);
+    for (; it != end; ++it) {
+        ret.insert(it.key(), it.value());
+    }
+    return ret;
 }
 
 int TransactionTableModel::rowCount(const QModelIndex& parent) const
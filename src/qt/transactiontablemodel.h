@@ -9,6 +9,8 @@
 #include "bitcoinunits.h"
 
 #include <QAbstractTableModel>
+#include <QDate>
+#include <QMap>
 #include <QStringList>
 
 #include <memory>
@@ -82,10 +84,15 @@ public:
     QVariant headerData(int section, Qt::Orientation orientation, int role) const override;
     QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const override;
     bool processingQueuedTransactions() const { return fProcessingQueuedTransactions; }
+    /** Per-day totals of the stake rewards (staked amount, masternode rewards) from the day from to the day to
+        included, a null date leaving the range open. Orphaned stakes aren't counted. Can be called from any thread. */
+    QMap<QDate, std::pair<qint64, qint64>> getStakeAmountsByDay(const QDate& from, const QDate& to) const;
 
 Q_SIGNALS:
     // Emitted only during startup when records gets parsed
     void txLoaded(const QString& hash, const int txType, const int txStatus);
+    // Emitted once all the records of the startup load are in the model
+    void txLoadingFinished();
     // Emitted when a transaction that belongs to this wallet gets connected to the chain and/or committed locally.
     void txArrived(const QString& hash, const bool isCoinStake, const bool isMNReward, const bool isCSAnyType);
 
@@ -124,6 +131,9 @@ public Q_SLOTS:
     void updateAmountColumnTitle();
     /* Needed to update fProcessingQueuedTransactions through a QueuedConnection */
     void setProcessingQueuedTransactions(bool value) { fProcessingQueuedTransactions = value; }
+    /* Insert the records built by the background load, called through a QueuedConnection */
+    void processLoadedRecords();
+    void finishLoadingRecords();
 
     friend class TransactionTablePriv;
 };
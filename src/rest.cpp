@@ -9,6 +9,7 @@
 #include "primitives/block.h"
 #include "primitives/transaction.h"
 #include "httpserver.h"
+#include "index/compactsaplingindex.h"
 #include "rpc/server.h"
 #include "streams.h"
 #include "sync.h"
@@ -177,6 +178,138 @@ static bool rest_headers(HTTPRequest* req,
     }
 }
 
+static bool rest_blockrange(HTTPRequest* req,
+                            const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::vector<std::string> params;
+    const RetFormat rf = ParseDataFormat(params, strURIPart);
+    if (rf != RF_BINARY)
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: .bin)");
+
+    std::vector<std::string> path;
+    boost::split(path, params[0], boost::is_any_of("/"));
+    if (path.size() != 2)
+        return RESTERR(req, HTTP_BAD_REQUEST, "No block range specified. Use /rest/blockrange/<start>/<count>.bin.");
+
+    int start;
+    if (!ParseInt32(path[0], &start) || start < 0)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid start height: " + path[0]);
+    int count;
+    if (!ParseInt32(path[1], &count) || count < 1 || count > 2000)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Block count out of range: " + path[1]);
+
+    // The positions of the blocks on disk, streamed as they are stored (the disk and the network
+    // serializations of the blocks are the same)
+    std::vector<FlatFilePos> positions;
+    positions.reserve(count);
+    {
+        LOCK(cs_main);
+        for (const CBlockIndex* pindex = chainActive[start]; pindex != nullptr && positions.size() < (size_t)count;
+                pindex = chainActive.Next(pindex)) {
+            if (!(pindex->nStatus & BLOCK_HAVE_DATA))
+                return RESTERR(req, HTTP_NOT_FOUND, pindex->GetBlockHash().GetHex() + " not available (pruned data)");
+            positions.emplace_back(pindex->GetBlockPos());
+        }
+    }
+    if (positions.empty())
+        return RESTERR(req, HTTP_NOT_FOUND, "Start height out of range: " + path[0]);
+
+    req->WriteHeader("Content-Type", "application/octet-stream");
+    size_t nSent = 0;
+    for (FlatFilePos pos : positions) {
+        // Each block is preceded by the message start and its size
+        pos.nPos -= sizeof(uint32_t);
+        FILE* file = OpenBlockFile(pos, true);
+        uint32_t nSize = 0;
+        if (!file || fread(&nSize, 1, sizeof(nSize), file) != sizeof(nSize)) {
+            if (file) fclose(file);
+            LogPrintf("%s: unable to read the block at %s\n", __func__, pos.ToString());
+            break;
+        }
+        if (!req->WriteReplyFileChunk(HTTP_OK, file, le32toh(nSize))) {
+            LogPrintf("%s: unable to send the block at %s\n", __func__, pos.ToString());
+            break;
+        }
+        nSent++;
+    }
+    if (nSent == 0)
+        return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, "Unable to read the blocks");
+    // A truncated reply if a block couldn't be read, once the streaming is started
+    req->EndChunkedReply();
+    return true;
+}
+
+static bool rest_compactsaplingblocks(HTTPRequest* req,
+                                      const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    if (!g_compactsaplingindex)
+        return RESTERR(req, HTTP_NOT_FOUND, "The compact sapling index is not enabled (-compactsaplingindex)");
+    std::vector<std::string> params;
+    const RetFormat rf = ParseDataFormat(params, strURIPart);
+
+    std::vector<std::string> path;
+    boost::split(path, params[0], boost::is_any_of("/"));
+    if (path.size() != 2)
+        return RESTERR(req, HTTP_BAD_REQUEST, "No block range specified. Use /rest/compactsaplingblocks/<start>/<count>.<ext>.");
+
+    int start;
+    if (!ParseInt32(path[0], &start) || start < 0)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid start height: " + path[0]);
+    int count;
+    if (!ParseInt32(path[1], &count) || count < 1 || count > MAX_COMPACT_SAPLING_BLOCKS)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Block count out of range: " + path[1]);
+
+    std::vector<const CBlockIndex*> vIndex;
+    {
+        LOCK(cs_main);
+        for (const CBlockIndex* pindex = chainActive[start]; pindex != nullptr && vIndex.size() < (size_t)count;
+                pindex = chainActive.Next(pindex)) {
+            vIndex.emplace_back(pindex);
+        }
+    }
+    if (vIndex.empty())
+        return RESTERR(req, HTTP_NOT_FOUND, "Start height out of range: " + path[0]);
+
+    std::vector<CompactSaplingBlock> blocks;
+    if (!g_compactsaplingindex->LookupBlocks(vIndex, blocks))
+        return RESTERR(req, HTTP_SERVICE_UNAVAILABLE, "The compact sapling index is not in sync with the start height yet");
+
+    switch (rf) {
+    case RF_BINARY:
+    case RF_HEX: {
+        // Each compact block is sent in its own chunk, as it's serialized
+        req->WriteHeader("Content-Type", rf == RF_BINARY ? "application/octet-stream" : "text/plain");
+        for (const CompactSaplingBlock& block : blocks) {
+            CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+            ss << block;
+            std::string chunk = rf == RF_BINARY ? ss.str() : HexStr(ss) + "\n";
+            req->WriteReplyChunk(HTTP_OK, std::move(chunk));
+        }
+        req->EndChunkedReply();
+        return true;
+    }
+
+    case RF_JSON: {
+        UniValue jsonBlocks(UniValue::VARR);
+        for (const CompactSaplingBlock& block : blocks) {
+            jsonBlocks.push_back(CompactSaplingBlockToJSON(block));
+        }
+        std::string strJSON = jsonBlocks.write() + "\n";
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, strJSON);
+        return true;
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+}
+
 static bool rest_block(HTTPRequest* req,
                        const std::string& strURIPart,
                        bool showTxDetails)
@@ -560,6 +693,57 @@ static bool rest_getutxos(HTTPRequest* req, const std::string& strURIPart)
     }
 }
 
+UniValue getaddressbalance(const JSONRPCRequest& request);
+UniValue getaddresstxids(const JSONRPCRequest& request);
+UniValue getaddressutxos(const JSONRPCRequest& request);
+
+/** Serve a /rest/address/<query>/<address>.json request from the address index rpc call rpcQuery */
+static bool rest_address(HTTPRequest* req, const std::string& strURIPart, UniValue (*rpcQuery)(const JSONRPCRequest&))
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::vector<std::string> params;
+    const RetFormat rf = ParseDataFormat(params, strURIPart);
+
+    switch (rf) {
+    case RF_JSON: {
+        if (!fAddressIndex)
+            return RESTERR(req, HTTP_NOT_FOUND, "Address index not enabled (use -addressindex)");
+        JSONRPCRequest jsonRequest;
+        jsonRequest.params = UniValue(UniValue::VARR);
+        jsonRequest.params.push_back(params[0]);
+        UniValue result;
+        try {
+            result = rpcQuery(jsonRequest);
+        } catch (const UniValue& objError) {
+            return RESTERR(req, HTTP_BAD_REQUEST, find_value(objError, "message").get_str());
+        }
+        std::string strJSON = result.write() + "\n";
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, strJSON);
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: json)");
+    }
+    }
+}
+
+static bool rest_address_balance(HTTPRequest* req, const std::string& strURIPart)
+{
+    return rest_address(req, strURIPart, getaddressbalance);
+}
+
+static bool rest_address_txids(HTTPRequest* req, const std::string& strURIPart)
+{
+    return rest_address(req, strURIPart, getaddresstxids);
+}
+
+static bool rest_address_utxos(HTTPRequest* req, const std::string& strURIPart)
+{
+    return rest_address(req, strURIPart, getaddressutxos);
+}
+
 static const struct {
     const char* prefix;
     bool (*handler)(HTTPRequest* req, const std::string& strReq);
@@ -571,13 +755,19 @@ static const struct {
       {"/rest/mempool/info", rest_mempool_info},
       {"/rest/mempool/contents", rest_mempool_contents},
       {"/rest/headers/", rest_headers},
+      {"/rest/blockrange/", rest_blockrange},
+      {"/rest/compactsaplingblocks/", rest_compactsaplingblocks},
       {"/rest/getutxos", rest_getutxos},
+      {"/rest/address/balance/", rest_address_balance},
+      {"/rest/address/txids/", rest_address_txids},
+      {"/rest/address/utxos/", rest_address_utxos},
 };
 
 bool StartREST()
 {
     for (unsigned int i = 0; i < ARRAYLEN(uri_prefixes); i++)
-        RegisterHTTPHandler(uri_prefixes[i].prefix, false, uri_prefixes[i].handler);
+        RegisterHTTPHandler(uri_prefixes[i].prefix, false, uri_prefixes[i].handler,
+                            [](HTTPRequest*, const std::string&) { return HTTPWorkQueueId::READ; });
     return true;
 }
 
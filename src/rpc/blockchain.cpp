@@ -11,7 +11,11 @@
 #include "clientversion.h"
 #include "consensus/upgrades.h"
 #include "core_io.h"
+#include "crypto/muhash.h"
+#include "ctpl_stl.h"
 #include "hash.h"
+#include "index/blockfilterindex.h"
+#include "index/compactsaplingindex.h"
 #include "kernel.h"
 #include "key_io.h"
 #include "llmq/quorums_chainlocks.h"
@@ -20,11 +24,13 @@
 #include "policy/policy.h"
 #include "rpc/server.h"
 #include "script/descriptor.h"
+#include "shutdown.h"
 #include "sync.h"
 #include "txdb.h"
 #include "util/system.h"
 #include "utilmoneystr.h"
 #include "utilstrencodings.h"
+#include "utxo_snapshot.h"
 #include "validation.h"
 #include "validationinterface.h"
 #include "wallet/wallet.h"
@@ -208,8 +214,8 @@ UniValue getblockcount(const JSONRPCRequest& request)
             "\nExamples:\n" +
             HelpExampleCli("getblockcount", "") + HelpExampleRpc("getblockcount", ""));
 
-    LOCK(cs_main);
-    return chainActive.Height();
+    const auto tip = GetChainTipSnapshot();
+    return tip ? tip->nHeight : -1;
 }
 
 UniValue getbestblockhash(const JSONRPCRequest& request)
@@ -225,8 +231,11 @@ UniValue getbestblockhash(const JSONRPCRequest& request)
             "\nExamples\n" +
             HelpExampleCli("getbestblockhash", "") + HelpExampleRpc("getbestblockhash", ""));
 
-    LOCK(cs_main);
-    return chainActive.Tip()->GetBlockHash().GetHex();
+    const auto tip = GetChainTipSnapshot();
+    if (!tip) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Chain tip not loaded");
+    }
+    return tip->hash.GetHex();
 }
 
 UniValue getbestsaplinganchor(const JSONRPCRequest& request)
@@ -399,8 +408,8 @@ UniValue getdifficulty(const JSONRPCRequest& request)
             "\nExamples:\n" +
             HelpExampleCli("getdifficulty", "") + HelpExampleRpc("getdifficulty", ""));
 
-    LOCK(cs_main);
-    return GetDifficulty();
+    const auto tip = GetChainTipSnapshot();
+    return tip ? GetDifficulty(tip->pindex) : 1.0;
 }
 
 static std::string EntryDescriptionString()
@@ -672,20 +681,175 @@ UniValue getblockheader(const JSONRPCRequest& request)
     return blockheaderToJSON(chainActive.Tip(), pblockindex);
 }
 
+UniValue getblockfilter(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw std::runtime_error(
+            "getblockfilter \"blockhash\" ( \"filtertype\" )\n"
+            "\nRetrieve a BIP 157 content filter for a particular block.\n"
+            "It requires the index of the filter type to be enabled with -blockfilterindex.\n"
+
+            "\nArguments:\n"
+            "1. \"blockhash\"     (string, required) The hash of the block\n"
+            "2. \"filtertype\"    (string, optional, default=basic) The type name of the filter\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"filter\" : \"xxxx\", (string) the hex-encoded filter data\n"
+            "  \"header\" : \"xxxx\"  (string) the hex-encoded filter header\n"
+            "}\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("getblockfilter", "\"00000000000fd08c2fb661d2fcb0d49abb3a91e5f27082ce64feed3b4dede2e2\" \"basic\"") +
+            HelpExampleRpc("getblockfilter", "\"00000000000fd08c2fb661d2fcb0d49abb3a91e5f27082ce64feed3b4dede2e2\", \"basic\""));
+
+    uint256 block_hash(ParseHashV(request.params[0], "blockhash"));
+    std::string filtertype_name = "basic";
+    if (request.params.size() > 1)
+        filtertype_name = request.params[1].get_str();
+
+    BlockFilterType filtertype;
+    if (!BlockFilterTypeByName(filtertype_name, filtertype))
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown filtertype");
+
+    BlockFilterIndex* index = GetBlockFilterIndex(filtertype);
+    if (!index)
+        throw JSONRPCError(RPC_MISC_ERROR, "Index is not enabled for filtertype " + filtertype_name);
+
+    const CBlockIndex* block_index;
+    bool block_was_connected;
+    {
+        LOCK(cs_main);
+        block_index = LookupBlockIndex(block_hash);
+        if (!block_index)
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+        block_was_connected = block_index->IsValid(BLOCK_VALID_SCRIPTS);
+    }
+
+    bool index_ready = index->BlockUntilSyncedToCurrentChain();
+
+    BlockFilter filter;
+    uint256 filter_header;
+    if (!index->LookupFilter(block_index, filter) ||
+        !index->LookupFilterHeader(block_index, filter_header)) {
+        int err_code;
+        std::string errmsg = "Filter not found.";
+
+        if (!block_was_connected) {
+            err_code = RPC_INVALID_ADDRESS_OR_KEY;
+            errmsg += " Block was not connected to active chain.";
+        } else if (!index_ready) {
+            err_code = RPC_MISC_ERROR;
+            errmsg += " Block filters are still in the process of being indexed.";
+        } else {
+            err_code = RPC_INTERNAL_ERROR;
+            errmsg += " This error is unexpected and indicates index corruption.";
+        }
+
+        throw JSONRPCError(err_code, errmsg);
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("filter", HexStr(filter.GetEncodedFilter()));
+    ret.pushKV("header", filter_header.GetHex());
+    return ret;
+}
+
+UniValue getcompactsaplingblocks(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 3)
+        throw std::runtime_error(
+            "getcompactsaplingblocks startheight ( count verbose )\n"
+            "\nReturns the compact shielded blocks of the active chain from height startheight, for the light wallets\n"
+            "to trial-decrypt the shielded outputs without downloading the full blocks.\n"
+            "It requires the compact sapling index (-compactsaplingindex).\n"
+
+            "\nArguments:\n"
+            "1. startheight    (numeric, required) The height of the first block\n"
+            "2. count          (numeric, optional, default=1) The number of blocks (up to " + std::to_string(MAX_COMPACT_SAPLING_BLOCKS) + ")\n"
+            "3. verbose        (boolean, optional, default=true) True for json objects, false for the hex encoded data\n"
+
+            "\nResult (for verbose = true):\n"
+            "[\n"
+            "  {\n"
+            "    \"height\" : n,                  (numeric) The block height\n"
+            "    \"hash\" : \"hash\",               (string) The block hash\n"
+            "    \"previousblockhash\" : \"hash\",  (string) The hash of the previous block\n"
+            "    \"time\" : ttt,                  (numeric) The block time in seconds since epoch (Jan 1 1970 GMT)\n"
+            "    \"finalsaplingroot\" : \"hash\",   (string) The root of the Sapling commitment tree after the block\n"
+            "    \"tx\" : [                       (array) The transactions with Sapling spends or outputs\n"
+            "      {\n"
+            "        \"index\" : n,               (numeric) The position of the transaction in the block\n"
+            "        \"txid\" : \"hash\",           (string) The transaction id\n"
+            "        \"nullifiers\" : [ \"hash\", ... ], (array) The nullifiers of the spent notes\n"
+            "        \"outputs\" : [\n"
+            "          {\n"
+            "            \"cmu\" : \"hex\",          (string) The note commitment\n"
+            "            \"ephemeralKey\" : \"hex\", (string) The ephemeral key\n"
+            "            \"ciphertext\" : \"hex\"    (string) The first 52 bytes of the note ciphertext\n"
+            "          }, ...\n"
+            "        ]\n"
+            "      }, ...\n"
+            "    ]\n"
+            "  }, ...\n"
+            "]\n"
+
+            "\nResult (for verbose = false):\n"
+            "[ \"data\", ... ]    (array) The serialized, hex-encoded compact blocks\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("getcompactsaplingblocks", "2700500 100") + HelpExampleRpc("getcompactsaplingblocks", "2700500, 100"));
+
+    if (!g_compactsaplingindex)
+        throw JSONRPCError(RPC_MISC_ERROR, "The compact sapling index is not enabled (-compactsaplingindex)");
+
+    const int nStart = request.params[0].get_int();
+    const int nCount = request.params.size() > 1 ? request.params[1].get_int() : 1;
+    if (nCount < 1 || nCount > MAX_COMPACT_SAPLING_BLOCKS)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Block count out of range");
+    const bool fVerbose = request.params.size() > 2 ? request.params[2].get_bool() : true;
+
+    std::vector<const CBlockIndex*> vIndex;
+    {
+        LOCK(cs_main);
+        if (nStart < 0 || nStart > chainActive.Height())
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Start height out of range");
+        for (const CBlockIndex* pindex = chainActive[nStart]; pindex && vIndex.size() < (size_t)nCount; pindex = chainActive.Next(pindex)) {
+            vIndex.emplace_back(pindex);
+        }
+    }
+
+    std::vector<CompactSaplingBlock> blocks;
+    if (!g_compactsaplingindex->LookupBlocks(vIndex, blocks))
+        throw JSONRPCError(RPC_MISC_ERROR, "The compact sapling index is not in sync with the start height yet");
+
+    UniValue result(UniValue::VARR);
+    for (const CompactSaplingBlock& block : blocks) {
+        if (fVerbose) {
+            result.push_back(CompactSaplingBlockToJSON(block));
+        } else {
+            CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+            ss << block;
+            result.push_back(HexStr(ss));
+        }
+    }
+    return result;
+}
+
 UniValue getsupplyinfo(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() > 1)
         throw std::runtime_error(
             "getsupplyinfo ( force_update )\n"
-            "\nIf force_update=false (default if no argument is given): return the last cached money supply"
+            "\nIf force_update=false (default if no argument is given): return the money supply"
             "\n(sum of spendable transaction outputs) and the height of the chain when it was last updated"
-            "\n(it is updated periodically, whenever the chainstate is flushed)."
+            "\n(it is updated with each block connected or disconnected)."
             "\n"
-            "\nIf force_update=true: Flush the chainstate to disk and return the money supply updated to"
-            "\nthe current chain height.\n"
+            "\nIf force_update=true: Flush the chainstate to disk and audit the money supply, summing all"
+            "\nthe unspent outputs at the current chain height (slow).\n"
 
             "\nArguments:\n"
-            "1. force_update       (boolean, optional, default=false) flush chainstate to disk and update cache\n"
+            "1. force_update       (boolean, optional, default=false) flush chainstate to disk and sum the UTXO set\n"
 
             "\nResult:\n"
             "{\n"
@@ -702,8 +866,10 @@ UniValue getsupplyinfo(const JSONRPCRequest& request)
     const bool fForceUpdate = request.params.size() > 0 ? request.params[0].get_bool() : false;
 
     if (fForceUpdate) {
-        // Flush state to disk (which updates the cached supply)
+        // Flush state to disk, and sum the flushed UTXO set
+        LOCK(cs_main);
         FlushStateToDisk();
+        LoadMoneySupply(true);
     }
 
     UniValue ret(UniValue::VOBJ);
@@ -746,18 +912,36 @@ static void ApplyStats(CCoinsStats &stats, CHashWriter& ss, const uint256& hash,
     ss << VARINT(0u);
 }
 
+/**
+ * Set the height of the best block of the stats, taken from the cursors. The cursors must be created under the same
+ * lock of cs_main as the (full) flush of the chainstate before them: a background flush only starts under cs_main, so
+ * none can be writing to the database when they're taken.
+ */
+static bool SetUTXOStatsHeight(CCoinsStats& stats) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    AssertLockHeld(cs_main);
+    const CBlockIndex* pindex = LookupBlockIndex(stats.hashBlock);
+    if (!pindex) {
+        return error("%s: best block %s of the coins database not found", __func__, stats.hashBlock.GetHex());
+    }
+    stats.nHeight = pindex->nHeight;
+    return true;
+}
+
 //! Calculate statistics about the unspent transaction output set
 static bool GetUTXOStats(CCoinsView *view, CCoinsStats &stats)
 {
-    std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor());
-    assert(pcursor);
-
-    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
-    stats.hashBlock = pcursor->GetBestBlock();
+    std::unique_ptr<CCoinsViewCursor> pcursor;
     {
         LOCK(cs_main);
-        stats.nHeight = LookupBlockIndex(stats.hashBlock)->nHeight;
+        FlushStateToDisk();
+        pcursor.reset(view->Cursor());
+        assert(pcursor);
+        stats.hashBlock = pcursor->GetBestBlock();
+        if (!SetUTXOStatsHeight(stats)) return false;
     }
+
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
     ss << stats.hashBlock;
     uint256 prevkey;
     std::map<uint32_t, Coin> outputs;
@@ -785,13 +969,92 @@ static bool GetUTXOStats(CCoinsView *view, CCoinsStats &stats)
     return true;
 }
 
+//! Max number of threads reading the UTXO set in parallel (gettxoutsetinfo)
+static const int MAX_UTXO_STATS_THREADS = 16;
+
+//! Calculate the statistics, and the MuHash if fMuHash, of the coins of a range of the UTXO set
+static bool GetUTXORangeStats(CCoinsViewCursor* pcursor, bool fMuHash, CCoinsStats& stats, MuHash3072& muhash)
+{
+    uint256 prevkey;
+    while (pcursor->Valid()) {
+        if (ShutdownRequested()) return false;
+        COutPoint key;
+        Coin coin;
+        if (!pcursor->GetKey(key) || !pcursor->GetValue(coin)) {
+            return error("%s: unable to read value", __func__);
+        }
+        if (stats.nTransactionOutputs == 0 || key.hash != prevkey) {
+            stats.nTransactions++;
+            prevkey = key.hash;
+        }
+        stats.nTransactionOutputs++;
+        stats.nTotalAmount += coin.out.nValue;
+        if (fMuHash) {
+            CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+            ss << key << (uint32_t)(coin.nHeight * 4 + (coin.fCoinBase ? 2u : 0u) + (coin.fCoinStake ? 1u : 0u)) << coin.out;
+            muhash.Insert(MakeUCharSpan(ss));
+        }
+        pcursor->Next();
+    }
+    return true;
+}
+
+/**
+ * Calculate the statistics about the unspent transaction output set on several threads, each one reading a range of
+ * txids from the same snapshot of the database. The hash of the set, if fMuHash, is the MuHash of its coins: unlike
+ * hash_serialized_2, it doesn't depend on the order of the coins, so the hashes of the ranges are combined.
+ */
+static bool GetUTXOStatsParallel(CCoinsViewDB* view, CCoinsStats& stats, bool fMuHash)
+{
+    const int nThreads = std::max(1, std::min(GetNumCores(), MAX_UTXO_STATS_THREADS));
+    std::vector<std::unique_ptr<CCoinsViewCursor>> cursors;
+    {
+        LOCK(cs_main);
+        FlushStateToDisk();
+        cursors = view->RangeCursors(nThreads);
+        stats.hashBlock = cursors[0]->GetBestBlock();
+        if (!SetUTXOStatsHeight(stats)) return false;
+    }
+
+    std::vector<CCoinsStats> rangeStats(cursors.size());
+    std::vector<MuHash3072> rangeHashes(cursors.size());
+    bool fSuccess = true;
+    {
+        ctpl::thread_pool pool(nThreads);
+        std::vector<std::future<bool>> futures;
+        for (size_t i = 0; i < cursors.size(); i++) {
+            futures.emplace_back(pool.push([&cursors, &rangeStats, &rangeHashes, fMuHash, i](int) {
+                return GetUTXORangeStats(cursors[i].get(), fMuHash, rangeStats[i], rangeHashes[i]);
+            }));
+        }
+        for (auto& f : futures) {
+            fSuccess &= f.get();
+        }
+    }
+    if (!fSuccess) return false;
+
+    MuHash3072 muhash;
+    for (size_t i = 0; i < cursors.size(); i++) {
+        stats.nTransactions += rangeStats[i].nTransactions;
+        stats.nTransactionOutputs += rangeStats[i].nTransactionOutputs;
+        stats.nTotalAmount += rangeStats[i].nTotalAmount;
+        if (fMuHash) muhash *= rangeHashes[i];
+    }
+    if (fMuHash) muhash.Finalize(stats.hashSerialized);
+    stats.nDiskSize = view->EstimateSize();
+    return true;
+}
+
 UniValue gettxoutsetinfo(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() != 0)
+    if (request.fHelp || request.params.size() > 1)
         throw std::runtime_error(
-            "gettxoutsetinfo\n"
+            "gettxoutsetinfo ( \"hash_type\" )\n"
             "\nReturns statistics about the unspent transaction output set.\n"
-            "Note this call may take some time.\n"
+            "Note this call may take some time. With hash_type muhash or none, the set is read on several threads.\n"
+
+            "\nArguments:\n"
+            "1. \"hash_type\"      (string, optional, default=hash_serialized_2) Which UTXO set hash should be calculated. Options: 'hash_serialized_2' (the legacy algorithm), 'muhash', 'none'.\n"
 
             "\nResult:\n"
             "{\n"
@@ -799,24 +1062,34 @@ UniValue gettxoutsetinfo(const JSONRPCRequest& request)
             "  \"bestblock\": \"hex\",   (string) the best block hash hex\n"
             "  \"transactions\": n,      (numeric) The number of transactions\n"
             "  \"txouts\": n,            (numeric) The number of output transactions\n"
-            "  \"hash_serialized_2\": \"hash\",   (string) The serialized hash\n"
+            "  \"hash_serialized_2\": \"hash\",   (string) The serialized hash (only present if 'hash_serialized_2' hash_type is chosen)\n"
+            "  \"muhash\": \"hash\",      (string) The MuHash of the coins (only present if 'muhash' hash_type is chosen)\n"
             "  \"disk_size\": n,         (numeric) The estimated size of the chainstate on disk\n"
             "  \"total_amount\": x.xxx          (numeric) The total amount\n"
             "}\n"
 
             "\nExamples:\n" +
-            HelpExampleCli("gettxoutsetinfo", "") + HelpExampleRpc("gettxoutsetinfo", ""));
+            HelpExampleCli("gettxoutsetinfo", "") + HelpExampleCli("gettxoutsetinfo", "muhash") +
+            HelpExampleRpc("gettxoutsetinfo", "\"none\""));
+
+    const std::string strHashType = request.params.empty() || request.params[0].isNull() ? "hash_serialized_2" : request.params[0].get_str();
+    if (strHashType != "hash_serialized_2" && strHashType != "muhash" && strHashType != "none") {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("%s is not a valid hash_type", strHashType));
+    }
 
     UniValue ret(UniValue::VOBJ);
 
     CCoinsStats stats;
-    FlushStateToDisk();
-    if (GetUTXOStats(pcoinsTip.get(), stats)) {
+    const bool fSuccess = strHashType == "hash_serialized_2" ? GetUTXOStats(pcoinsTip.get(), stats)
+                                                             : GetUTXOStatsParallel(pcoinsdbview.get(), stats, strHashType == "muhash");
+    if (fSuccess) {
         ret.pushKV("height", (int64_t)stats.nHeight);
         ret.pushKV("bestblock", stats.hashBlock.GetHex());
         ret.pushKV("transactions", (int64_t)stats.nTransactions);
         ret.pushKV("txouts", (int64_t)stats.nTransactionOutputs);
-        ret.pushKV("hash_serialized_2", stats.hashSerialized.GetHex());
+        if (strHashType != "none") {
+            ret.pushKV(strHashType, stats.hashSerialized.GetHex());
+        }
         ret.pushKV("total_amount", ValueFromAmount(stats.nTotalAmount));
         ret.pushKV("disk_size", stats.nDiskSize);
     }
@@ -901,6 +1174,54 @@ UniValue gettxout(const JSONRPCRequest& request)
     return ret;
 }
 
+UniValue dumptxoutset(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "dumptxoutset \"path\"\n"
+            "\nExports the UTXO set at the current tip to disk: the unspent transaction outputs and the sapling anchors\n"
+            "and nullifiers, followed by the hash of the content. The file is only an export: it can't be loaded by the node.\n"
+            "Note this call may take some time, during which the node doesn't process new blocks.\n"
+
+            "\nArguments:\n"
+            "1. \"path\"    (string, required) path to the output file. If relative, will be prefixed by datadir.\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"base_hash\": \"hex\",     (string) the hash of the block at which the UTXO set was exported\n"
+            "  \"base_height\": n,        (numeric) the height of the block at which the UTXO set was exported\n"
+            "  \"coins_written\": n,      (numeric) the number of coins written in the file\n"
+            "  \"sapling_anchors\": n,    (numeric) the number of sapling anchors\n"
+            "  \"sapling_nullifiers\": n, (numeric) the number of sapling nullifiers\n"
+            "  \"hash\": \"hex\",          (string) the hash of the content of the file\n"
+            "  \"path\": \"path\"          (string) the absolute path of the file\n"
+            "}\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("dumptxoutset", "\"utxo.dat\"") + HelpExampleRpc("dumptxoutset", "\"utxo.dat\""));
+
+    const fs::path path = fs::absolute(request.params[0].get_str(), GetDataDir());
+    if (fs::exists(path)) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, path.string() + " already exists. If you are sure this is what you want, move it out of the way first");
+    }
+
+    SnapshotStats stats;
+    std::string strError;
+    if (!DumpUTXOSnapshot(path, stats, strError)) {
+        throw JSONRPCError(RPC_MISC_ERROR, strError);
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("base_hash", stats.baseBlockHash.GetHex());
+    ret.pushKV("base_height", stats.nBaseHeight);
+    ret.pushKV("coins_written", (int64_t)stats.nCoins);
+    ret.pushKV("sapling_anchors", (int64_t)stats.nSaplingAnchors);
+    ret.pushKV("sapling_nullifiers", (int64_t)stats.nSaplingNullifiers);
+    ret.pushKV("hash", stats.hash.GetHex());
+    ret.pushKV("path", path.string());
+    return ret;
+}
+
 UniValue verifychain(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() > 1)
@@ -927,6 +1248,44 @@ UniValue verifychain(const JSONRPCRequest& request)
     return CVerifyDB().VerifyDB(pcoinsTip.get(), nCheckLevel, nCheckDepth);
 }
 
+UniValue getverifychaininfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getverifychaininfo\n"
+            "\nReturns the progress of the last verification of the blockchain database (verifychain, or the one\n"
+            "of the startup).\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"running\": true|false,   (boolean) Whether the verification is running\n"
+            "  \"checklevel\": n,         (numeric) The level of the verification\n"
+            "  \"checkblocks\": n,        (numeric) The number of blocks verified\n"
+            "  \"progress\": n,           (numeric) The percentage done\n"
+            "  \"height\": n,             (numeric) The height of the block being verified\n"
+            "  \"starttime\": ttt,        (numeric) The start time, in seconds since epoch\n"
+            "  \"endtime\": ttt,          (numeric, optional) The end time, once done\n"
+            "  \"result\": true|false     (boolean, optional) Whether the database is consistent, once done\n"
+            "}\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("getverifychaininfo", "") + HelpExampleRpc("getverifychaininfo", ""));
+
+    const VerifyDBStatus status = GetVerifyDBStatus();
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("running", status.fRunning);
+    ret.pushKV("checklevel", status.nCheckLevel);
+    ret.pushKV("checkblocks", status.nCheckDepth);
+    ret.pushKV("progress", status.nProgress);
+    ret.pushKV("height", status.nHeight);
+    ret.pushKV("starttime", status.nStartTime);
+    if (status.result) {
+        ret.pushKV("endtime", status.nEndTime);
+        ret.pushKV("result", *status.result);
+    }
+    return ret;
+}
+
 /** Implementation of IsSuperMajority with better feedback */
 static UniValue SoftForkMajorityDesc(int version, const CBlockIndex* pindex, const Consensus::Params& consensusParams)
 {
@@ -1040,22 +1399,22 @@ UniValue getblockchaininfo(const JSONRPCRequest& request)
             "\nExamples:\n" +
             HelpExampleCli("getblockchaininfo", "") + HelpExampleRpc("getblockchaininfo", ""));
 
-    LOCK(cs_main);
-
+    // Served from the tip snapshot, without cs_main
+    const auto tip = GetChainTipSnapshot();
     const Consensus::Params& consensusParams = Params().GetConsensus();
-    const CBlockIndex* pChainTip = chainActive.Tip();
-    int nTipHeight = pChainTip ? pChainTip->nHeight : -1;
+    const CBlockIndex* pChainTip = tip ? tip->pindex : nullptr;
+    int nTipHeight = tip ? tip->nHeight : -1;
 
     UniValue obj(UniValue::VOBJ);
     obj.pushKV("chain", Params().NetworkIDString());
     obj.pushKV("blocks", nTipHeight);
-    obj.pushKV("headers", pindexBestHeader ? pindexBestHeader->nHeight : -1);
-    obj.pushKV("bestblockhash", pChainTip ? pChainTip->GetBlockHash().GetHex() : "");
-    obj.pushKV("difficulty", (double)GetDifficulty());
+    obj.pushKV("headers", nBestHeaderHeight.load());
+    obj.pushKV("bestblockhash", tip ? tip->hash.GetHex() : "");
+    obj.pushKV("difficulty", tip ? GetDifficulty(pChainTip) : 1.0);
     obj.pushKV("verificationprogress", Checkpoints::GuessVerificationProgress(pChainTip));
-    obj.pushKV("chainwork", pChainTip ? pChainTip->nChainWork.GetHex() : "");
+    obj.pushKV("chainwork", tip ? tip->nChainWork.GetHex() : "");
     // Sapling shield pool value
-    obj.pushKV("shield_pool_value", pChainTip ? ValuePoolDesc(pChainTip->nChainSaplingValue, pChainTip->nSaplingValue) : 0);
+    obj.pushKV("shield_pool_value", tip ? ValuePoolDesc(tip->nChainSaplingValue, tip->nSaplingValue) : 0);
     obj.pushKV("initial_block_downloading", IsInitialBlockDownload());
     UniValue softforks(UniValue::VARR);
     softforks.push_back(SoftForkDesc("bip65", 5, pChainTip));
@@ -1083,6 +1442,58 @@ struct CompareBlocksByHeight {
     }
 };
 
+UniValue getblockprocessingstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getblockprocessingstats\n"
+            "Returns the histograms of the durations of the stages of the connection of the blocks to the chain tip, since startup.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"stage\": {                (object) For each stage: load_block, connect_txs, verify_scripts, special_txs (with the\n"
+            "                               llmq and deterministic_mns stages), index_writing, connect_block (all of the previous ones\n"
+            "                               but load_block), flush_view, write_chainstate, postprocess, connect_tip (all of them), and\n"
+            "                               shielded_proofs (verified when the block is received)\n"
+            "    \"count\": n,             (numeric) Number of blocks timed\n"
+            "    \"avg_us\": n,            (numeric) Average duration, in microseconds\n"
+            "    \"max_us\": n,            (numeric) Longest duration, in microseconds\n"
+            "    \"buckets\": [            (array) Number of blocks by duration\n"
+            "      {\n"
+            "        \"le_us\"|\"gt_us\": n, (numeric) Upper (or, for the last one, lower) bound of the bucket\n"
+            "        \"count\": n          (numeric) Number of blocks\n"
+            "      },...\n"
+            "    ]\n"
+            "  },...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getblockprocessingstats", "")
+            + HelpExampleRpc("getblockprocessingstats", "")
+        );
+
+    UniValue ret(UniValue::VOBJ);
+    for (const auto& it : GetBlockProcessingStats()) {
+        const BlockStageTimes& times = it.second;
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("count", times.nCount);
+        obj.pushKV("avg_us", times.nCount == 0 ? 0 : times.nTotal / (int64_t)times.nCount);
+        obj.pushKV("max_us", times.nMax);
+        UniValue buckets(UniValue::VARR);
+        for (size_t i = 0; i < times.buckets.size(); i++) {
+            UniValue bucket(UniValue::VOBJ);
+            if (i < BLOCK_STAGE_BUCKET_BOUNDS.size()) {
+                bucket.pushKV("le_us", BLOCK_STAGE_BUCKET_BOUNDS[i]);
+            } else {
+                bucket.pushKV("gt_us", BLOCK_STAGE_BUCKET_BOUNDS.back());
+            }
+            bucket.pushKV("count", times.buckets[i]);
+            buckets.push_back(bucket);
+        }
+        obj.pushKV("buckets", buckets);
+        ret.pushKV(it.first, obj);
+    }
+    return ret;
+}
+
 UniValue getchaintips(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 0)
@@ -1180,6 +1591,16 @@ UniValue mempoolInfoToJSON()
     ret.pushKV("size", (int64_t) mempool.size());
     ret.pushKV("bytes", (int64_t) mempool.GetTotalTxSize());
     ret.pushKV("usage", (int64_t) mempool.DynamicMemoryUsage());
+    const MemPoolUsage usage = mempool.GetMemoryUsage();
+    UniValue breakdown(UniValue::VOBJ);
+    breakdown.pushKV("transactions", (int64_t) usage.nTransactions);
+    breakdown.pushKV("entries", (int64_t) usage.nEntries);
+    breakdown.pushKV("links", (int64_t) usage.nLinks);
+    breakdown.pushKV("spends", (int64_t) usage.nSpends);
+    breakdown.pushKV("nullifiers", (int64_t) usage.nNullifiers);
+    breakdown.pushKV("deltas", (int64_t) usage.nDeltas);
+    breakdown.pushKV("pool_allocated", (int64_t) usage.nPoolAllocated);
+    ret.pushKV("usage_breakdown", breakdown);
     size_t maxmempool = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
     ret.pushKV("mempoolminfee", ValueFromAmount(std::max(mempool.GetMinFee(maxmempool), ::minRelayTxFee).GetFeePerK()));
     ret.pushKV("minrelaytxfee", ValueFromAmount(::minRelayTxFee.GetFeePerK()));
@@ -1200,6 +1621,15 @@ UniValue getmempoolinfo(const JSONRPCRequest& request)
             "  \"size\": xxxxx                (numeric) Current tx count\n"
             "  \"bytes\": xxxxx               (numeric) Sum of all tx sizes\n"
             "  \"usage\": xxxxx               (numeric) Total memory usage for the mempool\n"
+            "  \"usage_breakdown\": {         (json object) Memory usage by component (summing up to usage)\n"
+            "     \"transactions\": xxxxx     (numeric) Transaction data, including their cached signature hashes\n"
+            "     \"entries\": xxxxx          (numeric) Mempool entries and their indexes\n"
+            "     \"links\": xxxxx            (numeric) Links between in-mempool parents and children\n"
+            "     \"spends\": xxxxx           (numeric) Outpoints spent by mempool transactions\n"
+            "     \"nullifiers\": xxxxx       (numeric) Sapling nullifiers spent by mempool transactions\n"
+            "     \"deltas\": xxxxx           (numeric) Fee deltas of the prioritised transactions\n"
+            "     \"pool_allocated\": xxxxx   (numeric) Memory held by the entries and links pool, including its free blocks (not part of usage)\n"
+            "  },\n"
             "  \"maxmempool\": xxxxx,         (numeric) Maximum memory usage for the mempool\n"
             "  \"mempoolminfee\": xxxxx       (numeric) Minimum fee rate in " + CURRENCY_UNIT + "/kB for tx to be accepted. Is the maximum of minrelaytxfee and minimum mempool fee\n"
             "  \"minrelaytxfee\": xxxxx       (numeric) Current minimum relay fee for transactions\n"
@@ -1229,10 +1659,10 @@ UniValue invalidateblock(const JSONRPCRequest& request)
 
     {
         LOCK(cs_main);
-        if (mapBlockIndex.count(hash) == 0)
+        CBlockIndex* pblockindex = LookupBlockIndex(hash);
+        if (!pblockindex)
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
-        CBlockIndex* pblockindex = mapBlockIndex[hash];
         // For each wallet in your wallet list
         std::string errString = "";
         for (auto* pwallet : vpwallets) {
@@ -1279,10 +1709,10 @@ UniValue reconsiderblock(const JSONRPCRequest& request)
 
     {
         LOCK(cs_main);
-        if (mapBlockIndex.count(hash) == 0)
+        CBlockIndex* pblockindex = LookupBlockIndex(hash);
+        if (!pblockindex)
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
-        CBlockIndex* pblockindex = mapBlockIndex[hash];
         ReconsiderBlock(state, pblockindex);
     }
 
@@ -1689,14 +2119,18 @@ UniValue scantxoutset(const JSONRPCRequest& request)
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         okSafe argNames
   //  --------------------- ------------------------  -----------------------  ------ --------
+    { "blockchain",         "dumptxoutset",           &dumptxoutset,           true,  {"path"} },
     { "blockchain",         "getbestblockhash",       &getbestblockhash,       true,  {} },
     { "blockchain",         "getbestsaplinganchor",   &getbestsaplinganchor,   true,  {} },
     { "blockchain",         "getblock",               &getblock,               true,  {"blockhash","verbose|verbosity"} },
     { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      true,  {} },
     { "blockchain",         "getblockcount",          &getblockcount,          true,  {} },
+    { "blockchain",         "getblockfilter",         &getblockfilter,         true,  {"blockhash","filtertype"} },
+    { "blockchain",         "getcompactsaplingblocks", &getcompactsaplingblocks, true, {"startheight","count","verbose"} },
     { "blockchain",         "getblockhash",           &getblockhash,           true,  {"height"} },
     { "blockchain",         "getblockheader",         &getblockheader,         false, {"blockhash","verbose"} },
     { "blockchain",         "getblockindexstats",     &getblockindexstats,     true,  {"height","range"} },
+    { "blockchain",         "getblockprocessingstats", &getblockprocessingstats, true, {} },
     { "blockchain",         "getchaintips",           &getchaintips,           true,  {} },
     { "blockchain",         "getdifficulty",          &getdifficulty,          true,  {} },
     { "blockchain",         "getfeeinfo",             &getfeeinfo,             true,  {"blocks"} },
@@ -1704,8 +2138,9 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getrawmempool",          &getrawmempool,          true,  {"verbose"} },
     { "blockchain",         "getsupplyinfo",          &getsupplyinfo,          true,  {"force_update"} },
     { "blockchain",         "gettxout",               &gettxout,               true,  {"txid","n","include_mempool"} },
-    { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true,  {} },
+    { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true,  {"hash_type"} },
     { "blockchain",         "scantxoutset",           &scantxoutset,           true,  {"action", "scanobjects"} },
+    { "blockchain",         "getverifychaininfo",     &getverifychaininfo,     true,  {} },
     { "blockchain",         "verifychain",            &verifychain,            true,  {"nblocks"} },
 
     /* Not shown in help */
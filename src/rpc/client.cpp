@@ -48,6 +48,11 @@ static const CRPCConvertParam vRPCConvertParams[] = {
     { "generate", 0, "nblocks" },
     { "generatetoaddress", 0, "nblocks" },
     { "getaddednodeinfo", 0, "dummy" },
+    { "getaddressbalance", 0, "addresses" },
+    { "getaddresstxids", 0, "addresses" },
+    { "getaddresstxids", 1, "start" },
+    { "getaddresstxids", 2, "end" },
+    { "getaddressutxos", 0, "addresses" },
     { "getbalance", 0, "minconf" },
     { "getbalance", 1, "include_watchonly" },
     { "getbalance", 2, "include_delegated" },
@@ -59,11 +64,18 @@ static const CRPCConvertParam vRPCConvertParams[] = {
     { "getblockindexstats", 0, "height" },
     { "getblockindexstats", 1, "range" },
     { "getblocktemplate", 0, "template_request" },
+    { "getcompactsaplingblocks", 0, "startheight" },
+    { "getcompactsaplingblocks", 1, "count" },
+    { "getcompactsaplingblocks", 2, "verbose" },
     { "getfeeinfo", 0, "blocks" },
     { "getshieldbalance", 1, "minconf" },
     { "getshieldbalance", 2, "include_watchonly" },
+    { "getshieldoperationresult", 0, "opids" },
+    { "getshieldoperationstatus", 0, "opids" },
+    { "getlockstats", 0, "reset" },
     { "getminedcommitment", 0, "llmq_type" },
     { "getnetworkhashps", 0, "nblocks" },
+    { "getnewshieldaddresses", 0, "count" },
     { "getnetworkhashps", 1, "height" },
     { "getnodeaddresses", 0, "count" },
     { "getquorummembers", 0, "llmq_type" },
@@ -169,6 +181,10 @@ static const CRPCConvertParam vRPCConvertParams[] = {
     { "shieldsendmany", 2, "minconf" },
     { "shieldsendmany", 3, "fee" },
     { "shieldsendmany", 4, "subtract_fee_from" },
+    { "shieldsendmanyasync", 1, "amounts" },
+    { "shieldsendmanyasync", 2, "minconf" },
+    { "shieldsendmanyasync", 3, "fee" },
+    { "shieldsendmanyasync", 4, "subtract_fee_from" },
     { "signrawtransaction", 1, "prevtxs" },
     { "signrawtransaction", 2, "privkeys" },
     { "spork", 1, "value" },
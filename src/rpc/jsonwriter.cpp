@@ -0,0 +1,172 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "rpc/jsonwriter.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <stdio.h>
+
+JSONStreamWriter::JSONStreamWriter(ChunkSink sinkIn, size_t nChunkSizeIn) :
+    sink(std::move(sinkIn)),
+    nChunkSize(std::max(nChunkSizeIn, (size_t) 1))
+{
+    buffer.reserve(nChunkSize + 1024);
+}
+
+void JSONStreamWriter::BeginValue()
+{
+    if (fAfterKey) {
+        fAfterKey = false;
+        return;
+    }
+    if (!vHasValues.empty()) {
+        if (vHasValues.back()) Write(",", 1);
+        vHasValues.back() = true;
+    }
+}
+
+JSONStreamWriter& JSONStreamWriter::BeginObject()
+{
+    BeginValue();
+    Write("{", 1);
+    vHasValues.push_back(false);
+    return *this;
+}
+
+JSONStreamWriter& JSONStreamWriter::EndObject()
+{
+    assert(!vHasValues.empty() && !fAfterKey);
+    vHasValues.pop_back();
+    Write("}", 1);
+    MaybeFlush();
+    return *this;
+}
+
+JSONStreamWriter& JSONStreamWriter::BeginArray()
+{
+    BeginValue();
+    Write("[", 1);
+    vHasValues.push_back(false);
+    return *this;
+}
+
+JSONStreamWriter& JSONStreamWriter::EndArray()
+{
+    assert(!vHasValues.empty() && !fAfterKey);
+    vHasValues.pop_back();
+    Write("]", 1);
+    MaybeFlush();
+    return *this;
+}
+
+JSONStreamWriter& JSONStreamWriter::Key(const std::string& key)
+{
+    assert(!vHasValues.empty() && !fAfterKey);
+    BeginValue();
+    WriteString(key);
+    Write(":", 1);
+    fAfterKey = true;
+    return *this;
+}
+
+JSONStreamWriter& JSONStreamWriter::Value(const UniValue& val)
+{
+    switch (val.getType()) {
+    case UniValue::VOBJ: {
+        BeginObject();
+        const std::vector<std::string>& keys = val.getKeys();
+        const std::vector<UniValue>& values = val.getValues();
+        for (size_t i = 0; i < keys.size(); i++) {
+            Key(keys[i]).Value(values[i]);
+        }
+        EndObject();
+        break;
+    }
+    case UniValue::VARR:
+        BeginArray();
+        for (const UniValue& v : val.getValues()) {
+            Value(v);
+        }
+        EndArray();
+        break;
+    case UniValue::VNULL:
+        BeginValue();
+        Write("null", 4);
+        break;
+    case UniValue::VSTR:
+        BeginValue();
+        WriteString(val.get_str());
+        break;
+    case UniValue::VNUM:
+        BeginValue();
+        Write(val.getValStr());
+        break;
+    case UniValue::VBOOL:
+        BeginValue();
+        if (val.get_bool()) {
+            Write("true", 4);
+        } else {
+            Write("false", 5);
+        }
+        break;
+    }
+    MaybeFlush();
+    return *this;
+}
+
+void JSONStreamWriter::Write(const char* data, size_t len)
+{
+    buffer.append(data, len);
+}
+
+void JSONStreamWriter::WriteString(const std::string& str)
+{
+    // Same escapes as UniValue::write
+    buffer += '"';
+    for (const char c : str) {
+        const unsigned char ch = c;
+        switch (ch) {
+        case '"': buffer += "\\\""; break;
+        case '\\': buffer += "\\\\"; break;
+        case '\b': buffer += "\\b"; break;
+        case '\t': buffer += "\\t"; break;
+        case '\n': buffer += "\\n"; break;
+        case '\f': buffer += "\\f"; break;
+        case '\r': buffer += "\\r"; break;
+        default:
+            if (ch < 0x20 || ch == 0x7f) {
+                char esc[7];
+                snprintf(esc, sizeof(esc), "\\u%04x", ch);
+                buffer.append(esc, 6);
+            } else {
+                buffer += c;
+            }
+        }
+    }
+    buffer += '"';
+}
+
+void JSONStreamWriter::MaybeFlush()
+{
+    if (buffer.size() >= nChunkSize) Flush();
+}
+
+void JSONStreamWriter::Flush()
+{
+    if (buffer.empty()) return;
+    nWritten += buffer.size();
+    std::string chunk;
+    chunk.reserve(nChunkSize + 1024);
+    chunk.swap(buffer);
+    sink(std::move(chunk));
+}
+
+std::string JSONStreamWriter::Release()
+{
+    std::string ret;
+    ret.swap(buffer);
+    nWritten += ret.size();
+    return ret;
+}
@@ -0,0 +1,66 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_RPC_JSONWRITER_H
+#define PIVX_RPC_JSONWRITER_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <univalue.h>
+
+//! Size of the chunks of JSON passed on by JSONStreamWriter
+static const size_t DEFAULT_JSON_CHUNK_SIZE = 1 << 18;
+
+/**
+ * Compact JSON emitter, which passes its output on to a sink in chunks of (about) nChunkSize bytes as it's written.
+ * Unlike UniValue::write, which returns a string for each nested value and the whole document at the end, it only
+ * holds one chunk in memory. Documents can be written value by value (BeginObject, Key, Value...), so that their
+ * parts can be released as soon as they're written, or from a UniValue tree. The output is the same as the one of
+ * UniValue::write without indentation.
+ */
+class JSONStreamWriter
+{
+public:
+    typedef std::function<void(std::string&& chunk)> ChunkSink;
+
+    explicit JSONStreamWriter(ChunkSink sinkIn, size_t nChunkSizeIn = DEFAULT_JSON_CHUNK_SIZE);
+
+    JSONStreamWriter& BeginObject();
+    JSONStreamWriter& EndObject();
+    JSONStreamWriter& BeginArray();
+    JSONStreamWriter& EndArray();
+    //! Key of the next value of the current object
+    JSONStreamWriter& Key(const std::string& key);
+    JSONStreamWriter& Value(const UniValue& val);
+    //! Shorthand for Key(key).Value(val)
+    JSONStreamWriter& KeyValue(const std::string& key, const UniValue& val) { return Key(key).Value(val); }
+
+    //! Passes the buffered output on to the sink
+    void Flush();
+    //! Returns the output not passed on to the sink yet, instead of flushing it
+    std::string Release();
+
+    //! Number of bytes written so far
+    size_t GetSize() const { return nWritten + buffer.size(); }
+
+private:
+    ChunkSink sink;
+    size_t nChunkSize;
+    std::string buffer;
+    size_t nWritten{0};
+    //! For each open array or object, whether a value was written in it already
+    std::vector<bool> vHasValues;
+    //! Whether the key of the next value was written
+    bool fAfterKey{false};
+
+    void BeginValue();
+    void Write(const char* data, size_t len);
+    void Write(const std::string& str) { Write(str.data(), str.size()); }
+    void WriteString(const std::string& str);
+    void MaybeFlush();
+};
+
+#endif // PIVX_RPC_JSONWRITER_H
@@ -97,7 +97,7 @@ UniValue initmasternode(const JSONRPCRequest& request)
     if (isDeterministic) {
         if (!activeMasternodeManager) {
             activeMasternodeManager = new CActiveDeterministicMasternodeManager();
-            RegisterValidationInterface(activeMasternodeManager);
+            RegisterValidationInterface(activeMasternodeManager, "activemasternode");
         }
         auto res = activeMasternodeManager->SetOperatorKey(_strMasterNodePrivKey);
         if (!res) throw std::runtime_error(res.getError());
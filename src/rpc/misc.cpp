@@ -5,20 +5,32 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "addressindex.h"
+#include "budget/budgetmanager.h"
 #include "clientversion.h"
+#include "dbwrapper.h"
+#include "evo/deterministicmns.h"
 #include "httpserver.h"
+#include "init.h"
 #include "key_io.h"
+#include "llmq/quorums_signing_shares.h"
 #include "sapling/key_io_sapling.h"
 #include "masternode-sync.h"
+#include "masternodeman.h"
 #include "messagesigner.h"
 #include "net.h"
+#include "net_processing.h"
 #include "netbase.h"
 #include "tiertwo/net_masternodes.h"
 #include "rpc/server.h"
+#include "scheduler.h"
 #include "spork.h"
 #include "timedata.h"
 #include "tiertwo/tiertwo_sync_state.h"
+#include "txdb.h"
+#include "txmempool.h"
 #include "util/system.h"
+#include "validationinterface.h"
 #ifdef ENABLE_WALLET
 #include "wallet/rpcwallet.h"
 #include "wallet/wallet.h"
@@ -722,6 +734,48 @@ static UniValue RPCLockedMemoryInfo()
     obj.pushKV("locked", uint64_t(stats.locked));
     obj.pushKV("chunks_used", uint64_t(stats.chunks_used));
     obj.pushKV("chunks_free", uint64_t(stats.chunks_free));
+    obj.pushKV("largest_free", uint64_t(stats.largest_free));
+    obj.pushKV("fragmentation", stats.free ? 1.0 - (double)stats.largest_free / stats.free : 0.0);
+    obj.pushKV("arenas", uint64_t(stats.arenas));
+    obj.pushKV("cached", uint64_t(LockedPoolManager::Instance().CachedBytes()));
+    return obj;
+}
+
+// The estimated memory usage of the caches and indexes of the subsystems, in bytes
+static UniValue RPCSubsystemsMemoryUsage()
+{
+    UniValue obj(UniValue::VOBJ);
+    size_t nTotal = 0;
+    const auto push = [&](const std::string& name, size_t nUsage) {
+        obj.pushKV(name, (uint64_t)nUsage);
+        nTotal += nUsage;
+    };
+    {
+        LOCK(cs_main);
+        push("coins_cache", pcoinsTip ? pcoinsTip->DynamicMemoryUsage() : 0);
+        push("block_index", GetBlockIndexMemoryUsage());
+    }
+    push("mempool", mempool.DynamicMemoryUsage());
+    push("orphan_pool", GetOrphanPoolMemoryUsage());
+    push("addrman", g_connman ? g_connman->GetAddrManMemoryUsage() : 0);
+    push("masternodes", mnodeman.DynamicMemoryUsage());
+    push("budget", g_budgetman.DynamicMemoryUsage());
+    push("deterministic_mns", deterministicMNManager ? deterministicMNManager->DynamicMemoryUsage() : 0);
+    push("llmq_sigshares", llmq::quorumSigSharesManager ? llmq::quorumSigSharesManager->DynamicMemoryUsage() : 0);
+#ifdef ENABLE_WALLET
+    UniValue wallets(UniValue::VOBJ);
+    for (const CWalletRef& pwallet : vpwallets) {
+        UniValue walletObj(UniValue::VOBJ);
+        const size_t nTxs = pwallet->GetWalletTxsMemoryUsage();
+        const size_t nWitnesses = pwallet->GetSaplingWitnessesMemoryUsage();
+        walletObj.pushKV("transactions", (uint64_t)nTxs);
+        walletObj.pushKV("sapling_witnesses", (uint64_t)nWitnesses);
+        wallets.pushKV(pwallet->GetName(), walletObj);
+        nTotal += nTxs + nWitnesses;
+    }
+    obj.pushKV("wallets", wallets);
+#endif
+    obj.pushKV("total", (uint64_t)nTotal);
     return obj;
 }
 
@@ -730,10 +784,13 @@ UniValue getmemoryinfo(const JSONRPCRequest& request)
     /* Please, avoid using the word "pool" here in the RPC interface or help,
      * as users will undoubtedly confuse it with the other "memory pool"
      */
-    if (request.fHelp || request.params.size() != 0)
+    if (request.fHelp || request.params.size() > 1)
         throw std::runtime_error(
-            "getmemoryinfo\n"
+            "getmemoryinfo ( \"mode\" )\n"
             "Returns an object containing information about memory usage.\n"
+            "\nArguments:\n"
+            "1. \"mode\"    (string, optional, default=\"stats\") \"stats\" for the locked memory only,\n"
+            "                 \"detailed\" to add the estimated memory usage of the subsystems.\n"
             "\nResult:\n"
             "{\n"
             "  \"locked\": {               (json object) Information about locked memory manager\n"
@@ -743,17 +800,289 @@ UniValue getmemoryinfo(const JSONRPCRequest& request)
             "    \"locked\": xxxxxx,       (numeric) Amount of bytes that succeeded locking. If this number is smaller than total, locking pages failed at some point and key data could be swapped to disk.\n"
             "    \"chunks_used\": xxxxx,   (numeric) Number allocated chunks\n"
             "    \"chunks_free\": xxxxx,   (numeric) Number unused chunks\n"
+            "    \"largest_free\": xxxxx,  (numeric) Size of the largest unused chunk, in bytes\n"
+            "    \"fragmentation\": x.xx,  (numeric) Share of the available bytes outside of the largest unused chunk\n"
+            "    \"arenas\": n,            (numeric) Number of arenas of locked memory\n"
+            "    \"cached\": xxxxx,        (numeric) Bytes of the unused chunks kept by the threads for their next small allocations (counted as used)\n"
+            "  },\n"
+            "  \"usage\": {                (json object, \"detailed\" mode only) Estimated memory usage of the subsystems, in bytes\n"
+            "    \"coins_cache\": xxxxx,       (numeric) The cache of the UTXO set\n"
+            "    \"block_index\": xxxxx,       (numeric) The block index (mapBlockIndex and mapPrevBlockIndex)\n"
+            "    \"mempool\": xxxxx,           (numeric) The transactions memory pool\n"
+            "    \"orphan_pool\": xxxxx,       (numeric) The orphan transactions\n"
+            "    \"addrman\": xxxxx,           (numeric) The address manager\n"
+            "    \"masternodes\": xxxxx,       (numeric) The legacy masternodes list, with the seen broadcasts and pings\n"
+            "    \"budget\": xxxxx,            (numeric) The budget proposals and finalized budgets, with their votes\n"
+            "    \"deterministic_mns\": xxxxx, (numeric) The cached deterministic masternode lists and diffs\n"
+            "    \"llmq_sigshares\": xxxxx,    (numeric) The LLMQ signature shares and sessions\n"
+#ifdef ENABLE_WALLET
+            "    \"wallets\": {              (json object) For each loaded wallet, by name\n"
+            "      \"name\": {\n"
+            "        \"transactions\": xxxxx,      (numeric) The wallet transactions\n"
+            "        \"sapling_witnesses\": xxxxx, (numeric) The Sapling witnesses cached for the notes\n"
+            "      }, ...\n"
+            "    },\n"
+#endif
+            "    \"total\": xxxxx              (numeric) The sum of the above\n"
             "  }\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getmemoryinfo", "")
-            + HelpExampleRpc("getmemoryinfo", "")
+            + HelpExampleCli("getmemoryinfo", "\"detailed\"")
+            + HelpExampleRpc("getmemoryinfo", "\"detailed\"")
         );
+    const std::string strMode = request.params.empty() ? "stats" : request.params[0].get_str();
+    if (strMode != "stats" && strMode != "detailed") {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "unknown mode " + strMode);
+    }
     UniValue obj(UniValue::VOBJ);
     obj.pushKV("locked", RPCLockedMemoryInfo());
+    if (strMode == "detailed") {
+        obj.pushKV("usage", RPCSubsystemsMemoryUsage());
+    }
     return obj;
 }
 
+UniValue getdbstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getdbstats\n"
+            "Returns the LevelDB statistics of the open databases.\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"name\": \"xxxx\",          (string) The path of the database, relative to the data directory\n"
+            "    \"block_cache\": xxxxx,      (numeric) Size of the cache of the table blocks, in bytes\n"
+            "    \"write_buffer\": xxxxx,     (numeric) Size of the write buffer, in bytes\n"
+            "    \"bloom_bits\": n,           (numeric) Bits per key of the bloom filters (0: no filters)\n"
+            "    \"approximate_size\": xxxxx, (numeric) Approximate size of the tables on disk, in bytes\n"
+            "    \"memory_usage\": xxxxx,     (numeric) Approximate memory used by the write buffers and the block cache, in bytes\n"
+            "    \"files_per_level\": [n,...], (array) Number of table files of each level\n"
+            "    \"stats\": \"xxxx\"          (string) The leveldb.stats property: size of the levels, and time and I/O spent compacting them\n"
+            "  },...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getdbstats", "")
+            + HelpExampleRpc("getdbstats", "")
+        );
+
+    UniValue ret(UniValue::VARR);
+    for (const DBWrapperStats& stats : GetDBWrapperStats()) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("name", stats.strName);
+        obj.pushKV("block_cache", (uint64_t)stats.nBlockCacheSize);
+        obj.pushKV("write_buffer", (uint64_t)stats.nWriteBufferSize);
+        obj.pushKV("bloom_bits", stats.nBloomBitsPerKey);
+        obj.pushKV("approximate_size", stats.nApproximateSize);
+        obj.pushKV("memory_usage", stats.nMemoryUsage);
+        UniValue levels(UniValue::VARR);
+        for (int nFiles : stats.vFilesPerLevel) {
+            levels.push_back(nFiles);
+        }
+        obj.pushKV("files_per_level", levels);
+        obj.pushKV("stats", stats.strStats);
+        ret.push_back(obj);
+    }
+    return ret;
+}
+
+UniValue getrpcworkqueues(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getrpcworkqueues\n"
+            "Returns the statistics of the work queues of the HTTP server (the queues without threads are not listed).\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"name\": \"xxxx\",        (string) The queue: default, wallet, read or heavy\n"
+            "    \"threads\": n,            (numeric) Number of worker threads\n"
+            "    \"depth\": n,              (numeric) Number of requests waiting in the queue\n"
+            "    \"max_depth\": n,          (numeric) Maximum number of requests waiting (-rpcworkqueue)\n"
+            "    \"requests\": n,           (numeric) Number of requests started\n"
+            "    \"rejected\": n,           (numeric) Number of requests rejected because the queue was full\n"
+            "    \"wait_avg_us\": n,        (numeric) Average time waited in the queue, in microseconds\n"
+            "    \"wait_max_us\": n,        (numeric) Longest time waited in the queue, in microseconds\n"
+            "    \"run_avg_us\": n,         (numeric) Average execution time, in microseconds\n"
+            "    \"run_max_us\": n          (numeric) Longest execution time, in microseconds\n"
+            "  },...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getrpcworkqueues", "")
+            + HelpExampleRpc("getrpcworkqueues", "")
+        );
+
+    UniValue ret(UniValue::VARR);
+    for (const HTTPWorkQueueStats& stats : GetHTTPWorkQueueStats()) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("name", GetHTTPWorkQueueName(stats.id));
+        obj.pushKV("threads", stats.nThreads);
+        obj.pushKV("depth", (uint64_t)stats.nDepth);
+        obj.pushKV("max_depth", (uint64_t)stats.nMaxDepth);
+        obj.pushKV("requests", stats.nRequests);
+        obj.pushKV("rejected", stats.nRejected);
+        obj.pushKV("wait_avg_us", stats.nRequests ? stats.nWaitTotal / (int64_t)stats.nRequests : 0);
+        obj.pushKV("wait_max_us", stats.nWaitMax);
+        obj.pushKV("run_avg_us", stats.nRequests ? stats.nRunTotal / (int64_t)stats.nRequests : 0);
+        obj.pushKV("run_max_us", stats.nRunMax);
+        ret.push_back(obj);
+    }
+    return ret;
+}
+
+UniValue getvalidationqueueinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getvalidationqueueinfo\n"
+            "Returns the statistics of the queue of the validation notifications, and of the time spent by each subscriber in them.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"depth\": n,                (numeric) Number of notifications waiting in the queue\n"
+            "  \"max_depth\": n,            (numeric) Number of notifications waiting after which the block connection waits for the queue (-maxvalidationqueue)\n"
+            "  \"notifications\": n,        (numeric) Number of notifications processed\n"
+            "  \"wait_avg_us\": n,          (numeric) Average time waited in the queue, in microseconds\n"
+            "  \"wait_max_us\": n,          (numeric) Longest time waited in the queue, in microseconds\n"
+            "  \"subscribers\": [\n"
+            "    {\n"
+            "      \"name\": \"xxxx\",      (string) The subscriber\n"
+            "      \"calls\": n,            (numeric) Number of notifications received\n"
+            "      \"run_avg_us\": n,       (numeric) Average execution time, in microseconds\n"
+            "      \"run_max_us\": n        (numeric) Longest execution time, in microseconds\n"
+            "    },...\n"
+            "  ]\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getvalidationqueueinfo", "")
+            + HelpExampleRpc("getvalidationqueueinfo", "")
+        );
+
+    const ValidationQueueStats queue = GetMainSignals().GetQueueStats();
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("depth", (uint64_t)queue.nDepth);
+    ret.pushKV("max_depth", (uint64_t)queue.nMaxDepth);
+    ret.pushKV("notifications", queue.nCallbacks);
+    ret.pushKV("wait_avg_us", queue.nCallbacks ? queue.nWaitTotal / (int64_t)queue.nCallbacks : 0);
+    ret.pushKV("wait_max_us", queue.nWaitMax);
+    UniValue subscribers(UniValue::VARR);
+    for (const ValidationSubscriberStats& stats : GetMainSignals().GetSubscriberStats()) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("name", stats.name);
+        obj.pushKV("calls", stats.nCalls);
+        obj.pushKV("run_avg_us", stats.nCalls ? stats.nRunTotal / (int64_t)stats.nCalls : 0);
+        obj.pushKV("run_max_us", stats.nRunMax);
+        subscribers.push_back(obj);
+    }
+    ret.pushKV("subscribers", subscribers);
+    return ret;
+}
+
+UniValue getlockstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw std::runtime_error(
+            "getlockstats ( reset )\n"
+            "Returns the contention statistics of the locks, by mutex and file taking it, when enabled by -lockstats.\n"
+            "\nArguments:\n"
+            "1. reset      (boolean, optional, default=false) Clear the statistics after returning them\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"enabled\": true|false,     (boolean) Whether the statistics are gathered (-lockstats)\n"
+            "  \"locks\": [                 (array) By decreasing total wait time\n"
+            "    {\n"
+            "      \"name\": \"xxxx\",        (string) The mutex, as locked\n"
+            "      \"file\": \"xxxx\",        (string) The source file locking it\n"
+            "      \"locks\": n,            (numeric) Number of acquisitions\n"
+            "      \"contentions\": n,      (numeric) Number of acquisitions which had to wait\n"
+            "      \"wait_total_us\": n,    (numeric) Total time waited, in microseconds\n"
+            "      \"wait_max_us\": n,      (numeric) Longest wait, in microseconds\n"
+            "      \"hold_total_us\": n,    (numeric) Total time held, in microseconds\n"
+            "      \"hold_max_us\": n       (numeric) Longest time held, in microseconds\n"
+            "    },...\n"
+            "  ]\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getlockstats", "")
+            + HelpExampleCli("getlockstats", "true")
+            + HelpExampleRpc("getlockstats", "")
+        );
+
+    UniValue locks(UniValue::VARR);
+    for (const LockStatsEntry& entry : GetLockStatsEntries()) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("name", entry.name);
+        obj.pushKV("file", entry.file);
+        obj.pushKV("locks", entry.nLocks);
+        obj.pushKV("contentions", entry.nContentions);
+        obj.pushKV("wait_total_us", entry.nWaitTotal);
+        obj.pushKV("wait_max_us", entry.nWaitMax);
+        obj.pushKV("hold_total_us", entry.nHoldTotal);
+        obj.pushKV("hold_max_us", entry.nHoldMax);
+        locks.push_back(obj);
+    }
+    if (!request.params[0].isNull() && request.params[0].get_bool()) {
+        ResetLockStats();
+    }
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("enabled", g_lock_stats.load());
+    ret.pushKV("locks", locks);
+    return ret;
+}
+
+UniValue getschedulerinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || !request.params.empty())
+        throw std::runtime_error(
+            "getschedulerinfo\n"
+            "Returns the run statistics of the background tasks of the scheduler, by task name.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"pending\": n,                (numeric) Number of tasks waiting in the queue\n"
+            "  \"tasks\": [                   (array) By decreasing total run time\n"
+            "    {\n"
+            "      \"name\": \"xxxx\",          (string) The task name\n"
+            "      \"runs\": n,               (numeric) Number of runs\n"
+            "      \"delay_avg_us\": n,       (numeric) Average time between the scheduled time and the start, in microseconds\n"
+            "      \"delay_max_us\": n,       (numeric) Longest delay, in microseconds\n"
+            "      \"run_avg_us\": n,         (numeric) Average run time, in microseconds\n"
+            "      \"run_max_us\": n          (numeric) Longest run time, in microseconds\n"
+            "    },...\n"
+            "  ]\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getschedulerinfo", "")
+            + HelpExampleRpc("getschedulerinfo", "")
+        );
+
+    const CScheduler& scheduler = GetScheduler();
+    std::vector<std::pair<std::string, SchedulerTaskStats>> vTasks;
+    for (const auto& it : scheduler.GetTaskStats()) {
+        vTasks.emplace_back(it.first, it.second);
+    }
+    std::sort(vTasks.begin(), vTasks.end(), [](const std::pair<std::string, SchedulerTaskStats>& a, const std::pair<std::string, SchedulerTaskStats>& b) {
+        return a.second.nRunTotal > b.second.nRunTotal;
+    });
+
+    UniValue tasks(UniValue::VARR);
+    for (const auto& it : vTasks) {
+        const SchedulerTaskStats& stats = it.second;
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("name", it.first);
+        obj.pushKV("runs", stats.nRuns);
+        obj.pushKV("delay_avg_us", stats.nRuns ? stats.nDelayTotal / (int64_t)stats.nRuns : 0);
+        obj.pushKV("delay_max_us", stats.nDelayMax);
+        obj.pushKV("run_avg_us", stats.nRuns ? stats.nRunTotal / (int64_t)stats.nRuns : 0);
+        obj.pushKV("run_max_us", stats.nRunMax);
+        tasks.push_back(obj);
+    }
+    UniValue ret(UniValue::VOBJ);
+    std::chrono::system_clock::time_point first, last;
+    ret.pushKV("pending", (int64_t)scheduler.getQueueInfo(first, last));
+    ret.pushKV("tasks", tasks);
+    return ret;
+}
+
 UniValue echo(const JSONRPCRequest& request)
 {
     if (request.fHelp)
@@ -844,15 +1173,203 @@ UniValue mnconnect(const JSONRPCRequest& request)
     return false;
 }
 
+/** The indexed (type, hash) of the addresses of a request param, a single address or an array of them */
+static std::vector<std::pair<std::string, std::pair<AddressType, uint160>>> ParseIndexedAddresses(const UniValue& param)
+{
+    if (!fAddressIndex) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Address index not enabled (use -addressindex)");
+    }
+    std::vector<std::string> vAddresses;
+    if (param.isArray()) {
+        for (unsigned int i = 0; i < param.size(); i++) {
+            vAddresses.emplace_back(param[i].get_str());
+        }
+    } else {
+        vAddresses.emplace_back(param.get_str());
+    }
+
+    std::vector<std::pair<std::string, std::pair<AddressType, uint160>>> ret;
+    for (const std::string& strAddress : vAddresses) {
+        const std::pair<AddressType, uint160> addr = GetIndexedAddress(DecodeDestination(strAddress));
+        if (addr.first == AddressType::UNKNOWN) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address: " + strAddress);
+        }
+        ret.emplace_back(strAddress, addr);
+    }
+    return ret;
+}
+
+UniValue getaddressbalance(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "getaddressbalance \"address\"|[\"address\",...]\n"
+            "\nReturns the balance of one or more addresses (requires -addressindex).\n"
+            "Cold staking outputs count for both their staker and owner addresses.\n"
+
+            "\nArguments:\n"
+            "1. \"address\"     (string or array of strings, required) The pivx address(es)\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"balance\" : x.xxx,     (numeric) The current balance in " + CURRENCY_UNIT + "\n"
+            "  \"received\" : x.xxx     (numeric) The total amount received in " + CURRENCY_UNIT + ", including change\n"
+            "}\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("getaddressbalance", "\"[\\\"DMJRSsuU9zfyrvxVaAEFQqK4MxZg6vgeS6\\\"]\"") +
+            HelpExampleRpc("getaddressbalance", "\"DMJRSsuU9zfyrvxVaAEFQqK4MxZg6vgeS6\""));
+
+    const auto vAddresses = ParseIndexedAddresses(request.params[0]);
+
+    AddressIndexEntries vIndex;
+    {
+        LOCK(cs_main);
+        for (const auto& it : vAddresses) {
+            if (!pblocktree->ReadAddressIndex(it.second.first, it.second.second, vIndex)) {
+                throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read the address index for " + it.first);
+            }
+        }
+    }
+
+    CAmount nBalance = 0;
+    CAmount nReceived = 0;
+    for (const auto& it : vIndex) {
+        nBalance += it.second;
+        if (it.second > 0) nReceived += it.second;
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("balance", ValueFromAmount(nBalance));
+    ret.pushKV("received", ValueFromAmount(nReceived));
+    return ret;
+}
+
+UniValue getaddresstxids(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.empty() || request.params.size() > 3)
+        throw std::runtime_error(
+            "getaddresstxids \"address\"|[\"address\",...] ( start end )\n"
+            "\nReturns the ids of the transactions paying to or spending from one or more addresses,\n"
+            "in the order of the chain (requires -addressindex).\n"
+
+            "\nArguments:\n"
+            "1. \"address\"     (string or array of strings, required) The pivx address(es)\n"
+            "2. start         (numeric, optional, default=0) The first block height\n"
+            "3. end           (numeric, optional, default=0) The last block height, 0 for the chain tip\n"
+
+            "\nResult:\n"
+            "[\n"
+            "  \"txid\"         (string) The transaction id\n"
+            "  ,...\n"
+            "]\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("getaddresstxids", "\"[\\\"DMJRSsuU9zfyrvxVaAEFQqK4MxZg6vgeS6\\\"]\" 1000 2000") +
+            HelpExampleRpc("getaddresstxids", "\"DMJRSsuU9zfyrvxVaAEFQqK4MxZg6vgeS6\""));
+
+    const auto vAddresses = ParseIndexedAddresses(request.params[0]);
+    const int nStart = request.params.size() > 1 ? request.params[1].get_int() : 0;
+    const int nEnd = request.params.size() > 2 ? request.params[2].get_int() : 0;
+    if (nStart < 0 || nEnd < 0 || (nEnd > 0 && nEnd < nStart)) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid start or end height");
+    }
+
+    AddressIndexEntries vIndex;
+    {
+        LOCK(cs_main);
+        for (const auto& it : vAddresses) {
+            if (!pblocktree->ReadAddressIndex(it.second.first, it.second.second, vIndex, nStart, nEnd)) {
+                throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read the address index for " + it.first);
+            }
+        }
+    }
+
+    // Order by position in the chain, listing each transaction once
+    std::set<std::pair<std::pair<int, unsigned int>, uint256>> setTxids;
+    for (const auto& it : vIndex) {
+        setTxids.emplace(std::make_pair(it.first.blockHeight, it.first.txindex), it.first.txhash);
+    }
+
+    UniValue ret(UniValue::VARR);
+    for (const auto& it : setTxids) {
+        ret.push_back(it.second.GetHex());
+    }
+    return ret;
+}
+
+UniValue getaddressutxos(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "getaddressutxos \"address\"|[\"address\",...]\n"
+            "\nReturns the unspent outputs of one or more addresses (requires -addressindex).\n"
+
+            "\nArguments:\n"
+            "1. \"address\"     (string or array of strings, required) The pivx address(es)\n"
+
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"address\" : \"address\",   (string) The address\n"
+            "    \"txid\" : \"hash\",         (string) The id of the transaction\n"
+            "    \"outputIndex\" : n,       (numeric) The index of the output\n"
+            "    \"script\" : \"hex\",        (string) The hex encoded script of the output\n"
+            "    \"satoshis\" : n,          (numeric) The value of the output in satoshis\n"
+            "    \"height\" : n             (numeric) The height of the block of the transaction\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("getaddressutxos", "\"[\\\"DMJRSsuU9zfyrvxVaAEFQqK4MxZg6vgeS6\\\"]\"") +
+            HelpExampleRpc("getaddressutxos", "\"DMJRSsuU9zfyrvxVaAEFQqK4MxZg6vgeS6\""));
+
+    const auto vAddresses = ParseIndexedAddresses(request.params[0]);
+
+    UniValue ret(UniValue::VARR);
+    LOCK(cs_main);
+    for (const auto& it : vAddresses) {
+        AddressUnspentEntries vUnspent;
+        if (!pblocktree->ReadAddressUnspentIndex(it.second.first, it.second.second, vUnspent)) {
+            throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read the address index for " + it.first);
+        }
+        std::sort(vUnspent.begin(), vUnspent.end(), [](const std::pair<CAddressUnspentKey, CAddressUnspentValue>& a,
+                                                       const std::pair<CAddressUnspentKey, CAddressUnspentValue>& b) {
+            return a.second.blockHeight < b.second.blockHeight;
+        });
+        for (const auto& utxo : vUnspent) {
+            UniValue obj(UniValue::VOBJ);
+            obj.pushKV("address", it.first);
+            obj.pushKV("txid", utxo.first.txhash.GetHex());
+            obj.pushKV("outputIndex", (int)utxo.first.index);
+            obj.pushKV("script", HexStr(utxo.second.script));
+            obj.pushKV("satoshis", utxo.second.satoshis);
+            obj.pushKV("height", utxo.second.blockHeight);
+            ret.push_back(obj);
+        }
+    }
+    return ret;
+}
+
 // clang-format off
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         okSafe argNames
   //  --------------------- ------------------------  -----------------------  ------ --------
     { "control",            "getinfo",                &getinfo,                true,  {} }, /* uses wallet if enabled */
-    { "control",            "getmemoryinfo",          &getmemoryinfo,          true,  {} },
+    { "control",            "getmemoryinfo",          &getmemoryinfo,          true,  {"mode"} },
+    { "control",            "getdbstats",             &getdbstats,             true,  {} },
+    { "control",            "getrpcworkqueues",       &getrpcworkqueues,       true,  {} },
+    { "control",            "getvalidationqueueinfo", &getvalidationqueueinfo, true,  {} },
+    { "control",            "getlockstats",           &getlockstats,           true,  {"reset"} },
+    { "control",            "getschedulerinfo",       &getschedulerinfo,       true,  {} },
     { "control",            "mnsync",                 &mnsync,                 true,  {"mode"} },
     { "control",            "spork",                  &spork,                  true,  {"name","value"} },
 
+    { "addressindex",       "getaddressbalance",      &getaddressbalance,      true,  {"addresses"} },
+    { "addressindex",       "getaddresstxids",        &getaddresstxids,        true,  {"addresses","start","end"} },
+    { "addressindex",       "getaddressutxos",        &getaddressutxos,        true,  {"addresses"} },
+
     { "util",               "createmultisig",         &createmultisig,         true,  {"nrequired","keys"} },
     { "util",               "logging",                &logging,                true,  {"include", "exclude"} },
     { "util",               "validateaddress",        &validateaddress,        true,  {"pivxaddress"} }, /* uses wallet if enabled */
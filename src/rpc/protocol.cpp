@@ -8,6 +8,7 @@
 #include "rpc/protocol.h"
 
 #include "random.h"
+#include "rpc/jsonwriter.h"
 #include "tinyformat.h"
 #include "util/system.h"
 #include "utilstrencodings.h"
@@ -50,6 +51,15 @@ std::string JSONRPCReply(const UniValue& result, const UniValue& error, const Un
     return reply.write() + "\n";
 }
 
+void JSONRPCReply(JSONStreamWriter& writer, const UniValue& result, const UniValue& error, const UniValue& id)
+{
+    writer.BeginObject();
+    writer.KeyValue("result", error.isNull() ? result : NullUniValue);
+    writer.KeyValue("error", error);
+    writer.KeyValue("id", id);
+    writer.EndObject();
+}
+
 UniValue JSONRPCError(int code, const std::string& message)
 {
     UniValue error(UniValue::VOBJ);
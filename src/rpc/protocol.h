@@ -16,6 +16,8 @@
 
 #include <univalue.h>
 
+class JSONStreamWriter;
+
 //! HTTP status codes
 enum HTTPStatusCode {
     HTTP_OK                    = 200,
@@ -83,6 +85,8 @@ enum RPCErrorCode {
 UniValue JSONRPCRequestObj(const std::string& strMethod, const UniValue& params, const UniValue& id);
 UniValue JSONRPCReplyObj(const UniValue& result, const UniValue& error, const UniValue& id);
 std::string JSONRPCReply(const UniValue& result, const UniValue& error, const UniValue& id);
+//! Writes the reply object to writer, without copying result into it
+void JSONRPCReply(JSONStreamWriter& writer, const UniValue& result, const UniValue& error, const UniValue& id);
 UniValue JSONRPCError(int code, const std::string& message);
 
 /** Get name of RPC authentication cookie file */
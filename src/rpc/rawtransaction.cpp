@@ -7,6 +7,7 @@
 
 #include "core_io.h"
 #include "evo/providertx.h"
+#include "index/txindex.h"
 #include "key_io.h"
 #include "keystore.h"
 #include "llmq/quorums_chainlocks.h"
@@ -18,6 +19,7 @@
 #include "script/script_error.h"
 #include "script/sign.h"
 #include "script/standard.h"
+#include "txdb.h"
 #include "uint256.h"
 #include "utilmoneystr.h"
 #include "validationinterface.h"
@@ -69,6 +71,69 @@ static void PayloadToJSON(const CTransaction& tx, UniValue& entry)
     }
 }
 
+// Resolve the prevouts of the inputs, and the spends of the outputs, with a single batch of spent index lookups
+static void SpentInfoToJSON(const CTransaction& tx, UniValue& entry)
+{
+    const bool fHasInputs = !tx.IsCoinBase() && !tx.HasZerocoinSpendInputs();
+    std::vector<COutPoint> vOutpoints;
+    vOutpoints.reserve((fHasInputs ? tx.vin.size() : 0) + tx.vout.size());
+    if (fHasInputs) {
+        for (const CTxIn& txin : tx.vin) {
+            vOutpoints.emplace_back(txin.prevout);
+        }
+    }
+    const size_t nOutputsStart = vOutpoints.size();
+    for (unsigned int i = 0; i < tx.vout.size(); i++) {
+        vOutpoints.emplace_back(tx.GetHash(), i);
+    }
+
+    std::vector<CSpentIndexValue> vSpent;
+    if (!pblocktree->ReadSpentIndex(vOutpoints, vSpent)) {
+        return;
+    }
+
+    if (fHasInputs) {
+        UniValue vin(UniValue::VARR);
+        CAmount nValueIn = 0;
+        bool fAllResolved = true;
+        for (size_t i = 0; i < nOutputsStart; i++) {
+            UniValue in = entry["vin"][i];
+            const CSpentIndexValue& spent = vSpent[i];
+            if (spent.IsNull()) {
+                fAllResolved = false;
+            } else {
+                in.pushKV("value", ValueFromAmount(spent.satoshis));
+                in.pushKV("valueSat", spent.satoshis);
+                // P2CS prevouts are shown with their staker address
+                const bool fColdStake = spent.script.IsPayToColdStaking();
+                CTxDestination dest;
+                if (ExtractDestination(spent.script, dest, fColdStake)) {
+                    in.pushKV("address", EncodeDestination(dest, fColdStake, spent.script.IsPayToExchangeAddress()));
+                }
+                nValueIn += spent.satoshis;
+            }
+            vin.push_back(in);
+        }
+        entry.pushKV("vin", vin);
+        if (fAllResolved && !tx.IsCoinStake()) {
+            entry.pushKV("fee", ValueFromAmount(nValueIn + tx.GetShieldedValueIn() - tx.GetValueOut()));
+        }
+    }
+
+    UniValue vout(UniValue::VARR);
+    for (size_t i = nOutputsStart; i < vSpent.size(); i++) {
+        UniValue out = entry["vout"][i - nOutputsStart];
+        const CSpentIndexValue& spent = vSpent[i];
+        if (!spent.IsNull()) {
+            out.pushKV("spentTxId", spent.txid.GetHex());
+            out.pushKV("spentIndex", (int)spent.inputIndex);
+            out.pushKV("spentHeight", spent.blockHeight);
+        }
+        vout.push_back(out);
+    }
+    entry.pushKV("vout", vout);
+}
+
 extern int ComputeNextBlockAndDepth(const CBlockIndex* tip, const CBlockIndex* blockindex, const CBlockIndex*& next);
 
 static int ComputeConfirmations(const CBlockIndex* tip, const CBlockIndex* blockindex)
@@ -106,6 +171,10 @@ void TxToJSON(CWallet* const pwallet, const CTransaction& tx, const CBlockIndex*
         PayloadToJSON(tx, entry);
     }
 
+    if (fSpentIndex) {
+        SpentInfoToJSON(tx, entry);
+    }
+
     bool chainLock = false;
     if (blockindex && tip) {
         entry.pushKV("blockhash", blockindex->GetBlockHash().ToString());
@@ -193,7 +262,10 @@ UniValue getrawtransaction(const JSONRPCRequest& request)
             "         \"asm\": \"asm\",  (string) asm\n"
             "         \"hex\": \"hex\"   (string) hex\n"
             "       },\n"
-            "       \"sequence\": n      (numeric) The script sequence number\n"
+            "       \"sequence\": n,     (numeric) The script sequence number\n"
+            "       \"value\": x.xxx,    (numeric) The value of the spent output in PIV (only with -spentindex, when its spend is in the chain)\n"
+            "       \"valueSat\": n,     (numeric) `value` in sats (only with -spentindex)\n"
+            "       \"address\": \"addr\" (string) The address of the spent output (only with -spentindex)\n"
             "     }\n"
             "     ,...\n"
             "  ],\n"
@@ -210,7 +282,10 @@ UniValue getrawtransaction(const JSONRPCRequest& request)
             "           \"pivxaddress\"        (string) pivx address\n"
             "           ,...\n"
             "         ]\n"
-            "       }\n"
+            "       },\n"
+            "       \"spentTxId\" : \"id\",        (string) The transaction spending the output (only with -spentindex, when spent in the chain)\n"
+            "       \"spentIndex\" : n,           (numeric) The input of spentTxId spending the output (only with -spentindex)\n"
+            "       \"spentHeight\" : n           (numeric) The height of the block of spentTxId (only with -spentindex)\n"
             "     }\n"
             "     ,...\n"
             "  ],\n"
@@ -218,6 +293,7 @@ UniValue getrawtransaction(const JSONRPCRequest& request)
             "  \"shielded_addresses\"      (json array of string) the shielded addresses involved in this transaction if possible (only for shielded transactions and the tx owner/viewer)\n"
             "  \"extraPayloadSize\" : n    (numeric) Size of extra payload. Only present if it's a special TX\n"
             "  \"extraPayload\" : \"hex\"  (string) Hex encoded extra payload data. Only present if it's a special TX\n"
+            "  \"fee\" : x.xxx,            (numeric) The fee in PIV (only with -spentindex, when all the inputs are resolved)\n"
             "  \"blockhash\" : \"hash\",   (string) the block hash\n"
             "  \"confirmations\" : n,      (numeric) The confirmations\n"
             "  \"time\" : ttt,             (numeric) The transaction time in seconds since epoch (Jan 1 1970 GMT)\n"
@@ -232,6 +308,10 @@ UniValue getrawtransaction(const JSONRPCRequest& request)
             + HelpExampleCli("getrawtransaction", "\"mytxid\" true \"myblockhash\"")
         );
 
+    if (request.params[2].isNull() && g_txindex) {
+        g_txindex->BlockUntilSyncedToCurrentChain();
+    }
+
     LOCK(cs_main);
 
     bool in_active_chain = true;
@@ -262,9 +342,13 @@ UniValue getrawtransaction(const JSONRPCRequest& request)
             }
             errmsg = "No such transaction found in the provided block";
         } else {
-            errmsg = fTxIndex
-              ? "No such mempool or blockchain transaction"
-              : "No such mempool transaction. Use -txindex to enable blockchain transaction queries";
+            if (!g_txindex) {
+                errmsg = "No such mempool transaction. Use -txindex to enable blockchain transaction queries";
+            } else if (!g_txindex->IsSynced()) {
+                errmsg = "No such mempool or blockchain transaction. The transaction index is still being built";
+            } else {
+                errmsg = "No such mempool or blockchain transaction";
+            }
         }
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, errmsg + ". Use gettransaction for wallet transactions.");
     }
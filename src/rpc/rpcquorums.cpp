@@ -7,6 +7,7 @@
 #include "chainparams.h"
 #include "llmq/quorums.h"
 #include "llmq/quorums_blockprocessor.h"
+#include "llmq/quorums_chainlocks.h"
 #include "llmq/quorums_commitment.h"
 #include "llmq/quorums_debug.h"
 #include "llmq/quorums_dkgsession.h"
@@ -297,6 +298,44 @@ UniValue getquorummembers(const JSONRPCRequest& request)
     return ret;
 }
 
+UniValue getchainlockstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getchainlockstats\n"
+            "Returns the latencies of the ChainLocks stages since the node started.\n"
+            "Latencies are in milliseconds, tracked for the blocks that became the tip of this node.\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"signed_sessions\": n,      (numeric) Number of blocks signed by this node (masternodes only)\n"
+            "  \"recovered_sigs\": n,       (numeric) Number of recovered signatures of the signed blocks\n"
+            "  \"chainlocks\": n,           (numeric) Number of new best chainlocks accepted\n"
+            "  \"timed_out_sessions\": n,   (numeric) Signed blocks not chainlocked within 60 seconds\n"
+            "  \"lost_races\": n,           (numeric) Signed blocks for which a competing block at the same height got chainlocked\n"
+            "  \"latency\": {\n"
+            "    \"stage\": {             (json object) One of tip_to_sign, sign_to_recovered_sig, tip_to_chainlock, tip_to_enforced\n"
+            "      \"count\": n,          (numeric) Number of samples\n"
+            "      \"avg_ms\": n,         (numeric) Average latency\n"
+            "      \"max_ms\": n,         (numeric) Maximum latency\n"
+            "      \"buckets\": [         (array of json objects) Histogram of the latencies\n"
+            "        {\n"
+            "          \"le_ms\": n,      (numeric) Upper bound of the bucket (gt_ms, lower bound, for the last bucket)\n"
+            "          \"count\": n       (numeric) Number of samples in the bucket\n"
+            "        },\n"
+            "        ...\n"
+            "      ]\n"
+            "    },\n"
+            "    ...\n"
+            "  }\n"
+            "}\n"
+
+            "\nExample:\n" +
+            HelpExampleRpc("getchainlockstats", "") + HelpExampleCli("getchainlockstats", ""));
+
+    return llmq::chainLocksHandler->GetStats().ToJson();
+}
+
 UniValue quorumdkgstatus(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() > 1) {
@@ -386,6 +425,7 @@ static const CRPCCommand commands[] =
     { "evo",         "quorumdkgstatus",        &quorumdkgstatus,     true,  {"detail_level"}  },
     { "evo",         "listquorums",            &listquorums,         true,  {"count"}  },
     { "evo",         "getquoruminfo",          &getquoruminfo,       true,  {"llmqType", "quorumHash", "includeSkShare"}  },
+    { "evo",         "getchainlockstats",      &getchainlockstats,   true,  {}  },
 
     /** Not shown in help */
     { "hidden",      "signsession",            &signsession,         true,  {"llmqType", "id", "msgHash"} },
@@ -7,9 +7,11 @@
 
 #include "rpc/server.h"
 
+#include "ctpl_stl.h"
 #include "fs.h"
 #include "key_io.h"
 #include "random.h"
+#include "rpc/jsonwriter.h"
 #include "shutdown.h"
 #include "sync.h"
 #include "guiinterface.h"
@@ -38,6 +40,11 @@ static RPCTimerInterface* timerInterface = nullptr;
 /* Map of name to timer. */
 static std::map<std::string, std::unique_ptr<RPCTimerBase>> deadlineTimers;
 
+/* Threads executing the read-only requests of the batches (-rpcbatchthreads) */
+static Mutex cs_rpcBatchPool;
+static std::unique_ptr<ctpl::thread_pool> rpcBatchPool GUARDED_BY(cs_rpcBatchPool);
+static int nRPCBatchThreads{0};
+
 static struct CRPCSignals
 {
     boost::signals2::signal<void ()> Started;
@@ -329,6 +336,12 @@ bool StartRPC()
 {
     LogPrint(BCLog::RPC, "Starting RPC\n");
     g_rpc_running = true;
+    nRPCBatchThreads = std::max((int) gArgs.GetArg("-rpcbatchthreads", DEFAULT_RPC_BATCH_THREADS), 0);
+    if (nRPCBatchThreads > 0) {
+        LOCK(cs_rpcBatchPool);
+        rpcBatchPool.reset(new ctpl::thread_pool(nRPCBatchThreads));
+        LogPrint(BCLog::RPC, "Executing the read-only requests of the batches on %d threads\n", nRPCBatchThreads);
+    }
     g_rpcSignals.Started();
     return true;
 }
@@ -344,6 +357,9 @@ void StopRPC()
 {
     LogPrint(BCLog::RPC, "Stopping RPC\n");
     deadlineTimers.clear();
+    // The batches being executed finish their remaining requests sequentially
+    std::unique_ptr<ctpl::thread_pool> pool = WITH_LOCK(cs_rpcBatchPool, return std::move(rpcBatchPool); );
+    if (pool) pool->stop(true);
     DeleteAuthCookie();
     g_rpcSignals.Stopped();
 }
@@ -411,33 +427,100 @@ bool IsDeprecatedRPCEnabled(const std::string& method)
     return find(enabled_methods.begin(), enabled_methods.end(), method) != enabled_methods.end();
 }
 
-static UniValue JSONRPCExecOne(const UniValue& req)
+/** Reply to a request of a batch, waiting to be written */
+struct JSONRPCBatchReply
 {
-    UniValue rpc_result(UniValue::VOBJ);
+    UniValue result;
+    UniValue error;
+    UniValue id;
+    //! Set when the request is executed by the batch threads
+    std::future<void> done;
+};
 
+static void JSONRPCExecOne(const UniValue& req, JSONRPCBatchReply& reply)
+{
     JSONRPCRequest jreq;
     try {
         jreq.parse(req);
 
-        UniValue result = tableRPC.execute(jreq);
-        rpc_result = JSONRPCReplyObj(result, NullUniValue, jreq.id);
+        reply.result = tableRPC.execute(jreq);
     } catch (const UniValue& objError) {
-        rpc_result = JSONRPCReplyObj(NullUniValue, objError, jreq.id);
+        reply.error = objError;
     } catch (const std::exception& e) {
-        rpc_result = JSONRPCReplyObj(NullUniValue,
-            JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
+        reply.error = JSONRPCError(RPC_PARSE_ERROR, e.what());
     }
-
-    return rpc_result;
+    reply.id = jreq.id;
+}
+
+//! Whether the request only reads the chain, so that it can be executed at the same time as the others
+static bool IsParallelBatchRequest(const UniValue& req)
+{
+    static const std::set<std::string> setReadOnlyMethods = {
+        "decoderawtransaction",
+        "decodescript",
+        "getbestblockhash",
+        "getblock",
+        "getblockcount",
+        "getblockhash",
+        "getblockheader",
+        "getrawtransaction",
+        "gettxout",
+    };
+    if (!req.isObject()) return false;
+    const UniValue& method = find_value(req.get_obj(), "method");
+    return method.isStr() && setReadOnlyMethods.count(method.get_str());
+}
+
+void JSONRPCExecBatch(const UniValue& vReq, JSONStreamWriter& writer)
+{
+    // Each reply is written (and released) as soon as it's available, in the order of the requests.
+    // The read-only requests are dispatched to the batch threads, keeping at most two
+    // per thread in flight, while the other ones wait for the previous requests.
+    const size_t nMaxInFlight = 2 * nRPCBatchThreads;
+    std::deque<JSONRPCBatchReply> pending;
+    auto writeFront = [&]() {
+        JSONRPCBatchReply& reply = pending.front();
+        if (reply.done.valid()) reply.done.wait();
+        JSONRPCReply(writer, reply.result, reply.error, reply.id);
+        pending.pop_front();
+    };
+
+    writer.BeginArray();
+    try {
+        for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++) {
+            const UniValue& req = vReq[reqIdx];
+            pending.emplace_back();
+            JSONRPCBatchReply& reply = pending.back();
+            if (nMaxInFlight > 0 && IsParallelBatchRequest(req)) {
+                LOCK(cs_rpcBatchPool);
+                if (rpcBatchPool) {
+                    reply.done = rpcBatchPool->push([&req, &reply](int) { JSONRPCExecOne(req, reply); });
+                }
+            }
+            if (!reply.done.valid()) {
+                // Executed here, after the previous requests
+                while (pending.size() > 1) writeFront();
+                JSONRPCExecOne(req, reply);
+            }
+            while (pending.size() > nMaxInFlight) writeFront();
+        }
+        while (!pending.empty()) writeFront();
+    } catch (...) {
+        // Don't release the replies still referenced by the batch threads
+        for (JSONRPCBatchReply& reply : pending) {
+            if (reply.done.valid()) reply.done.wait();
+        }
+        throw;
+    }
+    writer.EndArray();
 }
 
 std::string JSONRPCExecBatch(const UniValue& vReq)
 {
-    UniValue ret(UniValue::VARR);
-    for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(vReq[reqIdx]));
-
-    return ret.write() + "\n";
+    std::string strReply;
+    JSONStreamWriter writer([&strReply](std::string&& chunk) { strReply += chunk; });
+    JSONRPCExecBatch(vReq, writer);
+    return strReply + writer.Release() + "\n";
 }
 
 /**
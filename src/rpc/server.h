@@ -29,6 +29,10 @@ namespace RPCServer
 
 class CBlockIndex;
 class CNetAddr;
+class JSONStreamWriter;
+
+//! Default for -rpcbatchthreads
+static const int DEFAULT_RPC_BATCH_THREADS = 0;
 
 /** Wrapper for UniValue::VType, which includes typeAny:
  * Used to denote don't care type. Only used by RPCTypeCheckObj */
@@ -201,6 +205,8 @@ bool StartRPC();
 void InterruptRPC();
 void StopRPC();
 std::string JSONRPCExecBatch(const UniValue& vReq);
+//! Executes the requests of a batch, writing each reply to writer as soon as it's available
+void JSONRPCExecBatch(const UniValue& vReq, JSONStreamWriter& writer);
 void RPCNotifyBlockChange(bool fInitialDownload, const CBlockIndex* pindex);
 
 #endif // BITCOIN_RPCSERVER_H
@@ -33,7 +33,19 @@ extern "C" {
         const char* output_hash,
         const codeunit* sprout_path,
         size_t sprout_path_len,
-        const char* sprout_hash
+        const char* sprout_hash,
+        bool verify_params,
+        bool load_proving_params
+    );
+
+    /// Loads the Sapling proving parameters into memory,
+    /// when they were not loaded by librustzcash_init_zksnark_params.
+    void librustzcash_load_zksnark_proving_params(
+        const codeunit* spend_path,
+        size_t spend_path_len,
+        const codeunit* output_path,
+        size_t output_path_len,
+        bool verify_params
     );
 
     /// Validates the provided Equihash solution against
@@ -72,6 +84,19 @@ extern "C" {
         unsigned char *result
     );
 
+    /// Computes the merkle tree hashes of `count` pairs
+    /// of nodes at the same `depth`, as librustzcash_merkle_hash:
+    /// the pair i is the nodes 2*i and 2*i+1 of `nodes`.
+    ///
+    /// `nodes` must be of length 64 * count, and `result`
+    /// of length 32 * count.
+    void librustzcash_merkle_hash_batch(
+        size_t depth,
+        size_t count,
+        const unsigned char *nodes,
+        unsigned char *result
+    );
+
     /// Computes the signature for each Spend description, given the key
     /// `ask`, the re-randomization `ar`, the 32-byte sighash `sighash`,
     /// and an output `result` buffer of 64-bytes for the signature.
@@ -173,6 +198,52 @@ extern "C" {
     /// `librustzcash_sapling_verification_ctx_init`.
     void librustzcash_sapling_verification_ctx_free(void *);
 
+    /// Creates a Sapling batch validation context. Spend and Output
+    /// proofs added to it are verified all at once by
+    /// `librustzcash_sapling_batch_validate`.
+    void * librustzcash_sapling_batch_validator_init();
+
+    /// Checks the signature of a Sapling Spend description and
+    /// queues its proof in the batch, accumulating the value
+    /// commitment of the current transaction.
+    bool librustzcash_sapling_batch_check_spend(
+        void *batch,
+        const unsigned char *cv,
+        const unsigned char *anchor,
+        const unsigned char *nullifier,
+        const unsigned char *rk,
+        const unsigned char *zkproof,
+        const unsigned char *spendAuthSig,
+        const unsigned char *sighashValue
+    );
+
+    /// Queues the proof of a Sapling Output description in the
+    /// batch, accumulating the value commitment of the current
+    /// transaction.
+    bool librustzcash_sapling_batch_check_output(
+        void *batch,
+        const unsigned char *cv,
+        const unsigned char *cm,
+        const unsigned char *ephemeralKey,
+        const unsigned char *zkproof
+    );
+
+    /// Checks the binding signature of the current transaction,
+    /// and resets the accumulated value commitment for the next one.
+    bool librustzcash_sapling_batch_final_check(
+        void *batch,
+        int64_t valueBalance,
+        const unsigned char *bindingSig,
+        const unsigned char *sighashValue
+    );
+
+    /// Verifies all the proofs queued in the batch.
+    bool librustzcash_sapling_batch_validate(void *batch);
+
+    /// Frees a Sapling batch validation context returned from
+    /// `librustzcash_sapling_batch_validator_init`.
+    void librustzcash_sapling_batch_validator_free(void *);
+
     /// Compute a Sapling nullifier.
     ///
     /// The `diversifier` parameter must be 11 bytes in length.
@@ -3,13 +3,16 @@
 
 use bellman::{
     gadgets::multipack,
-    groth16::{create_random_proof, verify_proof, Parameters, PreparedVerifyingKey, Proof},
+    groth16::{
+        batch, create_random_proof, prepare_verifying_key, verify_proof, Parameters,
+        PreparedVerifyingKey, Proof, VerifyingKey,
+    },
 };
 use blake2s_simd::Params as Blake2sParams;
 use bls12_381::{Bls12, Scalar};
 use byteorder::{LittleEndian, ReadBytesExt, WriteBytesExt};
 use ff::{Field, PrimeField};
-use group::GroupEncoding;
+use group::{Curve, GroupEncoding};
 use jubjub::Fr;
 use libc::{c_char, c_uchar, size_t};
 use rand_core::OsRng;
@@ -25,7 +28,10 @@ use zcash_note_encryption::Domain;
 use zcash_primitives::{
     block::equihash,
     consensus::TestNetwork,
-    constants::{CRH_IVK_PERSONALIZATION, PROOF_GENERATION_KEY_GENERATOR, SPENDING_KEY_GENERATOR},
+    constants::{
+        CRH_IVK_PERSONALIZATION, PROOF_GENERATION_KEY_GENERATOR, SPENDING_KEY_GENERATOR,
+        VALUE_COMMITMENT_RANDOMNESS_GENERATOR, VALUE_COMMITMENT_VALUE_GENERATOR,
+    },
     merkle_tree::MerklePath,
     sapling::{
         keys::{DiversifiedTransmissionKey, EphemeralSecretKey, NullifierDerivingKey},
@@ -69,6 +75,9 @@ static mut SAPLING_SPEND_VK: Option<PreparedVerifyingKey<Bls12>> = None;
 static mut SAPLING_OUTPUT_VK: Option<PreparedVerifyingKey<Bls12>> = None;
 static mut SPROUT_GROTH16_VK: Option<PreparedVerifyingKey<Bls12>> = None;
 
+static mut SAPLING_SPEND_BATCH_VK: Option<VerifyingKey<Bls12>> = None;
+static mut SAPLING_OUTPUT_BATCH_VK: Option<VerifyingKey<Bls12>> = None;
+
 static mut SAPLING_SPEND_PARAMS: Option<Parameters<Bls12>> = None;
 static mut SAPLING_OUTPUT_PARAMS: Option<Parameters<Bls12>> = None;
 static mut SPROUT_GROTH16_PARAMS_PATH: Option<PathBuf> = None;
@@ -100,6 +109,8 @@ pub extern "system" fn librustzcash_init_zksnark_params(
     sprout_path: *const u8,
     sprout_path_len: usize,
     sprout_hash: *const c_char,
+    verify_params: bool,
+    load_proving_params: bool,
 ) {
     let spend_path = Path::new(OsStr::from_bytes(unsafe {
         slice::from_raw_parts(spend_path, spend_path_len)
@@ -122,6 +133,8 @@ pub extern "system" fn librustzcash_init_zksnark_params(
         output_hash,
         sprout_path,
         sprout_hash,
+        verify_params,
+        load_proving_params,
     )
 }
 
@@ -137,6 +150,8 @@ pub extern "system" fn librustzcash_init_zksnark_params(
     sprout_path: *const u16,
     sprout_path_len: usize,
     sprout_hash: *const c_char,
+    verify_params: bool,
+    load_proving_params: bool,
 ) {
     let spend_path =
         OsString::from_wide(unsafe { slice::from_raw_parts(spend_path, spend_path_len) });
@@ -157,6 +172,8 @@ pub extern "system" fn librustzcash_init_zksnark_params(
         output_hash,
         sprout_path.as_ref().map(|p| Path::new(p)),
         sprout_hash,
+        verify_params,
+        load_proving_params,
     )
 }
 
@@ -167,6 +184,8 @@ fn init_zksnark_params(
     output_hash: *const c_char,
     sprout_path: Option<&Path>,
     sprout_hash: *const c_char,
+    verify_params: bool,
+    load_proving_params: bool,
 ) {
     let _spend_hash = unsafe { CStr::from_ptr(spend_hash) }
         .to_str()
@@ -186,6 +205,27 @@ fn init_zksnark_params(
         )
     };
 
+    if !verify_params && sprout_path.is_none() {
+        // Only the verifying keys, at the start of the files, are read. The proving
+        // parameters are read on first use by librustzcash_load_zksnark_proving_params.
+        let spend_vk = read_verifying_key(spend_path);
+        let output_vk = read_verifying_key(output_path);
+
+        // Caller is responsible for calling this function once, so
+        // these global mutations are safe.
+        unsafe {
+            SAPLING_SPEND_VK = Some(prepare_verifying_key(&spend_vk));
+            SAPLING_OUTPUT_VK = Some(prepare_verifying_key(&output_vk));
+
+            SAPLING_SPEND_BATCH_VK = Some(spend_vk);
+            SAPLING_OUTPUT_BATCH_VK = Some(output_vk);
+        }
+        if load_proving_params {
+            load_zksnark_proving_params(spend_path, output_path, false);
+        }
+        return;
+    }
+
     // Load params
     let ZcashParameters {
         spend_params,
@@ -198,8 +238,13 @@ fn init_zksnark_params(
     // Caller is responsible for calling this function once, so
     // these global mutations are safe.
     unsafe {
-        SAPLING_SPEND_PARAMS = Some(spend_params);
-        SAPLING_OUTPUT_PARAMS = Some(output_params);
+        SAPLING_SPEND_BATCH_VK = Some(spend_params.vk.clone());
+        SAPLING_OUTPUT_BATCH_VK = Some(output_params.vk.clone());
+
+        if load_proving_params {
+            SAPLING_SPEND_PARAMS = Some(spend_params);
+            SAPLING_OUTPUT_PARAMS = Some(output_params);
+        }
         SPROUT_GROTH16_PARAMS_PATH = sprout_path.map(|p| p.to_owned());
 
         SAPLING_SPEND_VK = Some(spend_vk);
@@ -208,6 +253,72 @@ fn init_zksnark_params(
     }
 }
 
+/// Reads the verifying key at the start of a Sapling parameters file.
+fn read_verifying_key(path: &Path) -> VerifyingKey<Bls12> {
+    let file = File::open(path).expect("couldn't load Sapling parameters file");
+    VerifyingKey::<Bls12>::read(&mut BufReader::new(file))
+        .expect("couldn't deserialize Sapling verifying key")
+}
+
+/// Reads the Sapling proving parameters, hashing the files only with verify_params
+/// (the files already verified by a previous start are trusted).
+fn load_zksnark_proving_params(spend_path: &Path, output_path: &Path, verify_params: bool) {
+    let (spend_params, output_params) = if verify_params {
+        let params = load_parameters(spend_path, output_path, None);
+        (params.spend_params, params.output_params)
+    } else {
+        let read_params = |path: &Path| {
+            let file = File::open(path).expect("couldn't load Sapling parameters file");
+            Parameters::<Bls12>::read(&mut BufReader::with_capacity(1024 * 1024, file), false)
+                .expect("couldn't deserialize Sapling parameters file")
+        };
+        (read_params(spend_path), read_params(output_path))
+    };
+
+    // Caller is responsible for calling this function once, before
+    // any proof is created, so these global mutations are safe.
+    unsafe {
+        SAPLING_SPEND_PARAMS = Some(spend_params);
+        SAPLING_OUTPUT_PARAMS = Some(output_params);
+    }
+}
+
+#[cfg(not(target_os = "windows"))]
+#[no_mangle]
+pub extern "system" fn librustzcash_load_zksnark_proving_params(
+    spend_path: *const u8,
+    spend_path_len: usize,
+    output_path: *const u8,
+    output_path_len: usize,
+    verify_params: bool,
+) {
+    let spend_path = Path::new(OsStr::from_bytes(unsafe {
+        slice::from_raw_parts(spend_path, spend_path_len)
+    }));
+    let output_path = Path::new(OsStr::from_bytes(unsafe {
+        slice::from_raw_parts(output_path, output_path_len)
+    }));
+
+    load_zksnark_proving_params(spend_path, output_path, verify_params)
+}
+
+#[cfg(target_os = "windows")]
+#[no_mangle]
+pub extern "system" fn librustzcash_load_zksnark_proving_params(
+    spend_path: *const u16,
+    spend_path_len: usize,
+    output_path: *const u16,
+    output_path_len: usize,
+    verify_params: bool,
+) {
+    let spend_path =
+        OsString::from_wide(unsafe { slice::from_raw_parts(spend_path, spend_path_len) });
+    let output_path =
+        OsString::from_wide(unsafe { slice::from_raw_parts(output_path, output_path_len) });
+
+    load_zksnark_proving_params(Path::new(&spend_path), Path::new(&output_path), verify_params)
+}
+
 #[no_mangle]
 pub extern "system" fn librustzcash_tree_uncommitted(result: *mut [c_uchar; 32]) {
     let tmp = Fr::one();
@@ -235,6 +346,25 @@ pub extern "system" fn librustzcash_merkle_hash(
     *result = tmp;
 }
 
+/// Computes the Merkle tree hashes of `count` pairs of nodes at the same depth.
+#[no_mangle]
+pub extern "system" fn librustzcash_merkle_hash_batch(
+    depth: size_t,
+    count: size_t,
+    nodes: *const [c_uchar; 32],
+    result: *mut [c_uchar; 32],
+) {
+    // Should be okay, caller is responsible for ensuring the pointers
+    // are valid pointers to 2 * count nodes and to count hashes that
+    // can be mutated.
+    let nodes = unsafe { slice::from_raw_parts(nodes, 2 * count) };
+    let result = unsafe { slice::from_raw_parts_mut(result, count) };
+
+    for (pair, result) in nodes.chunks_exact(2).zip(result.iter_mut()) {
+        *result = merkle_hash(depth, &pair[0], &pair[1]);
+    }
+}
+
 #[no_mangle] // ToScalar
 pub extern "system" fn librustzcash_to_scalar(
     input: *const [c_uchar; 64],
@@ -687,6 +817,257 @@ pub extern "system" fn librustzcash_sapling_final_check(
     unsafe { &*ctx }.final_check(value_balance, unsafe { &*sighash_value }, binding_sig)
 }
 
+/// Batch validation context for the Sapling descriptions of many transactions.
+///
+/// Value commitments, spend authorization signatures and binding signatures
+/// are checked as soon as they are added, while the Groth16 proofs are only
+/// queued and then verified all at once (one multi-pairing per circuit) by
+/// `librustzcash_sapling_batch_validate`.
+pub struct SaplingBatchValidator {
+    spend_proofs: batch::Verifier<Bls12>,
+    output_proofs: batch::Verifier<Bls12>,
+    // Sum of the value commitments of the transaction currently being added
+    cv_sum: jubjub::ExtendedPoint,
+}
+
+/// Reads a jubjub point from its encoding, rejecting small order points
+fn read_point_not_small_order(from: &[c_uchar; 32]) -> Option<jubjub::ExtendedPoint> {
+    let p = jubjub::ExtendedPoint::from_bytes(from);
+    if p.is_none().into() {
+        return None;
+    }
+    let p = p.unwrap();
+    if p.is_small_order().into() {
+        return None;
+    }
+    Some(p)
+}
+
+/// Concatenates the encoding of a point with the sighash, as signed by
+/// spend authorization and binding signatures
+fn data_to_be_signed(p: &jubjub::ExtendedPoint, sighash: &[c_uchar; 32]) -> [u8; 64] {
+    let mut data = [0u8; 64];
+    data[0..32].copy_from_slice(&p.to_bytes());
+    data[32..64].copy_from_slice(&sighash[..]);
+    data
+}
+
+#[no_mangle]
+pub extern "system" fn librustzcash_sapling_batch_validator_init() -> *mut SaplingBatchValidator {
+    let batch = Box::new(SaplingBatchValidator {
+        spend_proofs: batch::Verifier::new(),
+        output_proofs: batch::Verifier::new(),
+        cv_sum: jubjub::ExtendedPoint::identity(),
+    });
+
+    Box::into_raw(batch)
+}
+
+#[no_mangle]
+pub extern "system" fn librustzcash_sapling_batch_validator_free(
+    batch: *mut SaplingBatchValidator,
+) {
+    drop(unsafe { Box::from_raw(batch) });
+}
+
+#[no_mangle]
+pub extern "system" fn librustzcash_sapling_batch_check_spend(
+    batch: *mut SaplingBatchValidator,
+    cv: *const [c_uchar; 32],
+    anchor: *const [c_uchar; 32],
+    nullifier: *const [c_uchar; 32],
+    rk: *const [c_uchar; 32],
+    zkproof: *const [c_uchar; GROTH_PROOF_SIZE],
+    spend_auth_sig: *const [c_uchar; 64],
+    sighash_value: *const [c_uchar; 32],
+) -> bool {
+    let batch = unsafe { &mut *batch };
+
+    // Deserialize the value commitment
+    let cv = match read_point_not_small_order(unsafe { &*cv }) {
+        Some(p) => p,
+        None => return false,
+    };
+
+    // Deserialize the anchor, which should be an element of Fr.
+    let anchor = {
+        let anchor = Scalar::from_repr(unsafe { *anchor });
+        if anchor.is_some().into() {
+            anchor.unwrap()
+        } else {
+            return false;
+        }
+    };
+
+    // Deserialize rk
+    let rk = match redjubjub::PublicKey::read(&(unsafe { &*rk })[..]) {
+        Ok(p) => p,
+        Err(_) => return false,
+    };
+    if rk.0.is_small_order().into() {
+        return false;
+    }
+
+    // Deserialize the signature
+    let spend_auth_sig = match Signature::read(&(unsafe { &*spend_auth_sig })[..]) {
+        Ok(sig) => sig,
+        Err(_) => return false,
+    };
+
+    // Deserialize the proof
+    let zkproof = match Proof::<Bls12>::read(&(unsafe { &*zkproof })[..]) {
+        Ok(p) => p,
+        Err(_) => return false,
+    };
+
+    // Verify the spend authorization signature
+    let data = data_to_be_signed(&rk.0, unsafe { &*sighash_value });
+    if !rk.verify_with_zip216(&data, &spend_auth_sig, SPENDING_KEY_GENERATOR, true) {
+        return false;
+    }
+
+    // Accumulate the value commitment
+    batch.cv_sum += cv;
+
+    // Construct the public inputs of the spend circuit and queue the proof
+    let rk_affine = rk.0.to_affine();
+    let cv_affine = cv.to_affine();
+    let nullifier = multipack::bytes_to_bits_le(&(unsafe { &*nullifier })[..]);
+    let nullifier = multipack::compute_multipacking::<Scalar>(&nullifier);
+    assert_eq!(nullifier.len(), 2);
+
+    let public_input = [
+        rk_affine.get_u(),
+        rk_affine.get_v(),
+        cv_affine.get_u(),
+        cv_affine.get_v(),
+        anchor,
+        nullifier[0],
+        nullifier[1],
+    ];
+    batch.spend_proofs.queue((&zkproof, &public_input[..]));
+
+    true
+}
+
+#[no_mangle]
+pub extern "system" fn librustzcash_sapling_batch_check_output(
+    batch: *mut SaplingBatchValidator,
+    cv: *const [c_uchar; 32],
+    cm: *const [c_uchar; 32],
+    epk: *const [c_uchar; 32],
+    zkproof: *const [c_uchar; GROTH_PROOF_SIZE],
+) -> bool {
+    let batch = unsafe { &mut *batch };
+
+    // Deserialize the value commitment
+    let cv = match read_point_not_small_order(unsafe { &*cv }) {
+        Some(p) => p,
+        None => return false,
+    };
+
+    // Deserialize the commitment, which should be an element of Fr.
+    let cm = {
+        let cm = Scalar::from_repr(unsafe { *cm });
+        if cm.is_some().into() {
+            cm.unwrap()
+        } else {
+            return false;
+        }
+    };
+
+    // Deserialize the ephemeral key
+    let epk = match read_point_not_small_order(unsafe { &*epk }) {
+        Some(p) => p,
+        None => return false,
+    };
+
+    // Deserialize the proof
+    let zkproof = match Proof::<Bls12>::read(&(unsafe { &*zkproof })[..]) {
+        Ok(p) => p,
+        Err(_) => return false,
+    };
+
+    // Accumulate the value commitment
+    batch.cv_sum -= cv;
+
+    // Construct the public inputs of the output circuit and queue the proof
+    let cv_affine = cv.to_affine();
+    let epk_affine = epk.to_affine();
+
+    let public_input = [
+        cv_affine.get_u(),
+        cv_affine.get_v(),
+        epk_affine.get_u(),
+        epk_affine.get_v(),
+        cm,
+    ];
+    batch.output_proofs.queue((&zkproof, &public_input[..]));
+
+    true
+}
+
+#[no_mangle]
+pub extern "system" fn librustzcash_sapling_batch_final_check(
+    batch: *mut SaplingBatchValidator,
+    value_balance: i64,
+    binding_sig: *const [c_uchar; 64],
+    sighash_value: *const [c_uchar; 32],
+) -> bool {
+    let batch = unsafe { &mut *batch };
+
+    // The value commitments sum is per transaction: reset it for the next one
+    let cv_sum = std::mem::replace(&mut batch.cv_sum, jubjub::ExtendedPoint::identity());
+
+    let value_balance = match Amount::from_i64(value_balance) {
+        Ok(vb) => i64::from(vb),
+        Err(()) => return false,
+    };
+
+    // Deserialize the signature
+    let binding_sig = match Signature::read(&(unsafe { &*binding_sig })[..]) {
+        Ok(sig) => sig,
+        Err(_) => return false,
+    };
+
+    // Compute the commitment to the value balance, without randomness
+    let abs = match value_balance.checked_abs() {
+        Some(a) => a as u64,
+        None => return false,
+    };
+    let mut vb_commitment: jubjub::ExtendedPoint =
+        (VALUE_COMMITMENT_VALUE_GENERATOR * jubjub::Fr::from(abs)).into();
+    if value_balance < 0 {
+        vb_commitment = -vb_commitment;
+    }
+
+    // Verify the binding signature with bvk = cv_sum - [valueBalance] * G
+    let bvk = redjubjub::PublicKey(cv_sum - vb_commitment);
+    let data = data_to_be_signed(&bvk.0, unsafe { &*sighash_value });
+    bvk.verify_with_zip216(
+        &data,
+        &binding_sig,
+        VALUE_COMMITMENT_RANDOMNESS_GENERATOR,
+        true,
+    )
+}
+
+/// Verifies all the queued proofs. The batch can't be reused afterwards.
+#[no_mangle]
+pub extern "system" fn librustzcash_sapling_batch_validate(
+    batch: *mut SaplingBatchValidator,
+) -> bool {
+    let batch = unsafe { &mut *batch };
+
+    let spend_proofs = std::mem::replace(&mut batch.spend_proofs, batch::Verifier::new());
+    let output_proofs = std::mem::replace(&mut batch.output_proofs, batch::Verifier::new());
+
+    let spend_vk = unsafe { SAPLING_SPEND_BATCH_VK.as_ref() }.unwrap();
+    let output_vk = unsafe { SAPLING_OUTPUT_BATCH_VK.as_ref() }.unwrap();
+
+    spend_proofs.verify(OsRng, spend_vk).is_ok() && output_proofs.verify(OsRng, output_vk).is_ok()
+}
+
 #[no_mangle]
 pub extern "system" fn librustzcash_sprout_prove(
     proof_out: *mut [c_uchar; GROTH_PROOF_SIZE],
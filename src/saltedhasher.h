@@ -8,6 +8,8 @@
 #include "crypto/siphash.h"
 #include "uint256.h"
 
+#include <vector>
+
 /** Helper classes for std::unordered_map and std::unordered_set hashing */
 
 template<typename T> struct SaltedHasherImpl;
@@ -39,6 +41,15 @@ struct SaltedHasherImpl<uint256>
     }
 };
 
+template<>
+struct SaltedHasherImpl<std::vector<unsigned char>>
+{
+    static std::size_t CalcHash(const std::vector<unsigned char>& v, uint64_t k0, uint64_t k1)
+    {
+        return CSipHasher(k0, k1).Write(v.data(), v.size()).Finalize();
+    }
+};
+
 struct SaltedHasherBase
 {
     /** Salt */
@@ -76,21 +76,19 @@ bool CCryptoKeyStore::UnlockSaplingKeys(const CKeyingMaterial& vMasterKeyIn, boo
         return true;
     }
 
-    bool keyFail = false;
-    bool keyPass = false;
-    CryptedSaplingSpendingKeyMap::const_iterator miSapling = mapCryptedSaplingSpendingKeys.begin();
-    for (; miSapling != mapCryptedSaplingSpendingKeys.end(); ++miSapling) {
-        const libzcash::SaplingExtendedFullViewingKey &extfvk = (*miSapling).first;
-        const std::vector<unsigned char> &vchCryptedSecret = (*miSapling).second;
-        libzcash::SaplingExtendedSpendingKey sk;
-        if (!DecryptSaplingSpendingKey(vMasterKeyIn, vchCryptedSecret, extfvk, sk)) {
-            keyFail = true;
-            break;
-        }
-        keyPass = true;
-        if (fDecryptionThoroughlyChecked)
-            break;
+    // The first key checks the passphrase. The first unlock then checks all the others, in parallel.
+    std::vector<CryptedSaplingSpendingKeyMap::const_iterator> vKeys;
+    vKeys.reserve(fDecryptionThoroughlyChecked ? 1 : mapCryptedSaplingSpendingKeys.size());
+    for (auto miSapling = mapCryptedSaplingSpendingKeys.begin(); miSapling != mapCryptedSaplingSpendingKeys.end(); ++miSapling) {
+        vKeys.push_back(miSapling);
+        if (fDecryptionThoroughlyChecked) break;
     }
+    const auto checkKey = [&](size_t i) {
+        libzcash::SaplingExtendedSpendingKey sk;
+        return DecryptSaplingSpendingKey(vMasterKeyIn, vKeys[i]->second, vKeys[i]->first, sk);
+    };
+    const bool keyPass = checkKey(0);
+    const bool keyFail = !keyPass || !CheckCryptedKeys(vKeys.size() - 1, [&](size_t i) { return checkKey(i + 1); });
 
     if (keyPass && keyFail) {
         LogPrintf("Sapling wallet is probably corrupted: Some keys decrypt but not all.");
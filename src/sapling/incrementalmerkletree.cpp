@@ -3,6 +3,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or https://www.opensource.org/licenses/mit-license.php.
 
+#include <assert.h>
 #include <stdexcept>
 
 #include "crypto/sha256.h"
@@ -30,6 +31,25 @@ PedersenHash PedersenHash::combine(
     return res;
 }
 
+std::vector<PedersenHash> PedersenHash::combine_pairs(
+    const std::vector<PedersenHash>& nodes,
+    size_t depth
+)
+{
+    static_assert(sizeof(PedersenHash) == 32, "the nodes must be contiguous");
+    assert(nodes.size() % 2 == 0);
+    std::vector<PedersenHash> res(nodes.size() / 2);
+    if (!res.empty()) {
+        librustzcash_merkle_hash_batch(
+            depth,
+            res.size(),
+            nodes[0].begin(),
+            res[0].begin()
+        );
+    }
+    return res;
+}
+
 PedersenHash PedersenHash::uncommitted() {
     PedersenHash res = PedersenHash();
 
@@ -439,6 +459,20 @@ SHA256Compress SHA256Compress::combine(
     return res;
 }
 
+std::vector<SHA256Compress> SHA256Compress::combine_pairs(
+    const std::vector<SHA256Compress>& nodes,
+    size_t depth
+)
+{
+    assert(nodes.size() % 2 == 0);
+    std::vector<SHA256Compress> res;
+    res.reserve(nodes.size() / 2);
+    for (size_t i = 0; i < nodes.size(); i += 2) {
+        res.push_back(combine(nodes[i], nodes[i + 1], depth));
+    }
+    return res;
+}
+
 static const std::array<SHA256Compress, 66> sha256_empty_roots = {
     uint256(std::vector<unsigned char>{
         0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
@@ -956,6 +990,55 @@ void IncrementalMerkleTree<Depth, Hash>::append(Hash obj) {
     }
 }
 
+template<size_t Depth, typename Hash>
+void IncrementalMerkleTree<Depth, Hash>::append(const std::vector<Hash>& objs) {
+    if (objs.empty()) {
+        return;
+    }
+    const uint64_t nSize = size();
+    if (objs.size() > (((uint64_t)1) << Depth) - nSize) {
+        throw std::runtime_error("tree is full");
+    }
+    const uint64_t nTotal = nSize + objs.size();
+
+    // The leaves not combined yet: the pending left and right ones, then the new ones.
+    // The parents hold the combination of the leaves before them, so they start at an
+    // even position, and so do the nodes of each level above.
+    std::vector<Hash> nodes;
+    nodes.reserve(objs.size() + 2);
+    if (left) nodes.push_back(*left);
+    if (right) nodes.push_back(*right);
+    nodes.insert(nodes.end(), objs.begin(), objs.end());
+
+    // As append(), keep the last leaf (odd size) or the last two (even size) uncombined
+    const size_t nKeep = (nTotal & 1) ? 1 : 2;
+    left = nodes[nodes.size() - nKeep];
+    right = nKeep == 2 ? Optional<Hash>(nodes.back()) : nullopt;
+    nodes.resize(nodes.size() - nKeep);
+
+    // Combine the rest level by level, each pending parent preceding the nodes of its level
+    for (size_t d = 0; !nodes.empty(); d++) {
+        std::vector<Hash> next = Hash::combine_pairs(nodes, d);
+        if (d < parents.size() && parents[d]) {
+            next.insert(next.begin(), *parents[d]);
+        }
+        if (parents.size() <= d) {
+            parents.resize(d + 1);
+        }
+        if (next.size() & 1) {
+            // the last node is a left child waiting for its sibling
+            parents[d] = next.back();
+            next.pop_back();
+        } else {
+            parents[d] = nullopt;
+        }
+        nodes = std::move(next);
+    }
+    while (!parents.empty() && !parents.back()) {
+        parents.pop_back();
+    }
+}
+
 // This is for allowing the witness to determine if a subtree has filled
 // to a particular depth, or for append() to ensure we're not appending
 // to a full tree.
@@ -1138,6 +1221,133 @@ void IncrementalWitness<Depth, Hash>::append(Hash obj) {
     }
 }
 
+template<size_t Depth, typename Hash>
+uint64_t IncrementalWitness<Depth, Hash>::next_position() const {
+    uint64_t pos = tree.size();
+    for (size_t i = 0; i < filled.size(); i++) {
+        pos += (uint64_t) 1 << tree.next_depth(i);
+    }
+    if (cursor) {
+        pos += cursor->size();
+    }
+    return pos;
+}
+
+template<size_t Depth, typename Hash>
+void IncrementalWitness<Depth, Hash>::append(const IncrementalMerkleFrontier<Depth, Hash>& frontier) {
+    uint64_t pos = next_position();
+    if (pos < frontier.nStart || pos > frontier.nSize) {
+        throw std::runtime_error("witness is out of the frontier range");
+    }
+
+    while (true) {
+        if (!cursor) {
+            if (pos == frontier.nSize) {
+                break;
+            }
+            cursor_depth = tree.next_depth(filled.size());
+            if (cursor_depth >= Depth) {
+                throw std::runtime_error("tree is full");
+            }
+        }
+
+        // The uncle subtrees are aligned, so pos lies in the subtree with this index.
+        const uint64_t index = pos >> cursor_depth;
+        Optional<Hash> root = frontier.subtree_root(cursor_depth, index);
+        if (root) {
+            filled.push_back(*root);
+            cursor = nullopt;
+            pos = (index + 1) << cursor_depth;
+        } else {
+            // The subtree is not complete yet, so it holds the last commitment of the frontier
+            cursor = frontier.partial_subtree(cursor_depth);
+            break;
+        }
+    }
+}
+
+template<size_t Depth, typename Hash>
+IncrementalMerkleFrontier<Depth, Hash>::IncrementalMerkleFrontier(const IncrementalMerkleTree<Depth, Hash>& tree) :
+        current(tree),
+        nStart(tree.size()),
+        nSize(nStart),
+        ommers(Depth + 1),
+        completed(Depth + 1),
+        firstCompleted(Depth + 1, 0)
+{
+    // Collapse the (lazy) left/right leaves of the tree, so that ommers[d]
+    // is set for every bit d of the size.
+    Optional<Hash> carry;
+    if (tree.left && tree.right) {
+        carry = Hash::combine(*tree.left, *tree.right, 0);
+    } else if (tree.left) {
+        ommers[0] = *tree.left;
+    }
+    for (size_t i = 0; i < tree.parents.size(); i++) {
+        const Optional<Hash>& parent = tree.parents[i];
+        if (carry) {
+            if (parent) {
+                carry = Hash::combine(*parent, *carry, i + 1);
+            } else {
+                ommers[i + 1] = carry;
+                carry = nullopt;
+            }
+        } else if (parent) {
+            ommers[i + 1] = parent;
+        }
+    }
+    if (carry) {
+        ommers[tree.parents.size() + 1] = carry;
+    }
+}
+
+template<size_t Depth, typename Hash>
+void IncrementalMerkleFrontier<Depth, Hash>::append(Hash obj) {
+    current.append(obj);
+
+    const uint64_t pos = nSize++;
+    Hash node = obj;
+    size_t d = 0;
+    while (true) {
+        if (completed[d].empty()) {
+            firstCompleted[d] = pos >> d;
+        }
+        completed[d].push_back(node);
+        if (((pos >> d) & 1) == 0) {
+            // left child: wait for its sibling
+            break;
+        }
+        node = Hash::combine(*ommers[d], node, d);
+        ommers[d] = nullopt;
+        d++;
+    }
+    ommers[d] = node;
+}
+
+template<size_t Depth, typename Hash>
+Optional<Hash> IncrementalMerkleFrontier<Depth, Hash>::subtree_root(size_t depth, uint64_t index) const {
+    const std::vector<Hash>& roots = completed[depth];
+    if (roots.empty() || index < firstCompleted[depth] || index - firstCompleted[depth] >= roots.size()) {
+        return nullopt;
+    }
+    return roots[index - firstCompleted[depth]];
+}
+
+template<size_t Depth, typename Hash>
+IncrementalMerkleTree<Depth, Hash> IncrementalMerkleFrontier<Depth, Hash>::partial_subtree(size_t depth) const {
+    // The lower levels of the tree only depend on the leaves of the subtree
+    // that they are filling: truncate the parents to get the subtree alone.
+    IncrementalMerkleTree<Depth, Hash> subtree;
+    subtree.left = current.left;
+    subtree.right = current.right;
+    subtree.parents.assign(current.parents.begin(),
+                           current.parents.begin() + std::min(current.parents.size(), depth - 1));
+    while (!subtree.parents.empty() && !subtree.parents.back()) {
+        subtree.parents.pop_back();
+    }
+    return subtree;
+}
+
 template class IncrementalMerkleTree<INCREMENTAL_MERKLE_TREE_DEPTH, SHA256Compress>;
 template class IncrementalMerkleTree<INCREMENTAL_MERKLE_TREE_DEPTH_TESTING, SHA256Compress>;
 
@@ -1150,4 +1360,10 @@ template class IncrementalMerkleTree<INCREMENTAL_MERKLE_TREE_DEPTH_TESTING, Pede
 template class IncrementalWitness<SAPLING_INCREMENTAL_MERKLE_TREE_DEPTH, PedersenHash>;
 template class IncrementalWitness<INCREMENTAL_MERKLE_TREE_DEPTH_TESTING, PedersenHash>;
 
+template class IncrementalMerkleFrontier<INCREMENTAL_MERKLE_TREE_DEPTH, SHA256Compress>;
+template class IncrementalMerkleFrontier<INCREMENTAL_MERKLE_TREE_DEPTH_TESTING, SHA256Compress>;
+
+template class IncrementalMerkleFrontier<SAPLING_INCREMENTAL_MERKLE_TREE_DEPTH, PedersenHash>;
+template class IncrementalMerkleFrontier<INCREMENTAL_MERKLE_TREE_DEPTH_TESTING, PedersenHash>;
+
 } // end namespace `libzcash`
@@ -15,6 +15,7 @@
 
 #include <array>
 #include <deque>
+#include <vector>
 
 namespace libzcash {
 
@@ -84,10 +85,14 @@ bool operator==(const EmptyMerkleRoots<Depth, Hash>& a,
 template<size_t Depth, typename Hash>
 class IncrementalWitness;
 
+template<size_t Depth, typename Hash>
+class IncrementalMerkleFrontier;
+
 template<size_t Depth, typename Hash>
 class IncrementalMerkleTree {
 
 friend class IncrementalWitness<Depth, Hash>;
+friend class IncrementalMerkleFrontier<Depth, Hash>;
 
 public:
     BOOST_STATIC_ASSERT(Depth >= 1);
@@ -103,6 +108,8 @@ public:
     size_t size() const;
 
     void append(Hash obj);
+    // Append the objects in order, hashing the nodes of each level of the tree together
+    void append(const std::vector<Hash>& objs);
     Hash root() const {
         return root(Depth, std::deque<Hash>());
     }
@@ -157,6 +164,12 @@ public:
     // Required for Unserialize()
     IncrementalWitness() {}
 
+    size_t DynamicMemoryUsage() const {
+        return tree.DynamicMemoryUsage() +
+               filled.size() * 32 + // filled
+               (cursor ? cursor->DynamicMemoryUsage() : 0); // cursor
+    }
+
     MerklePath path() const {
         return tree.path(partial_path());
     }
@@ -177,6 +190,10 @@ public:
 
     void append(Hash obj);
 
+    // Append all the commitments added to the frontier (and not yet witnessed),
+    // reusing the subtree roots computed once by the frontier.
+    void append(const IncrementalMerkleFrontier<Depth, Hash>& frontier);
+
     SERIALIZE_METHODS(IncrementalWitness, obj)
     {
         READWRITE(obj.tree, obj.filled, obj.cursor);
@@ -193,6 +210,8 @@ private:
     Optional<IncrementalMerkleTree<Depth, Hash>> cursor;
     size_t cursor_depth = 0;
     std::deque<Hash> partial_path() const;
+    // Position of the next commitment that this witness will receive
+    uint64_t next_position() const;
     IncrementalWitness(IncrementalMerkleTree<Depth, Hash> tree) : tree(tree) {}
 };
 
@@ -205,6 +224,44 @@ bool operator==(const IncrementalWitness<Depth, Hash>& a,
             a.cursor_depth == b.cursor_depth);
 }
 
+/**
+ * Right edge of a commitment tree, shared by all the witnesses that follow it.
+ * Every commitment appended to the frontier is hashed into the roots of the
+ * subtrees it completes only once; the witnesses are then brought up to date
+ * with IncrementalWitness::append(frontier), which takes those roots instead of
+ * re-hashing the same commitments on each witness.
+ */
+template<size_t Depth, typename Hash>
+class IncrementalMerkleFrontier {
+friend class IncrementalWitness<Depth, Hash>;
+
+public:
+    explicit IncrementalMerkleFrontier(const IncrementalMerkleTree<Depth, Hash>& tree);
+
+    void append(Hash obj);
+
+    // The tree, including every commitment appended to the frontier
+    const IncrementalMerkleTree<Depth, Hash>& tree() const { return current; }
+
+    uint64_t size() const { return nSize; }
+
+private:
+    IncrementalMerkleTree<Depth, Hash> current;
+    // Size of the tree when the frontier was created
+    uint64_t nStart;
+    uint64_t nSize;
+    // Completed left subtrees ("ommers") of the right edge, by depth
+    std::vector<Optional<Hash>> ommers;
+    // Roots of the subtrees completed since the frontier was created, by depth:
+    // completed[d][i] is the root of the subtree with index firstCompleted[d] + i.
+    std::vector<std::vector<Hash>> completed;
+    std::vector<uint64_t> firstCompleted;
+
+    Optional<Hash> subtree_root(size_t depth, uint64_t index) const;
+    // The incomplete subtree of the given depth which holds the last commitment
+    IncrementalMerkleTree<Depth, Hash> partial_subtree(size_t depth) const;
+};
+
 class SHA256Compress : public uint256 {
 public:
     SHA256Compress() : uint256() {}
@@ -215,6 +272,11 @@ public:
         const SHA256Compress& b,
         size_t depth
     );
+    // The combination of each pair of consecutive nodes (an even number of them)
+    static std::vector<SHA256Compress> combine_pairs(
+        const std::vector<SHA256Compress>& nodes,
+        size_t depth
+    );
 
     static SHA256Compress uncommitted() {
         return SHA256Compress();
@@ -232,6 +294,11 @@ public:
         const PedersenHash& b,
         size_t depth
     );
+    // The combination of each pair of consecutive nodes (an even number of them)
+    static std::vector<PedersenHash> combine_pairs(
+        const std::vector<PedersenHash>& nodes,
+        size_t depth
+    );
 
     static PedersenHash uncommitted();
     static PedersenHash EmptyRoot(size_t);
@@ -248,4 +315,7 @@ typedef libzcash::IncrementalMerkleTree<INCREMENTAL_MERKLE_TREE_DEPTH_TESTING, l
 typedef libzcash::IncrementalWitness<SAPLING_INCREMENTAL_MERKLE_TREE_DEPTH, libzcash::PedersenHash> SaplingWitness;
 typedef libzcash::IncrementalWitness<INCREMENTAL_MERKLE_TREE_DEPTH_TESTING, libzcash::PedersenHash> SaplingTestingWitness;
 
+typedef libzcash::IncrementalMerkleFrontier<SAPLING_INCREMENTAL_MERKLE_TREE_DEPTH, libzcash::PedersenHash> SaplingMerkleFrontier;
+typedef libzcash::IncrementalMerkleFrontier<INCREMENTAL_MERKLE_TREE_DEPTH_TESTING, libzcash::PedersenHash> SaplingTestingMerkleFrontier;
+
 #endif /* INCREMENTALMERKLETREE_H_ */
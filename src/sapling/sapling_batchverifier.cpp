@@ -0,0 +1,97 @@
+// Copyright (c) 2023 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+#include "sapling/sapling_batchverifier.h"
+
+#include "primitives/transaction.h"
+
+#include <librustzcash.h>
+
+namespace SaplingValidation {
+
+CSaplingBatchVerifier::CSaplingBatchVerifier() : ctx(librustzcash_sapling_batch_validator_init()) {}
+
+CSaplingBatchVerifier::~CSaplingBatchVerifier()
+{
+    librustzcash_sapling_batch_validator_free(ctx);
+}
+
+void CSaplingBatchVerifier::Add(const CSaplingProofCheck& check)
+{
+    vChecks.emplace_back(check);
+    if (!fAllOk) {
+        // The batch already failed, no need to keep checking.
+        return;
+    }
+
+    const CTransaction& tx = *check.GetTx();
+    const uint256& dataToBeSigned = check.GetDataToBeSigned();
+
+    for (const SpendDescription& spend : tx.sapData->vShieldedSpend) {
+        if (!librustzcash_sapling_batch_check_spend(
+                ctx,
+                spend.cv.begin(),
+                spend.anchor.begin(),
+                spend.nullifier.begin(),
+                spend.rk.begin(),
+                spend.zkproof.begin(),
+                spend.spendAuthSig.begin(),
+                dataToBeSigned.begin())) {
+            fAllOk = false;
+            return;
+        }
+    }
+
+    for (const OutputDescription& output : tx.sapData->vShieldedOutput) {
+        if (!librustzcash_sapling_batch_check_output(
+                ctx,
+                output.cv.begin(),
+                output.cmu.begin(),
+                output.ephemeralKey.begin(),
+                output.zkproof.begin())) {
+            fAllOk = false;
+            return;
+        }
+    }
+
+    if (!librustzcash_sapling_batch_final_check(
+            ctx,
+            tx.sapData->valueBalance,
+            tx.sapData->bindingSig.begin(),
+            dataToBeSigned.begin())) {
+        fAllOk = false;
+    }
+}
+
+bool CSaplingBatchVerifier::Verify(const CTransaction** pInvalidTx)
+{
+    if (vChecks.empty()) {
+        return true;
+    }
+
+    if (fAllOk && librustzcash_sapling_batch_validate(ctx)) {
+        return true;
+    }
+
+    // Fallback to per-transaction verification to find the culprit
+    for (CSaplingProofCheck& check : vChecks) {
+        if (!check()) {
+            if (pInvalidTx) *pInvalidTx = check.GetTx();
+            return false;
+        }
+    }
+    // The batch failed, but every transaction is valid on its own
+    return true;
+}
+
+bool CSaplingBatchCheck::operator()()
+{
+    CSaplingBatchVerifier batch;
+    for (const CSaplingProofCheck& check : vChecks) {
+        batch.Add(check);
+    }
+    return batch.Verify();
+}
+
+} // End SaplingValidation namespace
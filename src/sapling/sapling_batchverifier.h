@@ -0,0 +1,78 @@
+// Copyright (c) 2023 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_SAPLING_SAPLING_BATCHVERIFIER_H
+#define PIVX_SAPLING_SAPLING_BATCHVERIFIER_H
+
+#include "sapling/sapling_validation.h"
+
+#include <vector>
+
+class CTransaction;
+
+namespace SaplingValidation {
+
+/**
+ * Verifies the Sapling proofs of a set of transactions (e.g. all the shielded
+ * txes of a block) with a single Groth16 multi-pairing per circuit, instead
+ * of one pairing check per proof.
+ * Spend authorization and binding signatures are verified when a transaction
+ * is added. If the batch fails, every transaction is checked on its own to
+ * identify the invalid one.
+ */
+class CSaplingBatchVerifier
+{
+private:
+    void* ctx;
+    std::vector<CSaplingProofCheck> vChecks;
+    bool fAllOk{true};
+
+public:
+    CSaplingBatchVerifier();
+    ~CSaplingBatchVerifier();
+
+    CSaplingBatchVerifier(const CSaplingBatchVerifier&) = delete;
+    CSaplingBatchVerifier& operator=(const CSaplingBatchVerifier&) = delete;
+
+    // Queue the proofs of a shielded transaction.
+    // Note: this stores a reference to the transaction.
+    void Add(const CSaplingProofCheck& check);
+
+    bool IsEmpty() const { return vChecks.empty(); }
+
+    // Verify all the queued proofs. On failure, if pInvalidTx is not null, it's set
+    // to the first transaction that fails the per-transaction verification.
+    bool Verify(const CTransaction** pInvalidTx = nullptr);
+};
+
+/**
+ * Closure representing the batch verification of the Sapling proofs of a
+ * group of transactions, to be run by a CCheckQueue.
+ * Note that this stores references to the transactions.
+ */
+class CSaplingBatchCheck
+{
+private:
+    std::vector<CSaplingProofCheck> vChecks;
+
+public:
+    CSaplingBatchCheck() {}
+
+    void Add(CSaplingProofCheck& check)
+    {
+        vChecks.emplace_back();
+        vChecks.back().swap(check);
+    }
+
+    bool operator()();
+
+    void swap(CSaplingBatchCheck& check)
+    {
+        vChecks.swap(check.vChecks);
+    }
+};
+
+} // End SaplingValidation namespace
+
+#endif // PIVX_SAPLING_SAPLING_BATCHVERIFIER_H
@@ -0,0 +1,82 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "sapling/sapling_compactblock.h"
+
+#include "chain.h"
+#include "primitives/block.h"
+#include "utilstrencodings.h"
+
+#include <univalue.h>
+
+CompactSaplingBlock::CompactSaplingBlock(const CBlockIndex* pindex) :
+    height(pindex->nHeight),
+    hash(pindex->GetBlockHash()),
+    prevHash(pindex->pprev ? pindex->pprev->GetBlockHash() : UINT256_ZERO),
+    time(pindex->nTime),
+    saplingRoot(pindex->hashFinalSaplingRoot)
+{}
+
+std::vector<CompactSaplingTx> GetCompactSaplingTxs(const CBlock& block)
+{
+    std::vector<CompactSaplingTx> vtx;
+    for (size_t i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        if (!tx.IsShieldedTx()) continue;
+        const SaplingTxData& sapData = *tx.sapData;
+        if (sapData.vShieldedSpend.empty() && sapData.vShieldedOutput.empty()) continue;
+
+        CompactSaplingTx ctx;
+        ctx.index = (uint32_t) i;
+        ctx.txid = tx.GetHash();
+        ctx.nullifiers.reserve(sapData.vShieldedSpend.size());
+        for (const SpendDescription& spend : sapData.vShieldedSpend) {
+            ctx.nullifiers.emplace_back(spend.nullifier);
+        }
+        ctx.outputs.resize(sapData.vShieldedOutput.size());
+        for (size_t j = 0; j < sapData.vShieldedOutput.size(); j++) {
+            const OutputDescription& output = sapData.vShieldedOutput[j];
+            CompactSaplingOutput& coutput = ctx.outputs[j];
+            coutput.cmu = output.cmu;
+            coutput.ephemeralKey = output.ephemeralKey;
+            std::copy(output.encCiphertext.begin(), output.encCiphertext.begin() + SAPLING_COMPACT_NOTE_SIZE,
+                      coutput.ciphertext.begin());
+        }
+        vtx.emplace_back(std::move(ctx));
+    }
+    return vtx;
+}
+
+UniValue CompactSaplingBlockToJSON(const CompactSaplingBlock& block)
+{
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("height", block.height);
+    result.pushKV("hash", block.hash.GetHex());
+    result.pushKV("previousblockhash", block.prevHash.GetHex());
+    result.pushKV("time", (int64_t) block.time);
+    result.pushKV("finalsaplingroot", block.saplingRoot.GetHex());
+    UniValue txs(UniValue::VARR);
+    for (const CompactSaplingTx& ctx : block.vtx) {
+        UniValue tx(UniValue::VOBJ);
+        tx.pushKV("index", (int64_t) ctx.index);
+        tx.pushKV("txid", ctx.txid.GetHex());
+        UniValue nullifiers(UniValue::VARR);
+        for (const uint256& nullifier : ctx.nullifiers) {
+            nullifiers.push_back(nullifier.GetHex());
+        }
+        tx.pushKV("nullifiers", nullifiers);
+        UniValue outputs(UniValue::VARR);
+        for (const CompactSaplingOutput& output : ctx.outputs) {
+            UniValue out(UniValue::VOBJ);
+            out.pushKV("cmu", output.cmu.GetHex());
+            out.pushKV("ephemeralKey", output.ephemeralKey.GetHex());
+            out.pushKV("ciphertext", HexStr(output.ciphertext));
+            outputs.push_back(out);
+        }
+        tx.pushKV("outputs", outputs);
+        txs.push_back(tx);
+    }
+    result.pushKV("tx", txs);
+    return result;
+}
@@ -0,0 +1,70 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_SAPLING_COMPACTBLOCK_H
+#define PIVX_SAPLING_COMPACTBLOCK_H
+
+#include "sapling/sapling.h"
+#include "serialize.h"
+#include "uint256.h"
+
+#include <array>
+#include <vector>
+
+class CBlock;
+class CBlockIndex;
+class UniValue;
+
+/** Size of the start of the note ciphertext needed to trial-decrypt an output: the leading byte, the
+ * diversifier, the value and rcm of the note (ZIP 307) */
+static constexpr size_t SAPLING_COMPACT_NOTE_SIZE = ZC_NOTEPLAINTEXT_LEADING + ZC_DIVERSIFIER_SIZE + ZC_V_SIZE + ZC_R_SIZE;
+static_assert(SAPLING_COMPACT_NOTE_SIZE == 52, "the compact note ciphertext is 52 bytes");
+
+/** The part of a shielded output needed by a light wallet to detect and decrypt its notes */
+struct CompactSaplingOutput
+{
+    uint256 cmu;
+    uint256 ephemeralKey;
+    std::array<unsigned char, SAPLING_COMPACT_NOTE_SIZE> ciphertext{};
+
+    SERIALIZE_METHODS(CompactSaplingOutput, obj) { READWRITE(obj.cmu, obj.ephemeralKey, obj.ciphertext); }
+};
+
+/** The shielded spends (nullifiers) and outputs of a transaction, at position index of its block */
+struct CompactSaplingTx
+{
+    uint32_t index{0};
+    uint256 txid;
+    std::vector<uint256> nullifiers;
+    std::vector<CompactSaplingOutput> outputs;
+
+    SERIALIZE_METHODS(CompactSaplingTx, obj) { READWRITE(obj.index, obj.txid, obj.nullifiers, obj.outputs); }
+};
+
+/**
+ * Compact shielded block: the header fields a light wallet needs to follow the chain and the
+ * compact shielded data of the block transactions (only those with Sapling spends or outputs).
+ */
+struct CompactSaplingBlock
+{
+    int height{-1};
+    uint256 hash;
+    uint256 prevHash;
+    uint32_t time{0};
+    uint256 saplingRoot;    //!< the root of the note commitment tree after the block
+    std::vector<CompactSaplingTx> vtx;
+
+    CompactSaplingBlock() = default;
+    /** The header fields of the block of pindex, with no transactions */
+    explicit CompactSaplingBlock(const CBlockIndex* pindex);
+
+    SERIALIZE_METHODS(CompactSaplingBlock, obj) { READWRITE(obj.height, obj.hash, obj.prevHash, obj.time, obj.saplingRoot, obj.vtx); }
+};
+
+/** The compact shielded data of the transactions of block with Sapling spends or outputs */
+std::vector<CompactSaplingTx> GetCompactSaplingTxs(const CBlock& block);
+
+UniValue CompactSaplingBlockToJSON(const CompactSaplingBlock& block);
+
+#endif // PIVX_SAPLING_COMPACTBLOCK_H
@@ -79,6 +79,12 @@ TxValues calculateTarget(const std::vector<SendManyRecipient>& recipients, const
 }
 
 OperationResult SaplingOperation::build()
+{
+    OperationResult res = prepare();
+    return res ? proveAndSign() : res;
+}
+
+OperationResult SaplingOperation::prepare()
 {
     bool isFromtAddress = false;
     bool isFromShielded = false;
@@ -254,7 +260,11 @@ OperationResult SaplingOperation::build()
     }
     // Done
     fee = nFeeRet;
+    return OperationResult(true);
+}
 
+OperationResult SaplingOperation::proveAndSign()
+{
     // Clear dummy signatures/proofs and add real ones
     txBuilder.ClearProofsAndSignatures();
     TransactionBuilderResult txResult = txBuilder.ProveAndSign();
@@ -284,6 +294,18 @@ OperationResult SaplingOperation::buildAndSend(std::string& retTxHash)
     return (res) ? send(retTxHash) : res;
 }
 
+void SaplingOperation::setInputsLocked(bool fLocked)
+{
+    LOCK(wallet->cs_wallet);
+    for (const COutput& t : transInputs) {
+        const COutPoint outpoint(t.tx->GetHash(), t.i);
+        fLocked ? wallet->LockCoin(outpoint) : wallet->UnlockCoin(outpoint);
+    }
+    for (const SaplingOutPoint& op : selectedNotes) {
+        fLocked ? wallet->LockNote(op) : wallet->UnlockNote(op);
+    }
+}
+
 void SaplingOperation::setFromAddress(const CTxDestination& _dest)
 {
     fromAddress = FromAddress(_dest);
@@ -431,6 +453,7 @@ static CacheCheckResult CheckCachedNote(CWallet* pwallet,
 OperationResult SaplingOperation::loadUnspentNotes(TxValues& txValues, uint256& ovk)
 {
     shieldedInputs.clear();
+    selectedNotes.clear();
     auto sspkm = wallet->GetSaplingScriptPubKeyMan();
     // if we already have selected the notes, let's directly set them.
     bool hasCoinControl = coinControl && coinControl->HasSelected();
@@ -521,6 +544,8 @@ OperationResult SaplingOperation::loadUnspentNotes(TxValues& txValues, uint256&
                                   FormatMoney(txValues.shieldedInTotal), FormatMoney(txValues.target)));
     }
 
+    selectedNotes = ops;
+
     // Fetch Sapling anchor and witnesses
     uint256 anchor;
     std::vector<Optional<SaplingWitness>> witnesses;
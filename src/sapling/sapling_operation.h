@@ -89,6 +89,13 @@ public:
     OperationResult send(std::string& retTxHash);
     OperationResult buildAndSend(std::string& retTxHash);
 
+    // The two steps of build(): prepare() selects the inputs and sets the fee (with dummy proofs and signatures),
+    // then proveAndSign() creates the final tx. Only the first one needs cs_main and cs_wallet held by the caller.
+    OperationResult prepare();
+    OperationResult proveAndSign();
+    // Locks (or unlocks) the inputs selected by prepare(), keeping them away from the other operations
+    void setInputsLocked(bool fLocked);
+
     void setFromAddress(const CTxDestination&);
     void setFromAddress(const libzcash::SaplingPaymentAddress&);
     void clearTx() { txBuilder.Clear(); }
@@ -122,6 +129,7 @@ private:
     std::vector<SendManyRecipient> recipients;
     std::vector<COutput> transInputs;
     std::vector<SaplingNoteEntry> shieldedInputs;
+    std::vector<SaplingOutPoint> selectedNotes;
     int mindepth{5}; // Min default depth 5.
     CAmount fee{0};  // User selected fee.
 
@@ -0,0 +1,158 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+#include "sapling/sapling_operation_queue.h"
+
+#include "ctpl_stl.h"
+#include "random.h"
+#include "util/system.h"
+#include "utiltime.h"
+#include "validation.h"
+
+SaplingOperationQueue::SaplingOperationQueue(int nThreads) :
+    pool(new ctpl::thread_pool(std::max(1, nThreads)))
+{}
+
+SaplingOperationQueue::~SaplingOperationQueue()
+{
+    Stop();
+}
+
+std::string SaplingOperationQueue::Submit(CWallet* pwallet, std::shared_ptr<SaplingOperation> operation)
+{
+    OperationInfo info;
+    info.id = "opid-" + GetRandHash().GetHex().substr(0, 32);
+    info.nCreationTime = GetTime();
+    WITH_LOCK(cs, mapOperations.emplace(info.id, info));
+
+    const std::string id = info.id;
+    pool->push([this, id, pwallet, operation](int) {
+        Execute(id, pwallet, *operation);
+    });
+    return id;
+}
+
+void SaplingOperationQueue::Execute(const std::string& id, CWallet* pwallet, SaplingOperation& operation)
+{
+    {
+        LOCK(cs);
+        auto it = mapOperations.find(id);
+        if (it == mapOperations.end() || it->second.state != State::QUEUED) {
+            // Cancelled
+            return;
+        }
+        it->second.state = State::EXECUTING;
+    }
+
+    const int64_t nStartTime = GetTimeMillis();
+    std::string txid;
+    OperationResult res(false);
+    try {
+        {
+            LOCK2(cs_main, pwallet->cs_wallet);
+            res = operation.prepare();
+            if (res) operation.setInputsLocked(true);
+        }
+        if (res) {
+            res = operation.proveAndSign();
+            if (res) res = operation.send(txid);
+            operation.setInputsLocked(false);
+        }
+    } catch (const std::exception& e) {
+        res = errorOut(e.what());
+    }
+
+    LOCK(cs);
+    OperationInfo& info = mapOperations.at(id);
+    info.nExecutionMillis = GetTimeMillis() - nStartTime;
+    if (res) {
+        info.state = State::SUCCESS;
+        info.txid = txid;
+    } else {
+        info.state = State::FAILED;
+        info.error = res.getError();
+        LogPrintf("%s: shielded send %s failed: %s\n", __func__, id, info.error);
+    }
+}
+
+std::vector<SaplingOperationQueue::OperationInfo> SaplingOperationQueue::GetInfo(const std::vector<std::string>& ids) const
+{
+    LOCK(cs);
+    std::vector<OperationInfo> ret;
+    if (ids.empty()) {
+        for (const auto& it : mapOperations) ret.emplace_back(it.second);
+        return ret;
+    }
+    for (const std::string& id : ids) {
+        auto it = mapOperations.find(id);
+        if (it != mapOperations.end()) ret.emplace_back(it->second);
+    }
+    return ret;
+}
+
+std::vector<SaplingOperationQueue::OperationInfo> SaplingOperationQueue::PopFinished(const std::vector<std::string>& ids)
+{
+    std::vector<OperationInfo> ret;
+    for (const OperationInfo& info : GetInfo(ids)) {
+        if (info.IsFinished()) ret.emplace_back(info);
+    }
+    LOCK(cs);
+    for (const OperationInfo& info : ret) {
+        mapOperations.erase(info.id);
+    }
+    return ret;
+}
+
+bool SaplingOperationQueue::Cancel(const std::string& id)
+{
+    LOCK(cs);
+    auto it = mapOperations.find(id);
+    if (it == mapOperations.end() || it->second.state != State::QUEUED) {
+        return false;
+    }
+    it->second.state = State::CANCELLED;
+    return true;
+}
+
+void SaplingOperationQueue::Stop()
+{
+    if (pool) {
+        pool->stop(false);
+        pool.reset();
+    }
+    LOCK(cs);
+    for (auto& it : mapOperations) {
+        if (it.second.state == State::QUEUED) it.second.state = State::CANCELLED;
+    }
+}
+
+std::string SaplingOperationQueue::StateToString(State state)
+{
+    switch (state) {
+        case State::QUEUED: return "queued";
+        case State::EXECUTING: return "executing";
+        case State::SUCCESS: return "success";
+        case State::FAILED: return "failed";
+        case State::CANCELLED: return "cancelled";
+    }
+    assert(false);
+}
+
+static Mutex cs_operationQueue;
+static std::unique_ptr<SaplingOperationQueue> operationQueue GUARDED_BY(cs_operationQueue);
+
+SaplingOperationQueue& GetSaplingOperationQueue()
+{
+    LOCK(cs_operationQueue);
+    if (!operationQueue) {
+        operationQueue.reset(new SaplingOperationQueue(gArgs.GetArg("-shieldsendthreads", DEFAULT_SHIELD_SEND_THREADS)));
+    }
+    return *operationQueue;
+}
+
+void StopSaplingOperationQueue()
+{
+    LOCK(cs_operationQueue);
+    operationQueue.reset();
+}
@@ -0,0 +1,79 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_SAPLING_OPERATION_QUEUE_H
+#define PIVX_SAPLING_OPERATION_QUEUE_H
+
+#include "sapling/sapling_operation.h"
+#include "sync.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ctpl {
+    class thread_pool;
+}
+
+static const int DEFAULT_SHIELD_SEND_THREADS = 2;
+
+/**
+ * Builds and sends SaplingOperations on a dedicated thread pool (shieldsendmanyasync), so that the proofs of a
+ * shielded tx don't hold an RPC worker. Each operation is referred to by an id, to poll its state and result.
+ * Only the input selection runs under cs_main and cs_wallet: the selected inputs are then locked until the tx is
+ * committed, so that the concurrent operations of a wallet don't spend them twice.
+ */
+class SaplingOperationQueue
+{
+public:
+    enum class State {
+        QUEUED,
+        EXECUTING,
+        SUCCESS,
+        FAILED,
+        CANCELLED
+    };
+
+    struct OperationInfo {
+        std::string id;
+        State state{State::QUEUED};
+        int64_t nCreationTime{0};
+        int64_t nExecutionMillis{0};
+        // Set on success or failure
+        std::string txid;
+        std::string error;
+
+        bool IsFinished() const { return state != State::QUEUED && state != State::EXECUTING; }
+    };
+
+    explicit SaplingOperationQueue(int nThreads);
+    ~SaplingOperationQueue();
+
+    /** Queues an operation, set up but not built yet, of pwallet. Returns its id. */
+    std::string Submit(CWallet* pwallet, std::shared_ptr<SaplingOperation> operation);
+    /** Returns the info of the operations with the given ids (of all the operations if empty). */
+    std::vector<OperationInfo> GetInfo(const std::vector<std::string>& ids) const;
+    /** Like GetInfo for the finished operations, which are then forgotten. */
+    std::vector<OperationInfo> PopFinished(const std::vector<std::string>& ids);
+    /** Cancels a queued operation. Returns false if it's unknown or already started. */
+    bool Cancel(const std::string& id);
+    /** Drops the queued operations, and waits for the running ones. */
+    void Stop();
+
+    static std::string StateToString(State state);
+
+private:
+    mutable Mutex cs;
+    std::map<std::string, OperationInfo> mapOperations GUARDED_BY(cs);
+    std::unique_ptr<ctpl::thread_pool> pool;
+
+    void Execute(const std::string& id, CWallet* pwallet, SaplingOperation& operation);
+};
+
+/** The queue of the async shielded sends, created on first use with -shieldsendthreads workers. */
+SaplingOperationQueue& GetSaplingOperationQueue();
+void StopSaplingOperationQueue();
+
+#endif // PIVX_SAPLING_OPERATION_QUEUE_H
@@ -0,0 +1,86 @@
+// Copyright (c) 2023 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+#include "sapling/sapling_proofcache.h"
+
+#include "crypto/sha256.h"
+#include "cuckoocache.h"
+#include "random.h"
+#include "script/sigcache.h" // for SignatureCacheHasher
+#include "util/system.h"
+
+#include <boost/thread/shared_mutex.hpp>
+
+namespace SaplingValidation {
+
+namespace {
+
+class CShieldedProofCache
+{
+private:
+    //! Entries are SHA256(nonce || txid || sighash):
+    uint256 nonce;
+    typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
+    map_type setValid;
+    boost::shared_mutex cs_proofcache;
+
+public:
+    CShieldedProofCache()
+    {
+        GetRandBytes(nonce.begin(), 32);
+    }
+
+    void ComputeEntry(uint256& entry, const uint256& txid, const uint256& sighash)
+    {
+        CSHA256().Write(nonce.begin(), 32).Write(txid.begin(), 32).Write(sighash.begin(), 32).Finalize(entry.begin());
+    }
+
+    bool Get(const uint256& entry)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_proofcache);
+        return setValid.contains(entry, false);
+    }
+
+    void Set(uint256& entry)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_proofcache);
+        setValid.insert(entry);
+    }
+
+    uint32_t setup_bytes(size_t n)
+    {
+        return setValid.setup_bytes(n);
+    }
+};
+
+static CShieldedProofCache proofCache;
+
+} // anon namespace
+
+// To be called once in AppInitMain/BasicTestingSetup to initialize the proofCache.
+void InitShieldedProofCache()
+{
+    // nMaxCacheSize is unsigned. If -shieldedproofcachesize is set to zero,
+    // setup_bytes creates the minimum possible cache (2 elements).
+    size_t nMaxCacheSize = std::min(std::max((int64_t)0, gArgs.GetArg("-shieldedproofcachesize", DEFAULT_SHIELDED_PROOF_CACHE_SIZE)), MAX_SHIELDED_PROOF_CACHE_SIZE) * ((size_t) 1 << 20);
+    size_t nElems = proofCache.setup_bytes(nMaxCacheSize);
+    LogPrintf("Using %zu MiB out of %zu requested for shielded proofs cache, able to store %zu elements\n",
+            (nElems*sizeof(uint256)) >>20, nMaxCacheSize>>20, nElems);
+}
+
+bool ShieldedProofCacheGet(const uint256& txid, const uint256& sighash)
+{
+    uint256 entry;
+    proofCache.ComputeEntry(entry, txid, sighash);
+    return proofCache.Get(entry);
+}
+
+void ShieldedProofCacheSet(const uint256& txid, const uint256& sighash)
+{
+    uint256 entry;
+    proofCache.ComputeEntry(entry, txid, sighash);
+    proofCache.Set(entry);
+}
+
+} // End SaplingValidation namespace
@@ -0,0 +1,34 @@
+// Copyright (c) 2023 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_SAPLING_SAPLING_PROOFCACHE_H
+#define PIVX_SAPLING_SAPLING_PROOFCACHE_H
+
+#include "uint256.h"
+
+#include <stdint.h>
+
+// Limit the shielded proofs cache to 4MB (over 130000 entries on 64-bit systems)
+static const unsigned int DEFAULT_SHIELDED_PROOF_CACHE_SIZE = 4;
+// Maximum shielded proofs cache size allowed
+static const int64_t MAX_SHIELDED_PROOF_CACHE_SIZE = 1024;
+
+namespace SaplingValidation {
+
+/**
+ * Valid shielded bundles cache, to avoid verifying the (expensive) Sapling
+ * proofs and binding signature of a transaction twice: once when accepted
+ * into the memory pool, and again when accepted into the block chain.
+ * Entries are keyed on (txid, sighash).
+ */
+void InitShieldedProofCache();
+
+// Returns true if the shielded data of the tx was already fully verified
+bool ShieldedProofCacheGet(const uint256& txid, const uint256& sighash);
+// Record that the shielded data of the tx passed the full verification
+void ShieldedProofCacheSet(const uint256& txid, const uint256& sighash);
+
+} // End SaplingValidation namespace
+
+#endif // PIVX_SAPLING_SAPLING_PROOFCACHE_H
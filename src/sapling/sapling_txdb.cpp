@@ -4,6 +4,9 @@
 
 #include "txdb.h"
 
+#include <algorithm>
+#include <numeric>
+
 // Db keys
 static const char DB_SAPLING_ANCHOR = 'Z';
 static const char DB_SAPLING_NULLIFIER = 'S';
@@ -17,9 +20,15 @@ bool CCoinsViewDB::GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree
         return true;
     }
 
-    bool read = db.Read(std::make_pair(DB_SAPLING_ANCHOR, rt), tree);
-
-    return read;
+    LOCK(cs_saplingAnchors);
+    if (saplingAnchorsCache.get(rt, tree)) {
+        return true;
+    }
+    if (!db.Read(std::make_pair(DB_SAPLING_ANCHOR, rt), tree)) {
+        return false;
+    }
+    saplingAnchorsCache.insert(rt, tree);
+    return true;
 }
 
 bool CCoinsViewDB::GetNullifier(const uint256 &nf) const {
@@ -27,6 +36,26 @@ bool CCoinsViewDB::GetNullifier(const uint256 &nf) const {
     return db.Read(std::make_pair(DB_SAPLING_NULLIFIER, nf), spent);
 }
 
+void CCoinsViewDB::GetNullifiers(const std::vector<uint256>& nullifiers, std::vector<bool>& vSpent) const
+{
+    if (nullifiers.size() <= 1) {
+        return CCoinsView::GetNullifiers(nullifiers, vSpent);
+    }
+    vSpent.assign(nullifiers.size(), false);
+    // Seek the keys in their order in the database with a single iterator,
+    // so that the blocks read for a nullifier are reused for the next ones.
+    std::vector<size_t> vOrder(nullifiers.size());
+    std::iota(vOrder.begin(), vOrder.end(), 0);
+    std::sort(vOrder.begin(), vOrder.end(), [&nullifiers](size_t a, size_t b) { return nullifiers[a] < nullifiers[b]; });
+    std::unique_ptr<CDBIterator> pcursor(const_cast<CDBWrapper&>(db).NewIterator());
+    for (size_t i : vOrder) {
+        const auto key = std::make_pair(DB_SAPLING_NULLIFIER, nullifiers[i]);
+        pcursor->Seek(key);
+        std::pair<char, uint256> foundKey;
+        vSpent[i] = pcursor->Valid() && pcursor->GetKey(foundKey) && foundKey == key;
+    }
+}
+
 uint256 CCoinsViewDB::GetBestAnchor() const {
     uint256 hashBestAnchor;
     if (!db.Read(DB_BEST_SAPLING_ANCHOR, hashBestAnchor))
@@ -81,9 +110,48 @@ bool CCoinsViewDB::BatchWriteSapling(const uint256& hashSaplingAnchor,
                               CNullifiersMap& mapSaplingNullifiers,
                               CDBBatch& batch) {
 
+    {
+        // The tree of an anchor is the only one with its root, so the cache can take the
+        // new trees before the batch is written.
+        LOCK(cs_saplingAnchors);
+        for (const auto& it : mapSaplingAnchors) {
+            if (!(it.second.flags & CAnchorsSaplingCacheEntry::DIRTY)) continue;
+            if (it.second.entered) {
+                saplingAnchorsCache.insert(it.first, it.second.tree);
+            } else {
+                saplingAnchorsCache.erase(it.first);
+            }
+        }
+    }
     ::BatchWriteAnchors<CAnchorsSaplingMap, CAnchorsSaplingMap::iterator, CAnchorsSaplingCacheEntry, SaplingMerkleTree>(batch, mapSaplingAnchors, DB_SAPLING_ANCHOR);
     ::BatchWriteNullifiers(batch, mapSaplingNullifiers, DB_SAPLING_NULLIFIER);
     if (!hashSaplingAnchor.IsNull())
         batch.Write(DB_BEST_SAPLING_ANCHOR, hashSaplingAnchor);
     return true;
 }
+
+bool CCoinsViewDB::ForEachSaplingAnchor(const std::function<bool(const uint256&, const SaplingMerkleTree&)>& func) const
+{
+    std::unique_ptr<CDBIterator> pcursor(const_cast<CDBWrapper&>(db).NewIterator());
+    for (pcursor->Seek(std::make_pair(DB_SAPLING_ANCHOR, UINT256_ZERO)); pcursor->Valid(); pcursor->Next()) {
+        std::pair<char, uint256> key;
+        if (!pcursor->GetKey(key) || key.first != DB_SAPLING_ANCHOR) break;
+        SaplingMerkleTree tree;
+        if (!pcursor->GetValue(tree)) {
+            return error("%s: unable to read value", __func__);
+        }
+        if (!func(key.second, tree)) break;
+    }
+    return true;
+}
+
+bool CCoinsViewDB::ForEachSaplingNullifier(const std::function<bool(const uint256&)>& func) const
+{
+    std::unique_ptr<CDBIterator> pcursor(const_cast<CDBWrapper&>(db).NewIterator());
+    for (pcursor->Seek(std::make_pair(DB_SAPLING_NULLIFIER, UINT256_ZERO)); pcursor->Valid(); pcursor->Next()) {
+        std::pair<char, uint256> key;
+        if (!pcursor->GetKey(key) || key.first != DB_SAPLING_NULLIFIER) break;
+        if (!func(key.second)) break;
+    }
+    return true;
+}
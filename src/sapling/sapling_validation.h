@@ -7,23 +7,62 @@
 #define PIVX_SAPLING_VALIDATION_H
 
 #include "chainparams.h"
+#include "uint256.h"
+
+#include <vector>
 
 class CTransaction;
 class CValidationState;
 
 namespace SaplingValidation {
 
+/**
+ * Closure representing the verification of the Sapling spend/output proofs
+ * and binding signature of one transaction.
+ * Note that this stores a reference to the transaction.
+ */
+class CSaplingProofCheck
+{
+private:
+    const CTransaction* ptx;
+    uint256 dataToBeSigned;
+
+public:
+    CSaplingProofCheck() : ptx(nullptr) {}
+    CSaplingProofCheck(const CTransaction& txIn, const uint256& dataToBeSignedIn) :
+        ptx(&txIn),
+        dataToBeSigned(dataToBeSignedIn) {}
+
+    bool operator()();
+
+    const CTransaction* GetTx() const { return ptx; }
+    const uint256& GetDataToBeSigned() const { return dataToBeSigned; }
+
+    void swap(CSaplingProofCheck& check)
+    {
+        std::swap(ptx, check.ptx);
+        std::swap(dataToBeSigned, check.dataToBeSigned);
+    }
+};
+
 /** Context-independent validity checks */
 // Note: for v3+, if the tx has no shielded data, this method returns true.
 // Note2: This function only performs shielded data related checks, it does NOT checks regular inputs and outputs.
 bool CheckTransaction(const CTransaction& tx, CValidationState& state, CAmount& nValueOut);
 bool CheckTransactionWithoutProofVerification(const CTransaction& tx, CValidationState &state, CAmount& nValueOut);
 
+/** Verify the spend/output proofs and the binding signature of a shielded transaction */
+bool CheckSaplingProofs(const CTransaction& tx, const uint256& dataToBeSigned, CValidationState& state,
+                        int dosLevelPotentiallyRelaxing);
+
 /** Check a transaction contextually against a set of consensus rules */
 // Note: if v5 upgrade wasn't enforced, this method returns true without performing any check.
+// Note2: if pvChecks is not null, the proofs verification is not performed here but deferred
+//        to a CSaplingProofCheck appended to pvChecks.
 bool ContextualCheckTransaction(const CTransaction &tx, CValidationState &state,
                                 const CChainParams &chainparams, int nHeight, bool isMined,
-                                bool sInitBlockDownload);
+                                bool sInitBlockDownload,
+                                std::vector<CSaplingProofCheck>* pvChecks = nullptr);
 
 }; // End SaplingValidation namespace
 
@@ -6,6 +6,7 @@
 #include "sapling/saplingscriptpubkeyman.h"
 
 #include "chain.h" // for CBlockIndex
+#include "ctpl_stl.h"
 #include "primitives/transaction.h"
 #include "consensus/params.h"
 #include "primitives/block.h"
@@ -18,6 +19,10 @@
 #include <string>
 #include <vector>
 
+SaplingScriptPubKeyMan::SaplingScriptPubKeyMan(CWallet* parent) : wallet(parent) {}
+
+SaplingScriptPubKeyMan::~SaplingScriptPubKeyMan() {}
+
 void SaplingScriptPubKeyMan::AddToSaplingSpends(const uint256& nullifier, const uint256& wtxid)
 {
     AssertLockHeld(wallet->cs_wallet);
@@ -30,13 +35,13 @@ void SaplingScriptPubKeyMan::AddToSaplingSpends(const uint256& nullifier, const
 
 bool SaplingScriptPubKeyMan::IsSaplingSpent(const SaplingOutPoint& op) const
 {
-    for (auto& i : mapSaplingNullifiersToNotes) {
-        SaplingOutPoint iOp = i.second;
-        if (iOp == op) {
-            return IsSaplingSpent(i.first);
-        }
-    }
-    return false;
+    LOCK(wallet->cs_wallet);
+    // The nullifier of the note is cached in its note data (if the note is ours and has a witness)
+    const CWalletTx* wtx = wallet->GetWalletTx(op.hash);
+    if (!wtx) return false;
+    auto it = wtx->mapSaplingNoteData.find(op);
+    if (it == wtx->mapSaplingNoteData.end() || !it->second.nullifier) return false;
+    return IsSaplingSpent(*it->second.nullifier);
 }
 
 bool SaplingScriptPubKeyMan::IsSaplingSpent(const uint256& nullifier) const {
@@ -54,6 +59,120 @@ bool SaplingScriptPubKeyMan::IsSaplingSpent(const uint256& nullifier) const {
     return false;
 }
 
+bool SaplingScriptPubKeyMan::IsSaplingSpentInChain(const uint256& nullifier) const
+{
+    AssertLockHeld(wallet->cs_wallet);
+    auto range = mapTxSaplingNullifiers.equal_range(nullifier);
+    for (auto it = range.first; it != range.second; ++it) {
+        const CWalletTx* wtx = wallet->GetWalletTx(it->second);
+        if (wtx && wtx->GetDepthInMainChain() > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void SaplingScriptPubKeyMan::AddToUnspentNotesIndex(const CWalletTx& wtx) const
+{
+    AssertLockHeld(wallet->cs_wallet);
+    // Built from the whole wallet at the next lookup
+    if (!fUnspentNotesIndexValid) return;
+
+    for (const auto& it : wtx.mapSaplingNoteData) {
+        const SaplingOutPoint& op = it.first;
+        if (!it.second.IsMyNote()) continue;
+        auto ait = mapNoteAddresses.find(op);
+        if (ait != mapNoteAddresses.end()) {
+            mapUnspentNotesByAddress[ait->second].insert(op);
+        } else {
+            setUnindexedNotes.insert(op);
+        }
+    }
+}
+
+void SaplingScriptPubKeyMan::IndexNotesOfTx(const CWalletTx& wtx)
+{
+    AssertLockHeld(wallet->cs_wallet);
+    for (const auto& it : wtx.mapSaplingNoteData) {
+        if (it.second.IsMyNote()) {
+            setTxsWithMyNotes.emplace(wtx.GetHash());
+            break;
+        }
+    }
+    AddToUnspentNotesIndex(wtx);
+}
+
+template <typename Func>
+void SaplingScriptPubKeyMan::ForEachTxWithMyNotes(Func func)
+{
+    AssertLockHeld(wallet->cs_wallet);
+    for (auto it = setTxsWithMyNotes.begin(); it != setTxsWithMyNotes.end();) {
+        auto wit = wallet->mapWallet.find(*it);
+        if (wit == wallet->mapWallet.end()) {
+            it = setTxsWithMyNotes.erase(it);
+            continue;
+        }
+        func(wit->second);
+        ++it;
+    }
+}
+
+std::set<SaplingOutPoint> SaplingScriptPubKeyMan::GetUnspentNotesCandidates(const std::set<libzcash::PaymentAddress>& filterAddresses) const
+{
+    AssertLockHeld(wallet->cs_wallet);
+    if (!fUnspentNotesIndexValid) {
+        mapUnspentNotesByAddress.clear();
+        setUnindexedNotes.clear();
+        fUnspentNotesIndexValid = true;
+        for (const auto& it : wallet->mapWallet) {
+            AddToUnspentNotesIndex(it.second);
+        }
+    }
+
+    // Recover the address of the new notes
+    for (const SaplingOutPoint& op : setUnindexedNotes) {
+        const CWalletTx* wtx = wallet->GetWalletTx(op.hash);
+        if (!wtx) continue;
+        auto optNotePtAndAddress = wtx->DecryptSaplingNote(op);
+        assert(static_cast<bool>(optNotePtAndAddress));
+        const libzcash::SaplingPaymentAddress& pa = optNotePtAndAddress->second;
+        mapNoteAddresses.emplace(op, pa);
+        mapUnspentNotesByAddress[pa].insert(op);
+    }
+    setUnindexedNotes.clear();
+
+    std::set<SaplingOutPoint> candidates;
+    auto collect = [&](std::set<SaplingOutPoint>& notes) {
+        for (auto it = notes.begin(); it != notes.end();) {
+            const CWalletTx* wtx = wallet->GetWalletTx(it->hash);
+            auto ndIt = wtx ? wtx->mapSaplingNoteData.find(*it) : mapSaplingNoteData_t::const_iterator();
+            if (!wtx || ndIt == wtx->mapSaplingNoteData.end() ||
+                 (ndIt->second.nullifier && IsSaplingSpentInChain(*ndIt->second.nullifier))) {
+                // Erased from the wallet, or spent for good (until a block disconnection)
+                it = notes.erase(it);
+                continue;
+            }
+            candidates.insert(*it);
+            ++it;
+        }
+    };
+    if (filterAddresses.empty()) {
+        for (auto& it : mapUnspentNotesByAddress) {
+            collect(it.second);
+        }
+    } else {
+        for (const libzcash::PaymentAddress& address : filterAddresses) {
+            const auto* pa = boost::get<libzcash::SaplingPaymentAddress>(&address);
+            if (!pa) continue;
+            auto it = mapUnspentNotesByAddress.find(*pa);
+            if (it != mapUnspentNotesByAddress.end()) {
+                collect(it->second);
+            }
+        }
+    }
+    return candidates;
+}
+
 void SaplingScriptPubKeyMan::UpdateSaplingNullifierNoteMapForBlock(const CBlock *pblock) {
     LOCK(wallet->cs_wallet);
 
@@ -126,6 +245,7 @@ void SaplingScriptPubKeyMan::UpdateNullifierNoteMapWithTx(const CWalletTx& wtx)
                 mapSaplingNullifiersToNotes[*item.second.nullifier] = item.first;
             }
         }
+        IndexNotesOfTx(wtx);
     }
 }
 
@@ -158,7 +278,7 @@ void CopyPreviousWitnesses(NoteDataMap& noteDataMap, int indexHeight, int64_t nW
     }
 }
 
-void AppendNoteCommitment(SaplingNoteData* nd, int indexHeight, int64_t nWitnessCacheSize, const uint256& note_commitment)
+void AppendNoteCommitments(SaplingNoteData* nd, int indexHeight, int64_t nWitnessCacheSize, const SaplingMerkleFrontier& frontier)
 {
     // skip externally sent notes
     if (!nd->IsMyNote()) return;
@@ -167,7 +287,7 @@ void AppendNoteCommitment(SaplingNoteData* nd, int indexHeight, int64_t nWitness
         // Check the validity of the cache
         // See comment in CopyPreviousWitnesses about validity.
         assert(nWitnessCacheSize >= (int64_t) nd->witnesses.size());
-        nd->witnesses.front().append(note_commitment);
+        nd->witnesses.front().append(frontier);
     }
 }
 
@@ -263,7 +383,7 @@ bool SaplingScriptPubKeyMan::BuildWitnessChain(const CBlockIndex* pTargetBlock,
     int height = minHeight;
     for (CBlock& block : cblocks) {
         // Finally build the witness cache for each sapling note
-        std::vector<uint256> noteCommitments;
+        SaplingMerkleFrontier frontier(initialSaplingTree);
         std::vector<SaplingNoteData*> inBlockArrivingNotes;
         for (const auto& tx : block.vtx) {
             const auto& hash = tx->GetHash();
@@ -272,30 +392,31 @@ bool SaplingScriptPubKeyMan::BuildWitnessChain(const CBlockIndex* pTargetBlock,
 
             if (!tx->IsShieldedTx()) continue;
             for (uint32_t i = 0; i < tx->sapData->vShieldedOutput.size(); i++) {
-                const auto& cmu = tx->sapData->vShieldedOutput[i].cmu;
-                noteCommitments.emplace_back(cmu);
-                for (auto& item : inBlockArrivingNotes) {
-                    item->witnesses.front().append(cmu);
-                }
-                initialSaplingTree.append(cmu);
+                frontier.append(tx->sapData->vShieldedOutput[i].cmu);
                 if (txIsOurs) {
                     CWalletTx* wtx = &it->second;
                     auto ndIt = wtx->mapSaplingNoteData.find({hash, i});
                     if (ndIt != wtx->mapSaplingNoteData.end()) {
                         SaplingNoteData* nd = &ndIt->second;
-                        nd->witnesses.push_front(initialSaplingTree.witness());
+                        nd->witnesses.push_front(frontier.tree().witness());
                         inBlockArrivingNotes.emplace_back(nd);
                     }
                 }
             }
         }
+        // Append the following block note commitments to the in-block notes
+        for (auto& item : inBlockArrivingNotes) {
+            item->witnesses.front().append(frontier);
+        }
+        const bool fNewCommitments = frontier.size() != initialSaplingTree.size();
+        initialSaplingTree = frontier.tree();
         for (auto& it2 : cachedWitnessMap) {
             // Don't duplicate if the block is too old
             if (height >= rollbackTargetHeight) {
                 it2.second.emplace_front(it2.second.front());
             }
-            for (auto& noteComm : noteCommitments) {
-                it2.second.front().append(noteComm);
+            if (fNewCommitments) {
+                it2.second.front().append(frontier);
             }
         }
         for (auto nd : inBlockArrivingNotes) {
@@ -324,9 +445,10 @@ void SaplingScriptPubKeyMan::IncrementNoteWitnesses(const CBlockIndex* pindex,
         nWitnessCacheNeedsUpdate = true;
     }
 
-    // 1) Loop over the block txs and gather the note commitments ordered.
-    // If the wtx is from this wallet, witness it and append the following block note commitments on top.
-    std::vector<uint256> noteCommitments;
+    // 1) Loop over the block txs and append the note commitments, in order, to the shared frontier.
+    // If the wtx is from this wallet, witness it (the following block note commitments are appended
+    // on top once the whole block has been processed).
+    SaplingMerkleFrontier frontier(saplingTreeRes);
     std::vector<std::pair<CWalletTx*, SaplingNoteData*>> inBlockArrivingNotes;
     for (const auto& tx : pblock->vtx) {
         if (!tx->IsShieldedTx()) continue;
@@ -336,58 +458,51 @@ void SaplingScriptPubKeyMan::IncrementNoteWitnesses(const CBlockIndex* pindex,
         bool txIsOurs = it != wallet->mapWallet.end();
 
         for (uint32_t i = 0; i < tx->sapData->vShieldedOutput.size(); i++) {
-            const auto& cmu = tx->sapData->vShieldedOutput[i].cmu;
-            noteCommitments.emplace_back(cmu);
-
-            // Append note commitment to the in-block wallet's notes.
-            // This is processed here because we already looked for the wtx on
-            // the WitnessNoteIfMine call and only need to append the follow-up block notes,
-            // not every block note (check below).
-            for (auto& item : inBlockArrivingNotes) {
-                ::AppendNoteCommitment(item.second, chainHeight, nWitnessCacheSize, cmu);
-            }
+            frontier.append(tx->sapData->vShieldedOutput[i].cmu);
 
             // If tx is from this wallet, try to witness the note for the first time (if exists).
             // And add it to the in-block arriving txs.
-            saplingTreeRes.append(cmu);
             if (txIsOurs) {
                 CWalletTx* wtx = &it->second;
                 auto ndIt = wtx->mapSaplingNoteData.find({hash, i});
                 if (ndIt != wtx->mapSaplingNoteData.end()) {
                     SaplingNoteData* nd = &ndIt->second;
-                    ::WitnessNoteIfMine(nd, chainHeight, nWitnessCacheSize, saplingTreeRes.witness());
+                    ::WitnessNoteIfMine(nd, chainHeight, nWitnessCacheSize, frontier.tree().witness());
                     inBlockArrivingNotes.emplace_back(std::make_pair(wtx, nd));
                 }
             }
         }
     }
+    const bool fNewCommitments = frontier.size() != saplingTreeRes.size();
+    saplingTreeRes = frontier.tree();
 
-    // 2) Mark already sync wtx, so we don't process them again.
+    // 2) Append the follow-up block note commitments to the in-block wallet's notes,
+    // and mark already sync wtx, so we don't process them again.
+    for (auto& item : inBlockArrivingNotes) {
+        ::AppendNoteCommitments(item.second, chainHeight, nWitnessCacheSize, frontier);
+    }
     for (auto& item : inBlockArrivingNotes) {
         ::UpdateWitnessHeights(item.first->mapSaplingNoteData, chainHeight, nWitnessCacheSize);
     }
 
     // 3) Loop over the shield txs in the wallet's map (excluding the wtx arriving in this block) and for each tx:
     //    a) Copy the previous witness.
-    //    b) Append all new notes commitments
+    //    b) Append all new notes commitments (taking the subtree roots from the frontier)
     //    c) Update witness last processed height
-    for (auto& it : wallet->mapWallet) {
-        CWalletTx& wtx = it.second;
-        if (!wtx.mapSaplingNoteData.empty()) {
-            // Create copy of the previous witness (verifying pre-arriving block witness cache size)
-            ::CopyPreviousWitnesses(wtx.mapSaplingNoteData, chainHeight, prevWitCacheSize);
-
-            // Append new notes commitments.
-            for (auto& noteComm : noteCommitments) {
-                for (auto& item : wtx.mapSaplingNoteData) {
-                    AppendNoteCommitment(&(item.second), chainHeight, nWitnessCacheSize, noteComm);
-                }
+    ForEachTxWithMyNotes([&](CWalletTx& wtx) {
+        // Create copy of the previous witness (verifying pre-arriving block witness cache size)
+        ::CopyPreviousWitnesses(wtx.mapSaplingNoteData, chainHeight, prevWitCacheSize);
+
+        // Append new notes commitments.
+        if (fNewCommitments) {
+            for (auto& item : wtx.mapSaplingNoteData) {
+                ::AppendNoteCommitments(&(item.second), chainHeight, nWitnessCacheSize, frontier);
             }
-
-            // Set last processed height.
-            ::UpdateWitnessHeights(wtx.mapSaplingNoteData, chainHeight, nWitnessCacheSize);
         }
-    }
+
+        // Set last processed height.
+        ::UpdateWitnessHeights(wtx.mapSaplingNoteData, chainHeight, nWitnessCacheSize);
+    });
 
     // For performance reasons, we write out the witness cache in
     // CWallet::SetBestChain() (which also ensures that overall consistency
@@ -471,12 +586,10 @@ void SaplingScriptPubKeyMan::DecrementNoteWitnesses(const CBlockIndex* pindex)
     int nChainHeight = pindex->nHeight;
     // if the targetHeight is different from -1 we have a cache to use
     if (rollbackTargetHeight != -1) {
-        for (std::pair<const uint256, CWalletTx>& wtxItem : wallet->mapWallet) {
-            if (!wtxItem.second.mapSaplingNoteData.empty()) {
-                // For each sapling note that you own reset the current witness with the cached one
-                ResetNoteWitnesses(wtxItem.second.mapSaplingNoteData, cachedWitnessMap, nChainHeight);
-            }
-        }
+        ForEachTxWithMyNotes([&](CWalletTx& wtx) {
+            // For each sapling note that you own reset the current witness with the cached one
+            ResetNoteWitnesses(wtx.mapSaplingNoteData, cachedWitnessMap, nChainHeight);
+        });
         nWitnessCacheSize = 1;
         nWitnessCacheNeedsUpdate = true;
         // If we reached the target height empty the cache and reset the target height to -1
@@ -488,9 +601,9 @@ void SaplingScriptPubKeyMan::DecrementNoteWitnesses(const CBlockIndex* pindex)
         return;
     }
 
-    for (std::pair<const uint256, CWalletTx>& wtxItem : wallet->mapWallet) {
-        ::DecrementNoteWitnesses(wtxItem.second.mapSaplingNoteData, nChainHeight, nWitnessCacheSize);
-    }
+    ForEachTxWithMyNotes([&](CWalletTx& wtx) {
+        ::DecrementNoteWitnesses(wtx.mapSaplingNoteData, nChainHeight, nWitnessCacheSize);
+    });
     nWitnessCacheSize -= 1;
     nWitnessCacheNeedsUpdate = true;
     // TODO: If nWitnessCache is zero, we need to regenerate the caches (#1302)
@@ -525,35 +638,32 @@ std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap> SaplingScriptPubKe
     SaplingIncomingViewingKeyMap viewingKeysToAdd;
 
     // Protocol Spec: 4.19 Block Chain Scanning (Sapling)
-    for (uint32_t i = 0; i < tx.sapData->vShieldedOutput.size(); ++i) {
-        const OutputDescription output = tx.sapData->vShieldedOutput[i];
-        for (auto it = wallet->mapSaplingFullViewingKeys.begin(); it != wallet->mapSaplingFullViewingKeys.end(); ++it) {
-            libzcash::SaplingIncomingViewingKey ivk = it->first;
-            auto result = libzcash::SaplingNotePlaintext::decrypt(output.encCiphertext, ivk, output.ephemeralKey, output.cmu);
-            if (!result) {
-                continue;
-            }
+    const std::vector<Optional<DecryptedOutput>> decrypted = TrialDecryptOutputs(tx.sapData->vShieldedOutput);
+    for (uint32_t i = 0; i < decrypted.size(); ++i) {
+        if (!decrypted[i]) {
+            continue;
+        }
+        const libzcash::SaplingIncomingViewingKey& ivk = decrypted[i]->first;
+        const libzcash::SaplingNotePlaintext& result = decrypted[i]->second;
 
-            // Check if we already have it.
-            Optional<libzcash::SaplingPaymentAddress> address = ivk.address(result.get().d);
-            if (address && wallet->mapSaplingIncomingViewingKeys.count(address.get()) == 0) {
-                viewingKeysToAdd[address.get()] = ivk;
-            }
-            // We don't cache the nullifier here as computing it requires knowledge of the note position
-            // in the commitment tree, which can only be determined when the transaction has been mined.
-            SaplingOutPoint op {hash, i};
-            SaplingNoteData nd;
-            nd.ivk = ivk;
-            nd.amount = result->value();
-            nd.address = address;
-            const auto& memo = result->memo();
-            // don't save empty memo (starting with 0xF6)
-            if (memo[0] < 0xF6) {
-                nd.memo = memo;
-            }
-            noteData.insert(std::make_pair(op, nd));
-            break;
+        // Check if we already have it.
+        Optional<libzcash::SaplingPaymentAddress> address = ivk.address(result.d);
+        if (address && wallet->mapSaplingIncomingViewingKeys.count(address.get()) == 0) {
+            viewingKeysToAdd[address.get()] = ivk;
+        }
+        // We don't cache the nullifier here as computing it requires knowledge of the note position
+        // in the commitment tree, which can only be determined when the transaction has been mined.
+        SaplingOutPoint op {hash, i};
+        SaplingNoteData nd;
+        nd.ivk = ivk;
+        nd.amount = result.value();
+        nd.address = address;
+        const auto& memo = result.memo();
+        // don't save empty memo (starting with 0xF6)
+        if (memo[0] < 0xF6) {
+            nd.memo = memo;
         }
+        noteData.insert(std::make_pair(op, nd));
     }
 
     return std::make_pair(noteData, viewingKeysToAdd);
@@ -566,16 +676,83 @@ std::vector<libzcash::SaplingPaymentAddress> SaplingScriptPubKeyMan::FindMySapli
     if (!tx.sapData) return ret;
 
     // Protocol Spec: 4.19 Block Chain Scanning (Sapling)
-    for (const OutputDescription& output : tx.sapData->vShieldedOutput) {
-        for (auto it = wallet->mapSaplingFullViewingKeys.begin(); it != wallet->mapSaplingFullViewingKeys.end(); ++it) {
-            libzcash::SaplingIncomingViewingKey ivk = it->first;
-            auto result = libzcash::SaplingNotePlaintext::decrypt(output.encCiphertext, ivk, output.ephemeralKey, output.cmu);
-            if (!result) {
+    for (const Optional<DecryptedOutput>& decrypted : TrialDecryptOutputs(tx.sapData->vShieldedOutput)) {
+        if (!decrypted) {
+            continue;
+        }
+        Optional<libzcash::SaplingPaymentAddress> address = decrypted->first.address(decrypted->second.d);
+        if (address && wallet->mapSaplingIncomingViewingKeys.count(address.get()) != 0) {
+            ret.emplace_back(address.get());
+        }
+    }
+    return ret;
+}
+
+std::vector<Optional<SaplingScriptPubKeyMan::DecryptedOutput>> SaplingScriptPubKeyMan::TrialDecryptOutputs(const std::vector<OutputDescription>& outputs) const
+{
+    AssertLockHeld(wallet->cs_KeyStore);
+    std::vector<Optional<DecryptedOutput>> ret(outputs.size());
+    if (outputs.empty() || wallet->mapSaplingFullViewingKeys.empty()) {
+        return ret;
+    }
+
+    // Snapshot the ivks once per tx, instead of walking the map for every output.
+    std::vector<libzcash::SaplingIncomingViewingKey> ivks;
+    ivks.reserve(wallet->mapSaplingFullViewingKeys.size());
+    for (const auto& it : wallet->mapSaplingFullViewingKeys) {
+        ivks.emplace_back(it.first);
+    }
+
+    // Trial-decrypts the (output, ivk) pairs with flat index in [begin, end), row-major
+    // (output-first), stopping at the first ivk that decrypts each output.
+    typedef std::pair<size_t, DecryptedOutput> IndexedOutput;
+    auto decryptRange = [&outputs, &ivks](size_t begin, size_t end) {
+        std::vector<IndexedOutput> found;
+        for (size_t n = begin; n < end; ++n) {
+            const size_t i = n / ivks.size();
+            if (!found.empty() && found.back().first == i) {
+                // already decrypted by a previous ivk: skip to the next output
+                n = (i + 1) * ivks.size() - 1;
                 continue;
             }
-            Optional<libzcash::SaplingPaymentAddress> address = ivk.address(result.get().d);
-            if (address && wallet->mapSaplingIncomingViewingKeys.count(address.get()) != 0) {
-                ret.emplace_back(address.get());
+            const OutputDescription& output = outputs[i];
+            const libzcash::SaplingIncomingViewingKey& ivk = ivks[n % ivks.size()];
+            auto result = libzcash::SaplingNotePlaintext::decrypt(output.encCiphertext, ivk, output.ephemeralKey, output.cmu);
+            if (result) {
+                found.emplace_back(i, DecryptedOutput(ivk, *result));
+            }
+        }
+        return found;
+    };
+
+    const size_t nTotal = outputs.size() * ivks.size();
+    const int nThreads = std::min(GetNumCores(), MAX_TRIAL_DECRYPTION_THREADS);
+    std::vector<std::vector<IndexedOutput>> results;
+    if (nThreads <= 1 || nTotal < MIN_PARALLEL_TRIAL_DECRYPTIONS) {
+        results.emplace_back(decryptRange(0, nTotal));
+    } else {
+        if (!decryptionPool) {
+            decryptionPool.reset(new ctpl::thread_pool(nThreads));
+        }
+        // Contiguous ranges, so that results of lower ranges refer to lower (output, ivk) pairs
+        const size_t nChunkSize = (nTotal + nThreads - 1) / nThreads;
+        std::vector<std::future<std::vector<IndexedOutput>>> futures;
+        for (size_t begin = 0; begin < nTotal; begin += nChunkSize) {
+            const size_t end = std::min(nTotal, begin + nChunkSize);
+            futures.emplace_back(decryptionPool->push([&decryptRange, begin, end](int) {
+                return decryptRange(begin, end);
+            }));
+        }
+        for (auto& f : futures) {
+            results.emplace_back(f.get());
+        }
+    }
+
+    // An output can be split among several ranges: keep the first match (lowest ivk index).
+    for (const auto& found : results) {
+        for (const IndexedOutput& res : found) {
+            if (!ret[res.first]) {
+                ret[res.first] = res.second;
             }
         }
     }
@@ -648,56 +825,81 @@ void SaplingScriptPubKeyMan::GetFilteredNotes(
 {
     LOCK(wallet->cs_wallet);
 
-    for (auto& p : wallet->mapWallet) {
-        const CWalletTx& wtx = p.second;
+    const int nextBlockHeight = wallet->GetLastBlockHeight() + 1;
+    const int64_t nAdjustedTime = GetAdjustedTime();
+    // Filter the transactions before checking for notes
+    auto isTxInRange = [&](const CWalletTx& wtx, int& depth) {
+        depth = wtx.GetDepthInMainChain();
+        return IsFinalTx(wtx.tx, nextBlockHeight, nAdjustedTime) && depth >= minDepth && depth <= maxDepth;
+    };
 
-        // Filter coinbase/coinstakes transactions that don't have Sapling outputs
-        if ((wtx.IsCoinBase() || wtx.IsCoinStake()) && wtx.mapSaplingNoteData.empty()) {
-            continue;
-        }
+    auto addNote = [&](const CWalletTx& wtx, int depth, const SaplingOutPoint& op, const SaplingNoteData& nd) {
+        // skip sent notes
+        if (!nd.IsMyNote()) return;
 
-        // Filter the transactions before checking for notes
-        const int depth = wtx.GetDepthInMainChain();
-        if (!IsFinalTx(wtx.tx, wallet->GetLastBlockHeight() + 1, GetAdjustedTime()) ||
-            depth < minDepth || depth > maxDepth) {
-            continue;
+        if (ignoreSpent && nd.nullifier && IsSaplingSpent(*nd.nullifier)) {
+            return;
         }
 
-        for (const auto& it : wtx.mapSaplingNoteData) {
-            const SaplingOutPoint& op = it.first;
-            const SaplingNoteData& nd = it.second;
-            // skip sent notes
-            if (!nd.IsMyNote()) continue;
+        // recover plaintext and address
+        auto optNotePtAndAddress = wtx.DecryptSaplingNote(op);
+        assert(static_cast<bool>(optNotePtAndAddress));
 
-            // recover plaintext and address
-            auto optNotePtAndAddress = wtx.DecryptSaplingNote(op);
-            assert(static_cast<bool>(optNotePtAndAddress));
+        const libzcash::SaplingIncomingViewingKey& ivk = *(nd.ivk);
+        const libzcash::SaplingNotePlaintext& notePt = optNotePtAndAddress->first;
+        const libzcash::SaplingPaymentAddress& pa = optNotePtAndAddress->second;
 
-            const libzcash::SaplingIncomingViewingKey& ivk = *(nd.ivk);
-            const libzcash::SaplingNotePlaintext& notePt = optNotePtAndAddress->first;
-            const libzcash::SaplingPaymentAddress& pa = optNotePtAndAddress->second;
-            auto note = notePt.note(ivk).get();
+        // skip notes which belong to a different payment address in the wallet
+        if (!(filterAddresses.empty() || filterAddresses.count(pa))) {
+            return;
+        }
 
-            // skip notes which belong to a different payment address in the wallet
-            if (!(filterAddresses.empty() || filterAddresses.count(pa))) {
-                continue;
-            }
+        // skip notes which cannot be spent
+        if (requireSpendingKey && !HaveSpendingKeyForPaymentAddress(pa)) {
+            return;
+        }
 
-            if (ignoreSpent && nd.nullifier && IsSaplingSpent(*nd.nullifier)) {
-                continue;
-            }
+        // skip locked notes.
+        if (ignoreLocked && wallet->IsLockedNote(op)) {
+            return;
+        }
 
-            // skip notes which cannot be spent
-            if (requireSpendingKey && !HaveSpendingKeyForPaymentAddress(pa)) {
-                continue;
+        auto note = notePt.note(ivk).get();
+        saplingEntries.emplace_back(op, pa, note, notePt.memo(), depth);
+    };
+
+    if (ignoreSpent) {
+        // Only walk the notes that may be unspent (in the same order as the wallet txs)
+        const CWalletTx* wtx = nullptr;
+        int depth = 0;
+        bool fInRange = false;
+        for (const SaplingOutPoint& op : GetUnspentNotesCandidates(filterAddresses)) {
+            if (!wtx || wtx->GetHash() != op.hash) {
+                wtx = wallet->GetWalletTx(op.hash);
+                fInRange = isTxInRange(*wtx, depth);
             }
-
-            // skip locked notes.
-            if (ignoreLocked && wallet->IsLockedNote(op)) {
-                continue;
+            if (fInRange) {
+                addNote(*wtx, depth, op, wtx->mapSaplingNoteData.at(op));
             }
+        }
+        return;
+    }
+
+    for (auto& p : wallet->mapWallet) {
+        const CWalletTx& wtx = p.second;
+
+        // Filter coinbase/coinstakes transactions that don't have Sapling outputs
+        if ((wtx.IsCoinBase() || wtx.IsCoinStake()) && wtx.mapSaplingNoteData.empty()) {
+            continue;
+        }
+
+        int depth;
+        if (!isTxInRange(wtx, depth)) {
+            continue;
+        }
 
-            saplingEntries.emplace_back(op, pa, note, notePt.memo(), depth);
+        for (const auto& it : wtx.mapSaplingNoteData) {
+            addNote(wtx, depth, it.first, it.second);
         }
     }
 }
@@ -817,9 +1019,14 @@ Optional<std::pair<
         libzcash::SaplingNotePlaintext,
         libzcash::SaplingPaymentAddress>>
         SaplingScriptPubKeyMan::TryToRecoverNote(const CWalletTx& tx, const SaplingOutPoint& op)
+{
+    assert(tx.GetHash() == op.hash);
+    return tx.RecoverSaplingNote(op, GetRecoveryOVKs(tx));
+}
+
+std::set<uint256> SaplingScriptPubKeyMan::GetRecoveryOVKs(const CWalletTx& tx)
 {
     const uint256& txId = tx.GetHash();
-    assert(txId == op.hash);
     // Try to recover it with the ovks (either the common one, if t->shield tx, or the ones from the spends)
     std::set<uint256> ovks;
     // Get the common OVK for recovering t->shield outputs.
@@ -853,7 +1060,7 @@ Optional<std::pair<
             }
         }
     }
-    return tx.RecoverSaplingNote(op, ovks);
+    return ovks;
 }
 
 isminetype SaplingScriptPubKeyMan::IsMine(const CWalletTx& wtx, const SaplingOutPoint& op) const
@@ -980,25 +1187,55 @@ void SaplingScriptPubKeyMan::GetSaplingNoteWitnesses(const std::vector<SaplingOu
                                       std::vector<Optional<SaplingWitness>>& witnesses,
                                       uint256& final_anchor) const
 {
-    LOCK(wallet->cs_wallet);
-    witnesses.resize(notes.size());
-    Optional<uint256> rt;
-    int i = 0;
-    for (SaplingOutPoint note : notes) {
-        auto it = wallet->mapWallet.find(note.hash);
-        if (it != wallet->mapWallet.end()) {
-            auto nit = it->second.mapSaplingNoteData.find(note);
-            if (nit != it->second.mapSaplingNoteData.end() &&
-                    nit->second.witnesses.size() > 0) {
-                witnesses[i] = nit->second.witnesses.front();
-                if (!rt) {
-                    rt = witnesses[i]->root();
-                } else {
-                    assert(*rt == witnesses[i]->root());
+    {
+        LOCK(wallet->cs_wallet);
+        witnesses.resize(notes.size());
+        int i = 0;
+        for (SaplingOutPoint note : notes) {
+            auto it = wallet->mapWallet.find(note.hash);
+            if (it != wallet->mapWallet.end()) {
+                auto nit = it->second.mapSaplingNoteData.find(note);
+                if (nit != it->second.mapSaplingNoteData.end() &&
+                        nit->second.witnesses.size() > 0) {
+                    witnesses[i] = nit->second.witnesses.front();
                 }
             }
+            i++;
+        }
+    }
+
+    // Each root hashes the path of the note up to the top of the tree: the witnesses
+    // are independent, so their roots are computed concurrently for multi-note spends.
+    std::vector<uint256> roots(witnesses.size());
+    auto computeRoots = [&witnesses, &roots](size_t begin, size_t end) {
+        for (size_t n = begin; n < end; n++) {
+            if (witnesses[n]) roots[n] = witnesses[n]->root();
+        }
+    };
+    const int nThreads = std::min(GetNumCores(), MAX_WITNESS_ROOT_THREADS);
+    if (nThreads <= 1 || witnesses.size() < MIN_PARALLEL_WITNESS_ROOTS) {
+        computeRoots(0, witnesses.size());
+    } else {
+        ctpl::thread_pool pool(nThreads);
+        const size_t nChunkSize = (witnesses.size() + nThreads - 1) / nThreads;
+        std::vector<std::future<void>> futures;
+        for (size_t begin = 0; begin < witnesses.size(); begin += nChunkSize) {
+            const size_t end = std::min(witnesses.size(), begin + nChunkSize);
+            futures.emplace_back(pool.push([&computeRoots, begin, end](int) { computeRoots(begin, end); }));
+        }
+        for (auto& f : futures) {
+            f.get();
+        }
+    }
+
+    Optional<uint256> rt;
+    for (size_t n = 0; n < witnesses.size(); n++) {
+        if (!witnesses[n]) continue;
+        if (!rt) {
+            rt = roots[n];
+        } else {
+            assert(*rt == roots[n]);
         }
-        i++;
     }
     // All returned witnesses have the same anchor
     if (rt) {
@@ -1023,6 +1260,8 @@ bool SaplingScriptPubKeyMan::UpdatedNoteData(const CWalletTx& wtxIn, CWalletTx&
 
         // Now copy over the updated note data
         wtx.mapSaplingNoteData = tmp;
+        LOCK(wallet->cs_wallet);
+        IndexNotesOfTx(wtx);
     }
 
     return !unchangedSaplingFlag;
@@ -1068,9 +1307,12 @@ Optional<libzcash::SaplingExtendedFullViewingKey> SaplingScriptPubKeyMan::GetVie
 
 //! TODO: Should be Sapling address format, SaplingPaymentAddress
 // Generate a new Sapling spending key and return its public payment address
-libzcash::SaplingPaymentAddress SaplingScriptPubKeyMan::GenerateNewSaplingZKey()
+libzcash::SaplingExtendedSpendingKey SaplingScriptPubKeyMan::GetCoinTypeKey()
 {
-    LOCK(wallet->cs_wallet); // mapSaplingZKeyMetadata
+    LOCK(wallet->cs_KeyStore);
+    if (wallet->IsLocked())
+        throw std::runtime_error(std::string(__func__) + ": wallet locked");
+    if (!coinTypeKeyCache.empty()) return coinTypeKeyCache.front();
 
     // Try to get the seed
     CKey seedKey;
@@ -1084,34 +1326,64 @@ libzcash::SaplingPaymentAddress SaplingScriptPubKeyMan::GenerateNewSaplingZKey()
     // Derive m/32'
     auto m_32h = m.Derive(32 | ZIP32_HARDENED_KEY_LIMIT);
     // Derive m/32'/coin_type'
-    auto m_32h_cth = m_32h.Derive(119 | ZIP32_HARDENED_KEY_LIMIT);
+    coinTypeKeyCache.emplace_back(m_32h.Derive(119 | ZIP32_HARDENED_KEY_LIMIT));
+    return coinTypeKeyCache.front();
+}
 
-    // Derive account key at next index, skip keys already known to the wallet
-    libzcash::SaplingExtendedSpendingKey xsk;
-    do {
-        xsk = m_32h_cth.Derive(hdChain.nExternalChainCounter | ZIP32_HARDENED_KEY_LIMIT);
+void SaplingScriptPubKeyMan::ClearCoinTypeKeyCache()
+{
+    LOCK(wallet->cs_KeyStore);
+    // Release the locked memory (cleansed by the allocator)
+    decltype(coinTypeKeyCache)().swap(coinTypeKeyCache);
+}
+
+libzcash::SaplingPaymentAddress SaplingScriptPubKeyMan::GenerateNewSaplingZKey()
+{
+    return GenerateNewSaplingZKeys(1).front();
+}
+
+std::vector<libzcash::SaplingPaymentAddress> SaplingScriptPubKeyMan::GenerateNewSaplingZKeys(unsigned int count)
+{
+    LOCK(wallet->cs_wallet); // mapSaplingZKeyMetadata
+
+    const auto m_32h_cth = GetCoinTypeKey();
+
+    // Derive the account keys at the next indexes, skip keys already known to the wallet
+    std::vector<std::pair<libzcash::SaplingExtendedSpendingKey, uint32_t>> vKeys;
+    vKeys.reserve(count);
+    while (vKeys.size() < count) {
+        auto xsk = m_32h_cth.Derive(hdChain.nExternalChainCounter | ZIP32_HARDENED_KEY_LIMIT);
         hdChain.nExternalChainCounter++; // Increment childkey index
-    } while (wallet->HaveSaplingSpendingKey(xsk.ToXFVK()));
+        if (!wallet->HaveSaplingSpendingKey(xsk.ToXFVK())) {
+            vKeys.emplace_back(xsk, hdChain.nExternalChainCounter);
+        }
+    }
 
     // Update the chain model in the database
     if (!WalletBatch(wallet->GetDBHandle()).WriteHDChain(hdChain))
         throw std::runtime_error(std::string(__func__) + ": Writing HD chain model failed");
 
-    // Create new metadata
-    int64_t nCreationTime = GetTime();
-    auto ivk = xsk.expsk.full_viewing_key().in_viewing_key();
-    CKeyMetadata metadata(nCreationTime);
-    metadata.key_origin.path.push_back(32 | BIP32_HARDENED_KEY_LIMIT);
-    metadata.key_origin.path.push_back(119 | BIP32_HARDENED_KEY_LIMIT);
-    metadata.key_origin.path.push_back(hdChain.nExternalChainCounter | BIP32_HARDENED_KEY_LIMIT);
-    metadata.hd_seed_id = hdChain.GetID();
-    mapSaplingZKeyMetadata[ivk] = metadata;
-
-    if (!AddSaplingZKey(xsk)) {
-        throw std::runtime_error(std::string(__func__) + ": AddSaplingZKey failed");
+    std::vector<libzcash::SaplingPaymentAddress> vAddresses;
+    vAddresses.reserve(count);
+    for (const auto& key : vKeys) {
+        const auto& xsk = key.first;
+        // Create new metadata
+        int64_t nCreationTime = GetTime();
+        auto ivk = xsk.expsk.full_viewing_key().in_viewing_key();
+        CKeyMetadata metadata(nCreationTime);
+        metadata.key_origin.path.push_back(32 | BIP32_HARDENED_KEY_LIMIT);
+        metadata.key_origin.path.push_back(119 | BIP32_HARDENED_KEY_LIMIT);
+        metadata.key_origin.path.push_back(key.second | BIP32_HARDENED_KEY_LIMIT);
+        metadata.hd_seed_id = hdChain.GetID();
+        mapSaplingZKeyMetadata[ivk] = metadata;
+
+        if (!AddSaplingZKey(xsk)) {
+            throw std::runtime_error(std::string(__func__) + ": AddSaplingZKey failed");
+        }
+        // return default sapling payment address.
+        vAddresses.emplace_back(xsk.DefaultAddress());
     }
-    // return default sapling payment address.
-    return xsk.DefaultAddress();
+    return vAddresses;
 }
 
 int64_t SaplingScriptPubKeyMan::GetKeyCreationTime(const libzcash::SaplingIncomingViewingKey& ivk)
@@ -1389,6 +1661,7 @@ void SaplingScriptPubKeyMan::SetHDChain(CHDChain& chain, bool memonly)
         throw std::runtime_error(std::string(__func__) + ": writing sapling chain failed");
 
     hdChain = chain;
+    ClearCoinTypeKeyCache();
 
     // Sanity check
     if (!wallet->HaveKey(hdChain.GetID()))
@@ -8,6 +8,7 @@
 #include "consensus/consensus.h"
 #include "sapling/incrementalmerkletree.h"
 #include "sapling/note.h"
+#include "support/allocators/secure.h"
 #include "uint256.h"
 #include "wallet/hdchain.h"
 #include "wallet/scriptpubkeyman.h"
@@ -20,8 +21,18 @@
 //  unless there is some exceptional network disruption.
 static const unsigned int WITNESS_CACHE_SIZE = DEFAULT_MAX_REORG_DEPTH + 1;
 
+//! Max number of threads used to trial-decrypt the shielded outputs of a transaction
+static const int MAX_TRIAL_DECRYPTION_THREADS = 4;
+//! Min number of (output, ivk) trial decryptions needed to spread them over the worker threads
+static const size_t MIN_PARALLEL_TRIAL_DECRYPTIONS = 16;
+//! Max number of threads used to compute the roots of the witnesses of the notes spent by a transaction
+static const int MAX_WITNESS_ROOT_THREADS = 4;
+//! Min number of witnesses needed to compute their roots concurrently
+static const size_t MIN_PARALLEL_WITNESS_ROOTS = 4;
+
 class CBlock;
 class CBlockIndex;
+namespace ctpl { class thread_pool; }
 
 /** Sapling note, its location in a transaction, and number of confirmations. */
 struct SaplingNoteEntry
@@ -147,9 +158,9 @@ typedef std::map<SaplingOutPoint, SaplingNoteData> mapSaplingNoteData_t;
 class SaplingScriptPubKeyMan {
 
 public:
-    SaplingScriptPubKeyMan(CWallet *parent) : wallet(parent) {}
+    SaplingScriptPubKeyMan(CWallet *parent);
 
-    ~SaplingScriptPubKeyMan() {};
+    ~SaplingScriptPubKeyMan();
 
     /**
      * Keep track of the used nullifier.
@@ -176,7 +187,8 @@ public:
 
     /**
      * Update mapSaplingNullifiersToNotes
-     * with the cached nullifiers in this tx.
+     * with the cached nullifiers in this tx,
+     * and add its notes to the unspent notes index.
      */
     void UpdateNullifierNoteMapWithTx(const CWalletTx& wtx);
 
@@ -242,6 +254,10 @@ public:
 
     //! Generates new Sapling key
     libzcash::SaplingPaymentAddress GenerateNewSaplingZKey();
+    //! Generates count new Sapling keys, writing the HD chain only once
+    std::vector<libzcash::SaplingPaymentAddress> GenerateNewSaplingZKeys(unsigned int count);
+    //! Forget the cached key of the HD chain (when the wallet is locked)
+    void ClearCoinTypeKeyCache();
     //! Adds Sapling spending key to the store, and saves it to disk
     bool AddSaplingZKey(const libzcash::SaplingExtendedSpendingKey &key);
     bool AddSaplingIncomingViewingKey(
@@ -324,6 +340,8 @@ public:
     std::set<std::pair<libzcash::PaymentAddress, uint256>> GetNullifiersForAddresses(const std::set<libzcash::PaymentAddress> & addresses) const;
     bool IsNoteSaplingChange(const std::set<std::pair<libzcash::PaymentAddress, uint256>>& nullifierSet, const libzcash::PaymentAddress& address, const SaplingOutPoint& entry) const;
 
+    //! The wallet's ovks able to recover the outputs of tx: the common one for t->shield txes, else the ones of the spends
+    std::set<uint256> GetRecoveryOVKs(const CWalletTx& tx);
     //! Try to recover the note using the wallet's ovks (mostly used when the outpoint is a debit)
     Optional<std::pair<
             libzcash::SaplingNotePlaintext,
@@ -415,6 +433,9 @@ public:
 
     std::map<uint256, SaplingOutPoint> mapSaplingNullifiersToNotes;
 
+    /* The notes spent by a confirmed tx can be unspent again (e.g. after a block disconnection) */
+    void MarkUnspentNotesIndexDirty() { fUnspentNotesIndexValid = false; }
+
 private:
     /* Map hash nullifiers, list Sapling Witness*/
     std::map<uint256, std::list<SaplingWitness>> cachedWitnessMap;
@@ -423,10 +444,26 @@ private:
     CWallet* wallet{nullptr};
     /* the HD chain data model (external/internal chain counters) */
     CHDChain hdChain;
+    /* the m/32'/coin_type' key of hdChain, parent of the account keys, derived from the seed once while the
+     * wallet is unlocked. Kept in locked memory (at most one element), guarded by cs_KeyStore. */
+    std::vector<libzcash::SaplingExtendedSpendingKey, secure_allocator<libzcash::SaplingExtendedSpendingKey>> coinTypeKeyCache;
+    libzcash::SaplingExtendedSpendingKey GetCoinTypeKey();
     /* cached common OVK for sapling spends from t addresses */
     Optional<uint256> commonOVK;
     uint256 getCommonOVKFromSeed() const;
 
+    /* workers used to trial-decrypt the outputs of a tx (created on first use, guarded by cs_KeyStore) */
+    mutable std::unique_ptr<ctpl::thread_pool> decryptionPool;
+
+    typedef std::pair<libzcash::SaplingIncomingViewingKey, libzcash::SaplingNotePlaintext> DecryptedOutput;
+    /**
+     * Trial-decrypts each output with every full viewing key of the wallet.
+     * Returns, for each output, the first ivk (in mapSaplingFullViewingKeys order)
+     * able to decrypt it, together with the note plaintext.
+     * The (output, ivk) pairs are spread over decryptionPool when there are enough of them.
+     */
+    std::vector<Optional<DecryptedOutput>> TrialDecryptOutputs(const std::vector<OutputDescription>& outputs) const;
+
 
     /**
      * Used to keep track of spent Notes, and
@@ -434,6 +471,35 @@ private:
      */
     typedef std::multimap<uint256, uint256> TxNullifiers;
     TxNullifiers mapTxSaplingNullifiers;
+
+    /**
+     * Index, by payment address, of the notes of the wallet that may be unspent, walked by GetFilteredNotes
+     * instead of every wallet tx. The notes enter it when their tx is added to the wallet, waiting in
+     * setUnindexedNotes until the next lookup decrypts their address, and leave it once spent by a confirmed tx.
+     * It's rebuilt (guarded by cs_wallet) after MarkUnspentNotesIndexDirty.
+     */
+    mutable std::map<libzcash::SaplingPaymentAddress, std::set<SaplingOutPoint>> mapUnspentNotesByAddress;
+    mutable std::set<SaplingOutPoint> setUnindexedNotes;
+    mutable bool fUnspentNotesIndexValid{false};
+    /* The addresses of the notes already decrypted by the index, which never change */
+    mutable std::map<SaplingOutPoint, libzcash::SaplingPaymentAddress> mapNoteAddresses;
+
+    void AddToUnspentNotesIndex(const CWalletTx& wtx) const;
+
+    /**
+     * The wallet txs with notes of ours (guarded by cs_wallet), whose witnesses are updated at each block
+     * connection and disconnection, instead of walking the whole mapWallet. The txs erased from the wallet are
+     * removed when they are next walked.
+     */
+    std::set<uint256> setTxsWithMyNotes;
+    /* Called when the note data of a wallet tx is set */
+    void IndexNotesOfTx(const CWalletTx& wtx);
+    template <typename Func>
+    void ForEachTxWithMyNotes(Func func);
+    /* Returns the indexed notes paying to filterAddresses (all of them if empty), pruning the spent ones */
+    std::set<SaplingOutPoint> GetUnspentNotesCandidates(const std::set<libzcash::PaymentAddress>& filterAddresses) const;
+    /* Whether the nullifier is spent by a tx in the active chain */
+    bool IsSaplingSpentInChain(const uint256& nullifier) const;
 };
 
 #endif //PIVX_SAPLINGSCRIPTPUBKEYMAN_H
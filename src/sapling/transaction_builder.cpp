@@ -5,14 +5,50 @@
 
 #include "sapling/transaction_builder.h"
 
+#include "ctpl_stl.h"
 #include "script/sign.h"
 #include "utilmoneystr.h"
 #include "consensus/upgrades.h"
 #include "policy/policy.h"
+#include "util/system.h"
 #include "validation.h"
 
 #include <librustzcash.h>
 
+//! Max number of threads used to compute the authentication paths of the notes spent
+static const int MAX_WITNESS_PATH_THREADS = 4;
+//! Min number of spends needed to compute their authentication paths concurrently
+static const size_t MIN_PARALLEL_WITNESS_PATHS = 4;
+
+// The serialized authentication paths of the witnesses of the spends
+static std::vector<std::vector<unsigned char>> GetWitnessPaths(const std::vector<SpendDescriptionInfo>& spends)
+{
+    std::vector<std::vector<unsigned char>> paths(spends.size());
+    auto computePaths = [&spends, &paths](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+            ss << spends[i].witness.path();
+            paths[i].assign(ss.begin(), ss.end());
+        }
+    };
+    const int nThreads = std::min(GetNumCores(), MAX_WITNESS_PATH_THREADS);
+    if (nThreads <= 1 || spends.size() < MIN_PARALLEL_WITNESS_PATHS) {
+        computePaths(0, spends.size());
+        return paths;
+    }
+    ctpl::thread_pool pool(nThreads);
+    const size_t nChunkSize = (spends.size() + nThreads - 1) / nThreads;
+    std::vector<std::future<void>> futures;
+    for (size_t begin = 0; begin < spends.size(); begin += nChunkSize) {
+        const size_t end = std::min(spends.size(), begin + nChunkSize);
+        futures.emplace_back(pool.push([&computePaths, begin, end](int) { computePaths(begin, end); }));
+    }
+    for (auto& f : futures) {
+        f.get();
+    }
+    return paths;
+}
+
 SpendDescriptionInfo::SpendDescriptionInfo(const libzcash::SaplingExpandedSpendingKey& _expsk,
                                            const libzcash::SaplingNote& _note,
                                            const uint256& _anchor,
@@ -25,7 +61,7 @@ SpendDescriptionInfo::SpendDescriptionInfo(const libzcash::SaplingExpandedSpendi
     librustzcash_sapling_generate_r(alpha.begin());
 }
 
-Optional<OutputDescription> OutputDescriptionInfo::Build(void* ctx) {
+Optional<OutputDescription> OutputDescriptionInfo::Build(void* ctx) const {
     auto cmu = this->note.cmu();
     if (!cmu) {
         return nullopt;
@@ -237,11 +273,23 @@ TransactionBuilderResult TransactionBuilder::ProveAndSign()
     // Sapling spend descriptions
     //
     if (!spends.empty() || !outputs.empty()) {
+        try {
+            initZKSNARKSProvingParams();
+        } catch (const std::runtime_error& e) {
+            return TransactionBuilderResult(e.what());
+        }
 
         auto ctx = librustzcash_sapling_proving_ctx_init();
 
+        // The proofs are created one at a time, with a single proving context: it accumulates the value
+        // commitment randomness of the proofs (in private fields of zcash_proofs' SaplingProvingContext)
+        // into the key of the binding signature, and there is no way to merge the contexts of several
+        // threads. Each proof is already multi-threaded by bellman.
+        mtx.sapData->vShieldedOutput.reserve(outputs.size());
+        mtx.sapData->vShieldedSpend.reserve(spends.size());
+
         // Create Sapling OutputDescriptions
-        for (auto output : outputs) {
+        for (const auto& output : outputs) {
             // Check this out here as well to provide better logging.
             if (!output.note.cmu()) {
                 librustzcash_sapling_proving_ctx_free(ctx);
@@ -258,7 +306,9 @@ TransactionBuilderResult TransactionBuilder::ProveAndSign()
         }
 
         // Create Sapling SpendDescriptions
-        for (auto spend : spends) {
+        const auto& witnessPaths = GetWitnessPaths(spends);
+        for (size_t i = 0; i < spends.size(); i++) {
+            const auto& spend = spends[i];
             auto cm = spend.note.cmu();
             auto nf = spend.note.nullifier(
                     spend.expsk.full_viewing_key(), spend.witness.position());
@@ -267,9 +317,7 @@ TransactionBuilderResult TransactionBuilder::ProveAndSign()
                 return TransactionBuilderResult("Spend is invalid");
             }
 
-            CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-            ss << spend.witness.path();
-            std::vector<unsigned char> witness(ss.begin(), ss.end());
+            const std::vector<unsigned char>& witness = witnessPaths[i];
 
             SpendDescription sdesc;
             if (!librustzcash_sapling_spend_proof(
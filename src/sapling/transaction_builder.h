@@ -47,7 +47,7 @@ struct OutputDescriptionInfo {
             memo(_memo)
     {}
 
-    Optional<OutputDescription> Build(void* ctx);
+    Optional<OutputDescription> Build(void* ctx) const;
 };
 
 struct TransparentInputInfo {
@@ -7,6 +7,7 @@
 
 #include "random.h"
 
+#include <algorithm>
 #include <assert.h>
 #include <utility>
 
@@ -19,6 +20,21 @@ CScheduler::~CScheduler()
     assert(nThreadsServicingQueue == 0);
 }
 
+CScheduler::TaskQueue::iterator CScheduler::nextTask(std::chrono::system_clock::time_point now)
+{
+    // The LOW priority tasks don't take the last thread left to the others
+    const bool fLowAllowed = nThreadsServicingQueue <= 1 || nLowPriorityRunning + 1 < nThreadsServicingQueue;
+    TaskQueue::iterator itBest = taskQueue.end();
+    for (auto it = taskQueue.begin(); it != taskQueue.end() && it->first <= now; ++it) {
+        if (it->second.priority == Priority::LOW && !fLowAllowed) continue;
+        if (itBest == taskQueue.end() || it->second.priority < itBest->second.priority) {
+            itBest = it;
+            if (itBest->second.priority == Priority::HIGH) break;
+        }
+    }
+    return itBest;
+}
+
 void CScheduler::serviceQueue()
 {
     WAIT_LOCK(newTaskMutex, lock);
@@ -38,29 +54,61 @@ void CScheduler::serviceQueue()
             }
 
             // Wait until either there is a new task, or until
-            // the time of the first item on the queue:
-
+            // the time of the first item on the queue that can run:
+            TaskQueue::iterator itTask = taskQueue.end();
             while (!shouldStop() && !taskQueue.empty()) {
-                std::chrono::system_clock::time_point timeToWaitFor = taskQueue.begin()->first;
-                if (newTaskScheduled.wait_until(lock, timeToWaitFor) == std::cv_status::timeout) {
-                    break; // Exit loop after timeout, it means we reached the time of the event
+                const std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
+                itTask = nextTask(now);
+                if (itTask != taskQueue.end()) break;
+                // The due tasks (if any) are LOW priority ones held back until a thread finishes its task
+                auto itNext = taskQueue.upper_bound(now);
+                if (itNext == taskQueue.end()) {
+                    newTaskScheduled.wait(lock);
+                } else {
+                    newTaskScheduled.wait_until(lock, itNext->first);
                 }
             }
 
             // If there are multiple threads, the queue can empty while we're waiting (another
             // thread may service the task we were waiting on).
-            if (shouldStop() || taskQueue.empty())
+            if (shouldStop() || itTask == taskQueue.end())
                 continue;
 
-            Function f = taskQueue.begin()->second;
-            taskQueue.erase(taskQueue.begin());
+            const std::chrono::system_clock::time_point timeScheduled = itTask->first;
+            Task task = std::move(itTask->second);
+            taskQueue.erase(itTask);
+            const bool fLow = task.priority == Priority::LOW;
+            if (fLow) ++nLowPriorityRunning;
 
+            const auto timeStart = std::chrono::system_clock::now();
+            std::chrono::system_clock::time_point timeEnd;
             {
                 // Unlock before calling f, so it can reschedule itself or another task
                 // without deadlocking:
                 REVERSE_LOCK(lock);
-                f();
+                try {
+                    task.f();
+                } catch (...) {
+                    LOCK(newTaskMutex);
+                    if (fLow) --nLowPriorityRunning;
+                    throw;
+                }
+                timeEnd = std::chrono::system_clock::now();
             }
+            if (fLow) {
+                --nLowPriorityRunning;
+                // A held back LOW priority task can run now
+                newTaskScheduled.notify_all();
+            }
+
+            SchedulerTaskStats& stats = mapTaskStats[task.name];
+            const int64_t nDelay = std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::microseconds>(timeStart - timeScheduled).count());
+            const int64_t nRun = std::chrono::duration_cast<std::chrono::microseconds>(timeEnd - timeStart).count();
+            stats.nRuns++;
+            stats.nDelayTotal += nDelay;
+            stats.nDelayMax = std::max(stats.nDelayMax, nDelay);
+            stats.nRunTotal += nRun;
+            stats.nRunMax = std::max(stats.nRunMax, nRun);
         } catch (...) {
             --nThreadsServicingQueue;
             throw;
@@ -82,29 +130,29 @@ void CScheduler::stop(bool drain)
     newTaskScheduled.notify_all();
 }
 
-void CScheduler::schedule(CScheduler::Function f, std::chrono::system_clock::time_point t)
+void CScheduler::schedule(CScheduler::Function f, std::chrono::system_clock::time_point t, const std::string& name, Priority priority)
 {
     {
         LOCK(newTaskMutex);
-        taskQueue.emplace(t, f);
+        taskQueue.emplace(t, Task{std::move(f), name, priority});
     }
     newTaskScheduled.notify_one();
 }
 
-void CScheduler::scheduleFromNow(CScheduler::Function f, int64_t deltaMilliSeconds)
+void CScheduler::scheduleFromNow(CScheduler::Function f, int64_t deltaMilliSeconds, const std::string& name, Priority priority)
 {
-    schedule(f, std::chrono::system_clock::now() + std::chrono::milliseconds(deltaMilliSeconds));
+    schedule(f, std::chrono::system_clock::now() + std::chrono::milliseconds(deltaMilliSeconds), name, priority);
 }
 
-static void Repeat(CScheduler* s, CScheduler::Function f, int64_t deltaMilliSeconds)
+static void Repeat(CScheduler* s, CScheduler::Function f, int64_t deltaMilliSeconds, const std::string& name, CScheduler::Priority priority)
 {
     f();
-    s->scheduleFromNow(std::bind(&Repeat, s, f, deltaMilliSeconds), deltaMilliSeconds);
+    s->scheduleFromNow(std::bind(&Repeat, s, f, deltaMilliSeconds, name, priority), deltaMilliSeconds, name, priority);
 }
 
-void CScheduler::scheduleEvery(CScheduler::Function f, int64_t deltaMilliSeconds)
+void CScheduler::scheduleEvery(CScheduler::Function f, int64_t deltaMilliSeconds, const std::string& name, Priority priority)
 {
-    scheduleFromNow(std::bind(&Repeat, this, f, deltaMilliSeconds), deltaMilliSeconds);
+    scheduleFromNow(std::bind(&Repeat, this, f, deltaMilliSeconds, name, priority), deltaMilliSeconds, name, priority);
 }
 
 size_t CScheduler::getQueueInfo(std::chrono::system_clock::time_point &first,
@@ -124,6 +172,12 @@ bool CScheduler::AreThreadsServicingQueue() const {
     return nThreadsServicingQueue;
 }
 
+std::map<std::string, SchedulerTaskStats> CScheduler::GetTaskStats() const
+{
+    LOCK(newTaskMutex);
+    return mapTaskStats;
+}
+
 void SingleThreadedSchedulerClient::MaybeScheduleProcessQueue() {
     {
         LOCK(m_cs_callbacks_pending);
@@ -133,7 +187,8 @@ void SingleThreadedSchedulerClient::MaybeScheduleProcessQueue() {
         if (m_are_callbacks_running) return;
         if (m_callbacks_pending.empty()) return;
     }
-    m_pscheduler->schedule(std::bind(&SingleThreadedSchedulerClient::ProcessQueue, this), std::chrono::system_clock::now());
+    m_pscheduler->schedule(std::bind(&SingleThreadedSchedulerClient::ProcessQueue, this), std::chrono::system_clock::now(),
+                           "validationinterface", CScheduler::Priority::HIGH);
 }
 
 void SingleThreadedSchedulerClient::ProcessQueue() {
@@ -11,10 +11,13 @@
 // boost::thread should be ported to std::thread
 // when we support C++11.
 //
+#include <chrono>
 #include <condition_variable>
 #include <functional>
 #include <list>
 #include <map>
+#include <string>
+#include <vector>
 
 #include "sync.h"
 
@@ -35,6 +38,25 @@
 // delete t;
 // delete s; // Must be done after thread is interrupted/joined.
 //
+// Several threads can run serviceQueue. The tasks which are due run in order of priority, and the
+// LOW priority ones never take the last thread available for the others.
+//
+
+//! Default for -schedulerthreads
+static const int DEFAULT_SCHEDULER_THREADS = 2;
+//! Maximum for -schedulerthreads
+static const int MAX_SCHEDULER_THREADS = 8;
+
+/** Run statistics of the tasks scheduled with a name (times in microseconds) */
+struct SchedulerTaskStats
+{
+    uint64_t nRuns{0};
+    //! Time between the scheduled time and the start of the runs
+    int64_t nDelayTotal{0};
+    int64_t nDelayMax{0};
+    int64_t nRunTotal{0};
+    int64_t nRunMax{0};
+};
 
 class CScheduler
 {
@@ -44,18 +66,24 @@ public:
 
     typedef std::function<void(void)> Function;
 
-    // Call func at/after time t
-    void schedule(Function f, std::chrono::system_clock::time_point t);
+    enum class Priority {
+        HIGH,   // time-sensitive, e.g. the validation interface callbacks
+        NORMAL,
+        LOW,    // long maintenance tasks and file dumps
+    };
+
+    // Call func at/after time t. The statistics of the tasks are gathered by name
+    void schedule(Function f, std::chrono::system_clock::time_point t, const std::string& name = "unnamed", Priority priority = Priority::NORMAL);
 
     // Convenience method: call f once deltaMilliSeconds from now
-    void scheduleFromNow(Function f, int64_t deltaMilliSeconds);
+    void scheduleFromNow(Function f, int64_t deltaMilliSeconds, const std::string& name = "unnamed", Priority priority = Priority::NORMAL);
 
     // Another convenience method: call f approximately
     // every deltaMilliSeconds forever, starting deltaMilliSeconds from now.
     // To be more precise: every time f is finished, it
     // is rescheduled to run deltaMilliSeconds later. If you
     // need more accurate scheduling, don't use this method.
-    void scheduleEvery(Function f, int64_t deltaMilliSeconds);
+    void scheduleEvery(Function f, int64_t deltaMilliSeconds, const std::string& name = "unnamed", Priority priority = Priority::NORMAL);
 
     // To keep things as simple as possible, there is no unschedule.
 
@@ -76,14 +104,28 @@ public:
     // Returns true if there are threads actively running in serviceQueue()
     bool AreThreadsServicingQueue() const;
 
+    // The statistics of the tasks run, by name
+    std::map<std::string, SchedulerTaskStats> GetTaskStats() const;
+
 private:
+    struct Task {
+        Function f;
+        std::string name;
+        Priority priority;
+    };
+    typedef std::multimap<std::chrono::system_clock::time_point, Task> TaskQueue;
+
     mutable Mutex newTaskMutex;
     std::condition_variable newTaskScheduled;
-    std::multimap<std::chrono::system_clock::time_point, Function> taskQueue GUARDED_BY(newTaskMutex);
+    TaskQueue taskQueue GUARDED_BY(newTaskMutex);
+    std::map<std::string, SchedulerTaskStats> mapTaskStats GUARDED_BY(newTaskMutex);
     int nThreadsServicingQueue GUARDED_BY(newTaskMutex);
+    int nLowPriorityRunning GUARDED_BY(newTaskMutex){0};
     bool stopRequested GUARDED_BY(newTaskMutex);
     bool stopWhenEmpty GUARDED_BY(newTaskMutex);
     bool shouldStop() const EXCLUSIVE_LOCKS_REQUIRED(newTaskMutex) { return stopRequested || (stopWhenEmpty && taskQueue.empty()); }
+    // The task to run at now, the one of highest priority (and the earliest) among the due ones, or taskQueue.end()
+    TaskQueue::iterator nextTask(std::chrono::system_clock::time_point now) EXCLUSIVE_LOCKS_REQUIRED(newTaskMutex);
 };
 
 /**
@@ -10,6 +10,7 @@
 #include "crypto/ripemd160.h"
 #include "crypto/sha1.h"
 #include "crypto/sha256.h"
+#include "memusage.h"
 #include "pubkey.h"
 #include "script/script.h"
 
@@ -1166,8 +1167,11 @@ uint256 GetShieldedOutputsHash(const CTransaction& txTo) {
 
 } // anon namespace
 
-PrecomputedTransactionData::PrecomputedTransactionData(const CTransaction& txTo)
+PrecomputedTransactionData::PrecomputedTransactionData(const CTransaction& txTo) : vSigHashes(txTo.vin.size())
 {
+    if (!txTo.isSaplingVersion()) {
+        return;
+    }
     hashPrevouts = GetPrevoutHash(txTo);
     hashSequence = GetSequenceHash(txTo);
     hashOutputs = GetOutputsHash(txTo);
@@ -1177,6 +1181,41 @@ PrecomputedTransactionData::PrecomputedTransactionData(const CTransaction& txTo)
     }
 }
 
+/** Bound of the signature hashes kept for each input (one per scriptCode and hash type) */
+static const size_t MAX_INPUT_SIGHASHES = 4;
+
+uint256 PrecomputedTransactionData::GetSignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType,
+                                                     const CAmount& amount, SigVersion sigversion) const
+{
+    if (nIn >= vSigHashes.size()) {
+        return SignatureHash(scriptCode, txTo, nIn, nHashType, amount, sigversion, this);
+    }
+    std::vector<SigHashEntry>& entries = vSigHashes[nIn];
+    for (const SigHashEntry& entry : entries) {
+        if (entry.nHashType == nHashType && entry.amount == amount && entry.sigversion == sigversion &&
+                entry.scriptCode == scriptCode) {
+            return entry.hash;
+        }
+    }
+    const uint256 hash = SignatureHash(scriptCode, txTo, nIn, nHashType, amount, sigversion, this);
+    if (entries.size() < MAX_INPUT_SIGHASHES) {
+        entries.push_back({scriptCode, nHashType, amount, sigversion, hash});
+    }
+    return hash;
+}
+
+size_t PrecomputedTransactionData::DynamicMemoryUsage() const
+{
+    size_t nUsage = memusage::DynamicUsage(vSigHashes);
+    for (const std::vector<SigHashEntry>& entries : vSigHashes) {
+        nUsage += memusage::DynamicUsage(entries);
+        for (const SigHashEntry& entry : entries) {
+            nUsage += memusage::DynamicUsage(entry.scriptCode);
+        }
+    }
+    return nUsage;
+}
+
 uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType, const CAmount& amount, SigVersion sigversion, const PrecomputedTransactionData* cache)
 {
     if (nIn >= txTo.vin.size() && nIn != NOT_AN_INPUT) {
@@ -1189,6 +1228,8 @@ uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsig
     }
 
     if (sigversion == SIGVERSION_SAPLING) {
+        // The hashes aren't precomputed for the older transactions
+        if (!txTo.isSaplingVersion()) cache = nullptr;
 
         uint256 hashPrevouts;
         uint256 hashSequence;
@@ -1309,7 +1350,8 @@ bool TransactionSignatureChecker::CheckSig(const std::vector<unsigned char>& vch
     int nHashType = vchSig.back();
     vchSig.pop_back();
 
-    const uint256& sighash = SignatureHash(scriptCode, *txTo, nIn, nHashType, amount, sigversion, this->precomTxData);
+    const uint256 sighash = precomTxData ? precomTxData->GetSignatureHash(scriptCode, *txTo, nIn, nHashType, amount, sigversion) :
+                                           SignatureHash(scriptCode, *txTo, nIn, nHashType, amount, sigversion);
 
     if (!VerifySignature(vchSig, pubkey, sighash))
         return false;
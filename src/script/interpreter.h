@@ -91,9 +91,32 @@ bool CheckSignatureEncoding(const std::vector<unsigned char> &vchSig, unsigned i
 
 struct PrecomputedTransactionData
 {
+    // Only computed for the Sapling version transactions, the others don't use them
     uint256 hashPrevouts, hashSequence, hashOutputs, hashShieldedSpends, hashShieldedOutputs;
 
     PrecomputedTransactionData(const CTransaction& tx);
+
+    /** The signature hash of the input nIn of txTo (the transaction of this data), reused by the next checks
+     *  of the same input: the mandatory flags check after the standard one, the multisig signatures, and the
+     *  block connection of the transactions accepted to the mempool (which keeps their data). */
+    uint256 GetSignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType,
+                             const CAmount& amount, SigVersion sigversion) const;
+
+    /** The memory used by the kept signature hashes (and their scriptCodes) */
+    size_t DynamicMemoryUsage() const;
+
+private:
+    struct SigHashEntry
+    {
+        CScript scriptCode;
+        int nHashType;
+        CAmount amount;
+        SigVersion sigversion;
+        uint256 hash;
+    };
+    /** The signature hashes of each input. The entries of an input are only accessed by the check of that input,
+     *  as the checks of the different inputs can run on different threads. */
+    mutable std::vector<std::vector<SigHashEntry>> vSigHashes;
 };
 
 uint256 SignatureHash(const CScript &scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType, const CAmount& amount, SigVersion sigversion, const PrecomputedTransactionData* cache = nullptr);
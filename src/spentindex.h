@@ -0,0 +1,45 @@
+// Copyright (c) 2016 BitPay, Inc.
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_SPENTINDEX_H
+#define PIVX_SPENTINDEX_H
+
+#include "amount.h"
+#include "primitives/transaction.h"
+#include "script/script.h"
+#include "serialize.h"
+#include "uint256.h"
+
+#include <utility>
+#include <vector>
+
+//! Default for -spentindex
+static const bool DEFAULT_SPENTINDEX = false;
+
+/**
+ * The input spending an output (the key of the entry), with the value and the script of the output,
+ * so that the inputs can be resolved without reading the transactions of their prevouts.
+ * A null value erases the entry of its key.
+ */
+struct CSpentIndexValue
+{
+    uint256 txid;
+    unsigned int inputIndex{0};
+    int blockHeight{0};
+    CAmount satoshis{-1};
+    CScript script;
+
+    CSpentIndexValue() = default;
+    CSpentIndexValue(const uint256& _txid, unsigned int _inputIndex, int _blockHeight, CAmount _satoshis, const CScript& _script) :
+        txid(_txid), inputIndex(_inputIndex), blockHeight(_blockHeight), satoshis(_satoshis), script(_script) {}
+
+    SERIALIZE_METHODS(CSpentIndexValue, obj) { READWRITE(obj.txid, obj.inputIndex, obj.blockHeight, obj.satoshis, obj.script); }
+
+    bool IsNull() const { return satoshis == -1; }
+};
+
+typedef std::vector<std::pair<COutPoint, CSpentIndexValue>> SpentIndexEntries;
+
+#endif // PIVX_SPENTINDEX_H
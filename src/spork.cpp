@@ -31,16 +31,34 @@ std::map<uint256, CSporkMessage> mapSporks;
 
 CSporkManager::CSporkManager()
 {
+    // The IDs without a spork definition are never published
+    for (auto& value : sporkValues) {
+        value = -1;
+    }
     for (auto& sporkDef : sporkDefs) {
         sporkDefsById.emplace(sporkDef.sporkId, &sporkDef);
         sporkDefsByName.emplace(sporkDef.name, &sporkDef);
     }
+    LOCK(cs);
+    PublishSporkValues();
 }
 
 void CSporkManager::Clear()
 {
+    LOCK(cs);
     strMasterPrivKey = "";
     mapSporksActive.clear();
+    PublishSporkValues();
+}
+
+void CSporkManager::PublishSporkValues()
+{
+    AssertLockHeld(cs);
+    // Each value is written once, with its final value: the lock-free readers never see an intermediate one
+    for (const auto& sporkDef : sporkDefs) {
+        auto it = mapSporksActive.find(sporkDef.sporkId);
+        sporkValues[sporkDef.sporkId - SPORK_ID_MIN] = it != mapSporksActive.end() ? it->second.nValue : sporkDef.defaultValue;
+    }
 }
 
 // PIVX: on startup load spork values from previous session if they exist in the sporkDB
@@ -209,6 +227,7 @@ void CSporkManager::AddOrUpdateSporkMessage(const CSporkMessage& spork, bool flu
         LOCK(cs);
         mapSporks[spork.GetHash()] = spork;
         mapSporksActive[spork.nSporkID] = spork;
+        PublishSporkValues();
     }
     if (flush) {
         // add to spork database.
@@ -225,21 +244,11 @@ bool CSporkManager::IsSporkActive(SporkId nSporkID)
 // grab the value of the spork on the network, or the default
 int64_t CSporkManager::GetSporkValue(SporkId nSporkID)
 {
-    LOCK(cs);
-
-    if (mapSporksActive.count(nSporkID)) {
-        return mapSporksActive[nSporkID].nValue;
-
-    } else {
-        auto it = sporkDefsById.find(nSporkID);
-        if (it != sporkDefsById.end()) {
-            return it->second->defaultValue;
-        } else {
-            LogPrintf("%s : Unknown Spork %d\n", __func__, nSporkID);
-        }
+    const int64_t nValue = nSporkID >= SPORK_ID_MIN && nSporkID <= SPORK_ID_MAX ? sporkValues[nSporkID - SPORK_ID_MIN].load() : -1;
+    if (nValue == -1 && !sporkDefsById.count(nSporkID)) {
+        LogPrintf("%s : Unknown Spork %d\n", __func__, nSporkID);
     }
-
-    return -1;
+    return nValue;
 }
 
 SporkId CSporkManager::GetSporkIDByName(std::string strName)
@@ -17,6 +17,9 @@
 
 #include "protocol.h"
 
+#include <array>
+#include <atomic>
+
 
 class CSporkMessage;
 class CSporkManager;
@@ -76,10 +79,20 @@ private:
     std::map<std::string, CSporkDef*> sporkDefsByName;
     std::map<SporkId, CSporkMessage> mapSporksActive;
 
+    // Values of the sporks indexed by ID (from SPORK_ID_MIN), published when mapSporksActive changes, so that
+    // GetSporkValue/IsSporkActive don't lock cs. -1 for the unknown/deleted sporks.
+    std::array<std::atomic<int64_t>, SPORK_ID_MAX - SPORK_ID_MIN + 1> sporkValues;
+    void PublishSporkValues();
+
 public:
     CSporkManager();
 
-    SERIALIZE_METHODS(CSporkManager, obj) { READWRITE(obj.mapSporksActive); }
+    SERIALIZE_METHODS(CSporkManager, obj)
+    {
+        LOCK(obj.cs);
+        READWRITE(obj.mapSporksActive);
+        SER_READ(obj, obj.PublishSporkValues());
+    }
 
     void Clear();
     void LoadSporksFromDB();
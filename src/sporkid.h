@@ -32,6 +32,10 @@ enum SporkId : int32_t {
     SPORK_INVALID                               = -1
 };
 
+// Range of the spork IDs, to index the spork values
+static const int32_t SPORK_ID_MIN = SPORK_2_SWIFTTX;
+static const int32_t SPORK_ID_MAX = SPORK_23_CHAINLOCKS_ENFORCEMENT;
+
 // Default values
 struct CSporkDef
 {
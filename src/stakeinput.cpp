@@ -38,6 +38,18 @@ CPivStake* CPivStake::NewPivStake(const CTxIn& txin, int nHeight, uint32_t nTime
         return new CPivStake(coin.out, txin.prevout, pindexFrom);
     }
 
+    // Then among the coins spent by the last blocks (stake of a fork block, spent on the active chain after the split)
+    Coin spentCoin;
+    if (GetRecentlySpentCoin(txin.prevout, spentCoin) && (int)spentCoin.nHeight <= chainActive.Height()) {
+        const CBlockIndex* pindexFrom = chainActive[spentCoin.nHeight];
+        // Check that the stake has the required depth/age
+        if (!HasStakeMinAgeOrDepth(nHeight, nTime, pindexFrom)) {
+            return nullptr;
+        }
+        // All good
+        return new CPivStake(spentCoin.out, txin.prevout, pindexFrom);
+    }
+
     // Otherwise find the previous transaction in database
     uint256 hashBlock;
     CTransactionRef txPrev;
@@ -135,7 +135,9 @@ void Arena::free(void *ptr)
 
 Arena::Stats Arena::stats() const
 {
-    Arena::Stats r{ 0, 0, 0, chunks_used.size(), chunks_free.size() };
+    Arena::Stats r{ 0, 0, 0, chunks_used.size(), chunks_free.size(), 0 };
+    if (!size_to_free_chunk.empty())
+        r.largest_free = size_to_free_chunk.rbegin()->first;
     for (const auto& chunk: chunks_used)
         r.used += chunk.second;
     for (const auto& chunk: chunks_free)
@@ -336,7 +338,7 @@ void LockedPool::free(void *ptr)
 LockedPool::Stats LockedPool::stats() const
 {
     std::lock_guard<std::mutex> lock(mutex);
-    LockedPool::Stats r{0, 0, 0, cumulative_bytes_locked, 0, 0};
+    LockedPool::Stats r{0, 0, 0, cumulative_bytes_locked, 0, 0, 0, arenas.size()};
     for (const auto &arena: arenas) {
         Arena::Stats i = arena.stats();
         r.used += i.used;
@@ -344,6 +346,7 @@ LockedPool::Stats LockedPool::stats() const
         r.total += i.total;
         r.chunks_used += i.chunks_used;
         r.chunks_free += i.chunks_free;
+        r.largest_free = std::max(r.largest_free, i.largest_free);
     }
     return r;
 }
@@ -400,6 +403,73 @@ bool LockedPoolManager::LockingFailed()
     return true;
 }
 
+#ifdef HAVE_THREAD_LOCAL
+namespace {
+//! Set once the cache of the thread is destroyed: the chunks freed afterwards go to the pool
+thread_local bool g_chunk_cache_destroyed = false;
+
+/** Free chunks of the small sizes (by multiple of the arena alignment) kept by a thread */
+struct LockedChunkCache
+{
+    static const size_t SIZES = LockedPoolManager::CACHE_MAX_SIZE / LockedPool::ARENA_ALIGN;
+    std::vector<void*> chunks[SIZES];
+    ~LockedChunkCache();
+};
+
+LockedChunkCache::~LockedChunkCache()
+{
+    g_chunk_cache_destroyed = true;
+    for (size_t i = 0; i < SIZES; i++) {
+        LockedPoolManager::Instance().ReleaseCachedChunks(chunks[i], (i + 1) * LockedPool::ARENA_ALIGN);
+    }
+}
+
+thread_local LockedChunkCache g_chunk_cache;
+} // namespace
+#endif
+
+void* LockedPoolManager::AllocCached(size_t size)
+{
+#ifdef HAVE_THREAD_LOCAL
+    if (size > 0 && size <= CACHE_MAX_SIZE && !g_chunk_cache_destroyed) {
+        std::vector<void*>& chunks = g_chunk_cache.chunks[(size - 1) / ARENA_ALIGN];
+        if (!chunks.empty()) {
+            void* ptr = chunks.back();
+            chunks.pop_back();
+            cached_bytes -= ((size - 1) / ARENA_ALIGN + 1) * ARENA_ALIGN;
+            return ptr;
+        }
+        // Allocate the whole size class, so that the chunk can serve any size of it
+        return alloc(((size - 1) / ARENA_ALIGN + 1) * ARENA_ALIGN);
+    }
+#endif
+    return alloc(size);
+}
+
+void LockedPoolManager::FreeCached(void* ptr, size_t size)
+{
+#ifdef HAVE_THREAD_LOCAL
+    if (ptr && size > 0 && size <= CACHE_MAX_SIZE && !g_chunk_cache_destroyed) {
+        std::vector<void*>& chunks = g_chunk_cache.chunks[(size - 1) / ARENA_ALIGN];
+        if (chunks.size() < CACHE_CHUNKS_PER_SIZE) {
+            chunks.push_back(ptr);
+            cached_bytes += ((size - 1) / ARENA_ALIGN + 1) * ARENA_ALIGN;
+            return;
+        }
+    }
+#endif
+    free(ptr);
+}
+
+void LockedPoolManager::ReleaseCachedChunks(std::vector<void*>& chunks, size_t size)
+{
+    for (void* ptr : chunks) {
+        free(ptr);
+    }
+    cached_bytes -= chunks.size() * size;
+    chunks.clear();
+}
+
 void LockedPoolManager::CreateInstance()
 {
     // Using a local static instance guarantees that the object is initialized
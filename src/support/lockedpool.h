@@ -5,6 +5,7 @@
 #ifndef BITCOIN_SUPPORT_LOCKEDPOOL_H
 #define BITCOIN_SUPPORT_LOCKEDPOOL_H
 
+#include <atomic>
 #include <list>
 #include <map>
 #include <memory>
@@ -12,6 +13,7 @@
 #include <stdexcept>
 #include <stdint.h>
 #include <unordered_map>
+#include <vector>
 
 /**
  * OS-dependent allocation and deallocation of locked/pinned memory pages.
@@ -63,6 +65,7 @@ public:
         size_t total;
         size_t chunks_used;
         size_t chunks_free;
+        size_t largest_free;
     };
 
     /** Allocate size bytes from this arena.
@@ -151,6 +154,9 @@ public:
         size_t locked;
         size_t chunks_used;
         size_t chunks_free;
+        /** Largest free chunk: the free bytes left out of it are fragmented */
+        size_t largest_free;
+        size_t arenas;
     };
 
     /** Create a new LockedPool. This takes ownership of the MemoryPageLocker,
@@ -219,6 +225,11 @@ private:
 class LockedPoolManager : public LockedPool
 {
 public:
+    /** Largest allocation served from the per-thread caches */
+    static const size_t CACHE_MAX_SIZE = 256;
+    /** Number of chunks of each size kept by a thread */
+    static const size_t CACHE_CHUNKS_PER_SIZE = 16;
+
     /** Return the current instance, or create it once */
     static LockedPoolManager& Instance()
     {
@@ -226,7 +237,22 @@ public:
         return *LockedPoolManager::_instance;
     }
 
+    /** Allocate size bytes, taking the small sizes from the cache of the calling thread
+     * when it has a chunk of that size, so that they don't wait for the pool mutex.
+     */
+    void* AllocCached(size_t size);
+    /** Free a chunk allocated with AllocCached for size bytes, which must have been cleansed.
+     * The small ones go back to the cache of the calling thread, up to CACHE_CHUNKS_PER_SIZE.
+     */
+    void FreeCached(void* ptr, size_t size);
+    /** Bytes of the chunks held by the thread caches (counted as used by the pool) */
+    size_t CachedBytes() const { return cached_bytes.load(); }
+    /** Give the chunks of size bytes of an exiting thread back to the pool */
+    void ReleaseCachedChunks(std::vector<void*>& chunks, size_t size);
+
 private:
+    std::atomic<size_t> cached_bytes{0};
+
     LockedPoolManager(std::unique_ptr<LockedPageAllocator> allocator);
 
     /** Create a new LockedPoolManager specialized to the OS */
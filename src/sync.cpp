@@ -9,6 +9,8 @@
 #include "utilstrencodings.h"
 #include "util/threadnames.h"
 
+#include <algorithm>
+#include <chrono>
 #include <stdio.h>
 #include <system_error>
 #include <map>
@@ -26,6 +28,103 @@ void PrintLockContention(const char* pszName, const char* pszFile, int nLine)
 }
 #endif /* DEBUG_LOCKCONTENTION */
 
+std::atomic<bool> g_lock_stats{false};
+
+static void UpdateMax(std::atomic<int64_t>& nMax, int64_t n)
+{
+    int64_t nPrev = nMax.load(std::memory_order_relaxed);
+    while (n > nPrev && !nMax.compare_exchange_weak(nPrev, n, std::memory_order_relaxed)) {}
+}
+
+void LockStats::AddLock(bool fContended, int64_t nWait)
+{
+    nLocks.fetch_add(1, std::memory_order_relaxed);
+    if (fContended) {
+        nContentions.fetch_add(1, std::memory_order_relaxed);
+        nWaitTotal.fetch_add(nWait, std::memory_order_relaxed);
+        UpdateMax(nWaitMax, nWait);
+    }
+}
+
+void LockStats::AddHold(int64_t nHold)
+{
+    nHoldTotal.fetch_add(nHold, std::memory_order_relaxed);
+    UpdateMax(nHoldMax, nHold);
+}
+
+namespace {
+struct LockStatsRegistry
+{
+    std::mutex mutex;
+    std::map<std::pair<std::string, std::string>, std::unique_ptr<LockStats>> mapStats;
+};
+LockStatsRegistry& GetLockStatsRegistry()
+{
+    // Never destroyed, as locks can still be taken by the global destructors
+    static LockStatsRegistry* registry = new LockStatsRegistry();
+    return *registry;
+}
+} // namespace
+
+LockStats* GetLockStats(const char* pszName, const char* pszFile)
+{
+    // The sites are looked up by the addresses of their strings first, without the registry mutex
+    static thread_local std::map<std::pair<const char*, const char*>, LockStats*> mapCache;
+    const auto key = std::make_pair(pszName, pszFile);
+    auto it = mapCache.find(key);
+    if (it != mapCache.end()) {
+        return it->second;
+    }
+    LockStatsRegistry& registry = GetLockStatsRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    std::unique_ptr<LockStats>& stats = registry.mapStats[std::make_pair(std::string(pszName), std::string(pszFile))];
+    if (!stats) {
+        stats = std::make_unique<LockStats>();
+    }
+    mapCache.emplace(key, stats.get());
+    return stats.get();
+}
+
+int64_t LockStatsMicros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::vector<LockStatsEntry> GetLockStatsEntries()
+{
+    std::vector<LockStatsEntry> vEntries;
+    LockStatsRegistry& registry = GetLockStatsRegistry();
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (const auto& it : registry.mapStats) {
+            const LockStats& stats = *it.second;
+            vEntries.push_back({it.first.first, it.first.second,
+                                stats.nLocks.load(), stats.nContentions.load(),
+                                stats.nWaitTotal.load(), stats.nWaitMax.load(),
+                                stats.nHoldTotal.load(), stats.nHoldMax.load()});
+        }
+    }
+    std::stable_sort(vEntries.begin(), vEntries.end(), [](const LockStatsEntry& a, const LockStatsEntry& b) {
+        return a.nWaitTotal > b.nWaitTotal;
+    });
+    return vEntries;
+}
+
+void ResetLockStats()
+{
+    LockStatsRegistry& registry = GetLockStatsRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (const auto& it : registry.mapStats) {
+        LockStats& stats = *it.second;
+        stats.nLocks = 0;
+        stats.nContentions = 0;
+        stats.nWaitTotal = 0;
+        stats.nWaitMax = 0;
+        stats.nHoldTotal = 0;
+        stats.nHoldMax = 0;
+    }
+}
+
 #ifdef DEBUG_LOCKORDER
 //
 // Early deadlock detection.
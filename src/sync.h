@@ -10,10 +10,12 @@
 #include "threadsafety.h"
 #include "util/macros.h"
 
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 
 
 /////////////////////////////////////////////////
@@ -118,14 +120,64 @@ typedef AnnotatedMixin<std::mutex> Mutex;
 void PrintLockContention(const char* pszName, const char* pszFile, int nLine);
 #endif
 
+/**
+ * Contention statistics of the locks taken by a site (the name of the mutex in the LOCK macro, and the
+ * file taking it), gathered when enabled by -lockstats. The hold times run from the acquisition to the
+ * release of the lock, including the waits on condition variables in between.
+ */
+struct LockStats
+{
+    std::atomic<uint64_t> nLocks{0};
+    std::atomic<uint64_t> nContentions{0};
+    std::atomic<int64_t> nWaitTotal{0};
+    std::atomic<int64_t> nWaitMax{0};
+    std::atomic<int64_t> nHoldTotal{0};
+    std::atomic<int64_t> nHoldMax{0};
+
+    void AddLock(bool fContended, int64_t nWait);
+    void AddHold(int64_t nHold);
+};
+
+/** Copy of the statistics of a lock site, for the RPC */
+struct LockStatsEntry
+{
+    std::string name;
+    std::string file;
+    uint64_t nLocks;
+    uint64_t nContentions;
+    int64_t nWaitTotal;
+    int64_t nWaitMax;
+    int64_t nHoldTotal;
+    int64_t nHoldMax;
+};
+
+//! Default for -lockstats
+static const bool DEFAULT_LOCK_STATS = false;
+extern std::atomic<bool> g_lock_stats;
+
+/** The statistics of the site, created on first use. The entries are never released */
+LockStats* GetLockStats(const char* pszName, const char* pszFile);
+/** Monotonic time of the lock statistics, in microseconds */
+int64_t LockStatsMicros();
+/** The statistics of all the lock sites, ordered by decreasing total wait time */
+std::vector<LockStatsEntry> GetLockStatsEntries();
+void ResetLockStats();
+
 /** Wrapper around std::unique_lock style lock for Mutex. */
 template <typename Mutex, typename Base = typename Mutex::UniqueLock>
 class SCOPED_LOCKABLE UniqueLock  : public Base
 {
 private:
+    LockStats* m_stats{nullptr};
+    int64_t m_lock_time{0};
+
     void Enter(const char* pszName, const char* pszFile, int nLine)
     {
         EnterCritical(pszName, pszFile, nLine, (void*)(Base::mutex()));
+        if (g_lock_stats.load(std::memory_order_relaxed)) {
+            EnterWithStats(pszName, pszFile, nLine);
+            return;
+        }
 #ifdef DEBUG_LOCKCONTENTION
         if (!Base::try_lock()) {
             PrintLockContention(pszName, pszFile, nLine);
@@ -136,6 +188,29 @@ private:
 #endif
     }
 
+    void EnterWithStats(const char* pszName, const char* pszFile, int nLine)
+    {
+        m_stats = GetLockStats(pszName, pszFile);
+        const int64_t nStart = LockStatsMicros();
+        const bool fContended = !Base::try_lock();
+        if (fContended) {
+#ifdef DEBUG_LOCKCONTENTION
+            PrintLockContention(pszName, pszFile, nLine);
+#endif
+            Base::lock();
+        }
+        m_lock_time = fContended ? LockStatsMicros() : nStart;
+        m_stats->AddLock(fContended, m_lock_time - nStart);
+    }
+
+    void LeaveStats()
+    {
+        if (m_stats) {
+            m_stats->AddHold(LockStatsMicros() - m_lock_time);
+            m_stats = nullptr;
+        }
+    }
+
     bool TryEnter(const char* pszName, const char* pszFile, int nLine)
     {
         EnterCritical(pszName, pszFile, nLine, (void*)(Base::mutex()), true);
@@ -167,8 +242,10 @@ public:
 
     ~UniqueLock() UNLOCK_FUNCTION()
     {
-        if (Base::owns_lock())
+        if (Base::owns_lock()) {
+            LeaveStats();
             LeaveCritical();
+        }
     }
 
     operator bool()
@@ -188,6 +265,7 @@ public:
     public:
         explicit reverse_lock(UniqueLock& _lock, const char* _guardname, const char* _file, int _line) : lock(_lock), file(_file), line(_line) {
             CheckLastCritical((void*)lock.mutex(), lockname, _guardname, _file, _line);
+            lock.LeaveStats();
             lock.unlock();
             LeaveCritical();
             lock.swap(templock);
@@ -32,6 +32,7 @@ struct COrphanTx {
     CTransactionRef tx;
     NodeId fromPeer;
     int64_t nTimeExpire;
+    unsigned int nTxSize;
 };
 extern RecursiveMutex g_cs_orphans;
 extern std::map<uint256, COrphanTx> mapOrphanTransactions GUARDED_BY(g_cs_orphans);
@@ -261,4 +262,47 @@ BOOST_AUTO_TEST_CASE(DoS_mapOrphans)
     BOOST_CHECK(mapOrphanTransactions.empty());
 }
 
+static size_t CountOrphansFrom(NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans)
+{
+    size_t nOrphans = 0;
+    for (const auto& it : mapOrphanTransactions) {
+        nOrphans += it.second.fromPeer == peer;
+    }
+    return nOrphans;
+}
+
+BOOST_AUTO_TEST_CASE(DoS_mapOrphans_peer_quota)
+{
+    // Big orphans, of about 90 kB
+    auto makeBigOrphan = []() {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(InsecureRand256(), 0);
+        tx.vin[0].scriptSig << std::vector<unsigned char>(90000, 0x01);
+        tx.vout.resize(1);
+        tx.vout[0].nValue = 1 * CENT;
+        return MakeTransactionRef(tx);
+    };
+
+    LOCK2(cs_main, g_cs_orphans);
+    // Peer 1 sends a couple of orphans, then peer 0 floods: it can only evict its own orphans
+    BOOST_CHECK(AddOrphanTx(makeBigOrphan(), 1));
+    BOOST_CHECK(AddOrphanTx(makeBigOrphan(), 1));
+    for (int i = 0; i < 30; i++) {
+        BOOST_CHECK(AddOrphanTx(makeBigOrphan(), 0));
+    }
+    BOOST_CHECK_EQUAL(CountOrphansFrom(1), 2);
+    const size_t nOrphansPeer0 = CountOrphansFrom(0);
+    BOOST_CHECK(nOrphansPeer0 > 2 && nOrphansPeer0 <= MAX_ORPHAN_TX_BYTES_PER_PEER / 90000);
+
+    // The global limit evicts the orphans of the peer using the most space first
+    LimitOrphanTxSize(4);
+    BOOST_CHECK_EQUAL(CountOrphansFrom(0), 2);
+    BOOST_CHECK_EQUAL(CountOrphansFrom(1), 2);
+
+    EraseOrphansFor(0);
+    EraseOrphansFor(1);
+    BOOST_CHECK(mapOrphanTransactions.empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
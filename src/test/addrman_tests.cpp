@@ -245,13 +245,59 @@ BOOST_AUTO_TEST_CASE(addrman_select)
     BOOST_CHECK(addrman.size() == 7);
 
     // Test 12: Select pulls from new and tried regardless of port number.
+    // (the only 7777 address has 1/8 chances to be picked by each Select)
     std::set<uint16_t> ports;
-    for (int i = 0; i < 20; ++i) {
+    for (int i = 0; i < 50; ++i) {
         ports.insert(addrman.Select().GetPort());
     }
     BOOST_CHECK_EQUAL(ports.size(), 3);
 }
 
+BOOST_AUTO_TEST_CASE(addrman_select_sparse)
+{
+    CAddrManTest addrman;
+
+    // A single address in each table of thousands of positions is still found at once
+    CService addr1 = ResolveService("250.1.1.1", 8333);
+    CService addr2 = ResolveService("250.2.2.2", 8333);
+    addrman.Add(CAddress(addr1, NODE_NONE), ResolveIP("252.2.2.2"));
+    addrman.Add(CAddress(addr2, NODE_NONE), ResolveIP("252.2.2.2"));
+    addrman.Good(CAddress(addr2, NODE_NONE));
+    std::set<std::string> selected;
+    for (int i = 0; i < 50; ++i) {
+        selected.insert(addrman.Select().ToString());
+        BOOST_CHECK_EQUAL(addrman.Select(true).ToString(), "250.1.1.1:8333");
+    }
+    BOOST_CHECK_EQUAL(selected.size(), 2U);
+
+    // Nothing is left to select once the tables are emptied
+    addrman.Clear();
+    BOOST_CHECK_EQUAL(addrman.Select().ToString(), "[::]:0");
+}
+
+BOOST_AUTO_TEST_CASE(addrman_changes)
+{
+    CAddrManTest addrman;
+    CService addr1 = ResolveService("250.1.1.1", 8333);
+    CNetAddr source = ResolveIP("252.2.2.2");
+
+    // Reads leave the change counter alone, so that unchanged tables aren't written again
+    uint64_t nChanges = addrman.GetChanges();
+    addrman.Select();
+    addrman.GetAddr(/* max_addresses */ 0, /* max_pct */ 0, /* network */ nullopt);
+    BOOST_CHECK_EQUAL(addrman.size(), 0U);
+    BOOST_CHECK_EQUAL(addrman.GetChanges(), nChanges);
+
+    addrman.Add(CAddress(addr1, NODE_NONE), source);
+    BOOST_CHECK(addrman.GetChanges() > nChanges);
+    nChanges = addrman.GetChanges();
+    addrman.Select();
+    BOOST_CHECK_EQUAL(addrman.GetChanges(), nChanges);
+
+    addrman.Good(CAddress(addr1, NODE_NONE));
+    BOOST_CHECK(addrman.GetChanges() > nChanges);
+}
+
 BOOST_AUTO_TEST_CASE(addrman_new_collisions)
 {
     CAddrManTest addrman;
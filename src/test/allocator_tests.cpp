@@ -4,9 +4,12 @@
 
 #include "util/system.h"
 
+#include "support/allocators/pool.h"
 #include "support/allocators/zeroafterfree.h"
 #include "test/test_pivx.h"
 
+#include <thread>
+
 #include <boost/test/unit_test.hpp>
 
 BOOST_FIXTURE_TEST_SUITE(allocator_tests, BasicTestingSetup)
@@ -231,4 +234,92 @@ BOOST_AUTO_TEST_CASE(lockedpool_tests_live)
     BOOST_CHECK(pool.stats().used == initial.used);
 }
 
+#ifdef HAVE_THREAD_LOCAL
+BOOST_AUTO_TEST_CASE(lockedpool_cache_live)
+{
+    LockedPoolManager &pool = LockedPoolManager::Instance();
+    const size_t nCachedBefore = pool.CachedBytes();
+
+    // A freed small chunk is kept by the thread for the next allocation of its size class
+    void *a0 = pool.AllocCached(20);
+    BOOST_CHECK(a0);
+    pool.FreeCached(a0, 20);
+    BOOST_CHECK_EQUAL(pool.CachedBytes(), nCachedBefore + 32);
+    void *a1 = pool.AllocCached(32);
+    BOOST_CHECK(a1 == a0);
+    BOOST_CHECK_EQUAL(pool.CachedBytes(), nCachedBefore);
+    pool.FreeCached(a1, 32);
+
+    // The large ones go back to the pool
+    void *a2 = pool.AllocCached(LockedPoolManager::CACHE_MAX_SIZE + 1);
+    BOOST_CHECK(a2);
+    pool.FreeCached(a2, LockedPoolManager::CACHE_MAX_SIZE + 1);
+    BOOST_CHECK_EQUAL(pool.CachedBytes(), nCachedBefore + 32);
+
+    // The cache of a thread is released when it exits
+    std::thread thread([&pool]() {
+        void *p = pool.AllocCached(64);
+        pool.FreeCached(p, 64);
+    });
+    thread.join();
+    BOOST_CHECK_EQUAL(pool.CachedBytes(), nCachedBefore + 32);
+
+    LockedPool::Stats stats = pool.stats();
+    BOOST_CHECK(stats.arenas >= 1);
+    BOOST_CHECK(stats.largest_free <= stats.free);
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(pool_resource_tests)
+{
+    typedef PoolResource<128, 8> Resource;
+    Resource resource(1024);
+    BOOST_CHECK_EQUAL(resource.ChunkSizeBytes(), 1024U);
+    BOOST_CHECK(Resource::IsFreeListUsable(128, 8));
+    BOOST_CHECK(!Resource::IsFreeListUsable(129, 8));
+    BOOST_CHECK(!Resource::IsFreeListUsable(8, 16));
+
+    // The blocks are carved out of the chunks, rounded to the alignment
+    std::vector<char*> blocks;
+    for (int i = 0; i < 128; i++) {
+        char* p = static_cast<char*>(resource.Allocate(7, 8));
+        BOOST_CHECK_EQUAL((uintptr_t)p % 8, 0U);
+        memset(p, 0xAA, 7);
+        blocks.push_back(p);
+    }
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+    BOOST_CHECK(resource.Allocate(8, 8) != nullptr);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 2U);
+
+    // The freed blocks are reused, for the same size only
+    resource.Deallocate(blocks[5], 7, 8);
+    BOOST_CHECK(resource.Allocate(16, 8) != blocks[5]);
+    BOOST_CHECK(resource.Allocate(8, 8) == blocks[5]);
+
+    // The big blocks are not pooled
+    void* big = resource.Allocate(4096, 8);
+    memset(big, 0xAA, 4096);
+    resource.Deallocate(big, 4096, 8);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 2U);
+
+    // A pool allocated map
+    typedef PoolAllocator<std::pair<const int, int>, sizeof(std::pair<const int, int>) + 4 * sizeof(void*)> Allocator;
+    Allocator::ResourceType mapResource;
+    std::unordered_map<int, int, std::hash<int>, std::equal_to<int>, Allocator> map(0, std::hash<int>(), std::equal_to<int>(), &mapResource);
+    for (int i = 0; i < 10000; i++) {
+        map[i] = i;
+    }
+    for (int i = 0; i < 10000; i += 2) {
+        map.erase(i);
+    }
+    const size_t nChunks = mapResource.NumAllocatedChunks();
+    for (int i = 0; i < 10000; i += 2) {
+        map[i] = i;
+    }
+    BOOST_CHECK_EQUAL(mapResource.NumAllocatedChunks(), nChunks);
+    for (int i = 0; i < 10000; i++) {
+        BOOST_CHECK_EQUAL(map.at(i), i);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,150 @@
+// Copyright (c) 2011-2021 The Bitcoin Core developers
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "test/test_pivx.h"
+
+#include "blockencodings.h"
+#include "consensus/merkle.h"
+#include "random.h"
+#include "streams.h"
+#include "txmempool.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockencodings_tests, BasicTestingSetup)
+
+static CMutableTransaction CreateTx(const uint256& prevHash, CAmount nValue)
+{
+    CMutableTransaction tx;
+    tx.vin.emplace_back(COutPoint(prevHash, 0));
+    tx.vin[0].scriptSig.resize(10);
+    tx.vout.emplace_back(nValue, CScript() << OP_TRUE);
+    return tx;
+}
+
+// Coinbase, (optional) coinstake and three txes, the second one spending the first one
+static CBlock BuildBlock(bool fProofOfStake)
+{
+    CBlock block;
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].scriptSig.resize(10);
+    coinbase.vout.emplace_back(42, CScript() << OP_TRUE);
+    block.vtx.emplace_back(MakeTransactionRef(coinbase));
+    if (fProofOfStake) {
+        CMutableTransaction coinstake = CreateTx(InsecureRand256(), 0);
+        coinstake.vout[0].SetEmpty();
+        coinstake.vout.emplace_back(42, CScript() << OP_TRUE);
+        block.vtx.emplace_back(MakeTransactionRef(coinstake));
+        block.vchBlockSig = {0x01, 0x02, 0x03};
+    }
+
+    const CTransactionRef& tx1 = MakeTransactionRef(CreateTx(InsecureRand256(), 10));
+    block.vtx.emplace_back(tx1);
+    block.vtx.emplace_back(MakeTransactionRef(CreateTx(tx1->GetHash(), 9)));
+    block.vtx.emplace_back(MakeTransactionRef(CreateTx(InsecureRand256(), 8)));
+
+    block.nVersion = 10;
+    block.hashPrevBlock = InsecureRand256();
+    block.nBits = 0x207fffff;
+    block.hashMerkleRoot = BlockMerkleRoot(block);
+    return block;
+}
+
+static CBlockHeaderAndShortTxIDs RoundTrip(const CBlockHeaderAndShortTxIDs& cmpctblock)
+{
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << cmpctblock;
+    CBlockHeaderAndShortTxIDs ret;
+    stream >> ret;
+    return ret;
+}
+
+BOOST_AUTO_TEST_CASE(reconstruct_from_mempool)
+{
+    for (bool fProofOfStake : {false, true}) {
+        CTxMemPool pool(CFeeRate(0));
+        TestMemPoolEntryHelper entry;
+        const CBlock& block = BuildBlock(fProofOfStake);
+        const size_t nPrefilled = fProofOfStake ? 2 : 1;
+        BOOST_CHECK_EQUAL(block.IsProofOfStake(), fProofOfStake);
+
+        // The first and the last tx of the block are in the mempool
+        {
+            LOCK(pool.cs);
+            pool.addUnchecked(block.vtx[nPrefilled]->GetHash(), entry.FromTx(*block.vtx[nPrefilled]));
+            pool.addUnchecked(block.vtx.back()->GetHash(), entry.FromTx(*block.vtx.back()));
+        }
+
+        const CBlockHeaderAndShortTxIDs& cmpctblock = RoundTrip(CBlockHeaderAndShortTxIDs(block));
+        BOOST_CHECK_EQUAL(cmpctblock.BlockTxCount(), block.vtx.size());
+        BOOST_CHECK(cmpctblock.vchBlockSig == block.vchBlockSig);
+
+        // The header block, checked before the reconstruction, carries the work and the stake
+        const CBlock& headerBlock = cmpctblock.GetHeaderBlock();
+        BOOST_CHECK_EQUAL(headerBlock.GetHash(), block.GetHash());
+        BOOST_CHECK_EQUAL(headerBlock.vtx.size(), nPrefilled);
+        BOOST_CHECK_EQUAL(headerBlock.IsProofOfStake(), fProofOfStake);
+        BOOST_CHECK(headerBlock.vchBlockSig == block.vchBlockSig);
+
+        PartiallyDownloadedBlock partialBlock(&pool);
+        BOOST_CHECK(partialBlock.InitData(cmpctblock) == READ_STATUS_OK);
+        // coinbase and coinstake are prefilled, only the middle tx is missing
+        for (size_t i = 0; i < block.vtx.size(); i++) {
+            BOOST_CHECK_EQUAL(partialBlock.IsTxAvailable(i), i != nPrefilled + 1);
+        }
+
+        // Request and receive the missing tx
+        BlockTransactionsRequest req;
+        req.blockhash = cmpctblock.header.GetHash();
+        req.indexes.push_back(nPrefilled + 1);
+        CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+        stream << req;
+        BlockTransactionsRequest req2;
+        stream >> req2;
+        BOOST_CHECK(req2.indexes == req.indexes);
+
+        BlockTransactions resp(req2);
+        resp.txn[0] = block.vtx[req2.indexes[0]];
+
+        // A wrong transaction is detected by the merkle root
+        PartiallyDownloadedBlock partialBlockCopy(partialBlock);
+        CBlock wrongBlock;
+        BOOST_CHECK(partialBlockCopy.FillBlock(wrongBlock, {block.vtx.back()}) == READ_STATUS_FAILED);
+
+        CBlock reconstructed;
+        BOOST_CHECK(partialBlock.FillBlock(reconstructed, resp.txn) == READ_STATUS_OK);
+        BOOST_CHECK_EQUAL(reconstructed.GetHash(), block.GetHash());
+        BOOST_CHECK_EQUAL(reconstructed.IsProofOfStake(), fProofOfStake);
+        BOOST_CHECK(reconstructed.vchBlockSig == block.vchBlockSig);
+        BOOST_CHECK_EQUAL(BlockMerkleRoot(reconstructed), block.hashMerkleRoot);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(invalid_compact_blocks)
+{
+    CTxMemPool pool(CFeeRate(0));
+    const CBlock& block = BuildBlock(true);
+
+    // Empty compact block
+    {
+        CBlockHeaderAndShortTxIDs cmpctblock;
+        cmpctblock.header = block.GetBlockHeader();
+        PartiallyDownloadedBlock partialBlock(&pool);
+        BOOST_CHECK(partialBlock.InitData(RoundTrip(cmpctblock)) == READ_STATUS_INVALID);
+    }
+
+    // All the txes are given: too many missing txes
+    {
+        PartiallyDownloadedBlock partialBlock(&pool);
+        BOOST_CHECK(partialBlock.InitData(RoundTrip(CBlockHeaderAndShortTxIDs(block))) == READ_STATUS_OK);
+        std::vector<CTransactionRef> vtx(block.vtx.begin() + 2, block.vtx.end());
+        vtx.emplace_back(block.vtx[0]);
+        CBlock reconstructed;
+        BOOST_CHECK(partialBlock.FillBlock(reconstructed, vtx) == READ_STATUS_INVALID);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -7,6 +7,7 @@
 #include "bls/bls_wrapper.h"
 #include "budget/budgetmanager.h"
 #include "masternode-payments.h"
+#include "net_processing.h"
 #include "spork.h"
 #include "test/util/blocksutil.h"
 #include "tiertwo/tiertwo_sync_state.h"
@@ -525,4 +526,139 @@ BOOST_AUTO_TEST_CASE(fbv_signverify_bls)
     BOOST_CHECK(!vote3_3.CheckSignature(sk1.GetPublicKey()));
 }
 
+// A finalized budget vote of a random voter at nTime, signed with a deterministic (or a legacy) masternode key,
+// or with another key if fBadSig
+static CFinalizedBudgetVote SignedBudgetVote(const uint256& budgetHash, int64_t nTime, bool fDeterministic, bool fBadSig,
+                                             CBudgetManager::VoteSigner& signerRet, const CTxIn& vin = CTxIn(COutPoint(GetRandHash(), 0)))
+{
+    CFinalizedBudgetVote vote(vin, budgetHash);
+    vote.SetTime(nTime);
+    signerRet.fDeterministic = fDeterministic;
+    signerRet.strName = vin.prevout.ToString();
+    if (fDeterministic) {
+        CBLSSecretKey sk, otherSk;
+        sk.MakeNewKey();
+        otherSk.MakeNewKey();
+        BOOST_CHECK(vote.Sign(fBadSig ? otherSk : sk));
+        signerRet.pubKey = sk.GetPublicKey();
+    } else {
+        CKey key, otherKey;
+        key.MakeNewKey(true);
+        otherKey.MakeNewKey(true);
+        const CKey& signKey = fBadSig ? otherKey : key;
+        BOOST_CHECK(vote.Sign(signKey, signKey.GetPubKey().GetID()));
+        signerRet.keyID = key.GetPubKey().GetID();
+    }
+    return vote;
+}
+
+static std::vector<uint256> GetBudgetVotes(const uint256& budgetHash)
+{
+    CFinalizedBudget fb;
+    BOOST_CHECK(g_budgetman.GetFinalizedBudget(budgetHash, fb));
+    std::vector<uint256> vHashes = fb.GetVotesHashes();
+    std::sort(vHashes.begin(), vHashes.end());
+    return vHashes;
+}
+
+static bool HasBudgetVote(const uint256& budgetHash, const CFinalizedBudgetVote& vote)
+{
+    const std::vector<uint256>& vHashes = GetBudgetVotes(budgetHash);
+    return std::binary_search(vHashes.begin(), vHashes.end(), vote.GetHash());
+}
+
+static int GetMisbehavior(NodeId nodeId)
+{
+    CNodeStateStats stats;
+    BOOST_CHECK(GetNodeStateStats(nodeId, stats));
+    return stats.nMisbehavior;
+}
+
+BOOST_FIXTURE_TEST_CASE(budget_votes_verifier_test, TestingSetup)
+{
+    CAddress addr1(CService(CNetAddr(in_addr{0x0200a8c0}), Params().GetDefaultPort()), NODE_NONE);
+    CAddress addr2(CService(CNetAddr(in_addr{0x0300a8c0}), Params().GetDefaultPort()), NODE_NONE);
+    CNode node1(0, NODE_NETWORK, 0, INVALID_SOCKET, addr1, 0, 0, "", true);
+    CNode node2(1, NODE_NETWORK, 0, INVALID_SOCKET, addr2, 1, 1, "", true);
+    peerLogic->InitializeNode(&node1);
+    peerLogic->InitializeNode(&node2);
+
+    CFinalizedBudget fin("main (test)", 144, {CTxBudgetPayment(GetRandHash(), GetScriptForDestination(CKeyID(uint160(InsecureRandBytes(20)))), 10 * COIN)}, GetRandHash());
+    const uint256& budgetHash = fin.GetHash();
+    g_budgetman.ForceAddFinalizedBudget(budgetHash, fin.GetFeeTXHash(), fin);
+    const int64_t nTime = GetTime();
+
+    // Not running: the votes are verified in place
+    CBudgetManager::VoteSigner signer;
+    BOOST_CHECK(!g_budgetman.QueueVoteVerification(SignedBudgetVote(budgetHash, nTime, true, false, signer), &node1, signer));
+
+    StartBudgetVotesVerification(3);
+
+    // 1) A batch with a bad BLS signature fails: the peers of the batch are checked one by one,
+    // only the bad vote is rejected and only its source punished
+    std::vector<CFinalizedBudgetVote> vGood;
+    CFinalizedBudgetVote badVote;
+    for (int i = 0; i < 12; i++) {
+        const bool fBad = i == 7;
+        // node2 sends the bad vote, and some valid ones
+        CNode& node = (i % 3 == 0) ? node2 : node1;
+        // some legacy votes, checked on the pool meanwhile
+        const bool fDeterministic = fBad || i % 4 != 1;
+        const CFinalizedBudgetVote& vote = SignedBudgetVote(budgetHash, nTime, fDeterministic, fBad, signer);
+        if (fBad) {
+            badVote = vote;
+        } else {
+            vGood.emplace_back(vote);
+        }
+        BOOST_CHECK(g_budgetman.QueueVoteVerification(vote, fBad ? &node2 : &node, signer));
+    }
+    SyncWithBudgetVotesVerification();
+    for (const CFinalizedBudgetVote& vote : vGood) {
+        BOOST_CHECK(HasBudgetVote(budgetHash, vote));
+    }
+    BOOST_CHECK(!HasBudgetVote(budgetHash, badVote));
+    BOOST_CHECK_EQUAL(GetMisbehavior(node1.GetId()), 0);
+    // An invalid signature of a deterministic masternode
+    BOOST_CHECK_EQUAL(GetMisbehavior(node2.GetId()), 100);
+
+    // 2) A batch of valid votes only
+    const size_t nVotes = GetBudgetVotes(budgetHash).size();
+    vGood.clear();
+    for (int i = 0; i < 10; i++) {
+        vGood.emplace_back(SignedBudgetVote(budgetHash, nTime, true, false, signer));
+        BOOST_CHECK(g_budgetman.QueueVoteVerification(vGood.back(), &node1, signer));
+    }
+    SyncWithBudgetVotesVerification();
+    BOOST_CHECK_EQUAL(GetBudgetVotes(budgetHash).size(), nVotes + vGood.size());
+    BOOST_CHECK_EQUAL(GetMisbehavior(node1.GetId()), 0);
+
+    // 3) The votes are applied in the order they were received: the second vote of a voter, queued
+    // in the same batch, is too close to the first one and rejected (and the first one would be rejected,
+    // as older, if they were swapped)
+    const CTxIn voterVin(COutPoint(GetRandHash(), 0));
+    CBudgetManager::VoteSigner signer1, signer2;
+    const CFinalizedBudgetVote& vote1 = SignedBudgetVote(budgetHash, nTime, true, false, signer1, voterVin);
+    const CFinalizedBudgetVote& vote2 = SignedBudgetVote(budgetHash, nTime + 10, true, false, signer2, voterVin);
+    BOOST_CHECK(g_budgetman.QueueVoteVerification(vote1, &node1, signer1));
+    BOOST_CHECK(g_budgetman.QueueVoteVerification(vote2, &node1, signer2));
+    SyncWithBudgetVotesVerification();
+    BOOST_CHECK(HasBudgetVote(budgetHash, vote1));
+    BOOST_CHECK(!HasBudgetVote(budgetHash, vote2));
+    // A vote of the same voter BUDGET_VOTE_UPDATE_MIN later replaces it
+    const CFinalizedBudgetVote& vote3 = SignedBudgetVote(budgetHash, nTime + BUDGET_VOTE_UPDATE_MIN, true, false, signer2, voterVin);
+    BOOST_CHECK(g_budgetman.QueueVoteVerification(vote3, &node1, signer2));
+    SyncWithBudgetVotesVerification();
+    BOOST_CHECK(!HasBudgetVote(budgetHash, vote1));
+    BOOST_CHECK(HasBudgetVote(budgetHash, vote3));
+    BOOST_CHECK_EQUAL(GetMisbehavior(node1.GetId()), 0);
+
+    StopBudgetVotesVerification();
+    BOOST_CHECK(!g_budgetman.QueueVoteVerification(SignedBudgetVote(budgetHash, nTime, true, false, signer), &node1, signer));
+
+    bool fUpdateConnectionTime = false;
+    peerLogic->FinalizeNode(node1.GetId(), fUpdateConnectionTime);
+    peerLogic->FinalizeNode(node2.GetId(), fUpdateConnectionTime);
+    g_budgetman.Clear();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
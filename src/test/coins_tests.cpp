@@ -7,6 +7,7 @@
 
 #include "coins.h"
 #include "script/standard.h"
+#include "txdb.h"
 #include "uint256.h"
 #include "undo.h"
 #include "utilstrencodings.h"
@@ -501,6 +502,31 @@ BOOST_AUTO_TEST_CASE(nullifiers_test)
     checkNullifierCache(cache3, txWithNullifiers, false);
 }
 
+BOOST_AUTO_TEST_CASE(nullifiers_batch_test)
+{
+    CCoinsViewTest base;
+    TxWithNullifiers spentInBase, spentInCache, unspent;
+    {
+        CCoinsViewCache cache(&base);
+        cache.SetNullifiers(*spentInBase.tx, true);
+        cache.Flush();
+    }
+
+    CCoinsViewCache cache(&base);
+    cache.SetNullifiers(*spentInCache.tx, true);
+    const std::vector<uint256> vNullifiers = {unspent.saplingNullifier, spentInBase.saplingNullifier,
+                                              spentInCache.saplingNullifier, spentInBase.saplingNullifier};
+    std::vector<bool> vSpent;
+    cache.GetNullifiers(vNullifiers, vSpent);
+    BOOST_CHECK(vSpent == std::vector<bool>({false, true, true, true}));
+
+    // The nullifiers looked up in the base are now cached
+    CCoinsViewCache cache2(&cache);
+    cache2.GetNullifiers(vNullifiers, vSpent);
+    BOOST_CHECK(vSpent == std::vector<bool>({false, true, true, true}));
+    BOOST_CHECK(cache.HaveShieldedRequirements(*spentInBase.tx) == false);
+}
+
 template<typename Tree> void anchorsFlushImpl()
 {
     CCoinsViewTest base;
@@ -1056,7 +1082,8 @@ void GetCoinsMapEntry(const CCoinsMap& map, CAmount& value, char& flags)
 
 void WriteCoinsViewEntry(CCoinsView& view, CAmount value, char flags)
 {
-    CCoinsMap map;
+    CCoinsMapMemoryResource resource;
+    CCoinsMap map(0, SaltedOutpointHasher(), CCoinsMap::key_equal(), &resource);
     InsertCoinsMapEntry(map, value, flags);
     CAnchorsSaplingMap mapSaplingAnchors;
     CNullifiersMap mapSaplingNullifiers;
@@ -1320,4 +1347,209 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+BOOST_AUTO_TEST_CASE(ccoins_cache_pool)
+{
+    CCoinsView root;
+    CCoinsViewCacheTest base{&root};
+    CCoinsViewCacheTest cache{&base};
+    const size_t nEmptyUsage = cache.DynamicMemoryUsage();
+
+    for (int i = 0; i < 100000; i++) {
+        Coin coin;
+        coin.out.nValue = InsecureRand32();
+        cache.AddCoin(COutPoint(InsecureRand256(), i), std::move(coin), false);
+    }
+    cache.SelfTest();
+
+    // The nodes cost less than when they were allocated one by one
+    const CCoinsMap& map = cache.map();
+    const size_t nMapUsage = memusage::DynamicUsage(map);
+    BOOST_CHECK(nMapUsage < memusage::MallocUsage(sizeof(memusage::unordered_node<CCoinsMap::value_type>)) * map.size() +
+                            memusage::MallocUsage(sizeof(void*) * map.bucket_count()));
+
+    // The uncached coins are given back to the pool, which keeps its chunks
+    std::vector<COutPoint> vOutpoints;
+    for (auto& entry : cache.map()) {
+        entry.second.flags = 0;
+        vOutpoints.push_back(entry.first);
+    }
+    for (size_t i = 0; i < vOutpoints.size() / 2; i++) {
+        cache.Uncache(vOutpoints[i]);
+    }
+    cache.SelfTest();
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), vOutpoints.size() - vOutpoints.size() / 2);
+    BOOST_CHECK_EQUAL(memusage::DynamicUsage(map), nMapUsage);
+
+    // The chunks are freed on flush
+    BOOST_CHECK(cache.Flush());
+    cache.SelfTest();
+    BOOST_CHECK_EQUAL(cache.DynamicMemoryUsage(), nEmptyUsage);
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_snapshot)
+{
+    CCoinsView root;
+    CCoinsViewCacheTest base{&root};
+    CCoinsViewCacheTest cache{&base};
+    const uint256 hashBlock = InsecureRand256();
+    base.SetBestBlock(InsecureRand256());
+    cache.SetBestBlock(hashBlock);
+
+    // A coin is spent and a new one is added on top of the base
+    const COutPoint spent(InsecureRand256(), 0), added(InsecureRand256(), 1);
+    Coin coin;
+    coin.out.nValue = 10;
+    base.AddCoin(spent, Coin(coin), false);
+    cache.SpendCoin(spent);
+    cache.AddCoin(added, Coin(coin), false);
+
+    std::unique_ptr<CCoinsViewSnapshot> snapshot = cache.TakeSnapshot();
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+    BOOST_CHECK(snapshot->GetBackend() == &base);
+    BOOST_CHECK_EQUAL(snapshot->GetCoins().size(), 2U);
+    BOOST_CHECK(snapshot->GetBestBlock() == hashBlock);
+
+    // The cache reads through the snapshot, which hides the spent coin of the base
+    BOOST_CHECK(base.HaveCoin(spent));
+    BOOST_CHECK(!snapshot->HaveCoin(spent));
+    BOOST_CHECK(!cache.HaveCoin(spent));
+    BOOST_CHECK(cache.HaveCoin(added));
+    BOOST_CHECK(cache.GetBestBlock() == hashBlock);
+
+    cache.SpendCoin(added);
+
+    {
+        // The snapshot can't be written to
+        CCoinsMapMemoryResource resource;
+        CCoinsMap mapCoins{0, SaltedOutpointHasher(), CCoinsMap::key_equal(), &resource};
+        CAnchorsSaplingMap mapSaplingAnchors(snapshot->GetSaplingAnchors());
+        CNullifiersMap mapSaplingNullifiers(snapshot->GetSaplingNullifiers());
+        BOOST_CHECK(!snapshot->BatchWrite(mapCoins, hashBlock, snapshot->GetBestAnchor(), mapSaplingAnchors, mapSaplingNullifiers));
+
+        // Once the snapshot is written, the base takes its place
+        mapCoins.insert(snapshot->GetCoins().begin(), snapshot->GetCoins().end());
+        BOOST_CHECK(base.BatchWrite(mapCoins, snapshot->GetBestBlock(), snapshot->GetBestAnchor(), mapSaplingAnchors, mapSaplingNullifiers));
+    }
+    cache.SetBackend(*snapshot->GetBackend());
+    snapshot.reset();
+    BOOST_CHECK(!base.HaveCoin(spent));
+    BOOST_CHECK(base.HaveCoin(added));
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK(!base.HaveCoin(added));
+    BOOST_CHECK(base.GetBestBlock() == hashBlock);
+    base.SelfTest();
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_range_cursors)
+{
+    CCoinsViewDB db(1 << 20, true);
+    std::set<COutPoint> setCoins;
+    {
+        CCoinsViewCache cache(&db);
+        cache.SetBestBlock(InsecureRand256());
+        for (int i = 0; i < 500; i++) {
+            const COutPoint outpoint(InsecureRand256(), InsecureRandRange(3));
+            Coin coin;
+            coin.out.nValue = 1 + InsecureRandRange(1000);
+            cache.AddCoin(outpoint, std::move(coin), true);
+            setCoins.insert(outpoint);
+        }
+        BOOST_CHECK(cache.Flush());
+    }
+    const uint256 hashBlock = db.GetBestBlock();
+
+    std::vector<std::unique_ptr<CCoinsViewCursor>> cursors = db.RangeCursors(7);
+    BOOST_CHECK_EQUAL(cursors.size(), 7U);
+
+    // Written after the snapshot of the cursors, so not seen by them
+    {
+        CCoinsViewCache cache(&db);
+        cache.SetBestBlock(InsecureRand256());
+        Coin coin;
+        coin.out.nValue = 1;
+        cache.AddCoin(COutPoint(InsecureRand256(), 0), std::move(coin), false);
+        BOOST_CHECK(cache.Flush());
+    }
+
+    // The ranges are disjoint, ordered, and cover all the coins
+    std::set<COutPoint> setSeen;
+    int nPrevByte = -1;
+    for (size_t i = 0; i < cursors.size(); i++) {
+        BOOST_CHECK(cursors[i]->GetBestBlock() == hashBlock);
+        for (; cursors[i]->Valid(); cursors[i]->Next()) {
+            COutPoint outpoint;
+            BOOST_CHECK(cursors[i]->GetKey(outpoint));
+            BOOST_CHECK(*outpoint.hash.begin() >= nPrevByte);
+            BOOST_CHECK(*outpoint.hash.begin() < (i + 1) * 256 / cursors.size());
+            BOOST_CHECK(setSeen.insert(outpoint).second);
+            nPrevByte = *outpoint.hash.begin();
+        }
+    }
+    BOOST_CHECK(setSeen == setCoins);
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_cache_coin)
+{
+    CCoinsView root;
+    CCoinsViewCacheTest base{&root};
+    CCoinsViewCacheTest cache{&base};
+    base.SetBestBlock(InsecureRand256());
+
+    Coin coin;
+    coin.out.nValue = 10;
+    coin.out.scriptPubKey = CScript() << OP_TRUE;
+    const COutPoint prefetched(InsecureRand256(), 0), spent(InsecureRand256(), 1);
+    base.AddCoin(prefetched, Coin(coin), false);
+    base.AddCoin(spent, Coin(coin), false);
+
+    // A prefetched coin is cached as if it was fetched from the base
+    cache.CacheCoin(prefetched, Coin(coin));
+    BOOST_CHECK(cache.HaveCoinInCache(prefetched));
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 1U);
+    BOOST_CHECK_EQUAL(cache.usage(), coin.DynamicMemoryUsage());
+    cache.SelfTest();
+    cache.Uncache(prefetched);
+    BOOST_CHECK(!cache.HaveCoinInCache(prefetched));
+
+    // It doesn't replace a coin spent in the cache in the meantime
+    cache.SpendCoin(spent);
+    cache.CacheCoin(spent, Coin(coin));
+    BOOST_CHECK(!cache.HaveCoin(spent));
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK(!base.HaveCoin(spent));
+    cache.SelfTest();
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_value_delta)
+{
+    CCoinsView root;
+    CCoinsViewCacheTest base{&root};
+    base.SetBestBlock(InsecureRand256());
+
+    Coin coin;
+    coin.out.nValue = 10;
+    coin.out.scriptPubKey = CScript() << OP_TRUE;
+    const COutPoint a(InsecureRand256(), 0), b(InsecureRand256(), 1);
+    base.AddCoin(a, Coin(coin), false);
+    BOOST_CHECK_EQUAL(base.GetValueDelta(), 10);
+
+    // The spends of the coins of the base, the overwrites and the unspendable outputs
+    CCoinsViewCacheTest cache{&base};
+    cache.SpendCoin(a);
+    cache.SpendCoin(a);
+    BOOST_CHECK_EQUAL(cache.GetValueDelta(), -10);
+    coin.out.nValue = 7;
+    cache.AddCoin(b, Coin(coin), false);
+    coin.out.nValue = 5;
+    cache.AddCoin(b, Coin(coin), true);
+    BOOST_CHECK_EQUAL(cache.GetValueDelta(), -5);
+    coin.out.scriptPubKey = CScript() << OP_RETURN;
+    cache.AddCoin(COutPoint(InsecureRand256(), 0), Coin(coin), false);
+    BOOST_CHECK_EQUAL(cache.GetValueDelta(), -5);
+
+    // Flushing doesn't change the delta of the base
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK_EQUAL(base.GetValueDelta(), 10);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
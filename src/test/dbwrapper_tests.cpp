@@ -4,6 +4,7 @@
 
 #include "clientversion.h"
 #include "dbwrapper.h"
+#include "evo/evodb.h"
 #include "uint256.h"
 #include "random.h"
 #include "test/test_pivx.h"
@@ -186,6 +187,34 @@ BOOST_AUTO_TEST_CASE(dbwrapper_iterator)
     }
 }
 
+BOOST_AUTO_TEST_CASE(dbwrapper_stats)
+{
+    fs::path ph = SetDataDir(std::string("dbwrapper_stats"));
+    const DBTuning tuning{80, 10, 0};
+    const size_t nCacheSize = 1 << 20;
+    CDBWrapper dbw(ph, nCacheSize, false, true, CLIENT_VERSION, tuning);
+
+    for (uint32_t i = 0; i < 1000; i++) {
+        BOOST_CHECK(dbw.Write(i, InsecureRand256()));
+    }
+    dbw.CompactFull();
+
+    DBWrapperStats stats = dbw.GetStats();
+    BOOST_CHECK_EQUAL(stats.nBlockCacheSize, nCacheSize / 100 * 80);
+    BOOST_CHECK_EQUAL(stats.nWriteBufferSize, nCacheSize / 100 * 10);
+    BOOST_CHECK_EQUAL(stats.nBloomBitsPerKey, 0);
+    BOOST_CHECK(stats.nApproximateSize > 0);
+    BOOST_CHECK(stats.nMemoryUsage > 0);
+    BOOST_CHECK_EQUAL(stats.vFilesPerLevel.size(), 7U);
+    BOOST_CHECK(!stats.strStats.empty());
+
+    // Listed with the open databases
+    std::vector<DBWrapperStats> vStats = GetDBWrapperStats();
+    BOOST_CHECK(std::count_if(vStats.begin(), vStats.end(), [&stats](const DBWrapperStats& s) {
+        return s.strName == stats.strName;
+    }) == 1);
+}
+
 BOOST_AUTO_TEST_CASE(iterator_ordering)
 {
     fs::path ph = SetDataDir(std::string("iterator_ordering"));
@@ -313,6 +342,53 @@ BOOST_AUTO_TEST_CASE(iterator_string_ordering)
     }
 }
 
+BOOST_AUTO_TEST_CASE(evodb_background_commit)
+{
+    CEvoDB evodb(1 << 20, true, true);
+    const uint256 in1 = InsecureRand256();
+    const uint256 in2 = InsecureRand256();
+    uint256 res;
+    {
+        auto dbTx = evodb.BeginTransaction();
+        evodb.Write('a', in1);
+        evodb.Write('b', in1);
+        dbTx->Commit();
+    }
+    BOOST_CHECK(evodb.CommitRootTransaction());
 
+    // A transaction on top of the one being written
+    {
+        auto dbTx = evodb.BeginTransaction();
+        evodb.Write('a', in2);
+        evodb.Erase('b');
+        evodb.Write('c', in2);
+        dbTx->Commit();
+    }
+    evodb.BeginBackgroundCommit();
+    {
+        auto dbTx = evodb.BeginTransaction();
+        evodb.Write('d', in1);
+        dbTx->Commit();
+    }
+    BOOST_CHECK(evodb.Read('a', res) && res == in2);
+    BOOST_CHECK(!evodb.Exists('b'));
+    BOOST_CHECK(evodb.GetRawDB().Read('a', res) && res == in1);
+
+    BOOST_CHECK(evodb.WriteBackgroundCommit());
+    BOOST_CHECK(evodb.GetRawDB().Read('a', res) && res == in2);
+    BOOST_CHECK(!evodb.GetRawDB().Exists('b'));
+    BOOST_CHECK(evodb.GetRawDB().Read('c', res) && res == in2);
+    // Still readable from the flushing transaction, until the end of the commit
+    BOOST_CHECK(evodb.Read('c', res) && res == in2);
+    evodb.EndBackgroundCommit();
+    BOOST_CHECK(evodb.Read('a', res) && res == in2);
+    BOOST_CHECK(evodb.Read('c', res) && res == in2);
+    BOOST_CHECK(!evodb.Exists('b'));
+
+    // The writes made meanwhile are in the next commit
+    BOOST_CHECK(!evodb.GetRawDB().Exists('d'));
+    BOOST_CHECK(evodb.CommitRootTransaction());
+    BOOST_CHECK(evodb.GetRawDB().Read('d', res) && res == in1);
+}
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -10,8 +10,10 @@
 #include "consensus/params.h"
 #include "evo/specialtx_validation.h"
 #include "evo/deterministicmns.h"
+#include "llmq/quorums.h"
 #include "llmq/quorums_blockprocessor.h"
 #include "llmq/quorums_commitment.h"
+#include "llmq/quorums_dkgsessionmgr.h"
 #include "llmq/quorums_utils.h"
 #include "masternode-payments.h"
 #include "messagesigner.h"
@@ -648,6 +650,13 @@ BOOST_FIXTURE_TEST_CASE(dip3_protx, TestChain400Setup)
         auto tx2 = MalleateProUpServTx(tx);
         BOOST_CHECK(!WITH_LOCK(cs_main, return CheckSpecialTx(tx2, chainTip, view, dummyState); ));
         BOOST_CHECK_EQUAL(dummyState.GetRejectReason(), "bad-protx-sig");
+        // the payload signature checks can be deferred (as done when connecting a block)
+        std::vector<CProTxSigCheck> vSigChecks;
+        BOOST_CHECK(WITH_LOCK(cs_main, return CheckSpecialTx(tx, chainTip, view, dummyState, &vSigChecks); ));
+        BOOST_CHECK(WITH_LOCK(cs_main, return CheckSpecialTx(tx2, chainTip, view, dummyState, &vSigChecks); ));
+        BOOST_CHECK_EQUAL(vSigChecks.size(), 2);
+        BOOST_CHECK(vSigChecks[0]());
+        BOOST_CHECK(!vSigChecks[1]());
 
         CreateAndProcessBlock({tx}, coinbaseKey);
         chainTip = chainActive.Tip();
@@ -769,6 +778,10 @@ BOOST_FIXTURE_TEST_CASE(dip3_protx, TestChain400Setup)
         BOOST_CHECK_MESSAGE(dmn->pdmnState->pubKeyOperator.Get() == new_operatorKey.GetPublicKey(), "mn operator key not changed");
         BOOST_CHECK_MESSAGE(dmn->pdmnState->keyIDVoting == new_votingKey.GetPubKey().GetID(), "mn voting key not changed");
         BOOST_CHECK_MESSAGE(dmn->pdmnState->scriptPayout == new_payee, "mn script payout not changed");
+        // the operator key index follows the update
+        const auto& mnList = deterministicMNManager->GetListAtChainTip();
+        BOOST_CHECK(mnList.GetMNByOperatorKey(new_operatorKey.GetPublicKey())->proTxHash == proTx);
+        BOOST_CHECK(!mnList.GetMNByOperatorKey(operatorKeys.at(proTx).GetPublicKey()));
 
         operatorKeys[proTx] = std::move(new_operatorKey);
 
@@ -903,6 +916,8 @@ BOOST_FIXTURE_TEST_CASE(dip3_protx, TestChain400Setup)
         auto dmn = deterministicMNManager->GetListAtChainTip().GetMN(proTx);
         BOOST_ASSERT(dmn != nullptr);
         BOOST_CHECK_MESSAGE(!dmn->pdmnState->pubKeyOperator.Get().IsValid(), "mn operator key not removed");
+        BOOST_CHECK(!deterministicMNManager->GetListAtChainTip().GetMNByOperatorKey(operatorKeys.at(proTx).GetPublicKey()));
+        BOOST_CHECK(!deterministicMNManager->GetListAtChainTip().GetMNByOperatorKey(CBLSPublicKey()));
         BOOST_CHECK_MESSAGE(dmn->pdmnState->addr == CService(), "mn IP address not removed");
         BOOST_CHECK_MESSAGE(dmn->pdmnState->scriptOperatorPayout.empty(), "mn operator payout not removed");
         BOOST_CHECK_EQUAL(dmn->pdmnState->nRevocationReason, reason);
@@ -910,6 +925,20 @@ BOOST_FIXTURE_TEST_CASE(dip3_protx, TestChain400Setup)
         BOOST_CHECK_EQUAL(dmn->pdmnState->nPoSeBanHeight, nHeight);
     }
 
+    // Lists rebuilt with a short snapshot interval (compacting the diff chains into snapshots)
+    // and a tiny lists cache: same lists, both from the diffs and from the compacted snapshots.
+    for (size_t i = 0; i < 2; i++) {
+        CDeterministicMNManager compactingManager(*evoDb, 5, 2);
+        for (int h : {nHeight - 20, nHeight - 7, nHeight}) {
+            const CBlockIndex* pindex = WITH_LOCK(cs_main, return chainActive[h]; );
+            const auto& list = compactingManager.GetListForBlock(pindex);
+            BOOST_CHECK_EQUAL(list.GetBlockHash(), pindex->GetBlockHash());
+            BOOST_CHECK_EQUAL(list.GetHeight(), h);
+            BOOST_CHECK(!list.BuildDiff(deterministicMNManager->GetListForBlock(pindex)).HasChanges());
+            BOOST_CHECK(!list.BuildDiff(compactingManager.GetListForBlock(pindex)).HasChanges());
+        }
+    }
+
     UpdateNetworkUpgradeParameters(Consensus::UPGRADE_V6_0, Consensus::NetworkUpgrade::NO_ACTIVATION_HEIGHT);
 }
 
@@ -1052,6 +1081,18 @@ BOOST_FIXTURE_TEST_CASE(dkg_pose_and_qfc_invalid_paths, TestChain400Setup)
 
     // get quorum mns
     auto members = deterministicMNManager->GetAllQuorumMembers(Consensus::LLMQ_TEST, quorumIndex);
+    {
+        // members are the top ranked mns (same order as ranking all of them), then they are served from the cache
+        auto mnList = deterministicMNManager->GetListForBlock(quorumIndex);
+        auto modifier = ::SerializeHash(std::make_pair(static_cast<uint8_t>(Consensus::LLMQ_TEST), quorumHash));
+        auto ranked = mnList.CalculateQuorum(mnList.GetAllMNsCount(), modifier);
+        BOOST_CHECK_EQUAL(members.size(), (size_t)params.size);
+        BOOST_CHECK(ranked.size() > members.size());
+        for (size_t i = 0; i < members.size(); i++) {
+            BOOST_CHECK_EQUAL(members[i]->proTxHash, ranked[i]->proTxHash);
+        }
+        BOOST_CHECK(deterministicMNManager->GetAllQuorumMembers(Consensus::LLMQ_TEST, quorumIndex) == members);
+    }
     std::vector<CBLSPublicKey> pkeys;
     std::vector<CBLSSecretKey> skeys;
     for (size_t i = 0; i < members.size()-1; i++) {             // all, except the last one...
@@ -1209,6 +1250,17 @@ BOOST_FIXTURE_TEST_CASE(dkg_pose_and_qfc_invalid_paths, TestChain400Setup)
     // non-participating mn has been punished
     auto punished_mn = deterministicMNManager->GetListAtChainTip().GetMN(invalidmn_proTx);
     BOOST_CHECK_EQUAL(punished_mn->pdmnState->nPoSePenalty, 66);
+    // it's the only one with a penalty, and all the mns are confirmed
+    std::vector<uint256> penalized_mns;
+    deterministicMNManager->GetListAtChainTip().ForEachPoSePenalizedMN([&](const CDeterministicMNCPtr& dmn) {
+        penalized_mns.emplace_back(dmn->proTxHash);
+    });
+    BOOST_CHECK(penalized_mns == std::vector<uint256>{invalidmn_proTx});
+    size_t unconfirmed_mns = 0;
+    deterministicMNManager->GetListAtChainTip().ForEachUnconfirmedMN([&](const CDeterministicMNCPtr& dmn) {
+        unconfirmed_mns++;
+    });
+    BOOST_CHECK_EQUAL(unconfirmed_mns, 0);
 
     // penalty is decreased each block
     CreateAndProcessBlock({}, coinbaseKey);
@@ -1330,6 +1382,26 @@ BOOST_FIXTURE_TEST_CASE(dkg_pose_and_qfc_invalid_paths, TestChain400Setup)
     BOOST_CHECK(qfc3.quorumSig == ret.quorumSig);
     BOOST_CHECK(qfc3.membersSig == ret.membersSig);
 
+    // warm up the quorums on a running worker pool, while holding cs_main: the jobs must not need it
+    {
+        CBLSWorker worker;
+        worker.Start();
+        llmq::CQuorumManager quorumManager(*evoDb, worker, *llmq::quorumDKGSessionManager);
+        BOOST_CHECK(quorumManager.WarmupQuorums(nullptr).empty());
+        {
+            LOCK(cs_main);
+            auto futures = quorumManager.WarmupQuorums(chainActive.Tip());
+            BOOST_CHECK_EQUAL(futures.size(), Params().GetConsensus().llmqs.size());
+            for (auto& f : futures) {
+                BOOST_CHECK(f.wait_for(std::chrono::seconds(30)) == std::future_status::ready);
+            }
+        }
+        auto quorums = quorumManager.ScanQuorums(Consensus::LLMQ_TEST, chainTip, 1);
+        BOOST_CHECK_EQUAL(quorums.size(), 1);
+        BOOST_CHECK(quorums[0]->pindexQuorum->GetBlockHash() == quorumHash);
+        BOOST_CHECK(quorums[0]->quorumPublicKey == qfc3.quorumPublicKey);
+    }
+
     UpdateNetworkUpgradeParameters(Consensus::UPGRADE_V6_0, Consensus::NetworkUpgrade::NO_ACTIVATION_HEIGHT);
 }
 
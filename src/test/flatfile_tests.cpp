@@ -120,4 +120,41 @@ BOOST_AUTO_TEST_CASE(flatfile_flush)
     BOOST_CHECK_EQUAL(fs::file_size(seq.FileName(FlatFilePos(0, 1))), 1);
 }
 
+#ifndef WIN32
+BOOST_AUTO_TEST_CASE(flatfile_mmap)
+{
+    auto data_dir = SetDataDir("flatfile_test");
+    FlatFileSeq seq(data_dir, "a", 100);
+    const std::string line("Commerce on the Internet has come to rely almost exclusively on financial institutions.");
+    for (int nFile = 0; nFile < 3; nFile++) {
+        CAutoFile file(seq.Open(FlatFilePos(nFile, 0)), SER_DISK, CLIENT_VERSION);
+        file << LIMITED_STRING(line, 256);
+    }
+    const size_t nSize = GetSerializeSize(line, CLIENT_VERSION);
+
+    FlatFileMapCache cache(seq, 2);
+    std::shared_ptr<const MappedFlatFile> file0 = cache.Get(0);
+    BOOST_CHECK(file0);
+    BOOST_CHECK_EQUAL(file0->size(), nSize);
+    const unsigned char* data = file0->Read(1, line.size());
+    BOOST_CHECK(data && std::string((const char*)data, line.size()) == line);
+    BOOST_CHECK(file0->Read(nSize, 0));
+    BOOST_CHECK(!file0->Read(1, nSize));
+    BOOST_CHECK(!file0->Read(nSize + 1, 0));
+
+    // The mappings are reused, and the least recently used one is dropped
+    BOOST_CHECK(cache.Get(0) == file0);
+    BOOST_CHECK(cache.Get(1));
+    BOOST_CHECK(cache.Get(2));
+    BOOST_CHECK(cache.Get(0) != file0);
+    // A dropped mapping stays valid while it's used
+    BOOST_CHECK(std::string((const char*)file0->Read(1, line.size()), line.size()) == line);
+
+    // The missing files aren't mapped
+    BOOST_CHECK(!cache.Get(3));
+    cache.Clear();
+    BOOST_CHECK(!FlatFileMapCache(seq, 0).Get(0));
+}
+#endif
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -4,6 +4,7 @@
 
 #include "crypto/siphash.h"
 #include "hash.h"
+#include "primitives/block.h"
 #include "utilstrencodings.h"
 #include "test/test_pivx.h"
 
@@ -145,4 +146,28 @@ BOOST_AUTO_TEST_CASE(siphash)
     }
 }
 
+BOOST_AUTO_TEST_CASE(quark)
+{
+    // The mainnet genesis block, hashed with Quark as a version 1 header
+    CBlockHeader header;
+    header.nVersion = 1;
+    header.hashMerkleRoot = uint256S("0x1b2ef6e2f28be914103a277377ae7729dcd125dfeb8bf97bd5964ba72b6dc39b");
+    header.nTime = 1454124731;
+    header.nBits = 0x1e0ffff0;
+    header.nNonce = 2402015;
+    const uint256 expected = uint256S("0x0000041e482b9b9691d98eefb48473405c0b8ec31b76df3797c74a78680ef818");
+    BOOST_CHECK_EQUAL(header.GetHash(), expected);
+
+    unsigned char data[80];
+    WriteLE32(&data[0], header.nVersion);
+    memcpy(&data[4], header.hashPrevBlock.begin(), 32);
+    memcpy(&data[36], header.hashMerkleRoot.begin(), 32);
+    WriteLE32(&data[68], header.nTime);
+    WriteLE32(&data[72], header.nBits);
+    WriteLE32(&data[76], header.nNonce);
+    BOOST_CHECK_EQUAL(HashQuark(data, sizeof(data)), expected);
+    BOOST_CHECK_EQUAL(HashQuark(data, data + sizeof(data)), expected);
+    BOOST_CHECK(HashQuark(data, data + 79) != expected);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -110,6 +110,16 @@ BOOST_AUTO_TEST_CASE(key_test1)
         BOOST_CHECK(!pubkey2C.Verify(hashMsg, sign1C));
         BOOST_CHECK( pubkey2C.Verify(hashMsg, sign2C));
 
+        // verification of many signatures with a single key parse
+
+        std::vector<bool> vResults;
+        std::vector<std::pair<uint256, std::vector<unsigned char>>> vSigs{
+            {hashMsg, sign1}, {hashMsg, sign2}, {hashMsg, sign1C}, {uint256(), sign1}};
+        BOOST_CHECK_EQUAL(pubkey1.VerifyMany(vSigs, vResults), 2U);
+        BOOST_CHECK(vResults == std::vector<bool>({true, false, true, false}));
+        BOOST_CHECK_EQUAL(CPubKey().VerifyMany(vSigs, vResults), 0U);
+        BOOST_CHECK(vResults == std::vector<bool>(4, false));
+
         // compact signatures (with key recovery)
 
         std::vector<unsigned char> csign1, csign2, csign1C, csign2C;
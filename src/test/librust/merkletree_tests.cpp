@@ -134,6 +134,76 @@ BOOST_AUTO_TEST_CASE(SaplingVectors) {
     );
 }
 
+BOOST_AUTO_TEST_CASE(SaplingFrontierWitnesses) {
+    UniValue commitment_tests = read_json(MAKE_STRING(json_tests::merkle_commitments_sapling));
+
+    // Append the commitments in "blocks" of every size, witnessing at every
+    // point, and check that the witnesses updated through the shared frontier
+    // match the ones updated one commitment at a time.
+    for (size_t blockSize = 1; blockSize <= 16; blockSize++) {
+        SaplingTestingMerkleTree tree;
+        std::vector<SaplingTestingWitness> witnesses;
+        std::vector<SaplingTestingWitness> frontierWitnesses;
+        for (size_t i = 0; i < 16; i += blockSize) {
+            SaplingTestingMerkleFrontier frontier(tree);
+            for (size_t j = i; j < std::min<size_t>(i + blockSize, 16); j++) {
+                uint256 test_commitment = uint256S(commitment_tests[j].get_str());
+                witnesses.push_back(tree.witness());
+                frontierWitnesses.push_back(frontier.tree().witness());
+                tree.append(test_commitment);
+                frontier.append(test_commitment);
+                for (size_t k = 0; k < witnesses.size(); k++) {
+                    witnesses[k].append(test_commitment);
+                }
+            }
+            BOOST_CHECK(frontier.tree() == tree);
+            BOOST_CHECK_EQUAL(frontier.size(), tree.size());
+            for (size_t k = 0; k < frontierWitnesses.size(); k++) {
+                frontierWitnesses[k].append(frontier);
+                BOOST_CHECK(frontierWitnesses[k] == witnesses[k]);
+                BOOST_CHECK(frontierWitnesses[k].root() == tree.root());
+            }
+        }
+    }
+
+    // A witness can't skip commitments that the frontier doesn't have
+    SaplingTestingMerkleTree tree;
+    SaplingTestingWitness witness = tree.witness();
+    tree.append(uint256S(commitment_tests[0].get_str()));
+    SaplingTestingMerkleFrontier frontier(tree);
+    BOOST_CHECK_THROW(witness.append(frontier), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(SaplingBatchAppend) {
+    UniValue commitment_tests = read_json(MAKE_STRING(json_tests::merkle_commitments_sapling));
+    std::vector<libzcash::PedersenHash> commitments;
+    for (size_t i = 0; i < 16; i++) {
+        commitments.emplace_back(uint256S(commitment_tests[i].get_str()));
+    }
+
+    // Append every range of the commitments at once to the tree of the ones before,
+    // and check that it matches the tree built one commitment at a time.
+    for (size_t start = 0; start <= 16; start++) {
+        for (size_t end = start; end <= 16; end++) {
+            SaplingTestingMerkleTree tree;
+            SaplingTestingMerkleTree batchTree;
+            for (size_t i = 0; i < end; i++) {
+                tree.append(commitments[i]);
+                if (i < start) batchTree.append(commitments[i]);
+            }
+            batchTree.append(std::vector<libzcash::PedersenHash>(commitments.begin() + start, commitments.begin() + end));
+            BOOST_CHECK(batchTree == tree);
+            BOOST_CHECK(batchTree.root() == tree.root());
+        }
+    }
+
+    // The whole batch is rejected when the tree can't hold it
+    SaplingTestingMerkleTree tree;
+    tree.append(std::vector<libzcash::PedersenHash>(commitments.begin(), commitments.begin() + 15));
+    BOOST_CHECK_THROW(tree.append(std::vector<libzcash::PedersenHash>(commitments.begin(), commitments.begin() + 2)), std::runtime_error);
+    BOOST_CHECK_EQUAL(tree.size(), 15);
+}
+
 BOOST_AUTO_TEST_CASE(emptyroots) {
     libzcash::EmptyMerkleRoots<64, libzcash::SHA256Compress> emptyroots;
     std::array<libzcash::SHA256Compress, 65> computed;
@@ -174,6 +174,55 @@ BOOST_AUTO_TEST_CASE(FindMySaplingNotes)
     BOOST_CHECK_EQUAL(2, noteMap.size());
 }
 
+BOOST_AUTO_TEST_CASE(FindMySaplingNotesManyKeys)
+{
+    auto consensusParams = Params().GetConsensus();
+
+    CWallet& wallet = m_wallet;
+    LOCK(wallet.cs_wallet);
+    wallet.SetupSPKM(false);
+
+    // Enough (output, ivk) pairs to be spread over the trial-decryption threads
+    auto m = GetTestMasterSaplingSpendingKey();
+    std::vector<libzcash::SaplingExtendedSpendingKey> keys;
+    for (uint32_t i = 0; i < 8; i++) {
+        keys.emplace_back(m.Derive(i | ZIP32_HARDENED_KEY_LIMIT));
+        BOOST_CHECK(wallet.AddSaplingZKey(keys.back()));
+    }
+    auto pa2 = keys[2].DefaultAddress();
+    auto pa7 = keys[7].DefaultAddress();
+    auto paExternal = m.Derive(100 | ZIP32_HARDENED_KEY_LIMIT).DefaultAddress();
+
+    auto testNote = GetTestSaplingNote(m.DefaultAddress(), 50000000);
+    auto builder = TransactionBuilder(consensusParams);
+    builder.AddSaplingSpend(m.expsk, testNote.note, testNote.tree.root(), testNote.tree.witness());
+    builder.AddSaplingOutput(m.ToXFVK().fvk.ovk, paExternal, 10000000, {});
+    builder.AddSaplingOutput(m.ToXFVK().fvk.ovk, pa7, 10000000, {});
+    builder.AddSaplingOutput(m.ToXFVK().fvk.ovk, pa2, 20000000, {});
+    builder.SetFee(10000000);
+    auto tx = builder.Build().GetTxOrThrow();
+    BOOST_CHECK_EQUAL(tx.sapData->vShieldedOutput.size(), 3);
+
+    // Each note is found by the ivk it was sent to
+    auto noteMap = wallet.GetSaplingScriptPubKeyMan()->FindMySaplingNotes(tx).first;
+    BOOST_CHECK_EQUAL(2, noteMap.size());
+    BOOST_CHECK(noteMap.find(SaplingOutPoint(tx.GetHash(), 0)) == noteMap.end());
+    const SaplingNoteData& nd1 = noteMap.at(SaplingOutPoint(tx.GetHash(), 1));
+    BOOST_CHECK(*nd1.ivk == keys[7].ToXFVK().fvk.in_viewing_key());
+    BOOST_CHECK(*nd1.address == pa7);
+    BOOST_CHECK_EQUAL(*nd1.amount, 10000000);
+    const SaplingNoteData& nd2 = noteMap.at(SaplingOutPoint(tx.GetHash(), 2));
+    BOOST_CHECK(*nd2.ivk == keys[2].ToXFVK().fvk.in_viewing_key());
+    BOOST_CHECK(*nd2.address == pa2);
+    BOOST_CHECK_EQUAL(*nd2.amount, 20000000);
+
+    // Addresses are returned in output order
+    auto addresses = wallet.GetSaplingScriptPubKeyMan()->FindMySaplingAddresses(tx);
+    BOOST_CHECK_EQUAL(addresses.size(), 2);
+    BOOST_CHECK(addresses[0] == pa7);
+    BOOST_CHECK(addresses[1] == pa2);
+}
+
 // Generate note A and spend to create note B, from which we spend to create two conflicting transactions
 BOOST_AUTO_TEST_CASE(GetConflictedSaplingNotes)
 {
@@ -860,6 +909,65 @@ BOOST_AUTO_TEST_CASE(CachedWitnessesCleanIndex)
     }
 }
 
+BOOST_AUTO_TEST_CASE(CachedWitnessesTxsWithNotes)
+{
+    libzcash::SaplingExtendedSpendingKey sk = GetTestMasterSaplingSpendingKey();
+    CWallet& wallet = m_wallet;
+    {
+        LOCK(wallet.cs_wallet);
+        setupWallet(wallet);
+        BOOST_CHECK(wallet.AddSaplingZKey(sk));
+    }
+
+    // First block, with a note of ours
+    CBlock block1;
+    CBlockIndex index1(block1);
+    index1.nHeight = 1;
+    SaplingMerkleTree saplingTree;
+    SaplingOutPoint output1 = CreateValidBlock(wallet, sk, index1, block1, saplingTree);
+    {
+        LOCK(wallet.cs_wallet);
+        BOOST_CHECK_EQUAL(wallet.mapWallet.at(output1.hash).mapSaplingNoteData.at(output1).witnessHeight, 1);
+    }
+
+    // A tx with a note of ours, erased from the wallet before the next block
+    CWalletTx wtxErased = GetValidSaplingReceive(Params().GetConsensus(), wallet, sk, 10, true);
+    SetSaplingNoteData(wtxErased);
+    wallet.LoadToWallet(wtxErased);
+    WITH_LOCK(wallet.cs_wallet, wallet.mapWallet.erase(wtxErased.GetHash()));
+
+    // Second block, with another note of ours
+    CWalletTx wtx2 = GetValidSaplingReceive(Params().GetConsensus(), wallet, sk, 20, true);
+    std::vector<SaplingOutPoint> saplingNotes = SetSaplingNoteData(wtx2);
+    wallet.LoadToWallet(wtx2);
+    CBlock block2;
+    block2.hashPrevBlock = block1.GetHash();
+    block2.vtx.emplace_back(wtx2.tx);
+    CBlockIndex index2(block2);
+    index2.nHeight = 2;
+    wallet.IncrementNoteWitnesses(&index2, &block2, saplingTree);
+
+    // The witnesses of both notes are advanced, the erased tx is skipped
+    saplingNotes.emplace_back(output1);
+    std::vector<Optional<SaplingWitness>> saplingWitnesses;
+    GetWitnessesAndAnchors(wallet, saplingNotes, saplingWitnesses);
+    BOOST_CHECK((bool) saplingWitnesses[0]);
+    BOOST_CHECK((bool) saplingWitnesses[1]);
+    {
+        LOCK(wallet.cs_wallet);
+        BOOST_CHECK(!wallet.mapWallet.count(wtxErased.GetHash()));
+        BOOST_CHECK_EQUAL(wallet.mapWallet.at(output1.hash).mapSaplingNoteData.at(output1).witnessHeight, 2);
+        BOOST_CHECK_EQUAL(wallet.mapWallet.at(wtx2.GetHash()).mapSaplingNoteData.at(saplingNotes[0]).witnessHeight, 2);
+    }
+
+    // And moved back on disconnection
+    wallet.DecrementNoteWitnesses(&index2);
+    {
+        LOCK(wallet.cs_wallet);
+        BOOST_CHECK_EQUAL(wallet.mapWallet.at(output1.hash).mapSaplingNoteData.at(output1).witnessHeight, 1);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(ClearNoteWitnessCache)
 {
     auto consensusParams = Params().GetConsensus();
@@ -1198,12 +1306,25 @@ BOOST_AUTO_TEST_CASE(GetNotes)
     std::vector<SaplingNoteEntry> entries;
     Optional<libzcash::SaplingPaymentAddress> address = pk;
     wallet.GetSaplingScriptPubKeyMan()->GetFilteredNotes(entries, address, 0, true, false);
+    BOOST_CHECK_EQUAL(entries.size(), 5);
     for (int i=0; i<5; i++) {
         BOOST_CHECK(entries[i].op == saplingOutpoints[i]);
         BOOST_CHECK(entries[i].address == pk);
         BOOST_CHECK_EQUAL(entries[i].confirmations, 1);
     }
 
+    // The unspent notes index gives the same notes as the full scan (which includes the spent notes)
+    std::vector<SaplingNoteEntry> entriesWithSpent;
+    wallet.GetSaplingScriptPubKeyMan()->GetFilteredNotes(entriesWithSpent, address, 0, false, false);
+    BOOST_CHECK_EQUAL(entriesWithSpent.size(), entries.size());
+    for (size_t i = 0; i < entries.size(); i++) {
+        BOOST_CHECK(entriesWithSpent[i].op == entries[i].op);
+    }
+    std::vector<SaplingNoteEntry> entriesOtherAddr;
+    Optional<libzcash::SaplingPaymentAddress> otherAddress = GetTestMasterSaplingSpendingKey().Derive(1).DefaultAddress();
+    wallet.GetSaplingScriptPubKeyMan()->GetFilteredNotes(entriesOtherAddr, otherAddress, 0, true, false);
+    BOOST_CHECK(entriesOtherAddr.empty());
+
     // Check GetNotes
     std::vector<SaplingNoteEntry> entries2;
     wallet.GetSaplingScriptPubKeyMan()->GetNotes(saplingOutpoints, entries2);
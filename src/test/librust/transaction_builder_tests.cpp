@@ -8,6 +8,8 @@
 
 #include "sapling/sapling.h"
 #include "sapling/transaction_builder.h"
+#include "sapling/sapling_batchverifier.h"
+#include "sapling/sapling_proofcache.h"
 #include "sapling/sapling_validation.h"
 
 #include <univalue.h>
@@ -305,5 +307,89 @@ BOOST_AUTO_TEST_CASE(CheckSaplingTxVersion)
     }
 }
 
+BOOST_AUTO_TEST_CASE(BatchVerification)
+{
+    auto consensusParams = Params().GetConsensus();
+
+    auto sk = libzcash::SaplingSpendingKey::random();
+    auto expsk = sk.expanded_spending_key();
+    auto fvk = sk.full_viewing_key();
+    auto pa = sk.default_address();
+
+    // Create two Sapling-only transactions
+    std::vector<CTransaction> txes;
+    for (int i = 0; i < 2; i++) {
+        auto testNote = GetTestSaplingNote(pa, 40000000);
+        auto builder = TransactionBuilder(consensusParams);
+        builder.AddSaplingSpend(expsk, testNote.note, testNote.tree.root(), testNote.tree.witness());
+        builder.SetFee(10000000);
+        builder.AddSaplingOutput(fvk.ovk, pa, 29900000, {});
+        txes.emplace_back(builder.Build().GetTxOrThrow());
+    }
+
+    // And a rogue one, with a bad binding signature
+    CMutableTransaction mtx(txes[1]);
+    mtx.sapData->bindingSig[0] ^= 0x01;
+    txes.emplace_back(mtx);
+
+    std::vector<SaplingValidation::CSaplingProofCheck> vChecks;
+    for (const CTransaction& tx : txes) {
+        CValidationState state;
+        BOOST_CHECK(SaplingValidation::ContextualCheckTransaction(tx, state, Params(), 3, true, false, &vChecks));
+    }
+    BOOST_CHECK_EQUAL(vChecks.size(), 3);
+
+    // The valid transactions pass the batch verification
+    {
+        SaplingValidation::CSaplingBatchVerifier batch;
+        BOOST_CHECK(batch.IsEmpty());
+        BOOST_CHECK(batch.Verify());
+        batch.Add(vChecks[0]);
+        batch.Add(vChecks[1]);
+        BOOST_CHECK(batch.Verify());
+    }
+
+    // The batch fails with the rogue tx, and the fallback identifies it
+    {
+        SaplingValidation::CSaplingBatchVerifier batch;
+        for (const auto& check : vChecks) batch.Add(check);
+        const CTransaction* pInvalidTx = nullptr;
+        BOOST_CHECK(!batch.Verify(&pInvalidTx));
+        BOOST_CHECK(pInvalidTx == &txes[2]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ShieldedProofCache)
+{
+    auto consensusParams = Params().GetConsensus();
+
+    auto sk = libzcash::SaplingSpendingKey::random();
+    auto expsk = sk.expanded_spending_key();
+    auto fvk = sk.full_viewing_key();
+    auto pa = sk.default_address();
+
+    auto testNote = GetTestSaplingNote(pa, 40000000);
+    auto builder = TransactionBuilder(consensusParams);
+    builder.AddSaplingSpend(expsk, testNote.note, testNote.tree.root(), testNote.tree.witness());
+    builder.SetFee(10000000);
+    builder.AddSaplingOutput(fvk.ovk, pa, 29900000, {});
+    CTransaction tx = builder.Build().GetTxOrThrow();
+
+    // Block validation doesn't fill the cache
+    std::vector<SaplingValidation::CSaplingProofCheck> vChecks;
+    CValidationState state;
+    BOOST_CHECK(SaplingValidation::ContextualCheckTransaction(tx, state, Params(), 3, true, false, &vChecks));
+    BOOST_CHECK_EQUAL(vChecks.size(), 1);
+    BOOST_CHECK(!SaplingValidation::ShieldedProofCacheGet(tx.GetHash(), vChecks[0].GetDataToBeSigned()));
+
+    // Mempool validation does
+    BOOST_CHECK(SaplingValidation::ContextualCheckTransaction(tx, state, Params(), 3, false, false));
+    BOOST_CHECK(SaplingValidation::ShieldedProofCacheGet(tx.GetHash(), vChecks[0].GetDataToBeSigned()));
+
+    // And the proofs verification is skipped afterwards
+    vChecks.clear();
+    BOOST_CHECK(SaplingValidation::ContextualCheckTransaction(tx, state, Params(), 3, true, false, &vChecks));
+    BOOST_CHECK(vChecks.empty());
+}
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -128,6 +128,31 @@ BOOST_FIXTURE_TEST_CASE(StoreAndLoadSaplingZkeys, TestingSetup) {
     BOOST_CHECK(wallet.HaveSaplingIncomingViewingKey(dpa2));
 }
 
+BOOST_FIXTURE_TEST_CASE(GenerateSaplingZkeysBatch, TestingSetup) {
+    CWallet wallet("dummy", WalletDatabase::CreateDummy());
+    LOCK(wallet.cs_wallet);
+    CKey seed;
+    seed.MakeNewKey(true);
+    wallet.AddKeyPubKey(seed, seed.GetPubKey());
+    wallet.GetSaplingScriptPubKeyMan()->SetHDSeed(seed.GetPubKey(), false, true);
+
+    // The keys of a batch follow the ones generated one at a time on the m/32'/119'/account' path
+    std::vector<libzcash::SaplingPaymentAddress> addresses = {wallet.GenerateNewSaplingZKey()};
+    const auto& batch = wallet.GenerateNewSaplingZKeys(3);
+    BOOST_CHECK_EQUAL(batch.size(), 3);
+    addresses.insert(addresses.end(), batch.begin(), batch.end());
+
+    HDSeed hdSeed(seed.GetPrivKey());
+    auto m_32h_cth = libzcash::SaplingExtendedSpendingKey::Master(hdSeed).Derive(32 | ZIP32_HARDENED_KEY_LIMIT).Derive(119 | ZIP32_HARDENED_KEY_LIMIT);
+    for (uint32_t i = 0; i < addresses.size(); i++) {
+        BOOST_CHECK(addresses[i] == m_32h_cth.Derive(i | ZIP32_HARDENED_KEY_LIMIT).DefaultAddress());
+        BOOST_CHECK(wallet.HaveSpendingKeyForPaymentAddress(addresses[i]));
+    }
+    std::set<libzcash::SaplingPaymentAddress> addrs;
+    wallet.GetSaplingPaymentAddresses(addrs);
+    BOOST_CHECK_EQUAL(4, addrs.size());
+}
+
 /**
   * This test covers methods on WalletBatch to load/save crypted sapling z keys.
   */
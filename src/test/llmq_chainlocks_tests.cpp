@@ -0,0 +1,50 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "test/test_pivx.h"
+
+#include "llmq/quorums_chainlocks.h"
+#include "spork.h"
+#include "validation.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <future>
+
+BOOST_FIXTURE_TEST_SUITE(llmq_chainlocks_tests, TestingSetup)
+
+BOOST_AUTO_TEST_CASE(cleanup_non_masternode_no_cs_main)
+{
+    BOOST_CHECK(!fMasterNode);
+    int64_t nTime = GetTime() - 10;
+    sporkManager.AddOrUpdateSporkMessage(CSporkMessage(SPORK_23_CHAINLOCKS_ENFORCEMENT, nTime + 1, nTime));
+    BOOST_CHECK(sporkManager.IsSporkActive(SPORK_23_CHAINLOCKS_ENFORCEMENT));
+
+    const uint256 hash = g_insecure_rand_ctx.rand256();
+    CBlockIndex prev;
+    CBlockIndex index;
+    index.pprev = &prev;
+    index.phashBlock = &hash;
+    index.nHeight = 1;
+
+    llmq::CChainLocksHandler handler(nullptr);
+    std::future<void> f;
+    {
+        // the first new tip runs the cleanup: on non-masternodes, it must not wait for cs_main
+        LOCK(cs_main);
+        f = std::async(std::launch::async, [&]() { handler.UpdatedBlockTip(&index, &prev); });
+        BOOST_CHECK(f.wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+    }
+    f.get();
+
+    // non-masternodes don't sign
+    auto stats = handler.GetStats();
+    BOOST_CHECK_EQUAL(stats.nSignedSessions, 0);
+    BOOST_CHECK_EQUAL(stats.nTimedOutSessions, 0);
+
+    sporkManager.AddOrUpdateSporkMessage(CSporkMessage(SPORK_23_CHAINLOCKS_ENFORCEMENT, 4070908800ULL, GetTime()));
+    BOOST_CHECK(!sporkManager.IsSporkActive(SPORK_23_CHAINLOCKS_ENFORCEMENT));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,171 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "test/test_pivx.h"
+
+#include "logging.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <fstream>
+#include <thread>
+
+BOOST_FIXTURE_TEST_SUITE(logging_tests, BasicTestingSetup)
+
+static void OpenTestLog(BCLog::Logger& logger, const fs::path& path)
+{
+    logger.m_print_to_file = true;
+    logger.m_log_timestamps = false;
+    logger.m_file_path = path;
+    BOOST_CHECK(logger.OpenDebugLog());
+}
+
+static std::vector<std::string> ReadLines(const fs::path& path)
+{
+    std::vector<std::string> lines;
+    std::ifstream file(path.string());
+    std::string line;
+    while (std::getline(file, line)) {
+        lines.emplace_back(line);
+    }
+    return lines;
+}
+
+// Log nMessages "<thread> <index>" messages from each of nThreads threads
+static void LogFromThreads(BCLog::Logger& logger, int nThreads, int nMessages)
+{
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nThreads; t++) {
+        threads.emplace_back([&logger, t, nMessages]() {
+            for (int i = 0; i < nMessages; i++) {
+                logger.LogPrintStr(strprintf("%d %d\n", t, i));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+// Check that the messages of every thread are written in order, return how many were written
+// and the sum of the dropped counts reported by the writer
+static size_t CheckThreadMessages(const std::vector<std::string>& lines, int nThreads, uint64_t& nReportedDropped)
+{
+    std::vector<int> vLast(nThreads, -1);
+    size_t nWritten = 0;
+    nReportedDropped = 0;
+    for (const std::string& line : lines) {
+        unsigned int nDropped;
+        if (sscanf(line.c_str(), "Logger: %u messages dropped", &nDropped) == 1) {
+            nReportedDropped += nDropped;
+            continue;
+        }
+        int t, i;
+        BOOST_REQUIRE(sscanf(line.c_str(), "%d %d", &t, &i) == 2);
+        BOOST_REQUIRE(t >= 0 && t < nThreads);
+        BOOST_CHECK(i > vLast[t]);
+        vLast[t] = i;
+        nWritten++;
+    }
+    return nWritten;
+}
+
+BOOST_AUTO_TEST_CASE(async_concurrent_writers)
+{
+    const fs::path path = GetDataDir() / "async_concurrent.log";
+    const int nThreads = 8;
+    const int nMessages = 1000;
+    {
+        BCLog::Logger logger;
+        OpenTestLog(logger, path);
+        // large enough for all the messages: nothing is dropped
+        logger.StartAsync();
+        LogFromThreads(logger, nThreads, nMessages);
+        logger.StopAsync();
+        BOOST_CHECK_EQUAL(logger.GetDroppedCount(), 0U);
+    }
+
+    uint64_t nReportedDropped;
+    BOOST_CHECK_EQUAL(CheckThreadMessages(ReadLines(path), nThreads, nReportedDropped), (size_t)nThreads * nMessages);
+    BOOST_CHECK_EQUAL(nReportedDropped, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(async_wrap_around)
+{
+    const fs::path path = GetDataDir() / "async_wrap_around.log";
+    const int nMessages = 64;
+    {
+        BCLog::Logger logger;
+        OpenTestLog(logger, path);
+        logger.StartAsync(4);
+        // wait for every message to be written before logging the next one, so that the
+        // positions go around the 4 slots many times without ever filling the buffer
+        for (int i = 0; i < nMessages; i++) {
+            logger.LogPrintStr(strprintf("0 %d\n", i));
+            int64_t nStart = GetTimeMillis();
+            while (ReadLines(path).size() < (size_t)i + 1 && GetTimeMillis() - nStart < 10000) {
+                MilliSleep(1);
+            }
+        }
+        logger.StopAsync();
+        BOOST_CHECK_EQUAL(logger.GetDroppedCount(), 0U);
+    }
+
+    uint64_t nReportedDropped;
+    BOOST_CHECK_EQUAL(CheckThreadMessages(ReadLines(path), 1, nReportedDropped), (size_t)nMessages);
+    BOOST_CHECK_EQUAL(nReportedDropped, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(async_overflow)
+{
+    const fs::path path = GetDataDir() / "async_overflow.log";
+    const int nThreads = 4;
+    const int nMessages = 10000;
+    uint64_t nDropped;
+    {
+        BCLog::Logger logger;
+        OpenTestLog(logger, path);
+        // the writer can't keep up with the producers on a 2 slots buffer
+        logger.StartAsync(2);
+        LogFromThreads(logger, nThreads, nMessages);
+        logger.StopAsync();
+        nDropped = logger.GetDroppedCount();
+    }
+    BOOST_CHECK(nDropped > 0);
+
+    // every message is either written or counted as dropped, and the writer reports all the drops
+    uint64_t nReportedDropped;
+    const size_t nWritten = CheckThreadMessages(ReadLines(path), nThreads, nReportedDropped);
+    BOOST_CHECK_EQUAL(nWritten + nDropped, (size_t)nThreads * nMessages);
+    BOOST_CHECK_EQUAL(nReportedDropped, nDropped);
+}
+
+BOOST_AUTO_TEST_CASE(async_flush_on_stop)
+{
+    const fs::path path = GetDataDir() / "async_flush_on_stop.log";
+    const int nMessages = 1000;
+    BCLog::Logger logger;
+    OpenTestLog(logger, path);
+    logger.StartAsync();
+    for (int i = 0; i < nMessages; i++) {
+        logger.LogPrintStr(strprintf("0 %d\n", i));
+    }
+    // all the pending messages are written when the writer stops
+    logger.StopAsync();
+    uint64_t nReportedDropped;
+    BOOST_CHECK_EQUAL(CheckThreadMessages(ReadLines(path), 1, nReportedDropped), (size_t)nMessages);
+    BOOST_CHECK_EQUAL(logger.GetDroppedCount(), 0U);
+
+    // then the messages are written synchronously again
+    logger.LogPrintStr(strprintf("0 %d\n", nMessages));
+    BOOST_CHECK_EQUAL(CheckThreadMessages(ReadLines(path), 1, nReportedDropped), (size_t)nMessages + 1);
+
+    // and the async mode can be restarted
+    logger.StartAsync();
+    logger.LogPrintStr(strprintf("0 %d\n", nMessages + 1));
+    logger.StopAsync();
+    BOOST_CHECK_EQUAL(CheckThreadMessages(ReadLines(path), 1, nReportedDropped), (size_t)nMessages + 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
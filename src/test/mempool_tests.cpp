@@ -5,6 +5,7 @@
 #include "test/test_pivx.h"
 
 #include "policy/feerate.h"
+#include "script/interpreter.h"
 #include "txmempool.h"
 #include "util/system.h"
 
@@ -579,4 +580,126 @@ BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
     SetMockTime(0);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolBatchInsertionTest)
+{
+    CTxMemPool pool(CFeeRate(0));
+    TestMemPoolEntryHelper entry;
+    entry.nFee = 10000LL;
+
+    auto makeTx = [](const std::vector<COutPoint>& prevouts, int nOutputs) {
+        CMutableTransaction tx;
+        for (const COutPoint& prevout : prevouts) {
+            tx.vin.emplace_back(prevout);
+        }
+        if (prevouts.empty()) {
+            tx.vin.resize(1);
+            tx.vin[0].scriptSig = CScript() << OP_1;
+        }
+        tx.vout.resize(nOutputs);
+        for (auto& out : tx.vout) {
+            out.scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+            out.nValue = COIN;
+        }
+        return tx;
+    };
+
+    // Diamond: tx1 -> (tx2, tx3) -> tx4, then tx5 spending tx4 and tx1
+    const CMutableTransaction tx1 = makeTx({}, 3);
+    std::vector<CMutableTransaction> txs;
+    txs.emplace_back(makeTx({COutPoint(tx1.GetHash(), 0)}, 1));
+    txs.emplace_back(makeTx({COutPoint(tx1.GetHash(), 1)}, 1));
+    txs.emplace_back(makeTx({COutPoint(txs[0].GetHash(), 0), COutPoint(txs[1].GetHash(), 0)}, 1));
+    txs.emplace_back(makeTx({COutPoint(txs[2].GetHash(), 0), COutPoint(tx1.GetHash(), 2)}, 1));
+
+    {
+        CTxMemPool::BatchInsertion batch(pool);
+        pool.addUnchecked(tx1.GetHash(), entry.FromTx(tx1));
+        for (const auto& tx : txs) {
+            pool.addUnchecked(tx.GetHash(), entry.FromTx(tx));
+        }
+    }
+    BOOST_CHECK_EQUAL(pool.size(), 5U);
+    const auto it4 = pool.mapTx.find(txs[2].GetHash());
+    BOOST_CHECK_EQUAL(it4->GetCountWithAncestors(), 4U);
+    BOOST_CHECK_EQUAL(it4->GetSizeWithAncestors(), it4->GetTxSize() + pool.mapTx.find(txs[0].GetHash())->GetTxSize() +
+                                                   pool.mapTx.find(txs[1].GetHash())->GetTxSize() + pool.mapTx.find(tx1.GetHash())->GetTxSize());
+    const auto it5 = pool.mapTx.find(txs[3].GetHash());
+    BOOST_CHECK_EQUAL(it5->GetCountWithAncestors(), 5U);
+    BOOST_CHECK_EQUAL(it5->GetModFeesWithAncestors(), 5 * 10000LL);
+    BOOST_CHECK_EQUAL(pool.mapTx.find(tx1.GetHash())->GetCountWithDescendants(), 5U);
+
+    // Same state as without a batch
+    CTxMemPool pool2(CFeeRate(0));
+    pool2.addUnchecked(tx1.GetHash(), entry.FromTx(tx1));
+    for (const auto& tx : txs) {
+        pool2.addUnchecked(tx.GetHash(), entry.FromTx(tx));
+    }
+    for (const auto& tx : txs) {
+        const auto a = pool.mapTx.find(tx.GetHash());
+        const auto b = pool2.mapTx.find(tx.GetHash());
+        BOOST_CHECK_EQUAL(a->GetCountWithAncestors(), b->GetCountWithAncestors());
+        BOOST_CHECK_EQUAL(a->GetSizeWithAncestors(), b->GetSizeWithAncestors());
+        BOOST_CHECK_EQUAL(a->GetCountWithDescendants(), b->GetCountWithDescendants());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(MempoolUsageTest)
+{
+    CTxMemPool pool(CFeeRate(1000));
+    TestMemPoolEntryHelper entry;
+    BOOST_CHECK_EQUAL(pool.GetMemoryUsage().Total(), pool.DynamicMemoryUsage());
+
+    CMutableTransaction tx1 = CMutableTransaction();
+    tx1.vin.resize(1);
+    tx1.vin[0].scriptSig = CScript() << OP_1;
+    tx1.vout.resize(2);
+    tx1.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+    tx1.vout[0].nValue = 10 * COIN;
+    tx1.vout[1] = tx1.vout[0];
+    pool.addUnchecked(tx1.GetHash(), entry.Fee(10000LL).FromTx(tx1));
+    const MemPoolUsage usage1 = pool.GetMemoryUsage();
+
+    // Child spending both outputs: a single link each way
+    CMutableTransaction tx2 = CMutableTransaction();
+    tx2.vin.resize(2);
+    tx2.vin[0].prevout = COutPoint(tx1.GetHash(), 0);
+    tx2.vin[1].prevout = COutPoint(tx1.GetHash(), 1);
+    tx2.vout.resize(1);
+    tx2.vout[0].scriptPubKey = CScript() << OP_2 << OP_EQUAL;
+    tx2.vout[0].nValue = 10 * COIN;
+    pool.addUnchecked(tx2.GetHash(), entry.Fee(10000LL).FromTx(tx2));
+    const MemPoolUsage usage2 = pool.GetMemoryUsage();
+    BOOST_CHECK_EQUAL(usage2.Total(), pool.DynamicMemoryUsage());
+    BOOST_CHECK_EQUAL(usage2.nEntries, 2 * usage1.nEntries);
+    BOOST_CHECK(usage2.nLinks > 2 * usage1.nLinks);
+    BOOST_CHECK(usage2.nSpends > usage1.nSpends);
+    BOOST_CHECK(usage2.nPoolAllocated > 0);
+
+    // The links are released with the child
+    pool.removeRecursive(tx2);
+    BOOST_CHECK_EQUAL(pool.GetMemoryUsage().nLinks, usage1.nLinks);
+    BOOST_CHECK_EQUAL(pool.GetMemoryUsage().Total(), pool.DynamicMemoryUsage());
+
+    // The signature hashes kept by the entries are part of their usage
+    const CTransaction tx(tx2);
+    auto precomTxData = std::make_shared<PrecomputedTransactionData>(tx);
+    CScript scriptCode;
+    for (int i = 0; i < 10; i++) {
+        scriptCode << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, i) << OP_EQUALVERIFY << OP_CHECKSIG;
+    }
+    for (unsigned int nIn = 0; nIn < tx.vin.size(); nIn++) {
+        precomTxData->GetSignatureHash(scriptCode, tx, nIn, SIGHASH_ALL, 10 * COIN, SIGVERSION_BASE);
+    }
+    BOOST_CHECK(precomTxData->DynamicMemoryUsage() > 2 * scriptCode.size());
+    CTxMemPoolEntry entry2 = entry.Fee(10000LL).FromTx(tx2);
+    const size_t nEntryUsage = entry2.DynamicMemoryUsage();
+    entry2.SetPrecomputedTxData(precomTxData);
+    BOOST_CHECK(entry2.DynamicMemoryUsage() >= nEntryUsage + precomTxData->DynamicMemoryUsage());
+    pool.addUnchecked(tx2.GetHash(), entry2);
+    BOOST_CHECK_EQUAL(pool.GetMemoryUsage().nTransactions, usage2.nTransactions + entry2.DynamicMemoryUsage() - nEntryUsage);
+    BOOST_CHECK_EQUAL(pool.GetMemoryUsage().Total(), pool.DynamicMemoryUsage());
+    pool.removeRecursive(tx2);
+    BOOST_CHECK_EQUAL(pool.GetMemoryUsage().nTransactions, usage1.nTransactions);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -96,6 +96,21 @@ void TestPackageSelection(const CChainParams& chainparams, CScript scriptPubKey,
     BOOST_CHECK(pblocktemplate->block.vtx[2]->GetHash() == hashHighFeeTx);
     BOOST_CHECK(pblocktemplate->block.vtx[3]->GetHash() == hashMediumFeeTx);
 
+    // The same selection with an unchanged mempool
+    std::unique_ptr<CBlockTemplate> pblocktemplate2 = BlockAssembler(chainparams, DEFAULT_PRINTPRIORITY).CreateNewBlock(scriptPubKey);
+    BOOST_CHECK_EQUAL(pblocktemplate2->block.vtx.size(), pblocktemplate->block.vtx.size());
+    for (size_t i = 1; i < pblocktemplate->block.vtx.size(); ++i) {
+        BOOST_CHECK(pblocktemplate2->block.vtx[i]->GetHash() == pblocktemplate->block.vtx[i]->GetHash());
+        BOOST_CHECK_EQUAL(pblocktemplate2->vTxFees[i], pblocktemplate->vTxFees[i]);
+    }
+    BOOST_CHECK(pblocktemplate2->block.vtx[0]->GetValueOut() == pblocktemplate->block.vtx[0]->GetValueOut());
+
+    // But not after a fee change
+    mempool.PrioritiseTransaction(hashMediumFeeTx, 1000000);
+    pblocktemplate2 = BlockAssembler(chainparams, DEFAULT_PRINTPRIORITY).CreateNewBlock(scriptPubKey);
+    BOOST_CHECK(pblocktemplate2->block.vtx[1]->GetHash() == hashMediumFeeTx);
+    mempool.PrioritiseTransaction(hashMediumFeeTx, -1000000);
+
     // Test that a package below the min relay fee doesn't get included
     tx.vin[0].prevout.hash = hashHighFeeTx;
     tx.vout[0].nValue = 5000000000LL - 1000 - 50000; // 0 fee
@@ -8,6 +8,7 @@
 #include "consensus/merkle.h"
 #include "masternode-payments.h"
 #include "masternodeman.h"
+#include "net_processing.h"
 #include "spork.h"
 #include "tiertwo/tiertwo_sync_state.h"
 #include "primitives/transaction.h"
@@ -314,4 +315,114 @@ BOOST_FIXTURE_TEST_CASE(mnwinner_test, TestChain100Setup)
     BOOST_CHECK_MESSAGE(stateInternal.IsValid(), stateInternal.GetRejectReason());
 }
 
+// A winner vote of a random voter, signed (with a legacy or a deterministic masternode key) by the voter,
+// or with another key if fBadSig
+static CMasternodePaymentWinner SignedMNWinner(bool fDeterministic, bool fBadSig, CKeyID& keyIDRet, CBLSPublicKey& pubKeyRet)
+{
+    CMasternodePaymentWinner winner(CTxIn(COutPoint(InsecureRand256(), 0)), 1000);
+    winner.AddPayee(GetScriptForDestination(CKeyID(uint160(InsecureRandBytes(20)))));
+    if (fDeterministic) {
+        CBLSSecretKey sk, otherSk;
+        sk.MakeNewKey();
+        otherSk.MakeNewKey();
+        BOOST_CHECK(winner.Sign(fBadSig ? otherSk : sk));
+        pubKeyRet = sk.GetPublicKey();
+    } else {
+        CKey key, otherKey;
+        key.MakeNewKey(true);
+        otherKey.MakeNewKey(true);
+        keyIDRet = key.GetPubKey().GetID();
+        const CKey& signKey = fBadSig ? otherKey : key;
+        BOOST_CHECK(winner.Sign(signKey, signKey.GetPubKey().GetID()));
+    }
+    return winner;
+}
+
+static bool IsMNWinnerAccepted(const CMasternodePaymentWinner& winner)
+{
+    LOCK(cs_mapMasternodePayeeVotes);
+    return masternodePayments.mapMasternodePayeeVotes.count(winner.GetHash());
+}
+
+static int GetMisbehavior(NodeId nodeId)
+{
+    CNodeStateStats stats;
+    BOOST_CHECK(GetNodeStateStats(nodeId, stats));
+    return stats.nMisbehavior;
+}
+
+BOOST_FIXTURE_TEST_CASE(mnwinner_votes_verifier_test, TestingSetup)
+{
+    CAddress addr1(CService(CNetAddr(in_addr{0x0200a8c0}), Params().GetDefaultPort()), NODE_NONE);
+    CAddress addr2(CService(CNetAddr(in_addr{0x0300a8c0}), Params().GetDefaultPort()), NODE_NONE);
+    CNode node1(0, NODE_NETWORK, 0, INVALID_SOCKET, addr1, 0, 0, "", true);
+    CNode node2(1, NODE_NETWORK, 0, INVALID_SOCKET, addr2, 1, 1, "", true);
+    peerLogic->InitializeNode(&node1);
+    peerLogic->InitializeNode(&node2);
+
+    // Not running: the votes are processed in place
+    CKeyID keyID;
+    CBLSPublicKey pubKey;
+    BOOST_CHECK(!QueueMNWinnerVerification(SignedMNWinner(false, false, keyID, pubKey), node1.GetId(), keyID, pubKey));
+
+    StartMNWinnerVotesVerification(3);
+
+    // 1) A batch of valid votes, legacy and deterministic, all accepted
+    std::vector<CMasternodePaymentWinner> vWinners;
+    for (int i = 0; i < 20; i++) {
+        CKeyID voteKeyID;
+        CBLSPublicKey votePubKey;
+        vWinners.emplace_back(SignedMNWinner(i % 2, false, voteKeyID, votePubKey));
+        BOOST_CHECK(QueueMNWinnerVerification(vWinners.back(), node1.GetId(), voteKeyID, votePubKey));
+    }
+    SyncWithMNWinnerVotesVerification();
+    for (const auto& winner : vWinners) {
+        BOOST_CHECK(IsMNWinnerAccepted(winner));
+    }
+    BOOST_CHECK_EQUAL(GetMisbehavior(node1.GetId()), 0);
+
+    // 2) A batch with one bad vote of each kind, from node2: only they are rejected,
+    // the votes of node1 verified in the same BLS batch are accepted
+    vWinners.clear();
+    std::vector<CMasternodePaymentWinner> vBadWinners;
+    for (int i = 0; i < 10; i++) {
+        const bool fBad = i == 4 || i == 5;
+        CKeyID voteKeyID;
+        CBLSPublicKey votePubKey;
+        const CMasternodePaymentWinner& winner = SignedMNWinner(i % 2, fBad, voteKeyID, votePubKey);
+        (fBad ? vBadWinners : vWinners).emplace_back(winner);
+        BOOST_CHECK(QueueMNWinnerVerification(winner, (fBad ? node2 : node1).GetId(), voteKeyID, votePubKey));
+    }
+    SyncWithMNWinnerVotesVerification();
+    for (const auto& winner : vWinners) {
+        BOOST_CHECK(IsMNWinnerAccepted(winner));
+    }
+    for (const auto& winner : vBadWinners) {
+        BOOST_CHECK(!IsMNWinnerAccepted(winner));
+    }
+    BOOST_CHECK_EQUAL(GetMisbehavior(node1.GetId()), 0);
+    BOOST_CHECK_EQUAL(GetMisbehavior(node2.GetId()), 40);
+    BOOST_CHECK(!WITH_LOCK(cs_main, return IsBanned(node2.GetId())));
+
+    // 3) The source of the bad votes is banned once it reaches the ban score
+    for (int i = 0; i < 3; i++) {
+        CKeyID voteKeyID;
+        CBLSPublicKey votePubKey;
+        const CMasternodePaymentWinner& winner = SignedMNWinner(i % 2, true, voteKeyID, votePubKey);
+        BOOST_CHECK(QueueMNWinnerVerification(winner, node2.GetId(), voteKeyID, votePubKey));
+    }
+    SyncWithMNWinnerVotesVerification();
+    BOOST_CHECK_EQUAL(GetMisbehavior(node2.GetId()), 100);
+    BOOST_CHECK(WITH_LOCK(cs_main, return IsBanned(node2.GetId())));
+    BOOST_CHECK(!WITH_LOCK(cs_main, return IsBanned(node1.GetId())));
+
+    StopMNWinnerVotesVerification();
+    BOOST_CHECK(!QueueMNWinnerVerification(SignedMNWinner(true, false, keyID, pubKey), node1.GetId(), keyID, pubKey));
+
+    bool fUpdateConnectionTime = false;
+    peerLogic->FinalizeNode(node1.GetId(), fUpdateConnectionTime);
+    peerLogic->FinalizeNode(node2.GetId(), fUpdateConnectionTime);
+    masternodePayments.Clear();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
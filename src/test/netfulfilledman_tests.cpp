@@ -18,7 +18,7 @@ BOOST_AUTO_TEST_CASE(netfulfilledman_simple_add_and_expire)
 
     CNetFulfilledRequestManager fulfilledMan(DEFAULT_ITEMS_FILTER_SIZE);
     CService service = LookupNumeric("1.1.1.1", 9999);
-    std::string request = "request";
+    NetRequest request = NetRequest::BUDGET_SYNC_RECV;
     BOOST_ASSERT(!fulfilledMan.HasFulfilledRequest(service, request));
 
     // Add request
@@ -37,6 +37,33 @@ BOOST_AUTO_TEST_CASE(netfulfilledman_simple_add_and_expire)
     fulfilledMan.CheckAndRemove();
     BOOST_CHECK(fulfilledMan.Size() == 0);
 
+    // A renewed request isn't removed by the expiration of the previous one
+    fulfilledMan.AddFulfilledRequest(service, request);
+    SetMockTime(GetMockTime() + 30 * 60);
+    fulfilledMan.AddFulfilledRequest(service, request);
+    fulfilledMan.AddFulfilledRequest(service, NetRequest::MNW_SYNC_RECV);
+    SetMockTime(GetMockTime() + 30 * 60 + 1);
+    fulfilledMan.CheckAndRemove();
+    BOOST_CHECK(fulfilledMan.Size() == 1);
+    BOOST_CHECK(fulfilledMan.HasFulfilledRequest(service, request));
+    BOOST_CHECK(fulfilledMan.HasFulfilledRequest(service, NetRequest::MNW_SYNC_RECV));
+    BOOST_CHECK(!fulfilledMan.HasFulfilledRequest(service, NetRequest::SPORKS_SYNC));
+
+    // The cache file roundtrip keeps the requests
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << fulfilledMan;
+    CNetFulfilledRequestManager fulfilledMan2(0);
+    ss >> fulfilledMan2;
+    BOOST_CHECK(fulfilledMan2.Size() == 1);
+    BOOST_CHECK(fulfilledMan2.HasFulfilledRequest(service, request));
+    BOOST_CHECK(fulfilledMan2.HasFulfilledRequest(service, NetRequest::MNW_SYNC_RECV));
+
+    SetMockTime(GetMockTime() + 30 * 60);
+    fulfilledMan.CheckAndRemove();
+    fulfilledMan2.CheckAndRemove();
+    BOOST_CHECK(fulfilledMan.Size() == 0);
+    BOOST_CHECK(fulfilledMan2.Size() == 0);
+
     // Items filter, insertion and lookup.
     uint256 item(g_insecure_rand_ctx.rand256());
     fulfilledMan.AddItemRequest(service, item);
@@ -5,6 +5,7 @@
 
 #include "rpc/server.h"
 #include "rpc/client.h"
+#include "rpc/jsonwriter.h"
 
 #include "netbase.h"
 #include "util/system.h"
@@ -225,6 +226,66 @@ BOOST_AUTO_TEST_CASE(json_parse_errors)
     BOOST_CHECK_THROW(ParseNonRFCJSONValue("3J98t1WpEZ73CNmQviecrnyiWrnqRhWNL"), std::runtime_error);
 }
 
+BOOST_AUTO_TEST_CASE(json_stream_writer)
+{
+    UniValue inner(UniValue::VOBJ);
+    inner.pushKV("str", std::string("a\"b\\c\n\t\x01\x7f\xc3\xa9", 11));
+    inner.pushKV("num", 1.5);
+    inner.pushKV("neg", -42);
+    inner.pushKV("t", true);
+    inner.pushKV("f", false);
+    inner.pushKV("null", NullUniValue);
+    inner.pushKV("emptyobj", UniValue(UniValue::VOBJ));
+    inner.pushKV("emptyarr", UniValue(UniValue::VARR));
+    UniValue val(UniValue::VARR);
+    for (int i = 0; i < 50; i++) {
+        val.push_back(inner);
+        val.push_back(i);
+    }
+
+    // Same output as UniValue::write, with any chunk size
+    for (size_t nChunkSize : {(size_t) 1, (size_t) 7, (size_t) 100, DEFAULT_JSON_CHUNK_SIZE}) {
+        std::string str;
+        size_t nChunks = 0;
+        JSONStreamWriter writer([&](std::string&& chunk) { str += chunk; nChunks++; }, nChunkSize);
+        writer.Value(val);
+        writer.Flush();
+        BOOST_CHECK_EQUAL(str, val.write());
+        BOOST_CHECK_EQUAL(writer.GetSize(), str.size());
+        BOOST_CHECK(nChunkSize == DEFAULT_JSON_CHUNK_SIZE ? nChunks == 1 : nChunks > 1);
+    }
+
+    // Written value by value
+    std::string str;
+    JSONStreamWriter writer([&](std::string&& chunk) { str += chunk; });
+    writer.BeginObject();
+    writer.KeyValue("inner", inner);
+    writer.Key("arr").BeginArray().Value(1).BeginArray().EndArray().Value("x").EndArray();
+    writer.Key("obj").BeginObject().EndObject();
+    writer.EndObject();
+    UniValue expected(UniValue::VOBJ);
+    expected.pushKV("inner", inner);
+    UniValue arr(UniValue::VARR);
+    arr.push_back(1);
+    arr.push_back(UniValue(UniValue::VARR));
+    arr.push_back("x");
+    expected.pushKV("arr", arr);
+    expected.pushKV("obj", UniValue(UniValue::VOBJ));
+    BOOST_CHECK(str.empty());
+    BOOST_CHECK_EQUAL(writer.Release(), expected.write());
+
+    // JSON-RPC replies
+    std::string strReply;
+    JSONStreamWriter replyWriter([&](std::string&& chunk) { strReply += chunk; }, 5);
+    JSONRPCReply(replyWriter, val, NullUniValue, 1);
+    strReply += replyWriter.Release() + "\n";
+    BOOST_CHECK_EQUAL(strReply, JSONRPCReply(val, NullUniValue, 1));
+    strReply.clear();
+    JSONRPCReply(replyWriter, val, JSONRPCError(RPC_MISC_ERROR, "error"), "id");
+    strReply += replyWriter.Release() + "\n";
+    BOOST_CHECK_EQUAL(strReply, JSONRPCReply(val, JSONRPCError(RPC_MISC_ERROR, "error"), "id"));
+}
+
 BOOST_AUTO_TEST_CASE(rpc_ban)
 {
     BOOST_CHECK_NO_THROW(CallRPC(std::string("clearbanned")));
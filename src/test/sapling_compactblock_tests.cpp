@@ -0,0 +1,109 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "test/test_pivx.h"
+
+#include "chain.h"
+#include "primitives/block.h"
+#include "random.h"
+#include "sapling/sapling_compactblock.h"
+#include "streams.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(sapling_compactblock_tests, BasicTestingSetup)
+
+static OutputDescription RandomOutput()
+{
+    OutputDescription output;
+    output.cv = GetRandHash();
+    output.cmu = GetRandHash();
+    output.ephemeralKey = GetRandHash();
+    GetRandBytes(output.encCiphertext.data(), output.encCiphertext.size());
+    return output;
+}
+
+BOOST_AUTO_TEST_CASE(compact_sapling_txs)
+{
+    CBlock block;
+    // A transparent transaction, skipped
+    CMutableTransaction tx_transparent;
+    tx_transparent.vout.emplace_back(100, CScript() << OP_TRUE);
+    block.vtx.emplace_back(MakeTransactionRef(tx_transparent));
+
+    // A shielded transaction with two spends and an output
+    CMutableTransaction tx_shielded;
+    tx_shielded.nVersion = CTransaction::TxVersion::SAPLING;
+    tx_shielded.sapData->vShieldedSpend.resize(2);
+    tx_shielded.sapData->vShieldedSpend[0].nullifier = GetRandHash();
+    tx_shielded.sapData->vShieldedSpend[1].nullifier = GetRandHash();
+    tx_shielded.sapData->vShieldedOutput.emplace_back(RandomOutput());
+    block.vtx.emplace_back(MakeTransactionRef(tx_shielded));
+
+    // A sapling version transaction without shielded data, skipped
+    CMutableTransaction tx_sapling_transparent;
+    tx_sapling_transparent.nVersion = CTransaction::TxVersion::SAPLING;
+    tx_sapling_transparent.vout.emplace_back(200, CScript() << OP_TRUE);
+    block.vtx.emplace_back(MakeTransactionRef(tx_sapling_transparent));
+
+    // A shielding transaction, with two outputs only
+    CMutableTransaction tx_shielding;
+    tx_shielding.nVersion = CTransaction::TxVersion::SAPLING;
+    tx_shielding.sapData->vShieldedOutput.emplace_back(RandomOutput());
+    tx_shielding.sapData->vShieldedOutput.emplace_back(RandomOutput());
+    block.vtx.emplace_back(MakeTransactionRef(tx_shielding));
+
+    const std::vector<CompactSaplingTx> vtx = GetCompactSaplingTxs(block);
+    BOOST_CHECK_EQUAL(vtx.size(), 2);
+
+    BOOST_CHECK_EQUAL(vtx[0].index, 1);
+    BOOST_CHECK(vtx[0].txid == block.vtx[1]->GetHash());
+    BOOST_CHECK_EQUAL(vtx[0].nullifiers.size(), 2);
+    BOOST_CHECK(vtx[0].nullifiers[0] == tx_shielded.sapData->vShieldedSpend[0].nullifier);
+    BOOST_CHECK(vtx[0].nullifiers[1] == tx_shielded.sapData->vShieldedSpend[1].nullifier);
+    BOOST_CHECK_EQUAL(vtx[0].outputs.size(), 1);
+
+    BOOST_CHECK_EQUAL(vtx[1].index, 3);
+    BOOST_CHECK(vtx[1].nullifiers.empty());
+    BOOST_CHECK_EQUAL(vtx[1].outputs.size(), 2);
+    for (size_t i = 0; i < vtx[1].outputs.size(); i++) {
+        const OutputDescription& output = tx_shielding.sapData->vShieldedOutput[i];
+        const CompactSaplingOutput& coutput = vtx[1].outputs[i];
+        BOOST_CHECK(coutput.cmu == output.cmu);
+        BOOST_CHECK(coutput.ephemeralKey == output.ephemeralKey);
+        BOOST_CHECK(std::equal(coutput.ciphertext.begin(), coutput.ciphertext.end(), output.encCiphertext.begin()));
+    }
+
+    // Header fields from the block index, and serialization round trip
+    CBlockIndex prev;
+    uint256 prevHash = GetRandHash();
+    prev.phashBlock = &prevHash;
+    CBlockIndex index;
+    uint256 hash = GetRandHash();
+    index.phashBlock = &hash;
+    index.pprev = &prev;
+    index.nHeight = 1000;
+    index.nTime = 1650000000;
+    index.hashFinalSaplingRoot = GetRandHash();
+
+    CompactSaplingBlock cblock(&index);
+    cblock.vtx = vtx;
+    BOOST_CHECK_EQUAL(cblock.height, 1000);
+    BOOST_CHECK(cblock.hash == hash);
+    BOOST_CHECK(cblock.prevHash == prevHash);
+    BOOST_CHECK(cblock.saplingRoot == index.hashFinalSaplingRoot);
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << cblock;
+    CompactSaplingBlock cblock2;
+    ss >> cblock2;
+    BOOST_CHECK(ss.empty());
+    BOOST_CHECK_EQUAL(cblock2.height, cblock.height);
+    BOOST_CHECK_EQUAL(cblock2.time, cblock.time);
+    BOOST_CHECK(cblock2.hash == cblock.hash);
+    BOOST_CHECK_EQUAL(cblock2.vtx.size(), 2);
+    BOOST_CHECK(cblock2.vtx[1].outputs[1].ciphertext == cblock.vtx[1].outputs[1].ciphertext);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
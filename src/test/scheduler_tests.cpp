@@ -144,4 +144,29 @@ BOOST_AUTO_TEST_CASE(singlethreadedscheduler_ordered)
     BOOST_CHECK_EQUAL(counter2, 100);
 }
 
+BOOST_AUTO_TEST_CASE(scheduler_priorities)
+{
+    CScheduler scheduler;
+    std::vector<int> order;
+
+    // All due before the thread starts: they run by priority, then by time
+    const std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
+    scheduler.schedule([&order]() { order.push_back(3); }, now - std::chrono::seconds(4), "low", CScheduler::Priority::LOW);
+    scheduler.schedule([&order]() { order.push_back(2); }, now - std::chrono::seconds(3), "normal");
+    scheduler.schedule([&order]() { order.push_back(0); }, now - std::chrono::seconds(2), "high", CScheduler::Priority::HIGH);
+    scheduler.schedule([&order]() { order.push_back(1); }, now - std::chrono::seconds(1), "high", CScheduler::Priority::HIGH);
+
+    scheduler.stop(true);
+    boost::thread thread(boost::bind(&CScheduler::serviceQueue, &scheduler));
+    thread.join();
+
+    BOOST_CHECK(order == std::vector<int>({0, 1, 2, 3}));
+    const std::map<std::string, SchedulerTaskStats> stats = scheduler.GetTaskStats();
+    BOOST_CHECK_EQUAL(stats.size(), 3U);
+    BOOST_CHECK_EQUAL(stats.at("high").nRuns, 2U);
+    BOOST_CHECK_EQUAL(stats.at("normal").nRuns, 1U);
+    BOOST_CHECK_EQUAL(stats.at("low").nRuns, 1U);
+    BOOST_CHECK(stats.at("low").nDelayMax >= 4 * 1000 * 1000);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
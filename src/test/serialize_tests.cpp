@@ -3,6 +3,7 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or https://www.opensource.org/licenses/mit-license.php.
 
+#include "chain.h"
 #include "optional.h"
 #include "serialize.h"
 #include "streams.h"
@@ -400,4 +401,33 @@ BOOST_AUTO_TEST_CASE(class_methods)
     BOOST_CHECK(methodtest3 == methodtest4);
 }
 
+BOOST_AUTO_TEST_CASE(stake_modifier_bytes)
+{
+    // Serialized as the byte vector it replaced in the block index
+    for (size_t nSize : {0, 8, 32}) {
+        std::vector<unsigned char> vch(nSize);
+        for (size_t i = 0; i < nSize; i++) vch[i] = InsecureRandBits(8);
+        CStakeModifierBytes modifier;
+        modifier.assign(vch.data(), vch.size());
+        BOOST_CHECK_EQUAL(modifier.size(), nSize);
+
+        CDataStream ss(SER_DISK, 0);
+        ss << modifier;
+        CDataStream ssVector(SER_DISK, 0);
+        ssVector << vch;
+        BOOST_CHECK(ss.str() == ssVector.str());
+
+        CStakeModifierBytes modifier2;
+        ssVector >> modifier2;
+        BOOST_CHECK_EQUAL(modifier2.size(), nSize);
+        BOOST_CHECK(std::equal(vch.begin(), vch.end(), modifier2.begin()));
+    }
+
+    // Too large
+    CDataStream ss(SER_DISK, 0);
+    ss << std::vector<unsigned char>(33);
+    CStakeModifierBytes modifier;
+    BOOST_CHECK_THROW(ss >> modifier, std::ios_base::failure);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -191,6 +191,27 @@ BOOST_AUTO_TEST_CASE(sighash_test)
     #endif
 }
 
+BOOST_AUTO_TEST_CASE(sighash_precomputed)
+{
+    for (int i = 0; i < 1000; i++) {
+        CMutableTransaction mtx;
+        RandomTransaction(mtx, false);
+        const CTransaction tx(mtx);
+        const PrecomputedTransactionData txdata(tx);
+        const SigVersion sigversion = tx.GetRequiredSigVersion();
+        for (int j = 0; j < 8; j++) {
+            // Few distinct hash types and scripts, to hit the cached signature hashes
+            const int nHashType = SIGHASH_ALL | (InsecureRandBool() ? SIGHASH_ANYONECANPAY : 0);
+            CScript scriptCode;
+            if (InsecureRandBool()) RandomScript(scriptCode);
+            const unsigned int nIn = InsecureRandRange(tx.vin.size());
+            const CAmount amount = InsecureRandRange(3);
+            BOOST_CHECK(txdata.GetSignatureHash(scriptCode, tx, nIn, nHashType, amount, sigversion) ==
+                        SignatureHash(scriptCode, tx, nIn, nHashType, amount, sigversion));
+        }
+    }
+}
+
 // Goal: check that SignatureHash generates correct hash
 // TODO: Update with Sapling transactions..
 BOOST_AUTO_TEST_CASE(sighash_from_data)
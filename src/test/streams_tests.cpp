@@ -68,6 +68,29 @@ BOOST_AUTO_TEST_CASE(streams_vector_writer)
     vch.clear();
 }
 
+BOOST_AUTO_TEST_CASE(streams_swap_buffer)
+{
+    CDataStream ss(SER_NETWORK, INIT_PROTO_VERSION);
+    ss << uint32_t(1) << uint32_t(2);
+    uint32_t n;
+    ss >> n;
+
+    // The buffers are exchanged with their capacity, and reading restarts from the start
+    CSerializeData buffer;
+    buffer.reserve(1024);
+    ss.swap_buffer(buffer);
+    BOOST_CHECK(ss.empty());
+    BOOST_CHECK_EQUAL(buffer.size(), 8U);
+    ss << uint32_t(3);
+    ss >> n;
+    BOOST_CHECK_EQUAL(n, 3U);
+    BOOST_CHECK(ss.empty());
+    ss.swap_buffer(buffer);
+    BOOST_CHECK_EQUAL(buffer.capacity(), 1024U);
+    ss >> n;
+    BOOST_CHECK_EQUAL(n, 1U);
+}
+
 BOOST_AUTO_TEST_CASE(streams_buffered_file)
 {
     FILE* file = fsbridge::fopen("streams_test_tmp", "w+b");
@@ -4,6 +4,9 @@
 
 #include "sync.h"
 #include "test/test_pivx.h"
+#include "utiltime.h"
+
+#include <thread>
 
 #include <boost/test/unit_test.hpp>
 
@@ -49,4 +52,49 @@ BOOST_AUTO_TEST_CASE(potential_deadlock_detected)
     #endif
 }
 
+BOOST_AUTO_TEST_CASE(lock_stats)
+{
+    auto findEntry = [](const std::string& name) {
+        for (const LockStatsEntry& entry : GetLockStatsEntries()) {
+            if (entry.name == name) return entry;
+        }
+        return LockStatsEntry{};
+    };
+    Mutex statsMutex;
+
+    // Nothing is gathered while disabled
+    {
+        LOCK(statsMutex);
+    }
+    BOOST_CHECK(findEntry("statsMutex").name.empty());
+
+    g_lock_stats = true;
+    {
+        LOCK(statsMutex);
+    }
+    {
+        WAIT_LOCK(statsMutex, lock);
+        // Contended by another thread
+        std::thread t([&statsMutex] { LOCK(statsMutex); });
+        UninterruptibleSleep(std::chrono::milliseconds{20});
+        REVERSE_LOCK(lock);
+        t.join();
+    }
+    g_lock_stats = false;
+
+    LockStatsEntry entry = findEntry("statsMutex");
+    BOOST_CHECK_EQUAL(entry.file, __FILE__);
+    BOOST_CHECK_EQUAL(entry.nLocks, 3U);
+    BOOST_CHECK_EQUAL(entry.nContentions, 1U);
+    BOOST_CHECK(entry.nWaitTotal > 0);
+    BOOST_CHECK_EQUAL(entry.nWaitTotal, entry.nWaitMax);
+    BOOST_CHECK(entry.nHoldMax >= entry.nWaitMax);
+    BOOST_CHECK(entry.nHoldTotal >= entry.nHoldMax);
+
+    ResetLockStats();
+    entry = findEntry("statsMutex");
+    BOOST_CHECK_EQUAL(entry.nLocks, 0U);
+    BOOST_CHECK_EQUAL(entry.nHoldTotal, 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
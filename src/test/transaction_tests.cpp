@@ -254,6 +254,28 @@ BOOST_AUTO_TEST_CASE(basic_transaction_tests)
     BOOST_CHECK_MESSAGE(!CheckTransaction(tx, state, false) || !state.IsValid(), "Transaction with duplicate txins should be invalid.");
 }
 
+BOOST_AUTO_TEST_CASE(deserialize_moved_transaction)
+{
+    // The deserializing constructor takes the data of the mutable transaction it reads
+    CMutableTransaction mtx;
+    mtx.nVersion = CTransaction::TxVersion::SAPLING;
+    mtx.nType = CTransaction::TxType::PROREG;
+    mtx.vin.emplace_back(COutPoint(GetRandHash(), 0));
+    mtx.vout.emplace_back(1 * COIN, CScript() << OP_TRUE);
+    mtx.sapData->vShieldedOutput.emplace_back();
+    mtx.extraPayload = std::vector<uint8_t>(100, 0x01);
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << mtx;
+
+    const CTransaction tx(deserialize, ss);
+    BOOST_CHECK(ss.empty());
+    BOOST_CHECK_EQUAL(tx.GetHash(), mtx.GetHash());
+    BOOST_CHECK_EQUAL(tx.vin.size(), 1U);
+    BOOST_CHECK_EQUAL(tx.vout.size(), 1U);
+    BOOST_CHECK_EQUAL(tx.sapData->vShieldedOutput.size(), 1U);
+    BOOST_CHECK(tx.extraPayload && tx.extraPayload->size() == 100);
+}
+
 //
 // Helper: create two dummy transactions, each with
 // two outputs.  The first has 11 and 50 CENT outputs
@@ -0,0 +1,112 @@
+// Copyright (c) 2017-2018 The Bitcoin Core developers
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "test/test_pivx.h"
+
+#include "index/txindex.h"
+#include "script/standard.h"
+#include "txdb.h"
+#include "utiltime.h"
+#include "validation.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(txindex_tests)
+
+BOOST_FIXTURE_TEST_CASE(txindex_initial_sync, TestChain100Setup)
+{
+    TxIndex txindex(1 << 20, true);
+
+    CTransactionRef tx_disk;
+    uint256 block_hash;
+
+    // Transaction should not be found in the index before it is started.
+    for (const auto& txn : coinbaseTxns) {
+        BOOST_CHECK(!txindex.FindTx(txn.GetHash(), block_hash, tx_disk));
+    }
+
+    // BlockUntilSyncedToCurrentChain should return false before txindex is started.
+    BOOST_CHECK(!txindex.BlockUntilSyncedToCurrentChain());
+
+    txindex.Start();
+
+    // Allow tx index to catch up with the block index.
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!txindex.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    // Check that txindex has all txs that were in the chain before it started.
+    for (const auto& txn : coinbaseTxns) {
+        if (!txindex.FindTx(txn.GetHash(), block_hash, tx_disk)) {
+            BOOST_ERROR("FindTx failed");
+        } else if (tx_disk->GetHash() != txn.GetHash()) {
+            BOOST_ERROR("Read incorrect tx");
+        }
+    }
+
+    // Check that new transactions in new blocks make it into the index.
+    const CScript coinbase_script_pub_key = GetScriptForDestination(coinbaseKey.GetPubKey().GetID());
+    for (int i = 0; i < 10; i++) {
+        std::vector<CMutableTransaction> no_txns;
+        const CBlock& block = CreateAndProcessBlock(no_txns, coinbase_script_pub_key);
+        const CTransaction& txn = *block.vtx[0];
+
+        BOOST_CHECK(txindex.BlockUntilSyncedToCurrentChain());
+        if (!txindex.FindTx(txn.GetHash(), block_hash, tx_disk)) {
+            BOOST_ERROR("FindTx failed");
+        } else if (tx_disk->GetHash() != txn.GetHash()) {
+            BOOST_ERROR("Read incorrect tx");
+        }
+        BOOST_CHECK(block_hash == block.GetHash());
+    }
+
+    txindex.Stop();
+}
+
+BOOST_FIXTURE_TEST_CASE(txindex_migration, TestChain100Setup)
+{
+    // Write the entries of the chain to the block tree DB, as the previous versions did in ConnectBlock
+    {
+        LOCK(cs_main);
+        for (int nHeight = 0; nHeight <= chainActive.Height(); nHeight++) {
+            const CBlockIndex* pindex = chainActive[nHeight];
+            CBlock block;
+            BOOST_REQUIRE(ReadBlockFromDisk(block, pindex));
+            CDiskTxPos pos(pindex->GetBlockPos(), GetSizeOfCompactSize(block.vtx.size()));
+            CDBBatch batch(CLIENT_VERSION);
+            for (const auto& tx : block.vtx) {
+                batch.Write(std::make_pair('t', tx->GetHash()), pos);
+                pos.nTxOffset += ::GetSerializeSize(*tx, CLIENT_VERSION);
+            }
+            BOOST_REQUIRE(pblocktree->WriteBatch(batch));
+        }
+        BOOST_REQUIRE(pblocktree->WriteFlag("txindex", true));
+    }
+
+    // The entries are moved to the new database, which is then in sync with the chain
+    TxIndex txindex(1 << 20, true);
+    txindex.Start();
+    BOOST_CHECK(txindex.IsSynced());
+    CTransactionRef tx_disk;
+    uint256 block_hash;
+    for (const auto& txn : coinbaseTxns) {
+        if (!txindex.FindTx(txn.GetHash(), block_hash, tx_disk)) {
+            BOOST_ERROR("FindTx failed");
+        } else if (tx_disk->GetHash() != txn.GetHash()) {
+            BOOST_ERROR("Read incorrect tx");
+        }
+        BOOST_CHECK(!pblocktree->Exists(std::make_pair('t', txn.GetHash())));
+    }
+    bool fLegacyFlag = true;
+    BOOST_CHECK(pblocktree->ReadFlag("txindex", fLegacyFlag));
+    BOOST_CHECK(!fLegacyFlag);
+
+    txindex.Stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,130 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "test/test_pivx.h"
+
+#include "random.h"
+#include "txreconciliation.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(txreconciliation_tests, BasicTestingSetup)
+
+static uint32_t RandElement()
+{
+    return 1 + InsecureRand32() % 0xFFFFFFFF;
+}
+
+BOOST_AUTO_TEST_CASE(sketch_decode)
+{
+    for (size_t capacity : {1, 2, 7, 20, 64}) {
+        for (size_t nDiff = 0; nDiff <= capacity; nDiff++) {
+            // Two sets with 50 common elements, and nDiff elements in only one of them
+            CTxSketch sketch1(capacity), sketch2(capacity);
+            for (int i = 0; i < 50; i++) {
+                const uint32_t e = RandElement();
+                sketch1.Add(e);
+                sketch2.Add(e);
+            }
+            std::set<uint32_t> diff;
+            while (diff.size() < nDiff) {
+                const uint32_t e = RandElement();
+                if (!diff.insert(e).second) continue;
+                (diff.size() % 2 ? sketch1 : sketch2).Add(e);
+            }
+            // Serialization of the merged sketch
+            sketch1.Merge(CTxSketch(sketch2.GetSyndromes()));
+            std::vector<uint32_t> decoded;
+            BOOST_CHECK(sketch1.Decode(decoded));
+            BOOST_CHECK(std::set<uint32_t>(decoded.begin(), decoded.end()) == diff);
+        }
+    }
+
+    // Too many elements
+    CTxSketch sketch(10);
+    for (int i = 0; i < 15; i++) {
+        sketch.Add(RandElement());
+    }
+    std::vector<uint32_t> decoded;
+    BOOST_CHECK(!sketch.Decode(decoded) || decoded.size() == sketch.Capacity());
+}
+
+BOOST_AUTO_TEST_CASE(reconciliation_round)
+{
+    // "initiator" reconciles with its outbound peer (node 1), the "responder" with its inbound peer (node 2)
+    TxReconciliationTracker initiator, responder;
+    const NodeId outboundPeer = 1, inboundPeer = 2;
+    const uint64_t initiatorSalt = initiator.PreRegisterPeer(outboundPeer);
+    const uint64_t responderSalt = responder.PreRegisterPeer(inboundPeer);
+    BOOST_CHECK(!initiator.IsPeerRegistered(outboundPeer));
+    BOOST_CHECK(!initiator.RegisterPeer(outboundPeer, false, 0, responderSalt));
+    BOOST_CHECK(initiator.RegisterPeer(outboundPeer, false, TXRECONCILIATION_PROTO_VERSION, responderSalt));
+    BOOST_CHECK(responder.RegisterPeer(inboundPeer, true, TXRECONCILIATION_PROTO_VERSION, initiatorSalt));
+    BOOST_CHECK(!responder.RegisterPeer(inboundPeer, true, TXRECONCILIATION_PROTO_VERSION, initiatorSalt));
+    BOOST_CHECK(initiator.IsPeerRegistered(outboundPeer));
+
+    // Nothing is flooded to inbound peers
+    BOOST_CHECK(!responder.ShouldFloodTo(inboundPeer, InsecureRand256()));
+
+    std::set<uint256> common, onlyInitiator, onlyResponder;
+    for (int i = 0; i < 100; i++) common.insert(InsecureRand256());
+    for (int i = 0; i < 5; i++) onlyInitiator.insert(InsecureRand256());
+    for (int i = 0; i < 8; i++) onlyResponder.insert(InsecureRand256());
+    for (const uint256& txid : common) {
+        BOOST_CHECK(initiator.AddToSet(outboundPeer, txid));
+        BOOST_CHECK(responder.AddToSet(inboundPeer, txid));
+    }
+    for (const uint256& txid : onlyInitiator) BOOST_CHECK(initiator.AddToSet(outboundPeer, txid));
+    for (const uint256& txid : onlyResponder) BOOST_CHECK(responder.AddToSet(inboundPeer, txid));
+
+    // Only the initiator requests the reconciliations, one at a time
+    std::chrono::microseconds now{GetTimeMicros()};
+    uint16_t nSetSize;
+    BOOST_CHECK(!responder.InitiateReconciliation(inboundPeer, now, nSetSize));
+    BOOST_CHECK(initiator.InitiateReconciliation(outboundPeer, now, nSetSize));
+    BOOST_CHECK_EQUAL(nSetSize, common.size() + onlyInitiator.size());
+    BOOST_CHECK(!initiator.InitiateReconciliation(outboundPeer, now + RECON_REQUEST_INTERVAL, nSetSize));
+
+    std::vector<uint32_t> vSketch;
+    BOOST_CHECK(responder.HandleReconciliationRequest(inboundPeer, nSetSize, vSketch));
+    BOOST_CHECK(!vSketch.empty());
+
+    bool fSuccess = false;
+    std::vector<uint256> vAnnounced;
+    std::vector<uint32_t> vRequested;
+    BOOST_CHECK(initiator.HandleSketch(outboundPeer, vSketch, fSuccess, vAnnounced, vRequested));
+    BOOST_CHECK(fSuccess);
+    BOOST_CHECK(std::set<uint256>(vAnnounced.begin(), vAnnounced.end()) == onlyInitiator);
+    BOOST_CHECK_EQUAL(vRequested.size(), onlyResponder.size());
+    // Not waiting for a sketch anymore
+    BOOST_CHECK(!initiator.HandleSketch(outboundPeer, vSketch, fSuccess, vAnnounced, vRequested));
+
+    std::vector<uint256> vResponderAnnounced;
+    BOOST_CHECK(responder.HandleReconciliationDiff(inboundPeer, true, vRequested, vResponderAnnounced));
+    BOOST_CHECK(std::set<uint256>(vResponderAnnounced.begin(), vResponderAnnounced.end()) == onlyResponder);
+    BOOST_CHECK(!responder.HandleReconciliationDiff(inboundPeer, true, vRequested, vResponderAnnounced));
+
+    // Too big difference: both sets are flooded
+    std::set<uint256> bigResponderSet;
+    for (size_t i = 0; i < MAX_SKETCH_CAPACITY * 2; i++) {
+        bigResponderSet.insert(InsecureRand256());
+    }
+    for (const uint256& txid : bigResponderSet) BOOST_CHECK(responder.AddToSet(inboundPeer, txid));
+    const uint256& initiatorTx = InsecureRand256();
+    BOOST_CHECK(initiator.AddToSet(outboundPeer, initiatorTx));
+    now += RECON_REQUEST_INTERVAL;
+    BOOST_CHECK(initiator.InitiateReconciliation(outboundPeer, now, nSetSize));
+    BOOST_CHECK(responder.HandleReconciliationRequest(inboundPeer, nSetSize, vSketch));
+    BOOST_CHECK(initiator.HandleSketch(outboundPeer, vSketch, fSuccess, vAnnounced, vRequested));
+    BOOST_CHECK(!fSuccess);
+    BOOST_CHECK(vAnnounced.size() == 1 && vAnnounced[0] == initiatorTx);
+    BOOST_CHECK(responder.HandleReconciliationDiff(inboundPeer, false, vRequested, vResponderAnnounced));
+    BOOST_CHECK(std::set<uint256>(vResponderAnnounced.begin(), vResponderAnnounced.end()) == bigResponderSet);
+
+    initiator.ForgetPeer(outboundPeer);
+    BOOST_CHECK(!initiator.IsPeerRegistered(outboundPeer));
+    BOOST_CHECK(!initiator.AddToSet(outboundPeer, InsecureRand256()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -86,4 +86,45 @@ BOOST_FIXTURE_TEST_CASE(tx_mempool_block_doublespend, TestChain100Setup)
     BOOST_CHECK_EQUAL(mempool.size(), 0);
 }
 
+BOOST_FIXTURE_TEST_CASE(checkinputs_script_cache, TestChain100Setup)
+{
+    CScript scriptPubKey = CScript() <<  ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+
+    CMutableTransaction spend;
+    spend.nVersion = 1;
+    spend.vin.resize(1);
+    spend.vin[0].prevout.hash = coinbaseTxns[0].GetHash();
+    spend.vin[0].prevout.n = 0;
+    spend.vout.resize(1);
+    spend.vout[0].nValue = 11*CENT;
+    spend.vout[0].scriptPubKey = scriptPubKey;
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(scriptPubKey, spend, 0, SIGHASH_ALL, 0, SIGVERSION_BASE);
+    BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    spend.vin[0].scriptSig << vchSig;
+    const CTransaction tx(spend);
+
+    LOCK(cs_main);
+    CValidationState state;
+    PrecomputedTransactionData txdata(tx);
+    const unsigned int flags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_DERSIG;
+    std::vector<CScriptCheck> vChecks;
+
+    // Not in the cache: the script check is pushed
+    BOOST_CHECK(CheckInputs(tx, state, *pcoinsTip, true, flags, false, false, txdata, &vChecks));
+    BOOST_CHECK_EQUAL(vChecks.size(), 1U);
+
+    // Checked inline and stored: the next check with the same flags is skipped (and erases the entry)
+    BOOST_CHECK(CheckInputs(tx, state, *pcoinsTip, true, flags, false, true, txdata));
+    vChecks.clear();
+    BOOST_CHECK(CheckInputs(tx, state, *pcoinsTip, true, flags | SCRIPT_VERIFY_LOW_S, false, false, txdata, &vChecks));
+    BOOST_CHECK_EQUAL(vChecks.size(), 1U);
+    vChecks.clear();
+    BOOST_CHECK(CheckInputs(tx, state, *pcoinsTip, true, flags, false, false, txdata, &vChecks));
+    BOOST_CHECK(vChecks.empty());
+    BOOST_CHECK(CheckInputs(tx, state, *pcoinsTip, true, flags, false, false, txdata, &vChecks));
+    BOOST_CHECK_EQUAL(vChecks.size(), 1U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
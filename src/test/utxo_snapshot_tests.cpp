@@ -0,0 +1,60 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "test/test_pivx.h"
+
+#include "hash.h"
+#include "txdb.h"
+#include "utxo_snapshot.h"
+#include "validation.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <fstream>
+#include <iterator>
+
+BOOST_FIXTURE_TEST_SUITE(utxo_snapshot_tests, TestChain100Setup)
+
+static std::vector<unsigned char> ReadFile(const fs::path& path)
+{
+    std::ifstream file(path.string(), std::ios::binary);
+    return std::vector<unsigned char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+BOOST_AUTO_TEST_CASE(dump)
+{
+    const fs::path path = GetDataDir() / "utxo.dat";
+    SnapshotStats stats;
+    std::string strError;
+    BOOST_CHECK(DumpUTXOSnapshot(path, stats, strError));
+    const CBlockIndex* pindexTip = WITH_LOCK(cs_main, return chainActive.Tip(); );
+    BOOST_CHECK(stats.baseBlockHash == pindexTip->GetBlockHash());
+    BOOST_CHECK_EQUAL(stats.nBaseHeight, pindexTip->nHeight);
+
+    // Every coin of the database is exported
+    uint64_t nCoins = 0;
+    std::unique_ptr<CCoinsViewCursor> pcursor(pcoinsdbview->Cursor());
+    for (; pcursor->Valid(); pcursor->Next()) {
+        nCoins++;
+    }
+    BOOST_CHECK(stats.nCoins > 0);
+    BOOST_CHECK_EQUAL(stats.nCoins, nCoins);
+
+    // The file ends with the hash of its content
+    const std::vector<unsigned char> vData = ReadFile(path);
+    BOOST_REQUIRE(vData.size() > 32);
+    CHashWriter hasher(SER_DISK, CLIENT_VERSION);
+    hasher.write((const char*)vData.data(), vData.size() - 32);
+    BOOST_CHECK(hasher.GetHash() == stats.hash);
+    BOOST_CHECK(uint256(std::vector<unsigned char>(vData.end() - 32, vData.end())) == stats.hash);
+
+    // The export is the same at the same tip
+    const fs::path path2 = GetDataDir() / "utxo2.dat";
+    SnapshotStats stats2;
+    BOOST_CHECK(DumpUTXOSnapshot(path2, stats2, strError));
+    BOOST_CHECK(stats2.hash == stats.hash);
+    BOOST_CHECK(ReadFile(path2) == vData);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -8,8 +8,10 @@
 #include "chainparams.h"
 #include "consensus/merkle.h"
 #include "consensus/validation.h"
+#include "evo/evodb.h"
 #include "pow.h"
 #include "random.h"
+#include "shutdown.h"
 #include "test/test_pivx.h"
 #include "util/blockstatecatcher.h"
 #include "validation.h"
@@ -165,4 +167,223 @@ BOOST_AUTO_TEST_CASE(processnewblock_signals_ordering)
     BOOST_CHECK_EQUAL(sub.m_expected_tip, WITH_LOCK(cs_main, return chainActive.Tip()->GetBlockHash()));
 }
 
+BOOST_AUTO_TEST_CASE(processnewblockheaders_batch)
+{
+    // A chain of headers going past the v3.4 upgrade (with the lowest version accepted on regtest)
+    const int nV34Height = Params().GetConsensus().vUpgrades[Consensus::UPGRADE_V3_4].nActivationHeight;
+    std::vector<CBlockHeader> headers;
+    uint256 hashPrev = Params().GenesisBlock().GetHash();
+    for (int i = 0; i < nV34Height + 10; i++) {
+        CBlockHeader header;
+        header.nVersion = 7;
+        header.hashPrevBlock = hashPrev;
+        header.hashMerkleRoot = InsecureRand256();
+        header.nTime = Params().GenesisBlock().nTime + (i + 1) * 60;
+        header.nBits = Params().GenesisBlock().nBits;
+        headers.push_back(header);
+        hashPrev = header.GetHash();
+    }
+
+    // Non-continuous sequence: nothing is added
+    std::vector<CBlockHeader> badHeaders(headers.begin(), headers.begin() + 20);
+    std::swap(badHeaders[5], badHeaders[6]);
+    CValidationState state;
+    CBlockIndex* pindexLast = nullptr;
+    int nDoS = 0;
+    BOOST_CHECK(!ProcessNewBlockHeaders(badHeaders, state, &pindexLast));
+    BOOST_CHECK(state.IsInvalid(nDoS) && nDoS == 20);
+    BOOST_CHECK(pindexLast == nullptr);
+    BOOST_CHECK(WITH_LOCK(cs_main, return LookupBlockIndex(headers[0].GetHash())) == nullptr);
+
+    // The headers are added up to the v3.4 upgrade
+    CValidationState state2;
+    BOOST_CHECK(ProcessNewBlockHeaders(headers, state2, &pindexLast));
+    BOOST_CHECK(pindexLast != nullptr);
+    BOOST_CHECK_EQUAL(pindexLast->nHeight, nV34Height - 1);
+    BOOST_CHECK_EQUAL(nBestHeaderHeight, nV34Height - 1);
+    BOOST_CHECK(pindexLast->GetBlockHash() == headers[nV34Height - 2].GetHash());
+    BOOST_CHECK(WITH_LOCK(cs_main, return LookupBlockIndex(headers[nV34Height - 1].GetHash())) == nullptr);
+
+    // Already known headers are accepted again
+    std::vector<CBlockHeader> knownHeaders(headers.begin(), headers.begin() + 20);
+    BOOST_CHECK(ProcessNewBlockHeaders(knownHeaders, state2, &pindexLast));
+    BOOST_CHECK_EQUAL(pindexLast->nHeight, 20);
+}
+
+BOOST_FIXTURE_TEST_CASE(chain_tip_snapshot, TestChain100Setup)
+{
+    auto checkSnapshot = [](const ChainTipSnapshot& snapshot, const CBlockIndex* pindex) {
+        BOOST_CHECK(snapshot.pindex == pindex);
+        BOOST_CHECK_EQUAL(snapshot.nHeight, pindex->nHeight);
+        BOOST_CHECK(snapshot.hash == pindex->GetBlockHash());
+        BOOST_CHECK_EQUAL(snapshot.nTime, pindex->GetBlockTime());
+        BOOST_CHECK_EQUAL(snapshot.nBits, pindex->nBits);
+        BOOST_CHECK(snapshot.nChainWork == pindex->nChainWork);
+    };
+    const auto snapshot = GetChainTipSnapshot();
+    BOOST_CHECK(snapshot);
+    CBlockIndex* pindexTip = WITH_LOCK(cs_main, return chainActive.Tip(); );
+    checkSnapshot(*snapshot, pindexTip);
+
+    // A new snapshot is published for the new tip, the previous one doesn't change
+    CreateAndProcessBlock({}, coinbaseKey);
+    const auto snapshot2 = GetChainTipSnapshot();
+    BOOST_CHECK_EQUAL(snapshot2->nHeight, snapshot->nHeight + 1);
+    checkSnapshot(*snapshot2, WITH_LOCK(cs_main, return chainActive.Tip(); ));
+    checkSnapshot(*snapshot, pindexTip);
+
+    // And for the tips set by a disconnection
+    {
+        LOCK(cs_main);
+        CValidationState state;
+        BOOST_CHECK(InvalidateBlock(state, Params(), chainActive.Tip()));
+    }
+    checkSnapshot(*GetChainTipSnapshot(), pindexTip);
+}
+
+BOOST_FIXTURE_TEST_CASE(lookup_block_index_shared, TestChain100Setup)
+{
+    // Found without cs_main, as with it
+    const CBlockIndex* pindexTip = WITH_LOCK(cs_main, return chainActive.Tip(); );
+    BOOST_CHECK(LookupBlockIndexShared(pindexTip->GetBlockHash()) == pindexTip);
+    BOOST_CHECK(LookupBlockIndexShared(pindexTip->pprev->GetBlockHash()) == pindexTip->pprev);
+    BOOST_CHECK(LookupBlockIndexShared(UINT256_ONE) == nullptr);
+
+    // And the new blocks once added
+    CBlock block = CreateAndProcessBlock({}, coinbaseKey);
+    CBlockIndex* pindex = LookupBlockIndexShared(block.GetHash());
+    BOOST_CHECK(pindex != nullptr);
+    BOOST_CHECK(pindex == WITH_LOCK(cs_main, return LookupBlockIndex(block.GetHash()); ));
+    BOOST_CHECK(pindex->pprev == pindexTip);
+    BOOST_CHECK_EQUAL(pindex->nHeight, pindexTip->nHeight + 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(block_processing_stats, TestChain100Setup)
+{
+    auto getCount = [](const std::string& stage) {
+        for (const auto& it : GetBlockProcessingStats()) {
+            if (it.first == stage) return it.second.nCount;
+        }
+        return (uint64_t)-1;
+    };
+    const uint64_t nConnectTip = getCount("connect_tip");
+    const uint64_t nSpecialTxs = getCount("special_txs");
+    BOOST_CHECK(nConnectTip >= 100);
+    CreateAndProcessBlock({}, coinbaseKey);
+    BOOST_CHECK_EQUAL(getCount("connect_tip"), nConnectTip + 1);
+    BOOST_CHECK_EQUAL(getCount("special_txs"), nSpecialTxs + 1);
+
+    // All the stages are there, each with a bucket per bound plus one
+    const auto stats = GetBlockProcessingStats();
+    BOOST_CHECK_EQUAL(stats.size(), (size_t)BlockStage::COUNT);
+    for (const auto& it : stats) {
+        BOOST_CHECK_EQUAL(it.second.buckets.size(), BLOCK_STAGE_BUCKET_BOUNDS.size() + 1);
+        BOOST_CHECK(it.second.nTotal >= it.second.nMax);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(reorg_disconnect_failure, TestChain100Setup)
+{
+    // A fork from height 95, one block longer than the chain: its reorg disconnects the last 5 blocks in a batch
+    const CScript forkScript = CScript() << OP_TRUE;
+    CBlockIndex* pindexPrev = WITH_LOCK(cs_main, return chainActive[95]; );
+    std::vector<std::shared_ptr<CBlock>> vForkBlocks;
+    for (int i = 0; i < 6; i++) {
+        auto pblock = std::make_shared<CBlock>(CreateBlock({}, forkScript, true, false, false, pindexPrev));
+        vForkBlocks.emplace_back(pblock);
+        if (i < 5) {
+            // Accepted on the side chain, the last one is processed below
+            BOOST_CHECK(ProcessNewBlock(pblock, nullptr));
+            pindexPrev = WITH_LOCK(cs_main, return LookupBlockIndex(pblock->GetHash()); );
+            BOOST_REQUIRE(pindexPrev);
+        }
+    }
+    BOOST_CHECK_EQUAL(WITH_LOCK(cs_main, return chainActive.Height(); ), 100);
+
+    // The undo data of the third block to disconnect is missing
+    CBlockIndex* pindexBroken = WITH_LOCK(cs_main, return chainActive[98]; );
+    WITH_LOCK(cs_main, pindexBroken->nStatus &= ~BLOCK_HAVE_UNDO; );
+    BOOST_CHECK(!ProcessNewBlock(vForkBlocks.back(), nullptr));
+
+    // The blocks above it are disconnected, as they would be one by one, and the chain state is consistent
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(chainActive.Tip() == pindexBroken);
+        BOOST_CHECK(pcoinsTip->GetBestBlock() == pindexBroken->GetBlockHash());
+        BOOST_CHECK(evoDb->VerifyBestBlock(pindexBroken->GetBlockHash()));
+    }
+
+    // The reorg completes once the undo data is back
+    AbortShutdown();
+    WITH_LOCK(cs_main, pindexBroken->nStatus |= BLOCK_HAVE_UNDO; );
+    CValidationState state;
+    BOOST_CHECK(ActivateBestChain(state));
+    LOCK(cs_main);
+    BOOST_CHECK(chainActive.Tip()->GetBlockHash() == vForkBlocks.back()->GetHash());
+    BOOST_CHECK_EQUAL(chainActive.Height(), 101);
+    BOOST_CHECK(pcoinsTip->GetBestBlock() == chainActive.Tip()->GetBlockHash());
+}
+
+BOOST_FIXTURE_TEST_CASE(spent_coins_cache, TestChain100Setup)
+{
+    // Spend the first coinbase
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    CMutableTransaction spend;
+    spend.vin.resize(1);
+    spend.vin[0].prevout = COutPoint(coinbaseTxns[0].GetHash(), 0);
+    spend.vout.resize(1);
+    spend.vout[0].nValue = 11 * CENT;
+    spend.vout[0].scriptPubKey = scriptPubKey;
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(scriptPubKey, spend, 0, SIGHASH_ALL, 0, SIGVERSION_BASE);
+    BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    spend.vin[0].scriptSig << vchSig;
+    const COutPoint& outpoint = spend.vin[0].prevout;
+
+    Coin coin;
+    BOOST_CHECK(!WITH_LOCK(cs_main, return GetRecentlySpentCoin(outpoint, coin); ));
+    CBlock block = CreateAndProcessBlock({spend}, scriptPubKey);
+    BOOST_CHECK(WITH_LOCK(cs_main, return chainActive.Tip()->GetBlockHash(); ) == block.GetHash());
+
+    // The coin spent by the block is cached
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(GetRecentlySpentCoin(outpoint, coin));
+        BOOST_CHECK(coin.out == coinbaseTxns[0].vout[0]);
+        BOOST_CHECK_EQUAL(coin.nHeight, 1U);
+        BOOST_CHECK(pcoinsTip->AccessCoin(outpoint).IsSpent());
+    }
+
+    // The disconnections of VerifyDB, on a temporary view, don't change it
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(CVerifyDB().VerifyDB(pcoinsTip.get(), 3, 6));
+        BOOST_CHECK(GetRecentlySpentCoin(outpoint, coin));
+    }
+
+    // The disconnection of the block removes it: the coin is unspent again
+    {
+        LOCK(cs_main);
+        CValidationState state;
+        BOOST_CHECK(InvalidateBlock(state, Params(), chainActive.Tip()));
+        BOOST_CHECK(!GetRecentlySpentCoin(outpoint, coin));
+        BOOST_CHECK(!pcoinsTip->AccessCoin(outpoint).IsSpent());
+        BOOST_CHECK(ReconsiderBlock(state, LookupBlockIndex(block.GetHash())));
+    }
+    CValidationState state;
+    BOOST_CHECK(ActivateBestChain(state));
+    BOOST_CHECK(WITH_LOCK(cs_main, return chainActive.Tip()->GetBlockHash(); ) == block.GetHash());
+    BOOST_CHECK(WITH_LOCK(cs_main, return GetRecentlySpentCoin(outpoint, coin); ));
+
+    // It's evicted once the block is deeper than the max reorg depth
+    const int nSpentHeight = WITH_LOCK(cs_main, return chainActive.Height(); );
+    while (WITH_LOCK(cs_main, return chainActive.Height(); ) < nSpentHeight + DEFAULT_MAX_REORG_DEPTH) {
+        CreateAndProcessBlock({}, scriptPubKey);
+    }
+    BOOST_CHECK(WITH_LOCK(cs_main, return GetRecentlySpentCoin(outpoint, coin); ));
+    CreateAndProcessBlock({}, scriptPubKey);
+    BOOST_CHECK(!WITH_LOCK(cs_main, return GetRecentlySpentCoin(outpoint, coin); ));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -41,4 +41,26 @@ BOOST_FIXTURE_TEST_CASE(accumulator_checksums_db, TestingSetup)
     BOOST_CHECK(empty_map.empty());
 }
 
+BOOST_FIXTURE_TEST_CASE(coin_spends_db, TestingSetup)
+{
+    std::vector<std::pair<CBigNum, uint256>> vSpends;
+    for (int i = 0; i < 20; i++) {
+        vSpends.emplace_back(CBigNum(InsecureRand256()), InsecureRand256());
+    }
+    BOOST_CHECK(zerocoinDB->WriteCoinSpendBatch(vSpends));
+
+    uint256 txHash;
+    for (const auto& it : vSpends) {
+        BOOST_CHECK(zerocoinDB->ReadCoinSpend(it.first, txHash));
+        BOOST_CHECK(txHash == it.second);
+    }
+    // unknown serials are filtered out without hitting the db
+    BOOST_CHECK(!zerocoinDB->ReadCoinSpend(CBigNum(InsecureRand256()), txHash));
+
+    // erased serials keep their fingerprint, but are not found in the db
+    BOOST_CHECK(zerocoinDB->EraseCoinSpend(vSpends[0].first));
+    BOOST_CHECK(!zerocoinDB->ReadCoinSpend(vSpends[0].first, txHash));
+    BOOST_CHECK(zerocoinDB->ReadCoinSpend(vSpends[1].first, txHash));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -5,6 +5,7 @@
 #include "tiertwo/init.h"
 
 #include "budget/budgetdb.h"
+#include "evo/deterministicmns.h"
 #include "evo/evodb.h"
 #include "evo/evonotificationinterface.h"
 #include "flatdb.h"
@@ -14,6 +15,7 @@
 #include "masternode-payments.h"
 #include "masternodeconfig.h"
 #include "llmq/quorums_init.h"
+#include "llmq/quorums_signing_shares.h"
 #include "scheduler.h"
 #include "tiertwo/masternode_meta_manager.h"
 #include "tiertwo/netfulfilledman.h"
@@ -24,6 +26,9 @@
 
 static std::unique_ptr<EvoNotificationInterface> pEvoNotificationInterface{nullptr};
 
+// Dump the tier two caches every 15 minutes, so that the shutdown only writes the files that changed since
+static const int DUMP_TIERTWO_INTERVAL = 15 * 60;
+
 std::string GetTierTwoHelpString(bool showDebug)
 {
     std::string strUsage = HelpMessageGroup("Masternode options:");
@@ -34,10 +39,16 @@ std::string GetTierTwoHelpString(bool showDebug)
     strUsage += HelpMessageOpt("-masternodeaddr=<n>", strprintf("Set external address:port to get to this masternode (example: %s). Only for Legacy Masternodes", "128.127.106.235:51472"));
     strUsage += HelpMessageOpt("-budgetvotemode=<mode>", "Change automatic finalized budget voting behavior. mode=auto: Vote for only exact finalized budget match to my generated budget. (string, default: auto)");
     strUsage += HelpMessageOpt("-mnoperatorprivatekey=<bech32>", "Set the masternode operator private key. Only valid with -masternode=1. When set, the masternode acts as a deterministic masternode.");
+    strUsage += HelpMessageOpt("-evodbcache=<n>", strprintf("Set the cache size of the deterministic masternodes and quorums database in megabytes (minimum %d, default: %d)", MIN_EVODB_CACHE, DEFAULT_EVODB_CACHE));
     if (showDebug) {
         strUsage += HelpMessageOpt("-pushversion", strprintf("Modifies the mnauth serialization if the version is lower than %d."
                                                              "testnet/regtest only; ", MNAUTH_NODE_VER_VERSION));
         strUsage += HelpMessageOpt("-disabledkg", "Disable the DKG sessions process threads for the entire lifecycle. testnet/regtest only.");
+        strUsage += HelpMessageOpt("-dmnsnapshotinterval=<n>", strprintf("Write the full deterministic masternode list to disk every <n> blocks (default: %u)", DEFAULT_DMN_SNAPSHOT_INTERVAL));
+        strUsage += HelpMessageOpt("-dmnlistscachesize=<n>", strprintf("Keep in memory the last <n> requested deterministic masternode lists (default: %u)", DEFAULT_DMN_LISTS_CACHE_SIZE));
+        strUsage += HelpMessageOpt("-budgetvoteverifythreads=<n>", strprintf("Verify the signatures of the budget votes in batches on <n> threads (0-%d, 0 = in the message processing thread, default: %d)", MAX_BUDGET_VOTE_VERIFY_THREADS, DEFAULT_BUDGET_VOTE_VERIFY_THREADS));
+        strUsage += HelpMessageOpt("-mnwverifythreads=<n>", strprintf("Verify the signatures of the masternode winner votes in batches on <n> threads (0-%d, 0 = in the message processing thread, default: %d)", MAX_MNW_VERIFY_THREADS, DEFAULT_MNW_VERIFY_THREADS));
+        strUsage += HelpMessageOpt("-llmqsigshareworkers=<n>", strprintf("Verify and recover the LLMQ signature shares in <n> concurrent shards (1-%d, default: %d)", llmq::MAX_SIGSHARES_WORKERS, llmq::DEFAULT_SIGSHARES_WORKERS));
     }
     return strUsage;
 }
@@ -45,7 +56,7 @@ std::string GetTierTwoHelpString(bool showDebug)
 void InitTierTwoInterfaces()
 {
     pEvoNotificationInterface = std::make_unique<EvoNotificationInterface>();
-    RegisterValidationInterface(pEvoNotificationInterface.get());
+    RegisterValidationInterface(pEvoNotificationInterface.get(), "evo");
 }
 
 void ResetTierTwoInterfaces()
@@ -64,17 +75,20 @@ void ResetTierTwoInterfaces()
 
 void InitTierTwoPreChainLoad(bool fReindex)
 {
-    int64_t nEvoDbCache = 1024 * 1024 * 64; // Max cache is 64MB
+    int64_t nEvoDbCache = std::max(gArgs.GetArg("-evodbcache", DEFAULT_EVODB_CACHE), MIN_EVODB_CACHE) << 20;
+    LogPrintf("* Using %.1fMiB for evo database\n", nEvoDbCache * (1.0 / 1024 / 1024));
     deterministicMNManager.reset();
     evoDb.reset();
     evoDb.reset(new CEvoDB(nEvoDbCache, false, fReindex));
-    deterministicMNManager.reset(new CDeterministicMNManager(*evoDb));
+    deterministicMNManager.reset(new CDeterministicMNManager(*evoDb,
+                                                             gArgs.GetArg("-dmnsnapshotinterval", DEFAULT_DMN_SNAPSHOT_INTERVAL),
+                                                             gArgs.GetArg("-dmnlistscachesize", DEFAULT_DMN_LISTS_CACHE_SIZE)));
 }
 
 void InitTierTwoPostCoinsCacheLoad(CScheduler* scheduler)
 {
     // Initialize LLMQ system
-    llmq::InitLLMQSystem(*evoDb, scheduler, false);
+    llmq::InitLLMQSystem(*evoDb, scheduler, false, gArgs.GetArg("-llmqsigshareworkers", llmq::DEFAULT_SIGSHARES_WORKERS));
 }
 
 void InitTierTwoChainTip()
@@ -192,9 +206,9 @@ bool LoadTierTwo(int chain_active_height, bool load_cache_files)
 
 void RegisterTierTwoValidationInterface()
 {
-    RegisterValidationInterface(&g_budgetman);
-    RegisterValidationInterface(&masternodePayments);
-    if (activeMasternodeManager) RegisterValidationInterface(activeMasternodeManager);
+    RegisterValidationInterface(&g_budgetman, "budget");
+    RegisterValidationInterface(&masternodePayments, "masternodepayments");
+    if (activeMasternodeManager) RegisterValidationInterface(activeMasternodeManager, "activemasternode");
 }
 
 void DumpTierTwo()
@@ -303,7 +317,11 @@ bool InitActiveMN()
 void StartTierTwoThreadsAndScheduleJobs(boost::thread_group& threadGroup, CScheduler& scheduler)
 {
     threadGroup.create_thread(std::bind(&ThreadCheckMasternodes));
-    scheduler.scheduleEvery(std::bind(&CNetFulfilledRequestManager::DoMaintenance, std::ref(g_netfulfilledman)), 60 * 1000);
+    StartBudgetVotesVerification(std::max(0, std::min((int)gArgs.GetArg("-budgetvoteverifythreads", DEFAULT_BUDGET_VOTE_VERIFY_THREADS), MAX_BUDGET_VOTE_VERIFY_THREADS)));
+    StartMNWinnerVotesVerification(std::max(0, std::min((int)gArgs.GetArg("-mnwverifythreads", DEFAULT_MNW_VERIFY_THREADS), MAX_MNW_VERIFY_THREADS)));
+    scheduler.scheduleEvery(std::bind(&CNetFulfilledRequestManager::DoMaintenance, std::ref(g_netfulfilledman)), 60 * 1000,
+                            "netfulfilled-maintenance", CScheduler::Priority::LOW);
+    scheduler.scheduleEvery(std::bind(&DumpTierTwo), DUMP_TIERTWO_INTERVAL * 1000, "dump-tiertwo", CScheduler::Priority::LOW);
 
     // Start LLMQ system
     if (gArgs.GetBoolArg("-disabledkg", false)) {
@@ -319,6 +337,8 @@ void StartTierTwoThreadsAndScheduleJobs(boost::thread_group& threadGroup, CSched
 
 void StopTierTwoThreads()
 {
+    StopMNWinnerVotesVerification();
+    StopBudgetVotesVerification();
     llmq::StopLLMQSystem();
 }
 
@@ -67,8 +67,20 @@ bool TierTwoConnMan::hasQuorumNodes(Consensus::LLMQType llmqType, const uint256&
 
 void TierTwoConnMan::removeQuorumNodes(Consensus::LLMQType llmqType, const uint256& quorumHash)
 {
+    const auto& consensus = Params().GetConsensus();
+    const int64_t standbyUntil = GetTime() + consensus.llmqs.at(llmqType).dkgInterval * consensus.nTargetSpacing;
+
     LOCK(cs_vPendingMasternodes);
-    masternodeQuorumNodes.erase(std::make_pair(llmqType, quorumHash));
+    auto it = masternodeQuorumNodes.find(std::make_pair(llmqType, quorumHash));
+    if (it == masternodeQuorumNodes.end()) {
+        return;
+    }
+    // Keep the authenticated connections warm for the upcoming DKG sessions
+    for (const auto& proTxHash : it->second) {
+        int64_t& until = masternodeStandbyNodes[proTxHash];
+        until = std::max(until, standbyUntil);
+    }
+    masternodeQuorumNodes.erase(it);
 }
 
 void TierTwoConnMan::setMasternodeQuorumRelayMembers(Consensus::LLMQType llmqType, const uint256& quorumHash, const std::set<uint256>& proTxHashes)
@@ -120,7 +132,8 @@ bool TierTwoConnMan::isMasternodeQuorumNode(const CNode* pnode)
             }
         }
     }
-    return false;
+    const uint256& proTxHash = pnode->verifiedProRegTxHash.IsNull() ? assumedProTxHash : pnode->verifiedProRegTxHash;
+    return !proTxHash.IsNull() && masternodeStandbyNodes.count(proTxHash);
 }
 
 bool TierTwoConnMan::isMasternodeQuorumRelayMember(const uint256& protxHash)
@@ -160,6 +173,7 @@ void TierTwoConnMan::clear()
     masternodeQuorumRelayMembers.clear();
     vPendingMasternodes.clear();
     masternodePendingProbes.clear();
+    masternodeStandbyNodes.clear();
 }
 
 void TierTwoConnMan::start(CScheduler& scheduler, const TierTwoConnMan::Options& options)
@@ -173,7 +187,7 @@ void TierTwoConnMan::start(CScheduler& scheduler, const TierTwoConnMan::Options&
     // Initiate masternode connections
     threadOpenMasternodeConnections = std::thread(&TraceThread<std::function<void()> >, "mncon", std::function<void()>(std::bind(&TierTwoConnMan::ThreadOpenMasternodeConnections, this)));
     // Cleanup process every 60 seconds
-    scheduler.scheduleEvery(std::bind(&TierTwoConnMan::doMaintenance, this), 60 * 1000);
+    scheduler.scheduleEvery(std::bind(&TierTwoConnMan::doMaintenance, this), 60 * 1000, "tiertwo-connman-maintenance");
 }
 
 void TierTwoConnMan::stop() {
@@ -413,6 +427,14 @@ void TierTwoConnMan::doMaintenance()
     if(!g_tiertwo_sync_state.IsBlockchainSynced() || interruptNet) {
         return;
     }
+    {
+        // Release the expired warm standby connections
+        const int64_t now = GetTime();
+        LOCK(cs_vPendingMasternodes);
+        for (auto it = masternodeStandbyNodes.begin(); it != masternodeStandbyNodes.end(); ) {
+            it = it->second < now ? masternodeStandbyNodes.erase(it) : std::next(it);
+        }
+    }
     ProcessMasternodeConnections(*connman, *this);
 }
 
@@ -44,13 +44,14 @@ public:
     // Return true if the quorum was already registered
     bool hasQuorumNodes(Consensus::LLMQType llmqType, const uint256& quorumHash);
 
-    // Remove the registered quorum from the pending/protected MN connections
+    // Remove the registered quorum from the pending/protected MN connections.
+    // Its members stay on warm standby for a DKG interval, as the next quorums are likely to reuse them.
     void removeQuorumNodes(Consensus::LLMQType llmqType, const uint256& quorumHash);
 
     // Add MNs to the active quorum relay members map and push QSENDRECSIGS to the verified connected peers that are part of this new quorum.
     void setMasternodeQuorumRelayMembers(Consensus::LLMQType llmqType, const uint256& quorumHash, const std::set<uint256>& proTxHashes);
 
-    // Returns true if the node has the same address as a MN.
+    // Returns true if the node has the same address as a MN of a registered quorum (or on warm standby).
     bool isMasternodeQuorumNode(const CNode* pnode);
 
     // Whether protxHash an active quorum relay member
@@ -84,6 +85,8 @@ private:
     std::map<QuorumTypeAndHash, std::set<uint256>> masternodeQuorumNodes GUARDED_BY(cs_vPendingMasternodes);
     std::map<QuorumTypeAndHash, std::set<uint256>> masternodeQuorumRelayMembers GUARDED_BY(cs_vPendingMasternodes);
     std::set<uint256> masternodePendingProbes GUARDED_BY(cs_vPendingMasternodes);
+    // members of the removed quorums --> time until which their connections are kept
+    std::map<uint256, int64_t> masternodeStandbyNodes GUARDED_BY(cs_vPendingMasternodes);
 
     // The local DMN
     Optional<uint256> local_dmn_pro_tx_hash GUARDED_BY(cs_vPendingMasternodes){nullopt};
@@ -9,8 +9,30 @@
 #include "shutdown.h"
 #include "utiltime.h"
 
+#include <algorithm>
+
 CNetFulfilledRequestManager g_netfulfilledman(DEFAULT_ITEMS_FILTER_SIZE);
 
+const char* NetRequestName(NetRequest request)
+{
+    switch (request) {
+    case NetRequest::SPORKS_SYNC: return "getspork";
+    case NetRequest::BUDGET_SYNC: return "busync";
+    case NetRequest::MN_LIST_SYNC: return "mnsync";
+    case NetRequest::MNW_SYNC: return "mnwsync";
+    case NetRequest::MNW_SYNC_RECV: return "mnget";
+    case NetRequest::BUDGET_SYNC_RECV: return "budget-sync-recv";
+    case NetRequest::COUNT: break;
+    }
+    assert(false);
+    return "";
+}
+
+size_t CNetFulfilledRequestManager::AddrHasher::operator()(const CService& addr) const
+{
+    return CSipHasher(StaticSaltedHasher::s.k0, StaticSaltedHasher::s.k1).Write(addr.GetHash()).Write(addr.GetPort()).Finalize();
+}
+
 CNetFulfilledRequestManager::CNetFulfilledRequestManager(unsigned int _itemsFilterSize)
 {
     itemsFilterSize = _itemsFilterSize;
@@ -19,21 +41,26 @@ CNetFulfilledRequestManager::CNetFulfilledRequestManager(unsigned int _itemsFilt
     }
 }
 
-void CNetFulfilledRequestManager::AddFulfilledRequest(const CService& addr, const std::string& strRequest)
+void CNetFulfilledRequestManager::AddRequest(const CService& addr, NetRequest request, int64_t nExpireTime)
+{
+    AssertLockHeld(cs_mapFulfilledRequests);
+    auto it = mapFulfilledRequests.emplace(addr, fulfilledreqmapentry_t{}).first;
+    it->second[(size_t)request] = nExpireTime;
+    expiringRequests.push_back({nExpireTime, addr, request});
+}
+
+void CNetFulfilledRequestManager::AddFulfilledRequest(const CService& addr, NetRequest request)
 {
     LOCK(cs_mapFulfilledRequests);
-    mapFulfilledRequests[addr][strRequest] = GetTime() + Params().FulfilledRequestExpireTime();
+    AddRequest(addr, request, GetTime() + Params().FulfilledRequestExpireTime());
 }
 
-bool CNetFulfilledRequestManager::HasFulfilledRequest(const CService& addr, const std::string& strRequest) const
+bool CNetFulfilledRequestManager::HasFulfilledRequest(const CService& addr, NetRequest request) const
 {
     LOCK(cs_mapFulfilledRequests);
     auto it = mapFulfilledRequests.find(addr);
     if (it != mapFulfilledRequests.end()) {
-        auto itReq = it->second.find(strRequest);
-        if (itReq != it->second.end()) {
-            return itReq->second > GetTime();
-        }
+        return it->second[(size_t)request] > GetTime();
     }
     return false;
 }
@@ -65,19 +92,17 @@ void CNetFulfilledRequestManager::CheckAndRemove()
 {
     LOCK(cs_mapFulfilledRequests);
     int64_t now = GetTime();
-    for (auto it = mapFulfilledRequests.begin(); it != mapFulfilledRequests.end();) {
-        for (auto it_entry = it->second.begin(); it_entry != it->second.end();) {
-            if (now > it_entry->second) {
-                it_entry = it->second.erase(it_entry);
-            } else {
-                it_entry++;
+    while (!expiringRequests.empty() && now > expiringRequests.front().nExpireTime) {
+        const ExpiringRequest& req = expiringRequests.front();
+        auto it = mapFulfilledRequests.find(req.addr);
+        // Skip the requests renewed later
+        if (it != mapFulfilledRequests.end() && it->second[(size_t)req.request] == req.nExpireTime) {
+            it->second[(size_t)req.request] = 0;
+            if (std::all_of(it->second.begin(), it->second.end(), [](int64_t t) { return t == 0; })) {
+                mapFulfilledRequests.erase(it);
             }
         }
-        if (it->second.empty()) {
-            it = mapFulfilledRequests.erase(it);
-        } else {
-            it++;
-        }
+        expiringRequests.pop_front();
     }
 
     if (now > lastFilterCleanup ||  itemsFilterCount >= itemsFilterSize) {
@@ -91,6 +116,7 @@ void CNetFulfilledRequestManager::Clear()
 {
     LOCK(cs_mapFulfilledRequests);
     mapFulfilledRequests.clear();
+    expiringRequests.clear();
 }
 
 std::string CNetFulfilledRequestManager::ToString() const
@@ -7,13 +7,17 @@
 #define PIVX_NETFULFILLEDMAN_H
 
 #include "bloom.h"
+#include "netaddress.h"
+#include "saltedhasher.h"
 #include "serialize.h"
 #include "sync.h"
 
+#include <array>
+#include <deque>
 #include <map>
+#include <unordered_map>
 
 class CBloomFilter;
-class CService;
 
 static const std::string NET_REQUESTS_CACHE_FILENAME = "netrequests.dat";
 static const std::string NET_REQUESTS_CACHE_FILE_ID = "magicNetRequestsCache";
@@ -21,16 +25,47 @@ static const std::string NET_REQUESTS_CACHE_FILE_ID = "magicNetRequestsCache";
 static const unsigned int DEFAULT_ITEMS_FILTER_SIZE = 250;
 static const unsigned int DEFAULT_ITEMS_FILTER_CLEANUP = 60 * 60;
 
+/** The requests tracked for each peer */
+enum class NetRequest : uint8_t {
+    SPORKS_SYNC,        // we asked the sporks
+    BUDGET_SYNC,        // we asked the budget
+    MN_LIST_SYNC,       // we asked the masternodes list
+    MNW_SYNC,           // we asked the masternode winners
+    MNW_SYNC_RECV,      // the peer asked the masternode winners
+    BUDGET_SYNC_RECV,   // the peer asked the budget
+    COUNT
+};
+
+/** The name of a request, used in the cache file */
+const char* NetRequestName(NetRequest request);
+
 // Fulfilled requests are used to prevent nodes from asking the same data on sync
 // and being banned for doing it too often.
 class CNetFulfilledRequestManager
 {
 private:
-    typedef std::map<std::string, int64_t> fulfilledreqmapentry_t;
-    typedef std::map<CService, fulfilledreqmapentry_t> fulfilledreqmap_t;
+    static constexpr size_t NET_REQUESTS_COUNT = (size_t)NetRequest::COUNT;
+
+    struct AddrHasher
+    {
+        size_t operator()(const CService& addr) const;
+    };
+
+    // expiration time of each request, 0 when not requested
+    typedef std::array<int64_t, NET_REQUESTS_COUNT> fulfilledreqmapentry_t;
+    typedef std::unordered_map<CService, fulfilledreqmapentry_t, AddrHasher> fulfilledreqmap_t;
 
     // Keep track of what node has/was asked for and when
     fulfilledreqmap_t mapFulfilledRequests GUARDED_BY(cs_mapFulfilledRequests);
+    // The requests by expiration time. As they all last FulfilledRequestExpireTime, this is a FIFO.
+    // Entries of requests renewed since then are skipped on removal.
+    struct ExpiringRequest
+    {
+        int64_t nExpireTime;
+        CService addr;
+        NetRequest request;
+    };
+    std::deque<ExpiringRequest> expiringRequests GUARDED_BY(cs_mapFulfilledRequests);
     mutable Mutex cs_mapFulfilledRequests;
 
     std::unique_ptr<CBloomFilter> itemsFilter GUARDED_BY(cs_mapFulfilledRequests){nullptr};
@@ -39,16 +74,55 @@ private:
     int64_t filterCleanupTime{DEFAULT_ITEMS_FILTER_CLEANUP}; // for now, fixed cleanup time
     int64_t lastFilterCleanup{0};
 
+    void AddRequest(const CService& addr, NetRequest request, int64_t nExpireTime) EXCLUSIVE_LOCKS_REQUIRED(cs_mapFulfilledRequests);
+
 public:
     CNetFulfilledRequestManager(unsigned int itemsFilterSize);
 
-    SERIALIZE_METHODS(CNetFulfilledRequestManager, obj) {
-        LOCK(obj.cs_mapFulfilledRequests);
-        READWRITE(obj.mapFulfilledRequests);
+    // The cache file keeps the request names, as std::map<CService, std::map<std::string, int64_t>>
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        std::map<CService, std::map<std::string, int64_t>> mapFile;
+        {
+            LOCK(cs_mapFulfilledRequests);
+            for (const auto& p : mapFulfilledRequests) {
+                auto& entry = mapFile[p.first];
+                for (size_t i = 0; i < NET_REQUESTS_COUNT; i++) {
+                    if (p.second[i] != 0) entry.emplace(NetRequestName((NetRequest)i), p.second[i]);
+                }
+            }
+        }
+        s << mapFile;
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        std::map<CService, std::map<std::string, int64_t>> mapFile;
+        s >> mapFile;
+        // Requests by expiration time, to fill the expiration FIFO in order
+        std::multimap<int64_t, std::pair<CService, NetRequest>> mapExpiring;
+        for (const auto& p : mapFile) {
+            for (const auto& req : p.second) {
+                for (size_t i = 0; i < NET_REQUESTS_COUNT; i++) {
+                    if (req.first == NetRequestName((NetRequest)i)) {
+                        mapExpiring.emplace(req.second, std::make_pair(p.first, (NetRequest)i));
+                        break;
+                    }
+                }
+            }
+        }
+        LOCK(cs_mapFulfilledRequests);
+        mapFulfilledRequests.clear();
+        expiringRequests.clear();
+        for (const auto& p : mapExpiring) {
+            AddRequest(p.second.first, p.second.second, p.first);
+        }
     }
 
-    void AddFulfilledRequest(const CService& addr, const std::string& strRequest);
-    bool HasFulfilledRequest(const CService& addr, const std::string& strRequest) const;
+    void AddFulfilledRequest(const CService& addr, NetRequest request);
+    bool HasFulfilledRequest(const CService& addr, NetRequest request) const;
 
     // Faster lookup using bloom filter
     void AddItemRequest(const CService& addr, const uint256& itemHash);
@@ -8,7 +8,7 @@
 
 TierTwoSyncState g_tiertwo_sync_state;
 
-static void UpdateLastTime(const uint256& hash, int64_t& last, std::map<uint256, int>& mapSeen)
+static void UpdateLastTime(const uint256& hash, std::atomic<int64_t>& last, std::map<uint256, int>& mapSeen)
 {
     auto it = mapSeen.find(hash);
     if (it != mapSeen.end()) {
@@ -24,16 +24,19 @@ static void UpdateLastTime(const uint256& hash, int64_t& last, std::map<uint256,
 
 void TierTwoSyncState::AddedMasternodeList(const uint256& hash)
 {
+    LOCK(cs_seen);
     UpdateLastTime(hash, lastMasternodeList, mapSeenSyncMNB);
 }
 
 void TierTwoSyncState::AddedMasternodeWinner(const uint256& hash)
 {
+    LOCK(cs_seen);
     UpdateLastTime(hash, lastMasternodeWinner, mapSeenSyncMNW);
 }
 
 void TierTwoSyncState::AddedBudgetItem(const uint256& hash)
 {
+    LOCK(cs_seen);
     UpdateLastTime(hash, lastBudgetItem, mapSeenSyncBudget);
 }
 
@@ -42,6 +45,7 @@ void TierTwoSyncState::ResetData()
     lastMasternodeList = 0;
     lastMasternodeWinner = 0;
     lastBudgetItem = 0;
+    LOCK(cs_seen);
     mapSeenSyncMNB.clear();
     mapSeenSyncMNW.clear();
     mapSeenSyncBudget.clear();
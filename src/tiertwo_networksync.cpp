@@ -20,6 +20,7 @@
 // Update in-flight message status if needed
 bool CMasternodeSync::UpdatePeerSyncState(const NodeId& id, const char* msg, const int nextSyncStatus)
 {
+    LOCK(cs_peersSyncState);
     auto it = peersSyncState.find(id);
     if (it != peersSyncState.end()) {
         auto peerData = it->second;
@@ -170,6 +171,7 @@ void CMasternodeSync::PushMessage(CNode* pnode, const char* msg, Args&&... args)
 template <typename... Args>
 void CMasternodeSync::RequestDataTo(CNode* pnode, const char* msg, bool forceRequest, Args&&... args)
 {
+    LOCK(cs_peersSyncState);
     const auto& it = peersSyncState.find(pnode->GetId());
     bool exist = it != peersSyncState.end();
     if (!exist || forceRequest) {
@@ -20,7 +20,9 @@
 static const char DB_COIN = 'C';
 static const char DB_COINS = 'c';
 static const char DB_BLOCK_FILES = 'f';
-static const char DB_TXINDEX = 't';
+static const char DB_ADDRESSINDEX = 'a';
+static const char DB_ADDRESSUNSPENTINDEX = 'u';
+static const char DB_SPENTINDEX = 'p';
 static const char DB_BLOCK_INDEX = 'b';
 
 static const char DB_BEST_BLOCK = 'B';
@@ -28,7 +30,9 @@ static const char DB_HEAD_BLOCKS = 'H';
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
-// static const char DB_MONEY_SUPPLY = 'M';
+// static const char DB_MONEY_SUPPLY = 'M'; (legacy, the supply at the best block is DB_TRANSPARENT_SUPPLY)
+static const char DB_TRANSPARENT_SUPPLY = 'T';
+// static const char DB_TXINDEX = 't'; (legacy, migrated to indexes/txindex/ by TxIndex)
 
 namespace {
 
@@ -66,6 +70,22 @@ uint256 CCoinsViewDB::GetBestBlock() const
     return hashBestChain;
 }
 
+void CCoinsViewDB::SetMoneySupply(const uint256& hashBlock, const CAmount& nSupply)
+{
+    LOCK(cs_moneySupply);
+    moneySupply = std::make_pair(hashBlock, nSupply);
+}
+
+bool CCoinsViewDB::ReadMoneySupply(const uint256& hashBlock, CAmount& nSupply) const
+{
+    std::pair<uint256, CAmount> supply;
+    if (!db.Read(DB_TRANSPARENT_SUPPLY, supply) || supply.first != hashBlock) {
+        return false;
+    }
+    nSupply = supply.second;
+    return true;
+}
+
 std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
     std::vector<uint256> vhashHeadBlocks;
     if (!db.Read(DB_HEAD_BLOCKS, vhashHeadBlocks)) {
@@ -79,14 +99,21 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap& mapCoins,
                               const uint256& hashSaplingAnchor,
                               CAnchorsSaplingMap& mapSaplingAnchors,
                               CNullifiersMap& mapSaplingNullifiers)
+{
+    bool ret = WriteCoins(mapCoins, hashBlock, hashSaplingAnchor, mapSaplingAnchors, mapSaplingNullifiers);
+    mapCoins.clear();
+    return ret;
+}
+
+bool CCoinsViewDB::BeginBatchWrite(const uint256& hashBlock)
 {
     CDBBatch batch(CLIENT_VERSION);
-    size_t count = 0;
-    size_t changed = 0;
-    size_t batch_size = (size_t) gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
-    int crash_simulate = gArgs.GetArg("-dbcrashratio", 0);
-    assert(!hashBlock.IsNull());
+    WriteHeadBlocks(hashBlock, batch);
+    return db.WriteBatch(batch, true);
+}
 
+void CCoinsViewDB::WriteHeadBlocks(const uint256& hashBlock, CDBBatch& batch) const
+{
     uint256 old_tip = GetBestBlock();
     if (old_tip.IsNull()) {
         // We may be in the middle of replaying.
@@ -103,8 +130,24 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap& mapCoins,
     // interrupting after partial writes from multiple independent reorgs.
     batch.Erase(DB_BEST_BLOCK);
     batch.Write(DB_HEAD_BLOCKS, Vector(hashBlock, old_tip));
+}
+
+bool CCoinsViewDB::WriteCoins(const CCoinsMap& mapCoins,
+                              const uint256& hashBlock,
+                              const uint256& hashSaplingAnchor,
+                              CAnchorsSaplingMap& mapSaplingAnchors,
+                              CNullifiersMap& mapSaplingNullifiers)
+{
+    CDBBatch batch(CLIENT_VERSION);
+    size_t count = 0;
+    size_t changed = 0;
+    size_t batch_size = (size_t) gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
+    int crash_simulate = gArgs.GetArg("-dbcrashratio", 0);
+    assert(!hashBlock.IsNull());
+
+    WriteHeadBlocks(hashBlock, batch);
 
-    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
+    for (CCoinsMap::const_iterator it = mapCoins.begin(); it != mapCoins.end(); it++) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
             CoinEntry entry(&it->first);
             if (it->second.coin.IsSpent())
@@ -114,8 +157,6 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap& mapCoins,
             changed++;
         }
         count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
         if (batch.SizeEstimate() > batch_size) {
             LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
             db.WriteBatch(batch);
@@ -136,6 +177,14 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap& mapCoins,
     // In the last batch, mark the database as consistent with hashBlock again.
     batch.Erase(DB_HEAD_BLOCKS);
     batch.Write(DB_BEST_BLOCK, hashBlock);
+    {
+        LOCK(cs_moneySupply);
+        if (moneySupply.first == hashBlock) {
+            batch.Write(DB_TRANSPARENT_SUPPLY, moneySupply);
+        } else {
+            batch.Erase(DB_TRANSPARENT_SUPPLY);
+        }
+    }
 
     LogPrint(BCLog::COINDB, "Writing final batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
     bool ret = db.WriteBatch(batch);
@@ -188,16 +237,50 @@ CCoinsViewCursor *CCoinsViewDB::Cursor() const
        only need read operations on it, use a const-cast to get around
        that restriction.  */
     i->pcursor->Seek(DB_COIN);
-    // Cache key of first record
-    // Cache key of first record
-    if (i->pcursor->Valid()) {
-        CoinEntry entry(&i->keyTmp.second);
-        i->pcursor->GetKey(entry);
-        i->keyTmp.first = entry.key;
+    i->CacheKey();
+    return i;
+}
+
+std::vector<std::unique_ptr<CCoinsViewCursor>> CCoinsViewDB::RangeCursors(int nRanges) const
+{
+    assert(nRanges > 0 && nRanges <= 256);
+    CDBWrapper& dbw = const_cast<CDBWrapper&>(db);
+    std::shared_ptr<const leveldb::Snapshot> snapshot = dbw.GetSnapshot();
+
+    // The best block of the snapshot (the iterators don't see the writes made after it)
+    uint256 hashBestBlock;
+    {
+        std::unique_ptr<CDBIterator> pcursor(dbw.NewIterator(snapshot.get()));
+        pcursor->Seek(DB_BEST_BLOCK);
+        char chKey;
+        if (!pcursor->Valid() || !pcursor->GetKey(chKey) || chKey != DB_BEST_BLOCK || !pcursor->GetValue(hashBestBlock)) {
+            hashBestBlock.SetNull();
+        }
+    }
+
+    // The txids are uniformly distributed, so are the ranges of their first byte
+    std::vector<std::unique_ptr<CCoinsViewCursor>> ret;
+    for (int n = 0; n < nRanges; n++) {
+        CCoinsViewDBCursor* i = new CCoinsViewDBCursor(dbw.NewIterator(snapshot.get()), hashBestBlock);
+        i->snapshot = snapshot;
+        i->nEndByte = (n + 1) * 256 / nRanges;
+        COutPoint start;
+        *start.hash.begin() = (unsigned char)(n * 256 / nRanges);
+        i->pcursor->Seek(CoinEntry(&start));
+        i->CacheKey();
+        ret.emplace_back(i);
+    }
+    return ret;
+}
+
+void CCoinsViewDBCursor::CacheKey()
+{
+    CoinEntry entry(&keyTmp.second);
+    if (!pcursor->Valid() || !pcursor->GetKey(entry) || (entry.key == DB_COIN && *keyTmp.second.hash.begin() >= nEndByte)) {
+        keyTmp.first = 0; // Invalidate cached key after last record so that Valid() and GetKey() return false
     } else {
-        i->keyTmp.first = 0; // Make sure Valid() and GetKey() return false
+        keyTmp.first = entry.key;
     }
-    return i;
 }
 
 bool CCoinsViewDBCursor::GetKey(COutPoint &key) const
@@ -228,12 +311,7 @@ bool CCoinsViewDBCursor::Valid() const
 void CCoinsViewDBCursor::Next()
 {
     pcursor->Next();
-    CoinEntry entry(&keyTmp.second);
-    if (!pcursor->Valid() || !pcursor->GetKey(entry)) {
-        keyTmp.first = 0; // Invalidate cached key after last record so that Valid() and GetKey() return false
-    } else {
-        keyTmp.first = entry.key;
-    }
+    CacheKey();
 }
 
 bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo) {
@@ -248,19 +326,95 @@ bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockF
     return WriteBatch(batch, true);
 }
 
-bool CBlockTreeDB::ReadTxIndex(const uint256& txid, CDiskTxPos& pos)
+bool CBlockTreeDB::UpdateAddressIndex(const AddressIndexEntries& vIndex, const AddressUnspentEntries& vUnspent, bool fErase)
+{
+    CDBBatch batch(CLIENT_VERSION);
+    for (const auto& it : vIndex) {
+        if (fErase) {
+            batch.Erase(std::make_pair(DB_ADDRESSINDEX, it.first));
+        } else {
+            batch.Write(std::make_pair(DB_ADDRESSINDEX, it.first), it.second);
+        }
+    }
+    for (const auto& it : vUnspent) {
+        if (it.second.IsNull()) {
+            batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, it.first));
+        } else {
+            batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, it.first), it.second);
+        }
+    }
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadAddressIndex(AddressType type, const uint160& hashBytes, AddressIndexEntries& vIndex, int nStart, int nEnd)
+{
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, hashBytes, nStart)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CAddressIndexKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSINDEX ||
+                key.second.type != type || key.second.hashBytes != hashBytes ||
+                (nEnd > 0 && key.second.blockHeight > nEnd)) {
+            break;
+        }
+        CAmount nValue;
+        if (!pcursor->GetValue(nValue)) {
+            return error("%s : failed to read value", __func__);
+        }
+        vIndex.emplace_back(key.second, nValue);
+        pcursor->Next();
+    }
+    return true;
+}
+
+bool CBlockTreeDB::ReadAddressUnspentIndex(AddressType type, const uint160& hashBytes, AddressUnspentEntries& vUnspent)
 {
-    return Read(std::make_pair(DB_TXINDEX, txid), pos);
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressUnspentIteratorKey(type, hashBytes)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CAddressUnspentKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSUNSPENTINDEX ||
+                key.second.type != type || key.second.hashBytes != hashBytes) {
+            break;
+        }
+        CAddressUnspentValue value;
+        if (!pcursor->GetValue(value)) {
+            return error("%s : failed to read value", __func__);
+        }
+        vUnspent.emplace_back(key.second, value);
+        pcursor->Next();
+    }
+    return true;
 }
 
-bool CBlockTreeDB::WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> >& vect)
+bool CBlockTreeDB::UpdateSpentIndex(const SpentIndexEntries& vSpent)
 {
     CDBBatch batch(CLIENT_VERSION);
-    for (std::vector<std::pair<uint256, CDiskTxPos> >::const_iterator it = vect.begin(); it != vect.end(); it++)
-        batch.Write(std::make_pair(DB_TXINDEX, it->first), it->second);
+    for (const auto& it : vSpent) {
+        if (it.second.IsNull()) {
+            batch.Erase(std::make_pair(DB_SPENTINDEX, it.first));
+        } else {
+            batch.Write(std::make_pair(DB_SPENTINDEX, it.first), it.second);
+        }
+    }
     return WriteBatch(batch);
 }
 
+bool CBlockTreeDB::ReadSpentIndex(const std::vector<COutPoint>& vOutpoints, std::vector<CSpentIndexValue>& vSpent)
+{
+    vSpent.assign(vOutpoints.size(), CSpentIndexValue());
+    for (size_t i = 0; i < vOutpoints.size(); i++) {
+        if (!Read(std::make_pair(DB_SPENTINDEX, vOutpoints[i]), vSpent[i])) {
+            vSpent[i] = CSpentIndexValue();
+        }
+    }
+    return true;
+}
+
 bool CBlockTreeDB::WriteFlag(const std::string& name, bool fValue)
 {
     return Write(std::make_pair(DB_FLAG, name), fValue ? '1' : '0');
@@ -299,7 +453,8 @@ bool CBlockTreeDB::LoadBlockIndexGuts(std::function<CBlockIndex*(const uint256&)
             CDiskBlockIndex diskindex;
             if (pcursor->GetValue(diskindex)) {
                 // Construct block index object
-                CBlockIndex* pindexNew = insertBlockIndex(diskindex.GetBlockHash());
+                // The key is the hash of the header, not recomputed here (see LoadBlockIndexDB)
+                CBlockIndex* pindexNew = insertBlockIndex(key.second);
                 pindexNew->pprev = insertBlockIndex(diskindex.hashPrev);
                 pindexNew->nHeight = diskindex.nHeight;
                 pindexNew->nFile = diskindex.nFile;
@@ -322,7 +477,7 @@ bool CBlockTreeDB::LoadBlockIndexGuts(std::function<CBlockIndex*(const uint256&)
 
                 //Proof Of Stake
                 pindexNew->nFlags = diskindex.nFlags;
-                pindexNew->vStakeModifier = diskindex.vStakeModifier;
+                pindexNew->stakeModifier = diskindex.stakeModifier;
 
                 if (!Params().GetConsensus().NetworkUpgradeActive(pindexNew->nHeight, Consensus::UPGRADE_POS)) {
                     if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits))
@@ -343,22 +498,46 @@ bool CBlockTreeDB::LoadBlockIndexGuts(std::function<CBlockIndex*(const uint256&)
 
 CZerocoinDB::CZerocoinDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "zerocoin", nCacheSize, fMemory, fWipe)
 {
+    LoadSerialFingerprints();
+}
+
+void CZerocoinDB::LoadSerialFingerprints()
+{
+    LOCK(cs_serials);
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair('s', UINT256_ZERO));
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, uint256> key;
+        if (!pcursor->GetKey(key) || key.first != 's') {
+            break;
+        }
+        setSerialFingerprints.insert(key.second.GetCheapHash());
+        pcursor->Next();
+    }
+    LogPrintf("%s: Total zerocoin spent serials: %d\n", __func__, setSerialFingerprints.size());
 }
 
 bool CZerocoinDB::WriteCoinSpendBatch(const std::vector<std::pair<CBigNum, uint256> >& spendInfo)
 {
     CDBBatch batch(CLIENT_VERSION);
-    size_t count = 0;
+    std::vector<uint64_t> vFingerprints;
+    vFingerprints.reserve(spendInfo.size());
     for (std::vector<std::pair<CBigNum, uint256> >::const_iterator it=spendInfo.begin(); it != spendInfo.end(); it++) {
         CBigNum bnSerial = it->first;
         CDataStream ss(SER_GETHASH, 0);
         ss << bnSerial;
         uint256 hash = Hash(ss.begin(), ss.end());
         batch.Write(std::make_pair('s', hash), it->second);
-        ++count;
+        vFingerprints.emplace_back(hash.GetCheapHash());
     }
 
-    LogPrint(BCLog::COINDB, "Writing %u coin spends to db.\n", (unsigned int)count);
+    LogPrint(BCLog::COINDB, "Writing %u coin spends to db.\n", (unsigned int)vFingerprints.size());
+    {
+        // Added before the write, a missing fingerprint must never hide a spent serial
+        LOCK(cs_serials);
+        setSerialFingerprints.insert(vFingerprints.begin(), vFingerprints.end());
+    }
     return WriteBatch(batch, true);
 }
 
@@ -368,6 +547,9 @@ bool CZerocoinDB::ReadCoinSpend(const CBigNum& bnSerial, uint256& txHash)
     ss << bnSerial;
     uint256 hash = Hash(ss.begin(), ss.end());
 
+    if (WITH_LOCK(cs_serials, return !setSerialFingerprints.count(hash.GetCheapHash()))) {
+        return false;
+    }
     return Read(std::make_pair('s', hash), txHash);
 }
 
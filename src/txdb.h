@@ -7,14 +7,22 @@
 #ifndef BITCOIN_TXDB_H
 #define BITCOIN_TXDB_H
 
+#include "addressindex.h"
 #include "coins.h"
 #include "chain.h"
 #include "dbwrapper.h"
 #include "libzerocoin/Coin.h"
 #include "libzerocoin/CoinSpend.h"
+#include "saltedhasher.h"
+#include "spentindex.h"
+#include "sync.h"
+#include "unordered_lru_cache.h"
 
+#include <functional>
 #include <map>
+#include <memory>
 #include <string>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -31,14 +39,22 @@ static const int64_t nDefaultDbBatchSize = 16 << 20;
 static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 16384 : 1024;
 //! min. -dbcache (MiB)
 static const int64_t nMinDbCache = 4;
-//! Max memory allocated to block tree DB specific cache, if no -txindex (MiB)
+//! Max memory allocated to block tree DB specific cache, if no -addressindex/-spentindex (MiB)
 static const int64_t nMaxBlockDBCache = 2;
-//! Max memory allocated to block tree DB specific cache, if -txindex (MiB)
-// Unlike for the UTXO database, for the txindex scenario the leveldb cache make
+//! Max memory allocated to block tree DB specific cache, if -addressindex/-spentindex (MiB)
+// Unlike for the UTXO database, for the index scenario the leveldb cache make
 // a meaningful difference: https://github.com/bitcoin/bitcoin/pull/8273#issuecomment-229601991
 static const int64_t nMaxBlockDBAndTxIndexCache = 1024;
+//! Max memory allocated to the txindex DB specific cache (MiB)
+static const int64_t nMaxTxIndexCache = 1024;
+//! Max memory allocated to each block filter index DB specific cache (MiB)
+static const int64_t nMaxFilterIndexCache = 1024;
+//! Max memory allocated to the compact sapling index DB specific cache (MiB)
+static const int64_t nMaxCompactSaplingIndexCache = 64;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
+//! Number of sapling anchor trees kept in memory by the coins DB
+static const size_t SAPLING_ANCHORS_CACHE_SIZE = 500;
 
 struct CDiskTxPos : public FlatFilePos
 {
@@ -72,6 +88,18 @@ class CCoinsViewDB : public CCoinsView
 protected:
     CDBWrapper db;
 
+    // The trees of the recently read or written sapling anchors: the spends of the
+    // transactions being validated mostly refer to the same few recent anchors.
+    mutable Mutex cs_saplingAnchors;
+    mutable unordered_lru_cache<uint256, SaplingMerkleTree, StaticSaltedHasher, SAPLING_ANCHORS_CACHE_SIZE> saplingAnchorsCache GUARDED_BY(cs_saplingAnchors);
+
+    // Marks the database as being in the middle of a transition to hashBlock (replayed after a crash)
+    void WriteHeadBlocks(const uint256& hashBlock, CDBBatch& batch) const;
+
+    // The money supply at a block, written with the coins when it's their best block
+    mutable Mutex cs_moneySupply;
+    std::pair<uint256, CAmount> moneySupply GUARDED_BY(cs_moneySupply){UINT256_ZERO, 0};
+
 public:
     CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
 
@@ -80,6 +108,8 @@ public:
     uint256 GetBestBlock() const override;
     std::vector<uint256> GetHeadBlocks() const override;
     CCoinsViewCursor* Cursor() const override;
+    //! Splits the coins in nRanges ranges of txids, with a cursor per range, all reading the same snapshot of the database
+    std::vector<std::unique_ptr<CCoinsViewCursor>> RangeCursors(int nRanges) const;
 
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
@@ -91,14 +121,33 @@ public:
                     CAnchorsSaplingMap& mapSaplingAnchors,
                     CNullifiersMap& mapSaplingNullifiers) override;
 
+    //! Writes the transition marker (the head blocks) of a WriteCoins made later, e.g. in the background
+    bool BeginBatchWrite(const uint256& hashBlock);
+    //! Like BatchWrite, but leaves the coins map untouched (the sapling maps are still consumed)
+    bool WriteCoins(const CCoinsMap& mapCoins,
+                    const uint256& hashBlock,
+                    const uint256& hashSaplingAnchor,
+                    CAnchorsSaplingMap& mapSaplingAnchors,
+                    CNullifiersMap& mapSaplingNullifiers);
+
+    //! Sets the money supply at hashBlock, stored by the next write of the coins with hashBlock as best block
+    //! (the other writes erase the stored supply)
+    void SetMoneySupply(const uint256& hashBlock, const CAmount& nSupply);
+    //! Reads the stored money supply, if it's the one at hashBlock
+    bool ReadMoneySupply(const uint256& hashBlock, CAmount& nSupply) const;
+
     // Sapling, the implementation of the following functions can be found in sapling_txdb.cpp.
     bool GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const override;
     bool GetNullifier(const uint256 &nf) const override;
+    void GetNullifiers(const std::vector<uint256>& nullifiers, std::vector<bool>& vSpent) const override;
     uint256 GetBestAnchor() const override;
     bool BatchWriteSapling(const uint256& hashSaplingAnchor,
                            CAnchorsSaplingMap& mapSaplingAnchors,
                            CNullifiersMap& mapSaplingNullifiers,
                            CDBBatch& batch);
+    //! Iterate over the sapling anchors and nullifiers stored in the database, until func returns false
+    bool ForEachSaplingAnchor(const std::function<bool(const uint256&, const SaplingMerkleTree&)>& func) const;
+    bool ForEachSaplingNullifier(const std::function<bool(const uint256&)>& func) const;
 };
 
 /** Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB */
@@ -119,6 +168,12 @@ private:
         CCoinsViewCursor(hashBlockIn), pcursor(pcursorIn) {}
     std::unique_ptr<CDBIterator> pcursor;
     std::pair<char, COutPoint> keyTmp;
+    //! Snapshot read by pcursor, if any
+    std::shared_ptr<const leveldb::Snapshot> snapshot;
+    //! The cursor stops at the first txid whose first (serialized) byte is nEndByte or more
+    int nEndByte{256};
+
+    void CacheKey();
 
     friend class CCoinsViewDB;
 };
@@ -138,8 +193,14 @@ public:
     bool ReadLastBlockFile(int& nFile);
     bool WriteReindexing(bool fReindexing);
     bool ReadReindexing(bool& fReindexing);
-    bool ReadTxIndex(const uint256& txid, CDiskTxPos& pos);
-    bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> >& vect);
+    /** Write (or with fErase remove) the address index entries, and update the unspent outputs of the addresses */
+    bool UpdateAddressIndex(const AddressIndexEntries& vIndex, const AddressUnspentEntries& vUnspent, bool fErase);
+    /** The entries of an address in the heights [nStart, nEnd] (nEnd = 0 for no upper bound) */
+    bool ReadAddressIndex(AddressType type, const uint160& hashBytes, AddressIndexEntries& vIndex, int nStart = 0, int nEnd = 0);
+    bool ReadAddressUnspentIndex(AddressType type, const uint160& hashBytes, AddressUnspentEntries& vUnspent);
+    bool UpdateSpentIndex(const SpentIndexEntries& vSpent);
+    /** The spends of the outpoints, a null value for the unspent ones (or spent in the mempool) */
+    bool ReadSpentIndex(const std::vector<COutPoint>& vOutpoints, std::vector<CSpentIndexValue>& vSpent);
     bool WriteFlag(const std::string& name, bool fValue);
     bool ReadFlag(const std::string& name, bool& fValue);
     bool WriteInt(const std::string& name, int nValue);
@@ -157,6 +218,16 @@ private:
     CZerocoinDB(const CZerocoinDB&);
     void operator=(const CZerocoinDB&);
 
+    /**
+     * In-memory prefilter of the spent serials: the 64 bits fingerprints of their keys, loaded at startup.
+     * A serial whose fingerprint is missing is not in the db, so the (usual) misses never reach LevelDB.
+     * Fingerprints of erased serials are kept: a false positive only costs a db read.
+     */
+    Mutex cs_serials;
+    std::unordered_set<uint64_t> setSerialFingerprints GUARDED_BY(cs_serials);
+
+    void LoadSerialFingerprints();
+
 public:
     /** Write zPIV spends to the zerocoinDB in a batch
      * Pair of: CBigNum -> coinSerialNumber and uint256 -> txHash.
@@ -46,6 +46,16 @@ CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFe
     nSigOpCountWithAncestors = sigOpCount;
 }
 
+void CTxMemPoolEntry::SetPrecomputedTxData(std::shared_ptr<PrecomputedTransactionData> data)
+{
+    // Counted when the entry is added to the mempool: the data is filled by the checks of the tx before,
+    // and the checks of the block connection, which reuse it, only find the hashes already there.
+    nUsageSize -= nPrecomTxDataUsage;
+    precomTxData = std::move(data);
+    nPrecomTxDataUsage = precomTxData ? memusage::DynamicUsage(precomTxData) + precomTxData->DynamicMemoryUsage() : 0;
+    nUsageSize += nPrecomTxDataUsage;
+}
+
 void CTxMemPoolEntry::UpdateFeeDelta(int64_t newFeeDelta)
 {
     nModFeesWithDescendants += newFeeDelta - feeDelta;
@@ -58,14 +68,14 @@ void CTxMemPoolEntry::UpdateFeeDelta(int64_t newFeeDelta)
 // descendants.
 void CTxMemPool::UpdateForDescendants(txiter updateIt, cacheMap &cachedDescendants, const std::set<uint256> &setExclude)
 {
-    setEntries stageEntries, setAllDescendants;
-    stageEntries = GetMemPoolChildren(updateIt);
+    const vecEntries& children = GetMemPoolChildren(updateIt);
+    setEntries stageEntries(children.begin(), children.end()), setAllDescendants;
 
     while (!stageEntries.empty()) {
         const txiter cit = *stageEntries.begin();
         setAllDescendants.insert(cit);
         stageEntries.erase(cit);
-        const setEntries &setChildren = GetMemPoolChildren(cit);
+        const vecEntries &setChildren = GetMemPoolChildren(cit);
         for (const txiter& childEntry : setChildren) {
             cacheMap::iterator cacheIt = cachedDescendants.find(childEntry);
             if (cacheIt != cachedDescendants.end()) {
@@ -106,6 +116,8 @@ void CTxMemPool::UpdateForDescendants(txiter updateIt, cacheMap &cachedDescendan
 void CTxMemPool::UpdateTransactionsFromBlock(const std::vector<uint256> &vHashesToUpdate)
 {
     LOCK(cs);
+    // The re-added entries get new descendants, which the ancestors of the batch don't know about
+    mapBatchAncestors.clear();
     // For each entry in vHashesToUpdate, store the set of in-mempool, but not
     // in-vHashesToUpdate transactions, so that we don't have to recalculate
     // descendants when we come across a previously seen entry.
@@ -169,30 +181,52 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
         // If we're not searching for parents, we require this to be an
         // entry in the mempool already.
         txiter it = mapTx.iterator_to(entry);
-        parentHashes = GetMemPoolParents(it);
+        const vecEntries& parents = GetMemPoolParents(it);
+        parentHashes.insert(parents.begin(), parents.end());
     }
 
     size_t totalSizeWithAncestors = entry.GetTxSize();
 
-    while (!parentHashes.empty()) {
-        txiter stageit = *parentHashes.begin();
-
-        setAncestors.insert(stageit);
-        parentHashes.erase(stageit);
-        totalSizeWithAncestors += stageit->GetTxSize();
+    // Adds an ancestor, checking the limits
+    auto addAncestor = [&](txiter it) {
+        setAncestors.insert(it);
+        totalSizeWithAncestors += it->GetTxSize();
 
-        if (stageit->GetSizeWithDescendants() + entry.GetTxSize() > limitDescendantSize) {
-            errString = strprintf("exceeds descendant size limit for tx %s [limit: %u]", stageit->GetTx().GetHash().ToString(), limitDescendantSize);
+        if (it->GetSizeWithDescendants() + entry.GetTxSize() > limitDescendantSize) {
+            errString = strprintf("exceeds descendant size limit for tx %s [limit: %u]", it->GetTx().GetHash().ToString(), limitDescendantSize);
             return false;
-        } else if (stageit->GetCountWithDescendants() + 1 > limitDescendantCount) {
-            errString = strprintf("too many descendants for tx %s [limit: %u]", stageit->GetTx().GetHash().ToString(), limitDescendantCount);
+        } else if (it->GetCountWithDescendants() + 1 > limitDescendantCount) {
+            errString = strprintf("too many descendants for tx %s [limit: %u]", it->GetTx().GetHash().ToString(), limitDescendantCount);
             return false;
         } else if (totalSizeWithAncestors > limitAncestorSize) {
             errString = strprintf("exceeds ancestor size limit [limit: %u]", limitAncestorSize);
             return false;
         }
+        return true;
+    };
+
+    while (!parentHashes.empty()) {
+        txiter stageit = *parentHashes.begin();
+        parentHashes.erase(stageit);
+        // Already added with the ancestors of an entry of the current batch
+        if (setAncestors.count(stageit)) continue;
+
+        if (!addAncestor(stageit)) return false;
+
+        const auto batchIt = mapBatchAncestors.find(stageit);
+        if (batchIt != mapBatchAncestors.end()) {
+            // The ancestors of this parent are known, no need to walk them
+            for (const txiter& ancestorIt : batchIt->second) {
+                if (setAncestors.count(ancestorIt) == 0 && !addAncestor(ancestorIt)) return false;
+            }
+            if (parentHashes.size() + setAncestors.size() + 1 > limitAncestorCount) {
+                errString = strprintf("too many unconfirmed ancestors [limit: %u]", limitAncestorCount);
+                return false;
+            }
+            continue;
+        }
 
-        const setEntries & setMemPoolParents = GetMemPoolParents(stageit);
+        const vecEntries & setMemPoolParents = GetMemPoolParents(stageit);
         for (const txiter& phash : setMemPoolParents) {
             // If this is a new ancestor, add it.
             if (setAncestors.count(phash) == 0) {
@@ -210,7 +244,7 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
 
 void CTxMemPool::UpdateAncestorsOf(bool add, txiter it, setEntries &setAncestors)
 {
-    setEntries parentIters = GetMemPoolParents(it);
+    const vecEntries& parentIters = GetMemPoolParents(it);
     // add or remove this tx as a child of each parent
     for (const txiter& piter : parentIters) {
         UpdateChild(piter, it, add);
@@ -239,7 +273,7 @@ void CTxMemPool::UpdateEntryForAncestors(txiter it, const setEntries &setAncesto
 
 void CTxMemPool::UpdateChildrenForRemoval(txiter it)
 {
-    const setEntries &setMemPoolChildren = GetMemPoolChildren(it);
+    const vecEntries &setMemPoolChildren = GetMemPoolChildren(it);
     for (const txiter& updateIt : setMemPoolChildren) {
         UpdateParent(updateIt, it, false);
     }
@@ -324,7 +358,9 @@ void CTxMemPoolEntry::UpdateAncestorState(int64_t modifySize, CAmount modifyFee,
 }
 
 CTxMemPool::CTxMemPool(const CFeeRate& _minReasonableRelayFee) :
-        nTransactionsUpdated(0)
+        nTransactionsUpdated(0),
+        mapTx(indexed_transaction_set::ctor_args_list(), MemPoolAllocator<CTxMemPoolEntry>(&m_pool_resource)),
+        mapLinks(txlinksMap::allocator_type(&m_pool_resource))
 {
     _clear();   // lock-free clear
 
@@ -418,7 +454,7 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
     // Used by AcceptToMemoryPool(), which DOES do all the appropriate checks.
     LOCK(cs);
     indexed_transaction_set::iterator newit = mapTx.insert(entry).first;
-    mapLinks.insert(make_pair(newit, TxLinks()));
+    mapLinks.insert(std::make_pair(newit, TxLinks()));
 
     // Update transaction for any feeDelta created by PrioritiseTransaction
     // TODO: refactor so that the fee delta is calculated before inserting
@@ -431,6 +467,10 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
         }
     }
 
+    if (nBatchInsertions > 0) {
+        mapBatchAncestors.emplace(newit, setAncestors);
+    }
+
     // Update cachedInnerUsage to include contained transaction's usage.
     // (When we update the entry for in-mempool parents, memory usage will be
     // further updated.)
@@ -548,6 +588,8 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
     }
 
     AssertLockHeld(cs);
+    // The ancestors of the entries of the batch could include this one
+    mapBatchAncestors.clear();
     const CTransaction& tx = it->GetTx();
     for (const CTxIn& txin : tx.vin)
         mapNextTx.erase(txin.prevout);
@@ -589,7 +631,7 @@ void CTxMemPool::CalculateDescendants(txiter entryit, setEntries &setDescendants
         setDescendants.insert(it);
         stage.erase(it);
 
-        const setEntries &setChildren = GetMemPoolChildren(it);
+        const vecEntries &setChildren = GetMemPoolChildren(it);
         for (const txiter& childiter : setChildren) {
             if (!setDescendants.count(childiter)) {
                 stage.insert(childiter);
@@ -869,8 +911,23 @@ void CTxMemPool::removeForBlock(const std::vector<CTransactionRef>& vtx, unsigne
 }
 
 
+CTxMemPool::BatchInsertion::BatchInsertion(CTxMemPool& _pool) : pool(_pool)
+{
+    LOCK(pool.cs);
+    pool.nBatchInsertions++;
+}
+
+CTxMemPool::BatchInsertion::~BatchInsertion()
+{
+    LOCK(pool.cs);
+    if (--pool.nBatchInsertions == 0) {
+        pool.mapBatchAncestors.clear();
+    }
+}
+
 void CTxMemPool::_clear()
 {
+    mapBatchAncestors.clear();
     mapLinks.clear();
     mapTx.clear();
     mapNextTx.clear();
@@ -949,7 +1006,7 @@ void CTxMemPool::check(const CCoinsViewCache* pcoins) const
                 assert(!pcoins->GetNullifier(sd.nullifier));
             }
         }
-        assert(setParentCheck == GetMemPoolParents(it));
+        assert(setParentCheck == setEntries(links.parents.begin(), links.parents.end()));
         // Verify ancestor state is correct.
         setEntries setAncestors;
         uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
@@ -982,7 +1039,7 @@ void CTxMemPool::check(const CCoinsViewCache* pcoins) const
                 childSizes += childit->GetTxSize();
             }
         }
-        assert(setChildrenCheck == GetMemPoolChildren(it));
+        assert(setChildrenCheck == setEntries(links.children.begin(), links.children.end()));
         // Also check to make sure size is greater than sum with immediate children.
         // just a sanity check, not definitive that this calc is correct...
         assert(it->GetSizeWithDescendants() >= (uint64_t)(childSizes + it->GetTxSize()));
@@ -993,7 +1050,7 @@ void CTxMemPool::check(const CCoinsViewCache* pcoins) const
         else {
             CValidationState state;
             PrecomputedTransactionData precomTxData(tx);
-            assert(CheckInputs(tx, state, mempoolDuplicate, false, 0, false, precomTxData, nullptr));
+            assert(CheckInputs(tx, state, mempoolDuplicate, false, 0, false, false, precomTxData, nullptr));
             UpdateCoins(tx, mempoolDuplicate, 1000000);
         }
     }
@@ -1009,7 +1066,7 @@ void CTxMemPool::check(const CCoinsViewCache* pcoins) const
             assert(stepsSinceLastRemove < waitingOnDependants.size());
         } else {
             PrecomputedTransactionData precomTxData(entry->GetTx());
-            assert(CheckInputs(entry->GetTx(), state, mempoolDuplicate, false, 0, false, precomTxData, nullptr));
+            assert(CheckInputs(entry->GetTx(), state, mempoolDuplicate, false, 0, false, false, precomTxData, nullptr));
             UpdateCoins(entry->GetTx(), mempoolDuplicate, 1000000);
             stepsSinceLastRemove = 0;
         }
@@ -1134,6 +1191,15 @@ std::shared_ptr<const CTransaction> CTxMemPool::get(const uint256& hash) const
     return i->GetSharedTx();
 }
 
+std::shared_ptr<PrecomputedTransactionData> CTxMemPool::getPrecomputedTxData(const uint256& hash) const
+{
+    LOCK(cs);
+    indexed_transaction_set::const_iterator i = mapTx.find(hash);
+    if (i == mapTx.end())
+        return nullptr;
+    return i->GetPrecomputedTxData();
+}
+
 TxMempoolInfo CTxMemPool::info(const uint256& hash) const
 {
     LOCK(cs);
@@ -1257,6 +1323,7 @@ void CTxMemPool::PrioritiseTransaction(const uint256& hash, const CAmount& nFeeD
             for (const txiter& ancestorIt : setAncestors) {
                 mapTx.modify(ancestorIt, update_descendant_state(0, nFeeDelta, 0));
             }
+            ++nTransactionsUpdated;
         }
     }
     LogPrintf("PrioritiseTransaction: %s feerate += %s\n", hash.ToString(), FormatMoney(nFeeDelta));
@@ -1284,6 +1351,16 @@ bool CTxMemPool::nullifierExists(const uint256& nullifier) const
     return mapSaplingNullifiers.count(nullifier);
 }
 
+bool CTxMemPool::anyNullifierExists(Span<const SpendDescription> spends) const
+{
+    LOCK(cs);
+    if (mapSaplingNullifiers.empty()) return false;
+    for (const SpendDescription& sd : spends) {
+        if (mapSaplingNullifiers.count(sd.nullifier)) return true;
+    }
+    return false;
+}
+
 bool CTxMemPool::HasNoInputsOf(const CTransaction &tx) const
 {
     if (tx.HasZerocoinSpendInputs())
@@ -1324,19 +1401,46 @@ bool CCoinsViewMemPool::GetNullifier(const uint256& nullifier) const
     return mempool.nullifierExists(nullifier) || base->GetNullifier(nullifier);
 }
 
+void CCoinsViewMemPool::GetNullifiers(const std::vector<uint256>& nullifiers, std::vector<bool>& vSpent) const
+{
+    base->GetNullifiers(nullifiers, vSpent);
+    for (size_t i = 0; i < nullifiers.size(); i++) {
+        if (!vSpent[i]) vSpent[i] = mempool.nullifierExists(nullifiers[i]);
+    }
+}
+
 size_t CTxMemPool::DynamicMemoryUsage() const
 {
     LOCK(cs);
-    // Estimate the overhead of mapTx to be 15 pointers + an allocation, as no exact formula for
-    // boost::multi_index_contained is implemented.
-    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 15 * sizeof(void*)) * mapTx.size() +
+    // Estimate the overhead of mapTx to be 15 pointers, as no exact formula for
+    // boost::multi_index_contained is implemented. The nodes of mapTx and mapLinks
+    // come from the pool, so that they have no allocation overhead.
+    return memusage::PoolUsage(sizeof(CTxMemPoolEntry) + 15 * sizeof(void*)) * mapTx.size() +
             memusage::DynamicUsage(mapNextTx) +
             memusage::DynamicUsage(mapDeltas) +
-            memusage::DynamicUsage(mapLinks) +
+            memusage::PoolUsage(sizeof(memusage::stl_tree_node<txlinksMap::value_type>)) * mapLinks.size() +
             cachedInnerUsage +
             memusage::DynamicUsage(mapSaplingNullifiers);
 }
 
+MemPoolUsage CTxMemPool::GetMemoryUsage() const
+{
+    LOCK(cs);
+    MemPoolUsage usage;
+    size_t nLinksInnerUsage = 0;
+    for (const auto& it : mapLinks) {
+        nLinksInnerUsage += memusage::DynamicUsage(it.second.parents) + memusage::DynamicUsage(it.second.children);
+    }
+    usage.nTransactions = cachedInnerUsage - nLinksInnerUsage;
+    usage.nEntries = memusage::PoolUsage(sizeof(CTxMemPoolEntry) + 15 * sizeof(void*)) * mapTx.size();
+    usage.nLinks = memusage::PoolUsage(sizeof(memusage::stl_tree_node<txlinksMap::value_type>)) * mapLinks.size() + nLinksInnerUsage;
+    usage.nSpends = memusage::DynamicUsage(mapNextTx);
+    usage.nNullifiers = memusage::DynamicUsage(mapSaplingNullifiers);
+    usage.nDeltas = memusage::DynamicUsage(mapDeltas);
+    usage.nPoolAllocated = m_pool_resource.NumAllocatedChunks() * m_pool_resource.ChunkSizeBytes();
+    return usage;
+}
+
 void CTxMemPool::RemoveStaged(setEntries &stage, bool updateDescendants, MemPoolRemovalReason reason)
 {
     AssertLockHeld(cs);
@@ -1373,27 +1477,33 @@ bool CTxMemPool::addUnchecked(const uint256&hash, const CTxMemPoolEntry &entry,
     return addUnchecked(hash, entry, setAncestors, validFeeEstimate);
 }
 
-void CTxMemPool::UpdateChild(txiter entry, txiter child, bool add)
+void CTxMemPool::UpdateLink(vecEntries& links, txiter link, bool add)
 {
-    setEntries s;
-    if (add && mapLinks[entry].children.insert(child).second) {
-        cachedInnerUsage += memusage::IncrementalDynamicUsage(s);
-    } else if (!add && mapLinks[entry].children.erase(child)) {
-        cachedInnerUsage -= memusage::IncrementalDynamicUsage(s);
+    auto it = std::lower_bound(links.begin(), links.end(), link, CompareIteratorByHash());
+    const bool fFound = it != links.end() && *it == link;
+    if (add == fFound) return;
+    cachedInnerUsage -= memusage::DynamicUsage(links);
+    if (add) {
+        links.insert(it, link);
+    } else {
+        links.erase(it);
+        // Give back the unused capacity
+        vecEntries(links).swap(links);
     }
+    cachedInnerUsage += memusage::DynamicUsage(links);
+}
+
+void CTxMemPool::UpdateChild(txiter entry, txiter child, bool add)
+{
+    UpdateLink(mapLinks[entry].children, child, add);
 }
 
 void CTxMemPool::UpdateParent(txiter entry, txiter parent, bool add)
 {
-    setEntries s;
-    if (add && mapLinks[entry].parents.insert(parent).second) {
-        cachedInnerUsage += memusage::IncrementalDynamicUsage(s);
-    } else if (!add && mapLinks[entry].parents.erase(parent)) {
-        cachedInnerUsage -= memusage::IncrementalDynamicUsage(s);
-    }
+    UpdateLink(mapLinks[entry].parents, parent, add);
 }
 
-const CTxMemPool::setEntries & CTxMemPool::GetMemPoolParents(txiter entry) const
+const CTxMemPool::vecEntries & CTxMemPool::GetMemPoolParents(txiter entry) const
 {
     assert (entry != mapTx.end());
     txlinksMap::const_iterator it = mapLinks.find(entry);
@@ -1401,7 +1511,7 @@ const CTxMemPool::setEntries & CTxMemPool::GetMemPoolParents(txiter entry) const
     return it->second.parents;
 }
 
-const CTxMemPool::setEntries & CTxMemPool::GetMemPoolChildren(txiter entry) const
+const CTxMemPool::vecEntries & CTxMemPool::GetMemPoolChildren(txiter entry) const
 {
     assert (entry != mapTx.end());
     txlinksMap::const_iterator it = mapLinks.find(entry);
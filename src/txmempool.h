@@ -10,6 +10,7 @@
 #include <list>
 #include <memory>
 #include <set>
+#include <unordered_map>
 
 #include "amount.h"
 #include "coins.h"
@@ -20,6 +21,8 @@
 #include "sync.h"
 #include "random.h"
 #include "netaddress.h"
+#include "span.h"
+#include "support/allocators/pool.h"
 
 #include "boost/multi_index_container.hpp"
 #include "boost/multi_index/ordered_index.hpp"
@@ -28,6 +31,7 @@
 
 class CAutoFile;
 class CBLSPublicKey;
+struct PrecomputedTransactionData;
 
 
 /** Fake height value used in Coin to signify they are only in the memory pool (since 0.8) */
@@ -66,6 +70,8 @@ private:
     bool spendsCoinbaseOrCoinstake; //! keep track of transactions that spend a coinbase or a coinstake
     unsigned int sigOpCount; //! Legacy sig ops plus P2SH sig op count
     int64_t feeDelta; //! Used for determining the priority of the transaction for mining in a block
+    std::shared_ptr<PrecomputedTransactionData> precomTxData; //! The hashes of the script checks, reused when connecting the tx
+    size_t nPrecomTxDataUsage{0}; //! Memory usage of precomTxData, part of nUsageSize
 
     // Information about descendants of this transaction that are in the
     // mempool; if we remove this transaction we must remove all of these
@@ -98,6 +104,8 @@ public:
     unsigned int GetSigOpCount() const { return sigOpCount; }
     int64_t GetModifiedFee() const { return nFee + feeDelta; }
     size_t DynamicMemoryUsage() const { return nUsageSize; }
+    const std::shared_ptr<PrecomputedTransactionData>& GetPrecomputedTxData() const { return precomTxData; }
+    void SetPrecomputedTxData(std::shared_ptr<PrecomputedTransactionData> data);
 
     // Adjusts the descendant state, if this entry is not dirty.
     void UpdateDescendantState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount);
@@ -380,6 +388,29 @@ enum class MemPoolRemovalReason {
  * the feerate of the transaction without any descendants.
  *
  */
+/**
+ * The nodes of mapTx and mapLinks are pool allocated: they cost no malloc overhead, and the nodes of the removed
+ * transactions are reused by the next ones. A mapTx node (an entry and the links of its five indexes) fits in a block.
+ */
+static const size_t MEMPOOL_POOL_BLOCK_BYTES = 512;
+typedef PoolResource<MEMPOOL_POOL_BLOCK_BYTES, alignof(void*)> MemPoolResource;
+template <typename T>
+using MemPoolAllocator = PoolAllocator<T, MEMPOOL_POOL_BLOCK_BYTES, alignof(void*)>;
+
+/** Memory usage of the mempool, by container (see CTxMemPool::GetMemoryUsage) */
+struct MemPoolUsage
+{
+    size_t nTransactions{0};  // the transactions themselves, and their precomputed data
+    size_t nEntries{0};       // mapTx
+    size_t nLinks{0};         // mapLinks
+    size_t nSpends{0};        // mapNextTx
+    size_t nNullifiers{0};    // mapSaplingNullifiers
+    size_t nDeltas{0};        // mapDeltas
+    size_t nPoolAllocated{0}; // memory of the node pool, including its unused blocks (not part of the total)
+
+    size_t Total() const { return nTransactions + nEntries + nLinks + nSpends + nNullifiers + nDeltas; }
+};
+
 class CTxMemPool
 {
 private:
@@ -390,6 +421,7 @@ private:
     CFeeRate minRelayFee; //! Passed to constructor to avoid dependency on main
     uint64_t totalTxSize; //! sum of all mempool tx' byte sizes
     uint64_t cachedInnerUsage; //! sum of dynamic memory usage of all the map elements (NOT the maps themselves)
+    MemPoolResource m_pool_resource; //! must outlive mapTx and mapLinks
 
     CFeeRate minReasonableRelayFee;
 
@@ -400,7 +432,7 @@ private:
     void trackPackageRemoved(const CFeeRate& rate);
 
     // Shielded txes
-    std::map<uint256, CTransactionRef> mapSaplingNullifiers;
+    std::unordered_map<uint256, CTransactionRef, SaltedIdHasher> mapSaplingNullifiers;
     void checkNullifiers() const;
 
     bool m_is_loaded GUARDED_BY(cs){false};
@@ -438,7 +470,8 @@ public:
                 boost::multi_index::identity<CTxMemPoolEntry>,
                 CompareTxMemPoolEntryByAncestorFee
             >
-        >
+        >,
+        MemPoolAllocator<CTxMemPoolEntry>
     > indexed_transaction_set;
 
     /**
@@ -479,27 +512,50 @@ public:
         }
     };
     typedef std::set<txiter, CompareIteratorByHash> setEntries;
+    //! In-mempool parents or children of a transaction, sorted as in setEntries (a handful of them, at most)
+    typedef std::vector<txiter> vecEntries;
 
-    const setEntries & GetMemPoolParents(txiter entry) const;
-    const setEntries & GetMemPoolChildren(txiter entry) const;
+    const vecEntries & GetMemPoolParents(txiter entry) const;
+    const vecEntries & GetMemPoolChildren(txiter entry) const;
+
+    /**
+     * Scope of the insertion of a batch of transactions, in topological order (re-added after a reorg, or loaded
+     * from mempool.dat). The ancestors of the entries added in the scope are kept, so that CalculateMemPoolAncestors()
+     * takes the ancestors of such a parent at once, instead of walking them again through mapLinks.
+     * They are dropped at the first removal from the mempool, or UpdateTransactionsFromBlock().
+     */
+    class BatchInsertion
+    {
+    private:
+        CTxMemPool& pool;
+
+    public:
+        explicit BatchInsertion(CTxMemPool& _pool);
+        ~BatchInsertion();
+    };
 
 private:
     typedef std::map<txiter, setEntries, CompareIteratorByHash> cacheMap;
 
     struct TxLinks {
-        setEntries parents;
-        setEntries children;
+        vecEntries parents;
+        vecEntries children;
     };
 
-    typedef std::map<txiter, TxLinks, CompareIteratorByHash> txlinksMap;
+    typedef std::map<txiter, TxLinks, CompareIteratorByHash, MemPoolAllocator<std::pair<const txiter, TxLinks> > > txlinksMap;
     txlinksMap mapLinks;
 
+    //! Number of the open BatchInsertion scopes, and ancestors of the entries they added
+    int nBatchInsertions{0};
+    cacheMap mapBatchAncestors;
+
     std::multimap<uint256, uint256> mapProTxRefs; // proTxHash -> transaction (all TXs that refer to an existing proTx)
     std::map<CService, uint256> mapProTxAddresses;
     std::map<CKeyID, uint256> mapProTxPubKeyIDs;
     std::map<uint256, uint256> mapProTxBlsPubKeyHashes;
     std::map<COutPoint, uint256> mapProTxCollaterals;
 
+    void UpdateLink(vecEntries& links, txiter link, bool add);
     void UpdateParent(txiter entry, txiter parent, bool add);
     void UpdateChild(txiter entry, txiter child, bool add);
 
@@ -562,6 +618,8 @@ public:
     void ClearPrioritisation(const uint256 hash);
 
     bool nullifierExists(const uint256& nullifier) const;
+    /** Whether any of the nullifiers of spends is spent by a mempool transaction (with a single lock) */
+    bool anyNullifierExists(Span<const SpendDescription> spends) const;
 
     /** Remove a set of transactions from the mempool.
      *  If a transaction is in this set, then all in-mempool descendants must
@@ -651,6 +709,8 @@ public:
     }
 
     CTransactionRef get(const uint256& hash) const;
+    /** The data of the script checks of the mempool tx hash (null if the tx or its data are missing) */
+    std::shared_ptr<PrecomputedTransactionData> getPrecomputedTxData(const uint256& hash) const;
     TxMempoolInfo info(const uint256& hash) const;
     std::vector<TxMempoolInfo> infoAll() const;
 
@@ -671,6 +731,8 @@ public:
     bool ReadFeeEstimates(CAutoFile& filein);
 
     size_t DynamicMemoryUsage() const;
+    /** The memory usage of DynamicMemoryUsage(), by container */
+    MemPoolUsage GetMemoryUsage() const;
 
 private:
     /** UpdateForDescendants is used by UpdateTransactionsFromBlock to update
@@ -735,6 +797,7 @@ public:
     bool GetCoin(const COutPoint& outpoint, Coin& coin) const;
     bool HaveCoin(const COutPoint& outpoint) const;
     bool GetNullifier(const uint256& nullifier) const;
+    void GetNullifiers(const std::vector<uint256>& nullifiers, std::vector<bool>& vSpent) const;
 };
 
 /**
@@ -0,0 +1,419 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "txreconciliation.h"
+
+#include "crypto/siphash.h"
+#include "hash.h"
+#include "random.h"
+
+#include <algorithm>
+
+namespace {
+
+// GF(2^32) elements, modulo the irreducible x^32 + x^7 + x^3 + x^2 + 1
+const uint64_t FIELD_MODULUS = 0x10000008DULL;
+
+uint32_t Mul(uint32_t a, uint32_t b)
+{
+    uint64_t r = 0;
+    for (int i = 0; i < 32; i++) {
+        r ^= ((uint64_t)a << i) & (0 - (uint64_t)((b >> i) & 1));
+    }
+    for (int i = 62; i >= 32; i--) {
+        r ^= (FIELD_MODULUS << (i - 32)) & (0 - ((r >> i) & 1));
+    }
+    return (uint32_t)r;
+}
+
+uint32_t Sqr(uint32_t a) { return Mul(a, a); }
+
+// a^(2^32 - 2)
+uint32_t Inv(uint32_t a)
+{
+    uint32_t r = 1;
+    for (int i = 0; i < 31; i++) {
+        a = Sqr(a);
+        r = Mul(r, a);
+    }
+    return r;
+}
+
+// Polynomials over GF(2^32), lowest degree coefficient first, without leading zeros
+typedef std::vector<uint32_t> Poly;
+
+void Trim(Poly& a)
+{
+    while (!a.empty() && a.back() == 0) a.pop_back();
+}
+
+void MakeMonic(Poly& a)
+{
+    const uint32_t inv = Inv(a.back());
+    for (auto& c : a) c = Mul(c, inv);
+}
+
+// a = a mod f (monic f), returns the quotient
+Poly DivMod(Poly& a, const Poly& f)
+{
+    const size_t df = f.size() - 1;
+    if (a.size() <= df) return Poly();
+    Poly q(a.size() - df, 0);
+    for (size_t i = a.size() - 1; i >= df; i--) {
+        const uint32_t c = a[i];
+        if (c != 0) {
+            q[i - df] = c;
+            for (size_t j = 0; j <= df; j++) {
+                a[i - df + j] ^= Mul(c, f[j]);
+            }
+        }
+        if (i == df) break;
+    }
+    a.resize(df);
+    Trim(a);
+    return q;
+}
+
+// a^2 mod f (monic f)
+Poly SqrMod(const Poly& a, const Poly& f)
+{
+    if (a.empty()) return a;
+    Poly r(2 * a.size() - 1, 0);
+    for (size_t i = 0; i < a.size(); i++) {
+        r[2 * i] = Sqr(a[i]);
+    }
+    DivMod(r, f);
+    return r;
+}
+
+Poly Gcd(Poly a, Poly b)
+{
+    while (!b.empty()) {
+        MakeMonic(b);
+        DivMod(a, b);
+        std::swap(a, b);
+    }
+    if (!a.empty()) MakeMonic(a);
+    return a;
+}
+
+// Roots of the monic f, which must split in distinct linear factors. Berlekamp trace algorithm: with the basis
+// elements beta = 2^k, gcd(f, Tr(beta * x)) splits f, unless all its roots have the same trace for beta (the
+// previous basis elements didn't split the parent polynomial either).
+void FindRoots(const Poly& f, std::vector<uint32_t>& roots, int k)
+{
+    if (f.size() <= 1) return;
+    if (f.size() == 2) {
+        // x + c
+        roots.emplace_back(f[0]);
+        return;
+    }
+    for (; k < 32; k++) {
+        Poly t{0, (uint32_t)1 << k};
+        Poly trace = t;
+        for (int i = 1; i < 32; i++) {
+            t = SqrMod(t, f);
+            if (trace.size() < t.size()) trace.resize(t.size(), 0);
+            for (size_t j = 0; j < t.size(); j++) trace[j] ^= t[j];
+        }
+        Trim(trace);
+        Poly g = Gcd(f, trace);
+        if (g.size() > 1 && g.size() < f.size()) {
+            Poly rem = f;
+            const Poly& q = DivMod(rem, g);
+            FindRoots(g, roots, k + 1);
+            FindRoots(q, roots, k + 1);
+            return;
+        }
+    }
+}
+
+} // anon namespace
+
+void CTxSketch::Add(uint32_t element)
+{
+    const uint32_t sqr = Sqr(element);
+    uint32_t pw = element;
+    for (auto& s : syndromes) {
+        s ^= pw;
+        pw = Mul(pw, sqr);
+    }
+}
+
+void CTxSketch::Merge(const CTxSketch& other)
+{
+    const size_t n = std::min(syndromes.size(), other.syndromes.size());
+    syndromes.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        syndromes[i] ^= other.syndromes[i];
+    }
+}
+
+bool CTxSketch::Decode(std::vector<uint32_t>& elements) const
+{
+    elements.clear();
+    const size_t capacity = syndromes.size();
+    if (std::all_of(syndromes.begin(), syndromes.end(), [](uint32_t s) { return s == 0; })) {
+        return true;
+    }
+
+    // All the power sums S_1..S_2c: in characteristic 2, S_2i = S_i^2
+    std::vector<uint32_t> s(2 * capacity);
+    for (size_t i = 0; i < s.size(); i++) {
+        const size_t p = i + 1;
+        s[i] = (p & 1) ? syndromes[p / 2] : Sqr(s[p / 2 - 1]);
+    }
+
+    // Berlekamp-Massey: the error locator polynomial C(z) = prod(1 - x_j * z)
+    Poly c{1}, b{1};
+    size_t l = 0, m = 1;
+    uint32_t bd = 1;
+    for (size_t n = 0; n < s.size(); n++) {
+        uint32_t d = s[n];
+        for (size_t i = 1; i <= l && i < c.size(); i++) {
+            d ^= Mul(c[i], s[n - i]);
+        }
+        if (d == 0) {
+            m++;
+            continue;
+        }
+        const uint32_t coef = Mul(d, Inv(bd));
+        Poly prev = c;
+        if (c.size() < b.size() + m) c.resize(b.size() + m, 0);
+        for (size_t i = 0; i < b.size(); i++) {
+            c[i + m] ^= Mul(coef, b[i]);
+        }
+        if (2 * l <= n) {
+            l = n + 1 - l;
+            b = std::move(prev);
+            bd = d;
+            m = 1;
+        } else {
+            m++;
+        }
+    }
+    Trim(c);
+    if (l > capacity || c.size() != l + 1) return false;
+
+    // The elements are the roots of the reversed (monic) locator polynomial
+    Poly f(c.rbegin(), c.rend());
+    // Check that f splits in distinct linear factors: x^(2^32) = x mod f
+    Poly x{0, 1};
+    if (f.size() > 2) {
+        Poly t = x;
+        for (int i = 0; i < 32; i++) {
+            t = SqrMod(t, f);
+        }
+        if (t != x) return false;
+    }
+    FindRoots(f, elements, 0);
+    if (elements.size() != l) return false;
+
+    // A too big difference may still decode to a wrong set of elements
+    CTxSketch check(capacity);
+    for (uint32_t e : elements) {
+        check.Add(e);
+    }
+    return check.syndromes == syndromes;
+}
+
+uint32_t TxReconciliationTracker::PeerState::ComputeShortID(const uint256& txid) const
+{
+    const uint64_t h = SipHashUint256(k0, k1, txid);
+    return 1 + (uint32_t)((h & 0xFFFFFFFF) % 0xFFFFFFFF);
+}
+
+uint64_t TxReconciliationTracker::PreRegisterPeer(NodeId nodeId)
+{
+    const uint64_t salt = GetRand(std::numeric_limits<uint64_t>::max());
+    LOCK(cs);
+    preRegistered[nodeId] = salt;
+    return salt;
+}
+
+bool TxReconciliationTracker::RegisterPeer(NodeId nodeId, bool fInbound, uint32_t nVersion, uint64_t remoteSalt)
+{
+    LOCK(cs);
+    auto it = preRegistered.find(nodeId);
+    if (it == preRegistered.end() || registered.count(nodeId) || nVersion < TXRECONCILIATION_PROTO_VERSION) {
+        return false;
+    }
+    // Both peers compute the same keys from the two salts
+    const uint64_t localSalt = it->second;
+    preRegistered.erase(it);
+    CHashWriter hw(SER_GETHASH, 0);
+    hw << std::string("Tx Relay Salting") << std::min(localSalt, remoteSalt) << std::max(localSalt, remoteSalt);
+    const uint256& h = hw.GetHash();
+
+    PeerState& state = registered[nodeId];
+    state.fInitiator = !fInbound;
+    state.k0 = h.GetUint64(0);
+    state.k1 = h.GetUint64(1);
+    return true;
+}
+
+void TxReconciliationTracker::ForgetPeer(NodeId nodeId)
+{
+    LOCK(cs);
+    preRegistered.erase(nodeId);
+    registered.erase(nodeId);
+}
+
+bool TxReconciliationTracker::IsPeerRegistered(NodeId nodeId) const
+{
+    LOCK(cs);
+    return registered.count(nodeId) != 0;
+}
+
+bool TxReconciliationTracker::ShouldFloodTo(NodeId nodeId, const uint256& txid) const
+{
+    LOCK(cs);
+    auto it = registered.find(nodeId);
+    if (it == registered.end()) return true;
+    const PeerState& state = it->second;
+    return state.fInitiator && (SipHashUint256(state.k0, state.k1, txid) >> 32) % OUTBOUND_FANOUT_RATIO == 0;
+}
+
+bool TxReconciliationTracker::AddToSet(NodeId nodeId, const uint256& txid)
+{
+    LOCK(cs);
+    auto it = registered.find(nodeId);
+    if (it == registered.end() || it->second.localSet.size() >= MAX_RECONSET_SIZE) return false;
+    it->second.localSet.insert(txid);
+    return true;
+}
+
+void TxReconciliationTracker::TryRemovingFromSet(NodeId nodeId, const uint256& txid)
+{
+    LOCK(cs);
+    auto it = registered.find(nodeId);
+    if (it != registered.end()) {
+        it->second.localSet.erase(txid);
+    }
+}
+
+bool TxReconciliationTracker::InitiateReconciliation(NodeId nodeId, std::chrono::microseconds now, uint16_t& nSetSize)
+{
+    LOCK(cs);
+    auto it = registered.find(nodeId);
+    if (it == registered.end() || !it->second.fInitiator) return false;
+    PeerState& state = it->second;
+    if (state.requestTime.count() != 0 && now < state.requestTime + RECON_RESPONSE_TIMEOUT) return false;
+    if (now < state.nextRequestTime) return false;
+    state.requestTime = now;
+    state.nextRequestTime = now + RECON_REQUEST_INTERVAL;
+    nSetSize = (uint16_t)std::min<size_t>(state.localSet.size(), std::numeric_limits<uint16_t>::max());
+    return true;
+}
+
+bool TxReconciliationTracker::HandleReconciliationRequest(NodeId nodeId, uint16_t nRemoteSetSize, std::vector<uint32_t>& vSketch)
+{
+    LOCK(cs);
+    auto it = registered.find(nodeId);
+    if (it == registered.end() || it->second.fInitiator) return false;
+    PeerState& state = it->second;
+    if (state.fAwaitingDiff) {
+        // The previous reconciliation was abandoned by the peer
+        for (const auto& p : state.sketchSnapshot) {
+            state.localSet.insert(p.second);
+        }
+    }
+    state.sketchSnapshot.clear();
+    std::set<uint256> vCollisions;
+    for (const uint256& txid : state.localSet) {
+        if (!state.sketchSnapshot.emplace(state.ComputeShortID(txid), txid).second) {
+            // Short id collision: left for the next reconciliation
+            vCollisions.insert(txid);
+        }
+    }
+    state.localSet = std::move(vCollisions);
+    state.fAwaitingDiff = true;
+
+    // Estimated difference: the difference of the sizes, and a fraction (1/4) of the smallest set
+    const size_t nLocal = state.sketchSnapshot.size();
+    const size_t capacity = std::max<size_t>(nLocal, nRemoteSetSize) - std::min<size_t>(nLocal, nRemoteSetSize) +
+                            std::min<size_t>(nLocal, nRemoteSetSize) / 4 + 1;
+    vSketch.clear();
+    if (capacity <= MAX_SKETCH_CAPACITY) {
+        CTxSketch sketch(capacity);
+        for (const auto& p : state.sketchSnapshot) {
+            sketch.Add(p.first);
+        }
+        vSketch = sketch.GetSyndromes();
+    }
+    return true;
+}
+
+bool TxReconciliationTracker::HandleSketch(NodeId nodeId, const std::vector<uint32_t>& vSketch, bool& fSuccess,
+                                           std::vector<uint256>& vAnnounce, std::vector<uint32_t>& vRequested)
+{
+    LOCK(cs);
+    auto it = registered.find(nodeId);
+    if (it == registered.end() || !it->second.fInitiator || it->second.requestTime.count() == 0 ||
+        vSketch.size() > MAX_SKETCH_CAPACITY) {
+        return false;
+    }
+    PeerState& state = it->second;
+    state.requestTime = std::chrono::microseconds{0};
+
+    fSuccess = false;
+    vAnnounce.clear();
+    vRequested.clear();
+    if (!vSketch.empty()) {
+        std::map<uint32_t, uint256> localShortIDs;
+        CTxSketch sketch(vSketch);
+        for (const uint256& txid : state.localSet) {
+            const uint32_t shortID = state.ComputeShortID(txid);
+            if (localShortIDs.emplace(shortID, txid).second) {
+                sketch.Add(shortID);
+            }
+        }
+        // A full sketch could be the wrong decoding of a bigger difference: one syndrome is kept as a check
+        std::vector<uint32_t> vDiff;
+        if (sketch.Decode(vDiff) && vDiff.size() < sketch.Capacity()) {
+            fSuccess = true;
+            for (uint32_t shortID : vDiff) {
+                auto itTx = localShortIDs.find(shortID);
+                if (itTx != localShortIDs.end()) {
+                    vAnnounce.emplace_back(itTx->second);
+                } else {
+                    vRequested.emplace_back(shortID);
+                }
+            }
+        }
+    }
+    if (!fSuccess) {
+        vAnnounce.assign(state.localSet.begin(), state.localSet.end());
+    }
+    state.localSet.clear();
+    return true;
+}
+
+bool TxReconciliationTracker::HandleReconciliationDiff(NodeId nodeId, bool fSuccess, const std::vector<uint32_t>& vRequested,
+                                                       std::vector<uint256>& vAnnounce)
+{
+    LOCK(cs);
+    auto it = registered.find(nodeId);
+    if (it == registered.end() || it->second.fInitiator || !it->second.fAwaitingDiff ||
+        vRequested.size() > MAX_SKETCH_CAPACITY) {
+        return false;
+    }
+    PeerState& state = it->second;
+    vAnnounce.clear();
+    if (fSuccess) {
+        for (uint32_t shortID : vRequested) {
+            auto itTx = state.sketchSnapshot.find(shortID);
+            if (itTx != state.sketchSnapshot.end()) {
+                vAnnounce.emplace_back(itTx->second);
+            }
+        }
+    } else {
+        for (const auto& p : state.sketchSnapshot) {
+            vAnnounce.emplace_back(p.second);
+        }
+    }
+    state.sketchSnapshot.clear();
+    state.fAwaitingDiff = false;
+    return true;
+}
@@ -0,0 +1,122 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_TXRECONCILIATION_H
+#define PIVX_TXRECONCILIATION_H
+
+#include "sync.h"
+#include "uint256.h"
+
+#include <chrono>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+typedef int NodeId;
+
+//! Version of the transaction reconciliation protocol announced with sendtxrcncl
+static const uint32_t TXRECONCILIATION_PROTO_VERSION = 1;
+//! Maximum number of transactions waiting to be reconciled with a peer (the next ones are flooded)
+static const size_t MAX_RECONSET_SIZE = 3000;
+//! Maximum number of differences that a sketch can hold (a bigger difference is flooded)
+static const size_t MAX_SKETCH_CAPACITY = 64;
+//! Interval between the reconciliations that we request to each of our outbound peers
+static constexpr std::chrono::seconds RECON_REQUEST_INTERVAL{8};
+//! Time after which an unanswered reconciliation request is sent again
+static constexpr std::chrono::seconds RECON_RESPONSE_TIMEOUT{60};
+//! One in OUTBOUND_FANOUT_RATIO transactions is still announced with an inv to each reconciling outbound peer
+static const uint32_t OUTBOUND_FANOUT_RATIO = 4;
+
+/**
+ * A PinSketch (BCH syndromes over GF(2^32)) of a set of 32-bit non-zero short ids: the odd power sums of the
+ * elements, up to the capacity. Merging two sketches gives the sketch of the symmetric difference of the sets,
+ * which can be decoded when it has no more than capacity elements.
+ */
+class CTxSketch
+{
+private:
+    std::vector<uint32_t> syndromes;
+
+public:
+    explicit CTxSketch(size_t capacity) : syndromes(capacity, 0) {}
+    explicit CTxSketch(std::vector<uint32_t> syndromesIn) : syndromes(std::move(syndromesIn)) {}
+
+    size_t Capacity() const { return syndromes.size(); }
+    const std::vector<uint32_t>& GetSyndromes() const { return syndromes; }
+
+    // Adds (or, as the sketch is linear, removes) a non-zero element
+    void Add(uint32_t element);
+    void Merge(const CTxSketch& other);
+    // Fails if the sketched set has more than Capacity() elements (or the sketches had different capacities)
+    bool Decode(std::vector<uint32_t>& elements) const;
+};
+
+/**
+ * Erlay-like transaction relay: instead of announcing every transaction with an inv to every peer, the
+ * transactions are added to a per-peer set, and the sets are periodically reconciled. We request the
+ * reconciliations (reqtxrcncl) to our outbound peers, which answer with the sketch of their set; the
+ * difference is decoded on our side, then both peers announce with invs only the transactions that the other
+ * one is missing (the ones we miss are requested with a reconcildiff). When the difference is too big for
+ * the sketch, both sets are flooded with invs.
+ * The peers are registered after the sendtxrcncl messages exchange, which gives the salt of the short ids.
+ */
+class TxReconciliationTracker
+{
+private:
+    struct PeerState
+    {
+        // We are the initiator of the reconciliations with our outbound peers
+        bool fInitiator;
+        // SipHash keys of the short ids
+        uint64_t k0, k1;
+        // Transactions not yet reconciled
+        std::set<uint256> localSet;
+        // Initiator: when the reconciliation request was sent (0 if none pending)
+        std::chrono::microseconds requestTime{0};
+        std::chrono::microseconds nextRequestTime{0};
+        // Responder: the set sent in the last sketch (by short id), waiting for the reconcildiff
+        std::map<uint32_t, uint256> sketchSnapshot;
+        bool fAwaitingDiff{false};
+
+        uint32_t ComputeShortID(const uint256& txid) const;
+    };
+
+    mutable Mutex cs;
+    // Our salts, sent in sendtxrcncl
+    std::unordered_map<NodeId, uint64_t> preRegistered GUARDED_BY(cs);
+    std::unordered_map<NodeId, PeerState> registered GUARDED_BY(cs);
+
+public:
+    // Returns the salt to send to the peer in sendtxrcncl
+    uint64_t PreRegisterPeer(NodeId nodeId);
+    // After the peer's sendtxrcncl. Fails if the peer wasn't pre-registered, or already registered
+    bool RegisterPeer(NodeId nodeId, bool fInbound, uint32_t nVersion, uint64_t remoteSalt);
+    void ForgetPeer(NodeId nodeId);
+    bool IsPeerRegistered(NodeId nodeId) const;
+
+    // Whether the tx is still announced with an inv to this registered peer (low fanout to the outbound peers)
+    bool ShouldFloodTo(NodeId nodeId, const uint256& txid) const;
+    // Fails when the set is full (the tx must be announced with an inv)
+    bool AddToSet(NodeId nodeId, const uint256& txid);
+    // The peer announced the tx to us
+    void TryRemovingFromSet(NodeId nodeId, const uint256& txid);
+
+    // Initiator: whether it's time to send a reconciliation request, with the size of our set
+    bool InitiateReconciliation(NodeId nodeId, std::chrono::microseconds now, uint16_t& nSetSize);
+    // Responder: the sketch of our set to answer a reqtxrcncl (empty if the difference would be too big).
+    // Fails on unexpected requests.
+    bool HandleReconciliationRequest(NodeId nodeId, uint16_t nRemoteSetSize, std::vector<uint32_t>& vSketch);
+    // Initiator: decodes the difference with our set. Fills the txes to announce to the peer and the short ids of
+    // the ones to request (all our set is announced when the decoding fails) and clears our set.
+    // Fails on unexpected sketches.
+    bool HandleSketch(NodeId nodeId, const std::vector<uint32_t>& vSketch, bool& fSuccess,
+                      std::vector<uint256>& vAnnounce, std::vector<uint32_t>& vRequested);
+    // Responder: the txes to announce to the peer after a reconcildiff (all the sketched set on failure).
+    // Fails on unexpected diffs.
+    bool HandleReconciliationDiff(NodeId nodeId, bool fSuccess, const std::vector<uint32_t>& vRequested,
+                                  std::vector<uint256>& vAnnounce);
+};
+
+#endif // PIVX_TXRECONCILIATION_H
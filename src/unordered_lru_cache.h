@@ -6,6 +6,8 @@
 #ifndef PIVX_UNORDERED_LRU_CACHE_H
 #define PIVX_UNORDERED_LRU_CACHE_H
 
+#include "memusage.h"
+
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
@@ -32,6 +34,7 @@ public:
     }
 
     size_t max_size() const { return maxSize; }
+    size_t DynamicMemoryUsage() const { return memusage::DynamicUsage(cacheMap); }
 
     template<typename Value2>
     void _emplace(const Key& key, Value2&& v)
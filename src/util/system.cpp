@@ -621,7 +621,44 @@ const fs::path &ZC_GetParamsDir()
     return path;
 }
 
-void initZKSNARKS()
+//! Identifies the params files by their path, size and modification time
+static std::string GetSaplingParamsStamp(const fs::path& sapling_spend, const fs::path& sapling_output)
+{
+    std::string stamp;
+    for (const fs::path& file : {sapling_spend, sapling_output}) {
+        stamp += strprintf("%s %u %d\n", fs::system_complete(file).string(),
+                           (uint64_t)fs::file_size(file), (int64_t)fs::last_write_time(file));
+    }
+    return stamp;
+}
+
+static fs::path GetSaplingParamsVerifiedMarker()
+{
+    return GetDataDir() / "sapling-params.verified";
+}
+
+//! Whether the files were hashed by a previous start, and not modified since then
+static bool IsSaplingParamsVerified(const std::string& stamp)
+{
+    fsbridge::ifstream file(GetSaplingParamsVerifiedMarker());
+    if (!file.is_open()) return false;
+    const std::string verified_stamp((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return verified_stamp == stamp;
+}
+
+static void WriteSaplingParamsVerified(const std::string& stamp)
+{
+    fsbridge::ofstream file(GetSaplingParamsVerifiedMarker(), std::ios::trunc);
+    file << stamp;
+}
+
+// The params files found by initZKSNARKS, and whether the proving parameters were loaded
+static std::mutex cs_zksnark_params;
+static fs::path g_sapling_spend_path;
+static fs::path g_sapling_output_path;
+static bool g_sapling_proving_params_loaded = false;
+
+void initZKSNARKS(bool fLoadProvingParams)
 {
     const fs::path& path = ZC_GetParamsDir();
     fs::path sapling_spend = path / "sapling-spend.params";
@@ -676,7 +713,13 @@ void initZKSNARKS()
     auto sapling_spend_str = sapling_spend.native();
     auto sapling_output_str = sapling_output.native();
 
-    //LogPrintf("Loading Sapling (Spend) parameters from %s\n", sapling_spend.string().c_str());
+    // The files hashed by a previous start, and not modified since then, are trusted
+    const std::string stamp = GetSaplingParamsStamp(sapling_spend, sapling_output);
+    const bool fVerifyParams = !IsSaplingParamsVerified(stamp);
+
+    std::lock_guard<std::mutex> lock(cs_zksnark_params);
+    g_sapling_spend_path = sapling_spend;
+    g_sapling_output_path = sapling_output;
 
     librustzcash_init_zksnark_params(
         reinterpret_cast<const codeunit*>(sapling_spend_str.c_str()),
@@ -687,12 +730,47 @@ void initZKSNARKS()
         "657e3d38dbb5cb5e7dd2970e8b03d69b4787dd907285b5a7f0790dcc8072f60bf593b32cc2d1c030e00ff5ae64bf84c5c3beb84ddc841d48264b4a171744d028",
         nullptr,    // sprout_path
         0,          // sprout_path_len
-        ""          // sprout_hash
+        "",         // sprout_hash
+        fVerifyParams,
+        fLoadProvingParams
     );
+    g_sapling_proving_params_loaded = fLoadProvingParams;
+
+    // The hashes of the files matched (the library aborts otherwise)
+    if (fVerifyParams) {
+        WriteSaplingParamsVerified(stamp);
+    }
 
     //std::cout << "### Sapling params initialized ###" << std::endl;
 }
 
+void initZKSNARKSProvingParams()
+{
+    std::lock_guard<std::mutex> lock(cs_zksnark_params);
+    if (g_sapling_proving_params_loaded) return;
+    if (g_sapling_spend_path.empty()) {
+        throw std::runtime_error("Sapling params not initialized");
+    }
+
+    const std::string stamp = GetSaplingParamsStamp(g_sapling_spend_path, g_sapling_output_path);
+    const bool fVerifyParams = !IsSaplingParamsVerified(stamp);
+    auto sapling_spend_str = g_sapling_spend_path.native();
+    auto sapling_output_str = g_sapling_output_path.native();
+    LogPrintf("Loading Sapling proving parameters...\n");
+    librustzcash_load_zksnark_proving_params(
+        reinterpret_cast<const codeunit*>(sapling_spend_str.c_str()),
+        sapling_spend_str.length(),
+        reinterpret_cast<const codeunit*>(sapling_output_str.c_str()),
+        sapling_output_str.length(),
+        fVerifyParams
+    );
+    g_sapling_proving_params_loaded = true;
+
+    if (fVerifyParams) {
+        WriteSaplingParamsVerified(stamp);
+    }
+}
+
 const fs::path &GetBlocksDir()
 {
 
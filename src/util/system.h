@@ -104,8 +104,11 @@ const fs::path &GetDataDir(bool fNetSpecific = true);
 bool CheckDataDirOption();
 // Sapling network dir
 const fs::path &ZC_GetParamsDir();
-// Init sapling library
-void initZKSNARKS();
+// Init sapling library. Without fLoadProvingParams only the verifying keys are loaded,
+// and the proving parameters are loaded by initZKSNARKSProvingParams on first use.
+void initZKSNARKS(bool fLoadProvingParams = true);
+// Load the sapling proving parameters, if not loaded yet
+void initZKSNARKSProvingParams();
 void ClearDatadirCache();
 fs::path GetConfigFile(const std::string& confPath);
 fs::path GetMasternodeConfigFile();
@@ -0,0 +1,86 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "utxo_snapshot.h"
+
+#include "chain.h"
+#include "hash.h"
+#include "streams.h"
+#include "txdb.h"
+#include "util/system.h"
+#include "validation.h"
+
+bool DumpUTXOSnapshot(const fs::path& path, SnapshotStats& stats, std::string& strError)
+{
+    stats = SnapshotStats();
+    // The chainstate must not change while it's written
+    LOCK(cs_main);
+    FlushStateToDisk();
+    const CBlockIndex* pindexBase = chainActive.Tip();
+    if (!pindexBase || pcoinsdbview->GetBestBlock() != pindexBase->GetBlockHash()) {
+        strError = "unable to flush the chainstate";
+        return false;
+    }
+
+    const fs::path temppath = path.string() + ".incomplete";
+    CAutoFile afile(fsbridge::fopen(temppath, "wb"), SER_DISK, CLIENT_VERSION);
+    if (afile.IsNull()) {
+        strError = strprintf("unable to open %s for writing", temppath.string());
+        return false;
+    }
+    try {
+        CHashedWriter<CAutoFile> writer(&afile);
+        stats.baseBlockHash = pindexBase->GetBlockHash();
+        stats.nBaseHeight = pindexBase->nHeight;
+        writer << stats.baseBlockHash << stats.nBaseHeight;
+
+        // The entries of each section are preceded by a true, the sections end with a false
+        std::unique_ptr<CCoinsViewCursor> pcursor(pcoinsdbview->Cursor());
+        for (; pcursor->Valid(); pcursor->Next()) {
+            COutPoint outpoint;
+            Coin coin;
+            if (!pcursor->GetKey(outpoint) || !pcursor->GetValue(coin)) {
+                throw std::runtime_error("unable to read the coins database");
+            }
+            writer << true << outpoint << coin;
+            stats.nCoins++;
+        }
+        writer << false;
+
+        writer << pcoinsdbview->GetBestAnchor();
+        bool fSaplingRead = pcoinsdbview->ForEachSaplingAnchor([&](const uint256& root, const SaplingMerkleTree& tree) {
+            writer << true << root << tree;
+            stats.nSaplingAnchors++;
+            return true;
+        });
+        writer << false;
+        fSaplingRead &= pcoinsdbview->ForEachSaplingNullifier([&](const uint256& nullifier) {
+            writer << true << nullifier;
+            stats.nSaplingNullifiers++;
+            return true;
+        });
+        writer << false;
+        if (!fSaplingRead) {
+            throw std::runtime_error("unable to read the sapling data of the coins database");
+        }
+
+        stats.hash = writer.GetHash();
+        afile << stats.hash;
+        if (!FileCommit(afile.Get())) {
+            throw std::runtime_error("unable to commit the file");
+        }
+        afile.fclose();
+    } catch (const std::exception& e) {
+        afile.fclose();
+        fs::remove(temppath);
+        strError = strprintf("unable to write %s: %s", temppath.string(), e.what());
+        return false;
+    }
+    if (!RenameOver(temppath, path)) {
+        fs::remove(temppath);
+        strError = strprintf("unable to rename %s to %s", temppath.string(), path.string());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,32 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_UTXO_SNAPSHOT_H
+#define PIVX_UTXO_SNAPSHOT_H
+
+#include "fs.h"
+#include "uint256.h"
+
+#include <string>
+
+/**
+ * Statistics of a UTXO set export (dumptxoutset). The file starts with the hash and the height of the base block,
+ * followed by the coins and the sapling anchors and nullifiers of the chainstate at the base block, and ends with
+ * the hash of all the previous data.
+ */
+struct SnapshotStats
+{
+    uint256 baseBlockHash;
+    int nBaseHeight{0};
+    uint64_t nCoins{0};
+    uint64_t nSaplingAnchors{0};
+    uint64_t nSaplingNullifiers{0};
+    //! Commitment to the content of the file
+    uint256 hash;
+};
+
+/** Flushes the chainstate, and exports the UTXO set at the current tip to path. */
+bool DumpUTXOSnapshot(const fs::path& path, SnapshotStats& stats, std::string& strError);
+
+#endif // PIVX_UTXO_SNAPSHOT_H
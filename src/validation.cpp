@@ -10,6 +10,7 @@
 
 #include "validation.h"
 
+#include "addressindex.h"
 #include "addrman.h"
 #include "blocksignature.h"
 #include "budget/budgetmanager.h"
@@ -21,10 +22,13 @@
 #include "consensus/tx_verify.h"
 #include "consensus/validation.h"
 #include "consensus/zerocoin_verify.h"
+#include "ctpl_stl.h"
+#include "cuckoocache.h"
 #include "evo/evodb.h"
 #include "evo/specialtx_validation.h"
 #include "flatfile.h"
 #include "guiinterface.h"
+#include "index/txindex.h"
 #include "interfaces/handler.h"
 #include "invalid.h"
 #include "kernel.h"
@@ -32,11 +36,15 @@
 #include "llmq/quorums_chainlocks.h"
 #include "masternode-payments.h"
 #include "masternodeman.h"
+#include "metrics.h"
 #include "policy/policy.h"
 #include "pow.h"
+#include "random.h"
 #include "reverse_iterate.h"
+#include "sapling/sapling_batchverifier.h"
 #include "script/sigcache.h"
 #include "shutdown.h"
+#include "spentindex.h"
 #include "spork.h"
 #include "sporkdb.h"
 #include "tiertwo/tiertwo_sync_state.h"
@@ -54,7 +62,9 @@
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/thread.hpp>
+#include <boost/thread/shared_mutex.hpp>
 #include <atomic>
+#include <deque>
 #include <queue>
 
 
@@ -80,9 +90,21 @@
 RecursiveMutex cs_main;
 
 BlockMap mapBlockIndex;
+// Taken exclusively (with cs_main) to insert in mapBlockIndex, shared by LookupBlockIndexShared
+static boost::shared_mutex g_block_index_mutex;
 PrevBlockMap mapPrevBlockIndex;
+
+size_t GetBlockIndexMemoryUsage()
+{
+    AssertLockHeld(cs_main);
+    return memusage::DynamicUsage(mapBlockIndex) + memusage::MallocUsage(sizeof(CBlockIndex)) * mapBlockIndex.size() +
+           memusage::DynamicUsage(mapPrevBlockIndex);
+}
 CChain chainActive;
 CBlockIndex* pindexBestHeader = nullptr;
+std::atomic<int> nBestHeaderHeight{-1};
+// Accessed with the atomic functions of shared_ptr
+static std::shared_ptr<const ChainTipSnapshot> g_chain_tip_snapshot;
 
 // Best block section
 Mutex g_best_block_mutex;
@@ -94,8 +116,11 @@ int nScriptCheckThreads = 0;
 std::atomic<bool> fImporting{false};
 std::atomic<bool> fReindex{false};
 bool fTxIndex = true;
+bool fAddressIndex = false;
+bool fSpentIndex = false;
 bool fRequireStandard = true;
 bool fCheckBlockIndex = false;
+uint256 hashAssumeValid;
 size_t nCoinCacheUsage = 5000 * 300;
 
 /* If the tip is older than this (in seconds), the node is considered to be in initial block download. */
@@ -113,6 +138,24 @@ std::map<uint256, int64_t> mapRejectedBlocks;
 
 CMoneySupply MoneySupply;
 
+void LoadMoneySupply(bool fAudit)
+{
+    AssertLockHeld(cs_main);
+    const uint256& hashTip = pcoinsTip->GetBestBlock();
+    const int nHeight = chainActive.Height();
+    CAmount nSupply;
+    if (!fAudit && pcoinsdbview->ReadMoneySupply(hashTip, nSupply)) {
+        MoneySupply.Update(nSupply, nHeight, hashTip);
+        return;
+    }
+    nSupply = pcoinsTip->GetTotalAmount();
+    if (fAudit && MoneySupply.GetBlockHash() == hashTip && MoneySupply.Get() != nSupply) {
+        LogPrintf("%s: the tracked money supply %s differs from the sum of the UTXO set %s at %s\n", __func__,
+                  FormatMoney(MoneySupply.Get()), FormatMoney(nSupply), hashTip.ToString());
+    }
+    MoneySupply.Update(nSupply, nHeight, hashTip);
+}
+
 static void CheckBlockIndex();
 
 /** Constant stuff for coinbase transactions we create: */
@@ -191,6 +234,26 @@ CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& loc
     return chain.Genesis();
 }
 
+static void PublishChainTipSnapshot(const CBlockIndex* pindexTip)
+{
+    AssertLockHeld(cs_main);
+    std::shared_ptr<const ChainTipSnapshot> snapshot;
+    if (pindexTip) snapshot = std::make_shared<const ChainTipSnapshot>(*pindexTip);
+    std::atomic_store(&g_chain_tip_snapshot, snapshot);
+}
+
+std::shared_ptr<const ChainTipSnapshot> GetChainTipSnapshot()
+{
+    return std::atomic_load(&g_chain_tip_snapshot);
+}
+
+CBlockIndex* LookupBlockIndexShared(const uint256& hash)
+{
+    boost::shared_lock<boost::shared_mutex> lock(g_block_index_mutex);
+    BlockMap::const_iterator it = mapBlockIndex.find(hash);
+    return it == mapBlockIndex.end() ? nullptr : it->second;
+}
+
 CBlockIndex* GetChainTip()
 {
     LOCK(cs_main);
@@ -218,6 +281,7 @@ enum FlushStateMode {
 
 // See definition for documentation
 bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode);
+static bool FinishCoinsFlush(bool fWait) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 static FlatFileSeq BlockFileSeq();
 static FlatFileSeq UndoFileSeq();
 
@@ -313,6 +377,7 @@ static void UpdateMempoolForReorg(DisconnectedBlockTransactions &disconnectpool,
     AssertLockHeld(cs_main);
     AssertLockHeld(mempool.cs);
     std::vector<uint256> vHashUpdate;
+    CTxMemPool::BatchInsertion batch(mempool);
     // disconnectpool's insertion_order index sorts the entries from
     // oldest to newest, but the oldest entry will be the last tx from the
     // latest mined block that was disconnected.
@@ -365,9 +430,41 @@ static bool IsCurrentForFeeEstimation()
     return true;
 }
 
+// Used by ConnectBlock and AcceptToMemoryPool, which both hold cs_main
+static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+
+/**
+ * Verifies the input scripts of a mempool transaction on the script check threads. If a check fails,
+ * the caller must run CheckInputs() again serially, to get the reject reason.
+ */
+static bool CheckInputScriptsParallel(const CTransaction& tx, CValidationState& state, const CCoinsViewCache& view,
+                                      unsigned int flags, PrecomputedTransactionData& precomTxData) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    AssertLockHeld(cs_main);
+    std::vector<CScriptCheck> vChecks;
+    if (!CheckInputs(tx, state, view, true, flags, true, false, precomTxData, &vChecks)) {
+        return false;
+    }
+    CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+    control.Add(vChecks);
+    return control.Wait();
+}
+
+/** The script flags of the mempool acceptance on top of the block at chainHeight */
+static unsigned int GetMempoolScriptFlags(int chainHeight)
+{
+    const Consensus::Params& consensus = Params().GetConsensus();
+    unsigned int flags = STANDARD_SCRIPT_VERIFY_FLAGS;
+    if (consensus.NetworkUpgradeActive(chainHeight, Consensus::UPGRADE_BIP65))
+        flags |= SCRIPT_VERIFY_CHECKLOCKTIMEVERIFY;
+    if (consensus.NetworkUpgradeActive(chainHeight, Consensus::UPGRADE_V5_6))
+        flags |= SCRIPT_VERIFY_EXCHANGEADDR;
+    return flags;
+}
+
 static bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState &state, const CTransactionRef& _tx, bool fLimitFree,
                               bool* pfMissingInputs, int64_t nAcceptTime, bool fOverrideMempoolLimit, bool fRejectAbsurdFee, bool ignoreFees,
-                              std::vector<COutPoint>& coins_to_uncache) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+                              bool fAlreadyValidated, std::vector<COutPoint>& coins_to_uncache) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
     AssertLockHeld(cs_main);
     const CTransaction& tx = *_tx;
@@ -403,7 +500,10 @@ static bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState &state,
 
     int nextBlockHeight = chainHeight + 1;
     // Check transaction contextually against consensus rules at block height
-    if (!ContextualCheckTransaction(_tx, state, params, nextBlockHeight, false /* isMined */, IsInitialBlockDownload())) {
+    // (the Sapling proofs of an already validated transaction are deferred here, and dropped)
+    std::vector<SaplingValidation::CSaplingProofCheck> vSkippedSaplingChecks;
+    if (!ContextualCheckTransaction(_tx, state, params, nextBlockHeight, false /* isMined */, IsInitialBlockDownload(),
+                                    fAlreadyValidated ? &vSkippedSaplingChecks : nullptr)) {
         return error("AcceptToMemoryPool: ContextualCheckTransaction failed");
     }
 
@@ -441,11 +541,8 @@ static bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState &state,
     }
 
     // Check sapling nullifiers
-    if (tx.IsShieldedTx()) {
-        for (const auto& sd : tx.sapData->vShieldedSpend) {
-            if (pool.nullifierExists(sd.nullifier))
-                return state.Invalid(false, REJECT_INVALID, "bad-txns-nullifier-double-spent");
-        }
+    if (tx.IsShieldedTx() && pool.anyNullifierExists(tx.sapData->vShieldedSpend)) {
+        return state.Invalid(false, REJECT_INVALID, "bad-txns-nullifier-double-spent");
     }
 
     {
@@ -572,15 +669,17 @@ static bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState &state,
         bool exchangeAddrActivated = consensus.NetworkUpgradeActive(chainHeight, Consensus::UPGRADE_V5_6);
         // Check against previous transactions
         // This is done last to help prevent CPU exhaustion denial-of-service attacks.
-        int flags = STANDARD_SCRIPT_VERIFY_FLAGS;
-        if (fCLTVIsActivated)
-            flags |= SCRIPT_VERIFY_CHECKLOCKTIMEVERIFY;
-        if (exchangeAddrActivated)
-            flags |= SCRIPT_VERIFY_EXCHANGEADDR;
-
-
-        PrecomputedTransactionData precomTxData(tx);
-        if (!CheckInputs(tx, state, view, true, flags, true, precomTxData)) {
+        int flags = GetMempoolScriptFlags(chainHeight);
+
+        // Kept by the mempool entry, for the block connection
+        auto precomTxData = std::make_shared<PrecomputedTransactionData>(tx);
+        // The scripts of an already validated transaction are not executed again (the inputs are still checked)
+        const bool fScriptChecks = !fAlreadyValidated;
+        // The signatures of a transaction with many inputs are verified in parallel, with a serial
+        // pass only if one of them fails. They are cached, for the next checks and the block connection.
+        const bool fParallelChecks = fScriptChecks && nScriptCheckThreads && tx.vin.size() >= MIN_PARALLEL_SCRIPT_CHECK_INPUTS;
+        if ((!fParallelChecks || !CheckInputScriptsParallel(tx, state, view, flags, *precomTxData)) &&
+                !CheckInputs(tx, state, view, fScriptChecks, flags, true, false, *precomTxData)) {
             return false;
         }
 
@@ -593,12 +692,14 @@ static bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState &state,
         // There is a similar check in CreateNewBlock() to prevent creating
         // invalid blocks, however allowing such transactions into the mempool
         // can be exploited as a DoS attack.
-        flags = MANDATORY_SCRIPT_VERIFY_FLAGS;
+        // DERSIG is added (the standard flags include it) to check with the flags of the next block: the
+        // scripts are then in the script execution cache, and skipped when the tx is connected.
+        flags = MANDATORY_SCRIPT_VERIFY_FLAGS | SCRIPT_VERIFY_DERSIG;
         if (fCLTVIsActivated)
             flags |= SCRIPT_VERIFY_CHECKLOCKTIMEVERIFY;
         if (exchangeAddrActivated)
             flags |= SCRIPT_VERIFY_EXCHANGEADDR;
-        if (!CheckInputs(tx, state, view, true, flags, true, precomTxData)) {
+        if (!CheckInputs(tx, state, view, fScriptChecks, flags, true, true, *precomTxData)) {
             return error("%s: BUG! PLEASE REPORT THIS! ConnectInputs failed against MANDATORY but not STANDARD flags %s, %s",
                     __func__, hash.ToString(), FormatStateMessage(state));
         }
@@ -610,6 +711,7 @@ static bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState &state,
         bool validForFeeEstimation = IsCurrentForFeeEstimation() && pool.HasNoInputsOf(tx);
 
         // Store transaction in memory
+        entry.SetPrecomputedTxData(std::move(precomTxData));
         pool.addUnchecked(hash, entry, setAncestors, validForFeeEstimation);
 
         // trim mempool and check if tx was trimmed
@@ -630,12 +732,14 @@ static bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState &state,
 }
 
 bool AcceptToMemoryPoolWithTime(CTxMemPool& pool, CValidationState &state, const CTransactionRef& tx, bool fLimitFree,
-                        bool* pfMissingInputs, int64_t nAcceptTime, bool fOverrideMempoolLimit, bool fRejectAbsurdFee, bool fIgnoreFees)
+                        bool* pfMissingInputs, int64_t nAcceptTime, bool fOverrideMempoolLimit, bool fRejectAbsurdFee, bool fIgnoreFees,
+                        bool fAlreadyValidated)
 {
     AssertLockHeld(cs_main);
 
     std::vector<COutPoint> coins_to_uncache;
-    bool res = AcceptToMemoryPoolWorker(pool, state, tx, fLimitFree, pfMissingInputs, nAcceptTime, fOverrideMempoolLimit, fRejectAbsurdFee, fIgnoreFees, coins_to_uncache);
+    bool res = AcceptToMemoryPoolWorker(pool, state, tx, fLimitFree, pfMissingInputs, nAcceptTime, fOverrideMempoolLimit, fRejectAbsurdFee, fIgnoreFees, fAlreadyValidated, coins_to_uncache);
+    (res ? metrics::mempoolAccepted : metrics::mempoolRejected).Inc();
     if (!res) {
         for (const COutPoint& outpoint: coins_to_uncache)
             pcoinsTip->Uncache(outpoint);
@@ -682,28 +786,28 @@ bool GetTransaction(const uint256& hash, CTransactionRef& txOut, uint256& hashBl
             return true;
         }
 
-        if (fTxIndex) {
-            CDiskTxPos postx;
-            if (pblocktree->ReadTxIndex(hash, postx)) {
-                CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
-                if (file.IsNull())
-                    return error("%s: OpenBlockFile failed", __func__);
-                CBlockHeader header;
-                try {
-                    file >> header;
-                    fseek(file.Get(), postx.nTxOffset, SEEK_CUR);
-                    file >> txOut;
-                } catch (const std::exception& e) {
-                    return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+        if (g_txindex) {
+            // The best block is read first: the blocks above it may have been written meanwhile, but not skipped
+            const CBlockIndex* pindexIndexed = g_txindex->GetBestBlockIndex();
+            if (g_txindex->FindTx(hash, hashBlock, txOut)) return true;
+            if (g_txindex->IsSynced()) {
+                // The index follows the chain through the validation interface queue, which the consensus callers
+                // can't wait for (they hold cs_main): the (few) blocks connected since its best block are scanned
+                const CBlockIndex* pindexFork = pindexIndexed ? chainActive.FindFork(pindexIndexed) : nullptr;
+                for (const CBlockIndex* pindex = chainActive.Tip(); pindex && pindex != pindexFork; pindex = pindex->pprev) {
+                    CBlock block;
+                    if (!ReadBlockFromDisk(block, pindex)) continue;
+                    for (const auto& tx : block.vtx) {
+                        if (tx->GetHash() == hash) {
+                            txOut = tx;
+                            hashBlock = pindex->GetBlockHash();
+                            return true;
+                        }
+                    }
                 }
-                hashBlock = header.GetHash();
-                if (txOut->GetHash() != hash)
-                    return error("%s : txid mismatch", __func__);
-                return true;
+                // transaction not found in the index, nothing more can be done once it is in sync
+                return false;
             }
-
-            // transaction not found in the index, nothing more can be done
-            return false;
         }
 
         if (fAllowSlow) { // use coin database to locate block that contains transaction, and scan it
@@ -755,20 +859,67 @@ bool WriteBlockToDisk(const CBlock& block, FlatFilePos& pos)
     return true;
 }
 
+//! Memory mappings of the block files before nLastBlockFile (-blocksmmap), if enabled
+static std::unique_ptr<FlatFileMapCache> blockFileMappings;
+
+void InitBlockFileMappings(int nMaxFiles)
+{
+    if (nMaxFiles > 0) {
+        blockFileMappings.reset(new FlatFileMapCache(BlockFileSeq(), std::min(nMaxFiles, MAX_BLOCKS_MMAP)));
+    } else {
+        blockFileMappings.reset();
+    }
+}
+
+/**
+ * Points to the serialized block at pos in its mapped block file, checking the index header written by
+ * WriteBlockToDisk. Returns false (the block is then read from the file) if the file isn't mapped.
+ */
+static bool ReadMappedBlock(const FlatFilePos& pos, std::shared_ptr<const MappedFlatFile>& file, const unsigned char*& data, unsigned int& nSize)
+{
+    // The last block file is still written (and truncated when it's finalized)
+    if (!blockFileMappings || pos.IsNull() || pos.nFile >= WITH_LOCK(cs_LastBlockFile, return nLastBlockFile; )) {
+        return false;
+    }
+    static const unsigned int nHeaderSize = CMessageHeader::MESSAGE_START_SIZE + sizeof(unsigned int);
+    if (pos.nPos < nHeaderSize || !(file = blockFileMappings->Get(pos.nFile))) {
+        return false;
+    }
+    const unsigned char* header = file->Read(pos.nPos - nHeaderSize, nHeaderSize);
+    if (!header || memcmp(header, Params().MessageStart(), CMessageHeader::MESSAGE_START_SIZE) != 0) {
+        return false;
+    }
+    nSize = ReadLE32(header + CMessageHeader::MESSAGE_START_SIZE);
+    data = nSize <= MAX_SIZE ? file->Read(pos.nPos, nSize) : nullptr;
+    return data != nullptr;
+}
+
 bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos)
 {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("ReadBlockFromDisk : OpenBlockFile failed");
+    std::shared_ptr<const MappedFlatFile> mapped;
+    const unsigned char* data;
+    unsigned int nSize;
+    if (ReadMappedBlock(pos, mapped, data, nSize)) {
+        try {
+            CDataStream ss((const char*)data, (const char*)data + nSize, SER_DISK, CLIENT_VERSION);
+            ss >> block;
+        } catch (const std::exception& e) {
+            return error("%s : Deserialize error - %s", __func__, e.what());
+        }
+    } else {
+        // Open history file to read
+        CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+            return error("ReadBlockFromDisk : OpenBlockFile failed");
 
-    // Read block
-    try {
-        filein >> block;
-    } catch (const std::exception& e) {
-        return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+        // Read block
+        try {
+            filein >> block;
+        } catch (const std::exception& e) {
+            return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+        }
     }
 
     // Check the header
@@ -793,6 +944,51 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex)
     return true;
 }
 
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& block, const FlatFilePos& pos)
+{
+    std::shared_ptr<const MappedFlatFile> mapped;
+    const unsigned char* data;
+    unsigned int nSize;
+    if (ReadMappedBlock(pos, mapped, data, nSize)) {
+        block.assign(data, data + nSize);
+        return true;
+    }
+
+    // Seek back to the index header (message start and size) written by WriteBlockToDisk
+    FlatFilePos hpos = pos;
+    if (hpos.nPos < CMessageHeader::MESSAGE_START_SIZE + sizeof(unsigned int))
+        return error("%s : invalid block position %s", __func__, pos.ToString());
+    hpos.nPos -= CMessageHeader::MESSAGE_START_SIZE + sizeof(unsigned int);
+
+    CAutoFile filein(OpenBlockFile(hpos, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("%s : OpenBlockFile failed for %s", __func__, pos.ToString());
+
+    try {
+        CMessageHeader::MessageStartChars blk_start;
+        unsigned int blk_size;
+        filein >> blk_start >> blk_size;
+        if (memcmp(blk_start, Params().MessageStart(), CMessageHeader::MESSAGE_START_SIZE) != 0)
+            return error("%s : block magic mismatch for %s: %s versus expected %s", __func__, pos.ToString(),
+                         HexStr(blk_start), HexStr(Params().MessageStart()));
+        if (blk_size > MAX_SIZE)
+            return error("%s : block data is larger than maximum deserialization size for %s: %s versus %s", __func__, pos.ToString(),
+                         blk_size, MAX_SIZE);
+        block.resize(blk_size);
+        filein.read((char*)block.data(), blk_size);
+    } catch (const std::exception& e) {
+        return error("%s : Read from block file failed: %s for %s", __func__, e.what(), pos.ToString());
+    }
+
+    return true;
+}
+
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& block, const CBlockIndex* pindex)
+{
+    FlatFilePos blockPos = WITH_LOCK(cs_main, return pindex->GetBlockPos(); );
+    return ReadRawBlockFromDisk(block, blockPos);
+}
+
 
 double ConvertBitsToDouble(unsigned int nBits)
 {
@@ -1099,7 +1295,20 @@ bool CheckTxInputs(const CTransaction& tx, CValidationState& state, const CCoins
 }
 }// namespace Consensus
 
-bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &inputs, bool fScriptChecks, unsigned int flags, bool cacheStore, PrecomputedTransactionData& precomTxData, std::vector<CScriptCheck> *pvChecks)
+static CuckooCache::cache<uint256, SignatureCacheHasher> scriptExecutionCache;
+static uint256 scriptExecutionCacheNonce(GetRandHash());
+
+void InitScriptExecutionCache()
+{
+    // nMaxCacheSize is unsigned. If -maxsigcachesize is set to zero,
+    // setup_bytes creates the minimum possible cache (2 elements).
+    size_t nMaxCacheSize = std::min(std::max((int64_t)0, gArgs.GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE) / 2), MAX_MAX_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
+    size_t nElems = scriptExecutionCache.setup_bytes(nMaxCacheSize);
+    LogPrintf("Using %zu MiB out of %zu requested for script execution cache, able to store %zu elements\n",
+            (nElems*sizeof(uint256)) >>20, nMaxCacheSize>>20, nElems);
+}
+
+bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &inputs, bool fScriptChecks, unsigned int flags, bool cacheSigStore, bool cacheFullScriptStore, PrecomputedTransactionData& precomTxData, std::vector<CScriptCheck> *pvChecks)
 {
     if (!tx.IsCoinBase() && !tx.HasZerocoinSpendInputs()) {
 
@@ -1117,6 +1326,17 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
         // before the last block chain checkpoint. This is safe because block merkle hashes are
         // still computed and checked, and any change will be caught at the next checkpoint.
         if (fScriptChecks) {
+            // First check if the scripts were already executed with the same flags: they only depend on the tx
+            // (the coins it spends are committed to by its prevouts). Entries are SHA256(nonce || txid || flags).
+            uint256 hashCacheEntry;
+            CSHA256().Write(scriptExecutionCacheNonce.begin(), 32).Write(tx.GetHash().begin(), 32).Write((const unsigned char*)&flags, sizeof(flags)).Finalize(hashCacheEntry.begin());
+            AssertLockHeld(cs_main); // The CuckooCache needs external locking
+            if (scriptExecutionCache.contains(hashCacheEntry, !cacheFullScriptStore)) {
+                metrics::scriptCacheHits.Inc();
+                return true;
+            }
+            metrics::scriptCacheMisses.Inc();
+
             for (unsigned int i = 0; i < tx.vin.size(); i++) {
                 const COutPoint& prevout = tx.vin[i].prevout;
                 const Coin& coin = inputs.AccessCoin(prevout);
@@ -1129,7 +1349,7 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
                 // spent being checked as a part of CScriptCheck.
 
                 // Verify signature
-                CScriptCheck check(coin.out, tx, i, flags, cacheStore, &precomTxData);
+                CScriptCheck check(coin.out, tx, i, flags, cacheSigStore, &precomTxData);
                 if (pvChecks) {
                     pvChecks->emplace_back();
                     check.swap(pvChecks->back());
@@ -1142,7 +1362,7 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
                         // avoid splitting the network between upgraded and
                         // non-upgraded nodes.
                         CScriptCheck check2(coin.out, tx, i,
-                            flags & ~STANDARD_NOT_MANDATORY_VERIFY_FLAGS, cacheStore, &precomTxData);
+                            flags & ~STANDARD_NOT_MANDATORY_VERIFY_FLAGS, cacheSigStore, &precomTxData);
                         if (check2())
                             return state.Invalid(false, REJECT_NONSTANDARD, strprintf("non-mandatory-script-verify-flag (%s)", ScriptErrorString(check.GetScriptError())));
                     }
@@ -1156,6 +1376,11 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
                     return state.DoS(100, false, REJECT_INVALID, strprintf("mandatory-script-verify-flag-failed (%s)", ScriptErrorString(check.GetScriptError())));
                 }
             }
+
+            if (cacheFullScriptStore && !pvChecks) {
+                // All the scripts passed (they were checked inline): any later check with the same flags is skipped
+                scriptExecutionCache.insert(hashCacheEntry);
+            }
         }
     }
 
@@ -1209,7 +1434,8 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, FlatFilePos& pos, const uint25
     return true;
 }
 
-bool UndoReadFromDisk(CBlockUndo& blockundo, const FlatFilePos& pos, const uint256& hashBlock)
+/** Reads the undo data field by field from the file, hashing the bytes read */
+bool UndoReadFromFileVerified(CBlockUndo& blockundo, const FlatFilePos& pos, const uint256& hashBlock)
 {
     // Open history file to read
     CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
@@ -1234,8 +1460,58 @@ bool UndoReadFromDisk(CBlockUndo& blockundo, const FlatFilePos& pos, const uint2
     return true;
 }
 
+bool UndoReadFromDisk(CBlockUndo& blockundo, const FlatFilePos& pos, const uint256& hashBlock)
+{
+    // Read the undo data with its size from the index header and its checksum in a single read,
+    // instead of issuing a read of the file for each field of each coin
+    if (pos.nPos < sizeof(unsigned int))
+        return error("%s : invalid undo position %s", __func__, pos.ToString());
+    CAutoFile filein(OpenUndoFile(FlatFilePos(pos.nFile, pos.nPos - sizeof(unsigned int)), true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("%s : OpenBlockFile failed", __func__);
+
+    CDataStream ssUndo(SER_DISK, CLIENT_VERSION);
+    uint256 hashChecksum;
+    try {
+        unsigned int nSize;
+        filein >> nSize;
+        if (nSize > MAX_SIZE)
+            throw std::ios_base::failure("undo data too large");
+        ssUndo.resize(nSize);
+        filein.read(ssUndo.data(), nSize);
+        filein >> hashChecksum;
+    } catch (const std::exception& e) {
+        return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+    }
+
+    CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
+    hasher << hashBlock;
+    hasher.write(ssUndo.data(), ssUndo.size());
+    if (hashChecksum == hasher.GetHash()) {
+        try {
+            ssUndo >> blockundo;
+            if (ssUndo.empty())
+                return true;
+        } catch (const std::exception&) {}
+    }
+
+    // The size in the header doesn't match the undo data: read it field by field
+    LogPrint(BCLog::VALIDATION, "%s : undo data size mismatch at %s, reading it from the file\n", __func__, pos.ToString());
+    blockundo = CBlockUndo();
+    return UndoReadFromFileVerified(blockundo, pos, hashBlock);
+}
+
 } // anon namespace
 
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
+{
+    FlatFilePos pos = WITH_LOCK(cs_main, return pindex->GetUndoPos(); );
+    if (pos.IsNull() || !pindex->pprev) {
+        return error("%s : no undo data available for block %s", __func__, pindex->GetBlockHash().ToString());
+    }
+    return UndoReadFromDisk(blockundo, pos, pindex->pprev->GetBlockHash());
+}
+
 enum DisconnectResult
 {
     DISCONNECT_OK,      // All good.
@@ -1279,9 +1555,68 @@ int ApplyTxInUndo(Coin&& undo, CCoinsViewCache& view, const COutPoint& out)
 }
 
 
+//! Number of the last connected blocks whose spent coins are kept, see GetRecentlySpentCoin
+static const int SPENT_COINS_CACHE_BLOCKS = DEFAULT_MAX_REORG_DEPTH + 1;
+//! The coins spent by the last connected blocks
+static std::unordered_map<COutPoint, Coin, SaltedOutpointHasher> mapRecentlySpentCoins GUARDED_BY(cs_main);
+//! The outpoints of mapRecentlySpentCoins by height of the block spending them, the lowest are evicted first
+static std::map<int, std::vector<COutPoint>> mapRecentlySpentByHeight GUARDED_BY(cs_main);
+
+static void CacheSpentCoins(const CBlock& block, const CBlockUndo& blockundo, int nHeight) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    std::vector<COutPoint>& vSpent = mapRecentlySpentByHeight[nHeight];
+    for (size_t i = 1; i < block.vtx.size() && i <= blockundo.vtxundo.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        const CTxUndo& txundo = blockundo.vtxundo[i - 1];
+        for (size_t j = 0; j < txundo.vprevout.size() && j < tx.vin.size(); j++) {
+            mapRecentlySpentCoins[tx.vin[j].prevout] = txundo.vprevout[j];
+            vSpent.emplace_back(tx.vin[j].prevout);
+        }
+    }
+    while (!mapRecentlySpentByHeight.empty() && mapRecentlySpentByHeight.begin()->first <= nHeight - SPENT_COINS_CACHE_BLOCKS) {
+        for (const COutPoint& out : mapRecentlySpentByHeight.begin()->second) {
+            mapRecentlySpentCoins.erase(out);
+        }
+        mapRecentlySpentByHeight.erase(mapRecentlySpentByHeight.begin());
+    }
+}
+
+static void UncacheSpentCoins(int nHeight) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    // The coins spent from this height are unspent again, and the ones created from it don't exist anymore
+    for (auto it = mapRecentlySpentByHeight.lower_bound(nHeight); it != mapRecentlySpentByHeight.end(); ) {
+        for (const COutPoint& out : it->second) {
+            mapRecentlySpentCoins.erase(out);
+        }
+        it = mapRecentlySpentByHeight.erase(it);
+    }
+    for (auto it = mapRecentlySpentCoins.begin(); it != mapRecentlySpentCoins.end(); ) {
+        if ((int)it->second.nHeight >= nHeight) {
+            it = mapRecentlySpentCoins.erase(it);
+        } else {
+            it++;
+        }
+    }
+}
+
+bool GetRecentlySpentCoin(const COutPoint& outpoint, Coin& coin)
+{
+    AssertLockHeld(cs_main);
+    auto it = mapRecentlySpentCoins.find(outpoint);
+    if (it == mapRecentlySpentCoins.end()) {
+        return false;
+    }
+    coin = it->second;
+    return true;
+}
+
 /** Undo the effects of this block (with given index) on the UTXO set represented by coins.
+ *  fUpdateIndexes is false when view is only a temporary cache (VerifyDB), whose changes are
+ *  never flushed, so that the optional indexes and the spent coins cache are left as they are.
+ *  pblockUndo is the undo data of the block when it was already read (its coins are moved out),
+ *  nullptr to read it here.
  *  When FAILED is returned, view is left in an indeterminate state. */
-DisconnectResult DisconnectBlock(CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view)
+DisconnectResult DisconnectBlock(CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view, bool fUpdateIndexes = true, CBlockUndo* pblockUndo = nullptr)
 {
     AssertLockHeld(cs_main);
 
@@ -1295,16 +1630,20 @@ DisconnectResult DisconnectBlock(CBlock& block, const CBlockIndex* pindex, CCoin
 
     bool fClean = true;
 
-    CBlockUndo blockUndo;
-    FlatFilePos pos = pindex->GetUndoPos();
-    if (pos.IsNull()) {
-        error("%s: no undo data available", __func__);
-        return DISCONNECT_FAILED;
-    }
-    if (!UndoReadFromDisk(blockUndo, pos, pindex->pprev->GetBlockHash())) {
-        error("%s: failure reading undo data", __func__);
-        return DISCONNECT_FAILED;
+    CBlockUndo blockUndoRead;
+    if (!pblockUndo) {
+        FlatFilePos pos = pindex->GetUndoPos();
+        if (pos.IsNull()) {
+            error("%s: no undo data available", __func__);
+            return DISCONNECT_FAILED;
+        }
+        if (!UndoReadFromDisk(blockUndoRead, pos, pindex->pprev->GetBlockHash())) {
+            error("%s: failure reading undo data", __func__);
+            return DISCONNECT_FAILED;
+        }
+        pblockUndo = &blockUndoRead;
     }
+    CBlockUndo& blockUndo = *pblockUndo;
 
     if (blockUndo.vtxundo.size() + 1 != block.vtx.size()) {
         error("%s: block and undo data inconsistent", __func__);
@@ -1315,6 +1654,10 @@ DisconnectResult DisconnectBlock(CBlock& block, const CBlockIndex* pindex, CCoin
         return DISCONNECT_FAILED;
     }
 
+    AddressIndexEntries vAddressIndex;
+    AddressUnspentEntries vAddressUnspent;
+    SpentIndexEntries vSpentIndex;
+
     // undo transactions in reverse order
     for (int i = block.vtx.size() - 1; i >= 0; i--) {
         const CTransaction& tx = *block.vtx[i];
@@ -1340,10 +1683,22 @@ DisconnectResult DisconnectBlock(CBlock& block, const CBlockIndex* pindex, CCoin
             }
         }
 
+        const bool fHasInputs = !tx.IsCoinBase() && !tx.HasZerocoinSpendInputs();
+        if (fAddressIndex && fUpdateIndexes) {
+            CollectAddressIndexEntries(tx, fHasInputs ? &blockUndo.vtxundo[i - 1] : nullptr, pindex->nHeight, i,
+                                       true, vAddressIndex, vAddressUnspent);
+        }
+
         // not coinbases or zerocoinspend because they dont have traditional inputs
-        if (tx.IsCoinBase() || tx.HasZerocoinSpendInputs())
+        if (!fHasInputs)
             continue;
 
+        if (fSpentIndex && fUpdateIndexes) {
+            for (const CTxIn& txin : tx.vin) {
+                vSpentIndex.emplace_back(txin.prevout, CSpentIndexValue());
+            }
+        }
+
         // Sapling, update unspent nullifiers
         view.SetNullifiers(tx, false);
 
@@ -1363,6 +1718,15 @@ DisconnectResult DisconnectBlock(CBlock& block, const CBlockIndex* pindex, CCoin
         // At this point, all of txundo.vprevout should have been moved out.
     }
 
+    if (fAddressIndex && fUpdateIndexes && !pblocktree->UpdateAddressIndex(vAddressIndex, vAddressUnspent, true)) {
+        AbortNode("Failed to update the address index");
+        return DISCONNECT_FAILED;
+    }
+    if (fSpentIndex && fUpdateIndexes && !pblocktree->UpdateSpentIndex(vSpentIndex)) {
+        AbortNode("Failed to update the spent index");
+        return DISCONNECT_FAILED;
+    }
+
     const Consensus::Params& consensus = Params().GetConsensus();
 
     // set the old best Sapling anchor back
@@ -1386,6 +1750,10 @@ DisconnectResult DisconnectBlock(CBlock& block, const CBlockIndex* pindex, CCoin
         CacheAccChecksum(pindex, false);
     }
 
+    if (fUpdateIndexes) {
+        UncacheSpentCoins(pindex->nHeight);
+    }
+
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
 }
 
@@ -1406,14 +1774,92 @@ void static FlushBlockFile(bool fFinalize = false)
 
 bool FindUndoPos(CValidationState& state, int nFile, FlatFilePos& pos, unsigned int nAddSize);
 
-static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
-
 void ThreadScriptCheck()
 {
     util::ThreadRename("pivx-scriptch");
     scriptcheckqueue.Thread();
 }
 
+static CCheckQueue<SaplingValidation::CSaplingBatchCheck> saplingcheckqueue(1);
+
+void ThreadSaplingCheck()
+{
+    util::ThreadRename("pivx-saplingch");
+    saplingcheckqueue.Thread();
+}
+
+static CCheckQueue<CPublicCoinSpendCheck> zerocoincheckqueue(4);
+
+void ThreadZerocoinCheck()
+{
+    util::ThreadRename("pivx-zerocoinch");
+    zerocoincheckqueue.Thread();
+}
+
+/**
+ * Whether the scripts and proofs of the block at pindex can be assumed valid: it is an ancestor of the
+ * -assumevalid block, which is in the best headers chain, and is buried under at least two weeks of it.
+ * The UTXO accounting and the other consensus rules are always checked.
+ */
+static bool IsAssumedValid(const CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    AssertLockHeld(cs_main);
+    if (hashAssumeValid.IsNull() || pindexBestHeader == nullptr) {
+        return false;
+    }
+    BlockMap::const_iterator it = mapBlockIndex.find(hashAssumeValid);
+    if (it == mapBlockIndex.end()) {
+        // Not seen the assumed valid block (yet), check everything
+        return false;
+    }
+    return it->second->GetAncestor(pindex->nHeight) == pindex &&
+           pindexBestHeader->GetAncestor(pindex->nHeight) == pindex &&
+           pindexBestHeader->GetBlockTime() - pindex->GetBlockTime() > 60 * 60 * 24 * 7 * 2;
+}
+
+const std::vector<int64_t> BLOCK_STAGE_BUCKET_BOUNDS = {100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000,
+                                                          100000, 250000, 500000, 1000000, 2500000, 5000000};
+
+static const char* const BLOCK_STAGE_NAMES[] = {
+    "load_block", "connect_txs", "verify_scripts", "special_txs", "llmq", "deterministic_mns", "index_writing",
+    "connect_block", "flush_view", "write_chainstate", "postprocess", "connect_tip", "shielded_proofs"};
+static_assert(sizeof(BLOCK_STAGE_NAMES) / sizeof(BLOCK_STAGE_NAMES[0]) == (size_t)BlockStage::COUNT, "missing block stage name");
+
+static Mutex cs_block_stage_times;
+static std::vector<BlockStageTimes> vBlockStageTimes GUARDED_BY(cs_block_stage_times)((size_t)BlockStage::COUNT);
+
+BlockStageTimes::BlockStageTimes() :
+    buckets(BLOCK_STAGE_BUCKET_BOUNDS.size() + 1, 0)
+{
+}
+
+void BlockStageTimes::Add(int64_t nTime)
+{
+    nTime = std::max<int64_t>(nTime, 0);
+    // first bucket with upper bound >= nTime
+    size_t i = std::lower_bound(BLOCK_STAGE_BUCKET_BOUNDS.begin(), BLOCK_STAGE_BUCKET_BOUNDS.end(), nTime) - BLOCK_STAGE_BUCKET_BOUNDS.begin();
+    buckets[i]++;
+    nCount++;
+    nTotal += nTime;
+    nMax = std::max(nMax, nTime);
+}
+
+void AddBlockStageTime(BlockStage stage, int64_t nTime)
+{
+    LOCK(cs_block_stage_times);
+    vBlockStageTimes[(size_t)stage].Add(nTime);
+}
+
+std::vector<std::pair<std::string, BlockStageTimes>> GetBlockProcessingStats()
+{
+    LOCK(cs_block_stage_times);
+    std::vector<std::pair<std::string, BlockStageTimes>> ret;
+    for (size_t i = 0; i < vBlockStageTimes.size(); i++) {
+        ret.emplace_back(BLOCK_STAGE_NAMES[i], vBlockStageTimes[i]);
+    }
+    return ret;
+}
+
 static int64_t nTimeVerify = 0;
 static int64_t nTimeProcessSpecial = 0;
 static int64_t nTimeConnect = 0;
@@ -1497,7 +1943,7 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         }
     }
 
-    bool fScriptChecks = pindex->nHeight >= Checkpoints::GetTotalBlocksEstimate();
+    bool fScriptChecks = pindex->nHeight >= Checkpoints::GetTotalBlocksEstimate() && !IsAssumedValid(pindex);
 
     // If scripts won't be checked anyways, don't bother seeing if CLTV is activated
     bool fCLTVIsActivated = false;
@@ -1513,10 +1959,10 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     CAmount nFees = 0;
     int nInputs = 0;
     unsigned int nSigOps = 0;
-    CDiskTxPos pos(pindex->GetBlockPos(), GetSizeOfCompactSize(block.vtx.size()));
-    std::vector<std::pair<uint256, CDiskTxPos> > vPos;
     std::vector<std::pair<CBigNum, uint256> > vSpends;
-    vPos.reserve(block.vtx.size());
+    AddressIndexEntries vAddressIndex;
+    AddressUnspentEntries vAddressUnspent;
+    SpentIndexEntries vSpentIndex;
     CBlockUndo blockundo;
     blockundo.vtxundo.reserve(block.vtx.size() - 1);
     CAmount nValueOut = 0;
@@ -1526,9 +1972,23 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     // Sapling
     SaplingMerkleTree sapling_tree;
     assert(view.GetSaplingAnchorAt(view.GetBestAnchor(), sapling_tree));
+    // The note commitments of the block, appended to the tree at once
+    std::vector<libzcash::PedersenHash> vCommitments;
+    {
+        // Bring the nullifiers of all the shielded spends of the block into the cache at once
+        std::vector<uint256> vNullifiers;
+        for (const auto& tx : block.vtx) {
+            if (!tx->IsShieldedTx()) continue;
+            for (const SpendDescription& spendDescription : tx->sapData->vShieldedSpend) {
+                vNullifiers.emplace_back(spendDescription.nullifier);
+            }
+        }
+        std::vector<bool> vSpent;
+        if (!vNullifiers.empty()) view.GetNullifiers(vNullifiers, vSpent);
+    }
 
-    std::vector<PrecomputedTransactionData> precomTxData;
-    precomTxData.reserve(block.vtx.size()); // Required so that pointers to individual precomTxData don't get invalidated
+    std::vector<std::shared_ptr<PrecomputedTransactionData>> precomTxData;
+    precomTxData.reserve(block.vtx.size());
     bool fInitialBlockDownload = IsInitialBlockDownload();
     bool fSaplingMaintenance =  (block.nTime > sporkManager.GetSporkValue(SPORK_20_SAPLING_MAINTENANCE));
     for (unsigned int i = 0; i < block.vtx.size(); i++) {
@@ -1568,8 +2028,9 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
 
         }
 
-        // Cache the sig ser hashes
-        precomTxData.emplace_back(tx);
+        // Cache the sig ser hashes, reusing the ones (and the signature hashes) computed by the mempool acceptance
+        std::shared_ptr<PrecomputedTransactionData> txData = tx.IsCoinBase() ? nullptr : mempool.getPrecomputedTxData(tx.GetHash());
+        precomTxData.emplace_back(txData ? std::move(txData) : std::make_shared<PrecomputedTransactionData>(tx));
 
         CAmount txValueOut = tx.GetValueOut();
         if (!tx.IsCoinBase()) {
@@ -1586,7 +2047,7 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
                 flags |= SCRIPT_VERIFY_EXCHANGEADDR;
 
             bool fCacheResults = fJustCheck; /* Don't cache results if we're actually connecting blocks (still consult the cache, though) */
-            if (!CheckInputs(tx, state, view, fScriptChecks, flags, fCacheResults, precomTxData[i], nScriptCheckThreads ? &vChecks : nullptr))
+            if (!CheckInputs(tx, state, view, fScriptChecks, flags, fCacheResults, fCacheResults, *precomTxData[i], nScriptCheckThreads ? &vChecks : nullptr))
                 return error("%s: Check inputs on %s failed with %s", __func__, tx.GetHash().ToString(), FormatStateMessage(state));
             control.Add(vChecks);
         }
@@ -1598,17 +2059,28 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         }
         const bool fSkipInvalid = SkipInvalidUTXOS(pindex->nHeight);
         UpdateCoins(tx, view, i == 0 ? undoDummy : blockundo.vtxundo.back(), pindex->nHeight, fSkipInvalid);
+        if (fAddressIndex && !fJustCheck) {
+            CollectAddressIndexEntries(tx, i == 0 ? nullptr : &blockundo.vtxundo.back(), pindex->nHeight, i,
+                                       false, vAddressIndex, vAddressUnspent);
+        }
+        if (fSpentIndex && !fJustCheck && i > 0) {
+            const CTxUndo& txundo = blockundo.vtxundo.back();
+            for (unsigned int j = 0; j < txundo.vprevout.size() && j < tx.vin.size(); j++) {
+                const Coin& coin = txundo.vprevout[j];
+                vSpentIndex.emplace_back(tx.vin[j].prevout, CSpentIndexValue(tx.GetHash(), j, pindex->nHeight,
+                                                                             coin.out.nValue, coin.out.scriptPubKey));
+            }
+        }
 
         // Sapling update tree
         if (tx.IsShieldedTx() && !tx.sapData->vShieldedOutput.empty()) {
             for(const OutputDescription &outputDescription : tx.sapData->vShieldedOutput) {
-                sapling_tree.append(outputDescription.cmu);
+                vCommitments.emplace_back(outputDescription.cmu);
             }
         }
 
-        vPos.emplace_back(tx.GetHash(), pos);
-        pos.nTxOffset += ::GetSerializeSize(tx, CLIENT_VERSION);
     }
+    sapling_tree.append(vCommitments);
 
     // Push new tree anchor
     view.PushAnchor(sapling_tree);
@@ -1630,6 +2102,7 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
 
     int64_t nTime1 = GetTimeMicros();
     nTimeConnect += nTime1 - nTimeStart;
+    if (!fJustCheck) AddBlockStageTime(BlockStage::CONNECT_TXS, nTime1 - nTimeStart);
     LogPrint(BCLog::BENCHMARK, "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs]\n", (unsigned)block.vtx.size(), 0.001 * (nTime1 - nTimeStart), 0.001 * (nTime1 - nTimeStart) / block.vtx.size(), nInputs <= 1 ? 0 : 0.001 * (nTime1 - nTimeStart) / (nInputs - 1), nTimeConnect * 0.000001);
 
     //PoW phase redistributed fees to miner. PoS stage destroys fees.
@@ -1664,6 +2137,7 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         return state.DoS(100, error("%s: CheckQueue failed", __func__), REJECT_INVALID, "block-validation-failed");
     int64_t nTime2 = GetTimeMicros();
     nTimeVerify += nTime2 - nTimeStart;
+    if (!fJustCheck) AddBlockStageTime(BlockStage::VERIFY_SCRIPTS, nTime2 - nTime1);
     LogPrint(BCLog::BENCHMARK, "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs]\n", nInputs - 1, 0.001 * (nTime2 - nTimeStart), nInputs <= 1 ? 0 : 0.001 * (nTime2 - nTimeStart) / (nInputs - 1), nTimeVerify * 0.000001);
 
     if (!ProcessSpecialTxsInBlock(block, pindex, &view, state, fJustCheck)) {
@@ -1671,6 +2145,7 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     }
     int64_t nTime3 = GetTimeMicros();
     nTimeProcessSpecial += nTime3 - nTime2;
+    if (!fJustCheck) AddBlockStageTime(BlockStage::SPECIAL_TXS, nTime3 - nTime2);
     LogPrint(BCLog::BENCHMARK, "    - Process special tx: %.2fms [%.2fs]\n", 0.001 * (nTime3 - nTime2), nTimeProcessSpecial * 0.000001);
 
     //IMPORTANT NOTE: Nothing before this point should actually store to disk (or even memory)
@@ -1699,9 +2174,14 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     if (!vSpends.empty() && !zerocoinDB->WriteCoinSpendBatch(vSpends))
         return AbortNode(state, "Failed to record coin serials to database");
 
-    if (fTxIndex)
-        if (!pblocktree->WriteTxIndex(vPos))
-            return AbortNode(state, "Failed to write transaction index");
+    if (fAddressIndex && !pblocktree->UpdateAddressIndex(vAddressIndex, vAddressUnspent, false))
+        return AbortNode(state, "Failed to write address index");
+
+    if (fSpentIndex && !pblocktree->UpdateSpentIndex(vSpentIndex))
+        return AbortNode(state, "Failed to write spent index");
+
+    // Keep the coins spent by this block, for the stake inputs of the forks (see GetRecentlySpentCoin)
+    CacheSpentCoins(block, blockundo, pindex->nHeight);
 
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
@@ -1709,6 +2189,7 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
 
     int64_t nTime4 = GetTimeMicros();
     nTimeIndex += nTime4 - nTime3;
+    AddBlockStageTime(BlockStage::INDEX_WRITING, nTime4 - nTime3);
     LogPrint(BCLog::BENCHMARK, "    - Index writing: %.2fms [%.2fs]\n", 0.001 * (nTime4 - nTime3), nTimeIndex * 0.000001);
 
     if (consensus.NetworkUpgradeActive(pindex->nHeight, Consensus::UPGRADE_ZC_V2) &&
@@ -1734,11 +2215,94 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     return true;
 }
 
+/**
+ * Chainstate flush in progress on the background thread: the content of pcoinsTip was moved to a read-only
+ * snapshot, which pcoinsTip reads through until it's written to pcoinsdbview.
+ */
+static std::unique_ptr<CCoinsViewSnapshot> pcoinsFlushing GUARDED_BY(cs_main);
+static int nCoinsFlushingHeight GUARDED_BY(cs_main) = 0;
+static std::thread coinsFlushThread;
+static std::atomic<bool> fCoinsFlushDone{false};
+static std::atomic<bool> fCoinsFlushFailed{false};
+//! Incremented whenever the chainstate flushes start or end to change pcoinsdbview (see CachePrefetchedCoins)
+static uint64_t nCoinsDBWriteSeq GUARDED_BY(cs_main) = 0;
+
+/**
+ * Joins the background chainstate flush (if any), once it's done or, with fWait, waiting for it, and puts the
+ * database back under pcoinsTip (and drops the EvoDB data written with it). Returns false if the write failed.
+ */
+static bool FinishCoinsFlush(bool fWait)
+{
+    AssertLockHeld(cs_main);
+    if (!pcoinsFlushing || (!fWait && !fCoinsFlushDone)) {
+        return true;
+    }
+    coinsFlushThread.join();
+    pcoinsTip->SetBackend(*pcoinsFlushing->GetBackend());
+    pcoinsFlushing.reset();
+    evoDb->EndBackgroundCommit();
+    nCoinsDBWriteSeq++;
+    if (fCoinsFlushFailed) {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Hands the content of pcoinsTip over to the background thread, which writes it to pcoinsdbview.
+ * The database is first marked as being in the middle of the transition to the new best block, so that the
+ * write is replayed (ReplayBlocks) after a crash. The root transaction of the EvoDB is written by the same thread,
+ * before the coins: the replay also covers it, until the coins write clears the mark.
+ */
+static bool StartCoinsFlush()
+{
+    AssertLockHeld(cs_main);
+    assert(!pcoinsFlushing);
+    if (!pcoinsdbview->BeginBatchWrite(pcoinsTip->GetBestBlock())) {
+        return false;
+    }
+    pcoinsFlushing = pcoinsTip->TakeSnapshot();
+    evoDb->BeginBackgroundCommit();
+    nCoinsFlushingHeight = chainActive.Height();
+    nCoinsDBWriteSeq++;
+    fCoinsFlushDone = false;
+    fCoinsFlushFailed = false;
+    CCoinsViewDB* pdb = pcoinsdbview.get();
+    const CCoinsViewSnapshot* snapshot = pcoinsFlushing.get();
+    CEvoDB* pevodb = evoDb.get();
+    coinsFlushThread = std::thread(&TraceThread<std::function<void()>>, "coinsflush", std::function<void()>([pdb, snapshot, pevodb]() {
+        try {
+            if (!pevodb->WriteBackgroundCommit()) {
+                LogPrintf("%s: Failed to commit EvoDB\n", __func__);
+                fCoinsFlushFailed = true;
+                fCoinsFlushDone = true;
+                return;
+            }
+            // The sapling maps are consumed by the write
+            CAnchorsSaplingMap mapSaplingAnchors = snapshot->GetSaplingAnchors();
+            CNullifiersMap mapSaplingNullifiers = snapshot->GetSaplingNullifiers();
+            const int64_t nStart = GetTimeMicros();
+            if (!pdb->WriteCoins(snapshot->GetCoins(), snapshot->GetBestBlock(), snapshot->GetBestAnchor(),
+                                 mapSaplingAnchors, mapSaplingNullifiers)) {
+                fCoinsFlushFailed = true;
+            }
+            LogPrint(BCLog::COINDB, "Background chainstate flush done in %.2fms\n", (GetTimeMicros() - nStart) * 0.001);
+        } catch (const std::exception& e) {
+            LogPrintf("%s: %s\n", __func__, e.what());
+            fCoinsFlushFailed = true;
+        }
+        fCoinsFlushDone = true;
+    }));
+    return true;
+}
+
 /**
  * Update the on-disk chain state.
  * The caches and indexes are flushed if either they're too large, forceWrite is set, or
  * fast is not set and it's been a while since the last write.
- * Full flush also updates the money supply from disk (except during shutdown)
+ * Full flush also stores the money supply, with the best block of the chainstate
+ * The periodic full flushes of the chainstate are written in the background (-backgroundflush): the next calls
+ * join them, waiting for them only when a new full flush is needed.
  */
 bool static FlushStateToDisk(CValidationState& state, FlushStateMode mode)
 {
@@ -1759,12 +2323,16 @@ bool static FlushStateToDisk(CValidationState& state, FlushStateMode mode)
         if (nLastSetChain == 0) {
             nLastSetChain = nNow;
         }
+        if (!FinishCoinsFlush(mode == FLUSH_STATE_ALWAYS)) {
+            return AbortNode(state, "Failed to write to coin database");
+        }
+        const bool fCoinsFlushing = pcoinsFlushing != nullptr;
         int64_t nMempoolSizeMax = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
-        int64_t cacheSize = pcoinsTip->DynamicMemoryUsage();
+        int64_t cacheSize = pcoinsTip->DynamicMemoryUsage() + (fCoinsFlushing ? pcoinsFlushing->DynamicMemoryUsage() : 0);
         int64_t nTotalSpace = nCoinCacheUsage + std::max<int64_t>(nMempoolSizeMax - nMempoolUsage, 0);
         // The cache is large and we're within 10% and 10 MiB of the limit, but we have time now
         // (not in the middle of a block processing).
-        bool fCacheLarge = mode == FLUSH_STATE_PERIODIC &&
+        bool fCacheLarge = mode == FLUSH_STATE_PERIODIC && !fCoinsFlushing &&
                 cacheSize > std::max((9 * nTotalSpace) / 10, nTotalSpace - MAX_BLOCK_COINSDB_USAGE * 1024 * 1024);
         // The cache is over the limit, we have to write now.
         bool fCacheCritical = mode == FLUSH_STATE_IF_NEEDED && (unsigned) cacheSize > nCoinCacheUsage;
@@ -1774,7 +2342,7 @@ bool static FlushStateToDisk(CValidationState& state, FlushStateMode mode)
         // Do this frequently, so we don't need to redownload after a crash.
         bool fPeriodicWrite = mode == FLUSH_STATE_PERIODIC && nNow > nLastWrite + (int64_t)DATABASE_WRITE_INTERVAL * 1000000;
         // It's been very long since we flushed the cache. Do this infrequently, to optimize cache usage.
-        bool fPeriodicFlush = mode == FLUSH_STATE_PERIODIC && nNow > nLastFlush + (int64_t)DATABASE_FLUSH_INTERVAL * 1000000;
+        bool fPeriodicFlush = mode == FLUSH_STATE_PERIODIC && !fCoinsFlushing && nNow > nLastFlush + (int64_t)DATABASE_FLUSH_INTERVAL * 1000000;
         // Combine all conditions that result in a full cache flush.
         bool fDoFullFlush = (mode == FLUSH_STATE_ALWAYS) || fCacheLarge || fCacheCritical || fEvoDbCacheCritical || fPeriodicFlush;
         // Write blocks and block index to disk.
@@ -1819,17 +2387,26 @@ bool static FlushStateToDisk(CValidationState& state, FlushStateMode mode)
             if (!CheckDiskSpace(GetDataDir(), 48 * 2 * 2 * pcoinsTip->GetCacheSize())) {
                 return AbortNode(state, "Disk space is low!", _("Error: Disk space is low!"));
             }
-            // Flush the chainstate (which may refer to block index entries).
-            if (!pcoinsTip->Flush())
+            // A new flush can only start once the previous one is written.
+            if (!FinishCoinsFlush(true)) {
                 return AbortNode(state, "Failed to write to coin database");
-            if (!evoDb->CommitRootTransaction()) {
-                return AbortNode(state, "Failed to commit EvoDB");
             }
-            nLastFlush = nNow;
-            // Update money supply on memory, reading data from disk
-            if (!ShutdownRequested() && !IsInitialBlockDownload()) {
-                MoneySupply.Update(pcoinsTip->GetTotalAmount(), chainActive.Height());
+            // Flush the chainstate (which may refer to block index entries), and the supply at its best block.
+            pcoinsdbview->SetMoneySupply(MoneySupply.GetBlockHash(), MoneySupply.Get());
+            const bool fBackground = mode == FLUSH_STATE_PERIODIC && !ShutdownRequested() &&
+                                     gArgs.GetBoolArg("-backgroundflush", DEFAULT_BACKGROUND_FLUSH);
+            if (fBackground) {
+                if (!StartCoinsFlush())
+                    return AbortNode(state, "Failed to write to coin database");
+            } else {
+                nCoinsDBWriteSeq++;
+                if (!pcoinsTip->Flush())
+                    return AbortNode(state, "Failed to write to coin database");
+                if (!evoDb->CommitRootTransaction()) {
+                    return AbortNode(state, "Failed to commit EvoDB");
+                }
             }
+            nLastFlush = nNow;
         }
         if ((mode == FLUSH_STATE_ALWAYS || mode == FLUSH_STATE_PERIODIC) && nNow > nLastSetChain + (int64_t)DATABASE_WRITE_INTERVAL * 1000000) {
             // Update best block in wallet (so we can detect restored wallets).
@@ -1854,6 +2431,7 @@ void static UpdateTip(CBlockIndex* pindexNew)
 {
     AssertLockHeld(cs_main);
     chainActive.SetTip(pindexNew);
+    PublishChainTipSnapshot(pindexNew);
 
     // New best block
     mempool.AddTransactionsUpdated(1);
@@ -1897,15 +2475,57 @@ void static UpdateTip(CBlockIndex* pindexNew)
     }
 }
 
-/** Disconnect chainActive's tip.
-  * After calling, the mempool will be in an inconsistent state, with
-  * transactions from disconnected blocks being added to disconnectpool.  You
-  * should make the mempool consistent again by calling UpdateMempoolForReorg.
-  * with cs_main held.
-  *
-  * If disconnectpool is nullptr, then no disconnected transactions are added to
-  * disconnectpool (note that the caller is responsible for mempool consistency
-  * in any case).
+/** The steps of DisconnectTip following the disconnection of the tip pindexDelete from the chain state. */
+static void FinishDisconnectTip(CBlockIndex* pindexDelete, const std::shared_ptr<const CBlock>& pblock,
+                                const uint256& saplingAnchorBeforeDisconnect, const uint256& saplingAnchorAfterDisconnect,
+                                DisconnectedBlockTransactions* disconnectpool) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    const CBlock& block = *pblock;
+    if (disconnectpool) {
+        // Save transactions to re-add to mempool at end of reorg
+        for (auto it = block.vtx.rbegin(); it != block.vtx.rend(); ++it) {
+            disconnectpool->addTransaction(*it);
+        }
+        while (disconnectpool->DynamicMemoryUsage() > MAX_DISCONNECTED_TX_POOL_SIZE * 1000) {
+            // Drop the earliest entry, and remove its children from the mempool.
+            auto it = disconnectpool->queuedTx.get<insertion_order>().begin();
+            mempool.removeRecursive(**it, MemPoolRemovalReason::REORG);
+            disconnectpool->removeEntry(it);
+        }
+    }
+
+    // Evict from mempool if the anchor changes
+    if (saplingAnchorBeforeDisconnect != saplingAnchorAfterDisconnect) {
+        // The anchor may not change between block disconnects,
+        // in which case we don't want to evict from the mempool yet!
+        mempool.removeWithAnchor(saplingAnchorBeforeDisconnect);
+    }
+    // Update chainActive and related variables.
+    UpdateTip(pindexDelete->pprev);
+    // Let wallets know transactions went from 1-confirmed to
+    // 0-confirmed or conflicted:
+    GetMainSignals().BlockDisconnected(pblock, pindexDelete->GetBlockHash(), pindexDelete->nHeight, pindexDelete->GetBlockTime());
+
+    // Update MN manager cache
+    deterministicMNManager->SetTipIndex(pindexDelete->pprev);
+    // replace the cached hash of pindexDelete with the hash of the block
+    // at depth CACHED_BLOCK_HASHES if it exists, or empty hash otherwise.
+    if ((unsigned) pindexDelete->nHeight >= CACHED_BLOCK_HASHES) {
+        mnodeman.CacheBlockHash(chainActive[pindexDelete->nHeight - CACHED_BLOCK_HASHES]);
+    } else {
+        mnodeman.UncacheBlockHash(pindexDelete);
+    }
+}
+
+/** Disconnect chainActive's tip.
+  * After calling, the mempool will be in an inconsistent state, with
+  * transactions from disconnected blocks being added to disconnectpool.  You
+  * should make the mempool consistent again by calling UpdateMempoolForReorg.
+  * with cs_main held.
+  *
+  * If disconnectpool is nullptr, then no disconnected transactions are added to
+  * disconnectpool (note that the caller is responsible for mempool consistency
+  * in any case).
   */
 bool static DisconnectTip(CValidationState& state, const CChainParams& chainparams, DisconnectedBlockTransactions *disconnectpool)
 {
@@ -1931,50 +2551,138 @@ bool static DisconnectTip(CValidationState& state, const CChainParams& chainpara
         bool flushed = view.Flush();
         assert(flushed);
         dbTx->Commit();
+        MoneySupply.AddDelta(view.GetValueDelta(), pindexDelete->nHeight - 1, pindexDelete->pprev->GetBlockHash());
     }
     LogPrint(BCLog::BENCHMARK, "- Disconnect block: %.2fms\n", (GetTimeMicros() - nStart) * 0.001);
     const uint256& saplingAnchorAfterDisconnect = pcoinsTip->GetBestAnchor();
     // Write the chain state to disk, if necessary.
     if (!FlushStateToDisk(state, FLUSH_STATE_IF_NEEDED))
         return false;
-    if (disconnectpool) {
-        // Save transactions to re-add to mempool at end of reorg
-        for (auto it = block.vtx.rbegin(); it != block.vtx.rend(); ++it) {
-            disconnectpool->addTransaction(*it);
+    FinishDisconnectTip(pindexDelete, pblock, saplingAnchorBeforeDisconnect, saplingAnchorAfterDisconnect, disconnectpool);
+    return true;
+}
+
+/** Maximum number of blocks disconnected by a single DisconnectTips */
+static const int DISCONNECT_BATCH_SIZE = 32;
+/** Number of threads reading the blocks and undo data of the blocks to disconnect */
+static const int DISCONNECT_READ_THREADS = 4;
+
+/** A block to disconnect with its undo data, read ahead of the disconnection */
+struct CDisconnectRead
+{
+    std::shared_ptr<CBlock> pblock;
+    CBlockUndo blockUndo;
+};
+
+/** Disconnect the blocks of vpindexDelete (from the tip) in a batch, see DisconnectTips.
+  * When false is returned, the coins view and the evo db transaction were dropped, but the
+  * other side effects of DisconnectBlock (indexes, zerocoin db, budget objects) may have been
+  * applied for some of the blocks.
+  */
+static bool DisconnectTipsBatch(const std::vector<CBlockIndex*>& vpindexDelete, std::vector<CDisconnectRead>& vRead, std::vector<uint256>& vAnchors) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    // Read the blocks and their undo data. The positions are read here: the threads can't take cs_main
+    int64_t nStart = GetTimeMicros();
+    vRead.assign(vpindexDelete.size(), CDisconnectRead());
+    {
+        ctpl::thread_pool pool(std::min((int)vpindexDelete.size(), DISCONNECT_READ_THREADS));
+        std::vector<std::future<bool>> vFutures;
+        vFutures.reserve(vpindexDelete.size());
+        for (size_t i = 0; i < vpindexDelete.size(); i++) {
+            const CBlockIndex* pindex = vpindexDelete[i];
+            const FlatFilePos pos = pindex->GetBlockPos();
+            const FlatFilePos posUndo = pindex->GetUndoPos();
+            const uint256 hash = pindex->GetBlockHash();
+            const uint256 hashPrev = pindex->pprev->GetBlockHash();
+            CDisconnectRead& read = vRead[i];
+            vFutures.emplace_back(pool.push([&read, pos, posUndo, hash, hashPrev](int) {
+                read.pblock = std::make_shared<CBlock>();
+                if (!ReadBlockFromDisk(*read.pblock, pos) || read.pblock->GetHash() != hash) {
+                    return error("DisconnectTips() : Failed to read block %s", hash.ToString());
+                }
+                if (posUndo.IsNull() || !UndoReadFromDisk(read.blockUndo, posUndo, hashPrev)) {
+                    return error("DisconnectTips() : Failed to read the undo data of block %s", hash.ToString());
+                }
+                return true;
+            }));
         }
-        while (disconnectpool->DynamicMemoryUsage() > MAX_DISCONNECTED_TX_POOL_SIZE * 1000) {
-            // Drop the earliest entry, and remove its children from the mempool.
-            auto it = disconnectpool->queuedTx.get<insertion_order>().begin();
-            mempool.removeRecursive(**it, MemPoolRemovalReason::REORG);
-            disconnectpool->removeEntry(it);
+        bool fRead = true;
+        for (auto& f : vFutures) {
+            fRead &= f.get();
+        }
+        if (!fRead) {
+            return false;
         }
     }
+    LogPrint(BCLog::BENCHMARK, "- Read %d blocks to disconnect: %.2fms\n", vpindexDelete.size(), (GetTimeMicros() - nStart) * 0.001);
 
-    // Evict from mempool if the anchor changes
-    if (saplingAnchorBeforeDisconnect != saplingAnchorAfterDisconnect) {
-        // The anchor may not change between block disconnects,
-        // in which case we don't want to evict from the mempool yet!
-        mempool.removeWithAnchor(saplingAnchorBeforeDisconnect);
+    // Apply the blocks atomically to the chain state, keeping the anchor after each of them
+    vAnchors.clear();
+    vAnchors.reserve(vpindexDelete.size() + 1);
+    vAnchors.push_back(pcoinsTip->GetBestAnchor());
+    nStart = GetTimeMicros();
+    {
+        auto dbTx = evoDb->BeginTransaction();
+
+        CCoinsViewCache view(pcoinsTip.get());
+        for (size_t i = 0; i < vpindexDelete.size(); i++) {
+            const CBlockIndex* pindexDelete = vpindexDelete[i];
+            assert(view.GetBestBlock() == pindexDelete->GetBlockHash());
+            if (DisconnectBlock(*vRead[i].pblock, pindexDelete, view, true, &vRead[i].blockUndo) != DISCONNECT_OK)
+                return error("DisconnectTips() : DisconnectBlock %s failed", pindexDelete->GetBlockHash().ToString());
+            vAnchors.push_back(view.GetBestAnchor());
+        }
+        bool flushed = view.Flush();
+        assert(flushed);
+        dbTx->Commit();
+        const CBlockIndex* pindexNewTip = vpindexDelete.back()->pprev;
+        MoneySupply.AddDelta(view.GetValueDelta(), pindexNewTip->nHeight, pindexNewTip->GetBlockHash());
     }
-    // Update chainActive and related variables.
-    UpdateTip(pindexDelete->pprev);
-    // Let wallets know transactions went from 1-confirmed to
-    // 0-confirmed or conflicted:
-    GetMainSignals().BlockDisconnected(pblock, pindexDelete->GetBlockHash(), pindexDelete->nHeight, pindexDelete->GetBlockTime());
+    LogPrint(BCLog::BENCHMARK, "- Disconnect %d blocks: %.2fms\n", vpindexDelete.size(), (GetTimeMicros() - nStart) * 0.001);
+    return true;
+}
 
-    // Update MN manager cache
-    deterministicMNManager->SetTipIndex(pindexDelete->pprev);
-    // replace the cached hash of pindexDelete with the hash of the block
-    // at depth CACHED_BLOCK_HASHES if it exists, or empty hash otherwise.
-    if ((unsigned) pindexDelete->nHeight >= CACHED_BLOCK_HASHES) {
-        mnodeman.CacheBlockHash(chainActive[pindexDelete->nHeight - CACHED_BLOCK_HASHES]);
-    } else {
-        mnodeman.UncacheBlockHash(pindexDelete);
+/** Disconnect the blocks of chainActive following pindexFork (at most DISCONNECT_BATCH_SIZE),
+  * like as many DisconnectTip calls. The blocks and undo data are read in parallel first,
+  * then they are all undone in a single CCoinsViewCache and evo db transaction, flushed (and
+  * written to disk, if necessary) once.
+  * When one of them fails, the batch is dropped and the blocks are disconnected again one by
+  * one with DisconnectTip, which re-applies the other (idempotent) side effects of the blocks
+  * before the failed one: the chain state is then left at the block that failed, as without
+  * the batch. The same remarks on the mempool as for DisconnectTip apply.
+  */
+static bool DisconnectTips(CValidationState& state, const CBlockIndex* pindexFork, DisconnectedBlockTransactions* disconnectpool) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(mempool.cs);
+    std::vector<CBlockIndex*> vpindexDelete;
+    for (CBlockIndex* pindex = chainActive.Tip(); pindex && pindex != pindexFork && (int)vpindexDelete.size() < DISCONNECT_BATCH_SIZE; pindex = pindex->pprev) {
+        vpindexDelete.push_back(pindex);
+    }
+    if (vpindexDelete.empty()) {
+        return true;
     }
 
-    return true;
+    std::vector<CDisconnectRead> vRead;
+    std::vector<uint256> vAnchors;
+    if (!DisconnectTipsBatch(vpindexDelete, vRead, vAnchors)) {
+        LogPrintf("DisconnectTips() : Failed to disconnect %d blocks in a batch, disconnecting them one by one\n", vpindexDelete.size());
+        for (size_t i = 0; i < vpindexDelete.size(); i++) {
+            if (!DisconnectTip(state, Params(), disconnectpool)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    for (size_t i = 0; i < vpindexDelete.size(); i++) {
+        FinishDisconnectTip(vpindexDelete[i], vRead[i].pblock, vAnchors[i], vAnchors[i + 1], disconnectpool);
+    }
+    // Write the chain state to disk, if necessary.
+    return FlushStateToDisk(state, FLUSH_STATE_IF_NEEDED);
 }
 
+
 static int64_t nTimeReadFromDisk = 0;
 static int64_t nTimeConnectTotal = 0;
 static int64_t nTimeFlush = 0;
@@ -2049,6 +2757,7 @@ bool static ConnectTip(CValidationState& state, CBlockIndex* pindexNew, const st
     // Apply the block atomically to the chain state.
     int64_t nTime2 = GetTimeMicros();
     nTimeReadFromDisk += nTime2 - nTime1;
+    AddBlockStageTime(BlockStage::LOAD_BLOCK, nTime2 - nTime1);
     int64_t nTime3;
     LogPrint(BCLog::BENCHMARK, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * 0.001, nTimeReadFromDisk * 0.000001);
     {
@@ -2064,13 +2773,16 @@ bool static ConnectTip(CValidationState& state, CBlockIndex* pindexNew, const st
         }
         nTime3 = GetTimeMicros();
         nTimeConnectTotal += nTime3 - nTime2;
+        AddBlockStageTime(BlockStage::CONNECT_BLOCK, nTime3 - nTime2);
         LogPrint(BCLog::BENCHMARK, "  - Connect total: %.2fms [%.2fs]\n", (nTime3 - nTime2) * 0.001, nTimeConnectTotal * 0.000001);
         bool flushed = view.Flush();
         assert(flushed);
         dbTx->Commit();
+        MoneySupply.AddDelta(view.GetValueDelta(), pindexNew->nHeight, pindexNew->GetBlockHash());
     }
     int64_t nTime4 = GetTimeMicros();
     nTimeFlush += nTime4 - nTime3;
+    AddBlockStageTime(BlockStage::FLUSH_VIEW, nTime4 - nTime3);
     LogPrint(BCLog::BENCHMARK, "  - Flush: %.2fms [%.2fs]\n", (nTime4 - nTime3) * 0.001, nTimeFlush * 0.000001);
 
     // Write the chain state to disk, if necessary. Always write to disk if this is the first of a new file.
@@ -2081,6 +2793,7 @@ bool static ConnectTip(CValidationState& state, CBlockIndex* pindexNew, const st
         return false;
     int64_t nTime5 = GetTimeMicros();
     nTimeChainState += nTime5 - nTime4;
+    AddBlockStageTime(BlockStage::WRITE_CHAINSTATE, nTime5 - nTime4);
     LogPrint(BCLog::BENCHMARK, "  - Writing chainstate: %.2fms [%.2fs]\n", (nTime5 - nTime4) * 0.001, nTimeChainState * 0.000001);
 
     // Remove conflicting transactions from the mempool.
@@ -2099,6 +2812,8 @@ bool static ConnectTip(CValidationState& state, CBlockIndex* pindexNew, const st
     int64_t nTime6 = GetTimeMicros();
     nTimePostConnect += nTime6 - nTime5;
     nTimeTotal += nTime6 - nTime1;
+    AddBlockStageTime(BlockStage::POSTPROCESS, nTime6 - nTime5);
+    AddBlockStageTime(BlockStage::CONNECT_TIP, nTime6 - nTime1);
     LogPrint(BCLog::BENCHMARK, "  - Connect postprocess: %.2fms [%.2fs]\n", (nTime6 - nTime5) * 0.001, nTimePostConnect * 0.000001);
     LogPrint(BCLog::BENCHMARK, "- Connect block: %.2fms [%.2fs]\n", (nTime6 - nTime1) * 0.001, nTimeTotal * 0.000001);
 
@@ -2178,11 +2893,73 @@ static void PruneBlockIndexCandidates()
     assert(!setBlockIndexCandidates.empty());
 }
 
+/** Number of blocks read from disk ahead of their connection */
+static const int BLOCK_READ_AHEAD = 8;
+
+/**
+ * Reads the next blocks of the chain being connected from disk, on a helper thread, so that
+ * the reads overlap the connection of the current block instead of alternating with it.
+ * It lives for an ActivateBestChain call, which connects all the blocks available.
+ */
+class CBlockReadAhead
+{
+private:
+    std::unique_ptr<ctpl::thread_pool> pool;
+    std::map<const CBlockIndex*, std::future<std::shared_ptr<const CBlock>>> mapReads;
+
+public:
+    /** Start reading the (up to BLOCK_READ_AHEAD) blocks of pindexMostWork's chain following pindexFrom */
+    void Schedule(const CBlockIndex* pindexFrom, CBlockIndex* pindexMostWork) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+    {
+        AssertLockHeld(cs_main);
+        // Forget the reads of the blocks not ahead on this chain (anymore)
+        for (auto it = mapReads.begin(); it != mapReads.end();) {
+            if (it->first->nHeight <= pindexFrom->nHeight || pindexMostWork->GetAncestor(it->first->nHeight) != it->first) {
+                it = mapReads.erase(it);
+            } else {
+                it++;
+            }
+        }
+        const int nTargetHeight = std::min(pindexFrom->nHeight + BLOCK_READ_AHEAD, pindexMostWork->nHeight);
+        for (int nHeight = pindexFrom->nHeight + 1; nHeight <= nTargetHeight; nHeight++) {
+            const CBlockIndex* pindex = pindexMostWork->GetAncestor(nHeight);
+            if (mapReads.count(pindex) || !(pindex->nStatus & BLOCK_HAVE_DATA)) {
+                continue;
+            }
+            if (!pool) {
+                pool = std::make_unique<ctpl::thread_pool>(1);
+            }
+            // The position is read here: the helper thread can't take cs_main, held while waiting for it
+            const FlatFilePos pos = pindex->GetBlockPos();
+            const uint256 hash = pindex->GetBlockHash();
+            mapReads.emplace(pindex, pool->push([pos, hash](int) {
+                auto pblock = std::make_shared<CBlock>();
+                if (!ReadBlockFromDisk(*pblock, pos) || pblock->GetHash() != hash) {
+                    return std::shared_ptr<const CBlock>();
+                }
+                return std::shared_ptr<const CBlock>(pblock);
+            }));
+        }
+    }
+
+    /** The block of pindex if it was read ahead, nullptr otherwise (in which case it's read by ConnectTip) */
+    std::shared_ptr<const CBlock> Take(const CBlockIndex* pindex)
+    {
+        auto it = mapReads.find(pindex);
+        if (it == mapReads.end()) {
+            return nullptr;
+        }
+        std::shared_ptr<const CBlock> pblock = it->second.get();
+        mapReads.erase(it);
+        return pblock;
+    }
+};
+
 /**
  * Try to make some progress towards making pindexMostWork the active block.
  * pblock is either nullptr or a pointer to a CBlock corresponding to pindexMostWork.
  */
-static bool ActivateBestChainStep(CValidationState& state, CBlockIndex* pindexMostWork, const std::shared_ptr<const CBlock>& pblock, bool& fInvalidFound, ConnectTrace& connectTrace) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+static bool ActivateBestChainStep(CValidationState& state, CBlockIndex* pindexMostWork, const std::shared_ptr<const CBlock>& pblock, bool& fInvalidFound, ConnectTrace& connectTrace, CBlockReadAhead& readAhead) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
     AssertLockHeld(cs_main);
     AssertLockHeld(mempool.cs);
@@ -2193,7 +2970,9 @@ static bool ActivateBestChainStep(CValidationState& state, CBlockIndex* pindexMo
     bool fBlocksDisconnected = false;
     DisconnectedBlockTransactions disconnectpool;
     while (chainActive.Tip() && chainActive.Tip() != pindexFork) {
-        if (!DisconnectTip(state, Params(), &disconnectpool)) {
+        // A single block is disconnected as usual, deeper reorgs in batches
+        const bool fBatch = chainActive.Tip()->pprev != pindexFork;
+        if (fBatch ? !DisconnectTips(state, pindexFork, &disconnectpool) : !DisconnectTip(state, Params(), &disconnectpool)) {
             // This is likely a fatal error, but keep the mempool consistent,
             // just in case. Only remove from the mempool in this case.
             UpdateMempoolForReorg(disconnectpool, false);
@@ -2225,7 +3004,9 @@ static bool ActivateBestChainStep(CValidationState& state, CBlockIndex* pindexMo
 
         // Connect new blocks.
         for (CBlockIndex* pindexConnect : reverse_iterate(vpindexToConnect)) {
-            if (!ConnectTip(state, pindexConnect, (pindexConnect == pindexMostWork) ? pblock : std::shared_ptr<const CBlock>(), connectTrace, disconnectpool)) {
+            std::shared_ptr<const CBlock> pblockConnect = (pindexConnect == pindexMostWork) ? pblock : readAhead.Take(pindexConnect);
+            readAhead.Schedule(pindexConnect, pindexMostWork);
+            if (!ConnectTip(state, pindexConnect, pblockConnect, connectTrace, disconnectpool)) {
                 if (state.IsInvalid()) {
                     // The block violates a consensus rule.
                     if (!state.CorruptionPossible()) {
@@ -2291,10 +3072,11 @@ bool ActivateBestChain(CValidationState& state, std::shared_ptr<const CBlock> pb
 
     CBlockIndex* pindexNewTip = nullptr;
     CBlockIndex* pindexMostWork = nullptr;
+    CBlockReadAhead readAhead;
     do {
         boost::this_thread::interruption_point();
 
-        if (GetMainSignals().CallbacksPending() > 10) {
+        if (GetMainSignals().CallbacksPending() > GetMainSignals().MaxCallbacksPending()) {
             // Block until the validation queue drains. This should largely
             // never happen in normal operation, however may happen during
             // reindex, causing memory blowup  if we run too far ahead.
@@ -2322,7 +3104,7 @@ bool ActivateBestChain(CValidationState& state, std::shared_ptr<const CBlock> pb
 
                 bool fInvalidFound = false;
                 std::shared_ptr<const CBlock> nullBlockPtr;
-                if (!ActivateBestChainStep(state, pindexMostWork, pblock && pblock->GetHash() == pindexMostWork->GetBlockHash() ? pblock : nullBlockPtr, fInvalidFound, connectTrace))
+                if (!ActivateBestChainStep(state, pindexMostWork, pblock && pblock->GetHash() == pindexMostWork->GetBlockHash() ? pblock : nullBlockPtr, fInvalidFound, connectTrace, readAhead))
                     return false;
                 blocks_connected = true;
 
@@ -2448,12 +3230,11 @@ bool ReconsiderBlock(CValidationState& state, CBlockIndex* pindex)
     return true;
 }
 
-static CBlockIndex* AddToBlockIndex(const CBlock& block) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+static CBlockIndex* AddToBlockIndex(const CBlock& block, const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
     AssertLockHeld(cs_main);
 
     // Check for duplicate
-    uint256 hash = block.GetHash();
     CBlockIndex* pindex = LookupBlockIndex(hash);
     if (pindex)
         return pindex;
@@ -2464,6 +3245,8 @@ static CBlockIndex* AddToBlockIndex(const CBlock& block) EXCLUSIVE_LOCKS_REQUIRE
     // to avoid miners withholding blocks but broadcasting headers, to get a
     // competitive advantage.
     pindexNew->nSequenceId = 0;
+    // Held until the links to the previous block are set, for LookupBlockIndexShared
+    boost::unique_lock<boost::shared_mutex> lockIndex(g_block_index_mutex);
     BlockMap::iterator mi = mapBlockIndex.emplace(hash, pindexNew).first;
 
     pindexNew->phashBlock = &((*mi).first);
@@ -2483,11 +3266,14 @@ static CBlockIndex* AddToBlockIndex(const CBlock& block) EXCLUSIVE_LOCKS_REQUIRE
             pindexNew->SetNewStakeModifier(block.vtx[1]->vin[0].prevout.hash);
         }
     }
+    lockIndex.unlock();
     pindexNew->nTimeMax = (pindexNew->pprev ? std::max(pindexNew->pprev->nTimeMax, pindexNew->nTime) : pindexNew->nTime);
     pindexNew->nChainWork = (pindexNew->pprev ? pindexNew->pprev->nChainWork : 0) + GetBlockProof(*pindexNew);
     pindexNew->RaiseValidity(BLOCK_VALID_TREE);
-    if (pindexBestHeader == nullptr || pindexBestHeader->nChainWork < pindexNew->nChainWork)
+    if (pindexBestHeader == nullptr || pindexBestHeader->nChainWork < pindexNew->nChainWork) {
         pindexBestHeader = pindexNew;
+        nBestHeaderHeight = pindexNew->nHeight;
+    }
 
     setDirtyBlockIndex.insert(pindexNew);
     // track prevBlockHash -> pindex (multimap)
@@ -2696,6 +3482,41 @@ static unsigned int GetTotalShieldedTxSize(const CBlock& block)
     return nSizeShielded;
 }
 
+/** The context-free checks of a transaction of a block (CheckTransaction), out of cs_main. */
+class CTxCheck
+{
+private:
+    const CTransaction* ptx{nullptr};
+    bool fColdStakingActive{true};
+
+public:
+    CTxCheck() {}
+    CTxCheck(const CTransaction* ptxIn, bool fColdStakingActiveIn) : ptx(ptxIn), fColdStakingActive(fColdStakingActiveIn) {}
+
+    bool operator()()
+    {
+        CValidationState state;
+        return CheckTransaction(*ptx, state, fColdStakingActive);
+    }
+
+    void swap(CTxCheck& check)
+    {
+        std::swap(ptx, check.ptx);
+        std::swap(fColdStakingActive, check.fColdStakingActive);
+    }
+};
+
+static CCheckQueue<CTxCheck> txcheckqueue(32);
+
+void ThreadTxCheck()
+{
+    util::ThreadRename("pivx-txcheck");
+    txcheckqueue.Thread();
+}
+
+/** The transactions of blocks with fewer of them are checked sequentially only */
+static const size_t MIN_PARALLEL_TX_CHECKS = 16;
+
 bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bool fCheckMerkleRoot, bool fCheckSig)
 {
     AssertLockHeld(cs_main);
@@ -2792,10 +3613,22 @@ bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bo
         }
     }
 
-    // Check transactions
+    // Check transactions. The context-free checks of large blocks run in parallel first: when any fails,
+    // they run again in the loop below, to report the first failing transaction.
+    bool fTxsChecked = false;
+    if (nScriptCheckThreads && block.vtx.size() >= MIN_PARALLEL_TX_CHECKS) {
+        std::vector<CTxCheck> vChecks;
+        vChecks.reserve(block.vtx.size());
+        for (const auto& tx : block.vtx) {
+            vChecks.emplace_back(tx.get(), fColdStakingActive);
+        }
+        CCheckQueueControl<CTxCheck> control(&txcheckqueue);
+        control.Add(vChecks);
+        fTxsChecked = control.Wait();
+    }
     for (const auto& txIn : block.vtx) {
         const CTransaction& tx = *txIn;
-        if (!CheckTransaction(tx, state, fColdStakingActive)) {
+        if (!fTxsChecked && !CheckTransaction(tx, state, fColdStakingActive)) {
             return state.Invalid(false, state.GetRejectCode(), state.GetRejectReason(),
                     strprintf("Transaction check failed (tx hash %s) %s", tx.GetHash().ToString(), state.GetDebugMessage()));
         }
@@ -2904,12 +3737,11 @@ static const CBlockIndex* GetLastCheckpoint() EXCLUSIVE_LOCKS_REQUIRED(cs_main)
     return nullptr;
 }
 
-bool ContextualCheckBlockHeader(const CBlockHeader& block, CValidationState& state, CBlockIndex* const pindexPrev)
+static bool ContextualCheckBlockHeader(const CBlockHeader& block, const uint256& hash, CValidationState& state, CBlockIndex* const pindexPrev) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
     AssertLockHeld(cs_main);
 
     const Consensus::Params& consensus = Params().GetConsensus();
-    uint256 hash = block.GetHash();
 
     if (hash == consensus.hashGenesisBlock)
         return true;
@@ -2953,16 +3785,27 @@ bool ContextualCheckBlockHeader(const CBlockHeader& block, CValidationState& sta
     return true;
 }
 
-bool ContextualCheckBlock(const CBlock& block, CValidationState& state, CBlockIndex* const pindexPrev)
+bool ContextualCheckBlockHeader(const CBlockHeader& block, CValidationState& state, CBlockIndex* const pindexPrev)
+{
+    return ContextualCheckBlockHeader(block, block.GetHash(), state, pindexPrev);
+}
+
+bool ContextualCheckBlock(const CBlock& block, CValidationState& state, CBlockIndex* const pindexPrev, bool fCheckProofs)
 {
     const int nHeight = pindexPrev == nullptr ? 0 : pindexPrev->nHeight + 1;
     const CChainParams& chainparams = Params();
 
+    const bool fIBD = IsInitialBlockDownload();
+    // Sapling proofs verification is deferred, and done in batches
+    std::vector<SaplingValidation::CSaplingProofCheck> vSaplingChecks;
+    // Public zerocoin spends verification is deferred too
+    std::vector<CPublicCoinSpendCheck> vZerocoinChecks;
+
     // Check that all transactions are finalized
     for (const auto& tx : block.vtx) {
 
         // Check transaction contextually against consensus rules at block height
-        if (!ContextualCheckTransaction(tx, state, chainparams, nHeight, true /* isMined */, IsInitialBlockDownload())) {
+        if (!ContextualCheckTransaction(tx, state, chainparams, nHeight, true /* isMined */, fIBD, &vSaplingChecks, &vZerocoinChecks)) {
             return false;
         }
 
@@ -2971,6 +3814,53 @@ bool ContextualCheckBlock(const CBlock& block, CValidationState& state, CBlockIn
         }
     }
 
+    if (!fCheckProofs) {
+        // Assumed valid block: skip the Sapling proofs and the public zerocoin spends verification
+        vSaplingChecks.clear();
+        vZerocoinChecks.clear();
+    }
+
+    // Split the proofs in one batch per verification thread (if enabled)
+    const int64_t nTimeProofs = GetTimeMicros();
+    const size_t nBatches = std::max(1, std::min<int>(nScriptCheckThreads, vSaplingChecks.size()));
+    std::vector<SaplingValidation::CSaplingBatchCheck> vBatches(vSaplingChecks.empty() ? 0 : nBatches);
+    for (size_t i = 0; i < vSaplingChecks.size(); i++) {
+        vBatches[i % nBatches].Add(vSaplingChecks[i]);
+    }
+    bool fSaplingOk = true;
+    bool fZerocoinOk = true;
+    if (nScriptCheckThreads) {
+        CCheckQueueControl<SaplingValidation::CSaplingBatchCheck> control(&saplingcheckqueue);
+        CCheckQueueControl<CPublicCoinSpendCheck> zcControl(&zerocoincheckqueue);
+        control.Add(vBatches);
+        zcControl.Add(vZerocoinChecks);
+        fSaplingOk = control.Wait();
+        fZerocoinOk = zcControl.Wait();
+    } else {
+        for (auto& batch : vBatches) {
+            if (!(fSaplingOk = batch())) break;
+        }
+        for (auto& check : vZerocoinChecks) {
+            if (!fSaplingOk || !(fZerocoinOk = check())) break;
+        }
+    }
+
+    if (!fSaplingOk || !fZerocoinOk) {
+        // Redo the verification serially, to set the exact failure reason in the validation state
+        for (const auto& tx : block.vtx) {
+            if (!ContextualCheckTransaction(tx, state, chainparams, nHeight, true /* isMined */, fIBD)) {
+                return false;
+            }
+        }
+        if (!fSaplingOk) {
+            return state.DoS(100, error("%s: Sapling CheckQueue failed", __func__), REJECT_INVALID, "bad-txns-sapling-proofs-invalid");
+        }
+        return state.DoS(100, error("%s: Zerocoin CheckQueue failed", __func__), REJECT_INVALID, "bad-txns-invalid-zpiv");
+    }
+    if (!vSaplingChecks.empty() || !vZerocoinChecks.empty()) {
+        AddBlockStageTime(BlockStage::SHIELDED_PROOFS, GetTimeMicros() - nTimeProofs);
+    }
+
     // Enforce block.nVersion=2 rule that the coinbase starts with serialized block height
     if (pindexPrev) { // pindexPrev is only null on the first block which is a version 1 block.
         CScript expect = CScript() << nHeight;
@@ -2999,13 +3889,13 @@ bool ContextualCheckBlock(const CBlock& block, CValidationState& state, CBlockIn
 }
 
 // Get the index of previous block of given CBlock
-static bool GetPrevIndex(const CBlock& block, CBlockIndex** pindexPrevRet, CValidationState& state) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+static bool GetPrevIndex(const CBlock& block, const uint256& hash, CBlockIndex** pindexPrevRet, CValidationState& state) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
     AssertLockHeld(cs_main);
 
     CBlockIndex*& pindexPrev = *pindexPrevRet;
     pindexPrev = nullptr;
-    if (block.GetHash() != Params().GetConsensus().hashGenesisBlock) {
+    if (hash != Params().GetConsensus().hashGenesisBlock) {
         pindexPrev = LookupBlockIndex(block.hashPrevBlock);
         if (!pindexPrev) {
             return state.DoS(0, error("%s : prev block %s not found", __func__, block.hashPrevBlock.GetHex()), 0,
@@ -3022,18 +3912,18 @@ static bool GetPrevIndex(const CBlock& block, CBlockIndex** pindexPrevRet, CVali
                     return true;
                 }
             }
-            return state.DoS(100, error("%s : prev block %s is invalid, unable to add block %s", __func__, block.hashPrevBlock.GetHex(), block.GetHash().GetHex()),
+            return state.DoS(100, error("%s : prev block %s is invalid, unable to add block %s", __func__, block.hashPrevBlock.GetHex(), hash.GetHex()),
                              REJECT_INVALID, "bad-prevblk");
         }
     }
     return true;
 }
 
-bool AcceptBlockHeader(const CBlock& block, CValidationState& state, CBlockIndex** ppindex, CBlockIndex* pindexPrev)
+// The hash of the block is given, as it's expensive to compute for the old (Quark) block versions
+static bool AcceptBlockHeader(const CBlock& block, const uint256& hash, CValidationState& state, CBlockIndex** ppindex, CBlockIndex* pindexPrev) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
     AssertLockHeld(cs_main);
     // Check for duplicate
-    const uint256& hash = block.GetHash();
     CBlockIndex* pindex = LookupBlockIndex(hash);
 
     // TODO : ENABLE BLOCK CACHE IN SPECIFIC CASES
@@ -3047,21 +3937,21 @@ bool AcceptBlockHeader(const CBlock& block, CValidationState& state, CBlockIndex
     }
 
     // Get prev block index
-    if (pindexPrev == nullptr && !GetPrevIndex(block, &pindexPrev, state)) {
+    if (pindexPrev == nullptr && !GetPrevIndex(block, hash, &pindexPrev, state)) {
         return false;
     }
 
-    if (!ContextualCheckBlockHeader(block, state, pindexPrev))
+    if (!ContextualCheckBlockHeader(block, hash, state, pindexPrev))
         return error("%s: ContextualCheckBlockHeader failed for block %s: %s", __func__, hash.ToString(), FormatStateMessage(state));
 
     // Check for conflicting chainlocks UNLESS that's the genesis block
-    if (block.GetHash() != Params().GetConsensus().hashGenesisBlock) {
+    if (hash != Params().GetConsensus().hashGenesisBlock) {
         if (llmq::chainLocksHandler->HasConflictingChainLock(pindexPrev->nHeight + 1, hash)) {
             return state.DoS(10, error("%s: conflicting with chainlock", __func__), REJECT_INVALID, "bad-chainlock");
         }
     }
     if (pindex == nullptr)
-        pindex = AddToBlockIndex(block);
+        pindex = AddToBlockIndex(block, hash);
 
     if (ppindex)
         *ppindex = pindex;
@@ -3073,6 +3963,100 @@ bool AcceptBlockHeader(const CBlock& block, CValidationState& state, CBlockIndex
     return true;
 }
 
+bool AcceptBlockHeader(const CBlock& block, CValidationState& state, CBlockIndex** ppindex, CBlockIndex* pindexPrev)
+{
+    return AcceptBlockHeader(block, block.GetHash(), state, ppindex, pindexPrev);
+}
+
+/** Computes the hash of a header of a headers message, out of cs_main. */
+class CBlockHeaderHashCheck
+{
+private:
+    const CBlockHeader* pheader{nullptr};
+    uint256* phash{nullptr};
+
+public:
+    CBlockHeaderHashCheck() {}
+    CBlockHeaderHashCheck(const CBlockHeader* pheaderIn, uint256* phashIn) : pheader(pheaderIn), phash(phashIn) {}
+
+    bool operator()()
+    {
+        *phash = pheader->GetHash();
+        return true;
+    }
+
+    void swap(CBlockHeaderHashCheck& check)
+    {
+        std::swap(pheader, check.pheader);
+        std::swap(phash, check.phash);
+    }
+};
+
+static CCheckQueue<CBlockHeaderHashCheck> headerhashqueue(16);
+
+void ThreadHeaderHashCheck()
+{
+    util::ThreadRename("pivx-headerch");
+    headerhashqueue.Thread();
+}
+
+std::vector<uint256> HashBlockHeaders(const std::vector<CBlockHeader>& headers)
+{
+    std::vector<uint256> vHashes(headers.size());
+    std::vector<CBlockHeaderHashCheck> vChecks;
+    vChecks.reserve(headers.size());
+    for (size_t i = 0; i < headers.size(); i++) {
+        vChecks.emplace_back(&headers[i], &vHashes[i]);
+    }
+    if (nScriptCheckThreads) {
+        CCheckQueueControl<CBlockHeaderHashCheck> control(&headerhashqueue);
+        control.Add(vChecks);
+        control.Wait();
+    } else {
+        for (auto& check : vChecks) {
+            check();
+        }
+    }
+    return vHashes;
+}
+
+bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, CBlockIndex** ppindex)
+{
+    AssertLockNotHeld(cs_main);
+
+    const std::vector<uint256> vHashes = HashBlockHeaders(headers);
+
+    // Context-free check: the headers must be a chain
+    for (size_t i = 1; i < headers.size(); i++) {
+        if (headers[i].hashPrevBlock != vHashes[i - 1]) {
+            return state.DoS(20, error("%s: non-continuous headers sequence", __func__), REJECT_INVALID, "non-continuous-headers");
+        }
+    }
+
+    LOCK(cs_main);
+    const Consensus::Params& consensus = Params().GetConsensus();
+    CBlockIndex* pindexLast = nullptr;
+    for (size_t i = 0; i < headers.size(); i++) {
+        // The stake modifier of the blocks since v3.4 is computed from their coinstake, so these can't be added
+        // to the block index from their header only.
+        const CBlockIndex* pindexPrev = LookupBlockIndex(headers[i].hashPrevBlock);
+        if (pindexPrev && consensus.NetworkUpgradeActive(pindexPrev->nHeight + 1, Consensus::UPGRADE_V3_4) &&
+                !LookupBlockIndex(vHashes[i])) {
+            break;
+        }
+        if (!AcceptBlockHeader(CBlock(headers[i]), vHashes[i], state, &pindexLast, nullptr)) {
+            if (ppindex) {
+                *ppindex = pindexLast;
+            }
+            return false;
+        }
+    }
+    if (ppindex) {
+        *ppindex = pindexLast;
+    }
+    return true;
+}
+
 /*
  * Collect the sets of the inputs (either regular utxos or zerocoin serials) spent
  * by in-block txes.
@@ -3155,70 +4139,127 @@ static bool CheckInBlockDoubleSpends(const CBlock& block, int nHeight, CValidati
     return true;
 }
 
-/*
- * Check whether ALL the provided inputs (outpoints and zerocoin serials) are UNSPENT on
- * a forked (non currently active) chain.
- * Start from startIndex and go backwards on the forked chain, down to the split block.
- * Return false if any block contains a tx spending an input included in the provided sets
- * 'outpoints' and/or 'serials'.
- * Return false also when the fork is longer than -maxreorg.
- * Return true otherwise.
- * Save in pindexFork the index of the pre-split block (last common block with the active chain).
- * Remove from the outpoints set, any coin that was created in the fork (we don't
- * need to check that it was unspent on the active chain before the split).
- */
-static bool IsUnspentOnFork(std::unordered_set<COutPoint, SaltedOutpointHasher>& outpoints,
-                            const std::set<CBigNum>& serials,
-                            const CBlockIndex* startIndex, CValidationState& state, const CBlockIndex*& pindexFork)
+/** The regular outpoints spent and created, and the zerocoin serials spent, by the transactions of a block */
+struct BlockOutpoints
 {
-    // Go backwards on the forked chain up to the split
-    int readBlock = 0;
-    pindexFork = startIndex;
-    for ( ; !chainActive.Contains(pindexFork); pindexFork = pindexFork->pprev) {
-        // Check if the forked chain is longer than the max reorg limit
-        if (++readBlock == gArgs.GetArg("-maxreorg", DEFAULT_MAX_REORG_DEPTH)) {
-            // TODO: Remove this chain from disk.
-            return error("%s: forked chain longer than maximum reorg limit", __func__);
-        }
-        if (pindexFork->pprev == nullptr) {
-            return error("%s: null pprev for block %s", __func__, pindexFork->GetBlockHash().GetHex());
-        }
+    std::vector<COutPoint> vSpent;
+    std::vector<COutPoint> vCreated;
+    std::vector<CBigNum> vSerials;
 
-        // if there are no coins left, don't read the block
-        if (outpoints.empty() && serials.empty()) continue;
-
-        // read block
-        CBlock bl;
-        if (!ReadBlockFromDisk(bl, pindexFork)) {
-            return error("%s: block %s not on disk", __func__, pindexFork->GetBlockHash().GetHex());
-        }
-        // Loop through every tx of this block
-        // (reversed because we first check spent outpoints, and then remove created ones)
-        for (auto it = bl.vtx.rbegin(); it != bl.vtx.rend(); ++it) {
-            CTransactionRef tx = *it;
-            // Loop through every input of this tx
+    explicit BlockOutpoints(const CBlock& block)
+    {
+        for (const auto& tx : block.vtx) {
             for (const CTxIn& in: tx->vin) {
-                // check if any of the provided outpoints/serials is being spent
                 if (!in.IsZerocoinSpend()) {
-                    // regular utxo
-                    if (outpoints.find(in.prevout) != outpoints.end()) {
-                        return state.DoS(100, false, REJECT_INVALID, "bad-txns-inputs-spent-fork-post-split");
-                    }
+                    vSpent.emplace_back(in.prevout);
                 } else {
-                    // zerocoin serial
-                    const CBigNum& s = ZPIVModule::TxInToZerocoinSpend(in).getCoinSerialNumber();
-                    if (serials.find(s) != serials.end()) {
-                        return state.DoS(100, false, REJECT_INVALID, "bad-txns-serials-spent-fork-post-split");
-                    }
+                    vSerials.emplace_back(ZPIVModule::TxInToZerocoinSpend(in).getCoinSerialNumber());
                 }
             }
-            // Then remove from the outpoints set, any coin created by this tx
             const uint256& txid = tx->GetHash();
             for (size_t i = 0; i < tx->vout.size(); i++) {
-                // erase if present (no-op if not)
-                outpoints.erase(COutPoint(txid, i));
+                vCreated.emplace_back(txid, i);
+            }
+        }
+    }
+};
+
+//! Maximum number of blocks kept in mapBlockOutpoints
+static const size_t MAX_BLOCK_OUTPOINTS_CACHE_SIZE = 2 * DEFAULT_MAX_REORG_DEPTH;
+
+//! Outpoints of the recently accepted (or read) blocks, so that the fork checks of AcceptBlock
+//! don't read the blocks of a fork from disk again for each new block on top of it
+static std::unordered_map<uint256, std::shared_ptr<const BlockOutpoints>, BlockHasher> mapBlockOutpoints GUARDED_BY(cs_main);
+//! Insertion order of mapBlockOutpoints, the oldest entries are evicted first
+static std::deque<uint256> dequeBlockOutpoints GUARDED_BY(cs_main);
+
+static std::shared_ptr<const BlockOutpoints> CacheBlockOutpoints(const uint256& hash, const CBlock& block) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    auto it = mapBlockOutpoints.find(hash);
+    if (it != mapBlockOutpoints.end()) {
+        return it->second;
+    }
+    auto outpoints = std::make_shared<const BlockOutpoints>(block);
+    mapBlockOutpoints.emplace(hash, outpoints);
+    dequeBlockOutpoints.emplace_back(hash);
+    while (dequeBlockOutpoints.size() > MAX_BLOCK_OUTPOINTS_CACHE_SIZE) {
+        mapBlockOutpoints.erase(dequeBlockOutpoints.front());
+        dequeBlockOutpoints.pop_front();
+    }
+    return outpoints;
+}
+
+/** The outpoints of the block of pindex, from the cache, or else read from disk (nullptr if it can't be read) */
+static std::shared_ptr<const BlockOutpoints> GetBlockOutpoints(const CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    auto it = mapBlockOutpoints.find(pindex->GetBlockHash());
+    if (it != mapBlockOutpoints.end()) {
+        return it->second;
+    }
+    CBlock bl;
+    if (!ReadBlockFromDisk(bl, pindex)) {
+        return nullptr;
+    }
+    return CacheBlockOutpoints(pindex->GetBlockHash(), bl);
+}
+
+/*
+ * Check whether ALL the provided inputs (outpoints and zerocoin serials) are UNSPENT on
+ * a forked (non currently active) chain.
+ * Start from startIndex and go backwards on the forked chain, down to the split block.
+ * Return false if any block contains a tx spending an input included in the provided sets
+ * 'outpoints' and/or 'serials'.
+ * Return false also when the fork is longer than -maxreorg.
+ * Return true otherwise.
+ * Save in pindexFork the index of the pre-split block (last common block with the active chain).
+ * Remove from the outpoints set, any coin that was created in the fork (we don't
+ * need to check that it was unspent on the active chain before the split).
+ */
+static bool IsUnspentOnFork(std::unordered_set<COutPoint, SaltedOutpointHasher>& outpoints,
+                            const std::set<CBigNum>& serials,
+                            const CBlockIndex* startIndex, CValidationState& state, const CBlockIndex*& pindexFork) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    // Go backwards on the forked chain up to the split
+    int readBlock = 0;
+    pindexFork = startIndex;
+    for ( ; !chainActive.Contains(pindexFork); pindexFork = pindexFork->pprev) {
+        // Check if the forked chain is longer than the max reorg limit
+        if (++readBlock == gArgs.GetArg("-maxreorg", DEFAULT_MAX_REORG_DEPTH)) {
+            // TODO: Remove this chain from disk.
+            return error("%s: forked chain longer than maximum reorg limit", __func__);
+        }
+        if (pindexFork->pprev == nullptr) {
+            return error("%s: null pprev for block %s", __func__, pindexFork->GetBlockHash().GetHex());
+        }
+
+        // if there are no coins left, don't read the block
+        if (outpoints.empty() && serials.empty()) continue;
+
+        // the spent and created outpoints of the block (cached, or read from disk)
+        std::shared_ptr<const BlockOutpoints> bl = GetBlockOutpoints(pindexFork);
+        if (!bl) {
+            return error("%s: block %s not on disk", __func__, pindexFork->GetBlockHash().GetHex());
+        }
+        // First check the spent outpoints, and then remove the created ones.
+        // An in-block tx can only spend the outputs of the txes before it, so checking all the
+        // inputs of the block at once is the same as checking its txes in reverse order.
+        for (const COutPoint& prevout : bl->vSpent) {
+            // regular utxo
+            if (outpoints.find(prevout) != outpoints.end()) {
+                return state.DoS(100, false, REJECT_INVALID, "bad-txns-inputs-spent-fork-post-split");
+            }
+        }
+        for (const CBigNum& s : bl->vSerials) {
+            // zerocoin serial
+            if (serials.find(s) != serials.end()) {
+                return state.DoS(100, false, REJECT_INVALID, "bad-txns-serials-spent-fork-post-split");
             }
         }
+        // Then remove from the outpoints set, any coin created by this block
+        for (const COutPoint& out : bl->vCreated) {
+            // erase if present (no-op if not)
+            outpoints.erase(out);
+        }
     }
 
     // All the provided outpoints/serials are not spent on the fork,
@@ -3233,7 +4274,7 @@ static bool IsUnspentOnFork(std::unordered_set<COutPoint, SaltedOutpointHasher>&
  * blocks. At the end, return true if the set is empty (all outpoints are spent), and false
  * otherwise (some outpoint is unspent).
  */
-static bool IsSpentOnActiveChain(std::unordered_set<COutPoint, SaltedOutpointHasher>& outpoints, const CBlockIndex* pindexFork)
+static bool IsSpentOnActiveChain(std::unordered_set<COutPoint, SaltedOutpointHasher>& outpoints, const CBlockIndex* pindexFork) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
     assert(chainActive.Contains(pindexFork));
     const int height_start = pindexFork->nHeight + 1;
@@ -3241,19 +4282,15 @@ static bool IsSpentOnActiveChain(std::unordered_set<COutPoint, SaltedOutpointHas
 
     // Go upwards on the active chain till the tip
     for (int height = height_start; height <= height_end && !outpoints.empty(); height++) {
-        // read block
+        // the spent outpoints of the block (cached, or read from disk)
         const CBlockIndex* pindex = mapBlockIndex.at(chainActive[height]->GetBlockHash());
-        CBlock bl;
-        if (!ReadBlockFromDisk(bl, pindex)) {
+        std::shared_ptr<const BlockOutpoints> bl = GetBlockOutpoints(pindex);
+        if (!bl) {
             return error("%s: block %s not on disk", __func__, pindex->GetBlockHash().GetHex());
         }
-        // Loop through every tx of this block
-        for (const auto& tx : bl.vtx) {
-            // Loop through every input of this tx
-            for (const CTxIn& in: tx->vin) {
-                // erase if present (no-op if not)
-                outpoints.erase(in.prevout);
-            }
+        for (const COutPoint& prevout : bl->vSpent) {
+            // erase if present (no-op if not)
+            outpoints.erase(prevout);
         }
     }
 
@@ -3270,11 +4307,12 @@ static bool AcceptBlock(const CBlock& block, CValidationState& state, CBlockInde
     const Consensus::Params& consensus = Params().GetConsensus();
 
     // Get prev block index
+    const uint256& hash = block.GetHash();
     CBlockIndex* pindexPrev = nullptr;
-    if (!GetPrevIndex(block, &pindexPrev, state))
+    if (!GetPrevIndex(block, hash, &pindexPrev, state))
         return false;
 
-    if (block.GetHash() != consensus.hashGenesisBlock && !CheckWork(block, pindexPrev))
+    if (hash != consensus.hashGenesisBlock && !CheckWork(block, pindexPrev))
         return state.DoS(100, false, REJECT_INVALID);
 
     bool isPoS = block.IsProofOfStake();
@@ -3284,7 +4322,7 @@ static bool AcceptBlock(const CBlock& block, CValidationState& state, CBlockInde
             return state.DoS(100, error("%s: proof of stake check failed (%s)", __func__, strError));
     }
 
-    if (!AcceptBlockHeader(block, state, &pindex, pindexPrev))
+    if (!AcceptBlockHeader(block, hash, state, &pindex, pindexPrev))
         return false;
 
     if (pindex->nStatus & BLOCK_HAVE_DATA) {
@@ -3294,7 +4332,7 @@ static bool AcceptBlock(const CBlock& block, CValidationState& state, CBlockInde
         return true;
     }
 
-    if (!CheckBlock(block, state) || !ContextualCheckBlock(block, state, pindex->pprev)) {
+    if (!CheckBlock(block, state) || !ContextualCheckBlock(block, state, pindex->pprev, !IsAssumedValid(pindex))) {
         if (state.IsInvalid() && !state.CorruptionPossible()) {
             pindex->nStatus |= BLOCK_FAILED_VALID;
             setDirtyBlockIndex.insert(pindex);
@@ -3404,9 +4442,124 @@ static bool AcceptBlock(const CBlock& block, CValidationState& state, CBlockInde
         return AbortNode(state, std::string("System error: ") + e.what());
     }
 
+    // The next blocks of a fork on top of this one walk it back to the split
+    if (isPoS) {
+        CacheBlockOutpoints(hash, block);
+    }
+
     return true;
 }
 
+/** Reads a coin from the chainstate database, out of cs_main, for PrefetchBlockCoins. */
+class CCoinPrefetchCheck
+{
+private:
+    const CCoinsViewDB* pdb{nullptr};
+    const COutPoint* poutpoint{nullptr};
+    Coin* pcoin{nullptr};
+
+public:
+    CCoinPrefetchCheck() {}
+    CCoinPrefetchCheck(const CCoinsViewDB* pdbIn, const COutPoint* poutpointIn, Coin* pcoinIn) :
+        pdb(pdbIn), poutpoint(poutpointIn), pcoin(pcoinIn) {}
+
+    bool operator()()
+    {
+        // A missing coin is left spent: it's then read (or found missing) again by the validation
+        try {
+            if (!pdb->GetCoin(*poutpoint, *pcoin)) pcoin->Clear();
+        } catch (const std::exception&) {
+            pcoin->Clear();
+        }
+        return true;
+    }
+
+    void swap(CCoinPrefetchCheck& check)
+    {
+        std::swap(pdb, check.pdb);
+        std::swap(poutpoint, check.poutpoint);
+        std::swap(pcoin, check.pcoin);
+    }
+};
+
+static CCheckQueue<CCoinPrefetchCheck> coinprefetchqueue(16);
+
+void ThreadCoinPrefetch()
+{
+    util::ThreadRename("pivx-coinpref");
+    coinprefetchqueue.Thread();
+}
+
+struct PrefetchedCoins
+{
+    uint64_t nCoinsDBWriteSeq{0};
+    std::vector<COutPoint> vOutpoints;
+    std::vector<Coin> vCoins;
+};
+
+/**
+ * Reads the coins spent by a block that are missing from the cache of the chainstate, from the database on the
+ * prefetch threads, so that its validation doesn't wait for these random reads, one at a time.
+ */
+static void PrefetchBlockCoins(const CBlock& block, PrefetchedCoins& prefetched)
+{
+    AssertLockNotHeld(cs_main);
+    if (!nScriptCheckThreads || block.vtx.size() < 2) {
+        return;
+    }
+    std::set<uint256> setBlockTxids;
+    for (const auto& tx : block.vtx) {
+        setBlockTxids.insert(tx->GetHash());
+    }
+    {
+        LOCK(cs_main);
+        // The database is behind the cache during a background flush
+        if (pcoinsFlushing || !pcoinsdbview) {
+            return;
+        }
+        prefetched.nCoinsDBWriteSeq = nCoinsDBWriteSeq;
+        for (size_t i = 1; i < block.vtx.size(); i++) {
+            for (const CTxIn& in : block.vtx[i]->vin) {
+                if (in.IsZerocoinSpend() || in.IsZerocoinPublicSpend() || setBlockTxids.count(in.prevout.hash) ||
+                        pcoinsTip->HaveCoinInCache(in.prevout)) {
+                    continue;
+                }
+                prefetched.vOutpoints.emplace_back(in.prevout);
+            }
+        }
+    }
+    if (prefetched.vOutpoints.empty()) {
+        return;
+    }
+
+    const int64_t nStart = GetTimeMicros();
+    prefetched.vCoins.resize(prefetched.vOutpoints.size());
+    std::vector<CCoinPrefetchCheck> vChecks;
+    vChecks.reserve(prefetched.vOutpoints.size());
+    for (size_t i = 0; i < prefetched.vOutpoints.size(); i++) {
+        vChecks.emplace_back(pcoinsdbview.get(), &prefetched.vOutpoints[i], &prefetched.vCoins[i]);
+    }
+    CCheckQueueControl<CCoinPrefetchCheck> control(&coinprefetchqueue);
+    control.Add(vChecks);
+    control.Wait();
+    LogPrint(BCLog::BENCHMARK, "    - Prefetch %u coins: %.2fms\n", prefetched.vOutpoints.size(), (GetTimeMicros() - nStart) * 0.001);
+}
+
+/** Adds the prefetched coins to the cache, unless a flush changed the database since they were read. */
+static void CachePrefetchedCoins(PrefetchedCoins& prefetched) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    AssertLockHeld(cs_main);
+    if (prefetched.vCoins.empty() || pcoinsFlushing || prefetched.nCoinsDBWriteSeq != nCoinsDBWriteSeq) {
+        return;
+    }
+    // The coins created or spent since the reads are in the cache, so CacheCoin keeps them
+    for (size_t i = 0; i < prefetched.vCoins.size(); i++) {
+        if (!prefetched.vCoins[i].IsSpent()) {
+            pcoinsTip->CacheCoin(prefetched.vOutpoints[i], std::move(prefetched.vCoins[i]));
+        }
+    }
+}
+
 bool ProcessNewBlock(const std::shared_ptr<const CBlock>& pblock, const FlatFilePos* dbp)
 {
     AssertLockNotHeld(cs_main);
@@ -3415,9 +4568,13 @@ bool ProcessNewBlock(const std::shared_ptr<const CBlock>& pblock, const FlatFile
     int64_t nStartTime = GetTimeMillis();
     int newHeight = 0;
 
+    PrefetchedCoins prefetched;
+    PrefetchBlockCoins(*pblock, prefetched);
+
     {
         // CheckBlock requires cs_main lock
         LOCK(cs_main);
+        CachePrefetchedCoins(prefetched);
         CValidationState state;
         if (!CheckBlock(*pblock, state)) {
             GetMainSignals().BlockChecked(*pblock, state);
@@ -3518,6 +4675,7 @@ CBlockIndex* InsertBlockIndex(const uint256& hash)
 
     // Create new
     CBlockIndex* pindexNew = new CBlockIndex();
+    boost::unique_lock<boost::shared_mutex> lockIndex(g_block_index_mutex);
     mi = mapBlockIndex.emplace(hash, pindexNew).first;
 
     pindexNew->phashBlock = &((*mi).first);
@@ -3525,15 +4683,43 @@ CBlockIndex* InsertBlockIndex(const uint256& hash)
     return pindexNew;
 }
 
+/** One in this many block index entries has its header re-hashed at startup (all of them with -checkblockindex) */
+static const int BLOCK_INDEX_HASH_SAMPLE = 1000;
+
 bool static LoadBlockIndexDB(std::string& strError) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
     AssertLockHeld(cs_main);
 
+    const int64_t nTimeStart = GetTimeMicros();
     if (!pblocktree->LoadBlockIndexGuts(InsertBlockIndex))
         return false;
+    const int64_t nTimeLoad = GetTimeMicros();
 
     boost::this_thread::interruption_point();
 
+    // The entries are keyed by the hash of their header, which is trusted as stored (HashQuark for the old
+    // versions is slow). A random sample is re-hashed to detect a corrupted block index.
+    std::vector<const CBlockIndex*> vToVerify;
+    std::vector<CBlockHeader> vHeaders;
+    FastRandomContext rng;
+    for (const std::pair<const uint256, CBlockIndex*>& item : mapBlockIndex) {
+        const CBlockIndex* pindex = item.second;
+        // Skip the parents referenced by an entry but missing from the database
+        if ((pindex->nStatus & BLOCK_VALID_MASK) == BLOCK_VALID_UNKNOWN) continue;
+        if (fCheckBlockIndex || rng.randrange(BLOCK_INDEX_HASH_SAMPLE) == 0) {
+            vToVerify.push_back(pindex);
+            vHeaders.push_back(pindex->GetBlockHeader());
+        }
+    }
+    const std::vector<uint256> vHashes = HashBlockHeaders(vHeaders);
+    for (size_t i = 0; i < vToVerify.size(); i++) {
+        if (vHashes[i] != vToVerify[i]->GetBlockHash()) {
+            return error("%s: the header of the block index entry %s hashes to %s", __func__,
+                         vToVerify[i]->GetBlockHash().ToString(), vHashes[i].ToString());
+        }
+    }
+    const int64_t nTimeVerify = GetTimeMicros();
+
     // Calculate nChainWork
     std::vector<std::pair<int, CBlockIndex*> > vSortedByHeight;
     vSortedByHeight.reserve(mapBlockIndex.size());
@@ -3580,9 +4766,12 @@ bool static LoadBlockIndexDB(std::string& strError) EXCLUSIVE_LOCKS_REQUIRED(cs_
             pindexBestInvalid = pindex;
         if (pindex->pprev)
             pindex->BuildSkip();
-        if (pindex->IsValid(BLOCK_VALID_TREE) && (pindexBestHeader == nullptr || CBlockIndexWorkComparator()(pindexBestHeader, pindex)))
+        if (pindex->IsValid(BLOCK_VALID_TREE) && (pindexBestHeader == nullptr || CBlockIndexWorkComparator()(pindexBestHeader, pindex))) {
             pindexBestHeader = pindex;
+            nBestHeaderHeight = pindex->nHeight;
+        }
     }
+    const int64_t nTimeChainWork = GetTimeMicros();
 
     // Load block file info
     pblocktree->ReadLastBlockFile(nLastBlockFile);
@@ -3616,6 +4805,10 @@ bool static LoadBlockIndexDB(std::string& strError) EXCLUSIVE_LOCKS_REQUIRED(cs_
             return false;
         }
     }
+    const int64_t nTimeFiles = GetTimeMicros();
+    LogPrintf("%s: loaded %u entries in %.2fms, re-hashed %u headers in %.2fms, chain work in %.2fms, block files in %.2fms\n",
+              __func__, mapBlockIndex.size(), (nTimeLoad - nTimeStart) * 0.001, vToVerify.size(), (nTimeVerify - nTimeLoad) * 0.001,
+              (nTimeChainWork - nTimeVerify) * 0.001, (nTimeFiles - nTimeChainWork) * 0.001);
 
     //Check if the shutdown procedure was followed on last client exit
     bool fLastShutdownWasPrepared = true;
@@ -3627,9 +4820,13 @@ bool static LoadBlockIndexDB(std::string& strError) EXCLUSIVE_LOCKS_REQUIRED(cs_
     pblocktree->ReadReindexing(fReindexing);
     if (fReindexing) fReindex = true;
 
-    // Check whether we have a transaction index
-    pblocktree->ReadFlag("txindex", fTxIndex);
-    LogPrintf("LoadBlockIndexDB(): transaction index %s\n", fTxIndex ? "enabled" : "disabled");
+    // Check whether we have an address index
+    pblocktree->ReadFlag("addressindex", fAddressIndex);
+    LogPrintf("LoadBlockIndexDB(): address index %s\n", fAddressIndex ? "enabled" : "disabled");
+
+    // Check whether we have a spent index
+    pblocktree->ReadFlag("spentindex", fSpentIndex);
+    LogPrintf("LoadBlockIndexDB(): spent index %s\n", fSpentIndex ? "enabled" : "disabled");
 
     // If this is written true before the next client init, then we know the shutdown process failed
     pblocktree->WriteFlag("shutdown", false);
@@ -3659,6 +4856,7 @@ bool LoadChainTip(const CChainParams& chainparams)
         return false;
     }
     chainActive.SetTip(pindex);
+    PublishChainTipSnapshot(pindex);
 
     PruneBlockIndexCandidates();
 
@@ -3671,6 +4869,74 @@ bool LoadChainTip(const CChainParams& chainparams)
     return true;
 }
 
+/** Number of threads reading (with their undo data) the blocks verified by VerifyDB */
+static const int VERIFYDB_READ_THREADS = 4;
+/** Number of blocks read ahead of their verification by VerifyDB */
+static const int VERIFYDB_READ_AHEAD = 32;
+
+static Mutex cs_verifyDBStatus;
+static VerifyDBStatus verifyDBStatus GUARDED_BY(cs_verifyDBStatus);
+
+VerifyDBStatus GetVerifyDBStatus()
+{
+    LOCK(cs_verifyDBStatus);
+    return verifyDBStatus;
+}
+
+static void SetVerifyDBProgress(int nProgress, int nHeight)
+{
+    LOCK(cs_verifyDBStatus);
+    verifyDBStatus.nProgress = nProgress;
+    verifyDBStatus.nHeight = nHeight;
+}
+
+static bool FinishVerifyDB(bool fResult)
+{
+    LOCK(cs_verifyDBStatus);
+    verifyDBStatus.fRunning = false;
+    verifyDBStatus.nEndTime = GetTime();
+    verifyDBStatus.result = fResult;
+    return fResult;
+}
+
+/** A block verified by VerifyDB, read with its undo data by the checks that don't need cs_main */
+struct CVerifyDBRead
+{
+    CBlock block;
+    CBlockUndo blockUndo;
+    bool fHaveUndo{false};
+    //! The failure of the read or of the checks, if any
+    std::string strError;
+};
+
+static CVerifyDBRead ReadVerifyDBBlock(const FlatFilePos& pos, const FlatFilePos& posUndo, const uint256& hash,
+                                       const uint256& hashPrev, int nHeight, bool fCheckMerkleRoot, bool fReadUndo)
+{
+    CVerifyDBRead read;
+    // check level 0: read from disk
+    if (!ReadBlockFromDisk(read.block, pos) || read.block.GetHash() != hash) {
+        read.strError = strprintf("ReadBlockFromDisk failed at %d, hash=%s", nHeight, hash.ToString());
+        return read;
+    }
+    // check level 1: the merkle root (the rest of CheckBlock needs cs_main)
+    if (fCheckMerkleRoot) {
+        bool mutated;
+        if (read.block.hashMerkleRoot != BlockMerkleRoot(read.block, &mutated) || mutated) {
+            read.strError = strprintf("found bad block at %d, hash=%s (bad-txnmrklroot)", nHeight, hash.ToString());
+            return read;
+        }
+    }
+    // check level 2: verify undo validity (also used by the disconnection of level 3)
+    if (fReadUndo && !posUndo.IsNull()) {
+        if (!UndoReadFromDisk(read.blockUndo, posUndo, hashPrev)) {
+            read.strError = strprintf("found bad undo data at %d, hash=%s", nHeight, hash.ToString());
+            return read;
+        }
+        read.fHaveUndo = true;
+    }
+    return read;
+}
+
 CVerifyDB::CVerifyDB()
 {
     uiInterface.ShowProgress(_("Verifying blocks..."), 0);
@@ -3699,6 +4965,15 @@ bool CVerifyDB::VerifyDB(CCoinsView* coinsview, int nCheckLevel, int nCheckDepth
         nCheckDepth = chainHeight;
     nCheckLevel = std::max(0, std::min(4, nCheckLevel));
     LogPrintf("Verifying last %i blocks at level %i\n", nCheckDepth, nCheckLevel);
+    {
+        LOCK(cs_verifyDBStatus);
+        verifyDBStatus = VerifyDBStatus();
+        verifyDBStatus.fRunning = true;
+        verifyDBStatus.nCheckLevel = nCheckLevel;
+        verifyDBStatus.nCheckDepth = nCheckDepth;
+        verifyDBStatus.nHeight = chainHeight;
+        verifyDBStatus.nStartTime = GetTime();
+    }
     CCoinsViewCache coins(coinsview);
     CBlockIndex* pindexState = chainActive.Tip();
     CBlockIndex* pindexFailure = nullptr;
@@ -3706,7 +4981,36 @@ bool CVerifyDB::VerifyDB(CCoinsView* coinsview, int nCheckLevel, int nCheckDepth
     int reportDone = 0;
     LogPrintf("[0%%]...");
     CValidationState state;
+
+    // The blocks to verify
+    std::vector<CBlockIndex*> vpindex;
     for (CBlockIndex* pindex = chainActive.Tip(); pindex && pindex->pprev; pindex = pindex->pprev) {
+        if (pindex->nHeight < chainHeight - nCheckDepth)
+            break;
+        vpindex.push_back(pindex);
+    }
+
+    // The blocks are read, with the context-free checks, by a pool of threads (which can't take cs_main),
+    // up to VERIFYDB_READ_AHEAD blocks ahead of the checks below.
+    ctpl::thread_pool pool(std::max(1, std::min((int)vpindex.size(), VERIFYDB_READ_THREADS)));
+    RenameThreadPool(pool, "pivx-verifydb");
+    std::deque<std::future<CVerifyDBRead>> vReads;
+    const bool fCheckMerkleRoot = nCheckLevel >= 1;
+    const bool fReadUndo = nCheckLevel >= 2;
+    size_t nPushed = 0;
+    for (size_t i = 0; i < vpindex.size(); i++) {
+        for (; nPushed < vpindex.size() && nPushed < i + VERIFYDB_READ_AHEAD; nPushed++) {
+            const CBlockIndex* pindexRead = vpindex[nPushed];
+            const FlatFilePos pos = pindexRead->GetBlockPos();
+            const FlatFilePos posUndo = pindexRead->GetUndoPos();
+            const uint256 hash = pindexRead->GetBlockHash();
+            const uint256 hashPrev = pindexRead->pprev->GetBlockHash();
+            const int nHeight = pindexRead->nHeight;
+            vReads.emplace_back(pool.push([pos, posUndo, hash, hashPrev, nHeight, fCheckMerkleRoot, fReadUndo](int) {
+                return ReadVerifyDBBlock(pos, posUndo, hash, hashPrev, nHeight, fCheckMerkleRoot, fReadUndo);
+            }));
+        }
+        CBlockIndex* pindex = vpindex[i];
         boost::this_thread::interruption_point();
         int percentageDone = std::max(1, std::min(99, (int)(((double)(chainActive.Height() - pindex->nHeight)) / (double)nCheckDepth * (nCheckLevel >= 4 ? 50 : 100))));
         if (reportDone < percentageDone/10) {
@@ -3715,31 +5019,22 @@ bool CVerifyDB::VerifyDB(CCoinsView* coinsview, int nCheckLevel, int nCheckDepth
             reportDone = percentageDone/10;
         }
         uiInterface.ShowProgress(_("Verifying blocks..."), percentageDone);
-        if (pindex->nHeight < chainHeight - nCheckDepth)
-            break;
-        CBlock block;
-        // check level 0: read from disk
-        if (!ReadBlockFromDisk(block, pindex))
-            return error("%s: *** ReadBlockFromDisk failed at %d, hash=%s", __func__, pindex->nHeight, pindex->GetBlockHash().ToString());
-        // check level 1: verify block validity
-        if (nCheckLevel >= 1 && !CheckBlock(block, state))
-            return error("%s: *** found bad block at %d, hash=%s (%s)\n", __func__, pindex->nHeight, pindex->GetBlockHash().ToString(), FormatStateMessage(state));
-        // check level 2: verify undo validity
-        if (nCheckLevel >= 2 && pindex) {
-            CBlockUndo undo;
-            FlatFilePos pos = pindex->GetUndoPos();
-            if (!pos.IsNull()) {
-                if (!UndoReadFromDisk(undo, pos, pindex->pprev->GetBlockHash()))
-                    return error("%s: *** found bad undo data at %d, hash=%s\n", __func__, pindex->nHeight, pindex->GetBlockHash().ToString());
-            }
-        }
+        SetVerifyDBProgress(percentageDone, pindex->nHeight);
+        CVerifyDBRead read = vReads.front().get();
+        vReads.pop_front();
+        if (!read.strError.empty())
+            return FinishVerifyDB(error("%s: *** %s", __func__, read.strError));
+        CBlock& block = read.block;
+        // check level 1: verify block validity (the merkle root was checked with the read)
+        if (nCheckLevel >= 1 && !CheckBlock(block, state, true, false))
+            return FinishVerifyDB(error("%s: *** found bad block at %d, hash=%s (%s)\n", __func__, pindex->nHeight, pindex->GetBlockHash().ToString(), FormatStateMessage(state)));
         // check level 3: check for inconsistencies during memory-only disconnect of tip blocks
         if (nCheckLevel >= 3 && pindex == pindexState && (coins.DynamicMemoryUsage() + pcoinsTip->DynamicMemoryUsage()) <= nCoinCacheUsage) {
             assert(coins.GetBestBlock() == pindex->GetBlockHash());
-            DisconnectResult res = DisconnectBlock(block, pindex, coins);
+            DisconnectResult res = DisconnectBlock(block, pindex, coins, false, read.fHaveUndo ? &read.blockUndo : nullptr);
             if (res == DISCONNECT_FAILED) {
-                return error("%s: *** irrecoverable inconsistency in block data at %d, hash=%s", __func__,
-                             pindex->nHeight, pindex->GetBlockHash().ToString());
+                return FinishVerifyDB(error("%s: *** irrecoverable inconsistency in block data at %d, hash=%s", __func__,
+                                            pindex->nHeight, pindex->GetBlockHash().ToString()));
             }
             pindexState = pindex->pprev;
             if (res == DISCONNECT_UNCLEAN) {
@@ -3750,29 +5045,32 @@ bool CVerifyDB::VerifyDB(CCoinsView* coinsview, int nCheckLevel, int nCheckDepth
             }
         }
         if (ShutdownRequested())
-            return true;
+            return FinishVerifyDB(true);
     }
     if (pindexFailure)
-        return error("%s: *** coin database inconsistencies found (last %i blocks, %i good transactions before that)\n", __func__, chainHeight - pindexFailure->nHeight + 1, nGoodTransactions);
+        return FinishVerifyDB(error("%s: *** coin database inconsistencies found (last %i blocks, %i good transactions before that)\n", __func__, chainHeight - pindexFailure->nHeight + 1, nGoodTransactions));
 
     // check level 4: try reconnecting blocks
     if (nCheckLevel >= 4) {
         CBlockIndex* pindex = pindexState;
         while (pindex != chainActive.Tip()) {
             boost::this_thread::interruption_point();
-            uiInterface.ShowProgress(_("Verifying blocks..."), std::max(1, std::min(99, 100 - (int)(((double)(chainHeight - pindex->nHeight)) / (double)nCheckDepth * 50))));
+            const int percentageDone = std::max(1, std::min(99, 100 - (int)(((double)(chainHeight - pindex->nHeight)) / (double)nCheckDepth * 50)));
+            uiInterface.ShowProgress(_("Verifying blocks..."), percentageDone);
             pindex = chainActive.Next(pindex);
+            SetVerifyDBProgress(percentageDone, pindex->nHeight);
             CBlock block;
             if (!ReadBlockFromDisk(block, pindex))
-                return error("%s: *** ReadBlockFromDisk failed at %d, hash=%s", __func__, pindex->nHeight, pindex->GetBlockHash().ToString());
+                return FinishVerifyDB(error("%s: *** ReadBlockFromDisk failed at %d, hash=%s", __func__, pindex->nHeight, pindex->GetBlockHash().ToString()));
             if (!ConnectBlock(block, state, pindex, coins, false))
-                return error("%s: *** found unconnectable block at %d, hash=%s", __func__, pindex->nHeight, pindex->GetBlockHash().ToString());
+                return FinishVerifyDB(error("%s: *** found unconnectable block at %d, hash=%s", __func__, pindex->nHeight, pindex->GetBlockHash().ToString()));
         }
     }
     LogPrintf("[DONE].\n");
     LogPrintf("No coin database inconsistencies in last %i blocks (%i transactions)\n", chainHeight - pindexState->nHeight, nGoodTransactions);
+    SetVerifyDBProgress(100, chainHeight);
 
-    return true;
+    return FinishVerifyDB(true);
 }
 
 /** Apply the effects of a block on the utxo cache, ignoring that it may already have been applied. */
@@ -3880,18 +5178,27 @@ bool ReplayBlocks(const CChainParams& params, CCoinsView* view)
 void UnloadBlockIndex()
 {
     LOCK(cs_main);
+    FinishCoinsFlush(true);
     setBlockIndexCandidates.clear();
     chainActive.SetTip(nullptr);
+    PublishChainTipSnapshot(nullptr);
     pindexBestInvalid = nullptr;
     pindexBestHeader = nullptr;
+    nBestHeaderHeight = -1;
     mempool.clear();
     mapBlocksUnlinked.clear();
+    mapBlockOutpoints.clear();
+    dequeBlockOutpoints.clear();
+    mapRecentlySpentCoins.clear();
+    mapRecentlySpentByHeight.clear();
     vinfoBlockFile.clear();
     nLastBlockFile = 0;
+    if (blockFileMappings) blockFileMappings->Clear();
     nBlockSequenceId = 1;
     setDirtyBlockIndex.clear();
     setDirtyFileInfo.clear();
 
+    boost::unique_lock<boost::shared_mutex> lockIndex(g_block_index_mutex);
     for (BlockMap::value_type& entry : mapBlockIndex) {
         delete entry.second;
     }
@@ -3917,9 +5224,12 @@ bool LoadBlockIndex(std::string& strError)
         // needs_init.
 
         LogPrintf("Initializing databases...\n");
-        // Use the provided setting for -txindex in the new database
-        fTxIndex = gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX);
-        pblocktree->WriteFlag("txindex", fTxIndex);
+        // Use the provided setting for -addressindex in the new database
+        fAddressIndex = gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
+        pblocktree->WriteFlag("addressindex", fAddressIndex);
+        // Use the provided setting for -spentindex in the new database
+        fSpentIndex = gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
+        pblocktree->WriteFlag("spentindex", fSpentIndex);
     }
     return true;
 }
@@ -3946,7 +5256,7 @@ bool LoadGenesisBlock()
             return error("%s: FindBlockPos failed", __func__);
         if (!WriteBlockToDisk(block, blockPos))
             return error("%s: writing genesis block to disk failed", __func__);
-        CBlockIndex *pindex = AddToBlockIndex(block);
+        CBlockIndex *pindex = AddToBlockIndex(block, block.GetHash());
         if (!ReceivedBlockTransactions(block, state, pindex, blockPos))
             return error("%s: genesis block not accepted", __func__);
     } catch (const std::runtime_error& e) {
@@ -3957,10 +5267,114 @@ bool LoadGenesisBlock()
 }
 
 
+// Map of disk positions for blocks with unknown parent (only used for reindex)
+static std::multimap<uint256, FlatFilePos> mapBlocksUnknownParent;
+
+/**
+ * Reads the next block of a block file, skipping the bytes that don't start a block.
+ * Returns false at the end of the file.
+ */
+static bool ReadNextFileBlock(CBufferedFile& blkdat, uint64_t& nRewind, CBlock& block, uint64_t& nBlockPos)
+{
+    while (!blkdat.eof()) {
+        blkdat.SetPos(nRewind);
+        nRewind++;         // start one byte further next time, in case of failure
+        blkdat.SetLimit(); // remove former limit
+        unsigned int nSize = 0;
+        try {
+            // locate a header
+            unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
+            blkdat.FindByte(Params().MessageStart()[0]);
+            nRewind = blkdat.GetPos()+1;
+            blkdat >> buf;
+            if (memcmp(buf, Params().MessageStart(), CMessageHeader::MESSAGE_START_SIZE))
+                continue;
+            // read size
+            blkdat >> nSize;
+            if (nSize < 80 || nSize > MAX_BLOCK_SIZE_CURRENT)
+                continue;
+        } catch (const std::exception&) {
+            // no valid block header found; don't complain
+            return false;
+        }
+        try {
+            // read block
+            nBlockPos = blkdat.GetPos();
+            blkdat.SetLimit(nBlockPos + nSize);
+            blkdat.SetPos(nBlockPos);
+            blkdat >> block;
+            nRewind = blkdat.GetPos();
+            return true;
+        } catch (const std::exception& e) {
+            LogPrintf("%s : Deserialize or I/O error - %s", __func__, e.what());
+        }
+    }
+    return false;
+}
+
+/**
+ * Processes a block read from a block file, and then the blocks of mapBlocksUnknownParent that
+ * descend from it. Returns false if the block was invalid, to stop the import of the file.
+ */
+static bool ProcessFileBlock(const std::shared_ptr<const CBlock>& pblock, const uint256& hash, FlatFilePos* dbp,
+                             BlockStateCatcherWrapper& stateCatcher, int& nLoaded)
+{
+    CBlockIndex* pindex{nullptr};
+    {
+        LOCK(cs_main);
+        // detect out of order blocks, and store them for later
+        if (hash != Params().GetConsensus().hashGenesisBlock && !LookupBlockIndex(pblock->hashPrevBlock)) {
+            LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__,
+                    hash.ToString(), pblock->hashPrevBlock.ToString());
+            if (dbp)
+                mapBlocksUnknownParent.emplace(pblock->hashPrevBlock, *dbp);
+            return true;
+        }
+
+        pindex = LookupBlockIndex(hash);
+    }
+
+    // process in case the block isn't known yet
+    if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0) {
+        stateCatcher.get().setBlockHash(hash);
+        if (ProcessNewBlock(pblock, dbp)) {
+            nLoaded++;
+        }
+        if (stateCatcher.get().stateErrorFound()) {
+            return false;
+        }
+    } else if (hash != Params().GetConsensus().hashGenesisBlock && pindex->nHeight % 1000 == 0) {
+        LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), pindex->nHeight);
+    }
+
+    // Recursively process earlier encountered successors of this block
+    std::deque<uint256> queue;
+    queue.push_back(hash);
+    while (!queue.empty()) {
+        uint256 head = queue.front();
+        queue.pop_front();
+        std::pair<std::multimap<uint256, FlatFilePos>::iterator, std::multimap<uint256, FlatFilePos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
+        while (range.first != range.second) {
+            std::multimap<uint256, FlatFilePos>::iterator it = range.first;
+            CBlock block;
+            if (ReadBlockFromDisk(block, it->second)) {
+                LogPrint(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, block.GetHash().ToString(),
+                    head.ToString());
+                std::shared_ptr<const CBlock> block_ptr = std::make_shared<const CBlock>(block);
+                if (ProcessNewBlock(block_ptr, &it->second)) {
+                    nLoaded++;
+                    queue.emplace_back(block.GetHash());
+                }
+            }
+            range.first++;
+            mapBlocksUnknownParent.erase(it);
+        }
+    }
+    return true;
+}
+
 bool LoadExternalBlockFile(FILE* fileIn, FlatFilePos* dbp)
 {
-    // Map of disk positions for blocks with unknown parent (only used for reindex)
-    static std::multimap<uint256, FlatFilePos> mapBlocksUnknownParent;
     int64_t nStart = GetTimeMillis();
 
     // Block checked event listener
@@ -3972,92 +5386,18 @@ bool LoadExternalBlockFile(FILE* fileIn, FlatFilePos* dbp)
         // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
         CBufferedFile blkdat(fileIn, 2 * MAX_BLOCK_SIZE_CURRENT, MAX_BLOCK_SIZE_CURRENT + 8, SER_DISK, CLIENT_VERSION);
         uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof()) {
+        CBlock block;
+        uint64_t nBlockPos;
+        while (true) {
             boost::this_thread::interruption_point();
-
-            blkdat.SetPos(nRewind);
-            nRewind++;         // start one byte further next time, in case of failure
-            blkdat.SetLimit(); // remove former limit
-            unsigned int nSize = 0;
-            try {
-                // locate a header
-                unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
-                blkdat.FindByte(Params().MessageStart()[0]);
-                nRewind = blkdat.GetPos()+1;
-                blkdat >> buf;
-                if (memcmp(buf, Params().MessageStart(), CMessageHeader::MESSAGE_START_SIZE))
-                    continue;
-                // read size
-                blkdat >> nSize;
-                if (nSize < 80 || nSize > MAX_BLOCK_SIZE_CURRENT)
-                    continue;
-            } catch (const std::exception&) {
-                // no valid block header found; don't complain
+            if (!ReadNextFileBlock(blkdat, nRewind, block, nBlockPos))
                 break;
-            }
+            if (dbp)
+                dbp->nPos = nBlockPos;
             try {
-                // read block
-                uint64_t nBlockPos = blkdat.GetPos();
-                if (dbp)
-                    dbp->nPos = nBlockPos;
-                blkdat.SetLimit(nBlockPos + nSize);
-                blkdat.SetPos(nBlockPos);
-                CBlock block;
-                blkdat >> block;
-                nRewind = blkdat.GetPos();
-
-                uint256 hash = block.GetHash();
-                CBlockIndex* pindex{nullptr};
-                {
-                    LOCK(cs_main);
-                    // detect out of order blocks, and store them for later
-                    if (hash != Params().GetConsensus().hashGenesisBlock && !LookupBlockIndex(block.hashPrevBlock)) {
-                        LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__,
-                                hash.ToString(), block.hashPrevBlock.ToString());
-                        if (dbp)
-                            mapBlocksUnknownParent.emplace(block.hashPrevBlock, *dbp);
-                        continue;
-                    }
-
-                    pindex = LookupBlockIndex(hash);
-                }
-
-                // process in case the block isn't known yet
-                if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0) {
-                    std::shared_ptr<const CBlock> block_ptr = std::make_shared<const CBlock>(block);
-                    stateCatcher.get().setBlockHash(block_ptr->GetHash());
-                    if (ProcessNewBlock(block_ptr, dbp)) {
-                        nLoaded++;
-                    }
-                    if (stateCatcher.get().stateErrorFound()) {
-                        break;
-                    }
-                } else if (hash != Params().GetConsensus().hashGenesisBlock && pindex->nHeight % 1000 == 0) {
-                    LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), pindex->nHeight);
-                }
-
-                // Recursively process earlier encountered successors of this block
-                std::deque<uint256> queue;
-                queue.push_back(hash);
-                while (!queue.empty()) {
-                    uint256 head = queue.front();
-                    queue.pop_front();
-                    std::pair<std::multimap<uint256, FlatFilePos>::iterator, std::multimap<uint256, FlatFilePos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
-                    while (range.first != range.second) {
-                        std::multimap<uint256, FlatFilePos>::iterator it = range.first;
-                        if (ReadBlockFromDisk(block, it->second)) {
-                            LogPrint(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, block.GetHash().ToString(),
-                                head.ToString());
-                            std::shared_ptr<const CBlock> block_ptr = std::make_shared<const CBlock>(block);
-                            if (ProcessNewBlock(block_ptr, &it->second)) {
-                                nLoaded++;
-                                queue.emplace_back(block.GetHash());
-                            }
-                        }
-                        range.first++;
-                        mapBlocksUnknownParent.erase(it);
-                    }
-                }
+                std::shared_ptr<const CBlock> block_ptr = std::make_shared<const CBlock>(block);
+                if (!ProcessFileBlock(block_ptr, block_ptr->GetHash(), dbp, stateCatcher, nLoaded))
+                    break;
             } catch (const std::exception& e) {
                 LogPrintf("%s : Deserialize or I/O error - %s", __func__, e.what());
             }
@@ -4070,6 +5410,89 @@ bool LoadExternalBlockFile(FILE* fileIn, FlatFilePos* dbp)
     return nLoaded > 0;
 }
 
+namespace {
+/** A block of a block file, with its hash and position, parsed ahead of its connection by the reindex */
+struct ScannedBlock
+{
+    std::shared_ptr<const CBlock> block;
+    uint256 hash;
+    FlatFilePos pos;
+};
+}
+
+/**
+ * Finds and deserializes the blocks of the block file nFile, and computes their hashes.
+ * Returns nullptr if the file couldn't be opened.
+ */
+static std::unique_ptr<std::vector<ScannedBlock>> ScanBlockFile(int nFile)
+{
+    FILE* file = OpenBlockFile(FlatFilePos(nFile, 0), true);
+    if (!file)
+        return nullptr; // This error is logged in OpenBlockFile
+    auto vBlocks = std::make_unique<std::vector<ScannedBlock>>();
+    try {
+        // This takes over file and calls fclose() on it in the CBufferedFile destructor
+        CBufferedFile blkdat(file, 2 * MAX_BLOCK_SIZE_CURRENT, MAX_BLOCK_SIZE_CURRENT + 8, SER_DISK, CLIENT_VERSION);
+        uint64_t nRewind = blkdat.GetPos();
+        CBlock block;
+        uint64_t nBlockPos;
+        while (!ShutdownRequested() && ReadNextFileBlock(blkdat, nRewind, block, nBlockPos)) {
+            auto block_ptr = std::make_shared<const CBlock>(std::move(block));
+            block = CBlock();
+            vBlocks->push_back({block_ptr, block_ptr->GetHash(), FlatFilePos(nFile, nBlockPos)});
+        }
+    } catch (const std::runtime_error& e) {
+        AbortNode(std::string("System error: ") + e.what());
+    }
+    return vBlocks;
+}
+
+void ReindexBlockFiles()
+{
+    int nFiles = 0;
+    while (fs::exists(GetBlockPosFilename(FlatFilePos(nFiles, 0))))
+        nFiles++;
+
+    // The blocks are connected in the order of the files by this thread, while the next files are
+    // scanned by the pool. Each scanned file stays in memory until connected, so only a few are
+    // scanned ahead: the connection is the bottleneck anyway.
+    const int nThreads = std::max(1, std::min(GetNumCores() - 1, MAX_REINDEX_SCAN_THREADS));
+    ctpl::thread_pool pool(nThreads);
+    std::deque<std::future<std::unique_ptr<std::vector<ScannedBlock>>>> scans;
+    int nNextScan = 0;
+
+    // Block checked event listener
+    BlockStateCatcherWrapper stateCatcher(UINT256_ZERO);
+    stateCatcher.registerEvent();
+
+    for (int nFile = 0; nFile < nFiles; nFile++) {
+        for (; nNextScan < nFiles && (int)scans.size() < nThreads; nNextScan++) {
+            scans.emplace_back(pool.push([nNextScan](int) { return ScanBlockFile(nNextScan); }));
+        }
+        std::unique_ptr<std::vector<ScannedBlock>> vBlocks = scans.front().get();
+        scans.pop_front();
+        if (!vBlocks)
+            break;
+        LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)nFile);
+        int64_t nStart = GetTimeMillis();
+        int nLoaded = 0;
+        for (ScannedBlock& scanned : *vBlocks) {
+            boost::this_thread::interruption_point();
+            try {
+                if (!ProcessFileBlock(scanned.block, scanned.hash, &scanned.pos, stateCatcher, nLoaded))
+                    break;
+            } catch (const std::exception& e) {
+                LogPrintf("%s : Deserialize or I/O error - %s", __func__, e.what());
+            }
+            scanned.block.reset();
+        }
+        if (nLoaded > 0)
+            LogPrintf("Loaded %i blocks from block file in %dms\n", nLoaded, GetTimeMillis() - nStart);
+    }
+    // Don't wait for the scans of the files that won't be connected
+    pool.stop(false);
+}
+
 void static CheckBlockIndex()
 {
     if (!fCheckBlockIndex) {
@@ -4240,7 +5663,9 @@ CBlockFileInfo* GetBlockFileInfo(size_t n)
     return &vinfoBlockFile.at(n);
 }
 
-static const uint64_t MEMPOOL_DUMP_VERSION = 1;
+// Version 2 records the tip and the script flags the transactions were validated with, after the version
+static const uint64_t MEMPOOL_DUMP_VERSION = 2;
+static const uint64_t MEMPOOL_DUMP_VERSION_NO_TIP = 1;
 
 bool LoadMempool(CTxMemPool& pool)
 {
@@ -4260,11 +5685,28 @@ bool LoadMempool(CTxMemPool& pool)
     try {
         uint64_t version;
         file >> version;
-        if (version != MEMPOOL_DUMP_VERSION) {
+        if (version != MEMPOOL_DUMP_VERSION && version != MEMPOOL_DUMP_VERSION_NO_TIP) {
             return false;
         }
+        // While the tip and the script flags are the ones the transactions were validated with, their
+        // scripts and proofs are not verified again. All the other checks still run.
+        uint256 hashTip;
+        uint32_t nScriptFlags = 0;
+        if (version == MEMPOOL_DUMP_VERSION) {
+            file >> hashTip;
+            file >> nScriptFlags;
+        }
+        auto isValidatedAtTip = [&hashTip, nScriptFlags]() EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
+            return !hashTip.IsNull() && chainActive.Tip() && chainActive.Tip()->GetBlockHash() == hashTip &&
+                   GetMempoolScriptFlags(chainActive.Height()) == nScriptFlags;
+        };
+        if (WITH_LOCK(cs_main, return isValidatedAtTip(); )) {
+            LogPrintf("Loading mempool validated at the current tip\n");
+        }
         uint64_t num;
         file >> num;
+        // The transactions were dumped with their parents first
+        CTxMemPool::BatchInsertion batch(pool);
         while (num--) {
             CTransactionRef tx;
             int64_t nTime;
@@ -4280,7 +5722,7 @@ bool LoadMempool(CTxMemPool& pool)
             CValidationState state;
             if (nTime + nExpiryTimeout > nNow) {
                 LOCK(cs_main);
-                AcceptToMemoryPoolWithTime(pool, state, tx, true, nullptr, nTime);
+                AcceptToMemoryPoolWithTime(pool, state, tx, true, nullptr, nTime, false, false, false, isValidatedAtTip());
                 if (state.IsValid()) {
                     ++count;
                 } else {
@@ -4314,15 +5756,23 @@ bool DumpMempool(const CTxMemPool& pool)
     std::map<uint256, CAmount> mapDeltas;
     std::vector<TxMempoolInfo> vinfo;
 
+    uint256 hashTip;
+    uint32_t nScriptFlags = 0;
+
     static Mutex dump_mutex;
     LOCK(dump_mutex);
 
     {
-        LOCK(pool.cs);
+        // The mempool is consistent with the tip when both are locked
+        LOCK2(cs_main, pool.cs);
         for (const auto &i : pool.mapDeltas) {
             mapDeltas[i.first] = i.second;
         }
         vinfo = pool.infoAll();
+        if (chainActive.Tip()) {
+            hashTip = chainActive.Tip()->GetBlockHash();
+            nScriptFlags = GetMempoolScriptFlags(chainActive.Height());
+        }
     }
 
     int64_t mid = GetTimeMicros();
@@ -4337,6 +5787,8 @@ bool DumpMempool(const CTxMemPool& pool)
 
         uint64_t version = MEMPOOL_DUMP_VERSION;
         file << version;
+        file << hashTip;
+        file << nScriptFlags;
 
         file << (uint64_t)vinfo.size();
         for (const auto& i : vinfo) {
@@ -4362,6 +5814,109 @@ bool DumpMempool(const CTxMemPool& pool)
     return true;
 }
 
+static const uint64_t COINS_CACHE_DUMP_VERSION = 1;
+//! Maximum number of outpoints dumped by DumpCoinsCache
+static const size_t MAX_COINS_CACHE_DUMP = 2000000;
+//! Number of coins read by LoadCoinsCache between the inserts into the cache
+static const size_t COINS_CACHE_LOAD_BATCH = 1000;
+
+bool DumpCoinsCache()
+{
+    int64_t start = GetTimeMicros();
+
+    std::vector<COutPoint> vOutpoints;
+    uint256 hashBest;
+    {
+        LOCK(cs_main);
+        if (!pcoinsTip) return false;
+        pcoinsTip->GetCachedOutpoints(vOutpoints, MAX_COINS_CACHE_DUMP);
+        hashBest = pcoinsTip->GetBestBlock();
+    }
+    // Keep the last dump if the node stopped before using the cache
+    if (vOutpoints.empty()) {
+        return false;
+    }
+
+    int64_t mid = GetTimeMicros();
+
+    try {
+        FILE* filestr = fsbridge::fopen(GetDataDir() / "coinscache.dat.new", "wb");
+        if (!filestr) {
+            return false;
+        }
+
+        CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+        file << COINS_CACHE_DUMP_VERSION;
+        file << hashBest;
+        file << vOutpoints;
+        if (!FileCommit(file.Get()))
+            throw std::runtime_error("FileCommit failed");
+        file.fclose();
+        if (!RenameOver(GetDataDir() / "coinscache.dat.new", GetDataDir() / "coinscache.dat")) {
+            throw std::runtime_error("Rename failed");
+        }
+        int64_t last = GetTimeMicros();
+        LogPrintf("Dumped %u outpoints of the coins cache: %gs to copy, %gs to dump\n", vOutpoints.size(), (mid-start)*0.000001, (last-mid)*0.000001);
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to dump the coins cache: %s. Continuing anyway.\n", e.what());
+        return false;
+    }
+    return true;
+}
+
+bool LoadCoinsCache()
+{
+    AssertLockNotHeld(cs_main);
+    int64_t start = GetTimeMicros();
+    CAutoFile file(fsbridge::fopen(GetDataDir() / "coinscache.dat", "rb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        LogPrintf("Failed to open the coins cache file from disk. Continuing anyway.\n");
+        return false;
+    }
+
+    std::vector<COutPoint> vOutpoints;
+    try {
+        uint64_t version;
+        file >> version;
+        if (version != COINS_CACHE_DUMP_VERSION) {
+            return false;
+        }
+        // The outpoints spent since the dump (if the node ran without it) are just missing from the database
+        uint256 hashBest;
+        file >> hashBest;
+        file >> vOutpoints;
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to deserialize the coins cache data on disk: %s. Continuing anyway.\n", e.what());
+        return false;
+    }
+
+    size_t nLoaded = 0;
+    for (size_t nPos = 0; nPos < vOutpoints.size(); nPos += COINS_CACHE_LOAD_BATCH) {
+        if (ShutdownRequested()) return false;
+        PrefetchedCoins prefetched;
+        {
+            LOCK(cs_main);
+            // Leave the room of the cache to the blocks, and skip the reads while the database is behind it
+            if (!pcoinsTip || pcoinsTip->DynamicMemoryUsage() > nCoinCacheUsage / 2) break;
+            if (pcoinsFlushing || !pcoinsdbview) continue;
+            prefetched.nCoinsDBWriteSeq = nCoinsDBWriteSeq;
+            for (size_t i = nPos; i < std::min(nPos + COINS_CACHE_LOAD_BATCH, vOutpoints.size()); i++) {
+                if (!pcoinsTip->HaveCoinInCache(vOutpoints[i])) prefetched.vOutpoints.emplace_back(vOutpoints[i]);
+            }
+        }
+        prefetched.vCoins.resize(prefetched.vOutpoints.size());
+        for (size_t i = 0; i < prefetched.vOutpoints.size(); i++) {
+            CCoinPrefetchCheck(pcoinsdbview.get(), &prefetched.vOutpoints[i], &prefetched.vCoins[i])();
+            if (!prefetched.vCoins[i].IsSpent()) nLoaded++;
+        }
+        LOCK(cs_main);
+        CachePrefetchedCoins(prefetched);
+    }
+
+    LogPrintf("Loaded %u of the %u outpoints of the coins cache from disk in %gs\n", nLoaded, vOutpoints.size(), (GetTimeMicros() - start) * 0.000001);
+    return true;
+}
+
 class CMainCleanup
 {
 public:
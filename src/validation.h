@@ -40,6 +40,7 @@
 class AccumulatorCache;
 class CBlockIndex;
 class CBlockTreeDB;
+class CBlockUndo;
 class CBudgetManager;
 class CCoinsViewDB;
 class CZerocoinDB;
@@ -60,6 +61,8 @@ static const unsigned int DEFAULT_ANCESTOR_SIZE_LIMIT = 101;
 static const int DEFAULT_BANSCORE_THRESHOLD = 100;
 /** Default for -persistmempool */
 static const bool DEFAULT_PERSIST_MEMPOOL = true;
+/** Default for -persistcoinscache */
+static const bool DEFAULT_PERSIST_COINS_CACHE = true;
 /** Default for -limitdescendantcount, max number of in-mempool descendants */
 static const unsigned int DEFAULT_DESCENDANT_LIMIT = 25;
 /** Default for -limitdescendantsize, maximum kilobytes of in-mempool descendants */
@@ -87,8 +90,16 @@ static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 static const int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
-/** Number of blocks that can be requested at any given time from a single peer. */
-static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
+/** Number of blocks that can be requested at any given time from a single peer, before its download speed is measured. */
+static const int DEFAULT_BLOCKS_IN_TRANSIT_PER_PEER = 16;
+/** Bounds of the number of blocks that can be requested at any given time from a single peer, sized from its speed. */
+static const int MIN_BLOCKS_IN_TRANSIT_PER_PEER = 2;
+static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 64;
+/** Time (in microseconds) the blocks in flight from a peer should keep it busy for, on top of its round trip. */
+static const int64_t BLOCK_DOWNLOAD_BUSY_TIME = 1000000;
+/** The block holding back our chain is requested again from a peer at least this many times faster than the one it
+ *  has been in flight from for more than BLOCK_STALLING_TIMEOUT. */
+static const int BLOCK_REREQUEST_SPEED_RATIO = 2;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
 static const unsigned int BLOCK_STALLING_TIMEOUT = 2;
 /** Number of headers sent in one getheaders result. We rely on the assumption that if a peer sends
@@ -103,6 +114,13 @@ static const unsigned int BLOCK_DOWNLOAD_WINDOW = 1024;
 static const unsigned int DATABASE_WRITE_INTERVAL = 60 * 60;
 /** Time to wait (in seconds) between flushing chainstate to disk. */
 static const unsigned int DATABASE_FLUSH_INTERVAL = 24 * 60 * 60;
+/** Default for -backgroundflush, write the periodic chainstate flushes on a background thread. */
+static const bool DEFAULT_BACKGROUND_FLUSH = true;
+/** Default and max. for -blocksmmap, the number of block files kept memory mapped for the reads (0 = none) */
+static const int DEFAULT_BLOCKS_MMAP = 0;
+static const int MAX_BLOCKS_MMAP = sizeof(void*) > 4 ? 1024 : 4;
+/** Maximum number of threads scanning the block files ahead of their connection during -reindex */
+static const int MAX_REINDEX_SCAN_THREADS = 3;
 /** Average delay between local address broadcasts */
 static constexpr std::chrono::hours AVG_LOCAL_ADDRESS_BROADCAST_INTERVAL{24};
 /** Average delay between peer address broadcasts */
@@ -127,6 +145,8 @@ typedef std::unordered_map<uint256, CBlockIndex*, BlockHasher> BlockMap;
 typedef std::unordered_multimap<uint256, CBlockIndex*, BlockHasher> PrevBlockMap;
 extern BlockMap mapBlockIndex;
 extern PrevBlockMap mapPrevBlockIndex;
+/** Estimated memory usage of mapBlockIndex, of its entries and of mapPrevBlockIndex */
+size_t GetBlockIndexMemoryUsage() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 extern uint64_t nLastBlockTx;
 extern uint64_t nLastBlockSize;
 
@@ -140,8 +160,12 @@ extern std::atomic<bool> fImporting;
 extern std::atomic<bool> fReindex;
 extern int nScriptCheckThreads;
 extern bool fTxIndex;
+extern bool fAddressIndex;
+extern bool fSpentIndex;
 extern bool fRequireStandard;
 extern bool fCheckBlockIndex;
+/** Block hash whose ancestors we will assume to have valid scripts and proofs without checking them. */
+extern uint256 hashAssumeValid;
 extern size_t nCoinCacheUsage;
 extern CFeeRate minRelayTxFee;
 extern int64_t nMaxTipAge;
@@ -152,9 +176,86 @@ extern bool fLargeWorkInvalidChainFound;
 extern std::map<uint256, int64_t> mapRejectedBlocks;
 
 extern CMoneySupply MoneySupply;
+/**
+ * Load the money supply stored with the best block of the chainstate or, with fAudit (or when it isn't stored),
+ * sum the UTXO set, logging its difference with the tracked supply. pcoinsTip must be flushed.
+ */
+void LoadMoneySupply(bool fAudit) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
 /** Best header we've seen so far (used for getheaders queries' starting points). */
 extern CBlockIndex* pindexBestHeader;
+/** Height of pindexBestHeader (-1 when unset), which can be read without cs_main. */
+extern std::atomic<int> nBestHeaderHeight;
+
+/**
+ * Immutable copy of the state of the chain tip, published on each tip change, so that
+ * it can be read (e.g. by the RPC commands) without cs_main.
+ */
+struct ChainTipSnapshot
+{
+    //! The tip itself, for the immutable data of its chain (verification progress, versions of the ancestors).
+    //! The block index entries are only released by UnloadBlockIndex, before the RPC warmup ends.
+    const CBlockIndex* pindex;
+    int nHeight;
+    uint256 hash;
+    int64_t nTime;
+    uint32_t nBits;
+    arith_uint256 nChainWork;
+    Optional<CAmount> nChainSaplingValue;
+    Optional<CAmount> nSaplingValue;
+
+    explicit ChainTipSnapshot(const CBlockIndex& tip) :
+        pindex(&tip),
+        nHeight(tip.nHeight),
+        hash(tip.GetBlockHash()),
+        nTime(tip.GetBlockTime()),
+        nBits(tip.nBits),
+        nChainWork(tip.nChainWork),
+        nChainSaplingValue(tip.nChainSaplingValue),
+        nSaplingValue(tip.nSaplingValue)
+    {}
+};
+
+/** The snapshot of the current chain tip, nullptr when there is no tip yet. Doesn't lock cs_main. */
+std::shared_ptr<const ChainTipSnapshot> GetChainTipSnapshot();
+
+/** Stages of the connection of a block to the tip, timed for getblockprocessingstats */
+enum class BlockStage {
+    LOAD_BLOCK,         // read of the block from disk (ConnectTip)
+    CONNECT_TXS,        // inputs and outputs of the transactions (ConnectBlock)
+    VERIFY_SCRIPTS,     // wait for the script checks (ConnectBlock)
+    SPECIAL_TXS,        // ProcessSpecialTxsInBlock, with the two following stages
+    LLMQ,               // quorum commitments (CQuorumBlockProcessor::ProcessBlock)
+    DETERMINISTIC_MNS,  // masternode list (CDeterministicMNManager::ProcessBlock)
+    INDEX_WRITING,      // optional indexes (ConnectBlock)
+    CONNECT_BLOCK,      // all of ConnectBlock
+    FLUSH_VIEW,         // flush of the block's coins and evo db transaction
+    WRITE_CHAINSTATE,   // FlushStateToDisk
+    POSTPROCESS,        // mempool, tip and tier two updates
+    CONNECT_TIP,        // all of ConnectTip
+    SHIELDED_PROOFS,    // Sapling proofs and public zerocoin spends of a block (ContextualCheckBlock)
+    COUNT
+};
+
+/** Histogram of the durations (in microseconds) of a stage */
+struct BlockStageTimes
+{
+    //! one bucket for each upper bound of BLOCK_STAGE_BUCKET_BOUNDS, plus one for the durations above the last one
+    std::vector<uint64_t> buckets;
+    uint64_t nCount{0};
+    int64_t nTotal{0};
+    int64_t nMax{0};
+
+    BlockStageTimes();
+    void Add(int64_t nTime);
+};
+
+extern const std::vector<int64_t> BLOCK_STAGE_BUCKET_BOUNDS;
+
+/** Record the duration of a stage of the connection of a block */
+void AddBlockStageTime(BlockStage stage, int64_t nTime);
+/** The times of each stage, by name, in the order of BlockStage */
+std::vector<std::pair<std::string, BlockStageTimes>> GetBlockProcessingStats();
 
 /**
  * Process an incoming block. This only returns after the best known valid
@@ -180,8 +281,12 @@ FILE* OpenBlockFile(const FlatFilePos& pos, bool fReadOnly = false);
 FILE* OpenUndoFile(const FlatFilePos& pos, bool fReadOnly = false);
 /** Translation to a filesystem path */
 fs::path GetBlockPosFilename(const FlatFilePos &pos);
+/** Reads the blocks of the block files that aren't written anymore from memory mappings of nMaxFiles of them (-blocksmmap) */
+void InitBlockFileMappings(int nMaxFiles);
 /** Import blocks from an external file */
 bool LoadExternalBlockFile(FILE* fileIn, FlatFilePos* dbp = nullptr);
+/** Reindex the blocks of the block files, scanning the next files in parallel while the blocks are connected (-reindex) */
+void ReindexBlockFiles();
 /** Ensures we have a genesis block in the block tree, possibly writing one to disk. */
 bool LoadGenesisBlock();
 /** Load the block tree and coins database from disk,
@@ -195,11 +300,24 @@ void UnloadBlockIndex();
 int ActiveProtocol();
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the sapling proofs checking thread */
+void ThreadSaplingCheck();
+/** Run an instance of the public zerocoin spends checking thread */
+void ThreadZerocoinCheck();
+/** Run an instance of the headers hashing thread */
+void ThreadHeaderHashCheck();
+/** Run an instance of the block transactions checking thread */
+void ThreadTxCheck();
+/** Run an instance of the coins prefetching thread */
+void ThreadCoinPrefetch();
 
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
 /** Retrieve a transaction (from memory pool, or from disk, if possible) */
 bool GetTransaction(const uint256& hash, CTransactionRef& tx, uint256& hashBlock, bool fAllowSlow = false, CBlockIndex* blockIndex = nullptr);
+/** Find a coin spent by one of the last blocks connected to the active chain, without disk access.
+ * These are the stake inputs of the fork blocks that were spent on the active chain after the split. */
+bool GetRecentlySpentCoin(const COutPoint& outpoint, Coin& coin);
 /** Retrieve an output (from memory pool, or from disk, if possible) */
 bool GetOutput(const uint256& hash, unsigned int index, CValidationState& state, CTxOut& out);
 
@@ -216,15 +334,23 @@ CBlockIndex* InsertBlockIndex(const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_m
 void FlushStateToDisk();
 
 
+/** Minimum number of inputs of a transaction for AcceptToMemoryPool to verify its scripts in parallel */
+static const unsigned int MIN_PARALLEL_SCRIPT_CHECK_INPUTS = 16;
+
 /** (try to) add transaction to memory pool **/
 bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransactionRef& tx, bool fLimitFree,
                         bool* pfMissingInputs, bool fOverrideMempoolLimit = false,
                         bool fRejectInsaneFee = false, bool ignoreFees = false) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
-/** (try to) add transaction to memory pool with a specified acceptance time **/
+/** (try to) add transaction to memory pool with a specified acceptance time.
+ * With fAlreadyValidated, the scripts and the Sapling proofs are not verified again (the transaction was accepted
+ * in the mempool at the current tip with the same script flags, before a restart) **/
 bool AcceptToMemoryPoolWithTime(CTxMemPool& pool, CValidationState &state, const CTransactionRef &tx, bool fLimitFree,
                                 bool* pfMissingInputs, int64_t nAcceptTime, bool fOverrideMempoolLimit = false,
-                                bool fRejectInsaneFee = false, bool ignoreFees = false) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+                                bool fRejectInsaneFee = false, bool ignoreFees = false, bool fAlreadyValidated = false) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+/** Expire the pool entries older than age (in seconds), and trim it to the limit (in bytes) */
+void LimitMempoolSize(CTxMemPool& pool, size_t limit, unsigned long age) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
 CAmount GetMinRelayFee(const CTransaction& tx, const CTxMemPool& pool, unsigned int nBytes);
 CAmount GetMinRelayFee(unsigned int nBytes);
@@ -245,12 +371,17 @@ CAmount GetShieldedTxMinFee(const CTransaction& tx);
  *   DUP CHECKSIG DROP ... repeated 100 times... OP_1
  */
 
+/** Initializes the script execution cache, from half of -maxsigcachesize */
+void InitScriptExecutionCache();
+
 /**
  * Check whether all inputs of this transaction are valid (no double spends, scripts & sigs, amounts)
  * This does not modify the UTXO set. If pvChecks is not nullptr, script checks are pushed onto it
  * instead of being performed inline.
+ * The transactions whose scripts all passed with flags are added to the script execution cache with
+ * cacheFullScriptStore (not when pushing onto pvChecks), and their scripts are skipped the next time.
  */
-bool CheckInputs(const CTransaction& tx, CValidationState& state, const CCoinsViewCache& view, bool fScriptChecks, unsigned int flags, bool cacheStore, PrecomputedTransactionData& precomTxData, std::vector<CScriptCheck>* pvChecks = nullptr);
+bool CheckInputs(const CTransaction& tx, CValidationState& state, const CCoinsViewCache& view, bool fScriptChecks, unsigned int flags, bool cacheSigStore, bool cacheFullScriptStore, PrecomputedTransactionData& precomTxData, std::vector<CScriptCheck>* pvChecks = nullptr);
 
 /** Apply the effects of this transaction on the UTXO set represented by view */
 void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, int nHeight, bool fSkipInvalid = false);
@@ -312,6 +443,11 @@ public:
 bool WriteBlockToDisk(const CBlock& block, FlatFilePos& pos);
 bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex);
+/** Read the serialized block as stored on disk (no deserialization nor header checks: already validated blocks only) */
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& block, const FlatFilePos& pos);
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& block, const CBlockIndex* pindex);
+/** Read the undo data of a connected block (the coins spent by its transactions) */
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex);
 
 
 /** Functions for validating blocks and updating the block tree */
@@ -322,13 +458,23 @@ bool CheckWork(const CBlock& block, const CBlockIndex* const pindexPrev);
 
 /** Context-dependent validity checks */
 bool ContextualCheckBlockHeader(const CBlockHeader& block, CValidationState& state, CBlockIndex* pindexPrev) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
-bool ContextualCheckBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindexPrev);
+bool ContextualCheckBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindexPrev, bool fCheckProofs = true);
 
 /** Check a block is completely valid from start to finish (only works on top of our current best block, with cs_main held) */
 bool TestBlockValidity(CValidationState& state, const CBlock& block, CBlockIndex* pindexPrev, bool fCheckPOW = true, bool fCheckMerkleRoot = true, bool fCheckBlockSig = true) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
 bool AcceptBlockHeader(const CBlock& block, CValidationState& state, CBlockIndex** ppindex = nullptr, CBlockIndex* pindexPrev = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+/** The hashes of headers, computed in parallel on the headers hashing threads (when running). Doesn't need cs_main. */
+std::vector<uint256> HashBlockHeaders(const std::vector<CBlockHeader>& headers);
+
+/**
+ * Process the headers of a headers message: they are hashed in parallel and checked to be a chain, before taking
+ * cs_main once to add them to the block index. Stops at the first header since v3.4 (as its stake modifier needs the
+ * block's coinstake). ppindex is set to the last header added (also on failure).
+ */
+bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, CBlockIndex** ppindex = nullptr) LOCKS_EXCLUDED(cs_main);
+
 
 /** RAII wrapper for VerifyDB: Verify consistency of the block and coin databases */
 class CVerifyDB
@@ -336,9 +482,29 @@ class CVerifyDB
 public:
     CVerifyDB();
     ~CVerifyDB();
+    /**
+     * Verify the last nCheckDepth blocks at nCheckLevel.
+     * The blocks and undo data are read, with the context-free checks, by a pool of threads ahead of the other checks.
+     */
     bool VerifyDB(CCoinsView* coinsview, int nCheckLevel, int nCheckDepth);
 };
 
+/** Progress of the last (or running) VerifyDB */
+struct VerifyDBStatus
+{
+    bool fRunning{false};
+    int nCheckLevel{0};
+    int nCheckDepth{0};
+    //! Percentage done, and height of the block being verified
+    int nProgress{0};
+    int nHeight{-1};
+    int64_t nStartTime{0};
+    int64_t nEndTime{0};
+    //! Set once it's done
+    Optional<bool> result;
+};
+VerifyDBStatus GetVerifyDBStatus();
+
 /** Replay blocks that aren't fully applied to the database. */
 bool ReplayBlocks(const CChainParams& params, CCoinsView* view);
 
@@ -349,6 +515,14 @@ inline CBlockIndex* LookupBlockIndex(const uint256& hash) EXCLUSIVE_LOCKS_REQUIR
     return it == mapBlockIndex.end() ? nullptr : it->second;
 }
 
+/**
+ * Like LookupBlockIndex, without cs_main: the insertions in mapBlockIndex are also guarded by
+ * a read-mostly lock, taken shared here, so that the message handlers and the RPC commands can
+ * look up a block without waiting for the block connection in progress.
+ * Only the immutable data of the result (hash, header, height, pprev) can be read without cs_main.
+ */
+CBlockIndex* LookupBlockIndexShared(const uint256& hash);
+
 /** Find the last common block between the parameter chain and a locator. */
 CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& locator) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
@@ -412,4 +586,10 @@ bool DumpMempool(const CTxMemPool& pool);
 /** Load the mempool from disk. */
 bool LoadMempool(CTxMemPool& pool);
 
+/** Dump the outpoints of the coins in the cache of the chainstate to disk. To be called before its last flush. */
+bool DumpCoinsCache();
+
+/** Load the coins dumped by DumpCoinsCache into the cache of the chainstate, out of cs_main but for the batch inserts */
+bool LoadCoinsCache();
+
 #endif // BITCOIN_MAIN_H
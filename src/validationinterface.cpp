@@ -9,9 +9,11 @@
 #include "chain.h"
 #include "consensus/validation.h"
 #include "evo/deterministicmns.h"
+#include "llmq/quorums_chainlocks.h"
 #include "logging.h"
 #include "scheduler.h"
 #include "util/validation.h"
+#include "utiltime.h"
 #include "validation.h" // cs_main
 
 #include <future>
@@ -19,7 +21,28 @@
 #include <unordered_map>
 #include <boost/signals2/signal.hpp>
 
+/** The statistics of a subscriber, updated by its callbacks */
+struct SubscriberStats {
+    Mutex cs;
+    ValidationSubscriberStats stats GUARDED_BY(cs);
+
+    explicit SubscriberStats(const std::string& name) { stats.name = name; }
+    void AddRun(int64_t nTime) { WITH_LOCK(cs, stats.AddRun(nTime)); }
+};
+
+/** Wraps the callback f of a subscriber to account the time spent in it */
+template <typename F>
+static auto TimedCallback(const std::shared_ptr<SubscriberStats>& stats, F f)
+{
+    return [stats, f](auto&&... args) {
+        const int64_t nStart = GetTimeMicros();
+        f(std::forward<decltype(args)>(args)...);
+        stats->AddRun(GetTimeMicros() - nStart);
+    };
+}
+
 struct ValidationInterfaceConnections {
+    std::shared_ptr<SubscriberStats> stats;
     boost::signals2::scoped_connection AcceptedBlockHeader;
     boost::signals2::scoped_connection UpdatedBlockTip;
     boost::signals2::scoped_connection TransactionAddedToMempool;
@@ -30,6 +53,7 @@ struct ValidationInterfaceConnections {
     boost::signals2::scoped_connection Broadcast;
     boost::signals2::scoped_connection BlockChecked;
     boost::signals2::scoped_connection NotifyMasternodeListChanged;
+    boost::signals2::scoped_connection NotifyChainLock;
 };
 
 struct MainSignalsInstance {
@@ -56,8 +80,14 @@ struct MainSignalsInstance {
     boost::signals2::signal<void (const CBlock&, const CValidationState&)> BlockChecked;
     /** Notifies listeners of updated deterministic masternode list */
     boost::signals2::signal<void (bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNListDiff& diff)> NotifyMasternodeListChanged;
+    /** Notifies listeners of a chainlock enforced on the active chain */
+    boost::signals2::signal<void (const CBlockIndex* pindex, const llmq::CChainLockSig& clsig)> NotifyChainLock;
+
+    Mutex m_mutex;
+    std::unordered_map<CValidationInterface*, ValidationInterfaceConnections> m_connMainSignals GUARDED_BY(m_mutex);
 
-    std::unordered_map<CValidationInterface*, ValidationInterfaceConnections> m_connMainSignals;
+    Mutex m_cs_queue_stats;
+    ValidationQueueStats m_queue_stats GUARDED_BY(m_cs_queue_stats);
 
     // We are not allowed to assume the scheduler only runs in one thread,
     // but must ensure all callbacks happen in-order, so we end up creating
@@ -89,36 +119,61 @@ size_t CMainSignals::CallbacksPending() {
     return m_internals->m_schedulerClient.CallbacksPending();
 }
 
+ValidationQueueStats CMainSignals::GetQueueStats()
+{
+    if (!m_internals) return ValidationQueueStats();
+    ValidationQueueStats stats = WITH_LOCK(m_internals->m_cs_queue_stats, return m_internals->m_queue_stats);
+    stats.nDepth = m_internals->m_schedulerClient.CallbacksPending();
+    stats.nMaxDepth = m_max_callbacks_pending;
+    return stats;
+}
+
+std::vector<ValidationSubscriberStats> CMainSignals::GetSubscriberStats()
+{
+    std::vector<ValidationSubscriberStats> ret;
+    if (!m_internals) return ret;
+    LOCK(m_internals->m_mutex);
+    for (const auto& it : m_internals->m_connMainSignals) {
+        ret.emplace_back(WITH_LOCK(it.second.stats->cs, return it.second.stats->stats));
+    }
+    return ret;
+}
+
 CMainSignals& GetMainSignals()
 {
     return g_signals;
 }
-void RegisterSharedValidationInterface(std::shared_ptr<CValidationInterface> pwalletIn)
+void RegisterSharedValidationInterface(std::shared_ptr<CValidationInterface> pwalletIn, const std::string& name)
 {
     // Each connection captures pwalletIn to ensure that each callback is
     // executed before pwalletIn is destroyed. For more details see bitcoin #18338
+    LOCK(g_signals.m_internals->m_mutex);
     ValidationInterfaceConnections& conns = g_signals.m_internals->m_connMainSignals[pwalletIn.get()];
-    conns.AcceptedBlockHeader = g_signals.m_internals->AcceptedBlockHeader.connect(std::bind(&CValidationInterface::AcceptedBlockHeader, pwalletIn, std::placeholders::_1));
-    conns.UpdatedBlockTip = g_signals.m_internals->UpdatedBlockTip.connect(std::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
-    conns.TransactionAddedToMempool = g_signals.m_internals->TransactionAddedToMempool.connect(std::bind(&CValidationInterface::TransactionAddedToMempool, pwalletIn, std::placeholders::_1));
-    conns.BlockConnected = g_signals.m_internals->BlockConnected.connect(std::bind(&CValidationInterface::BlockConnected, pwalletIn, std::placeholders::_1, std::placeholders::_2));
-    conns.BlockDisconnected = g_signals.m_internals->BlockDisconnected.connect(std::bind(&CValidationInterface::BlockDisconnected, pwalletIn, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
-    conns.TransactionRemovedFromMempool = g_signals.m_internals->TransactionRemovedFromMempool.connect(std::bind(&CValidationInterface::TransactionRemovedFromMempool, pwalletIn, std::placeholders::_1, std::placeholders::_2));
-    conns.SetBestChain = g_signals.m_internals->SetBestChain.connect(std::bind(&CValidationInterface::SetBestChain, pwalletIn, std::placeholders::_1));
-    conns.Broadcast = g_signals.m_internals->Broadcast.connect(std::bind(&CValidationInterface::ResendWalletTransactions, pwalletIn, std::placeholders::_1));
-    conns.BlockChecked = g_signals.m_internals->BlockChecked.connect(std::bind(&CValidationInterface::BlockChecked, pwalletIn, std::placeholders::_1, std::placeholders::_2));
-    conns.NotifyMasternodeListChanged = g_signals.m_internals->NotifyMasternodeListChanged.connect(std::bind(&CValidationInterface::NotifyMasternodeListChanged, pwalletIn, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
-}
-void RegisterValidationInterface(CValidationInterface* pwalletIn)
+    auto stats = std::make_shared<SubscriberStats>(name);
+    conns.stats = stats;
+    conns.AcceptedBlockHeader = g_signals.m_internals->AcceptedBlockHeader.connect(TimedCallback(stats, std::bind(&CValidationInterface::AcceptedBlockHeader, pwalletIn, std::placeholders::_1)));
+    conns.UpdatedBlockTip = g_signals.m_internals->UpdatedBlockTip.connect(TimedCallback(stats, std::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3)));
+    conns.TransactionAddedToMempool = g_signals.m_internals->TransactionAddedToMempool.connect(TimedCallback(stats, std::bind(&CValidationInterface::TransactionAddedToMempool, pwalletIn, std::placeholders::_1)));
+    conns.BlockConnected = g_signals.m_internals->BlockConnected.connect(TimedCallback(stats, std::bind(&CValidationInterface::BlockConnected, pwalletIn, std::placeholders::_1, std::placeholders::_2)));
+    conns.BlockDisconnected = g_signals.m_internals->BlockDisconnected.connect(TimedCallback(stats, std::bind(&CValidationInterface::BlockDisconnected, pwalletIn, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4)));
+    conns.TransactionRemovedFromMempool = g_signals.m_internals->TransactionRemovedFromMempool.connect(TimedCallback(stats, std::bind(&CValidationInterface::TransactionRemovedFromMempool, pwalletIn, std::placeholders::_1, std::placeholders::_2)));
+    conns.SetBestChain = g_signals.m_internals->SetBestChain.connect(TimedCallback(stats, std::bind(&CValidationInterface::SetBestChain, pwalletIn, std::placeholders::_1)));
+    conns.Broadcast = g_signals.m_internals->Broadcast.connect(TimedCallback(stats, std::bind(&CValidationInterface::ResendWalletTransactions, pwalletIn, std::placeholders::_1)));
+    conns.BlockChecked = g_signals.m_internals->BlockChecked.connect(TimedCallback(stats, std::bind(&CValidationInterface::BlockChecked, pwalletIn, std::placeholders::_1, std::placeholders::_2)));
+    conns.NotifyMasternodeListChanged = g_signals.m_internals->NotifyMasternodeListChanged.connect(TimedCallback(stats, std::bind(&CValidationInterface::NotifyMasternodeListChanged, pwalletIn, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3)));
+    conns.NotifyChainLock = g_signals.m_internals->NotifyChainLock.connect(TimedCallback(stats, std::bind(&CValidationInterface::NotifyChainLock, pwalletIn, std::placeholders::_1, std::placeholders::_2)));
+}
+void RegisterValidationInterface(CValidationInterface* pwalletIn, const std::string& name)
 {
     // Create a shared_ptr with a no-op deleter - CValidationInterface lifecycle
     // is managed by the caller.
-    RegisterSharedValidationInterface({pwalletIn, [](CValidationInterface*) {}});
+    RegisterSharedValidationInterface({pwalletIn, [](CValidationInterface*) {}}, name);
 }
 
 void UnregisterValidationInterface(CValidationInterface* pwalletIn)
 {
     if (g_signals.m_internals) {
+        LOCK(g_signals.m_internals->m_mutex);
         g_signals.m_internals->m_connMainSignals.erase(pwalletIn);
     }
 }
@@ -133,6 +188,7 @@ void UnregisterAllValidationInterfaces()
     if (!g_signals.m_internals) {
         return;
     }
+    LOCK(g_signals.m_internals->m_mutex);
     g_signals.m_internals->m_connMainSignals.clear();
 }
 
@@ -157,14 +213,18 @@ void SyncWithValidationInterfaceQueue() {
 // evaluating arguments when logging is not enabled.
 //
 // NOTE: The lambda captures all local variables by value.
-#define ENQUEUE_AND_LOG_EVENT(event, fmt, name, ...)           \
-    do {                                                       \
-        auto local_name = (name);                              \
-        LOG_EVENT("Enqueuing " fmt, local_name, __VA_ARGS__);  \
-        m_internals->m_schedulerClient.AddToProcessQueue([=] { \
-            LOG_EVENT(fmt, local_name, __VA_ARGS__);           \
-            event();                                           \
-        });                                                    \
+#define ENQUEUE_AND_LOG_EVENT(event, fmt, name, ...)                  \
+    do {                                                              \
+        auto local_name = (name);                                     \
+        const int64_t nEnqueued = GetTimeMicros();                    \
+        LOG_EVENT("Enqueuing " fmt, local_name, __VA_ARGS__);         \
+        m_internals->m_schedulerClient.AddToProcessQueue([=] {        \
+            const int64_t nWait = GetTimeMicros() - nEnqueued;        \
+            WITH_LOCK(m_internals->m_cs_queue_stats,                  \
+                      m_internals->m_queue_stats.AddWait(nWait));     \
+            LOG_EVENT(fmt, local_name, __VA_ARGS__);                  \
+            event();                                                  \
+        });                                                           \
     } while (0)
 
 #define LOG_EVENT(fmt, ...) \
@@ -249,3 +309,11 @@ void CMainSignals::NotifyMasternodeListChanged(bool undo, const CDeterministicMN
               diff.updatedMNs.size(),
               diff.removedMns.size());
 }
+
+void CMainSignals::NotifyChainLock(const CBlockIndex* pindex, const llmq::CChainLockSig& clsig) {
+    auto event = [pindex, clsig, this] {
+        m_internals->NotifyChainLock(pindex, clsig);
+    };
+    ENQUEUE_AND_LOG_EVENT(event, "%s: block hash=%s, block height=%d", __func__,
+                          pindex->GetBlockHash().ToString(), pindex->nHeight);
+}
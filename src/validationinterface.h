@@ -11,8 +11,12 @@
 #include "sapling/incrementalmerkletree.h"
 #include "primitives/transaction.h"
 
+#include <algorithm>
+#include <atomic>
 #include <functional>
 #include <memory>
+#include <string>
+#include <vector>
 
 class CBlock;
 struct CBlockLocator;
@@ -26,10 +30,40 @@ class uint256;
 class CScheduler;
 enum class MemPoolRemovalReason;
 
+namespace llmq {
+class CChainLockSig;
+} // namespace llmq
+
+//! Default for -maxvalidationqueue
+static const unsigned int DEFAULT_VALIDATION_QUEUE_DEPTH = 10;
+
+/** The statistics of the callbacks of a subscriber (times in microseconds) */
+struct ValidationSubscriberStats
+{
+    std::string name;
+    uint64_t nCalls{0};
+    int64_t nRunTotal{0};
+    int64_t nRunMax{0};
+
+    void AddRun(int64_t nTime) { nCalls++; nRunTotal += nTime; nRunMax = std::max(nRunMax, nTime); }
+};
+
+/** The statistics of the queue of the background callbacks (times in microseconds) */
+struct ValidationQueueStats
+{
+    size_t nDepth{0};
+    size_t nMaxDepth{0};
+    uint64_t nCallbacks{0};
+    int64_t nWaitTotal{0};
+    int64_t nWaitMax{0};
+
+    void AddWait(int64_t nTime) { nCallbacks++; nWaitTotal += nTime; nWaitMax = std::max(nWaitMax, nTime); }
+};
+
 // These functions dispatch to one or all registered wallets
 
-/** Register a wallet to receive updates from core */
-void RegisterValidationInterface(CValidationInterface* pwalletIn);
+/** Register a wallet to receive updates from core. The name identifies it in the callbacks statistics */
+void RegisterValidationInterface(CValidationInterface* pwalletIn, const std::string& name = "unnamed");
 /** Unregister a wallet from core */
 void UnregisterValidationInterface(CValidationInterface* pwalletIn);
 /** Unregister all wallets from core */
@@ -39,7 +73,7 @@ void UnregisterAllValidationInterfaces();
 // notification is sent. These are useful for race-free cleanup, since
 // unregistration is nonblocking and can return before the last notification is
 // processed.
-void RegisterSharedValidationInterface(std::shared_ptr<CValidationInterface> pwalletIn);
+void RegisterSharedValidationInterface(std::shared_ptr<CValidationInterface> pwalletIn, const std::string& name = "unnamed");
 void UnregisterSharedValidationInterface(std::shared_ptr<CValidationInterface> pwalletIn);
 
 /**
@@ -155,19 +189,22 @@ protected:
     /** Tells listeners to broadcast their data. */
     virtual void ResendWalletTransactions(CConnman* connman) {}
     virtual void BlockChecked(const CBlock&, const CValidationState&) {}
-    friend void ::RegisterSharedValidationInterface(std::shared_ptr<CValidationInterface>);
+    friend void ::RegisterSharedValidationInterface(std::shared_ptr<CValidationInterface>, const std::string&);
     friend void ::UnregisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterAllValidationInterfaces();
     /** Notifies listeners of updated deterministic masternode list */
     virtual void NotifyMasternodeListChanged(bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNListDiff& diff) {}
+    /** Notifies listeners of a chainlock enforced on the active chain (called on a background thread) */
+    virtual void NotifyChainLock(const CBlockIndex* pindex, const llmq::CChainLockSig& clsig) {}
 };
 
 struct MainSignalsInstance;
 class CMainSignals {
 private:
     std::unique_ptr<MainSignalsInstance> m_internals;
+    std::atomic<size_t> m_max_callbacks_pending{DEFAULT_VALIDATION_QUEUE_DEPTH};
 
-    friend void ::RegisterSharedValidationInterface(std::shared_ptr<CValidationInterface>);
+    friend void ::RegisterSharedValidationInterface(std::shared_ptr<CValidationInterface>, const std::string&);
     friend void ::UnregisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterAllValidationInterfaces();
     friend void ::CallFunctionInValidationInterfaceQueue(std::function<void ()> func);
@@ -182,6 +219,14 @@ public:
 
     size_t CallbacksPending();
 
+    /** Number of callbacks pending after which the block connection waits for the queue to drain */
+    void SetMaxCallbacksPending(size_t nMax) { m_max_callbacks_pending = nMax; }
+    size_t MaxCallbacksPending() const { return m_max_callbacks_pending; }
+
+    /** The statistics of the queue, and of the callbacks of each subscriber */
+    ValidationQueueStats GetQueueStats();
+    std::vector<ValidationSubscriberStats> GetSubscriberStats();
+
     void AcceptedBlockHeader(const CBlockIndex* pindexNew);
     void UpdatedBlockTip(const CBlockIndex *, const CBlockIndex *, bool fInitialDownload);
     void TransactionAddedToMempool(const CTransactionRef &ptxn);
@@ -192,6 +237,7 @@ public:
     void Broadcast(CConnman* connman);
     void BlockChecked(const CBlock&, const CValidationState&);
     void NotifyMasternodeListChanged(bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNListDiff& diff);
+    void NotifyChainLock(const CBlockIndex* pindex, const llmq::CChainLockSig& clsig);
 };
 
 CMainSignals& GetMainSignals();
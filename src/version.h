@@ -11,7 +11,7 @@
  * network protocol versioning
  */
 
-static const int PROTOCOL_VERSION = 70927;
+static const int PROTOCOL_VERSION = 70929;
 
 //! initial proto version, to be increased after version/verack negotiation
 static const int INIT_PROTO_VERSION = 209;
@@ -26,6 +26,12 @@ static const int MIN_BIP155_PROTOCOL_VERSION = 70923;
 //! Version where MNAUTH was introduced
 static const int MNAUTH_NODE_VER_VERSION = 70925;
 
+//! Version where compact block relay (sendcmpct, cmpctblock, getblocktxn, blocktxn) was introduced
+static const int SHORT_IDS_BLOCKS_VERSION = 70928;
+
+//! Version where transaction relay reconciliation (sendtxrcncl, reqtxrcncl, sketch, reconcildiff) was introduced
+static const int TXRECONCILIATION_VERSION = 70929;
+
 // Make sure that none of the values above collide with
 // `ADDRV2_FORMAT`.
 
@@ -0,0 +1,103 @@
+// Copyright (c) 2017-2020 The Bitcoin Core developers
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "wallet/coinselection.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+//! Maximum number of branches explored by SelectCoinsBnB
+static const size_t BNB_TOTAL_TRIES = 100000;
+
+void SortCoinsForBnB(std::vector<CInputCoin>& utxo_pool)
+{
+    std::sort(utxo_pool.begin(), utxo_pool.end(), [](const CInputCoin& a, const CInputCoin& b) {
+        return a.effective_value > b.effective_value;
+    });
+}
+
+/*
+ * The search walks a binary tree, where each level is the decision of including, or not, the next coin of the
+ * pool. Including is explored first, and a branch is cut (backtracking to the last included coin, to exclude it)
+ * when it exceeds the target window, when the remaining coins can't reach the target anymore, or when its waste
+ * is above the best one while adding inputs only increases it (the fees are above the long term ones).
+ * Coins equal to an excluded previous one are excluded too, as their branches would be duplicates.
+ */
+bool SelectCoinsBnB(const std::vector<CInputCoin>& utxo_pool, const CAmount& target_value, const CAmount& cost_of_change,
+                    std::vector<size_t>& vSelectedRet, CAmount& nValueRet)
+{
+    vSelectedRet.clear();
+    nValueRet = 0;
+    if (utxo_pool.empty()) return false;
+
+    CAmount curr_value = 0;
+    CAmount curr_available_value = 0;
+    for (const CInputCoin& utxo : utxo_pool) {
+        assert(utxo.effective_value > 0);
+        curr_available_value += utxo.effective_value;
+    }
+    if (curr_available_value < target_value) return false;
+
+    std::vector<bool> curr_selection;
+    curr_selection.reserve(utxo_pool.size());
+    CAmount curr_waste = 0;
+    std::vector<bool> best_selection;
+    CAmount best_waste = std::numeric_limits<CAmount>::max();
+    const bool fFeesAboveLongTerm = utxo_pool[0].fee - utxo_pool[0].long_term_fee > 0;
+
+    for (size_t i = 0; i < BNB_TOTAL_TRIES; i++) {
+        bool backtrack = false;
+        if (curr_value + curr_available_value < target_value ||
+                curr_value > target_value + cost_of_change ||
+                (curr_waste > best_waste && fFeesAboveLongTerm)) {
+            backtrack = true;
+        } else if (curr_value >= target_value) {
+            // A solution: record it if it's the least wasteful so far
+            const CAmount waste = curr_waste + (curr_value - target_value);
+            if (waste <= best_waste) {
+                best_selection = curr_selection;
+                best_selection.resize(utxo_pool.size());
+                best_waste = waste;
+            }
+            backtrack = true;
+        }
+
+        if (backtrack) {
+            // Walk back to the last included coin, and exclude it
+            while (!curr_selection.empty() && !curr_selection.back()) {
+                curr_selection.pop_back();
+                curr_available_value += utxo_pool[curr_selection.size()].effective_value;
+            }
+            if (curr_selection.empty()) break; // the whole tree was explored
+            curr_selection.back() = false;
+            const CInputCoin& utxo = utxo_pool[curr_selection.size() - 1];
+            curr_value -= utxo.effective_value;
+            curr_waste -= utxo.fee - utxo.long_term_fee;
+        } else {
+            // Move to the next coin, including it unless it's equal to the previous, excluded, one
+            const CInputCoin& utxo = utxo_pool[curr_selection.size()];
+            curr_available_value -= utxo.effective_value;
+            if (!curr_selection.empty() && !curr_selection.back() &&
+                    utxo.effective_value == utxo_pool[curr_selection.size() - 1].effective_value &&
+                    utxo.fee == utxo_pool[curr_selection.size() - 1].fee) {
+                curr_selection.push_back(false);
+            } else {
+                curr_selection.push_back(true);
+                curr_value += utxo.effective_value;
+                curr_waste += utxo.fee - utxo.long_term_fee;
+            }
+        }
+    }
+
+    if (best_selection.empty()) return false;
+    for (size_t i = 0; i < best_selection.size(); i++) {
+        if (best_selection[i]) {
+            vSelectedRet.emplace_back(utxo_pool[i].index);
+            nValueRet += utxo_pool[i].value;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,76 @@
+// Copyright (c) 2017-2020 The Bitcoin Core developers
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_WALLET_COINSELECTION_H
+#define PIVX_WALLET_COINSELECTION_H
+
+#include "amount.h"
+#include "policy/feerate.h"
+
+#include <vector>
+
+//! Size of a signed P2PKH input, used to estimate the cost of spending a change output
+static const size_t DUMMY_P2PKH_INPUT_SIZE = 148;
+
+/** A coin considered by the branch and bound selection, valued net of the fee of its input */
+struct CInputCoin
+{
+    //! Position of the coin in the caller's list of candidates
+    size_t index{0};
+    CAmount value{0};
+    //! value, minus the fee paid at the current fee rate to spend it
+    CAmount effective_value{0};
+    //! Fee of the input at the current fee rate
+    CAmount fee{0};
+    //! Fee of the input at the long term fee rate
+    CAmount long_term_fee{0};
+
+    CInputCoin() {}
+    CInputCoin(size_t _index, CAmount _value, CAmount _fee, CAmount _long_term_fee) :
+        index(_index), value(_value), effective_value(_value - _fee), fee(_fee), long_term_fee(_long_term_fee) {}
+};
+
+/** Parameters of the coin selection of a transaction */
+struct CoinSelectionParams
+{
+    //! Try the branch and bound selection first, falling back to the knapsack one
+    bool use_bnb{false};
+    //! Fee rate paid by the transaction
+    CFeeRate effective_fee;
+    //! Fee rate expected in the long term, at which the change would be spent
+    CFeeRate long_term_fee;
+    //! Size of the change output
+    size_t change_output_size{0};
+    //! Size of the input spending the change output
+    size_t change_spend_size{DUMMY_P2PKH_INPUT_SIZE};
+    //! Size of the transaction without its inputs
+    size_t tx_noinputs_size{0};
+
+    //! Fee of the transaction without its inputs, at the current fee rate
+    CAmount GetNotInputFees() const { return effective_fee.GetFee(tx_noinputs_size); }
+
+    //! Cost of creating a change output, and of spending it later
+    CAmount GetCostOfChange() const
+    {
+        return effective_fee.GetFee(change_output_size) + long_term_fee.GetFee(change_spend_size);
+    }
+};
+
+/**
+ * Branch and bound search for a set of coins, whose effective values amount to between target_value and
+ * target_value + cost_of_change, so that the transaction doesn't need a change output (the excess goes to the fee).
+ * Among the solutions found, the one with the least waste is selected: the excess, plus the difference between
+ * the fees of the inputs at the current and at the long term fee rates (so that fewer inputs are preferred when
+ * the fees are high, and more of them when they are low).
+ * utxo_pool must be sorted by descending effective value, and contain only positive effective values.
+ * Returns the indexes (CInputCoin::index) of the selected coins in vSelectedRet.
+ */
+bool SelectCoinsBnB(const std::vector<CInputCoin>& utxo_pool, const CAmount& target_value, const CAmount& cost_of_change,
+                    std::vector<size_t>& vSelectedRet, CAmount& nValueRet);
+
+//! Orders a pool of coins for SelectCoinsBnB
+void SortCoinsForBnB(std::vector<CInputCoin>& utxo_pool);
+
+#endif // PIVX_WALLET_COINSELECTION_H
@@ -22,6 +22,7 @@
 #include "rpc/server.h"
 #include "sapling/key_io_sapling.h"
 #include "sapling/sapling_operation.h"
+#include "sapling/sapling_operation_queue.h"
 #include "shutdown.h"
 #include "spork.h"
 #include "timedata.h"
@@ -619,6 +620,56 @@ UniValue getnewshieldaddress(const JSONRPCRequest& request)
     return KeyIO::EncodePaymentAddress(pwallet->GenerateNewSaplingZKey(label));
 }
 
+UniValue getnewshieldaddresses(const JSONRPCRequest& request)
+{
+    CWallet * const pwallet = GetWalletForJSONRPCRequest(request);
+
+    if (!EnsureWalletIsAvailable(pwallet, request.fHelp))
+        return NullUniValue;
+
+    if (request.fHelp || request.params.empty() || request.params.size() > 2)
+        throw std::runtime_error(
+                "getnewshieldaddresses count ( \"label\" )\n"
+                "\nReturns count new shield addresses for receiving payments.\n"
+                "If 'label' is specified, it is added to the address book \n"
+                "so payments received with the shield addresses will be associated with 'label'.\n"
+                + HelpRequiringPassphrase(pwallet) + "\n"
+
+                "\nArguments:\n"
+                "1. count          (numeric, required) The number of addresses to generate (1 to 10000).\n"
+                "2. \"label\"        (string, optional) The label name for the addresses to be linked to. if not provided, the default label \"\" is used.\n"
+
+                "\nResult:\n"
+                "[\n"
+                "  \"address\"    (string) A new shield address.\n"
+                "  ,...\n"
+                "]\n"
+
+                "\nExamples:\n"
+                + HelpExampleCli("getnewshieldaddresses", "100")
+                + HelpExampleRpc("getnewshieldaddresses", "100, \"deposits\"")
+        );
+
+    const int count = request.params[0].get_int();
+    if (count < 1 || count > 10000) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid count, must be between 1 and 10000");
+    }
+    std::string label;
+    if (request.params.size() > 1) {
+        label = LabelFromValue(request.params[1]);
+    }
+
+    LOCK2(cs_main, pwallet->cs_wallet);
+
+    EnsureWalletIsUnlocked(pwallet);
+
+    UniValue ret(UniValue::VARR);
+    for (const auto& address : pwallet->GenerateNewSaplingZKeys((unsigned int)count, label)) {
+        ret.push_back(KeyIO::EncodePaymentAddress(address));
+    }
+    return ret;
+}
+
 static inline std::string HexStrTrimmed(std::array<unsigned char, ZC_MEMO_SIZE> vch)
 {
     return HexStr(std::vector<unsigned char>(vch.begin(), FindFirstNonZero(vch.rbegin(), vch.rend()).base()));
@@ -1001,7 +1052,7 @@ UniValue getrawchangeaddress(const JSONRPCRequest& request)
     LOCK2(cs_main, pwallet->cs_wallet);
 
     if (!pwallet->IsLocked())
-        pwallet->TopUpKeyPool();
+        pwallet->MaybeTopUpKeyPool();
 
     CReserveKey reservekey(pwallet);
     CPubKey vchPubKey;
@@ -1054,7 +1105,8 @@ UniValue setlabel(const JSONRPCRequest& request)
 
 static void SendMoney(CWallet* const pwallet, const CTxDestination& address, CAmount nValue, bool fSubtractFeeFromAmount, CTransactionRef& tx)
 {
-    LOCK2(cs_main, pwallet->cs_wallet);
+    // Not holding cs_wallet: CreateTransaction reserves the coins it selects, so the concurrent sends don't wait
+    // for the signing of each other
 
     // Check amount
     if (nValue <= 0)
@@ -1211,6 +1263,7 @@ UniValue sendtoaddress(const JSONRPCRequest& request)
     SendMoney(pwallet, address, nAmount, fSubtractFeeFromAmount, tx);
 
     // Wallet comments
+    LOCK(pwallet->cs_wallet);
     CWalletTx& wtx = pwallet->mapWallet.at(tx->GetHash());
     if (!commentStr.empty())
         wtx.mapValue["comment"] = commentStr;
@@ -1572,12 +1625,19 @@ UniValue viewshieldtransaction(const JSONRPCRequest& request)
     auto it = pwallet->mapWallet.find(hash);
     if (it == pwallet->mapWallet.end())
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid or non-wallet transaction id");
-    const CWalletTx& wtx = it->second;
+    CWalletTx& wtx = it->second;
 
     if (!wtx.tx->IsShieldedTx()) {
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid transaction, no shield data available");
     }
 
+    // The outputs are recovered when the tx is added to the wallet. Recover (and store) now the ones
+    // missed back then, e.g. t->shield outputs sent while the wallet was locked (without common ovk).
+    if (pwallet->IsFromMe(wtx.tx) && pwallet->AddExternalNotesDataToTx(wtx)) {
+        WalletBatch batch(pwallet->GetDBHandle());
+        batch.WriteTx(wtx);
+    }
+
     entry.pushKV("txid", hash.GetHex());
 
     UniValue spends(UniValue::VARR);
@@ -1605,13 +1665,6 @@ UniValue viewshieldtransaction(const JSONRPCRequest& request)
 
     auto sspkm = pwallet->GetSaplingScriptPubKeyMan();
 
-    // Collect OutgoingViewingKeys for recovering output information
-    std::set<uint256> ovks;
-    // Get the common OVK for recovering t->shield outputs.
-    // If not already databased, a new one will be generated from the HD seed.
-    // It is safe to do it here, as the wallet is unlocked.
-    ovks.insert(sspkm->getCommonOVK());
-
     // Sapling spends
     for (size_t i = 0; i < wtx.tx->sapData->vShieldedSpend.size(); ++i) {
         const auto& spend = wtx.tx->sapData->vShieldedSpend[i];
@@ -1687,11 +1740,9 @@ UniValue viewshieldtransaction(const JSONRPCRequest& request)
     return entry;
 }
 
-static SaplingOperation CreateShieldedTransaction(CWallet* const pwallet, const JSONRPCRequest& request)
+// Sets up, without building it, the operation of a shieldsendmany request
+static void SetupShieldedTransaction(CWallet* const pwallet, const JSONRPCRequest& request, SaplingOperation& operation)
 {
-    LOCK2(cs_main, pwallet->cs_wallet);
-    SaplingOperation operation(Params().GetConsensus(), pwallet);
-
     // Param 0: source of funds. Can either be a valid address, sapling address,
     // or the string "from_transparent"|"from_trans_cold"|"from_shield"
     bool fromSapling  = false;
@@ -1845,10 +1896,17 @@ static SaplingOperation CreateShieldedTransaction(CWallet* const pwallet, const
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Minconf cannot be negative");
     }
 
+    operation.setMinDepth(nMinDepth)->setRecipients(recipients);
+}
+
+static SaplingOperation CreateShieldedTransaction(CWallet* const pwallet, const JSONRPCRequest& request)
+{
+    LOCK2(cs_main, pwallet->cs_wallet);
+    SaplingOperation operation(Params().GetConsensus(), pwallet);
+    SetupShieldedTransaction(pwallet, request, operation);
+
     // Build the send operation
-    OperationResult res = operation.setMinDepth(nMinDepth)
-            ->setRecipients(recipients)
-            ->build();
+    OperationResult res = operation.build();
     if (!res) throw JSONRPCError(RPC_WALLET_ERROR, res.getError());
     return operation;
 }
@@ -1967,6 +2025,161 @@ UniValue rawshieldsendmany(const JSONRPCRequest& request)
     return EncodeHexTx(tx);
 }
 
+UniValue shieldsendmanyasync(const JSONRPCRequest& request)
+{
+    CWallet * const pwallet = GetWalletForJSONRPCRequest(request);
+
+    if (!EnsureWalletIsAvailable(pwallet, request.fHelp))
+        return NullUniValue;
+
+    if (request.fHelp || request.params.size() < 2 || request.params.size() > 5)
+        throw std::runtime_error(
+                "shieldsendmanyasync \"fromaddress\" [{\"address\":... ,\"amount\":...},...] ( minconf fee subtract_fee_from )\n"
+                "\nQueues a shieldsendmany, built and sent on a background thread (-shieldsendthreads), and returns its operation id."
+                "\nThe arguments are checked immediately, the funds are selected when the operation starts."
+                "\nUse getshieldoperationstatus and getshieldoperationresult to follow it, and cancelshieldoperation to cancel it before it starts."
+                "\nThe wallet must stay unlocked until the operation is done."
+                + HelpRequiringPassphrase(pwallet) + "\n"
+
+                "\nArguments:\n"
+                "Same as shieldsendmany.\n"
+
+                "\nResult:\n"
+                "\"opid\"        (string) the id of the operation\n"
+
+                "\nExamples:\n"
+                + HelpExampleCli("shieldsendmanyasync",
+                                 "\"DMJRSsuU9zfyrvxVaAEFQqK4MxZg6vgeS6\" '[{\"address\": \"ps1ra969yfhvhp73rw5ak2xvtcm9fkuqsnmad7qln79mphhdrst3lwu9vvv03yuyqlh42p42st47qd\" ,\"amount\": 5.0}]'")
+                + HelpExampleRpc("shieldsendmanyasync",
+                                 "\"DMJRSsuU9zfyrvxVaAEFQqK4MxZg6vgeS6\", [{\"address\": \"ps1ra969yfhvhp73rw5ak2xvtcm9fkuqsnmad7qln79mphhdrst3lwu9vvv03yuyqlh42p42st47qd\" ,\"amount\": 5.0}]")
+        );
+
+    EnsureWalletIsUnlocked(pwallet);
+
+    // Make sure the results are valid at least up to the most recent block
+    // the user could have gotten from another RPC command prior to now
+    pwallet->BlockUntilSyncedToCurrentChain();
+
+    auto operation = std::make_shared<SaplingOperation>(Params().GetConsensus(), pwallet);
+    {
+        LOCK2(cs_main, pwallet->cs_wallet);
+        SetupShieldedTransaction(pwallet, request, *operation);
+    }
+    return GetSaplingOperationQueue().Submit(pwallet, operation);
+}
+
+static std::vector<std::string> ParseShieldOperationIds(const UniValue& param)
+{
+    std::vector<std::string> ids;
+    if (!param.isNull()) {
+        for (const UniValue& id : param.get_array().getValues()) {
+            ids.emplace_back(id.get_str());
+        }
+    }
+    return ids;
+}
+
+static UniValue ShieldOperationToJSON(const SaplingOperationQueue::OperationInfo& info)
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("id", info.id);
+    obj.pushKV("status", SaplingOperationQueue::StateToString(info.state));
+    obj.pushKV("creation_time", info.nCreationTime);
+    if (info.state == SaplingOperationQueue::State::SUCCESS || info.state == SaplingOperationQueue::State::FAILED) {
+        obj.pushKV("execution_secs", info.nExecutionMillis / 1000.0);
+    }
+    if (info.state == SaplingOperationQueue::State::SUCCESS) {
+        obj.pushKV("txid", info.txid);
+    } else if (info.state == SaplingOperationQueue::State::FAILED) {
+        obj.pushKV("error", info.error);
+    }
+    return obj;
+}
+
+static const std::string SHIELD_OPERATION_RESULT_HELP =
+        "[\n"
+        "  {\n"
+        "    \"id\": \"opid\",           (string) the id of the operation\n"
+        "    \"status\": \"xxx\",        (string) queued|executing|success|failed|cancelled\n"
+        "    \"creation_time\": n,       (numeric) the time the operation was queued, in seconds since epoch\n"
+        "    \"execution_secs\": n,      (numeric, if success or failed) the duration of the operation\n"
+        "    \"txid\": \"hash\",         (string, if success) the id of the sent transaction\n"
+        "    \"error\": \"xxx\",         (string, if failed) the reason of the failure\n"
+        "  }, ...\n"
+        "]\n";
+
+UniValue getshieldoperationstatus(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw std::runtime_error(
+                "getshieldoperationstatus ( [\"opid\",...] )\n"
+                "\nReturns the status of the shieldsendmanyasync operations with the given ids (of all of them by default).\n"
+
+                "\nArguments:\n"
+                "1. \"opids\"     (array, optional) The ids of the operations\n"
+
+                "\nResult:\n"
+                + SHIELD_OPERATION_RESULT_HELP +
+
+                "\nExamples:\n"
+                + HelpExampleCli("getshieldoperationstatus", "")
+                + HelpExampleRpc("getshieldoperationstatus", "[\"opid-0a1654cde1d6ee1920fa06f33f0b8d70\"]")
+        );
+
+    UniValue ret(UniValue::VARR);
+    for (const auto& info : GetSaplingOperationQueue().GetInfo(ParseShieldOperationIds(request.params[0]))) {
+        ret.push_back(ShieldOperationToJSON(info));
+    }
+    return ret;
+}
+
+UniValue getshieldoperationresult(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw std::runtime_error(
+                "getshieldoperationresult ( [\"opid\",...] )\n"
+                "\nReturns the result of the finished shieldsendmanyasync operations with the given ids (of all of them by default),\n"
+                "which are then removed from the list of the operations.\n"
+
+                "\nArguments:\n"
+                "1. \"opids\"     (array, optional) The ids of the operations\n"
+
+                "\nResult:\n"
+                + SHIELD_OPERATION_RESULT_HELP +
+
+                "\nExamples:\n"
+                + HelpExampleCli("getshieldoperationresult", "")
+                + HelpExampleRpc("getshieldoperationresult", "[\"opid-0a1654cde1d6ee1920fa06f33f0b8d70\"]")
+        );
+
+    UniValue ret(UniValue::VARR);
+    for (const auto& info : GetSaplingOperationQueue().PopFinished(ParseShieldOperationIds(request.params[0]))) {
+        ret.push_back(ShieldOperationToJSON(info));
+    }
+    return ret;
+}
+
+UniValue cancelshieldoperation(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+                "cancelshieldoperation \"opid\"\n"
+                "\nCancels a shieldsendmanyasync operation which has not started yet.\n"
+
+                "\nArguments:\n"
+                "1. \"opid\"      (string, required) The id of the operation\n"
+
+                "\nResult:\n"
+                "true|false       (boolean) Whether the operation was cancelled\n"
+
+                "\nExamples:\n"
+                + HelpExampleCli("cancelshieldoperation", "\"opid-0a1654cde1d6ee1920fa06f33f0b8d70\"")
+                + HelpExampleRpc("cancelshieldoperation", "\"opid-0a1654cde1d6ee1920fa06f33f0b8d70\"")
+        );
+
+    return GetSaplingOperationQueue().Cancel(request.params[0].get_str());
+}
+
 UniValue listaddressgroupings(const JSONRPCRequest& request)
 {
     CWallet * const pwallet = GetWalletForJSONRPCRequest(request);
@@ -2345,8 +2558,7 @@ UniValue getunconfirmedbalance(const JSONRPCRequest& request)
  */
 static UniValue legacy_sendmany(CWallet* const pwallet, const UniValue& sendTo, int nMinDepth, std::string comment, bool fIncludeDelegated, const UniValue& subtractFeeFromAmount)
 {
-    LOCK2(cs_main, pwallet->cs_wallet);
-
+    // Not holding cs_wallet, as in SendMoney
     if (!g_connman)
         throw JSONRPCError(RPC_CLIENT_P2P_DISABLED, "Error: Peer-to-peer functionality missing or disabled");
 
@@ -2410,6 +2622,7 @@ static UniValue legacy_sendmany(CWallet* const pwallet, const UniValue& sendTo,
         throw JSONRPCError(RPC_WALLET_ERROR, res.ToString());
 
     // Set comment
+    LOCK(pwallet->cs_wallet);
     CWalletTx& wtx = pwallet->mapWallet.at(txNew->GetHash());
     if (!comment.empty()) {
         wtx.mapValue["comment"] = comment;
@@ -2850,8 +3063,9 @@ UniValue listreceivedbyshieldaddress(const JSONRPCRequest& request)
         auto it = pwallet->mapWallet.find(entry.op.hash);
         if (it != pwallet->mapWallet.end()) {
             const CWalletTx& wtx = it->second;
-            if (!wtx.m_confirm.hashBlock.IsNull())
-                height = mapBlockIndex[wtx.m_confirm.hashBlock]->nHeight;
+            const CBlockIndex* pindex = wtx.m_confirm.hashBlock.IsNull() ? nullptr : LookupBlockIndex(wtx.m_confirm.hashBlock);
+            if (pindex)
+                height = pindex->nHeight;
             index = wtx.m_confirm.nIndex;
             time = wtx.GetTxTime();
         }
@@ -2952,40 +3166,32 @@ UniValue listcoldutxos(const JSONRPCRequest& request)
         fExcludeWhitelisted = request.params[0].get_bool();
     UniValue results(UniValue::VARR);
 
-    for (const auto& entry : pwallet->mapWallet) {
-        const uint256& wtxid = entry.first;
-        const CWalletTx* pcoin = &entry.second;
-        if (!CheckFinalTx(pcoin->tx) || !pcoin->IsTrusted())
-            continue;
-
-        // if this tx has no unspent P2CS outputs for us, skip it
-        if(pcoin->GetColdStakingCredit() == 0 && pcoin->GetStakeDelegationCredit() == 0)
-            continue;
-
-        for (unsigned int i = 0; i < pcoin->tx->vout.size(); i++) {
-            const CTxOut& out = pcoin->tx->vout[i];
-            isminetype mine = pwallet->IsMine(out);
-            if (!bool(mine & ISMINE_COLD) && !bool(mine & ISMINE_SPENDABLE_DELEGATED))
-                continue;
-            txnouttype type;
-            std::vector<CTxDestination> addresses;
-            int nRequired;
-            if (!ExtractDestinations(out.scriptPubKey, type, addresses, nRequired))
-                continue;
-            const bool fWhitelisted = pwallet->HasAddressBook(addresses[1]) > 0;
-            if (fExcludeWhitelisted && fWhitelisted)
-                continue;
-            UniValue entry(UniValue::VOBJ);
-            entry.pushKV("txid", wtxid.GetHex());
-            entry.pushKV("txidn", (int)i);
-            entry.pushKV("amount", ValueFromAmount(out.nValue));
-            entry.pushKV("confirmations", pcoin->GetDepthInMainChain());
-            entry.pushKV("cold-staker", EncodeDestination(addresses[0], CChainParams::STAKING_ADDRESS));
-            entry.pushKV("coin-owner", EncodeDestination(addresses[1]));
-            entry.pushKV("whitelisted", fWhitelisted ? "true" : "false");
-            results.push_back(entry);
+    // The indexed P2CS outputs of the wallet, each tx being checked once for all its outputs
+    const CWalletTx* pLastTx = nullptr;
+    bool fLastTxListed = false;
+    pwallet->ForEachP2CSOutput([&](const CWalletTx& wtx, uint32_t i, const P2CSOutputKeys& keys) {
+        if (&wtx != pLastTx) {
+            pLastTx = &wtx;
+            // if this tx has no unspent P2CS outputs for us, skip it
+            fLastTxListed = CheckFinalTx(wtx.tx) && wtx.IsTrusted() &&
+                            (wtx.GetColdStakingCredit() != 0 || wtx.GetStakeDelegationCredit() != 0);
         }
-    }
+        if (!fLastTxListed)
+            return;
+        const CTxOut& out = wtx.tx->vout[i];
+        const bool fWhitelisted = pwallet->HasAddressBook(CTxDestination(keys.ownerId)) > 0;
+        if (fExcludeWhitelisted && fWhitelisted)
+            return;
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("txid", wtx.GetHash().GetHex());
+        entry.pushKV("txidn", (int)i);
+        entry.pushKV("amount", ValueFromAmount(out.nValue));
+        entry.pushKV("confirmations", wtx.GetDepthInMainChain());
+        entry.pushKV("cold-staker", EncodeDestination(keys.stakerId, CChainParams::STAKING_ADDRESS));
+        entry.pushKV("coin-owner", EncodeDestination(keys.ownerId));
+        entry.pushKV("whitelisted", fWhitelisted ? "true" : "false");
+        results.push_back(entry);
+    });
 
     return results;
 }
@@ -3061,6 +3267,20 @@ static void ListTransactions(CWallet* const pwallet, const CWalletTx& wtx, int n
     }
 }
 
+// The number of entries that ListTransactions adds for wtx, without building them
+static size_t CountListTransactions(const CWalletTx& wtx, int nMinDepth, const isminefilter& filter) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    CAmount nFee;
+    std::list<COutputEntry> listReceived;
+    std::list<COutputEntry> listSent;
+    wtx.GetAmounts(listReceived, listSent, nFee, filter);
+    size_t nEntries = listSent.size();
+    if (!listReceived.empty() && wtx.GetDepthInMainChain() >= nMinDepth) {
+        nEntries += listReceived.size();
+    }
+    return nEntries;
+}
+
 UniValue listtransactions(const JSONRPCRequest& request)
 {
     CWallet * const pwallet = GetWalletForJSONRPCRequest(request);
@@ -3145,35 +3365,35 @@ UniValue listtransactions(const JSONRPCRequest& request)
     if (nFrom < 0)
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative from");
 
-    UniValue ret(UniValue::VARR);
+    std::vector<UniValue> arrTmp;
+    arrTmp.reserve(std::min(nCount, 1000));
 
     const CWallet::TxItems & txOrdered = pwallet->wtxOrdered;
 
-    // iterate backwards until we have nCount items to return:
-    for (CWallet::TxItems::const_reverse_iterator it = txOrdered.rbegin(); it != txOrdered.rend(); ++it) {
+    // iterate backwards until we have nCount items to return.
+    // The entries of the txs before 'from' are only counted (with the cached amounts of the txs), not built.
+    const int64_t nEnd = (int64_t)nFrom + nCount;
+    int64_t nPos = 0;
+    for (CWallet::TxItems::const_reverse_iterator it = txOrdered.rbegin(); it != txOrdered.rend() && nPos < nEnd; ++it) {
         CWalletTx* const pwtx = (*it).second;
-        ListTransactions(pwallet, *pwtx, 0, true, ret, filter);
-        if ((int)ret.size() >= (nCount + nFrom)) break;
+        const int64_t nEntries = CountListTransactions(*pwtx, 0, filter);
+        if (nPos + nEntries <= nFrom) {
+            nPos += nEntries;
+            continue;
+        }
+        UniValue entries(UniValue::VARR);
+        ListTransactions(pwallet, *pwtx, 0, true, entries, filter);
+        for (const UniValue& entry : entries.getValues()) {
+            if (nPos >= nFrom && nPos < nEnd) arrTmp.push_back(entry);
+            nPos++;
+        }
     }
-    // ret is newest to oldest
-
-    if (nFrom > (int)ret.size())
-        nFrom = ret.size();
-    if ((nFrom + nCount) > (int)ret.size())
-        nCount = ret.size() - nFrom;
-
-    std::vector<UniValue> arrTmp = ret.getValues();
-
-    std::vector<UniValue>::iterator first = arrTmp.begin();
-    std::advance(first, nFrom);
-    std::vector<UniValue>::iterator last = arrTmp.begin();
-    std::advance(last, nFrom+nCount);
-
-    if (last != arrTmp.end()) arrTmp.erase(last, arrTmp.end());
-    if (first != arrTmp.begin()) arrTmp.erase(arrTmp.begin(), first);
+    // arrTmp is newest to oldest
 
     std::reverse(arrTmp.begin(), arrTmp.end()); // Return oldest to newest
 
+    UniValue ret(UniValue::VARR);
+
     ret.clear();
     ret.setArray();
     ret.push_backV(arrTmp);
@@ -4828,6 +5048,7 @@ static const CRPCCommand commands[] =
 
     /** Sapling functions */
     { "wallet",             "getnewshieldaddress",           &getnewshieldaddress,            true,  {"label"} },
+    { "wallet",             "getnewshieldaddresses",         &getnewshieldaddresses,          true,  {"count","label"} },
     { "wallet",             "listshieldaddresses",           &listshieldaddresses,            false, {"include_watchonly"} },
     { "wallet",             "exportsaplingkey",              &exportsaplingkey,               true,  {"shield_addr"} },
     { "wallet",             "importsaplingkey",              &importsaplingkey,               true,  {"key","rescan","height"} },
@@ -4837,6 +5058,10 @@ static const CRPCCommand commands[] =
     { "wallet",             "listshieldunspent",             &listshieldunspent,              false, {"minconf","maxconf","include_watchonly","addresses"} },
     { "wallet",             "rawshieldsendmany",             &rawshieldsendmany,              false, {"fromaddress","amounts","minconf","fee"} },
     { "wallet",             "shieldsendmany",                &shieldsendmany,                 false, {"fromaddress","amounts","minconf","fee","subtract_fee_from"} },
+    { "wallet",             "shieldsendmanyasync",           &shieldsendmanyasync,            false, {"fromaddress","amounts","minconf","fee","subtract_fee_from"} },
+    { "wallet",             "getshieldoperationstatus",      &getshieldoperationstatus,       true,  {"opids"} },
+    { "wallet",             "getshieldoperationresult",      &getshieldoperationresult,       true,  {"opids"} },
+    { "wallet",             "cancelshieldoperation",         &cancelshieldoperation,          true,  {"opid"} },
     { "wallet",             "listreceivedbyshieldaddress",   &listreceivedbyshieldaddress,    false, {"address","minconf"} },
     { "wallet",             "viewshieldtransaction",         &viewshieldtransaction,          false, {"txid"} },
     { "wallet",             "getsaplingnotescount",          &getsaplingnotescount,           false, {"minconf"} },
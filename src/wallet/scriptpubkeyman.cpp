@@ -5,7 +5,9 @@
 
 #include "wallet/scriptpubkeyman.h"
 #include "crypter.h"
+#include "scheduler.h"
 #include "script/standard.h"
+#include "shutdown.h"
 
 bool ScriptPubKeyMan::SetupGeneration(bool newKeypool, bool force, bool memOnly)
 {
@@ -298,7 +300,7 @@ void ScriptPubKeyMan::MarkUnusedAddresses(const CScript& script)
             LogPrintf("%s: Detected a used keypool key, mark all keypool key up to this key as used\n", __func__);
             MarkReserveKeysAsUsed(mi->second);
 
-            if (!TopUp()) {
+            if (!MaybeTopUp()) {
                 LogPrintf("%s: Topping up keypool failed (locked wallet)\n", __func__);
             }
         }
@@ -362,6 +364,68 @@ bool ScriptPubKeyMan::NewKeyPool()
     return true;
 }
 
+unsigned int ScriptPubKeyMan::GetKeyPoolTargetSize(unsigned int kpSize) const
+{
+    if (kpSize > 0) return kpSize;
+    return (unsigned int) std::max(gArgs.GetArg("-keypool", DEFAULT_KEYPOOL_SIZE), (int64_t) 0);
+}
+
+bool ScriptPubKeyMan::TopUpKeys(unsigned int nTargetSize, int64_t nMaxKeys, int64_t& nStillMissing)
+{
+    AssertLockHeld(wallet->cs_wallet);
+    nStillMissing = 0;
+    if (!CanGenerateKeys() || wallet->IsLocked()) {
+        return false;
+    }
+
+    // Count amount of available keys (internal, external)
+    // make sure the keypool of external and internal keys fits the user selected target (-keypool)
+    int64_t missingExternal = std::max(std::max((int64_t) nTargetSize, (int64_t) 1) - (int64_t)setExternalKeyPool.size(), (int64_t) 0);
+    int64_t missingInternal = std::max(std::max((int64_t) nTargetSize, (int64_t) 1) - (int64_t)setInternalKeyPool.size(), (int64_t) 0);
+    int64_t missingStaking = std::max(std::max((int64_t) nTargetSize, (int64_t) 1) - (int64_t)setStakingKeyPool.size(), (int64_t) 0);
+
+    if (!IsHDEnabled()) {
+        // don't create extra internal or staking keys
+        missingInternal = 0;
+        missingStaking = 0;
+    }
+
+    // Derive at most nMaxKeys keys, for the emptiest pools first
+    const int64_t nMissing = missingExternal + missingInternal + missingStaking;
+    if (nMissing > nMaxKeys) {
+        std::array<int64_t*, 3> vMissing{{&missingExternal, &missingInternal, &missingStaking}};
+        std::sort(vMissing.begin(), vMissing.end(), [](const int64_t* a, const int64_t* b) { return *a < *b; });
+        int64_t nExcess = nMissing - nMaxKeys;
+        for (int64_t* pMissing : vMissing) {
+            const int64_t nDeferred = std::min(*pMissing, nExcess);
+            *pMissing -= nDeferred;
+            nExcess -= nDeferred;
+        }
+        nStillMissing = nMissing - nMaxKeys;
+    }
+    if (nMissing == 0) {
+        return true;
+    }
+
+    // Write all the new keys, and the chain counters, in a single db transaction
+    WalletBatch batch(wallet->GetDBHandle());
+    const bool fAtomic = batch.TxnBegin();
+    GeneratePool(batch, missingExternal, HDChain::ChangeType::EXTERNAL);
+    GeneratePool(batch, missingInternal, HDChain::ChangeType::INTERNAL);
+    GeneratePool(batch, missingStaking, HDChain::ChangeType::STAKING);
+    if (fAtomic && !batch.TxnCommit()) {
+        throw std::runtime_error(std::string(__func__) + ": committing the new keypool keys failed");
+    }
+
+    if (missingInternal + missingExternal > 0) {
+        LogPrintf("keypool added %d keys (%d internal), size=%u (%u internal), \n", missingInternal + missingExternal, missingInternal, setInternalKeyPool.size() + setExternalKeyPool.size() + set_pre_split_keypool.size(), setInternalKeyPool.size());
+    }
+    if (missingStaking > 0) {
+        LogPrintf("keypool added %d staking keys\n", setStakingKeyPool.size());
+    }
+    return true;
+}
+
 /**
  * Fill the key pool
  */
@@ -372,48 +436,65 @@ bool ScriptPubKeyMan::TopUp(unsigned int kpSize)
     }
     {
         LOCK(wallet->cs_wallet);
-        if (wallet->IsLocked()) return false;
-
-        // Top up key pool
-        unsigned int nTargetSize;
-        if (kpSize > 0)
-            nTargetSize = kpSize;
-        else
-            nTargetSize = std::max(gArgs.GetArg("-keypool", DEFAULT_KEYPOOL_SIZE), (int64_t) 0);
-
-        // Count amount of available keys (internal, external)
-        // make sure the keypool of external and internal keys fits the user selected target (-keypool)
-        int64_t missingExternal = std::max(std::max((int64_t) nTargetSize, (int64_t) 1) - (int64_t)setExternalKeyPool.size(), (int64_t) 0);
-        int64_t missingInternal = std::max(std::max((int64_t) nTargetSize, (int64_t) 1) - (int64_t)setInternalKeyPool.size(), (int64_t) 0);
-        int64_t missingStaking = std::max(std::max((int64_t) nTargetSize, (int64_t) 1) - (int64_t)setStakingKeyPool.size(), (int64_t) 0);
-
-        if (!IsHDEnabled()) {
-            // don't create extra internal or staking keys
-            missingInternal = 0;
-            missingStaking = 0;
+        int64_t nStillMissing;
+        if (!TopUpKeys(GetKeyPoolTargetSize(kpSize), std::numeric_limits<int64_t>::max(), nStillMissing)) {
+            return false;
         }
+    }
+    // TODO: Implement this.
+    //NotifyCanGetAddressesChanged();
+    return true;
+}
 
-        WalletBatch batch(wallet->GetDBHandle());
-        GeneratePool(batch, missingExternal, HDChain::ChangeType::EXTERNAL);
-        GeneratePool(batch, missingInternal, HDChain::ChangeType::INTERNAL);
-        GeneratePool(batch, missingStaking, HDChain::ChangeType::STAKING);
+bool ScriptPubKeyMan::MaybeTopUp()
+{
+    LOCK(wallet->cs_wallet);
+    const bool fEmptyPool = setExternalKeyPool.empty() ||
+                            (IsHDEnabled() && (setInternalKeyPool.empty() || setStakingKeyPool.empty()));
+    if (!scheduler || fEmptyPool) {
+        return TopUp();
+    }
+    if (!CanGenerateKeys() || wallet->IsLocked()) {
+        return false;
+    }
+    // The flag is reset by the task while holding cs_wallet, so no key drawn meanwhile is left without replacement
+    if (!fTopUpScheduled.exchange(true)) {
+        scheduler->scheduleFromNow(std::bind(&ScriptPubKeyMan::BackgroundTopUp, this), 0, "wallet-topup", CScheduler::Priority::LOW);
+    }
+    return true;
+}
 
-        if (missingInternal + missingExternal > 0) {
-            LogPrintf("keypool added %d keys (%d internal), size=%u (%u internal), \n", missingInternal + missingExternal, missingInternal, setInternalKeyPool.size() + setExternalKeyPool.size() + set_pre_split_keypool.size(), setInternalKeyPool.size());
+void ScriptPubKeyMan::BackgroundTopUp()
+{
+    const unsigned int nTargetSize = GetKeyPoolTargetSize(0);
+    while (!ShutdownRequested()) {
+        LOCK(wallet->cs_wallet);
+        int64_t nStillMissing;
+        bool fContinue;
+        try {
+            fContinue = TopUpKeys(nTargetSize, KEYPOOL_TOPUP_CHUNK, nStillMissing) && nStillMissing > 0;
+        } catch (const std::exception& e) {
+            // Don't bring down the scheduler thread: the next key drawn schedules another top-up
+            LogPrintf("%s: keypool top-up failed: %s\n", __func__, e.what());
+            fContinue = false;
         }
-        if (missingStaking > 0) {
-            LogPrintf("keypool added %d staking keys\n", setStakingKeyPool.size());
+        if (!fContinue) {
+            fTopUpScheduled = false;
+            return;
         }
     }
-    // TODO: Implement this.
-    //NotifyCanGetAddressesChanged();
-    return true;
+    fTopUpScheduled = false;
 }
 
 void ScriptPubKeyMan::GeneratePool(WalletBatch& batch, int64_t targetSize, const uint8_t& type)
 {
+    if (targetSize <= 0) return;
+    // The chain key is the same for all the new keys: derive it once
+    ChainKey chainKey;
+    const bool fHD = IsHDEnabled();
+    if (fHD) DeriveChainKey(type, chainKey);
     for (int64_t i = targetSize; i--;) {
-        CPubKey pubkey(GenerateNewKey(batch, type));
+        CPubKey pubkey(GenerateNewKey(batch, type, fHD ? &chainKey : nullptr));
         AddKeypoolPubkeyWithDB(pubkey, type, batch);
     }
 }
@@ -443,6 +524,11 @@ void ScriptPubKeyMan::AddKeypoolPubkeyWithDB(const CPubKey& pubkey, const uint8_
  * Generate a new key and stores it in db.
  */
 CPubKey ScriptPubKeyMan::GenerateNewKey(WalletBatch &batch, const uint8_t& type)
+{
+    return GenerateNewKey(batch, type, nullptr);
+}
+
+CPubKey ScriptPubKeyMan::GenerateNewKey(WalletBatch &batch, const uint8_t& type, const ChainKey* pChainKey)
 {
     AssertLockHeld(wallet->cs_wallet);
     bool fCompressed = wallet->CanSupportFeature(FEATURE_COMPRPUBKEY); // default to compressed public keys if we want 0.6.0 wallets
@@ -455,7 +541,7 @@ CPubKey ScriptPubKeyMan::GenerateNewKey(WalletBatch &batch, const uint8_t& type)
 
     // use HD key derivation if HD was enabled during wallet creation and a seed is present
     if (IsHDEnabled()) {
-        DeriveNewChildKey(batch, metadata, secret, type);
+        DeriveNewChildKey(batch, metadata, secret, type, pChainKey);
     } else {
         secret.MakeNewKey(fCompressed);
     }
@@ -477,7 +563,7 @@ CPubKey ScriptPubKeyMan::GenerateNewKey(WalletBatch &batch, const uint8_t& type)
     return pubkey;
 }
 
-void ScriptPubKeyMan::DeriveNewChildKey(WalletBatch &batch, CKeyMetadata& metadata, CKey& secret, const uint8_t& changeType)
+void ScriptPubKeyMan::DeriveChainKey(const uint8_t& changeType, ChainKey& chainKey)
 {
     AssertLockHeld(wallet->cs_wallet);
     // Use BIP44 keypath scheme i.e. m / purpose' / coin_type' / account' / change / address_index
@@ -486,8 +572,6 @@ void ScriptPubKeyMan::DeriveNewChildKey(WalletBatch &batch, CKeyMetadata& metada
     CExtKey purposeKey;            //key at m/purpose' --> key at m/44'
     CExtKey cointypeKey;           //key at m/purpose'/coin_type'  --> key at m/44'/119'
     CExtKey accountKey;            //key at m/purpose'/coin_type'/account' ---> key at m/44'/119'/account_num'
-    CExtKey changeKey;             //key at m/purpose'/coin_type'/account'/change ---> key at m/44'/119'/account_num'/change', external = 0' or internal = 1'.
-    CExtKey childKey;              //key at m/purpose'/coin_type'/account'/change/address_index ---> key at m/44'/119'/account_num'/change'/<n>'
 
     // For now only one account.
     int nAccountNumber = 0;
@@ -506,7 +590,24 @@ void ScriptPubKeyMan::DeriveNewChildKey(WalletBatch &batch, CKeyMetadata& metada
     // derive m/purpose'/coin_type'/account' // Hardcoded to account 0 for now.
     cointypeKey.Derive(accountKey, nAccountNumber | BIP32_HARDENED_KEY_LIMIT);
     // derive m/purpose'/coin_type'/account'/change'
-    accountKey.Derive(changeKey,  changeType | BIP32_HARDENED_KEY_LIMIT);
+    accountKey.Derive(chainKey.extKey,  changeType | BIP32_HARDENED_KEY_LIMIT);
+    chainKey.masterKeyId = masterKey.key.GetPubKey().GetID();
+}
+
+void ScriptPubKeyMan::DeriveNewChildKey(WalletBatch &batch, CKeyMetadata& metadata, CKey& secret, const uint8_t& changeType,
+                                        const ChainKey* pChainKey)
+{
+    AssertLockHeld(wallet->cs_wallet);
+    ChainKey derivedChainKey;
+    if (!pChainKey) {
+        DeriveChainKey(changeType, derivedChainKey);
+        pChainKey = &derivedChainKey;
+    }
+    const CExtKey& changeKey = pChainKey->extKey; //key at m/purpose'/coin_type'/account'/change ---> key at m/44'/119'/account_num'/change', external = 0' or internal = 1'.
+    CExtKey childKey;              //key at m/purpose'/coin_type'/account'/change/address_index ---> key at m/44'/119'/account_num'/change'/<n>'
+
+    // For now only one account.
+    int nAccountNumber = 0;
 
     // derive child key at next index, skip keys already known to the wallet
     do {
@@ -529,7 +630,7 @@ void ScriptPubKeyMan::DeriveNewChildKey(WalletBatch &batch, CKeyMetadata& metada
 
     secret = childKey.key;
     metadata.hd_seed_id = hdChain.GetID();
-    CKeyID master_id = masterKey.key.GetPubKey().GetID();
+    const CKeyID& master_id = pChainKey->masterKeyId;
     std::copy(master_id.begin(), master_id.begin() + 4, metadata.key_origin.fingerprint);
     // update the chain model in the database
     if (!batch.WriteHDChain(hdChain))
@@ -10,8 +10,14 @@
 #include "wallet/wallet.h"
 #include "wallet/walletdb.h"
 
+#include <atomic>
+
+class CScheduler;
+
 //! Default for -keypool
 static const unsigned int DEFAULT_KEYPOOL_SIZE = 100;
+//! Number of keys derived by the background key pool top-up each time it holds cs_wallet
+static const int64_t KEYPOOL_TOPUP_CHUNK = 100;
 static const uint32_t BIP32_HARDENED_KEY_LIMIT = 0x80000000;
 
 /*
@@ -86,6 +92,15 @@ public:
       */
     bool TopUp(unsigned int size = 0);
 
+    /** Makes sure that the keys drawn from the pool are replaced: the pools are topped up in the background when
+      * a scheduler is set and none of them is empty, so that the caller doesn't wait for the derivation of the
+      * new keys, and synchronously otherwise.
+      */
+    bool MaybeTopUp();
+
+    //! Set the scheduler running the background key pool top-ups
+    void SetScheduler(CScheduler* _scheduler) { scheduler = _scheduler; }
+
     //! Mark unused addresses as being used
     void MarkUnusedAddresses(const CScript& script);
 
@@ -141,6 +156,16 @@ private:
     // Tracks keypool indexes to CKeyIDs of keys that have been taken out of the keypool but may be returned to it
     std::map<int64_t, CKeyID> m_index_to_reserved_key;
 
+    /* Background key pool top-up */
+    CScheduler* scheduler{nullptr};
+    std::atomic<bool> fTopUpScheduled{false};
+
+    /* Key at m/purpose'/coin_type'/account'/change of a HD chain, derived once for a batch of new pool keys */
+    struct ChainKey {
+        CExtKey extKey;
+        CKeyID masterKeyId;
+    };
+
     /* */
     bool AddKeyPubKeyInner(const CKey& key, const CPubKey &pubkey);
 
@@ -149,9 +174,21 @@ private:
     /* Complete me */
     void AddKeypoolPubkeyWithDB(const CPubKey& pubkey, const uint8_t& type, WalletBatch& batch);
     void GeneratePool(WalletBatch& batch, int64_t targetSize, const uint8_t& type);
-
+    CPubKey GenerateNewKey(WalletBatch& batch, const uint8_t& type, const ChainKey* pChainKey);
+
+    //! Target size of the pools, kpSize or -keypool when it's zero
+    unsigned int GetKeyPoolTargetSize(unsigned int kpSize) const;
+    /* Derives at most nMaxKeys of the keys missing to reach nTargetSize in the pools, committing them to the
+       database at once. Returns false if no key can be generated (locked wallet), throws if the writes fail */
+    bool TopUpKeys(unsigned int nTargetSize, int64_t nMaxKeys, int64_t& nStillMissing);
+    /* Scheduler task: tops up the pools, releasing cs_wallet every KEYPOOL_TOPUP_CHUNK keys. Stops, logging it, if the writes fail */
+    void BackgroundTopUp();
+
+    /* HD derive the key of the internal, external or staking chain */
+    void DeriveChainKey(const uint8_t& type, ChainKey& chainKey);
     /* HD derive new child key (on internal or external chain) */
-    void DeriveNewChildKey(WalletBatch &batch, CKeyMetadata& metadata, CKey& secret, const uint8_t& type = HDChain::ChangeType::EXTERNAL);
+    void DeriveNewChildKey(WalletBatch &batch, CKeyMetadata& metadata, CKey& secret, const uint8_t& type = HDChain::ChangeType::EXTERNAL,
+                           const ChainKey* pChainKey = nullptr);
 
     /**
      * Marks all keys in the keypool up to and including reserve_key as used.
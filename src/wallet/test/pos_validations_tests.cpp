@@ -438,4 +438,44 @@ BOOST_FIXTURE_TEST_CASE(created_on_fork_tests, TestPoSChainSetup)
     BOOST_CHECK(ProcessNewBlock(pblockI, nullptr));
 }
 
+BOOST_FIXTURE_TEST_CASE(reserved_coins_tests, TestPoSChainSetup)
+{
+    const CTxDestination dest = *pwalletMain->getNewAddress("").getObjResult();
+    CAmount nFeeRet = 0;
+    std::string strFailReason;
+    auto isReserved = [&](const CTransactionRef& tx) {
+        LOCK(pwalletMain->cs_wallet);
+        for (const CTxIn& in : tx->vin) {
+            if (!pwalletMain->IsReservedCoin(in.prevout.hash, in.prevout.n)) return false;
+        }
+        return true;
+    };
+
+    // The coins selected by a transaction not committed yet aren't selected by the next ones
+    CTransactionRef tx1, tx2;
+    CReserveKey reservekey2(pwalletMain.get());
+    {
+        CReserveKey reservekey1(pwalletMain.get());
+        BOOST_CHECK(pwalletMain->CreateTransaction(GetScriptForDestination(dest), 249 * COIN, tx1, reservekey1, nFeeRet, strFailReason));
+        BOOST_CHECK(isReserved(tx1));
+        BOOST_CHECK(pwalletMain->CreateTransaction(GetScriptForDestination(dest), 249 * COIN, tx2, reservekey2, nFeeRet, strFailReason));
+        BOOST_CHECK(isReserved(tx2));
+        for (const CTxIn& in : tx2->vin) {
+            for (const CTxIn& in1 : tx1->vin) {
+                BOOST_CHECK(in.prevout != in1.prevout);
+            }
+        }
+    }
+    // Released with the reserve key of the transaction dropped, and by the commit of the other one
+    for (const CTxIn& in : tx1->vin) {
+        BOOST_CHECK(!WITH_LOCK(pwalletMain->cs_wallet, return pwalletMain->IsReservedCoin(in.prevout.hash, in.prevout.n)));
+    }
+    pwalletMain->CommitTransaction(tx2, reservekey2, nullptr);
+    LOCK(pwalletMain->cs_wallet);
+    for (const CTxIn& in : tx2->vin) {
+        BOOST_CHECK(!pwalletMain->IsReservedCoin(in.prevout.hash, in.prevout.n));
+        BOOST_CHECK(pwalletMain->IsSpent(in.prevout));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
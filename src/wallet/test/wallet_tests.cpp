@@ -339,6 +339,54 @@ BOOST_AUTO_TEST_CASE(coin_selection_tests)
     empty_wallet();
 }
 
+static std::vector<size_t> SelectBnB(const std::vector<CAmount>& vValues, CAmount nInputFee, CAmount nLongTermFee,
+                                     CAmount nTarget, CAmount nCostOfChange, bool& fFound)
+{
+    std::vector<CInputCoin> vPool;
+    for (size_t i = 0; i < vValues.size(); i++) {
+        vPool.emplace_back(i, vValues[i], nInputFee, nLongTermFee);
+    }
+    SortCoinsForBnB(vPool);
+    std::vector<size_t> vSelected;
+    CAmount nValueRet;
+    fFound = SelectCoinsBnB(vPool, nTarget, nCostOfChange, vSelected, nValueRet);
+    CAmount nTotal = 0;
+    for (size_t i : vSelected) nTotal += vValues[i];
+    BOOST_CHECK_EQUAL(nTotal, nValueRet);
+    std::sort(vSelected.begin(), vSelected.end());
+    return vSelected;
+}
+
+BOOST_AUTO_TEST_CASE(bnb_coin_selection_tests)
+{
+    bool fFound;
+    const std::vector<CAmount> vValues = {1 * CENT, 2 * CENT, 3 * CENT, 4 * CENT, 15 * CENT};
+
+    // Exact matches, without fees
+    BOOST_CHECK(SelectBnB(vValues, 0, 0, 15 * CENT, 0, fFound) == std::vector<size_t>({4}) && fFound);
+    BOOST_CHECK(SelectBnB(vValues, 0, 0, 10 * CENT, 0, fFound) == std::vector<size_t>({0, 1, 2, 3}) && fFound);
+    BOOST_CHECK(SelectBnB(vValues, 0, 0, 25 * CENT, 0, fFound) == std::vector<size_t>({0, 1, 2, 3, 4}) && fFound);
+    BOOST_CHECK(SelectBnB(vValues, 0, 0, 7 * CENT, 0, fFound).size() >= 2 && fFound);
+    // Nothing in the window
+    SelectBnB({3 * CENT, 5 * CENT}, 0, 0, 4 * CENT, 0, fFound);
+    BOOST_CHECK(!fFound);
+    // ...unless the cost of change covers the excess
+    BOOST_CHECK(SelectBnB({3 * CENT, 5 * CENT}, 0, 0, 4 * CENT, 1 * CENT, fFound) == std::vector<size_t>({1}) && fFound);
+    // Not enough funds
+    SelectBnB(vValues, 0, 0, 26 * CENT, 1 * CENT, fFound);
+    BOOST_CHECK(!fFound);
+
+    // Effective values: with an input fee of 1000, 10 cents exactly come from the 10 cents + 1000 coin
+    BOOST_CHECK(SelectBnB({5 * CENT + 1000, 10 * CENT + 1000}, 1000, 1000, 10 * CENT, 0, fFound) == std::vector<size_t>({1}) && fFound);
+    // and 15 cents from both
+    BOOST_CHECK(SelectBnB({5 * CENT + 1000, 10 * CENT + 1000}, 1000, 1000, 15 * CENT, 0, fFound) == std::vector<size_t>({0, 1}) && fFound);
+
+    // Waste: with fees above the long term ones, the fewest inputs are preferred, and the most of them otherwise
+    const std::vector<CAmount> vChoice = {2 * CENT + 1000, 2 * CENT + 1000, 2 * CENT + 1000, 6 * CENT + 1000};
+    BOOST_CHECK(SelectBnB(vChoice, 1000, 0, 6 * CENT, 0, fFound) == std::vector<size_t>({3}) && fFound);
+    BOOST_CHECK(SelectBnB(vChoice, 1000, 2000, 6 * CENT, 0, fFound) == std::vector<size_t>({0, 1, 2}) && fFound);
+}
+
 static void AddKey(CWallet& wallet, const CKey& key)
 {
     LOCK(wallet.cs_wallet);
@@ -654,4 +702,188 @@ BOOST_AUTO_TEST_CASE(cached_balances_tests)
 
 }
 
+/**
+ * Validates that the wallet balances, cached between the changes of the wallet, follow:
+ * 1) the confirmation of a received tx.
+ * 2) the spend of one of the received outputs.
+ */
+BOOST_AUTO_TEST_CASE(cached_wallet_balances_tests)
+{
+    CAmount nCredit = 20 * COIN;
+
+    CWallet wallet("testWallet1", WalletDatabase::CreateMock());
+    bool fFirstRun;
+    BOOST_CHECK_EQUAL(wallet.LoadWallet(fFirstRun), DB_LOAD_OK);
+    LOCK2(cs_main, wallet.cs_wallet);
+    wallet.SetMinVersion(FEATURE_PRE_SPLIT_KEYPOOL);
+    wallet.SetupSPKM(false);
+    wallet.SetLastBlockProcessed(chainActive.Tip());
+
+    auto res = wallet.getNewAddress("receiving_address");
+    BOOST_ASSERT(res);
+    CTxDestination receivingAddr = *res.getObjResult();
+    CTxOut creditOut(nCredit / 2, GetScriptForDestination(receivingAddr));
+    CWalletTx& wtxCredit = ReceiveBalanceWith({creditOut, creditOut}, wallet);
+
+    // Not trusted yet (unconfirmed, not in the mempool)
+    BOOST_CHECK_EQUAL(wallet.GetAvailableBalance(), 0);
+    BOOST_CHECK_EQUAL(wallet.GetBalance().m_mine_trusted, 0);
+
+    // 1) Confirm it
+    SimpleFakeMine(wtxCredit, wallet);
+    BOOST_CHECK_EQUAL(wallet.GetAvailableBalance(), nCredit);
+    BOOST_CHECK_EQUAL(wallet.GetAvailableBalance(), nCredit);
+    BOOST_CHECK_EQUAL(wallet.GetBalance().m_mine_trusted, nCredit);
+
+    // 2) Spend one of the outputs
+    CKey key;
+    key.MakeNewKey(true);
+    std::vector<CTxIn> vinDebit = {CTxIn(COutPoint(wtxCredit.GetHash(), 0))};
+    std::vector<CTxOut> voutDebit = {CTxOut(nCredit / 2, GetScriptForDestination(key.GetPubKey().GetID()))};
+    BuildAndLoadTxToWallet(vinDebit, voutDebit, wallet);
+    // The available credit of the tx is still cached, break it
+    wtxCredit.MarkDirty();
+    BOOST_CHECK_EQUAL(wallet.GetAvailableBalance(), nCredit / 2);
+    BOOST_CHECK_EQUAL(wallet.GetBalance().m_mine_trusted, nCredit / 2);
+}
+
+/**
+ * Validates that the P2CS outputs index of the wallet follows:
+ * 1) the reception of a delegation.
+ * 2) its spend.
+ */
+BOOST_AUTO_TEST_CASE(p2cs_outputs_index_tests)
+{
+    CAmount nCredit = 20 * COIN;
+
+    CWallet wallet("testWallet1", WalletDatabase::CreateMock());
+    bool fFirstRun;
+    BOOST_CHECK_EQUAL(wallet.LoadWallet(fFirstRun), DB_LOAD_OK);
+    LOCK2(cs_main, wallet.cs_wallet);
+    wallet.SetMinVersion(FEATURE_PRE_SPLIT_KEYPOOL);
+    wallet.SetupSPKM(false);
+    wallet.SetLastBlockProcessed(chainActive.Tip());
+
+    auto res = wallet.getNewAddress("owner_address");
+    BOOST_ASSERT(res);
+    const CKeyID ownerId = boost::get<CKeyID>(*res.getObjResult());
+    CKey stakerKey;
+    stakerKey.MakeNewKey(true);
+    std::vector<COutput> vCoins;
+    wallet.GetAvailableP2CSCoins(vCoins);
+    BOOST_CHECK(vCoins.empty());
+
+    // 1) Receive and confirm a delegation
+    CTxOut delegationOut(nCredit, GetScriptForStakeDelegation(stakerKey.GetPubKey().GetID(), ownerId));
+    CWalletTx& wtxDelegation = ReceiveBalanceWith({delegationOut}, wallet);
+    CBlockIndex* pindex = SimpleFakeMine(wtxDelegation, wallet);
+    wallet.GetAvailableP2CSCoins(vCoins);
+    BOOST_CHECK_EQUAL(vCoins.size(), 1);
+    BOOST_CHECK(vCoins[0].fSpendable);
+    BOOST_CHECK_EQUAL(wallet.GetDelegatedBalance(), nCredit);
+    BOOST_CHECK_EQUAL(wallet.GetColdStakingBalance(), 0);
+    size_t nIndexed = 0;
+    wallet.ForEachP2CSOutput([&](const CWalletTx& wtx, uint32_t n, const P2CSOutputKeys& keys) {
+        BOOST_CHECK(wtx.GetHash() == wtxDelegation.GetHash());
+        BOOST_CHECK(keys.stakerId == stakerKey.GetPubKey().GetID());
+        BOOST_CHECK(keys.ownerId == ownerId);
+        nIndexed++;
+    });
+    BOOST_CHECK_EQUAL(nIndexed, 1);
+
+    // 2) Spend it, in the same block
+    CKey key;
+    key.MakeNewKey(true);
+    std::vector<CTxIn> vinDebit = {CTxIn(COutPoint(wtxDelegation.GetHash(), 0))};
+    std::vector<CTxOut> voutDebit = {CTxOut(nCredit, GetScriptForDestination(key.GetPubKey().GetID()))};
+    CWalletTx& wtxSpend = BuildAndLoadTxToWallet(vinDebit, voutDebit, wallet);
+    wtxSpend.m_confirm = CWalletTx::Confirmation(CWalletTx::Status::CONFIRMED, pindex->nHeight, pindex->GetBlockHash(), 1);
+    // The available credit of the tx is still cached, break it
+    wtxDelegation.MarkDirty();
+    wallet.GetAvailableP2CSCoins(vCoins);
+    BOOST_CHECK(vCoins.empty());
+    BOOST_CHECK_EQUAL(wallet.GetDelegatedBalance(), 0);
+    // Spent by a confirmed tx, the output left the index
+    nIndexed = 0;
+    wallet.ForEachP2CSOutput([&](const CWalletTx& wtx, uint32_t n, const P2CSOutputKeys& keys) { nIndexed++; });
+    BOOST_CHECK_EQUAL(nIndexed, 0);
+}
+
+static std::vector<CWalletTx> ReadWalletTxs(CWallet& wallet)
+{
+    std::vector<uint256> vTxHash;
+    std::vector<CWalletTx> vWtx;
+    BOOST_CHECK_EQUAL(WalletBatch(wallet.GetDBHandle()).FindWalletTx(&wallet, vTxHash, vWtx), DB_LOAD_OK);
+    return vWtx;
+}
+
+/**
+ * Validates that the txs added inside a BatchWrites are written at the end of the outermost one, with their order positions.
+ */
+BOOST_AUTO_TEST_CASE(batch_writes_tests)
+{
+    CWallet wallet("testWallet1", WalletDatabase::CreateMock());
+    bool fFirstRun;
+    BOOST_CHECK_EQUAL(wallet.LoadWallet(fFirstRun), DB_LOAD_OK);
+    LOCK(wallet.cs_wallet);
+
+    std::vector<uint256> vHashes;
+    {
+        CWallet::BatchWrites outerWrites(wallet);
+        {
+            CWallet::BatchWrites innerWrites(wallet);
+            for (int i = 0; i < 3; i++) {
+                CMutableTransaction mtx;
+                mtx.vin.emplace_back(COutPoint(InsecureRand256(), 0));
+                mtx.vout.emplace_back(i + 1, CScript() << OP_TRUE);
+                BOOST_CHECK(wallet.AddToWallet(CWalletTx(&wallet, MakeTransactionRef(mtx))));
+                vHashes.emplace_back(mtx.GetHash());
+            }
+            // An update of a pending tx is written once
+            CWalletTx wtxUpdate(wallet.mapWallet.at(vHashes[0]));
+            wtxUpdate.fFromMe = true;
+            BOOST_CHECK(wallet.AddToWallet(wtxUpdate));
+        }
+        // Nothing written until the outermost scope ends
+        BOOST_CHECK(ReadWalletTxs(wallet).empty());
+    }
+
+    const std::vector<CWalletTx>& vWtx = ReadWalletTxs(wallet);
+    BOOST_CHECK_EQUAL(vWtx.size(), vHashes.size());
+    for (const CWalletTx& wtx : vWtx) {
+        BOOST_CHECK(std::find(vHashes.begin(), vHashes.end(), wtx.GetHash()) != vHashes.end());
+        BOOST_CHECK_EQUAL(wtx.nOrderPos, wallet.mapWallet.at(wtx.GetHash()).nOrderPos);
+        BOOST_CHECK_EQUAL((bool)wtx.fFromMe, wtx.GetHash() == vHashes[0]);
+    }
+    BOOST_CHECK_EQUAL(wallet.nOrderPosNext, (int64_t)vHashes.size());
+}
+
+/**
+ * Validates that the cached IsMine results of the scripts follow the keys and the watch-only scripts of the wallet.
+ */
+BOOST_AUTO_TEST_CASE(cached_ismine_tests)
+{
+    CWallet wallet("testWallet1", WalletDatabase::CreateMock());
+    bool fFirstRun;
+    BOOST_CHECK_EQUAL(wallet.LoadWallet(fFirstRun), DB_LOAD_OK);
+    LOCK(wallet.cs_wallet);
+
+    CKey key;
+    key.MakeNewKey(true);
+    CTxOut out(COIN, GetScriptForDestination(key.GetPubKey().GetID()));
+    BOOST_CHECK_EQUAL(wallet.IsMine(out), ISMINE_NO);
+    BOOST_CHECK_EQUAL(wallet.IsMine(out), ISMINE_NO);
+
+    // A new watch-only script breaks the cached result
+    BOOST_CHECK(wallet.AddWatchOnly(out.scriptPubKey));
+    BOOST_CHECK_EQUAL(wallet.IsMine(out), ISMINE_WATCH_ONLY);
+    BOOST_CHECK(wallet.RemoveWatchOnly(out.scriptPubKey));
+    BOOST_CHECK_EQUAL(wallet.IsMine(out), ISMINE_NO);
+
+    // And so does a new key
+    BOOST_CHECK(wallet.AddKeyPubKey(key, key.GetPubKey()));
+    BOOST_CHECK_EQUAL(wallet.IsMine(out), ISMINE_SPENDABLE);
+    BOOST_CHECK_EQUAL(wallet.IsMine(out), ISMINE_SPENDABLE);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
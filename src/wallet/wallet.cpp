@@ -15,6 +15,7 @@
 
 #include "checkpoints.h"
 #include "coincontrol.h"
+#include "ctpl_stl.h"
 #include "evo/providertx.h"
 #include "guiinterfaceutil.h"
 #include "policy/policy.h"
@@ -200,7 +201,7 @@ CallResult<CTxDestination> CWallet::getNewAddress(const std::string& addressLabe
 
     // Refill keypool if wallet is unlocked
     if (!IsLocked())
-        TopUpKeyPool();
+        MaybeTopUpKeyPool();
 
     uint8_t type = (addrType == CChainParams::Base58Type::STAKING_ADDRESS ? HDChain::ChangeType::STAKING : HDChain::ChangeType::EXTERNAL);
     CPubKey newKey;
@@ -402,6 +403,7 @@ bool CWallet::Lock()
     {
         LOCK(cs_KeyStore);
         vMasterKey.clear();
+        m_sspk_man->ClearCoinTypeKeyCache();
     }
 
     NotifyStatusChanged(this);
@@ -415,21 +417,19 @@ bool CWallet::Unlock(const CKeyingMaterial& vMasterKeyIn)
         if (!SetCrypted())
             return false;
 
-        bool keyPass = false;
-        bool keyFail = false;
-        CryptedKeyMap::const_iterator mi = mapCryptedKeys.begin();
-        for (; mi != mapCryptedKeys.end(); ++mi) {
-            const CPubKey& vchPubKey = (*mi).second.first;
-            const std::vector<unsigned char>& vchCryptedSecret = (*mi).second.second;
-            CKey key;
-            if (!DecryptKey(vMasterKeyIn, vchCryptedSecret, vchPubKey, key)) {
-                keyFail = true;
-                break;
-            }
-            keyPass = true;
-            if (fDecryptionThoroughlyChecked)
-                break;
+        // The first key checks the passphrase. The first unlock then checks all the others, in parallel.
+        std::vector<CryptedKeyMap::const_iterator> vKeys;
+        vKeys.reserve(fDecryptionThoroughlyChecked ? 1 : mapCryptedKeys.size());
+        for (auto mi = mapCryptedKeys.begin(); mi != mapCryptedKeys.end(); ++mi) {
+            vKeys.push_back(mi);
+            if (fDecryptionThoroughlyChecked) break;
         }
+        const auto checkKey = [&](size_t i) {
+            CKey key;
+            return DecryptKey(vMasterKeyIn, vKeys[i]->second.second, vKeys[i]->second.first, key);
+        };
+        const bool keyPass = !vKeys.empty() && checkKey(0);
+        const bool keyFail = !keyPass || !CheckCryptedKeys(vKeys.size() - 1, [&](size_t i) { return checkKey(i + 1); });
 
         if (keyPass && keyFail) {
             LogPrintf("The wallet is probably corrupted: Some keys decrypt but not all.\n");
@@ -746,6 +746,7 @@ void CWallet::AddToSpends(const COutPoint& outpoint, const uint256& wtxid)
 {
     mapTxSpends.emplace(outpoint, wtxid);
     setLockedCoins.erase(outpoint);
+    MarkBalancesDirty();
 
     std::pair<TxSpends::iterator, TxSpends::iterator> range;
     range = mapTxSpends.equal_range(outpoint);
@@ -895,13 +896,81 @@ void CWallet::MarkDirty()
         LOCK(cs_wallet);
         for (std::pair<const uint256, CWalletTx> & item : mapWallet)
             item.second.MarkDirty();
+        fUnspentCandidatesValid = false;
+        fP2CSOutputsValid = false;
+        MarkBalancesDirty();
+        m_sspk_man->MarkUnspentNotesIndexDirty();
+    }
+}
+
+CWallet::BatchWrites::BatchWrites(CWallet& _wallet) : wallet(_wallet)
+{
+    AssertLockHeld(wallet.cs_wallet);
+    wallet.nBatchWrites++;
+}
+
+CWallet::BatchWrites::~BatchWrites()
+{
+    AssertLockHeld(wallet.cs_wallet);
+    if (--wallet.nBatchWrites == 0) {
+        wallet.WritePendingTxs();
+    }
+}
+
+bool CWallet::WritePendingTxs(WalletBatch& batch, bool fKeepFailed)
+{
+    AssertLockHeld(cs_wallet);
+    bool ret = true;
+    for (auto it = setPendingTxWrites.begin(); it != setPendingTxWrites.end();) {
+        auto mi = mapWallet.find(*it);
+        // erased meanwhile
+        const bool fWritten = mi == mapWallet.end() || batch.WriteTx(mi->second);
+        if (!fWritten) {
+            LogPrintf("%s: Failed to write transaction %s\n", __func__, it->ToString());
+            ret = false;
+        }
+        it = (fKeepFailed && fWritten) ? setPendingTxWrites.erase(it) : std::next(it);
+    }
+    if (fPendingOrderPosWrite) {
+        const bool fWritten = batch.WriteOrderPosNext(nOrderPosNext);
+        if (!fWritten) ret = false;
+        if (fKeepFailed && fWritten) fPendingOrderPosWrite = false;
+    }
+    return ret;
+}
+
+bool CWallet::WritePendingTxs()
+{
+    AssertLockHeld(cs_wallet);
+    if (setPendingTxWrites.empty() && !fPendingOrderPosWrite) return true;
+
+    // Do not flush the wallet here for performance reasons
+    WalletBatch batch(*database, "r+", false);
+    if (batch.TxnBegin()) {
+        if (WritePendingTxs(batch, false) && batch.TxnCommit()) {
+            setPendingTxWrites.clear();
+            fPendingOrderPosWrite = false;
+            return true;
+        }
+        batch.TxnAbort();
+        LogPrintf("%s: Failed to commit the write of %d transactions, writing them one by one\n", __func__, setPendingTxWrites.size());
+    } else {
+        LogPrintf("%s: Couldn't start atomic write, writing the transactions one by one\n", __func__);
     }
+    // The writes that fail are kept, and retried at the end of the next BatchWrites (or at the flush of the wallet)
+    if (!WritePendingTxs(batch, true)) {
+        LogPrintf("%s: Error: %d transactions could not be written to the wallet database, will retry\n", __func__, setPendingTxWrites.size());
+        return false;
+    }
+    return true;
 }
 
 bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
 {
     LOCK(cs_wallet);
-    WalletBatch batch(*database, "r+", fFlushOnClose);
+    // Inside a BatchWrites, the tx is written at its end
+    const bool fDeferWrites = nBatchWrites > 0;
+    std::unique_ptr<WalletBatch> batch(fDeferWrites ? nullptr : new WalletBatch(*database, "r+", fFlushOnClose));
     const uint256& hash = wtxIn.GetHash();
 
     // Inserts only if not already there, returns tx inserted or tx found
@@ -911,9 +980,16 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
     // Sapling
     m_sspk_man->UpdateNullifierNoteMapWithTx(wtx);
     bool fInsertedNew = ret.second;
+    if (fP2CSOutputsValid) AddToP2CSOutputs(wtx);
     if (fInsertedNew) {
+        setUnspentCandidates.emplace(hash);
         wtx.nTimeReceived = GetAdjustedTime();
-        wtx.nOrderPos = IncOrderPosNext(&batch);
+        if (fDeferWrites) {
+            wtx.nOrderPos = nOrderPosNext++;
+            fPendingOrderPosWrite = true;
+        } else {
+            wtx.nOrderPos = IncOrderPosNext(batch.get());
+        }
         wtxOrdered.emplace(wtx.nOrderPos, &wtx);
         wtx.UpdateTimeSmart();
         AddToSpends(hash);
@@ -942,13 +1018,20 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
         }
     }
 
+    if ((fInsertedNew || fUpdated) && wtx.CanBeResent()) {
+        setResendCandidates.emplace(wtx.nTimeReceived, hash);
+    }
+
     //// debug print
     LogPrintf("AddToWallet %s  %s%s\n", wtxIn.GetHash().ToString(), (fInsertedNew ? "new" : ""), (fUpdated ? "update" : ""));
 
     // Write to disk
     if (fInsertedNew || fUpdated) {
-        if (!batch.WriteTx(wtx))
+        if (fDeferWrites) {
+            setPendingTxWrites.emplace(hash);
+        } else if (!batch->WriteTx(wtx)) {
             return false;
+        }
     }
 
     // Break debit/credit balance caches:
@@ -1011,6 +1094,7 @@ bool CWallet::LoadToWallet(CWalletTx& wtxIn)
     m_sspk_man->UpdateNullifierNoteMapWithTx(wtx);
     wtxOrdered.emplace(wtx.nOrderPos, &wtx);
     AddToSpends(hash);
+    if (fP2CSOutputsValid) AddToP2CSOutputs(wtx);
     for (const CTxIn& txin : wtx.tx->vin) {
         auto it = mapWallet.find(txin.prevout.hash);
         if (it != mapWallet.end()) {
@@ -1037,17 +1121,22 @@ bool CWallet::FindNotesDataAndAddMissingIVKToKeystore(const CTransaction& tx, Op
     return true;
 }
 
-void CWallet::AddExternalNotesDataToTx(CWalletTx& wtx) const
+bool CWallet::AddExternalNotesDataToTx(CWalletTx& wtx) const
 {
+    bool fAdded = false;
     if (HasSaplingSPKM() && wtx.tx->IsShieldedTx()) {
         const uint256& txId = wtx.GetHash();
-        // Add the external outputs.
+        // Add the external outputs, all recovered with the same ovks
+        Optional<std::set<uint256>> ovks;
         SaplingOutPoint op {txId, 0};
         for (unsigned int i = 0; i < wtx.tx->sapData->vShieldedOutput.size(); i++) {
             op.n = i;
-            if (wtx.mapSaplingNoteData.count(op)) continue;     // internal output
-            auto recovered = GetSaplingScriptPubKeyMan()->TryToRecoverNote(wtx, op);
+            if (wtx.mapSaplingNoteData.count(op)) continue;     // internal output (or already recovered)
+            if (!ovks) ovks = GetSaplingScriptPubKeyMan()->GetRecoveryOVKs(wtx);
+            if (ovks->empty()) break;
+            auto recovered = wtx.RecoverSaplingNote(op, *ovks);
             if (recovered) {
+                fAdded = true;
                 // Always true for 'IsFromMe' transactions
                 wtx.mapSaplingNoteData[op].address = recovered->second;
                 wtx.mapSaplingNoteData[op].amount = recovered->first.value();
@@ -1059,6 +1148,7 @@ void CWallet::AddExternalNotesDataToTx(CWalletTx& wtx) const
             }
         }
     }
+    return fAdded;
 }
 
 /**
@@ -1236,7 +1326,11 @@ void CWallet::MarkConflicted(const uint256& hashBlock, int conflicting_height, c
             wtx.m_confirm.block_height = conflicting_height;
             wtx.setConflicted();
             wtx.MarkDirty();
-            batch.WriteTx(wtx);
+            if (nBatchWrites > 0) {
+                setPendingTxWrites.emplace(now);
+            } else {
+                batch.WriteTx(wtx);
+            }
             // Iterate over all its outputs, and mark transactions in the wallet that spend them conflicted too
             TxSpends::const_iterator iter = mapTxSpends.lower_bound(COutPoint(now, 0));
             while (iter != mapTxSpends.end() && iter->first.hash == now) {
@@ -1275,6 +1369,7 @@ void CWallet::TransactionAddedToMempool(const CTransactionRef& ptx)
     auto it = mapWallet.find(ptx->GetHash());
     if (it != mapWallet.end()) {
         it->second.fInMempool = true;
+        MarkBalancesDirty();
     }
 }
 
@@ -1283,6 +1378,7 @@ void CWallet::TransactionRemovedFromMempool(const CTransactionRef &ptx, MemPoolR
     auto it = mapWallet.find(ptx->GetHash());
     if (it != mapWallet.end()) {
         it->second.fInMempool = false;
+        MarkBalancesDirty();
     }
     // Handle transactions that were removed from the mempool because they
     // conflict with transactions in a newly connected block.
@@ -1320,10 +1416,14 @@ void CWallet::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const
 {
     {
         LOCK2(cs_main, cs_wallet);
+        // Write the txs of the block at once
+        BatchWrites batchWrites(*this);
 
         m_last_block_processed = pindex->GetBlockHash();
         m_last_block_processed_time = pindex->GetBlockTime();
         m_last_block_processed_height = pindex->nHeight;
+        // The depth of every confirmed tx changed
+        MarkBalancesDirty();
         for (size_t index = 0; index < pblock->vtx.size(); index++) {
             CWalletTx::Confirmation confirm(CWalletTx::Status::CONFIRMED, m_last_block_processed_height,
                                             m_last_block_processed, index);
@@ -1360,6 +1460,7 @@ void CWallet::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const
 void CWallet::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const uint256& blockHash, int nBlockHeight, int64_t blockTime)
 {
     LOCK(cs_wallet);
+    BatchWrites batchWrites(*this);
 
     // At block disconnection, this will change an abandoned transaction to
     // be unconfirmed, whether or not the transaction is added back to the mempool.
@@ -1368,6 +1469,12 @@ void CWallet::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, con
     m_last_block_processed_height = nBlockHeight - 1;
     m_last_block_processed_time = blockTime;
     m_last_block_processed = blockHash;
+    // Outputs spent in the disconnected block can be unspent again, and conflicted txes unconfirmed
+    fUnspentCandidatesValid = false;
+    fResendCandidatesValid = false;
+    fP2CSOutputsValid = false;
+    MarkBalancesDirty();
+    m_sspk_man->MarkUnspentNotesIndexDirty();
     for (const CTransactionRef& ptx : pblock->vtx) {
         CWalletTx::Confirmation confirm(CWalletTx::Status::UNCONFIRMED, /* block_height */ 0, {}, /* nIndex */ 0);
         SyncTransaction(ptx, confirm);
@@ -1375,7 +1482,11 @@ void CWallet::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, con
 
     if (Params().GetConsensus().NetworkUpgradeActive(nBlockHeight, Consensus::UPGRADE_V5_0)) {
         // Update Sapling cached incremental witnesses
-        m_sspk_man->DecrementNoteWitnesses(mapBlockIndex[blockHash]);
+        // Without cs_main, taken before cs_wallet: only the height of the disconnected block is read
+        const CBlockIndex* pindex = LookupBlockIndexShared(blockHash);
+        if (pindex) {
+            m_sspk_man->DecrementNoteWitnesses(pindex);
+        }
         m_sspk_man->UpdateSaplingNullifierNoteMapForBlock(pblock.get());
     }
 }
@@ -1438,8 +1549,10 @@ void CWallet::EraseFromWallet(const uint256& hash)
 {
     {
         LOCK(cs_wallet);
-        if (mapWallet.erase(hash))
+        if (mapWallet.erase(hash)) {
             WalletBatch(*database).EraseTx(hash);
+            MarkBalancesDirty();
+        }
         LogPrintf("%s: Erased wtx %s from wallet\n", __func__, hash.GetHex());
     }
     return;
@@ -1504,7 +1617,7 @@ bool CWallet::IsChange(const CTxOut& txout) const
     // a better way of identifying which outputs are 'the send' and which are
     // 'the change' will need to be implemented (maybe extend CWalletTx to remember
     // which output, if any, was change).
-    if (::IsMine(*this, txout.scriptPubKey)) {
+    if (IsMine(txout)) {
         CTxDestination address;
         if (!ExtractDestination(txout.scriptPubKey, address))
             return true;
@@ -1538,8 +1651,9 @@ void CWalletTx::UpdateTimeSmart()
 {
     nTimeSmart = nTimeReceived;
     if (!m_confirm.hashBlock.IsNull()) {
-        if (mapBlockIndex.count(m_confirm.hashBlock)) {
-            nTimeSmart = mapBlockIndex.at(m_confirm.hashBlock)->GetBlockTime();
+        const CBlockIndex* pindex = LookupBlockIndexShared(m_confirm.hashBlock);
+        if (pindex) {
+            nTimeSmart = pindex->GetBlockTime();
         } else
             LogPrintf("%s : found %s in block %s not in index\n", __func__, GetHash().ToString(), m_confirm.hashBlock.ToString());
     }
@@ -1739,6 +1853,15 @@ void CWalletTx::GetAmounts(std::list<COutputEntry>& listReceived,
     CAmount& nFee,
     const isminefilter& filter) const
 {
+    const uint64_t nAddressBookGeneration = pwallet ? pwallet->GetAddressBookGeneration() : 0;
+    std::shared_ptr<const CachedOutputEntries> cached = m_output_entries;
+    if (cached && cached->filter == filter && cached->nAddressBookGeneration == nAddressBookGeneration) {
+        listReceived = cached->listReceived;
+        listSent = cached->listSent;
+        nFee = cached->nFee;
+        return;
+    }
+
     nFee = 0;
     listReceived.clear();
     listSent.clear();
@@ -1802,6 +1925,9 @@ void CWalletTx::GetAmounts(std::list<COutputEntry>& listReceived,
         if (fIsMine & filter)
             listReceived.push_back(output);
     }
+
+    m_output_entries = std::make_shared<const CachedOutputEntries>(
+            CachedOutputEntries{filter, nAddressBookGeneration, listReceived, listSent, nFee});
 }
 
 bool CWallet::Upgrade(std::string& error, const int prevVersion)
@@ -1899,8 +2025,30 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, CBlock
             dProgressTip = Checkpoints::GuessVerificationProgress(tip, false);
         }
 
+        // Pipelined rescan: blocks are read from disk, and deserialized, ahead of time
+        // by a pool of reader threads, while this thread processes them in height order.
+        const int nReaders = std::max(1, std::min(GetNumCores() - 1, MAX_RESCAN_READER_THREADS));
+        ctpl::thread_pool readerPool(nReaders);
+        std::deque<std::pair<CBlockIndex*, std::future<std::shared_ptr<const CBlock>>>> prefetched;
+        CBlockIndex* pindexNextRead = pindexStart;
+        auto fillPrefetchWindow = [&]() {
+            while (pindexNextRead && prefetched.size() < RESCAN_PREFETCH_WINDOW) {
+                CBlockIndex* pindexRead = pindexNextRead;
+                prefetched.emplace_back(pindexRead, readerPool.push([pindexRead](int) {
+                    auto pblock = std::make_shared<CBlock>();
+                    if (!ReadBlockFromDisk(*pblock, pindexRead)) {
+                        return std::shared_ptr<const CBlock>();
+                    }
+                    return std::shared_ptr<const CBlock>(pblock);
+                }));
+                pindexNextRead = pindexRead == pindexStop ? nullptr : WITH_LOCK(cs_main, return chainActive.Next(pindexRead); );
+            }
+        };
+        fillPrefetchWindow();
+
         std::vector<uint256> myTxHashes;
-        while (pindex && !fAbortRescan) {
+        while (!prefetched.empty() && !fAbortRescan) {
+            pindex = prefetched.front().first;
             double gvp = 0;
             if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0) {
                 gvp = WITH_LOCK(cs_main, return Checkpoints::GuessVerificationProgress(pindex, false); );
@@ -1914,9 +2062,14 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, CBlock
                 break;
             }
 
-            CBlock block;
-            if (ReadBlockFromDisk(block, pindex)) {
+            std::shared_ptr<const CBlock> pblock = prefetched.front().second.get();
+            prefetched.pop_front();
+            fillPrefetchWindow();
+
+            if (pblock) {
+                const CBlock& block = *pblock;
                 LOCK2(cs_main, cs_wallet);
+                BatchWrites batchWrites(*this);
                 if (pindex && !chainActive.Contains(pindex)) {
                      // Abort scan if current block is no longer active, to prevent
                      // marking transactions as coming from the wrong block.
@@ -1950,13 +2103,20 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, CBlock
             }
             {
                 LOCK(cs_main);
-                pindex = chainActive.Next(pindex);
+                if (prefetched.empty()) {
+                    // The tip might have moved forward since the last block was queued
+                    pindexNextRead = chainActive.Next(pindex);
+                }
                 if (tip != chainActive.Tip()) {
                     tip = chainActive.Tip();
                     // in case the tip has changed, update progress max
                     dProgressTip = Checkpoints::GuessVerificationProgress(tip, false);
                 }
             }
+            fillPrefetchWindow();
+            if (prefetched.empty()) {
+                pindex = nullptr;
+            }
         }
 
         // Sapling
@@ -2016,20 +2176,23 @@ bool CWalletTx::InMempool() const
     return fInMempool;
 }
 
+bool CWalletTx::CanBeResent() const
+{
+    return !IsCoinBase() && !IsCoinStake() && GetDepthInMainChain() == 0 && !isAbandoned();
+}
+
 void CWalletTx::RelayWalletTransaction(CConnman* connman)
 {
-    if (!connman || IsCoinBase() || IsCoinStake()) {
+    if (!connman || !CanBeResent()) {
         // Nothing to do. Return early
         return;
     }
-    if (GetDepthInMainChain() == 0 && !isAbandoned()) {
-        const uint256& hash = GetHash();
-        LogPrintf("Relaying wtx %s\n", hash.ToString());
-        CInv inv(MSG_TX, hash);
-        connman->ForEachNode([&inv](CNode* pnode) {
-          pnode->PushInventory(inv);
-        });
-    }
+    const uint256& hash = GetHash();
+    LogPrintf("Relaying wtx %s\n", hash.ToString());
+    CInv inv(MSG_TX, hash);
+    connman->ForEachNode([&inv](CNode* pnode) {
+      pnode->PushInventory(inv);
+    });
 }
 
 std::set<uint256> CWalletTx::GetConflicts() const
@@ -2045,18 +2208,97 @@ std::set<uint256> CWalletTx::GetConflicts() const
 
 void CWallet::Flush(bool shutdown)
 {
+    // Last chance for the writes deferred by a BatchWrites that failed
+    WITH_LOCK(cs_wallet, WritePendingTxs());
     database->Flush(shutdown);
 }
 
+// Time over which the rebroadcasts of a resend are spread
+static const int64_t WALLET_RESEND_SPREAD = 5 * 60;
+
+void CWallet::ScheduleResends(int64_t nNow)
+{
+    LOCK(cs_wallet);
+    if (!fResendCandidatesValid) {
+        setResendCandidates.clear();
+        for (const auto& it : mapWallet) {
+            if (it.second.CanBeResent()) setResendCandidates.emplace(it.second.nTimeReceived, it.first);
+        }
+        fResendCandidatesValid = true;
+    }
+
+    // Walk them in chronological order, pruning the ones that can't be resent anymore
+    std::vector<uint256> vHashes;
+    for (auto it = setResendCandidates.begin(); it != setResendCandidates.end(); ) {
+        const auto mit = mapWallet.find(it->second);
+        if (mit == mapWallet.end() || !mit->second.CanBeResent()) {
+            it = setResendCandidates.erase(it);
+            continue;
+        }
+        // Don't rebroadcast until it's had plenty of time that
+        // it should have gotten in already by now.
+        if (nTimeBestReceived - (int64_t)it->first > 5 * 60) {
+            vHashes.emplace_back(it->second);
+        }
+        ++it;
+    }
+
+    // Random relay times, assigned in chronological order (the
+    // rebroadcasts not done yet are replaced by this resend)
+    std::vector<int64_t> vTimes;
+    for (size_t i = 0; i < vHashes.size(); i++) {
+        vTimes.emplace_back(nNow + GetRand(WALLET_RESEND_SPREAD));
+    }
+    std::sort(vTimes.begin(), vTimes.end());
+    mapResendSchedule.clear();
+    for (size_t i = 0; i < vHashes.size(); i++) {
+        mapResendSchedule.emplace_hint(mapResendSchedule.end(), vTimes[i], vHashes[i]);
+    }
+    nNextScheduledResend = mapResendSchedule.empty() ? std::numeric_limits<int64_t>::max() : mapResendSchedule.begin()->first;
+    LogPrintf("ResendWalletTransactions(): %d transactions to rebroadcast\n", vHashes.size());
+}
+
+void CWallet::RelayScheduledResends(CConnman* connman, int64_t nNow)
+{
+    std::vector<CInv> vInv;
+    {
+        LOCK(cs_wallet);
+        auto it = mapResendSchedule.begin();
+        for (; it != mapResendSchedule.end() && it->first <= nNow; ++it) {
+            const auto mit = mapWallet.find(it->second);
+            if (mit != mapWallet.end() && mit->second.CanBeResent()) {
+                vInv.emplace_back(MSG_TX, it->second);
+            }
+        }
+        mapResendSchedule.erase(mapResendSchedule.begin(), it);
+        nNextScheduledResend = mapResendSchedule.empty() ? std::numeric_limits<int64_t>::max() : mapResendSchedule.begin()->first;
+    }
+
+    // Outside of cs_wallet: each peer trickles its inventory on its own schedule
+    if (!connman) return;
+    for (const CInv& inv : vInv) {
+        LogPrintf("Relaying wtx %s\n", inv.hash.ToString());
+        connman->ForEachNode([&inv](CNode* pnode) {
+          pnode->PushInventory(inv);
+        });
+    }
+}
+
 void CWallet::ResendWalletTransactions(CConnman* connman)
 {
+    const int64_t nNow = GetTime();
+    // The rebroadcasts due of the last resend
+    if (nNow >= nNextScheduledResend) {
+        RelayScheduledResends(connman, nNow);
+    }
+
     // Do this infrequently and randomly to avoid giving away
     // that these are our transactions.
-    if (GetTime() < nNextResend) {
+    if (nNow < nNextResend) {
         return;
     }
     bool fFirst = (nNextResend == 0);
-    nNextResend = GetTime() + GetRand(30 * 60);
+    nNextResend = nNow + GetRand(30 * 60);
     if (fFirst) {
         return;
     }
@@ -2065,27 +2307,11 @@ void CWallet::ResendWalletTransactions(CConnman* connman)
     if (nTimeBestReceived < nLastResend) {
         return;
     }
-    nLastResend = GetTime();
+    nLastResend = nNow;
 
-    // Rebroadcast any of our txes that aren't in a block yet
-    LogPrintf("ResendWalletTransactions()\n");
-    {
-        LOCK(cs_wallet);
-        // Sort them in chronological order
-        std::multimap<unsigned int, CWalletTx*> mapSorted;
-        for (std::pair<const uint256, CWalletTx> & item : mapWallet) {
-            CWalletTx& wtx = item.second;
-            // Don't rebroadcast until it's had plenty of time that
-            // it should have gotten in already by now.
-            if (nTimeBestReceived - (int64_t)wtx.nTimeReceived > 5 * 60) {
-                mapSorted.emplace(wtx.nTimeReceived, &wtx);
-            }
-        }
-        for (std::pair<const unsigned int, CWalletTx*> & item : mapSorted) {
-            CWalletTx& wtx = *item.second;
-            wtx.RelayWalletTransaction(connman);
-        }
-    }
+    // Rebroadcast any of our txes that aren't in a block yet,
+    // spread over the next minutes
+    ScheduleResends(nNow);
 }
 
 void CWallet::UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload)
@@ -2106,6 +2332,12 @@ CWallet::Balance CWallet::GetBalance(const int min_depth) const
     Balance ret;
     {
         LOCK(cs_wallet);
+        // Read the generation before walking the wallet, so that a change made meanwhile invalidates the result
+        const uint64_t nGeneration = nBalancesGeneration;
+        auto itCache = mapBalanceStructCache.find(min_depth);
+        if (itCache != mapBalanceStructCache.end() && itCache->second.first == nGeneration) {
+            return itCache->second.second;
+        }
         std::set<uint256> trusted_parents;
         for (const auto& entry : mapWallet) {
             const CWalletTx& wtx = entry.second;
@@ -2126,17 +2358,39 @@ CWallet::Balance CWallet::GetBalance(const int min_depth) const
             }
             ret.m_mine_immature += wtx.GetImmatureCredit();
         }
+        mapBalanceStructCache[min_depth] = std::make_pair(nGeneration, ret);
     }
     return ret;
 }
 
-CAmount CWallet::loopTxsBalance(const std::function<void(const uint256&, const CWalletTx&, CAmount&)>& method) const
+CAmount CWallet::loopTxsBalance(const std::function<void(const uint256&, const CWalletTx&, CAmount&)>& method,
+                                const Optional<BalanceCacheKey>& key, bool fOnlyP2CS) const
 {
     CAmount nTotal = 0;
     {
         LOCK(cs_wallet);
-        for (const auto& it : mapWallet) {
-            method(it.first, it.second, nTotal);
+        const uint64_t nGeneration = nBalancesGeneration;
+        if (key) {
+            auto itCache = mapBalanceCache.find(*key);
+            if (itCache != mapBalanceCache.end() && itCache->second.first == nGeneration) {
+                return itCache->second.second;
+            }
+        }
+        if (fOnlyP2CS) {
+            // The indexed outputs are ordered by outpoint, so the outputs of each tx are consecutive
+            const CWalletTx* pLastTx = nullptr;
+            ForEachP2CSOutput([&](const CWalletTx& wtx, uint32_t n, const P2CSOutputKeys& keys) {
+                if (&wtx == pLastTx) return;
+                pLastTx = &wtx;
+                method(wtx.GetHash(), wtx, nTotal);
+            });
+        } else {
+            for (const auto& it : mapWallet) {
+                method(it.first, it.second, nTotal);
+            }
+        }
+        if (key) {
+            mapBalanceCache[*key] = std::make_pair(nGeneration, nTotal);
         }
     }
     return nTotal;
@@ -2165,15 +2419,15 @@ CAmount CWallet::GetAvailableBalance(isminefilter& filter, bool useCache, int mi
         if (pcoin.IsTrusted(depth, fConflicted) && depth >= minDepth) {
             nTotal += pcoin.GetAvailableCredit(useCache, filter);
         }
-    });
+    }, useCache ? Optional<BalanceCacheKey>(BalanceCacheKey{BALANCE_AVAILABLE, filter, minDepth}) : nullopt);
 }
 
 CAmount CWallet::GetColdStakingBalance() const
 {
     return loopTxsBalance([](const uint256& id, const CWalletTx& pcoin, CAmount& nTotal) {
-        if (pcoin.tx->HasP2CSOutputs() && pcoin.IsTrusted())
+        if (pcoin.IsTrusted())
             nTotal += pcoin.GetColdStakingCredit();
-    });
+    }, BalanceCacheKey{BALANCE_COLD_STAKING, ISMINE_ALL, 0}, true);
 }
 
 CAmount CWallet::GetStakingBalance(const bool fIncludeColdStaking) const
@@ -2187,15 +2441,15 @@ CAmount CWallet::GetStakingBalance(const bool fIncludeColdStaking) const
             if (fIncludeColdStaking)
                 nTotal += pcoin.GetColdStakingCredit(); // plus cold coins, if any and if requested
         }
-    }));
+    }, BalanceCacheKey{BALANCE_STAKING, ISMINE_ALL, fIncludeColdStaking}));
 }
 
 CAmount CWallet::GetDelegatedBalance() const
 {
     return loopTxsBalance([](const uint256& id, const CWalletTx& pcoin, CAmount& nTotal) {
-            if (pcoin.tx->HasP2CSOutputs() && pcoin.IsTrusted())
+            if (pcoin.IsTrusted())
                 nTotal += pcoin.GetStakeDelegationCredit();
-    });
+    }, BalanceCacheKey{BALANCE_DELEGATED, ISMINE_ALL, 0}, true);
 }
 
 CAmount CWallet::GetLockedCoins() const
@@ -2243,28 +2497,28 @@ CAmount CWallet::GetUnconfirmedBalance(isminetype filter) const
     return loopTxsBalance([filter](const uint256& id, const CWalletTx& pcoin, CAmount& nTotal) {
             if (!pcoin.IsTrusted() && pcoin.GetDepthInMainChain() == 0 && pcoin.InMempool())
                 nTotal += pcoin.GetCredit(filter);
-    });
+    }, BalanceCacheKey{BALANCE_UNCONFIRMED, filter, 0});
 }
 
 CAmount CWallet::GetImmatureBalance() const
 {
     return loopTxsBalance([](const uint256& id, const CWalletTx& pcoin, CAmount& nTotal) {
             nTotal += pcoin.GetImmatureCredit(false);
-    });
+    }, BalanceCacheKey{BALANCE_IMMATURE, ISMINE_ALL, 0});
 }
 
 CAmount CWallet::GetImmatureColdStakingBalance() const
 {
     return loopTxsBalance([](const uint256& id, const CWalletTx& pcoin, CAmount& nTotal) {
             nTotal += pcoin.GetImmatureCredit(false, ISMINE_COLD);
-    });
+    }, BalanceCacheKey{BALANCE_IMMATURE_COLD_STAKING, ISMINE_ALL, 0});
 }
 
 CAmount CWallet::GetImmatureDelegatedBalance() const
 {
     return loopTxsBalance([](const uint256& id, const CWalletTx& pcoin, CAmount& nTotal) {
             nTotal += pcoin.GetImmatureCredit(false, ISMINE_SPENDABLE_DELEGATED);
-    });
+    }, BalanceCacheKey{BALANCE_IMMATURE_DELEGATED, ISMINE_ALL, 0});
 }
 
 CAmount CWallet::GetWatchOnlyBalance() const
@@ -2272,7 +2526,7 @@ CAmount CWallet::GetWatchOnlyBalance() const
     return loopTxsBalance([](const uint256& id, const CWalletTx& pcoin, CAmount& nTotal) {
             if (pcoin.IsTrusted())
                 nTotal += pcoin.GetAvailableWatchOnlyCredit();
-    });
+    }, BalanceCacheKey{BALANCE_WATCH_ONLY, ISMINE_ALL, 0});
 }
 
 CAmount CWallet::GetUnconfirmedWatchOnlyBalance() const
@@ -2280,14 +2534,14 @@ CAmount CWallet::GetUnconfirmedWatchOnlyBalance() const
     return loopTxsBalance([](const uint256& id, const CWalletTx& pcoin, CAmount& nTotal) {
             if (!pcoin.IsTrusted() && pcoin.GetDepthInMainChain() == 0 && pcoin.InMempool())
                 nTotal += pcoin.GetAvailableWatchOnlyCredit();
-    });
+    }, BalanceCacheKey{BALANCE_UNCONFIRMED_WATCH_ONLY, ISMINE_ALL, 0});
 }
 
 CAmount CWallet::GetImmatureWatchOnlyBalance() const
 {
     return loopTxsBalance([](const uint256& id, const CWalletTx& pcoin, CAmount& nTotal) {
             nTotal += pcoin.GetImmatureWatchOnlyCredit();
-    });
+    }, BalanceCacheKey{BALANCE_IMMATURE_WATCH_ONLY, ISMINE_ALL, 0});
 }
 
 // Calculate total balance in a different way from GetBalance. The biggest
@@ -2346,35 +2600,22 @@ void CWallet::GetAvailableP2CSCoins(std::vector<COutput>& vCoins) const {
     vCoins.clear();
     {
         LOCK(cs_wallet);
-        for (const auto& it : mapWallet) {
-            const uint256& wtxid = it.first;
-            const CWalletTx* pcoin = &it.second;
-
+        ForEachP2CSOutput([&](const CWalletTx& wtx, uint32_t i, const P2CSOutputKeys& keys) {
             bool fConflicted;
-            int nDepth = pcoin->GetDepthAndMempool(fConflicted);
+            int nDepth = wtx.GetDepthAndMempool(fConflicted);
 
             if (fConflicted || nDepth < 0)
-                continue;
-
-            bool fSafe = pcoin->IsTrusted();
-
-            if (pcoin->tx->HasP2CSOutputs()) {
-                for (int i = 0; i < (int) pcoin->tx->vout.size(); i++) {
-                    const auto &utxo = pcoin->tx->vout[i];
+                return;
 
-                    if (IsSpent(wtxid, i))
-                        continue;
+            if (IsSpent(wtx.GetHash(), i))
+                return;
 
-                    if (utxo.scriptPubKey.IsPayToColdStaking()) {
-                        isminetype mine = IsMine(utxo);
-                        bool isMineSpendable = mine & ISMINE_SPENDABLE_DELEGATED;
-                        if (mine & ISMINE_COLD || isMineSpendable)
-                            // Depth and solvability members are not used, no need waste resources and set them for now.
-                            vCoins.emplace_back(pcoin, i, 0, isMineSpendable, true, fSafe);
-                    }
-                }
-            }
-        }
+            bool fSafe = wtx.IsTrusted();
+            isminetype mine = IsMine(wtx.tx->vout[i]);
+            bool isMineSpendable = mine & ISMINE_SPENDABLE_DELEGATED;
+            // Depth and solvability members are not used, no need waste resources and set them for now.
+            vCoins.emplace_back(&wtx, i, 0, isMineSpendable, true, fSafe);
+        });
     }
 
 }
@@ -2503,8 +2744,8 @@ CWallet::OutputAvailabilityResult CWallet::CheckOutputAvailability(
 {
     OutputAvailabilityResult res;
 
-    // Check if the utxo was spent.
-    if (IsSpent(wtxid, outIndex)) return res;
+    // Check if the utxo was spent, or is being spent by a transaction in creation.
+    if (IsSpent(wtxid, outIndex) || IsReservedCoin(wtxid, outIndex)) return res;
 
     isminetype mine = IsMine(output);
 
@@ -2535,6 +2776,88 @@ CWallet::OutputAvailabilityResult CWallet::CheckOutputAvailability(
     return res;
 }
 
+void CWallet::ForEachUnspentCandidate(const std::function<bool(const uint256&, const CWalletTx*)>& func) const
+{
+    AssertLockHeld(cs_wallet);
+    if (!fUnspentCandidatesValid) {
+        setUnspentCandidates.clear();
+        for (const auto& it : mapWallet) setUnspentCandidates.emplace_hint(setUnspentCandidates.end(), it.first);
+        fUnspentCandidatesValid = true;
+    }
+
+    // An output will never be unspent again if it's not ours, or if it's spent by a confirmed transaction
+    // (until the next block disconnection, which resets the candidates).
+    auto isOutputDone = [&](const CWalletTx& wtx, uint32_t n) {
+        if (IsMine(wtx.tx->vout[n]) == ISMINE_NO) return true;
+        const auto range = mapTxSpends.equal_range(COutPoint(wtx.GetHash(), n));
+        for (auto it = range.first; it != range.second; ++it) {
+            const auto mit = mapWallet.find(it->second);
+            if (mit != mapWallet.end() && mit->second.GetDepthInMainChain() > 0) return true;
+        }
+        return false;
+    };
+
+    for (auto it = setUnspentCandidates.begin(); it != setUnspentCandidates.end(); ) {
+        const auto mit = mapWallet.find(*it);
+        if (mit == mapWallet.end()) {
+            it = setUnspentCandidates.erase(it);
+            continue;
+        }
+        bool fDone = true;
+        for (uint32_t n = 0; n < mit->second.tx->vout.size() && fDone; n++) {
+            fDone = isOutputDone(mit->second, n);
+        }
+        if (fDone) {
+            it = setUnspentCandidates.erase(it);
+            continue;
+        }
+        ++it;
+        if (!func(mit->first, &mit->second)) return;
+    }
+}
+
+void CWallet::AddToP2CSOutputs(const CWalletTx& wtx) const
+{
+    AssertLockHeld(cs_wallet);
+    if (!wtx.tx->HasP2CSOutputs()) return;
+    for (uint32_t n = 0; n < wtx.tx->vout.size(); n++) {
+        const CTxOut& out = wtx.tx->vout[n];
+        if (!out.scriptPubKey.IsPayToColdStaking() || !(IsMine(out) & (ISMINE_COLD | ISMINE_SPENDABLE_DELEGATED))) continue;
+        txnouttype type;
+        std::vector<CTxDestination> addresses;
+        int nRequired;
+        if (!ExtractDestinations(out.scriptPubKey, type, addresses, nRequired) || addresses.size() != 2) continue;
+        mapP2CSOutputs[COutPoint(wtx.GetHash(), n)] = {boost::get<CKeyID>(addresses[0]), boost::get<CKeyID>(addresses[1])};
+    }
+}
+
+void CWallet::ForEachP2CSOutput(const std::function<void(const CWalletTx&, uint32_t, const P2CSOutputKeys&)>& func) const
+{
+    AssertLockHeld(cs_wallet);
+    if (!fP2CSOutputsValid) {
+        mapP2CSOutputs.clear();
+        for (const auto& it : mapWallet) AddToP2CSOutputs(it.second);
+        fP2CSOutputsValid = true;
+    }
+
+    for (auto it = mapP2CSOutputs.begin(); it != mapP2CSOutputs.end(); ) {
+        const auto mit = mapWallet.find(it->first.hash);
+        bool fDone = mit == mapWallet.end();
+        // Spent by a confirmed transaction, until the next block disconnection (which resets the index)
+        const auto range = mapTxSpends.equal_range(it->first);
+        for (auto sit = range.first; sit != range.second && !fDone; ++sit) {
+            const auto spender = mapWallet.find(sit->second);
+            fDone = spender != mapWallet.end() && spender->second.GetDepthInMainChain() > 0;
+        }
+        if (fDone) {
+            it = mapP2CSOutputs.erase(it);
+            continue;
+        }
+        func(mit->second, it->first.n, it->second);
+        ++it;
+    }
+}
+
 bool CWallet::AvailableCoins(std::vector<COutput>* pCoins,      // --> populates when != nullptr
                              const CCoinControl* coinControl,   // Default: nullptr
                              AvailableCoinsFilter coinsFilter) const
@@ -2548,18 +2871,16 @@ bool CWallet::AvailableCoins(std::vector<COutput>* pCoins,      // --> populates
     {
         LOCK(cs_wallet);
         CAmount nTotal = 0;
-        for (const auto& entry : mapWallet) {
-            const uint256& wtxid = entry.first;
-            const CWalletTx* pcoin = &entry.second;
-
+        bool fFound = false;
+        ForEachUnspentCandidate([&](const uint256& wtxid, const CWalletTx* pcoin) {
             // Check if the tx is selectable
             int nDepth = 0;
             bool safeTx = false;
             if (!CheckTXAvailability(pcoin, coinsFilter.fOnlySafe, nDepth, safeTx, m_last_block_processed_height))
-                continue;
+                return true;
 
             // Check min depth filtering requirements
-            if (nDepth < coinsFilter.minDepth) continue;
+            if (nDepth < coinsFilter.minDepth) return true;
 
             for (unsigned int i = 0; i < pcoin->tx->vout.size(); i++) {
                 const auto& output = pcoin->tx->vout[i];
@@ -2595,7 +2916,10 @@ bool CWallet::AvailableCoins(std::vector<COutput>* pCoins,      // --> populates
                 if (coinsFilter.fOnlySpendable && !res.spendable) continue;
 
                 // found valid coin
-                if (!pCoins) return true;
+                if (!pCoins) {
+                    fFound = true;
+                    return false;
+                }
                 pCoins->emplace_back(pcoin, (int) i, nDepth, res.spendable, res.solvable, safeTx);
 
                 // Checks the sum amount of all UTXO's.
@@ -2603,17 +2927,20 @@ bool CWallet::AvailableCoins(std::vector<COutput>* pCoins,      // --> populates
                     nTotal += output.nValue;
 
                     if (nTotal >= coinsFilter.nMinimumSumAmount) {
-                        return true;
+                        fFound = true;
+                        return false;
                     }
                 }
 
                 // Checks the maximum number of UTXO's.
                 if (coinsFilter.nMaximumCount > 0 && pCoins->size() >= coinsFilter.nMaximumCount) {
-                    return true;
+                    fFound = true;
+                    return false;
                 }
             }
-        }
-        return (pCoins && !pCoins->empty());
+            return true;
+        });
+        return fFound || (pCoins && !pCoins->empty());
     }
 }
 
@@ -2697,18 +3024,16 @@ bool CWallet::StakeableCoins(std::vector<CStakeableOutput>* pCoins)
     if (pCoins) pCoins->clear();
 
     LOCK2(cs_main, cs_wallet);
-    for (const auto& it : mapWallet) {
-        const uint256& wtxid = it.first;
-        const CWalletTx* pcoin = &(it).second;
-
+    bool fFound = false;
+    ForEachUnspentCandidate([&](const uint256& wtxid, const CWalletTx* pcoin) {
         // Check if the tx is selectable
         int nDepth = 0;
         bool safeTx = false;
         if (!CheckTXAvailability(pcoin, true, nDepth, safeTx))
-            continue;
+            return true;
 
         // Check min depth requirement for stake inputs
-        if (nDepth < Params().GetConsensus().nStakeMinDepth) continue;
+        if (nDepth < Params().GetConsensus().nStakeMinDepth) return true;
 
         const CBlockIndex* pindex = nullptr;
         for (unsigned int index = 0; index < pcoin->tx->vout.size(); index++) {
@@ -2726,12 +3051,68 @@ bool CWallet::StakeableCoins(std::vector<CStakeableOutput>* pCoins)
             if (!res.available || !res.spendable) continue;
 
             // found valid coin
-            if (!pCoins) return true;
+            if (!pCoins) {
+                fFound = true;
+                return false;
+            }
             if (!pindex) pindex = mapBlockIndex.at(pcoin->m_confirm.hashBlock);
             pCoins->emplace_back(pcoin, (int) index, nDepth, pindex);
         }
+        return true;
+    });
+    return fFound || (pCoins && !pCoins->empty());
+}
+
+// Whether output can be selected with the given confirmations and mempool chain limits
+static bool IsCoinEligible(const COutput& output, int nConfMine, int nConfTheirs, uint64_t nMaxAncestors)
+{
+    if (!output.fSpendable) return false;
+    const CWalletTx* pcoin = output.tx;
+    if (output.nDepth < (pcoin->IsFromMe(ISMINE_ALL) ? nConfMine : nConfTheirs)) return false;
+    return mempool.TransactionWithinChainLimit(pcoin->GetHash(), nMaxAncestors);
+}
+
+std::vector<CInputCoin> CWallet::GetBnBCoinPool(const std::vector<COutput>& vCoins, const CoinSelectionParams& params, SigVersion sigversion) const
+{
+    std::vector<CInputCoin> vPool;
+    vPool.reserve(vCoins.size());
+    for (size_t i = 0; i < vCoins.size(); i++) {
+        const COutput& output = vCoins[i];
+        if (!output.fSpendable) continue;
+        const CTxOut& txout = output.tx->tx->vout[output.i];
+        // Size of the input, with a dummy signature
+        SignatureData sigdata;
+        if (!ProduceSignature(DummySignatureCreator(this), txout.scriptPubKey, sigdata, sigversion, false)) continue;
+        const size_t nInputSize = ::GetSerializeSize(CTxIn(COutPoint(), sigdata.scriptSig), PROTOCOL_VERSION);
+        CInputCoin coin(i, txout.nValue, params.effective_fee.GetFee(nInputSize), params.long_term_fee.GetFee(nInputSize));
+        // Not worth spending
+        if (coin.effective_value <= 0) continue;
+        vPool.emplace_back(coin);
+    }
+    SortCoinsForBnB(vPool);
+    return vPool;
+}
+
+bool CWallet::SelectCoinsBnBMinConf(const CAmount& nTargetValue, int nConfMine, int nConfTheirs, uint64_t nMaxAncestors, const std::vector<COutput>& vCoins, const std::vector<CInputCoin>& vPool, const CAmount& nCostOfChange, std::set<std::pair<const CWalletTx*, unsigned int> >& setCoinsRet, CAmount& nValueRet) const
+{
+    setCoinsRet.clear();
+    nValueRet = 0;
+
+    // vPool is already sorted, and so is any subset of it
+    std::vector<CInputCoin> vEligible;
+    vEligible.reserve(vPool.size());
+    for (const CInputCoin& coin : vPool) {
+        if (IsCoinEligible(vCoins[coin.index], nConfMine, nConfTheirs, nMaxAncestors)) {
+            vEligible.emplace_back(coin);
+        }
     }
-    return (pCoins && !pCoins->empty());
+
+    std::vector<size_t> vSelected;
+    if (!SelectCoinsBnB(vEligible, nTargetValue, nCostOfChange, vSelected, nValueRet)) return false;
+    for (size_t index : vSelected) {
+        setCoinsRet.emplace(vCoins[index].tx, vCoins[index].i);
+    }
+    return true;
 }
 
 bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int nConfTheirs, uint64_t nMaxAncestors, std::vector<COutput> vCoins, std::set<std::pair<const CWalletTx*, unsigned int> >& setCoinsRet, CAmount& nValueRet) const
@@ -2749,19 +3130,10 @@ bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int
     Shuffle(vCoins.begin(), vCoins.end(), FastRandomContext());
 
     for (const COutput& output : vCoins) {
-        if (!output.fSpendable)
+        if (!IsCoinEligible(output, nConfMine, nConfTheirs, nMaxAncestors))
             continue;
 
         const CWalletTx* pcoin = output.tx;
-
-        if (output.nDepth < (pcoin->IsFromMe(ISMINE_ALL) ? nConfMine : nConfTheirs)) {
-            continue;
-        }
-
-        if (!mempool.TransactionWithinChainLimit(pcoin->GetHash(), nMaxAncestors)) {
-            continue;
-        }
-
         int i = output.i;
         CAmount n = pcoin->tx->vout[i].nValue;
 
@@ -2825,8 +3197,11 @@ bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int
     return true;
 }
 
-bool CWallet::SelectCoinsToSpend(const std::vector<COutput>& vAvailableCoins, const CAmount& nTargetValue, std::set<std::pair<const CWalletTx*, unsigned int> >& setCoinsRet, CAmount& nValueRet, const CCoinControl* coinControl) const
+bool CWallet::SelectCoinsToSpend(const std::vector<COutput>& vAvailableCoins, const CAmount& nTargetValue, std::set<std::pair<const CWalletTx*, unsigned int> >& setCoinsRet, CAmount& nValueRet, const CCoinControl* coinControl,
+                                 const CoinSelectionParams* pBnBParams, const std::vector<CInputCoin>& vBnBPool, bool* pfBnBUsed) const
 {
+    if (pfBnBUsed) *pfBnBUsed = false;
+
     // Note: this function should never be used for "always free" tx types like dstx
     std::vector<COutput> vCoins(vAvailableCoins);
 
@@ -2872,6 +3247,22 @@ bool CWallet::SelectCoinsToSpend(const std::vector<COutput>& vAvailableCoins, co
 
     size_t nMaxChainLength = std::min(gArgs.GetArg("-limitancestorcount", DEFAULT_ANCESTOR_LIMIT), gArgs.GetArg("-limitdescendantcount", DEFAULT_DESCENDANT_LIMIT));
 
+    // Changeless selection first (the preset inputs, if any, aren't part of the branch and bound pool)
+    if (pBnBParams && nValueFromPresetInputs == 0 && nTargetValue > 0) {
+        const CAmount nBnBTarget = nTargetValue + pBnBParams->GetNotInputFees();
+        const CAmount nCostOfChange = pBnBParams->GetCostOfChange();
+        bool fBnB = SelectCoinsBnBMinConf(nBnBTarget, 1, 6, 0, vAvailableCoins, vBnBPool, nCostOfChange, setCoinsRet, nValueRet) ||
+                SelectCoinsBnBMinConf(nBnBTarget, 1, 1, 0, vAvailableCoins, vBnBPool, nCostOfChange, setCoinsRet, nValueRet) ||
+                (bSpendZeroConfChange && SelectCoinsBnBMinConf(nBnBTarget, 0, 1, 2, vAvailableCoins, vBnBPool, nCostOfChange, setCoinsRet, nValueRet)) ||
+                (bSpendZeroConfChange && SelectCoinsBnBMinConf(nBnBTarget, 0, 1, std::min((size_t)4, nMaxChainLength/3), vAvailableCoins, vBnBPool, nCostOfChange, setCoinsRet, nValueRet)) ||
+                (bSpendZeroConfChange && SelectCoinsBnBMinConf(nBnBTarget, 0, 1, nMaxChainLength/2, vAvailableCoins, vBnBPool, nCostOfChange, setCoinsRet, nValueRet)) ||
+                (bSpendZeroConfChange && SelectCoinsBnBMinConf(nBnBTarget, 0, 1, nMaxChainLength, vAvailableCoins, vBnBPool, nCostOfChange, setCoinsRet, nValueRet));
+        if (fBnB) {
+            if (pfBnBUsed) *pfBnBUsed = true;
+            return true;
+        }
+    }
+
     bool res = nTargetValue <= nValueFromPresetInputs ||
             SelectCoinsMinConf(nTargetValue - nValueFromPresetInputs, 1, 6, 0, vCoins, setCoinsRet, nValueRet) ||
             SelectCoinsMinConf(nTargetValue - nValueFromPresetInputs, 1, 1, 0, vCoins, setCoinsRet, nValueRet) ||
@@ -3059,6 +3450,8 @@ bool CWallet::CreateTransaction(const std::vector<CRecipient>& vecSend,
     coinFilter.fIncludeDelegated = fIncludeDelegated;
     coinFilter.minDepth = nMinDepth;
 
+    // The spent outputs, and whether we only have their staker key, for the signing out of cs_wallet
+    std::vector<std::pair<CTxOut, bool>> vSpentOutputs;
     {
         std::set<std::pair<const CWalletTx*,unsigned int> > setCoins;
         LOCK2(cs_main, cs_wallet);
@@ -3072,6 +3465,21 @@ bool CWallet::CreateTransaction(const std::vector<CRecipient>& vecSend,
                 AvailableCoins(&vAvailableCoins, coinControl, coinFilter);
             }
 
+            // The first pass looks for a changeless set of coins, paying the fee rate of the transaction.
+            // Not with a fixed fee, a fee subtracted from the outputs, or inputs chosen by coin control.
+            CoinSelectionParams coin_selection_params;
+            std::vector<CInputCoin> vBnBPool;
+            coin_selection_params.use_bnb = nFeePay == 0 && nSubtractFeeFromAmount == 0 &&
+                                            !(coinControl && coinControl->HasSelected());
+            if (coin_selection_params.use_bnb) {
+                coin_selection_params.effective_fee = (coinControl && coinControl->fOverrideFeeRate) ?
+                                                      coinControl->nFeeRate :
+                                                      CFeeRate(GetMinimumFee(1000, nTxConfirmTarget, mempool));
+                coin_selection_params.long_term_fee = CFeeRate(GetRequiredFee(1000));
+                coin_selection_params.change_output_size = ::GetSerializeSize(CTxOut(0, GetScriptForDestination(CKeyID())), PROTOCOL_VERSION);
+                vBnBPool = GetBnBCoinPool(vAvailableCoins, coin_selection_params, txNew.GetRequiredSigVersion());
+            }
+
             nFeeRet = 0;
             if (nFeePay > 0) nFeeRet = nFeePay;
             while (true) {
@@ -3108,13 +3516,25 @@ bool CWallet::CreateTransaction(const std::vector<CRecipient>& vecSend,
                 CAmount nValueIn = 0;
                 setCoins.clear();
 
-                if (!SelectCoinsToSpend(vAvailableCoins, nValueToSelect, setCoins, nValueIn, coinControl)) {
+                bool fBnBUsed = false;
+                if (coin_selection_params.use_bnb) {
+                    coin_selection_params.tx_noinputs_size = ::GetSerializeSize(txNew, PROTOCOL_VERSION) + nExtraSize;
+                }
+                if (!SelectCoinsToSpend(vAvailableCoins, nValueToSelect, setCoins, nValueIn, coinControl,
+                                        coin_selection_params.use_bnb ? &coin_selection_params : nullptr, vBnBPool, &fBnBUsed)) {
                     strFailReason = _("Insufficient funds.");
                     return false;
                 }
+                // The next passes have the fee of the previous one in nValueToSelect
+                coin_selection_params.use_bnb = false;
 
                 // Change
                 CAmount nChange = nValueIn - nValueToSelect;
+                if (fBnBUsed) {
+                    // No change output, the excess (less than its cost) goes to the fee
+                    nFeeRet += nChange;
+                    nChange = 0;
+                }
                 if (nChange > 0) {
                     // Fill a vout to ourself
                     // TODO: pass in scriptChange instead of reservekey so
@@ -3242,40 +3662,47 @@ bool CWallet::CreateTransaction(const std::vector<CRecipient>& vecSend,
             }
         }
 
-        if (sign) {
-            CTransaction txNewConst(txNew);
-            int nIn = 0;
-            for (const auto& coin : setCoins) {
-                const CScript& scriptPubKey = coin.first->tx->vout[coin.second].scriptPubKey;
-                SignatureData sigdata;
-                bool haveKey = coin.first->GetStakeDelegationCredit() > 0;
-
-                if (!ProduceSignature(
-                        TransactionSignatureCreator(this, &txNewConst, nIn, coin.first->tx->vout[coin.second].nValue, SIGHASH_ALL),
-                        scriptPubKey,
-                        sigdata,
-                        txNewConst.GetRequiredSigVersion(),
-                        !haveKey    // fColdStake
-                        )) {
-                    strFailReason = _("Signing transaction failed");
-                    return false;
-                } else {
-                    UpdateTransaction(txNew, nIn, sigdata);
-                }
-                nIn++;
-            }
+        // The selected coins are reserved, so that the other transactions created meanwhile don't select them
+        std::vector<COutPoint> vCoins;
+        for (const auto& coin : setCoins) {
+            vSpentOutputs.emplace_back(coin.first->tx->vout[coin.second], coin.first->GetStakeDelegationCredit() <= 0);
+            vCoins.emplace_back(coin.first->GetHash(), coin.second);
         }
-
-        // Limit size
-        if (::GetSerializeSize(txNew, PROTOCOL_VERSION) >= MAX_STANDARD_TX_SIZE) {
-            strFailReason = _("Transaction too large");
-            return false;
+        reservekey.ReserveCoins(vCoins);
+    }
+
+    // The signing only needs the keystore (which has its own lock), not cs_wallet
+    if (sign) {
+        CTransaction txNewConst(txNew);
+        for (size_t nIn = 0; nIn < vSpentOutputs.size(); nIn++) {
+            const CTxOut& spent = vSpentOutputs[nIn].first;
+            SignatureData sigdata;
+            if (!ProduceSignature(
+                    TransactionSignatureCreator(this, &txNewConst, nIn, spent.nValue, SIGHASH_ALL),
+                    spent.scriptPubKey,
+                    sigdata,
+                    txNewConst.GetRequiredSigVersion(),
+                    vSpentOutputs[nIn].second    // fColdStake
+                    )) {
+                strFailReason = _("Signing transaction failed");
+                reservekey.ReturnCoins();
+                return false;
+            } else {
+                UpdateTransaction(txNew, nIn, sigdata);
+            }
         }
+    }
 
-        // Embed the constructed transaction data in wtxNew.
-        txRet = MakeTransactionRef(std::move(txNew));
+    // Limit size
+    if (::GetSerializeSize(txNew, PROTOCOL_VERSION) >= MAX_STANDARD_TX_SIZE) {
+        strFailReason = _("Transaction too large");
+        reservekey.ReturnCoins();
+        return false;
     }
 
+    // Embed the constructed transaction data in wtxNew.
+    txRet = MakeTransactionRef(std::move(txNew));
+
     // Lastly, ensure this tx will pass the mempool's chain limits
     CTxMemPoolEntry entry(txRet, 0, 0, 0, false, 0);
     CTxMemPool::setEntries setAncestors;
@@ -3286,6 +3713,7 @@ bool CWallet::CreateTransaction(const std::vector<CRecipient>& vecSend,
     std::string errString;
     if (!mempool.CalculateMemPoolAncestors(entry, setAncestors, nLimitAncestors, nLimitAncestorSize, nLimitDescendants, nLimitDescendantSize, errString)) {
         strFailReason = _("Transaction has too long of a mempool chain");
+        reservekey.ReturnCoins();
         return false;
     }
 
@@ -3305,6 +3733,83 @@ int CWallet::GetLastBlockHeightLockWallet() const
     return WITH_LOCK(cs_wallet, return m_last_block_processed_height;);
 }
 
+//! Minimum number of stakeable coins to hash their kernels on several threads
+static const size_t MIN_PARALLEL_STAKE_COINS = 1000;
+//! Maximum number of threads hashing the kernels
+static const int MAX_STAKE_SEARCH_THREADS = 8;
+//! Number of coins claimed at once by the threads
+static const size_t STAKE_SEARCH_BATCH_SIZE = 256;
+
+/**
+ * Finds a coin, from the position nStart in coins, whose kernel meets the target. The kernels are
+ * hashed on several threads for the large wallets, which all stop at the first kernel found.
+ * Returns coins.size() if no kernel was found or if the search was interrupted.
+ */
+static size_t FindStakeKernel(const CBlockIndex* pindexPrev, unsigned int nBits, const std::vector<CStakeableOutput>& coins,
+                              size_t nStart, const std::function<bool()>& interrupted, int64_t& nTxNewTime, int& nAttempts)
+{
+    const auto checkKernel = [&](size_t i, int64_t& nTime) {
+        const CStakeableOutput& out = coins[i];
+        CPivStake stakeInput(out.tx->tx->vout[out.i], COutPoint(out.tx->GetHash(), out.i), out.pindex);
+        return Stake(pindexPrev, &stakeInput, nBits, nTime);
+    };
+
+    const int nThreads = coins.size() - nStart < MIN_PARALLEL_STAKE_COINS ? 1 : std::min(GetNumCores(), MAX_STAKE_SEARCH_THREADS);
+    if (nThreads <= 1) {
+        for (size_t i = nStart; i < coins.size(); i++) {
+            if (interrupted()) return coins.size();
+            nAttempts++;
+            if (checkKernel(i, nTxNewTime)) return i;
+        }
+        return coins.size();
+    }
+
+    std::atomic<size_t> nNextBatch{nStart};
+    std::atomic<bool> fStop{false};
+    std::atomic<int> nTries{0};
+    std::atomic<int64_t> nLastTime{0};
+    Mutex cs_found;
+    size_t nFound = coins.size();
+    int64_t nFoundTime = 0;
+
+    ctpl::thread_pool pool(nThreads);
+    std::vector<std::future<void>> vSearches;
+    for (int t = 0; t < nThreads; t++) {
+        vSearches.emplace_back(pool.push([&](int) {
+            while (!fStop) {
+                const size_t nBatchStart = nNextBatch.fetch_add(STAKE_SEARCH_BATCH_SIZE);
+                if (nBatchStart >= coins.size()) return;
+                if (interrupted()) {
+                    fStop = true;
+                    return;
+                }
+                const size_t nBatchEnd = std::min(nBatchStart + STAKE_SEARCH_BATCH_SIZE, coins.size());
+                for (size_t i = nBatchStart; i < nBatchEnd && !fStop; i++) {
+                    nTries++;
+                    int64_t nTime = 0;
+                    const bool fFound = checkKernel(i, nTime);
+                    nLastTime = nTime;
+                    if (fFound) {
+                        LOCK(cs_found);
+                        if (i < nFound) {
+                            nFound = i;
+                            nFoundTime = nTime;
+                        }
+                        fStop = true;
+                    }
+                }
+            }
+        }));
+    }
+    for (auto& search : vSearches) {
+        search.get();
+    }
+    nAttempts += nTries;
+    LOCK(cs_found);
+    nTxNewTime = nFound < coins.size() ? nFoundTime : nLastTime.load();
+    return nFound;
+}
+
 bool CWallet::CreateCoinstakeOuts(const CPivStake& stakeInput, std::vector<CTxOut>& vout, CAmount nTotal) const
 {
     std::vector<valtype> vSolutions;
@@ -3369,44 +3874,43 @@ bool CWallet::CreateCoinStake(
     pStakerStatus->SetLastTip(pindexPrev);
     pStakerStatus->SetLastCoins((int) availableCoins->size());
 
+    // Make sure the stake inputs haven't been spent since last check
+    {
+        LOCK(cs_wallet);
+        availableCoins->erase(std::remove_if(availableCoins->begin(), availableCoins->end(), [this](const CStakeableOutput& out) {
+            AssertLockHeld(cs_wallet);
+            return IsSpent(COutPoint(out.tx->GetHash(), out.i));
+        }), availableCoins->end());
+    }
+
+    const auto interrupted = [&]() {
+        // New block came in, move on
+        if (stopOnNewBlock && GetLastBlockHeightLockWallet() != pindexPrev->nHeight) return true;
+        // Make sure the wallet is unlocked and shutdown hasn't been requested
+        return IsLocked() || ShutdownRequested();
+    };
+
     // Kernel Search
     CAmount nCredit;
     CAmount nMasternodePayment;
     CScript scriptPubKeyKernel;
     bool fKernelFound = false;
     int nAttempts = 0;
-    for (auto it = availableCoins->begin(); it != availableCoins->end();) {
-        COutPoint outPoint = COutPoint(it->tx->GetHash(), it->i);
-        CPivStake stakeInput(it->tx->tx->vout[it->i],
-                             outPoint,
-                             it->pindex);
-
-        // New block came in, move on
-        if (stopOnNewBlock && GetLastBlockHeightLockWallet() != pindexPrev->nHeight) return false;
-
-        // Make sure the wallet is unlocked and shutdown hasn't been requested
-        if (IsLocked() || ShutdownRequested()) return false;
-
-        // Make sure the stake input hasn't been spent since last check
-        if (WITH_LOCK(cs_wallet, return IsSpent(outPoint))) {
-            // remove it from the available coins
-            it = availableCoins->erase(it);
-            continue;
-        }
-
-        nCredit = 0;
-
-        nAttempts++;
-        fKernelFound = Stake(pindexPrev, &stakeInput, nBits, nTxNewTime);
+    size_t nNext = 0;
+    while (true) {
+        const size_t nKernel = FindStakeKernel(pindexPrev, nBits, *availableCoins, nNext, interrupted, nTxNewTime, nAttempts);
 
         // update staker status (time, attempts)
         pStakerStatus->SetLastTime(nTxNewTime);
         pStakerStatus->SetLastTries(nAttempts);
 
-        if (!fKernelFound) {
-            it++;
-            continue;
-        }
+        if (nKernel >= availableCoins->size()) break;
+        nNext = nKernel + 1;
+        const CStakeableOutput& out = (*availableCoins)[nKernel];
+        CPivStake stakeInput(out.tx->tx->vout[out.i],
+                             COutPoint(out.tx->GetHash(), out.i),
+                             out.pindex);
+        nCredit = 0;
 
         // Found a kernel
         LogPrintf("CreateCoinStake : kernel found\n");
@@ -3420,7 +3924,6 @@ bool CWallet::CreateCoinStake(
         std::vector<CTxOut> vout;
         if (!CreateCoinstakeOuts(stakeInput, vout, nCredit - nMasternodePayment)) {
             LogPrintf("%s : failed to create output\n", __func__);
-            it++;
             continue;
         }
         txNew.vout.insert(txNew.vout.end(), vout.begin(), vout.end());
@@ -3448,6 +3951,7 @@ bool CWallet::CreateCoinStake(
         if (nBytes >= DEFAULT_BLOCK_MAX_SIZE / 5)
             return error("%s : exceeded coinstake size limit", __func__);
 
+        fKernelFound = true;
         break;
     }
     LogPrint(BCLog::STAKING, "%s: attempted staking %d times\n", __func__, nAttempts);
@@ -3520,6 +4024,9 @@ CWallet::CommitResult CWallet::CommitTransaction(CTransactionRef tx, CReserveKey
             // otherwise just for transaction history.
             AddToWallet(wtxNew);
 
+            // The coins reserved by CreateTransaction are spent now
+            if (opReservekey) opReservekey->ReturnCoins();
+
             // Notify that old coins are spent
             if (!wtxNew.tx->HasZerocoinSpendInputs()) {
                 std::set<uint256> updated_hashes;
@@ -3630,6 +4137,7 @@ bool CWallet::SetAddressBook(const CWDestination& address, const std::string& st
         mapAddressBook[address].name = strName;
         if (!strPurpose.empty()) /* update purpose only if requested */
             mapAddressBook[address].purpose = strPurpose;
+        if (!fUpdated) nAddressBookGeneration++;
     }
     NotifyAddressBookChanged(this, address, strName, ::IsMine(*this, address) != ISMINE_NO,
             mapAddressBook.at(address).purpose, (fUpdated ? CT_UPDATED : CT_NEW));
@@ -3651,6 +4159,7 @@ bool CWallet::DelAddressBook(const CWDestination& address, const CChainParams::B
             WalletBatch(*database).EraseDestData(strAddress, item.first);
         }
         mapAddressBook.erase(address);
+        nAddressBookGeneration++;
     }
 
     NotifyAddressBookChanged(this, address, "", ::IsMine(*this, address) != ISMINE_NO, purpose, CT_DELETED);
@@ -3719,6 +4228,11 @@ bool CWallet::TopUpKeyPool(unsigned int kpSize)
     return m_spk_man->TopUp(kpSize);
 }
 
+bool CWallet::MaybeTopUpKeyPool()
+{
+    return m_spk_man->MaybeTopUp();
+}
+
 void CWallet::KeepKey(int64_t nIndex)
 {
     m_spk_man->KeepDestination(nIndex);
@@ -3784,87 +4298,107 @@ std::map<CTxDestination, CAmount> CWallet::GetAddressBalances()
     return balances;
 }
 
+namespace {
+
+/** Disjoint sets of destinations, merged by union by size with path halving */
+class DestinationSets
+{
+private:
+    std::map<CTxDestination, size_t> mapIds;
+    std::vector<size_t> vParent;
+    std::vector<size_t> vSize;
+
+public:
+    size_t Add(const CTxDestination& dest)
+    {
+        auto res = mapIds.emplace(dest, vParent.size());
+        if (res.second) {
+            vParent.push_back(res.first->second);
+            vSize.push_back(1);
+        }
+        return res.first->second;
+    }
+
+    size_t Find(size_t id)
+    {
+        while (vParent[id] != id) {
+            vParent[id] = vParent[vParent[id]];
+            id = vParent[id];
+        }
+        return id;
+    }
+
+    void Union(size_t a, size_t b)
+    {
+        a = Find(a);
+        b = Find(b);
+        if (a == b) return;
+        if (vSize[a] < vSize[b]) std::swap(a, b);
+        vParent[b] = a;
+        vSize[a] += vSize[b];
+    }
+
+    std::set<std::set<CTxDestination>> GetSets()
+    {
+        std::vector<std::set<CTxDestination>> vSets(vParent.size());
+        for (const auto& it : mapIds) {
+            vSets[Find(it.second)].insert(it.first);
+        }
+        std::set<std::set<CTxDestination>> ret;
+        for (auto& set : vSets) {
+            if (!set.empty()) ret.insert(std::move(set));
+        }
+        return ret;
+    }
+};
+
+} // namespace
+
 std::set<std::set<CTxDestination> > CWallet::GetAddressGroupings()
 {
     AssertLockHeld(cs_wallet); // mapWallet
-    std::set<std::set<CTxDestination> > groupings;
-    std::set<CTxDestination> grouping;
+    DestinationSets groupings;
 
     for (const auto& walletEntry : mapWallet) {
         const CWalletTx* pcoin = &walletEntry.second;
 
         if (pcoin->tx->vin.size() > 0) {
-            bool any_mine = false;
             // group all input addresses with each other
-            for (CTxIn txin : pcoin->tx->vin) {
+            Optional<size_t> group;
+            for (const CTxIn& txin : pcoin->tx->vin) {
                 CTxDestination address;
                 if (!IsMine(txin)) /* If this input isn't mine, ignore it */
                     continue;
                 if (!ExtractDestination(mapWallet.at(txin.prevout.hash).tx->vout[txin.prevout.n].scriptPubKey, address))
                     continue;
-                grouping.insert(address);
-                any_mine = true;
+                const size_t id = groupings.Add(address);
+                if (group) groupings.Union(*group, id);
+                group = id;
             }
 
             // group change with input addresses
-            if (any_mine) {
-                for (CTxOut txout : pcoin->tx->vout)
+            if (group) {
+                for (const CTxOut& txout : pcoin->tx->vout)
                     if (IsChange(txout)) {
                         CTxDestination txoutAddr;
                         if (!ExtractDestination(txout.scriptPubKey, txoutAddr))
                             continue;
-                        grouping.insert(txoutAddr);
+                        groupings.Union(*group, groupings.Add(txoutAddr));
                     }
             }
-            if (grouping.size() > 0) {
-                groupings.insert(grouping);
-                grouping.clear();
-            }
         }
 
         // group lone addrs by themselves
-        for (unsigned int i = 0; i < pcoin->tx->vout.size(); i++)
-            if (IsMine(pcoin->tx->vout[i])) {
+        for (const CTxOut& txout : pcoin->tx->vout)
+            if (IsMine(txout)) {
                 CTxDestination address;
-                if (!ExtractDestination(pcoin->tx->vout[i].scriptPubKey, address))
+                if (!ExtractDestination(txout.scriptPubKey, address))
                     continue;
-                grouping.insert(address);
-                groupings.insert(grouping);
-                grouping.clear();
+                groupings.Add(address);
             }
     }
 
-    std::set<std::set<CTxDestination>*> uniqueGroupings;        // a set of pointers to groups of addresses
-    std::map<CTxDestination, std::set<CTxDestination>*> setmap; // map addresses to the unique group containing it
-    for (std::set<CTxDestination> grouping : groupings) {
-        // make a set of all the groups hit by this new group
-        std::set<std::set<CTxDestination>*> hits;
-        std::map<CTxDestination, std::set<CTxDestination>*>::iterator it;
-        for (CTxDestination address : grouping)
-            if ((it = setmap.find(address)) != setmap.end())
-                hits.insert((*it).second);
-
-        // merge all hit groups into a new single group and delete old groups
-        std::set<CTxDestination>* merged = new std::set<CTxDestination>(grouping);
-        for (std::set<CTxDestination>* hit : hits) {
-            merged->insert(hit->begin(), hit->end());
-            uniqueGroupings.erase(hit);
-            delete hit;
-        }
-        uniqueGroupings.insert(merged);
-
-        // update setmap
-        for (CTxDestination element : *merged)
-            setmap[element] = merged;
-    }
-
-    std::set<std::set<CTxDestination> > ret;
-    for (std::set<CTxDestination>* uniqueGrouping : uniqueGroupings) {
-        ret.insert(*uniqueGrouping);
-        delete uniqueGrouping;
-    }
-
-    return ret;
+    return groupings.GetSets();
 }
 
 std::set<CTxDestination> CWallet::GetLabelAddresses(const std::string& label) const
@@ -3892,7 +4426,7 @@ bool CReserveKey::GetReservedKey(CPubKey& pubkey, bool _internal)
     if (nIndex == -1) {
 
         // Fill the pool if needed
-        m_spk_man->TopUp();
+        m_spk_man->MaybeTopUp();
         internal = _internal;
 
         // Modify this for Staking addresses support if needed.
@@ -3928,40 +4462,65 @@ void CReserveKey::ReturnKey()
     vchPubKey = CPubKey();
 }
 
+void CReserveKey::ReserveCoins(const std::vector<COutPoint>& vCoins)
+{
+    AssertLockHeld(pwallet->cs_wallet); // setReservedCoins
+    for (const COutPoint& out : vCoins) {
+        pwallet->setReservedCoins.insert(out);
+        vReservedCoins.emplace_back(out);
+    }
+}
+
+void CReserveKey::ReturnCoins()
+{
+    if (vReservedCoins.empty()) return;
+    LOCK(pwallet->cs_wallet);
+    for (const COutPoint& out : vReservedCoins) {
+        pwallet->setReservedCoins.erase(out);
+    }
+    vReservedCoins.clear();
+}
+
 void CWallet::LockCoin(const COutPoint& output)
 {
     AssertLockHeld(cs_wallet); // setLockedCoins
     setLockedCoins.insert(output);
+    MarkBalancesDirty();
 }
 
 void CWallet::LockNote(const SaplingOutPoint& op)
 {
     AssertLockHeld(cs_wallet); // setLockedNotes
     setLockedNotes.insert(op);
+    MarkBalancesDirty();
 }
 
 void CWallet::UnlockCoin(const COutPoint& output)
 {
     AssertLockHeld(cs_wallet); // setLockedCoins
     setLockedCoins.erase(output);
+    MarkBalancesDirty();
 }
 
 void CWallet::UnlockNote(const SaplingOutPoint& op)
 {
     AssertLockHeld(cs_wallet); // setLockedNotes
     setLockedNotes.erase(op);
+    MarkBalancesDirty();
 }
 
 void CWallet::UnlockAllCoins()
 {
     AssertLockHeld(cs_wallet); // setLockedCoins
     setLockedCoins.clear();
+    MarkBalancesDirty();
 }
 
 void CWallet::UnlockAllNotes()
 {
     AssertLockHeld(cs_wallet); // setLockedNotes
     setLockedNotes.clear();
+    MarkBalancesDirty();
 }
 
 bool CWallet::IsLockedCoin(const uint256& hash, unsigned int n) const
@@ -3972,6 +4531,12 @@ bool CWallet::IsLockedCoin(const uint256& hash, unsigned int n) const
     return (setLockedCoins.count(outpt) > 0);
 }
 
+bool CWallet::IsReservedCoin(const uint256& hash, unsigned int n) const
+{
+    AssertLockHeld(cs_wallet); // setReservedCoins
+    return setReservedCoins.count(COutPoint(hash, n)) > 0;
+}
+
 bool CWallet::IsLockedNote(const SaplingOutPoint& op) const
 {
     AssertLockHeld(cs_wallet); // setLockedNotes
@@ -4368,10 +4933,11 @@ CWallet* CWallet::CreateWalletFromFile(const std::string& name, const fs::path&
         if (tip) {
             walletInstance->m_last_block_processed = tip->GetBlockHash();
             walletInstance->m_last_block_processed_height = tip->nHeight;
+            walletInstance->MarkBalancesDirty();
             walletInstance->m_last_block_processed_time = tip->GetBlockTime();
         }
     }
-    RegisterValidationInterface(walletInstance);
+    RegisterValidationInterface(walletInstance, "wallet " + walletInstance->GetName());
 
     if (chainActive.Tip() && chainActive.Tip() != pindexRescan) {
         uiInterface.InitMessage(_("Rescanning..."));
@@ -4431,9 +4997,12 @@ void CWallet::postInitProcess(CScheduler& scheduler)
     // Add wallet transactions that aren't already in a block to mapTransactions
     ReacceptWalletTransactions(/*fFirstLoad*/true);
 
+    // Top up the key pool in the background from now on
+    m_spk_man->SetScheduler(&scheduler);
+
     // Run a thread to flush wallet periodically
     if (!CWallet::fFlushScheduled.exchange(true)) {
-        scheduler.scheduleEvery(MaybeCompactWalletDB, 500);
+        scheduler.scheduleEvery(MaybeCompactWalletDB, 500, "wallet-flush");
     }
 }
 
@@ -4498,6 +5067,7 @@ bool CWalletTx::AcceptToMemoryPool(CValidationState& state)
     bool fMissingInputs;
     bool fAccepted = ::AcceptToMemoryPool(mempool, state, tx, true, &fMissingInputs, false, true, false);
     fInMempool = fAccepted;
+    pwallet->MarkBalancesDirty();
     if (!fAccepted) {
         if (fMissingInputs) {
             // For now, "missing inputs" error is not returning the proper state, so need to set it manually here.
@@ -4580,7 +5150,24 @@ bool CWallet::LoadMinVersion(int nVersion)
 
 isminetype CWallet::IsMine(const CTxOut& txout) const
 {
-    return ::IsMine(*this, txout.scriptPubKey);
+    // The generation is read before solving the script, so a result racing with a change of the keys isn't cached
+    const uint64_t nGeneration = GetKeysGeneration();
+    {
+        LOCK(cs_ismine_cache);
+        if (nIsMineCacheGeneration != nGeneration) {
+            mapIsMineCache.clear();
+            nIsMineCacheGeneration = nGeneration;
+        }
+        auto it = mapIsMineCache.find(txout.scriptPubKey);
+        if (it != mapIsMineCache.end()) return it->second;
+    }
+    const isminetype mine = ::IsMine(*this, txout.scriptPubKey);
+    LOCK(cs_ismine_cache);
+    if (nIsMineCacheGeneration == nGeneration) {
+        if (mapIsMineCache.size() >= MAX_ISMINE_CACHE_SIZE) mapIsMineCache.clear();
+        mapIsMineCache.emplace(txout.scriptPubKey, mine);
+    }
+    return mine;
 }
 
 CAmount CWallet::GetCredit(const CTxOut& txout, const isminefilter& filter) const
@@ -4687,6 +5274,31 @@ int CWallet::GetVersion()
     return nWalletVersion;
 }
 
+size_t CWallet::GetWalletTxsMemoryUsage() const
+{
+    LOCK(cs_wallet);
+    size_t nUsage = memusage::DynamicUsage(mapWallet);
+    for (const auto& it : mapWallet) {
+        nUsage += memusage::RecursiveDynamicUsage(it.second.tx) + memusage::DynamicUsage(it.second.mapSaplingNoteData);
+    }
+    return nUsage;
+}
+
+size_t CWallet::GetSaplingWitnessesMemoryUsage() const
+{
+    LOCK(cs_wallet);
+    size_t nUsage = 0;
+    for (const auto& it : mapWallet) {
+        for (const auto& nd : it.second.mapSaplingNoteData) {
+            nUsage += memusage::DynamicUsage(nd.second.witnesses);
+            for (const SaplingWitness& witness : nd.second.witnesses) {
+                nUsage += witness.DynamicMemoryUsage();
+            }
+        }
+    }
+    return nUsage;
+}
+
 ///////////////// Sapling Methods //////////////////////////
 ////////////////////////////////////////////////////////////
 
@@ -4700,6 +5312,19 @@ libzcash::SaplingPaymentAddress CWallet::GenerateNewSaplingZKey(std::string labe
     return address;
 }
 
+std::vector<libzcash::SaplingPaymentAddress> CWallet::GenerateNewSaplingZKeys(unsigned int count, const std::string& label)
+{
+    if (!m_sspk_man->IsEnabled()) {
+        throw std::runtime_error("Cannot generate shielded addresses. Start with -upgradewallet in order to upgrade a non-HD wallet to HD and Sapling features");
+    }
+
+    auto addresses = m_sspk_man->GenerateNewSaplingZKeys(count);
+    for (const auto& address : addresses) {
+        SetAddressBook(address, label, AddressBook::AddressBookPurpose::SHIELDED_RECEIVE);
+    }
+    return addresses;
+}
+
 void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
                             const CBlock* pblock,
                             SaplingMerkleTree& saplingTree) { m_sspk_man->IncrementNoteWitnesses(pindex, pblock, saplingTree); }
@@ -4824,6 +5449,8 @@ void CWalletTx::MarkDirty()
     nShieldedChangeCached = 0;
     fShieldedChangeCached = false;
     fStakeDelegationVoided = false;
+    m_output_entries.reset();
+    if (pwallet) pwallet->MarkBalancesDirty();
 }
 
 void CWalletTx::BindWallet(CWallet* pwalletIn)
@@ -4876,7 +5503,7 @@ Optional<std::pair<
         libzcash::SaplingNotePlaintext,
         libzcash::SaplingPaymentAddress>> CWalletTx::RecoverSaplingNote(const SaplingOutPoint& op, const std::set<uint256>& ovks) const
 {
-    auto output = this->tx->sapData->vShieldedOutput[op.n];
+    const auto& output = this->tx->sapData->vShieldedOutput[op.n];
 
     for (const auto& ovk : ovks) {
         auto outPt = libzcash::SaplingOutgoingPlaintext::decrypt(
@@ -22,6 +22,7 @@
 #include "policy/feerate.h"
 #include "primitives/block.h"
 #include "primitives/transaction.h"
+#include "saltedhasher.h"
 #include "sapling/address.h"
 #include "guiinterface.h"
 #include "util/system.h"
@@ -31,15 +32,19 @@
 #include "wallet/scriptpubkeyman.h"
 #include "sapling/saplingscriptpubkeyman.h"
 #include "validation.h"
+#include "wallet/coinselection.h"
 #include "wallet/walletdb.h"
 
 #include <algorithm>
 #include <atomic>
+#include <limits>
 #include <map>
 #include <set>
 #include <stdexcept>
 #include <stdint.h>
 #include <string>
+#include <tuple>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -85,6 +90,10 @@ static const unsigned int DEFAULT_GENERATE_PROCLIMIT = 1;
 static const unsigned int DEFAULT_CREATEWALLETBACKUPS = 10;
 //! Default for -disablewallet
 static const bool DEFAULT_DISABLE_WALLET = false;
+//! Max number of threads reading blocks ahead of time during a rescan
+static const int MAX_RESCAN_READER_THREADS = 4;
+//! Max number of blocks read ahead of time during a rescan
+static const size_t RESCAN_PREFETCH_WINDOW = 32;
 
 static const int64_t TIMESTAMP_MIN = 0;
 
@@ -295,6 +304,12 @@ struct COutputEntry {
     int vout;
 };
 
+/** The keys of a P2CS output */
+struct P2CSOutputKeys {
+    CKeyID stakerId;
+    CKeyID ownerId;
+};
+
 /** Legacy class used for deserializing vtxPrev for backwards compatibility.
  * vtxPrev was removed in commit 93a18a3650292afbb441a47d1fa1b94aeb0164e3,
  * but old wallet.dat files may still contain vtxPrev vectors of CMerkleTxs.
@@ -351,6 +366,18 @@ public:
     bool IsAmountCached(AmountType type, const isminefilter& filter) const; // Only used in unit tests
     mutable CachableAmount m_amounts[AMOUNTTYPE_ENUM_ELEMENTS];
 
+    //! The GetAmounts result of the last filter, valid while the address book of the wallet doesn't change.
+    //! Replaced, never modified, so copies of the tx can share it.
+    struct CachedOutputEntries
+    {
+        isminefilter filter;
+        uint64_t nAddressBookGeneration;
+        std::list<COutputEntry> listReceived;
+        std::list<COutputEntry> listSent;
+        CAmount nFee;
+    };
+    mutable std::shared_ptr<const CachedOutputEntries> m_output_entries;
+
     mutable bool fStakeDelegationVoided;
     mutable bool fChangeCached;
     mutable bool fInMempool;
@@ -524,6 +551,8 @@ public:
 
     int64_t GetTxTime() const;
     void UpdateTimeSmart();
+    // Whether the tx is still to be relayed: unconfirmed, not abandoned, and neither a coinbase nor a coinstake
+    bool CanBeResent() const;
     void RelayWalletTransaction(CConnman* connman);
     std::set<uint256> GetConflicts() const;
 
@@ -637,12 +666,58 @@ private:
      */
     typedef TxSpendMap<COutPoint> TxSpends;
     TxSpends mapTxSpends;
+
+    /**
+     * Transactions that may still hold unspent outputs of ours, walked by AvailableCoins() and StakeableCoins()
+     * instead of the whole mapWallet. Transactions enter the set when added to the wallet, and leave it once all
+     * their outputs are either not ours or spent by a confirmed transaction. The set is rebuilt after a block
+     * disconnection, or after MarkDirty() (e.g. key imports), as those can make such outputs unspent again.
+     */
+    mutable std::set<uint256> setUnspentCandidates GUARDED_BY(cs_wallet);
+    mutable bool fUnspentCandidatesValid GUARDED_BY(cs_wallet){false};
+    /** Calls func on each unspent candidate (pruning the ones that are done) until it returns false */
+    void ForEachUnspentCandidate(const std::function<bool(const uint256&, const CWalletTx*)>& func) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
+    /**
+     * Transactions that ResendWalletTransactions() may rebroadcast, by time received, walked instead of the whole
+     * mapWallet. Transactions enter the set when added to (or updated in) the wallet while they can be resent, and
+     * leave it once confirmed, conflicted or abandoned. The set is rebuilt after a block disconnection.
+     */
+    std::set<std::pair<unsigned int, uint256>> setResendCandidates GUARDED_BY(cs_wallet);
+    bool fResendCandidatesValid GUARDED_BY(cs_wallet){false};
+    /**
+     * The rebroadcasts of the last resend, by relay time, spread over a few minutes in the order of the
+     * transactions (parents first). Relayed a few at a time, by the calls of ResendWalletTransactions().
+     */
+    std::multimap<int64_t, uint256> mapResendSchedule GUARDED_BY(cs_wallet);
+    std::atomic<int64_t> nNextScheduledResend{std::numeric_limits<int64_t>::max()};
+    void ScheduleResends(int64_t nNow);
+    void RelayScheduledResends(CConnman* connman, int64_t nNow);
+
+    /**
+     * The P2CS outputs for which we have the staker or the owner key, with the key ids of both, walked by the
+     * cold staking balances and RPCs instead of the whole mapWallet. Outputs enter the index when their tx is
+     * added to the wallet, and leave it once they are spent by a confirmed transaction. Like the unspent
+     * candidates, it is rebuilt after a block disconnection or after MarkDirty().
+     */
+    mutable std::map<COutPoint, P2CSOutputKeys> mapP2CSOutputs GUARDED_BY(cs_wallet);
+    mutable bool fP2CSOutputsValid GUARDED_BY(cs_wallet){false};
+    void AddToP2CSOutputs(const CWalletTx& wtx) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
     void AddToSpends(const COutPoint& outpoint, const uint256& wtxid);
     void AddToSpends(const uint256& wtxid);
 
     /* Mark a transaction (and its in-wallet descendants) as conflicting with a particular block. */
     void MarkConflicted(const uint256& hashBlock, int conflicting_height, const uint256& hashTx);
 
+    //! Number of BatchWrites alive, and the txs (and order position) whose write they deferred
+    int nBatchWrites GUARDED_BY(cs_wallet){0};
+    std::set<uint256> setPendingTxWrites GUARDED_BY(cs_wallet);
+    bool fPendingOrderPosWrite GUARDED_BY(cs_wallet){false};
+    //! Write the pending txs with batch, if fKeepFailed only the ones whose write failed are left pending
+    bool WritePendingTxs(WalletBatch& batch, bool fKeepFailed) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    //! Write the pending txs in a database transaction. Returns false if some writes are left pending.
+    bool WritePendingTxs() EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
     template <class T>
     void SyncMetaData(std::pair<typename TxSpendMap<T>::iterator, typename TxSpendMap<T>::iterator> range);
     void ChainTipAdded(const CBlockIndex *pindex, const CBlock *pblock, SaplingMerkleTree saplingTree);
@@ -701,6 +776,7 @@ public:
         m_last_block_processed_height = pindex->nHeight;
         m_last_block_processed = pindex->GetBlockHash();
         m_last_block_processed_time = pindex->GetBlockTime();
+        MarkBalancesDirty();
     };
 
     /* SPKM Helpers */
@@ -772,6 +848,8 @@ public:
 
     std::set<COutPoint> setLockedCoins;
     std::set<SaplingOutPoint> setLockedNotes;
+    //! Coins spent by the transactions being created, until they're committed (see CReserveKey::ReserveCoins)
+    std::set<COutPoint> setReservedCoins;
 
     int64_t nTimeFirstKey;
 
@@ -828,17 +906,28 @@ public:
                         AvailableCoinsFilter coinsFilter = AvailableCoinsFilter()
                         ) const;
     //! >> Available coins (spending)
-    bool SelectCoinsToSpend(const std::vector<COutput>& vAvailableCoins, const CAmount& nTargetValue, std::set<std::pair<const CWalletTx*, unsigned int> >& setCoinsRet, CAmount& nValueRet, const CCoinControl* coinControl = nullptr) const;
+    /**
+     * When pBnBParams is set, a changeless set of coins of vBnBPool is searched first (see SelectCoinsBnB),
+     * whose effective value covers nTargetValue plus the fee of the outputs, and pfBnBUsed is set when it's found.
+     */
+    bool SelectCoinsToSpend(const std::vector<COutput>& vAvailableCoins, const CAmount& nTargetValue, std::set<std::pair<const CWalletTx*, unsigned int> >& setCoinsRet, CAmount& nValueRet, const CCoinControl* coinControl = nullptr,
+                            const CoinSelectionParams* pBnBParams = nullptr, const std::vector<CInputCoin>& vBnBPool = {}, bool* pfBnBUsed = nullptr) const;
 
     /**
      * Select coins until nTargetValue is reached. Return the actual value
      * and the corresponding coin set.
      */
     bool SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int nConfTheirs, uint64_t nMaxAncestors, std::vector<COutput> vCoins, std::set<std::pair<const CWalletTx*, unsigned int> >& setCoinsRet, CAmount& nValueRet) const;
+    /** Branch and bound version of SelectCoinsMinConf, over vPool (the coins of vCoins valued by GetBnBCoinPool) */
+    bool SelectCoinsBnBMinConf(const CAmount& nTargetValue, int nConfMine, int nConfTheirs, uint64_t nMaxAncestors, const std::vector<COutput>& vCoins, const std::vector<CInputCoin>& vPool, const CAmount& nCostOfChange, std::set<std::pair<const CWalletTx*, unsigned int> >& setCoinsRet, CAmount& nValueRet) const;
+    /** Values the spendable coins of vCoins net of the fee of their input, sorted for SelectCoinsBnB */
+    std::vector<CInputCoin> GetBnBCoinPool(const std::vector<COutput>& vCoins, const CoinSelectionParams& params, SigVersion sigversion) const;
     //! >> Available coins (staking)
     bool StakeableCoins(std::vector<CStakeableOutput>* pCoins = nullptr);
     //! >> Available coins (P2CS)
     void GetAvailableP2CSCoins(std::vector<COutput>& vCoins) const;
+    /** Calls func on each indexed P2CS output (pruning the ones spent by a confirmed transaction), ordered by outpoint */
+    void ForEachP2CSOutput(const std::function<void(const CWalletTx&, uint32_t, const P2CSOutputKeys&)>& func) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
 
     std::map<CTxDestination, std::vector<COutput> > AvailableCoinsByAddress(bool fConfirmed, CAmount maxCoinValue, bool fIncludeColdStaking);
 
@@ -866,6 +955,7 @@ public:
 
     bool IsLockedCoin(const uint256& hash, unsigned int n) const;
     bool IsLockedNote(const SaplingOutPoint& op) const;
+    bool IsReservedCoin(const uint256& hash, unsigned int n) const;
 
     void LockCoin(const COutPoint& output);
     void LockNote(const SaplingOutPoint& op);
@@ -927,11 +1017,13 @@ public:
 
     // Search for notes and addresses from this wallet in the tx, and add the addresses --> IVK mapping to the keystore if missing.
     bool FindNotesDataAndAddMissingIVKToKeystore(const CTransaction& tx, Optional<mapSaplingNoteData_t>& saplingNoteData);
-    // Decrypt sapling output notes with the inputs ovk and updates saplingNoteDataMap
-    void AddExternalNotesDataToTx(CWalletTx& wtx) const;
+    // Decrypt sapling output notes with the inputs ovk and updates saplingNoteDataMap. Returns whether any note was added
+    bool AddExternalNotesDataToTx(CWalletTx& wtx) const;
 
     //! Generates new Sapling key
     libzcash::SaplingPaymentAddress GenerateNewSaplingZKey(std::string label = "");
+    //! Generates count new Sapling keys, with the same label
+    std::vector<libzcash::SaplingPaymentAddress> GenerateNewSaplingZKeys(unsigned int count, const std::string& label = "");
 
     //! pindex is the new tip being connected.
     void IncrementNoteWitnesses(const CBlockIndex* pindex,
@@ -1023,7 +1115,27 @@ public:
      */
     int64_t IncOrderPosNext(WalletBatch* batch = nullptr);
 
+    /**
+     * While alive, the database writes of the txs added to (or updated in) the wallet, e.g. by a connected block
+     * or a rescanned one, are deferred. They are made at its end, in a single database transaction, and once per tx.
+     * cs_wallet must be held during its whole lifetime. Can be nested, only the outermost one writes.
+     * The writes that fail are kept pending, and retried at the end of the next one or at the wallet flush.
+     */
+    class BatchWrites
+    {
+    private:
+        CWallet& wallet;
+
+    public:
+        explicit BatchWrites(CWallet& _wallet);
+        ~BatchWrites();
+    };
+
     void MarkDirty();
+    /** Invalidates the cached balances (any change of a wallet tx, of the last processed block, of the locked coins...) */
+    void MarkBalancesDirty() const { nBalancesGeneration++; }
+    /** Changes with the address book, which decides which outputs of the wallet txs are change */
+    uint64_t GetAddressBookGeneration() const { return nAddressBookGeneration; }
     bool AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose = true);
     bool LoadToWallet(CWalletTx& wtxIn);
     void TransactionAddedToMempool(const CTransactionRef& tx) override;
@@ -1055,7 +1167,46 @@ public:
     };
     Balance GetBalance(int min_depth = 0) const;
 
-    CAmount loopTxsBalance(const std::function<void(const uint256&, const CWalletTx&, CAmount&)>&method) const;
+private:
+    /**
+     * The balances are cached with the generation they were computed at, which MarkBalancesDirty() bumps, so that
+     * the repeated balance queries of an unchanged wallet don't walk mapWallet again.
+     * They are keyed by (balance getter, isminefilter, parameter of the getter).
+     */
+    enum BalanceType {
+        BALANCE_AVAILABLE,
+        BALANCE_COLD_STAKING,
+        BALANCE_IMMATURE_COLD_STAKING,
+        BALANCE_STAKING,
+        BALANCE_DELEGATED,
+        BALANCE_IMMATURE_DELEGATED,
+        BALANCE_UNCONFIRMED,
+        BALANCE_IMMATURE,
+        BALANCE_WATCH_ONLY,
+        BALANCE_UNCONFIRMED_WATCH_ONLY,
+        BALANCE_IMMATURE_WATCH_ONLY,
+    };
+    typedef std::tuple<BalanceType, isminefilter, int> BalanceCacheKey;
+    mutable std::atomic<uint64_t> nBalancesGeneration{0};
+    std::atomic<uint64_t> nAddressBookGeneration{0};
+    mutable std::map<BalanceCacheKey, std::pair<uint64_t, CAmount>> mapBalanceCache GUARDED_BY(cs_wallet);
+    mutable std::map<int, std::pair<uint64_t, Balance>> mapBalanceStructCache GUARDED_BY(cs_wallet);
+
+    struct SaltedScriptHasher : SaltedHasherBase
+    {
+        size_t operator()(const CScript& script) const { return CSipHasher(k0, k1).Write(script.data(), script.size()).Finalize(); }
+    };
+    //! IsMine results of the scriptPubKeys, valid while the keys generation of the store is nIsMineCacheGeneration
+    static const size_t MAX_ISMINE_CACHE_SIZE = 100000;
+    mutable Mutex cs_ismine_cache;
+    mutable std::unordered_map<CScript, isminetype, SaltedScriptHasher> mapIsMineCache GUARDED_BY(cs_ismine_cache);
+    mutable uint64_t nIsMineCacheGeneration GUARDED_BY(cs_ismine_cache){0};
+
+public:
+    /** Sums up method over mapWallet (or only over the txs with indexed P2CS outputs),
+     * or returns the cached sum of key if the wallet didn't change since */
+    CAmount loopTxsBalance(const std::function<void(const uint256&, const CWalletTx&, CAmount&)>&method,
+                           const Optional<BalanceCacheKey>& key = nullopt, bool fOnlyP2CS = false) const;
     CAmount GetAvailableBalance(bool fIncludeDelegated = true, bool fIncludeShielded = true) const;
     CAmount GetAvailableBalance(isminefilter& filter, bool useCache = false, int minDepth = 1) const;
     CAmount GetColdStakingBalance() const;  // delegated coins for which we have the staking key
@@ -1130,6 +1281,8 @@ public:
 
     size_t KeypoolCountExternalKeys();
     bool TopUpKeyPool(unsigned int kpSize = 0);
+    //! Replaces the keys drawn from the pool, in the background when possible (see ScriptPubKeyMan::MaybeTopUp)
+    bool MaybeTopUpKeyPool();
     void KeepKey(int64_t nIndex);
     void ReturnKey(int64_t nIndex, const bool internal = false, const bool staking = false);
     bool GetKeyFromPool(CPubKey& key, const uint8_t& type = HDChain::ChangeType::EXTERNAL);
@@ -1194,6 +1347,10 @@ public:
     //! get the current wallet format (the oldest client version guaranteed to understand this wallet)
     int GetVersion();
 
+    //! Estimated memory usage of mapWallet (with the transactions), and of the Sapling witnesses cached in it
+    size_t GetWalletTxsMemoryUsage() const;
+    size_t GetSaplingWitnessesMemoryUsage() const;
+
     //! Get wallet transactions that conflict with given transaction (spend same outputs)
     std::set<uint256> GetConflicts(const uint256& txid) const;
 
@@ -1258,6 +1415,8 @@ protected:
     int64_t nIndex;
     bool internal{false};
     CPubKey vchPubKey;
+    //! Coins reserved by the CreateTransaction calls, for the CommitTransaction
+    std::vector<COutPoint> vReservedCoins;
 
 public:
     CReserveKey(CWallet* pwalletIn)
@@ -1273,11 +1432,20 @@ public:
     ~CReserveKey()
     {
         ReturnKey();
+        ReturnCoins();
     }
 
     void ReturnKey();
     bool GetReservedKey(CPubKey& pubkey, bool internal = false);
     void KeepKey();
+
+    /**
+     * Keep the coins out of the coin selection of the other transactions, while the transaction spending them is
+     * signed out of cs_wallet and until it's committed (or this is destroyed). Requires cs_wallet.
+     */
+    void ReserveCoins(const std::vector<COutPoint>& vCoins);
+    //! Release the reserved coins (spent by the committed transaction, or not spent)
+    void ReturnCoins();
 };
 
 class COutput
@@ -9,6 +9,7 @@
 
 #include "fs.h"
 
+#include "ctpl_stl.h"
 #include "key_io.h"
 #include "protocol.h"
 #include "reverse_iterate.h"
@@ -350,6 +351,53 @@ public:
     }
 };
 
+/**
+ * Deserializes a tx record (ssKey being past its type), which doesn't need the wallet, so that the records can be
+ * read on several threads. fUpgraded is set when the record has to be rewritten.
+ */
+static bool ReadTxRecord(CDataStream& ssKey, CDataStream& ssValue, CWalletTx& wtx, bool& fUpgraded, std::string& strErr)
+{
+    fUpgraded = false;
+    try {
+        uint256 hash;
+        ssKey >> hash;
+        ssValue >> wtx;
+        if (wtx.GetHash() != hash)
+            return false;
+
+        // Undo serialize changes in 31600
+        if (31404 <= wtx.fTimeReceivedIsTxTime && wtx.fTimeReceivedIsTxTime <= 31703) {
+            if (!ssValue.empty()) {
+                char fTmp;
+                char fUnused;
+                std::string unused_string;
+                ssValue >> fTmp >> fUnused >> unused_string;
+                strErr = strprintf("LoadWallet() upgrading tx ver=%d %d %s",
+                    wtx.fTimeReceivedIsTxTime, fTmp, hash.ToString());
+                wtx.fTimeReceivedIsTxTime = fTmp;
+            } else {
+                strErr = strprintf("LoadWallet() repairing tx ver=%d %s", wtx.fTimeReceivedIsTxTime, hash.ToString());
+                wtx.fTimeReceivedIsTxTime = 0;
+            }
+            fUpgraded = true;
+        }
+    } catch (...) {
+        return false;
+    }
+    return true;
+}
+
+static void LoadTxRecord(CWallet* pwallet, CWalletTx& wtx, bool fUpgraded, CWalletScanState& wss)
+{
+    if (fUpgraded)
+        wss.vWalletUpgrade.push_back(wtx.GetHash());
+
+    if (wtx.nOrderPos == -1)
+        wss.fAnyUnordered = true;
+
+    pwallet->LoadToWallet(wtx);
+}
+
 bool ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue, CWalletScanState& wss, std::string& strType, std::string& strErr)
 {
     try {
@@ -370,34 +418,11 @@ bool ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue, CW
             ssValue >> strPurpose;
             pwallet->LoadAddressBookPurpose(Standard::DecodeDestination(strAddress), strPurpose);
         } else if (strType == DBKeys::TX) {
-            uint256 hash;
-            ssKey >> hash;
             CWalletTx wtx(nullptr /* pwallet */, MakeTransactionRef());
-            ssValue >> wtx;
-            if (wtx.GetHash() != hash)
+            bool fUpgraded;
+            if (!ReadTxRecord(ssKey, ssValue, wtx, fUpgraded, strErr))
                 return false;
-
-            // Undo serialize changes in 31600
-            if (31404 <= wtx.fTimeReceivedIsTxTime && wtx.fTimeReceivedIsTxTime <= 31703) {
-                if (!ssValue.empty()) {
-                    char fTmp;
-                    char fUnused;
-                    std::string unused_string;
-                    ssValue >> fTmp >> fUnused >> unused_string;
-                    strErr = strprintf("LoadWallet() upgrading tx ver=%d %d %s",
-                        wtx.fTimeReceivedIsTxTime, fTmp, hash.ToString());
-                    wtx.fTimeReceivedIsTxTime = fTmp;
-                } else {
-                    strErr = strprintf("LoadWallet() repairing tx ver=%d %s", wtx.fTimeReceivedIsTxTime, hash.ToString());
-                    wtx.fTimeReceivedIsTxTime = 0;
-                }
-                wss.vWalletUpgrade.push_back(hash);
-            }
-
-            if (wtx.nOrderPos == -1)
-                wss.fAnyUnordered = true;
-
-            pwallet->LoadToWallet(wtx);
+            LoadTxRecord(pwallet, wtx, fUpgraded, wss);
         } else if (strType == DBKeys::WATCHS) {
             CScript script;
             ssKey >> script;
@@ -632,12 +657,80 @@ bool WalletBatch::IsKeyType(const std::string& strType)
             strType == DBKeys::SAP_KEY || strType == DBKeys::SAP_KEY_CRIPTED);
 }
 
+//! Number of tx records deserialized at once, on several threads once a first batch is full
+static const size_t LOAD_TX_BATCH_SIZE = 1000;
+static const int MAX_LOAD_TX_THREADS = 8;
+
+namespace {
+struct TxRecord
+{
+    CDataStream ssKey;
+    CDataStream ssValue;
+    CWalletTx wtx{nullptr /* pwallet */, MakeTransactionRef()};
+    bool fRead{false};
+    bool fUpgraded{false};
+    std::string strErr;
+
+    TxRecord(CDataStream&& _ssKey, CDataStream&& _ssValue) : ssKey(std::move(_ssKey)), ssValue(std::move(_ssValue)) {}
+    void Read()
+    {
+        std::string strType;
+        ssKey >> strType;
+        fRead = ReadTxRecord(ssKey, ssValue, wtx, fUpgraded, strErr);
+    }
+};
+} // anon namespace
+
 DBErrors WalletBatch::LoadWallet(CWallet* pwallet)
 {
     CWalletScanState wss;
     bool fNoncriticalErrors = false;
     DBErrors result = DB_LOAD_OK;
 
+    // The tx records (usually the bulk of the wallet) are deserialized in batches, on a pool of threads
+    // for the large wallets, and then loaded in the order of the database.
+    std::vector<TxRecord> vTxRecords;
+    vTxRecords.reserve(LOAD_TX_BATCH_SIZE);
+    std::unique_ptr<ctpl::thread_pool> readerPool;
+    const int nReaders = std::min(GetNumCores() - 1, MAX_LOAD_TX_THREADS);
+    auto loadTxRecords = [&]() {
+        if (vTxRecords.empty()) return;
+        if (!readerPool && nReaders > 1 && vTxRecords.size() >= LOAD_TX_BATCH_SIZE) {
+            readerPool.reset(new ctpl::thread_pool(nReaders));
+        }
+        if (readerPool) {
+            const size_t nChunk = (vTxRecords.size() + nReaders - 1) / nReaders;
+            std::vector<std::future<void>> vReads;
+            for (size_t nStart = 0; nStart < vTxRecords.size(); nStart += nChunk) {
+                const size_t nEnd = std::min(nStart + nChunk, vTxRecords.size());
+                vReads.emplace_back(readerPool->push([&vTxRecords, nStart, nEnd](int) {
+                    for (size_t i = nStart; i < nEnd; i++) vTxRecords[i].Read();
+                }));
+            }
+            for (auto& f : vReads) f.get();
+        } else {
+            for (TxRecord& record : vTxRecords) record.Read();
+        }
+        for (TxRecord& record : vTxRecords) {
+            bool fLoaded = record.fRead;
+            if (fLoaded) {
+                try {
+                    LoadTxRecord(pwallet, record.wtx, record.fUpgraded, wss);
+                } catch (...) {
+                    fLoaded = false;
+                }
+            }
+            if (!fLoaded) {
+                fNoncriticalErrors = true;
+                // Rescan if there is a bad transaction record:
+                gArgs.SoftSetBoolArg("-rescan", true);
+            }
+            if (!record.strErr.empty())
+                LogPrintf("%s\n", record.strErr);
+        }
+        vTxRecords.clear();
+    };
+
     LOCK(pwallet->cs_wallet);
     try {
         int nMinVersion = 0;
@@ -667,8 +760,22 @@ DBErrors WalletBatch::LoadWallet(CWallet* pwallet)
                 return DB_CORRUPT;
             }
 
-            // Try to be tolerant of single corrupt records:
             std::string strType, strErr;
+            try {
+                CDataStream ssType(ssKey);
+                ssType >> strType;
+            } catch (...) {
+                strType.clear();
+            }
+            if (strType == DBKeys::TX) {
+                vTxRecords.emplace_back(std::move(ssKey), std::move(ssValue));
+                if (vTxRecords.size() >= LOAD_TX_BATCH_SIZE) loadTxRecords();
+                continue;
+            }
+            // Keep the order of the records
+            loadTxRecords();
+
+            // Try to be tolerant of single corrupt records:
             if (!ReadKeyValue(pwallet, ssKey, ssValue, wss, strType, strErr)) {
                 // losing keys is considered a catastrophic error, anything else
                 // we assume the user can live with:
@@ -685,6 +792,7 @@ DBErrors WalletBatch::LoadWallet(CWallet* pwallet)
             if (!strErr.empty())
                 LogPrintf("%s\n", strErr);
         }
+        loadTxRecords();
         pcursor->close();
     } catch (const boost::thread_interrupted&) {
         throw;
@@ -21,3 +21,17 @@ bool CZMQAbstractNotifier::NotifyTransaction(const CTransaction &/*transaction*/
     return true;
 }
 
+bool CZMQAbstractNotifier::NotifyTransactionRemoved(const CTransaction &/*transaction*/, MemPoolRemovalReason /*reason*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyChainLock(const CBlockIndex * /*pindex*/, const llmq::CChainLockSig& /*clsig*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyMasternodeListChanged(bool /*undo*/, const CDeterministicMNList& /*oldMNList*/, const CDeterministicMNListDiff& /*diff*/)
+{
+    return true;
+}
@@ -7,15 +7,26 @@
 
 #include "zmqconfig.h"
 
+#include <atomic>
+
 class CBlockIndex;
+class CDeterministicMNList;
+class CDeterministicMNListDiff;
 class CZMQAbstractNotifier;
+enum class MemPoolRemovalReason;
+
+namespace llmq {
+class CChainLockSig;
+} // namespace llmq
 
 typedef CZMQAbstractNotifier* (*CZMQNotifierFactory)();
 
 class CZMQAbstractNotifier
 {
 public:
-    CZMQAbstractNotifier() : psocket(0) { }
+    static const int DEFAULT_ZMQ_SNDHWM {1000};
+
+    CZMQAbstractNotifier() : psocket(0), outbound_message_high_water_mark(DEFAULT_ZMQ_SNDHWM) { }
     virtual ~CZMQAbstractNotifier();
 
     template <typename T>
@@ -28,17 +39,33 @@ public:
     void SetType(const std::string &t) { type = t; }
     std::string GetAddress() const { return address; }
     void SetAddress(const std::string &a) { address = a; }
+    int GetOutboundMessageHighWaterMark() const { return outbound_message_high_water_mark; }
+    void SetOutboundMessageHighWaterMark(const int sndhwm) {
+        if (sndhwm >= 0) {
+            outbound_message_high_water_mark = sndhwm;
+        }
+    }
+    //! Sequence number of the next notification
+    uint32_t GetSequence() const { return nSequence; }
+    //! Number of notifications dropped because the queue of the publisher thread was full
+    uint64_t GetDroppedMessages() const { return nDropped; }
 
     virtual bool Initialize(void *pcontext) = 0;
     virtual void Shutdown() = 0;
 
     virtual bool NotifyBlock(const CBlockIndex *pindex);
     virtual bool NotifyTransaction(const CTransaction &transaction);
+    virtual bool NotifyTransactionRemoved(const CTransaction &transaction, MemPoolRemovalReason reason);
+    virtual bool NotifyChainLock(const CBlockIndex *pindex, const llmq::CChainLockSig& clsig);
+    virtual bool NotifyMasternodeListChanged(bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNListDiff& diff);
 
 protected:
     void *psocket;
     std::string type;
     std::string address;
+    int outbound_message_high_water_mark; // aka SNDHWM
+    std::atomic<uint32_t> nSequence{0}; // upcounting per message sequence number
+    std::atomic<uint64_t> nDropped{0};
 };
 
 #endif // BITCOIN_ZMQ_ZMQABSTRACTNOTIFIER_H
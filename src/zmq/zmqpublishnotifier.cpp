@@ -7,14 +7,27 @@
 #include "chainparams.h"
 #include "util/system.h"
 #include "crypto/common.h"
+#include "evo/deterministicmns.h"
+#include "llmq/quorums_chainlocks.h"
+#include "sync.h"
+#include "txmempool.h"
 #include "validation.h"     // cs_main
 
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
 static std::multimap<std::string, CZMQAbstractPublishNotifier*> mapPublishNotifiers;
 
 static const char *MSG_HASHBLOCK  = "hashblock";
 static const char *MSG_HASHTX     = "hashtx";
 static const char *MSG_RAWBLOCK   = "rawblock";
 static const char *MSG_RAWTX      = "rawtx";
+static const char *MSG_HASHTXREMOVED   = "hashtxremoved";
+static const char *MSG_HASHCHAINLOCK   = "hashchainlock";
+static const char *MSG_RAWCHAINLOCK    = "rawchainlock";
+static const char *MSG_RAWCHAINLOCKSIG = "rawchainlocksig";
+static const char *MSG_MNLISTDIFF      = "mnlistdiff";
 
 // Internal function to send multipart message
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
@@ -59,6 +72,114 @@ static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
     return 0;
 }
 
+/** A message of a publish notifier, waiting to be sent by the publisher thread */
+struct ZMQPublishMessage
+{
+    void* psocket;
+    const char* command;
+    std::vector<unsigned char> data;
+    uint32_t nSequence;
+};
+
+/**
+ * The messages of all the publish notifiers, sent in order by a single thread, so that
+ * the validation interface callbacks don't wait for the sockets (which are only used by
+ * this thread while it runs). The thread takes all the messages queued at once, so that
+ * a burst of notifications (e.g. the rawtx of a block) is sent as a batch.
+ */
+class CZMQPublishQueue
+{
+private:
+    Mutex cs;
+    std::condition_variable cond;
+    std::condition_variable condSent;
+    std::deque<ZMQPublishMessage> queue GUARDED_BY(cs);
+    size_t nMaxSize GUARDED_BY(cs){DEFAULT_ZMQ_QUEUE_SIZE};
+    bool fStop GUARDED_BY(cs){false};
+    bool fSending GUARDED_BY(cs){false};
+    std::thread thread;
+
+    void Thread()
+    {
+        while (true) {
+            std::deque<ZMQPublishMessage> batch;
+            {
+                WAIT_LOCK(cs, lock);
+                fSending = false;
+                condSent.notify_all();
+                cond.wait(lock, [this]() EXCLUSIVE_LOCKS_REQUIRED(cs) { return fStop || !queue.empty(); });
+                // Stopped, once all the messages are sent
+                if (queue.empty()) break;
+                batch.swap(queue);
+                fSending = true;
+            }
+            for (const ZMQPublishMessage& msg : batch) {
+                /* send three parts, command & data & a LE 4byte sequence number */
+                unsigned char msgseq[sizeof(uint32_t)];
+                WriteLE32(&msgseq[0], msg.nSequence);
+                zmq_send_multipart(msg.psocket, msg.command, strlen(msg.command), msg.data.data(), msg.data.size(),
+                                   msgseq, (size_t)sizeof(uint32_t), (void*)0);
+            }
+        }
+    }
+
+public:
+    void Start(size_t nMaxSizeIn)
+    {
+        assert(!thread.joinable());
+        {
+            LOCK(cs);
+            nMaxSize = nMaxSizeIn;
+            fStop = false;
+        }
+        thread = std::thread(&TraceThread<std::function<void()>>, "zmqpub", std::function<void()>(std::bind(&CZMQPublishQueue::Thread, this)));
+    }
+
+    void Stop()
+    {
+        {
+            LOCK(cs);
+            fStop = true;
+        }
+        cond.notify_one();
+        if (thread.joinable()) thread.join();
+    }
+
+    /** Queue a message. Returns false (dropping it) if the queue is full */
+    bool Push(ZMQPublishMessage&& msg)
+    {
+        {
+            LOCK(cs);
+            if (queue.size() >= nMaxSize) return false;
+            queue.emplace_back(std::move(msg));
+            // Otherwise the thread is already sending, and takes this message next
+            if (queue.size() > 1) return true;
+        }
+        cond.notify_one();
+        return true;
+    }
+
+    /** Wait until the messages queued until now are sent */
+    void Flush()
+    {
+        WAIT_LOCK(cs, lock);
+        if (!thread.joinable()) return;
+        condSent.wait(lock, [this]() EXCLUSIVE_LOCKS_REQUIRED(cs) { return queue.empty() && !fSending; });
+    }
+};
+
+static CZMQPublishQueue publishQueue;
+
+void CZMQAbstractPublishNotifier::StartPublisher(size_t nMaxQueueSize)
+{
+    publishQueue.Start(nMaxQueueSize);
+}
+
+void CZMQAbstractPublishNotifier::StopPublisher()
+{
+    publishQueue.Stop();
+}
+
 bool CZMQAbstractPublishNotifier::Initialize(void *pcontext)
 {
     assert(!psocket);
@@ -75,7 +196,16 @@ bool CZMQAbstractPublishNotifier::Initialize(void *pcontext)
             return false;
         }
 
-        int rc = zmq_bind(psocket, address.c_str());
+        LogPrint(BCLog::ZMQ, "Outbound message high water mark for %s at %s is %d\n", type, address, outbound_message_high_water_mark);
+
+        int rc = zmq_setsockopt(psocket, ZMQ_SNDHWM, &outbound_message_high_water_mark, sizeof(outbound_message_high_water_mark));
+        if (rc != 0) {
+            zmqError("Failed to set outbound message high water mark");
+            zmq_close(psocket);
+            return false;
+        }
+
+        rc = zmq_bind(psocket, address.c_str());
         if (rc!=0)
         {
             zmqError("Failed to bind address");
@@ -119,6 +249,8 @@ void CZMQAbstractPublishNotifier::Shutdown()
 
     if (count == 1)
     {
+        // The publisher thread may still send messages of this socket
+        publishQueue.Flush();
         LogPrint(BCLog::ZMQ, "Close socket at address %s\n", address);
         int linger = 0;
         zmq_setsockopt(psocket, ZMQ_LINGER, &linger, sizeof(linger));
@@ -132,15 +264,13 @@ bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const void* d
 {
     assert(psocket);
 
-    /* send three parts, command & data & a LE 4byte sequence number */
-    unsigned char msgseq[sizeof(uint32_t)];
-    WriteLE32(&msgseq[0], nSequence);
-    int rc = zmq_send_multipart(psocket, command, strlen(command), data, size, msgseq, (size_t)sizeof(uint32_t), (void*)0);
-    if (rc == -1)
-        return false;
-
-    /* increment memory only sequence number after sending */
-    nSequence++;
+    /* increment memory only sequence number, also for the dropped messages */
+    const uint32_t nMsgSequence = nSequence++;
+    const unsigned char* begin = static_cast<const unsigned char*>(data);
+    if (!publishQueue.Push({psocket, command, std::vector<unsigned char>(begin, begin + size), nMsgSequence})) {
+        LogPrint(BCLog::ZMQ, "Queue full, dropped %s message %u\n", command, nMsgSequence);
+        nDropped++;
+    }
 
     return true;
 }
@@ -193,3 +323,81 @@ bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &tr
     ss << transaction;
     return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
 }
+
+bool CZMQPublishHashTransactionRemovedNotifier::NotifyTransactionRemoved(const CTransaction &transaction, MemPoolRemovalReason reason)
+{
+    uint256 hash = transaction.GetHash();
+    LogPrint(BCLog::ZMQ, "Publish hashtxremoved %s (reason %d)\n", hash.GetHex(), (int)reason);
+    /* the hash followed by the reason of the removal */
+    char data[33];
+    for (unsigned int i = 0; i < 32; i++)
+        data[31 - i] = hash.begin()[i];
+    data[32] = (char)reason;
+    return SendMessage(MSG_HASHTXREMOVED, data, 33);
+}
+
+bool CZMQPublishHashChainLockNotifier::NotifyChainLock(const CBlockIndex *pindex, const llmq::CChainLockSig& clsig)
+{
+    uint256 hash = pindex->GetBlockHash();
+    LogPrint(BCLog::ZMQ, "Publish hashchainlock %s\n", hash.GetHex());
+    char data[32];
+    for (unsigned int i = 0; i < 32; i++)
+        data[31 - i] = hash.begin()[i];
+    return SendMessage(MSG_HASHCHAINLOCK, data, 32);
+}
+
+static bool ReadChainLockedBlock(const CBlockIndex *pindex, CDataStream& ss)
+{
+    LOCK(cs_main);
+    CBlock block;
+    if (!ReadBlockFromDisk(block, pindex)) {
+        zmqError("Can't read block from disk");
+        return false;
+    }
+    ss << block;
+    return true;
+}
+
+bool CZMQPublishRawChainLockNotifier::NotifyChainLock(const CBlockIndex *pindex, const llmq::CChainLockSig& clsig)
+{
+    LogPrint(BCLog::ZMQ, "Publish rawchainlock %s\n", pindex->GetBlockHash().GetHex());
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    if (!ReadChainLockedBlock(pindex, ss)) {
+        return false;
+    }
+    return SendMessage(MSG_RAWCHAINLOCK, &(*ss.begin()), ss.size());
+}
+
+bool CZMQPublishRawChainLockSigNotifier::NotifyChainLock(const CBlockIndex *pindex, const llmq::CChainLockSig& clsig)
+{
+    LogPrint(BCLog::ZMQ, "Publish rawchainlocksig %s\n", pindex->GetBlockHash().GetHex());
+    /* the block followed by the chainlock signature */
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    if (!ReadChainLockedBlock(pindex, ss)) {
+        return false;
+    }
+    ss << clsig;
+    return SendMessage(MSG_RAWCHAINLOCKSIG, &(*ss.begin()), ss.size());
+}
+
+bool CZMQPublishMasternodeListDiffNotifier::NotifyMasternodeListChanged(bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNListDiff& diff)
+{
+    LogPrint(BCLog::ZMQ, "Publish mnlistdiff %s (undo=%d)\n", oldMNList.GetBlockHash().GetHex(), undo);
+    /* the pro-reg tx hashes of the added, updated and removed masternodes, from the list of a block
+       (to the list of its child, or of its parent with undo) */
+    std::vector<uint256> vAdded, vUpdated, vRemoved;
+    for (const auto& dmn : diff.addedMNs) {
+        vAdded.emplace_back(dmn->proTxHash);
+    }
+    for (const auto& p : diff.updatedMNs) {
+        auto dmn = oldMNList.GetMNByInternalId(p.first);
+        if (dmn) vUpdated.emplace_back(dmn->proTxHash);
+    }
+    for (uint64_t internalId : diff.removedMns) {
+        auto dmn = oldMNList.GetMNByInternalId(internalId);
+        if (dmn) vRemoved.emplace_back(dmn->proTxHash);
+    }
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << undo << oldMNList.GetBlockHash() << oldMNList.GetHeight() << vAdded << vUpdated << vRemoved;
+    return SendMessage(MSG_MNLISTDIFF, &(*ss.begin()), ss.size());
+}
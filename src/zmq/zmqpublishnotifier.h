@@ -9,23 +9,30 @@
 
 class CBlockIndex;
 
+//! Default for -zmqqueuesize
+static const size_t DEFAULT_ZMQ_QUEUE_SIZE = 10000;
+
 class CZMQAbstractPublishNotifier : public CZMQAbstractNotifier
 {
-private:
-    uint32_t nSequence{0}; // upcounting per message sequence number
-
 public:
 
-    /* send zmq multipart message
+    /* queue zmq multipart message, sent by the publisher thread
        parts:
           * command
           * data
           * message sequence number
+       When the queue is full, the message is dropped, but its sequence number
+       is still used, so that the subscribers can detect the gap.
     */
     bool SendMessage(const char *command, const void* data, size_t size);
 
     bool Initialize(void *pcontext);
     void Shutdown();
+
+    /** Start the thread sending the messages of the publish notifiers, queuing up to nMaxQueueSize messages */
+    static void StartPublisher(size_t nMaxQueueSize);
+    /** Send the queued messages and stop the publisher thread */
+    static void StopPublisher();
 };
 
 class CZMQPublishHashBlockNotifier : public CZMQAbstractPublishNotifier
@@ -52,4 +59,34 @@ public:
     bool NotifyTransaction(const CTransaction &transaction);
 };
 
+class CZMQPublishHashTransactionRemovedNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyTransactionRemoved(const CTransaction &transaction, MemPoolRemovalReason reason) override;
+};
+
+class CZMQPublishHashChainLockNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyChainLock(const CBlockIndex *pindex, const llmq::CChainLockSig& clsig) override;
+};
+
+class CZMQPublishRawChainLockNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyChainLock(const CBlockIndex *pindex, const llmq::CChainLockSig& clsig) override;
+};
+
+class CZMQPublishRawChainLockSigNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyChainLock(const CBlockIndex *pindex, const llmq::CChainLockSig& clsig) override;
+};
+
+class CZMQPublishMasternodeListDiffNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyMasternodeListChanged(bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNListDiff& diff) override;
+};
+
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H
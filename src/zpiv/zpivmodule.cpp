@@ -197,8 +197,7 @@ namespace ZPIVModule {
         return spend;
     }
 
-    bool validateInput(const CTxIn &in, const CTxOut &prevOut, const CTransaction &tx, PublicCoinSpend &publicSpend) {
-        // Now prove that the commitment value opens to the input
+    bool validateInputWithoutVerification(const CTxIn &in, const CTxOut &prevOut, const CTransaction &tx, PublicCoinSpend &publicSpend) {
         if (!parseCoinSpend(in, tx, prevOut, publicSpend)) {
             return false;
         }
@@ -206,7 +205,12 @@ namespace ZPIVModule {
                 libzerocoin::IntToZerocoinDenomination(in.nSequence)) != prevOut.nValue) {
             return error("PublicCoinSpend validateInput :: input nSequence different to prevout value");
         }
-        return publicSpend.Verify();
+        return true;
+    }
+
+    bool validateInput(const CTxIn &in, const CTxOut &prevOut, const CTransaction &tx, PublicCoinSpend &publicSpend) {
+        // Now prove that the commitment value opens to the input
+        return validateInputWithoutVerification(in, prevOut, tx, publicSpend) && publicSpend.Verify();
     }
 
     bool ParseZerocoinPublicSpend(const CTxIn &txIn, const CTransaction& tx, CValidationState& state, PublicCoinSpend& publicSpend)
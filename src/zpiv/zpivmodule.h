@@ -68,6 +68,8 @@ namespace ZPIVModule {
     bool parseCoinSpend(const CTxIn &in, const CTransaction& tx, const CTxOut &prevOut, PublicCoinSpend& publicCoinSpend);
     libzerocoin::CoinSpend TxInToZerocoinSpend(const CTxIn& txin);
     bool validateInput(const CTxIn &in, const CTxOut &prevOut, const CTransaction& tx, PublicCoinSpend& ret);
+    // Same as validateInput, without the (expensive) PublicCoinSpend::Verify left to the caller
+    bool validateInputWithoutVerification(const CTxIn &in, const CTxOut &prevOut, const CTransaction& tx, PublicCoinSpend& ret);
 
     // Public zc spend parse
     /**
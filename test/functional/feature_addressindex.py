@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 The PIVX Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or https://www.opensource.org/licenses/mit-license.php .
+"""Test the address and spent indexes: the getaddress* RPCs, the /rest/address endpoints,
+the inputs resolved by getrawtransaction, and the reorgs"""
+
+from decimal import Decimal
+import http.client
+import json
+import urllib.parse
+
+from test_framework.test_framework import PivxTestFramework
+from test_framework.util import (
+    assert_equal,
+    assert_raises_rpc_error,
+)
+
+
+class AddressIndexTest(PivxTestFramework):
+
+    def set_test_params(self):
+        # The index is built from the genesis block
+        self.setup_clean_chain = True
+        self.num_nodes = 2
+        self.extra_args = [["-addressindex", "-spentindex"], []]
+
+    def check_address(self, addr, balance, received, txids, utxos):
+        node = self.nodes[0]
+        assert_equal(node.getaddressbalance(addr), {"balance": balance, "received": received})
+        assert_equal(node.getaddresstxids([addr]), txids)
+        assert_equal([(u["txid"], u["satoshis"]) for u in node.getaddressutxos(addr)], utxos)
+
+    def run_test(self):
+        node = self.nodes[0]
+        node.generate(101)
+        self.sync_all()
+        addr = self.nodes[1].getnewaddress()
+        self.check_address(addr, 0, 0, [], [])
+
+        self.log.info("Receive to the address")
+        txid = node.sendtoaddress(addr, 10)
+        node.generate(1)
+        self.sync_all()
+        self.check_address(addr, 10, 10, [txid], [(txid, 10 * 100000000)])
+
+        self.log.info("Spend from the address")
+        utxo = [u for u in node.getaddressutxos(addr) if u["txid"] == txid][0]
+        inputs = [{"txid": txid, "vout": utxo["outputIndex"]}]
+        raw = self.nodes[1].createrawtransaction(inputs, {node.getnewaddress(): Decimal("9.99")})
+        spend_txid = self.nodes[1].sendrawtransaction(self.nodes[1].signrawtransaction(raw)["hex"])
+        self.sync_all()
+        node.generate(1)
+        self.sync_all()
+        self.check_address(addr, 0, 10, [txid, spend_txid], [])
+        tip_height = node.getblockcount()
+
+        self.log.info("Resolve the inputs from the spent index")
+        tx = node.getrawtransaction(spend_txid, True)
+        assert_equal(tx["vin"][0]["value"], 10)
+        assert_equal(tx["vin"][0]["address"], addr)
+        assert_equal(tx["fee"], Decimal("0.01"))
+        prev_out = node.getrawtransaction(txid, True)["vout"][utxo["outputIndex"]]
+        assert_equal((prev_out["spentTxId"], prev_out["spentIndex"], prev_out["spentHeight"]), (spend_txid, 0, tip_height))
+        assert "fee" not in self.nodes[1].getrawtransaction(spend_txid, True)
+        assert_equal(node.getaddresstxids([addr], tip_height, tip_height), [spend_txid])
+        assert_equal(node.getaddresstxids([addr], 0, tip_height - 1), [txid])
+
+        self.log.info("Query the REST endpoints")
+        url = urllib.parse.urlparse(node.url)
+        conn = http.client.HTTPConnection(url.hostname, url.port)
+        conn.request('GET', '/rest/address/txids/' + addr + '.json')
+        assert_equal(json.loads(conn.getresponse().read().decode('utf-8')), [txid, spend_txid])
+        conn.request('GET', '/rest/address/balance/' + addr + '.json')
+        assert_equal(json.loads(conn.getresponse().read().decode('utf-8'))["received"], 10)
+        conn.request('GET', '/rest/address/utxos/invalid.json')
+        assert_equal(conn.getresponse().status, 400)
+
+        self.log.info("Disconnect the spending block")
+        node.invalidateblock(node.getbestblockhash())
+        self.check_address(addr, 10, 10, [txid], [(txid, 10 * 100000000)])
+        assert "spentTxId" not in node.getrawtransaction(txid, True)["vout"][utxo["outputIndex"]]
+        node.reconsiderblock(self.nodes[1].getbestblockhash())
+        self.check_address(addr, 0, 10, [txid, spend_txid], [])
+
+        self.log.info("The index is optional")
+        assert_raises_rpc_error(-1, "Address index not enabled", self.nodes[1].getaddressbalance, addr)
+
+
+if __name__ == '__main__':
+    AddressIndexTest().main()
@@ -0,0 +1,54 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 The PIVX Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the block verification of the startup (-checkblocks, -checklevel).
+
+The levels 3-4 disconnect and reconnect the blocks: they must be done
+before the node is loaded, and leave the chain state as it was.
+"""
+
+from test_framework.test_framework import PivxTestFramework
+from test_framework.util import assert_equal
+
+
+class VerifyDBTest(PivxTestFramework):
+
+    def set_test_params(self):
+        self.num_nodes = 1
+        self.setup_clean_chain = True
+
+    def chain_state(self):
+        node = self.nodes[0]
+        return (node.getbestblockhash(), node.gettxoutsetinfo()['hash_serialized_2'],
+                sorted(node.getrawmempool()), node.getbalance())
+
+    def run_test(self):
+        node = self.nodes[0]
+        node.generate(120)
+        node.sendtoaddress(node.getnewaddress(), 1)
+        node.generate(5)
+        # A tx in the mempool, to check that it's untouched
+        node.sendtoaddress(node.getnewaddress(), 1)
+        state = self.chain_state()
+
+        for level in range(5):
+            self.log.info("Verify the last 50 blocks at level %d at startup" % level)
+            self.restart_node(0, extra_args=['-checklevel=%d' % level, '-checkblocks=50'])
+            # Already done once the node answers the RPC calls
+            info = node.getverifychaininfo()
+            assert_equal(info['running'], False)
+            assert_equal(info['result'], True)
+            assert_equal(info['checklevel'], level)
+            assert_equal(info['checkblocks'], 50)
+            assert_equal(info['progress'], 100)
+            assert_equal(self.chain_state(), state)
+
+        self.log.info("The chain state is still usable after the verification")
+        node.generate(1)
+        assert_equal(node.getblockcount(), 126)
+        assert_equal(len(node.getrawmempool()), 0)
+
+
+if __name__ == '__main__':
+    VerifyDBTest().main()
@@ -4,6 +4,7 @@
 # file COPYING or http://www.opensource.org/licenses/mit-license.php.
 """Test pivx-cli"""
 
+import json
 import time
 
 from test_framework.test_framework import PivxTestFramework
@@ -57,5 +58,20 @@ class TestBitcoinCli(PivxTestFramework):
         assert_equal(cli_get_info['relayfee'], network_info['relayfee'])
         # unlocked_until is not tested because the wallet is not encrypted
 
+        self.log.info("Compare responses from `pivx-cli -batch` and the RPCs")
+        commands = "getblockcount\n" \
+                   "# comment\n" \
+                   "{\"method\": \"getbestblockhash\", \"params\": [], \"id\": \"best\"}\n" \
+                   "\n" \
+                   "getblockhash 0\n"
+        for batchsize in [1, 2, 10]:
+            cli_output = self.nodes[0].cli("-batch", "-batchsize=%d" % batchsize, input=commands).send_cli()
+            replies = [json.loads(line) for line in cli_output.split("\n")]
+            assert_equal([r["id"] for r in replies], [1, "best", 5])
+            assert_equal([r["error"] for r in replies], [None] * 3)
+            assert_equal(replies[0]["result"], self.nodes[0].getblockcount())
+            assert_equal(replies[1]["result"], self.nodes[0].getbestblockhash())
+            assert_equal(replies[2]["result"], self.nodes[0].getblockhash(0))
+
 if __name__ == '__main__':
     TestBitcoinCli().main()
@@ -14,6 +14,7 @@ from test_framework.util import assert_equal, str_to_b64str
 class HTTPBasicsTest (PivxTestFramework):
     def set_test_params(self):
         self.num_nodes = 3
+        self.extra_args = [[], ["-rpcheavythreads=1", "-rpcreadthreads=2"], []]
 
     def setup_network(self):
         self.setup_nodes()
@@ -104,6 +105,23 @@ class HTTPBasicsTest (PivxTestFramework):
         out1 = conn.getresponse()
         assert_equal(out1.status, http.client.BAD_REQUEST)
 
+        # Check the separate work queues
+        assert_equal([q["name"] for q in self.nodes[0].getrpcworkqueues()], ["default"])
+        node = self.nodes[1]
+        queues = {q["name"]: q for q in node.getrpcworkqueues()}
+        assert_equal(sorted(queues), ["default", "heavy", "read"])
+        assert_equal(queues["heavy"]["threads"], 1)
+        assert_equal(queues["read"]["threads"], 2)
+        assert_equal(queues["heavy"]["requests"], 0)
+        node.gettxoutsetinfo()
+        node.getblockcount()
+        node.getblockcount()
+        queues = {q["name"]: q for q in node.getrpcworkqueues()}
+        assert_equal(queues["heavy"]["requests"], 1)
+        assert_equal(queues["read"]["requests"], 2)
+        assert_equal(queues["heavy"]["rejected"], 0)
+        assert queues["heavy"]["run_max_us"] > 0
+
 
 if __name__ == '__main__':
     HTTPBasicsTest ().main ()
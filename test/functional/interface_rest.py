@@ -268,6 +268,22 @@ class RESTTest (PivxTestFramework):
         json_obj = json.loads(response_header_json_str)
         assert_equal(len(json_obj), 5) #now we should have 5 header objects
 
+        # stream a range of raw blocks, as their concatenation
+        start = self.nodes[0].getblockcount() - 4
+        response = http_get_call(url.hostname, url.port, '/rest/blockrange/%d/10%sbin' % (start, self.FORMAT_SEPARATOR), True)
+        assert_equal(response.status, 200)
+        expected = b''
+        for height in range(start, start + 5):
+            block_hash = self.nodes[0].getblockhash(height)
+            expected += http_get_call(url.hostname, url.port, '/rest/block/'+block_hash+self.FORMAT_SEPARATOR+"bin", True).read()
+        assert_equal(response.read(), expected)
+        response = http_get_call(url.hostname, url.port, '/rest/blockrange/%d/1%sjson' % (start, self.FORMAT_SEPARATOR), True)
+        assert_equal(response.status, 404)
+        response = http_get_call(url.hostname, url.port, '/rest/blockrange/%d/2001%sbin' % (start, self.FORMAT_SEPARATOR), True)
+        assert_equal(response.status, 400)
+        response = http_get_call(url.hostname, url.port, '/rest/blockrange/%d/1%sbin' % (start + 5, self.FORMAT_SEPARATOR), True)
+        assert_equal(response.status, 404)
+
         # do tx test
         tx_hash = block_json_obj['tx'][0]['txid']
         json_string = http_get_call(url.hostname, url.port, '/rest/tx/'+tx_hash+self.FORMAT_SEPARATOR+"json")
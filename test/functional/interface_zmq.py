@@ -126,5 +126,16 @@ class ZMQTest (PivxTestFramework):
         hex = self.rawtx.receive()
         assert_equal(payment_txid, hash256(hex).hex())
 
+        self.log.info("Check the active notifications")
+        notifications = sorted(self.nodes[0].getzmqnotifications(), key=lambda n: n["type"])
+        assert_equal([n["type"] for n in notifications], ["pubhashblock", "pubhashtx", "pubrawblock", "pubrawtx"])
+        for n in notifications:
+            sub = getattr(self, n["type"][3:])
+            assert_equal(n["address"], "tcp://127.0.0.1:28332")
+            assert_equal(n["hwm"], 1000)
+            assert_equal(n["sequence"], sub.sequence)
+            assert_equal(n["dropped"], 0)
+        assert_equal(self.nodes[1].getzmqnotifications(), [])
+
 if __name__ == '__main__':
     ZMQTest().main()
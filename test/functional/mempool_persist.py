@@ -31,6 +31,7 @@ Test is as follows:
 """
 
 from decimal import Decimal
+import os
 
 from test_framework.test_framework import PivxTestFramework
 from test_framework.util import (
@@ -86,7 +87,12 @@ class MempoolPersistTest(PivxTestFramework):
 
         self.log.debug("Stop-start node0. Verify that it has the transactions in its mempool.")
         self.stop_nodes()
-        self.start_node(0)
+        # The coins cache is persisted alongside the mempool
+        assert os.path.isfile(os.path.join(self.nodes[0].datadir, 'regtest', 'coinscache.dat'))
+        assert not os.path.isfile(os.path.join(self.nodes[0].datadir, 'regtest', 'coinscache.dat.new'))
+        # The tip didn't change: the scripts of the transactions are not verified again
+        with self.nodes[0].assert_debug_log(["Loading mempool validated at the current tip"]):
+            self.start_node(0)
         assert self.nodes[0].getmempoolinfo()["loaded"]
         assert_equal(len(self.nodes[0].getrawmempool()), 5)
 
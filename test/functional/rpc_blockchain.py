@@ -14,6 +14,7 @@ Test the following RPCs:
     - getchaintxstats
     - getnetworkhashps
     - verifychain
+    - batches of requests (executed on -rpcbatchthreads)
 
 Tests correspond to code in rpc/blockchain.cpp.
 """
@@ -32,12 +33,14 @@ from test_framework.util import (
 class BlockchainTest(PivxTestFramework):
     def set_test_params(self):
         self.num_nodes = 1
+        self.extra_args = [['-rpcbatchthreads=2']]
 
     def run_test(self):
         self._test_getblockchaininfo()
         self._test_gettxoutsetinfo()
         self._test_getblockheader()
         self._test_getblock()
+        self._test_batch()
         #self._test_getdifficulty()
         self.nodes[0].verifychain(0)
 
@@ -77,6 +80,16 @@ class BlockchainTest(PivxTestFramework):
         assert_equal(len(res['bestblock']), 64)
         assert_equal(len(res['hash_serialized_2']), 64)
 
+        # The set is read in parallel with the other hash types, with the same statistics
+        for hash_type in ['muhash', 'none']:
+            res2 = node.gettxoutsetinfo(hash_type)
+            for key in ['total_amount', 'transactions', 'height', 'txouts', 'bestblock', 'disk_size']:
+                assert_equal(res2[key], res[key])
+            assert 'hash_serialized_2' not in res2
+        assert_equal(len(node.gettxoutsetinfo('muhash')['muhash']), 64)
+        assert 'muhash' not in node.gettxoutsetinfo('none')
+        assert_raises_rpc_error(-8, "foo is not a valid hash_type", node.gettxoutsetinfo, "foo")
+
     def _test_getblockheader(self):
         node = self.nodes[0]
 
@@ -121,6 +134,34 @@ class BlockchainTest(PivxTestFramework):
         assert_is_hash_string(node.getblock(besthash, True)['tx'][0])
         assert_is_hex_string(node.getblock(besthash, 2)['tx'][0]['vin'][0]['coinbase'])
 
+    def _test_batch(self):
+        self.log.info("Test batch requests")
+        node = self.nodes[0]
+        height = node.getblockcount()
+        hashes = [node.getblockhash(h) for h in range(height + 1)]
+
+        # The read-only requests are executed in parallel, the other ones in sequence,
+        # and the replies are returned in the order of the requests
+        requests = []
+        for h in range(height + 1):
+            requests.append(node.getblockhash.get_request(h))
+            requests.append(node.getblock.get_request(hashes[h], 2))
+            if h % 50 == 0:
+                requests.append(node.getmempoolinfo.get_request())
+        requests.append(node.getblockhash.get_request(height + 1))
+        replies = node.batch(requests)
+        assert_equal(len(replies), len(requests))
+        for req, reply in zip(requests, replies):
+            assert_equal(reply['id'], req['id'])
+            if req['method'] == 'getblockhash' and req['params'][0] <= height:
+                assert_equal(reply['result'], hashes[req['params'][0]])
+            elif req['method'] == 'getblock':
+                assert_equal(reply['result']['hash'], req['params'][0])
+                assert_is_hex_string(reply['result']['tx'][0]['vin'][0]['coinbase'])
+            elif req['method'] == 'getmempoolinfo':
+                assert_equal(reply['result']['size'], 0)
+        assert_equal(replies[-1]['error']['code'], -8)
+
 
 if __name__ == '__main__':
     BlockchainTest().main()
@@ -10,6 +10,7 @@ from test_framework.test_framework import PivxTestFramework
 from test_framework.util import (
     assert_equal,
     assert_raises_rpc_error,
+    wait_until,
 )
 
 
@@ -111,6 +112,23 @@ class SaplingWalletSend(PivxTestFramework):
         assert_equal(len(self.nodes[0].listlockunspent()["shielded"]), 0)
         self.nodes[0].shieldsendmany("from_shield", recipient2)
 
+        self.log.info("Checking shieldsendmanyasync")
+        assert_raises_rpc_error(-8, "Invalid parameter, amounts array is empty.",
+                                self.nodes[2].shieldsendmanyasync, "from_transparent", [])
+        recipient3 = [{"address": self.nodes[1].getnewshieldaddress(), "amount": Decimal('1')}]
+        opids = [self.nodes[2].shieldsendmanyasync("from_transparent", recipient3) for _ in range(2)]
+        wait_until(lambda: all(op["status"] == "success" for op in self.nodes[2].getshieldoperationstatus(opids)))
+        results = self.nodes[2].getshieldoperationresult(opids)
+        assert_equal(sorted(op["id"] for op in results), sorted(opids))
+        # The concurrent operations spent different inputs
+        mempool = self.nodes[2].getrawmempool()
+        for op in results:
+            assert op["txid"] in mempool
+        assert results[0]["txid"] != results[1]["txid"]
+        # The results are given once, and finished operations can't be cancelled
+        assert_equal(self.nodes[2].getshieldoperationstatus(opids), [])
+        assert not self.nodes[2].cancelshieldoperation(opids[0])
+
 
 if __name__ == '__main__':
     SaplingWalletSend().main()
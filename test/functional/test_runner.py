@@ -103,6 +103,7 @@ BASE_SCRIPTS= [
     'interface_http.py',                        # ~ 105 sec
     'feature_abortnode.py',                     # ~ 101 sec
     'feature_blockhashcache.py',                # ~ 100 sec
+    'feature_verifydb.py',
     'p2p_invalid_tx.py',                        # ~ 98 sec
     'wallet_listtransactions.py',               # ~ 97 sec
     'wallet_listreceivedby.py',                 # ~ 94 sec
@@ -136,6 +137,7 @@ BASE_SCRIPTS= [
     'rpc_signrawtransaction.py',                # ~ 50 sec
     'rpc_decodescript.py',                      # ~ 50 sec
     'rpc_blockchain.py',                        # ~ 50 sec
+    'feature_addressindex.py',
     'wallet_disable.py',                        # ~ 50 sec
     'p2p_addrv2_relay.py',                      # ~ 49 sec
     'wallet_autocombine.py',                    # ~ 49 sec
@@ -52,6 +52,11 @@ class ChainLocksTest(PivxDMNTestFramework):
         for h in range(1, self.nodes[0].getblockcount()):
             block = self.nodes[0].getblock(self.nodes[0].getblockhash(h))
             assert block['chainlock']
+        # the stages latencies are tracked
+        stats = self.nodes[0].getchainlockstats()
+        assert stats['chainlocks'] > 0
+        assert_equal(stats['latency']['tip_to_chainlock']['count'],
+                     sum(b['count'] for b in stats['latency']['tip_to_chainlock']['buckets']))
 
         # Isolate node, mine on another, and reconnect
         self.nodes[0].setnetworkactive(False)
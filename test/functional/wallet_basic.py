@@ -95,6 +95,12 @@ class WalletTest(PivxTestFramework):
         memory_after = self.nodes[0].getmemoryinfo()
         assert memory_before['locked']['used'] + 32 <= memory_after['locked']['used']
         self.sync_mempools(self.nodes[0:3])
+        usage = self.nodes[0].getmemoryinfo("detailed")['usage']
+        assert usage['mempool'] > 0 and usage['coins_cache'] > 0 and usage['block_index'] > 0
+        assert usage['wallets']['']['transactions'] > 0
+        assert_equal(usage['total'], sum(v for k, v in usage.items() if k not in ('wallets', 'total')) +
+                     sum(sum(w.values()) for w in usage['wallets'].values()))
+        assert_raises_rpc_error(-8, "unknown mode", self.nodes[0].getmemoryinfo, "foo")
 
         # Node0 should have two unspent outputs.
         # One safe, the other one not yet
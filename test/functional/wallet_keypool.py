@@ -7,7 +7,7 @@
 import time
 
 from test_framework.test_framework import PivxTestFramework
-from test_framework.util import assert_equal, assert_raises_rpc_error
+from test_framework.util import assert_equal, assert_raises_rpc_error, wait_until
 
 
 class KeyPoolTest(PivxTestFramework):
@@ -78,5 +78,15 @@ class KeyPoolTest(PivxTestFramework):
         assert_equal(wi['keypoolsize_hd_internal'], 100)
         assert_equal(wi['keypoolsize'], 100)
 
+        # the keys drawn from the pool are replaced in the background
+        self.restart_node(0, ['-keypool=100'])
+        nodes[0].walletpassphrase('test', 100)
+        nodes[0].getnewaddress()
+        nodes[0].getnewaddress()
+        nodes[0].getrawchangeaddress()
+        nodes[0].getrawchangeaddress()
+        wait_until(lambda: nodes[0].getwalletinfo()['keypoolsize'] == 100)
+        wait_until(lambda: nodes[0].getwalletinfo()['keypoolsize_hd_internal'] == 100)
+
 if __name__ == '__main__':
     KeyPoolTest().main()
@@ -71,6 +71,10 @@ class ResendWalletTransactionsTest(PivxTestFramework):
         # Use mocktime and give an extra 5 minutes to be sure.
         rebroadcast_time = int(time.time()) + 41 * 60
         node.setmocktime(rebroadcast_time)
+        # The rebroadcasts are spread over the five minutes after the resend.
+        # Give it time to schedule them before moving past them.
+        time.sleep(1)
+        node.setmocktime(rebroadcast_time + 6 * 60)
         wait_until(lambda: node.p2ps[1].tx_invs_received[txid] >= 1, lock=mininode_lock)
 
 if __name__ == '__main__':